@@ -13,7 +13,10 @@
  *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 #include <Uefi.h>
+#include <Pi/PiFirmwareFile.h>
+#include <Pi/PiFirmwareVolume.h>
 
+#include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DevicePathLib.h>
 #include <Library/MemoryAllocationLib.h>
@@ -25,14 +28,94 @@
 #include <Library/UefiLib.h>
 
 #include <Protocol/AdapterInformation.h>
-#include <Protocol/ComponentName.h>
-#include <Protocol/ComponentName2.h>
+#include <Protocol/Decompress.h>
+#include <Protocol/FirmwareVolume2.h>
+#include <Protocol/FirmwareVolumeBlock.h>
+#include <Protocol/Http.h>
+#include <Protocol/ServiceBinding.h>
 #include <Protocol/FirmwareManagement.h>
 
 #include "IFXTPMUpdate.h"
 
 #define SIZE_SHA1 20
 
+/// Number of bytes read from a file at once by LoadFile
+#define LOAD_FILE_CHUNK_SIZE (64 * 1024)
+
+/// Duration in microseconds of the stall used to calibrate the time-stamp counter for the batch step and run summary durations
+#define BATCH_CALIBRATION_STALL_US 10000
+
+/// Command line option selecting the run summary file
+#define SUMMARY_OPTION L"-summary"
+
+/// Size of the run summary record in bytes
+#define SUMMARY_BUFFER_SIZE 2048
+
+/// Name of the log file
+#define LOG_FILE_NAME L"RunIFXTPMUpdate.log"
+
+/// Name of the shell environment variable selecting the log mode. Set it to "memory" to only write the log file if the command fails.
+#define LOG_MODE_VARIABLE L"RunIFXTPMUpdateLogMode"
+
+/// Name of the shell environment variable selecting the log file encoding. Set it to "utf8" to write UTF-8 instead of UCS-2 LE.
+#define LOG_ENCODING_VARIABLE L"RunIFXTPMUpdateLogEncoding"
+
+/// Size of the stack buffer used to convert a log message to UTF-8 in bytes
+#define LOG_UTF8_CHUNK_SIZE 256
+
+/// Size of the log buffer in bytes. In memory-only mode the log file receives the most recent messages up to this size.
+#define LOG_BUFFER_SIZE (512 * 1024)
+
+/// Number of buffered bytes that causes the log buffer to be written to the log file
+#define LOG_FLUSH_THRESHOLD (LOG_BUFFER_SIZE - 64 * 1024)
+
+/// Ring buffer holding the log messages not yet written to the log file
+static UINT8 s_rgbLogBuffer[LOG_BUFFER_SIZE];
+
+/// Offset of the oldest byte in s_rgbLogBuffer
+static UINTN s_ullLogStart = 0;
+
+/// Number of bytes used in s_rgbLogBuffer
+static UINTN s_ullLogUsed = 0;
+
+/// Handle of the log file while it is open
+static SHELL_FILE_HANDLE s_hLogFile = NULL;
+
+/// Flag indicating that the log is only kept in memory and written to the log file if the command fails
+static BOOLEAN s_fLogMemoryOnly = FALSE;
+
+/// Flag indicating that the log messages are converted to UTF-8 before they are buffered
+static BOOLEAN s_fLogUtf8 = FALSE;
+
+/// Handle of the driver while its SetImage method reports the progress to ProgressCallback
+static EFI_HANDLE s_hProgressDriver = NULL;
+
+/// Run summary written to the file given with -summary
+typedef struct {
+    /// Update type given on the command line
+    CONST CHAR16*   Method;
+    /// Firmware image given on the command line (NULL if none)
+    CONST CHAR16*   Image;
+    /// Result of the run
+    EFI_STATUS      Status;
+    /// Time-stamp counter increments per millisecond
+    UINT64          TicksPerMs;
+    /// Time-stamp counter increments spent loading the driver
+    UINT64          DriverLoadTicks;
+    /// Time-stamp counter increments spent loading the firmware image
+    UINT64          ImageLoadTicks;
+    /// Time-stamp counter increments spent in CheckImage
+    UINT64          CheckImageTicks;
+    /// Time-stamp counter increments spent in SetImage
+    UINT64          SetImageTicks;
+    /// Time-stamp counter increments of the whole run
+    UINT64          TotalTicks;
+    /// TRUE if History holds the update attempt of this run
+    BOOLEAN         HistoryValid;
+    /// Update attempt of this run as recorded by the driver
+    EFI_IFXTPM_UPDATE_HISTORY_ENTRY History;
+} RUN_SUMMARY;
+
 /**
  *  @brief      Shows the usage of the program.
  *  @details    The function shows the usage of the program.
@@ -43,6 +126,7 @@ ShowUsage()
 {
     Print(L"Usage:\n");
     Print(L" RunIFXTPMUpdate.efi <update-type|driver-method> <driver> [firmware] [policy-session-handle] [owner-auth]\n");
+    Print(L" RunIFXTPMUpdate.efi batch <driver> <driver-method> [<driver-method> ...] [firmware]\n");
     Print(L"\n");
     Print(L"Mandatory parameters:\n");
     Print(L" <update-type>:           The update type to use. Supported types:\n");
@@ -58,16 +142,29 @@ ShowUsage()
     Print(L"  call-getFuDetails        EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation()\n");
     Print(L"  call-setImage            EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
     Print(L"  call-setOperational      EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
+    Print(L" batch:                   Call the given driver methods in order with one driver load and report their durations.\n");
+    Print(L"                          The batch stops at the first failing method.\n");
+    Print(L" -summary <file>:         Write a key=value summary of the run (versions, result and step durations) to <file>\n");
+    Print(L"                          on exit (applicable to <update-type>)\n");
     Print(L" <driver>:                Path to the Infineon TPM Firmware Update Driver\n");
     Print(L"\n");
     Print(L"Additional parameters:\n");
-    Print(L" [firmware]:              Path to the TPM firmware image\n");
+    Print(L" [firmware]:              Path to the TPM firmware image (raw or compressed with TianoCompress -e)\n");
+    Print(L"                          or fv:<GUID> for the FFS file <GUID> in a firmware volume\n");
+    Print(L"                          or an http:// or https:// URL to download it\n");
     Print(L" [policy-session-handle]: Handle of Policy Session (hex, applicable to <update-type> tpm20)\n");
     Print(L" [owner-auth]:            20 byte TPM Owner authorization value (hex, applicable to <update-type> tpm12-owned) (if empty the default password \"12345678\" will be used)\n");
     Print(L"\n");
+    Print(L"Logging:\n");
+    Print(L" Messages are logged to RunIFXTPMUpdate.log. Set the shell environment variable %s to \"memory\"\n", LOG_MODE_VARIABLE);
+    Print(L" to keep the log in memory and only write it if the command fails.\n");
+    Print(L" Set %s to \"utf8\" to write the log file as UTF-8 instead of UCS-2 LE\n", LOG_ENCODING_VARIABLE);
+    Print(L" (delete an existing log file when switching the encoding).\n");
+    Print(L"\n");
     Print(L"Examples (with s = TPM source FW version, t = TPM target FW version):\n");
     Print(L" RunIFXTPMUpdate.efi tpm20 IFXTPMUpdate.efi TPM20_t_R1.bin 3000000\n");
     Print(L" RunIFXTPMUpdate.efi tpm20 IFXTPMUpdate.efi TPM20_s_to_TPM20_t.bin 3000000\n");
+    Print(L" RunIFXTPMUpdate.efi -summary summary.txt tpm20 IFXTPMUpdate.efi TPM20_s_to_TPM20_t.bin 3000000\n");
     Print(L" RunIFXTPMUpdate.efi tpm20-nonOperational IFXTPMUpdate.efi TPM20_t_R1.bin\n");
     Print(L" RunIFXTPMUpdate.efi tpm12-PP IFXTPMUpdate.efi TPM12_s_to_TPM20_t.bin\n");
     Print(L" RunIFXTPMUpdate.efi tpm12-owned IFXTPMUpdate.efi TPM12_s_to_TPM12_t.bin 0102..1920\n");
@@ -79,6 +176,8 @@ ShowUsage()
     Print(L" RunIFXTPMUpdate.efi call-getFuDetails IFXTPMUpdate.efi\n");
     Print(L" RunIFXTPMUpdate.efi call-setImage IFXTPMUpdate.efi TPM20_t_R1.bin\n");
     Print(L" RunIFXTPMUpdate.efi call-setOperational IFXTPMUpdate.efi\n");
+    Print(L" or\n");
+    Print(L" RunIFXTPMUpdate.efi batch IFXTPMUpdate.efi call-getImageInfo call-getFuCounters call-getFuDetails call-checkImage TPM20_t_R1.bin\n");
     Print(L"Example image names:\n");
     Print(L" TPM20_15.20.15686.0_R1.bin\n");
     Print(L" TPM20_7.63.3144.0_to_TPM20_7.85.4555.0.bin\n");
@@ -102,14 +201,18 @@ PrintGuid(
 
 /**
  *  @brief      Loads a file from disk.
- *  @details    The function allocates PppData with AllocateZeroPool(). It is the callers responsibility to free the memory with FreePool().
+ *  @details    The function allocates PppData with AllocatePool() and reads the file in chunks of LOAD_FILE_CHUNK_SIZE bytes
+ *              directly into it. It is the callers responsibility to free the memory with FreePool().
  *
  *  @param      PwszPath        Path to the file on disk. Omit the drive part.
  *  @param      PppData         Will receive a pointer to the file contents.
  *  @param      PpunSizeData    Will receive the size in bytes of the file contents.
  *
- *  @retval     EFI_SUCCESS     The function executed successfully.
- *  @retval     other           An error occurred when executing this function.
+ *  @retval     EFI_SUCCESS             The function executed successfully.
+ *  @retval     EFI_OUT_OF_RESOURCES    The memory for the file contents could not be allocated.
+ *  @retval     EFI_BAD_BUFFER_SIZE     The file is empty or too large.
+ *  @retval     EFI_END_OF_FILE         The file ended before its reported size was read.
+ *  @retval     other                   An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
@@ -121,13 +224,15 @@ LoadFile(
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
     SHELL_FILE_HANDLE hFile = NULL;
     UINT64 ullSize = 0;
-    VOID* pBuffer = NULL;
+    UINT8* pbBuffer = NULL;
 
     *PppData = NULL;
     *PpunSizeData = 0;
 
     do
     {
+        UINT64 ullOffset = 0;
+
         efiStatus = ShellOpenFileByName((CHAR16*)PwszPath, &hFile, EFI_FILE_MODE_READ, EFI_FILE_READ_ONLY);
         if (EFI_ERROR(efiStatus))
             break;
@@ -136,9 +241,37 @@ LoadFile(
         if (EFI_ERROR(efiStatus))
             break;
 
-        pBuffer = (VOID*)AllocateZeroPool(ullSize);
+        if (0 == ullSize || ullSize > MAX_UINT32)
+        {
+            efiStatus = EFI_BAD_BUFFER_SIZE;
+            break;
+        }
+
+        // The buffer is completely overwritten by the file contents, so it does not need to be zeroed
+        pbBuffer = (UINT8*)AllocatePool((UINTN)ullSize);
+        if (NULL == pbBuffer)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        // Read the file in chunks, a read may return less than requested
+        while (ullOffset < ullSize)
+        {
+            UINTN ullChunkSize = LOAD_FILE_CHUNK_SIZE;
+            if (ullChunkSize > ullSize - ullOffset)
+                ullChunkSize = (UINTN)(ullSize - ullOffset);
 
-        efiStatus = ShellReadFile(hFile, &ullSize, pBuffer);
+            efiStatus = ShellReadFile(hFile, &ullChunkSize, &pbBuffer[ullOffset]);
+            if (EFI_ERROR(efiStatus))
+                break;
+            if (0 == ullChunkSize)
+            {
+                efiStatus = EFI_END_OF_FILE;
+                break;
+            }
+            ullOffset += ullChunkSize;
+        }
         if (EFI_ERROR(efiStatus))
             break;
 
@@ -147,13 +280,16 @@ LoadFile(
         if (EFI_ERROR(efiStatus))
             break;
 
-        *PppData = pBuffer;
+        *PppData = pbBuffer;
         *PpunSizeData = (UINT32)ullSize;
+        pbBuffer = NULL;
     }
     while (FALSE);
 
     if (hFile != NULL)
         ShellCloseFile(&hFile);
+    if (pbBuffer != NULL)
+        FreePool(pbBuffer);
 
     return efiStatus;
 }
@@ -161,78 +297,58 @@ LoadFile(
 /**
  *  @ingroup    RunIFXTPMUpdate
  *  @brief      Checks if IFXTPMUpdate.efi is loaded.
- *  @details    The function searches for IFXTPMUpdate.efi with @ref IFXTPMUpdate_ComponentName_GetDriverName "EFI_COMPONENT_NAME_PROTOCOL.GetDriverName()" and
- *              @ref IFXTPMUpdate_ComponentName_GetDriverName "EFI_COMPONENT_NAME2_PROTOCOL.GetDriverName()". It parses all loaded drivers for a driver with name "Infineon TPM Firmware Update Driver".
+ *  @details    The function searches for the handle with the EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL installed by IFXTPMUpdate.efi.
+ *              A single LocateHandleBuffer(ByProtocol) call finds the driver, the drivers with EFI_COMPONENT_NAME_PROTOCOL and
+ *              EFI_COMPONENT_NAME2_PROTOCOL do not need to be queried for their names.
+ *
+ *  @param      PphDriver       Receives the handle of the loaded driver, may be NULL.
  *
  *  @retval     EFI_SUCCESS     The IFXTPMUpdate.efi driver is loaded.
  *  @retval     EFI_NOT_FOUND   The IFXTPMUpdate.efi driver is not loaded.
+ *  @retval     EFI_UNSUPPORTED The loaded driver implements an older revision of EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL.
  *  @retval     other           An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
-IsDriverLoaded()
+IsDriverLoaded(
+    OUT EFI_HANDLE* PphDriver OPTIONAL)
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
-    EFI_COMPONENT_NAME_PROTOCOL* pCompName = NULL;
-    EFI_COMPONENT_NAME2_PROTOCOL* pCompName2 = NULL;
-    BOOLEAN fIsLoaded = FALSE;
+    EFI_GUID guidDriverProtocol = EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_GUID;
+    EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL* pDriverProtocol = NULL;
     UINTN ullHandleCount = 0;
     EFI_HANDLE* pHandleBuffer = NULL;
-    UINTN ullIndex = 0;
-    CHAR16* wszDriverName = NULL;
-    // Driver name which is returned by IFXTPMUpdate.efi in EFI_COMPONENT_NAME_PROTOCOL and EFI_COMPONENT_NAME2_PROTOCOL
-    CHAR16 wszInfineonDriverName[] = L"Infineon TPM Firmware Update Driver";
 
     Print(L"\nIsDriverLoaded()\n");
-    Print(L"  Search driver with EFI_COMPONENT_NAME2_PROTOCOL:\n");
-    efiStatus = gBS->LocateHandleBuffer(ByProtocol, &gEfiComponentName2ProtocolGuid, NULL, &ullHandleCount, &pHandleBuffer);
-    for (ullIndex = 0; ullIndex < ullHandleCount; ullIndex++)
+    do
     {
-        efiStatus = gBS->OpenProtocol(pHandleBuffer[ullIndex], &gEfiComponentName2ProtocolGuid, (VOID **)&pCompName2, gImageHandle, NULL, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+        efiStatus = gBS->LocateHandleBuffer(ByProtocol, &guidDriverProtocol, NULL, &ullHandleCount, &pHandleBuffer);
         if (EFI_ERROR(efiStatus))
-            continue;
-
-        efiStatus = pCompName2->GetDriverName(pCompName2, "en", &wszDriverName);
-        if (EFI_SUCCESS == efiStatus)
+            break;
+        if (0 == ullHandleCount)
         {
-            if (0 == (int)StrnCmp(wszDriverName, wszInfineonDriverName, sizeof(wszInfineonDriverName) / sizeof(wszInfineonDriverName[0])))
-            {
-                Print(L"    ComponentName2.Name: %s\n", wszDriverName);
-                fIsLoaded = TRUE;
-            }
+            efiStatus = EFI_NOT_FOUND;
+            break;
         }
 
-        efiStatus = gBS->CloseProtocol(pHandleBuffer[ullIndex], &gEfiComponentName2ProtocolGuid, gImageHandle, NULL);
-    }
-    if (NULL != pHandleBuffer)
-        FreePool(pHandleBuffer);
-
-    Print(L"  Search driver with EFI_COMPONENT_NAME_PROTOCOL:\n");
-    efiStatus = gBS->LocateHandleBuffer(ByProtocol, &gEfiComponentNameProtocolGuid, NULL, &ullHandleCount, &pHandleBuffer);
-    for (ullIndex = 0; ullIndex < ullHandleCount; ullIndex++)
-    {
-        efiStatus = gBS->OpenProtocol(pHandleBuffer[ullIndex], &gEfiComponentNameProtocolGuid, (VOID **)&pCompName, gImageHandle, NULL, EFI_OPEN_PROTOCOL_GET_PROTOCOL);
+        efiStatus = gBS->HandleProtocol(pHandleBuffer[0], &guidDriverProtocol, (VOID**)&pDriverProtocol);
         if (EFI_ERROR(efiStatus))
-            continue;
-
-        efiStatus = pCompName->GetDriverName(pCompName, "eng;en", &wszDriverName);
-        if (EFI_SUCCESS == efiStatus)
+            break;
+        Print(L"  Driver handle: 0x%p, interface revision: 0x%.8X\n", pHandleBuffer[0], pDriverProtocol->Revision);
+        if (pDriverProtocol->Revision < EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_REVISION)
         {
-            if (0 == (int)StrnCmp(wszDriverName, wszInfineonDriverName, sizeof(wszInfineonDriverName) / sizeof(wszInfineonDriverName[0])))
-            {
-                Print(L"    ComponentName.Name: %s\n", wszDriverName);
-                fIsLoaded = TRUE;
-            }
+            efiStatus = EFI_UNSUPPORTED;
+            break;
         }
 
-        efiStatus = gBS->CloseProtocol(pHandleBuffer[ullIndex], &gEfiComponentNameProtocolGuid, gImageHandle, NULL);
+        if (NULL != PphDriver)
+            *PphDriver = pHandleBuffer[0];
     }
+    while (FALSE);  // Loop construct for error handling
+
     if (NULL != pHandleBuffer)
         FreePool(pHandleBuffer);
 
-    if (EFI_SUCCESS == efiStatus && !fIsLoaded)
-        efiStatus = EFI_NOT_FOUND;
-
     Print(L"End IsDriverLoaded(), Status: 0x%.16lX\n", efiStatus);
     return efiStatus;
 }
@@ -325,44 +441,49 @@ UnloadDriver(
 
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Callback function for logging of IFXTPMUpdate.efi.
- *  @details    The function is used as logging callback for IFXTPMUpdate.efi. IFXTPMUpdate.efi calls this function to log messages. The function appends the messages to a log file RunIFXTPMUpdate.log.
- *
- *  @param      PullBufferSize  Size of PwszBuffer in bytes including zero termination.
- *  @param      PwszBuffer      Buffer containing the null-terminated message to be logged.
+ *  @brief      Opens the log file for appending.
+ *  @details    The function creates the log file RunIFXTPMUpdate.log (with UCS-2 LE or UTF-8 byte order mark depending on the selected
+ *              encoding) or opens the existing one at its end.
+ *              The file stays open until CloseLogging() is called.
  *
- *  @retval     EFI_SUCCESS     The callback executed successfully.
- *  @retval     other           The callback failed (will be ignored by IFXTPMUpdate.efi).
+ *  @retval     EFI_SUCCESS     The log file is open.
+ *  @retval     other           An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
-LoggingCallback(
-    IN  UINTN   PullBufferSize,
-    IN  CHAR16* PwszBuffer)
+OpenLogFile()
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
     SHELL_FILE_HANDLE hFile = NULL;
 
     do
     {
-        CHAR16 wszLogFile[] = L"RunIFXTPMUpdate.log";
-        efiStatus = ShellFileExists(wszLogFile);
+        // Log file already open?
+        if (s_hLogFile != NULL)
+        {
+            efiStatus = EFI_SUCCESS;
+            break;
+        }
+
+        efiStatus = ShellFileExists(LOG_FILE_NAME);
         if (EFI_NOT_FOUND == efiStatus)
         {
             CHAR8 bom_ucs2le[] = {0xFF, 0xFE};
-            UINTN ullSizeBom = sizeof(bom_ucs2le);
+            CHAR8 bom_utf8[] = {0xEF, 0xBB, 0xBF};
+            CHAR8* pbBom = s_fLogUtf8 ? bom_utf8 : bom_ucs2le;
+            UINTN ullSizeBom = s_fLogUtf8 ? sizeof(bom_utf8) : sizeof(bom_ucs2le);
 
-            efiStatus = ShellOpenFileByName(wszLogFile, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ | EFI_FILE_MODE_CREATE, 0);
+            efiStatus = ShellOpenFileByName(LOG_FILE_NAME, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ | EFI_FILE_MODE_CREATE, 0);
             if (EFI_ERROR(efiStatus))
                 break;
 
-            efiStatus = ShellWriteFile(hFile, &ullSizeBom, bom_ucs2le);
+            efiStatus = ShellWriteFile(hFile, &ullSizeBom, pbBom);
             if (EFI_ERROR(efiStatus))
                 break;
         }
         else if (EFI_SUCCESS == efiStatus)
         {
-            efiStatus = ShellOpenFileByName(wszLogFile, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ, 0);
+            efiStatus = ShellOpenFileByName(LOG_FILE_NAME, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ, 0);
             if (EFI_ERROR(efiStatus))
                 break;
 
@@ -373,21 +494,229 @@ LoggingCallback(
         else
             break;
 
-        // Write buffer without zero termination
-        PullBufferSize -= 2;
-        efiStatus = ShellWriteFile(hFile, &PullBufferSize, PwszBuffer);
-        if (EFI_ERROR(efiStatus))
+        s_hLogFile = hFile;
+        hFile = NULL;
+    } while(FALSE);
+
+    if (hFile != NULL)
+        ShellCloseFile(&hFile);
+
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Writes the log buffer to the log file.
+ *  @details    The function appends the contents of the log buffer to the log file and empties the buffer.
+ *              Data that could not be written stays in the buffer.
+ *
+ *  @retval     EFI_SUCCESS     The log buffer was written successfully.
+ *  @retval     other           An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+FlushLog()
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do
+    {
+        if (0 == s_ullLogUsed)
             break;
 
-        efiStatus = ShellCloseFile(&hFile);
+        efiStatus = OpenLogFile();
         if (EFI_ERROR(efiStatus))
             break;
 
-        hFile = NULL;
+        // Write the buffered data in at most two parts (up to the end of the ring buffer and from its beginning)
+        while (s_ullLogUsed > 0)
+        {
+            UINTN ullChunk = MIN(s_ullLogUsed, LOG_BUFFER_SIZE - s_ullLogStart);
+            UINTN ullWritten = ullChunk;
+            efiStatus = ShellWriteFile(s_hLogFile, &ullWritten, &s_rgbLogBuffer[s_ullLogStart]);
+            if (EFI_ERROR(efiStatus))
+                break;
+
+            s_ullLogStart = (s_ullLogStart + ullChunk) % LOG_BUFFER_SIZE;
+            s_ullLogUsed -= ullChunk;
+        }
+
+        if (0 == s_ullLogUsed)
+            s_ullLogStart = 0;
     } while(FALSE);
 
-    if (hFile != NULL)
-        ShellCloseFile(&hFile);
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Finishes logging.
+ *  @details    The function writes the log buffer to the log file and closes it. In memory-only mode the buffered messages are only
+ *              written if the command failed and are discarded otherwise.
+ *
+ *  @param      PfFailed        Set to TRUE if the command failed, set to FALSE otherwise.
+ */
+VOID
+EFIAPI
+CloseLogging(
+    IN  BOOLEAN     PfFailed)
+{
+    if (!s_fLogMemoryOnly || PfFailed)
+        FlushLog();
+
+    s_ullLogStart = 0;
+    s_ullLogUsed = 0;
+
+    if (s_hLogFile != NULL)
+        ShellCloseFile(&s_hLogFile);
+    s_hLogFile = NULL;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Appends data to the log buffer.
+ *  @details    The function appends the data to the ring buffer, overwriting the oldest data if the buffer is full.
+ *              Data larger than the whole buffer is truncated to its end.
+ *
+ *  @param      PpbData         Data to be appended.
+ *  @param      PullDataSize    Size of PpbData in bytes.
+ */
+VOID
+EFIAPI
+AppendLogData(
+    IN  CONST UINT8*    PpbData,
+    IN  UINTN           PullDataSize)
+{
+    // Keep only the end of data that is larger than the whole buffer
+    if (PullDataSize > LOG_BUFFER_SIZE)
+    {
+        PpbData += PullDataSize - LOG_BUFFER_SIZE;
+        PullDataSize = LOG_BUFFER_SIZE;
+    }
+
+    while (PullDataSize > 0)
+    {
+        UINTN ullEnd = (s_ullLogStart + s_ullLogUsed) % LOG_BUFFER_SIZE;
+        UINTN ullChunk = MIN(PullDataSize, LOG_BUFFER_SIZE - ullEnd);
+        CopyMem(&s_rgbLogBuffer[ullEnd], PpbData, ullChunk);
+
+        s_ullLogUsed += ullChunk;
+        if (s_ullLogUsed > LOG_BUFFER_SIZE)
+        {
+            s_ullLogStart = (s_ullLogStart + s_ullLogUsed - LOG_BUFFER_SIZE) % LOG_BUFFER_SIZE;
+            s_ullLogUsed = LOG_BUFFER_SIZE;
+        }
+
+        PpbData += ullChunk;
+        PullDataSize -= ullChunk;
+    }
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Appends a log message to the log buffer as UTF-8.
+ *  @details    The function converts the UCS-2 message in chunks on the stack. Surrogate pairs are combined to one four byte sequence,
+ *              unpaired surrogates are replaced with U+FFFD.
+ *
+ *  @param      PwszMessage     Message to be appended.
+ *  @param      PullLength      Length of PwszMessage in characters without zero termination.
+ */
+VOID
+EFIAPI
+AppendLogMessageUtf8(
+    IN  CONST CHAR16*   PwszMessage,
+    IN  UINTN           PullLength)
+{
+    UINT8 rgbChunk[LOG_UTF8_CHUNK_SIZE];
+    UINTN ullChunkUsed = 0;
+    UINTN ullIndex = 0;
+
+    while (ullIndex < PullLength)
+    {
+        UINT32 unCodePoint = PwszMessage[ullIndex++];
+
+        if (unCodePoint >= 0xD800 && unCodePoint <= 0xDBFF && ullIndex < PullLength &&
+                PwszMessage[ullIndex] >= 0xDC00 && PwszMessage[ullIndex] <= 0xDFFF)
+        {
+            unCodePoint = 0x10000 + ((unCodePoint - 0xD800) << 10) + (PwszMessage[ullIndex++] - 0xDC00);
+        }
+        else if (unCodePoint >= 0xD800 && unCodePoint <= 0xDFFF)
+        {
+            unCodePoint = 0xFFFD;
+        }
+
+        // Make room for the longest sequence
+        if (ullChunkUsed > sizeof(rgbChunk) - 4)
+        {
+            AppendLogData(rgbChunk, ullChunkUsed);
+            ullChunkUsed = 0;
+        }
+
+        if (unCodePoint < 0x80)
+        {
+            rgbChunk[ullChunkUsed++] = (UINT8)unCodePoint;
+        }
+        else if (unCodePoint < 0x800)
+        {
+            rgbChunk[ullChunkUsed++] = (UINT8)(0xC0 | (unCodePoint >> 6));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | (unCodePoint & 0x3F));
+        }
+        else if (unCodePoint < 0x10000)
+        {
+            rgbChunk[ullChunkUsed++] = (UINT8)(0xE0 | (unCodePoint >> 12));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | ((unCodePoint >> 6) & 0x3F));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | (unCodePoint & 0x3F));
+        }
+        else
+        {
+            rgbChunk[ullChunkUsed++] = (UINT8)(0xF0 | (unCodePoint >> 18));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | ((unCodePoint >> 12) & 0x3F));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | ((unCodePoint >> 6) & 0x3F));
+            rgbChunk[ullChunkUsed++] = (UINT8)(0x80 | (unCodePoint & 0x3F));
+        }
+    }
+
+    if (ullChunkUsed > 0)
+        AppendLogData(rgbChunk, ullChunkUsed);
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Callback function for logging of IFXTPMUpdate.efi.
+ *  @details    The function is used as logging callback for IFXTPMUpdate.efi. IFXTPMUpdate.efi calls this function to log messages. The function collects
+ *              the messages in a ring buffer which is appended to the log file RunIFXTPMUpdate.log once it is nearly full and when logging is finished.
+ *              In memory-only mode the ring buffer keeps the most recent messages and is only written if the command fails.
+ *              In UTF-8 mode the messages are converted before they are buffered, which halves the size of mostly ASCII logs.
+ *
+ *  @param      PullBufferSize  Size of PwszBuffer in bytes including zero termination.
+ *  @param      PwszBuffer      Buffer containing the null-terminated message to be logged.
+ *
+ *  @retval     EFI_SUCCESS     The callback executed successfully.
+ *  @retval     other           The callback failed (will be ignored by IFXTPMUpdate.efi).
+ */
+EFI_STATUS
+EFIAPI
+LoggingCallback(
+    IN  UINTN   PullBufferSize,
+    IN  CHAR16* PwszBuffer)
+{
+    do
+    {
+        if (NULL == PwszBuffer || PullBufferSize < sizeof(CHAR16))
+            break;
+
+        // Buffer without zero termination
+        PullBufferSize -= sizeof(CHAR16);
+
+        // Append the message, overwriting the oldest data if the buffer is full
+        if (s_fLogUtf8)
+            AppendLogMessageUtf8(PwszBuffer, PullBufferSize / sizeof(CHAR16));
+        else
+            AppendLogData((CONST UINT8*)PwszBuffer, PullBufferSize);
+
+        if (!s_fLogMemoryOnly && s_ullLogUsed >= LOG_FLUSH_THRESHOLD)
+            FlushLog();
+    } while(FALSE);
 
     return EFI_SUCCESS;
 }
@@ -428,7 +757,11 @@ ConfigureLogging(
         Print(L"  EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation()\n");
         if (TRUE == PfEnableLogging)
         {
-            Print(L"    Enable logging\n");
+            CONST CHAR16* pwszLogMode = ShellGetEnvironmentVariable(LOG_MODE_VARIABLE);
+            CONST CHAR16* pwszLogEncoding = ShellGetEnvironmentVariable(LOG_ENCODING_VARIABLE);
+            s_fLogMemoryOnly = (pwszLogMode != NULL && StrCmp(pwszLogMode, L"memory") == 0);
+            s_fLogUtf8 = (pwszLogEncoding != NULL && StrCmp(pwszLogEncoding, L"utf8") == 0);
+            Print(L"    Enable logging%s%s\n", s_fLogMemoryOnly ? L" (memory-only)" : L"", s_fLogUtf8 ? L" (UTF-8)" : L"");
             descriptor.LogCallback = &LoggingCallback;
             descriptor.AddTimeStamps = TRUE;
         }
@@ -541,153 +874,665 @@ IsTpmUpdatable(
 
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Loads a TPM firmware image from disk.
- *  @details    The function allocates PppFirmwareImage with AllocateZeroPool(). It is the callers responsibility to free the memory with FreePool().
+ *  @brief      Expands a TPM firmware image compressed with the EFI compression algorithm.
+ *  @details    Firmware images may be stored compressed with the EFI compression algorithm (e.g. TianoCompress -e), which
+ *              reduces the amount of data read from slow media. The compressed format starts with the compressed size and
+ *              the original size (UINT32 each), so a file is recognized as compressed if the first value plus the 8 bytes
+ *              of the sizes equals the file size and EFI_DECOMPRESS_PROTOCOL.GetInfo() accepts it. The signed Infineon
+ *              firmware image inside is unchanged and verified by the driver as before. Other files are left untouched.
+ *              On success the compressed buffer is freed and replaced by the expanded image.
  *
- *  @param      PwszPath                Path to the firmware image on disk. Omit the drive part.
- *  @param      PppFirmwareImage        Will receive pointer to the firmware image.
- *  @param      PpunSizeFirmwareImage   Will receive size in bytes of the firmware image.
+ *  @param      PppFirmwareImage        On input the loaded file, on output the expanded firmware image.
+ *  @param      PpunSizeFirmwareImage   On input the size of the loaded file, on output the size of the firmware image.
  *
- *  @retval     EFI_SUCCESS     The function executed successfully.
- *  @retval     other           An error occurred when executing this function.
+ *  @retval     EFI_SUCCESS             The image was expanded or is not compressed.
+ *  @retval     EFI_UNSUPPORTED         The image is compressed but EFI_DECOMPRESS_PROTOCOL is not available.
+ *  @retval     EFI_OUT_OF_RESOURCES    The memory for the expanded image could not be allocated.
+ *  @retval     other                   An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
-LoadFirmwareImage(
-    IN  const CHAR16*   PwszPath,
-    OUT VOID**          PppFirmwareImage,
-    OUT UINT32*         PpunSizeFirmwareImage)
+DecompressFirmwareImage(
+    IN OUT  VOID**      PppFirmwareImage,
+    IN OUT  UINT32*     PpunSizeFirmwareImage)
 {
-    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
-    Print(L"\nLoadFirmwareImage()\n");
-    efiStatus = LoadFile(PwszPath, PppFirmwareImage, PpunSizeFirmwareImage);
-    Print(L"End LoadFirmwareImage(), Status: 0x%.16lX\n", efiStatus);
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    EFI_DECOMPRESS_PROTOCOL* pDecompress = NULL;
+    VOID* pScratch = NULL;
+    VOID* pDestination = NULL;
+
+    do
+    {
+        UINT32 unCompressedSize = 0;
+        UINT32 unDestinationSize = 0;
+        UINT32 unScratchSize = 0;
+
+        // Check the size header of the EFI compression format
+        if (*PpunSizeFirmwareImage < 2 * sizeof(UINT32))
+            break;
+        unCompressedSize = ReadUnaligned32((const UINT32*)*PppFirmwareImage);
+        if (unCompressedSize != *PpunSizeFirmwareImage - 2 * sizeof(UINT32))
+            break;
+
+        efiStatus = gBS->LocateProtocol(&gEfiDecompressProtocolGuid, NULL, (VOID**)&pDecompress);
+        if (EFI_ERROR(efiStatus))
+        {
+            Print(L"  The firmware image is compressed but EFI_DECOMPRESS_PROTOCOL is not available.\n");
+            efiStatus = EFI_UNSUPPORTED;
+            break;
+        }
+
+        // A raw image whose first bytes happen to match the compressed size is rejected by GetInfo
+        efiStatus = pDecompress->GetInfo(pDecompress, *PppFirmwareImage, *PpunSizeFirmwareImage, &unDestinationSize, &unScratchSize);
+        if (EFI_ERROR(efiStatus) || 0 == unDestinationSize)
+        {
+            efiStatus = EFI_SUCCESS;
+            break;
+        }
+
+        pDestination = AllocatePool(unDestinationSize);
+        pScratch = AllocatePool(unScratchSize);
+        if (NULL == pDestination || NULL == pScratch)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        efiStatus = pDecompress->Decompress(pDecompress, *PppFirmwareImage, *PpunSizeFirmwareImage, pDestination, unDestinationSize, pScratch, unScratchSize);
+        Print(L"  EFI_DECOMPRESS_PROTOCOL.Decompress()\n");
+        Print(L"    Status: 0x%.16lX\n", efiStatus);
+        if (EFI_ERROR(efiStatus))
+            break;
+        Print(L"    Size: %d -> %d bytes\n", *PpunSizeFirmwareImage, unDestinationSize);
+
+        FreePool(*PppFirmwareImage);
+        *PppFirmwareImage = pDestination;
+        *PpunSizeFirmwareImage = unDestinationSize;
+        pDestination = NULL;
+    }
+    while (FALSE);
+
+    if (pScratch != NULL)
+        FreePool(pScratch);
+    if (pDestination != NULL)
+        FreePool(pDestination);
+
     return efiStatus;
 }
 
+/// Prefix of the [firmware] parameter selecting a firmware image stored as FFS file in a firmware volume
+#define FV_IMAGE_PREFIX L"fv:"
+
+/// Firmware image used in place from a memory-mapped firmware volume (must not be freed)
+static VOID* s_pMappedFirmwareImage = NULL;
+
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Checks if the given firmware package can be used to update the TPM.
- *  @details    The function calls @ref IFXTPMUpdate_FirmwareManagement_CheckImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()"
- *              to check whether the TPM can be updated with the given firmware package.
+ *  @brief      Finds the raw section of an FFS file in a memory-mapped firmware volume.
+ *  @details    Only sections directly contained in the file are searched. A raw section inside an encapsulation section
+ *              (e.g. compressed) cannot be used in place and is not found.
  *
- *  @param      PhDriver                Handle to the driver.
- *  @param      PpFirmwareImage         Pointer to the firmware image.
- *  @param      PunSizeFirmwareImage    Size in bytes of the firmware image.
+ *  @param      PpFvHeader              Firmware volume header at the mapped address of the firmware volume.
+ *  @param      PpFileGuid              Name of the FFS file.
+ *  @param      PppData                 Will receive a pointer to the data of the raw section.
+ *  @param      PpunSizeData            Will receive the size in bytes of the raw section data.
  *
- *  @retval     EFI_SUCCESS                     The TPM can be updated with given firmware image.
- *  @retval     EFI_IFXTPM_WRONG_FIRMWARE_IMAGE The TPM can not be updated with given firmware image.
- *  @retval     other                           An error occurred when executing this function.
+ *  @retval     EFI_SUCCESS             The function executed successfully.
+ *  @retval     EFI_NOT_FOUND           The file or its raw section was not found.
+ *  @retval     EFI_VOLUME_CORRUPTED    The firmware volume header is invalid.
  */
 EFI_STATUS
 EFIAPI
-IsTpmUpdatableWithFirmware(
-    IN  EFI_HANDLE  PhDriver,
-    IN  const VOID* PpFirmwareImage,
-    IN  UINT32      PunSizeFirmwareImage)
+FindRawSectionInMappedFv(
+    IN  const EFI_FIRMWARE_VOLUME_HEADER*   PpFvHeader,
+    IN  const EFI_GUID*                     PpFileGuid,
+    OUT VOID**                              PppData,
+    OUT UINT32*                             PpunSizeData)
 {
-    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
-    EFI_FIRMWARE_MANAGEMENT_PROTOCOL *pFmp = NULL;
-    Print(L"\nIsTpmUpdatableWithFirmware()\n");
+    const UINT8* pbFv = (const UINT8*)PpFvHeader;
+    UINT64 ullOffset = 0;
 
-    do
+    if (EFI_FVH_SIGNATURE != PpFvHeader->Signature || PpFvHeader->HeaderLength > PpFvHeader->FvLength)
+        return EFI_VOLUME_CORRUPTED;
+
+    // The first file follows the header and the extended header (if any)
+    ullOffset = PpFvHeader->HeaderLength;
+    if (0 != PpFvHeader->ExtHeaderOffset && PpFvHeader->ExtHeaderOffset + sizeof(EFI_FIRMWARE_VOLUME_EXT_HEADER) <= PpFvHeader->FvLength)
+        ullOffset = PpFvHeader->ExtHeaderOffset + ((const EFI_FIRMWARE_VOLUME_EXT_HEADER*)(pbFv + PpFvHeader->ExtHeaderOffset))->ExtHeaderSize;
+    ullOffset = ALIGN_VALUE(ullOffset, 8);
+
+    while (ullOffset + sizeof(EFI_FFS_FILE_HEADER) <= PpFvHeader->FvLength)
     {
-        UINT32 unUpdatable = 0;
-        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, (VOID**)&pFmp, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+        const EFI_FFS_FILE_HEADER* pFile = (const EFI_FFS_FILE_HEADER*)(pbFv + ullOffset);
+        UINT64 ullFileSize = IS_FFS_FILE2(pFile) ? FFS_FILE2_SIZE(pFile) : FFS_FILE_SIZE(pFile);
+        UINT64 ullHeaderSize = IS_FFS_FILE2(pFile) ? sizeof(EFI_FFS_FILE_HEADER2) : sizeof(EFI_FFS_FILE_HEADER);
+        EFI_FFS_FILE_STATE bState = pFile->State;
+
+        // Free space (all bytes erased) or a truncated file ends the search
+        if (ullFileSize < ullHeaderSize || ullFileSize == 0xFFFFFF || ullOffset + ullFileSize > PpFvHeader->FvLength)
+            break;
+        if (0 != (PpFvHeader->Attributes & EFI_FVB2_ERASE_POLARITY))
+            bState = (EFI_FFS_FILE_STATE)~bState;
+
+        if (0 != (bState & EFI_FILE_DATA_VALID) && 0 == (bState & (EFI_FILE_DELETED | EFI_FILE_HEADER_INVALID)) && CompareGuid(&pFile->Name, PpFileGuid))
+        {
+            UINT64 ullSectionOffset = ullHeaderSize;
+            while (ullSectionOffset + sizeof(EFI_COMMON_SECTION_HEADER) <= ullFileSize)
+            {
+                const EFI_COMMON_SECTION_HEADER* pSection = (const EFI_COMMON_SECTION_HEADER*)((const UINT8*)pFile + ullSectionOffset);
+                UINT64 ullSectionSize = IS_SECTION2(pSection) ? SECTION2_SIZE(pSection) : SECTION_SIZE(pSection);
+                UINT64 ullSectionHeaderSize = IS_SECTION2(pSection) ? sizeof(EFI_COMMON_SECTION_HEADER2) : sizeof(EFI_COMMON_SECTION_HEADER);
+
+                if (ullSectionSize < ullSectionHeaderSize || ullSectionOffset + ullSectionSize > ullFileSize)
+                    break;
+                if (EFI_SECTION_RAW == pSection->Type && ullSectionSize > ullSectionHeaderSize && ullSectionSize - ullSectionHeaderSize <= MAX_UINT32)
+                {
+                    *PppData = (VOID*)((const UINT8*)pSection + ullSectionHeaderSize);
+                    *PpunSizeData = (UINT32)(ullSectionSize - ullSectionHeaderSize);
+                    return EFI_SUCCESS;
+                }
+                ullSectionOffset = ALIGN_VALUE(ullSectionOffset + ullSectionSize, 4);
+            }
+            return EFI_NOT_FOUND;
+        }
+
+        ullOffset = ALIGN_VALUE(ullOffset + ullFileSize, 8);
+    }
+
+    return EFI_NOT_FOUND;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Loads a TPM firmware image stored as FFS file in a firmware volume.
+ *  @details    The image is the raw section of the FFS file. If the firmware volume is memory-mapped (e.g. the BIOS flash),
+ *              PppFirmwareImage points directly into it and no memory is allocated. Otherwise the section is read with
+ *              EFI_FIRMWARE_VOLUME2_PROTOCOL.ReadSection() into pool memory, which also expands compressed sections.
+ *              Release the image with @ref FreeFirmwareImage.
+ *
+ *  @param      PpFileGuid              Name of the FFS file.
+ *  @param      PppFirmwareImage        Will receive pointer to the firmware image.
+ *  @param      PpunSizeFirmwareImage   Will receive size in bytes of the firmware image.
+ *
+ *  @retval     EFI_SUCCESS             The function executed successfully.
+ *  @retval     EFI_NOT_FOUND           No firmware volume contains the file.
+ *  @retval     other                   An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+LoadFirmwareImageFromFv(
+    IN  const EFI_GUID* PpFileGuid,
+    OUT VOID**          PppFirmwareImage,
+    OUT UINT32*         PpunSizeFirmwareImage)
+{
+    EFI_STATUS efiStatus = EFI_NOT_FOUND;
+    EFI_HANDLE* pHandleBuffer = NULL;
+    UINTN ullHandleCount = 0;
+    UINTN ullIndex = 0;
+
+    *PppFirmwareImage = NULL;
+    *PpunSizeFirmwareImage = 0;
+
+    if (EFI_ERROR(gBS->LocateHandleBuffer(ByProtocol, &gEfiFirmwareVolume2ProtocolGuid, NULL, &ullHandleCount, &pHandleBuffer)))
+        return EFI_NOT_FOUND;
+
+    for (ullIndex = 0; ullIndex < ullHandleCount; ullIndex++)
+    {
+        EFI_FIRMWARE_VOLUME2_PROTOCOL* pFv = NULL;
+        EFI_FIRMWARE_VOLUME_BLOCK2_PROTOCOL* pFvb = NULL;
+        EFI_FVB_ATTRIBUTES_2 unAttributes = 0;
+        EFI_PHYSICAL_ADDRESS ullAddress = 0;
+        VOID* pBuffer = NULL;
+        UINTN ullSize = 0;
+        UINT32 unAuthenticationStatus = 0;
+
+        // Use the image in place if the firmware volume is memory-mapped
+        if (!EFI_ERROR(gBS->HandleProtocol(pHandleBuffer[ullIndex], &gEfiFirmwareVolumeBlock2ProtocolGuid, (VOID**)&pFvb)) &&
+                !EFI_ERROR(pFvb->GetAttributes(pFvb, &unAttributes)) && 0 != (unAttributes & EFI_FVB2_MEMORY_MAPPED) &&
+                !EFI_ERROR(pFvb->GetPhysicalAddress(pFvb, &ullAddress)) &&
+                !EFI_ERROR(FindRawSectionInMappedFv((const EFI_FIRMWARE_VOLUME_HEADER*)(UINTN)ullAddress, PpFileGuid, PppFirmwareImage, PpunSizeFirmwareImage)))
+        {
+            Print(L"  Firmware image used in place at 0x%lX (%d bytes)\n", (UINT64)(UINTN)*PppFirmwareImage, *PpunSizeFirmwareImage);
+            s_pMappedFirmwareImage = *PppFirmwareImage;
+            efiStatus = EFI_SUCCESS;
+            break;
+        }
+
+        // Otherwise read the raw section into pool memory
+        if (EFI_ERROR(gBS->HandleProtocol(pHandleBuffer[ullIndex], &gEfiFirmwareVolume2ProtocolGuid, (VOID**)&pFv)))
+            continue;
+        efiStatus = pFv->ReadSection(pFv, PpFileGuid, EFI_SECTION_RAW, 0, &pBuffer, &ullSize, &unAuthenticationStatus);
         if (EFI_ERROR(efiStatus))
+        {
+            efiStatus = EFI_NOT_FOUND;
+            continue;
+        }
+        if (0 == ullSize || ullSize > MAX_UINT32)
+        {
+            FreePool(pBuffer);
+            efiStatus = EFI_BAD_BUFFER_SIZE;
             break;
+        }
+        Print(L"  Firmware image read from firmware volume (%d bytes)\n", (UINT32)ullSize);
+        *PppFirmwareImage = pBuffer;
+        *PpunSizeFirmwareImage = (UINT32)ullSize;
+        break;
+    }
 
-        Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()\n");
-        efiStatus = pFmp->CheckImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, &unUpdatable);
+    FreePool(pHandleBuffer);
+    return efiStatus;
+}
+
+/// Prefixes of the [firmware] parameter selecting a download with EFI_HTTP_PROTOCOL
+#define HTTP_IMAGE_PREFIX L"http://"
+#define HTTPS_IMAGE_PREFIX L"https://"
+
+/// Maximum time in milliseconds to wait for the completion of one HTTP request or response
+#define HTTP_TIMEOUT_MS 30000
+
+/// Interval in microseconds between two polls of EFI_HTTP_PROTOCOL
+#define HTTP_POLL_INTERVAL_US 1000
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Notification function of the HTTP token events.
+ *  @details
+ *
+ *  @param      PhEvent                 Event whose notification function is being invoked.
+ *  @param      PpContext               Pointer to the BOOLEAN set on completion.
+ */
+VOID
+EFIAPI
+HttpTokenNotify(
+    IN  EFI_EVENT   PhEvent,
+    IN  VOID*       PpContext)
+{
+    *(BOOLEAN*)PpContext = TRUE;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Polls EFI_HTTP_PROTOCOL until an asynchronous request or response completed.
+ *  @details
+ *
+ *  @param      PpHttp                  HTTP protocol instance.
+ *  @param      PpfDone                 BOOLEAN set by @ref HttpTokenNotify.
+ *  @param      PpToken                 Token of the request or response.
+ *
+ *  @retval     EFI_SUCCESS             The request or response completed successfully.
+ *  @retval     EFI_TIMEOUT             The request or response did not complete within HTTP_TIMEOUT_MS.
+ *  @retval     other                   Status of the token.
+ */
+EFI_STATUS
+EFIAPI
+HttpWaitToken(
+    IN  EFI_HTTP_PROTOCOL*  PpHttp,
+    IN  volatile BOOLEAN*   PpfDone,
+    IN  EFI_HTTP_TOKEN*     PpToken)
+{
+    UINT32 unElapsedUs = 0;
+
+    while (!*PpfDone)
+    {
+        if (unElapsedUs >= HTTP_TIMEOUT_MS * 1000)
+        {
+            PpHttp->Cancel(PpHttp, PpToken);
+            return EFI_TIMEOUT;
+        }
+        PpHttp->Poll(PpHttp);
+        gBS->Stall(HTTP_POLL_INTERVAL_US);
+        unElapsedUs += HTTP_POLL_INTERVAL_US;
+    }
+
+    return PpToken->Status;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Downloads a TPM firmware image with EFI_HTTP_PROTOCOL.
+ *  @details    The image is requested with HTTP GET and received in place into a buffer of the size given by the
+ *              Content-Length header, so no local storage and no intermediate copies are needed. HTTPS requires the TLS
+ *              support of the platform (TlsDxe and the TLS CA certificate configuration). Only IPv4 with the default
+ *              address of the network interface is used. It is the callers responsibility to free the image with
+ *              @ref FreeFirmwareImage.
+ *
+ *  @param      PwszUrl                 URL of the firmware image.
+ *  @param      PppFirmwareImage        Will receive pointer to the firmware image.
+ *  @param      PpunSizeFirmwareImage   Will receive size in bytes of the firmware image.
+ *
+ *  @retval     EFI_SUCCESS             The function executed successfully.
+ *  @retval     EFI_NOT_FOUND           No HTTP service is available or the server did not return the image (status other than 200).
+ *  @retval     EFI_UNSUPPORTED         The response has no valid Content-Length header.
+ *  @retval     EFI_OUT_OF_RESOURCES    The memory for the image could not be allocated.
+ *  @retval     other                   An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+LoadFirmwareImageFromHttp(
+    IN  const CHAR16*   PwszUrl,
+    OUT VOID**          PppFirmwareImage,
+    OUT UINT32*         PpunSizeFirmwareImage)
+{
+    EFI_STATUS efiStatus = EFI_NOT_FOUND;
+    EFI_HANDLE* pHandleBuffer = NULL;
+    EFI_SERVICE_BINDING_PROTOCOL* pServiceBinding = NULL;
+    EFI_HANDLE hChild = NULL;
+    EFI_HTTP_PROTOCOL* pHttp = NULL;
+    EFI_EVENT hEvent = NULL;
+    volatile BOOLEAN fDone = FALSE;
+    EFI_HTTP_RESPONSE_DATA sResponse;
+    EFI_HTTP_MESSAGE sMessage;
+    EFI_HTTP_TOKEN sToken;
+    UINT8* pbBuffer = NULL;
+    CHAR8 szHost[256];
+
+    *PppFirmwareImage = NULL;
+    *PpunSizeFirmwareImage = 0;
+    ZeroMem(&sResponse, sizeof(sResponse));
+    ZeroMem(&sMessage, sizeof(sMessage));
+    ZeroMem(&sToken, sizeof(sToken));
+    ZeroMem(szHost, sizeof(szHost));
+
+    do
+    {
+        UINTN ullHandleCount = 0;
+        UINTN ullIndex = 0;
+        UINT64 ullContentLength = 0;
+        UINT64 ullOffset = 0;
+        const CHAR16* pwszHost = NULL;
+        EFI_HTTPv4_ACCESS_POINT sIpv4Node;
+        EFI_HTTP_CONFIG_DATA sConfig;
+        EFI_HTTP_REQUEST_DATA sRequest;
+        EFI_HTTP_HEADER sHostHeader;
+        EFI_HTTP_MESSAGE sRequestMessage;
+
+        ZeroMem(&sIpv4Node, sizeof(sIpv4Node));
+        ZeroMem(&sConfig, sizeof(sConfig));
+        ZeroMem(&sRequest, sizeof(sRequest));
+        ZeroMem(&sHostHeader, sizeof(sHostHeader));
+        ZeroMem(&sRequestMessage, sizeof(sRequestMessage));
+
+        // The Host header is the authority part of the URL
+        pwszHost = StrStr(PwszUrl, L"://") + 3;
+        for (ullIndex = 0; ullIndex < sizeof(szHost) - 1 && pwszHost[ullIndex] != L'\0' && pwszHost[ullIndex] != L'/'; ullIndex++)
+            szHost[ullIndex] = (CHAR8)pwszHost[ullIndex];
+        if (0 == ullIndex)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Create an HTTP instance on the first network interface providing the HTTP service
+        efiStatus = gBS->LocateHandleBuffer(ByProtocol, &gEfiHttpServiceBindingProtocolGuid, NULL, &ullHandleCount, &pHandleBuffer);
+        if (EFI_ERROR(efiStatus) || 0 == ullHandleCount)
+        {
+            Print(L"  No HTTP service available.\n");
+            efiStatus = EFI_NOT_FOUND;
+            break;
+        }
+        efiStatus = gBS->HandleProtocol(pHandleBuffer[0], &gEfiHttpServiceBindingProtocolGuid, (VOID**)&pServiceBinding);
+        if (EFI_ERROR(efiStatus))
+            break;
+        efiStatus = pServiceBinding->CreateChild(pServiceBinding, &hChild);
+        if (EFI_ERROR(efiStatus))
+            break;
+        efiStatus = gBS->HandleProtocol(hChild, &gEfiHttpProtocolGuid, (VOID**)&pHttp);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        sIpv4Node.UseDefaultAddress = TRUE;
+        sConfig.HttpVersion = HttpVersion11;
+        sConfig.TimeOutMillisec = HTTP_TIMEOUT_MS;
+        sConfig.LocalAddressIsIPv6 = FALSE;
+        sConfig.AccessPoint.IPv4Node = &sIpv4Node;
+        efiStatus = pHttp->Configure(pHttp, &sConfig);
+        Print(L"  EFI_HTTP_PROTOCOL.Configure()\n");
         Print(L"    Status: 0x%.16lX\n", efiStatus);
-        Print(L"    Updatable: 0x%8X\n", unUpdatable);
+        if (EFI_ERROR(efiStatus))
+            break;
 
-        // Check if TPM will be reset to factory defaults after firmware update
-        if ((unUpdatable & IMAGE_UPDATABLE_IFXTPM_FACTORY_DEFAULTS) == IMAGE_UPDATABLE_IFXTPM_FACTORY_DEFAULTS)
-            Print(L"    Attention! This firmware update resets the TPM to factory defaults, i.e. all\n    data and state from the old TPM firmware will be lost!\n");
+        efiStatus = gBS->CreateEvent(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, HttpTokenNotify, (VOID*)&fDone, &hEvent);
+        if (EFI_ERROR(efiStatus))
+            break;
 
+        // Send the GET request
+        sRequest.Method = HttpMethodGet;
+        sRequest.Url = (CHAR16*)PwszUrl;
+        sHostHeader.FieldName = (CHAR8*)"Host";
+        sHostHeader.FieldValue = szHost;
+        sRequestMessage.Data.Request = &sRequest;
+        sRequestMessage.HeaderCount = 1;
+        sRequestMessage.Headers = &sHostHeader;
+        sToken.Event = hEvent;
+        sToken.Message = &sRequestMessage;
+        fDone = FALSE;
+        efiStatus = pHttp->Request(pHttp, &sToken);
+        if (!EFI_ERROR(efiStatus))
+            efiStatus = HttpWaitToken(pHttp, &fDone, &sToken);
+        Print(L"  EFI_HTTP_PROTOCOL.Request()\n");
+        Print(L"    Status: 0x%.16lX\n", efiStatus);
         if (EFI_ERROR(efiStatus))
             break;
 
-        if ((unUpdatable & IMAGE_UPDATABLE_VALID) != IMAGE_UPDATABLE_VALID)
+        // Receive the status and the headers, the header fields are allocated by the HTTP driver
+        sMessage.Data.Response = &sResponse;
+        sToken.Message = &sMessage;
+        fDone = FALSE;
+        efiStatus = pHttp->Response(pHttp, &sToken);
+        if (!EFI_ERROR(efiStatus))
+            efiStatus = HttpWaitToken(pHttp, &fDone, &sToken);
+        Print(L"  EFI_HTTP_PROTOCOL.Response()\n");
+        Print(L"    Status: 0x%.16lX\n", efiStatus);
+        if (EFI_ERROR(efiStatus))
+            break;
+        if (HTTP_STATUS_200_OK != sResponse.StatusCode)
         {
-            efiStatus = EFI_ABORTED;
+            Print(L"    HTTP status code: %d\n", sResponse.StatusCode);
+            efiStatus = EFI_NOT_FOUND;
+            break;
+        }
+
+        for (ullIndex = 0; ullIndex < sMessage.HeaderCount; ullIndex++)
+        {
+            if (0 == AsciiStriCmp(sMessage.Headers[ullIndex].FieldName, "Content-Length"))
+                ullContentLength = AsciiStrDecimalToUint64(sMessage.Headers[ullIndex].FieldValue);
+        }
+        if (0 == ullContentLength || ullContentLength > MAX_UINT32)
+        {
+            Print(L"    The response has no valid Content-Length.\n");
+            efiStatus = EFI_UNSUPPORTED;
             break;
         }
+
+        // The buffer is completely overwritten by the body, so it does not need to be zeroed
+        pbBuffer = (UINT8*)AllocatePool((UINTN)ullContentLength);
+        if (NULL == pbBuffer)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        // Receive the body directly into the image buffer, a response may return less than requested
+        while (ullOffset < ullContentLength)
+        {
+            EFI_HTTP_MESSAGE sBodyMessage;
+            ZeroMem(&sBodyMessage, sizeof(sBodyMessage));
+            sBodyMessage.BodyLength = (UINTN)(ullContentLength - ullOffset);
+            sBodyMessage.Body = &pbBuffer[ullOffset];
+            sToken.Message = &sBodyMessage;
+            fDone = FALSE;
+            efiStatus = pHttp->Response(pHttp, &sToken);
+            if (!EFI_ERROR(efiStatus))
+                efiStatus = HttpWaitToken(pHttp, &fDone, &sToken);
+            sToken.Message = &sMessage;
+            if (EFI_ERROR(efiStatus))
+                break;
+            if (0 == sBodyMessage.BodyLength)
+            {
+                efiStatus = EFI_END_OF_FILE;
+                break;
+            }
+            ullOffset += sBodyMessage.BodyLength;
+        }
+        Print(L"    Received: %ld of %ld bytes\n", ullOffset, ullContentLength);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        *PppFirmwareImage = pbBuffer;
+        *PpunSizeFirmwareImage = (UINT32)ullContentLength;
+        pbBuffer = NULL;
     }
-    while (FALSE);  // Loop construct for error handling
+    while (FALSE);
 
-    if (pFmp != NULL)
-        gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
+    // Free the header fields allocated by the HTTP driver
+    if (NULL != sMessage.Headers)
+    {
+        UINTN ullIndex = 0;
+        for (ullIndex = 0; ullIndex < sMessage.HeaderCount; ullIndex++)
+        {
+            if (NULL != sMessage.Headers[ullIndex].FieldName)
+                FreePool(sMessage.Headers[ullIndex].FieldName);
+            if (NULL != sMessage.Headers[ullIndex].FieldValue)
+                FreePool(sMessage.Headers[ullIndex].FieldValue);
+        }
+        FreePool(sMessage.Headers);
+    }
+    if (NULL != pbBuffer)
+        FreePool(pbBuffer);
+    if (NULL != hEvent)
+        gBS->CloseEvent(hEvent);
+    if (NULL != hChild)
+        pServiceBinding->DestroyChild(pServiceBinding, hChild);
+    if (NULL != pHandleBuffer)
+        FreePool(pHandleBuffer);
 
-    Print(L"End IsTpmUpdatableWithFirmware(), Status: 0x%.16lX\n", efiStatus);
     return efiStatus;
 }
 
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Sets the policy session handle with @ref IFXTPMUpdate_AdapterInformation_SetInformation "EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation()".
- *  @details    The function calls @ref IFXTPMUpdate_AdapterInformation_SetInformation "EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation()" to set the policy session handle.
+ *  @brief      Releases a firmware image returned by @ref LoadFirmwareImage.
+ *  @details    An image used in place from a memory-mapped firmware volume is not freed.
  *
- *  @param      PhDriver                Handle to the driver.
- *  @param      PunPolicySessionHandle  Handle to the policy session.
+ *  @param      PpFirmwareImage         Firmware image or NULL.
+ */
+VOID
+EFIAPI
+FreeFirmwareImage(
+    IN  VOID*   PpFirmwareImage)
+{
+    if (NULL != PpFirmwareImage && PpFirmwareImage != s_pMappedFirmwareImage)
+        FreePool(PpFirmwareImage);
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Loads a TPM firmware image from disk or from a firmware volume.
+ *  @details    The function allocates PppFirmwareImage with AllocatePool(). It is the callers responsibility to free the memory with @ref FreeFirmwareImage.
+ *              An image compressed with the EFI compression algorithm is expanded (see @ref DecompressFirmwareImage).
+ *              A path of the form fv:<GUID> selects the FFS file with this name in a firmware volume (see @ref LoadFirmwareImageFromFv).
+ *              An http:// or https:// URL downloads the image (see @ref LoadFirmwareImageFromHttp).
+ *
+ *  @param      PwszPath                Path to the firmware image on disk (omit the drive part), fv:<GUID> or URL.
+ *  @param      PppFirmwareImage        Will receive pointer to the firmware image.
+ *  @param      PpunSizeFirmwareImage   Will receive size in bytes of the firmware image.
  *
- *  @retval     EFI_SUCCESS     The policy session handle was set successfully.
+ *  @retval     EFI_SUCCESS     The function executed successfully.
  *  @retval     other           An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
-SetPolicySessionHandle(
-    IN EFI_HANDLE   PhDriver,
-    IN UINT32       PunPolicySessionHandle)
+LoadFirmwareImage(
+    IN  const CHAR16*   PwszPath,
+    OUT VOID**          PppFirmwareImage,
+    OUT UINT32*         PpunSizeFirmwareImage)
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
-    EFI_ADAPTER_INFORMATION_PROTOCOL* pAdapterInfo = NULL;
-    Print(L"\nSetPolicySessionHandle()\n");
-
-    do
+    Print(L"\nLoadFirmwareImage()\n");
+    if (0 == StrnCmp(PwszPath, FV_IMAGE_PREFIX, StrLen(FV_IMAGE_PREFIX)))
     {
-        UINTN ullCurrent = 0;
-        EFI_GUID* pBuffers = NULL;
-        UINTN ullBufferCount = 0;
+        EFI_GUID sFileGuid;
+        efiStatus = StrToGuid(PwszPath + StrLen(FV_IMAGE_PREFIX), &sFileGuid);
+        if (!EFI_ERROR(efiStatus))
+            efiStatus = LoadFirmwareImageFromFv(&sFileGuid, PppFirmwareImage, PpunSizeFirmwareImage);
+        Print(L"End LoadFirmwareImage(), Status: 0x%.16lX\n", efiStatus);
+        return efiStatus;
+    }
 
-        // AdapterInformation protocol
-        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, (VOID**)&pAdapterInfo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+    if (0 == StrnCmp(PwszPath, HTTP_IMAGE_PREFIX, StrLen(HTTP_IMAGE_PREFIX)) || 0 == StrnCmp(PwszPath, HTTPS_IMAGE_PREFIX, StrLen(HTTPS_IMAGE_PREFIX)))
+        efiStatus = LoadFirmwareImageFromHttp(PwszPath, PppFirmwareImage, PpunSizeFirmwareImage);
+    else
+        efiStatus = LoadFile(PwszPath, PppFirmwareImage, PpunSizeFirmwareImage);
+    if (!EFI_ERROR(efiStatus))
+    {
+        efiStatus = DecompressFirmwareImage(PppFirmwareImage, PpunSizeFirmwareImage);
         if (EFI_ERROR(efiStatus))
-            break;
+        {
+            FreePool(*PppFirmwareImage);
+            *PppFirmwareImage = NULL;
+            *PpunSizeFirmwareImage = 0;
+        }
+    }
+    Print(L"End LoadFirmwareImage(), Status: 0x%.16lX\n", efiStatus);
+    return efiStatus;
+}
 
-        // Call GetSupportedTypes()
-        Print(L"  EFI_ADAPTER_INFORMATION_PROTOCOL.GetSupportedTypes()\n");
-        efiStatus = pAdapterInfo->GetSupportedTypes(pAdapterInfo, &pBuffers, &ullBufferCount);
-        Print(L"    Status: 0x%8X\n", efiStatus);
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Checks if the given firmware package can be used to update the TPM.
+ *  @details    The function calls @ref IFXTPMUpdate_FirmwareManagement_CheckImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()"
+ *              to check whether the TPM can be updated with the given firmware package.
+ *
+ *  @param      PhDriver                Handle to the driver.
+ *  @param      PpFirmwareImage         Pointer to the firmware image.
+ *  @param      PunSizeFirmwareImage    Size in bytes of the firmware image.
+ *
+ *  @retval     EFI_SUCCESS                     The TPM can be updated with given firmware image.
+ *  @retval     EFI_IFXTPM_WRONG_FIRMWARE_IMAGE The TPM can not be updated with given firmware image.
+ *  @retval     other                           An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+IsTpmUpdatableWithFirmware(
+    IN  EFI_HANDLE  PhDriver,
+    IN  const VOID* PpFirmwareImage,
+    IN  UINT32      PunSizeFirmwareImage)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+    EFI_FIRMWARE_MANAGEMENT_PROTOCOL *pFmp = NULL;
+    Print(L"\nIsTpmUpdatableWithFirmware()\n");
+
+    do
+    {
+        UINT32 unUpdatable = 0;
+        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, (VOID**)&pFmp, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
         if (EFI_ERROR(efiStatus))
             break;
 
-        Print(L"    Count: %d\n", ullBufferCount);
-        for (ullCurrent = 0; ullCurrent < ullBufferCount; ullCurrent++)
-            PrintGuid(&pBuffers[ullCurrent]);
+        Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()\n");
+        efiStatus = pFmp->CheckImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, &unUpdatable);
+        Print(L"    Status: 0x%.16lX\n", efiStatus);
+        Print(L"    Updatable: 0x%8X\n", unUpdatable);
 
-        FreePool(pBuffers);
-        pBuffers = NULL;
+        // Check if TPM will be reset to factory defaults after firmware update
+        if ((unUpdatable & IMAGE_UPDATABLE_IFXTPM_FACTORY_DEFAULTS) == IMAGE_UPDATABLE_IFXTPM_FACTORY_DEFAULTS)
+            Print(L"    Attention! This firmware update resets the TPM to factory defaults, i.e. all\n    data and state from the old TPM firmware will be lost!\n");
+
+        if (EFI_ERROR(efiStatus))
+            break;
 
+        if ((unUpdatable & IMAGE_UPDATABLE_VALID) != IMAGE_UPDATABLE_VALID)
         {
-            // Call SetInformation()
-            EFI_GUID guid = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID;
-            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1 descriptor;
-            descriptor.SessionHandle = PunPolicySessionHandle;
-            Print(L"  EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation()\n");
-            efiStatus = pAdapterInfo->SetInformation(pAdapterInfo, &guid, &descriptor, sizeof(descriptor));
-            Print(L"    Status: 0x%.16lX\n", efiStatus);
-            if (EFI_ERROR(efiStatus))
-                break;
+            efiStatus = EFI_ABORTED;
+            break;
         }
     }
     while (FALSE);  // Loop construct for error handling
 
-    if (pAdapterInfo != NULL)
-        gBS->CloseProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, gImageHandle, NULL);
+    if (pFmp != NULL)
+        gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
 
-    Print(L"End SetPolicySessionHandle(), Status: 0x%.16lX\n", efiStatus);
+    Print(L"End IsTpmUpdatableWithFirmware(), Status: 0x%.16lX\n", efiStatus);
     return efiStatus;
 }
 
@@ -762,7 +1607,8 @@ SetOwnerAuthHash(
  *  @ingroup    RunIFXTPMUpdate
  *  @brief      Callback function for progress report of @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
  *  @details    The function is called by @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()" to update the progress (1 - 100). It prints the
- *              progress to the console.
+ *              progress to the console. While the firmware blocks are sent it also prints the throughput and the estimated time to completion
+ *              read with @ref IFXTPMUpdate_AdapterInformation_GetInformation "EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation()".
  *
  *  @param      PullCompletion  Progress completion value between 1 and 100.
  *
@@ -773,7 +1619,47 @@ EFIAPI
 ProgressCallback(
     IN UINTN PullCompletion)
 {
-    Print(L"    Completion: %d\r", PullCompletion);
+    EFI_ADAPTER_INFORMATION_PROTOCOL* pAdapterInfo = NULL;
+    EFI_GUID InformationType = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID;
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1* pTransfer = NULL;
+    UINTN ullInformationBlockSize = 0;
+    BOOLEAN fPrinted = FALSE;
+
+    do
+    {
+        if (NULL == s_hProgressDriver)
+            break;
+
+        // Read the transfer telemetry (the driver does not access the TPM for it)
+        if (EFI_ERROR(gBS->OpenProtocol(s_hProgressDriver, &gEfiAdapterInformationProtocolGuid, (VOID**)&pAdapterInfo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL)))
+        {
+            pAdapterInfo = NULL;
+            break;
+        }
+        if (EFI_ERROR(pAdapterInfo->GetInformation(pAdapterInfo, &InformationType, (VOID**)&pTransfer, &ullInformationBlockSize)))
+            break;
+        if (ullInformationBlockSize < sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1) || 0 == pTransfer->Active)
+            break;
+
+        if (EFI_IFXTPM_TRANSFER_ESTIMATE_UNKNOWN == pTransfer->EstimatedRemainingMs)
+            Print(L"    Completion: %d (%d/%d bytes, %d blocks, %d B/s, average %d B/s, ETA unknown)      \r",
+                  PullCompletion, pTransfer->BytesSent, pTransfer->TotalBytes, pTransfer->BlocksAcknowledged,
+                  pTransfer->CurrentThroughput, pTransfer->AverageThroughput);
+        else
+            Print(L"    Completion: %d (%d/%d bytes, %d blocks, %d B/s, average %d B/s, ETA %d s)      \r",
+                  PullCompletion, pTransfer->BytesSent, pTransfer->TotalBytes, pTransfer->BlocksAcknowledged,
+                  pTransfer->CurrentThroughput, pTransfer->AverageThroughput, (pTransfer->EstimatedRemainingMs + 999) / 1000);
+        fPrinted = TRUE;
+    }
+    while (FALSE);  // Loop construct for error handling
+
+    if (pTransfer != NULL)
+        FreePool(pTransfer);
+    if (pAdapterInfo != NULL)
+        gBS->CloseProtocol(s_hProgressDriver, &gEfiAdapterInformationProtocolGuid, gImageHandle, NULL);
+
+    if (!fPrinted)
+        Print(L"    Completion: %d\r", PullCompletion);
     return EFI_SUCCESS;
 }
 
@@ -785,6 +1671,7 @@ ProgressCallback(
  *  @param      PhDriver                Handle to the driver.
  *  @param      PpFirmwareImage         Pointer to the firmware image.
  *  @param      PunSizeFirmwareImage    Size in bytes of the firmware image.
+ *  @param      PunPolicySessionHandle  Handle to the policy session passed as SetImage() vendor code (0 to let the driver start the default policy session).
  *
  *  @retval     EFI_SUCCESS     The firmware was updated successfully.
  *  @retval     other           Errors returned by @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
@@ -794,10 +1681,12 @@ EFIAPI
 UpdateTpmFirmware(
     IN  EFI_HANDLE  PhDriver,
     IN  const VOID* PpFirmwareImage,
-    IN  UINT32      PunSizeFirmwareImage)
+    IN  UINT32      PunSizeFirmwareImage,
+    IN  UINT32      PunPolicySessionHandle)
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
     EFI_FIRMWARE_MANAGEMENT_PROTOCOL *pFmp = NULL;
+    EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1 sVendorCode;
     Print(L"\nUpdateTpmFirmware()\n\nDO NOT TURN OFF OR SHUT DOWN THE SYSTEM DURING THE UPDATE PROCESS!\n\n");
 
     do
@@ -808,8 +1697,14 @@ UpdateTpmFirmware(
         if (EFI_ERROR(efiStatus))
             break;
 
+        // Pass the policy session handle as vendor code, this saves a SetInformation() call and its TPM state query
+        sVendorCode.Version = EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_VERSION_1;
+        sVendorCode.SessionHandle = PunPolicySessionHandle;
+
         Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
-        efiStatus = pFmp->SetImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, NULL, &ProgressCallback, &wszAbortReason);
+        s_hProgressDriver = PhDriver;
+        efiStatus = pFmp->SetImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, &sVendorCode, &ProgressCallback, &wszAbortReason);
+        s_hProgressDriver = NULL;
         Print(L"\n");
         if (EFI_ERROR(efiStatus))
             Print(L"    Abort reason: %s\n", wszAbortReason); // AbortReason is always set to NULL within SetImage().
@@ -829,7 +1724,8 @@ UpdateTpmFirmware(
  *  @ingroup    RunIFXTPMUpdate
  *  @brief      Checks if the given firmware package can be used to update the TPM.
  *  @details    The function calls @ref IFXTPMUpdate_FirmwareManagement_CheckImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()"
- *              to check whether the TPM can be updated with the given firmware package.
+ *              to check whether the TPM can be updated with the given firmware package. For a valid package it prints the
+ *              estimated update duration read with @ref IFXTPMUpdate_AdapterInformation_GetInformation "EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation()".
  *
  *  @param      PhDriver                Handle to the driver.
  *  @param      PpFirmwareImage         Pointer to the firmware image.
@@ -847,12 +1743,16 @@ CheckImage(
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
     EFI_FIRMWARE_MANAGEMENT_PROTOCOL *pFmp = NULL;
+    EFI_ADAPTER_INFORMATION_PROTOCOL* pAdapterInfo = NULL;
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1* pDuration = NULL;
 
     Print(L"\nCheckImage()\n");
     do
     {
         // Open FirmwareManagement protocol
         UINT32 unUpdatable = 0;
+        EFI_GUID InformationType = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID;
+        UINTN ullInformationBlockSize = 0;
         efiStatus = gBS->OpenProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, (VOID**)&pFmp, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
         if (EFI_ERROR(efiStatus))
             break;
@@ -863,9 +1763,32 @@ CheckImage(
             break;
 
         Print(L"    Updatable: 0x%8X\n", unUpdatable);
+        if ((unUpdatable & IMAGE_UPDATABLE_VALID) != IMAGE_UPDATABLE_VALID)
+            break;
+
+        // Read the update duration estimate (older drivers do not support the information type)
+        if (EFI_ERROR(gBS->OpenProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, (VOID**)&pAdapterInfo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL)))
+        {
+            pAdapterInfo = NULL;
+            break;
+        }
+        Print(L"  EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation()\n");
+        if (EFI_ERROR(pAdapterInfo->GetInformation(pAdapterInfo, &InformationType, (VOID**)&pDuration, &ullInformationBlockSize)) ||
+                ullInformationBlockSize < sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1) || 0 == pDuration->Valid)
+        {
+            Print(L"    Estimated update duration: unknown\n");
+            break;
+        }
+        Print(L"    Estimated update duration: %d s (%d manifest and %d firmware blocks of %d bytes, %d us per block (%s), %d ms mode switch waits)\n",
+              (pDuration->EstimatedDurationMs + 999) / 1000, pDuration->ManifestBlocks, pDuration->FirmwareBlocks, pDuration->BlockSize,
+              pDuration->BlockLatencyUs, pDuration->Measured ? L"measured" : L"calibrated", pDuration->FixedWaitMs);
     }
     while (FALSE);  // Loop construct for error handling
 
+    if (pDuration != NULL)
+        FreePool(pDuration);
+    if (pAdapterInfo != NULL)
+        gBS->CloseProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, gImageHandle, NULL);
     if (pFmp != NULL)
         gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
 
@@ -1168,7 +2091,9 @@ SetOperational(
             break;
 
         Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
+        s_hProgressDriver = PhDriver;
         efiStatus = pFmp->SetImage(pFmp, 1, NULL, 0, NULL, &ProgressCallback, &wszAbortReason);
+        s_hProgressDriver = NULL;
 
         if (EFI_ERROR(efiStatus))
             break;
@@ -1180,71 +2105,294 @@ SetOperational(
     if (pFmp != NULL)
         gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
 
-    Print(L"End SetOperational(), Status: 0x%.16lX\n", efiStatus);
+    Print(L"End SetOperational(), Status: 0x%.16lX\n", efiStatus);
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Function to set the firmware image to use for firmware update.
+ *  @details    The function calls @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
+ *              It can be used to directly call SetImage method without further checks.
+ *
+ *  @param      PhDriver                Handle to the driver.
+ *  @param      PpFirmwareImage         Pointer to the firmware image.
+ *  @param      PunSizeFirmwareImage    Size in bytes of the firmware image.
+ *
+ *  @retval     EFI_SUCCESS     The firmware update image was set successfully.
+ *  @retval     other           Errors returned by @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
+ */
+EFI_STATUS
+EFIAPI
+SetImage(
+    IN  EFI_HANDLE  PhDriver,
+    IN  const VOID* PpFirmwareImage,
+    IN  UINT32      PunSizeFirmwareImage)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+    EFI_FIRMWARE_MANAGEMENT_PROTOCOL* pFmp = NULL;
+    Print(L"\nSetImage()\n");
+
+    do
+    {
+        CHAR16* wszAbortReason = NULL;
+
+        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, (VOID**)&pFmp, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
+        s_hProgressDriver = PhDriver;
+        efiStatus = pFmp->SetImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, NULL, &ProgressCallback, &wszAbortReason);
+        s_hProgressDriver = NULL;
+
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        Print(L"    Setting the firmware update image succeeded.\n");
+    } while (FALSE);  // Loop construct for error handling
+
+    if (pFmp != NULL)
+        gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
+
+    Print(L"End SetImage(), Status: 0x%.16lX\n", efiStatus);
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Calls one non update specific driver method.
+ *  @details    The firmware image is loaded on first use and kept in PppFirmwareImage for following calls. It is the callers
+ *              responsibility to free it with @ref FreeFirmwareImage.
+ *
+ *  @param      PhDriver                Handle to the driver.
+ *  @param      PwszCommand             Driver method to call (call-...).
+ *  @param      PwszFirmwareImagePath   Path to the firmware image or NULL if none was given.
+ *  @param      PppFirmwareImage        In: Firmware image loaded before or NULL. Out: Loaded firmware image.
+ *  @param      PpunSizeFirmwareImage   In: Size of the firmware image loaded before. Out: Size of the loaded firmware image.
+ *  @param      PpfShowUsage            Set to TRUE if the command or its parameters are invalid.
+ *
+ *  @retval     EFI_SUCCESS             The function executed successfully.
+ *  @retval     EFI_INVALID_PARAMETER   The command is unknown or requires a firmware image and none was given.
+ *  @retval     other                   An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+RunDriverMethod(
+    IN      EFI_HANDLE      PhDriver,
+    IN      const CHAR16*   PwszCommand,
+    IN      const CHAR16*   PwszFirmwareImagePath,
+    IN OUT  VOID**          PppFirmwareImage,
+    IN OUT  UINT32*         PpunSizeFirmwareImage,
+    OUT     BOOLEAN*        PpfShowUsage)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+
+    do
+    {
+        if (StrCmp(PwszCommand, L"call-checkImage") == 0)
+        {
+            if (NULL == PwszFirmwareImagePath)
+            {
+                *PpfShowUsage = TRUE;
+                efiStatus = EFI_INVALID_PARAMETER;
+                break;
+            }
+
+            // Load the firmware image that shall be used to update the TPM unless it has been loaded before.
+            if (NULL == *PppFirmwareImage)
+            {
+                efiStatus = LoadFirmwareImage(PwszFirmwareImagePath, PppFirmwareImage, PpunSizeFirmwareImage);
+                if (EFI_ERROR(efiStatus))
+                    break;
+            }
+
+            // Check the firmware image.
+            efiStatus = CheckImage(PhDriver, *PppFirmwareImage, *PpunSizeFirmwareImage);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-setImage") == 0)
+        {
+            if (NULL == PwszFirmwareImagePath)
+            {
+                *PpfShowUsage = TRUE;
+                efiStatus = EFI_INVALID_PARAMETER;
+                break;
+            }
+
+            // Load the firmware image that shall be used to update the TPM unless it has been loaded before.
+            if (NULL == *PppFirmwareImage)
+            {
+                efiStatus = LoadFirmwareImage(PwszFirmwareImagePath, PppFirmwareImage, PpunSizeFirmwareImage);
+                if (EFI_ERROR(efiStatus))
+                    break;
+            }
+
+            // Set the firmware image to use for firmware update.
+            efiStatus = SetImage(PhDriver, *PppFirmwareImage, *PpunSizeFirmwareImage);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-getImageInfo") == 0)
+        {
+            // Get infomation of actual firmware image.
+            efiStatus = GetImageInfo(PhDriver);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-getFuDetails") == 0)
+        {
+            // Get detail information of actual firmware image.
+            efiStatus = GetFuDetails(PhDriver);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-getFuCounters") == 0)
+        {
+            // Get fieldupgrade counters of actual firmware.
+            efiStatus = GetFuCounters(PhDriver);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-getOperationMode") == 0)
+        {
+            // Get operation mode of TPM firmware.
+            efiStatus = GetOperationMode(PhDriver);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else if (StrCmp(PwszCommand, L"call-setOperational") == 0)
+        {
+            // Get operation mode of TPM firmware.
+            efiStatus = SetOperational(PhDriver);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        else
+        {
+            *PpfShowUsage = TRUE;
+            efiStatus = EFI_INVALID_PARAMETER;
+        }
+    }
+    while (FALSE);
+
     return efiStatus;
 }
 
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Function to set the firmware image to use for firmware update.
- *  @details    The function calls @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
- *              It can be used to directly call SetImage method without further checks.
+ *  @brief      Function to handle non update specific commands.
+ *  @details    This function processes all command line options used for non update tasks.
  *
- *  @param      PhDriver                Handle to the driver.
- *  @param      PpFirmwareImage         Pointer to the firmware image.
- *  @param      PunSizeFirmwareImage    Size in bytes of the firmware image.
+ *  @param      PullArgc            Number of command line arguments.
+ *  @param      PpwszArgv           List of command line arguments.
  *
- *  @retval     EFI_SUCCESS     The firmware update image was set successfully.
- *  @retval     other           Errors returned by @ref IFXTPMUpdate_FirmwareManagement_SetImage "EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()".
+ *  @retval     EFI_SUCCESS     The function executed successfully.
  */
 EFI_STATUS
 EFIAPI
-SetImage(
-    IN  EFI_HANDLE  PhDriver,
-    IN  const VOID* PpFirmwareImage,
-    IN  UINT32      PunSizeFirmwareImage)
+CallDriverMethod(
+    IN UINTN PullArgc,
+    CHAR16** PpwszArgv)
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
-    EFI_FIRMWARE_MANAGEMENT_PROTOCOL* pFmp = NULL;
-    Print(L"\nSetImage()\n");
+    EFI_HANDLE hDriver = NULL;
+    VOID* pFirmwareImage = NULL;
+    CHAR16* pwszFirmwareImagePath = NULL;
+    UINT32 unSizeFirmwareImage = 0;
+    BOOLEAN showUsage = FALSE;
 
+    Print(L"\nCallDriverMethod()\nCommand flow to call non update specific driver method.\n");
     do
     {
-        CHAR16* wszAbortReason = NULL;
+        CHAR16* pwszCommand = PpwszArgv[1];
+        CHAR16* pwszDriverPath = PpwszArgv[2];
 
-        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, (VOID**)&pFmp, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+        Print(L"Parameters:\n");
+        Print(L"  Command: %s\n", pwszCommand);
+        Print(L"  Driver path: %s\n", pwszDriverPath);
+
+        if (PullArgc > 3)
+        {
+            pwszFirmwareImagePath = PpwszArgv[3];
+            Print(L"  Firmware image path: %s\n", pwszFirmwareImagePath);
+        }
+
+        // Load the IFXTPMUpdate.efi driver.
+        efiStatus = LoadDriver(pwszDriverPath, &hDriver);
         if (EFI_ERROR(efiStatus))
             break;
 
-        Print(L"  EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()\n");
-        efiStatus = pFmp->SetImage(pFmp, 1, PpFirmwareImage, PunSizeFirmwareImage, NULL, &ProgressCallback, &wszAbortReason);
-
+        // Enable logging
+        efiStatus = ConfigureLogging(hDriver, TRUE);
         if (EFI_ERROR(efiStatus))
             break;
 
-        Print(L"    Setting the firmware update image succeeded.\n");
-    } while (FALSE);  // Loop construct for error handling
+        // Call the driver method
+        efiStatus = RunDriverMethod(hDriver, pwszCommand, pwszFirmwareImagePath, &pFirmwareImage, &unSizeFirmwareImage, &showUsage);
+    } while (FALSE);
 
-    if (pFmp != NULL)
-        gBS->CloseProtocol(PhDriver, &gEfiFirmwareManagementProtocolGuid, gImageHandle, NULL);
+    // Unload driver if loaded
+    if (hDriver)
+    {
+        ConfigureLogging(hDriver, FALSE);
+        UnloadDriver(hDriver);
+    }
+
+    // Write the log file
+    CloseLogging(EFI_ERROR(efiStatus));
+
+    // Free memory for firmware image if allocated
+    FreeFirmwareImage(pFirmwareImage);
+
+    if (showUsage)
+        ShowUsage();
+
+    if (EFI_SUCCESS == efiStatus)
+        Print(L"\n\nRunIFXTPMUpdate completed successfully.\n");
+    else
+        Print(L"\n\nRunIFXTPMUpdate failed, Status: 0x%.16lX\n", efiStatus);
 
-    Print(L"End SetImage(), Status: 0x%.16lX\n", efiStatus);
     return efiStatus;
 }
 
+/**
+ *  @brief      Calibrates the time-stamp counter.
+ *  @details    The function measures the time-stamp counter increments during a stall of BATCH_CALIBRATION_STALL_US microseconds.
+ *
+ *  @returns    Time-stamp counter increments per millisecond (at least 1).
+ */
+UINT64
+EFIAPI
+GetTscTicksPerMillisecond()
+{
+    UINT64 ullStart = AsmReadTsc();
+    UINT64 ullTicksPerMs = 0;
+
+    gBS->Stall(BATCH_CALIBRATION_STALL_US);
+    ullTicksPerMs = DivU64x32(AsmReadTsc() - ullStart, BATCH_CALIBRATION_STALL_US / 1000);
+
+    return 0 == ullTicksPerMs ? 1 : ullTicksPerMs;
+}
+
 /**
  *  @ingroup    RunIFXTPMUpdate
- *  @brief      Function to handle non update specific commands.
- *  @details    This function processes all command line options used for non update tasks.
+ *  @brief      Function to handle the batch mode.
+ *  @details    The function loads the driver once and calls all driver methods given on the command line in order. The driver
+ *              stays loaded and the TPM stays connected between the methods. The firmware image is loaded once on first use.
+ *              The batch stops at the first failing method. The duration of each method and of the whole batch is reported.
  *
  *  @param      PullArgc            Number of command line arguments.
  *  @param      PpwszArgv           List of command line arguments.
  *
- *  @retval     EFI_SUCCESS     The function executed successfully.
+ *  @retval     EFI_SUCCESS             All driver methods executed successfully.
+ *  @retval     EFI_INVALID_PARAMETER   No driver method or more than one firmware image path was given.
+ *  @retval     other                   An error occurred when executing this function.
  */
 EFI_STATUS
 EFIAPI
-CallDriverMethod(
+RunBatch(
     IN UINTN PullArgc,
     CHAR16** PpwszArgv)
 {
@@ -1255,22 +2403,43 @@ CallDriverMethod(
     UINT32 unSizeFirmwareImage = 0;
     BOOLEAN showUsage = FALSE;
 
-    Print(L"\nCallDriverMethod()\nCommand flow to call non update specific driver method.\n");
+    Print(L"\nRunBatch()\nCommand flow to call several driver methods with one driver load.\n");
     do
     {
-        CHAR16* pwszCommand = PpwszArgv[1];
         CHAR16* pwszDriverPath = PpwszArgv[2];
+        UINTN ullIndex = 0;
+        UINTN ullMethodCount = 0;
+        UINT64 ullTicksPerMs = 0;
+        UINT64 ullBatchStart = 0;
 
         Print(L"Parameters:\n");
-        Print(L"  Command: %s\n", pwszCommand);
         Print(L"  Driver path: %s\n", pwszDriverPath);
 
-        if (PullArgc > 3)
+        // Arguments starting with "call-" are driver methods, another argument is the firmware image path
+        for (ullIndex = 3; ullIndex < PullArgc; ullIndex++)
         {
-            pwszFirmwareImagePath = PpwszArgv[3];
-            Print(L"  Firmware image path: %s\n", pwszFirmwareImagePath);
+            if (StrnCmp(PpwszArgv[ullIndex], L"call-", 5) == 0)
+            {
+                ullMethodCount++;
+                Print(L"  Method %lu: %s\n", (UINT64)ullMethodCount, PpwszArgv[ullIndex]);
+            }
+            else if (NULL == pwszFirmwareImagePath)
+            {
+                pwszFirmwareImagePath = PpwszArgv[ullIndex];
+                Print(L"  Firmware image path: %s\n", pwszFirmwareImagePath);
+            }
+            else
+                showUsage = TRUE;
+        }
+        if (showUsage || 0 == ullMethodCount)
+        {
+            showUsage = TRUE;
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
         }
 
+        ullTicksPerMs = GetTscTicksPerMillisecond();
+
         // Load the IFXTPMUpdate.efi driver.
         efiStatus = LoadDriver(pwszDriverPath, &hDriver);
         if (EFI_ERROR(efiStatus))
@@ -1281,105 +2450,201 @@ CallDriverMethod(
         if (EFI_ERROR(efiStatus))
             break;
 
-        // Check for driver method to call
-        if (StrCmp(pwszCommand, L"call-checkImage") == 0)
+        // Call the driver methods in order
+        ullBatchStart = AsmReadTsc();
+        for (ullIndex = 3; ullIndex < PullArgc; ullIndex++)
         {
-            if (PullArgc < 4)
-            {
-                showUsage = TRUE;
-                efiStatus = EFI_INVALID_PARAMETER;
-                break;
-            }
+            UINT64 ullStepStart = 0;
 
-            // Load the firmware image that shall be used to update the TPM.
-            efiStatus = LoadFirmwareImage(pwszFirmwareImagePath, &pFirmwareImage, &unSizeFirmwareImage);
-            if (EFI_ERROR(efiStatus))
-                break;
+            if (StrnCmp(PpwszArgv[ullIndex], L"call-", 5) != 0)
+                continue;
 
-            // Check the firmware image.
-            efiStatus = CheckImage(hDriver, pFirmwareImage, unSizeFirmwareImage);
+            ullStepStart = AsmReadTsc();
+            efiStatus = RunDriverMethod(hDriver, PpwszArgv[ullIndex], pwszFirmwareImagePath, &pFirmwareImage, &unSizeFirmwareImage, &showUsage);
+            Print(L"\nBatch step %s: Status: 0x%.16lX, Time: %lu ms\n", PpwszArgv[ullIndex], efiStatus, DivU64x64Remainder(AsmReadTsc() - ullStepStart, ullTicksPerMs, NULL));
             if (EFI_ERROR(efiStatus))
                 break;
         }
-        else if (StrCmp(pwszCommand, L"call-setImage") == 0)
-        {
-            if (PullArgc < 4)
-            {
-                showUsage = TRUE;
-                efiStatus = EFI_INVALID_PARAMETER;
-                break;
-            }
+        Print(L"\nBatch total time: %lu ms\n", DivU64x64Remainder(AsmReadTsc() - ullBatchStart, ullTicksPerMs, NULL));
+    } while (FALSE);
 
-            // Load the firmware image that shall be used to update the TPM.
-            efiStatus = LoadFirmwareImage(pwszFirmwareImagePath, &pFirmwareImage, &unSizeFirmwareImage);
-            if (EFI_ERROR(efiStatus))
-                break;
+    // Unload driver if loaded
+    if (hDriver)
+    {
+        ConfigureLogging(hDriver, FALSE);
+        UnloadDriver(hDriver);
+    }
 
-            // Set the firmware image to use for firmware update.
-            efiStatus = SetImage(hDriver, pFirmwareImage, unSizeFirmwareImage);
-            if (EFI_ERROR(efiStatus))
-                break;
+    // Write the log file
+    CloseLogging(EFI_ERROR(efiStatus));
+
+    // Free memory for firmware image if allocated
+    FreeFirmwareImage(pFirmwareImage);
+
+    if (showUsage)
+        ShowUsage();
+
+    if (EFI_SUCCESS == efiStatus)
+        Print(L"\n\nRunIFXTPMUpdate completed successfully.\n");
+    else
+        Print(L"\n\nRunIFXTPMUpdate failed, Status: 0x%.16lX\n", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Reads the firmware update history of the driver.
+ *  @details    The function reads @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1 "the update history" with
+ *              @ref IFXTPMUpdate_AdapterInformation_GetInformation "EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation()".
+ *              The information type does not access the TPM.
+ *
+ *  @param      PhDriver            Handle to the driver.
+ *  @param      PpunTotalCount      Receives the number of attempts recorded since the history was created.
+ *  @param      PpNewest            Receives the newest attempt (optional, zeroed if the history is empty).
+ *
+ *  @retval     EFI_SUCCESS     The function executed successfully.
+ *  @retval     other           An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+GetUpdateHistory(
+    IN  EFI_HANDLE                          PhDriver,
+    OUT UINT32*                             PpunTotalCount,
+    OUT EFI_IFXTPM_UPDATE_HISTORY_ENTRY*    PpNewest OPTIONAL)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+    EFI_ADAPTER_INFORMATION_PROTOCOL* pAdapterInfo = NULL;
+    EFI_GUID InformationType = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID;
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1* pHistory = NULL;
+    UINTN ullInformationBlockSize = 0;
+
+    *PpunTotalCount = 0;
+    if (PpNewest != NULL)
+        ZeroMem(PpNewest, sizeof(*PpNewest));
+
+    do
+    {
+        efiStatus = gBS->OpenProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, (VOID**)&pAdapterInfo, gImageHandle, NULL, EFI_OPEN_PROTOCOL_BY_HANDLE_PROTOCOL);
+        if (EFI_ERROR(efiStatus))
+        {
+            pAdapterInfo = NULL;
+            break;
         }
-        else if (StrCmp(pwszCommand, L"call-getImageInfo") == 0)
+
+        efiStatus = pAdapterInfo->GetInformation(pAdapterInfo, &InformationType, (VOID**)&pHistory, &ullInformationBlockSize);
+        if (EFI_ERROR(efiStatus))
+            break;
+        if (ullInformationBlockSize < sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1))
         {
-            // Get infomation of actual firmware image.
-            efiStatus = GetImageInfo(hDriver);
-            if (EFI_ERROR(efiStatus))
-                break;
+            efiStatus = EFI_BAD_BUFFER_SIZE;
+            break;
         }
-        else if (StrCmp(pwszCommand, L"call-getFuDetails") == 0)
+
+        *PpunTotalCount = pHistory->TotalCount;
+        if (PpNewest != NULL && pHistory->Count > 0)
+            CopyMem(PpNewest, &pHistory->Entries[0], sizeof(*PpNewest));
+    }
+    while (FALSE);  // Loop construct for error handling
+
+    if (pHistory != NULL)
+        FreePool(pHistory);
+    if (pAdapterInfo != NULL)
+        gBS->CloseProtocol(PhDriver, &gEfiAdapterInformationProtocolGuid, gImageHandle, NULL);
+
+    return efiStatus;
+}
+
+/**
+ *  @ingroup    RunIFXTPMUpdate
+ *  @brief      Writes the run summary file.
+ *  @details    The summary is one record of ASCII key=value lines, so an orchestrator can read the result of the run without
+ *              parsing the console output or the log file. The versions, block counts and phase durations are taken from the
+ *              update history entry the driver recorded for this run and are omitted if SetImage was not reached.
+ *              An existing file is replaced.
+ *
+ *  @param      PwszPath            Path of the summary file.
+ *  @param      PpSummary           Run summary.
+ *
+ *  @retval     EFI_SUCCESS             The summary was written successfully.
+ *  @retval     EFI_OUT_OF_RESOURCES    The memory for the summary could not be allocated.
+ *  @retval     other                   An error occurred when executing this function.
+ */
+EFI_STATUS
+EFIAPI
+WriteRunSummary(
+    IN  CONST CHAR16*       PwszPath,
+    IN  CONST RUN_SUMMARY*  PpSummary)
+{
+    static CONST CHAR8* s_rgszPhaseKeys[EFI_IFXTPM_UPDATE_PHASE_COUNT] = {
+        "verify", "state", "policy", "start", "boot_loader", "manifest", "firmware", "finalize"
+    };
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+    SHELL_FILE_HANDLE hFile = NULL;
+    CHAR8* szSummary = NULL;
+
+    do
+    {
+        UINTN ullLength = 0;
+        UINTN ullIndex = 0;
+        UINT64 ullTicksPerMs = 0 == PpSummary->TicksPerMs ? 1 : PpSummary->TicksPerMs;
+
+        szSummary = (CHAR8*)AllocateZeroPool(SUMMARY_BUFFER_SIZE);
+        if (NULL == szSummary)
         {
-            // Get detail information of actual firmware image.
-            efiStatus = GetFuDetails(hDriver);
-            if (EFI_ERROR(efiStatus))
-                break;
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
         }
-        else if (StrCmp(pwszCommand, L"call-getFuCounters") == 0)
+
+        ullLength += AsciiSPrint(&szSummary[ullLength], SUMMARY_BUFFER_SIZE - ullLength,
+                                 "method=%s\nimage=%s\nstatus=0x%016lX\nresult=%a\n",
+                                 PpSummary->Method, NULL == PpSummary->Image ? L"" : PpSummary->Image,
+                                 PpSummary->Status, EFI_ERROR(PpSummary->Status) ? "failure" : "success");
+        if (PpSummary->HistoryValid)
         {
-            // Get fieldupgrade counters of actual firmware.
-            efiStatus = GetFuCounters(hDriver);
-            if (EFI_ERROR(efiStatus))
-                break;
+            ullLength += AsciiSPrint(&szSummary[ullLength], SUMMARY_BUFFER_SIZE - ullLength,
+                                     "source_version=%s\ntarget_version=%s\nblock_count=%u\nblock_retries=%u\n",
+                                     PpSummary->History.SourceVersion, PpSummary->History.TargetVersion,
+                                     PpSummary->History.BlockCount, PpSummary->History.BlockRetries);
         }
-        else if (StrCmp(pwszCommand, L"call-getOperationMode") == 0)
+        ullLength += AsciiSPrint(&szSummary[ullLength], SUMMARY_BUFFER_SIZE - ullLength,
+                                 "driver_load_ms=%lu\nimage_load_ms=%lu\ncheck_image_ms=%lu\nset_image_ms=%lu\n",
+                                 DivU64x64Remainder(PpSummary->DriverLoadTicks, ullTicksPerMs, NULL),
+                                 DivU64x64Remainder(PpSummary->ImageLoadTicks, ullTicksPerMs, NULL),
+                                 DivU64x64Remainder(PpSummary->CheckImageTicks, ullTicksPerMs, NULL),
+                                 DivU64x64Remainder(PpSummary->SetImageTicks, ullTicksPerMs, NULL));
+        for (ullIndex = 0; PpSummary->HistoryValid && ullIndex < EFI_IFXTPM_UPDATE_PHASE_COUNT; ullIndex++)
         {
-            // Get operation mode of TPM firmware.
-            efiStatus = GetOperationMode(hDriver);
-            if (EFI_ERROR(efiStatus))
-                break;
+            ullLength += AsciiSPrint(&szSummary[ullLength], SUMMARY_BUFFER_SIZE - ullLength, "phase_%a_ms=%u\n",
+                                     s_rgszPhaseKeys[ullIndex], PpSummary->History.PhaseMs[ullIndex]);
         }
-        else if (StrCmp(pwszCommand, L"call-setOperational") == 0)
+        ullLength += AsciiSPrint(&szSummary[ullLength], SUMMARY_BUFFER_SIZE - ullLength, "total_ms=%lu\n",
+                                 DivU64x64Remainder(PpSummary->TotalTicks, ullTicksPerMs, NULL));
+
+        // Replace an existing file
+        if (ShellFileExists(PwszPath) == EFI_SUCCESS && !EFI_ERROR(ShellOpenFileByName(PwszPath, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ, 0)))
         {
-            // Get operation mode of TPM firmware.
-            efiStatus = SetOperational(hDriver);
+            efiStatus = ShellDeleteFile(&hFile);
+            hFile = NULL;
             if (EFI_ERROR(efiStatus))
                 break;
         }
-        else
+
+        efiStatus = ShellOpenFileByName(PwszPath, &hFile, EFI_FILE_MODE_WRITE | EFI_FILE_MODE_READ | EFI_FILE_MODE_CREATE, 0);
+        if (EFI_ERROR(efiStatus))
         {
-            showUsage = TRUE;
-            efiStatus = EFI_INVALID_PARAMETER;
+            hFile = NULL;
+            break;
         }
-    } while (FALSE);
 
-    // Unload driver if loaded
-    if (hDriver)
-    {
-        ConfigureLogging(hDriver, FALSE);
-        UnloadDriver(hDriver);
+        efiStatus = ShellWriteFile(hFile, &ullLength, szSummary);
     }
+    while (FALSE);  // Loop construct for error handling
 
-    // Free memory for firmware image if allocated
-    if (pFirmwareImage != NULL)
-        FreePool(pFirmwareImage);
-
-    if (showUsage)
-        ShowUsage();
-
-    if (EFI_SUCCESS == efiStatus)
-        Print(L"\n\nRunIFXTPMUpdate completed successfully.\n");
-    else
-        Print(L"\n\nRunIFXTPMUpdate failed, Status: 0x%.16lX\n", efiStatus);
+    if (hFile != NULL)
+        ShellCloseFile(&hFile);
+    if (szSummary != NULL)
+        FreePool(szSummary);
 
     return efiStatus;
 }
@@ -1411,6 +2676,10 @@ ShellAppMain(
     BOOLEAN fUpdatableOnce = FALSE;
     UINT32 unPolicySessionHandle = 0;
     BOOLEAN fDriverUnloaded = FALSE;
+    CHAR16* pwszSummaryPath = NULL;
+    UINT32 unHistoryCount = 0;
+    UINT64 ullStepStart = 0;
+    RUN_SUMMARY sSummary;
     // Exemplary SHA-1 hash value of ASCII string '12345678' (assumes that TPM Ownership has been taken with this string as TPM Owner authentication)
     UINT8 rgbOwnerAuthHash[SIZE_SHA1] = {
         0x7c, 0x22, 0x2f, 0xb2, 0x92, 0x7d, 0x82, 0x8a,
@@ -1418,6 +2687,24 @@ ShellAppMain(
         0x80, 0x63, 0x7c, 0x0d
     };
 
+    ZeroMem(&sSummary, sizeof(sSummary));
+
+    // Take the run summary option out of the positional arguments
+    for (UINTN ullIndex = 1; ullIndex < PullArgc; ullIndex++)
+    {
+        if (StrCmp(PpwszArgv[ullIndex], SUMMARY_OPTION) != 0)
+            continue;
+        if (ullIndex + 1 >= PullArgc || NULL != pwszSummaryPath)
+        {
+            ShowUsage();
+            return EFI_INVALID_PARAMETER;
+        }
+        pwszSummaryPath = PpwszArgv[ullIndex + 1];
+        CopyMem(&PpwszArgv[ullIndex], &PpwszArgv[ullIndex + 2], (PullArgc - ullIndex - 2) * sizeof(CHAR16*));
+        PullArgc -= 2;
+        ullIndex--;
+    }
+
     // Check for mandatory command line arguments
     if (PullArgc < 3)
     {
@@ -1440,9 +2727,12 @@ ShellAppMain(
             ullMinArgc = 4;
         else if (StrCmp(pwszCommand, L"tpm12-PP") == 0)
             ullMinArgc = 3;
-        // Call driver method directly?
-        else if (StrStr(pwszCommand, L"call-") != NULL)
+        // Call driver method directly? (the run summary is only written for update types)
+        else if (NULL == pwszSummaryPath && StrStr(pwszCommand, L"call-") != NULL)
             return CallDriverMethod(PullArgc, PpwszArgv);
+        // Call several driver methods with one driver load?
+        else if (NULL == pwszSummaryPath && StrCmp(pwszCommand, L"batch") == 0)
+            return RunBatch(PullArgc, PpwszArgv);
 
         Print(L"Parameters:\n");
         Print(L"  Update Type: %s\n", pwszCommand);
@@ -1453,6 +2743,8 @@ ShellAppMain(
             pwszFirmwareImagePath = PpwszArgv[3];
             Print(L"  Firmware image path: %s\n", pwszFirmwareImagePath);
         }
+        if (NULL != pwszSummaryPath)
+            Print(L"  Summary path: %s\n", pwszSummaryPath);
 
         // Check if a command was specified and if number of arguments fits
         if (0 == ullMinArgc || PullArgc < ullMinArgc)
@@ -1509,21 +2801,28 @@ ShellAppMain(
         }
     }
 
+    sSummary.Method = pwszCommand;
+    sSummary.Image = pwszFirmwareImagePath;
+    if (NULL != pwszSummaryPath)
+        sSummary.TicksPerMs = GetTscTicksPerMillisecond();
+    sSummary.TotalTicks = AsmReadTsc();
+
     do
     {
-        // Verify that IFXTPMUpdate.efi driver is not loaded.
-        // (with EFI_COMPONENT_NAME_PROTOCOL.GetDriverName() and EFI_COMPONENT_NAME2_PROTOCOL.GetDriverName())
-        efiStatus = IsDriverLoaded();
+        // Verify that IFXTPMUpdate.efi driver is not loaded (with EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL).
+        efiStatus = IsDriverLoaded(NULL);
         if (EFI_NOT_FOUND != efiStatus)
             break;
 
         // Load the IFXTPMUpdate.efi driver.
+        ullStepStart = AsmReadTsc();
         efiStatus = LoadDriver(pwszDriverPath, &hDriver);
+        sSummary.DriverLoadTicks = AsmReadTsc() - ullStepStart;
         if (EFI_ERROR(efiStatus))
             break;
 
         // Verify that IFXTPMUpdate.efi driver is loaded. NOTE: This is an optional step, it can be omitted.
-        efiStatus = IsDriverLoaded();
+        efiStatus = IsDriverLoaded(NULL);
         if (EFI_ERROR(efiStatus))
             break;
 
@@ -1546,24 +2845,22 @@ ShellAppMain(
             Print(L"- TPM can be updated one last time.\n");
 
         // Load the firmware image that shall be used to update the TPM.
+        ullStepStart = AsmReadTsc();
         efiStatus = LoadFirmwareImage(pwszFirmwareImagePath, &pFirmwareImage, &unSizeFirmwareImage);
+        sSummary.ImageLoadTicks = AsmReadTsc() - ullStepStart;
         if (EFI_ERROR(efiStatus))
             break;
 
         // Verify that the given firmware image can be used to update the TPM with EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage().
+        ullStepStart = AsmReadTsc();
         efiStatus = IsTpmUpdatableWithFirmware(hDriver, pFirmwareImage, unSizeFirmwareImage);
+        sSummary.CheckImageTicks = AsmReadTsc() - ullStepStart;
         if (EFI_ERROR(efiStatus))
             break;
         // Possible results:
         // - EFI_SUCCESS: This firmware can be flashed onto the TPM.
         // - EFI_ABORTED: This firmware cannot be flashed onto the TPM.
 
-        if (0 == StrCmp(pwszCommand, L"tpm20") && 4 < PullArgc)
-            // Set the policy session handle with EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation() (only required when starting a TPM2.0 firmware update).
-            efiStatus = SetPolicySessionHandle(hDriver, unPolicySessionHandle);
-        if (EFI_ERROR(efiStatus))
-            break;
-
         if (0 == StrCmp(pwszCommand, L"tpm12-owned"))
             // Set TPM Owner authentication hash with EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation() (only required for TPM1.2 if TPM Ownership has been taken).
             efiStatus = SetOwnerAuthHash(hDriver, rgbOwnerAuthHash);
@@ -1571,7 +2868,18 @@ ShellAppMain(
             break;
 
         // Update the TPM firmware with EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage().
-        efiStatus = UpdateTpmFirmware(hDriver, pFirmwareImage, unSizeFirmwareImage);
+        if (NULL != pwszSummaryPath)
+            GetUpdateHistory(hDriver, &unHistoryCount, NULL);
+        ullStepStart = AsmReadTsc();
+        // The policy session handle (only used when starting a TPM2.0 firmware update) is passed as SetImage() vendor code.
+        efiStatus = UpdateTpmFirmware(hDriver, pFirmwareImage, unSizeFirmwareImage, unPolicySessionHandle);
+        sSummary.SetImageTicks = AsmReadTsc() - ullStepStart;
+        // The driver records each SetImage call in its update history, take the versions and phase durations from there
+        if (NULL != pwszSummaryPath)
+        {
+            UINT32 unCount = 0;
+            sSummary.HistoryValid = !EFI_ERROR(GetUpdateHistory(hDriver, &unCount, &sSummary.History)) && unCount > unHistoryCount;
+        }
         if (EFI_ERROR(efiStatus))
             break;
         // Possible results:
@@ -1592,7 +2900,7 @@ ShellAppMain(
             break;
 
         // Verify that IFXTPMUpdate.efi driver is not loaded. NOTE: This is an optional step, it can be omitted.
-        efiStatus = IsDriverLoaded();
+        efiStatus = IsDriverLoaded(NULL);
         if (EFI_NOT_FOUND != efiStatus)
             break;
 
@@ -1603,14 +2911,24 @@ ShellAppMain(
     while (FALSE);
 
     // For testing only, disable logging and unload driver in error scenarios.
-    if (!fDriverUnloaded && IsDriverLoaded() == EFI_SUCCESS)
+    if (!fDriverUnloaded && IsDriverLoaded(&hDriver) == EFI_SUCCESS)
     {
         ConfigureLogging(hDriver, FALSE);
         UnloadDriver(hDriver);
     }
 
-    if (pFirmwareImage != NULL)
-        FreePool(pFirmwareImage);
+    // Write the log file
+    CloseLogging(EFI_ERROR(efiStatus));
+
+    FreeFirmwareImage(pFirmwareImage);
+
+    if (NULL != pwszSummaryPath)
+    {
+        sSummary.Status = efiStatus;
+        sSummary.TotalTicks = AsmReadTsc() - sSummary.TotalTicks;
+        if (EFI_ERROR(WriteRunSummary(pwszSummaryPath, &sSummary)))
+            Print(L"\nThe run summary could not be written to %s.\n", pwszSummaryPath);
+    }
 
     if (EFI_SUCCESS == efiStatus)
         Print(L"\n\nRunIFXTPMUpdate completed successfully.\n");
@@ -0,0 +1,600 @@
+/**
+ *  @addtogroup TpmBench
+ *  @brief      Implements the TPM transport microbenchmark application TpmBench.
+ *  @details    Measures the register access latency, the FIFO throughput, the end-to-end latency of short TPM2.0 commands and
+ *              the unmarshal throughput of the TPM access code used by the Infineon TPM Firmware Update Driver. The results are
+ *              printed as CSV.
+ *  @file       TpmBench.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#include "StdInclude.h"
+
+#include <Library/BaseLib.h>
+#include <Library/ShellCEntryLib.h>
+#include <Library/ShellLib.h>
+
+#include "DeviceAccess.h"
+#include "DeviceManagement.h"
+#include "TPM_TIS.h"
+#include "TPM2_GetCapability.h"
+#include "TPM2_GetTestResult.h"
+#include "TPM2_Marshal.h"
+
+/// Default number of iterations of each benchmark
+#define BENCH_DEFAULT_ITERATIONS        100
+
+/// Factor applied to the number of iterations of the unmarshal benchmark (it does not access the TPM)
+#define BENCH_UNMARSHAL_FACTOR          100
+
+/// Size of the memory arena in bytes (used by PropertyStorage)
+#define BENCH_ARENA_SIZE                (32 * 1024)
+
+/// Size of the padded command used to measure the FIFO write throughput in bytes
+#define BENCH_FIFO_COMMAND_SIZE         1024
+
+/// Size of the response buffer in bytes
+#define BENCH_RESPONSE_BUFFER_SIZE      4096
+
+/// Maximum duration of the commands sent directly through TIS in microseconds
+#define BENCH_COMMAND_MAX_DURATION_US   2000000
+
+/// Size of the TPM2.0 response header (tag, size and response code)
+#define BENCH_RESPONSE_HEADER_SIZE      10
+
+/// Current log level. Only errors are printed, as CSV comment lines.
+unsigned int g_unLoggingLevel = LOGGING_LEVEL_1;
+
+/**
+ *  @brief      Accumulated measurements of one benchmark.
+ */
+typedef struct tdBENCH_RESULT
+{
+    /// Number of measured iterations
+    unsigned int        unIterations;
+    /// Sum of the durations in microseconds
+    unsigned long long  ullTotalUs;
+    /// Shortest duration in microseconds
+    unsigned long long  ullMinUs;
+    /// Longest duration in microseconds
+    unsigned long long  ullMaxUs;
+    /// Number of bytes transferred or processed
+    unsigned long long  ullBytes;
+} BENCH_RESULT;
+
+/// Response buffer shared by the benchmarks
+static BYTE s_rgbResponse[BENCH_RESPONSE_BUFFER_SIZE];
+
+/// Size of the TPM2_GetCapability(TPM_CAP_COMMANDS) response recorded by the FIFO read benchmark
+static unsigned int s_unCapabilityResponseSize = 0;
+
+/**
+ *  @brief      Logging function
+ *  @details    Prints error messages as CSV comment lines. Messages of other levels are dropped.
+ *
+ *  @param      PszCurrentModule        Pointer to a char array holding the module name (optional, can be NULL).
+ *  @param      PszCurrentFunction      Pointer to a char array holding the function name (optional, can be NULL).
+ *  @param      PunLoggingLevel         Logging level.
+ *  @param      PwszLoggingMessage      Format string used to format the message.
+ *  @param      ...                     Parameters needed to format the message.
+ */
+void
+IFXAPI
+Logging_WriteLog(
+    _In_z_  const char*     PszCurrentModule,
+    _In_z_  const char*     PszCurrentFunction,
+    _In_    unsigned int    PunLoggingLevel,
+    _In_z_  const wchar_t*  PwszLoggingMessage,
+    ...)
+{
+    wchar_t wszMessage[256];
+    unsigned int unSize = RG_LEN(wszMessage);
+    va_list argptr;
+
+    UNREFERENCED_PARAMETER(PszCurrentModule);
+    UNREFERENCED_PARAMETER(PszCurrentFunction);
+
+    if (PunLoggingLevel > LOGGING_LEVEL_1 || NULL == PwszLoggingMessage)
+        return;
+
+    va_start(argptr, PwszLoggingMessage);
+    if (RC_SUCCESS == Platform_StringFormatV(wszMessage, &unSize, PwszLoggingMessage, argptr))
+        Print(L"# %s\n", wszMessage);
+    va_end(argptr);
+}
+
+/**
+ *  @brief      Log hex dump function
+ *  @details    Hex dumps are not printed.
+ *
+ *  @param      PszCurrentModule        Pointer to a char array holding the module name (optional, can be NULL).
+ *  @param      PszCurrentFunction      Pointer to a char array holding the function name (optional, can be NULL).
+ *  @param      PunLoggingLevel         Logging level.
+ *  @param      PrgbHexData             Format string used to format the message.
+ *  @param      PunSize                 Size of hex data buffer.
+ */
+void
+Logging_WriteHex(
+    _In_z_                  const char*     PszCurrentModule,
+    _In_z_                  const char*     PszCurrentFunction,
+    _In_                    unsigned int    PunLoggingLevel,
+    _In_bytecount_(PunSize) const BYTE*     PrgbHexData,
+    _In_                    unsigned int    PunSize)
+{
+    UNREFERENCED_PARAMETER(PszCurrentModule);
+    UNREFERENCED_PARAMETER(PszCurrentFunction);
+    UNREFERENCED_PARAMETER(PunLoggingLevel);
+    UNREFERENCED_PARAMETER(PrgbHexData);
+    UNREFERENCED_PARAMETER(PunSize);
+}
+
+/**
+ *  @brief      Shows the usage of the program.
+ *  @details    The function shows the usage of the program.
+ */
+void
+EFIAPI
+ShowUsage()
+{
+    Print(L"Usage:\n");
+    Print(L" TpmBench.efi [iterations]\n");
+    Print(L"\n");
+    Print(L"Measures the TPM transport of the platform and prints the results as CSV (default iterations: %d).\n", BENCH_DEFAULT_ITERATIONS);
+    Print(L"Columns: benchmark,iterations,total_us,min_us,avg_us,max_us,bytes,bytes_per_s\n");
+    Print(L"Error messages are printed as lines starting with '#'.\n");
+}
+
+/**
+ *  @brief      Adds a measurement to a benchmark result.
+ *
+ *  @param      PpsResult       Benchmark result.
+ *  @param      PullDurationUs  Duration of the iteration in microseconds.
+ *  @param      PullBytes       Number of bytes transferred or processed in the iteration.
+ */
+void
+EFIAPI
+BenchResult_Add(
+    IN OUT  BENCH_RESULT*       PpsResult,
+    IN      unsigned long long  PullDurationUs,
+    IN      unsigned long long  PullBytes)
+{
+    if (0 == PpsResult->unIterations || PullDurationUs < PpsResult->ullMinUs)
+        PpsResult->ullMinUs = PullDurationUs;
+    if (PullDurationUs > PpsResult->ullMaxUs)
+        PpsResult->ullMaxUs = PullDurationUs;
+    PpsResult->ullTotalUs += PullDurationUs;
+    PpsResult->ullBytes += PullBytes;
+    PpsResult->unIterations++;
+}
+
+/**
+ *  @brief      Prints a benchmark result as CSV row.
+ *
+ *  @param      PwszName        Name of the benchmark.
+ *  @param      PpsResult       Benchmark result.
+ */
+void
+EFIAPI
+BenchResult_Print(
+    IN  CONST CHAR16*       PwszName,
+    IN  CONST BENCH_RESULT* PpsResult)
+{
+    UINT64 ullAverageUs = 0;
+    UINT64 ullBytesPerSecond = 0;
+
+    if (0 != PpsResult->unIterations)
+        ullAverageUs = DivU64x32(PpsResult->ullTotalUs, PpsResult->unIterations);
+    if (0 != PpsResult->ullTotalUs)
+        ullBytesPerSecond = DivU64x64Remainder(MultU64x32(PpsResult->ullBytes, 1000000), PpsResult->ullTotalUs, NULL);
+
+    Print(L"%s,%u,%lu,%lu,%lu,%lu,%lu,%lu\n",
+          PwszName,
+          PpsResult->unIterations,
+          PpsResult->ullTotalUs,
+          PpsResult->ullMinUs,
+          ullAverageUs,
+          PpsResult->ullMaxUs,
+          PpsResult->ullBytes,
+          ullBytesPerSecond);
+}
+
+/**
+ *  @brief      Measures the latency of single register reads.
+ *  @details    Reads the TPM_ACCESS register of locality 0 with DeviceAccess_ReadByte.
+ *
+ *  @param      PunIterations   Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS     The benchmark completed.
+ */
+EFI_STATUS
+EFIAPI
+BenchRegisterRead(
+    IN  unsigned int    PunIterations)
+{
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+
+    ZeroMem(&sResult, sizeof(sResult));
+    for (unIndex = 0; unIndex < PunIterations; unIndex++)
+    {
+        unsigned long long ullStart = Platform_GetTicks();
+        IGNORE_RETURN_VALUE(DeviceAccess_ReadByte(TIS_LOCALITY0OFFSET + TIS_TPM_ACCESS));
+        BenchResult_Add(&sResult, Platform_TicksToMicroseconds(Platform_GetTicks() - ullStart), sizeof(BYTE));
+    }
+    BenchResult_Print(L"register_read", &sResult);
+
+    return EFI_SUCCESS;
+}
+
+/**
+ *  @brief      Measures the latency of single register writes.
+ *  @details    Writes 0 to the TPM_ACCESS register of locality 0 with DeviceAccess_WriteByte. The TPM_ACCESS bits only
+ *              act when written with 1, so the write does not change the TPM state.
+ *
+ *  @param      PunIterations   Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS     The benchmark completed.
+ */
+EFI_STATUS
+EFIAPI
+BenchRegisterWrite(
+    IN  unsigned int    PunIterations)
+{
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+
+    ZeroMem(&sResult, sizeof(sResult));
+    for (unIndex = 0; unIndex < PunIterations; unIndex++)
+    {
+        unsigned long long ullStart = Platform_GetTicks();
+        DeviceAccess_WriteByte(TIS_LOCALITY0OFFSET + TIS_TPM_ACCESS, 0);
+        BenchResult_Add(&sResult, Platform_TicksToMicroseconds(Platform_GetTicks() - ullStart), sizeof(BYTE));
+    }
+    BenchResult_Print(L"register_write", &sResult);
+
+    return EFI_SUCCESS;
+}
+
+/**
+ *  @brief      Sends a command through TIS and receives its response.
+ *  @details    The durations of the transport phases are returned so the FIFO throughput can be calculated without the
+ *              TPM processing time.
+ *
+ *  @param      PrgbCommand         Command bytes.
+ *  @param      PusCommandSize      Size of the command in bytes.
+ *  @param      PpusResponseSize    Receives the size of the response in s_rgbResponse.
+ *  @param      PpsTiming           Receives the durations of the transport phases.
+ *
+ *  @retval     EFI_SUCCESS         The command was transmitted.
+ *  @retval     EFI_DEVICE_ERROR    The command could not be transmitted.
+ */
+EFI_STATUS
+EFIAPI
+BenchTransceive(
+    IN  CONST BYTE*         PrgbCommand,
+    IN  UINT16              PusCommandSize,
+    OUT UINT16*             PpusResponseSize,
+    OUT TPM_PHASE_TIMING*   PpsTiming)
+{
+    UINT32 unReturnValue = TIS_SendLPC(TIS_LOCALITY_0, PrgbCommand, PusCommandSize);
+    if (RC_SUCCESS == unReturnValue)
+    {
+        *PpusResponseSize = sizeof(s_rgbResponse);
+        unReturnValue = TIS_ReceiveLPC(TIS_LOCALITY_0, s_rgbResponse, PpusResponseSize, BENCH_COMMAND_MAX_DURATION_US, 0);
+    }
+    if (RC_SUCCESS == unReturnValue)
+        unReturnValue = TIS_GetLastPhaseTiming(PpsTiming);
+    if (RC_SUCCESS != unReturnValue)
+    {
+        Print(L"# Error: TIS transmission failed (0x%.8X)\n", unReturnValue);
+        return EFI_DEVICE_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/**
+ *  @brief      Measures the FIFO write throughput.
+ *  @details    Sends a TPM2_GetTestResult command padded to BENCH_FIFO_COMMAND_SIZE bytes with TIS_SendLPC. The TPM rejects the
+ *              command with a size error, so only the send phase is measured.
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS         The benchmark completed.
+ *  @retval     EFI_DEVICE_ERROR    A command could not be transmitted.
+ */
+EFI_STATUS
+EFIAPI
+BenchFifoWrite(
+    IN  unsigned int    PunIterations)
+{
+    static BYTE rgbCommand[BENCH_FIFO_COMMAND_SIZE];
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+
+    ZeroMem(&sResult, sizeof(sResult));
+    ZeroMem(rgbCommand, sizeof(rgbCommand));
+
+    // TPM_ST_NO_SESSIONS, commandSize, TPM_CC_GetTestResult, followed by padding
+    rgbCommand[0] = 0x80;
+    rgbCommand[1] = 0x01;
+    rgbCommand[4] = (BYTE)(BENCH_FIFO_COMMAND_SIZE >> 8);
+    rgbCommand[5] = (BYTE)BENCH_FIFO_COMMAND_SIZE;
+    rgbCommand[8] = (BYTE)(TSS_TPM_CC_GetTestResult >> 8);
+    rgbCommand[9] = (BYTE)TSS_TPM_CC_GetTestResult;
+
+    for (unIndex = 0; unIndex < PunIterations; unIndex++)
+    {
+        UINT16 usResponseSize = 0;
+        TPM_PHASE_TIMING sTiming;
+
+        efiStatus = BenchTransceive(rgbCommand, sizeof(rgbCommand), &usResponseSize, &sTiming);
+        if (EFI_ERROR(efiStatus))
+            break;
+        BenchResult_Add(&sResult, sTiming.ullSendUs, sizeof(rgbCommand));
+    }
+    BenchResult_Print(L"fifo_write", &sResult);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Measures the FIFO read throughput.
+ *  @details    Sends TPM2_GetCapability(TPM_CAP_COMMANDS) and measures the receive phase of the response which lists all
+ *              implemented commands. The last response is kept for the unmarshal benchmark.
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS         The benchmark completed.
+ *  @retval     EFI_DEVICE_ERROR    A command could not be transmitted.
+ */
+EFI_STATUS
+EFIAPI
+BenchFifoRead(
+    IN  unsigned int    PunIterations)
+{
+    // TPM2_GetCapability(TPM_CAP_COMMANDS, TPM_CC_FIRST, 256)
+    static CONST BYTE rgbCommand[] = {
+        0x80, 0x01, 0x00, 0x00, 0x00, 0x16, 0x00, 0x00, 0x01, 0x7A,
+        0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x01, 0x1F, 0x00, 0x00, 0x01, 0x00
+    };
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+
+    ZeroMem(&sResult, sizeof(sResult));
+    for (unIndex = 0; unIndex < PunIterations; unIndex++)
+    {
+        UINT16 usResponseSize = 0;
+        TPM_PHASE_TIMING sTiming;
+
+        efiStatus = BenchTransceive(rgbCommand, sizeof(rgbCommand), &usResponseSize, &sTiming);
+        if (EFI_ERROR(efiStatus))
+            break;
+        BenchResult_Add(&sResult, sTiming.ullReceiveUs, usResponseSize);
+        s_unCapabilityResponseSize = usResponseSize;
+    }
+    BenchResult_Print(L"fifo_read", &sResult);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Measures the end-to-end latency of short TPM2.0 commands.
+ *  @details    Calls TSS_TPM2_GetCapability for a single TPM property and TSS_TPM2_GetTestResult through the complete
+ *              command stack (marshaling, DeviceManagement, TpmIO and TIS).
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS         The benchmark completed.
+ *  @retval     EFI_DEVICE_ERROR    A command failed.
+ */
+EFI_STATUS
+EFIAPI
+BenchCommands(
+    IN  unsigned int    PunIterations)
+{
+    static TSS_TPMS_CAPABILITY_DATA sCapabilityData;
+    static TSS_TPM2B_MAX_BUFFER sTestData;
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+    unsigned int unReturnValue = RC_SUCCESS;
+
+    do
+    {
+        ZeroMem(&sResult, sizeof(sResult));
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            TSS_TPMI_YES_NO bMoreData = 0;
+            unsigned long long ullStart = Platform_GetTicks();
+            unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_MANUFACTURER, 1, &bMoreData, &sCapabilityData);
+            BenchResult_Add(&sResult, Platform_TicksToMicroseconds(Platform_GetTicks() - ullStart), 0);
+        }
+        BenchResult_Print(L"tpm2_getcapability", &sResult);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            Print(L"# Error: TPM2_GetCapability failed (0x%.8X)\n", unReturnValue);
+            break;
+        }
+
+        ZeroMem(&sResult, sizeof(sResult));
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            TSS_TPM_RC unTestResult = 0;
+            unsigned long long ullStart = Platform_GetTicks();
+            unReturnValue = TSS_TPM2_GetTestResult(&sTestData, &unTestResult);
+            BenchResult_Add(&sResult, Platform_TicksToMicroseconds(Platform_GetTicks() - ullStart), 0);
+        }
+        BenchResult_Print(L"tpm2_gettestresult", &sResult);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            Print(L"# Error: TPM2_GetTestResult failed (0x%.8X)\n", unReturnValue);
+            break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Measures the unmarshal throughput.
+ *  @details    Unmarshals the TPMS_CAPABILITY_DATA of the TPM2_GetCapability(TPM_CAP_COMMANDS) response recorded by
+ *              BenchFifoRead repeatedly. The TPM is not accessed.
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     EFI_SUCCESS         The benchmark completed.
+ *  @retval     EFI_NOT_READY       No response was recorded.
+ *  @retval     EFI_DEVICE_ERROR    The response could not be unmarshaled.
+ */
+EFI_STATUS
+EFIAPI
+BenchUnmarshal(
+    IN  unsigned int    PunIterations)
+{
+    static TSS_TPMS_CAPABILITY_DATA sCapabilityData;
+    BENCH_RESULT sResult;
+    unsigned int unIndex = 0;
+    unsigned int unReturnValue = RC_SUCCESS;
+    // Skip the response header and the moreData flag
+    TSS_INT32 nParameterSize = (TSS_INT32)s_unCapabilityResponseSize - BENCH_RESPONSE_HEADER_SIZE - sizeof(TSS_TPMI_YES_NO);
+
+    if (nParameterSize <= 0)
+    {
+        Print(L"# Error: No TPM2_GetCapability response recorded\n");
+        return EFI_NOT_READY;
+    }
+
+    ZeroMem(&sResult, sizeof(sResult));
+    for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+    {
+        TSS_BYTE* pbBuffer = &s_rgbResponse[BENCH_RESPONSE_HEADER_SIZE + sizeof(TSS_TPMI_YES_NO)];
+        TSS_INT32 nSize = nParameterSize;
+        unsigned long long ullStart = Platform_GetTicks();
+        unReturnValue = TSS_TPMS_CAPABILITY_DATA_Unmarshal(&sCapabilityData, &pbBuffer, &nSize);
+        BenchResult_Add(&sResult, Platform_TicksToMicroseconds(Platform_GetTicks() - ullStart), (unsigned long long)(nParameterSize - nSize));
+    }
+    BenchResult_Print(L"unmarshal_capability", &sResult);
+    if (RC_SUCCESS != unReturnValue)
+    {
+        Print(L"# Error: Unmarshaling TPMS_CAPABILITY_DATA failed (0x%.8X)\n", unReturnValue);
+        return EFI_DEVICE_ERROR;
+    }
+
+    return EFI_SUCCESS;
+}
+
+/**
+ *  @ingroup    TpmBench
+ *  @brief      Entry point for TpmBench.efi.
+ *  @details    Connects to the TPM like the Infineon TPM Firmware Update Driver and runs all benchmarks.
+ *
+ *  @param      PullArgc            Number of command line arguments.
+ *  @param      PpwszArgv           List of command line arguments.
+ *
+ *  @retval     EFI_SUCCESS             All benchmarks completed.
+ *  @retval     EFI_INVALID_PARAMETER   Invalid command line arguments.
+ *  @retval     other                   An error occurred when executing this function.
+ */
+INTN
+EFIAPI
+ShellAppMain(
+    IN UINTN    PullArgc,
+    IN CHAR16** PpwszArgv)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+    unsigned int unIterations = BENCH_DEFAULT_ITERATIONS;
+    BOOLEAN fArenaInitialized = FALSE;
+    BOOLEAN fConnected = FALSE;
+
+    if (PullArgc > 2)
+    {
+        ShowUsage();
+        return EFI_INVALID_PARAMETER;
+    }
+    if (PullArgc == 2)
+    {
+        unIterations = (unsigned int)ShellStrToUintn(PpwszArgv[1]);
+        if (0 == unIterations)
+        {
+            ShowUsage();
+            return EFI_INVALID_PARAMETER;
+        }
+    }
+
+    do
+    {
+        unsigned int unReturnValue = RC_E_FAIL;
+
+        if (RC_SUCCESS != Platform_ArenaInitialize(BENCH_ARENA_SIZE))
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+        fArenaInitialized = TRUE;
+
+        // Same TPM access configuration as the driver
+        if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_LOCALITY, TIS_LOCALITY_0) ||
+            !PropertyStorage_SetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, TRUE) ||
+            !PropertyStorage_SetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, TPM_DEVICE_ACCESS_MEMORY_BASED))
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        DeviceManagement_Initialize();
+        unReturnValue = DeviceManagement_Connect();
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            Print(L"# Error: Connecting to the TPM failed (0x%.8X)\n", unReturnValue);
+            break;
+        }
+        fConnected = TRUE;
+
+        Print(L"benchmark,iterations,total_us,min_us,avg_us,max_us,bytes,bytes_per_s\n");
+
+        efiStatus = BenchRegisterRead(unIterations);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        efiStatus = BenchRegisterWrite(unIterations);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        efiStatus = BenchFifoWrite(unIterations);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        efiStatus = BenchFifoRead(unIterations);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        efiStatus = BenchCommands(unIterations);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        efiStatus = BenchUnmarshal(unIterations * BENCH_UNMARSHAL_FACTOR);
+    }
+    WHILE_FALSE_END;
+
+    if (fConnected)
+        IGNORE_RETURN_VALUE(DeviceManagement_Disconnect());
+    DeviceManagement_Uninitialize();
+    PropertyStorage_ClearElements();
+    if (fArenaInitialized)
+        Platform_ArenaUninitialize();
+
+    return efiStatus;
+}
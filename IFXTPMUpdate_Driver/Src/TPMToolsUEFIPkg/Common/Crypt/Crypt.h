@@ -35,6 +35,66 @@ typedef UINT16 CRYPT_ENC_SCHEME;
 /// Public exponent for firmware image signature
 static const BYTE RSA_DEFAULT_PUB_EXPONENT[]   = { 0x01, 0x00, 0x01 };
 
+/// Hash algorithm identifiers for the incremental hash functions
+#define CRYPT_HASH_ALGORITHM_NONE       0
+#define CRYPT_HASH_ALGORITHM_SHA1       1
+#define CRYPT_HASH_ALGORITHM_SHA256     2
+#define CRYPT_HASH_ALGORITHM_SHA384     3
+#define CRYPT_HASH_ALGORITHM_SHA512     4
+
+/// Size of the hash state buffer in a hash context in bytes
+#define CRYPT_HASH_STATE_SIZE   512
+
+/**
+ *  @brief      Context of an incremental hash calculation
+ *  @details    The context is owned by the caller and can be placed on the stack. It does not hold any allocated memory
+ *              and can be reused for any number of calculations by calling Crypt_HashInit again.
+ */
+typedef struct tdCRYPT_HASH_CONTEXT
+{
+    /// Hash algorithm of the running calculation or CRYPT_HASH_ALGORITHM_NONE if no calculation is running
+    unsigned int unAlgorithm;
+    /// Hash state of the crypto library (UINT64 elements for proper alignment)
+    UINT64 rgullState[CRYPT_HASH_STATE_SIZE / sizeof(UINT64)];
+} CRYPT_HASH_CONTEXT;
+
+/// Maximum number of ranges hashed by Crypt_HashRanges in one pass
+#define CRYPT_HASH_RANGES_MAX   4
+
+/**
+ *  @brief      Byte range of a multi-range hash calculation
+ *  @details    Describes one digest calculated by Crypt_HashRanges. The ranges may overlap.
+ */
+typedef struct tdCRYPT_HASH_RANGE
+{
+    /// Offset of the range in the data
+    unsigned int unOffset;
+    /// Size of the range in bytes. 0 to skip the digest, the digest buffer is zeroed then.
+    unsigned int unSize;
+    /// Hash algorithm (CRYPT_HASH_ALGORITHM_SHA1, _SHA256, _SHA384 or _SHA512)
+    unsigned int unAlgorithm;
+    /// Size of the digest buffer in bytes
+    unsigned int unDigestSize;
+    /// Receives the digest of the range
+    BYTE* pbDigest;
+} CRYPT_HASH_RANGE;
+
+/**
+ *  @brief      Initialize the crypto module
+ *  @details    Builds the CRC lookup tables, detects the CRC32 and SHA-256 instructions of the CPU and runs the SHA-256
+ *              self-test. Must be called on the boot processor before any calculation is started on an application processor.
+ */
+void
+Crypt_Initialize();
+
+/**
+ *  @brief      Uninitialize the crypto module
+ *  @details    Frees the RSA public keys cached for the signature verification.
+ */
+void
+Crypt_Uninitialize();
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 /**
  *  @brief      Calculate HMAC-SHA-1 on the given message
  *  @details    This function calculates a HMAC-SHA-1 on the input message.
@@ -55,6 +115,7 @@ Crypt_HMAC(
     _In_                                        UINT16          PusInputMessageSize,
     _In_opt_bytecount_(TSS_SHA1_DIGEST_SIZE)    const BYTE      PrgbKey[TSS_SHA1_DIGEST_SIZE],
     _Out_bytecap_(TSS_SHA1_DIGEST_SIZE)         BYTE            PrgbHMAC[TSS_SHA1_DIGEST_SIZE]);
+#endif
 
 /**
  *  @brief      Calculate SHA-1 on the given data
@@ -132,6 +193,90 @@ Crypt_SHA512(
     _In_                                    const unsigned int  PunInputMessageSize,
     _Out_bytecap_(TSS_SHA512_DIGEST_SIZE)   BYTE                PrgbSHA512[TSS_SHA512_DIGEST_SIZE]);
 
+/**
+ *  @brief      Start an incremental hash calculation
+ *  @details    This function initializes the given caller-owned hash context for the given algorithm. A context which
+ *              has been used before can be passed again, any running calculation in it is discarded.
+ *
+ *  @param      PpsContext              Hash context to initialize.
+ *  @param      PunAlgorithm            Hash algorithm (CRYPT_HASH_ALGORITHM_SHA1, _SHA256, _SHA384 or _SHA512).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or PunAlgorithm is unknown.
+ */
+_Check_return_
+unsigned int
+Crypt_HashInit(
+    _Out_   CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_    unsigned int            PunAlgorithm);
+
+/**
+ *  @brief      Add data to an incremental hash calculation
+ *  @details    This function hashes the given data into the running calculation of the hash context. It can be called
+ *              any number of times between Crypt_HashInit and Crypt_HashFinal. Empty data is accepted and ignored.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PrgbData                Data to hash.
+ *  @param      PunDataSize             Data size in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or has no running calculation or PrgbData is NULL and PunDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_HashUpdate(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize);
+
+/**
+ *  @brief      Finish an incremental hash calculation
+ *  @details    This function returns the digest of the running calculation of the hash context. Afterwards the context
+ *              has no running calculation until it is passed to Crypt_HashInit again.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PunDigestSize           Size of the digest buffer in bytes. Must be at least the digest size of the algorithm.
+ *  @param      PrgbDigest              Receives the digest.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext or PrgbDigest is NULL or PpsContext has no running calculation.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PunDigestSize is smaller than the digest size of the algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashFinal(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_                            unsigned int            PunDigestSize,
+    _Out_bytecap_(PunDigestSize)    BYTE*                   PrgbDigest);
+
+/**
+ *  @brief      Calculate the digests of several byte ranges of a data stream in one pass
+ *  @details    The data is walked once in chunks. While a chunk is in the cache it is added to the CRC and to the hash
+ *              calculation of each range overlapping it, so the memory is read only once for all digests.
+ *
+ *  @param      PrgbData                Data stream.
+ *  @param      PunDataSize             Size of the data stream in bytes. All ranges must lie within the data stream.
+ *  @param      PrgsRanges              Ranges to hash. The digests are written to the buffers given in the ranges.
+ *  @param      PunRangeCount           Number of ranges (not more than CRYPT_HASH_RANGES_MAX).
+ *  @param      PpunCRC                 Receives the CRC value of the whole data stream. NULL to skip the CRC.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbData is NULL, a range does not lie within the data stream or has no digest buffer or PunRangeCount is too large.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The digest buffer of a range is smaller than the digest size of its algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashRanges(
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize,
+    _Inout_count_(PunRangeCount)    CRYPT_HASH_RANGE*       PrgsRanges,
+    _In_                            unsigned int            PunRangeCount,
+    _Out_opt_                       unsigned int*           PpunCRC);
+
 /**
  *  @brief      Seed the pseudo random number generator
  *  @details    This function seeds the pseudo random number generator.
@@ -166,6 +311,7 @@ Crypt_GetRandom(
     _In_                            const UINT16    PusRandomSize,
     _Out_bytecap_(PusRandomSize)    BYTE*           PrgbRandom);
 
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 /**
  *  @brief      Encrypt a byte array with a RSA 2048-bit public key
  *  @details    This function encrypts the given data stream with RSA 2048-bit.
@@ -203,6 +349,7 @@ Crypt_EncryptRSA(
     _In_bytecount_(PunLabelSize)                const BYTE*         PrgbLabel,
     _Inout_                                     unsigned int*       PpunEncryptedDataSize,
     _Inout_bytecap_(*PpunEncryptedDataSize)     BYTE*               PrgbEncryptedData);
+#endif
 
 /**
  *  @brief      Verify the given RSA PKCS#1 RSASSA-PSS signature
@@ -249,6 +396,26 @@ Crypt_CRC(
     _In_                            int             PnInputDataSize,
     _Inout_                         unsigned int*   PpunCRC);
 
+/**
+ *  @brief      Continue a CRC calculation with the next part of a data stream
+ *  @details    The function updates a running CRC32 value with the given data. Starting with a CRC value of 0 and
+ *              passing all parts of a data stream in order results in the same value as Crypt_CRC on the whole stream.
+ *
+ *  @param      PpInputData         Next part of the data stream.
+ *  @param      PunInputDataSize    Size of the data in bytes.
+ *  @param      PpunCRC             In: CRC value of the preceding data (0 at the start of the stream).\n
+ *                                  Out: CRC value including the given data.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. PpunCRC is NULL or PpInputData is NULL and PunInputDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_CRCUpdate(
+    _In_bytecount_(PunInputDataSize)    const void*     PpInputData,
+    _In_                                unsigned int    PunInputDataSize,
+    _Inout_                             unsigned int*   PpunCRC);
+
 #ifdef __cplusplus
 }
 #endif
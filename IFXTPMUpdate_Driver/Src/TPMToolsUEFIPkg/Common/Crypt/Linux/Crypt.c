@@ -0,0 +1,1016 @@
+/**
+ *  @brief      Implements the crypto functions for Linux
+ *  @details    The hash, random number and RSA functions are provided by the OpenSSL crypto library (libcrypto). The
+ *              low level OpenSSL interfaces are used, which match the ones of the OpenSSL copy in the UEFI CryptoPkg.
+ *  @file       Linux/Crypt.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+/// The low level hash and RSA interfaces are deprecated since OpenSSL 3.0 but still provided
+#define OPENSSL_SUPPRESS_DEPRECATED
+
+#include "Crypt.h"
+
+#include <string.h>
+#include <openssl/bn.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/rand.h>
+#include <openssl/rsa.h>
+#include <openssl/sha.h>
+
+/// Reflected CRC32 polynomial (IEEE 802.3) as used by the CalculateCrc32 boot service
+#define CRYPT_CRC32_POLYNOMIAL  0xEDB88320
+
+/// Lookup tables for the slicing-by-8 calculation in Crypt_CRCUpdate. Table n holds the CRC of a byte followed by n zero bytes.
+static unsigned int s_rgunCrcTable[8][256];
+
+/// Flag indicating whether s_rgunCrcTable has been built
+static BOOL s_fCrcTableInitialized = FALSE;
+
+/// Number of bytes processed per step of Crypt_HashRanges. A chunk stays in the cache while it is added to all ranges.
+#define CRYPT_HASH_RANGES_CHUNK_SIZE    4096
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+/// OAEP label used by TPM1.2 (TPM_ES_RSAESOAEP_SHA1_MGF1)
+static const BYTE s_rgbOaepLabel[] = { 'T', 'C', 'P', 'A' };
+#endif
+
+/**
+ *  @brief      Creates an RSA public key object
+ *  @details
+ *
+ *  @param      PrgbModulus             Public modulus buffer.
+ *  @param      PunModulusSize          Size of public modulus buffer.
+ *  @param      PrgbExponent            Public exponent buffer.
+ *  @param      PunExponentSize         Size of public exponent buffer.
+ *
+ *  @returns    RSA public key object or NULL on failure. The caller must free it with RSA_free.
+ */
+static
+RSA*
+Crypt_CreatePublicKey(
+    _In_bytecount_(PunModulusSize)      const BYTE*     PrgbModulus,
+    _In_                                unsigned int    PunModulusSize,
+    _In_bytecount_(PunExponentSize)     const BYTE*     PrgbExponent,
+    _In_                                unsigned int    PunExponentSize)
+{
+    RSA* pRsaPublicKey = RSA_new();
+    BIGNUM* pModulus = BN_bin2bn(PrgbModulus, (int)PunModulusSize, NULL);
+    BIGNUM* pExponent = BN_bin2bn(PrgbExponent, (int)PunExponentSize, NULL);
+
+    // The key object takes the ownership of the numbers
+    if (NULL == pRsaPublicKey || NULL == pModulus || NULL == pExponent || 1 != RSA_set0_key(pRsaPublicKey, pModulus, pExponent, NULL))
+    {
+        RSA_free(pRsaPublicKey);
+        BN_free(pModulus);
+        BN_free(pExponent);
+        return NULL;
+    }
+
+    return pRsaPublicKey;
+}
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+/**
+ *  @brief      Calculate HMAC-SHA-1 on the given message
+ *  @details    This function calculates a HMAC-SHA-1 on the input message.
+ *
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PusInputMessageSize     Input message size in bytes.
+ *  @param      PrgbKey                 Message authentication key.
+ *  @param      PrgbHMAC                Receives the HMAC.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PusInputMessageSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_HMAC(
+    _In_bytecount_(PusInputMessageSize)         const BYTE*     PrgbInputMessage,
+    _In_                                        UINT16          PusInputMessageSize,
+    _In_opt_bytecount_(TSS_SHA1_DIGEST_SIZE)    const BYTE      PrgbKey[TSS_SHA1_DIGEST_SIZE],
+    _Out_bytecap_(TSS_SHA1_DIGEST_SIZE)         BYTE            PrgbHMAC[TSS_SHA1_DIGEST_SIZE])
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unHmacLength = TSS_SHA1_DIGEST_SIZE;
+        memset(PrgbHMAC, 0, TSS_SHA1_DIGEST_SIZE);
+
+        // Check parameters
+        if (NULL == PrgbInputMessage || 0 == PusInputMessageSize || NULL == PrgbKey)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        if (NULL == HMAC(EVP_sha1(), PrgbKey, TSS_SHA1_DIGEST_SIZE, PrgbInputMessage, PusInputMessageSize, PrgbHMAC, &unHmacLength))
+            break;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+#endif
+
+/**
+ *  @brief      Calculate a digest with the incremental hash functions
+ *  @details
+ *
+ *  @param      PunAlgorithm            Hash algorithm.
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PunInputMessageSize     Input message size in bytes.
+ *  @param      PunDigestSize           Size of the digest buffer in bytes.
+ *  @param      PrgbDigest              Receives the digest.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PunInputMessageSize is 0.
+ */
+static
+unsigned int
+Crypt_Hash(
+    _In_                                unsigned int    PunAlgorithm,
+    _In_bytecount_(PunInputMessageSize) const BYTE*     PrgbInputMessage,
+    _In_                                unsigned int    PunInputMessageSize,
+    _In_                                unsigned int    PunDigestSize,
+    _Out_bytecap_(PunDigestSize)        BYTE*           PrgbDigest)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    CRYPT_HASH_CONTEXT sContext;
+
+    do
+    {
+        memset(PrgbDigest, 0, PunDigestSize);
+
+        // Check parameters
+        if (NULL == PrgbInputMessage || 0 == PunInputMessageSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnValue = Crypt_HashInit(&sContext, PunAlgorithm);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = Crypt_HashUpdate(&sContext, PrgbInputMessage, PunInputMessageSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = Crypt_HashFinal(&sContext, PunDigestSize, PrgbDigest);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Calculate SHA-1 on the given data
+ *  @details    This function calculates a SHA-1 hash on the given data stream.
+ *
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PusInputMessageSize     Input message size in bytes.
+ *  @param      PrgbSHA1                Receives the SHA-1.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PusInputMessageSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_SHA1(
+    _In_bytecount_(PusInputMessageSize)     const BYTE*     PrgbInputMessage,
+    _In_                                    const UINT16    PusInputMessageSize,
+    _Out_bytecap_(TSS_SHA1_DIGEST_SIZE)     BYTE            PrgbSHA1[TSS_SHA1_DIGEST_SIZE])
+{
+    return Crypt_Hash(CRYPT_HASH_ALGORITHM_SHA1, PrgbInputMessage, PusInputMessageSize, TSS_SHA1_DIGEST_SIZE, PrgbSHA1);
+}
+
+/**
+ *  @brief      Calculate SHA-256 on the given data
+ *  @details    This function calculates a SHA-256 hash on the given data stream.
+ *
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PunInputMessageSize     Input message size in bytes.
+ *  @param      PrgbSHA256              Receives the SHA-256.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PunInputMessageSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_SHA256(
+    _In_bytecount_(PunInputMessageSize)     const BYTE*         PrgbInputMessage,
+    _In_                                    const unsigned int  PunInputMessageSize,
+    _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE                PrgbSHA256[TSS_SHA256_DIGEST_SIZE])
+{
+    return Crypt_Hash(CRYPT_HASH_ALGORITHM_SHA256, PrgbInputMessage, PunInputMessageSize, TSS_SHA256_DIGEST_SIZE, PrgbSHA256);
+}
+
+/**
+ *  @brief      Calculate SHA-384 on the given data
+ *  @details    This function calculates a SHA-384 hash on the given data stream.
+ *
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PunInputMessageSize     Input message size in bytes.
+ *  @param      PrgbSHA384              Receives the SHA-384.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PunInputMessageSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_SHA384(
+    _In_bytecount_(PunInputMessageSize)     const BYTE*         PrgbInputMessage,
+    _In_                                    const unsigned int  PunInputMessageSize,
+    _Out_bytecap_(TSS_SHA384_DIGEST_SIZE)   BYTE                PrgbSHA384[TSS_SHA384_DIGEST_SIZE])
+{
+    return Crypt_Hash(CRYPT_HASH_ALGORITHM_SHA384, PrgbInputMessage, PunInputMessageSize, TSS_SHA384_DIGEST_SIZE, PrgbSHA384);
+}
+
+/**
+ *  @brief      Calculate SHA-512 on the given data
+ *  @details    This function calculates a SHA-512 hash on the given data stream.
+ *
+ *  @param      PrgbInputMessage        Input message.
+ *  @param      PunInputMessageSize     Input message size in bytes.
+ *  @param      PrgbSHA512              Receives the SHA-512.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbInputMessage is NULL or PunInputMessageSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_SHA512(
+    _In_bytecount_(PunInputMessageSize)     const BYTE*         PrgbInputMessage,
+    _In_                                    const unsigned int  PunInputMessageSize,
+    _Out_bytecap_(TSS_SHA512_DIGEST_SIZE)   BYTE                PrgbSHA512[TSS_SHA512_DIGEST_SIZE])
+{
+    return Crypt_Hash(CRYPT_HASH_ALGORITHM_SHA512, PrgbInputMessage, PunInputMessageSize, TSS_SHA512_DIGEST_SIZE, PrgbSHA512);
+}
+
+/**
+ *  @brief      Start an incremental hash calculation
+ *  @details    This function initializes the given caller-owned hash context for the given algorithm. A context which
+ *              has been used before can be passed again, any running calculation in it is discarded.
+ *
+ *  @param      PpsContext              Hash context to initialize.
+ *  @param      PunAlgorithm            Hash algorithm (CRYPT_HASH_ALGORITHM_SHA1, _SHA256, _SHA384 or _SHA512).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or PunAlgorithm is unknown.
+ */
+_Check_return_
+unsigned int
+Crypt_HashInit(
+    _Out_   CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_    unsigned int            PunAlgorithm)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        size_t unCtxSize = 0;
+        int nInitialized = 0;
+
+        // Check parameters
+        if (NULL == PpsContext)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        PpsContext->unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+
+        switch (PunAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                unCtxSize = sizeof(SHA_CTX);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                unCtxSize = sizeof(SHA256_CTX);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+            case CRYPT_HASH_ALGORITHM_SHA512:
+                unCtxSize = sizeof(SHA512_CTX);
+                break;
+            default:
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+        }
+        if (RC_E_BAD_PARAMETER == unReturnValue)
+            break;
+
+        // The crypto library state must fit into the context
+        if (unCtxSize > sizeof(PpsContext->rgullState))
+            break;
+
+        memset(PpsContext->rgullState, 0, sizeof(PpsContext->rgullState));
+        switch (PunAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                nInitialized = SHA1_Init((SHA_CTX*)PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                nInitialized = SHA256_Init((SHA256_CTX*)PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                nInitialized = SHA384_Init((SHA512_CTX*)PpsContext->rgullState);
+                break;
+            default:
+                nInitialized = SHA512_Init((SHA512_CTX*)PpsContext->rgullState);
+                break;
+        }
+        if (1 != nInitialized)
+            break;
+
+        PpsContext->unAlgorithm = PunAlgorithm;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Add data to an incremental hash calculation
+ *  @details    This function hashes the given data into the running calculation of the hash context. It can be called
+ *              any number of times between Crypt_HashInit and Crypt_HashFinal. Empty data is accepted and ignored.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PrgbData                Data to hash.
+ *  @param      PunDataSize             Data size in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or has no running calculation or PrgbData is NULL and PunDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_HashUpdate(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        int nUpdated = 0;
+
+        // Check parameters
+        if (NULL == PpsContext || CRYPT_HASH_ALGORITHM_NONE == PpsContext->unAlgorithm || (NULL == PrgbData && 0 != PunDataSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (0 == PunDataSize)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                nUpdated = SHA1_Update((SHA_CTX*)PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                nUpdated = SHA256_Update((SHA256_CTX*)PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                nUpdated = SHA384_Update((SHA512_CTX*)PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA512:
+                nUpdated = SHA512_Update((SHA512_CTX*)PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            default:
+                break;
+        }
+        if (1 != nUpdated)
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Finish an incremental hash calculation
+ *  @details    This function returns the digest of the running calculation of the hash context. Afterwards the context
+ *              has no running calculation until it is passed to Crypt_HashInit again.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PunDigestSize           Size of the digest buffer in bytes. Must be at least the digest size of the algorithm.
+ *  @param      PrgbDigest              Receives the digest.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext or PrgbDigest is NULL or PpsContext has no running calculation.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PunDigestSize is smaller than the digest size of the algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashFinal(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_                            unsigned int            PunDigestSize,
+    _Out_bytecap_(PunDigestSize)    BYTE*                   PrgbDigest)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unDigestSize = 0;
+        int nFinalized = 0;
+
+        // Check parameters
+        if (NULL == PpsContext || NULL == PrgbDigest || CRYPT_HASH_ALGORITHM_NONE == PpsContext->unAlgorithm)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                unDigestSize = TSS_SHA1_DIGEST_SIZE;
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                unDigestSize = TSS_SHA256_DIGEST_SIZE;
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                unDigestSize = TSS_SHA384_DIGEST_SIZE;
+                break;
+            default:
+                unDigestSize = TSS_SHA512_DIGEST_SIZE;
+                break;
+        }
+        if (PunDigestSize < unDigestSize)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        memset(PrgbDigest, 0, PunDigestSize);
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                nFinalized = SHA1_Final(PrgbDigest, (SHA_CTX*)PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                nFinalized = SHA256_Final(PrgbDigest, (SHA256_CTX*)PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                nFinalized = SHA384_Final(PrgbDigest, (SHA512_CTX*)PpsContext->rgullState);
+                break;
+            default:
+                nFinalized = SHA512_Final(PrgbDigest, (SHA512_CTX*)PpsContext->rgullState);
+                break;
+        }
+
+        // The calculation is finished in any case, a new one has to be started with Crypt_HashInit
+        PpsContext->unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+        if (1 != nFinalized)
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Calculate the digests of several byte ranges of a data stream in one pass
+ *  @details    The data is walked once in chunks. While a chunk is in the cache it is added to the CRC and to the hash
+ *              calculation of each range overlapping it, so the memory is read only once for all digests.
+ *
+ *  @param      PrgbData                Data stream.
+ *  @param      PunDataSize             Size of the data stream in bytes. All ranges must lie within the data stream.
+ *  @param      PrgsRanges              Ranges to hash. The digests are written to the buffers given in the ranges.
+ *  @param      PunRangeCount           Number of ranges (not more than CRYPT_HASH_RANGES_MAX).
+ *  @param      PpunCRC                 Receives the CRC value of the whole data stream. NULL to skip the CRC.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbData is NULL, a range does not lie within the data stream or has no digest buffer or PunRangeCount is too large.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The digest buffer of a range is smaller than the digest size of its algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashRanges(
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize,
+    _Inout_count_(PunRangeCount)    CRYPT_HASH_RANGE*       PrgsRanges,
+    _In_                            unsigned int            PunRangeCount,
+    _Out_opt_                       unsigned int*           PpunCRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        CRYPT_HASH_CONTEXT rgsContexts[CRYPT_HASH_RANGES_MAX];
+        unsigned int unOffset = 0;
+        unsigned int unIndex = 0;
+
+        // Check parameters
+        if (NULL == PrgbData || PunRangeCount > CRYPT_HASH_RANGES_MAX || (NULL == PrgsRanges && 0 != PunRangeCount))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            if (NULL == PrgsRanges[unIndex].pbDigest ||
+                    PrgsRanges[unIndex].unOffset > PunDataSize ||
+                    PrgsRanges[unIndex].unSize > PunDataSize - PrgsRanges[unIndex].unOffset)
+                break;
+        }
+        if (unIndex < PunRangeCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (NULL != PpunCRC)
+            *PpunCRC = 0;
+
+        unReturnValue = RC_SUCCESS;
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            rgsContexts[unIndex].unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+            memset(PrgsRanges[unIndex].pbDigest, 0, PrgsRanges[unIndex].unDigestSize);
+            if (0 == PrgsRanges[unIndex].unSize)
+                continue;
+            unReturnValue = Crypt_HashInit(&rgsContexts[unIndex], PrgsRanges[unIndex].unAlgorithm);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        while (unOffset < PunDataSize)
+        {
+            unsigned int unChunkSize = PunDataSize - unOffset;
+            unsigned int unChunkEnd = 0;
+            if (unChunkSize > CRYPT_HASH_RANGES_CHUNK_SIZE)
+                unChunkSize = CRYPT_HASH_RANGES_CHUNK_SIZE;
+            unChunkEnd = unOffset + unChunkSize;
+
+            if (NULL != PpunCRC)
+            {
+                unReturnValue = Crypt_CRCUpdate(PrgbData + unOffset, unChunkSize, PpunCRC);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+            }
+
+            // Add the part of each range within the chunk
+            for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+            {
+                unsigned int unRangeEnd = PrgsRanges[unIndex].unOffset + PrgsRanges[unIndex].unSize;
+                unsigned int unStart = 0;
+                unsigned int unEnd = 0;
+                if (0 == PrgsRanges[unIndex].unSize || unOffset >= unRangeEnd || unChunkEnd <= PrgsRanges[unIndex].unOffset)
+                    continue;
+
+                unStart = unOffset > PrgsRanges[unIndex].unOffset ? unOffset : PrgsRanges[unIndex].unOffset;
+                unEnd = unChunkEnd < unRangeEnd ? unChunkEnd : unRangeEnd;
+                unReturnValue = Crypt_HashUpdate(&rgsContexts[unIndex], PrgbData + unStart, unEnd - unStart);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+            }
+            if (RC_SUCCESS != unReturnValue)
+                break;
+
+            unOffset = unChunkEnd;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            if (0 == PrgsRanges[unIndex].unSize)
+                continue;
+            unReturnValue = Crypt_HashFinal(&rgsContexts[unIndex], PrgsRanges[unIndex].unDigestSize, PrgsRanges[unIndex].pbDigest);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Seed the pseudo random number generator
+ *  @details    OpenSSL seeds its generator from the operating system, the given seed is added as additional input.
+ *
+ *  @param      PrgbSeed                Seed.
+ *  @param      PusSeedSize             Seed size in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbSeed is NULL and PusSeedSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_SeedRandom(
+    _In_bytecount_(PusSeedSize) const BYTE*     PrgbSeed,
+    _In_                        const UINT16    PusSeedSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        if (NULL == PrgbSeed && 0 != PusSeedSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        if (0 != PusSeedSize)
+            RAND_seed(PrgbSeed, PusSeedSize);
+        if (1 != RAND_status())
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Get random bytes from the pseudo random number generator
+ *  @details    This function gets random bytes from the pseudo random number generator.
+ *
+ *  @param      PusRandomSize           Number of bytes requested.
+ *  @param      PrgbRandom              Receives pseudo random bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbRandom is NULL or PusRandomSize is 0.
+ */
+_Check_return_
+unsigned int
+Crypt_GetRandom(
+    _In_                            const UINT16    PusRandomSize,
+    _Out_bytecap_(PusRandomSize)    BYTE*           PrgbRandom)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        // Check input parameters
+        if (NULL == PrgbRandom || 0 == PusRandomSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        if (1 != RAND_bytes(PrgbRandom, PusRandomSize))
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+/**
+ *  @brief      Encrypt a byte array with a RSA 2048-bit public key
+ *  @details    This function encrypts the given data stream with RSA 2048-bit.
+ *
+ *  @param      PusEncryptionScheme             Encryption scheme. Only CRYPT_ES_RSAESOAEP_SHA1_MGF1 is supported.
+ *  @param      PunInputDataSize                Size of input data in bytes.
+ *  @param      PrgbInputData                   Input data buffer.
+ *  @param      PunPublicModulusSize            Size of public modulus in bytes.
+ *  @param      PrgbPublicModulus               Public modulus buffer.
+ *  @param      PunPublicExponentSize           Size of public exponent in bytes.
+ *  @param      PrgbPublicExponent              Public exponent buffer.
+ *  @param      PunLabelSize                    Size of label in bytes.
+ *  @param      PrgbLabel                       Label buffer.
+ *  @param      PpunEncryptedDataSize           In: Size of buffer for encrypted data in bytes
+ *                                              Out: Size of encrypted data in bytes
+ *  @param      PrgbEncryptedData               Encrypted data buffer.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred during RSA functionality.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. It was NULL or empty.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   In case of PrgbEncryptedData is too small.
+ *  @retval     RC_E_INTERNAL           In case of a not supported padding schema.
+ */
+_Check_return_
+unsigned int
+Crypt_EncryptRSA(
+    _In_                                        CRYPT_ENC_SCHEME    PusEncryptionScheme,
+    _In_                                        unsigned int        PunInputDataSize,
+    _In_bytecount_(PunInputDataSize)            const BYTE*         PrgbInputData,
+    _In_                                        unsigned int        PunPublicModulusSize,
+    _In_bytecount_(PunPublicModulusSize)        const BYTE*         PrgbPublicModulus,
+    _In_                                        unsigned int        PunPublicExponentSize,
+    _In_bytecount_(PunPublicExponentSize)       const BYTE*         PrgbPublicExponent,
+    _In_                                        unsigned int        PunLabelSize,
+    _In_bytecount_(PunLabelSize)                const BYTE*         PrgbLabel,
+    _Inout_                                     unsigned int*       PpunEncryptedDataSize,
+    _Inout_bytecap_(*PpunEncryptedDataSize)     BYTE*               PrgbEncryptedData)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    RSA* pRsaPublicKey = NULL;
+
+    do
+    {
+        BYTE rgbPaddedBuffer[RSA2048_MODULUS_SIZE];
+        int nEncrypted = 0;
+        memset(rgbPaddedBuffer, 0, sizeof(rgbPaddedBuffer));
+
+        // Check parameter
+        if (NULL == PrgbInputData || 0 == PunInputDataSize ||
+                NULL == PrgbPublicModulus || 0 == PunPublicModulusSize ||
+                NULL == PrgbPublicExponent || 0 == PunPublicExponentSize ||
+                NULL == PrgbLabel || 0 == PunLabelSize ||
+                NULL == PrgbEncryptedData || 0 == PpunEncryptedDataSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        if (CRYPT_ES_RSAESOAEP_SHA1_MGF1 != PusEncryptionScheme)
+        {
+            unReturnValue = RC_E_INTERNAL;
+            break;
+        }
+
+        if (*PpunEncryptedDataSize < RSA2048_MODULUS_SIZE)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        pRsaPublicKey = Crypt_CreatePublicKey(PrgbPublicModulus, PunPublicModulusSize, PrgbPublicExponent, PunPublicExponentSize);
+        if (NULL == pRsaPublicKey)
+            break;
+
+        // Add the OAEP padding with the TPM1.2 label, like the UEFI implementation does
+        if (1 != RSA_padding_add_PKCS1_OAEP(rgbPaddedBuffer, sizeof(rgbPaddedBuffer), PrgbInputData, (int)PunInputDataSize, s_rgbOaepLabel, sizeof(s_rgbOaepLabel)))
+            break;
+
+        // Encrypt data with public key.
+        nEncrypted = RSA_public_encrypt(sizeof(rgbPaddedBuffer), rgbPaddedBuffer, PrgbEncryptedData, pRsaPublicKey, RSA_NO_PADDING);
+        if (nEncrypted <= 0)
+            break;
+
+        *PpunEncryptedDataSize = (unsigned int)nEncrypted;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    RSA_free(pRsaPublicKey);
+
+    return unReturnValue;
+}
+#endif
+
+/**
+ *  @brief      Verify the given RSA PKCS#1 RSASSA-PSS signature
+ *  @details    This function verifies the given RSA PKCS#1 RSASSA-PSS signature with a RSA 2048-bit public key.
+ *
+ *  @param      PrgbMessageHash         Message hash buffer.
+ *  @param      PunMessageHashSize      Size of message hash buffer.
+ *  @param      PrgbSignature           Signature buffer.
+ *  @param      PunSignatureSize        Size of the signature buffer.
+ *  @param      PrgbModulus             Public modulus buffer.
+ *  @param      PunModulusSize          Size of public modulus buffer.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred during RSA functionality.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. An input parameter is NULL or empty.
+ *  @retval     RC_E_VERIFY_SIGNATURE   In case the signature is invalid.
+ */
+_Check_return_
+unsigned int
+Crypt_VerifySignature(
+    _In_bytecount_(PunMessageHashSize)  const BYTE*         PrgbMessageHash,
+    _In_                                const unsigned int  PunMessageHashSize,
+    _In_bytecount_(PunSignatureSize)    const BYTE*         PrgbSignature,
+    _In_                                const unsigned int  PunSignatureSize,
+    _In_bytecount_(PunModulusSize)      const BYTE*         PrgbModulus,
+    _In_                                const unsigned int  PunModulusSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    RSA* pRsaPublicKey = NULL;
+
+    do
+    {
+        BYTE rgbDecryptedDigest[RSA2048_MODULUS_SIZE];
+        memset(rgbDecryptedDigest, 0, sizeof(rgbDecryptedDigest));
+
+        // Check parameter
+        if (NULL == PrgbMessageHash || 0 == PunMessageHashSize ||
+                NULL == PrgbSignature || 0 == PunSignatureSize ||
+                NULL == PrgbModulus || 0 == PunModulusSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnValue = RC_E_VERIFY_SIGNATURE;
+        if (TSS_SHA256_DIGEST_SIZE != PunMessageHashSize || RSA2048_MODULUS_SIZE != PunSignatureSize || RSA2048_MODULUS_SIZE != PunModulusSize)
+            break;
+
+        pRsaPublicKey = Crypt_CreatePublicKey(PrgbModulus, PunModulusSize, RSA_DEFAULT_PUB_EXPONENT, sizeof(RSA_DEFAULT_PUB_EXPONENT));
+        if (NULL == pRsaPublicKey)
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+
+        if (-1 == RSA_public_decrypt((int)PunSignatureSize, PrgbSignature, rgbDecryptedDigest, pRsaPublicKey, RSA_NO_PADDING))
+            break;
+
+        // Verify the signature
+        if (1 != RSA_verify_PKCS1_PSS(pRsaPublicKey, PrgbMessageHash, EVP_sha256(), rgbDecryptedDigest, CRYPT_PSS_PADDING_SALT_SIZE))
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    RSA_free(pRsaPublicKey);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Build the CRC lookup tables
+ *  @details    Called by Crypt_CRCUpdate on the first call.
+ */
+static
+void
+Crypt_CRCInitialize()
+{
+    unsigned int unEntry = 0;
+    unsigned int unTable = 0;
+
+    for (unEntry = 0; unEntry < RG_LEN(s_rgunCrcTable[0]); unEntry++)
+    {
+        unsigned int unValue = unEntry;
+        unsigned int unBit = 0;
+        for (unBit = 0; unBit < 8; unBit++)
+            unValue = (unValue & 1) ? (CRYPT_CRC32_POLYNOMIAL ^ (unValue >> 1)) : (unValue >> 1);
+        s_rgunCrcTable[0][unEntry] = unValue;
+    }
+    for (unTable = 1; unTable < RG_LEN(s_rgunCrcTable); unTable++)
+    {
+        for (unEntry = 0; unEntry < RG_LEN(s_rgunCrcTable[0]); unEntry++)
+        {
+            unsigned int unValue = s_rgunCrcTable[unTable - 1][unEntry];
+            s_rgunCrcTable[unTable][unEntry] = s_rgunCrcTable[0][unValue & 0xFF] ^ (unValue >> 8);
+        }
+    }
+
+    s_fCrcTableInitialized = TRUE;
+}
+
+/**
+ *  @brief      Calculate the CRC value of the given data stream
+ *  @details    The function calculates the CRC32 value of a data stream. The result is the same as the one of the
+ *              CalculateCrc32 boot service.
+ *
+ *  @param      PpInputData         Data stream for CRC calculation.
+ *  @param      PnInputDataSize     Size if data to calculate the CRC.
+ *  @param      PpunCRC             Calculated CRC value.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_FAIL           An unexpected error occurred during CRC calculation.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. It was NULL or empty.
+ */
+_Check_return_
+unsigned int
+Crypt_CRC(
+    _In_bytecount_(PnInputDataSize) const void*     PpInputData,
+    _In_                            int             PnInputDataSize,
+    _Inout_                         unsigned int*   PpunCRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameter
+        if (NULL == PpInputData || 0 >= PnInputDataSize || NULL == PpunCRC)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        *PpunCRC = 0;
+        unReturnValue = Crypt_CRCUpdate(PpInputData, (unsigned int)PnInputDataSize, PpunCRC);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Continue a CRC calculation with the next part of a data stream
+ *  @details    The function updates a running CRC32 value with the given data. Starting with a CRC value of 0 and
+ *              passing all parts of a data stream in order results in the same value as Crypt_CRC on the whole stream.
+ *              The calculation processes eight bytes per step with lookup tables (slicing-by-8), which are built on the
+ *              first call.
+ *
+ *  @param      PpInputData         Next part of the data stream.
+ *  @param      PunInputDataSize    Size of the data in bytes.
+ *  @param      PpunCRC             In: CRC value of the preceding data (0 at the start of the stream).\n
+ *                                  Out: CRC value including the given data.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. PpunCRC is NULL or PpInputData is NULL and PunInputDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_CRCUpdate(
+    _In_bytecount_(PunInputDataSize)    const void*     PpInputData,
+    _In_                                unsigned int    PunInputDataSize,
+    _Inout_                             unsigned int*   PpunCRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        const BYTE* pbData = (const BYTE*)PpInputData;
+        unsigned int unCRC = 0;
+
+        // Check parameter
+        if (NULL == PpunCRC || (NULL == PpInputData && 0 != PunInputDataSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        if (!s_fCrcTableInitialized)
+            Crypt_CRCInitialize();
+
+        unCRC = ~(*PpunCRC);
+        while (PunInputDataSize >= 8)
+        {
+            unsigned int unLow = unCRC ^ ((unsigned int)pbData[0] | ((unsigned int)pbData[1] << 8) | ((unsigned int)pbData[2] << 16) | ((unsigned int)pbData[3] << 24));
+            unsigned int unHigh = (unsigned int)pbData[4] | ((unsigned int)pbData[5] << 8) | ((unsigned int)pbData[6] << 16) | ((unsigned int)pbData[7] << 24);
+            unCRC = s_rgunCrcTable[7][unLow & 0xFF] ^ s_rgunCrcTable[6][(unLow >> 8) & 0xFF] ^
+                    s_rgunCrcTable[5][(unLow >> 16) & 0xFF] ^ s_rgunCrcTable[4][unLow >> 24] ^
+                    s_rgunCrcTable[3][unHigh & 0xFF] ^ s_rgunCrcTable[2][(unHigh >> 8) & 0xFF] ^
+                    s_rgunCrcTable[1][(unHigh >> 16) & 0xFF] ^ s_rgunCrcTable[0][unHigh >> 24];
+            pbData += 8;
+            PunInputDataSize -= 8;
+        }
+        while (PunInputDataSize > 0)
+        {
+            unCRC = s_rgunCrcTable[0][(unCRC ^ *pbData) & 0xFF] ^ (unCRC >> 8);
+            pbData++;
+            PunInputDataSize--;
+        }
+        *PpunCRC = ~unCRC;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Initialize the crypto module
+ *  @details    Builds the CRC lookup tables. Must be called before any calculation is started on another thread.
+ */
+void
+Crypt_Initialize()
+{
+    if (!s_fCrcTableInitialized)
+        Crypt_CRCInitialize();
+}
+
+/**
+ *  @brief      Uninitialize the crypto module
+ *  @details    Nothing to release on Linux, the RSA key objects are not cached.
+ */
+void
+Crypt_Uninitialize()
+{
+}
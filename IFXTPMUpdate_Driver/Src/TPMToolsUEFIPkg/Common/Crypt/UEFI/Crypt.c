@@ -20,6 +20,402 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/CryptFncIfx.h>
 
+#if defined(MDE_CPU_X64)
+#include <Library/BaseLib.h>    // AsmCpuid
+#include <immintrin.h>          // _mm_clmulepi64_si128, _mm_sha256rnds2_epu32
+#if defined(__GNUC__)
+/// Allows the carry-less multiplication intrinsics in a function without enabling them for the whole module
+#define CRYPT_CRC_TARGET_CLMUL __attribute__((target("pclmul,sse2")))
+/// Allows the SHA extension intrinsics in a function without enabling them for the whole module
+#define CRYPT_SHA256_TARGET_CPU __attribute__((target("sha,ssse3,sse4.1")))
+#else
+#define CRYPT_CRC_TARGET_CLMUL
+#define CRYPT_SHA256_TARGET_CPU
+#endif
+#endif
+
+/// Reflected CRC32 polynomial (IEEE 802.3) as used by the CalculateCrc32 boot service
+#define CRYPT_CRC32_POLYNOMIAL  0xEDB88320
+
+/// Minimum number of bytes processed with the CRC32 instructions of the CPU, shorter data is processed with the tables
+#define CRYPT_CRC_CPU_MIN_SIZE  64
+
+/// Lookup tables for the slicing-by-8 calculation in Crypt_CRCUpdate. Table n holds the CRC of a byte followed by n zero bytes.
+static unsigned int s_rgunCrcTable[8][256];
+
+/// Flag indicating whether s_rgunCrcTable has been built and s_fCrcCpuSupport has been detected
+static BOOL s_fCrcTableInitialized = FALSE;
+
+/// Flag indicating the CPU provides instructions for the CRC32 calculation (CRC32 on AArch64, PCLMULQDQ on X64)
+static BOOL s_fCrcCpuSupport = FALSE;
+
+/// Number of bytes processed per step of Crypt_HashRanges. A chunk stays in the cache while it is added to all ranges.
+#define CRYPT_HASH_RANGES_CHUNK_SIZE    4096
+
+/// Hash algorithm identifier of a SHA-256 calculation with the SHA-256 instructions of the CPU (only used within this module)
+#define CRYPT_HASH_ALGORITHM_SHA256_CPU 0x102
+
+/// Size of a SHA-256 message block in bytes
+#define CRYPT_SHA256_BLOCK_SIZE 64
+
+/**
+ *  @brief      State of a SHA-256 calculation with the SHA-256 instructions of the CPU
+ *  @details    Placed in the hash state buffer of CRYPT_HASH_CONTEXT.
+ */
+typedef struct tdCRYPT_SHA256_CPU_STATE
+{
+    /// Intermediate hash value
+    UINT32 rgunHash[8];
+    /// Message bytes which do not fill a block yet
+    BYTE rgbBlock[CRYPT_SHA256_BLOCK_SIZE];
+    /// Number of bytes in rgbBlock
+    unsigned int unBlockSize;
+    /// Number of message bytes hashed so far
+    UINT64 ullMessageSize;
+} CRYPT_SHA256_CPU_STATE;
+
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+/// SHA-256 round constants (FIPS 180-4, 4.2.2)
+static const UINT32 s_rgunSha256K[64] =
+{
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/// SHA-256 initial hash value (FIPS 180-4, 5.3.3)
+static const UINT32 s_rgunSha256InitialHash[8] =
+{
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+#endif
+
+/// Flag indicating whether s_fSha256CpuSupport has been detected
+static BOOL s_fSha256Initialized = FALSE;
+
+/// Flag indicating the SHA-256 instructions of the CPU are available and have passed the self-test
+static BOOL s_fSha256CpuSupport = FALSE;
+
+/// Flag indicating whether the pseudo random number generator has been seeded
+static BOOL s_fRandomSeeded = FALSE;
+
+#if defined(MDE_CPU_X64)
+/**
+ *  @brief      Hash message blocks with the SHA extensions
+ *  @details    Four rounds are calculated per step. The state is kept in the ABEF/CDGH layout of SHA256RNDS2.
+ *
+ *  @param      PrgunHash           Intermediate hash value.
+ *  @param      PrgbData            Message blocks.
+ *  @param      PunBlocks           Number of message blocks (at least 1).
+ */
+static
+CRYPT_SHA256_TARGET_CPU
+void
+Crypt_SHA256TransformCpu(
+    _Inout_updates_(8)                                      UINT32          PrgunHash[8],
+    _In_bytecount_(PunBlocks * CRYPT_SHA256_BLOCK_SIZE)     const BYTE*     PrgbData,
+    _In_                                                    unsigned int    PunBlocks)
+{
+    const __m128i sByteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+    __m128i sTemp = _mm_loadu_si128((const __m128i*)&PrgunHash[0]);
+    __m128i sState1 = _mm_loadu_si128((const __m128i*)&PrgunHash[4]);
+    __m128i sState0;
+
+    sTemp = _mm_shuffle_epi32(sTemp, 0xB1);             // CDAB
+    sState1 = _mm_shuffle_epi32(sState1, 0x1B);         // EFGH
+    sState0 = _mm_alignr_epi8(sTemp, sState1, 8);       // ABEF
+    sState1 = _mm_blend_epi16(sState1, sTemp, 0xF0);    // CDGH
+
+    while (PunBlocks > 0)
+    {
+        __m128i rgsMessage[4];
+        __m128i sSavedState0 = sState0;
+        __m128i sSavedState1 = sState1;
+        unsigned int unGroup = 0;
+
+        for (unGroup = 0; unGroup < 16; unGroup++)
+        {
+            __m128i sRounds;
+
+            // Message words unGroup * 4 to unGroup * 4 + 3
+            if (unGroup < 4)
+                rgsMessage[unGroup] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(PrgbData + unGroup * 16)), sByteSwap);
+            else
+            {
+                __m128i sMessage = _mm_sha256msg1_epu32(rgsMessage[unGroup & 3], rgsMessage[(unGroup + 1) & 3]);
+                sMessage = _mm_add_epi32(sMessage, _mm_alignr_epi8(rgsMessage[(unGroup + 3) & 3], rgsMessage[(unGroup + 2) & 3], 4));
+                rgsMessage[unGroup & 3] = _mm_sha256msg2_epu32(sMessage, rgsMessage[(unGroup + 3) & 3]);
+            }
+
+            sRounds = _mm_add_epi32(rgsMessage[unGroup & 3], _mm_loadu_si128((const __m128i*)&s_rgunSha256K[unGroup * 4]));
+            sState1 = _mm_sha256rnds2_epu32(sState1, sState0, sRounds);
+            sRounds = _mm_shuffle_epi32(sRounds, 0x0E);
+            sState0 = _mm_sha256rnds2_epu32(sState0, sState1, sRounds);
+        }
+
+        sState0 = _mm_add_epi32(sState0, sSavedState0);
+        sState1 = _mm_add_epi32(sState1, sSavedState1);
+        PrgbData += CRYPT_SHA256_BLOCK_SIZE;
+        PunBlocks--;
+    }
+
+    sTemp = _mm_shuffle_epi32(sState0, 0x1B);           // FEBA
+    sState1 = _mm_shuffle_epi32(sState1, 0xB1);         // DCHG
+    sState0 = _mm_blend_epi16(sTemp, sState1, 0xF0);    // DCBA
+    sState1 = _mm_alignr_epi8(sState1, sTemp, 8);       // HGFE
+    _mm_storeu_si128((__m128i*)&PrgunHash[0], sState0);
+    _mm_storeu_si128((__m128i*)&PrgunHash[4], sState1);
+}
+#elif defined(MDE_CPU_AARCH64) && defined(__GNUC__)
+/// Four rounds with the message words in register W (v16: round constants, v4: ABCD, v5: EFGH, v6/v7: scratch)
+#define CRYPT_SHA256_CPU_ROUNDS(W) \
+    "ld1        {v16.4s}, [%[k]], #16\n\t" \
+    "add        v7.4s, " W ".4s, v16.4s\n\t" \
+    "mov        v6.16b, v4.16b\n\t" \
+    "sha256h    q4, q5, v7.4s\n\t" \
+    "sha256h2   q5, q6, v7.4s\n\t"
+
+/// Replace the message words in W0 with the next four words of the message schedule
+#define CRYPT_SHA256_CPU_SCHEDULE(W0, W1, W2, W3) \
+    "sha256su0  " W0 ".4s, " W1 ".4s\n\t" \
+    "sha256su1  " W0 ".4s, " W2 ".4s, " W3 ".4s\n\t"
+
+/**
+ *  @brief      Hash message blocks with the SHA-256 instructions of the ARMv8 cryptographic extension
+ *  @details    The function is written in inline assembly since the firmware is built without SIMD code generation.
+ *
+ *  @param      PrgunHash           Intermediate hash value.
+ *  @param      PrgbData            Message blocks.
+ *  @param      PunBlocks           Number of message blocks (at least 1).
+ */
+static
+void
+Crypt_SHA256TransformCpu(
+    _Inout_updates_(8)                                      UINT32          PrgunHash[8],
+    _In_bytecount_(PunBlocks * CRYPT_SHA256_BLOCK_SIZE)     const BYTE*     PrgbData,
+    _In_                                                    unsigned int    PunBlocks)
+{
+    const UINT32* punRoundConstant = NULL;
+
+    __asm__ volatile(
+        ".arch_extension crypto\n\t"
+        "ld1        {v4.4s, v5.4s}, [%[hash]]\n"
+        "1:\n\t"
+        "ld1        {v0.16b, v1.16b, v2.16b, v3.16b}, [%[data]], #64\n\t"
+        "mov        %[k], %[constants]\n\t"
+        "mov        v18.16b, v4.16b\n\t"
+        "mov        v19.16b, v5.16b\n\t"
+        "rev32      v0.16b, v0.16b\n\t"
+        "rev32      v1.16b, v1.16b\n\t"
+        "rev32      v2.16b, v2.16b\n\t"
+        "rev32      v3.16b, v3.16b\n\t"
+        CRYPT_SHA256_CPU_ROUNDS("v0") CRYPT_SHA256_CPU_SCHEDULE("v0", "v1", "v2", "v3")
+        CRYPT_SHA256_CPU_ROUNDS("v1") CRYPT_SHA256_CPU_SCHEDULE("v1", "v2", "v3", "v0")
+        CRYPT_SHA256_CPU_ROUNDS("v2") CRYPT_SHA256_CPU_SCHEDULE("v2", "v3", "v0", "v1")
+        CRYPT_SHA256_CPU_ROUNDS("v3") CRYPT_SHA256_CPU_SCHEDULE("v3", "v0", "v1", "v2")
+        CRYPT_SHA256_CPU_ROUNDS("v0") CRYPT_SHA256_CPU_SCHEDULE("v0", "v1", "v2", "v3")
+        CRYPT_SHA256_CPU_ROUNDS("v1") CRYPT_SHA256_CPU_SCHEDULE("v1", "v2", "v3", "v0")
+        CRYPT_SHA256_CPU_ROUNDS("v2") CRYPT_SHA256_CPU_SCHEDULE("v2", "v3", "v0", "v1")
+        CRYPT_SHA256_CPU_ROUNDS("v3") CRYPT_SHA256_CPU_SCHEDULE("v3", "v0", "v1", "v2")
+        CRYPT_SHA256_CPU_ROUNDS("v0") CRYPT_SHA256_CPU_SCHEDULE("v0", "v1", "v2", "v3")
+        CRYPT_SHA256_CPU_ROUNDS("v1") CRYPT_SHA256_CPU_SCHEDULE("v1", "v2", "v3", "v0")
+        CRYPT_SHA256_CPU_ROUNDS("v2") CRYPT_SHA256_CPU_SCHEDULE("v2", "v3", "v0", "v1")
+        CRYPT_SHA256_CPU_ROUNDS("v3") CRYPT_SHA256_CPU_SCHEDULE("v3", "v0", "v1", "v2")
+        CRYPT_SHA256_CPU_ROUNDS("v0")
+        CRYPT_SHA256_CPU_ROUNDS("v1")
+        CRYPT_SHA256_CPU_ROUNDS("v2")
+        CRYPT_SHA256_CPU_ROUNDS("v3")
+        "add        v4.4s, v4.4s, v18.4s\n\t"
+        "add        v5.4s, v5.4s, v19.4s\n\t"
+        "subs       %w[blocks], %w[blocks], #1\n\t"
+        "b.ne       1b\n\t"
+        "st1        {v4.4s, v5.4s}, [%[hash]]\n\t"
+        : [data] "+r"(PrgbData), [blocks] "+r"(PunBlocks), [k] "=&r"(punRoundConstant)
+        : [hash] "r"(PrgunHash), [constants] "r"(s_rgunSha256K)
+        : "v0", "v1", "v2", "v3", "v4", "v5", "v6", "v7", "v16", "v18", "v19", "cc", "memory");
+}
+#endif
+
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+/**
+ *  @brief      Start a SHA-256 calculation with the SHA-256 instructions of the CPU
+ *  @details
+ *
+ *  @param      PpsState            State to initialize.
+ */
+static
+void
+Crypt_SHA256CpuInit(
+    _Out_   CRYPT_SHA256_CPU_STATE* PpsState)
+{
+    SetMem(PpsState, sizeof(*PpsState), 0);
+    CopyMem(PpsState->rgunHash, s_rgunSha256InitialHash, sizeof(PpsState->rgunHash));
+}
+
+/**
+ *  @brief      Add data to a SHA-256 calculation with the SHA-256 instructions of the CPU
+ *  @details    Complete blocks are hashed directly from the data, only the remainder is buffered.
+ *
+ *  @param      PpsState            State of the calculation.
+ *  @param      PrgbData            Data to hash.
+ *  @param      PunDataSize         Data size in bytes.
+ */
+static
+void
+Crypt_SHA256CpuUpdate(
+    _Inout_                         CRYPT_SHA256_CPU_STATE* PpsState,
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize)
+{
+    PpsState->ullMessageSize += PunDataSize;
+
+    // Fill up a partial block first
+    if (0 != PpsState->unBlockSize)
+    {
+        unsigned int unSize = CRYPT_SHA256_BLOCK_SIZE - PpsState->unBlockSize;
+        if (unSize > PunDataSize)
+            unSize = PunDataSize;
+        CopyMem(&PpsState->rgbBlock[PpsState->unBlockSize], PrgbData, unSize);
+        PpsState->unBlockSize += unSize;
+        PrgbData += unSize;
+        PunDataSize -= unSize;
+        if (CRYPT_SHA256_BLOCK_SIZE != PpsState->unBlockSize)
+            return;
+        Crypt_SHA256TransformCpu(PpsState->rgunHash, PpsState->rgbBlock, 1);
+        PpsState->unBlockSize = 0;
+    }
+
+    if (PunDataSize >= CRYPT_SHA256_BLOCK_SIZE)
+    {
+        Crypt_SHA256TransformCpu(PpsState->rgunHash, PrgbData, PunDataSize / CRYPT_SHA256_BLOCK_SIZE);
+        PrgbData += PunDataSize & ~(CRYPT_SHA256_BLOCK_SIZE - 1);
+        PunDataSize &= CRYPT_SHA256_BLOCK_SIZE - 1;
+    }
+
+    if (0 != PunDataSize)
+    {
+        CopyMem(PpsState->rgbBlock, PrgbData, PunDataSize);
+        PpsState->unBlockSize = PunDataSize;
+    }
+}
+
+/**
+ *  @brief      Finish a SHA-256 calculation with the SHA-256 instructions of the CPU
+ *  @details    Pads the message (FIPS 180-4, 5.1.1) and returns the digest.
+ *
+ *  @param      PpsState            State of the calculation.
+ *  @param      PrgbDigest          Receives the digest.
+ */
+static
+void
+Crypt_SHA256CpuFinal(
+    _Inout_                                 CRYPT_SHA256_CPU_STATE* PpsState,
+    _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE                    PrgbDigest[TSS_SHA256_DIGEST_SIZE])
+{
+    UINT64 ullMessageBits = PpsState->ullMessageSize * 8;
+    unsigned int unIndex = 0;
+
+    PpsState->rgbBlock[PpsState->unBlockSize++] = 0x80;
+    if (PpsState->unBlockSize > CRYPT_SHA256_BLOCK_SIZE - sizeof(ullMessageBits))
+    {
+        SetMem(&PpsState->rgbBlock[PpsState->unBlockSize], CRYPT_SHA256_BLOCK_SIZE - PpsState->unBlockSize, 0);
+        Crypt_SHA256TransformCpu(PpsState->rgunHash, PpsState->rgbBlock, 1);
+        PpsState->unBlockSize = 0;
+    }
+    SetMem(&PpsState->rgbBlock[PpsState->unBlockSize], CRYPT_SHA256_BLOCK_SIZE - sizeof(ullMessageBits) - PpsState->unBlockSize, 0);
+    for (unIndex = 0; unIndex < sizeof(ullMessageBits); unIndex++)
+        PpsState->rgbBlock[CRYPT_SHA256_BLOCK_SIZE - 1 - unIndex] = (BYTE)(ullMessageBits >> (8 * unIndex));
+    Crypt_SHA256TransformCpu(PpsState->rgunHash, PpsState->rgbBlock, 1);
+
+    for (unIndex = 0; unIndex < RG_LEN(PpsState->rgunHash); unIndex++)
+    {
+        PrgbDigest[unIndex * 4] = (BYTE)(PpsState->rgunHash[unIndex] >> 24);
+        PrgbDigest[unIndex * 4 + 1] = (BYTE)(PpsState->rgunHash[unIndex] >> 16);
+        PrgbDigest[unIndex * 4 + 2] = (BYTE)(PpsState->rgunHash[unIndex] >> 8);
+        PrgbDigest[unIndex * 4 + 3] = (BYTE)PpsState->rgunHash[unIndex];
+    }
+    SetMem(PpsState, sizeof(*PpsState), 0);
+}
+#endif
+
+/**
+ *  @brief      Detect the SHA-256 instructions of the CPU and run the known-answer self-test
+ *  @details    The SHA-256 instructions are only used if the CPU provides them (SHA extensions on X64, ARMv8 cryptographic
+ *              extension on AArch64) and the self-test calculates the known digests of FIPS 180-4 example messages.
+ *              Otherwise SHA-256 is calculated by the crypto library.
+ */
+static
+void
+Crypt_SHA256Initialize()
+{
+    BOOL fCpuSupport = FALSE;
+
+#if defined(MDE_CPU_X64)
+    {
+        UINT32 unMaxLeaf = 0;
+        UINT32 unEbx = 0;
+        UINT32 unEcx = 0;
+
+        // CPUID.01H:ECX.SSSE3[bit 9] and SSE4_1[bit 19], CPUID.(EAX=07H,ECX=0):EBX.SHA[bit 29]
+        IGNORE_RETURN_VALUE(AsmCpuid(0, &unMaxLeaf, NULL, NULL, NULL));
+        IGNORE_RETURN_VALUE(AsmCpuid(1, NULL, NULL, &unEcx, NULL));
+        if (unMaxLeaf >= 7)
+            IGNORE_RETURN_VALUE(AsmCpuidEx(7, 0, NULL, &unEbx, NULL, NULL));
+        fCpuSupport = (0 != (unEcx & BIT9)) && (0 != (unEcx & BIT19)) && (0 != (unEbx & BIT29));
+    }
+#elif defined(MDE_CPU_AARCH64) && defined(__GNUC__)
+    {
+        // ID_AA64ISAR0_EL1.SHA2[bits 15:12]
+        UINT64 ullIsar0 = 0;
+        __asm__ volatile("mrs %0, id_aa64isar0_el1" : "=r"(ullIsar0));
+        fCpuSupport = (0 != ((ullIsar0 >> 12) & 0xF));
+    }
+#endif
+
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+    if (fCpuSupport)
+    {
+        // FIPS 180-4 examples: "abc" (one block) and the 448 bit message (two blocks), the latter hashed in two parts
+        static const BYTE rgbMessage1[] = "abc";
+        static const BYTE rgbMessage2[] = "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+        static const BYTE rgbDigest1[TSS_SHA256_DIGEST_SIZE] =
+        {
+            0xba, 0x78, 0x16, 0xbf, 0x8f, 0x01, 0xcf, 0xea, 0x41, 0x41, 0x40, 0xde, 0x5d, 0xae, 0x22, 0x23,
+            0xb0, 0x03, 0x61, 0xa3, 0x96, 0x17, 0x7a, 0x9c, 0xb4, 0x10, 0xff, 0x61, 0xf2, 0x00, 0x15, 0xad
+        };
+        static const BYTE rgbDigest2[TSS_SHA256_DIGEST_SIZE] =
+        {
+            0x24, 0x8d, 0x6a, 0x61, 0xd2, 0x06, 0x38, 0xb8, 0xe5, 0xc0, 0x26, 0x93, 0x0c, 0x3e, 0x60, 0x39,
+            0xa3, 0x3c, 0xe4, 0x59, 0x64, 0xff, 0x21, 0x67, 0xf6, 0xec, 0xed, 0xd4, 0x19, 0xdb, 0x06, 0xc1
+        };
+        CRYPT_SHA256_CPU_STATE sState;
+        BYTE rgbDigest[TSS_SHA256_DIGEST_SIZE];
+
+        Crypt_SHA256CpuInit(&sState);
+        Crypt_SHA256CpuUpdate(&sState, rgbMessage1, sizeof(rgbMessage1) - 1);
+        Crypt_SHA256CpuFinal(&sState, rgbDigest);
+        if (0 != CompareMem(rgbDigest, rgbDigest1, sizeof(rgbDigest)))
+            fCpuSupport = FALSE;
+
+        Crypt_SHA256CpuInit(&sState);
+        Crypt_SHA256CpuUpdate(&sState, rgbMessage2, 5);
+        Crypt_SHA256CpuUpdate(&sState, rgbMessage2 + 5, sizeof(rgbMessage2) - 1 - 5);
+        Crypt_SHA256CpuFinal(&sState, rgbDigest);
+        if (0 != CompareMem(rgbDigest, rgbDigest2, sizeof(rgbDigest)))
+            fCpuSupport = FALSE;
+    }
+#endif
+
+    s_fSha256CpuSupport = fCpuSupport;
+    s_fSha256Initialized = TRUE;
+}
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 /**
  *  @brief      Calculate HMAC-SHA-1 on the given message
  *  @details    This function calculates a HMAC-SHA-1 on the input message.
@@ -62,6 +458,7 @@ Crypt_HMAC(
 
     return unReturnValue;
 }
+#endif
 
 /**
  *  @brief      Calculate SHA-1 on the given data
@@ -84,6 +481,7 @@ Crypt_SHA1(
 {
     unsigned int unReturnValue = RC_E_FAIL;
     VOID* pSha1Ctx = NULL;
+    unsigned int unArenaMark = Platform_ArenaGetMark();
 
     do
     {
@@ -99,7 +497,7 @@ Crypt_SHA1(
 
         // Calculate SHA-1
         ullCtxSize = Sha1GetContextSize();
-        pSha1Ctx = AllocatePool(ullCtxSize);
+        pSha1Ctx = Platform_ArenaAllocateZero((unsigned int)ullCtxSize);
         if (NULL == pSha1Ctx)
             break;
         if (!Sha1Init(pSha1Ctx))
@@ -112,8 +510,9 @@ Crypt_SHA1(
     }
     WHILE_FALSE_END;
 
-    if (NULL != pSha1Ctx)
-        FreePool(pSha1Ctx);
+    // Release the hash context scratch memory
+    Platform_MemoryFree((void**)&pSha1Ctx);
+    Platform_ArenaRelease(unArenaMark);
 
     return unReturnValue;
 }
@@ -138,11 +537,10 @@ Crypt_SHA256(
     _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE            PrgbSHA256[TSS_SHA256_DIGEST_SIZE])
 {
     unsigned int unReturnValue = RC_E_FAIL;
-    VOID* pSha256Ctx = NULL;
+    CRYPT_HASH_CONTEXT sContext;
 
     do
     {
-        UINTN ullCtxSize = 0;
         SetMem(PrgbSHA256, TSS_SHA256_DIGEST_SIZE, 0);
 
         // Check parameters
@@ -152,24 +550,17 @@ Crypt_SHA256(
             break;
         }
 
-        // Calculate SHA-256
-        ullCtxSize = Sha256GetContextSize();
-        pSha256Ctx = AllocatePool(ullCtxSize);
-        if (NULL == pSha256Ctx)
-            break;
-        if (!Sha256Init(pSha256Ctx))
-            break;
-        if (!Sha256Update(pSha256Ctx, PrgbInputMessage, PunInputMessageSize))
+        // Calculate SHA-256 (with the SHA-256 instructions of the CPU if available)
+        unReturnValue = Crypt_HashInit(&sContext, CRYPT_HASH_ALGORITHM_SHA256);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        if (!Sha256Final(pSha256Ctx, PrgbSHA256))
+        unReturnValue = Crypt_HashUpdate(&sContext, PrgbInputMessage, PunInputMessageSize);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        unReturnValue = RC_SUCCESS;
+        unReturnValue = Crypt_HashFinal(&sContext, TSS_SHA256_DIGEST_SIZE, PrgbSHA256);
     }
     WHILE_FALSE_END;
 
-    if (NULL != pSha256Ctx)
-        FreePool(pSha256Ctx);
-
     return unReturnValue;
 }
 
@@ -194,6 +585,7 @@ Crypt_SHA384(
 {
     unsigned int unReturnValue = RC_E_FAIL;
     VOID* pSha384Ctx = NULL;
+    unsigned int unArenaMark = Platform_ArenaGetMark();
 
     do
     {
@@ -209,7 +601,7 @@ Crypt_SHA384(
 
         // Calculate SHA-384
         ullCtxSize = Sha384GetContextSize();
-        pSha384Ctx = AllocatePool(ullCtxSize);
+        pSha384Ctx = Platform_ArenaAllocateZero((unsigned int)ullCtxSize);
         if (NULL == pSha384Ctx)
             break;
         if (!Sha384Init(pSha384Ctx))
@@ -222,8 +614,9 @@ Crypt_SHA384(
     }
     WHILE_FALSE_END;
 
-    if (NULL != pSha384Ctx)
-        FreePool(pSha384Ctx);
+    // Release the hash context scratch memory
+    Platform_MemoryFree((void**)&pSha384Ctx);
+    Platform_ArenaRelease(unArenaMark);
 
     return unReturnValue;
 }
@@ -249,6 +642,7 @@ Crypt_SHA512(
 {
     unsigned int unReturnValue = RC_E_FAIL;
     VOID* pSha512Ctx = NULL;
+    unsigned int unArenaMark = Platform_ArenaGetMark();
 
     do
     {
@@ -264,7 +658,7 @@ Crypt_SHA512(
 
         // Calculate SHA-512
         ullCtxSize = Sha512GetContextSize();
-        pSha512Ctx = AllocatePool(ullCtxSize);
+        pSha512Ctx = Platform_ArenaAllocateZero((unsigned int)ullCtxSize);
         if (NULL == pSha512Ctx)
             break;
         if (!Sha512Init(pSha512Ctx))
@@ -277,8 +671,392 @@ Crypt_SHA512(
     }
     WHILE_FALSE_END;
 
-    if (NULL != pSha512Ctx)
-        FreePool(pSha512Ctx);
+    // Release the hash context scratch memory
+    Platform_MemoryFree((void**)&pSha512Ctx);
+    Platform_ArenaRelease(unArenaMark);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Start an incremental hash calculation
+ *  @details    This function initializes the given caller-owned hash context for the given algorithm. A context which
+ *              has been used before can be passed again, any running calculation in it is discarded.
+ *
+ *  @param      PpsContext              Hash context to initialize.
+ *  @param      PunAlgorithm            Hash algorithm (CRYPT_HASH_ALGORITHM_SHA1, _SHA256, _SHA384 or _SHA512).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or PunAlgorithm is unknown.
+ */
+_Check_return_
+unsigned int
+Crypt_HashInit(
+    _Out_   CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_    unsigned int            PunAlgorithm)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        UINTN ullCtxSize = 0;
+        BOOLEAN fInitialized = FALSE;
+
+        // Check parameters
+        if (NULL == PpsContext)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        PpsContext->unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+        if (CRYPT_HASH_ALGORITHM_SHA256 == PunAlgorithm)
+        {
+            if (!s_fSha256Initialized)
+                Crypt_SHA256Initialize();
+            if (s_fSha256CpuSupport)
+            {
+                Crypt_SHA256CpuInit((CRYPT_SHA256_CPU_STATE*)PpsContext->rgullState);
+                PpsContext->unAlgorithm = CRYPT_HASH_ALGORITHM_SHA256_CPU;
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+        }
+#endif
+
+        switch (PunAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                ullCtxSize = Sha1GetContextSize();
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                ullCtxSize = Sha256GetContextSize();
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                ullCtxSize = Sha384GetContextSize();
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA512:
+                ullCtxSize = Sha512GetContextSize();
+                break;
+            default:
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+        }
+        if (RC_E_BAD_PARAMETER == unReturnValue)
+            break;
+
+        // The crypto library state must fit into the context
+        if (0 == ullCtxSize || ullCtxSize > sizeof(PpsContext->rgullState))
+            break;
+
+        SetMem(PpsContext->rgullState, sizeof(PpsContext->rgullState), 0);
+        switch (PunAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                fInitialized = Sha1Init(PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                fInitialized = Sha256Init(PpsContext->rgullState);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                fInitialized = Sha384Init(PpsContext->rgullState);
+                break;
+            default:
+                fInitialized = Sha512Init(PpsContext->rgullState);
+                break;
+        }
+        if (!fInitialized)
+            break;
+
+        PpsContext->unAlgorithm = PunAlgorithm;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Add data to an incremental hash calculation
+ *  @details    This function hashes the given data into the running calculation of the hash context. It can be called
+ *              any number of times between Crypt_HashInit and Crypt_HashFinal. Empty data is accepted and ignored.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PrgbData                Data to hash.
+ *  @param      PunDataSize             Data size in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext is NULL or has no running calculation or PrgbData is NULL and PunDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_HashUpdate(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BOOLEAN fUpdated = FALSE;
+
+        // Check parameters
+        if (NULL == PpsContext || CRYPT_HASH_ALGORITHM_NONE == PpsContext->unAlgorithm || (NULL == PrgbData && 0 != PunDataSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (0 == PunDataSize)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                fUpdated = Sha1Update(PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                fUpdated = Sha256Update(PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                fUpdated = Sha384Update(PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA512:
+                fUpdated = Sha512Update(PpsContext->rgullState, PrgbData, PunDataSize);
+                break;
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+            case CRYPT_HASH_ALGORITHM_SHA256_CPU:
+                Crypt_SHA256CpuUpdate((CRYPT_SHA256_CPU_STATE*)PpsContext->rgullState, PrgbData, PunDataSize);
+                fUpdated = TRUE;
+                break;
+#endif
+            default:
+                break;
+        }
+        if (!fUpdated)
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Finish an incremental hash calculation
+ *  @details    This function returns the digest of the running calculation of the hash context. Afterwards the context
+ *              has no running calculation until it is passed to Crypt_HashInit again.
+ *
+ *  @param      PpsContext              Hash context initialized by Crypt_HashInit.
+ *  @param      PunDigestSize           Size of the digest buffer in bytes. Must be at least the digest size of the algorithm.
+ *  @param      PrgbDigest              Receives the digest.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsContext or PrgbDigest is NULL or PpsContext has no running calculation.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PunDigestSize is smaller than the digest size of the algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashFinal(
+    _Inout_                         CRYPT_HASH_CONTEXT*     PpsContext,
+    _In_                            unsigned int            PunDigestSize,
+    _Out_bytecap_(PunDigestSize)    BYTE*                   PrgbDigest)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unDigestSize = 0;
+        BOOLEAN fFinalized = FALSE;
+
+        // Check parameters
+        if (NULL == PpsContext || NULL == PrgbDigest || CRYPT_HASH_ALGORITHM_NONE == PpsContext->unAlgorithm)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                unDigestSize = TSS_SHA1_DIGEST_SIZE;
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+            case CRYPT_HASH_ALGORITHM_SHA256_CPU:
+                unDigestSize = TSS_SHA256_DIGEST_SIZE;
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                unDigestSize = TSS_SHA384_DIGEST_SIZE;
+                break;
+            default:
+                unDigestSize = TSS_SHA512_DIGEST_SIZE;
+                break;
+        }
+        if (PunDigestSize < unDigestSize)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        SetMem(PrgbDigest, PunDigestSize, 0);
+
+        switch (PpsContext->unAlgorithm)
+        {
+            case CRYPT_HASH_ALGORITHM_SHA1:
+                fFinalized = Sha1Final(PpsContext->rgullState, PrgbDigest);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA256:
+                fFinalized = Sha256Final(PpsContext->rgullState, PrgbDigest);
+                break;
+            case CRYPT_HASH_ALGORITHM_SHA384:
+                fFinalized = Sha384Final(PpsContext->rgullState, PrgbDigest);
+                break;
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+            case CRYPT_HASH_ALGORITHM_SHA256_CPU:
+                Crypt_SHA256CpuFinal((CRYPT_SHA256_CPU_STATE*)PpsContext->rgullState, PrgbDigest);
+                fFinalized = TRUE;
+                break;
+#endif
+            default:
+                fFinalized = Sha512Final(PpsContext->rgullState, PrgbDigest);
+                break;
+        }
+
+        // The calculation is finished in any case, a new one has to be started with Crypt_HashInit
+        PpsContext->unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+        if (!fFinalized)
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Calculate the digests of several byte ranges of a data stream in one pass
+ *  @details    The data is walked once in chunks. While a chunk is in the cache it is added to the CRC and to the hash
+ *              calculation of each range overlapping it, so the memory is read only once for all digests.
+ *
+ *  @param      PrgbData                Data stream.
+ *  @param      PunDataSize             Size of the data stream in bytes. All ranges must lie within the data stream.
+ *  @param      PrgsRanges              Ranges to hash. The digests are written to the buffers given in the ranges.
+ *  @param      PunRangeCount           Number of ranges (not more than CRYPT_HASH_RANGES_MAX).
+ *  @param      PpunCRC                 Receives the CRC value of the whole data stream. NULL to skip the CRC.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbData is NULL, a range does not lie within the data stream or has no digest buffer or PunRangeCount is too large.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The digest buffer of a range is smaller than the digest size of its algorithm.
+ */
+_Check_return_
+unsigned int
+Crypt_HashRanges(
+    _In_bytecount_(PunDataSize)     const BYTE*             PrgbData,
+    _In_                            unsigned int            PunDataSize,
+    _Inout_count_(PunRangeCount)    CRYPT_HASH_RANGE*       PrgsRanges,
+    _In_                            unsigned int            PunRangeCount,
+    _Out_opt_                       unsigned int*           PpunCRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        CRYPT_HASH_CONTEXT rgsContexts[CRYPT_HASH_RANGES_MAX];
+        unsigned int unOffset = 0;
+        unsigned int unIndex = 0;
+
+        // Check parameters
+        if (NULL == PrgbData || PunRangeCount > CRYPT_HASH_RANGES_MAX || (NULL == PrgsRanges && 0 != PunRangeCount))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            if (NULL == PrgsRanges[unIndex].pbDigest ||
+                    PrgsRanges[unIndex].unOffset > PunDataSize ||
+                    PrgsRanges[unIndex].unSize > PunDataSize - PrgsRanges[unIndex].unOffset)
+                break;
+        }
+        if (unIndex < PunRangeCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (NULL != PpunCRC)
+            *PpunCRC = 0;
+
+        unReturnValue = RC_SUCCESS;
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            rgsContexts[unIndex].unAlgorithm = CRYPT_HASH_ALGORITHM_NONE;
+            SetMem(PrgsRanges[unIndex].pbDigest, PrgsRanges[unIndex].unDigestSize, 0);
+            if (0 == PrgsRanges[unIndex].unSize)
+                continue;
+            unReturnValue = Crypt_HashInit(&rgsContexts[unIndex], PrgsRanges[unIndex].unAlgorithm);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        while (unOffset < PunDataSize)
+        {
+            unsigned int unChunkSize = PunDataSize - unOffset;
+            unsigned int unChunkEnd = 0;
+            if (unChunkSize > CRYPT_HASH_RANGES_CHUNK_SIZE)
+                unChunkSize = CRYPT_HASH_RANGES_CHUNK_SIZE;
+            unChunkEnd = unOffset + unChunkSize;
+
+            if (NULL != PpunCRC)
+            {
+                unReturnValue = Crypt_CRCUpdate(PrgbData + unOffset, unChunkSize, PpunCRC);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+            }
+
+            // Add the part of each range within the chunk
+            for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+            {
+                unsigned int unRangeEnd = PrgsRanges[unIndex].unOffset + PrgsRanges[unIndex].unSize;
+                unsigned int unStart = 0;
+                unsigned int unEnd = 0;
+                if (0 == PrgsRanges[unIndex].unSize || unOffset >= unRangeEnd || unChunkEnd <= PrgsRanges[unIndex].unOffset)
+                    continue;
+
+                unStart = unOffset > PrgsRanges[unIndex].unOffset ? unOffset : PrgsRanges[unIndex].unOffset;
+                unEnd = unChunkEnd < unRangeEnd ? unChunkEnd : unRangeEnd;
+                unReturnValue = Crypt_HashUpdate(&rgsContexts[unIndex], PrgbData + unStart, unEnd - unStart);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+            }
+            if (RC_SUCCESS != unReturnValue)
+                break;
+
+            unOffset = unChunkEnd;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        for (unIndex = 0; unIndex < PunRangeCount; unIndex++)
+        {
+            if (0 == PrgsRanges[unIndex].unSize)
+                continue;
+            unReturnValue = Crypt_HashFinal(&rgsContexts[unIndex], PrgsRanges[unIndex].unDigestSize, PrgsRanges[unIndex].pbDigest);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+    }
+    WHILE_FALSE_END;
 
     return unReturnValue;
 }
@@ -314,6 +1092,7 @@ Crypt_SeedRandom(
             unReturnValue = RC_E_FAIL;
             break;
         }
+        s_fRandomSeeded = TRUE;
         unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
@@ -323,13 +1102,14 @@ Crypt_SeedRandom(
 
 /**
  *  @brief      Get random bytes from the pseudo random number generator
- *  @details    This function gets random bytes from the pseudo random number generator.
+ *  @details    This function gets random bytes from the pseudo random number generator. The generator is seeded on
+ *              first use if Crypt_SeedRandom has not been called before, so driver load does not wait for entropy.
  *
  *  @param      PusRandomSize           Number of bytes requested.
  *  @param      PrgbRandom              Receives pseudo random bytes.
  *
  *  @retval     RC_SUCCESS              The operation completed successfully.
- *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_FAIL               An unexpected error occurred, e.g. the generator could not be seeded.
  *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PrgbRandom is NULL or PusRandomSize is 0.
  */
 _Check_return_
@@ -348,6 +1128,14 @@ Crypt_GetRandom(
             break;
         }
 
+        // Seed the generator on first use
+        if (!s_fRandomSeeded)
+        {
+            unReturnValue = Crypt_SeedRandom(NULL, 0);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
         if (!RandomBytes(PrgbRandom, PusRandomSize))
         {
             unReturnValue = RC_E_FAIL;
@@ -360,6 +1148,7 @@ Crypt_GetRandom(
     return unReturnValue;
 }
 
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 /**
  *  @brief      Encrypt a byte array with a RSA 2048-bit public key
  *  @details    This function encrypts the given data stream with RSA 2048-bit.
@@ -430,6 +1219,7 @@ Crypt_EncryptRSA(
 
     return unReturnValue;
 }
+#endif
 
 /**
  *  @brief      Verify the given RSA PKCS#1 RSASSA-PSS signature
@@ -482,9 +1272,225 @@ Crypt_VerifySignature(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Build the CRC lookup tables and detect the CRC32 support of the CPU
+ *  @details    Called by Crypt_CRCUpdate on the first call.
+ */
+static
+void
+Crypt_CRCInitialize()
+{
+    unsigned int unEntry = 0;
+    unsigned int unTable = 0;
+
+    for (unEntry = 0; unEntry < RG_LEN(s_rgunCrcTable[0]); unEntry++)
+    {
+        unsigned int unValue = unEntry;
+        unsigned int unBit = 0;
+        for (unBit = 0; unBit < 8; unBit++)
+            unValue = (unValue & 1) ? (CRYPT_CRC32_POLYNOMIAL ^ (unValue >> 1)) : (unValue >> 1);
+        s_rgunCrcTable[0][unEntry] = unValue;
+    }
+    for (unTable = 1; unTable < RG_LEN(s_rgunCrcTable); unTable++)
+    {
+        for (unEntry = 0; unEntry < RG_LEN(s_rgunCrcTable[0]); unEntry++)
+        {
+            unsigned int unValue = s_rgunCrcTable[unTable - 1][unEntry];
+            s_rgunCrcTable[unTable][unEntry] = s_rgunCrcTable[0][unValue & 0xFF] ^ (unValue >> 8);
+        }
+    }
+
+#if defined(MDE_CPU_X64)
+    {
+        // CPUID.01H:ECX.PCLMULQDQ[bit 1]
+        UINT32 unEcx = 0;
+        IGNORE_RETURN_VALUE(AsmCpuid(1, NULL, NULL, &unEcx, NULL));
+        s_fCrcCpuSupport = (0 != (unEcx & BIT1));
+    }
+#elif defined(MDE_CPU_AARCH64) && defined(__GNUC__)
+    {
+        // ID_AA64ISAR0_EL1.CRC32[bits 19:16]
+        UINT64 ullIsar0 = 0;
+        __asm__ volatile("mrs %0, id_aa64isar0_el1" : "=r"(ullIsar0));
+        s_fCrcCpuSupport = (0 != ((ullIsar0 >> 16) & 0xF));
+    }
+#endif
+
+    s_fCrcTableInitialized = TRUE;
+}
+
+/**
+ *  @brief      Continue a CRC calculation with the lookup tables
+ *  @details    Eight bytes are processed per step (slicing-by-8).
+ *
+ *  @param      PunCRC              Inverted CRC value of the preceding data.
+ *  @param      PrgbData            Next part of the data stream.
+ *  @param      PunDataSize         Size of the data in bytes.
+ *
+ *  @returns    Inverted CRC value including the given data.
+ */
+static
+unsigned int
+Crypt_CRCUpdateTable(
+    _In_                        unsigned int    PunCRC,
+    _In_bytecount_(PunDataSize) const BYTE*     PrgbData,
+    _In_                        unsigned int    PunDataSize)
+{
+    while (PunDataSize >= 8)
+    {
+        unsigned int unLow = PunCRC ^ ((unsigned int)PrgbData[0] | ((unsigned int)PrgbData[1] << 8) | ((unsigned int)PrgbData[2] << 16) | ((unsigned int)PrgbData[3] << 24));
+        unsigned int unHigh = (unsigned int)PrgbData[4] | ((unsigned int)PrgbData[5] << 8) | ((unsigned int)PrgbData[6] << 16) | ((unsigned int)PrgbData[7] << 24);
+        PunCRC = s_rgunCrcTable[7][unLow & 0xFF] ^ s_rgunCrcTable[6][(unLow >> 8) & 0xFF] ^
+                 s_rgunCrcTable[5][(unLow >> 16) & 0xFF] ^ s_rgunCrcTable[4][unLow >> 24] ^
+                 s_rgunCrcTable[3][unHigh & 0xFF] ^ s_rgunCrcTable[2][(unHigh >> 8) & 0xFF] ^
+                 s_rgunCrcTable[1][(unHigh >> 16) & 0xFF] ^ s_rgunCrcTable[0][unHigh >> 24];
+        PrgbData += 8;
+        PunDataSize -= 8;
+    }
+    while (PunDataSize > 0)
+    {
+        PunCRC = s_rgunCrcTable[0][(PunCRC ^ *PrgbData) & 0xFF] ^ (PunCRC >> 8);
+        PrgbData++;
+        PunDataSize--;
+    }
+
+    return PunCRC;
+}
+
+#if defined(MDE_CPU_X64)
+/**
+ *  @brief      Continue a CRC calculation with carry-less multiplication
+ *  @details    The data is folded 64 bytes per step into four 128-bit lanes, the lanes are folded into 128 bits and
+ *              reduced to the CRC value with a Barrett reduction. The constants are the bit-reflected folding constants
+ *              for the IEEE polynomial from "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+ *              (Intel, 2009).
+ *
+ *  @param      PunCRC              Inverted CRC value of the preceding data.
+ *  @param      PrgbData            Next part of the data stream.
+ *  @param      PunDataSize         Size of the data in bytes. At least CRYPT_CRC_CPU_MIN_SIZE and a multiple of 16.
+ *
+ *  @returns    Inverted CRC value including the given data.
+ */
+static
+CRYPT_CRC_TARGET_CLMUL
+unsigned int
+Crypt_CRCUpdateCpu(
+    _In_                        unsigned int    PunCRC,
+    _In_bytecount_(PunDataSize) const BYTE*     PrgbData,
+    _In_                        unsigned int    PunDataSize)
+{
+    const __m128i sK1K2 = _mm_set_epi64x(0x01c6e41596, 0x0154442bd4);
+    const __m128i sK3K4 = _mm_set_epi64x(0x00ccaa009e, 0x01751997d0);
+    const __m128i sK5K0 = _mm_set_epi64x(0x0000000000, 0x0163cd6124);
+    const __m128i sPoly = _mm_set_epi64x(0x01f7011641, 0x01db710641);
+    const __m128i sMask32 = _mm_setr_epi32(~0, 0, ~0, 0);
+    __m128i sX1 = _mm_loadu_si128((const __m128i*)(PrgbData + 0x00));
+    __m128i sX2 = _mm_loadu_si128((const __m128i*)(PrgbData + 0x10));
+    __m128i sX3 = _mm_loadu_si128((const __m128i*)(PrgbData + 0x20));
+    __m128i sX4 = _mm_loadu_si128((const __m128i*)(PrgbData + 0x30));
+    __m128i sTemp;
+
+    sX1 = _mm_xor_si128(sX1, _mm_cvtsi32_si128((int)PunCRC));
+    PrgbData += 64;
+    PunDataSize -= 64;
+
+    // Fold 64 bytes per step
+    while (PunDataSize >= 64)
+    {
+        __m128i sX5 = _mm_clmulepi64_si128(sX1, sK1K2, 0x00);
+        __m128i sX6 = _mm_clmulepi64_si128(sX2, sK1K2, 0x00);
+        __m128i sX7 = _mm_clmulepi64_si128(sX3, sK1K2, 0x00);
+        __m128i sX8 = _mm_clmulepi64_si128(sX4, sK1K2, 0x00);
+
+        sX1 = _mm_clmulepi64_si128(sX1, sK1K2, 0x11);
+        sX2 = _mm_clmulepi64_si128(sX2, sK1K2, 0x11);
+        sX3 = _mm_clmulepi64_si128(sX3, sK1K2, 0x11);
+        sX4 = _mm_clmulepi64_si128(sX4, sK1K2, 0x11);
+
+        sX1 = _mm_xor_si128(_mm_xor_si128(sX1, sX5), _mm_loadu_si128((const __m128i*)(PrgbData + 0x00)));
+        sX2 = _mm_xor_si128(_mm_xor_si128(sX2, sX6), _mm_loadu_si128((const __m128i*)(PrgbData + 0x10)));
+        sX3 = _mm_xor_si128(_mm_xor_si128(sX3, sX7), _mm_loadu_si128((const __m128i*)(PrgbData + 0x20)));
+        sX4 = _mm_xor_si128(_mm_xor_si128(sX4, sX8), _mm_loadu_si128((const __m128i*)(PrgbData + 0x30)));
+
+        PrgbData += 64;
+        PunDataSize -= 64;
+    }
+
+    // Fold the four lanes into 128 bits
+    sTemp = _mm_clmulepi64_si128(sX1, sK3K4, 0x00);
+    sX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(sX1, sK3K4, 0x11), sX2), sTemp);
+    sTemp = _mm_clmulepi64_si128(sX1, sK3K4, 0x00);
+    sX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(sX1, sK3K4, 0x11), sX3), sTemp);
+    sTemp = _mm_clmulepi64_si128(sX1, sK3K4, 0x00);
+    sX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(sX1, sK3K4, 0x11), sX4), sTemp);
+
+    // Fold the remaining 16 byte blocks
+    while (PunDataSize >= 16)
+    {
+        sTemp = _mm_clmulepi64_si128(sX1, sK3K4, 0x00);
+        sX1 = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(sX1, sK3K4, 0x11), _mm_loadu_si128((const __m128i*)PrgbData)), sTemp);
+        PrgbData += 16;
+        PunDataSize -= 16;
+    }
+
+    // Fold 128 bits to 64 bits
+    sTemp = _mm_clmulepi64_si128(sX1, sK3K4, 0x10);
+    sX1 = _mm_xor_si128(_mm_srli_si128(sX1, 8), sTemp);
+    sTemp = _mm_srli_si128(sX1, 4);
+    sX1 = _mm_xor_si128(_mm_clmulepi64_si128(_mm_and_si128(sX1, sMask32), sK5K0, 0x00), sTemp);
+
+    // Barrett reduction to 32 bits
+    sTemp = _mm_clmulepi64_si128(_mm_and_si128(sX1, sMask32), sPoly, 0x10);
+    sTemp = _mm_clmulepi64_si128(_mm_and_si128(sTemp, sMask32), sPoly, 0x00);
+    sX1 = _mm_xor_si128(sX1, sTemp);
+
+    return (unsigned int)_mm_cvtsi128_si32(_mm_srli_si128(sX1, 4));
+}
+#elif defined(MDE_CPU_AARCH64) && defined(__GNUC__)
+/**
+ *  @brief      Continue a CRC calculation with the CRC32 instructions
+ *  @details    Eight bytes are processed per CRC32X instruction, the unaligned head and the tail per CRC32B instruction.
+ *
+ *  @param      PunCRC              Inverted CRC value of the preceding data.
+ *  @param      PrgbData            Next part of the data stream.
+ *  @param      PunDataSize         Size of the data in bytes.
+ *
+ *  @returns    Inverted CRC value including the given data.
+ */
+static
+unsigned int
+Crypt_CRCUpdateCpu(
+    _In_                        unsigned int    PunCRC,
+    _In_bytecount_(PunDataSize) const BYTE*     PrgbData,
+    _In_                        unsigned int    PunDataSize)
+{
+    while (PunDataSize > 0 && 0 != ((UINTN)PrgbData & 7))
+    {
+        __asm__(".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r"(PunCRC) : "r"((UINT32)*PrgbData));
+        PrgbData++;
+        PunDataSize--;
+    }
+    while (PunDataSize >= 8)
+    {
+        __asm__(".arch_extension crc\n\tcrc32x %w0, %w0, %x1" : "+r"(PunCRC) : "r"(*(const UINT64*)PrgbData));
+        PrgbData += 8;
+        PunDataSize -= 8;
+    }
+    while (PunDataSize > 0)
+    {
+        __asm__(".arch_extension crc\n\tcrc32b %w0, %w0, %w1" : "+r"(PunCRC) : "r"((UINT32)*PrgbData));
+        PrgbData++;
+        PunDataSize--;
+    }
+
+    return PunCRC;
+}
+#endif
+
 /**
  *  @brief      Calculate the CRC value of the given data stream
- *  @details    The function calculates the CRC32 value of a data stream
+ *  @details    The function calculates the CRC32 value of a data stream. The result is the same as the one of the
+ *              CalculateCrc32 boot service.
  *
  *  @param      PpInputData         Data stream for CRC calculation.
  *  @param      PnInputDataSize     Size if data to calculate the CRC.
@@ -505,21 +1511,100 @@ Crypt_CRC(
 
     do
     {
-        EFI_STATUS efiStatus = EFI_UNSUPPORTED;
+        // Check parameter
+        if (NULL == PpInputData || 0 >= PnInputDataSize || NULL == PpunCRC)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        *PpunCRC = 0;
+        unReturnValue = Crypt_CRCUpdate(PpInputData, (unsigned int)PnInputDataSize, PpunCRC);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Continue a CRC calculation with the next part of a data stream
+ *  @details    The function updates a running CRC32 value with the given data. Starting with a CRC value of 0 and
+ *              passing all parts of a data stream in order results in the same value as Crypt_CRC on the whole stream.
+ *              The CRC32 instructions of the CPU are used if available (CRC32 on AArch64, PCLMULQDQ on X64), otherwise
+ *              the calculation is table driven. The tables are built and the CPU support is detected on the first call.
+ *
+ *  @param      PpInputData         Next part of the data stream.
+ *  @param      PunInputDataSize    Size of the data in bytes.
+ *  @param      PpunCRC             In: CRC value of the preceding data (0 at the start of the stream).\n
+ *                                  Out: CRC value including the given data.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. PpunCRC is NULL or PpInputData is NULL and PunInputDataSize is not 0.
+ */
+_Check_return_
+unsigned int
+Crypt_CRCUpdate(
+    _In_bytecount_(PunInputDataSize)    const void*     PpInputData,
+    _In_                                unsigned int    PunInputDataSize,
+    _Inout_                             unsigned int*   PpunCRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        const BYTE* pbData = (const BYTE*)PpInputData;
+        unsigned int unCRC = 0;
 
         // Check parameter
-        if (NULL == PpInputData || 0 == PnInputDataSize || NULL == PpunCRC)
+        if (NULL == PpunCRC || (NULL == PpInputData && 0 != PunInputDataSize))
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
 
-        // Utilize the EDK II method for calculating a CRC32 value
-        efiStatus = gBS->CalculateCrc32((void*)PpInputData, PnInputDataSize, PpunCRC);
-        if (EFI_SUCCESS == efiStatus)
-            unReturnValue = RC_SUCCESS;
+        if (!s_fCrcTableInitialized)
+            Crypt_CRCInitialize();
+
+        unCRC = ~(*PpunCRC);
+#if defined(MDE_CPU_X64) || (defined(MDE_CPU_AARCH64) && defined(__GNUC__))
+        if (s_fCrcCpuSupport && PunInputDataSize >= CRYPT_CRC_CPU_MIN_SIZE)
+        {
+            // The folding works on 16 byte blocks, the rest is added with the tables
+            unsigned int unCpuSize = PunInputDataSize & ~15U;
+            unCRC = Crypt_CRCUpdateCpu(unCRC, pbData, unCpuSize);
+            pbData += unCpuSize;
+            PunInputDataSize -= unCpuSize;
+        }
+#endif
+        *PpunCRC = ~Crypt_CRCUpdateTable(unCRC, pbData, PunInputDataSize);
+
+        unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
 
     return unReturnValue;
 }
+
+/**
+ *  @brief      Initialize the crypto module
+ *  @details    Builds the CRC lookup tables, detects the CRC32 and SHA-256 instructions of the CPU and runs the SHA-256
+ *              self-test. Must be called on the boot processor before any calculation is started on an application processor.
+ */
+void
+Crypt_Initialize()
+{
+    if (!s_fCrcTableInitialized)
+        Crypt_CRCInitialize();
+    if (!s_fSha256Initialized)
+        Crypt_SHA256Initialize();
+}
+
+/**
+ *  @brief      Uninitialize the crypto module
+ *  @details    Frees the RSA public keys cached for the signature verification.
+ */
+void
+Crypt_Uninitialize()
+{
+    RsaFreeKeyCacheIfx();
+}
@@ -36,10 +36,131 @@ GLOBAL_REMOVE_IF_UNREFERENCED CONST UINT8 DefaultPublicExponent[] = {
 /// Size of SHA1 digest in bytes
 #define SHA1_DIGEST_SIZE 20
 
+/// Number of RSA public keys kept by the key cache
+#define RSA_KEY_CACHE_SIZE 4
+
+/// RSA public key cache entry
+typedef struct
+{
+    /// RSA public key object or NULL if the entry is empty
+    RSA*    RsaPublicKey;
+    /// Modulus the RSA public key object was created from
+    UINT8   Modulus[RSA2048_MODULUS_SIZE];
+} RSA_KEY_CACHE_ENTRY;
+
+/// RSA public keys used for signature verification. The keys are built once and reused for every verification.
+static RSA_KEY_CACHE_ENTRY g_RsaKeyCache[RSA_KEY_CACHE_SIZE];
+
+/**
+  Create a RSA 2048-bit public key object with the default public exponent.
+
+  @param[in]       Modulus          Pointer to buffer that carries the RSA public key.
+  @param[in]       ModulusSize      Size of the Modulus buffer in bytes.
+
+  @return  RSA public key object or NULL on failure. The caller must free it with RSA_free.
+*/
+static
+RSA*
+RsaCreatePublicKeyIfx (
+    const UINT8*  Modulus,
+    const UINT32  ModulusSize)
+{
+    RSA* RsaPublicKey = NULL;
+
+    // Initialize RSA Public Key object
+    RsaPublicKey = RsaNew();
+    if (NULL == RsaPublicKey)
+        goto _Exit;
+
+    // Set public key
+    if (!RsaSetKey(RsaPublicKey, RsaKeyN, Modulus, ModulusSize))
+        goto _Error;
+
+    // Set public exponent
+    if (!RsaSetKey(RsaPublicKey, RsaKeyE, DefaultPublicExponent, sizeof(DefaultPublicExponent)))
+        goto _Error;
+
+    // Keep the Montgomery context of the modulus in the object after the first public key operation
+    RSA_set_flags(RsaPublicKey, RSA_FLAG_CACHE_PUBLIC);
+    goto _Exit;
+
+_Error:
+    RSA_free(RsaPublicKey);
+    RsaPublicKey = NULL;
+
+_Exit:
+    return RsaPublicKey;
+}
+
+/**
+  Get the cached RSA 2048-bit public key object for the given modulus.
+
+  The object is created on the first request for a modulus and reused by all later requests. If the cache is full
+  a new object is returned which is not cached.
+
+  @param[in]       Modulus          Pointer to buffer that carries the RSA public key.
+  @param[in]       ModulusSize      Size of the Modulus buffer in bytes.
+  @param[out]      Cached           Receives TRUE if the returned object is owned by the cache, FALSE if the caller must free it.
+
+  @return  RSA public key object or NULL on failure.
+*/
+static
+RSA*
+RsaGetPublicKeyIfx (
+    const UINT8*  Modulus,
+    const UINT32  ModulusSize,
+    BOOLEAN*      Cached)
+{
+    RSA* RsaPublicKey = NULL;
+    UINTN Index = 0;
+
+    *Cached = FALSE;
+
+    for (Index = 0; Index < RSA_KEY_CACHE_SIZE; Index++)
+    {
+        if (NULL == g_RsaKeyCache[Index].RsaPublicKey)
+            break;
+        if (0 == CompareMem(g_RsaKeyCache[Index].Modulus, Modulus, ModulusSize))
+        {
+            *Cached = TRUE;
+            return g_RsaKeyCache[Index].RsaPublicKey;
+        }
+    }
+
+    RsaPublicKey = RsaCreatePublicKeyIfx(Modulus, ModulusSize);
+    if (NULL != RsaPublicKey && Index < RSA_KEY_CACHE_SIZE)
+    {
+        CopyMem(g_RsaKeyCache[Index].Modulus, Modulus, ModulusSize);
+        g_RsaKeyCache[Index].RsaPublicKey = RsaPublicKey;
+        *Cached = TRUE;
+    }
+
+    return RsaPublicKey;
+}
+
+/**
+  Free the RSA public key objects of the key cache.
+*/
+VOID
+EFIAPI
+RsaFreeKeyCacheIfx (
+    VOID)
+{
+    UINTN Index = 0;
+
+    for (Index = 0; Index < RSA_KEY_CACHE_SIZE; Index++)
+    {
+        if (NULL != g_RsaKeyCache[Index].RsaPublicKey)
+            RSA_free(g_RsaKeyCache[Index].RsaPublicKey);
+    }
+    ZeroMem(g_RsaKeyCache, sizeof(g_RsaKeyCache));
+}
+
 /**
   Verify the given RSA PKCS#1 RSASSA-PSS signature.
 
   This function verifies the given RSA PKCS#1 RSASSA-PSS signature with a RSA 2048-bit public key.
+  The RSA public key object of the modulus is taken from the key cache.
 
   If MessageHash is NULL, then return FALSE.
   If HashSize is not equal to the size of SHA-256 digest, then return FALSE.
@@ -69,6 +190,7 @@ RsaPssVerifyIfx (
     const UINT32  ModulusSize)
 {
     BOOLEAN result = FALSE;
+    BOOLEAN Cached = FALSE;
     RSA* RsaPublicKey = NULL;
 
     // Check input parameters
@@ -79,19 +201,11 @@ RsaPssVerifyIfx (
     if (NULL == Modulus || RSA2048_MODULUS_SIZE != ModulusSize)
         goto _Exit;
 
-    // Initialize RSA Public Key object
-    RsaPublicKey = RsaNew();
+    // Get RSA Public Key object
+    RsaPublicKey = RsaGetPublicKeyIfx(Modulus, ModulusSize, &Cached);
     if (NULL == RsaPublicKey)
         goto _Exit;
 
-    // Set public key
-    if (!RsaSetKey(RsaPublicKey, RsaKeyN, Modulus, ModulusSize))
-        goto _Exit;
-
-    // Set public exponent
-    if (!RsaSetKey(RsaPublicKey, RsaKeyE, DefaultPublicExponent, sizeof(DefaultPublicExponent)))
-        goto _Exit;
-
     {
         UINT8 DecryptedDigest[RSA2048_MODULUS_SIZE] = {0};
         if (-1 == RSA_public_decrypt(SignatureSize, Signature, DecryptedDigest, RsaPublicKey, RSA_NO_PADDING))
@@ -106,8 +220,8 @@ RsaPssVerifyIfx (
     }
 
 _Exit:
-    // Free RSA object and its components (BIGNUM)
-    if (NULL != RsaPublicKey)
+    // Free RSA object and its components (BIGNUM) unless it belongs to the key cache
+    if (NULL != RsaPublicKey && !Cached)
         RSA_free(RsaPublicKey);
 
     return result;
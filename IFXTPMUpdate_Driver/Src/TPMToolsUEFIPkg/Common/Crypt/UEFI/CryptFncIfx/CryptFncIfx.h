@@ -48,6 +48,17 @@ RsaPssVerifyIfx (
     const UINT32  ModulusSize
 );
 
+/**
+  Free the RSA public key objects of the key cache.
+
+  RsaPssVerifyIfx keeps the RSA public key object of each modulus for later verifications.
+  This function releases them. It is called when the module is unloaded.
+*/
+VOID
+EFIAPI
+RsaFreeKeyCacheIfx (
+    VOID);
+
 /**
   Encrypt a byte array with a RSA 2048-bit public key
 
@@ -16,6 +16,7 @@
 #include "TpmIO.h"
 #include "Logging.h"
 #include "Platform.h"
+#include "PropertyStorage.h"
 
 /// Function pointer to method for connecting to the TPM
 PFN_TPMIO_Connect       s_fpTpmIoConnect = NULL;
@@ -23,32 +24,131 @@ PFN_TPMIO_Connect       s_fpTpmIoConnect = NULL;
 /// Function pointer to method for disconnecting from the TPM
 PFN_TPMIO_Disconnect    s_fpTpmIoDisconnect = NULL;
 
+/// Function pointer to revalidate the connection to the TPM
+PFN_TPMIO_Revalidate    s_fpTpmIoRevalidate = NULL;
+
 /// Function pointer to method for transmitting data to the TPM
 PFN_TPMIO_Transmit      s_fpTpmIoTransmit = NULL;
 
+/// Function pointer to method for sending a command to the TPM without waiting for the response
+PFN_TPMIO_Send          s_fpTpmIoSend = NULL;
+
+/// Function pointer to method for receiving the response of a command sent to the TPM
+PFN_TPMIO_Receive       s_fpTpmIoReceive = NULL;
+
+/// Function pointer to check if the response of a sent command is available
+PFN_TPMIO_Poll          s_fpTpmIoPoll = NULL;
+
 /// Function pointer to read a byte from a register of the TPM
 PFN_TPMIO_ReadRegister  s_fpTpmIoReadRegister = NULL;
 
 /// Function pointer to write a byte to a register of the TPM
 PFN_TPMIO_WriteRegister s_fpTpmIoWriteRegister = NULL;
 
+/// Function pointer to get the transport phase durations of the last TPM command
+PFN_TPMIO_GetLastPhaseTiming s_fpTpmIoGetLastPhaseTiming = NULL;
+
+/// Function pointer to read the identification of the TPM from its interface registers
+PFN_TPMIO_GetInterfaceInfo s_fpTpmIoGetInterfaceInfo = NULL;
+
 /// Flag indicating TPM connection established or not
 BOOL                    s_fTpmConnected = FALSE;
 
 /// Flag indicating device management initialization performed or not
 BOOL                    s_fInitialized = FALSE;
 
-/// Caches the last TPM command
-BYTE                    g_rgbLastRequest[4096];
+/// History of the last TPM commands for troubleshooting
+DEVICE_MANAGEMENT_HISTORY_ENTRY s_rgsHistory[DEVICE_MANAGEMENT_HISTORY_SIZE];
+
+/// Number of TPM commands recorded in the command history since start, the newest entry is at (s_unHistoryCount - 1) % DEVICE_MANAGEMENT_HISTORY_SIZE
+unsigned int            s_unHistoryCount = 0;
+
+/// Command code of the current run of identical command codes (see DeviceManagement_LogSampleBegin)
+unsigned int            s_unLogSampleCommandCode = 0;
+
+/// Number of commands in the current run of identical command codes
+unsigned int            s_unLogSampleRunLength = 0;
+
+/// Number of request and response bytes of the completed commands in the current run
+unsigned long long      s_ullLogSampleBytes = 0;
+
+/// Sum of the latencies of the completed commands in the current run in microseconds
+unsigned long long      s_ullLogSampleTotalUs = 0;
+
+/// Flag indicating whether the current command is logged in full
+BOOL                    s_fLogCommandDetail = TRUE;
+
+/// Flag indicating a command was sent with DeviceManagement_Send and its response is not yet received
+BOOL                    s_fCommandPending = FALSE;
+
+/// Maximum duration of the pending command in microseconds
+unsigned int            s_unPendingMaxDuration = 0;
+
+/// Expected duration of the pending command in microseconds, 0 if not calibrated
+unsigned int            s_unPendingExpectedDuration = 0;
+
+/// TPM state generation, see DeviceManagement_GetTpmStateGeneration
+unsigned int            s_unTpmStateGeneration = 0;
+
+/// Zero based index of the selected TPM instance, see DeviceManagement_SelectInstance
+unsigned int            s_unSelectedInstance = 0;
+
+/// Command code of the pending command
+unsigned int            s_unPendingCommandCode = 0;
+
+/// Request size of the pending command in bytes
+unsigned int            s_unPendingRequestSize = 0;
+
+/// Tick count at the start of the pending command
+unsigned long long      s_ullPendingStartTicks = 0;
+
+/// Flag indicating DeviceManagement_Poll found the maximum duration of the pending command elapsed
+BOOL                    s_fPendingExpired = FALSE;
+
+/// Latency statistics of the TPM commands
+DEVICE_MANAGEMENT_LATENCY_STATISTICS s_sLatencyStatistics;
+
+/// Command context owning the request and response buffers of the Micro TSS command wrappers
+DEVICE_MANAGEMENT_COMMAND_CONTEXT s_sCommandContext;
+
+/// Number of nested DeviceManagement_AcquireAccess calls of the producer holding the TPM (0 if the TPM is not held)
+unsigned int            s_unAccessDepth = 0;
+
+/// Execution level of the producer holding the TPM
+unsigned int            s_unAccessLevel = 0;
+
+/// Access priority of the producer holding the TPM
+unsigned int            s_unAccessPriority = DEVICE_MANAGEMENT_PRIORITY_QUERY;
+
+/// Queries waiting until the TPM is released
+DEVICE_MANAGEMENT_SCHEDULED_QUERY s_rgsScheduledQueries[DEVICE_MANAGEMENT_SCHEDULER_QUEUE_SIZE];
+
+/// Number of queries in s_rgsScheduledQueries
+unsigned int            s_unScheduledQueryCount = 0;
+
+/// Command code monitored by the stall detector, 0 if the stall detector is stopped
+unsigned int            s_unStallCommandCode = 0;
+
+/// Latencies of the last successful monitored commands in microseconds (ring buffer)
+unsigned int            s_rgunStallLatencies[DEVICE_MANAGEMENT_STALL_SAMPLE_COUNT];
+
+/// Number of latencies recorded by the stall detector since it was started
+unsigned int            s_unStallLatencyCount = 0;
+
+/// Median latency the stall deadline of the current command is derived from in microseconds
+unsigned int            s_unStallMedian = 0;
 
-/// Caches the size of the last TPM command
-unsigned int            g_unSizeLastRequest = 0;
+/// Stall deadline of the current command in microseconds, 0 if the maximum duration from the command table applies
+unsigned int            s_unStallDeadline = 0;
 
-/// Caches the last TPM response
-BYTE                    g_rgbLastResponse[4096];
+/// Time budget of the current query access in microseconds, 0 if no query deadline applies
+unsigned int            s_unQueryDeadline = 0;
 
-/// Caches the size of the last TPM response
-unsigned int            g_unSizeLastResponse = 0;
+/// Tick count at the start of the current query access
+unsigned long long      s_ullQueryDeadlineStartTicks = 0;
+
+/// Flag indicating a TPM command of the last query access was not completed because the query deadline elapsed
+BOOL                    s_fQueryDeadlineExceeded = FALSE;
 
 /// Maximum wait time in TIS protocol for commands of category SMALL_DURATION: 10 seconds
 #define SMALL_DURATION 10000000
@@ -56,67 +156,140 @@ unsigned int            g_unSizeLastResponse = 0;
 #define MEDIUM_DURATION 20000000
 /// Maximum wait time in TIS protocol for commands of category LONG_DURATION: 120 seconds
 #define LONG_DURATION 120000000
+/// Factor applied to a calibrated command duration to get the maximum wait time in TIS protocol
+#define CALIBRATED_DURATION_FACTOR 4
+/// Lower limit of the maximum wait time in TIS protocol derived from a calibrated command duration: 2 seconds
+#define CALIBRATED_DURATION_MIN 2000000
+/// Number of latencies the stall detector needs before it limits the maximum wait time
+#define STALL_DETECTOR_MIN_SAMPLES 4
+/// Factor applied to the median latency of the streamed blocks to get the stall deadline
+#define STALL_DETECTOR_FACTOR 8
+/// Lower limit of the stall deadline: 1 second
+#define STALL_DETECTOR_MIN_DEADLINE 1000000
+
+/// List of TPM1.2 and TPM2.0 command codes which do not change the TPM state. All other commands invalidate cached TPM state information.
+/// The session and policy commands used to prepare the firmware update policy session are included since they do not affect the cached information.
+const unsigned int s_rgunTpmReadOnlyCommands[] = {
+    0x00000054, // TPM_GetTestResult
+    0x00000065, // TPM_GetCapability
+    0x0000007C, // TPM_ReadPubEK
+    0x0000012E, // TPM2_SetPrimaryPolicy
+    0x00000151, // TPM2_PolicySecret
+    0x00000165, // TPM2_FlushContext
+    0x00000169, // TPM2_NV_ReadPublic
+    0x0000016C, // TPM2_PolicyCommandCode
+    0x00000173, // TPM2_ReadPublic
+    0x00000176, // TPM2_StartAuthSession
+    0x00000179, // TPM2_FirmwareRead
+    0x0000017A, // TPM2_GetCapability
+    0x0000017B, // TPM2_GetRandom
+    0x0000017C, // TPM2_GetTestResult
+    0x0000017E, // TPM2_PCR_Read
+    0x00000181  // TPM2_ReadClock
+};
+
+/// List of TPM1.2 and TPM2.0 command codes which are safe to send again if the transport failed, since executing them twice
+/// has the same effect as executing them once. Session, policy and firmware update commands are not included.
+const unsigned int s_rgunTpmResendableCommands[] = {
+    0x00000054, // TPM_GetTestResult
+    0x00000065, // TPM_GetCapability
+    0x0000007C, // TPM_ReadPubEK
+    0x00000169, // TPM2_NV_ReadPublic
+    0x00000173, // TPM2_ReadPublic
+    0x0000017A, // TPM2_GetCapability
+    0x0000017C, // TPM2_GetTestResult
+    0x0000017E, // TPM2_PCR_Read
+    0x00000181  // TPM2_ReadClock
+};
+
+/// List of TPM2.0 warning codes which report that a command was not executed or was suspended, so it may be sent again unchanged
+const unsigned int s_rgunTpmTransientWarnings[] = {
+    0x00000908, // TPM_RC_YIELDED
+    0x0000090A, // TPM_RC_TESTING
+    0x00000922  // TPM_RC_RETRY
+};
+
+/// List of available TPM1.2 command names and their command codes.
+/// The list must be sorted by command code in ascending order (see DeviceManagement_TpmCommandName).
+const IfxTpmCommand s_sTpm1Commands[] = {
+    {L"None", 0},
+    {L"TPM_OIAP", 0x0000000A},
+    {L"TPM_OSAP", 0x0000000B},
+    {L"TPM_TakeOwnership", 0x0000000D},
+    {L"TPM_ChangeAuthOwner", 0x00000010},
+    {L"TPM_SetCapability", 0x0000003F},
+    {L"TPM_GetTestResult", 0x00000054},
+    {L"TPM_OwnerClear", 0x0000005B},
+    {L"TPM_GetCapability", 0x00000065},
+    {L"TPM_ReadPubEK", 0x0000007C},
+    {L"TPM_OwnerReadInternalPub", 0x00000081},
+    {L"TPM_Startup", 0x00000099},
+    {L"TPM_FieldUpgrade", 0x000000AA},
+    {L"TPM_FlushSpecific", 0x000000BA},
+    {L"TSC_PhysicalPresence", 0x4000000A}
+};
 
-/// List of available TPM1.2 command names and their properties: command code, maximum command duration
-IfxTpmCommand s_sTpm1Commands[] = {
-    {L"None", 0, LONG_DURATION},
-    {L"TPM_OIAP", 0x0000000A, SMALL_DURATION},
-    {L"TPM_OSAP", 0x0000000B, SMALL_DURATION},
-    {L"TPM_TakeOwnership", 0x0000000D, LONG_DURATION},
-    {L"TPM_ChangeAuthOwner", 0x00000010, MEDIUM_DURATION},
-    {L"TPM_SetCapability", 0x0000003F, SMALL_DURATION},
-    {L"TPM_GetTestResult", 0x00000054, SMALL_DURATION},
-    {L"TPM_OwnerClear", 0x0000005B, SMALL_DURATION},
-    {L"TPM_GetCapability", 0x00000065, SMALL_DURATION},
-    {L"TPM_ReadPubEK", 0x0000007C, MEDIUM_DURATION},
-    {L"TPM_OwnerReadInternalPub", 0x00000081, SMALL_DURATION},
-    {L"TPM_Startup", 0x00000099, SMALL_DURATION},
-    {L"TPM_FieldUpgrade", 0x000000AA, MEDIUM_DURATION},
-    {L"TPM_FlushSpecific", 0x000000BA, SMALL_DURATION},
-    {L"TSC_PhysicalPresence", 0x4000000A, SMALL_DURATION}
+/// Maximum command durations of the TPM1.2 commands, kept apart from the names so that no name string is read per command.
+/// The list must be sorted by command code in ascending order (see DeviceManagement_TpmCommandDuration).
+static const IfxTpmCommandDuration s_sTpm1CommandDurations[] = {
+    {0x0000000A, SMALL_DURATION},
+    {0x0000000B, SMALL_DURATION},
+    {0x0000000D, LONG_DURATION},
+    {0x00000010, MEDIUM_DURATION},
+    {0x0000003F, SMALL_DURATION},
+    {0x00000054, SMALL_DURATION},
+    {0x0000005B, SMALL_DURATION},
+    {0x00000065, SMALL_DURATION},
+    {0x0000007C, MEDIUM_DURATION},
+    {0x00000081, SMALL_DURATION},
+    {0x00000099, SMALL_DURATION},
+    {0x000000AA, MEDIUM_DURATION},
+    {0x000000BA, SMALL_DURATION},
+    {0x4000000A, SMALL_DURATION}
 };
 
-/// List of available TPM2.0 command names and their properties: command code, maximum command duration
-IfxTpmCommand s_sTpm2Commands[] = {
-    {L"None", 0, LONG_DURATION},                                        {L"TPM2_NV_UndefineSpaceSpecial", 0x0000011F, LONG_DURATION},   {L"TPM2_EvictControl", 0x00000120, LONG_DURATION},
-    {L"TPM2_HierarchyControl", 0x00000121, LONG_DURATION},              {L"TPM2_NV_UndefineSpace", 0x00000122, LONG_DURATION},          {L"TPM2_ChangeEPS", 0x00000124, LONG_DURATION},
-    {L"TPM2_ChangePPS", 0x00000125, LONG_DURATION},                     {L"TPM2_Clear", 0x00000126, LONG_DURATION},                     {L"TPM2_ClearControl", 0x00000127, LONG_DURATION},
-    {L"TPM2_ClockSet", 0x00000128, LONG_DURATION},                      {L"TPM2_HierarchyChangeAuth", 0x00000129, LONG_DURATION},       {L"TPM2_NV_DefineSpace", 0x0000012A, LONG_DURATION},
-    {L"TPM2_PCR_Allocate", 0x0000012B, LONG_DURATION},                  {L"TPM2_PCR_SetAuthPolicy", 0x0000012C, LONG_DURATION},         {L"TPM2_PP_Commands", 0x0000012D, LONG_DURATION},
-    {L"TPM2_SetPrimaryPolicy", 0x0000012E, LONG_DURATION},              {L"TPM2_FieldUpgradeStart", 0x0000012F, LONG_DURATION},         {L"TPM2_ClockRateAdjust", 0x00000130, LONG_DURATION},
-    {L"TPM2_CreatePrimary", 0x00000131, LONG_DURATION},                 {L"TPM2_NV_GlobalWriteLock", 0x00000132, LONG_DURATION},        {L"TPM2_GetCommandAuditDigest", 0x00000133, LONG_DURATION},
-    {L"TPM2_NV_Increment", 0x00000134, LONG_DURATION},                  {L"TPM2_NV_SetBits", 0x00000135, LONG_DURATION},                {L"TPM2_NV_Extend", 0x00000136, LONG_DURATION},
-    {L"TPM2_NV_Write", 0x00000137, LONG_DURATION},                      {L"TPM2_NV_WriteLock", 0x00000138, LONG_DURATION},              {L"TPM2_DictionaryAttackLockReset", 0x00000139, LONG_DURATION},
-    {L"TPM2_DictionaryAttackParameters", 0x0000013A, LONG_DURATION},    {L"TPM2_NV_ChangeAuth", 0x0000013B, LONG_DURATION},             {L"TPM2_PCR_Event", 0x0000013C, LONG_DURATION},
-    {L"TPM2_PCR_Reset", 0x0000013D, LONG_DURATION},                     {L"TPM2_SequenceComplete", 0x0000013E, LONG_DURATION},          {L"TPM2_SetAlgorithmSet", 0x0000013F, LONG_DURATION},
-    {L"TPM2_SetCommandCodeAuditStatus", 0x00000140, LONG_DURATION},     {L"TPM2_FieldUpgradeData", 0x00000141, LONG_DURATION},          {L"TPM2_IncrementalSelfTest", 0x00000142, LONG_DURATION},
-    {L"TPM2_SelfTest", 0x00000143, LONG_DURATION},                      {L"TPM2_Startup", 0x00000144, LONG_DURATION},                   {L"TPM2_Shutdown", 0x00000145, LONG_DURATION},
-    {L"TPM2_StirRandom", 0x00000146, LONG_DURATION},                    {L"TPM2_ActivateCredential", 0x00000147, LONG_DURATION},        {L"TPM2_Certify", 0x00000148, LONG_DURATION},
-    {L"TPM2_PolicyNV", 0x00000149, LONG_DURATION},                      {L"TPM2_CertifyCreation", 0x0000014A, LONG_DURATION},           {L"TPM2_Duplicate", 0x0000014B, LONG_DURATION},
-    {L"TPM2_GetTime", 0x0000014C, LONG_DURATION},                       {L"TPM2_GetSessionAuditDigest", 0x0000014D, LONG_DURATION},     {L"TPM2_NV_Read", 0x0000014E, LONG_DURATION},
-    {L"TPM2_NV_ReadLock", 0x0000014F, LONG_DURATION},                   {L"TPM2_ObjectChangeAuth", 0x00000150, LONG_DURATION},          {L"TPM2_PolicySecret", 0x00000151, LONG_DURATION},
-    {L"TPM2_Rewrap", 0x00000152, LONG_DURATION},                        {L"TPM2_Create", 0x00000153, LONG_DURATION},                    {L"TPM2_ECDH_ZGen", 0x00000154, LONG_DURATION},
-    {L"TPM2_HMAC", 0x00000155, LONG_DURATION},                          {L"TPM2_Import", 0x00000156, LONG_DURATION},                    {L"TPM2_Load", 0x00000157, LONG_DURATION},
-    {L"TPM2_Quote", 0x00000158, LONG_DURATION},                         {L"TPM2_RSA_Decrypt", 0x00000159, LONG_DURATION},               {L"TPM2_HMAC_Start", 0x0000015B, LONG_DURATION},
-    {L"TPM2_SequenceUpdate", 0x0000015C, LONG_DURATION},                {L"TPM2_Sign", 0x0000015D, LONG_DURATION},                      {L"TPM2_Unseal", 0x0000015E, LONG_DURATION},
-    {L"TPM2_PolicySigned", 0x00000160, LONG_DURATION},                  {L"TPM2_ContextLoad", 0x00000161, LONG_DURATION},               {L"TPM2_ContextSave", 0x00000162, LONG_DURATION},
-    {L"TPM2_ECDH_KeyGen", 0x00000163, LONG_DURATION},                   {L"TPM2_EncryptDecrypt", 0x00000164, LONG_DURATION},            {L"TPM2_FlushContext", 0x00000165, LONG_DURATION},
-    {L"TPM2_LoadExternal", 0x00000167, LONG_DURATION},                  {L"TPM2_MakeCredential", 0x00000168, LONG_DURATION},            {L"TPM2_NV_ReadPublic", 0x00000169, LONG_DURATION},
-    {L"TPM2_PolicyAuthorize", 0x0000016A, LONG_DURATION},               {L"TPM2_PolicyAuthValue", 0x0000016B, LONG_DURATION},           {L"TPM2_PolicyCommandCode", 0x0000016C, LONG_DURATION},
-    {L"TPM2_PolicyCounterTimer", 0x0000016D, LONG_DURATION},            {L"TPM2_PolicyCpHash", 0x0000016E, LONG_DURATION},              {L"TPM2_PolicyLocality", 0x0000016F, LONG_DURATION},
-    {L"TPM2_PolicyNameHash", 0x00000170, LONG_DURATION},                {L"TPM2_PolicyOR", 0x00000171, LONG_DURATION},                  {L"TPM2_PolicyTicket", 0x00000172, LONG_DURATION},
-    {L"TPM2_ReadPublic", 0x00000173, LONG_DURATION},                    {L"TPM2_RSA_Encrypt", 0x00000174, LONG_DURATION},               {L"TPM2_StartAuthSession", 0x00000176, LONG_DURATION},
-    {L"TPM2_VerifySignature", 0x00000177, LONG_DURATION},               {L"TPM2_ECC_Parameters", 0x00000178, LONG_DURATION},            {L"TPM2_FirmwareRead", 0x00000179, LONG_DURATION},
-    {L"TPM2_GetCapability", 0x0000017A, LONG_DURATION},                 {L"TPM2_GetRandom", 0x0000017B, LONG_DURATION},                 {L"TPM2_GetTestResult", 0x0000017C, LONG_DURATION},
-    {L"TPM2_Hash", 0x0000017D, LONG_DURATION},                          {L"TPM2_PCR_Read", 0x0000017E, LONG_DURATION},                  {L"TPM2_PolicyPCR", 0x0000017F, LONG_DURATION},
-    {L"TPM2_PolicyRestart", 0x00000180, LONG_DURATION},                 {L"TPM2_ReadClock", 0x00000181, LONG_DURATION},                 {L"TPM2_PCR_Extend", 0x00000182, LONG_DURATION},
-    {L"TPM2_PCR_SetAuthValue", 0x00000183, LONG_DURATION},              {L"TPM2_NV_Certify", 0x00000184, LONG_DURATION},                {L"TPM2_EventSequenceComplete", 0x00000185, LONG_DURATION},
-    {L"TPM2_HashSequenceStart", 0x00000186, LONG_DURATION},             {L"TPM2_PolicyPhysicalPresence", 0x00000187, LONG_DURATION},    {L"TPM2_PolicyDuplicationSelect", 0x00000188, LONG_DURATION},
-    {L"TPM2_PolicyGetDigest", 0x00000189, LONG_DURATION},               {L"TPM2_TestParms", 0x0000018A, LONG_DURATION},                 {L"TPM2_Commit", 0x0000018B, LONG_DURATION},
-    {L"TPM2_PolicyPassword", 0x0000018C, LONG_DURATION},                {L"TPM2_ZGen_2Phase", 0x0000018D, LONG_DURATION},               {L"TPM2_EC_Ephemeral", 0x0000018E, LONG_DURATION},
-    {L"TPM2_PolicyNvWritten", 0x0000018F, LONG_DURATION},               {L"TPM2_FieldUpgradeStartVendor", 0x2000012F, LONG_DURATION},   {L"TPM2_FieldUpgradeAbandonVendor", 0x20000130, LONG_DURATION},
-    {L"TPM2_FieldUpgradeManifestVendor", 0x20000131, LONG_DURATION},    {L"TPM2_FieldUpgradeDataVendor", 0x20000132, LONG_DURATION},    {L"TPM2_FieldUpgradeFinalizeVendor", 0x20000133, LONG_DURATION},
-    {L"TPM2_SetCapabilityVendor", 0x20000400, LONG_DURATION}
+/// List of available TPM2.0 command names and their command codes. All TPM2.0 commands use LONG_DURATION.
+/// The list must be sorted by command code in ascending order (see DeviceManagement_TpmCommandName).
+const IfxTpmCommand s_sTpm2Commands[] = {
+    {L"None", 0},                                        {L"TPM2_NV_UndefineSpaceSpecial", 0x0000011F},       {L"TPM2_EvictControl", 0x00000120},
+    {L"TPM2_HierarchyControl", 0x00000121},              {L"TPM2_NV_UndefineSpace", 0x00000122},              {L"TPM2_ChangeEPS", 0x00000124},
+    {L"TPM2_ChangePPS", 0x00000125},                     {L"TPM2_Clear", 0x00000126},                         {L"TPM2_ClearControl", 0x00000127},
+    {L"TPM2_ClockSet", 0x00000128},                      {L"TPM2_HierarchyChangeAuth", 0x00000129},           {L"TPM2_NV_DefineSpace", 0x0000012A},
+    {L"TPM2_PCR_Allocate", 0x0000012B},                  {L"TPM2_PCR_SetAuthPolicy", 0x0000012C},             {L"TPM2_PP_Commands", 0x0000012D},
+    {L"TPM2_SetPrimaryPolicy", 0x0000012E},              {L"TPM2_FieldUpgradeStart", 0x0000012F},             {L"TPM2_ClockRateAdjust", 0x00000130},
+    {L"TPM2_CreatePrimary", 0x00000131},                 {L"TPM2_NV_GlobalWriteLock", 0x00000132},            {L"TPM2_GetCommandAuditDigest", 0x00000133},
+    {L"TPM2_NV_Increment", 0x00000134},                  {L"TPM2_NV_SetBits", 0x00000135},                    {L"TPM2_NV_Extend", 0x00000136},
+    {L"TPM2_NV_Write", 0x00000137},                      {L"TPM2_NV_WriteLock", 0x00000138},                  {L"TPM2_DictionaryAttackLockReset", 0x00000139},
+    {L"TPM2_DictionaryAttackParameters", 0x0000013A},    {L"TPM2_NV_ChangeAuth", 0x0000013B},                 {L"TPM2_PCR_Event", 0x0000013C},
+    {L"TPM2_PCR_Reset", 0x0000013D},                     {L"TPM2_SequenceComplete", 0x0000013E},              {L"TPM2_SetAlgorithmSet", 0x0000013F},
+    {L"TPM2_SetCommandCodeAuditStatus", 0x00000140},     {L"TPM2_FieldUpgradeData", 0x00000141},              {L"TPM2_IncrementalSelfTest", 0x00000142},
+    {L"TPM2_SelfTest", 0x00000143},                      {L"TPM2_Startup", 0x00000144},                       {L"TPM2_Shutdown", 0x00000145},
+    {L"TPM2_StirRandom", 0x00000146},                    {L"TPM2_ActivateCredential", 0x00000147},            {L"TPM2_Certify", 0x00000148},
+    {L"TPM2_PolicyNV", 0x00000149},                      {L"TPM2_CertifyCreation", 0x0000014A},               {L"TPM2_Duplicate", 0x0000014B},
+    {L"TPM2_GetTime", 0x0000014C},                       {L"TPM2_GetSessionAuditDigest", 0x0000014D},         {L"TPM2_NV_Read", 0x0000014E},
+    {L"TPM2_NV_ReadLock", 0x0000014F},                   {L"TPM2_ObjectChangeAuth", 0x00000150},              {L"TPM2_PolicySecret", 0x00000151},
+    {L"TPM2_Rewrap", 0x00000152},                        {L"TPM2_Create", 0x00000153},                        {L"TPM2_ECDH_ZGen", 0x00000154},
+    {L"TPM2_HMAC", 0x00000155},                          {L"TPM2_Import", 0x00000156},                        {L"TPM2_Load", 0x00000157},
+    {L"TPM2_Quote", 0x00000158},                         {L"TPM2_RSA_Decrypt", 0x00000159},                   {L"TPM2_HMAC_Start", 0x0000015B},
+    {L"TPM2_SequenceUpdate", 0x0000015C},                {L"TPM2_Sign", 0x0000015D},                          {L"TPM2_Unseal", 0x0000015E},
+    {L"TPM2_PolicySigned", 0x00000160},                  {L"TPM2_ContextLoad", 0x00000161},                   {L"TPM2_ContextSave", 0x00000162},
+    {L"TPM2_ECDH_KeyGen", 0x00000163},                   {L"TPM2_EncryptDecrypt", 0x00000164},                {L"TPM2_FlushContext", 0x00000165},
+    {L"TPM2_LoadExternal", 0x00000167},                  {L"TPM2_MakeCredential", 0x00000168},                {L"TPM2_NV_ReadPublic", 0x00000169},
+    {L"TPM2_PolicyAuthorize", 0x0000016A},               {L"TPM2_PolicyAuthValue", 0x0000016B},               {L"TPM2_PolicyCommandCode", 0x0000016C},
+    {L"TPM2_PolicyCounterTimer", 0x0000016D},            {L"TPM2_PolicyCpHash", 0x0000016E},                  {L"TPM2_PolicyLocality", 0x0000016F},
+    {L"TPM2_PolicyNameHash", 0x00000170},                {L"TPM2_PolicyOR", 0x00000171},                      {L"TPM2_PolicyTicket", 0x00000172},
+    {L"TPM2_ReadPublic", 0x00000173},                    {L"TPM2_RSA_Encrypt", 0x00000174},                   {L"TPM2_StartAuthSession", 0x00000176},
+    {L"TPM2_VerifySignature", 0x00000177},               {L"TPM2_ECC_Parameters", 0x00000178},                {L"TPM2_FirmwareRead", 0x00000179},
+    {L"TPM2_GetCapability", 0x0000017A},                 {L"TPM2_GetRandom", 0x0000017B},                     {L"TPM2_GetTestResult", 0x0000017C},
+    {L"TPM2_Hash", 0x0000017D},                          {L"TPM2_PCR_Read", 0x0000017E},                      {L"TPM2_PolicyPCR", 0x0000017F},
+    {L"TPM2_PolicyRestart", 0x00000180},                 {L"TPM2_ReadClock", 0x00000181},                     {L"TPM2_PCR_Extend", 0x00000182},
+    {L"TPM2_PCR_SetAuthValue", 0x00000183},              {L"TPM2_NV_Certify", 0x00000184},                    {L"TPM2_EventSequenceComplete", 0x00000185},
+    {L"TPM2_HashSequenceStart", 0x00000186},             {L"TPM2_PolicyPhysicalPresence", 0x00000187},        {L"TPM2_PolicyDuplicationSelect", 0x00000188},
+    {L"TPM2_PolicyGetDigest", 0x00000189},               {L"TPM2_TestParms", 0x0000018A},                     {L"TPM2_Commit", 0x0000018B},
+    {L"TPM2_PolicyPassword", 0x0000018C},                {L"TPM2_ZGen_2Phase", 0x0000018D},                   {L"TPM2_EC_Ephemeral", 0x0000018E},
+    {L"TPM2_PolicyNvWritten", 0x0000018F},               {L"TPM2_FieldUpgradeStartVendor", 0x2000012F},       {L"TPM2_FieldUpgradeAbandonVendor", 0x20000130},
+    {L"TPM2_FieldUpgradeManifestVendor", 0x20000131},    {L"TPM2_FieldUpgradeDataVendor", 0x20000132},        {L"TPM2_FieldUpgradeFinalizeVendor", 0x20000133},
+    {L"TPM2_SetCapabilityVendor", 0x20000400}
 };
 
 /**
@@ -134,9 +307,15 @@ DeviceManagement_Initialize()
         // Initialize the TPM IO Function pointers
         s_fpTpmIoConnect        = &TPMIO_Connect;
         s_fpTpmIoDisconnect     = &TPMIO_Disconnect;
+        s_fpTpmIoRevalidate     = &TPMIO_Revalidate;
         s_fpTpmIoTransmit       = &TPMIO_Transmit;
+        s_fpTpmIoSend           = &TPMIO_Send;
+        s_fpTpmIoReceive        = &TPMIO_Receive;
+        s_fpTpmIoPoll           = &TPMIO_Poll;
         s_fpTpmIoReadRegister   = &TPMIO_ReadRegister;
         s_fpTpmIoWriteRegister  = &TPMIO_WriteRegister;
+        s_fpTpmIoGetLastPhaseTiming = &TPMIO_GetLastPhaseTiming;
+        s_fpTpmIoGetInterfaceInfo = &TPMIO_GetInterfaceInfo;
         s_fInitialized = TRUE;
     }
 
@@ -156,9 +335,15 @@ DeviceManagement_Uninitialize()
         // Uninitialize the TPM IO Function pointers
         s_fpTpmIoConnect        = NULL;
         s_fpTpmIoDisconnect     = NULL;
+        s_fpTpmIoRevalidate     = NULL;
         s_fpTpmIoTransmit       = NULL;
+        s_fpTpmIoSend           = NULL;
+        s_fpTpmIoReceive        = NULL;
+        s_fpTpmIoPoll           = NULL;
         s_fpTpmIoReadRegister   = NULL;
         s_fpTpmIoWriteRegister  = NULL;
+        s_fpTpmIoGetLastPhaseTiming = NULL;
+        s_fpTpmIoGetInterfaceInfo = NULL;
         s_fInitialized = FALSE;
     }
 }
@@ -230,6 +415,7 @@ DeviceManagement_Connect()
             }
 
             s_fTpmConnected = TRUE;
+            DeviceManagement_InvalidateTpmState();
         }
         unReturnValue = RC_SUCCESS;
     }
@@ -280,6 +466,8 @@ DeviceManagement_Disconnect()
             }
 
             s_fTpmConnected = FALSE;
+            s_fCommandPending = FALSE;
+            DeviceManagement_InvalidateTpmState();
         }
         unReturnValue = RC_SUCCESS;
     }
@@ -291,28 +479,21 @@ DeviceManagement_Disconnect()
 }
 
 /**
- *  @brief      Device transmit function
- *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface).
- *
- *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
- *  @param      PunRequestBufferSize    Size of command request in bytes.
- *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
- *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @brief      Revalidate the connection to the TPM
+ *  @details    Lightweight alternative to DeviceManagement_Disconnect and DeviceManagement_Connect after the TPM may have
+ *              restarted. The initialized device access and the connection configuration are kept, only the access
+ *              registers and the active locality are checked again (see TPMIO_Revalidate). A full reconnect is done if
+ *              the TPM is not connected or the revalidation fails for another reason than the TPM not responding yet.
+ *              Cached TPM state information is invalidated.
  *
- *  @retval     RC_SUCCESS              The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
- *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
- *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
- *  @retval     RC_E_FAIL               An unexpected error occurred.
- *  @retval ...                         Error codes from s_fpTpmIoTransmit function.
+ *  @retval     RC_SUCCESS              The operation completed successfully, the TPM is connected.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_NOT_READY          The TPM does not respond yet, the connection is kept.
+ *  @retval     ...                     Error codes from DeviceManagement_Connect function.
  */
 _Check_return_
 unsigned int
-DeviceManagement_Transmit(
-    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
-    _In_                                        unsigned int    PunRequestBufferSize,
-    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
-    _Inout_                                     unsigned int*   PpunResponseBufferSize)
+DeviceManagement_Revalidate()
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
@@ -320,166 +501,2110 @@ DeviceManagement_Transmit(
 
     do
     {
-        unsigned int unCommandCode = 0;
-        unsigned int unTisMaxDuration = LONG_DURATION;
-
-        // Check parameters
-        if (NULL == PrgbRequestBuffer || NULL == PrgbResponseBuffer)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpbRequestBuffer or PpunResponseBufferSize is NULL)");
-            break;
-        }
-        if (0 == PunRequestBufferSize || 0 == PpunResponseBufferSize)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter PunRequestBufferSize or PpunResponseBufferSize has invalid value 0");
-            break;
-        }
-
-        // Check if module is initialized
+        // Check if Module is initialized
         if (FALSE == DeviceManagement_IsInitialized())
         {
-            // Set error code and fill error object
             unReturnValue = RC_E_NOT_INITIALIZED;
             ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
             break;
         }
 
-        // Check if TPMIO is connected
-        if (FALSE == DeviceManagement_IsConnected())
-        {
-            unReturnValue = RC_E_NOT_CONNECTED;
-            ERROR_STORE(unReturnValue, L"TPM not connected");
-            break;
-        }
-
-        // Check if the request buffer holds at least enough bytes for the command length and code
-        if (PunRequestBufferSize >= 10)
+        if (TRUE == DeviceManagement_IsConnected())
         {
-            unsigned int unShiftedCommandCode = 0;
-            // Get TPM command code
-            unReturnValue = Platform_MemoryCopy(&unCommandCode, sizeof(unCommandCode), (const void*) &PrgbRequestBuffer[6], sizeof(unsigned int));
-            if (RC_SUCCESS != unReturnValue)
+            unReturnValue = s_fpTpmIoRevalidate();
+            if (RC_SUCCESS == unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"Unexpected return value from function call Platform_MemoryCopy");
+                // A response pending before the restart is lost
+                s_fCommandPending = FALSE;
+                DeviceManagement_InvalidateTpmState();
                 break;
             }
-            // Switch command code endianness
-            unShiftedCommandCode = Platform_SwapBytes32(unCommandCode);
-            // Output the corresponding command name
-            DeviceManagement_TpmCommandName(unShiftedCommandCode, &unTisMaxDuration);
-        }
-        else
-        {
-            LOGGING_WRITE_LEVEL3(L"Sending unknown or invalid TPM Command");
+            if (RC_E_NOT_READY == unReturnValue)
+                break;
+
+            LOGGING_WRITE_LEVEL2_FMT(L"TPMIO_Revalidate failed (0x%.8X). Reconnecting to the TPM.", unReturnValue);
+            unReturnValue = DeviceManagement_Disconnect();
+            if (RC_SUCCESS != unReturnValue)
+                LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_Disconnect failed (0x%.8X). Continue reconnecting.", unReturnValue);
         }
 
-        LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Transmit: Sending:  TxLen = %4d", PunRequestBufferSize);
-        LOGGING_WRITEHEX_LEVEL3(PrgbRequestBuffer, PunRequestBufferSize);
+        unReturnValue = DeviceManagement_Connect();
+    }
+    WHILE_FALSE_END;
 
-        // Cache the request for troubleshooting and clear the last TPM response cache
-        unReturnValue = Platform_MemoryCopy(g_rgbLastRequest, sizeof(g_rgbLastRequest), PrgbRequestBuffer, PunRequestBufferSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        g_unSizeLastRequest = PunRequestBufferSize;
-        g_unSizeLastResponse = 0;
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
 
-        unReturnValue = s_fpTpmIoTransmit(
-                            PrgbRequestBuffer,
-                            PunRequestBufferSize,
-                            PrgbResponseBuffer,
-                            PpunResponseBufferSize,
-                            unTisMaxDuration);
-        if (RC_SUCCESS != unReturnValue)
-        {
-            ERROR_STORE(unReturnValue, L"Error during TpmIOTransmit");
+    return unReturnValue;
+}
 
-            // Log the last TPM command/response for troubleshooting
-            LOGGING_WRITE_LEVEL1(L"Last TPM command:");
-            LOGGING_WRITEHEX_LEVEL1(g_rgbLastRequest, g_unSizeLastRequest);
-            LOGGING_WRITE_LEVEL1(L"Last TPM response:");
-            LOGGING_WRITEHEX_LEVEL1(g_rgbLastResponse, g_unSizeLastResponse);
+/**
+ *  @brief      Track the usage of the command context buffers
+ *  @details    If the buffer belongs to the borrowed command context, the number of used bytes is recorded, so only
+ *              those bytes are cleared on release.
+ *
+ *  @param      PpbBuffer               Request or response buffer passed to the TPM access module.
+ *  @param      PunSize                 Number of bytes used in the buffer.
+ */
+void
+DeviceManagement_TrackCommandContextUsage(
+    _In_    const BYTE*     PpbBuffer,
+    _In_    unsigned int    PunSize)
+{
+    if (!s_sCommandContext.fInUse)
+        return;
 
-            break;
-        }
+    if (PpbBuffer == s_sCommandContext.rgbRequest && PunSize <= sizeof(s_sCommandContext.rgbRequest))
+        s_sCommandContext.unRequestSize = PunSize;
+    else if (PpbBuffer == s_sCommandContext.rgbResponse && PunSize <= sizeof(s_sCommandContext.rgbResponse))
+        s_sCommandContext.unResponseSize = PunSize;
+}
+
+/**
+ *  @brief      Check whether a TPM command leaves the TPM state unchanged
+ *  @details
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *
+ *  @retval     TRUE    The command is listed in s_rgunTpmReadOnlyCommands.
+ *  @retval     FALSE   The command may change the TPM state.
+ */
+static
+BOOL
+DeviceManagement_IsReadOnlyCommand(
+    _In_    unsigned int    PunCommandCode)
+{
+    unsigned int unIndex = 0;
 
-        LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Transmit: Received:  RxLen = %4d", *PpunResponseBufferSize);
-        LOGGING_WRITEHEX_LEVEL3(PrgbResponseBuffer, *PpunResponseBufferSize);
+    for (unIndex = 0; unIndex < RG_LEN(s_rgunTpmReadOnlyCommands); unIndex++)
+    {
+        if (s_rgunTpmReadOnlyCommands[unIndex] == PunCommandCode)
+            return TRUE;
+    }
 
-        // Cache the response for troubleshooting
-        unReturnValue = Platform_MemoryCopy(g_rgbLastResponse, sizeof(g_rgbLastResponse), PrgbResponseBuffer, *PpunResponseBufferSize);
-        if (RC_SUCCESS != unReturnValue)
+    return FALSE;
+}
+
+/**
+ *  @brief      Check whether the caller may issue TPM commands
+ *  @details    A caller which has interrupted the holder of the TPM on a higher execution level must not issue commands,
+ *              they would interleave with the commands of the holder.
+ *
+ *  @retval     TRUE    The caller may issue TPM commands.
+ *  @retval     FALSE   The TPM is held by an interrupted producer.
+ */
+static
+BOOL
+DeviceManagement_IsAccessAllowed()
+{
+    return 0 == s_unAccessDepth || Platform_GetExecutionLevel() <= s_unAccessLevel;
+}
+
+/**
+ *  @brief      Check whether a TPM command may be sent again after a transport error
+ *  @details    A command is sent again only if it is listed in s_rgunTpmResendableCommands and the error is a transient
+ *              transport error. The TIS layer aborts a command whose transfer failed and waits for commandReady before the
+ *              next command is sent.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PunReturnValue          Error code of the TPM access module.
+ *
+ *  @retval     TRUE    The command may be sent again.
+ *  @retval     FALSE   The error must be returned to the caller.
+ */
+static
+BOOL
+DeviceManagement_IsRetryable(
+    _In_    unsigned int    PunCommandCode,
+    _In_    unsigned int    PunReturnValue)
+{
+    unsigned int unIndex = 0;
+
+    switch (PunReturnValue)
+    {
+        case RC_E_LOCALITY_NOT_ACTIVE:
+        case RC_E_TPM_NO_DATA_AVAILABLE:
+        case RC_E_TPM_RECEIVE_DATA:
+        case RC_E_TPM_TRANSMIT_DATA:
+        case RC_E_NOT_READY:
+        case RC_E_BUS_ERROR:
             break;
-        g_unSizeLastResponse = *PpunResponseBufferSize;
+        default:
+            return FALSE;
     }
-    WHILE_FALSE_END;
 
-    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+    for (unIndex = 0; unIndex < RG_LEN(s_rgunTpmResendableCommands); unIndex++)
+    {
+        if (s_rgunTpmResendableCommands[unIndex] == PunCommandCode)
+            return TRUE;
+    }
 
-    return unReturnValue;
+    return FALSE;
+}
+
+/**
+ *  @brief      Check whether a TPM2.0 command may be sent again after a transient TPM warning
+ *  @details    Only commands without sessions (tag TPM_ST_NO_SESSIONS) are sent again, the session state of other commands
+ *              is left to the caller. The response must consist of the response header only.
+ *
+ *  @param      PrgbRequest             TPM command request, at least the command header.
+ *  @param      PunRequestSize          Size of the request in bytes.
+ *  @param      PrgbResponse            TPM command response.
+ *  @param      PunResponseSize         Size of the response in bytes.
+ *
+ *  @returns    The TPM warning code if the command may be sent again, 0 otherwise.
+ */
+static
+unsigned int
+DeviceManagement_GetResendableWarning(
+    _In_bytecount_(PunRequestSize)  const BYTE*     PrgbRequest,
+    _In_                            unsigned int    PunRequestSize,
+    _In_bytecount_(PunResponseSize) const BYTE*     PrgbResponse,
+    _In_                            unsigned int    PunResponseSize)
+{
+    unsigned int unResponseCode = 0;
+    unsigned int unIndex = 0;
+
+    if (NULL == PrgbRequest || NULL == PrgbResponse || PunRequestSize < 10 || 10 != PunResponseSize)
+        return 0;
+
+    // TPM_ST_NO_SESSIONS
+    if (0x80 != PrgbRequest[0] || 0x01 != PrgbRequest[1])
+        return 0;
+
+    unResponseCode = ((unsigned int)PrgbResponse[6] << 24) | ((unsigned int)PrgbResponse[7] << 16) |
+                     ((unsigned int)PrgbResponse[8] << 8) | (unsigned int)PrgbResponse[9];
+    for (unIndex = 0; unIndex < RG_LEN(s_rgunTpmTransientWarnings); unIndex++)
+    {
+        if (s_rgunTpmTransientWarnings[unIndex] == unResponseCode)
+            return unResponseCode;
+    }
+
+    return 0;
 }
 
 /**
- *  @brief      Function to output TPM command name and return the duration.
- *  @details    This function determines the TPM command name from the command ordinal and puts it to the log file.
+ *  @brief      Invalidate cached TPM state information if a TPM command may change the TPM state
+ *  @details
  *
  *  @param      PunCommandCode          TPM command ordinal.
- *  @param      PpunMaxDuration         Maximum command duration in microseconds (relevant for memory based access / TIS protocol only).
  */
+static
 void
-DeviceManagement_TpmCommandName(
+DeviceManagement_TrackTpmStateChange(
+    _In_    unsigned int    PunCommandCode)
+{
+    if (!DeviceManagement_IsReadOnlyCommand(PunCommandCode))
+        DeviceManagement_InvalidateTpmState();
+}
+
+/**
+ *  @brief      Build the property key of the calibrated duration of a TPM command
+ *  @details
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PwszKey                 Buffer receiving the key.
+ *  @param      PunKeyCapacity          Capacity of the buffer in elements.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     ...                     Error codes from Platform_StringFormat.
+ */
+static
+unsigned int
+DeviceManagement_GetCommandDurationKey(
+    _In_                            unsigned int    PunCommandCode,
+    _Out_z_cap_(PunKeyCapacity)     wchar_t*        PwszKey,
+    _In_                            unsigned int    PunKeyCapacity)
+{
+    return Platform_StringFormat(PwszKey, &PunKeyCapacity, L"%ls%.8X", PROPERTY_COMMAND_DURATION_PREFIX, PunCommandCode);
+}
+
+/**
+ *  @brief      Apply the calibrated duration of a TPM command
+ *  @details    If a duration has been calibrated for the command code on the attached TPM, the maximum duration is
+ *              reduced to a multiple of it (but not below CALIBRATED_DURATION_MIN) and the calibrated duration is returned
+ *              as the expected duration. While calibration is active the maximum duration is kept, so the calibration
+ *              is not limited by earlier results.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PpunMaxDuration         In: Maximum command duration from the command table, out: maximum command duration to use.
+ *  @param      PpunExpectedDuration    Expected command duration in microseconds, 0 if not calibrated.
+ */
+static
+void
+DeviceManagement_ApplyCalibratedDuration(
     _In_    unsigned int    PunCommandCode,
-    _Out_   unsigned int*   PpunMaxDuration)
+    _Inout_ unsigned int*   PpunMaxDuration,
+    _Out_   unsigned int*   PpunExpectedDuration)
 {
-    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+    wchar_t wszKey[MAX_NAME + 1];
+    unsigned int unCalibratedDuration = 0;
+    unsigned long long ullMaxDuration = 0;
+    BOOL fCalibrate = FALSE;
 
-    do
+    *PpunExpectedDuration = 0;
+
+    Platform_MemorySet(wszKey, 0, sizeof(wszKey));
+    if (RC_SUCCESS != DeviceManagement_GetCommandDurationKey(PunCommandCode, wszKey, RG_LEN(wszKey)))
+        return;
+    if (!PropertyStorage_GetUIntegerValueByKey(wszKey, &unCalibratedDuration) || 0 == unCalibratedDuration)
+        return;
+
+    *PpunExpectedDuration = unCalibratedDuration;
+
+    if (PropertyStorage_GetBooleanValueByKey(PROPERTY_CALIBRATE_COMMAND_DURATIONS, &fCalibrate) && fCalibrate)
+        return;
+
+    ullMaxDuration = (unsigned long long)unCalibratedDuration * CALIBRATED_DURATION_FACTOR;
+    if (ullMaxDuration < CALIBRATED_DURATION_MIN)
+        ullMaxDuration = CALIBRATED_DURATION_MIN;
+    if (ullMaxDuration < *PpunMaxDuration)
+        *PpunMaxDuration = (unsigned int)ullMaxDuration;
+}
+
+/**
+ *  @brief      Calibrate the duration of a TPM command
+ *  @details    If calibration is active, the processing time of a successful command is stored in PropertyStorage
+ *              as calibrated duration of its command code if it exceeds the value calibrated so far.
+ *              The processing time is the latency minus the durations of the send and receive phases. It includes the
+ *              time between sending and receiving a pipelined command, which keeps the calibration on the safe side.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PullLatencyUs           Latency of the command in microseconds.
+ *  @param      PpsTiming               Phase durations of the command.
+ */
+static
+void
+DeviceManagement_CalibrateDuration(
+    _In_    unsigned int            PunCommandCode,
+    _In_    unsigned long long      PullLatencyUs,
+    _In_    const TPM_PHASE_TIMING* PpsTiming)
+{
+    wchar_t wszKey[MAX_NAME + 1];
+    unsigned int unCalibratedDuration = 0;
+    unsigned long long ullTransferUs = PpsTiming->ullSendUs + PpsTiming->ullReceiveUs;
+    unsigned long long ullDurationUs = 0;
+    BOOL fCalibrate = FALSE;
+
+    if (!PropertyStorage_GetBooleanValueByKey(PROPERTY_CALIBRATE_COMMAND_DURATIONS, &fCalibrate) || !fCalibrate)
+        return;
+
+    ullDurationUs = (PullLatencyUs > ullTransferUs) ? PullLatencyUs - ullTransferUs : 1;
+    if (ullDurationUs > LONG_DURATION)
+        ullDurationUs = LONG_DURATION;
+
+    Platform_MemorySet(wszKey, 0, sizeof(wszKey));
+    if (RC_SUCCESS != DeviceManagement_GetCommandDurationKey(PunCommandCode, wszKey, RG_LEN(wszKey)))
+        return;
+    if (PropertyStorage_GetUIntegerValueByKey(wszKey, &unCalibratedDuration) && unCalibratedDuration >= ullDurationUs)
+        return;
+
+    if (!PropertyStorage_SetUIntegerValueByKey(wszKey, (unsigned int)ullDurationUs))
+        LOGGING_WRITE_LEVEL2_FMT(L"Calibrated duration of TPM command 0x%.8X could not be stored", PunCommandCode);
+}
+
+/**
+ *  @brief      Add a TPM command to the command history
+ *  @details    Overwrites the oldest entry. Only the leading bytes of the request are copied.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PrgbRequest             Leading bytes of the request.
+ *  @param      PunAvailable            Number of bytes available at PrgbRequest.
+ *  @param      PunRequestSize          Size of the complete request in bytes.
+ */
+static
+void
+DeviceManagement_HistoryAdd(
+    _In_                            unsigned int    PunCommandCode,
+    _In_bytecount_(PunAvailable)    const BYTE*     PrgbRequest,
+    _In_                            unsigned int    PunAvailable,
+    _In_                            unsigned int    PunRequestSize)
+{
+    DEVICE_MANAGEMENT_HISTORY_ENTRY* psEntry = &s_rgsHistory[s_unHistoryCount % DEVICE_MANAGEMENT_HISTORY_SIZE];
+
+    Platform_MemorySet(psEntry, 0, sizeof(*psEntry));
+    psEntry->unCommandCode = PunCommandCode;
+    psEntry->unRequestSize = PunRequestSize;
+    psEntry->unReturnValue = RC_E_TPM_NO_DATA_AVAILABLE;
+    IGNORE_RETURN_VALUE(Platform_MemoryCopy(psEntry->rgbRequest, sizeof(psEntry->rgbRequest), PrgbRequest, MIN(PunAvailable, sizeof(psEntry->rgbRequest))));
+    s_unHistoryCount++;
+}
+
+/**
+ *  @brief      Complete the newest entry of the command history
+ *  @details    Only the leading bytes of the response are copied.
+ *
+ *  @param      PunReturnValue          Return code of the TPM access module.
+ *  @param      PullStartTicks          Tick count taken before the command was passed to the TPM access module.
+ *  @param      PrgbResponse            Response, may be NULL if PunResponseSize is zero.
+ *  @param      PunResponseSize         Size of the response in bytes.
+ */
+static
+void
+DeviceManagement_HistoryComplete(
+    _In_                                unsigned int        PunReturnValue,
+    _In_                                unsigned long long  PullStartTicks,
+    _In_bytecount_(PunResponseSize)     const BYTE*         PrgbResponse,
+    _In_                                unsigned int        PunResponseSize)
+{
+    DEVICE_MANAGEMENT_HISTORY_ENTRY* psEntry = NULL;
+
+    if (0 == s_unHistoryCount)
+        return;
+
+    psEntry = &s_rgsHistory[(s_unHistoryCount - 1) % DEVICE_MANAGEMENT_HISTORY_SIZE];
+    psEntry->unReturnValue = PunReturnValue;
+    psEntry->ullDurationUs = Platform_TicksToMicroseconds(Platform_GetTicks() - PullStartTicks);
+    if (RC_SUCCESS == PunReturnValue && NULL != PrgbResponse)
+    {
+        psEntry->unResponseSize = PunResponseSize;
+        IGNORE_RETURN_VALUE(Platform_MemoryCopy(psEntry->rgbResponse, sizeof(psEntry->rgbResponse), PrgbResponse, MIN(PunResponseSize, sizeof(psEntry->rgbResponse))));
+    }
+}
+
+/**
+ *  @brief      Log the command history
+ *  @details    Logs the recorded TPM commands from the oldest to the newest one.
+ */
+static
+void
+DeviceManagement_HistoryLog()
+{
+    unsigned int unIndex = s_unHistoryCount > DEVICE_MANAGEMENT_HISTORY_SIZE ? s_unHistoryCount - DEVICE_MANAGEMENT_HISTORY_SIZE : 0;
+
+    LOGGING_WRITE_LEVEL1_FMT(L"Last %d TPM command(s):", s_unHistoryCount - unIndex);
+    for (; unIndex < s_unHistoryCount; unIndex++)
     {
-        unsigned int unIndex = 0, unMaxCount = 0;
-        IfxTpmCommand* prgTpmCommands = NULL;
+        const DEVICE_MANAGEMENT_HISTORY_ENTRY* psEntry = &s_rgsHistory[unIndex % DEVICE_MANAGEMENT_HISTORY_SIZE];
+        LOGGING_WRITE_LEVEL1_FMT(L"#%d: 0x%.8X TxLen = %d RxLen = %d result 0x%.8X after %llu us",
+            unIndex, psEntry->unCommandCode, psEntry->unRequestSize, psEntry->unResponseSize, psEntry->unReturnValue, psEntry->ullDurationUs);
+        LOGGING_WRITEHEX_LEVEL1(psEntry->rgbRequest, MIN(psEntry->unRequestSize, sizeof(psEntry->rgbRequest)));
+        if (0 != psEntry->unResponseSize)
+            LOGGING_WRITEHEX_LEVEL1(psEntry->rgbResponse, MIN(psEntry->unResponseSize, sizeof(psEntry->rgbResponse)));
+    }
 
-        // Initialize output parameters
-        *PpunMaxDuration = LONG_DURATION;
+    // Log the commands following a failure in full again
+    s_unLogSampleRunLength = 0;
+}
 
-        // Determine if it is a TPM1.2 or TPM2.0 command code
-        if (PunCommandCode & 0x00000100)
-        {
-            // TPM2.0 command code
-            prgTpmCommands = s_sTpm2Commands;
-            unMaxCount = sizeof(s_sTpm2Commands) / sizeof(IfxTpmCommand);
-        }
-        else
-        {
-            // TPM1.2 command code
-            prgTpmCommands = s_sTpm1Commands;
-            unMaxCount = sizeof(s_sTpm1Commands) / sizeof(IfxTpmCommand);
-        }
+/**
+ *  @brief      Log a summary line of the current run of identical command codes
+ *  @details
+ */
+static
+void
+DeviceManagement_LogSampleSummary()
+{
+    LOGGING_WRITE_LEVEL3_FMT(L"TPM command 0x%.8X: %d command(s), %llu bytes, average latency %llu us",
+        s_unLogSampleCommandCode, s_unLogSampleRunLength, s_ullLogSampleBytes, 0 != s_unLogSampleRunLength ? s_ullLogSampleTotalUs / s_unLogSampleRunLength : 0);
+}
 
-        // Check for a known command code and eventually print out the command name
-        do
+/**
+ *  @brief      Decide whether a TPM command is logged in full
+ *  @details    Repetitive commands like the firmware blocks of an update would produce thousands of log lines at logging
+ *              level 3. For a run of identical command codes the first DEVICE_MANAGEMENT_LOG_SAMPLE_HEAD commands are logged
+ *              in full, the following ones only by a summary line every DEVICE_MANAGEMENT_LOG_SAMPLE_PERIOD commands. When
+ *              the run ends a final summary line and the command history entries of the last
+ *              DEVICE_MANAGEMENT_LOG_SAMPLE_TAIL commands are logged. Failed commands are always logged in full at level 1.
+ *              Must be called before the command is added to the command history.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ */
+static
+void
+DeviceManagement_LogSampleBegin(
+    _In_    unsigned int    PunCommandCode)
+{
+    if (PunCommandCode != s_unLogSampleCommandCode || 0 == s_unLogSampleRunLength)
+    {
+        // Close the previous run, the history still holds its last commands
+        if (s_unLogSampleRunLength > DEVICE_MANAGEMENT_LOG_SAMPLE_HEAD)
         {
-            if (prgTpmCommands[unIndex].unCommandCode == PunCommandCode)
+            unsigned int unTail = MIN(MIN(DEVICE_MANAGEMENT_LOG_SAMPLE_TAIL, s_unLogSampleRunLength - DEVICE_MANAGEMENT_LOG_SAMPLE_HEAD), MIN(DEVICE_MANAGEMENT_HISTORY_SIZE, s_unHistoryCount));
+            unsigned int unIndex = 0;
+
+            DeviceManagement_LogSampleSummary();
+            for (unIndex = s_unHistoryCount - unTail; unIndex < s_unHistoryCount; unIndex++)
             {
-                *PpunMaxDuration = prgTpmCommands[unIndex].unMaxDuration;
-                LOGGING_WRITE_LEVEL3_FMT(L"Sending TPM Command: %ls", prgTpmCommands[unIndex].pwszCommandName);
-                break;
+                const DEVICE_MANAGEMENT_HISTORY_ENTRY* psEntry = &s_rgsHistory[unIndex % DEVICE_MANAGEMENT_HISTORY_SIZE];
+                LOGGING_WRITE_LEVEL3_FMT(L"#%d: 0x%.8X TxLen = %d RxLen = %d result 0x%.8X after %llu us",
+                    unIndex, psEntry->unCommandCode, psEntry->unRequestSize, psEntry->unResponseSize, psEntry->unReturnValue, psEntry->ullDurationUs);
+                LOGGING_WRITEHEX_LEVEL3(psEntry->rgbRequest, MIN(psEntry->unRequestSize, sizeof(psEntry->rgbRequest)));
+                if (0 != psEntry->unResponseSize)
+                    LOGGING_WRITEHEX_LEVEL3(psEntry->rgbResponse, MIN(psEntry->unResponseSize, sizeof(psEntry->rgbResponse)));
             }
-            unIndex++;
         }
-        while(unIndex < unMaxCount);
 
-        // Print a warning message in case command code was not found
-        if (unIndex == unMaxCount)
+        s_unLogSampleCommandCode = PunCommandCode;
+        s_unLogSampleRunLength = 0;
+        s_ullLogSampleBytes = 0;
+        s_ullLogSampleTotalUs = 0;
+    }
+
+    s_unLogSampleRunLength++;
+    s_fLogCommandDetail = (s_unLogSampleRunLength <= DEVICE_MANAGEMENT_LOG_SAMPLE_HEAD);
+}
+
+/**
+ *  @brief      Logs the name of the TPM command being sent
+ *  @details    The name is only looked up if the command is logged in full at the current logging level.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ */
+static
+void
+DeviceManagement_LogCommandName(
+    _In_    unsigned int    PunCommandCode)
+{
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_3
+    const wchar_t* pwszCommandName = NULL;
+
+    if (!s_fLogCommandDetail || LOGGING_LEVEL_3 > g_unLoggingLevel)
+        return;
+
+    pwszCommandName = DeviceManagement_TpmCommandName(PunCommandCode);
+    if (NULL != pwszCommandName)
+    {
+        LOGGING_WRITE_LEVEL3_FMT(L"Sending TPM Command: %ls", pwszCommandName);
+    }
+    else
+    {
+        LOGGING_WRITE_LEVEL3(L"Sending unknown TPM Command");
+    }
+#else
+    UNREFERENCED_PARAMETER(PunCommandCode);
+#endif
+}
+
+/**
+ *  @brief      Account a completed TPM command to the current run of identical command codes
+ *  @details    Logs the periodic summary line while the commands of the run are not logged in full.
+ *
+ *  @param      PunBytes                Number of request and response bytes.
+ *  @param      PullStartTicks          Tick count taken before the command was passed to the TPM access module.
+ */
+static
+void
+DeviceManagement_LogSampleComplete(
+    _In_    unsigned int        PunBytes,
+    _In_    unsigned long long  PullStartTicks)
+{
+    s_ullLogSampleBytes += PunBytes;
+    s_ullLogSampleTotalUs += Platform_TicksToMicroseconds(Platform_GetTicks() - PullStartTicks);
+
+    if (!s_fLogCommandDetail && 0 == s_unLogSampleRunLength % DEVICE_MANAGEMENT_LOG_SAMPLE_PERIOD)
+        DeviceManagement_LogSampleSummary();
+}
+
+/**
+ *  @brief      Returns the latency statistics entry of a TPM command code
+ *  @details    A new entry is added for a command code without statistics.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *
+ *  @returns    The entry or NULL if the statistics table is full.
+ */
+static
+DEVICE_MANAGEMENT_COMMAND_LATENCY*
+DeviceManagement_GetLatencyEntry(
+    _In_    unsigned int    PunCommandCode)
+{
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; unIndex < s_sLatencyStatistics.unCommandCount; unIndex++)
+    {
+        if (s_sLatencyStatistics.rgsCommands[unIndex].unCommandCode == PunCommandCode)
+            return &s_sLatencyStatistics.rgsCommands[unIndex];
+    }
+
+    if (s_sLatencyStatistics.unCommandCount >= DEVICE_MANAGEMENT_LATENCY_COMMAND_COUNT)
+        return NULL;
+
+    s_sLatencyStatistics.rgsCommands[s_sLatencyStatistics.unCommandCount].unCommandCode = PunCommandCode;
+    return &s_sLatencyStatistics.rgsCommands[s_sLatencyStatistics.unCommandCount++];
+}
+
+/**
+ *  @brief      Record the latency of a TPM command
+ *  @details    This function adds the elapsed time since PullStartTicks and the phase durations reported by the TPM
+ *              access module to the statistics of the command code.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PullStartTicks          Tick count taken before the command was passed to the TPM access module.
+ *  @param      PfSucceeded             TRUE if the TPM access module completed the command successfully.
+ */
+static
+void
+DeviceManagement_RecordLatency(
+    _In_    unsigned int        PunCommandCode,
+    _In_    unsigned long long  PullStartTicks,
+    _In_    BOOL                PfSucceeded)
+{
+    unsigned long long ullLatencyUs = Platform_TicksToMicroseconds(Platform_GetTicks() - PullStartTicks);
+    unsigned long long ullBucketBoundUs = DEVICE_MANAGEMENT_LATENCY_FIRST_BUCKET_US;
+    unsigned int unBucket = 0;
+    DEVICE_MANAGEMENT_COMMAND_LATENCY* psLatency = NULL;
+    TPM_PHASE_TIMING sTiming;
+
+    Platform_MemorySet(&sTiming, 0, sizeof(sTiming));
+    if (NULL == s_fpTpmIoGetLastPhaseTiming || RC_SUCCESS != s_fpTpmIoGetLastPhaseTiming(&sTiming))
+        Platform_MemorySet(&sTiming, 0, sizeof(sTiming));
+
+    if (PfSucceeded)
+        DeviceManagement_CalibrateDuration(PunCommandCode, ullLatencyUs, &sTiming);
+
+    // Look up the entry of the command code or add a new one
+    psLatency = DeviceManagement_GetLatencyEntry(PunCommandCode);
+    if (NULL == psLatency)
+    {
+        s_sLatencyStatistics.unDroppedCount++;
+        return;
+    }
+
+    psLatency->unCount++;
+    if (!PfSucceeded)
+        psLatency->unFailures++;
+    if (1 == psLatency->unCount || ullLatencyUs < psLatency->ullMinUs)
+        psLatency->ullMinUs = ullLatencyUs;
+    if (ullLatencyUs > psLatency->ullMaxUs)
+        psLatency->ullMaxUs = ullLatencyUs;
+    psLatency->ullTotalUs += ullLatencyUs;
+    psLatency->ullSendUs += sTiming.ullSendUs;
+    psLatency->ullWaitUs += sTiming.ullWaitUs;
+    psLatency->ullReceiveUs += sTiming.ullReceiveUs;
+
+    // Find the first bucket whose upper bound exceeds the latency
+    while (unBucket < DEVICE_MANAGEMENT_LATENCY_BUCKET_COUNT - 1 && ullLatencyUs >= ullBucketBoundUs)
+    {
+        ullBucketBoundUs <<= 1;
+        unBucket++;
+    }
+    psLatency->rgunHistogram[unBucket]++;
+}
+
+/**
+ *  @brief      Apply the stall deadline to a TPM command
+ *  @details    If the stall detector monitors the command code and has observed enough latencies, the maximum duration
+ *              is reduced to STALL_DETECTOR_FACTOR times the median latency (but not below STALL_DETECTOR_MIN_DEADLINE).
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PpunMaxDuration         In: Maximum command duration, out: maximum command duration to use.
+ */
+static
+void
+DeviceManagement_ApplyStallDeadline(
+    _In_    unsigned int    PunCommandCode,
+    _Inout_ unsigned int*   PpunMaxDuration)
+{
+    unsigned int rgunSorted[DEVICE_MANAGEMENT_STALL_SAMPLE_COUNT];
+    unsigned int unCount = MIN(s_unStallLatencyCount, DEVICE_MANAGEMENT_STALL_SAMPLE_COUNT);
+    unsigned int unIndex = 0;
+    unsigned long long ullDeadline = 0;
+
+    s_unStallDeadline = 0;
+    if (0 == s_unStallCommandCode || PunCommandCode != s_unStallCommandCode || unCount < STALL_DETECTOR_MIN_SAMPLES)
+        return;
+
+    // Insertion sort of the recorded latencies to get the median
+    for (unIndex = 0; unIndex < unCount; unIndex++)
+    {
+        unsigned int unPosition = unIndex;
+        while (unPosition > 0 && rgunSorted[unPosition - 1] > s_rgunStallLatencies[unIndex])
+        {
+            rgunSorted[unPosition] = rgunSorted[unPosition - 1];
+            unPosition--;
+        }
+        rgunSorted[unPosition] = s_rgunStallLatencies[unIndex];
+    }
+    s_unStallMedian = rgunSorted[unCount / 2];
+
+    ullDeadline = (unsigned long long)s_unStallMedian * STALL_DETECTOR_FACTOR;
+    if (ullDeadline < STALL_DETECTOR_MIN_DEADLINE)
+        ullDeadline = STALL_DETECTOR_MIN_DEADLINE;
+    if (ullDeadline < *PpunMaxDuration)
+    {
+        *PpunMaxDuration = (unsigned int)ullDeadline;
+        s_unStallDeadline = (unsigned int)ullDeadline;
+    }
+}
+
+/**
+ *  @brief      Apply the query deadline to a TPM command
+ *  @details    While a producer with priority DEVICE_MANAGEMENT_PRIORITY_QUERY holds the TPM and PROPERTY_QUERY_DEADLINE
+ *              was set when it claimed the TPM, the maximum duration is reduced to the remaining time budget. No command
+ *              is started once the budget is used up.
+ *
+ *  @param      PpunMaxDuration         In: Maximum command duration, out: maximum command duration to use.
+ *
+ *  @retval     RC_SUCCESS              The command can be started.
+ *  @retval     RC_E_DEADLINE_EXCEEDED  The query deadline elapsed.
+ */
+static
+unsigned int
+DeviceManagement_ApplyQueryDeadline(
+    _Inout_ unsigned int*   PpunMaxDuration)
+{
+    unsigned long long ullElapsedUs = 0;
+
+    if (0 == s_unQueryDeadline || DEVICE_MANAGEMENT_PRIORITY_QUERY != s_unAccessPriority)
+        return RC_SUCCESS;
+
+    ullElapsedUs = Platform_TicksToMicroseconds(Platform_GetTicks() - s_ullQueryDeadlineStartTicks);
+    if (ullElapsedUs >= s_unQueryDeadline)
+    {
+        s_fQueryDeadlineExceeded = TRUE;
+        return RC_E_DEADLINE_EXCEEDED;
+    }
+    if (s_unQueryDeadline - ullElapsedUs < *PpunMaxDuration)
+        *PpunMaxDuration = (unsigned int)(s_unQueryDeadline - ullElapsedUs);
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Record the result of a TPM command in the stall detector
+ *  @details    The latency of a successful monitored command is added to the ring buffer. A monitored command which failed
+ *              after its stall deadline is reported as stalled.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @param      PullStartTicks          Tick count taken before the command was passed to the TPM access module.
+ *  @param      PunResult               Return code of the TPM access module.
+ */
+static
+void
+DeviceManagement_StallDetectorRecord(
+    _In_    unsigned int        PunCommandCode,
+    _In_    unsigned long long  PullStartTicks,
+    _In_    unsigned int        PunResult)
+{
+    unsigned long long ullLatencyUs = 0;
+
+    if (0 == s_unStallCommandCode || PunCommandCode != s_unStallCommandCode)
+        return;
+
+    ullLatencyUs = Platform_TicksToMicroseconds(Platform_GetTicks() - PullStartTicks);
+    if (RC_SUCCESS == PunResult)
+    {
+        s_rgunStallLatencies[s_unStallLatencyCount % DEVICE_MANAGEMENT_STALL_SAMPLE_COUNT] = (unsigned int)MIN(ullLatencyUs, LONG_DURATION);
+        s_unStallLatencyCount++;
+    }
+    else if (0 != s_unStallDeadline && ullLatencyUs >= s_unStallDeadline)
+    {
+        LOGGING_WRITE_LEVEL1_FMT(L"TPM command 0x%.8X stalled: no response within %d microseconds (%d times the median latency of %d microseconds over %d commands) (0x%.8X)",
+                                 PunCommandCode, s_unStallDeadline, STALL_DETECTOR_FACTOR, s_unStallMedian, s_unStallLatencyCount, PunResult);
+    }
+    s_unStallDeadline = 0;
+}
+
+/**
+ *  @brief      Starts the stall detector for a streaming phase
+ *  @details    The latencies of the successful commands with the given command code are tracked. Once enough latencies
+ *              have been observed, the maximum duration of the next command with this command code is reduced to a
+ *              multiple of the median latency. The maximum duration from the command table remains the upper limit.
+ *              A stalled command fails with the timeout error of the TPM access module, so the caller can recover
+ *              instead of waiting for the full maximum duration.
+ *
+ *  @param      PunCommandCode          TPM command ordinal of the streamed blocks (e.g. TPM2_FieldUpgradeDataVendor).
+ */
+void
+DeviceManagement_StallDetectorStart(
+    _In_    unsigned int    PunCommandCode)
+{
+    Platform_MemorySet(s_rgunStallLatencies, 0, sizeof(s_rgunStallLatencies));
+    s_unStallLatencyCount = 0;
+    s_unStallMedian = 0;
+    s_unStallDeadline = 0;
+    s_unStallCommandCode = PunCommandCode;
+}
+
+/**
+ *  @brief      Stops the stall detector
+ *  @details    Subsequent commands use their maximum duration from the command table again.
+ */
+void
+DeviceManagement_StallDetectorStop()
+{
+    s_unStallCommandCode = 0;
+    s_unStallDeadline = 0;
+}
+
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    At most DEVICE_MANAGEMENT_MAX_INSTANCES instances are reported.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetInstanceCount()
+{
+    unsigned int unCount = TPMIO_GetInstanceCount();
+    if (unCount > DEVICE_MANAGEMENT_MAX_INSTANCES)
+        unCount = DEVICE_MANAGEMENT_MAX_INSTANCES;
+
+    return unCount;
+}
+
+/**
+ *  @brief      Selects the TPM instance
+ *  @details    All following TPM commands are sent to the selected TPM instance. If connected, the connection to the
+ *              previous instance is closed and a connection to the selected instance is opened. Since connect and
+ *              disconnect increment the TPM state generation, information cached for the previous instance is not reused.
+ *              Selecting the instance already selected is a no-op.
+ *
+ *  @param      PunInstance             Zero based index of the TPM instance.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_BAD_PARAMETER      There is no TPM instance with the given index.
+ *  @retval     RC_E_NOT_READY          A command sent with DeviceManagement_Send is still pending.
+ *  @retval     ...                     Error codes from DeviceManagement_Connect and DeviceManagement_Disconnect.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_SelectInstance(
+    _In_ unsigned int PunInstance)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        BOOL fReconnect = FALSE;
+
+        // Check if Module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        if (PunInstance == s_unSelectedInstance)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        if (PunInstance >= DeviceManagement_GetInstanceCount())
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE_FMT(unReturnValue, L"TPM instance %d does not exist.", PunInstance);
+            break;
+        }
+
+        // The response of a pending command must be received from the instance it was sent to
+        if (s_fCommandPending)
+        {
+            unReturnValue = RC_E_NOT_READY;
+            ERROR_STORE(unReturnValue, L"The TPM instance cannot be changed while a command is pending.");
+            break;
+        }
+
+        fReconnect = DeviceManagement_IsConnected();
+        unReturnValue = DeviceManagement_Disconnect();
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TPMIO_SelectInstance(PunInstance);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(unReturnValue, L"TPMIO_SelectInstance failed: 0x%.8X", unReturnValue);
+            break;
+        }
+        s_unSelectedInstance = PunInstance;
+
+        if (fReconnect)
+        {
+            unReturnValue = DeviceManagement_Connect();
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the selected TPM instance
+ *  @details
+ *
+ *  @returns    Zero based index of the selected TPM instance.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetSelectedInstance()
+{
+    return s_unSelectedInstance;
+}
+
+/**
+ *  @brief      Returns the identification of the TPM read from its interface registers
+ *  @details    No TPM command is sent. The TPM family is derived from the interface type and is only a hint which command
+ *              set to try first; it is TPM_INTERFACE_FAMILY_UNKNOWN if the device access has no TPM registers.
+ *
+ *  @param      PpsInfo                 Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM is not connected.
+ *  @retval     ...                     Error codes from TPMIO_GetInterfaceInfo function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetInterfaceInfo(
+    _Out_   TPM_INTERFACE_INFO* PpsInfo)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        if (NULL == PpsInfo)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Bad parameter (PpsInfo)");
+            break;
+        }
+
+        // Check if Module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        // Check if TPMIO is connected
+        if (FALSE == DeviceManagement_IsConnected())
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            ERROR_STORE(unReturnValue, L"TPM not connected");
+            break;
+        }
+
+        unReturnValue = s_fpTpmIoGetInterfaceInfo(PpsInfo);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(unReturnValue, L"TPMIO_GetInterfaceInfo failed: 0x%.8X", unReturnValue);
+            break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Wait until the TPM interface responds
+ *  @details    This function revalidates the connection to the TPM at a short interval until it succeeds or the timeout
+ *              elapses (see DeviceManagement_Revalidate). Revalidating only reads the access and vendor ID registers, so
+ *              the TPM can be probed cheaply while it switches between operation modes.
+ *
+ *  @param      PunTimeout              Timeout in milliseconds.
+ *  @param      PunInterval             Interval between two probes in milliseconds.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully, the TPM is connected.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     ...                     Error codes from DeviceManagement_Revalidate function of the last probe.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_WaitForInterface(
+    _In_    unsigned int    PunTimeout,
+    _In_    unsigned int    PunInterval)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned long long ullStartTicks = Platform_GetTicks();
+    unsigned long long ullWaited = 0;
+    unsigned int unProbes = 0;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    for (;;)
+    {
+        unsigned long long ullElapsed = 0;
+
+        unProbes++;
+        unReturnValue = DeviceManagement_Revalidate();
+        if (RC_SUCCESS == unReturnValue || RC_E_NOT_INITIALIZED == unReturnValue)
+            break;
+
+        // The accumulated sleep time is a lower bound in case no tick counter is available
+        ullElapsed = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks) / 1000;
+        if (ullElapsed < ullWaited)
+            ullElapsed = ullWaited;
+        if (ullElapsed >= PunTimeout)
+            break;
+
+        Platform_Sleep(PunInterval);
+        ullWaited += PunInterval;
+    }
+
+    LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_WaitForInterface: %d probe(s), result 0x%.8X", unProbes, unReturnValue);
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Device transmit function
+ *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface).
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_DEADLINE_EXCEEDED  The query deadline elapsed.
+ *  @retval ...                         Error codes from s_fpTpmIoTransmit function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Transmit(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize,
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unCommandCode = 0;
+        unsigned int unTisMaxDuration = LONG_DURATION;
+        unsigned int unTisExpectedDuration = 0;
+        unsigned int unResponseBufferSize = 0;
+        unsigned int unRetry = 0;
+        unsigned int unWarningRetry = 0;
+        unsigned int unWarning = 0;
+        unsigned long long ullStartTicks = 0;
+
+        // Check parameters
+        if (NULL == PrgbRequestBuffer || NULL == PrgbResponseBuffer)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpbRequestBuffer or PpunResponseBufferSize is NULL)");
+            break;
+        }
+        if (0 == PunRequestBufferSize || 0 == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter PunRequestBufferSize or PpunResponseBufferSize has invalid value 0");
+            break;
+        }
+
+        // Check if module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            // Set error code and fill error object
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        // Check if TPMIO is connected
+        if (FALSE == DeviceManagement_IsConnected())
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            ERROR_STORE(unReturnValue, L"TPM not connected");
+            break;
+        }
+
+        // Do not interleave with the commands of an interrupted producer
+        if (!DeviceManagement_IsAccessAllowed())
+        {
+            unReturnValue = RC_E_NOT_READY;
+            ERROR_STORE(unReturnValue, L"The TPM is in use by an interrupted producer");
+            break;
+        }
+
+        // Do not interleave with a command sent by DeviceManagement_Send
+        if (s_fCommandPending)
+        {
+            unReturnValue = RC_E_INTERNAL;
+            ERROR_STORE(unReturnValue, L"The response of the previous TPM command was not received yet");
+            break;
+        }
+
+        // Check if the request buffer holds at least enough bytes for the command length and code
+        if (PunRequestBufferSize >= 10)
+        {
+            // Get TPM command code
+            unReturnValue = Platform_MemoryCopy(&unCommandCode, sizeof(unCommandCode), (const void*) &PrgbRequestBuffer[6], sizeof(unsigned int));
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Unexpected return value from function call Platform_MemoryCopy");
+                break;
+            }
+            // Switch command code endianness
+            unCommandCode = Platform_SwapBytes32(unCommandCode);
+            // Output the corresponding command name
+            DeviceManagement_LogSampleBegin(unCommandCode);
+            unTisMaxDuration = DeviceManagement_TpmCommandDuration(unCommandCode);
+            DeviceManagement_LogCommandName(unCommandCode);
+            DeviceManagement_ApplyCalibratedDuration(unCommandCode, &unTisMaxDuration, &unTisExpectedDuration);
+            DeviceManagement_ApplyStallDeadline(unCommandCode, &unTisMaxDuration);
+        }
+        else
+        {
+            DeviceManagement_LogSampleBegin(unCommandCode);
+            LOGGING_WRITE_LEVEL3(L"Sending unknown or invalid TPM Command");
+        }
+
+        // Do not start the command once the deadline of the query access elapsed
+        unReturnValue = DeviceManagement_ApplyQueryDeadline(&unTisMaxDuration);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(unReturnValue, L"The query deadline elapsed before TPM command 0x%.8X", unCommandCode);
+            break;
+        }
+
+        if (s_fLogCommandDetail)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Transmit: Sending:  TxLen = %4d", PunRequestBufferSize);
+            LOGGING_WRITEHEX_LEVEL3(PrgbRequestBuffer, PunRequestBufferSize);
+        }
+
+        // Record the command for troubleshooting, the request itself is only logged if the command fails
+        DeviceManagement_HistoryAdd(unCommandCode, PrgbRequestBuffer, PunRequestBufferSize, PunRequestBufferSize);
+        DeviceManagement_TrackCommandContextUsage(PrgbRequestBuffer, PunRequestBufferSize);
+
+        DeviceManagement_TrackTpmStateChange(unCommandCode);
+        unResponseBufferSize = *PpunResponseBufferSize;
+        for (;;)
+        {
+            DEVICE_MANAGEMENT_COMMAND_LATENCY* psLatency = NULL;
+
+            ullStartTicks = Platform_GetTicks();
+            unReturnValue = s_fpTpmIoTransmit(
+                                PrgbRequestBuffer,
+                                PunRequestBufferSize,
+                                PrgbResponseBuffer,
+                                PpunResponseBufferSize,
+                                unTisMaxDuration,
+                                unTisExpectedDuration);
+            DeviceManagement_RecordLatency(unCommandCode, ullStartTicks, RC_SUCCESS == unReturnValue);
+            DeviceManagement_StallDetectorRecord(unCommandCode, ullStartTicks, unReturnValue);
+            DeviceManagement_HistoryComplete(unReturnValue, ullStartTicks, PrgbResponseBuffer, *PpunResponseBufferSize);
+
+            // Send the command again after a transient TPM warning (e.g. while the TPM runs its self-test after a reset)
+            if (RC_SUCCESS == unReturnValue && unWarningRetry < DEVICE_MANAGEMENT_WARNING_RETRIES)
+            {
+                unWarning = DeviceManagement_GetResendableWarning(PrgbRequestBuffer, PunRequestBufferSize, PrgbResponseBuffer, *PpunResponseBufferSize);
+                if (0 != unWarning && RC_SUCCESS == DeviceManagement_ApplyQueryDeadline(&unTisMaxDuration))
+                {
+                    LOGGING_WRITE_LEVEL2_FMT(L"TPM warning 0x%.3X, sending TPM command 0x%.8X again (retry %d)", unWarning, unCommandCode, unWarningRetry + 1);
+                    Platform_Sleep(DEVICE_MANAGEMENT_WARNING_RETRY_DELAY << unWarningRetry);
+                    unWarningRetry++;
+                    *PpunResponseBufferSize = unResponseBufferSize;
+                    DeviceManagement_HistoryAdd(unCommandCode, PrgbRequestBuffer, PunRequestBufferSize, PunRequestBufferSize);
+                    continue;
+                }
+            }
+
+            if (RC_SUCCESS == unReturnValue || unRetry >= DEVICE_MANAGEMENT_TRANSMIT_RETRIES ||
+                    !DeviceManagement_IsRetryable(unCommandCode, unReturnValue) ||
+                    RC_SUCCESS != DeviceManagement_ApplyQueryDeadline(&unTisMaxDuration))
+                break;
+
+            // Send the command again after a transient transport error, back off exponentially
+            LOGGING_WRITE_LEVEL2_FMT(L"Transport error 0x%.8X, sending TPM command 0x%.8X again (retry %d)", unReturnValue, unCommandCode, unRetry + 1);
+            Platform_Sleep(DEVICE_MANAGEMENT_TRANSMIT_RETRY_DELAY << unRetry);
+            unRetry++;
+            psLatency = DeviceManagement_GetLatencyEntry(unCommandCode);
+            if (NULL != psLatency)
+                psLatency->unRetries++;
+            *PpunResponseBufferSize = unResponseBufferSize;
+            DeviceManagement_HistoryAdd(unCommandCode, PrgbRequestBuffer, PunRequestBufferSize, PunRequestBufferSize);
+        }
+        // A command which failed because its maximum duration was cut to the query deadline reports the deadline
+        if (RC_SUCCESS != unReturnValue && RC_SUCCESS != DeviceManagement_ApplyQueryDeadline(&unTisMaxDuration))
+            unReturnValue = RC_E_DEADLINE_EXCEEDED;
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Error during TpmIOTransmit");
+
+            // Log the failed TPM command and the commands before it for troubleshooting
+            DeviceManagement_HistoryLog();
+            LOGGING_WRITE_LEVEL1(L"Failed TPM command:");
+            LOGGING_WRITEHEX_LEVEL1(PrgbRequestBuffer, PunRequestBufferSize);
+
+            break;
+        }
+
+        DeviceManagement_LogSampleComplete(PunRequestBufferSize + *PpunResponseBufferSize, ullStartTicks);
+        if (s_fLogCommandDetail)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Transmit: Received:  RxLen = %4d", *PpunResponseBufferSize);
+            LOGGING_WRITEHEX_LEVEL3(PrgbResponseBuffer, *PpunResponseBufferSize);
+        }
+        DeviceManagement_TrackCommandContextUsage(PrgbResponseBuffer, *PpunResponseBufferSize);
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Device send function for scattered commands
+ *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface) without
+ *              waiting for the response. The command is passed as a list of segments which are streamed to the TPM
+ *              directly from the caller's buffers. The first segment must contain at least the command header.
+ *              The response must be collected with DeviceManagement_Receive before the next command is sent.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           The response of the previously sent command was not received yet.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_DEADLINE_EXCEEDED  The query deadline elapsed.
+ *  @retval ...                         Error codes from s_fpTpmIoSend function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_SendSegments(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unCommandCode = 0;
+        unsigned int unTisMaxDuration = LONG_DURATION;
+        unsigned int unTisExpectedDuration = 0;
+        unsigned int unRequestSize = 0;
+        unsigned int unIndex = 0;
+
+        // Check parameters
+        if (NULL == PrgsSegments || 0 == PunSegmentCount || NULL == PrgsSegments[0].pbData || 0 == PrgsSegments[0].unSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgsSegments is NULL or empty)");
+            break;
+        }
+
+        // Check if module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            // Set error code and fill error object
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        // Check if TPMIO is connected
+        if (FALSE == DeviceManagement_IsConnected())
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            ERROR_STORE(unReturnValue, L"TPM not connected");
+            break;
+        }
+
+        // Do not interleave with the commands of an interrupted producer
+        if (!DeviceManagement_IsAccessAllowed())
+        {
+            unReturnValue = RC_E_NOT_READY;
+            ERROR_STORE(unReturnValue, L"The TPM is in use by an interrupted producer");
+            break;
+        }
+
+        // Only one command may be outstanding at a time
+        if (s_fCommandPending)
+        {
+            unReturnValue = RC_E_INTERNAL;
+            ERROR_STORE(unReturnValue, L"The response of the previous TPM command was not received yet");
+            break;
+        }
+
+        for (unIndex = 0; unIndex < PunSegmentCount; unIndex++)
+            unRequestSize += PrgsSegments[unIndex].unSize;
+
+        // Check if the first segment holds at least enough bytes for the command length and code
+        if (PrgsSegments[0].unSize >= 10)
+        {
+            // Get TPM command code
+            unReturnValue = Platform_MemoryCopy(&unCommandCode, sizeof(unCommandCode), (const void*) &PrgsSegments[0].pbData[6], sizeof(unsigned int));
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Unexpected return value from function call Platform_MemoryCopy");
+                break;
+            }
+            // Switch command code endianness
+            unCommandCode = Platform_SwapBytes32(unCommandCode);
+            // Output the corresponding command name
+            DeviceManagement_LogSampleBegin(unCommandCode);
+            unTisMaxDuration = DeviceManagement_TpmCommandDuration(unCommandCode);
+            DeviceManagement_LogCommandName(unCommandCode);
+            DeviceManagement_ApplyCalibratedDuration(unCommandCode, &unTisMaxDuration, &unTisExpectedDuration);
+            DeviceManagement_ApplyStallDeadline(unCommandCode, &unTisMaxDuration);
+        }
+        else
+        {
+            DeviceManagement_LogSampleBegin(unCommandCode);
+            LOGGING_WRITE_LEVEL3(L"Sending unknown or invalid TPM Command");
+        }
+
+        // Do not start the command once the deadline of the query access elapsed
+        unReturnValue = DeviceManagement_ApplyQueryDeadline(&unTisMaxDuration);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(unReturnValue, L"The query deadline elapsed before TPM command 0x%.8X", unCommandCode);
+            break;
+        }
+
+        if (s_fLogCommandDetail)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Send: Sending:  TxLen = %4d", unRequestSize);
+            for (unIndex = 0; unIndex < PunSegmentCount; unIndex++)
+            {
+                LOGGING_WRITEHEX_LEVEL3(PrgsSegments[unIndex].pbData, PrgsSegments[unIndex].unSize);
+            }
+        }
+
+        // Record the command for troubleshooting. Only the leading segment (the command header) is logged if the
+        // command fails, further segments reference caller memory (e.g. the firmware image).
+        DeviceManagement_HistoryAdd(unCommandCode, PrgsSegments[0].pbData, PrgsSegments[0].unSize, unRequestSize);
+
+        DeviceManagement_TrackTpmStateChange(unCommandCode);
+        s_ullPendingStartTicks = Platform_GetTicks();
+        unReturnValue = s_fpTpmIoSend(PrgsSegments, PunSegmentCount);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            DeviceManagement_RecordLatency(unCommandCode, s_ullPendingStartTicks, FALSE);
+            DeviceManagement_StallDetectorRecord(unCommandCode, s_ullPendingStartTicks, unReturnValue);
+            DeviceManagement_HistoryComplete(unReturnValue, s_ullPendingStartTicks, NULL, 0);
+            ERROR_STORE(unReturnValue, L"Error during TpmIOSend");
+
+            // Log the failed TPM command and the commands before it for troubleshooting
+            DeviceManagement_HistoryLog();
+            LOGGING_WRITE_LEVEL1(L"Failed TPM command:");
+            LOGGING_WRITEHEX_LEVEL1(PrgsSegments[0].pbData, PrgsSegments[0].unSize);
+
+            break;
+        }
+
+        s_unPendingMaxDuration = unTisMaxDuration;
+        s_unPendingExpectedDuration = unTisExpectedDuration;
+        s_unPendingCommandCode = unCommandCode;
+        s_unPendingRequestSize = unRequestSize;
+        s_fPendingExpired = FALSE;
+        s_fCommandPending = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Device send function
+ *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface) without
+ *              waiting for the response. The response must be collected with DeviceManagement_Receive before the
+ *              next command is sent. This allows preparing the next command while the TPM processes the current one.
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval ...                         Error codes from DeviceManagement_SendSegments function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Send(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize)
+{
+    TPM_TX_SEGMENT sSegment;
+
+    sSegment.pbData = PrgbRequestBuffer;
+    sSegment.unSize = PunRequestBufferSize;
+
+    return DeviceManagement_SendSegments(&sSegment, 1);
+}
+
+/**
+ *  @brief      Device receive function
+ *  @details    This function waits for the response of the TPM command submitted with DeviceManagement_Send.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           No command was sent with DeviceManagement_Send.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval ...                         Error codes from s_fpTpmIoReceive function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check parameters
+        if (NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize || 0 == *PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbResponseBuffer or PpunResponseBufferSize is NULL or 0)");
+            break;
+        }
+
+        // Check if module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            // Set error code and fill error object
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        // Check if TPMIO is connected
+        if (FALSE == DeviceManagement_IsConnected())
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            ERROR_STORE(unReturnValue, L"TPM not connected");
+            break;
+        }
+
+        // Check if a command was sent before
+        if (!s_fCommandPending)
+        {
+            unReturnValue = RC_E_INTERNAL;
+            ERROR_STORE(unReturnValue, L"No TPM command is pending");
+            break;
+        }
+
+        // The response is consumed regardless of the result
+        s_fCommandPending = FALSE;
+
+        // Do not wait the whole maximum duration again if DeviceManagement_Poll already found it elapsed
+        unReturnValue = s_fpTpmIoReceive(PrgbResponseBuffer, PpunResponseBufferSize, s_fPendingExpired ? 0 : s_unPendingMaxDuration, s_unPendingExpectedDuration);
+        DeviceManagement_RecordLatency(s_unPendingCommandCode, s_ullPendingStartTicks, RC_SUCCESS == unReturnValue);
+        DeviceManagement_StallDetectorRecord(s_unPendingCommandCode, s_ullPendingStartTicks, unReturnValue);
+        DeviceManagement_HistoryComplete(unReturnValue, s_ullPendingStartTicks, PrgbResponseBuffer, *PpunResponseBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Error during TpmIOReceive");
+
+            // Log the TPM commands up to the failed one for troubleshooting
+            DeviceManagement_HistoryLog();
+
+            break;
+        }
+
+        DeviceManagement_LogSampleComplete(s_unPendingRequestSize + *PpunResponseBufferSize, s_ullPendingStartTicks);
+        if (s_fLogCommandDetail)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Receive: Received:  RxLen = %4d", *PpunResponseBufferSize);
+            LOGGING_WRITEHEX_LEVEL3(PrgbResponseBuffer, *PpunResponseBufferSize);
+        }
+        DeviceManagement_TrackCommandContextUsage(PrgbResponseBuffer, *PpunResponseBufferSize);
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Device poll function
+ *  @details    This function checks once, without waiting, if the response of the TPM command submitted with
+ *              DeviceManagement_Send is available. Together with DeviceManagement_Send and DeviceManagement_Receive it
+ *              allows the caller to do work on the host (e.g. hashing the next block or updating the progress display)
+ *              while the TPM processes a command.
+ *              The command is also reported as complete once its maximum duration has elapsed. DeviceManagement_Receive
+ *              then returns the response or the timeout error without waiting again.
+ *
+ *  @param      PpfComplete             Receives TRUE if DeviceManagement_Receive can be called without waiting, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           No command was sent with DeviceManagement_Send.
+ *  @retval ...                         Error codes from s_fpTpmIoPoll function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Poll(
+    _Out_   BOOL*   PpfComplete)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        BOOL fResponseAvailable = FALSE;
+
+        // Check parameters
+        if (NULL == PpfComplete)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpfComplete is NULL)");
+            break;
+        }
+        *PpfComplete = FALSE;
+
+        // Check if module is initialized
+        if (FALSE == DeviceManagement_IsInitialized())
+        {
+            // Set error code and fill error object
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            ERROR_STORE(unReturnValue, L"Module not initialized (DeviceManagement)");
+            break;
+        }
+
+        // Check if TPMIO is connected
+        if (FALSE == DeviceManagement_IsConnected())
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            ERROR_STORE(unReturnValue, L"TPM not connected");
+            break;
+        }
+
+        // Check if a command was sent before
+        if (!s_fCommandPending)
+        {
+            unReturnValue = RC_E_INTERNAL;
+            ERROR_STORE(unReturnValue, L"No TPM command is pending");
+            break;
+        }
+
+        if (s_fPendingExpired)
+        {
+            *PpfComplete = TRUE;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        unReturnValue = s_fpTpmIoPoll(&fResponseAvailable);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Error during TpmIOPoll");
+            break;
+        }
+
+        if (!fResponseAvailable &&
+                Platform_TicksToMicroseconds(Platform_GetTicks() - s_ullPendingStartTicks) >= s_unPendingMaxDuration)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"DeviceManagement_Poll: Maximum duration of %d microseconds elapsed", s_unPendingMaxDuration);
+            s_fPendingExpired = TRUE;
+        }
+
+        *PpfComplete = fResponseAvailable || s_fPendingExpired;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Device transmit function for scattered commands
+ *  @details    This function submits a TPM command passed as a list of segments and waits for the response.
+ *              A TPM2.0 command without sessions is sent again after a transient TPM warning (see
+ *              DeviceManagement_IsTransientTpmWarning).
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval ...                         Error codes from DeviceManagement_SendSegments and DeviceManagement_Receive functions.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_TransmitSegments(
+    _In_count_(PunSegmentCount)                 const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                                        unsigned int            PunSegmentCount,
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*                   PrgbResponseBuffer,
+    _Inout_                                     unsigned int*           PpunResponseBufferSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned int unResponseBufferSize = (NULL != PpunResponseBufferSize) ? *PpunResponseBufferSize : 0;
+    unsigned int unWarningRetry = 0;
+
+    for (;;)
+    {
+        unsigned int unWarning = 0;
+
+        unReturnValue = DeviceManagement_SendSegments(PrgsSegments, PunSegmentCount);
+        if (RC_SUCCESS == unReturnValue)
+            unReturnValue = DeviceManagement_Receive(PrgbResponseBuffer, PpunResponseBufferSize);
+        if (RC_SUCCESS != unReturnValue || unWarningRetry >= DEVICE_MANAGEMENT_WARNING_RETRIES)
+            break;
+
+        // The command tag is taken from the first segment, SendSegments has checked that it is not empty
+        unWarning = DeviceManagement_GetResendableWarning(PrgsSegments[0].pbData, PrgsSegments[0].unSize, PrgbResponseBuffer, *PpunResponseBufferSize);
+        if (0 == unWarning)
+            break;
+
+        LOGGING_WRITE_LEVEL2_FMT(L"TPM warning 0x%.3X, sending TPM command again (retry %d)", unWarning, unWarningRetry + 1);
+        Platform_Sleep(DEVICE_MANAGEMENT_WARNING_RETRY_DELAY << unWarningRetry);
+        unWarningRetry++;
+        *PpunResponseBufferSize = unResponseBufferSize;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Borrow the command context
+ *  @details    This function hands out the request and response buffers of the driver. Both buffers are zeroed,
+ *              so a command wrapper can marshal into them without clearing them first. The context must be given
+ *              back with DeviceManagement_ReleaseCommandContext.
+ *
+ *  @param      PppsContext             Receives the command context.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PppsContext is NULL.
+ *  @retval     RC_E_INTERNAL           The command context is already borrowed.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_AcquireCommandContext(
+    _Outptr_result_maybenull_   DEVICE_MANAGEMENT_COMMAND_CONTEXT** PppsContext)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PppsContext)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PppsContext is NULL)");
+            break;
+        }
+        *PppsContext = NULL;
+
+        // The buffers are shared by all commands, so nested commands are not allowed
+        if (s_sCommandContext.fInUse)
         {
-            LOGGING_WRITE_LEVEL3(L"Sending unknown TPM Command");
+            unReturnValue = RC_E_INTERNAL;
+            ERROR_STORE(unReturnValue, L"The command context is already in use");
+            break;
         }
+
+        // Until the TPM access module reports the actual sizes the whole buffers count as used
+        s_sCommandContext.unRequestSize = sizeof(s_sCommandContext.rgbRequest);
+        s_sCommandContext.unResponseSize = sizeof(s_sCommandContext.rgbResponse);
+        s_sCommandContext.fInUse = TRUE;
+        *PppsContext = &s_sCommandContext;
+        unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
 
-    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_EXIT_STRING);
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Give back the command context
+ *  @details    This function clears the bytes of the request and response buffers used by the last command and
+ *              marks the context as free. Calling it with a NULL context is allowed and does nothing.
+ *
+ *  @param      PppsContext             In: Command context from DeviceManagement_AcquireCommandContext, out: NULL.
+ */
+void
+DeviceManagement_ReleaseCommandContext(
+    _Inout_                     DEVICE_MANAGEMENT_COMMAND_CONTEXT** PppsContext)
+{
+    if (NULL == PppsContext || *PppsContext != &s_sCommandContext || !s_sCommandContext.fInUse)
+        return;
+
+    // Restore the all zero state for the next command
+    if (0 != s_sCommandContext.unRequestSize)
+        Platform_MemorySet(s_sCommandContext.rgbRequest, 0, s_sCommandContext.unRequestSize);
+    if (0 != s_sCommandContext.unResponseSize)
+        Platform_MemorySet(s_sCommandContext.rgbResponse, 0, s_sCommandContext.unResponseSize);
+    s_sCommandContext.unRequestSize = 0;
+    s_sCommandContext.unResponseSize = 0;
+    s_sCommandContext.fInUse = FALSE;
+    *PppsContext = NULL;
+}
+
+/**
+ *  @brief      Transmit the scheduled queries
+ *  @details    Local helper method transmitting the queued queries in priority order as long as the TPM is not held.
+ *              The scheduler holds the TPM while it transmits a query and calls the completion functions.
+ */
+static
+void
+DeviceManagement_RunScheduledQueries()
+{
+    unsigned int unLevel = Platform_GetExecutionLevel();
+
+    for (;;)
+    {
+        DEVICE_MANAGEMENT_SCHEDULED_QUERY sQuery;
+        DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+        unsigned int unResponseSize = 0;
+        unsigned int unReturnValue = RC_E_FAIL;
+        unsigned int unSelected = 0;
+        unsigned int unIndex = 0;
+        unsigned long long ullState = Platform_EnterCriticalSection();
+
+        if (0 != s_unAccessDepth || 0 == s_unScheduledQueryCount)
+        {
+            Platform_LeaveCriticalSection(ullState);
+            break;
+        }
+
+        // Take the oldest query with the highest priority out of the queue
+        for (unIndex = 1; unIndex < s_unScheduledQueryCount; unIndex++)
+        {
+            if (s_rgsScheduledQueries[unIndex].unPriority > s_rgsScheduledQueries[unSelected].unPriority)
+                unSelected = unIndex;
+        }
+        sQuery = s_rgsScheduledQueries[unSelected];
+        for (unIndex = unSelected + 1; unIndex < s_unScheduledQueryCount; unIndex++)
+            s_rgsScheduledQueries[unIndex - 1] = s_rgsScheduledQueries[unIndex];
+        s_unScheduledQueryCount--;
+
+        // Hold the TPM while the query is transmitted
+        s_unAccessDepth = 1;
+        s_unAccessLevel = unLevel;
+        s_unAccessPriority = sQuery.unPriority;
+        Platform_LeaveCriticalSection(ullState);
+
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS == unReturnValue)
+        {
+            unReturnValue = Platform_MemoryCopy(psContext->rgbRequest, sizeof(psContext->rgbRequest), sQuery.rgbRequest, sQuery.unRequestSize);
+            unResponseSize = sizeof(psContext->rgbResponse);
+            if (RC_SUCCESS == unReturnValue)
+                unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, sQuery.unRequestSize, psContext->rgbResponse, &unResponseSize);
+        }
+
+        for (unIndex = 0; unIndex < sQuery.unWaiterCount; unIndex++)
+        {
+            if (RC_SUCCESS == unReturnValue)
+                sQuery.rgsWaiters[unIndex].pfnCompletion(sQuery.rgsWaiters[unIndex].pvContext, unReturnValue, psContext->rgbResponse, unResponseSize);
+            else
+                sQuery.rgsWaiters[unIndex].pfnCompletion(sQuery.rgsWaiters[unIndex].pvContext, unReturnValue, NULL, 0);
+        }
+
+        DeviceManagement_ReleaseCommandContext(&psContext);
+
+        ullState = Platform_EnterCriticalSection();
+        s_unAccessDepth = 0;
+        Platform_LeaveCriticalSection(ullState);
+    }
+}
+
+/**
+ *  @brief      Claims the TPM for a producer
+ *  @details    A producer (e.g. a protocol entry point) claims the TPM before it issues commands and releases it with
+ *              DeviceManagement_ReleaseAccess. Calls on the execution level of the holder nest. A caller which has
+ *              interrupted the holder on a higher execution level (e.g. a status poll from a timer callback during a
+ *              firmware transfer) is rejected, so its commands cannot interleave with the commands of the holder.
+ *              The outermost claim with priority DEVICE_MANAGEMENT_PRIORITY_QUERY starts the time budget given by
+ *              PROPERTY_QUERY_DEADLINE, TPM commands fail with RC_E_DEADLINE_EXCEEDED once it is used up.
+ *
+ *  @param      PunPriority             Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
+ *
+ *  @retval     RC_SUCCESS              The TPM is held by the caller.
+ *  @retval     RC_E_NOT_READY          The TPM is held by an interrupted producer.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_AcquireAccess(
+    _In_    unsigned int    PunPriority)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    unsigned int unLevel = Platform_GetExecutionLevel();
+    unsigned int unQueryDeadlineMs = 0;
+    unsigned long long ullState = 0;
+
+    if (DEVICE_MANAGEMENT_PRIORITY_QUERY != PunPriority ||
+            FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_QUERY_DEADLINE, &unQueryDeadlineMs))
+        unQueryDeadlineMs = 0;
+
+    ullState = Platform_EnterCriticalSection();
+    if (0 == s_unAccessDepth)
+    {
+        s_unAccessDepth = 1;
+        s_unAccessLevel = unLevel;
+        s_unAccessPriority = PunPriority;
+        // The time budget of a query starts with the outermost claim
+        s_unQueryDeadline = (unsigned int)MIN((unsigned long long)unQueryDeadlineMs * 1000, LONG_DURATION);
+        s_ullQueryDeadlineStartTicks = Platform_GetTicks();
+        s_fQueryDeadlineExceeded = FALSE;
+    }
+    else if (unLevel == s_unAccessLevel)
+    {
+        s_unAccessDepth++;
+        s_unAccessPriority = MAX(s_unAccessPriority, PunPriority);
+    }
+    else
+        unReturnValue = RC_E_NOT_READY;
+
+    Platform_LeaveCriticalSection(ullState);
+
+    if (RC_SUCCESS != unReturnValue)
+        LOGGING_WRITE_LEVEL2_FMT(L"TPM access with priority %d rejected, the TPM is in use with priority %d", PunPriority, s_unAccessPriority);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Releases the TPM claimed with DeviceManagement_AcquireAccess
+ *  @details    Once the outermost claim is released the scheduled queries are transmitted in priority order.
+ *
+ *  @retval     TRUE    The TPM is not held anymore, the caller may tear down TPM access.
+ *  @retval     FALSE   The caller is nested in or has interrupted the holder of the TPM.
+ */
+_Check_return_
+BOOL
+DeviceManagement_ReleaseAccess()
+{
+    BOOL fReleased = TRUE;
+    unsigned int unLevel = Platform_GetExecutionLevel();
+    unsigned long long ullState = Platform_EnterCriticalSection();
+
+    if (0 != s_unAccessDepth)
+    {
+        if (unLevel == s_unAccessLevel)
+            s_unAccessDepth--;
+        fReleased = (0 == s_unAccessDepth);
+        if (fReleased)
+            s_unQueryDeadline = 0;
+    }
+
+    Platform_LeaveCriticalSection(ullState);
+
+    if (fReleased)
+        DeviceManagement_RunScheduledQueries();
+
+    return fReleased;
+}
+
+/**
+ *  @brief      Returns whether the query deadline elapsed
+ *  @details    The flag is reset by the outermost DeviceManagement_AcquireAccess call and remains valid after the TPM
+ *              has been released, so a protocol entry point can map the failure of a nested call to a timeout.
+ *
+ *  @retval     TRUE    A TPM command of the last query access was not completed because the query deadline elapsed.
+ *  @retval     FALSE   Otherwise.
+ */
+BOOL
+DeviceManagement_IsQueryDeadlineExceeded()
+{
+    return s_fQueryDeadlineExceeded;
+}
+
+/**
+ *  @brief      Schedules a read-only TPM command
+ *  @details    The query is transmitted right away if the TPM is not held. Otherwise it is queued until the holder
+ *              releases the TPM. A pending identical query is not queued again, the caller waits for its response.
+ *              The completion function may be called before the function returns.
+ *
+ *  @param      PunPriority             Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
+ *  @param      PrgbRequest             Request bytes of a read-only TPM command.
+ *  @param      PunRequestSize          Size of the request in bytes (at most DEVICE_MANAGEMENT_SCHEDULER_MAX_REQUEST_SIZE).
+ *  @param      PfnCompletion           Function called with the response.
+ *  @param      PpvContext              Context passed to the completion function.
+ *
+ *  @retval     RC_SUCCESS              The query has been transmitted or queued.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function, e.g. the command is not read-only.
+ *  @retval     RC_E_NOT_READY          The queue is full.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_ScheduleQuery(
+    _In_                            unsigned int                            PunPriority,
+    _In_bytecount_(PunRequestSize)  const BYTE*                             PrgbRequest,
+    _In_                            unsigned int                            PunRequestSize,
+    _In_                            PFN_DEVICE_MANAGEMENT_QUERY_COMPLETION  PfnCompletion,
+    _Inout_opt_                     void*                                   PpvContext)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned long long ullState = 0;
+        unsigned int unCommandCode = 0;
+        unsigned int unIndex = 0;
+
+        // Check parameters
+        if (NULL == PrgbRequest || NULL == PfnCompletion || PunRequestSize < 10 || PunRequestSize > DEVICE_MANAGEMENT_SCHEDULER_MAX_REQUEST_SIZE)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbRequest or PfnCompletion is NULL or PunRequestSize is invalid)");
+            break;
+        }
+
+        // Only commands which do not change the TPM state may be coalesced and reordered
+        unCommandCode = ((unsigned int)PrgbRequest[6] << 24) | ((unsigned int)PrgbRequest[7] << 16) | ((unsigned int)PrgbRequest[8] << 8) | PrgbRequest[9];
+        if (!DeviceManagement_IsReadOnlyCommand(unCommandCode))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE_FMT(unReturnValue, L"TPM command 0x%.8X cannot be scheduled, it may change the TPM state", unCommandCode);
+            break;
+        }
+
+        ullState = Platform_EnterCriticalSection();
+
+        // Wait for a pending identical query
+        unReturnValue = RC_E_NOT_READY;
+        for (unIndex = 0; unIndex < s_unScheduledQueryCount; unIndex++)
+        {
+            DEVICE_MANAGEMENT_SCHEDULED_QUERY* psQuery = &s_rgsScheduledQueries[unIndex];
+            if (PunRequestSize == psQuery->unRequestSize && psQuery->unWaiterCount < RG_LEN(psQuery->rgsWaiters) &&
+                    0 == Platform_MemoryCompare(PrgbRequest, psQuery->rgbRequest, PunRequestSize))
+            {
+                psQuery->rgsWaiters[psQuery->unWaiterCount].pfnCompletion = PfnCompletion;
+                psQuery->rgsWaiters[psQuery->unWaiterCount].pvContext = PpvContext;
+                psQuery->unWaiterCount++;
+                psQuery->unPriority = MAX(psQuery->unPriority, PunPriority);
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+        }
+
+        // Otherwise queue the query
+        if (RC_SUCCESS != unReturnValue && s_unScheduledQueryCount < RG_LEN(s_rgsScheduledQueries))
+        {
+            DEVICE_MANAGEMENT_SCHEDULED_QUERY* psQuery = &s_rgsScheduledQueries[s_unScheduledQueryCount];
+            psQuery->unPriority = PunPriority;
+            psQuery->unRequestSize = PunRequestSize;
+            unReturnValue = Platform_MemoryCopy(psQuery->rgbRequest, sizeof(psQuery->rgbRequest), PrgbRequest, PunRequestSize);
+            psQuery->rgsWaiters[0].pfnCompletion = PfnCompletion;
+            psQuery->rgsWaiters[0].pvContext = PpvContext;
+            psQuery->unWaiterCount = 1;
+            if (RC_SUCCESS == unReturnValue)
+                s_unScheduledQueryCount++;
+        }
+
+        Platform_LeaveCriticalSection(ullState);
+
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"The queue of scheduled TPM commands is full");
+            break;
+        }
+
+        // Transmit right away if the TPM is not held
+        DeviceManagement_RunScheduledQueries();
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the maximum duration of a TPM command
+ *  @details    All TPM2.0 commands use LONG_DURATION. TPM1.2 command codes are looked up in a compact table of command
+ *              codes and durations. Unknown command codes use LONG_DURATION.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @returns    Maximum command duration in microseconds (relevant for memory based access / TIS protocol only).
+ */
+unsigned int
+DeviceManagement_TpmCommandDuration(
+    _In_    unsigned int    PunCommandCode)
+{
+    unsigned int unLow = 0, unHigh = RG_LEN(s_sTpm1CommandDurations), unMiddle = 0;
+
+    // TPM2.0 command code
+    if (PunCommandCode & 0x00000100)
+        return LONG_DURATION;
+
+    // Binary search for a known TPM1.2 command code in the sorted duration list
+    while (unLow < unHigh)
+    {
+        unMiddle = unLow + (unHigh - unLow) / 2;
+        if (s_sTpm1CommandDurations[unMiddle].unCommandCode < PunCommandCode)
+            unLow = unMiddle + 1;
+        else if (s_sTpm1CommandDurations[unMiddle].unCommandCode > PunCommandCode)
+            unHigh = unMiddle;
+        else
+            return s_sTpm1CommandDurations[unMiddle].unMaxDuration;
+    }
+
+    return LONG_DURATION;
+}
+
+/**
+ *  @brief      Returns the name of a TPM command
+ *  @details    This function determines the TPM command name from the command ordinal.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @returns    Name of the TPM command or NULL if the command code is unknown.
+ */
+const wchar_t*
+DeviceManagement_TpmCommandName(
+    _In_    unsigned int    PunCommandCode)
+{
+    const wchar_t* pwszCommandName = NULL;
+
+    do
+    {
+        unsigned int unLow = 0, unHigh = 0, unMiddle = 0;
+        const IfxTpmCommand* prgTpmCommands = NULL;
+
+        // Determine if it is a TPM1.2 or TPM2.0 command code
+        if (PunCommandCode & 0x00000100)
+        {
+            // TPM2.0 command code
+            prgTpmCommands = s_sTpm2Commands;
+            unHigh = RG_LEN(s_sTpm2Commands);
+        }
+        else
+        {
+            // TPM1.2 command code
+            prgTpmCommands = s_sTpm1Commands;
+            unHigh = RG_LEN(s_sTpm1Commands);
+        }
 
-    return;
+        // Binary search for a known command code in the sorted command list
+        while (unLow < unHigh)
+        {
+            unMiddle = unLow + (unHigh - unLow) / 2;
+            if (prgTpmCommands[unMiddle].unCommandCode < PunCommandCode)
+            {
+                unLow = unMiddle + 1;
+            }
+            else if (prgTpmCommands[unMiddle].unCommandCode > PunCommandCode)
+            {
+                unHigh = unMiddle;
+            }
+            else
+            {
+                pwszCommandName = prgTpmCommands[unMiddle].pwszCommandName;
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    return pwszCommandName;
+}
+
+/**
+ *  @brief      Returns the command latency statistics
+ *  @details    This function copies the latency statistics of all TPM commands sent since the driver was loaded.
+ *
+ *  @param      PpsStatistics           Pointer to receive the statistics.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsStatistics is NULL.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetLatencyStatistics(
+    _Out_   DEVICE_MANAGEMENT_LATENCY_STATISTICS*   PpsStatistics)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PpsStatistics)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsStatistics is NULL)");
+            break;
+        }
+
+        *PpsStatistics = s_sLatencyStatistics;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns whether an error code is a transient TPM2.0 warning
+ *  @details    TPM_RC_RETRY and TPM_RC_TESTING report that the TPM did not execute the command, TPM_RC_YIELDED that it
+ *              suspended the command. The command may be sent again unchanged after a short delay.
+ *              DeviceManagement_Transmit and DeviceManagement_TransmitSegments do this for commands without sessions,
+ *              callers of DeviceManagement_Send and DeviceManagement_Receive must do it themselves.
+ *
+ *  @param      PunReturnValue          Error code returned by a Micro TSS function (TPM response code masked with RC_TPM_MASK).
+ *
+ *  @retval     TRUE    The error code is a transient TPM2.0 warning.
+ *  @retval     FALSE   Otherwise.
+ */
+_Check_return_
+BOOL
+DeviceManagement_IsTransientTpmWarning(
+    _In_    unsigned int    PunReturnValue)
+{
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; unIndex < RG_LEN(s_rgunTpmTransientWarnings); unIndex++)
+    {
+        if ((RC_TPM_MASK | s_rgunTpmTransientWarnings[unIndex]) == PunReturnValue)
+            return TRUE;
+    }
+
+    return FALSE;
+}
+
+/**
+ *  @brief      Returns the TPM state generation
+ *  @details    The generation is incremented on connect, on disconnect and whenever a TPM command is submitted that may
+ *              change the TPM state. Information derived from the TPM state can be cached together with the generation
+ *              and reused as long as the generation is unchanged.
+ *
+ *  @returns    The current TPM state generation.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetTpmStateGeneration()
+{
+    return s_unTpmStateGeneration;
+}
+
+/**
+ *  @brief      Invalidates cached TPM state information
+ *  @details    This function increments the TPM state generation. It is called internally for state changing TPM
+ *              commands and can be called by components that change the TPM state by other means.
+ */
+void
+DeviceManagement_InvalidateTpmState()
+{
+    s_unTpmStateGeneration++;
 }
 
 /**
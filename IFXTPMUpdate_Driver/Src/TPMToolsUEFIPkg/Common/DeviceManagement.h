@@ -19,15 +19,6 @@
 extern "C" {
 #endif
 
-/// Caches the last TPM command
-extern BYTE g_rgbLastRequest[4096];
-/// Caches the last TPM command
-extern unsigned int g_unSizeLastRequest;
-/// Caches the last TPM command
-extern BYTE g_rgbLastResponse[4096];
-/// Caches the last TPM response
-extern unsigned int g_unSizeLastResponse;
-
 /**
  *  @brief      Represents a TPM command
  *  @details    Structure that holds the code and the name of a TPM command.
@@ -36,9 +27,206 @@ typedef struct tdIfxTpmCommand
 {
     const wchar_t* pwszCommandName;
     unsigned int unCommandCode;
-    unsigned int unMaxDuration;
 } IfxTpmCommand;
 
+/**
+ *  @brief      Represents the maximum duration of a TPM command
+ *  @details    Kept apart from IfxTpmCommand so that the duration lookup per command does not read any name string.
+ */
+typedef struct tdIfxTpmCommandDuration
+{
+    unsigned int unCommandCode;
+    unsigned int unMaxDuration;
+} IfxTpmCommandDuration;
+
+/// Size of the request and the response buffer of the command context
+#define DEVICE_MANAGEMENT_COMMAND_BUFFER_SIZE 4096
+
+/**
+ *  @brief      Represents the command context
+ *  @details    Structure that owns the request and response buffers borrowed by the Micro TSS command wrappers.
+ *              The buffers are placed first to keep them aligned. Outside of a borrow both buffers are all zero,
+ *              the sizes track how many bytes must be cleared again on release.
+ */
+typedef struct tdDEVICE_MANAGEMENT_COMMAND_CONTEXT
+{
+    BYTE rgbRequest[DEVICE_MANAGEMENT_COMMAND_BUFFER_SIZE];
+    BYTE rgbResponse[DEVICE_MANAGEMENT_COMMAND_BUFFER_SIZE];
+    unsigned int unRequestSize;
+    unsigned int unResponseSize;
+    BOOL fInUse;
+} DEVICE_MANAGEMENT_COMMAND_CONTEXT;
+
+/// Access priority of status queries (e.g. operation mode or version probes)
+#define DEVICE_MANAGEMENT_PRIORITY_QUERY    0
+/// Access priority of the firmware update stream
+#define DEVICE_MANAGEMENT_PRIORITY_UPDATE   1
+
+/// Number of queries the scheduler can hold while the TPM is in use
+#define DEVICE_MANAGEMENT_SCHEDULER_QUEUE_SIZE 4
+/// Maximum request size of a scheduled query in bytes
+#define DEVICE_MANAGEMENT_SCHEDULER_MAX_REQUEST_SIZE 32
+/// Maximum number of callers waiting for the same scheduled query
+#define DEVICE_MANAGEMENT_SCHEDULER_MAX_WAITERS 4
+
+/**
+ *  @brief      Completion function of a query scheduled with DeviceManagement_ScheduleQuery
+ *  @details    The response buffer is only valid during the call.
+ *
+ *  @param      PpvContext          Context passed to DeviceManagement_ScheduleQuery.
+ *  @param      PunReturnValue      Return code of the transmission.
+ *  @param      PrgbResponse        Response of the TPM (NULL if the transmission failed).
+ *  @param      PunResponseSize     Size of the response in bytes.
+ */
+typedef void (*PFN_DEVICE_MANAGEMENT_QUERY_COMPLETION)(
+    _Inout_opt_                         void*           PpvContext,
+    _In_                                unsigned int    PunReturnValue,
+    _In_opt_bytecount_(PunResponseSize) const BYTE*     PrgbResponse,
+    _In_                                unsigned int    PunResponseSize);
+
+/**
+ *  @brief      Caller waiting for a scheduled query
+ *  @details
+ */
+typedef struct tdDEVICE_MANAGEMENT_QUERY_WAITER
+{
+    /// Completion function
+    PFN_DEVICE_MANAGEMENT_QUERY_COMPLETION pfnCompletion;
+    /// Context passed to the completion function
+    void* pvContext;
+} DEVICE_MANAGEMENT_QUERY_WAITER;
+
+/**
+ *  @brief      Read-only TPM command waiting until the TPM is released
+ *  @details    Identical queries are coalesced into one entry, so the TPM is asked only once for all waiting callers.
+ */
+typedef struct tdDEVICE_MANAGEMENT_SCHEDULED_QUERY
+{
+    /// Access priority (DEVICE_MANAGEMENT_PRIORITY_*), the highest priority of all waiting callers
+    unsigned int unPriority;
+    /// Size of the request in bytes
+    unsigned int unRequestSize;
+    /// Request bytes
+    BYTE rgbRequest[DEVICE_MANAGEMENT_SCHEDULER_MAX_REQUEST_SIZE];
+    /// Number of waiting callers
+    unsigned int unWaiterCount;
+    /// Waiting callers
+    DEVICE_MANAGEMENT_QUERY_WAITER rgsWaiters[DEVICE_MANAGEMENT_SCHEDULER_MAX_WAITERS];
+} DEVICE_MANAGEMENT_SCHEDULED_QUERY;
+
+/// Number of TPM commands kept in the command history
+#define DEVICE_MANAGEMENT_HISTORY_SIZE 8
+
+/// Number of leading request and response bytes kept per command history entry (the header and the first handle or parameter)
+#define DEVICE_MANAGEMENT_HISTORY_SNAPSHOT_SIZE 16
+
+/**
+ *  @brief      Entry of the TPM command history
+ *  @details    The command history is a ring of the last DEVICE_MANAGEMENT_HISTORY_SIZE TPM commands. It is logged when a
+ *              command fails, so the commands leading up to the failure can be inspected. Only the leading bytes of the
+ *              request and the response are kept; the complete request of the failed command is logged from the
+ *              caller's buffer.
+ */
+typedef struct tdDEVICE_MANAGEMENT_HISTORY_ENTRY
+{
+    /// TPM command ordinal
+    unsigned int unCommandCode;
+    /// Size of the request in bytes
+    unsigned int unRequestSize;
+    /// Size of the response in bytes (0 if no response was received)
+    unsigned int unResponseSize;
+    /// Return code of the TPM access module
+    unsigned int unReturnValue;
+    /// Duration from sending the request until the response was received in microseconds
+    unsigned long long ullDurationUs;
+    /// Leading bytes of the request
+    BYTE rgbRequest[DEVICE_MANAGEMENT_HISTORY_SNAPSHOT_SIZE];
+    /// Leading bytes of the response
+    BYTE rgbResponse[DEVICE_MANAGEMENT_HISTORY_SNAPSHOT_SIZE];
+} DEVICE_MANAGEMENT_HISTORY_ENTRY;
+
+/// Number of leading commands of a run of identical command codes which are logged in full (logging level 3)
+#define DEVICE_MANAGEMENT_LOG_SAMPLE_HEAD 4
+
+/// Number of trailing commands of a run of identical command codes which are logged from the command history when the run ends
+#define DEVICE_MANAGEMENT_LOG_SAMPLE_TAIL 4
+
+/// Number of commands between two summary lines of a run of identical command codes
+#define DEVICE_MANAGEMENT_LOG_SAMPLE_PERIOD 256
+
+/// Maximum number of TPM instances handled by the device management
+#define DEVICE_MANAGEMENT_MAX_INSTANCES 8
+
+/// Number of latencies of streamed blocks the stall detector derives the median latency from
+#define DEVICE_MANAGEMENT_STALL_SAMPLE_COUNT 16
+
+/// Number of buckets of the command latency histogram
+#define DEVICE_MANAGEMENT_LATENCY_BUCKET_COUNT 16
+
+/// Upper bound of the first command latency histogram bucket in microseconds. Each following bucket doubles the bound, the last bucket is unbounded.
+#define DEVICE_MANAGEMENT_LATENCY_FIRST_BUCKET_US 128
+
+/// Maximum number of different command codes with latency statistics
+#define DEVICE_MANAGEMENT_LATENCY_COMMAND_COUNT 24
+
+/// Number of times a command which is safe to resend is sent again after a transport error
+#define DEVICE_MANAGEMENT_TRANSMIT_RETRIES 3
+
+/// Delay before the first resend of a command in milliseconds, doubled before each further resend
+#define DEVICE_MANAGEMENT_TRANSMIT_RETRY_DELAY 10
+
+/// Number of times a TPM2.0 command without sessions is sent again after TPM_RC_RETRY, TPM_RC_YIELDED or TPM_RC_TESTING
+#define DEVICE_MANAGEMENT_WARNING_RETRIES 6
+
+/// Delay before the first resend after a TPM2.0 warning in milliseconds, doubled before each further resend
+#define DEVICE_MANAGEMENT_WARNING_RETRY_DELAY 5
+
+/**
+ *  @brief      Latency statistics of a TPM command code
+ *  @details    All durations are given in microseconds. The latency is measured from writing the command to the TPM
+ *              until the response is read. For commands sent with DeviceManagement_Send it includes the time until the
+ *              caller invokes DeviceManagement_Receive, so the host share is unTotalUs minus the three phase totals.
+ */
+typedef struct tdDEVICE_MANAGEMENT_COMMAND_LATENCY
+{
+    /// TPM command code
+    unsigned int unCommandCode;
+    /// Number of measured commands
+    unsigned int unCount;
+    /// Number of measured commands which failed in the TPM access module
+    unsigned int unFailures;
+    /// Number of times a command was sent again after a transport error
+    unsigned int unRetries;
+    /// Minimum latency
+    unsigned long long ullMinUs;
+    /// Maximum latency
+    unsigned long long ullMaxUs;
+    /// Sum of all latencies
+    unsigned long long ullTotalUs;
+    /// Sum of the send phases
+    unsigned long long ullSendUs;
+    /// Sum of the phases waiting for the response (TPM processing)
+    unsigned long long ullWaitUs;
+    /// Sum of the receive phases
+    unsigned long long ullReceiveUs;
+    /// Latency histogram, see DEVICE_MANAGEMENT_LATENCY_FIRST_BUCKET_US
+    unsigned int rgunHistogram[DEVICE_MANAGEMENT_LATENCY_BUCKET_COUNT];
+} DEVICE_MANAGEMENT_COMMAND_LATENCY;
+
+/**
+ *  @brief      Latency statistics of all TPM commands since the driver was loaded
+ *  @details
+ */
+typedef struct tdDEVICE_MANAGEMENT_LATENCY_STATISTICS
+{
+    /// Number of valid entries in rgsCommands
+    unsigned int unCommandCount;
+    /// Number of measured commands not recorded because rgsCommands is full
+    unsigned int unDroppedCount;
+    /// Statistics per command code in order of first occurrence
+    DEVICE_MANAGEMENT_COMMAND_LATENCY rgsCommands[DEVICE_MANAGEMENT_LATENCY_COMMAND_COUNT];
+} DEVICE_MANAGEMENT_LATENCY_STATISTICS;
+
 /**
  *  @brief      Device management initialization function
  *  @details    This function initializes the device IO.
@@ -99,6 +287,100 @@ _Check_return_
 unsigned int
 DeviceManagement_Disconnect();
 
+/**
+ *  @brief      Revalidate the connection to the TPM
+ *  @details    Lightweight alternative to DeviceManagement_Disconnect and DeviceManagement_Connect after the TPM may have
+ *              restarted. The initialized device access and the connection configuration are kept, only the access
+ *              registers and the active locality are checked again (see TPMIO_Revalidate). A full reconnect is done if
+ *              the TPM is not connected or the revalidation fails for another reason than the TPM not responding yet.
+ *              Cached TPM state information is invalidated.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully, the TPM is connected.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_NOT_READY          The TPM does not respond yet, the connection is kept.
+ *  @retval     ...                     Error codes from DeviceManagement_Connect function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Revalidate();
+
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    At most DEVICE_MANAGEMENT_MAX_INSTANCES instances are reported.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetInstanceCount();
+
+/**
+ *  @brief      Selects the TPM instance
+ *  @details    All following TPM commands are sent to the selected TPM instance. If connected, the connection to the
+ *              previous instance is closed and a connection to the selected instance is opened. Since connect and
+ *              disconnect increment the TPM state generation, information cached for the previous instance is not reused.
+ *              Selecting the instance already selected is a no-op.
+ *
+ *  @param      PunInstance             Zero based index of the TPM instance.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_BAD_PARAMETER      There is no TPM instance with the given index.
+ *  @retval     RC_E_NOT_READY          A command sent with DeviceManagement_Send is still pending.
+ *  @retval     ...                     Error codes from DeviceManagement_Connect and DeviceManagement_Disconnect.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_SelectInstance(
+    _In_ unsigned int PunInstance);
+
+/**
+ *  @brief      Returns the selected TPM instance
+ *  @details
+ *
+ *  @returns    Zero based index of the selected TPM instance.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetSelectedInstance();
+
+/**
+ *  @brief      Returns the identification of the TPM read from its interface registers
+ *  @details    No TPM command is sent. The TPM family is derived from the interface type and is only a hint which command
+ *              set to try first; it is TPM_INTERFACE_FAMILY_UNKNOWN if the device access has no TPM registers.
+ *
+ *  @param      PpsInfo                 Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM is not connected.
+ *  @retval     ...                     Error codes from TPMIO_GetInterfaceInfo function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetInterfaceInfo(
+    _Out_   TPM_INTERFACE_INFO* PpsInfo);
+
+/**
+ *  @brief      Wait until the TPM interface responds
+ *  @details    This function revalidates the connection to the TPM at a short interval until it succeeds or the timeout
+ *              elapses (see DeviceManagement_Revalidate). Revalidating only reads the access and vendor ID registers, so
+ *              the TPM can be probed cheaply while it switches between operation modes.
+ *
+ *  @param      PunTimeout              Timeout in milliseconds.
+ *  @param      PunInterval             Interval between two probes in milliseconds.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully, the TPM is connected.
+ *  @retval     RC_E_NOT_INITIALIZED    If this module is not initialized.
+ *  @retval     ...                     Error codes from DeviceManagement_Revalidate function of the last probe.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_WaitForInterface(
+    _In_    unsigned int    PunTimeout,
+    _In_    unsigned int    PunInterval);
+
 /**
  *  @brief      Device transmit function
  *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface).
@@ -113,6 +395,7 @@ DeviceManagement_Disconnect();
  *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
  *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
  *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_DEADLINE_EXCEEDED  The query deadline elapsed.
  *  @retval ...                         Error codes from s_fpTpmIoTransmit function.
  */
 _Check_return_
@@ -124,16 +407,300 @@ DeviceManagement_Transmit(
     _Inout_                                     unsigned int*   PpunResponseBufferSize);
 
 /**
- *  @brief      Function to output TPM command name and return the duration.
- *  @details    This function determines the TPM command name from the command ordinal and puts it to the log file.
+ *  @brief      Device send function for scattered commands
+ *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface) without
+ *              waiting for the response. The command is passed as a list of segments which are streamed to the TPM
+ *              directly from the caller's buffers. The first segment must contain at least the command header.
+ *              The response must be collected with DeviceManagement_Receive before the next command is sent.
  *
- *  @param      PunCommandCode          TPM command ordinal.
- *  @param      PpunMaxDuration         Maximum command duration in microseconds (relevant for memory based access / TIS protocol only).
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           The response of the previously sent command was not received yet.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_DEADLINE_EXCEEDED  The query deadline elapsed.
+ *  @retval ...                         Error codes from s_fpTpmIoSend function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_SendSegments(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount);
+
+/**
+ *  @brief      Device send function
+ *  @details    This function submits the TPM command to the underlying TPM access module (TpmIO interface) without
+ *              waiting for the response. The response must be collected with DeviceManagement_Receive before the
+ *              next command is sent. This allows preparing the next command while the TPM processes the current one.
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval ...                         Error codes from DeviceManagement_SendSegments function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Send(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize);
+
+/**
+ *  @brief      Device receive function
+ *  @details    This function waits for the response of the TPM command submitted with DeviceManagement_Send.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. Invalid buffer or buffer size.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           No command was sent with DeviceManagement_Send.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval ...                         Error codes from s_fpTpmIoReceive function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize);
+
+/**
+ *  @brief      Device poll function
+ *  @details    This function checks once, without waiting, if the response of the TPM command submitted with
+ *              DeviceManagement_Send is available. DeviceManagement_Send, DeviceManagement_Poll and DeviceManagement_Receive
+ *              form the split-phase (submit, poll, complete) interface to the TPM.
+ *              The command is also reported as complete once its maximum duration has elapsed. DeviceManagement_Receive
+ *              then returns the response or the timeout error without waiting again.
+ *
+ *  @param      PpfComplete             Receives TRUE if DeviceManagement_Receive can be called without waiting, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED    The module could not be initialized.
+ *  @retval     RC_E_NOT_CONNECTED      The connection to the TPM failed.
+ *  @retval     RC_E_INTERNAL           No command was sent with DeviceManagement_Send.
+ *  @retval ...                         Error codes from s_fpTpmIoPoll function.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_Poll(
+    _Out_   BOOL*   PpfComplete);
+
+/**
+ *  @brief      Device transmit function for scattered commands
+ *  @details    This function submits a TPM command passed as a list of segments and waits for the response.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval ...                         Error codes from DeviceManagement_SendSegments and DeviceManagement_Receive functions.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_TransmitSegments(
+    _In_count_(PunSegmentCount)                 const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                                        unsigned int            PunSegmentCount,
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*                   PrgbResponseBuffer,
+    _Inout_                                     unsigned int*           PpunResponseBufferSize);
+
+/**
+ *  @brief      Borrow the command context
+ *  @details    This function hands out the request and response buffers of the driver. Both buffers are zeroed,
+ *              so a command wrapper can marshal into them without clearing them first. The context must be given
+ *              back with DeviceManagement_ReleaseCommandContext.
+ *
+ *  @param      PppsContext             Receives the command context.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PppsContext is NULL.
+ *  @retval     RC_E_INTERNAL           The command context is already borrowed.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_AcquireCommandContext(
+    _Outptr_result_maybenull_   DEVICE_MANAGEMENT_COMMAND_CONTEXT** PppsContext);
+
+/**
+ *  @brief      Give back the command context
+ *  @details    This function clears the bytes of the request and response buffers used by the last command and
+ *              marks the context as free. Calling it with a NULL context is allowed and does nothing.
+ *
+ *  @param      PppsContext             In: Command context from DeviceManagement_AcquireCommandContext, out: NULL.
  */
 void
+DeviceManagement_ReleaseCommandContext(
+    _Inout_                     DEVICE_MANAGEMENT_COMMAND_CONTEXT** PppsContext);
+
+/**
+ *  @brief      Returns the maximum duration of a TPM command
+ *  @details    All TPM2.0 commands use LONG_DURATION. TPM1.2 command codes are looked up in a compact table of command
+ *              codes and durations. Unknown command codes use LONG_DURATION.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @returns    Maximum command duration in microseconds (relevant for memory based access / TIS protocol only).
+ */
+unsigned int
+DeviceManagement_TpmCommandDuration(
+    _In_    unsigned int    PunCommandCode);
+
+/**
+ *  @brief      Returns the name of a TPM command
+ *  @details    This function determines the TPM command name from the command ordinal.
+ *
+ *  @param      PunCommandCode          TPM command ordinal.
+ *  @returns    Name of the TPM command or NULL if the command code is unknown.
+ */
+const wchar_t*
 DeviceManagement_TpmCommandName(
-    _In_    unsigned int    PunCommandCode,
-    _Out_   unsigned int*   PpunMaxDuration);
+    _In_    unsigned int    PunCommandCode);
+
+/**
+ *  @brief      Returns the command latency statistics
+ *  @details    This function copies the latency statistics of all TPM commands sent since the driver was loaded.
+ *
+ *  @param      PpsStatistics           Pointer to receive the statistics.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PpsStatistics is NULL.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetLatencyStatistics(
+    _Out_   DEVICE_MANAGEMENT_LATENCY_STATISTICS*   PpsStatistics);
+
+/**
+ *  @brief      Starts the stall detector for a streaming phase
+ *  @details    The latencies of the successful commands with the given command code are tracked. Once enough latencies
+ *              have been observed, the maximum duration of the next command with this command code is reduced to a
+ *              multiple of the median latency. The maximum duration from the command table remains the upper limit.
+ *              A stalled command fails with the timeout error of the TPM access module, so the caller can recover
+ *              instead of waiting for the full maximum duration.
+ *
+ *  @param      PunCommandCode          TPM command ordinal of the streamed blocks (e.g. TPM2_FieldUpgradeDataVendor).
+ */
+void
+DeviceManagement_StallDetectorStart(
+    _In_    unsigned int    PunCommandCode);
+
+/**
+ *  @brief      Stops the stall detector
+ *  @details    Subsequent commands use their maximum duration from the command table again.
+ */
+void
+DeviceManagement_StallDetectorStop();
+
+/**
+ *  @brief      Claims the TPM for a producer
+ *  @details    A producer (e.g. a protocol entry point) claims the TPM before it issues commands and releases it with
+ *              DeviceManagement_ReleaseAccess. Calls on the execution level of the holder nest. A caller which has
+ *              interrupted the holder on a higher execution level (e.g. a status poll from a timer callback during a
+ *              firmware transfer) is rejected, so its commands cannot interleave with the commands of the holder.
+ *              The outermost claim with priority DEVICE_MANAGEMENT_PRIORITY_QUERY starts the time budget given by
+ *              PROPERTY_QUERY_DEADLINE, TPM commands fail with RC_E_DEADLINE_EXCEEDED once it is used up.
+ *
+ *  @param      PunPriority             Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
+ *
+ *  @retval     RC_SUCCESS              The TPM is held by the caller.
+ *  @retval     RC_E_NOT_READY          The TPM is held by an interrupted producer.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_AcquireAccess(
+    _In_    unsigned int    PunPriority);
+
+/**
+ *  @brief      Releases the TPM claimed with DeviceManagement_AcquireAccess
+ *  @details    Once the outermost claim is released the scheduled queries are transmitted in priority order.
+ *
+ *  @retval     TRUE    The TPM is not held anymore, the caller may tear down TPM access.
+ *  @retval     FALSE   The caller is nested in or has interrupted the holder of the TPM.
+ */
+_Check_return_
+BOOL
+DeviceManagement_ReleaseAccess();
+
+/**
+ *  @brief      Returns whether the query deadline elapsed
+ *  @details    The flag is reset by the outermost DeviceManagement_AcquireAccess call and remains valid after the TPM
+ *              has been released, so a protocol entry point can map the failure of a nested call to a timeout.
+ *
+ *  @retval     TRUE    A TPM command of the last query access was not completed because the query deadline elapsed.
+ *  @retval     FALSE   Otherwise.
+ */
+BOOL
+DeviceManagement_IsQueryDeadlineExceeded();
+
+/**
+ *  @brief      Schedules a read-only TPM command
+ *  @details    The query is transmitted right away if the TPM is not held. Otherwise it is queued until the holder
+ *              releases the TPM. A pending identical query is not queued again, the caller waits for its response.
+ *              The completion function may be called before the function returns.
+ *
+ *  @param      PunPriority             Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
+ *  @param      PrgbRequest             Request bytes of a read-only TPM command.
+ *  @param      PunRequestSize          Size of the request in bytes (at most DEVICE_MANAGEMENT_SCHEDULER_MAX_REQUEST_SIZE).
+ *  @param      PfnCompletion           Function called with the response.
+ *  @param      PpvContext              Context passed to the completion function.
+ *
+ *  @retval     RC_SUCCESS              The query has been transmitted or queued.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function, e.g. the command is not read-only.
+ *  @retval     RC_E_NOT_READY          The queue is full.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_ScheduleQuery(
+    _In_                            unsigned int                            PunPriority,
+    _In_bytecount_(PunRequestSize)  const BYTE*                             PrgbRequest,
+    _In_                            unsigned int                            PunRequestSize,
+    _In_                            PFN_DEVICE_MANAGEMENT_QUERY_COMPLETION  PfnCompletion,
+    _Inout_opt_                     void*                                   PpvContext);
+
+/**
+ *  @brief      Returns whether an error code is a transient TPM2.0 warning
+ *  @details    TPM_RC_RETRY and TPM_RC_TESTING report that the TPM did not execute the command, TPM_RC_YIELDED that it
+ *              suspended the command. The command may be sent again unchanged after a short delay.
+ *              DeviceManagement_Transmit and DeviceManagement_TransmitSegments do this for commands without sessions,
+ *              callers of DeviceManagement_Send and DeviceManagement_Receive must do it themselves.
+ *
+ *  @param      PunReturnValue          Error code returned by a Micro TSS function (TPM response code masked with RC_TPM_MASK).
+ *
+ *  @retval     TRUE    The error code is a transient TPM2.0 warning.
+ *  @retval     FALSE   Otherwise.
+ */
+_Check_return_
+BOOL
+DeviceManagement_IsTransientTpmWarning(
+    _In_    unsigned int    PunReturnValue);
+
+/**
+ *  @brief      Returns the TPM state generation
+ *  @details    The generation is incremented on connect, on disconnect and whenever a TPM command is submitted that may
+ *              change the TPM state. Information derived from the TPM state can be cached together with the generation
+ *              and reused as long as the generation is unchanged.
+ *
+ *  @returns    The current TPM state generation.
+ */
+_Check_return_
+unsigned int
+DeviceManagement_GetTpmStateGeneration();
+
+/**
+ *  @brief      Invalidates cached TPM state information
+ *  @details    This function increments the TPM state generation. It is called internally for state changing TPM
+ *              commands and can be called by components that change the TPM state by other means.
+ */
+void
+DeviceManagement_InvalidateTpmState();
 
 /**
  *  @brief      Register read function
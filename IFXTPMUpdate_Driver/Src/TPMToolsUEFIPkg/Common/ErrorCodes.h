@@ -63,6 +63,10 @@
 #define RC_E_TPM_TRANSMIT_DATA                  RC_E_NO_TPM + 0x07
 /// TPM not ready. Used by TIS. (0xE0295208)
 #define RC_E_NOT_READY                          RC_E_NO_TPM + 0x08
+/// Bus transaction to the TPM failed. Used by TIS. (0xE0295209)
+#define RC_E_BUS_ERROR                          RC_E_NO_TPM + 0x09
+/// The deadline of a TPM query elapsed before the TPM command completed. (0xE029520A)
+#define RC_E_DEADLINE_EXCEEDED                  RC_E_NO_TPM + 0x0A
 //<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<<
 
 //>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>>
@@ -118,8 +122,12 @@
 #define RC_E_RESUME_RUNDATA_NOT_FOUND           RC_E_TPM_FIRMWARE_UPDATE + 0x1A
 /// Error code if a newer revision of the firmware is required (0xE029551B)
 #define RC_E_NEWER_FW_IMAGE_REQUIRED            RC_E_TPM_FIRMWARE_UPDATE + 0x1B
+/// Error code if a firmware update was canceled (0xE029551C)
+#define RC_E_UPDATE_CANCELED                    RC_E_TPM_FIRMWARE_UPDATE + 0x1C
 
-// Range from 0x1C to 0x1F can be used for new error codes.
+/// The link to the TPM failed the pre-flight check before the firmware update
+#define RC_E_TPM_LINK_CHECK_FAILED              RC_E_TPM_FIRMWARE_UPDATE + 0x1D
+// Range from 0x1E to 0x1F can be used for new error codes.
 
 // Error codes 0x20 and 0x21 is for tool internal use
 
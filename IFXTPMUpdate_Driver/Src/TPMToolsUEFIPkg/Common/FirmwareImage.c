@@ -56,6 +56,280 @@ FirmwareImage_VerifyString(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Parses a firmware version string to a packed numeric tuple
+ *  @details    The version must consist of one to four decimal components separated by dots (e.g. "7.85.4555.0"). Each component must
+ *              be lower than 0x8000 and must not have leading zeros, so two versions are equal if and only if their packed tuples are equal.
+ *              The number of components is part of the packed tuple, e.g. "4.40.119" and "4.40.119.0" differ.
+ *
+ *  @param      PwszVersion             Version string.
+ *  @param      PunVersionLength        Length of the version string in elements (without null-termination).
+ *  @param      PpullVersion            Receives the packed numeric tuple.
+ *
+ *  @retval     TRUE                    The version was parsed.
+ *  @retval     FALSE                   The version is no numeric tuple.
+ */
+_Check_return_
+BOOL
+FirmwareImage_ParseVersion(
+    _In_count_(PunVersionLength)    const wchar_t*      PwszVersion,
+    _In_                            unsigned int        PunVersionLength,
+    _Out_                           unsigned long long* PpullVersion)
+{
+    BOOL fParsed = FALSE;
+    do
+    {
+        unsigned long long ullVersion = 0;
+        unsigned int unComponent = 0;
+        unsigned int unComponentCount = 0;
+        unsigned int unDigitCount = 0;
+        unsigned int unPos = 0;
+
+        if (NULL == PpullVersion)
+            break;
+        *PpullVersion = 0;
+        if (NULL == PwszVersion || 0 == PunVersionLength)
+            break;
+
+        // Walk one position past the end to close the last component
+        for (unPos = 0; unPos <= PunVersionLength; unPos++)
+        {
+            const wchar_t wchChar = (unPos < PunVersionLength) ? PwszVersion[unPos] : L'.';
+            if (wchChar >= L'0' && wchChar <= L'9')
+            {
+                // Reject leading zeros, otherwise "1.01" and "1.1" would be the same tuple
+                if (1 == unDigitCount && 0 == unComponent)
+                    break;
+                unComponent = unComponent * 10 + (unsigned int)(wchChar - L'0');
+                unDigitCount++;
+                if (unComponent >= (1u << VERSION_COMPONENT_BITS))
+                    break;
+            }
+            else if (wchChar == L'.')
+            {
+                if (0 == unDigitCount || VERSION_COMPONENTS_MAX == unComponentCount)
+                    break;
+                ullVersion |= (unsigned long long)unComponent << (VERSION_COMPONENT_BITS * unComponentCount);
+                unComponentCount++;
+                unComponent = 0;
+                unDigitCount = 0;
+            }
+            else
+                break;
+        }
+        if (unPos <= PunVersionLength)
+            break;
+
+        // Store the number of components above the components
+        ullVersion |= (unsigned long long)(unComponentCount - 1) << (VERSION_COMPONENT_BITS * VERSION_COMPONENTS_MAX);
+        *PpullVersion = ullVersion;
+        fParsed = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return fParsed;
+}
+
+/**
+ *  @brief      Returns the first hash set slot of a packed version tuple
+ *  @details    Fibonacci hashing of the packed tuple.
+ *
+ *  @param      PullVersion             Packed numeric tuple.
+ *
+ *  @returns    Slot index in the range [0, SOURCE_VERSION_HASH_SET_SIZE).
+ */
+_Check_return_
+unsigned int
+FirmwareImage_HashVersion(
+    _In_    unsigned long long  PullVersion)
+{
+    return (unsigned int)((PullVersion * 0x9E3779B97F4A7C15ULL) >> 32) & (SOURCE_VERSION_HASH_SET_SIZE - 1);
+}
+
+/**
+ *  @brief      Adds a version to the source version index
+ *  @details    Duplicate versions are stored once. Collisions are resolved by linear probing; the hash set has at least twice
+ *              as many slots as the index can hold versions, so a free slot is always found.
+ *
+ *  @param      PpIndex                 Source version index.
+ *  @param      PullVersion             Packed numeric tuple.
+ */
+void
+FirmwareImage_AddSourceVersion(
+    _Inout_ IfxSourceVersionIndex*  PpIndex,
+    _In_    unsigned long long      PullVersion)
+{
+    unsigned int unSlot = FirmwareImage_HashVersion(PullVersion);
+    while (0 != PpIndex->rgbHashSet[unSlot])
+    {
+        if (PpIndex->rgullVersions[PpIndex->rgbHashSet[unSlot] - 1] == PullVersion)
+            return;
+        unSlot = (unSlot + 1) & (SOURCE_VERSION_HASH_SET_SIZE - 1);
+    }
+    if (PpIndex->usCount >= RG_LEN(PpIndex->rgullVersions))
+        return;
+    PpIndex->rgullVersions[PpIndex->usCount] = PullVersion;
+    PpIndex->usCount++;
+    PpIndex->rgbHashSet[unSlot] = (BYTE)PpIndex->usCount;
+}
+
+/**
+ *  @brief      Checks whether a version is an allowed source version of a firmware image
+ *  @details    Looks the version up in the source version index. The index must be numeric (sSourceVersionIndex.fNumeric).
+ *
+ *  @param      PpFirmwareImage         Firmware image.
+ *  @param      PullVersion             Packed numeric tuple (see FirmwareImage_ParseVersion).
+ *
+ *  @retval     TRUE                    The version is an allowed source version.
+ *  @retval     FALSE                   Otherwise.
+ */
+_Check_return_
+BOOL
+FirmwareImage_IsSourceVersion(
+    _In_    const IfxFirmwareImage*     PpFirmwareImage,
+    _In_    unsigned long long          PullVersion)
+{
+    BOOL fFound = FALSE;
+    do
+    {
+        const IfxSourceVersionIndex* pIndex = NULL;
+        unsigned int unSlot = 0;
+
+        if (NULL == PpFirmwareImage)
+            break;
+        pIndex = &PpFirmwareImage->sSourceVersionIndex;
+
+        unSlot = FirmwareImage_HashVersion(PullVersion);
+        while (0 != pIndex->rgbHashSet[unSlot])
+        {
+            if (pIndex->rgullVersions[pIndex->rgbHashSet[unSlot] - 1] == PullVersion)
+            {
+                fFound = TRUE;
+                break;
+            }
+            unSlot = (unSlot + 1) & (SOURCE_VERSION_HASH_SET_SIZE - 1);
+        }
+    }
+    WHILE_FALSE_END;
+
+    return fFound;
+}
+
+/**
+ *  @brief      Returns the first hash set slot of a key group ID
+ *  @details    Fibonacci hashing of the key group ID.
+ *
+ *  @param      PunKeyGroupId           Key group ID.
+ *
+ *  @returns    Slot index in the range [0, MANIFEST_INDEX_HASH_SET_SIZE).
+ */
+static
+unsigned int
+FirmwareImage_HashKeyGroupId(
+    _In_    unsigned int    PunKeyGroupId)
+{
+    return (unsigned int)((PunKeyGroupId * 0x9E3779B9U) >> 16) & (MANIFEST_INDEX_HASH_SET_SIZE - 1);
+}
+
+/**
+ *  @brief      Builds the manifest index of a firmware image
+ *  @details    Walks the manifest data (manifest count followed by key group ID, size and data of each manifest) once. The index
+ *              stays invalid if the manifest data is malformed or holds more than MAX_MANIFEST_INDEX_COUNT manifests; manifest
+ *              selection then parses the manifest data itself and reports the error.
+ *
+ *  @param      PpTarget                Firmware image with rgbManifestData and unManifestDataSize set.
+ */
+static
+void
+FirmwareImage_BuildManifestIndex(
+    _Inout_ IfxFirmwareImage*   PpTarget)
+{
+    IfxManifestIndex* pIndex = &PpTarget->sManifestIndex;
+    BYTE* pbBuffer = PpTarget->rgbManifestData;
+    TSS_INT32 nBufferSize = (TSS_INT32)PpTarget->unManifestDataSize;
+    unsigned short usManifestCount = 0;
+
+    Platform_MemorySet(pIndex, 0, sizeof(*pIndex));
+
+    if (RC_SUCCESS != TSS_UINT16_Unmarshal(&usManifestCount, &pbBuffer, &nBufferSize))
+        return;
+    PpTarget->usNumManifests = usManifestCount;
+    if (usManifestCount < 1 || usManifestCount > MAX_MANIFEST_INDEX_COUNT)
+        return;
+
+    for (pIndex->usCount = 0; pIndex->usCount < usManifestCount; pIndex->usCount++)
+    {
+        IfxManifestIndexEntry* pEntry = &pIndex->rgsEntries[pIndex->usCount];
+        unsigned int unSlot = 0;
+        if (RC_SUCCESS != TSS_UINT32_Unmarshal(&pEntry->unKeyGroupId, &pbBuffer, &nBufferSize) ||
+                RC_SUCCESS != TSS_UINT16_Unmarshal(&pEntry->usSize, &pbBuffer, &nBufferSize) ||
+                pEntry->usSize > nBufferSize)
+            return;
+        pEntry->unOffset = (unsigned int)(pbBuffer - PpTarget->rgbManifestData);
+        pbBuffer += pEntry->usSize;
+        nBufferSize -= pEntry->usSize;
+
+        // Hash the key group ID, the first manifest of a key group wins
+        unSlot = FirmwareImage_HashKeyGroupId(pEntry->unKeyGroupId);
+        while (0 != pIndex->rgbHashSet[unSlot] && pIndex->rgsEntries[pIndex->rgbHashSet[unSlot] - 1].unKeyGroupId != pEntry->unKeyGroupId)
+            unSlot = (unSlot + 1) & (MANIFEST_INDEX_HASH_SET_SIZE - 1);
+        if (0 == pIndex->rgbHashSet[unSlot])
+            pIndex->rgbHashSet[unSlot] = (BYTE)(pIndex->usCount + 1);
+    }
+
+    pIndex->fValid = TRUE;
+}
+
+/**
+ *  @brief      Looks up the manifest of a key group in the manifest index of a firmware image
+ *  @details    The manifest index must be valid (sManifestIndex.fValid). The key group ID is looked up in the hash set of the
+ *              index. If several manifests have the same key group ID, the first one is returned.
+ *
+ *  @param      PpFirmwareImage         Firmware image.
+ *  @param      PunKeyGroupId           Key group ID of the TPM.
+ *  @param      PppbManifest            Receives the pointer to the manifest within the manifest data.
+ *  @param      PpusManifestSize        Receives the size of the manifest in bytes.
+ *
+ *  @retval     TRUE                    The image has a manifest for the key group.
+ *  @retval     FALSE                   Otherwise.
+ */
+_Check_return_
+BOOL
+FirmwareImage_FindManifest(
+    _In_    const IfxFirmwareImage*     PpFirmwareImage,
+    _In_    unsigned int                PunKeyGroupId,
+    _Out_   unsigned char**             PppbManifest,
+    _Out_   unsigned short*             PpusManifestSize)
+{
+    BOOL fFound = FALSE;
+    do
+    {
+        const IfxManifestIndex* pIndex = NULL;
+        unsigned int unSlot = 0;
+
+        if (NULL == PpFirmwareImage || NULL == PppbManifest || NULL == PpusManifestSize)
+            break;
+        pIndex = &PpFirmwareImage->sManifestIndex;
+
+        unSlot = FirmwareImage_HashKeyGroupId(PunKeyGroupId);
+        while (0 != pIndex->rgbHashSet[unSlot])
+        {
+            const IfxManifestIndexEntry* pEntry = &pIndex->rgsEntries[pIndex->rgbHashSet[unSlot] - 1];
+            if (pEntry->unKeyGroupId == PunKeyGroupId)
+            {
+                *PppbManifest = PpFirmwareImage->rgbManifestData + pEntry->unOffset;
+                *PpusManifestSize = pEntry->usSize;
+                fFound = TRUE;
+                break;
+            }
+            unSlot = (unSlot + 1) & (MANIFEST_INDEX_HASH_SET_SIZE - 1);
+        }
+    }
+    WHILE_FALSE_END;
+
+    return fFound;
+}
+
 /**
  *  @brief      Function to unmarshal a IfxFirmwareImage from a byte stream
  *  @details    This function unmarshals the structures parameters. For all fields with variable
@@ -180,6 +454,8 @@ FirmwareImage_Unmarshal(
             nBufferSize = (int)usSourceVersionsSize;
             rgbBuffer = *PprgbBuffer;
             PpTarget->usSourceVersionsCount = 0;
+            // The index stays numeric until a source version is found which is no numeric tuple
+            PpTarget->sSourceVersionIndex.fNumeric = TRUE;
             do
             {
                 wchar_t wszBuffer[256];
@@ -205,6 +481,15 @@ FirmwareImage_Unmarshal(
                     if (RC_SUCCESS != unReturnValue)
                         break;
 
+                    // Add the source version to the index
+                    {
+                        unsigned long long ullVersion = 0;
+                        if (FirmwareImage_ParseVersion(wszBuffer, unLength, &ullVersion))
+                            FirmwareImage_AddSourceVersion(&PpTarget->sSourceVersionIndex, ullVersion);
+                        else
+                            PpTarget->sSourceVersionIndex.fNumeric = FALSE;
+                    }
+
                     PpTarget->usSourceVersionsCount++;
                     // Reduce the remaining buffer size by unmarshalled string length (each character in the firmware image spans across 2 bytes).
                     nBufferSize -= (unLength + 1) * (unsigned int)sizeof(uint16_t);
@@ -343,6 +628,9 @@ FirmwareImage_Unmarshal(
                 PpTarget->rgbManifestData += usPaddingBytes;
             }
 
+            // Index the manifests for the selection by key group ID
+            FirmwareImage_BuildManifestIndex(PpTarget);
+
             // Reset fields
             PpTarget->usPolicyParameterBlockSize = 0;
             PpTarget->rgbPolicyParameterBlock = NULL;
@@ -351,15 +639,13 @@ FirmwareImage_Unmarshal(
         {
             // Get allowed versions from parameter block and store them in rgunIntSourceVersions
             // For >= VERSION_3 images the data will be overwritten with section retrieved from metadata.
-            sSignedData_d sSignedData;
-            BYTE* rgbPolicyParameterBlock = PpTarget->rgbPolicyParameterBlock;
-            TSS_INT32 nPolicyParameterBlockSize = PpTarget->usPolicyParameterBlockSize;
+            sSignedDataView_d sSignedData;
             Platform_MemorySet(&sSignedData, 0, sizeof(sSignedData));
-            // Unmarshal the block to sSignedData structure
-            unReturnValue = TSS_sSignedData_d_Unmarshal(&sSignedData, &rgbPolicyParameterBlock, &nPolicyParameterBlockSize);
+            // Unmarshal the block in place
+            unReturnValue = TSS_sSignedData_d_UnmarshalView(&sSignedData, PpTarget->rgbPolicyParameterBlock, PpTarget->usPolicyParameterBlockSize);
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_Unmarshal returned an unexpected value. (0x%.8x)", unReturnValue);
+                ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_UnmarshalView returned an unexpected value. (0x%.8x)", unReturnValue);
                 unReturnValue = RC_E_CORRUPT_FW_IMAGE;
                 break;
             }
@@ -367,13 +653,15 @@ FirmwareImage_Unmarshal(
             // Get allowed versions from parameter block
             {
                 unsigned int unIndex = 0;
-                PpTarget->usIntSourceVersionCount = sSignedData.sSignerInfo.sSignedAttributes.sVersions.wEntries;
+                BYTE* pbVersion = PpTarget->rgbPolicyParameterBlock + sSignedData.wVersionsOffset;
+                TSS_INT32 nVersionsSize = PpTarget->usPolicyParameterBlockSize - sSignedData.wVersionsOffset;
+                PpTarget->usIntSourceVersionCount = sSignedData.wVersionEntries;
                 for (unIndex = 0; unIndex < MAX_SOURCE_VERSIONS_COUNT; unIndex++)
                 {
+                    // A version missing in a truncated block reads as 0
+                    PpTarget->rgunIntSourceVersions[unIndex] = 0;
                     if (unIndex < PpTarget->usIntSourceVersionCount)
-                        PpTarget->rgunIntSourceVersions[unIndex] = sSignedData.sSignerInfo.sSignedAttributes.sVersions.Version[unIndex];
-                    else
-                        PpTarget->rgunIntSourceVersions[unIndex] = 0;
+                        IGNORE_RETURN_VALUE(TSS_VersionNumber_d_Unmarshal(&PpTarget->rgunIntSourceVersions[unIndex], &pbVersion, &nVersionsSize));
                 }
             }
         }
@@ -84,6 +84,67 @@ static const IfxKeyRecord s_rgPublicKeys[] = {
 /// The maximum supported number of source TPM firmware versions in V3 image file
 #define MAX_SOURCE_VERSIONS_COUNT_V3 32
 
+/// Maximum number of components of a numeric version tuple
+#define VERSION_COMPONENTS_MAX 4
+/// Number of bits per component of a packed numeric version tuple (see FirmwareImage_ParseVersion)
+#define VERSION_COMPONENT_BITS 15
+
+/// Number of slots of the source version hash set (power of two, at least twice MAX_SOURCE_VERSIONS_COUNT_V3)
+#define SOURCE_VERSION_HASH_SET_SIZE 64
+
+/**
+ *  @brief      Source version index
+ *  @details    Index of the allowed source versions built once by FirmwareImage_Unmarshal. Each version is stored as a packed numeric
+ *              tuple (see FirmwareImage_ParseVersion) in a hash set, so a TPM firmware version can be matched with a constant-time lookup.
+ */
+typedef struct tdIfxSourceVersionIndex
+{
+    /// TRUE if all allowed source versions are numeric tuples and the index can be used, FALSE otherwise
+    BOOL fNumeric;
+    /// Number of entries in rgullVersions
+    unsigned short usCount;
+    /// Allowed source versions as packed numeric tuples
+    unsigned long long rgullVersions[MAX_SOURCE_VERSIONS_COUNT_V3];
+    /// Hash set over rgullVersions. Each slot holds the index into rgullVersions plus one or 0 if the slot is empty.
+    BYTE rgbHashSet[SOURCE_VERSION_HASH_SET_SIZE];
+} IfxSourceVersionIndex;
+
+/// Maximum number of manifests held by the manifest index
+#define MAX_MANIFEST_INDEX_COUNT 16
+/// Number of slots of the key group ID hash set of the manifest index (power of two, at least twice MAX_MANIFEST_INDEX_COUNT)
+#define MANIFEST_INDEX_HASH_SET_SIZE 32
+
+/**
+ *  @brief      Manifest index entry
+ *  @details    Locates the manifest of one key group within the manifest data of a firmware image.
+ */
+typedef struct tdIfxManifestIndexEntry
+{
+    /// Key group ID of the manifest
+    unsigned int unKeyGroupId;
+    /// Offset of the manifest within the manifest data in bytes
+    unsigned int unOffset;
+    /// Size of the manifest in bytes
+    unsigned short usSize;
+} IfxManifestIndexEntry;
+
+/**
+ *  @brief      Manifest index
+ *  @details    Index of the manifests built once by FirmwareImage_Unmarshal (only V2 and later images), so the manifest for a key
+ *              group can be selected without parsing the manifest data again.
+ */
+typedef struct tdIfxManifestIndex
+{
+    /// TRUE if the manifest data is well-formed and all manifests are indexed, FALSE otherwise
+    BOOL fValid;
+    /// Number of entries in rgsEntries
+    unsigned short usCount;
+    /// Manifests in the order of the manifest data
+    IfxManifestIndexEntry rgsEntries[MAX_MANIFEST_INDEX_COUNT];
+    /// Hash set over the key group IDs of rgsEntries. Each slot holds the index into rgsEntries plus one or 0 if the slot is empty.
+    BYTE rgbHashSet[MANIFEST_INDEX_HASH_SET_SIZE];
+} IfxManifestIndex;
+
 /**
  *  @brief      TPM Target State bit field
  *  @details    This structure contains bit flags indicating the target state of the TPM after the firmware update.
@@ -140,6 +201,8 @@ typedef struct tdIfxFirmwareImage
     /// Allowed versions where the firmware update can be applied to. Array of version names (e.g. "5.12.3456.0") with additional null termination (multi string).
     ///  Size of multi string array is usSourceVersionsSize.
     BYTE* prgwszSourceVersions;
+    /// Index of the allowed source versions in prgwszSourceVersions
+    IfxSourceVersionIndex sSourceVersionIndex;
     /// Target TPM family. Either DEVICE_TYPE_TPM_12 or DEVICE_TYPE_TPM_20.
     unsigned char bTargetTpmFamily;
     /// Size in bytes of wszTargetVersion. Uses big-endian format.
@@ -154,6 +217,8 @@ typedef struct tdIfxFirmwareImage
     unsigned char* rgbManifestData;
     /// Number of manifests included within rgbManifestData. Uses big-endian format.
     unsigned short usNumManifests;
+    /// Index of the manifests included within rgbManifestData
+    IfxManifestIndex sManifestIndex;
     /// Key group id. Uses big-endian format.
     unsigned int unKeyGroupId;
     /// Size in bytes of the parameter block in rgbPolicyParameterBlock. Uses big-endian format.
@@ -181,6 +246,10 @@ typedef struct tdIfxFirmwareImage
     unsigned short  usSignatureKeyId;
     /// Byte array for signature
     BYTE rgbSignature[256];
+    /// SHA-512 digest of the manifest at pbManifestDigestBlock (calculated by the firmware image check for TPM2.0 based firmware update)
+    BYTE rgbManifestDigest[TSS_SHA512_DIGEST_SIZE];
+    /// Policy parameter block rgbManifestDigest has been calculated for. NULL if no digest has been calculated.
+    const unsigned char* pbManifestDigestBlock;
 } IfxFirmwareImage;
 
 /**
@@ -203,6 +272,63 @@ FirmwareImage_Unmarshal(
     _Inout_ unsigned char**     PprgbBuffer,
     _Inout_ int*                PpnBufferSize);
 
+/**
+ *  @brief      Parses a firmware version string to a packed numeric tuple
+ *  @details    The version must consist of one to four decimal components separated by dots (e.g. "7.85.4555.0"). Each component must
+ *              be lower than 0x8000 and must not have leading zeros, so two versions are equal if and only if their packed tuples are equal.
+ *              The number of components is part of the packed tuple, e.g. "4.40.119" and "4.40.119.0" differ.
+ *
+ *  @param      PwszVersion             Version string.
+ *  @param      PunVersionLength        Length of the version string in elements (without null-termination).
+ *  @param      PpullVersion            Receives the packed numeric tuple.
+ *
+ *  @retval     TRUE                    The version was parsed.
+ *  @retval     FALSE                   The version is no numeric tuple.
+ */
+_Check_return_
+BOOL
+FirmwareImage_ParseVersion(
+    _In_count_(PunVersionLength)    const wchar_t*      PwszVersion,
+    _In_                            unsigned int        PunVersionLength,
+    _Out_                           unsigned long long* PpullVersion);
+
+/**
+ *  @brief      Checks whether a version is an allowed source version of a firmware image
+ *  @details    Looks the version up in the source version index. The index must be numeric (sSourceVersionIndex.fNumeric).
+ *
+ *  @param      PpFirmwareImage         Firmware image.
+ *  @param      PullVersion             Packed numeric tuple (see FirmwareImage_ParseVersion).
+ *
+ *  @retval     TRUE                    The version is an allowed source version.
+ *  @retval     FALSE                   Otherwise.
+ */
+_Check_return_
+BOOL
+FirmwareImage_IsSourceVersion(
+    _In_    const IfxFirmwareImage*     PpFirmwareImage,
+    _In_    unsigned long long          PullVersion);
+
+/**
+ *  @brief      Looks up the manifest of a key group in the manifest index of a firmware image
+ *  @details    The manifest index must be valid (sManifestIndex.fValid). The key group ID is looked up in the hash set of the
+ *              index. If several manifests have the same key group ID, the first one is returned.
+ *
+ *  @param      PpFirmwareImage         Firmware image.
+ *  @param      PunKeyGroupId           Key group ID of the TPM.
+ *  @param      PppbManifest            Receives the pointer to the manifest within the manifest data.
+ *  @param      PpusManifestSize        Receives the size of the manifest in bytes.
+ *
+ *  @retval     TRUE                    The image has a manifest for the key group.
+ *  @retval     FALSE                   Otherwise.
+ */
+_Check_return_
+BOOL
+FirmwareImage_FindManifest(
+    _In_    const IfxFirmwareImage*     PpFirmwareImage,
+    _In_    unsigned int                PunKeyGroupId,
+    _Out_   unsigned char**             PppbManifest,
+    _Out_   unsigned short*             PpusManifestSize);
+
 #ifdef __cplusplus
 }
 #endif
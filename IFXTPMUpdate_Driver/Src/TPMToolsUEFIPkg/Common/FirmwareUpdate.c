@@ -15,6 +15,7 @@
 #include "FirmwareUpdate.h"
 #include "FirmwareImage.h"
 #include "Crypt.h"
+#include "DeviceManagement.h"
 
 #include "TPM2_Marshal.h"
 #include "TPM2_FlushContext.h"
@@ -22,6 +23,7 @@
 #include "TPM2_GetTestResult.h"
 #include "TPM2_HierarchyChangeAuth.h"
 #include "TPM2_PolicyCommandCode.h"
+#include "TPM2_PolicyGetDigest.h"
 #include "TPM2_PolicySecret.h"
 #include "TPM2_SetPrimaryPolicy.h"
 #include "TPM2_StartAuthSession.h"
@@ -38,6 +40,8 @@
 #include "TPM2_FieldUpgradeAbandonVendor.h"
 
 #include "TPM_Types.h"
+// IFXTPMUPDATE_TPM20_ONLY removes the TPM1.2 detection, update and authorization paths (see IFXTPMUpdateTpm20.inf)
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 #include "TPM_Startup.h"
 #include "TPM_GetCapability.h"
 #include "TPM_GetTestResult.h"
@@ -51,6 +55,295 @@
 #include "TPM_FieldUpgradeStart.h"
 #include "TPM_FieldUpgradeUpdate.h"
 #include "TPM_FieldUpgradeComplete.h"
+#endif
+
+/// Snapshot of the TPM state from the last successful FirmwareUpdate_CalculateState call
+static TPM_STATE s_sTpmStateSnapshot;
+
+/// TPM state generation (see DeviceManagement_GetTpmStateGeneration) of s_sTpmStateSnapshot
+static unsigned int s_unTpmStateSnapshotGeneration = 0;
+
+/// Flag indicating s_sTpmStateSnapshot is filled
+static BOOL s_fTpmStateSnapshotValid = FALSE;
+
+/// Flag indicating s_sTpmStateSnapshot includes the state of the platform hierarchy
+static BOOL s_fTpmStateSnapshotPlatformHierarchy = FALSE;
+
+/// State of the platform hierarchy for the current TPM boot
+static PLATFORM_HIERARCHY_CACHE s_sPlatformHierarchy;
+
+/// TPM2.0 properties read by TPM2_GetCapability for the current TPM state generation
+static TPM_PROPERTY_MAP s_sTpmPropertyMap;
+
+/// Interface registers and transport profile hints read by the last FirmwareUpdate_QueryState call
+static TPM_INTERFACE_INFO s_sInterfaceInfo;
+
+/// Policy session completed by FirmwareUpdate_CompleteTPM20Policy and kept for a retry of the update, 0 if none
+static TSS_TPMI_SH_AUTH_SESSION s_hRetainedPolicySession = 0;
+
+/// Parameter buffer of the TPM2.0 field upgrade start, finalize and abandon commands (kept off the stack)
+static TSS_TPM2B_MAX_BUFFER s_sFieldUpgradeData;
+
+/// Telemetry of the current or last firmware transfer
+static FIRMWARE_TRANSFER_TELEMETRY s_sTransferTelemetry;
+
+/// Ticks when the current firmware transfer started
+static unsigned long long s_ullTransferStartTicks = 0;
+
+/// Ticks when the last firmware block was acknowledged
+static unsigned long long s_ullTransferBlockTicks = 0;
+
+/// Phase timing of the current or last firmware update
+static UPDATE_PHASE_TIMING s_sPhaseTiming = {UPDATE_PHASE_NONE, {0}, 0};
+
+/// Ticks when the phase timing was reset
+static unsigned long long s_ullPhaseResetTicks = 0;
+
+/// Ticks when the current phase started
+static unsigned long long s_ullPhaseStartTicks = 0;
+
+/// Firmware update engine driven by FirmwareUpdate_StartUpdate and FirmwareUpdate_PollUpdate
+static UPDATE_ENGINE s_sUpdateEngine;
+
+/// Number of bytes at the head and at the tail of a firmware image covered by its fingerprint
+#define FIRMWARE_UPDATE_IMAGE_FINGERPRINT_SIZE 512
+
+/// Parse result and verification outcome of the last image checked by FirmwareUpdate_CheckImage
+static VERIFIED_IMAGE_CACHE s_sVerifiedImage;
+
+/// Integrity check outcome of the last image checked by FirmwareUpdate_CheckImageIntegrity
+static IMAGE_INTEGRITY_CACHE s_sImageIntegrity;
+
+/// Checksum calculation started by FirmwareUpdate_StartImageIntegrityCheck
+static IMAGE_CHECKSUM_TASK s_sImageChecksumTask;
+
+/**
+ *  @brief      Look up a property in the TPM property map
+ *  @details
+ *
+ *  @param      PunCapability       Capability of the property.
+ *  @param      PunProperty         Property identifier.
+ *
+ *  @returns    Pointer to the map entry or NULL if the property is not in the map.
+ */
+static
+TPM_PROPERTY_MAP_ENTRY*
+FirmwareUpdate_FindTpmProperty(
+    _In_    TSS_TPM_CAP     PunCapability,
+    _In_    TSS_UINT32      PunProperty)
+{
+    unsigned int unIndex = 0;
+
+    // Entries of an older TPM state generation are outdated
+    if (s_sTpmPropertyMap.unGeneration != DeviceManagement_GetTpmStateGeneration())
+    {
+        Platform_MemorySet(&s_sTpmPropertyMap, 0, sizeof(s_sTpmPropertyMap));
+        s_sTpmPropertyMap.unGeneration = DeviceManagement_GetTpmStateGeneration();
+    }
+
+    for (unIndex = 0; unIndex < s_sTpmPropertyMap.unCount; unIndex++)
+    {
+        if (s_sTpmPropertyMap.rgsEntries[unIndex].capability == PunCapability &&
+                s_sTpmPropertyMap.rgsEntries[unIndex].unProperty == PunProperty)
+            return &s_sTpmPropertyMap.rgsEntries[unIndex];
+    }
+
+    return NULL;
+}
+
+/**
+ *  @brief      Add a property to the TPM property map
+ *  @details
+ *
+ *  @param      PunCapability       Capability of the property.
+ *  @param      PunProperty         Property identifier.
+ *
+ *  @returns    Pointer to the new map entry or NULL if the map is full.
+ */
+static
+TPM_PROPERTY_MAP_ENTRY*
+FirmwareUpdate_AddTpmProperty(
+    _In_    TSS_TPM_CAP     PunCapability,
+    _In_    TSS_UINT32      PunProperty)
+{
+    TPM_PROPERTY_MAP_ENTRY* psEntry = FirmwareUpdate_FindTpmProperty(PunCapability, PunProperty);
+
+    if (NULL == psEntry && s_sTpmPropertyMap.unCount < TPM_PROPERTY_MAP_SIZE)
+    {
+        psEntry = &s_sTpmPropertyMap.rgsEntries[s_sTpmPropertyMap.unCount++];
+        psEntry->capability = PunCapability;
+        psEntry->unProperty = PunProperty;
+    }
+
+    return psEntry;
+}
+
+/**
+ *  @brief      Read TPM2.0 properties into the TPM property map
+ *  @details    Properties already in the map for the current TPM state generation are not read again.
+ *              TPM properties (TSS_TPM_CAP_TPM_PROPERTIES) are read in as few TPM2_GetCapability calls as possible: each call
+ *              covers the range from the lowest to the highest missing property and is continued behind the last
+ *              returned property as long as the TPM reports more data. Properties the TPM skips are not implemented
+ *              and stay missing.
+ *              Vendor properties (TSS_TPM_CAP_VENDOR_PROPERTY) are read one per call since the TPM returns their values
+ *              without property identifiers.
+ *
+ *  @param      PunCapability       TSS_TPM_CAP_TPM_PROPERTIES or TSS_TPM_CAP_VENDOR_PROPERTY.
+ *  @param      PrgunProperties     Property identifiers to read.
+ *  @param      PunCount            Number of property identifiers (at most TPM_PROPERTY_MAP_SIZE).
+ *  @param      PfSingle            TRUE to read TPM properties one per call (e.g. in failure mode).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL               The TPM returned more than one vendor property.
+ *  @retval     ...                     Error codes from TSS_TPM2_GetCapability.
+ */
+static
+unsigned int
+FirmwareUpdate_QueryTpmProperties(
+    _In_                    TSS_TPM_CAP         PunCapability,
+    _In_count_(PunCount)    const TSS_UINT32*   PrgunProperties,
+    _In_                    unsigned int        PunCount,
+    _In_                    BOOL                PfSingle)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unIndex = 0;
+        TSS_UINT32 unNext = 0;
+
+        if (NULL == PrgunProperties || 0 == PunCount || PunCount > TPM_PROPERTY_MAP_SIZE ||
+                (TSS_TPM_CAP_TPM_PROPERTIES != PunCapability && TSS_TPM_CAP_VENDOR_PROPERTY != PunCapability))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Make room for the properties
+        if (s_sTpmPropertyMap.unCount + PunCount > TPM_PROPERTY_MAP_SIZE)
+            s_sTpmPropertyMap.unCount = 0;
+
+        unReturnValue = RC_SUCCESS;
+        for (;;)
+        {
+            TSS_UINT32 unFirst = 0, unLast = 0, unPropertyCount = 0;
+            BOOL fMissing = FALSE;
+            BYTE bMoreData = 0;
+            TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
+
+            // Determine the range of the properties still missing
+            for (unIndex = 0; unIndex < PunCount; unIndex++)
+            {
+                if (PrgunProperties[unIndex] < unNext || NULL != FirmwareUpdate_FindTpmProperty(PunCapability, PrgunProperties[unIndex]))
+                    continue;
+                if (!fMissing || PrgunProperties[unIndex] < unFirst)
+                    unFirst = PrgunProperties[unIndex];
+                if (!fMissing || PrgunProperties[unIndex] > unLast)
+                    unLast = PrgunProperties[unIndex];
+                fMissing = TRUE;
+            }
+            if (!fMissing)
+                break;
+
+            if (TSS_TPM_CAP_VENDOR_PROPERTY == PunCapability)
+            {
+                BYTE rgbValue[TPM_PROPERTY_MAP_MAX_VALUE];
+                TSS_UINT32 unSize = sizeof(rgbValue);
+
+                unReturnValue = TSS_TPM2_GetVendorProperty(unFirst, rgbValue, &unSize);
+                // An oversized property is kept with its size only, so the size checks of the callers reject it
+                if (RC_E_BUFFER_TOO_SMALL == unReturnValue)
+                {
+                    Platform_MemorySet(rgbValue, 0, sizeof(rgbValue));
+                    unReturnValue = RC_SUCCESS;
+                }
+                if (RC_E_FAIL == unReturnValue)
+                {
+                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetVendorProperty did not return exactly one capability");
+                    break;
+                }
+                if (TSS_TPM_RC_SUCCESS != unReturnValue)
+                    break;
+
+                psEntry = FirmwareUpdate_AddTpmProperty(PunCapability, unFirst);
+                if (NULL != psEntry)
+                {
+                    psEntry->usSize = (TSS_UINT16)unSize;
+                    unReturnValue = Platform_MemoryCopy(psEntry->rgbValue, sizeof(psEntry->rgbValue), rgbValue, sizeof(rgbValue));
+                    if (RC_SUCCESS != unReturnValue)
+                        break;
+                }
+                unNext = unFirst + 1;
+            }
+            else if (PfSingle)
+            {
+                // A single property is read without the TPML_TAGGED_TPM_PROPERTY, like the TPM reports it in failure mode
+                TSS_UINT32 unValue = 0;
+
+                unReturnValue = TSS_TPM2_GetTpmProperty(unFirst, &unValue);
+                if (TSS_TPM_RC_SUCCESS == unReturnValue)
+                {
+                    psEntry = FirmwareUpdate_AddTpmProperty(PunCapability, unFirst);
+                    if (NULL != psEntry)
+                        psEntry->unValue = unValue;
+                }
+                else if (RC_E_NOT_FOUND == unReturnValue)
+                    unReturnValue = RC_SUCCESS;
+                else
+                    break;
+                unNext = unFirst + 1;
+            }
+            else
+            {
+                TSS_TPMS_CAPABILITY_DATA sCapabilityData;
+                TSS_TPML_TAGGED_TPM_PROPERTY* pProperties = &sCapabilityData.data.tpmProperties;
+                Platform_MemorySet(&sCapabilityData, 0, sizeof(sCapabilityData));
+
+                unPropertyCount = unLast - unFirst + 1;
+                if (unPropertyCount > TSS_MAX_TPM_PROPERTIES)
+                    unPropertyCount = TSS_MAX_TPM_PROPERTIES;
+
+                unReturnValue = TSS_TPM2_GetCapability(PunCapability, unFirst, unPropertyCount, &bMoreData, &sCapabilityData);
+                if (TSS_TPM_RC_SUCCESS != unReturnValue)
+                    break;
+                if (pProperties->count > unPropertyCount)
+                {
+                    unReturnValue = RC_E_FAIL;
+                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more properties than requested");
+                    break;
+                }
+
+                // Store the requested properties among the returned ones
+                for (unIndex = 0; unIndex < pProperties->count; unIndex++)
+                {
+                    unsigned int unWanted = 0;
+                    for (unWanted = 0; unWanted < PunCount; unWanted++)
+                    {
+                        if (PrgunProperties[unWanted] == pProperties->tpmProperty[unIndex].property)
+                        {
+                            psEntry = FirmwareUpdate_AddTpmProperty(PunCapability, PrgunProperties[unWanted]);
+                            if (NULL != psEntry)
+                                psEntry->unValue = pProperties->tpmProperty[unIndex].value;
+                            break;
+                        }
+                    }
+                }
+
+                // The TPM does not implement the missing properties up to the last returned one. Without more data it
+                // does not implement any further properties.
+                if (0 == pProperties->count || TSS_YES != bMoreData)
+                    break;
+                unNext = pProperties->tpmProperty[pProperties->count - 1].property + 1;
+                if (unNext <= unFirst)
+                    unNext = unFirst + 1;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
 
 /**
  *  @brief      Function to read Security Module Logic Info from TPM2.0.
@@ -83,29 +376,22 @@ FirmwareUpdate_Tpm20_GetSecurityModuleLogicInfo2(
 
         {
             // Read out the vendor specific TPM_PT_VENDOR_FIX_SMLI2 property from the TPM.
-            TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
+            // The marshaled property is not larger than the structure it is unmarshaled to
+            BYTE rgbProperty[sizeof(sSecurityModuleLogicInfo2_d)];
+            TSS_UINT32 unPropertySize = sizeof(rgbProperty);
             int nBufferSize = 0;
             BYTE* rgbBuffer = NULL;
-            BYTE bMoreData = 0;
 
-            Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
-            unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_SMLI2, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+            unReturnValue = TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_SMLI2, rgbProperty, &unPropertySize);
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned an unexpected value. (TPM_CAP_VENDOR_PROPERTY,TPM_PT_VENDOR_FIX_SMLI2)");
-                break;
-            }
-
-            if (1 != vendorCapabilityData.data.vendorData.count)
-            {
-                unReturnValue = RC_E_FAIL;
-                ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
+                ERROR_STORE(unReturnValue, L"TSS_TPM2_GetVendorProperty returned an unexpected value. (TPM_PT_VENDOR_FIX_SMLI2)");
                 break;
             }
 
             // Unmarshal the property to a sSecurityModuleLogicInfo2_d structure
-            nBufferSize = vendorCapabilityData.data.vendorData.buffer[0].size;
-            rgbBuffer = (BYTE*)&vendorCapabilityData.data.vendorData.buffer[0].buffer;
+            nBufferSize = (int)unPropertySize;
+            rgbBuffer = rgbProperty;
 
             unReturnValue = TSS_sSecurityModuleLogicInfo2_d_Unmarshal(PpSecurityModuleLogicInfo2, &rgbBuffer, &nBufferSize);
             if (RC_SUCCESS != unReturnValue)
@@ -125,6 +411,8 @@ FirmwareUpdate_Tpm20_GetSecurityModuleLogicInfo2(
  *  @details    This function obtains the field upgrade counter value from the TPM.
  *
  *  @param      PbfTpmAttributes            TPM state attributes.
+ *  @param      PpSecurityModuleLogicInfo2  Security Module Logic Info already read from a TPM2.0 without firmware update loader
+ *                                          or NULL to read it from the TPM.
  *  @param      PpunUpgradeCounter          Pointer to the field upgrade counter parameter.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
@@ -136,8 +424,9 @@ FirmwareUpdate_Tpm20_GetSecurityModuleLogicInfo2(
 _Check_return_
 unsigned int
 FirmwareUpdate_GetTpmFieldUpgradeCounter(
-    _In_    BITFIELD_TPM_ATTRIBUTES PbfTpmAttributes,
-    _Out_   unsigned int*           PpunUpgradeCounter)
+    _In_        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
+    _In_opt_    const sSecurityModuleLogicInfo2_d*  PpSecurityModuleLogicInfo2,
+    _Out_       unsigned int*                       PpunUpgradeCounter)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
@@ -161,31 +450,20 @@ FirmwareUpdate_GetTpmFieldUpgradeCounter(
             if (PbfTpmAttributes.tpmHasFULoader20)
             {
                 // Read update counter
-                BYTE bMoreData = 0;
-                TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-                Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
+                const TSS_UINT32 unProperty = TPM_PT_VENDOR_FIX_FU_COUNTER;
+                TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
 
                 // Get TPM_PT_VENDOR_FIX_FU_COUNTER
-                unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_COUNTER, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+                unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_VENDOR_PROPERTY, &unProperty, 1, TRUE);
                 if (TSS_TPM_RC_SUCCESS != unReturnValue)
                 {
                     ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_COUNTER)");
                     break;
                 }
 
-                // Check count of capabilities returned
-                if (1 != vendorCapabilityData.data.vendorData.count)
-                {
-                    unReturnValue = RC_E_FAIL;
-                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-                    break;
-                }
-
-                // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_FU_COUNTER)
-                TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
                 // Check buffer size
-                if (sizeof(TSS_UINT16) != pMaxBuffer->size)
+                psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_VENDOR_PROPERTY, unProperty);
+                if (NULL == psEntry || sizeof(TSS_UINT16) != psEntry->usSize)
                 {
                     unReturnValue = RC_E_FAIL;
                     ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
@@ -193,8 +471,8 @@ FirmwareUpdate_GetTpmFieldUpgradeCounter(
                 }
 
                 // Get value
-                BYTE* pbBuffer = pMaxBuffer->buffer;
-                TSS_INT32 nSizeRemaining = pMaxBuffer->size;
+                BYTE* pbBuffer = psEntry->rgbValue;
+                TSS_INT32 nSizeRemaining = psEntry->usSize;
                 TSS_UINT16 upgradeCounter = 0;
                 unReturnValue = TSS_UINT16_Unmarshal(&upgradeCounter, &pbBuffer, &nSizeRemaining);
                 if (RC_SUCCESS != unReturnValue)
@@ -203,6 +481,12 @@ FirmwareUpdate_GetTpmFieldUpgradeCounter(
                 // Return upgrade counter
                 *PpunUpgradeCounter = upgradeCounter;
             }
+            else if (NULL != PpSecurityModuleLogicInfo2)
+            {
+                // TPM2.0, the caller has already read the Security Module Logic Info
+                *PpunUpgradeCounter = PpSecurityModuleLogicInfo2->wFieldUpgradeCounter;
+                unReturnValue = RC_SUCCESS;
+            }
             else
             {
                 // TPM2.0
@@ -221,6 +505,7 @@ FirmwareUpdate_GetTpmFieldUpgradeCounter(
                 *PpunUpgradeCounter = securityModuleLogicInfo2.wFieldUpgradeCounter;
             }
         }
+#ifndef IFXTPMUPDATE_TPM20_ONLY
         else if (PbfTpmAttributes.tpm12 || !PbfTpmAttributes.tpmInOperationalMode)
         {
             // TPM1.2
@@ -246,6 +531,7 @@ FirmwareUpdate_GetTpmFieldUpgradeCounter(
 
             *PpunUpgradeCounter = securityModuleLogicInfo.wFieldUpgradeCounter;
         }
+#endif
         else
         {
             unReturnValue = RC_E_FAIL;
@@ -289,31 +575,20 @@ FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf(
         *PpunUpgradeCounterSelf = 0;
 
         // Read update counter (same version)
-        BYTE bMoreData = 0;
-        TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-        Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
+        const TSS_UINT32 unProperty = TPM_PT_VENDOR_FIX_FU_COUNTER_SAME;
+        TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
 
         // Get TPM_PT_VENDOR_FIX_FU_COUNTER_SAME
-        unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_COUNTER_SAME, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+        unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_VENDOR_PROPERTY, &unProperty, 1, TRUE);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
         {
             ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_COUNTER_SAME)");
             break;
         }
 
-        // Check count of capabilities returned
-        if (1 != vendorCapabilityData.data.vendorData.count)
-        {
-            unReturnValue = RC_E_FAIL;
-            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-            break;
-        }
-
-        // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_FU_COUNTER_SAME)
-        TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
         // Check buffer size
-        if (sizeof(TSS_UINT16) != pMaxBuffer->size)
+        psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_VENDOR_PROPERTY, unProperty);
+        if (NULL == psEntry || sizeof(TSS_UINT16) != psEntry->usSize)
         {
             unReturnValue = RC_E_FAIL;
             ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
@@ -321,8 +596,8 @@ FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf(
         }
 
         // Get value
-        BYTE* pbBuffer = pMaxBuffer->buffer;
-        TSS_INT32 nSizeRemaining = pMaxBuffer->size;
+        BYTE* pbBuffer = psEntry->rgbValue;
+        TSS_INT32 nSizeRemaining = psEntry->usSize;
         TSS_UINT16 upgradeCounterSelf = 0;
         unReturnValue = TSS_UINT16_Unmarshal(&upgradeCounterSelf, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
@@ -366,12 +641,10 @@ FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(
             break;
         }
 
-        BYTE bMoreData = 0;
-        TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-        Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
+        TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
 
         // Get TPM2.0 current firmware version
-        unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, PunCapProperty, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+        unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_VENDOR_PROPERTY, &PunCapProperty, 1, TRUE);
         if (RC_SUCCESS != unReturnValue)
         {
             unReturnValue = RC_E_FAIL;
@@ -379,19 +652,9 @@ FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(
             break;
         }
 
-        // Check count of capabilities returned
-        if (1 != vendorCapabilityData.data.vendorData.count)
-        {
-            unReturnValue = RC_E_FAIL;
-            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-            break;
-        }
-
-        // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_OPERATION_MODE)
-        TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
         // Check buffer size
-        if (9 != pMaxBuffer->size)
+        psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_VENDOR_PROPERTY, PunCapProperty);
+        if (NULL == psEntry || 9 != psEntry->usSize)
         {
             unReturnValue = RC_E_FAIL;
             ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
@@ -399,8 +662,8 @@ FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(
         }
 
         // Unmarshal FU firmware version
-        TSS_INT32 nSizeRemaining = pMaxBuffer->size;
-        TSS_BYTE* pbBuffer = pMaxBuffer->buffer;
+        TSS_INT32 nSizeRemaining = psEntry->usSize;
+        TSS_BYTE* pbBuffer = psEntry->rgbValue;
         unReturnValue = TSS_UINT16_Unmarshal(&PpFirmwareVersion->usMajor, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -417,7 +680,7 @@ FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(
         // Cast build number
         PpFirmwareVersion->usBuild = (TSS_UINT16)unBuild;
         // Set Revision: if no bit is set return not certified (2), if one bit is set return certified (0)
-        PpFirmwareVersion->usRevision = (0 == pMaxBuffer->buffer[8]) ? 2 : 0;
+        PpFirmwareVersion->usRevision = (0 == psEntry->rgbValue[8]) ? 2 : 0;
         unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
@@ -461,11 +724,10 @@ FirmwareUpdate_GetTpmFirmwareVersion(
         if (PbfTpmAttributes.tpm20)
         {
             // Read version from TPM2.0
-            BYTE bMoreData = 0;
-            TSS_TPMS_CAPABILITY_DATA capabilityData;
+            const TSS_UINT32 rgunProperties[] = { TSS_TPM_PT_FIRMWARE_VERSION_1, TSS_TPM_PT_FIRMWARE_VERSION_2 };
+            TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
             unsigned int unFirmwareVersion1 = 0;
             unsigned int unFirmwareVersion2 = 0;
-            Platform_MemorySet(&capabilityData, 0, sizeof(capabilityData));
 
             if (PbfTpmAttributes.tpmHasFULoader20)
             {
@@ -478,64 +740,35 @@ FirmwareUpdate_GetTpmFirmwareVersion(
                 }
             }
             else {
-                if (PbfTpmAttributes.tpm20InFailureMode || PbfTpmAttributes.tpm20restartRequired)
+                // In tpm20InFailureMode and tpm20restartRequired mode the capabilities must be read individually.
+                // In other TPM2.0 states the TPM allows to get both capabilities in one TPM command. This is faster.
+                // Get TSS_TPM_PT_FIRMWARE_VERSION_1 and TSS_TPM_PT_FIRMWARE_VERSION_2.
+                unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_TPM_PROPERTIES, rgunProperties, RG_LEN(rgunProperties),
+                                PbfTpmAttributes.tpm20InFailureMode || PbfTpmAttributes.tpm20restartRequired);
+                if (RC_SUCCESS != unReturnValue)
                 {
-                    // In tpm20InFailureMode and tpm20restartRequired mode the capabilities must be read individually.
-                    // Get TSS_TPM_PT_FIRMWARE_VERSION_1.
-                    unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_FIRMWARE_VERSION_1, 1, &bMoreData, &capabilityData);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned an unexpected value.(TPM_CAP_TPM_PROPERTIES,TPM_PT_FIRMWARE_VERSION_1)");
-                        break;
-                    }
-
-                    // Check count of capabilities returned
-                    if (1 != capabilityData.data.tpmProperties.count)
-                    {
-                        unReturnValue = RC_E_FAIL;
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-                        break;
-                    }
-                    unFirmwareVersion1 = capabilityData.data.tpmProperties.tpmProperty[0].value;
-
-                    // Get TSS_TPM_PT_FIRMWARE_VERSION_2.
-                    unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_FIRMWARE_VERSION_2, 1, &bMoreData, &capabilityData);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned an unexpected value.(TPM_CAP_TPM_PROPERTIES,TPM_PT_FIRMWARE_VERSION_2)");
-                        break;
-                    }
-
-                    // Check count of capabilities returned
-                    if (1 != capabilityData.data.tpmProperties.count)
-                    {
-                        unReturnValue = RC_E_FAIL;
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-                        break;
-                    }
-                    unFirmwareVersion2 = capabilityData.data.tpmProperties.tpmProperty[0].value;
+                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned an unexpected value.(TPM_CAP_TPM_PROPERTIES,TPM_PT_FIRMWARE_VERSION_1)");
+                    break;
                 }
-                else
+
+                // Check that both capabilities have been returned
+                psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_FIRMWARE_VERSION_1);
+                if (NULL == psEntry)
                 {
-                    // In other TPM2.0 states the TPM allows to get both capabilities in one TPM command. This is faster.
-                    // Get TSS_TPM_PT_FIRMWARE_VERSION_1 and TSS_TPM_PT_FIRMWARE_VERSION_2.
-                    unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_FIRMWARE_VERSION_1, 2, &bMoreData, &capabilityData);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned an unexpected value.(TPM_CAP_TPM_PROPERTIES,TPM_PT_FIRMWARE_VERSION_1)");
-                        break;
-                    }
+                    unReturnValue = RC_E_FAIL;
+                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability did not return TPM_PT_FIRMWARE_VERSION_1");
+                    break;
+                }
+                unFirmwareVersion1 = psEntry->unValue;
 
-                    // Check count of capabilities returned
-                    if (2 != capabilityData.data.tpmProperties.count)
-                    {
-                        unReturnValue = RC_E_FAIL;
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability did not return two capabilities");
-                        break;
-                    }
-                    unFirmwareVersion1 = capabilityData.data.tpmProperties.tpmProperty[0].value;
-                    unFirmwareVersion2 = capabilityData.data.tpmProperties.tpmProperty[1].value;
+                psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_FIRMWARE_VERSION_2);
+                if (NULL == psEntry)
+                {
+                    unReturnValue = RC_E_FAIL;
+                    ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability did not return TPM_PT_FIRMWARE_VERSION_2");
+                    break;
                 }
+                unFirmwareVersion2 = psEntry->unValue;
 
                 PpFirmwareVersion->usMajor = unFirmwareVersion1 >> 16;
                 PpFirmwareVersion->usMinor = unFirmwareVersion1 & 0xFFFF;
@@ -543,6 +776,7 @@ FirmwareUpdate_GetTpmFirmwareVersion(
                 PpFirmwareVersion->usRevision = unFirmwareVersion2 & 0xFF;
             }
         }
+#ifndef IFXTPMUPDATE_TPM20_ONLY
         else if (PbfTpmAttributes.tpm12 || !PbfTpmAttributes.tpmInOperationalMode)
         {
             // TPM1.2
@@ -565,6 +799,7 @@ FirmwareUpdate_GetTpmFirmwareVersion(
                 PpFirmwareVersion->usRevision = sTpmVersionInfo.vendorSpecific[4];
             }
         }
+#endif
         else
         {
             // Unknown TPM mode
@@ -656,6 +891,8 @@ FirmwareUpdate_GetTpmFirmwareVersionString(
 /**
  *  @brief      Function to read the key group ID
  *  @details    This function obtains the key group ID value from the TPM (only TPM2.0 based firmware update).
+ *              The value is kept in the TPM state snapshot (see FirmwareUpdate_CalculateState) and served from there as long
+ *              as the snapshot is valid.
  *
  *  @param      PpunKeyGroupId              Variable to store key group ID.
  *
@@ -684,41 +921,38 @@ FirmwareUpdate_GetTpmKeyGroupId(
         // Initialize output parameter
         *PpunKeyGroupId = 0;
 
-        // Read Keygroup ID
-        BYTE bMoreData = 0;
-        TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-        Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
-
-        // Get TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID
-        unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        // Serve the key group ID from the TPM state snapshot if the TPM state has not changed since
+        if (s_fTpmStateSnapshotValid && s_sTpmStateSnapshot.fKeyGroupIdValid &&
+                s_unTpmStateSnapshotGeneration == DeviceManagement_GetTpmStateGeneration())
         {
-            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID)");
+            *PpunKeyGroupId = s_sTpmStateSnapshot.unKeyGroupId;
+            unReturnValue = RC_SUCCESS;
             break;
         }
 
-        // Check count of capabilities returned
-        if (1 != vendorCapabilityData.data.vendorData.count)
+        // Read Keygroup ID
+        BYTE rgbProperty[sizeof(TSS_UINT32)];
+        TSS_UINT32 unPropertySize = sizeof(rgbProperty);
+
+        // Get TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID
+        unReturnValue = TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID, rgbProperty, &unPropertySize);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
         {
-            unReturnValue = RC_E_FAIL;
-            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
+            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID)");
             break;
         }
 
-        // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_FU_KEYGROUP_ID)
-        TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
         // Check buffer size
-        if (sizeof(TSS_UINT32) != pMaxBuffer->size)
+        if (sizeof(TSS_UINT32) != unPropertySize)
         {
             unReturnValue = RC_E_FAIL;
-            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
+            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetVendorProperty returned wrong buffer size of capability");
             break;
         }
 
         // Get value
-        BYTE* pbBuffer = pMaxBuffer->buffer;
-        TSS_INT32 nSizeRemaining = pMaxBuffer->size;
+        BYTE* pbBuffer = rgbProperty;
+        TSS_INT32 nSizeRemaining = (TSS_INT32)unPropertySize;
         TSS_UINT32 keygroupId = 0;
         unReturnValue = TSS_UINT32_Unmarshal(&keygroupId, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
@@ -726,6 +960,13 @@ FirmwareUpdate_GetTpmKeyGroupId(
 
         // Return Keygroup ID
         *PpunKeyGroupId = keygroupId;
+
+        // Keep it in the TPM state snapshot if that is still current
+        if (s_fTpmStateSnapshotValid && s_unTpmStateSnapshotGeneration == DeviceManagement_GetTpmStateGeneration())
+        {
+            s_sTpmStateSnapshot.unKeyGroupId = keygroupId;
+            s_sTpmStateSnapshot.fKeyGroupIdValid = TRUE;
+        }
     }
     WHILE_FALSE_END;
 
@@ -768,6 +1009,14 @@ FirmwareUpdate_SelectManifest(
         if (RC_SUCCESS != unReturnValue)
             break;
 
+        // Look the manifest up in the index built by FirmwareImage_Unmarshal
+        if (PpsFirmwareImage->sManifestIndex.fValid)
+        {
+            if (!FirmwareImage_FindManifest(PpsFirmwareImage, PpsFirmwareImage->unKeyGroupId, &PpsFirmwareImage->rgbPolicyParameterBlock, &PpsFirmwareImage->usPolicyParameterBlockSize))
+                unReturnValue = RC_E_NEWER_FW_IMAGE_REQUIRED;
+            break;
+        }
+
         // Get pointer and size of manifest data
         BYTE* rgbBuffer = PpsFirmwareImage->rgbManifestData;
         TSS_INT32 nBufferSize = PpsFirmwareImage->unManifestDataSize;
@@ -882,24 +1131,36 @@ FirmwareUpdate_CheckManifest(
             break;
         }
 
+        // Calculate the manifest digest for TPM2_FieldUpgradeStartVendor now, so it is not calculated while the policy session is open
+        if (PpsFirmwareImage->pbManifestDigestBlock != PpsFirmwareImage->rgbPolicyParameterBlock)
+        {
+            PpsFirmwareImage->pbManifestDigestBlock = NULL;
+            unReturnValue = Crypt_SHA512(PpsFirmwareImage->rgbPolicyParameterBlock, PpsFirmwareImage->usPolicyParameterBlockSize, PpsFirmwareImage->rgbManifestDigest);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE_FMT(RC_E_FAIL, L"Manifest hash creation failed (%x)", unReturnValue);
+                unReturnValue = RC_E_FAIL;
+                break;
+            }
+            PpsFirmwareImage->pbManifestDigestBlock = PpsFirmwareImage->rgbPolicyParameterBlock;
+        }
+
         if (!PbfTpmAttributes.tpmInOperationalMode)
         {
             // Get manifest hash from TPM
-            BYTE bMoreData = 0;
-            TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-            Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
+            BYTE rgbProperty[sizeof(TSS_TPMT_HA)];
+            TSS_UINT32 unPropertySize = sizeof(rgbProperty);
 
             // Get TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST
-            unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+            unReturnValue = TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST, rgbProperty, &unPropertySize);
             if (TSS_TPM_RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST)");
+                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST)");
                 break;
             }
 
-            TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-            BYTE* pbBuffer = pMaxBuffer->buffer;
-            TSS_INT32 nSize = pMaxBuffer->size;
+            BYTE* pbBuffer = rgbProperty;
+            TSS_INT32 nSize = (TSS_INT32)unPropertySize;
 
             // Unmarshal TPMT_HA structure
             TSS_TPMT_HA manifestHashInfo;
@@ -924,7 +1185,7 @@ FirmwareUpdate_CheckManifest(
                 case TSS_TPM_ALG_SHA512:
                     pbTpmFuStartHash = manifestHashInfo.digest.sha512;
                     unDigestSize = TSS_SHA512_DIGEST_SIZE;
-                    unReturnValue = Crypt_SHA512(PpsFirmwareImage->rgbPolicyParameterBlock, PpsFirmwareImage->usPolicyParameterBlockSize, rgbManifestHash);
+                    unReturnValue = Platform_MemoryCopy(rgbManifestHash, sizeof(rgbManifestHash), PpsFirmwareImage->rgbManifestDigest, TSS_SHA512_DIGEST_SIZE);
                     break;
 
                 default:
@@ -956,76 +1217,274 @@ FirmwareUpdate_CheckManifest(
 }
 
 /**
- *  @brief      Function to check if the TPM is updatable with the given firmware image
- *  @details    Some parameters like GUID, file content signature, TPM firmware major minor version or file content CRC
- *              are checked to get a decision if the firmware is updatable with the current image.
+ *  @brief      Calculate the CRC and the digests of a firmware image in one pass
+ *  @details    The CRC, the SHA-256 digest of the signed part of the image and the SHA-256 digest of the firmware block are
+ *              calculated by Crypt_HashRanges in a single pass over the image. The function does not log or store errors
+ *              since it may run on an application processor (see FirmwareUpdate_StartImageIntegrityCheck).
  *
- *  @param      PbfTpmAttributes            TPM state attributes.
  *  @param      PrgbFirmwareImage           Pointer to the firmware image byte stream.
- *  @param      PnFirmwareImageSize         Size of the firmware image byte stream.
- *  @param      PpsFirmwareImage            Pointer to the unmarshalled firmware image structure (Unmarshalled PrgbFirmwareImage).
- *  @param      PpfValid                    TRUE in case the image is valid, FALSE otherwise.
- *  @param      PpbfNewTpmFirmwareInfo      Pointer to a bit field to return info data for the new firmware image.
- *  @param      PpunErrorDetails            Pointer to an unsigned int to return error details. Possible values are:\n
- *                                              RC_E_FW_UPDATE_BLOCKED in case the field upgrade counter value has been exceeded.\n
- *                                              RC_E_WRONG_FW_IMAGE in case the TPM is not updatable with the given image.\n
- *                                              RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
- *                                              RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.\n
- *                                              RC_E_WRONG_DECRYPT_KEYS in case the TPM2.0 does not have decrypt keys matching to the firmware image.\n
- *                                              RC_E_NEWER_FW_IMAGE_REQUIRED in case the TPM2.0 does not have a key group id matching to the firmware image.
+ *  @param      PunCrcDataSize              Number of bytes covered by the CRC.
+ *  @param      PunSignedDataSize           Number of bytes covered by the signature digest (not more than PunCrcDataSize). 0 to skip the digest.
+ *  @param      PunFirmwareOffset           Offset of the firmware block in the image.
+ *  @param      PunFirmwareSize             Size of the firmware block (must end within PunCrcDataSize). 0 to skip the digest.
+ *  @param      PpunCRC                     Receives the CRC value.
+ *  @param      PrgbSignedDataDigest        Receives the SHA-256 digest of the signed part. Zeroed if PunSignedDataSize is 0.
+ *  @param      PrgbFirmwareDigest          Receives the SHA-256 digest of the firmware block. Zeroed if PunFirmwareSize is 0.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
- *  @retval     RC_E_FAIL                   An unexpected error occurred.
- *  @retval     RC_E_BAD_PARAMETER          In case of a NULL input parameter.
- *  @retval     ...                         Error codes from called functions.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     ...                         Error codes from Crypt_HashRanges.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_IsFirmwareUpdatable(
-    _In_                                BITFIELD_TPM_ATTRIBUTES         PbfTpmAttributes,
-    _In_bytecount_(PnFirmwareImageSize) BYTE*                           PrgbFirmwareImage,
-    _In_                                int                             PnFirmwareImageSize,
-    _In_                                IfxFirmwareImage*               PpsFirmwareImage,
-    _Out_                               BOOL*                           PpfValid,
-    _Out_                               BITFIELD_NEW_TPM_FIRMWARE_INFO* PpbfNewTpmFirmwareInfo,
-    _Out_                               unsigned int*                   PpunErrorDetails)
+FirmwareUpdate_CalculateImageChecksums(
+    _In_bytecount_(PunCrcDataSize)          const BYTE*     PrgbFirmwareImage,
+    _In_                                    unsigned int    PunCrcDataSize,
+    _In_                                    unsigned int    PunSignedDataSize,
+    _In_                                    unsigned int    PunFirmwareOffset,
+    _In_                                    unsigned int    PunFirmwareSize,
+    _Out_                                   unsigned int*   PpunCRC,
+    _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE            PrgbSignedDataDigest[TSS_SHA256_DIGEST_SIZE],
+    _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE            PrgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE])
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
-        // Check _Out_ parameters.
-        if (NULL == PpfValid || NULL == PpbfNewTpmFirmwareInfo || NULL == PpunErrorDetails)
+        CRYPT_HASH_RANGE rgsRanges[2];
+        unsigned int unFirmwareEnd = PunFirmwareOffset + PunFirmwareSize;
+
+        // Check parameters
+        if (NULL == PrgbFirmwareImage || 0 == PunCrcDataSize || PunSignedDataSize > PunCrcDataSize ||
+                unFirmwareEnd < PunFirmwareOffset || unFirmwareEnd > PunCrcDataSize ||
+                NULL == PpunCRC || NULL == PrgbSignedDataDigest || NULL == PrgbFirmwareDigest)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpfValid or PpbfNewTpmFirmwareInfo or PpunErrorDetails is NULL)");
             break;
         }
 
-        // Set default value for _Out_ parameters.
-        *PpfValid = FALSE;
-        *PpunErrorDetails = RC_E_WRONG_FW_IMAGE;
-        Platform_MemorySet(PpbfNewTpmFirmwareInfo, 0, sizeof(BITFIELD_NEW_TPM_FIRMWARE_INFO));
+        // The signed part starts at the beginning of the image and ends in front of the signature
+        rgsRanges[0].unOffset = 0;
+        rgsRanges[0].unSize = PunSignedDataSize;
+        rgsRanges[0].unAlgorithm = CRYPT_HASH_ALGORITHM_SHA256;
+        rgsRanges[0].unDigestSize = TSS_SHA256_DIGEST_SIZE;
+        rgsRanges[0].pbDigest = PrgbSignedDataDigest;
+
+        // The firmware block
+        rgsRanges[1].unOffset = PunFirmwareOffset;
+        rgsRanges[1].unSize = PunFirmwareSize;
+        rgsRanges[1].unAlgorithm = CRYPT_HASH_ALGORITHM_SHA256;
+        rgsRanges[1].unDigestSize = TSS_SHA256_DIGEST_SIZE;
+        rgsRanges[1].pbDigest = PrgbFirmwareDigest;
+
+        unReturnValue = Crypt_HashRanges(PrgbFirmwareImage, PunCrcDataSize, rgsRanges, RG_LEN(rgsRanges), PpunCRC);
+    }
+    WHILE_FALSE_END;
 
-        // Check _In_ parameters.
-        if (NULL == PrgbFirmwareImage ||
-                0 >= PnFirmwareImageSize ||
-                NULL == PpsFirmwareImage)
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Calculate the fingerprint of a firmware image
+ *  @details    The fingerprint is a CRC over the head of the image and the tail with signature and checksum. Together with
+ *              the image address and size it identifies an image in the verified image cache without reading all of it.
+ *
+ *  @param      PrgbImage               Firmware image byte stream.
+ *  @param      PullImageSize           Size of firmware image byte stream.
+ *
+ *  @returns    The fingerprint.
+ */
+static
+unsigned int
+FirmwareUpdate_GetImageFingerprint(
+    _In_bytecount_(PullImageSize)   const BYTE*         PrgbImage,
+    _In_                            unsigned long long  PullImageSize)
+{
+    unsigned int unFingerprint = 0;
+    unsigned int unSize = FIRMWARE_UPDATE_IMAGE_FINGERPRINT_SIZE;
+
+    if (PullImageSize < unSize)
+        unSize = (unsigned int)PullImageSize;
+
+    IGNORE_RETURN_VALUE(Crypt_CRCUpdate(PrgbImage, unSize, &unFingerprint));
+    IGNORE_RETURN_VALUE(Crypt_CRCUpdate(PrgbImage + (PullImageSize - unSize), unSize, &unFingerprint));
+
+    return unFingerprint;
+}
+
+/**
+ *  @brief      Determine the parts of a firmware image covered by the CRC and the digests
+ *  @details    The CRC covers the image without the CRC value. The signature digest covers the image without signature and
+ *              CRC value. The firmware block digest is only checked for images with a policy parameter block and is only
+ *              calculated with the CRC if the unmarshalled firmware block lies within the part of the image covered by the CRC.
+ *
+ *  @param      PrgbFirmwareImage           Pointer to the firmware image byte stream.
+ *  @param      PnFirmwareImageSize         Size of the firmware image byte stream.
+ *  @param      PpsFirmwareImage            Pointer to the unmarshalled firmware image structure (Unmarshalled PrgbFirmwareImage).
+ *  @param      PpunCrcDataSize             Receives the number of bytes covered by the CRC.
+ *  @param      PpunSignedDataSize          Receives the number of bytes covered by the signature digest.
+ *  @param      PpunFirmwareOffset          Receives the offset of the firmware block.
+ *  @param      PpunFirmwareSize            Receives the size of the firmware block or 0 if its digest is not calculated with the CRC.
+ */
+static
+void
+FirmwareUpdate_GetImageChecksumRanges(
+    _In_bytecount_(PnFirmwareImageSize) const BYTE*             PrgbFirmwareImage,
+    _In_                                int                     PnFirmwareImageSize,
+    _In_                                const IfxFirmwareImage* PpsFirmwareImage,
+    _Out_                               unsigned int*           PpunCrcDataSize,
+    _Out_                               unsigned int*           PpunSignedDataSize,
+    _Out_                               unsigned int*           PpunFirmwareOffset,
+    _Out_                               unsigned int*           PpunFirmwareSize)
+{
+    int nSizeOfDataForCrc = PnFirmwareImageSize - sizeof(PpsFirmwareImage->unChecksum);
+    // The signature is 256 bytes long and is located before the CRC
+    int nSizeOfDataForHash = nSizeOfDataForCrc - sizeof(s_rgPublicKeys[0].rgbPublicKey);
+
+    *PpunCrcDataSize = nSizeOfDataForCrc > 0 ? (unsigned int)nSizeOfDataForCrc : 0;
+    *PpunSignedDataSize = nSizeOfDataForHash > 0 ? (unsigned int)nSizeOfDataForHash : 0;
+    *PpunFirmwareOffset = 0;
+    *PpunFirmwareSize = 0;
+
+    if (NULL == PpsFirmwareImage->rgbManifestData && NULL != PpsFirmwareImage->rgbFirmware && nSizeOfDataForCrc > 0 &&
+            PpsFirmwareImage->rgbFirmware >= PrgbFirmwareImage &&
+            PpsFirmwareImage->rgbFirmware - PrgbFirmwareImage <= nSizeOfDataForCrc &&
+            PpsFirmwareImage->unFirmwareSize <= (unsigned int)nSizeOfDataForCrc - (unsigned int)(PpsFirmwareImage->rgbFirmware - PrgbFirmwareImage))
+    {
+        *PpunFirmwareOffset = (unsigned int)(PpsFirmwareImage->rgbFirmware - PrgbFirmwareImage);
+        *PpunFirmwareSize = PpsFirmwareImage->unFirmwareSize;
+    }
+}
+
+/**
+ *  @brief      Procedure of the checksum task started by FirmwareUpdate_StartImageIntegrityCheck
+ *  @details    Runs on an application processor. It only reads the image and writes the result to the task structure.
+ *
+ *  @param      PpvContext      Pointer to the IMAGE_CHECKSUM_TASK structure.
+ */
+static
+void
+FirmwareUpdate_ImageChecksumTask(
+    _Inout_ void* PpvContext)
+{
+    IMAGE_CHECKSUM_TASK* psTask = (IMAGE_CHECKSUM_TASK*)PpvContext;
+
+    psTask->unReturnValue = FirmwareUpdate_CalculateImageChecksums(
+                                psTask->pbImage,
+                                psTask->unCrcDataSize,
+                                psTask->unSignedDataSize,
+                                psTask->unFirmwareOffset,
+                                psTask->unFirmwareSize,
+                                &psTask->unCRC,
+                                psTask->rgbSignedDataDigest,
+                                psTask->rgbFirmwareDigest);
+}
+
+/**
+ *  @brief      Function to check the integrity of a firmware image
+ *  @details    Checks the CRC and the signature of the firmware image. The check is done on the host only, no TPM command is sent.
+ *              The outcome of the last check is kept together with the SHA-256 digest of the firmware block and reused if the same
+ *              image is checked again.
+ *
+ *  @param      PrgbFirmwareImage           Pointer to the firmware image byte stream.
+ *  @param      PnFirmwareImageSize         Size of the firmware image byte stream.
+ *  @param      PpsFirmwareImage            Pointer to the unmarshalled firmware image structure (Unmarshalled PrgbFirmwareImage).
+ *  @param      PpunErrorDetails            Receives RC_SUCCESS if the image is intact. Otherwise:\n
+ *                                              RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
+ *                                              RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to verify the signature.
+ *  @param      PrgbFirmwareDigest          Receives the SHA-256 digest of the firmware block if it was calculated together with the CRC.
+ *  @param      PpfFirmwareDigestValid      Receives TRUE if PrgbFirmwareDigest was filled.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     ...                         Error codes from called functions.
+ */
+static
+unsigned int
+FirmwareUpdate_CheckImageIntegrity(
+    _In_bytecount_(PnFirmwareImageSize)     BYTE*               PrgbFirmwareImage,
+    _In_                                    int                 PnFirmwareImageSize,
+    _In_                                    IfxFirmwareImage*   PpsFirmwareImage,
+    _Out_                                   unsigned int*       PpunErrorDetails,
+    _Out_bytecap_(TSS_SHA256_DIGEST_SIZE)   BYTE                PrgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE],
+    _Out_                                   BOOL*               PpfFirmwareDigestValid)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    BYTE rgbHash[TSS_SHA256_DIGEST_SIZE];
+    int nSizeOfDataForHash = 0;
+
+    Platform_MemorySet(rgbHash, 0, sizeof(rgbHash));
+
+    do
+    {
+        *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+        *PpfFirmwareDigestValid = FALSE;
+
+        // The image must not be read on an application processor any longer once the check is done
+        FirmwareUpdate_WaitImageIntegrityCheck();
+
+        // Reuse the outcome of the last check of the same image
+        if (s_sImageIntegrity.fValid &&
+                s_sImageIntegrity.pbImage == PrgbFirmwareImage &&
+                s_sImageIntegrity.ullImageSize == (unsigned long long)PnFirmwareImageSize &&
+                s_sImageIntegrity.unFingerprint == FirmwareUpdate_GetImageFingerprint(PrgbFirmwareImage, (unsigned long long)PnFirmwareImageSize))
         {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbFirmwareImage or PpsFirmwareImage is NULL or PnFirmwareImageSize <= 0)");
+            *PpunErrorDetails = s_sImageIntegrity.unErrorDetails;
+            *PpfFirmwareDigestValid = s_sImageIntegrity.fFirmwareDigestValid;
+            unReturnValue = Platform_MemoryCopy(PrgbFirmwareDigest, TSS_SHA256_DIGEST_SIZE, s_sImageIntegrity.rgbFirmwareDigest, sizeof(s_sImageIntegrity.rgbFirmwareDigest));
+            LOGGING_WRITE_LEVEL3(L"Firmware image integrity check served from cache");
             break;
         }
+        s_sImageIntegrity.fValid = FALSE;
 
-        // Check the CRC at the end of the firmware image
+        // Check the CRC at the end of the firmware image. The SHA-256 digests of the signed part and of the firmware
+        // block are calculated in the same pass over the image and verified below.
         {
             unsigned int unCRC = 0;
-            unReturnValue = Crypt_CRC((void*)PrgbFirmwareImage, PnFirmwareImageSize - sizeof(unCRC), &unCRC);
+            unsigned int unCrcDataSize = 0;
+            unsigned int unSignedDataSize = 0;
+            unsigned int unFirmwareOffset = 0;
+            unsigned int unFirmwareSize = 0;
+
+            FirmwareUpdate_GetImageChecksumRanges(PrgbFirmwareImage, PnFirmwareImageSize, PpsFirmwareImage, &unCrcDataSize, &unSignedDataSize, &unFirmwareOffset, &unFirmwareSize);
+            nSizeOfDataForHash = (int)unSignedDataSize;
+
+            // Take the checksums calculated on an application processor if they have been calculated for this image
+            if (s_sImageChecksumTask.fDone &&
+                    s_sImageChecksumTask.pbImage == PrgbFirmwareImage &&
+                    s_sImageChecksumTask.ullImageSize == (unsigned long long)PnFirmwareImageSize &&
+                    s_sImageChecksumTask.unCrcDataSize == unCrcDataSize &&
+                    s_sImageChecksumTask.unSignedDataSize == unSignedDataSize &&
+                    s_sImageChecksumTask.unFirmwareOffset == unFirmwareOffset &&
+                    s_sImageChecksumTask.unFirmwareSize == unFirmwareSize &&
+                    s_sImageChecksumTask.unFingerprint == FirmwareUpdate_GetImageFingerprint(PrgbFirmwareImage, (unsigned long long)PnFirmwareImageSize))
+            {
+                unCRC = s_sImageChecksumTask.unCRC;
+                unReturnValue = s_sImageChecksumTask.unReturnValue;
+                if (RC_SUCCESS == unReturnValue)
+                    unReturnValue = Platform_MemoryCopy(rgbHash, sizeof(rgbHash), s_sImageChecksumTask.rgbSignedDataDigest, sizeof(s_sImageChecksumTask.rgbSignedDataDigest));
+                if (RC_SUCCESS == unReturnValue)
+                    unReturnValue = Platform_MemoryCopy(PrgbFirmwareDigest, TSS_SHA256_DIGEST_SIZE, s_sImageChecksumTask.rgbFirmwareDigest, sizeof(s_sImageChecksumTask.rgbFirmwareDigest));
+                LOGGING_WRITE_LEVEL3(L"Firmware image checksums calculated on an application processor");
+            }
+            else
+            {
+                unReturnValue = FirmwareUpdate_CalculateImageChecksums(
+                                    PrgbFirmwareImage,
+                                    unCrcDataSize,
+                                    unSignedDataSize,
+                                    unFirmwareOffset,
+                                    unFirmwareSize,
+                                    &unCRC,
+                                    rgbHash,
+                                    PrgbFirmwareDigest);
+            }
+            s_sImageChecksumTask.fDone = FALSE;
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"Crypt_CRC returned an unexpected value");
+                ERROR_STORE(unReturnValue, L"FirmwareUpdate_CalculateImageChecksums returned an unexpected value");
                 break;
             }
+            *PpfFirmwareDigestValid = (0 != unFirmwareSize);
             if (PpsFirmwareImage->unChecksum != unCRC)
             {
                 ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The CRC value in the firmware image file is incorrect");
@@ -1037,11 +1496,6 @@ FirmwareUpdate_IsFirmwareUpdatable(
 
         // Check signature on the firmware image file with Infineon code signing public key
         {
-            BYTE rgbHash[TSS_SHA256_DIGEST_SIZE];
-            // The signature is 256 bytes long and is located before the CRC
-            int nSizeOfDataForHash = PnFirmwareImageSize - sizeof(PpsFirmwareImage->unChecksum) - sizeof(s_rgPublicKeys[0].rgbPublicKey);
-            Platform_MemorySet(rgbHash, 0, sizeof(rgbHash));
-
             // Check structure version of the firmware image file for V1 images.
             if (FIRMWARE_IMAGE_V1 == PpsFirmwareImage->bImageVersion && PpsFirmwareImage->usImageStructureVersion < 2)
             {
@@ -1082,14 +1536,6 @@ FirmwareUpdate_IsFirmwareUpdatable(
                     break;
                 }
 
-                // Recalculate the SHA-256 digest on which the signature is based
-                unReturnValue = Crypt_SHA256(PrgbFirmwareImage, nSizeOfDataForHash, rgbHash);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE(unReturnValue, L"Crypt_SHA256 returned an unexpected value");
-                    break;
-                }
-
                 // Verify the signature of the firmware image file
                 unReturnValue = Crypt_VerifySignature(rgbHash, sizeof(rgbHash), PpsFirmwareImage->rgbSignature, sizeof(PpsFirmwareImage->rgbSignature), s_rgPublicKeys[unIndexKey].rgbPublicKey, 256);
                 if (RC_SUCCESS != unReturnValue && RC_E_VERIFY_SIGNATURE != unReturnValue)
@@ -1107,21 +1553,199 @@ FirmwareUpdate_IsFirmwareUpdatable(
             }
         }
 
-        // Check consistency of firmware
+        *PpunErrorDetails = RC_SUCCESS;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    // Remember the outcome unless an unexpected error occurred
+    if (RC_SUCCESS == unReturnValue && !s_sImageIntegrity.fValid &&
+            RC_SUCCESS == Platform_MemoryCopy(s_sImageIntegrity.rgbFirmwareDigest, sizeof(s_sImageIntegrity.rgbFirmwareDigest), PrgbFirmwareDigest, TSS_SHA256_DIGEST_SIZE))
+    {
+        s_sImageIntegrity.pbImage = PrgbFirmwareImage;
+        s_sImageIntegrity.ullImageSize = (unsigned long long)PnFirmwareImageSize;
+        s_sImageIntegrity.unFingerprint = FirmwareUpdate_GetImageFingerprint(PrgbFirmwareImage, (unsigned long long)PnFirmwareImageSize);
+        s_sImageIntegrity.unErrorDetails = *PpunErrorDetails;
+        s_sImageIntegrity.fFirmwareDigestValid = *PpfFirmwareDigestValid;
+        s_sImageIntegrity.fValid = TRUE;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks if the firmware version of the TPM is an allowed source version of a firmware image
+ *  @details    The firmware version with subversion.minor (e.g. 4.40.119.0) and without it (e.g. 4.40.119) are matched.
+ *              Only the header of the firmware image (FirmwareImage_Unmarshal) is evaluated.
+ *
+ *  @param      PpsFirmwareImage                Unmarshalled firmware image.
+ *  @param      PwszFirmwareVersion             Firmware version of the TPM with subversion.minor.
+ *  @param      PunFirmwareVersionLength        Length of PwszFirmwareVersion in elements (without null-termination).
+ *  @param      PwszFirmwareVersionShort        Firmware version of the TPM without subversion.minor.
+ *  @param      PunFirmwareVersionShortLength   Length of PwszFirmwareVersionShort in elements (without null-termination).
+ *  @param      PpfAllowed                      Receives TRUE if the firmware version is an allowed source version, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_BUFFER_TOO_SMALL           The source version list of the firmware image is inconsistent.
+ *  @retval     ...                             Error codes from Platform_UnmarshalString.
+ */
+static
+unsigned int
+FirmwareUpdate_IsSourceVersionAllowed(
+    _In_                                        const IfxFirmwareImage* PpsFirmwareImage,
+    _In_count_(PunFirmwareVersionLength)        const wchar_t*          PwszFirmwareVersion,
+    _In_                                        unsigned int            PunFirmwareVersionLength,
+    _In_count_(PunFirmwareVersionShortLength)   const wchar_t*          PwszFirmwareVersionShort,
+    _In_                                        unsigned int            PunFirmwareVersionShortLength,
+    _Out_                                       BOOL*                   PpfAllowed)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    unsigned int unIndex = 0;
+
+    *PpfAllowed = FALSE;
+
+    if (PpsFirmwareImage->sSourceVersionIndex.fNumeric)
+    {
+        // All allowed source versions are numeric tuples, so look the firmware version up in the source version index.
+        // A firmware version which is no numeric tuple cannot match any of them.
+        unsigned long long ullFirmwareVersion = 0;
+        // Try the firmware version with subversion.minor first (e.g. 4.40.119.0)
+        if (FirmwareImage_ParseVersion(PwszFirmwareVersion, PunFirmwareVersionLength, &ullFirmwareVersion) &&
+                FirmwareImage_IsSourceVersion(PpsFirmwareImage, ullFirmwareVersion))
+            *PpfAllowed = TRUE;
+        // If this does not match, try the firmware version without subversion.minor (e.g. 4.40.119)
+        else if (FirmwareImage_ParseVersion(PwszFirmwareVersionShort, PunFirmwareVersionShortLength, &ullFirmwareVersion) &&
+                 FirmwareImage_IsSourceVersion(PpsFirmwareImage, ullFirmwareVersion))
+            *PpfAllowed = TRUE;
+    }
+    else
+    {
+        BYTE* prgwszSourceVersion = PpsFirmwareImage->prgwszSourceVersions;
+        UINT32 unSourceVersionsSize = PpsFirmwareImage->usSourceVersionsSize;
+        // Check if the firmware version is listed in the allowed source versions
+        for (; unIndex < PpsFirmwareImage->usSourceVersionsCount; unIndex++)
         {
-            // Source and target TPM family flags in the firmware image must indicate either TPM1.2 or TPM2.0
-            if (PpsFirmwareImage->bSourceTpmFamily != DEVICE_TYPE_TPM_12 && PpsFirmwareImage->bSourceTpmFamily != DEVICE_TYPE_TPM_20)
+            wchar_t wszSourceVersion[MAX_NAME];
+            unsigned int unStrLen = RG_LEN(wszSourceVersion);
+            IGNORE_RETURN_VALUE(Platform_StringSetZero(wszSourceVersion, RG_LEN(wszSourceVersion)));
+
+            // Unmarshal the binary source version blob to a string
+            unReturnValue = Platform_UnmarshalString(prgwszSourceVersion, unSourceVersionsSize, &wszSourceVersion[0], &unStrLen);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+
+            // Try the firmware version with subversion.minor first (e.g. 4.40.119.0)
+            if (0 == Platform_StringCompare(PwszFirmwareVersion, wszSourceVersion, PunFirmwareVersionLength + 1, FALSE))
             {
-                ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The content of the firmware image file is inconsistent");
-                unReturnValue = RC_SUCCESS;
-                *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+                *PpfAllowed = TRUE;
+                break;
+            }
+
+            // If this does not match, try the firmware version without subversion.minor (e.g. 4.40.119)
+            if (0 == Platform_StringCompare(PwszFirmwareVersionShort, wszSourceVersion, PunFirmwareVersionShortLength + 1, FALSE))
+            {
+                *PpfAllowed = TRUE;
                 break;
             }
-            if (PpsFirmwareImage->bTargetTpmFamily != DEVICE_TYPE_TPM_12 && PpsFirmwareImage->bTargetTpmFamily != DEVICE_TYPE_TPM_20)
+
+            // Calculate string length with null termination (2 bytes per character)
+            UINT32 unStrLen2 = (unStrLen + 1) * 2;
+            // Reduce size in bytes accordingly
+            unSourceVersionsSize -= unStrLen2;
+            // Set pointer to next position in double null terminated string
+            prgwszSourceVersion += unStrLen2;
+            // Check pointer
+            if (prgwszSourceVersion > (PpsFirmwareImage->prgwszSourceVersions + PpsFirmwareImage->usSourceVersionsSize))
             {
-                ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The content of the firmware image file is inconsistent");
-                unReturnValue = RC_SUCCESS;
-                *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+                unReturnValue = RC_E_BUFFER_TOO_SMALL;
+                break;
+            }
+        }
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Function to check if the TPM is updatable with the given firmware image
+ *  @details    Some parameters like GUID, file content signature, TPM firmware major minor version or file content CRC
+ *              are checked to get a decision if the firmware is updatable with the current image.
+ *
+ *  @param      PbfTpmAttributes            TPM state attributes.
+ *  @param      PrgbFirmwareImage           Pointer to the firmware image byte stream.
+ *  @param      PnFirmwareImageSize         Size of the firmware image byte stream.
+ *  @param      PpsFirmwareImage            Pointer to the unmarshalled firmware image structure (Unmarshalled PrgbFirmwareImage).
+ *  @param      PpfValid                    TRUE in case the image is valid, FALSE otherwise.
+ *  @param      PpbfNewTpmFirmwareInfo      Pointer to a bit field to return info data for the new firmware image.
+ *  @param      PpunErrorDetails            Pointer to an unsigned int to return error details. Possible values are:\n
+ *                                              RC_E_FW_UPDATE_BLOCKED in case the field upgrade counter value has been exceeded.\n
+ *                                              RC_E_WRONG_FW_IMAGE in case the TPM is not updatable with the given image.\n
+ *                                              RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
+ *                                              RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.\n
+ *                                              RC_E_WRONG_DECRYPT_KEYS in case the TPM2.0 does not have decrypt keys matching to the firmware image.\n
+ *                                              RC_E_NEWER_FW_IMAGE_REQUIRED in case the TPM2.0 does not have a key group id matching to the firmware image.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER          In case of a NULL input parameter.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_IsFirmwareUpdatable(
+    _In_                                BITFIELD_TPM_ATTRIBUTES         PbfTpmAttributes,
+    _In_bytecount_(PnFirmwareImageSize) BYTE*                           PrgbFirmwareImage,
+    _In_                                int                             PnFirmwareImageSize,
+    _In_                                IfxFirmwareImage*               PpsFirmwareImage,
+    _Out_                               BOOL*                           PpfValid,
+    _Out_                               BITFIELD_NEW_TPM_FIRMWARE_INFO* PpbfNewTpmFirmwareInfo,
+    _Out_                               unsigned int*                   PpunErrorDetails)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    BYTE rgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE];
+    BOOL fFirmwareDigestValid = FALSE;
+    // Read once for the decrypt key check and reused for the field upgrade counter
+    sSecurityModuleLogicInfo2_d sSecurityModuleLogicInfo2;
+    BOOL fSecurityModuleLogicInfo2Valid = FALSE;
+
+    Platform_MemorySet(rgbFirmwareDigest, 0, sizeof(rgbFirmwareDigest));
+    Platform_MemorySet(&sSecurityModuleLogicInfo2, 0, sizeof(sSecurityModuleLogicInfo2));
+
+    do
+    {
+        // Check _Out_ parameters.
+        if (NULL == PpfValid || NULL == PpbfNewTpmFirmwareInfo || NULL == PpunErrorDetails)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpfValid or PpbfNewTpmFirmwareInfo or PpunErrorDetails is NULL)");
+            break;
+        }
+
+        // Set default value for _Out_ parameters.
+        *PpfValid = FALSE;
+        *PpunErrorDetails = RC_E_WRONG_FW_IMAGE;
+        Platform_MemorySet(PpbfNewTpmFirmwareInfo, 0, sizeof(BITFIELD_NEW_TPM_FIRMWARE_INFO));
+
+        // Check _In_ parameters.
+        if (NULL == PrgbFirmwareImage ||
+                0 >= PnFirmwareImageSize ||
+                NULL == PpsFirmwareImage)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbFirmwareImage or PpsFirmwareImage is NULL or PnFirmwareImageSize <= 0)");
+            break;
+        }
+
+        // Get the SHA-256 digest of the firmware block. The CRC and the signature have already been checked by
+        // FirmwareUpdate_CheckImage before the TPM was queried, so the outcome is served from the integrity cache.
+        {
+            unsigned int unIntegrityDetails = RC_E_CORRUPT_FW_IMAGE;
+            unReturnValue = FirmwareUpdate_CheckImageIntegrity(PrgbFirmwareImage, PnFirmwareImageSize, PpsFirmwareImage, &unIntegrityDetails, rgbFirmwareDigest, &fFirmwareDigestValid);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            if (RC_SUCCESS != unIntegrityDetails)
+            {
+                *PpunErrorDetails = unIntegrityDetails;
                 break;
             }
         }
@@ -1150,15 +1774,11 @@ FirmwareUpdate_IsFirmwareUpdatable(
                 break;
             }
 
-            BYTE* rgbPolicyParameterBlock = NULL;
-            TSS_INT32 nPolicyParameterBlockSize = 0;
-            sSignedData_d sSignedData;
+            sSignedDataView_d sSignedData;
             Platform_MemorySet(&sSignedData, 0, sizeof(sSignedData));
 
-            // Unmarshal the policy parameter block
-            rgbPolicyParameterBlock = PpsFirmwareImage->rgbPolicyParameterBlock;
-            nPolicyParameterBlockSize = PpsFirmwareImage->usPolicyParameterBlockSize;
-            unReturnValue = TSS_sSignedData_d_Unmarshal(&sSignedData, &rgbPolicyParameterBlock, &nPolicyParameterBlockSize);
+            // Unmarshal the policy parameter block in place
+            unReturnValue = TSS_sSignedData_d_UnmarshalView(&sSignedData, PpsFirmwareImage->rgbPolicyParameterBlock, PpsFirmwareImage->usPolicyParameterBlockSize);
             if (RC_SUCCESS != unReturnValue)
             {
                 ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The content of the firmware image file is not parsable");
@@ -1169,18 +1789,20 @@ FirmwareUpdate_IsFirmwareUpdatable(
 
             // Calculate the SHA256 digest of the firmware image and verify if it matches the digest given in the policy parameter block
             {
-                // Recalculate the messageDigest of the firmware block
-                BYTE rgbMessageDigest[TSS_SHA256_DIGEST_SIZE];
-                Platform_MemorySet(rgbMessageDigest, 0, sizeof(rgbMessageDigest));
-                unReturnValue = Crypt_SHA256(PpsFirmwareImage->rgbFirmware, PpsFirmwareImage->unFirmwareSize, rgbMessageDigest);
-                if (RC_SUCCESS != unReturnValue)
+                // Recalculate the messageDigest of the firmware block unless it was calculated together with the CRC
+                if (!fFirmwareDigestValid)
                 {
-                    ERROR_STORE(unReturnValue, L"Crypt_SHA256 returned an unexpected value");
-                    break;
+                    unReturnValue = Crypt_SHA256(PpsFirmwareImage->rgbFirmware, PpsFirmwareImage->unFirmwareSize, rgbFirmwareDigest);
+                    if (RC_SUCCESS != unReturnValue)
+                    {
+                        ERROR_STORE(unReturnValue, L"Crypt_SHA256 returned an unexpected value");
+                        break;
+                    }
                 }
 
                 // Compare the messageDigest to the value stored in the policy parameter block
-                if (0 != Platform_MemoryCompare(sSignedData.sSignerInfo.sSignedAttributes.sMessageDigest.rgbMessageDigest, rgbMessageDigest, TSS_SHA256_DIGEST_SIZE))
+                if (TSS_SHA256_DIGEST_SIZE != sSignedData.wMessageDigestSize || TSS_SHA256_DIGEST_SIZE > PpsFirmwareImage->usPolicyParameterBlockSize - sSignedData.wMessageDigestOffset ||
+                        0 != Platform_MemoryCompare(PpsFirmwareImage->rgbPolicyParameterBlock + sSignedData.wMessageDigestOffset, rgbFirmwareDigest, TSS_SHA256_DIGEST_SIZE))
                 {
                     ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The firmware digest in the firmware image file is incorrect");
                     unReturnValue = RC_SUCCESS;
@@ -1192,10 +1814,8 @@ FirmwareUpdate_IsFirmwareUpdatable(
             // On TPM2.0 check that the TPM and the firmware image use the same key material
             if (PbfTpmAttributes.tpm20)
             {
-                sSecurityModuleLogicInfo2_d sSecurityModuleLogicInfo2;
                 unsigned int unIndex = 0;
                 BOOL fDecryptKeyValid = FALSE;
-                Platform_MemorySet(&sSecurityModuleLogicInfo2, 0, sizeof(sSecurityModuleLogicInfo2));
 
                 // Read the decrypt key ID from the TPM
                 unReturnValue = FirmwareUpdate_Tpm20_GetSecurityModuleLogicInfo2(&sSecurityModuleLogicInfo2);
@@ -1204,6 +1824,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
                     ERROR_STORE(unReturnValue, L"FirmwareUpdate_Tpm20_GetInfo returned an unexpected value");
                     break;
                 }
+                fSecurityModuleLogicInfo2Valid = TRUE;
 
                 // Consistency check: the TPM may report at maximum 4 decrypt key ID entries
                 if (sSecurityModuleLogicInfo2.sKeyList.wEntries > RG_LEN(sSecurityModuleLogicInfo2.sKeyList.DecryptKeyId))
@@ -1218,7 +1839,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
                 // There should be at least one match
                 for (unIndex = 0; unIndex < sSecurityModuleLogicInfo2.sKeyList.wEntries; unIndex++)
                 {
-                    if (sSecurityModuleLogicInfo2.sKeyList.DecryptKeyId[unIndex] == sSignedData.sSignerInfo.sSignedAttributes.DecryptKeyId)
+                    if (sSecurityModuleLogicInfo2.sKeyList.DecryptKeyId[unIndex] == sSignedData.DecryptKeyId)
                     {
                         fDecryptKeyValid = TRUE;
                         break;
@@ -1238,7 +1859,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
         // Check if the field upgrade counters allow an upgrade
         {
             unsigned int unFieldUpgradeCounter = 0;
-            unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(PbfTpmAttributes, &unFieldUpgradeCounter);
+            unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(PbfTpmAttributes, fSecurityModuleLogicInfo2Valid ? &sSecurityModuleLogicInfo2 : NULL, &unFieldUpgradeCounter);
             if (RC_SUCCESS != unReturnValue)
                 break;
 
@@ -1276,7 +1897,6 @@ FirmwareUpdate_IsFirmwareUpdatable(
             wchar_t wszFirmwareVersionShort[MAX_NAME];
             unsigned int unFirmwareVersionSize = RG_LEN(wszFirmwareVersion);
             unsigned int unFirmwareVersionShortSize = RG_LEN(wszFirmwareVersionShort);
-            unsigned int unIndex = 0;
             BOOL fImageAllowed = FALSE;
             IGNORE_RETURN_VALUE(Platform_StringSetZero(wszFirmwareVersion, RG_LEN(wszFirmwareVersion)));
             IGNORE_RETURN_VALUE(Platform_StringSetZero(wszFirmwareVersionShort, RG_LEN(wszFirmwareVersionShort)));
@@ -1286,48 +1906,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
             if (RC_SUCCESS != unReturnValue)
                 break;
 
-            BYTE* prgwszSourceVersion = PpsFirmwareImage->prgwszSourceVersions;
-            UINT32 unSourceVersionsSize = PpsFirmwareImage->usSourceVersionsSize;
-            // Check if the firmware version is listed in the allowed source versions
-            for (; unIndex < PpsFirmwareImage->usSourceVersionsCount; unIndex++)
-            {
-                wchar_t wszSourceVersion[MAX_NAME];
-                unsigned int unStrLen = RG_LEN(wszSourceVersion);
-                IGNORE_RETURN_VALUE(Platform_StringSetZero(wszSourceVersion, RG_LEN(wszSourceVersion)));
-
-                // Unmarshal the binary source version blob to a string
-                unReturnValue = Platform_UnmarshalString(prgwszSourceVersion, unSourceVersionsSize, &wszSourceVersion[0], &unStrLen);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-
-                // Try the firmware version with subversion.minor first (e.g. 4.40.119.0)
-                if (0 == Platform_StringCompare(wszFirmwareVersion, wszSourceVersion, unFirmwareVersionSize + 1, FALSE))
-                {
-                    fImageAllowed = TRUE;
-                    break;
-                }
-
-                // If this does not match, try the firmware version without subversion.minor (e.g. 4.40.119)
-                if (0 == Platform_StringCompare(wszFirmwareVersionShort, wszSourceVersion, unFirmwareVersionShortSize + 1, FALSE))
-                {
-                    fImageAllowed = TRUE;
-                    break;
-                }
-
-                // Calculate string length with null termination (2 bytes per character)
-                UINT32 unStrLen2 = (unStrLen + 1) * 2;
-                // Reduce size in bytes accordingly
-                unSourceVersionsSize -= unStrLen2;
-                // Set pointer to next position in double null terminated string
-                prgwszSourceVersion += unStrLen2;
-                // Check pointer
-                if (prgwszSourceVersion > (PpsFirmwareImage->prgwszSourceVersions + PpsFirmwareImage->usSourceVersionsSize))
-                {
-                    unReturnValue = RC_E_BUFFER_TOO_SMALL;
-                    break;
-                }
-            }
-
+            unReturnValue = FirmwareUpdate_IsSourceVersionAllowed(PpsFirmwareImage, wszFirmwareVersion, unFirmwareVersionSize, wszFirmwareVersionShort, unFirmwareVersionShortSize, &fImageAllowed);
             if (RC_SUCCESS != unReturnValue)
             {
                 *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
@@ -1378,6 +1957,12 @@ FirmwareUpdate_IsFirmwareUpdatable(
         // If this check fails verify if the build number matches the number in the IfxFirmwareImage structure.
         else
         {
+#ifdef IFXTPMUPDATE_TPM20_ONLY
+            // The TPM1.2 boot loader cannot be queried in this build
+            unReturnValue = RC_SUCCESS;
+            *PpunErrorDetails = RC_E_UNSUPPORTED_CHIP;
+            break;
+#else
             sSecurityModuleLogicInfo_d securityModuleLogicInfo;
 
             // Policy parameter block data
@@ -1443,18 +2028,13 @@ FirmwareUpdate_IsFirmwareUpdatable(
             // For VERSION_3 firmware images match unique ID between policy parameter block and TPM.
             if (PpsFirmwareImage->bfCapabilities.invalidFirmwareMode_matchUniqueID)
             {
-                BYTE* rgbPolicyParameterBlock = NULL;
-                TSS_INT32 nPolicyParameterBlockSize = 0;
-                sSignedData_d sSignedData;
+                sSignedDataView_d sSignedData;
                 Platform_MemorySet(&sSignedData, 0, sizeof(sSignedData));
-                // Copy pointer and size for unmarshalling
-                rgbPolicyParameterBlock = PpsFirmwareImage->rgbPolicyParameterBlock;
-                nPolicyParameterBlockSize = PpsFirmwareImage->usPolicyParameterBlockSize;
-                // Unmarshal the block to sSignedData structure
-                unReturnValue = TSS_sSignedData_d_Unmarshal(&sSignedData, &rgbPolicyParameterBlock, &nPolicyParameterBlockSize);
+                // Unmarshal the block in place
+                unReturnValue = TSS_sSignedData_d_UnmarshalView(&sSignedData, PpsFirmwareImage->rgbPolicyParameterBlock, PpsFirmwareImage->usPolicyParameterBlockSize);
                 if (RC_SUCCESS != unReturnValue)
                 {
-                    ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_Unmarshal returned an unexpected value. (0x%.8X)", unReturnValue);
+                    ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_UnmarshalView returned an unexpected value. (0x%.8X)", unReturnValue);
                     unReturnValue = RC_E_CORRUPT_FW_IMAGE;
                     break;
                 }
@@ -1462,7 +2042,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
                 {
                     // Get the unique ID from policy parameter block.
                     unsigned int unUniqueTPM = 0;
-                    unsigned int unUniqueFirmwareImage = sSignedData.sSignerInfo.sSignedAttributes.sFirmwarePackage.StaleVersion & 0x0000000f;
+                    unsigned int unUniqueFirmwareImage = sSignedData.sFirmwarePackage.StaleVersion & 0x0000000f;
 
                     // Get the unique ID from the TPM
                     unUniqueTPM = securityModuleLogicInfo.sProcessFirmwarePackage.StaleVersion & 0x0000000f;
@@ -1476,6 +2056,7 @@ FirmwareUpdate_IsFirmwareUpdatable(
                     }
                 }
             }
+#endif
         }
 
         *PpunErrorDetails = RC_SUCCESS;
@@ -1500,7 +2081,52 @@ FirmwareUpdate_IsFirmwareUpdatable(
 }
 
 /**
- *  @brief      Returns the TPM state attributes
+ *  @brief      Sets the TPM state attributes derived from the TPM2.0 firmware update operation mode
+ *  @details    The attributes tpmInOperationalMode and tpmFirmwareIsValid must be preset to 1 by the caller.
+ *
+ *  @param      PbOperationMode             Value of TPM_PT_VENDOR_FIX_FU_OPERATION_MODE.
+ *  @param      PpsTpmState                 Pointer to a variable representing the TPM state.
+ */
+static
+void
+FirmwareUpdate_SetOperationModeAttributes(
+    _In_    BYTE        PbOperationMode,
+    _Inout_ TPM_STATE*  PpsTpmState)
+{
+    // Set TPM2.0 based firmware update
+    PpsTpmState->attribs.tpmHasFULoader20 = 1;
+
+    // Set TPM2.0 operation mode value
+    PpsTpmState->attribs.tpm20OperationMode = PbOperationMode;
+
+    // Is TPM in non-operational mode?
+    if (OM_TPM != PbOperationMode)
+    {
+        // Clear operational mode flag
+        PpsTpmState->attribs.tpmInOperationalMode = 0;
+
+        // Set firmware update or recovery mode
+        PpsTpmState->attribs.tpmInFwUpdateMode = (PbOperationMode & 0x80) == 0x00 ? 1 : 0;
+        PpsTpmState->attribs.tpmInFwRecoveryMode = !PpsTpmState->attribs.tpmInFwUpdateMode;
+
+        // Is firmware valid (0x01 or 0x81)?
+        PpsTpmState->attribs.tpmFirmwareIsValid = (PbOperationMode & 0x7) == 0x1 ? 1 : 0;
+
+        // Is firmware valid and TPM restart pending (0x04 or 0x84)?
+        if ((PbOperationMode & 0x7) == 0x4)
+        {
+            PpsTpmState->attribs.tpmFirmwareIsValid = 1;
+            PpsTpmState->attribs.tpm20restartRequired = 1;
+        }
+
+        // Set firmware recovery supported flag if firmware recovery mode is active (info may not available if TPM restart is pending)
+        if (PpsTpmState->attribs.tpmInFwRecoveryMode && PpsTpmState->attribs.tpm20restartRequired)
+            PpsTpmState->attribs.tpmSupportsFwRecovery = 1;
+    }
+}
+
+/**
+ *  @brief      Determines the TPM state attributes by querying the TPM
  *  @details
  *
  *  @param      PfCheckPlatformHierarchy    Whether to check the state of platform hierarchy. This operation can be skipped if .tpm20phDisabled and .tpm20emptyPlatformAuth are
@@ -1512,16 +2138,19 @@ FirmwareUpdate_IsFirmwareUpdatable(
  *  @retval     RC_E_FAIL                   An unexpected error occurred. E.g. more than one property returned from TPM2_GetCapability call.
  *  @retval     ...                         Error codes from called functions.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_CalculateState(
+FirmwareUpdate_QueryState(
     _In_    BOOL        PfCheckPlatformHierarchy,
     _Out_   TPM_STATE*  PpsTpmState)
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    BOOL fTpm12Started = FALSE;
 
     do
     {
+        TPM_INTERFACE_INFO sInterfaceInfo;
+
         // Check parameters
         if (NULL == PpsTpmState)
         {
@@ -1531,24 +2160,47 @@ FirmwareUpdate_CalculateState(
         }
 
         Platform_MemorySet(PpsTpmState, 0, sizeof(*PpsTpmState));
+        Platform_MemorySet(&sInterfaceInfo, 0, sizeof(sInterfaceInfo));
+
+        // The interface registers tell which command set the TPM most likely speaks. The family is only a hint, so on
+        // a misprediction the TPM is probed in the default order (TPM2_Startup first, then TPM_Startup).
+        // The transport profile hints are kept for the firmware update.
+        IGNORE_RETURN_VALUE(DeviceManagement_GetInterfaceInfo(&sInterfaceInfo));
+        s_sInterfaceInfo = sInterfaceInfo;
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+        if (TPM_INTERFACE_FAMILY_TPM12 == sInterfaceInfo.bFamily)
+        {
+            unReturnValue = TSS_TPM_Startup(TSS_TPM_ST_CLEAR);
+            if (RC_SUCCESS == unReturnValue ||
+                    TSS_TPM_INVALID_POSTINIT == (unReturnValue ^ RC_TPM_MASK) ||
+                    TSS_TPM_FAILEDSELFTEST == (unReturnValue ^ RC_TPM_MASK))
+                fTpm12Started = TRUE;
+            else
+                LOGGING_WRITE_LEVEL3_FMT(L"TPM_Startup failed on a TIS 1.x interface (0x%.8X), probing for a TPM2.0", unReturnValue);
+        }
+#endif
 
-        // Try to call a TPM2_Startup command
-        unReturnValue = TSS_TPM2_Startup(TSS_TPM_SU_CLEAR);
-        // Remember to orderly shutdown the TPM2.0 if TPM2_Startup completed successfully.
-        if (TSS_TPM_RC_SUCCESS == unReturnValue)
+        if (!fTpm12Started)
         {
-            IGNORE_RETURN_VALUE(PropertyStorage_AddKeyBooleanValuePair(PROPERTY_CALL_SHUTDOWN_ON_EXIT, TRUE));
+            // Try to call a TPM2_Startup command
+            unReturnValue = TSS_TPM2_Startup(TSS_TPM_SU_CLEAR);
+            // Remember to orderly shutdown the TPM2.0 if TPM2_Startup completed successfully.
+            if (TSS_TPM_RC_SUCCESS == unReturnValue)
+            {
+                IGNORE_RETURN_VALUE(PropertyStorage_AddKeyBooleanValuePair(PROPERTY_CALL_SHUTDOWN_ON_EXIT, TRUE));
+                // The TPM has been restarted, so the platform hierarchy is back to its reset state
+                s_sPlatformHierarchy.fValid = FALSE;
+            }
         }
 
-        if (TSS_TPM_RC_SUCCESS == unReturnValue ||
+        if (!fTpm12Started && (TSS_TPM_RC_SUCCESS == unReturnValue ||
                 TSS_TPM_RC_INITIALIZE == (unReturnValue ^ RC_TPM_MASK) ||
                 TSS_TPM_RC_FAILURE == (unReturnValue ^ RC_TPM_MASK) ||
-                TSS_TPM_RC_REBOOT == (unReturnValue ^ RC_TPM_MASK))
+                TSS_TPM_RC_REBOOT == (unReturnValue ^ RC_TPM_MASK)))
         {
             // The TPM is a TPM2.0
-            BYTE bMoreData = 0;
-            TSS_TPMS_CAPABILITY_DATA capabilityData;
-            Platform_MemorySet(&capabilityData, 0, sizeof(capabilityData));
+            const TSS_UINT32 rgunProperties[] = { TSS_TPM_PT_MANUFACTURER, TSS_TPM_PT_FIRMWARE_VERSION_1, TSS_TPM_PT_FIRMWARE_VERSION_2 };
+            TPM_PROPERTY_MAP_ENTRY* psEntry = NULL;
             PpsTpmState->attribs.tpm20 = 1;
             PpsTpmState->attribs.tpmFirmwareIsValid = 1; // Set to initial value
             PpsTpmState->attribs.tpmInOperationalMode = 1; // Set to initial value
@@ -1581,10 +2233,15 @@ FirmwareUpdate_CalculateState(
                 PpsTpmState->attribs.infineon = 1; // This may not be true
             }
 
-            unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_MANUFACTURER, 1, &bMoreData, &capabilityData);
-            if (TSS_TPM_RC_SUCCESS == unReturnValue && 1 == capabilityData.data.tpmProperties.count)
+            // Prefetch the firmware version together with the manufacturer unless the properties must be read individually
+            if (PpsTpmState->attribs.tpm20InFailureMode || PpsTpmState->attribs.tpm20restartRequired)
+                unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_TPM_PROPERTIES, rgunProperties, 1, TRUE);
+            else
+                unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_TPM_PROPERTIES, rgunProperties, RG_LEN(rgunProperties), FALSE);
+            psEntry = (TSS_TPM_RC_SUCCESS == unReturnValue) ? FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_MANUFACTURER) : NULL;
+            if (NULL != psEntry)
             {
-                if (capabilityData.data.tpmProperties.tpmProperty[0].value == 0x49465800 /* IFX\0 */)
+                if (psEntry->unValue == 0x49465800 /* IFX\0 */)
                     PpsTpmState->attribs.infineon = 1;
                 else
                     PpsTpmState->attribs.infineon = 0;
@@ -1597,82 +2254,32 @@ FirmwareUpdate_CalculateState(
             // Check if TPM2.0 based firmware update is supported
             if (TSS_TPM_RC_SUCCESS == unReturnValue && 1 == PpsTpmState->attribs.infineon)
             {
-                bMoreData = 0;
-                TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-                Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
+                const TSS_UINT32 unOperationModeProperty = TPM_PT_VENDOR_FIX_FU_OPERATION_MODE;
+                const TSS_UINT32 unFuProperty = TPM_PT_VENDOR_FIX_FU_PROPERTIES;
 
                 // Get TPM2.0 operation mode property
-                unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_OPERATION_MODE, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
+                unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_VENDOR_PROPERTY, &unOperationModeProperty, 1, TRUE);
                 if (TSS_TPM_RC_SUCCESS == unReturnValue)
                 {
-                    // Check count of capabilities returned
-                    if (1 != vendorCapabilityData.data.vendorData.count)
-                    {
-                        unReturnValue = RC_E_FAIL;
-                        ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-                        break;
-                    }
-
-                    // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_OPERATION_MODE)
-                    TSS_TPM2B_MAX_BUFFER* pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
                     // Check buffer size
-                    if (sizeof(TSS_UINT8) != pMaxBuffer->size)
+                    psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_VENDOR_PROPERTY, unOperationModeProperty);
+                    if (NULL == psEntry || sizeof(TSS_UINT8) != psEntry->usSize)
                     {
                         unReturnValue = RC_E_FAIL;
                         ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
                         break;
                     }
 
-                    // Set TPM2.0 based firmware update
-                    PpsTpmState->attribs.tpmHasFULoader20 = 1;
-
-                    // Set TPM2.0 operation mode value
-                    UINT8 bOperationMode = pMaxBuffer->buffer[0];
-                    PpsTpmState->attribs.tpm20OperationMode = bOperationMode;
+                    // Set TPM2.0 based firmware update and the attributes derived from the operation mode
+                    FirmwareUpdate_SetOperationModeAttributes(psEntry->rgbValue[0], PpsTpmState);
 
-                    // Is TPM in non-operational mode?
-                    if(OM_TPM != bOperationMode)
+                    // Get TPM_PT_VENDOR_FIX_FU_PROPERTIES
+                    unReturnValue = FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_VENDOR_PROPERTY, &unFuProperty, 1, TRUE);
+                    if (TSS_TPM_RC_SUCCESS == unReturnValue)
                     {
-                        // Clear operational mode flag
-                        PpsTpmState->attribs.tpmInOperationalMode = 0;
-
-                        // Set firmware update or recovery mode
-                        PpsTpmState->attribs.tpmInFwUpdateMode = (bOperationMode & 0x80) == 0x00 ? 1 : 0;
-                        PpsTpmState->attribs.tpmInFwRecoveryMode = !PpsTpmState->attribs.tpmInFwUpdateMode;
-
-                        // Is firmware valid (0x01 or 0x81)?
-                        PpsTpmState->attribs.tpmFirmwareIsValid = (bOperationMode & 0x7) == 0x1 ? 1 : 0;
-
-                        // Is firmware valid and TPM restart pending (0x04 or 0x84)?
-                        if ((bOperationMode & 0x7) == 0x4)
-                        {
-                            PpsTpmState->attribs.tpmFirmwareIsValid = 1;
-                            PpsTpmState->attribs.tpm20restartRequired = 1;
-                        }
-
-                        // Set firmware recovery supported flag if firmware recovery mode is active (info may not available if TPM restart is pending)
-                        if (PpsTpmState->attribs.tpmInFwRecoveryMode && PpsTpmState->attribs.tpm20restartRequired)
-                            PpsTpmState->attribs.tpmSupportsFwRecovery = 1;
-                    }
-
-                    // Get TPM_PT_VENDOR_FIX_FU_PROPERTIES
-                    unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_PROPERTIES, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
-                    if (TSS_TPM_RC_SUCCESS == unReturnValue)
-                    {
-                        // Check count of capabilities returned
-                        if (1 != vendorCapabilityData.data.vendorData.count)
-                        {
-                            unReturnValue = RC_E_FAIL;
-                            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned more than one capability");
-                            break;
-                        }
-
-                        // Get pointer to first element in returned max buffer array (TPM_PT_VENDOR_FIX_FU_PROPERTIES)
-                        pMaxBuffer = &vendorCapabilityData.data.vendorData.buffer[0];
-
-                        // Check buffer size
-                        if (sizeof(TSS_UINT32) != pMaxBuffer->size)
+                        // Check buffer size
+                        psEntry = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_VENDOR_PROPERTY, unFuProperty);
+                        if (NULL == psEntry || sizeof(TSS_UINT32) != psEntry->usSize)
                         {
                             unReturnValue = RC_E_FAIL;
                             ERROR_STORE(unReturnValue, L"TSS_TPM2_GetCapability returned wrong buffer size of capability");
@@ -1680,7 +2287,7 @@ FirmwareUpdate_CalculateState(
                         }
 
                         // Is firmware recovery support bit set?
-                        PpsTpmState->attribs.tpmSupportsFwRecovery = pMaxBuffer->buffer[3] & TPM_FU_PROPERTIES_FW_RECOVERY_SUPPORTED;
+                        PpsTpmState->attribs.tpmSupportsFwRecovery = psEntry->rgbValue[3] & TPM_FU_PROPERTIES_FW_RECOVERY_SUPPORTED;
                     }
                     else
                     {
@@ -1706,48 +2313,74 @@ FirmwareUpdate_CalculateState(
                     !PpsTpmState->attribs.tpm20restartRequired && PpsTpmState->attribs.tpmInOperationalMode &&
                     PfCheckPlatformHierarchy)
             {
-                // Check whether platformAuth is the Empty Buffer and platform hierarchy is enabled.
-                // (-> Preconditions for TPMFactoryUpd to update a TPM2.0)
-                TSS_AuthorizationCommandData sAuthSessionData;
-                TSS_AcknowledgmentResponseData sAckAuthSessionData;
-                TSS_TPM2B_AUTH sNewAuth;
-                Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
-                Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
-                Platform_MemorySet(&sNewAuth, 0, sizeof(sNewAuth));
-                // Initialize authorization command data structure
-                sAuthSessionData.authHandle = TSS_TPM_RS_PW;    // Use password based authorization session
-                sAuthSessionData.sessionAttributes.continueSession = 1;
-                unReturnValue = TSS_TPM2_HierarchyChangeAuth(TSS_TPM_RH_PLATFORM, &sAuthSessionData, &sNewAuth, &sAckAuthSessionData);
-                if (TSS_TPM_RC_SUCCESS == unReturnValue)
-                {
-                    // The platformAuth is the Empty Buffer and platform hierarchy is enabled. The TPM can be updated with TPMFactoryUpd.
-                    PpsTpmState->attribs.tpm20emptyPlatformAuth = 1;
-                }
-                else if ((unReturnValue ^ RC_TPM_MASK) == (TSS_TPM_RC_HIERARCHY | TSS_TPM_RC_1))
-                {
-                    // The platform hierarchy is disabled. The TPM cannot be updated with TPMFactoryUpd.
-                    PpsTpmState->attribs.tpm20phDisabled = 1;
-                    unReturnValue = RC_SUCCESS;
-                }
-                else if ((unReturnValue ^ RC_TPM_MASK) == (TSS_TPM_RC_BAD_AUTH | TSS_TPM_RC_S | TSS_TPM_RC_1))
+                if (s_sPlatformHierarchy.fValid)
                 {
-                    // The platformAuth is not the Empty Buffer. The TPM cannot be updated with TPMFactoryUpd.
-                    // (Hint: platformAuth is not protected by DA, so a failed TPM2_HierarchyChangeAuth does not have DA implications)
-                    unReturnValue = RC_SUCCESS;
+                    // The platform hierarchy has already been probed in this TPM boot
+                    PpsTpmState->attribs.tpm20emptyPlatformAuth = s_sPlatformHierarchy.fEmptyPlatformAuth ? 1 : 0;
+                    PpsTpmState->attribs.tpm20phDisabled = s_sPlatformHierarchy.fDisabled ? 1 : 0;
+                    LOGGING_WRITE_LEVEL3(L"Platform hierarchy state served from cache");
                 }
                 else
                 {
-                    ERROR_STORE(unReturnValue, L"TSS_TPM2_HierarchyChangeAuth returned an unexpected value.");
+                    // Check whether platformAuth is the Empty Buffer and platform hierarchy is enabled.
+                    // (-> Preconditions for TPMFactoryUpd to update a TPM2.0)
+                    TSS_AuthorizationCommandData sAuthSessionData;
+                    TSS_AcknowledgmentResponseData sAckAuthSessionData;
+                    TSS_TPM2B_AUTH sNewAuth;
+                    Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
+                    Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
+                    Platform_MemorySet(&sNewAuth, 0, sizeof(sNewAuth));
+                    // Initialize authorization command data structure
+                    sAuthSessionData.authHandle = TSS_TPM_RS_PW;    // Use password based authorization session
+                    sAuthSessionData.sessionAttributes.continueSession = 1;
+                    unReturnValue = TSS_TPM2_HierarchyChangeAuth(TSS_TPM_RH_PLATFORM, &sAuthSessionData, &sNewAuth, &sAckAuthSessionData);
+                    if (TSS_TPM_RC_SUCCESS == unReturnValue)
+                    {
+                        // The platformAuth is the Empty Buffer and platform hierarchy is enabled. The TPM can be updated with TPMFactoryUpd.
+                        PpsTpmState->attribs.tpm20emptyPlatformAuth = 1;
+                    }
+                    else if ((unReturnValue ^ RC_TPM_MASK) == (TSS_TPM_RC_HIERARCHY | TSS_TPM_RC_1))
+                    {
+                        // The platform hierarchy is disabled. The TPM cannot be updated with TPMFactoryUpd.
+                        PpsTpmState->attribs.tpm20phDisabled = 1;
+                        unReturnValue = RC_SUCCESS;
+                    }
+                    else if ((unReturnValue ^ RC_TPM_MASK) == (TSS_TPM_RC_BAD_AUTH | TSS_TPM_RC_S | TSS_TPM_RC_1))
+                    {
+                        // The platformAuth is not the Empty Buffer. The TPM cannot be updated with TPMFactoryUpd.
+                        // (Hint: platformAuth is not protected by DA, so a failed TPM2_HierarchyChangeAuth does not have DA implications)
+                        unReturnValue = RC_SUCCESS;
+                    }
+                    else
+                    {
+                        ERROR_STORE(unReturnValue, L"TSS_TPM2_HierarchyChangeAuth returned an unexpected value.");
+                    }
+
+                    if (RC_SUCCESS == unReturnValue)
+                    {
+                        s_sPlatformHierarchy.fEmptyPlatformAuth = PpsTpmState->attribs.tpm20emptyPlatformAuth ? TRUE : FALSE;
+                        s_sPlatformHierarchy.fDisabled = PpsTpmState->attribs.tpm20phDisabled ? TRUE : FALSE;
+                        s_sPlatformHierarchy.fValid = TRUE;
+                    }
                 }
             }
         }
+#ifdef IFXTPMUPDATE_TPM20_ONLY
+        else
+        {
+            // A TPM that does not accept TPM2_Startup is not probed for TPM1.2 in this build
+            ERROR_STORE(unReturnValue, L"TSS_TPM2_Startup returned an unexpected value. (TPM1.2 support is not included)");
+        }
+#else
         else
         {
             TSS_TPM_CAP_VERSION_INFO tpmVersionInfo;
             unsigned int unTpmVersionSizeInfo = sizeof(TSS_TPM_CAP_VERSION_INFO);
             BYTE rgbIFX[] = { 'I', 'F', 'X', 0x00};
             Platform_MemorySet(&tpmVersionInfo, 0, sizeof(tpmVersionInfo));
-            unReturnValue = TSS_TPM_Startup(TSS_TPM_ST_CLEAR);
+            // Skip TPM_Startup if it has already been sent because of the interface hint
+            if (!fTpm12Started)
+                unReturnValue = TSS_TPM_Startup(TSS_TPM_ST_CLEAR);
             if (RC_SUCCESS == unReturnValue || TSS_TPM_INVALID_POSTINIT == (unReturnValue ^ RC_TPM_MASK))
             {
                 // The TPM is a TPM1.2
@@ -1913,6 +2546,7 @@ FirmwareUpdate_CalculateState(
                 ERROR_STORE(unReturnValue, L"TSS_TPM_Startup returned an unexpected value.");
             }
         }
+#endif
     }
     WHILE_FALSE_END;
 
@@ -1920,156 +2554,137 @@ FirmwareUpdate_CalculateState(
 }
 
 /**
- *  @brief      FirmwareUpdate start for TPM2.0.
- *  @details    The function takes the firmware update policy parameter block and the stored policy session and starts the
- *              firmware update process.
+ *  @brief      Returns the TPM state attributes
+ *  @details    The TPM state is served from a snapshot of the last call as long as no command that may change the TPM
+ *              state has been sent since (see DeviceManagement_GetTpmStateGeneration). Otherwise the TPM is queried and
+ *              the snapshot is updated. A snapshot without the state of the platform hierarchy is not used if
+ *              PfCheckPlatformHierarchy is TRUE. The state of the platform hierarchy itself is probed once per TPM boot.
  *
- *  @param      PbfTpmAttributes                The operation mode of the TPM.
- *  @param      PusPolicyParameterBlockSize     Size of the policy parameter block.
- *  @param      PrgbPolicyParameterBlock        Pointer to the policy parameter block byte stream.
- *  @param      PunSessionHandle                Session handle.
- *  @param      PfnProgress                     Callback function to indicate the progress.
+ *  @param      PfCheckPlatformHierarchy    Whether to check the state of platform hierarchy. This operation can be skipped if .tpm20phDisabled and .tpm20emptyPlatformAuth are
+ *                                          not needed and tool runtime should be optimized for performance.
+ *  @param      PpsTpmState                 Pointer to a variable representing the TPM state.
  *
- *  @retval     RC_SUCCESS                              The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER                      An invalid parameter was passed to the function. Policy parameter block stream is NULL.
- *  @retval     RC_E_TPM20_INVALID_POLICY_SESSION       The policy session handle is 0 or invalid or policy authorization failed.
- *  @retval     RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE   The policy handle value is out of range.
- *  @retval     RC_E_TPM20_POLICY_SESSION_NOT_LOADED    The policy session is not loaded to the TPM.
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED             Firmware update started but failed.
- *  @retval     RC_E_FAIL                               An unexpected error occurred.
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PpsTpmState is NULL.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred. E.g. more than one property returned from TPM2_GetCapability call.
+ *  @retval     ...                         Error codes from called functions.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_Start_Tpm20(
-    _In_                                        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
-    _In_bytecount_(PusPolicyParameterBlockSize) BYTE*                               PrgbPolicyParameterBlock,
-    _In_                                        UINT16                              PusPolicyParameterBlockSize,
-    _In_                                        unsigned int                        PunSessionHandle,
-    _In_                                        PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+FirmwareUpdate_CalculateState(
+    _In_    BOOL        PfCheckPlatformHierarchy,
+    _Out_   TPM_STATE*  PpsTpmState)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
-        // Authorization session area
-        TSS_AuthorizationCommandData sAuthSessionData;
-        TSS_AcknowledgmentResponseData sAckAuthSessionData;
-
-        // Policy parameter block data
-        TSS_TPM2B_MAX_BUFFER sData;
-        TSS_UINT8 bSubCommand;
-
-        // Out parameter
-        unsigned short usStartSize = 0;
-
-        Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
-        Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
-        Platform_MemorySet(&sData, 0, sizeof(sData));
-
         // Check parameters
-        if (NULL == PrgbPolicyParameterBlock ||
-                0 == PusPolicyParameterBlockSize)
+        if (NULL == PpsTpmState)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbPolicyParameterBlock is NULL or PusPolicyParameterBlockSize is zero)");
-            break;
-        }
-
-        if (0 == PunSessionHandle)
-        {
-            unReturnValue = RC_E_TPM20_INVALID_POLICY_SESSION;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PunSessionHandle is zero)");
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsTpmState is NULL)");
             break;
         }
 
-        if (PbfTpmAttributes.tpmHasFULoader20)
+        // Serve the request from the snapshot if the TPM state has not changed since
+        if (s_fTpmStateSnapshotValid &&
+                s_unTpmStateSnapshotGeneration == DeviceManagement_GetTpmStateGeneration() &&
+                (s_fTpmStateSnapshotPlatformHierarchy || !PfCheckPlatformHierarchy))
         {
-            TSS_TPMT_HA sHash;
-            TSS_INT32 nMarshal = sizeof(sData.buffer);
-            TSS_BYTE* pMarshal = sData.buffer;
-
-            // Set the sub-command.
-            bSubCommand = TPM20_FieldUpgradeStartManifestHash;
-
-            // Calculate SHA-512 hash over the manifest.
-            unReturnValue = Crypt_SHA512(PrgbPolicyParameterBlock, PusPolicyParameterBlockSize, sHash.digest.sha512);
-            if (RC_SUCCESS != unReturnValue)
-            {
-                unReturnValue = RC_E_FAIL;
-                break;
-            }
-            sHash.hashAlg = TSS_TPM_ALG_SHA512;
-
-            // Marshal the hash as TPMT_HA structure into TSS_TPM2B_MAX_BUFFER.
-            unReturnValue = TSS_TPMT_HA_Marshal(&sHash, &pMarshal, &nMarshal);
+            unReturnValue = Platform_MemoryCopy(PpsTpmState, sizeof(*PpsTpmState), &s_sTpmStateSnapshot, sizeof(s_sTpmStateSnapshot));
             if (RC_SUCCESS != unReturnValue)
-            {
-                unReturnValue = RC_E_FAIL;
                 break;
-            }
-
-            // Update the size of the TSS_TPM2B_MAX_BUFFER.
-            sData.size = (TSS_UINT16)(sizeof(sData.buffer) - nMarshal);
-        }
-        else
-        {
-            // Set the sub-command.
-            bSubCommand = TPM20_FieldUpgradeStart;
-
-            // Copy the block to TSS_TPM2B_MAX_BUFFER.
-            unReturnValue = Platform_MemoryCopy(sData.buffer, sizeof(sData.buffer), PrgbPolicyParameterBlock, PusPolicyParameterBlockSize);
-            if (RC_SUCCESS != unReturnValue)
+            if (!PfCheckPlatformHierarchy)
             {
-                unReturnValue = RC_E_FAIL;
-                break;
+                PpsTpmState->attribs.tpm20emptyPlatformAuth = 0;
+                PpsTpmState->attribs.tpm20phDisabled = 0;
             }
-            sData.size = PusPolicyParameterBlockSize;
+            LOGGING_WRITE_LEVEL3(L"TPM state served from snapshot");
+            break;
         }
 
-        // Initialize authorization command data structure
-        sAuthSessionData.authHandle = PunSessionHandle;
-        sAuthSessionData.sessionAttributes.continueSession = 1;
+        s_fTpmStateSnapshotValid = FALSE;
+        unReturnValue = FirmwareUpdate_QueryState(PfCheckPlatformHierarchy, PpsTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
-        // Call TPM2_FieldUpgradeStartVendor command
-        unReturnValue = TSS_TPM2_FieldUpgradeStartVendor(TSS_TPM_RH_PLATFORM, &sAuthSessionData, bSubCommand, &sData, &usStartSize, &sAckAuthSessionData);
-        if ((RC_TPM_MASK | TSS_TPM_RC_REFERENCE_S0) == unReturnValue)
+        // Take the generation after the query since the query itself sends commands like TPM2_Startup
+        if (RC_SUCCESS == Platform_MemoryCopy(&s_sTpmStateSnapshot, sizeof(s_sTpmStateSnapshot), PpsTpmState, sizeof(*PpsTpmState)))
         {
-            // Policy session handle is not loaded to the TPM
-            unReturnValue = RC_E_TPM20_POLICY_SESSION_NOT_LOADED;
-            ERROR_STORE(unReturnValue, L"A \"policy session handle is not loaded\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function.");
-            break;
+            s_unTpmStateSnapshotGeneration = DeviceManagement_GetTpmStateGeneration();
+            s_fTpmStateSnapshotPlatformHierarchy = PfCheckPlatformHierarchy;
+            s_fTpmStateSnapshotValid = TRUE;
         }
-        else if ((RC_TPM_MASK | TSS_TPM_RC_VALUE | TSS_TPM_RC_S | TSS_TPM_RC_1) == unReturnValue)
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads the TPM2.0 firmware update operation mode with a single command
+ *  @details    The function sends exactly one TPM2_GetCapability(TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_OPERATION_MODE)
+ *              command and sets only the attributes derived from the operation mode (tpm20, tpmHasFULoader20, tpm20OperationMode,
+ *              tpmInOperationalMode, tpmInFwUpdateMode, tpmInFwRecoveryMode, tpmFirmwareIsValid and tpm20restartRequired).
+ *              All other attributes are zero. Unlike FirmwareUpdate_CalculateState the TPM is not started and the TPM state
+ *              snapshot is neither used nor updated, so mode switches the TPM performs on its own are reported. If the function
+ *              fails (e.g. the TPM has not been started yet or is a TPM1.2) the caller can fall back to FirmwareUpdate_CalculateState.
+ *
+ *  @param      PpsTpmState                 Pointer to a variable representing the TPM state.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully. tpmHasFULoader20 is 0 if the TPM does not support the property.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PpsTpmState is NULL.
+ *  @retval     RC_E_FAIL                   The TPM returned a property of an unexpected size.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetOperationMode(
+    _Out_   TPM_STATE*  PpsTpmState)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BYTE bOperationMode = 0;
+        TSS_UINT32 unPropertySize = sizeof(bOperationMode);
+
+        // Check parameters
+        if (NULL == PpsTpmState)
         {
-            // Policy session handle value is out of range
-            unReturnValue = RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE;
-            ERROR_STORE(unReturnValue, L"A \"policy handle is out of range\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function");
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsTpmState is NULL)");
             break;
         }
-        else if ((RC_TPM_MASK | TSS_TPM_RC_POLICY_FAIL | TSS_TPM_RC_S | TSS_TPM_RC_1) == unReturnValue)
+
+        Platform_MemorySet(PpsTpmState, 0, sizeof(*PpsTpmState));
+
+        unReturnValue = TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_OPERATION_MODE, &bOperationMode, &unPropertySize);
+        if (RC_SUCCESS != unReturnValue)
         {
-            // Policy session is invalid
-            unReturnValue = RC_E_TPM20_INVALID_POLICY_SESSION;
-            ERROR_STORE(unReturnValue, L"A \"policy is invalid\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function.");
+            // A TPM2.0 without TPM2.0 based firmware update does not know the property
+            if ((unReturnValue ^ RC_TPM_MASK) == (TSS_TPM_RC_VALUE | TSS_TPM_RC_P | TSS_TPM_RC_2) ||
+                    (unReturnValue ^ RC_TPM_MASK) == TSS_TPM_RC_VALUE)
+            {
+                PpsTpmState->attribs.tpm20 = 1;
+                unReturnValue = RC_SUCCESS;
+            }
+            else
+                LOGGING_WRITE_LEVEL2_FMT(L"TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_OPERATION_MODE) failed (0x%.8X).", unReturnValue);
             break;
         }
-        else if (RC_SUCCESS != unReturnValue)
+        if (sizeof(bOperationMode) != unPropertySize)
         {
-            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeStartVendor returned an unexpected value.(0x%.8X)", unReturnValue);
-            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            unReturnValue = RC_E_FAIL;
+            ERROR_STORE(unReturnValue, L"TSS_TPM2_GetVendorProperty returned wrong buffer size of capability");
             break;
         }
 
-        // The TPM switches to boot loader mode, so there is no more need to call TPM2_Shutdown to prevent unorderly shutdowns.
-        if (PropertyStorage_ExistsElement(PROPERTY_CALL_SHUTDOWN_ON_EXIT))
-        {
-            IGNORE_RETURN_VALUE_BOOL(PropertyStorage_RemoveElement(PROPERTY_CALL_SHUTDOWN_ON_EXIT));
-        }
-
-        // Set Progress to 0% after start vendor
-        PfnProgress(0);
-
-        unReturnValue = RC_SUCCESS;
+        PpsTpmState->attribs.tpm20 = 1;
+        PpsTpmState->attribs.tpmFirmwareIsValid = 1;
+        PpsTpmState->attribs.tpmInOperationalMode = 1;
+        FirmwareUpdate_SetOperationModeAttributes(bOperationMode, PpsTpmState);
     }
     WHILE_FALSE_END;
 
@@ -2077,74 +2692,533 @@ FirmwareUpdate_Start_Tpm20(
 }
 
 /**
- *  @brief      FirmwareUpdate start for TPM1.2.
- *  @details    The function takes the firmware update policy parameter block and starts the firmware update process.
+ *  @brief      Starts the telemetry of a firmware transfer
+ *  @details
  *
- *  @param      PbfTpmAttributes                The operation mode of the TPM.
- *  @param      PrgbPolicyParameterBlock        Pointer to the policy parameter block byte stream.
- *  @param      PusPolicyParameterBlockSize     Size of the policy parameter block.
- *  @param      PrgbOwnerAuthHash               TPM Owner authentication hash (sha1).
- *  @param      PfnProgress                     Callback function to indicate the progress.
+ *  @param      PunTotalBytes       Number of firmware bytes to send.
+ */
+static
+void
+FirmwareUpdate_TransferTelemetryStart(
+    _In_    unsigned int    PunTotalBytes)
+{
+    Platform_MemorySet(&s_sTransferTelemetry, 0, sizeof(s_sTransferTelemetry));
+    s_sTransferTelemetry.fActive = TRUE;
+    s_sTransferTelemetry.unTotalBytes = PunTotalBytes;
+    s_ullTransferStartTicks = Platform_GetTicks();
+    s_ullTransferBlockTicks = s_ullTransferStartTicks;
+}
+
+/**
+ *  @brief      Records a firmware block acknowledged by the TPM in the transfer telemetry
+ *  @details    Updates the current and average throughput and the estimated time to completion.
  *
- *  @retval     RC_SUCCESS                      The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. Policy parameter block stream is NULL or policy session handle is not 0.
- *  @retval     RC_E_CORRUPT_FW_IMAGE           Policy parameter block is corrupt and/or cannot be unmarshalled.
- *  @retval     RC_E_FAIL                       TPM connection or command error.
- *  @retval     RC_E_TPM12_DEFERREDPP_REQUIRED  Deferred Physical Presence has not been set (TPM1.2 only).
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
- *  @retval     RC_E_TPM12_INVALID_OWNERAUTH    TPM Owner authentication is incorrect (TPM1.2 only).
- *  @retval     RC_E_TPM12_DA_ACTIVE            The TPM Owner is locked out due to dictionary attack (TPM1.2 only).
+ *  @param      PunBlockSize        Size of the acknowledged firmware block in bytes.
+ */
+static
+void
+FirmwareUpdate_TransferTelemetryBlock(
+    _In_    unsigned int    PunBlockSize)
+{
+    unsigned long long ullTicks = Platform_GetTicks();
+    unsigned long long ullBlockUs = Platform_TicksToMicroseconds(ullTicks - s_ullTransferBlockTicks);
+    unsigned long long ullElapsedUs = Platform_TicksToMicroseconds(ullTicks - s_ullTransferStartTicks);
+    unsigned int unRemainingBytes = 0;
+
+    s_ullTransferBlockTicks = ullTicks;
+    s_sTransferTelemetry.unBytesSent += PunBlockSize;
+    s_sTransferTelemetry.unBlocksAcknowledged++;
+    s_sTransferTelemetry.unElapsedMs = (unsigned int)(ullElapsedUs / 1000);
+    if (0 != ullBlockUs)
+        s_sTransferTelemetry.unCurrentThroughput = (unsigned int)((unsigned long long)PunBlockSize * 1000000 / ullBlockUs);
+    if (0 != ullElapsedUs)
+        s_sTransferTelemetry.unAverageThroughput = (unsigned int)((unsigned long long)s_sTransferTelemetry.unBytesSent * 1000000 / ullElapsedUs);
+
+    // Estimate the remaining time from the average throughput so far
+    unRemainingBytes = s_sTransferTelemetry.unTotalBytes > s_sTransferTelemetry.unBytesSent ? s_sTransferTelemetry.unTotalBytes - s_sTransferTelemetry.unBytesSent : 0;
+    if (0 == unRemainingBytes)
+        s_sTransferTelemetry.unEstimatedRemainingMs = 0;
+    else if (0 != s_sTransferTelemetry.unAverageThroughput)
+        s_sTransferTelemetry.unEstimatedRemainingMs = (unsigned int)((unsigned long long)unRemainingBytes * 1000 / s_sTransferTelemetry.unAverageThroughput);
+    else
+        s_sTransferTelemetry.unEstimatedRemainingMs = TRANSFER_TELEMETRY_UNKNOWN;
+}
+
+/**
+ *  @brief      Returns the telemetry of the current or last firmware transfer
+ *  @details    The function does not access the TPM. It can be called from the progress callback or from a timer event
+ *              while a firmware update is in progress.
+ *
+ *  @param      PpsTelemetry        Receives the transfer telemetry.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_Start_Tpm12(
-    _In_                                        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
-    _In_bytecount_(PusPolicyParameterBlockSize) BYTE*                               PrgbPolicyParameterBlock,
-    _In_                                        UINT16                              PusPolicyParameterBlockSize,
-    _In_bytecount_(TSS_SHA1_DIGEST_SIZE)        const BYTE                          PrgbOwnerAuthHash[TSS_SHA1_DIGEST_SIZE],
-    _In_                                        PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+FirmwareUpdate_GetTransferTelemetry(
+    _Out_   FIRMWARE_TRANSFER_TELEMETRY*    PpsTelemetry)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
-        TSS_TPM_NONCE sNonceEven;
-        TSS_TPM_AUTHHANDLE unAuthHandle = 0;
-        BYTE* pbOwnerAuth = NULL;
-        BYTE* rgbPolicyParameterBlock = NULL;
-        int nPolicyParameterBlockSize = 0;
-
-        // Policy parameter block data
-        sSignedData_d sSignedData;
-
-        Platform_MemorySet(&sNonceEven, 0, sizeof(sNonceEven));
-        Platform_MemorySet(&sSignedData, 0, sizeof(sSignedData));
-
         // Check parameters
-        if (NULL == PrgbPolicyParameterBlock ||
-                0 == PusPolicyParameterBlockSize)
+        if (NULL == PpsTelemetry)
         {
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbPolicyParameterBlock is NULL or PusPolicyParameterBlockSize is zero)");
             unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsTelemetry is NULL)");
             break;
         }
 
-        // Copy pointer and size for unmarshalling
-        rgbPolicyParameterBlock = PrgbPolicyParameterBlock;
-        nPolicyParameterBlockSize = PusPolicyParameterBlockSize;
+        unReturnValue = Platform_MemoryCopy(PpsTelemetry, sizeof(*PpsTelemetry), &s_sTransferTelemetry, sizeof(s_sTransferTelemetry));
+    }
+    WHILE_FALSE_END;
 
-        // Unmarshal the block to sSignedData structure
-        unReturnValue = TSS_sSignedData_d_Unmarshal(&sSignedData, &rgbPolicyParameterBlock, &nPolicyParameterBlockSize);
-        if (RC_SUCCESS != unReturnValue)
-        {
-            ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_Unmarshal returned an unexpected value. (0x%.8X)", unReturnValue);
-            unReturnValue = RC_E_CORRUPT_FW_IMAGE;
-            break;
-        }
+    return unReturnValue;
+}
 
-        if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.tpm12owner)
-        {
-            // Get dictionary attack state for TPM_ET_OWNER and return RC_E_TPM12_DA_ACTIVE if TPM Owner is locked out.
+/**
+ *  @brief      Resets the phase timing of a firmware update
+ *  @details    Called by the caller of FirmwareUpdate_UpdateImage before the image is verified, so that the verification and
+ *              the policy session are included in the phase timing. FirmwareUpdate_UpdateImage resets the phase timing itself
+ *              if no phase is measured when it is called.
+ */
+void
+FirmwareUpdate_PhaseTimingReset()
+{
+    Platform_MemorySet(&s_sPhaseTiming, 0, sizeof(s_sPhaseTiming));
+    s_sPhaseTiming.unCurrentPhase = UPDATE_PHASE_NONE;
+    s_ullPhaseResetTicks = Platform_GetTicks();
+    s_ullPhaseStartTicks = s_ullPhaseResetTicks;
+}
+
+/**
+ *  @brief      Switches the measured phase of a firmware update
+ *  @details    The time since the last switch is added to the phase measured so far. Switching to a phase measured before
+ *              adds to its time, so interleaved phases (e.g. verification and policy session) are accounted for separately.
+ *
+ *  @param      PunPhase            Phase to measure from now on (UPDATE_PHASE_VERIFY, ...) or UPDATE_PHASE_NONE to stop.
+ */
+void
+FirmwareUpdate_PhaseTimingSwitch(
+    _In_    unsigned int    PunPhase)
+{
+    unsigned long long ullTicks = Platform_GetTicks();
+
+    if (s_sPhaseTiming.unCurrentPhase < UPDATE_PHASE_COUNT)
+    {
+        s_sPhaseTiming.rgullPhaseUs[s_sPhaseTiming.unCurrentPhase] += Platform_TicksToMicroseconds(ullTicks - s_ullPhaseStartTicks);
+        s_sPhaseTiming.ullTotalUs = Platform_TicksToMicroseconds(ullTicks - s_ullPhaseResetTicks);
+    }
+    s_sPhaseTiming.unCurrentPhase = PunPhase < UPDATE_PHASE_COUNT ? PunPhase : UPDATE_PHASE_NONE;
+    s_ullPhaseStartTicks = ullTicks;
+}
+
+/**
+ *  @brief      Returns the phase timing of the current or last firmware update
+ *  @details    The function does not access the TPM.
+ *
+ *  @param      PpsTiming           Receives the phase timing.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetPhaseTiming(
+    _Out_   UPDATE_PHASE_TIMING*    PpsTiming)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PpsTiming)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsTiming is NULL)");
+            break;
+        }
+
+        unReturnValue = Platform_MemoryCopy(PpsTiming, sizeof(*PpsTiming), &s_sPhaseTiming, sizeof(s_sPhaseTiming));
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the firmware update history
+ *  @details    The history is read from the non-volatile platform storage. The function does not access the TPM.
+ *              An empty history is returned if no firmware update has been recorded yet.
+ *
+ *  @param      PpsHistory          Receives the firmware update history.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetUpdateHistory(
+    _Out_   UPDATE_HISTORY*         PpsHistory)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unHistorySize = sizeof(*PpsHistory);
+
+        // Check parameters
+        if (NULL == PpsHistory)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsHistory is NULL)");
+            break;
+        }
+
+        // Start a new history if none is stored or the stored one has another layout
+        if (RC_SUCCESS != Platform_NvStoreRead(UPDATE_HISTORY_NAME, PpsHistory, &unHistorySize) ||
+                sizeof(*PpsHistory) != unHistorySize || UPDATE_HISTORY_LAYOUT_VERSION != PpsHistory->unLayoutVersion)
+        {
+            Platform_MemorySet(PpsHistory, 0, sizeof(*PpsHistory));
+            PpsHistory->unLayoutVersion = UPDATE_HISTORY_LAYOUT_VERSION;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Estimates the duration of a firmware update
+ *  @details    The per-block latency and the block size are taken from the last firmware transfer if one was measured since
+ *              the driver was loaded, otherwise from the transport profile of the TPM model or the calibrated values for
+ *              the update flow.
+ *
+ *  @param      PfTpm20Loader           TRUE for the TPM2.0 based firmware update flow (see TPM_STATE.attribs.tpmHasFULoader20).
+ *  @param      PpsFirmwareImage        Pointer to the unmarshalled firmware image (with the manifest selected for the TPM2.0 based flow).
+ *  @param      PpsEstimate             Receives the update duration estimate.
+ */
+static
+void
+FirmwareUpdate_EstimateUpdateDuration(
+    _In_    BOOL                            PfTpm20Loader,
+    _In_    const IfxFirmwareImage* const   PpsFirmwareImage,
+    _Out_   UPDATE_DURATION_ESTIMATE*       PpsEstimate)
+{
+    Platform_MemorySet(PpsEstimate, 0, sizeof(*PpsEstimate));
+
+    if (s_sTransferTelemetry.unBlocksAcknowledged > 0 && !s_sTransferTelemetry.fActive)
+    {
+        PpsEstimate->fMeasured = TRUE;
+        PpsEstimate->unBlockSize = (s_sTransferTelemetry.unBytesSent + s_sTransferTelemetry.unBlocksAcknowledged - 1) / s_sTransferTelemetry.unBlocksAcknowledged;
+        PpsEstimate->unBlockLatencyUs = (unsigned int)((unsigned long long)s_sTransferTelemetry.unElapsedMs * 1000 / s_sTransferTelemetry.unBlocksAcknowledged);
+    }
+    else
+    {
+        PpsEstimate->unBlockSize = TSS_MAX_DIGEST_BUFFER;
+        PpsEstimate->unBlockLatencyUs = PfTpm20Loader ? TPM20_FU_ESTIMATE_BLOCK_LATENCY_US : TPM_FU_ESTIMATE_BLOCK_LATENCY_US;
+        if (0 != s_sInterfaceInfo.usFieldUpgradeBlockSize)
+            PpsEstimate->unBlockSize = s_sInterfaceInfo.usFieldUpgradeBlockSize;
+        if (0 != s_sInterfaceInfo.unBlockLatencyUs)
+            PpsEstimate->unBlockLatencyUs = s_sInterfaceInfo.unBlockLatencyUs;
+    }
+
+    if (PfTpm20Loader)
+    {
+        // Manifest blocks, switch to boot loader mode, firmware blocks, switch to the mode before finalize, finalize
+        PpsEstimate->unManifestBlocks = (PpsFirmwareImage->usPolicyParameterBlockSize + PpsEstimate->unBlockSize - 1) / PpsEstimate->unBlockSize;
+        PpsEstimate->unFixedWaitMs = 2 * TPM20_FU_WAIT_TIME + TPM_FU_COMPLETE_WAIT_TIME;
+    }
+    else
+    {
+        // TPM_FieldUpgradeStart carries the whole policy parameter block, switch to boot loader mode, firmware blocks, complete
+        PpsEstimate->unManifestBlocks = 1;
+        PpsEstimate->unFixedWaitMs = TPM_FU_START_RETRY_WAIT_TIME + TPM_FU_COMPLETE_WAIT_TIME;
+    }
+    PpsEstimate->unFirmwareBlocks = (PpsFirmwareImage->unFirmwareSize + PpsEstimate->unBlockSize - 1) / PpsEstimate->unBlockSize;
+    PpsEstimate->unTotalMs = PpsEstimate->unFixedWaitMs + (unsigned int)(
+                                 (unsigned long long)(PpsEstimate->unManifestBlocks + PpsEstimate->unFirmwareBlocks) * PpsEstimate->unBlockLatencyUs / 1000);
+    PpsEstimate->fValid = TRUE;
+}
+
+/**
+ *  @brief      Returns the estimated duration of a firmware update with the image last checked by FirmwareUpdate_CheckImage
+ *  @details    The function does not access the TPM. The estimate is not available (fValid is FALSE) if no image was checked,
+ *              if the image is not valid for the TPM or if the image has been consumed by FirmwareUpdate_UpdateImage.
+ *
+ *  @param      PpsEstimate         Receives the update duration estimate.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetUpdateDurationEstimate(
+    _Out_   UPDATE_DURATION_ESTIMATE*   PpsEstimate)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PpsEstimate)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsEstimate is NULL)");
+            break;
+        }
+
+        Platform_MemorySet(PpsEstimate, 0, sizeof(*PpsEstimate));
+        if (s_sVerifiedImage.fValid && s_sVerifiedImage.fImageValid)
+            *PpsEstimate = s_sVerifiedImage.sDurationEstimate;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      FirmwareUpdate start for TPM2.0.
+ *  @details    The function takes the firmware update policy parameter block and the stored policy session and starts the
+ *              firmware update process.
+ *
+ *  @param      PbfTpmAttributes                The operation mode of the TPM.
+ *  @param      PusPolicyParameterBlockSize     Size of the policy parameter block.
+ *  @param      PrgbPolicyParameterBlock        Pointer to the policy parameter block byte stream.
+ *  @param      PrgbManifestDigest              SHA-512 digest of the policy parameter block calculated in advance or NULL.
+ *                                              Only used for a TPM with TPM2.0 firmware loader.
+ *  @param      PunSessionHandle                Session handle.
+ *  @param      PfnProgress                     Callback function to indicate the progress.
+ *
+ *  @retval     RC_SUCCESS                              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                      An invalid parameter was passed to the function. Policy parameter block stream is NULL.
+ *  @retval     RC_E_TPM20_INVALID_POLICY_SESSION       The policy session handle is 0 or invalid or policy authorization failed.
+ *  @retval     RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE   The policy handle value is out of range.
+ *  @retval     RC_E_TPM20_POLICY_SESSION_NOT_LOADED    The policy session is not loaded to the TPM.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED             Firmware update started but failed.
+ *  @retval     RC_E_FAIL                               An unexpected error occurred.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_Start_Tpm20(
+    _In_                                        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
+    _In_bytecount_(PusPolicyParameterBlockSize) BYTE*                               PrgbPolicyParameterBlock,
+    _In_                                        UINT16                              PusPolicyParameterBlockSize,
+    _In_opt_                                    const BYTE*                         PrgbManifestDigest,
+    _In_                                        unsigned int                        PunSessionHandle,
+    _In_                                        PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Authorization session area
+        TSS_AuthorizationCommandData sAuthSessionData;
+        TSS_AcknowledgmentResponseData sAckAuthSessionData;
+
+        // Policy parameter block data
+        TSS_TPM2B_MAX_BUFFER* psData = &s_sFieldUpgradeData;
+        TSS_UINT8 bSubCommand;
+
+        // Out parameter
+        unsigned short usStartSize = 0;
+
+        Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
+        Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
+        Platform_MemorySet(psData, 0, sizeof(*psData));
+
+        // Check parameters
+        if (NULL == PrgbPolicyParameterBlock ||
+                0 == PusPolicyParameterBlockSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbPolicyParameterBlock is NULL or PusPolicyParameterBlockSize is zero)");
+            break;
+        }
+
+        if (0 == PunSessionHandle)
+        {
+            unReturnValue = RC_E_TPM20_INVALID_POLICY_SESSION;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PunSessionHandle is zero)");
+            break;
+        }
+
+        if (PbfTpmAttributes.tpmHasFULoader20)
+        {
+            TSS_TPMT_HA sHash;
+            TSS_INT32 nMarshal = sizeof(psData->buffer);
+            TSS_BYTE* pMarshal = psData->buffer;
+
+            // Set the sub-command.
+            bSubCommand = TPM20_FieldUpgradeStartManifestHash;
+
+            // Take the SHA-512 hash over the manifest calculated in advance or calculate it now.
+            if (NULL != PrgbManifestDigest)
+                unReturnValue = Platform_MemoryCopy(sHash.digest.sha512, sizeof(sHash.digest.sha512), PrgbManifestDigest, TSS_SHA512_DIGEST_SIZE);
+            else
+                unReturnValue = Crypt_SHA512(PrgbPolicyParameterBlock, PusPolicyParameterBlockSize, sHash.digest.sha512);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                unReturnValue = RC_E_FAIL;
+                break;
+            }
+            sHash.hashAlg = TSS_TPM_ALG_SHA512;
+
+            // Marshal the hash as TPMT_HA structure into TSS_TPM2B_MAX_BUFFER.
+            unReturnValue = TSS_TPMT_HA_Marshal(&sHash, &pMarshal, &nMarshal);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                unReturnValue = RC_E_FAIL;
+                break;
+            }
+
+            // Update the size of the TSS_TPM2B_MAX_BUFFER.
+            psData->size = (TSS_UINT16)(sizeof(psData->buffer) - nMarshal);
+        }
+        else
+        {
+            // Set the sub-command.
+            bSubCommand = TPM20_FieldUpgradeStart;
+
+            // Copy the block to TSS_TPM2B_MAX_BUFFER.
+            unReturnValue = Platform_MemoryCopy(psData->buffer, sizeof(psData->buffer), PrgbPolicyParameterBlock, PusPolicyParameterBlockSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                unReturnValue = RC_E_FAIL;
+                break;
+            }
+            psData->size = PusPolicyParameterBlockSize;
+        }
+
+        // Initialize authorization command data structure
+        sAuthSessionData.authHandle = PunSessionHandle;
+        sAuthSessionData.sessionAttributes.continueSession = 1;
+
+        // Call TPM2_FieldUpgradeStartVendor command
+        unReturnValue = TSS_TPM2_FieldUpgradeStartVendor(TSS_TPM_RH_PLATFORM, &sAuthSessionData, bSubCommand, psData, &usStartSize, &sAckAuthSessionData);
+        if ((RC_TPM_MASK | TSS_TPM_RC_REFERENCE_S0) == unReturnValue)
+        {
+            // Policy session handle is not loaded to the TPM
+            unReturnValue = RC_E_TPM20_POLICY_SESSION_NOT_LOADED;
+            ERROR_STORE(unReturnValue, L"A \"policy session handle is not loaded\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function.");
+            break;
+        }
+        else if ((RC_TPM_MASK | TSS_TPM_RC_VALUE | TSS_TPM_RC_S | TSS_TPM_RC_1) == unReturnValue)
+        {
+            // Policy session handle value is out of range
+            unReturnValue = RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE;
+            ERROR_STORE(unReturnValue, L"A \"policy handle is out of range\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function");
+            break;
+        }
+        else if ((RC_TPM_MASK | TSS_TPM_RC_POLICY_FAIL | TSS_TPM_RC_S | TSS_TPM_RC_1) == unReturnValue)
+        {
+            // Policy session is invalid
+            unReturnValue = RC_E_TPM20_INVALID_POLICY_SESSION;
+            ERROR_STORE(unReturnValue, L"A \"policy is invalid\" error was returned by TSS_TPM2_FieldUpgradeStartVendor function.");
+            break;
+        }
+        else if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeStartVendor returned an unexpected value.(0x%.8X)", unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+
+        // The TPM switches to boot loader mode, so there is no more need to call TPM2_Shutdown to prevent unorderly shutdowns.
+        if (PropertyStorage_ExistsElement(PROPERTY_CALL_SHUTDOWN_ON_EXIT))
+        {
+            IGNORE_RETURN_VALUE_BOOL(PropertyStorage_RemoveElement(PROPERTY_CALL_SHUTDOWN_ON_EXIT));
+        }
+
+        // Set Progress to 0% after start vendor
+        PfnProgress(0);
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+/**
+ *  @brief      FirmwareUpdate start for TPM1.2.
+ *  @details    The function takes the firmware update policy parameter block and starts the firmware update process.
+ *
+ *  @param      PbfTpmAttributes                The operation mode of the TPM.
+ *  @param      PrgbPolicyParameterBlock        Pointer to the policy parameter block byte stream.
+ *  @param      PusPolicyParameterBlockSize     Size of the policy parameter block.
+ *  @param      PrgbOwnerAuthHash               TPM Owner authentication hash (sha1).
+ *  @param      PfOwnerAuthVerified             TRUE if the caller has already checked the dictionary attack state and PrgbOwnerAuthHash. The
+ *                                              checks are skipped and TPM_FieldUpgradeStart validates the TPM Owner authorization itself.
+ *  @param      PfnProgress                     Callback function to indicate the progress.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. Policy parameter block stream is NULL or policy session handle is not 0.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE           Policy parameter block is corrupt and/or cannot be unmarshalled.
+ *  @retval     RC_E_FAIL                       TPM connection or command error.
+ *  @retval     RC_E_TPM12_DEFERREDPP_REQUIRED  Deferred Physical Presence has not been set (TPM1.2 only).
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ *  @retval     RC_E_TPM12_INVALID_OWNERAUTH    TPM Owner authentication is incorrect (TPM1.2 only).
+ *  @retval     RC_E_TPM12_DA_ACTIVE            The TPM Owner is locked out due to dictionary attack (TPM1.2 only).
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_Start_Tpm12(
+    _In_                                        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
+    _In_bytecount_(PusPolicyParameterBlockSize) BYTE*                               PrgbPolicyParameterBlock,
+    _In_                                        UINT16                              PusPolicyParameterBlockSize,
+    _In_bytecount_(TSS_SHA1_DIGEST_SIZE)        const BYTE                          PrgbOwnerAuthHash[TSS_SHA1_DIGEST_SIZE],
+    _In_                                        BOOL                                PfOwnerAuthVerified,
+    _In_                                        PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        TSS_TPM_NONCE sNonceEven;
+        TSS_TPM_AUTHHANDLE unAuthHandle = 0;
+        BYTE* pbOwnerAuth = NULL;
+
+        // Policy parameter block data
+        sSignedDataView_d sSignedData;
+
+        Platform_MemorySet(&sNonceEven, 0, sizeof(sNonceEven));
+        Platform_MemorySet(&sSignedData, 0, sizeof(sSignedData));
+
+        // Check parameters
+        if (NULL == PrgbPolicyParameterBlock ||
+                0 == PusPolicyParameterBlockSize)
+        {
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbPolicyParameterBlock is NULL or PusPolicyParameterBlockSize is zero)");
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check that the block is parsable, it is unmarshaled in place
+        unReturnValue = TSS_sSignedData_d_UnmarshalView(&sSignedData, PrgbPolicyParameterBlock, PusPolicyParameterBlockSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(RC_E_CORRUPT_FW_IMAGE, L"TSS_sSignedData_d_UnmarshalView returned an unexpected value. (0x%.8X)", unReturnValue);
+            unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            break;
+        }
+
+        if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.tpm12owner && PfOwnerAuthVerified)
+        {
+            // The dictionary attack state and the TPM Owner authorization have been checked by the caller, so neither the
+            // capability nor the EK is read again. A wrong authorization fails TPM_FieldUpgradeStart with TPM_AUTHFAIL.
+            LOGGING_WRITE_LEVEL2(L"TPM Owner authorization already verified, starting the update with a single OIAP session.");
+        }
+        else if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.tpm12owner)
+        {
+            // Get dictionary attack state for TPM_ET_OWNER and return RC_E_TPM12_DA_ACTIVE if TPM Owner is locked out.
             UINT16 usSubCap = TSS_TPM_ET_OWNER;
             TSS_TPM_DA_INFO sDaInfo;
             unsigned int unDaInfoSize = sizeof(TSS_TPM_DA_INFO);
@@ -2153,208 +3227,2305 @@ FirmwareUpdate_Start_Tpm12(
             unReturnValue = TSS_TPM_GetCapability(TSS_TPM_CAP_DA_LOGIC, sizeof(usSubCap), (BYTE*)&usSubCap, &unDaInfoSize, (BYTE*)&sDaInfo);
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"TSS_TPM_GetCapability returned an unexpected value.");
+                ERROR_STORE(unReturnValue, L"TSS_TPM_GetCapability returned an unexpected value.");
+                break;
+            }
+
+            if (TSS_TPM_DA_STATE_ACTIVE == sDaInfo.state)
+            {
+                unReturnValue = RC_E_TPM12_DA_ACTIVE;
+                ERROR_STORE(unReturnValue, L"TPM1.2 is in a dictionary attack mode.");
+                break;
+            }
+
+            // Check TPM Owner authorization (except for disabled/deactivated TPM)
+            unReturnValue = FirmwareUpdate_CheckOwnerAuthorization(PrgbOwnerAuthHash);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                if ((TSS_TPM_DEACTIVATED == (unReturnValue ^ RC_TPM_MASK)) || (TSS_TPM_DISABLED == (unReturnValue ^ RC_TPM_MASK)))
+                {
+                    // In disabled and/or deactivated state TPM Owner authorization may not be checkable prior to first TPM_FieldUpgrade request
+                }
+                else
+                {
+                    if (TSS_TPM_AUTHFAIL == (unReturnValue ^ RC_TPM_MASK))
+                    {
+                        unReturnValue = RC_E_TPM12_INVALID_OWNERAUTH;
+                        ERROR_STORE(unReturnValue, L"TPM1.2 Owner authentication is incorrect.");
+                    }
+                    else
+                    {
+                        ERROR_STORE(unReturnValue, L"TPM1.2 Owner authentication failed.");
+                        unReturnValue = RC_E_FAIL;
+                    }
+                    break;
+                }
+            }
+        }
+
+        if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.tpm12owner)
+        {
+            // Start OIAP session for TPM Owner authorized firmware update.
+            unReturnValue = TSS_TPM_OIAP(&unAuthHandle, &sNonceEven);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"TSS_TPM_OIAP returned an unexpected value.");
+                break;
+            }
+
+            pbOwnerAuth = (BYTE*)PrgbOwnerAuthHash;
+        }
+
+        unReturnValue = TSS_TPM_FieldUpgradeStart(PrgbPolicyParameterBlock, PusPolicyParameterBlockSize, pbOwnerAuth, unAuthHandle, &sNonceEven);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            if (TSS_TPM_BAD_PRESENCE == (unReturnValue ^ RC_TPM_MASK))
+            {
+                unReturnValue = RC_E_TPM12_DEFERREDPP_REQUIRED;
+                ERROR_STORE(unReturnValue, L"Deferred physical presence is required.");
+            }
+            else if (TSS_TPM_AUTHFAIL == (unReturnValue ^ RC_TPM_MASK))
+            {
+                unReturnValue = RC_E_TPM12_INVALID_OWNERAUTH;
+                ERROR_STORE(unReturnValue, L"The signature of the policy parameter block is invalid.");
+            }
+            else if (TSS_TPM_DEFEND_LOCK_RUNNING == (unReturnValue ^ RC_TPM_MASK))
+            {
+                unReturnValue = RC_E_TPM12_DA_ACTIVE;
+                ERROR_STORE(unReturnValue, L"TPM1.2 is in a dictionary attack mode.");
+            }
+            else
+            {
+                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"Error while sending the policy parameter block. (0x%.8X)", unReturnValue);
+                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            }
+
+            if (PbfTpmAttributes.tpm12owner)
+            {
+                IGNORE_RETURN_VALUE(TSS_TPM_FlushSpecific(unAuthHandle, TSS_TPM_RT_AUTH));
+            }
+
+            break;
+        }
+
+        // Set Progress to 0% after start vendor
+        PfnProgress(0);
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      FirmwareUpdateProcess Update
+ *  @details    The function determines the maximum data size for a firmware block and sends the firmware to the TPM
+ *              in chunks of maximum data size.
+ *
+ *  @param      PunFirmwareBlockSize    Size of the firmware block.
+ *  @param      PrgbFirmwareBlock       Pointer to the firmware block byte stream.
+ *  @param      PfnProgress             Callback function to indicate the progress.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. The firmware image block is NULL.
+ *  @retval     RC_E_FAIL                       In case of a TPM connection or command error.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ *  @retval     RC_E_TPM_NO_BOOT_LOADER_MODE    The TPM is not in boot loader mode.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_Update(
+    _In_                                    unsigned int                        PunFirmwareBlockSize,
+    _In_bytecount_(PunFirmwareBlockSize)    BYTE*                               PrgbFirmwareBlock,
+    _In_                                    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BYTE* rgbFirmwareBlock = NULL;
+        unsigned int unRemainingBytes = 0;
+        unsigned int unBlockNumber = 0;
+        unsigned int unCurrentProgress = 0;
+        UINT16 usMaxDataSize = 0;
+
+        // Check parameters
+        if (NULL == PrgbFirmwareBlock)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbFirmwareBlock is NULL)");
+            break;
+        }
+
+        rgbFirmwareBlock = PrgbFirmwareBlock;
+        unRemainingBytes = PunFirmwareBlockSize;
+
+        {
+            unsigned int unRetryCounter = 0;
+            unsigned int unWaitedMs = 0;
+            unsigned int unIntervalMs = TPM_FU_PROBE_INTERVAL_FIRST;
+
+            for (unRetryCounter = 0; ; unRetryCounter++)
+            {
+                // Get the max data size for a firmware update block and the boot loader status.
+                sSecurityModuleLogicInfo_d securityModuleLogicInfo;
+                Platform_MemorySet(&securityModuleLogicInfo, 0, sizeof(securityModuleLogicInfo));
+                unReturnValue = TSS_TPM_FieldUpgradeInfoRequest2(&securityModuleLogicInfo);
+                if (TSS_TPM_RESOURCES == (unReturnValue ^ RC_TPM_MASK))
+                {
+                    // Retry once on TPM_RESOURCES
+                    unReturnValue = TSS_TPM_FieldUpgradeInfoRequest2(&securityModuleLogicInfo);
+                }
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    if (TSS_TPM_BAD_PARAM_SIZE == (unReturnValue ^ RC_TPM_MASK) ||
+                            TSS_TPM_BAD_PARAMETER == (unReturnValue ^ RC_TPM_MASK))
+                    {
+                        ERROR_STORE(unReturnValue, L"TSS_TPM_FieldUpgradeInfoRequest2 returned an unexpected value.");
+                        unReturnValue = RC_E_UNSUPPORTED_CHIP;
+                    }
+                    ERROR_STORE(unReturnValue, L"TSS_TPM_FieldUpgradeInfoRequest2 returned an unexpected value.");
+                    break;
+                }
+                // The max data size does not change during the update session, keep the first value reported
+                if (0 == usMaxDataSize)
+                    usMaxDataSize = securityModuleLogicInfo.wMaxDataSize;
+
+                // Verify that TPM switched to boot loader mode. Wait some time if it did not.
+                if (securityModuleLogicInfo.SecurityModuleStatus != SMS_BTLDR_ACTIVE)
+                {
+                    unReturnValue = RC_E_TPM_NO_BOOT_LOADER_MODE;
+                    LOGGING_WRITE_LEVEL3_FMT(L"TPM is not in boot loader mode as expected (Count:%d, waited %d ms)", unRetryCounter, unWaitedMs);
+                    if (unWaitedMs >= TPM_FU_START_WAIT_BUDGET)
+                        break;
+                    // The TPM usually switches within a few ten milliseconds, so poll with an exponential backoff
+                    unIntervalMs = MIN(unIntervalMs, TPM_FU_START_WAIT_BUDGET - unWaitedMs);
+                    Platform_Sleep(unIntervalMs);
+                    unWaitedMs += unIntervalMs;
+                    unIntervalMs = MIN(unIntervalMs * 2, TPM_FU_PROBE_INTERVAL);
+                    continue;
+                }
+                else
+                {
+                    unReturnValue = RC_SUCCESS;
+                    break;
+                }
+            }
+
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        if (0 == usMaxDataSize)
+        {
+            unReturnValue = RC_E_FAIL;
+            ERROR_STORE(unReturnValue, L"TSS_TPM_FieldUpgradeInfoRequest2 returned a max data size of 0.");
+            break;
+        }
+
+        // Send the firmware image to the TPM block-by-block.
+        FirmwareUpdate_TransferTelemetryStart(PunFirmwareBlockSize);
+        for (unBlockNumber = 1; unRemainingBytes > 0; unBlockNumber++)
+        {
+            UINT16 usBlockSize = unRemainingBytes < usMaxDataSize ? (UINT16)unRemainingBytes : usMaxDataSize;
+
+            // Transmit data block
+            unReturnValue = TSS_TPM_FieldUpgradeUpdate(rgbFirmwareBlock, usBlockSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM_FieldUpgradeUpdate returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                break;
+            }
+
+            // Increase data pointer by block size
+            rgbFirmwareBlock += usBlockSize;
+
+            // Decrease size of remaining data by block size
+            unRemainingBytes -= usBlockSize;
+            FirmwareUpdate_TransferTelemetryBlock(usBlockSize);
+
+            // Set Progress (0 and 100% are set for _Start and _Complete so 98 steps are left)
+            {
+                unsigned int unProgress = (PunFirmwareBlockSize - unRemainingBytes) * 98 / PunFirmwareBlockSize + 1;
+                if (unCurrentProgress != unProgress)
+                {
+                    unCurrentProgress = unProgress;
+                    PfnProgress(unCurrentProgress);
+                }
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    s_sTransferTelemetry.fActive = FALSE;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      FirmwareUpdate Complete
+ *  @details    The function finishes the firmware update process.
+ *
+ *  @param      PfnProgress             Callback function to indicate the progress.
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_FAIL                       In case of a TPM connection or command error.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_Complete(
+    _In_    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK         PfnProgress)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Send TPM_FieldUpgradeComplete command.
+        uint16_t usCompleteDataSize = 1;
+        uint16_t usOutCompleteSize = 0;
+        BYTE bCompleteData = 0;
+
+        if (RC_SUCCESS != TSS_TPM_FieldUpgradeComplete(usCompleteDataSize, &bCompleteData, &usOutCompleteSize))
+        {
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM_FieldUpgradeComplete returned an unexpected value. (0x%.8X)", unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+
+        // Check if out parameter is as expected (zero)
+        if (0 != usOutCompleteSize)
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+
+        // Wait for TPM to complete update sequence, the TPM interface does not respond before
+        Platform_Sleep(TPM_FU_PROBE_INTERVAL);
+        {
+            unsigned int unResultWait = DeviceManagement_WaitForInterface(TPM_FU_COMPLETE_WAIT_TIME, TPM_FU_PROBE_INTERVAL);
+            if (RC_SUCCESS != unResultWait)
+                LOGGING_WRITE_LEVEL2_FMT(L"TPM interface did not respond after TSS_TPM_FieldUpgradeComplete (0x%.8X).", unResultWait);
+        }
+
+        // Set Progress to 100%
+        PfnProgress(100);
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+#endif
+
+/**
+ *  @brief      Checks whether the TPM2.0 has switched to the awaited operation mode during a firmware update.
+ *  @details
+ *
+ *  @param      PfFinalize          FALSE to check for boot loader mode (any mode other than OM_TPM).\n
+ *                                  TRUE to check for OM_FU_BEFORE_FINALIZE or OM_RE_BEFORE_FINALIZE.
+ *  @param      PbOperationMode     Operation mode read from the TPM.
+ *
+ *  @retval     TRUE                The TPM is in the awaited operation mode.
+ *  @retval     FALSE               The TPM is not in the awaited operation mode.
+ */
+static
+BOOL
+FirmwareUpdate_Tpm20_IsAwaitedMode(
+    _In_    BOOL    PfFinalize,
+    _In_    BYTE    PbOperationMode)
+{
+    if (PfFinalize)
+        return OM_FU_BEFORE_FINALIZE == PbOperationMode || OM_RE_BEFORE_FINALIZE == PbOperationMode;
+    return OM_TPM != PbOperationMode;
+}
+
+/**
+ *  @brief      Reads the TPM2.0 operation mode once the TPM interface responds.
+ *  @details    The TPM interface is probed at a short interval (see DeviceManagement_WaitForInterface) until it responds or
+ *              the timeout elapses.
+ *
+ *  @param      PunTimeout          Time in milliseconds to wait for the TPM interface.
+ *  @param      PpbOperationMode    Receives the operation mode read from the TPM.
+ *
+ *  @retval     RC_SUCCESS          The operation mode was read.
+ *  @retval     RC_E_FAIL           The TPM is not in a TPM2.0 firmware update capable mode.
+ *  @retval     ...                 Error codes from called functions.
+ */
+static
+unsigned int
+FirmwareUpdate_Tpm20_ProbeOperationMode(
+    _In_    unsigned int    PunTimeout,
+    _Out_   BYTE*           PpbOperationMode)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+        *PpbOperationMode = 0;
+
+        unReturnValue = DeviceManagement_WaitForInterface(PunTimeout, TPM20_FU_PROBE_INTERVAL);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_WaitForInterface failed (0x%.8X). Continue waiting for the mode switch.", unReturnValue);
+            break;
+        }
+
+        unReturnValue = FirmwareUpdate_GetOperationMode(&sTpmState);
+        if (RC_SUCCESS == unReturnValue && !sTpmState.attribs.tpmHasFULoader20)
+            unReturnValue = RC_E_FAIL;
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL2_FMT(L"FirmwareUpdate_GetOperationMode failed (0x%.8X). Continue waiting for the mode switch.", unReturnValue);
+            break;
+        }
+
+        *PpbOperationMode = (BYTE)sTpmState.attribs.tpm20OperationMode;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Waits for the TPM2.0 to switch its operation mode during a firmware update.
+ *  @details    The TPM interface is probed at a short interval (see DeviceManagement_WaitForInterface). The operation mode
+ *              is only read once the interface responds. Right after the command that triggers the switch the TPM may still
+ *              report the previous mode, so the mode is read again until the awaited mode is reported or
+ *              TPM20_FU_RETRY_COUNT * TPM20_FU_WAIT_TIME milliseconds have elapsed.
+ *
+ *  @param      PfFinalize          FALSE to wait for boot loader mode (any mode other than OM_TPM).\n
+ *                                  TRUE to wait for OM_FU_BEFORE_FINALIZE or OM_RE_BEFORE_FINALIZE.
+ *  @param      PpbOperationMode    Receives the last operation mode read from the TPM. The caller must check it since
+ *                                  it is not the awaited mode if the timeout elapsed.
+ *
+ *  @retval     RC_SUCCESS                      The operation mode was read.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The operation mode could not be read within the timeout.
+ */
+static
+unsigned int
+FirmwareUpdate_Tpm20_WaitForOperationMode(
+    _In_    BOOL    PfFinalize,
+    _Out_   BYTE*   PpbOperationMode)
+{
+    unsigned int unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+    const unsigned long long ullTimeout = TPM20_FU_RETRY_COUNT * TPM20_FU_WAIT_TIME;
+    unsigned long long ullStartTicks = Platform_GetTicks();
+    unsigned long long ullElapsed = 0;
+    unsigned long long ullWaited = 0;
+    BOOL fModeRead = FALSE;
+
+    *PpbOperationMode = 0;
+
+    for (;;)
+    {
+        BYTE bOperationMode = 0;
+
+        // Give the TPM a moment to start the mode switch
+        Platform_Sleep(TPM20_FU_PROBE_INTERVAL);
+        ullWaited += TPM20_FU_PROBE_INTERVAL;
+
+        // The accumulated sleep time is a lower bound in case no tick counter is available
+        ullElapsed = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks) / 1000;
+        if (ullElapsed < ullWaited)
+            ullElapsed = ullWaited;
+
+        // Read the operation mode once the TPM interface responds
+        if (RC_SUCCESS == FirmwareUpdate_Tpm20_ProbeOperationMode(ullElapsed < ullTimeout ? (unsigned int)(ullTimeout - ullElapsed) : 0, &bOperationMode))
+        {
+            fModeRead = TRUE;
+            *PpbOperationMode = bOperationMode;
+            if (FirmwareUpdate_Tpm20_IsAwaitedMode(PfFinalize, bOperationMode))
+                break;
+            LOGGING_WRITE_LEVEL3_FMT(L"TPM still reports operation mode 0x%.2X. Continue waiting for the mode switch.", bOperationMode);
+        }
+
+        ullElapsed = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks) / 1000;
+        if (ullElapsed < ullWaited)
+            ullElapsed = ullWaited;
+        if (ullElapsed >= ullTimeout)
+            break;
+    }
+
+    if (fModeRead)
+        unReturnValue = RC_SUCCESS;
+    else
+        ERROR_STORE(unReturnValue, L"No connection to the TPM can be established.");
+
+    LOGGING_WRITE_LEVEL3_FMT(L"Waited %d ms for the TPM operation mode switch.", (unsigned int)ullElapsed);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Writes the firmware transfer checkpoint to the non-volatile platform storage
+ *  @details    The checkpoint is informational, a failure to write it does not stop the firmware update.
+ *
+ *  @param      PpsCheckpoint       Checkpoint to write or NULL to delete the checkpoint.
+ */
+static
+void
+FirmwareUpdate_Tpm20_WriteCheckpoint(
+    _In_opt_    const FIRMWARE_TRANSFER_CHECKPOINT* PpsCheckpoint)
+{
+    unsigned int unReturnValue = Platform_NvStoreWrite(TPM20_FU_CHECKPOINT_NAME, PpsCheckpoint, NULL == PpsCheckpoint ? 0 : sizeof(*PpsCheckpoint));
+    if (RC_SUCCESS != unReturnValue)
+        LOGGING_WRITE_LEVEL2_FMT(L"Platform_NvStoreWrite(%ls) failed (0x%.8X).", TPM20_FU_CHECKPOINT_NAME, unReturnValue);
+}
+
+/**
+ *  @brief      Recovers the firmware transfer after a firmware block was not acknowledged
+ *  @details    Only errors which guarantee that the TPM did not process the block are recoverable: the transient TPM2.0
+ *              warnings (TPM_RC_RETRY, TPM_RC_YIELDED, TPM_RC_TESTING) and RC_E_TPM_TRANSMIT_DATA, which the TPM interface
+ *              reports before the command is started. Any other error (e.g. a lost response) may occur after the TPM has
+ *              taken the block, and resending it would corrupt the field upgrade.
+ *              The function waits until the TPM interface responds again and reads the operation mode:
+ *              - If the TPM still expects firmware data, the block can be resent.
+ *              - If the TPM is waiting for finalize and the block is the last one, the TPM has processed it. Only the
+ *                response got lost.
+ *
+ *  @param      PunError            Return code of the failed firmware block transfer.
+ *  @param      PunBlockNumber      Number of the failed firmware block.
+ *  @param      PfLastBlock         TRUE if the failed firmware block is the last one.
+ *  @param      PpfBlockAccepted    Receives TRUE if the TPM has received all firmware data, FALSE if the block must be resent.
+ *
+ *  @retval     RC_SUCCESS                      The firmware transfer can continue.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The error is not recoverable or the TPM is in an unexpected mode.
+ */
+static
+unsigned int
+FirmwareUpdate_Tpm20_RecoverBlock(
+    _In_    unsigned int    PunError,
+    _In_    unsigned int    PunBlockNumber,
+    _In_    BOOL            PfLastBlock,
+    _Out_   BOOL*           PpfBlockAccepted)
+{
+    unsigned int unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+
+    do
+    {
+        BYTE bOperationMode = 0;
+        *PpfBlockAccepted = FALSE;
+
+        if (RC_E_TPM_TRANSMIT_DATA != PunError && !DeviceManagement_IsTransientTpmWarning(PunError))
+            break;
+
+        LOGGING_WRITE_LEVEL1_FMT(L"Firmware block %d was not acknowledged (0x%.8X). Waiting for the TPM to resume the transfer.", PunBlockNumber, PunError);
+        unReturnValue = FirmwareUpdate_Tpm20_WaitForOperationMode(FALSE, &bOperationMode);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+
+        if (PfLastBlock && (OM_FU_BEFORE_FINALIZE == bOperationMode || OM_RE_BEFORE_FINALIZE == bOperationMode))
+            *PpfBlockAccepted = TRUE;
+        else if (OM_FU_CAN_ABANDON != bOperationMode && OM_FU_CANNOT_ABANDON != bOperationMode &&
+                 OM_RE_CAN_ABANDON != bOperationMode && OM_RE_CANNOT_ABANDON != bOperationMode)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"TPM is in an unexpected mode (%d), the firmware transfer cannot be resumed.", bOperationMode);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Determines the maximum data block size for the TPM2.0 field upgrade commands.
+ *  @details    The firmware and manifest blocks are TPM2B_MAX_BUFFER parameters. Their size is limited by TPM_PT_INPUT_BUFFER,
+ *              by TPM_PT_MAX_COMMAND_SIZE of the TPM and by TSS_MAX_COMMAND_SIZE. If the TPM does not report these properties
+ *              (e.g. in boot loader mode), the block size of the transport profile of the TPM model is used, or the
+ *              guaranteed minimum of TSS_MAX_DIGEST_BUFFER (1024) bytes if the profile has none.
+ *
+ *  @param      PunHeaderSize       Size of the command header preceding the data block in bytes.
+ *
+ *  @returns    The maximum data block size in bytes.
+ */
+static
+TSS_UINT16
+FirmwareUpdate_Tpm20_GetMaxBlockSize(
+    _In_    unsigned int    PunHeaderSize)
+{
+    const TSS_UINT32 rgunProperties[] = { TSS_TPM_PT_INPUT_BUFFER, TSS_TPM_PT_MAX_COMMAND_SIZE };
+    unsigned int unBlockSize = TSS_MAX_DIGEST_BUFFER;
+
+    do
+    {
+        const TPM_PROPERTY_MAP_ENTRY* psInputBuffer = NULL;
+        const TPM_PROPERTY_MAP_ENTRY* psMaxCommandSize = NULL;
+        unsigned int unLimit = TSS_MAX_COMMAND_SIZE - PunHeaderSize;
+
+        if (RC_SUCCESS != FirmwareUpdate_QueryTpmProperties(TSS_TPM_CAP_TPM_PROPERTIES, rgunProperties, RG_LEN(rgunProperties), FALSE))
+        {
+            LOGGING_WRITE_LEVEL2(L"TPM_PT_INPUT_BUFFER cannot be read, using the default field upgrade block size.");
+            if (s_sInterfaceInfo.usFieldUpgradeBlockSize > TSS_MAX_DIGEST_BUFFER)
+                unBlockSize = s_sInterfaceInfo.usFieldUpgradeBlockSize < unLimit ? s_sInterfaceInfo.usFieldUpgradeBlockSize : unLimit;
+            break;
+        }
+
+        psInputBuffer = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_INPUT_BUFFER);
+        if (NULL == psInputBuffer || psInputBuffer->unValue <= TSS_MAX_DIGEST_BUFFER)
+            break;
+
+        psMaxCommandSize = FirmwareUpdate_FindTpmProperty(TSS_TPM_CAP_TPM_PROPERTIES, TSS_TPM_PT_MAX_COMMAND_SIZE);
+        if (NULL != psMaxCommandSize && psMaxCommandSize->unValue > PunHeaderSize && psMaxCommandSize->unValue - PunHeaderSize < unLimit)
+            unLimit = psMaxCommandSize->unValue - PunHeaderSize;
+
+        unBlockSize = psInputBuffer->unValue < unLimit ? psInputBuffer->unValue : unLimit;
+        if (unBlockSize < TSS_MAX_DIGEST_BUFFER)
+            unBlockSize = TSS_MAX_DIGEST_BUFFER;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Using field upgrade blocks of up to %d bytes.", unBlockSize);
+
+    return (TSS_UINT16)unBlockSize;
+}
+
+/**
+ *  @brief      Sends the firmware blocks of a SLB 9672 firmware image with pipelined marshaling.
+ *  @details    The data blocks are streamed to the TPM directly from the firmware image. Two request headers are used
+ *              alternately: while the TPM processes block N, the header of block N+1 is marshaled. Block N+1 is
+ *              written to the TPM FIFO right after the response of block N has been read.
+ *
+ *  @param      PpsIfxFirmwareImage     Pointer to structure containing the firmware image.
+ *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PusMaxBlockSize         Maximum size of a firmware block in bytes.
+ *  @param      PpunCurrentProgress     In: last reported progress, out: updated progress.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation failed.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_SendFirmwareBlocksStreamed(
+    _In_    const IfxFirmwareImage* const       PpsIfxFirmwareImage,
+    _In_    const IfxFirmwareUpdateData* const  PpsFirmwareUpdateData,
+    _In_    TSS_UINT16                          PusMaxBlockSize,
+    _Inout_ unsigned int*                       PpunCurrentProgress)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+
+    do
+    {
+        BYTE rgbHeader[2][TPM2_FU_DATA_VENDOR_HEADER_SIZE];
+        unsigned int unCurrent = 0;
+        const BYTE* pbFirmwareBlock = PpsIfxFirmwareImage->rgbFirmware;
+        unsigned int unRemainingBytes = PpsIfxFirmwareImage->unFirmwareSize;
+        unsigned int unBlockNumber = 1;
+        unsigned int unWarningRetry = 0;
+        UINT16 usBlockSize = 0;
+
+        if (0 == unRemainingBytes)
+            break;
+
+        // Marshal and send the first block
+        usBlockSize = unRemainingBytes < PusMaxBlockSize ? (UINT16)unRemainingBytes : PusMaxBlockSize;
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader(usBlockSize, rgbHeader[unCurrent], sizeof(rgbHeader[unCurrent]));
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Send(rgbHeader[unCurrent], pbFirmwareBlock, usBlockSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor_Send returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            break;
+        }
+
+        for (;;)
+        {
+            unsigned int unNext = unCurrent ^ 1;
+            const BYTE* pbNextBlock = pbFirmwareBlock + usBlockSize;
+            unsigned int unNextRemainingBytes = unRemainingBytes - usBlockSize;
+            UINT16 usNextBlockSize = unNextRemainingBytes < PusMaxBlockSize ? (UINT16)unNextRemainingBytes : PusMaxBlockSize;
+
+            // Marshal the header of the next block while the TPM processes the current one
+            if (unNextRemainingBytes > 0)
+            {
+                unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader(usNextBlockSize, rgbHeader[unNext], sizeof(rgbHeader[unNext]));
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber + 1, unReturnValue);
+                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                    // Collect the pending response before giving up
+                    {
+                        unsigned int unResultReceive = TSS_TPM2_FieldUpgradeDataVendor_Receive();
+                        if (RC_SUCCESS != unResultReceive)
+                            LOGGING_WRITE_LEVEL1_FMT(L"Unexpected error calling TSS_TPM2_FieldUpgradeDataVendor_Receive: (0x%.8X)", unResultReceive);
+                    }
+                    break;
+                }
+            }
+
+            // Wait for the response of the current block
+            unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Receive();
+            if (DeviceManagement_IsTransientTpmWarning(unReturnValue) && unWarningRetry < DEVICE_MANAGEMENT_WARNING_RETRIES)
+            {
+                // The TPM did not process the block or suspended it, send it again unchanged
+                LOGGING_WRITE_LEVEL2_FMT(L"TPM warning 0x%.8X for block %d, sending it again (retry %d)", unReturnValue, unBlockNumber, unWarningRetry + 1);
+                Platform_Sleep(DEVICE_MANAGEMENT_WARNING_RETRY_DELAY << unWarningRetry);
+                unWarningRetry++;
+                unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Send(rgbHeader[unCurrent], pbFirmwareBlock, usBlockSize);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor_Send returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                    break;
+                }
+                continue;
+            }
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                break;
+            }
+
+            unRemainingBytes = unNextRemainingBytes;
+            unWarningRetry = 0;
+            FirmwareUpdate_TransferTelemetryBlock(usBlockSize);
+
+            // Set Progress (0% after _StartVendor, 1% after _ManifestVendor, 99% before _FinalizeVendor, 100% after _FinalizeVendor)
+            {
+                unsigned int unProgress = (PpsIfxFirmwareImage->unFirmwareSize - unRemainingBytes) * 96 / PpsIfxFirmwareImage->unFirmwareSize + 2;
+                if (*PpunCurrentProgress != unProgress)
+                {
+                    *PpunCurrentProgress = unProgress;
+                    PpsFirmwareUpdateData->fnProgressCallback(unProgress);
+                }
+            }
+
+            if (0 == unRemainingBytes)
+                break;
+
+            // Start transmitting the next block
+            unBlockNumber++;
+            unCurrent = unNext;
+            pbFirmwareBlock = pbNextBlock;
+            usBlockSize = usNextBlockSize;
+            unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Send(rgbHeader[unCurrent], pbFirmwareBlock, usBlockSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor_Send returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
+                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Abandon update and switch back to TPM operational mode.
+ *  @details    This function switch back to TPM operational mode by calling TPM2_FieldUpgradeAbandonVendor() command.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Return codes from TSS_TPM2_FieldUpgradeAbandonVendor().
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_AbandonUpdate()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Initialize size with zero since parameter is not used
+        s_sFieldUpgradeData.size = 0;
+
+        // Call abandon command (switching back to TPM operational mode)
+        unReturnValue = TSS_TPM2_FieldUpgradeAbandonVendor(&s_sFieldUpgradeData);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"TSS_TPM2_FieldUpgradeAbandonVendor returned an unexpected value.");
+            break;
+        }
+
+        // The transfer cannot be resumed anymore
+        FirmwareUpdate_Tpm20_WriteCheckpoint(NULL);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns information about the current state of TPM
+ *  @details
+ *
+ *  @param      PwszVersionName             A pointer to a null-terminated string representing the firmware image version name.
+ *  @param      PpunVersionNameSize         IN: Capacity of the PwszVersionName parameter in wide characters including zero termination
+ *                                          OUT: Length of written wide character string (excluding zero termination)
+ *  @param      PpsTpmState                 Receives TPM state.
+ *  @param      PpunRemainingUpdates        Receives the number of remaining updates or -1 in case the value could not be detected.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NO_IFX_TPM             The TPM is not manufactured by Infineon.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetImageInfo(
+    _Inout_bytecap_(*PpunVersionNameSize)   wchar_t*                    PwszVersionName,
+    _Inout_                                 unsigned int*               PpunVersionNameSize,
+    _Inout_                                 TPM_STATE *                 PpsTpmState,
+    _Inout_                                 unsigned int*               PpunRemainingUpdates)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unTpmFuCounter = REMAINING_UPDATES_UNAVAILABLE;
+
+        // Check parameters
+        if (NULL == PwszVersionName ||
+                NULL == PpunVersionNameSize ||
+                0 == *PpunVersionNameSize ||
+                NULL == PpsTpmState ||
+                NULL == PpunRemainingUpdates)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Bad parameter detected. PwszVersionName, PpunVersionNameSize, PpsTpmState or PpunRemainingUpdates is NULL or *PpunVersionNameSize is 0.");
+            break;
+        }
+
+        // Get TPM operation mode
+        unReturnValue = FirmwareUpdate_CalculateState(TRUE, PpsTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
+        if (PpsTpmState->attribs.infineon == 0)
+        {
+            unReturnValue = RC_E_NO_IFX_TPM;
+            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
+            break;
+        }
+
+        // Get firmware version string
+        {
+            wchar_t wszDummy[MAX_NAME];
+            unsigned int unDummySize = RG_LEN(wszDummy);
+            IGNORE_RETURN_VALUE(Platform_StringSetZero(wszDummy, RG_LEN(wszDummy)));
+            unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionString(PpsTpmState->attribs, PwszVersionName, PpunVersionNameSize, wszDummy, &unDummySize);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        // Read update counter from TPM
+        // Cannot be done after firmware update to TPM 2.0 when reboot is required
+        // Can be done for TPM2.0 firmware update loader when reboot is required (not in failure mode)
+        if ((!(PpsTpmState->attribs.tpm20 && PpsTpmState->attribs.tpm20restartRequired) &&
+                !PpsTpmState->attribs.tpm20InFailureMode &&
+                !(PpsTpmState->attribs.tpm12 && PpsTpmState->attribs.tpm12FieldUpgradeInfo2Failed)) ||
+                (PpsTpmState->attribs.tpmHasFULoader20 && !PpsTpmState->attribs.tpm20InFailureMode))
+        {
+            unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(PpsTpmState->attribs, NULL, &unTpmFuCounter);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        // Fill in number of remaining updates
+        *PpunRemainingUpdates = unTpmFuCounter;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Function to verify the integrity of a firmware image
+ *  @details    The function checks the CRC and the signature of the firmware image without sending any command to the TPM.
+ *              It can therefore be called while a TPM command is pending (e.g. between FirmwareUpdate_BeginTPM20Policy and
+ *              FirmwareUpdate_CompleteTPM20Policy). The outcome is remembered and reused by FirmwareUpdate_CheckImage.
+ *
+ *  @param      PrgbImage           Firmware image byte stream.
+ *  @param      PullImageSize       Size of firmware image byte stream.
+ *  @param      PpfIntact           TRUE in case the image is intact, FALSE otherwise.
+ *  @param      PpunErrorDetails    The error details in case the image is not intact:\n
+ *                                      RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
+ *                                      RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. It is invalid or NULL.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_VerifyImageIntegrity(
+    _In_bytecount_(PullImageSize)   BYTE*               PrgbImage,
+    _In_                            unsigned long long  PullImageSize,
+    _Out_                           BOOL*               PpfIntact,
+    _Out_                           unsigned int*       PpunErrorDetails)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    IfxFirmwareImage sIfxFirmwareImage;
+    BYTE rgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE];
+    BOOL fFirmwareDigestValid = FALSE;
+
+    Platform_MemorySet(&sIfxFirmwareImage, 0, sizeof(sIfxFirmwareImage));
+    Platform_MemorySet(rgbFirmwareDigest, 0, sizeof(rgbFirmwareDigest));
+
+    do
+    {
+        // Check parameters
+        if (NULL == PrgbImage || 0 == PullImageSize || PullImageSize > INT_MAX || NULL == PpfIntact || NULL == PpunErrorDetails)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbImage or PpfIntact or PpunErrorDetails is NULL or PullImageSize is invalid)");
+            break;
+        }
+        *PpfIntact = FALSE;
+        *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+
+        // Unmarshal the firmware image structure
+        {
+            BYTE* pbBuffer = PrgbImage;
+            int nBufferSize = (int)PullImageSize;
+            unReturnValue = FirmwareImage_Unmarshal(&sIfxFirmwareImage, &pbBuffer, &nBufferSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Failed to unmarshal the firmware image.");
+                *PpunErrorDetails = (RC_E_NEWER_TOOL_REQUIRED == unReturnValue) ? RC_E_NEWER_TOOL_REQUIRED : RC_E_CORRUPT_FW_IMAGE;
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+        }
+
+        unReturnValue = FirmwareUpdate_CheckImageIntegrity(PrgbImage, (int)PullImageSize, &sIfxFirmwareImage, PpunErrorDetails, rgbFirmwareDigest, &fFirmwareDigestValid);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        *PpfIntact = (RC_SUCCESS == *PpunErrorDetails);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Starts the CRC and digest calculation of a firmware image on an application processor
+ *  @details    The calculation runs while the caller talks to the TPM (e.g. FirmwareUpdate_CalculateState or
+ *              FirmwareUpdate_BeginTPM20Policy). The next integrity check of the same image waits for the result instead of
+ *              calculating it again. If no application processor is available or the image is already in the integrity
+ *              cache, nothing is started and the integrity check runs as before. The image must not be released before
+ *              FirmwareUpdate_WaitImageIntegrityCheck or an integrity check has been called.
+ *
+ *  @param      PrgbImage           Firmware image byte stream.
+ *  @param      PullImageSize       Size of firmware image byte stream.
+ */
+void
+FirmwareUpdate_StartImageIntegrityCheck(
+    _In_bytecount_(PullImageSize)   BYTE*               PrgbImage,
+    _In_                            unsigned long long  PullImageSize)
+{
+    do
+    {
+        IfxFirmwareImage sIfxFirmwareImage;
+        BYTE* pbBuffer = PrgbImage;
+        int nBufferSize = (int)PullImageSize;
+        unsigned int unFingerprint = 0;
+        unsigned int unReturnValue = RC_E_FAIL;
+        Platform_MemorySet(&sIfxFirmwareImage, 0, sizeof(sIfxFirmwareImage));
+
+        // Invalid images are rejected by the integrity check itself
+        if (NULL == PrgbImage || 0 == PullImageSize || PullImageSize > INT_MAX || s_sImageChecksumTask.fPending)
+            break;
+
+        // Nothing to calculate if the outcome of the integrity check is known already
+        unFingerprint = FirmwareUpdate_GetImageFingerprint(PrgbImage, PullImageSize);
+        if (s_sImageIntegrity.fValid &&
+                s_sImageIntegrity.pbImage == PrgbImage &&
+                s_sImageIntegrity.ullImageSize == PullImageSize &&
+                s_sImageIntegrity.unFingerprint == unFingerprint)
+            break;
+
+        // The offset of the firmware block is only known after unmarshalling
+        if (RC_SUCCESS != FirmwareImage_Unmarshal(&sIfxFirmwareImage, &pbBuffer, &nBufferSize))
+            break;
+
+        Platform_MemorySet(&s_sImageChecksumTask, 0, sizeof(s_sImageChecksumTask));
+        s_sImageChecksumTask.pbImage = PrgbImage;
+        s_sImageChecksumTask.ullImageSize = PullImageSize;
+        s_sImageChecksumTask.unFingerprint = unFingerprint;
+        FirmwareUpdate_GetImageChecksumRanges(
+            PrgbImage,
+            (int)PullImageSize,
+            &sIfxFirmwareImage,
+            &s_sImageChecksumTask.unCrcDataSize,
+            &s_sImageChecksumTask.unSignedDataSize,
+            &s_sImageChecksumTask.unFirmwareOffset,
+            &s_sImageChecksumTask.unFirmwareSize);
+        if (0 == s_sImageChecksumTask.unCrcDataSize)
+            break;
+
+        // The integrity check calculates the checksums itself if no application processor is available
+        unReturnValue = Platform_TaskStart(FirmwareUpdate_ImageChecksumTask, &s_sImageChecksumTask);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"Firmware image checksums are calculated on the boot processor (0x%.8X)", unReturnValue);
+            break;
+        }
+        s_sImageChecksumTask.fPending = TRUE;
+    }
+    WHILE_FALSE_END;
+}
+
+/**
+ *  @brief      Waits for the calculation started by FirmwareUpdate_StartImageIntegrityCheck
+ *  @details    Returns immediately if no calculation is running. The result is kept for the next integrity check.
+ */
+void
+FirmwareUpdate_WaitImageIntegrityCheck()
+{
+    if (!s_sImageChecksumTask.fPending)
+        return;
+
+    Platform_TaskWait();
+    s_sImageChecksumTask.fPending = FALSE;
+    s_sImageChecksumTask.fDone = TRUE;
+}
+
+/**
+ *  @brief      Look up a firmware image in the verified image cache
+ *  @details
+ *
+ *  @param      PrgbImage               Firmware image byte stream.
+ *  @param      PullImageSize           Size of firmware image byte stream.
+ *
+ *  @returns    Pointer to the cache entry or NULL if the image is not in the cache.
+ */
+static
+VERIFIED_IMAGE_CACHE*
+FirmwareUpdate_FindVerifiedImage(
+    _In_bytecount_(PullImageSize)   const BYTE*         PrgbImage,
+    _In_                            unsigned long long  PullImageSize)
+{
+    if (s_sVerifiedImage.fValid &&
+            s_sVerifiedImage.pbImage == PrgbImage &&
+            s_sVerifiedImage.ullImageSize == PullImageSize &&
+            s_sVerifiedImage.unFingerprint == FirmwareUpdate_GetImageFingerprint(PrgbImage, PullImageSize))
+        return &s_sVerifiedImage;
+
+    return NULL;
+}
+
+/**
+ *  @brief      Checks if the firmware image is valid for the TPM
+ *  @details    Performs integrity, consistency and content checks to determine if the given firmware image can be applied to the installed TPM.
+ *              The checks that depend on the image only (structure, CRC, signature and TPM family flags) run first, so a corrupt
+ *              or unsupported image is rejected without any command being sent to the TPM.
+ *
+ *  @param      PrgbImage                   Firmware image byte stream.
+ *  @param      PullImageSize               Size of firmware image byte stream.
+ *  @param      PpfValid                    TRUE in case the image is valid, FALSE otherwise.
+ *  @param      PpbfNewTpmFirmwareInfo      Pointer to a bit field to return info data for the new firmware image.
+ *  @param      PpunErrorDetails            Pointer to an unsigned int to return error details. Possible values are:\n
+ *                                              RC_E_FW_UPDATE_BLOCKED in case the field upgrade counter value has been exceeded.\n
+ *                                              RC_E_WRONG_FW_IMAGE in case the TPM is not updatable with the given image.\n
+ *                                              RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
+ *                                              RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.\n
+ *                                              RC_E_WRONG_DECRYPT_KEYS in case the TPM2.0 does not have decrypt keys matching to the firmware image.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM20_FAILURE_MODE     The TPM2.0 is in failure mode.
+ *  @retval     RC_E_RESTART_REQUIRED       In case a restart is required to get back to a functional TPM.
+ *  @retval     RC_E_NO_IFX_TPM             In case TPM vendor is not IFX.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+_Success_(return == 0)
+unsigned int
+FirmwareUpdate_CheckImage(
+    _In_bytecount_(PullImageSize)   BYTE *                           PrgbImage,
+    _In_                            unsigned long long               PullImageSize,
+    _Out_                           BOOL *                           PpfValid,
+    _Out_                           BITFIELD_NEW_TPM_FIRMWARE_INFO * PpbfNewTpmFirmwareInfo,
+    _Out_                           unsigned int*                    PpunErrorDetails)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        TPM_STATE sTpmState;
+        IfxFirmwareImage sIfxFirmwareImage;
+        IfxFirmwareImage sParsedFirmwareImage;
+        VERIFIED_IMAGE_CACHE* pCachedImage = NULL;
+        int nBufferSize = (int)PullImageSize;
+        BYTE* pbBuffer = PrgbImage;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+        Platform_MemorySet(&sIfxFirmwareImage, 0, sizeof(sIfxFirmwareImage));
+        Platform_MemorySet(&sParsedFirmwareImage, 0, sizeof(sParsedFirmwareImage));
+
+        // Check parameters
+        if (NULL == PrgbImage ||
+                0 == PullImageSize ||
+                NULL == PpfValid ||
+                NULL == PpbfNewTpmFirmwareInfo ||
+                NULL == PpunErrorDetails)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbImage or PpfValid or PpbfNewTpmFirmwareInfo is NULL or PullImageSize is zero)");
+            break;
+        }
+
+        // Initialize out parameters
+        *PpunErrorDetails = RC_E_FW_UPDATE_BLOCKED;
+        *PpfValid = FALSE;
+
+        Platform_MemorySet(PpbfNewTpmFirmwareInfo, 0, sizeof(BITFIELD_NEW_TPM_FIRMWARE_INFO));
+
+        // Validate the image on the host before talking to the TPM
+        if (PullImageSize > INT_MAX)
+        {
+            ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The size of the firmware image file is invalid");
+            unReturnValue = RC_SUCCESS;
+            *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+            break;
+        }
+
+        // Unmarshal the firmware image structure
+        unReturnValue = FirmwareImage_Unmarshal(&sIfxFirmwareImage, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Failed to unmarshal the firmware image.");
+            *PpunErrorDetails = (RC_E_NEWER_TOOL_REQUIRED == unReturnValue) ? RC_E_NEWER_TOOL_REQUIRED : RC_E_CORRUPT_FW_IMAGE;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        // Keep the parse result for the cache, the checks below work on a copy
+        sParsedFirmwareImage = sIfxFirmwareImage;
+
+        // Check the CRC and the signature of the firmware image. The outcome does not depend on the TPM state,
+        // so it is reused if the same image was checked before (e.g. by FirmwareUpdate_VerifyImageIntegrity).
+        {
+            unsigned int unIntegrityDetails = RC_E_CORRUPT_FW_IMAGE;
+            BYTE rgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE];
+            BOOL fFirmwareDigestValid = FALSE;
+            unReturnValue = FirmwareUpdate_CheckImageIntegrity(PrgbImage, (int)PullImageSize, &sIfxFirmwareImage, &unIntegrityDetails, rgbFirmwareDigest, &fFirmwareDigestValid);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            if (RC_SUCCESS != unIntegrityDetails)
+            {
+                LOGGING_WRITE_LEVEL3(L"Firmware image rejected before any TPM communication");
+                *PpunErrorDetails = unIntegrityDetails;
+                break;
+            }
+        }
+
+        // Source and target TPM family flags in the firmware image must indicate either TPM1.2 or TPM2.0
+        if ((sIfxFirmwareImage.bSourceTpmFamily != DEVICE_TYPE_TPM_12 && sIfxFirmwareImage.bSourceTpmFamily != DEVICE_TYPE_TPM_20) ||
+                (sIfxFirmwareImage.bTargetTpmFamily != DEVICE_TYPE_TPM_12 && sIfxFirmwareImage.bTargetTpmFamily != DEVICE_TYPE_TPM_20))
+        {
+            ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"The content of the firmware image file is inconsistent");
+            unReturnValue = RC_SUCCESS;
+            *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+            break;
+        }
+
+        // Get TPM operation mode
+        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
+        if (!sTpmState.attribs.infineon)
+        {
+            unReturnValue = RC_E_NO_IFX_TPM;
+            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
+            break;
+        }
+
+        // Cannot make a decision if restart is required.
+        if (sTpmState.attribs.tpm20restartRequired)
+        {
+            unReturnValue = RC_E_RESTART_REQUIRED;
+            ERROR_STORE(unReturnValue, L"A restart is required.");
+            *PpunErrorDetails = RC_E_WRONG_FW_IMAGE;
+            break;
+        }
+
+        // Cannot make a decision if TPM2.0 is in failure mode.
+        if (sTpmState.attribs.tpm20InFailureMode)
+        {
+            unReturnValue = RC_E_TPM20_FAILURE_MODE;
+            ERROR_STORE(unReturnValue, L"TPM2.0 is in failure mode.");
+            break;
+        }
+
+        // Reuse the outcome of the last verification of the same image if the TPM state has not changed since
+        pCachedImage = FirmwareUpdate_FindVerifiedImage(PrgbImage, PullImageSize);
+        if (NULL != pCachedImage && pCachedImage->unGeneration == DeviceManagement_GetTpmStateGeneration())
+        {
+            *PpfValid = pCachedImage->fImageValid;
+            *PpbfNewTpmFirmwareInfo = pCachedImage->bfNewTpmFirmwareInfo;
+            *PpunErrorDetails = pCachedImage->unErrorDetails;
+            LOGGING_WRITE_LEVEL3(L"Firmware image verification served from cache");
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+        s_sVerifiedImage.fValid = FALSE;
+
+        // Check if update is possible
+        nBufferSize = (int)PullImageSize;
+        unReturnValue = FirmwareUpdate_IsFirmwareUpdatable(sTpmState.attribs, PrgbImage, nBufferSize, &sIfxFirmwareImage, PpfValid, PpbfNewTpmFirmwareInfo, PpunErrorDetails);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Remember the outcome, take the generation afterwards since the checks may have sent commands to the TPM
+        s_sVerifiedImage.pbImage = PrgbImage;
+        s_sVerifiedImage.ullImageSize = PullImageSize;
+        s_sVerifiedImage.unFingerprint = FirmwareUpdate_GetImageFingerprint(PrgbImage, PullImageSize);
+        s_sVerifiedImage.unGeneration = DeviceManagement_GetTpmStateGeneration();
+        s_sVerifiedImage.sFirmwareImage = sParsedFirmwareImage;
+        // Keep the manifest digest for the start of the update, the manifest is selected again with the same key group id
+        IGNORE_RETURN_VALUE(Platform_MemoryCopy(s_sVerifiedImage.sFirmwareImage.rgbManifestDigest, sizeof(s_sVerifiedImage.sFirmwareImage.rgbManifestDigest), sIfxFirmwareImage.rgbManifestDigest, sizeof(sIfxFirmwareImage.rgbManifestDigest)));
+        s_sVerifiedImage.sFirmwareImage.pbManifestDigestBlock = sIfxFirmwareImage.pbManifestDigestBlock;
+        s_sVerifiedImage.fImageValid = *PpfValid;
+        s_sVerifiedImage.bfNewTpmFirmwareInfo = *PpbfNewTpmFirmwareInfo;
+        s_sVerifiedImage.unErrorDetails = *PpunErrorDetails;
+        FirmwareUpdate_EstimateUpdateDuration(sTpmState.attribs.tpmHasFULoader20, &sIfxFirmwareImage, &s_sVerifiedImage.sDurationEstimate);
+        if (*PpfValid)
+            LOGGING_WRITE_LEVEL3_FMT(L"Estimated update duration: %d ms (%d manifest and %d firmware blocks of %d bytes, %d us per block)",
+                                     s_sVerifiedImage.sDurationEstimate.unTotalMs, s_sVerifiedImage.sDurationEstimate.unManifestBlocks,
+                                     s_sVerifiedImage.sDurationEstimate.unFirmwareBlocks, s_sVerifiedImage.sDurationEstimate.unBlockSize,
+                                     s_sVerifiedImage.sDurationEstimate.unBlockLatencyUs);
+        s_sVerifiedImage.fValid = TRUE;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    // Do not return while the image is still read on an application processor
+    FirmwareUpdate_WaitImageIntegrityCheck();
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads the TPM state for the selection of a firmware image
+ *  @details    Determines the TPM state and the firmware version once for FirmwareUpdate_MatchImageHeader.
+ *
+ *  @param      PpsProbe                    Receives the TPM state.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. The parameter is NULL.
+ *  @retval     RC_E_NO_IFX_TPM             The TPM is not manufactured by Infineon.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_ProbeImageSelection(
+    _Out_   IMAGE_SELECTION_PROBE*  PpsProbe)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+        // Check parameters
+        if (NULL == PpsProbe)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsProbe is NULL)");
+            break;
+        }
+        Platform_MemorySet(PpsProbe, 0, sizeof(*PpsProbe));
+
+        unReturnValue = FirmwareUpdate_CalculateState(FALSE, &sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        if (!sTpmState.attribs.infineon)
+        {
+            unReturnValue = RC_E_NO_IFX_TPM;
+            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
+            break;
+        }
+        PpsProbe->attribs = sTpmState.attribs;
+
+        // The source versions are only checked in the same TPM states as in FirmwareUpdate_IsFirmwareUpdatable
+        if (sTpmState.attribs.tpmInOperationalMode || sTpmState.attribs.tpmHasFULoader20)
+        {
+            PpsProbe->unFirmwareVersionLength = RG_LEN(PpsProbe->wszFirmwareVersion);
+            PpsProbe->unFirmwareVersionShortLength = RG_LEN(PpsProbe->wszFirmwareVersionShort);
+            unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionString(
+                                sTpmState.attribs,
+                                PpsProbe->wszFirmwareVersion,
+                                &PpsProbe->unFirmwareVersionLength,
+                                PpsProbe->wszFirmwareVersionShort,
+                                &PpsProbe->unFirmwareVersionShortLength);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            PpsProbe->fVersionValid = TRUE;
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks if the header of a firmware image matches the TPM
+ *  @details    Only the header and the source version list of the image are parsed (FirmwareImage_Unmarshal). The CRC, the
+ *              digest and the signature are not verified and the TPM is not accessed, so the check is cheap enough to find
+ *              the applicable image among many candidates. The image must still be checked with FirmwareUpdate_CheckImage.
+ *
+ *  @param      PrgbImage                   Firmware image byte stream.
+ *  @param      PunImageSize                Size of firmware image byte stream.
+ *  @param      PpsProbe                    TPM state read by FirmwareUpdate_ProbeImageSelection.
+ *  @param      PpfMatch                    Receives TRUE if the image is meant for the TPM family, firmware loader and
+ *                                          firmware version of the TPM, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE       The header of the image cannot be parsed.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_MatchImageHeader(
+    _In_bytecount_(PunImageSize)    BYTE*                           PrgbImage,
+    _In_                            unsigned int                    PunImageSize,
+    _In_                            const IMAGE_SELECTION_PROBE*    PpsProbe,
+    _Out_                           BOOL*                           PpfMatch)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        IfxFirmwareImage sFirmwareImage;
+        BYTE* pbBuffer = PrgbImage;
+        int nBufferSize = (int)PunImageSize;
+        Platform_MemorySet(&sFirmwareImage, 0, sizeof(sFirmwareImage));
+
+        // Check parameters
+        if (NULL == PrgbImage || 0 == PunImageSize || PunImageSize > 0x7FFFFFFF || NULL == PpsProbe || NULL == PpfMatch)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbImage, PpsProbe or PpfMatch is NULL or PunImageSize is invalid)");
+            break;
+        }
+        *PpfMatch = FALSE;
+
+        unReturnValue = FirmwareImage_Unmarshal(&sFirmwareImage, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            break;
+        }
+        unReturnValue = RC_SUCCESS;
+
+        // The image must be meant for the TPM family
+        if ((PpsProbe->attribs.tpm20 || PpsProbe->attribs.tpmHasFULoader20) && DEVICE_TYPE_TPM_20 != sFirmwareImage.bSourceTpmFamily)
+            break;
+        if (PpsProbe->attribs.tpm12 && DEVICE_TYPE_TPM_12 != sFirmwareImage.bSourceTpmFamily)
+            break;
+
+        // Images with manifest data are applied by the TPM2.0 firmware loader only
+        if ((NULL != sFirmwareImage.rgbManifestData) != (PpsProbe->attribs.tpmHasFULoader20 ? TRUE : FALSE))
+            break;
+
+        // The firmware version of the TPM must be an allowed source version
+        if (PpsProbe->fVersionValid)
+        {
+            unReturnValue = FirmwareUpdate_IsSourceVersionAllowed(
+                                &sFirmwareImage,
+                                PpsProbe->wszFirmwareVersion,
+                                PpsProbe->unFirmwareVersionLength,
+                                PpsProbe->wszFirmwareVersionShort,
+                                PpsProbe->unFirmwareVersionShortLength,
+                                PpfMatch);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                *PpfMatch = FALSE;
+                unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            }
+            break;
+        }
+
+        *PpfMatch = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Starts the preparation of a policy session for TPM firmware.
+ *  @details    The function sets the primary policy of the platform hierarchy and sends the TPM2_StartAuthSession command
+ *              without waiting for the response. The caller can do work on the host (e.g. FirmwareUpdate_VerifyImageIntegrity)
+ *              while the TPM starts the session, but must not send other commands to the TPM before calling
+ *              FirmwareUpdate_CompleteTPM20Policy. FirmwareUpdate_CompleteTPM20Policy must only be called if this function
+ *              returned RC_SUCCESS.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_FAIL                           An unexpected error occurred.
+ *  @retval     RC_E_PLATFORM_AUTH_NOT_EMPTY        In case PlatformAuth is not the Empty Buffer.
+ *  @retval     RC_E_PLATFORM_HIERARCHY_DISABLED    In case platform hierarchy has been disabled.
+ *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_BeginTPM20Policy()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        TSS_TPM2B_NONCE sNonceCaller;
+
+        TSS_TPM2B_DIGEST sPolicyDigest;
+
+        // Authorization session area
+        TSS_AuthorizationCommandData sAuthSessionData;
+        TSS_AcknowledgmentResponseData sAckAuthSessionData;
+
+        Platform_MemorySet(&sNonceCaller, 0, sizeof(sNonceCaller));
+        Platform_MemorySet(&sPolicyDigest, 0, sizeof(sPolicyDigest));
+        Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
+        Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
+
+        sPolicyDigest.size = TSS_SHA256_DIGEST_SIZE;
+        unReturnValue = Platform_MemoryCopy(sPolicyDigest.buffer, sPolicyDigest.size, rgbTpm20FirmwareUpdatePolicyDigest, sPolicyDigest.size);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Platform_MemoryCopy returned an unexpected value while copying rgbTpm20FirmwareUpdatePolicyDigest.");
+            break;
+        }
+
+        // Call TPM2_SetPrimaryPolicy command
+        sAuthSessionData.authHandle = TSS_TPM_RS_PW;    // Use password based authorization session
+        sAuthSessionData.sessionAttributes.continueSession = 1;
+        // sAuthSessionData.hmac.size = 0;          // Due to current Empty Buffer platform AuthSecret
+        // sAuthSessionData.nonceCaller.size = 0;   // Due to password based authorization session
+
+        // PolicyDigest.buffer: return value of TPM2_PolicyDigest
+        unReturnValue = TSS_TPM2_SetPrimaryPolicy(TSS_TPM_RH_PLATFORM, &sAuthSessionData, &sPolicyDigest, TSS_TPM_ALG_SHA256, &sAckAuthSessionData);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        {
+            if ((TSS_TPM_RC_HIERARCHY | TSS_TPM_RC_1) == (unReturnValue ^ RC_TPM_MASK))
+            {
+                ERROR_STORE_FMT(RC_E_PLATFORM_HIERARCHY_DISABLED, L"TSS_TPM2_SetPrimaryPolicy returned that platform hierarchy is disabled. (0x%.8X)", unReturnValue);
+                unReturnValue = RC_E_PLATFORM_HIERARCHY_DISABLED;
+                break;
+            }
+            else if ((TSS_TPM_RC_BAD_AUTH | TSS_TPM_RC_S | TSS_TPM_RC_1) == (unReturnValue ^ RC_TPM_MASK))
+            {
+                ERROR_STORE_FMT(RC_E_PLATFORM_AUTH_NOT_EMPTY, L"TSS_TPM2_SetPrimaryPolicy returned that platformAuth is not the EmptyBuffer. (0x%.8X)", unReturnValue);
+                unReturnValue = RC_E_PLATFORM_AUTH_NOT_EMPTY;
+                break;
+            }
+            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_SetPrimaryPolicy");
+            break;
+        }
+
+        sNonceCaller.size = TSS_SHA256_DIGEST_SIZE;
+        unReturnValue = Crypt_GetRandom(sNonceCaller.size, sNonceCaller.buffer);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Error calling Crypt_GetRandom");
+            break;
+        }
+
+        {
+            // Start policy session, the response is received in FirmwareUpdate_CompleteTPM20Policy
+            TSS_TPM2B_ENCRYPTED_SECRET sEncSecretEmpty;
+            TSS_TPMT_SYM_DEF sSymDefEmpty;
+            Platform_MemorySet(&sEncSecretEmpty, 0, sizeof(sEncSecretEmpty));
+            Platform_MemorySet(&sSymDefEmpty, 0, sizeof(sSymDefEmpty));
+
+            sSymDefEmpty.algorithm = TSS_TPM_ALG_NULL;
+            unReturnValue = TSS_TPM2_StartAuthSession_Send(TSS_TPM_RH_NULL,
+                            // Bind must be NULL, otherwise we'd have
+                            // to calculate AuthSessionData.hmac !!
+                            TSS_TPM_RH_NULL,
+                            &sNonceCaller, &sEncSecretEmpty,
+                            TSS_TPM_SE_POLICY, &sSymDefEmpty, TSS_TPM_ALG_SHA256);
+            if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_StartAuthSession_Send");
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Completes the preparation of a policy session for TPM firmware.
+ *  @details    The function receives the response of the TPM2_StartAuthSession command sent by FirmwareUpdate_BeginTPM20Policy
+ *              and updates the policy session for TPM Firmware Update. If PfDiscard is TRUE (e.g. the firmware image turned
+ *              out to be invalid) the started session is flushed instead. A completed session is kept for a retry, see
+ *              FirmwareUpdate_ReuseTPM20Policy.
+ *
+ *  @param      PfDiscard                           TRUE to flush the started session instead of updating it.
+ *  @param      PphPolicySession                    Pointer to session handle that will be filled in by this method (0 if discarded).
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
+ *  @retval     RC_E_FAIL                           An unexpected error occurred.
+ *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_CompleteTPM20Policy(
+    _In_    BOOL                        PfDiscard,
+    _Out_   TSS_TPMI_SH_AUTH_SESSION*   PphPolicySession)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    TSS_TPMI_SH_AUTH_SESSION hPolicySession = 0;
+    TSS_TPM2B_NONCE sNonceTpm;
+
+    Platform_MemorySet(&sNonceTpm, 0, sizeof(sNonceTpm));
+
+    do
+    {
+        // Receive the started policy session in any case to complete the pending command
+        unReturnValue = TSS_TPM2_StartAuthSession_Receive(&hPolicySession, &sNonceTpm);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        {
+            hPolicySession = 0;
+            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_StartAuthSession_Receive");
+            break;
+        }
+
+        // Check parameters
+        if (NULL == PphPolicySession)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PphPolicySession is NULL)");
+            break;
+        }
+        *PphPolicySession = 0;
+
+        if (PfDiscard)
+        {
+            IGNORE_RETURN_VALUE(TSS_TPM2_FlushContext(hPolicySession));
+            hPolicySession = 0;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        {
+            // Update policy session to include platformAuth
+            TSS_AuthorizationCommandData sAuthSessionData;
+            TSS_AcknowledgmentResponseData sAckAuthSessionData;
+            TSS_TPM2B_DIGEST sDigestEmpty;
+            TSS_TPM2B_NONCE sPolicyRef;
+            TSS_TPMT_TK_AUTH sPolicyTicket;
+            TSS_TPM2B_TIMEOUT sTimeout;
+            unsigned int unPlatformValue = Platform_SwapBytes32(TSS_TPM_RH_PLATFORM);
+
+            Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
+            Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
+            Platform_MemorySet(&sDigestEmpty, 0, sizeof(sDigestEmpty));
+            Platform_MemorySet(&sPolicyRef, 0, sizeof(sPolicyRef));
+            Platform_MemorySet(&sPolicyTicket, 0, sizeof(sPolicyTicket));
+            Platform_MemorySet(&sTimeout, 0, sizeof(sTimeout));
+
+            sAuthSessionData.authHandle = TSS_TPM_RS_PW;    // Use password based authorization session
+            sAuthSessionData.sessionAttributes.continueSession = 1;
+
+            sPolicyRef.size = sizeof(unsigned int);
+            unReturnValue = Platform_MemoryCopy(sPolicyRef.buffer, sPolicyRef.size, (const void*) &unPlatformValue, sizeof(unPlatformValue));
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Unexpected return value from function call Platform_MemoryCopy");
                 break;
             }
 
-            if (TSS_TPM_DA_STATE_ACTIVE == sDaInfo.state)
+            unReturnValue = TSS_TPM2_PolicySecret(TSS_TPM_RH_PLATFORM, &sAuthSessionData, hPolicySession, &sNonceTpm, &sDigestEmpty, &sPolicyRef, 0, &sTimeout, &sPolicyTicket, &sAckAuthSessionData);
+            if (TSS_TPM_RC_SUCCESS != unReturnValue)
             {
-                unReturnValue = RC_E_TPM12_DA_ACTIVE;
-                ERROR_STORE(unReturnValue, L"TPM1.2 is in a dictionary attack mode.");
+                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_PolicySecret");
                 break;
             }
+        }
+
+        // Update policy session to include command TPM2_FieldUpgradeStartVendor
+        unReturnValue = TSS_TPM2_PolicyCommandCode(hPolicySession, TPM2_CC_FieldUpgradeStartVendor);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_PolicyCommandCode");
+            break;
+        }
+
+        // Keep the session for a retry, see FirmwareUpdate_ReuseTPM20Policy
+        s_hRetainedPolicySession = hPolicySession;
+        *PphPolicySession = hPolicySession;
+    }
+    WHILE_FALSE_END;
+
+    // Try to close policy session in case of errors (only if session has already been started)
+    if (RC_SUCCESS != unReturnValue && 0 != hPolicySession)
+        IGNORE_RETURN_VALUE(TSS_TPM2_FlushContext(hPolicySession));
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reuses the policy session kept from a previous firmware update attempt
+ *  @details    A policy session completed by FirmwareUpdate_CompleteTPM20Policy is kept until a started firmware update
+ *              consumes it or it is flushed with FirmwareUpdate_FlushTPM20Policy. Instead of the five commands of a new setup, the kept session is checked
+ *              with a single TPM2_PolicyGetDigest: it is reused if the TPM still holds it with the firmware update policy
+ *              digest. Otherwise it is forgotten without flushing it, since after a TPM restart the handle may belong to
+ *              another session.
+ *              If *PphPolicySession is 0 it receives the kept session or stays 0 if there is none or the check fails. If it
+ *              is the kept session it is checked and set to 0 if the check fails. Any other session handle (e.g. provided by
+ *              the caller of the driver) is left unchanged.
+ *
+ *  @param      PphPolicySession                    In: 0 or a policy session handle, Out: the session handle to use or 0.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_ReuseTPM20Policy(
+    _Inout_ TSS_TPMI_SH_AUTH_SESSION*   PphPolicySession)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+
+    do
+    {
+        TSS_TPM2B_DIGEST sPolicyDigest;
+        Platform_MemorySet(&sPolicyDigest, 0, sizeof(sPolicyDigest));
+
+        // Check parameters
+        if (NULL == PphPolicySession)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PphPolicySession is NULL)");
+            break;
+        }
+
+        if (0 != *PphPolicySession && s_hRetainedPolicySession != *PphPolicySession)
+            break;
+        *PphPolicySession = 0;
+        if (0 == s_hRetainedPolicySession)
+            break;
+
+        if (RC_SUCCESS == TSS_TPM2_PolicyGetDigest(s_hRetainedPolicySession, &sPolicyDigest) &&
+                sizeof(rgbTpm20FirmwareUpdatePolicyDigest) == sPolicyDigest.size &&
+                0 == Platform_MemoryCompare(sPolicyDigest.buffer, rgbTpm20FirmwareUpdatePolicyDigest, sPolicyDigest.size))
+        {
+            LOGGING_WRITE_LEVEL3_FMT(L"Reusing policy session 0x%.8X", s_hRetainedPolicySession);
+            *PphPolicySession = s_hRetainedPolicySession;
+            break;
+        }
+
+        LOGGING_WRITE_LEVEL3_FMT(L"Policy session 0x%.8X cannot be reused, a new one is started", s_hRetainedPolicySession);
+        s_hRetainedPolicySession = 0;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Flushes a policy session
+ *  @details    Errors are ignored. If the session was kept for a retry by FirmwareUpdate_CompleteTPM20Policy it is not
+ *              reused anymore.
+ *
+ *  @param      PhPolicySession                     Policy session handle.
+ */
+void
+FirmwareUpdate_FlushTPM20Policy(
+    _In_    TSS_TPMI_SH_AUTH_SESSION    PhPolicySession)
+{
+    if (s_hRetainedPolicySession == PhPolicySession)
+        s_hRetainedPolicySession = 0;
+    IGNORE_RETURN_VALUE(TSS_TPM2_FlushContext(PhPolicySession));
+}
+
+/**
+ *  @brief      Returns the policy session kept for a retry of the firmware update
+ *  @details    The function does not access the TPM. The session is kept in a TPM session slot until it is flushed with
+ *              FirmwareUpdate_FlushTPM20Policy, which the caller must do before it hands the TPM over (e.g. before the OS
+ *              boots or the tool exits).
+ *
+ *  @returns    Policy session handle or 0 if no session is kept.
+ */
+TSS_TPMI_SH_AUTH_SESSION
+FirmwareUpdate_GetRetainedTPM20Policy()
+{
+    return s_hRetainedPolicySession;
+}
+
+/**
+ *  @brief      Prepares a policy session for TPM firmware.
+ *  @details    The function prepares a policy session for TPM Firmware Update. A valid session kept from a previous
+ *              attempt is reused, see FirmwareUpdate_ReuseTPM20Policy.
+ *
+ *  @param      PphPolicySession                    Pointer to session handle that will be filled in by this method.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
+ *  @retval     RC_E_FAIL                           An unexpected error occurred.
+ *  @retval     RC_E_PLATFORM_AUTH_NOT_EMPTY        In case PlatformAuth is not the Empty Buffer.
+ *  @retval     RC_E_PLATFORM_HIERARCHY_DISABLED    In case platform hierarchy has been disabled.
+ *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_PrepareTPM20Policy(
+    _Out_ TSS_TPMI_SH_AUTH_SESSION * PphPolicySession)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PphPolicySession)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PphPolicySession is NULL)");
+            break;
+        }
+        *PphPolicySession = 0;
+
+        // A session kept from a previous attempt saves the setup
+        unReturnValue = FirmwareUpdate_ReuseTPM20Policy(PphPolicySession);
+        if (RC_SUCCESS != unReturnValue || 0 != *PphPolicySession)
+            break;
+
+        unReturnValue = FirmwareUpdate_BeginTPM20Policy();
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = FirmwareUpdate_CompleteTPM20Policy(FALSE, PphPolicySession);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Function to issue TPM_FieldUpgrade_Start
+ *  @details    This function initiates TPM Firmware Update via the TPM_FieldUpgrade_Start command depending on the current TPM Operation mode.
+ *
+ *  @param      PbfTpmAttributes        The current TPM operation mode.
+ *  @param      PpsIfxFirmwareImage     Pointer to structure containing the firmware image.
+ *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_TPM12_MISSING_OWNERAUTH    The TPM has an owner but TPM Owner authorization was not provided (TPM1.2 only).
+ *  @retval     RC_E_TPM12_NO_OWNER             The TPM does not have an owner but TPM Owner authorization was provided (TPM1.2 only).
+ *  @retval     RC_E_FAIL                       TPM connection or command error.
+ *  @retval     ...                             Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_Start(
+    _In_    BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
+    _In_    const IfxFirmwareImage * const      PpsIfxFirmwareImage,
+    _In_    const IfxFirmwareUpdateData * const PpsFirmwareUpdateData)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    BOOL fUpdateStarted = FALSE;
+
+    // Check if firmware update was already started
+    if (!PbfTpmAttributes.tpmInOperationalMode)
+    {
+        unReturnValue = RC_SUCCESS; // Continue firmware update
+        PpsFirmwareUpdateData->fnProgressCallback(0);
+    }
+    else if (PbfTpmAttributes.tpm20 && PbfTpmAttributes.infineon && !PbfTpmAttributes.tpm20restartRequired)
+    {
+        unReturnValue = FirmwareUpdate_Start_Tpm20(
+                            PbfTpmAttributes,
+                            PpsIfxFirmwareImage->rgbPolicyParameterBlock,
+                            PpsIfxFirmwareImage->usPolicyParameterBlockSize,
+                            PpsIfxFirmwareImage->pbManifestDigestBlock == PpsIfxFirmwareImage->rgbPolicyParameterBlock ? PpsIfxFirmwareImage->rgbManifestDigest : NULL,
+                            PpsFirmwareUpdateData->unSessionHandle,
+                            PpsFirmwareUpdateData->fnProgressCallback);
+        fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+    }
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+    else if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.infineon && !PbfTpmAttributes.unsupportedChip)
+    {
+        if (PbfTpmAttributes.tpm12owner)
+        {
+            if (!PpsFirmwareUpdateData->fOwnerAuthProvided)
+            {
+                unReturnValue = RC_E_TPM12_MISSING_OWNERAUTH;
+                ERROR_STORE(unReturnValue, L"TPM1.2 has an owner but TPM Owner authorization was not provided.");
+            }
+            else
+            {
+                unReturnValue = FirmwareUpdate_Start_Tpm12(
+                                    PbfTpmAttributes,
+                                    PpsIfxFirmwareImage->rgbPolicyParameterBlock,
+                                    PpsIfxFirmwareImage->usPolicyParameterBlockSize,
+                                    PpsFirmwareUpdateData->rgbOwnerAuthHash,
+                                    PpsFirmwareUpdateData->fOwnerAuthVerified,
+                                    PpsFirmwareUpdateData->fnProgressCallback);
+                fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+            }
+        }
+        else
+        {
+            if (PpsFirmwareUpdateData->fOwnerAuthProvided)
+            {
+                unReturnValue = RC_E_TPM12_NO_OWNER;
+                ERROR_STORE(unReturnValue, L"TPM1.2 does not have an owner but TPM Owner authorization was provided.");
+            }
+            else
+            {
+                unReturnValue = FirmwareUpdate_Start_Tpm12(
+                                    PbfTpmAttributes,
+                                    PpsIfxFirmwareImage->rgbPolicyParameterBlock,
+                                    PpsIfxFirmwareImage->usPolicyParameterBlockSize,
+                                    PpsFirmwareUpdateData->rgbOwnerAuthHash,
+                                    PpsFirmwareUpdateData->fOwnerAuthVerified,
+                                    PpsFirmwareUpdateData->fnProgressCallback);
+                fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+            }
+        }
+    }
+#endif
+    else
+    {
+        ERROR_STORE_FMT(unReturnValue, L"Error: Unexpected TPM state attributes were recognized. (Mode: 0x%.8X)", PbfTpmAttributes);
+    }
 
-            // Check TPM Owner authorization (except for disabled/deactivated TPM)
-            unReturnValue = FirmwareUpdate_CheckOwnerAuthorization(PrgbOwnerAuthHash);
+    // Invoke the callback function if firmware update was started and TPM is about to switch to boot loader mode.
+    if (fUpdateStarted && NULL != PpsFirmwareUpdateData->fnUpdateStartedCallback)
+    {
+        PpsFirmwareUpdateData->fnUpdateStartedCallback();
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Progress callback of the firmware update engine
+ *  @details    Records the progress for FirmwareUpdate_PollUpdate and forwards it to the progress callback of the caller.
+ *
+ *  @param      PullCompletion      Completion in percent.
+ *
+ *  @returns    Always 0.
+ */
+static
+unsigned long long
+IFXAPI
+FirmwareUpdate_Engine_Progress(
+    _In_    unsigned long long  PullCompletion)
+{
+    s_sUpdateEngine.sStatus.unProgress = (unsigned int)PullCompletion;
+    if (NULL != s_sUpdateEngine.fnProgressCallback)
+        IGNORE_RETURN_VALUE(s_sUpdateEngine.fnProgressCallback(PullCompletion));
+    return 0;
+}
+
+/**
+ *  @brief      Switches the state of the firmware update engine
+ *  @details    The phase timing follows the state.
+ *
+ *  @param      PunState            New state (UPDATE_STATE_IDLE, ...).
+ */
+static
+void
+FirmwareUpdate_Engine_SetState(
+    _In_    unsigned int    PunState)
+{
+    // Phase measured in each state, indexed by UPDATE_STATE_IDLE, ...
+    static const unsigned int s_rgunStatePhase[] =
+    {
+        UPDATE_PHASE_NONE, UPDATE_PHASE_VERIFY, UPDATE_PHASE_STATE, UPDATE_PHASE_POLICY, UPDATE_PHASE_START,
+        UPDATE_PHASE_BOOT_LOADER, UPDATE_PHASE_MANIFEST, UPDATE_PHASE_FIRMWARE, UPDATE_PHASE_FINALIZE,
+        UPDATE_PHASE_FINALIZE, UPDATE_PHASE_NONE
+    };
+
+    s_sUpdateEngine.sStatus.unState = PunState;
+    if (PunState < RG_LEN(s_rgunStatePhase))
+        FirmwareUpdate_PhaseTimingSwitch(s_rgunStatePhase[PunState]);
+}
+
+/**
+ *  @brief      Enters a state of the firmware update engine that waits for a TPM2.0 operation mode switch
+ *  @details    The TPM is probed for the first time after TPM20_FU_PROBE_INTERVAL milliseconds to give it a moment to start
+ *              the mode switch.
+ *
+ *  @param      PunState            UPDATE_STATE_WAIT_BOOT_LOADER or UPDATE_STATE_WAIT_FINALIZE.
+ */
+static
+void
+FirmwareUpdate_Engine_SetWaitState(
+    _In_    unsigned int    PunState)
+{
+    FirmwareUpdate_Engine_SetState(PunState);
+    s_sUpdateEngine.fModeRead = FALSE;
+    s_sUpdateEngine.ullWaitStartTicks = Platform_GetTicks();
+    s_sUpdateEngine.unWaitedMs = TPM20_FU_PROBE_INTERVAL;
+    s_sUpdateEngine.sStatus.unNextPollMs = TPM20_FU_PROBE_INTERVAL;
+}
+
+/**
+ *  @brief      Records the firmware update of the engine in the firmware update history
+ *  @details    The oldest entry of the history is replaced once UPDATE_HISTORY_SIZE attempts are recorded. A failure to
+ *              write the history is logged only, it does not change the result of the firmware update.
+ *
+ *  @param      PunResult           Result of the firmware update.
+ *  @param      PunLastState        Engine state in which the firmware update ended.
+ */
+static
+void
+FirmwareUpdate_Engine_RecordHistory(
+    _In_    unsigned int    PunResult,
+    _In_    unsigned int    PunLastState)
+{
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+    UPDATE_HISTORY sHistory;
+    UPDATE_HISTORY_ENTRY* pEntry = NULL;
+    unsigned int unCapacity = 0;
+    unsigned int unIndex = 0;
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    if (RC_SUCCESS != FirmwareUpdate_GetUpdateHistory(&sHistory))
+        return;
+
+    pEntry = &sHistory.rgsEntries[sHistory.unCount % UPDATE_HISTORY_SIZE];
+    Platform_MemorySet(pEntry, 0, sizeof(*pEntry));
+    sHistory.unCount++;
+    pEntry->unSequence = sHistory.unCount;
+    pEntry->unResult = PunResult;
+    pEntry->unLastState = PunLastState;
+    pEntry->unImageSize = pEngine->sUpdateData.unFirmwareImageSize;
+    pEntry->unFingerprint = FirmwareUpdate_GetImageFingerprint(pEngine->sUpdateData.rgbFirmwareImage, pEngine->sUpdateData.unFirmwareImageSize);
+    pEntry->unBlockCount = s_sTransferTelemetry.unBlocksAcknowledged;
+    pEntry->unBlockRetries = pEngine->unBlockRetries;
+    for (unIndex = 0; unIndex < UPDATE_PHASE_COUNT; unIndex++)
+        pEntry->rgunPhaseMs[unIndex] = (unsigned int)MIN(s_sPhaseTiming.rgullPhaseUs[unIndex] / 1000, 0xFFFFFFFF);
+
+    unCapacity = RG_LEN(pEntry->wszSourceVersion);
+    if (0 != pEngine->wszSourceVersion[0] && RC_SUCCESS != Platform_StringCopy(pEntry->wszSourceVersion, &unCapacity, pEngine->wszSourceVersion))
+        Platform_MemorySet(pEntry->wszSourceVersion, 0, sizeof(pEntry->wszSourceVersion));
+    unCapacity = RG_LEN(pEntry->wszTargetVersion);
+    if (0 != pEngine->sFirmwareImage.wszTargetVersion[0] && RC_SUCCESS != Platform_StringCopy(pEntry->wszTargetVersion, &unCapacity, pEngine->sFirmwareImage.wszTargetVersion))
+        Platform_MemorySet(pEntry->wszTargetVersion, 0, sizeof(pEntry->wszTargetVersion));
+
+    unReturnValue = Platform_NvStoreWrite(UPDATE_HISTORY_NAME, &sHistory, sizeof(sHistory));
+    if (RC_SUCCESS != unReturnValue)
+        LOGGING_WRITE_LEVEL2_FMT(L"Platform_NvStoreWrite(%ls) failed (0x%.8X).", UPDATE_HISTORY_NAME, unReturnValue);
+}
+
+/**
+ *  @brief      Ends the firmware update of the engine
+ *  @details    A policy session prepared by the engine is closed if the firmware update has not been started with it.
+ *              The attempt is recorded in the firmware update history.
+ *
+ *  @param      PunResult           Result of the firmware update.
+ */
+static
+void
+FirmwareUpdate_Engine_Complete(
+    _In_    unsigned int    PunResult)
+{
+    unsigned int unLastState = UPDATE_STATE_IDLE;
+
+    // The firmware transfer is over
+    s_sTransferTelemetry.fActive = FALSE;
+    DeviceManagement_StallDetectorStop();
+
+    if (s_sUpdateEngine.fOwnPolicySession && !s_sUpdateEngine.fStarted)
+        FirmwareUpdate_FlushTPM20Policy(s_sUpdateEngine.sUpdateData.unSessionHandle);
+    s_sUpdateEngine.fOwnPolicySession = FALSE;
+
+    // The new firmware (or the firmware loader) starts with its own platform hierarchy state
+    if (s_sUpdateEngine.fStarted)
+        s_sPlatformHierarchy.fValid = FALSE;
+
+    s_sUpdateEngine.sStatus.unResult = PunResult;
+    s_sUpdateEngine.sStatus.unNextPollMs = 0;
+    unLastState = s_sUpdateEngine.sStatus.unState;
+    FirmwareUpdate_Engine_SetState(UPDATE_STATE_DONE);
+    FirmwareUpdate_Engine_RecordHistory(PunResult, RC_SUCCESS == PunResult ? UPDATE_STATE_DONE : unLastState);
+}
+
+/**
+ *  @brief      Ends the firmware data transfer of the engine
+ *  @details    The engine waits for the TPM2.0 to switch to the mode before finalize next.
+ */
+static
+void
+FirmwareUpdate_Engine_EndData()
+{
+    // The firmware transfer is over
+    s_sTransferTelemetry.fActive = FALSE;
+    DeviceManagement_StallDetectorStop();
+
+    // Set Progress to 99%
+    s_sUpdateEngine.sUpdateData.fnProgressCallback(99);
+    FirmwareUpdate_Engine_SetWaitState(UPDATE_STATE_WAIT_FINALIZE);
+}
+
+/**
+ *  @brief      Begins the firmware data transfer of the engine
+ *  @details    The transfer is skipped if the TPM2.0 has received all firmware data already.
+ */
+static
+void
+FirmwareUpdate_Engine_BeginData()
+{
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+
+    // Set Progress to 1% after manifest vendor
+    pEngine->sUpdateData.fnProgressCallback(1);
+    FirmwareUpdate_Engine_SetState(UPDATE_STATE_DATA);
+    FirmwareUpdate_TransferTelemetryStart(pEngine->sFirmwareImage.unFirmwareSize);
+
+    // Detect a stalled firmware block long before the maximum duration of TPM2_FieldUpgradeDataVendor elapses
+    DeviceManagement_StallDetectorStart(TPM2_CC_FieldUpgradeDataVendor);
+
+    pEngine->unMaxBlockSize = FirmwareUpdate_Tpm20_GetMaxBlockSize(TPM2_FU_DATA_VENDOR_HEADER_SIZE);
+    pEngine->sCheckpoint.unBlockSize = pEngine->unMaxBlockSize;
+    FirmwareUpdate_Tpm20_WriteCheckpoint(&pEngine->sCheckpoint);
+    pEngine->unOffset = 0;
+    pEngine->unBlockNumber = 1;
+
+    // Check if firmware blocks must be send
+    if (OM_FU_BEFORE_FINALIZE == pEngine->bOperationMode || OM_RE_BEFORE_FINALIZE == pEngine->bOperationMode || 0 == pEngine->sFirmwareImage.unFirmwareSize)
+        FirmwareUpdate_Engine_EndData();
+}
+
+/**
+ *  @brief      Begins the manifest transfer of the engine
+ *  @details    Looks for the checkpoint of an interrupted transfer of the same image. The manifest is skipped if the TPM2.0
+ *              has received all firmware data already.
+ */
+static
+void
+FirmwareUpdate_Engine_BeginManifest()
+{
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+    FIRMWARE_TRANSFER_CHECKPOINT sPreviousCheckpoint;
+    unsigned int unCheckpointSize = sizeof(sPreviousCheckpoint);
+    Platform_MemorySet(&sPreviousCheckpoint, 0, sizeof(sPreviousCheckpoint));
+
+    FirmwareUpdate_Engine_SetState(UPDATE_STATE_MANIFEST);
+
+    // Look for the checkpoint of an interrupted transfer of the same image
+    pEngine->sCheckpoint.unFingerprint = FirmwareUpdate_GetImageFingerprint(pEngine->sUpdateData.rgbFirmwareImage, pEngine->sUpdateData.unFirmwareImageSize);
+    pEngine->sCheckpoint.unImageSize = pEngine->sUpdateData.unFirmwareImageSize;
+    pEngine->sCheckpoint.unInstance = DeviceManagement_GetSelectedInstance();
+    if (RC_SUCCESS == Platform_NvStoreRead(TPM20_FU_CHECKPOINT_NAME, &sPreviousCheckpoint, &unCheckpointSize) &&
+            sizeof(sPreviousCheckpoint) == unCheckpointSize &&
+            pEngine->sCheckpoint.unInstance == sPreviousCheckpoint.unInstance &&
+            pEngine->sCheckpoint.unFingerprint == sPreviousCheckpoint.unFingerprint && pEngine->sCheckpoint.unImageSize == sPreviousCheckpoint.unImageSize)
+    {
+        // The boot loader accepts the firmware data only in sequence after the manifest and does not report the last
+        // block it received. The transfer restarts with the manifest, the field upgrade counter is not decremented again.
+        LOGGING_WRITE_LEVEL1_FMT(L"Resuming an interrupted transfer of this firmware image (block size %d). Operation mode: 0x%.2X", sPreviousCheckpoint.unBlockSize, pEngine->bOperationMode);
+    }
+
+    // Check if manifest must be send
+    if (OM_FU_BEFORE_FINALIZE == pEngine->bOperationMode || OM_RE_BEFORE_FINALIZE == pEngine->bOperationMode || 0 == pEngine->sFirmwareImage.usPolicyParameterBlockSize)
+    {
+        FirmwareUpdate_Engine_BeginData();
+        return;
+    }
+
+    // Send the manifest to the TPM block-by-block in chunks of the largest size the TPM accepts
+    pEngine->unMaxBlockSize = FirmwareUpdate_Tpm20_GetMaxBlockSize(TPM2_FU_MANIFEST_VENDOR_HEADER_SIZE);
+    pEngine->unOffset = 0;
+    pEngine->unBlockNumber = 1;
+}
+
+/**
+ *  @brief      Engine step UPDATE_STATE_VERIFY
+ *  @details    Checks the firmware image if requested and parses it. The parse result of FirmwareUpdate_CheckImage is reused.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE           Policy parameter block is corrupt and/or cannot be unmarshalled.
+ *  @retval     ...                             Error codes from called functions.
+ */
+static
+unsigned int
+FirmwareUpdate_Engine_Verify()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+
+    do
+    {
+        VERIFIED_IMAGE_CACHE* pCachedImage = NULL;
+        int nBufferSize = (int)pEngine->sUpdateData.unFirmwareImageSize;
+        BYTE* pbBuffer = pEngine->sUpdateData.rgbFirmwareImage;
+
+        if (pEngine->fPrepare)
+        {
+            BOOL fValid = FALSE;
+            BITFIELD_NEW_TPM_FIRMWARE_INFO bfNewTpmFirmwareInfo;
+            unsigned int unErrorDetails = 0;
+            Platform_MemorySet(&bfNewTpmFirmwareInfo, 0, sizeof(bfNewTpmFirmwareInfo));
+
+            unReturnValue = FirmwareUpdate_CheckImage(pEngine->sUpdateData.rgbFirmwareImage, pEngine->sUpdateData.unFirmwareImageSize, &fValid, &bfNewTpmFirmwareInfo, &unErrorDetails);
             if (RC_SUCCESS != unReturnValue)
+                break;
+            if (!fValid)
             {
-                if ((TSS_TPM_DEACTIVATED == (unReturnValue ^ RC_TPM_MASK)) || (TSS_TPM_DISABLED == (unReturnValue ^ RC_TPM_MASK)))
-                {
-                    // In disabled and/or deactivated state TPM Owner authorization may not be checkable prior to first TPM_FieldUpgrade request
-                }
-                else
-                {
-                    if (TSS_TPM_AUTHFAIL == (unReturnValue ^ RC_TPM_MASK))
-                    {
-                        unReturnValue = RC_E_TPM12_INVALID_OWNERAUTH;
-                        ERROR_STORE(unReturnValue, L"TPM1.2 Owner authentication is incorrect.");
-                    }
-                    else
-                    {
-                        ERROR_STORE(unReturnValue, L"TPM1.2 Owner authentication failed.");
-                        unReturnValue = RC_E_FAIL;
-                    }
-                    break;
-                }
+                unReturnValue = unErrorDetails;
+                ERROR_STORE(unReturnValue, L"The firmware image is not valid for the TPM.");
+                break;
             }
+        }
 
-            // Start OIAP session for TPM Owner authorized firmware update.
-            unReturnValue = TSS_TPM_OIAP(&unAuthHandle, &sNonceEven);
+        // Reuse the parse result of FirmwareUpdate_CheckImage, the image is consumed by the update in any case
+        pCachedImage = FirmwareUpdate_FindVerifiedImage(pEngine->sUpdateData.rgbFirmwareImage, pEngine->sUpdateData.unFirmwareImageSize);
+        s_sVerifiedImage.fValid = FALSE;
+        if (NULL != pCachedImage)
+            pEngine->sFirmwareImage = pCachedImage->sFirmwareImage;
+        else
+        {
+            // Unmarshal the firmware image structure
+            unReturnValue = FirmwareImage_Unmarshal(&pEngine->sFirmwareImage, &pbBuffer, &nBufferSize);
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"TSS_TPM_OIAP returned an unexpected value.");
+                ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"Firmware image cannot be parsed. (0x%.8X)");
+                unReturnValue = RC_E_CORRUPT_FW_IMAGE;
                 break;
             }
-
-            pbOwnerAuth = (BYTE*)PrgbOwnerAuthHash;
         }
 
-        unReturnValue = TSS_TPM_FieldUpgradeStart(PrgbPolicyParameterBlock, PusPolicyParameterBlockSize, pbOwnerAuth, unAuthHandle, &sNonceEven);
-        if (RC_SUCCESS != unReturnValue)
+        FirmwareUpdate_Engine_SetState(UPDATE_STATE_PROBE);
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks the link to the TPM before a firmware update is started
+ *  @details    Reads the interface registers PunReads times and compares each identification with the first one. A failed
+ *              or inconsistent read counts as error. On a TPM2.0 in operational mode one small command (TPM2_GetCapability
+ *              for TPM_PT_MANUFACTURER) is sent in addition. The error count and the measured latencies are logged. A
+ *              marginal bus shows up here instead of in the middle of the firmware transfer.
+ *
+ *  @param      PsAttribs                       TPM attributes read by FirmwareUpdate_CalculateState.
+ *  @param      PunReads                        Number of interface register reads.
+ *  @param      PunMaxErrors                    Number of errors tolerated.
+ *
+ *  @retval     RC_SUCCESS                      The link passed the check.
+ *  @retval     RC_E_TPM_LINK_CHECK_FAILED      More than PunMaxErrors reads failed or the command failed.
+ */
+static
+unsigned int
+FirmwareUpdate_CheckTpmLink(
+    _In_    BITFIELD_TPM_ATTRIBUTES     PsAttribs,
+    _In_    unsigned int                PunReads,
+    _In_    unsigned int                PunMaxErrors)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        TPM_INTERFACE_INFO sFirstInfo;
+        BOOL fFirstInfoValid = FALSE;
+        unsigned int unErrors = 0;
+        unsigned int unRead = 0;
+        unsigned long long ullTotalUs = 0;
+        unsigned long long ullMaxUs = 0;
+        unsigned long long ullCommandUs = 0;
+        unsigned int unCommandResult = RC_SUCCESS;
+
+        Platform_MemorySet(&sFirstInfo, 0, sizeof(sFirstInfo));
+
+        for (unRead = 0; unRead < PunReads; unRead++)
         {
-            if (TSS_TPM_BAD_PRESENCE == (unReturnValue ^ RC_TPM_MASK))
+            TPM_INTERFACE_INFO sInfo;
+            unsigned long long ullStartTicks = Platform_GetTicks();
+            unsigned long long ullReadUs = 0;
+            unsigned int unResult = RC_SUCCESS;
+
+            Platform_MemorySet(&sInfo, 0, sizeof(sInfo));
+            unResult = DeviceManagement_GetInterfaceInfo(&sInfo);
+            ullReadUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+            ullTotalUs += ullReadUs;
+            if (ullReadUs > ullMaxUs)
+                ullMaxUs = ullReadUs;
+
+            if (RC_SUCCESS != unResult)
             {
-                unReturnValue = RC_E_TPM12_DEFERREDPP_REQUIRED;
-                ERROR_STORE(unReturnValue, L"Deferred physical presence is required.");
+                unErrors++;
+                continue;
             }
-            else if (TSS_TPM_AUTHFAIL == (unReturnValue ^ RC_TPM_MASK))
+            if (!fFirstInfoValid)
             {
-                unReturnValue = RC_E_TPM12_INVALID_OWNERAUTH;
-                ERROR_STORE(unReturnValue, L"The signature of the policy parameter block is invalid.");
+                sFirstInfo = sInfo;
+                fFirstInfoValid = TRUE;
             }
-            else
+            else if (sInfo.usVendorId != sFirstInfo.usVendorId || sInfo.usDeviceId != sFirstInfo.usDeviceId ||
+                     sInfo.bRevisionId != sFirstInfo.bRevisionId || sInfo.bInterfaceType != sFirstInfo.bInterfaceType)
             {
-                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"Error while sending the policy parameter block. (0x%.8X)", unReturnValue);
-                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                unErrors++;
             }
+        }
 
-            if (PbfTpmAttributes.tpm12owner)
-            {
-                IGNORE_RETURN_VALUE(TSS_TPM_FlushSpecific(unAuthHandle, TSS_TPM_RT_AUTH));
-            }
+        // Send one small command through the complete command/response path
+        if (PsAttribs.tpm20 && PsAttribs.tpmInOperationalMode && !PsAttribs.tpm20InFailureMode)
+        {
+            TSS_UINT32 unManufacturer = 0;
+            unsigned long long ullStartTicks = Platform_GetTicks();
+            unCommandResult = TSS_TPM2_GetTpmProperty(TSS_TPM_PT_MANUFACTURER, &unManufacturer);
+            ullCommandUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+            if (TSS_TPM_RC_SUCCESS == unCommandResult && 0x49465800 /* IFX\0 */ != unManufacturer)
+                unCommandResult = RC_E_NO_IFX_TPM;
+        }
+
+        LOGGING_WRITE_LEVEL2_FMT(L"TPM link check: %d register reads, %d errors, average %d us, maximum %d us per read.",
+                                 PunReads, unErrors, (unsigned int)(PunReads > 0 ? ullTotalUs / PunReads : 0), (unsigned int)ullMaxUs);
+        LOGGING_WRITE_LEVEL2_FMT(L"TPM link check: command result 0x%.8X in %d us.", unCommandResult, (unsigned int)ullCommandUs);
 
+        if (unErrors > PunMaxErrors || RC_SUCCESS != unCommandResult)
+        {
+            unReturnValue = RC_E_TPM_LINK_CHECK_FAILED;
+            ERROR_STORE_FMT(unReturnValue, L"TPM link check failed (%d of %d register reads failed, command result 0x%.8X).", unErrors, PunReads, unCommandResult);
             break;
         }
 
-        // Set Progress to 0% after start vendor
-        PfnProgress(0);
-
         unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
 
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
     return unReturnValue;
 }
 
 /**
- *  @brief      FirmwareUpdateProcess Update
- *  @details    The function determines the maximum data size for a firmware block and sends the firmware to the TPM
- *              in chunks of maximum data size.
- *
- *  @param      PunFirmwareBlockSize    Size of the firmware block.
- *  @param      PrgbFirmwareBlock       Pointer to the firmware block byte stream.
- *  @param      PfnProgress             Callback function to indicate the progress.
+ *  @brief      Engine step UPDATE_STATE_PROBE
+ *  @details    Reads the TPM state, checks the link to the TPM if PROPERTY_LINK_CHECK_READS is set and selects the
+ *              manifest of the firmware image.
  *
  *  @retval     RC_SUCCESS                      The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. The firmware image block is NULL.
- *  @retval     RC_E_FAIL                       In case of a TPM connection or command error.
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
- *  @retval     RC_E_TPM_NO_BOOT_LOADER_MODE    The TPM is not in boot loader mode.
+ *  @retval     RC_E_NO_IFX_TPM                 The TPM is not manufactured by Infineon.
+ *  @retval     RC_E_TPM_LINK_CHECK_FAILED      The link to the TPM failed the pre-flight check.
+ *  @retval     ...                             Error codes from called functions.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_Update(
-    _In_                                    unsigned int                        PunFirmwareBlockSize,
-    _In_bytecount_(PunFirmwareBlockSize)    BYTE*                               PrgbFirmwareBlock,
-    _In_                                    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress)
+FirmwareUpdate_Engine_Probe()
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
 
     do
     {
-        BYTE* rgbFirmwareBlock = NULL;
-        unsigned int unRemainingBytes = 0;
-        unsigned int unBlockNumber = 0;
-        unsigned int unCurrentProgress = 0;
-        UINT16 usMaxDataSize = 0;
+        // Get TPM operation mode
+        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &pEngine->sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
-        // Check parameters
-        if (NULL == PrgbFirmwareBlock)
+        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
+        if (!pEngine->sTpmState.attribs.infineon)
         {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbFirmwareBlock is NULL)");
+            unReturnValue = RC_E_NO_IFX_TPM;
+            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
             break;
         }
 
-        rgbFirmwareBlock = PrgbFirmwareBlock;
-        unRemainingBytes = PunFirmwareBlockSize;
-
+        // Remember the firmware version before the update for the firmware update history
         {
-            unsigned int unRetryCounter = 0;
+            TPM_FIRMWARE_VERSION sFirmwareVersion;
+            unsigned int unCapacity = RG_LEN(pEngine->wszSourceVersion);
+            Platform_MemorySet(&sFirmwareVersion, 0, sizeof(sFirmwareVersion));
+            if (RC_SUCCESS != FirmwareUpdate_GetTpmFirmwareVersion(pEngine->sTpmState.attribs, &sFirmwareVersion) ||
+                    RC_SUCCESS != Platform_StringFormat(pEngine->wszSourceVersion, &unCapacity, L"%d.%d.%d.%d", sFirmwareVersion.usMajor, sFirmwareVersion.usMinor, sFirmwareVersion.usBuild, sFirmwareVersion.usRevision))
+                Platform_MemorySet(pEngine->wszSourceVersion, 0, sizeof(pEngine->wszSourceVersion));
+        }
 
-            for (unRetryCounter = 0; unRetryCounter < TPM_FU_START_MAX_RETRIES; unRetryCounter++)
+        // Optional pre-flight check of the link to the TPM
+        {
+            unsigned int unLinkCheckReads = 0;
+            unsigned int unLinkCheckMaxErrors = 0;
+            if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LINK_CHECK_READS, &unLinkCheckReads))
+                unLinkCheckReads = 0;
+            if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LINK_CHECK_MAX_ERRORS, &unLinkCheckMaxErrors))
+                unLinkCheckMaxErrors = 0;
+            if (unLinkCheckReads > 0)
             {
-                // Get the max data size for a firmware update block.
-                sSecurityModuleLogicInfo_d securityModuleLogicInfo;
-                Platform_MemorySet(&securityModuleLogicInfo, 0, sizeof(securityModuleLogicInfo));
-                unReturnValue = TSS_TPM_FieldUpgradeInfoRequest2(&securityModuleLogicInfo);
-                if (TSS_TPM_RESOURCES == (unReturnValue ^ RC_TPM_MASK))
-                {
-                    // Retry once on TPM_RESOURCES
-                    unReturnValue = TSS_TPM_FieldUpgradeInfoRequest2(&securityModuleLogicInfo);
-                }
+                unReturnValue = FirmwareUpdate_CheckTpmLink(pEngine->sTpmState.attribs, unLinkCheckReads, unLinkCheckMaxErrors);
                 if (RC_SUCCESS != unReturnValue)
-                {
-                    if (TSS_TPM_BAD_PARAM_SIZE == (unReturnValue ^ RC_TPM_MASK) ||
-                            TSS_TPM_BAD_PARAMETER == (unReturnValue ^ RC_TPM_MASK))
-                    {
-                        ERROR_STORE(unReturnValue, L"TSS_TPM_FieldUpgradeInfoRequest2 returned an unexpected value.");
-                        unReturnValue = RC_E_UNSUPPORTED_CHIP;
-                    }
-                    ERROR_STORE(unReturnValue, L"TSS_TPM_FieldUpgradeInfoRequest2 returned an unexpected value.");
                     break;
-                }
-                usMaxDataSize = securityModuleLogicInfo.wMaxDataSize;
-
-                // Verify that TPM switched to boot loader mode. Wait some time if it did not.
-                if (securityModuleLogicInfo.SecurityModuleStatus != SMS_BTLDR_ACTIVE)
-                {
-                    unReturnValue = RC_E_TPM_NO_BOOT_LOADER_MODE;
-                    LOGGING_WRITE_LEVEL1_FMT(L"TPM is not in boot loader mode as expected (Count:%d)", unRetryCounter);
-                    Platform_Sleep(TPM_FU_START_RETRY_WAIT_TIME);
-                    continue;
-                }
-                else
-                {
-                    unReturnValue = RC_SUCCESS;
-                    break;
-                }
             }
+        }
 
+        if (pEngine->sTpmState.attribs.tpmHasFULoader20)
+        {
+            // Select correct manifest
+            unReturnValue = FirmwareUpdate_SelectManifest(&pEngine->sFirmwareImage);
             if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"FirmwareUpdate_SelectManifest returned an error");
                 break;
+            }
         }
 
-        // Send the firmware image to the TPM block-by-block.
-        for (unBlockNumber = 1; unRemainingBytes > 0; unBlockNumber++)
+        FirmwareUpdate_Engine_SetState(pEngine->fPrepare ? UPDATE_STATE_POLICY : UPDATE_STATE_START);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Engine step UPDATE_STATE_POLICY
+ *  @details    Prepares the default policy session on a TPM2.0 in operational mode if the caller did not give one.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     ...                             Error codes from FirmwareUpdate_PrepareTPM20Policy.
+ */
+static
+unsigned int
+FirmwareUpdate_Engine_Policy()
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+    BITFIELD_TPM_ATTRIBUTES* pAttribs = &pEngine->sTpmState.attribs;
+
+    do
+    {
+        if (0 == pEngine->sUpdateData.unSessionHandle && pAttribs->tpm20 && pAttribs->tpmInOperationalMode &&
+                !pAttribs->tpm20restartRequired && !pAttribs->tpm20InFailureMode)
         {
-            UINT16 usBlockSize = unRemainingBytes < usMaxDataSize ? (UINT16)unRemainingBytes : usMaxDataSize;
-
-            // Transmit data block
-            unReturnValue = TSS_TPM_FieldUpgradeUpdate(rgbFirmwareBlock, usBlockSize);
+            TSS_TPMI_SH_AUTH_SESSION hPolicySession = 0;
+            unReturnValue = FirmwareUpdate_PrepareTPM20Policy(&hPolicySession);
             if (RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM_FieldUpgradeUpdate returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
-                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
                 break;
-            }
-
-            // Increase data pointer by block size
-            rgbFirmwareBlock += usBlockSize;
-
-            // Decrease size of remaining data by block size
-            unRemainingBytes -= usBlockSize;
-
-            // Set Progress (0 and 100% are set for _Start and _Complete so 98 steps are left)
-            {
-                unsigned int unProgress = (PunFirmwareBlockSize - unRemainingBytes) * 98 / PunFirmwareBlockSize + 1;
-                if (unCurrentProgress != unProgress)
-                {
-                    unCurrentProgress = unProgress;
-                    PfnProgress(unCurrentProgress);
-                }
-            }
+            pEngine->sUpdateData.unSessionHandle = hPolicySession;
+            pEngine->fOwnPolicySession = TRUE;
         }
+
+        FirmwareUpdate_Engine_SetState(UPDATE_STATE_START);
     }
     WHILE_FALSE_END;
 
@@ -2362,49 +5533,45 @@ FirmwareUpdate_Update(
 }
 
 /**
- *  @brief      FirmwareUpdate Complete
- *  @details    The function finishes the firmware update process.
+ *  @brief      Engine step UPDATE_STATE_START
+ *  @details    Starts the firmware update on the TPM.
  *
- *  @param      PfnProgress             Callback function to indicate the progress.
  *  @retval     RC_SUCCESS                      The operation completed successfully.
- *  @retval     RC_E_FAIL                       In case of a TPM connection or command error.
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ *  @retval     RC_E_UNSUPPORTED_CHIP           TPM1.2 support is not included in the build (IFXTPMUPDATE_TPM20_ONLY).
+ *  @retval     ...                             Error codes from FirmwareUpdate_Start.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_Complete(
-    _In_    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK         PfnProgress)
+FirmwareUpdate_Engine_Start()
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
 
     do
     {
-        // Send TPM_FieldUpgradeComplete command.
-        uint16_t usCompleteDataSize = 1;
-        uint16_t usOutCompleteSize = 0;
-        BYTE bCompleteData = 0;
-
-        if (RC_SUCCESS != TSS_TPM_FieldUpgradeComplete(usCompleteDataSize, &bCompleteData, &usOutCompleteSize))
-        {
-            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM_FieldUpgradeComplete returned an unexpected value. (0x%.8X)", unReturnValue);
-            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+        unReturnValue = FirmwareUpdate_Start(pEngine->sTpmState.attribs, &pEngine->sFirmwareImage, &pEngine->sUpdateData);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        }
+        pEngine->fStarted = TRUE;
 
-        // Check if out parameter is as expected (zero)
-        if (0 != usOutCompleteSize)
+        // The started field upgrade consumes the policy session, it must neither be reused nor flushed anymore
+        if (s_hRetainedPolicySession == pEngine->sUpdateData.unSessionHandle)
+            s_hRetainedPolicySession = 0;
+
+        if (pEngine->sTpmState.attribs.tpmHasFULoader20)
         {
-            unReturnValue = RC_E_FAIL;
+            // Wait for TPM to switch to boot loader mode.
+            FirmwareUpdate_Engine_SetWaitState(UPDATE_STATE_WAIT_BOOT_LOADER);
             break;
         }
 
-        // Wait for TPM to complete update sequence
-        Platform_Sleep(TPM_FU_COMPLETE_WAIT_TIME);
-
-        // Set Progress to 100%
-        PfnProgress(100);
-
-        unReturnValue = RC_SUCCESS;
+#ifdef IFXTPMUPDATE_TPM20_ONLY
+        // The TPM1.2 field upgrade commands are not included in this build
+        unReturnValue = RC_E_UNSUPPORTED_CHIP;
+        ERROR_STORE(unReturnValue, L"TPM1.2 firmware update is not supported by this build.");
+#else
+        FirmwareUpdate_Engine_SetState(UPDATE_STATE_DATA);
+#endif
     }
     WHILE_FALSE_END;
 
@@ -2412,317 +5579,262 @@ FirmwareUpdate_Complete(
 }
 
 /**
- *  @brief      Processes the firmware update for the SLB 9672 TPM.
- *  @details    The function sends the firmware to the TPM in chunks of maximum data size. It sends
- *              the manifest first, then the firmware, and finally it calls the finalize function.
+ *  @brief      Engine steps UPDATE_STATE_WAIT_BOOT_LOADER and UPDATE_STATE_WAIT_FINALIZE
+ *  @details    Probes the TPM2.0 operation mode once. If the awaited mode is not reported yet, the engine stays in the wait
+ *              state and asks the caller to poll again after TPM20_FU_PROBE_INTERVAL milliseconds until
+ *              TPM20_FU_RETRY_COUNT * TPM20_FU_WAIT_TIME milliseconds have elapsed.
  *
- *  @param      PpsIfxFirmwareImage     Pointer to structure containing the firmware image.
- *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PfFinalize                      FALSE to wait for boot loader mode (any mode other than OM_TPM).\n
+ *                                              TRUE to wait for OM_FU_BEFORE_FINALIZE or OM_RE_BEFORE_FINALIZE.
  *
  *  @retval     RC_SUCCESS                      The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. The firmware image block is NULL.
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The operation mode could not be read within the timeout or is unexpected.
  *  @retval     RC_E_TPM_NO_BOOT_LOADER_MODE    The TPM is not in boot loader mode.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_UpdateTpm20(
-    _In_    const IfxFirmwareImage* const       PpsIfxFirmwareImage,
-    _In_    const IfxFirmwareUpdateData* const  PpsFirmwareUpdateData)
+FirmwareUpdate_Engine_Wait(
+    _In_    BOOL    PfFinalize)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned int unReturnValue = RC_SUCCESS;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+    const unsigned long long ullTimeout = TPM20_FU_RETRY_COUNT * TPM20_FU_WAIT_TIME;
 
     do
     {
-        TSS_TPM2B_MAX_BUFFER sData;
-        TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-        TSS_TPMI_YES_NO bMoreData = 0;
+        unsigned long long ullElapsed = 0;
         BYTE bOperationMode = 0;
-        unsigned int unRemainingBytes = 0;
-        unsigned int unBlockNumber = 0;
-        unsigned int unCurrentProgress = 1;
+        BOOL fAwaited = FALSE;
 
-        // Check input parameters.
-        if (NULL == PpsIfxFirmwareImage || NULL == PpsFirmwareUpdateData)
+        // Read the operation mode once the TPM interface responds
+        if (RC_SUCCESS == FirmwareUpdate_Tpm20_ProbeOperationMode(TPM20_FU_PROBE_INTERVAL, &bOperationMode))
         {
-            unReturnValue = RC_E_BAD_PARAMETER;
+            pEngine->fModeRead = TRUE;
+            pEngine->bOperationMode = bOperationMode;
+            fAwaited = FirmwareUpdate_Tpm20_IsAwaitedMode(PfFinalize, bOperationMode);
+            if (!fAwaited)
+                LOGGING_WRITE_LEVEL3_FMT(L"TPM still reports operation mode 0x%.2X. Continue waiting for the mode switch.", bOperationMode);
+        }
+
+        // The accumulated poll intervals are a lower bound in case no tick counter is available
+        ullElapsed = Platform_TicksToMicroseconds(Platform_GetTicks() - pEngine->ullWaitStartTicks) / 1000;
+        if (ullElapsed < pEngine->unWaitedMs)
+            ullElapsed = pEngine->unWaitedMs;
+        if (!fAwaited && ullElapsed < ullTimeout)
+        {
+            pEngine->unWaitedMs += TPM20_FU_PROBE_INTERVAL;
+            pEngine->sStatus.unNextPollMs = TPM20_FU_PROBE_INTERVAL;
             break;
         }
 
-        BYTE* rgbFirmwareBlock = PpsIfxFirmwareImage->rgbFirmware;
-        BYTE* rgbPolicyParameterBlock = PpsIfxFirmwareImage->rgbPolicyParameterBlock;
+        LOGGING_WRITE_LEVEL3_FMT(L"Waited %d ms for the TPM operation mode switch.", (unsigned int)ullElapsed);
+        if (!pEngine->fModeRead)
+        {
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            ERROR_STORE(unReturnValue, L"No connection to the TPM can be established.");
+            break;
+        }
 
+        if (!PfFinalize)
         {
-            unsigned int unRetryCounter = 1;
-            for (; unRetryCounter <= TPM20_FU_RETRY_COUNT; unRetryCounter++)
+            // Verify that TPM switched to boot loader mode.
+            if (OM_TPM == pEngine->bOperationMode)
             {
-                // Wait for TPM to switch to boot loader mode.
-                Platform_Sleep(TPM20_FU_WAIT_TIME);
-
-                // Disconnect from TPM.
-                unReturnValue = DeviceManagement_Disconnect();
-                if (RC_SUCCESS != unReturnValue) {
-                    LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_Disconnect failed (0x%.8X). Continue checking for boot loader mode.", unReturnValue);
-                }
-
-                // Reconnect to the TPM.
-                unReturnValue = DeviceManagement_Connect();
-                if (RC_SUCCESS != unReturnValue) {
-                    LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_Connect failed (0x%.8X). Continue checking for boot loader mode.", unReturnValue);
-                    continue;
-                }
-
-                // Verify that TPM switched to boot loader mode.
-                Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
-                unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_OPERATION_MODE, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_GetCapability returned an unexpected value. (0x%.8X)", unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-
-                // Check returned vendor capability data
-                if (TSS_TPM_CAP_VENDOR_PROPERTY != vendorCapabilityData.capability || 1 != vendorCapabilityData.data.vendorData.count)
-                {
-                    ERROR_STORE(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_GetCapability(TPM_PT_VENDOR_FIX_FU_OPERATION_MODE) returned unexpected data.");
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-
-                // Verify that TPM switched to boot loader mode.
-                bOperationMode = vendorCapabilityData.data.vendorData.buffer[0].buffer[0];
-                if (OM_TPM == bOperationMode)
-                {
-                    unReturnValue = RC_E_TPM_NO_BOOT_LOADER_MODE;
-                    LOGGING_WRITE_LEVEL1(L"TPM is not in boot loader mode as expected.");
-                    break;
-                }
-                else
-                {
-                    unReturnValue = RC_SUCCESS;
-                    break;
-                }
+                unReturnValue = RC_E_TPM_NO_BOOT_LOADER_MODE;
+                LOGGING_WRITE_LEVEL1(L"TPM is not in boot loader mode as expected.");
+                break;
             }
-
-            if (RC_SUCCESS != unReturnValue)
+            FirmwareUpdate_Engine_BeginManifest();
+        }
+        else
+        {
+            if (!FirmwareUpdate_Tpm20_IsAwaitedMode(TRUE, pEngine->bOperationMode))
             {
-                if (TPM20_FU_RETRY_COUNT == unRetryCounter)
-                {
-                    ERROR_STORE(RC_E_FIRMWARE_UPDATE_FAILED, L"No connection to the TPM can be established.");
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                }
+                unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+                ERROR_STORE_FMT(unReturnValue, L"TPM is in an unexpected mode (%d).", pEngine->bOperationMode);
                 break;
             }
+            FirmwareUpdate_Engine_SetState(UPDATE_STATE_FINALIZE);
         }
+    }
+    WHILE_FALSE_END;
 
-        // Check if manifest must be send
-        if (OM_FU_BEFORE_FINALIZE != bOperationMode && OM_RE_BEFORE_FINALIZE != bOperationMode)
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Engine step UPDATE_STATE_MANIFEST
+ *  @details    Sends one manifest block directly from the firmware image.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation failed.
+ *  @retval     RC_E_INTERNAL                   The abandon update mode property cannot be read.
+ */
+static
+unsigned int
+FirmwareUpdate_Engine_SendManifestBlock()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
+
+    do
+    {
+        unsigned int unRemainingBytes = pEngine->sFirmwareImage.usPolicyParameterBlockSize - pEngine->unOffset;
+        UINT16 usBlockSize = unRemainingBytes < pEngine->unMaxBlockSize ? (UINT16)unRemainingBytes : (UINT16)pEngine->unMaxBlockSize;
+
+        // Set intial processing info
+        TSS_UINT8 processingInfo = PROCESSING_INFO_FIRST_BLOCK;
+        // Consecutive block?
+        if (pEngine->unBlockNumber > 1)
+            processingInfo = PROCESSING_INFO_CONSECUTIVE_BLOCK;
+        // Last block reached?
+        if (unRemainingBytes <= pEngine->unMaxBlockSize)
+            processingInfo = PROCESSING_INFO_LAST_BLOCK_OR_NO_CHAINING;
+
+        // Transmit manifest block directly from the firmware image
+        unReturnValue = TSS_TPM2_FieldUpgradeManifestVendorDirect(processingInfo, pEngine->sFirmwareImage.rgbPolicyParameterBlock + pEngine->unOffset, usBlockSize);
+        if (RC_SUCCESS != unReturnValue)
         {
-            // Send the manifest to the TPM block-by-block in chunks of <= TSS_MAX_DIGEST_BUFFER bytes (1024)
-            unRemainingBytes = PpsIfxFirmwareImage->usPolicyParameterBlockSize;
-            for (unBlockNumber = 1; unRemainingBytes > 0; unBlockNumber++)
+            // Check if manifest was already send
+            if (TSS_TPM_RC_DISABLED == unReturnValue)
             {
-                UINT16 usBlockSize = unRemainingBytes < TSS_MAX_DIGEST_BUFFER ? (UINT16)unRemainingBytes : TSS_MAX_DIGEST_BUFFER;
-                // Copy the firmware block to TSS_TPM2B_MAX_BUFFER.
-                unReturnValue = Platform_MemoryCopy(sData.buffer, sizeof(sData.buffer), rgbPolicyParameterBlock, usBlockSize);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"Platform_MemoryCopy returned an unexpected value. (0x%.8X)", unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-                sData.size = usBlockSize;
-
-                // Set intial processing info
-                TSS_UINT8 processingInfo = PROCESSING_INFO_FIRST_BLOCK;
-                // Consecutive block?
-                if (unBlockNumber > 1)
-                    processingInfo = PROCESSING_INFO_CONSECUTIVE_BLOCK;
-                // Last block reached?
-                if (unRemainingBytes <= TSS_MAX_DIGEST_BUFFER)
-                    processingInfo = PROCESSING_INFO_LAST_BLOCK_OR_NO_CHAINING;
-
-                // Transmit manifest block
-                unReturnValue = TSS_TPM2_FieldUpgradeManifestVendor(processingInfo, &sData);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    // Check if manifest was already send
-                    if (TSS_TPM_RC_DISABLED == unReturnValue )
-                    {
-                        // Continue update
-                        unReturnValue = RC_SUCCESS;
-                        break;
-                    }
+                // Continue update
+                unReturnValue = RC_SUCCESS;
+                FirmwareUpdate_Engine_BeginData();
+                break;
+            }
 
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeManifestVendor returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeManifestVendor returned an unexpected value while processing block %d. (0x%.8X)", pEngine->unBlockNumber, unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
 
-                    // Get abandon mode
-                    UINT32 unAbandonUpdateMode = 0;
-                    if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, &unAbandonUpdateMode))
-                    {
-                        unReturnValue = RC_E_INTERNAL;
-                        break;
-                    }
+            // Get abandon mode
+            UINT32 unAbandonUpdateMode = 0;
+            if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, &unAbandonUpdateMode))
+            {
+                unReturnValue = RC_E_INTERNAL;
+                break;
+            }
 
-                    // Check if firmware update shall be abandoned
-                    if ((unAbandonUpdateMode & ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL) == ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL)
-                    {
-                        UINT32 unResultAbandonUpdate = FirmwareUpdate_AbandonUpdate();
-                        if (RC_SUCCESS != unResultAbandonUpdate)
-                            LOGGING_WRITE_LEVEL1_FMT(L"Unexpected error calling FirmwareUpdate_AbandonUpdate: (0x%.8lX)", unResultAbandonUpdate);
-                    }
+            // Check if firmware update shall be abandoned
+            if ((unAbandonUpdateMode & ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL) == ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL)
+            {
+                UINT32 unResultAbandonUpdate = FirmwareUpdate_AbandonUpdate();
+                if (RC_SUCCESS != unResultAbandonUpdate)
+                    LOGGING_WRITE_LEVEL1_FMT(L"Unexpected error calling FirmwareUpdate_AbandonUpdate: (0x%.8X)", unResultAbandonUpdate);
+            }
+            break;
+        }
 
-                    // Break FirmwareUpdate_UpdateTpm20 due to error within TSS_TPM2_FieldUpgradeManifestVendor
-                    break;
-                }
+        pEngine->unOffset += usBlockSize;
+        pEngine->unBlockNumber++;
+        if (pEngine->unOffset >= pEngine->sFirmwareImage.usPolicyParameterBlockSize)
+            FirmwareUpdate_Engine_BeginData();
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
 
-                // Increase data pointer by block size
-                rgbPolicyParameterBlock += usBlockSize;
+/**
+ *  @brief      Engine step UPDATE_STATE_DATA
+ *  @details    Sends one firmware block directly from the firmware image. A block is resent after a transmission error.
+ *              The TPM1.2 firmware data and the streamed TPM2.0 firmware data (PROPERTY_STREAMING_UPDATE) are sent in one step.
+ *
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation failed.
+ *  @retval     ...                             Error codes from called functions.
+ */
+static
+unsigned int
+FirmwareUpdate_Engine_SendFirmwareBlock()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
 
-                // Decrease size of remaining data by block size
-                unRemainingBytes -= usBlockSize;
-            }
+    do
+    {
+        unsigned int unRemainingBytes = pEngine->sFirmwareImage.unFirmwareSize - pEngine->unOffset;
+        UINT16 usBlockSize = unRemainingBytes < pEngine->unMaxBlockSize ? (UINT16)unRemainingBytes : (UINT16)pEngine->unMaxBlockSize;
+        BYTE* rgbFirmwareBlock = pEngine->sFirmwareImage.rgbFirmware + pEngine->unOffset;
+        unsigned int unRetryCounter = 0;
+        BOOL fBlockAccepted = FALSE;
+        BOOL fStreamingUpdate = FALSE;
+
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+        if (!pEngine->sTpmState.attribs.tpmHasFULoader20)
+        {
+            // Transfer new firmware data to TPM
+            unReturnValue = FirmwareUpdate_Update(pEngine->sFirmwareImage.unFirmwareSize, pEngine->sFirmwareImage.rgbFirmware, pEngine->sUpdateData.fnProgressCallback);
+            if (RC_SUCCESS == unReturnValue)
+                FirmwareUpdate_Engine_SetState(UPDATE_STATE_FINALIZE);
+            break;
         }
+#endif
 
-        // Check for errors
-        if (RC_SUCCESS != unReturnValue)
+        // Get firmware block streaming mode
+        if (FALSE == PropertyStorage_GetBooleanValueByKey(PROPERTY_STREAMING_UPDATE, &fStreamingUpdate))
+            fStreamingUpdate = FALSE;
+        if (fStreamingUpdate)
+        {
+            // Send the firmware image with pipelined marshaling of the next block
+            unReturnValue = FirmwareUpdate_SendFirmwareBlocksStreamed(
+                                &pEngine->sFirmwareImage,
+                                &pEngine->sUpdateData,
+                                (TSS_UINT16)pEngine->unMaxBlockSize,
+                                &pEngine->unCurrentProgress);
+            if (RC_SUCCESS == unReturnValue)
+                FirmwareUpdate_Engine_EndData();
             break;
+        }
 
-        // Set Progress to 1% after manifest vendor
-        PpsFirmwareUpdateData->fnProgressCallback(1);
-
-        // Check if firmware blocks must be send
-        if (OM_FU_BEFORE_FINALIZE != bOperationMode && OM_RE_BEFORE_FINALIZE != bOperationMode)
+        // Transmit firmware block directly from the firmware image, resend it after a transmission error
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendorDirect(rgbFirmwareBlock, usBlockSize);
+        while (RC_SUCCESS != unReturnValue && unRetryCounter < TPM20_FU_BLOCK_MAX_RETRIES)
         {
-            // Send the firmware image to the TPM block-by-block in chunks of <= TSS_MAX_DIGEST_BUFFER bytes (1024)
-            unRemainingBytes = PpsIfxFirmwareImage->unFirmwareSize;
-            for (unBlockNumber = 1; unRemainingBytes > 0; unBlockNumber++)
+            unsigned int unResultRecover = RC_E_FAIL;
+            unRetryCounter++;
+            pEngine->unBlockRetries++;
+            unResultRecover = FirmwareUpdate_Tpm20_RecoverBlock(unReturnValue, pEngine->unBlockNumber, unRemainingBytes == usBlockSize, &fBlockAccepted);
+            if (RC_SUCCESS != unResultRecover)
+                break;
+            if (fBlockAccepted)
             {
-                UINT16 usBlockSize = unRemainingBytes < TSS_MAX_DIGEST_BUFFER ? (UINT16)unRemainingBytes : TSS_MAX_DIGEST_BUFFER;
-
-                // Copy the firmware block to TSS_TPM2B_MAX_BUFFER.
-                unReturnValue = Platform_MemoryCopy(sData.buffer, sizeof(sData.buffer), rgbFirmwareBlock, usBlockSize);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"Platform_MemoryCopy returned an unexpected value. (0x%.8X)", unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-                sData.size = usBlockSize;
-
-                // Transmit firmware block
-                unReturnValue = TSS_TPM2_FieldUpgradeDataVendor(&sData);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor returned an unexpected value while processing block %d. (0x%.8X)", unBlockNumber, unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-
-                // Increase data pointer by block size
-                rgbFirmwareBlock += usBlockSize;
-
-                // Decrease size of remaining data by block size
-                unRemainingBytes -= usBlockSize;
-
-                // Set Progress (0% after _StartVendor, 1% after _ManifestVendor, 99% before _FinalizeVendor, 100% after _FinalizeVendor)
-                {
-                    unsigned int unProgress = (PpsIfxFirmwareImage->unFirmwareSize - unRemainingBytes) * 96 / PpsIfxFirmwareImage->unFirmwareSize + 2;
-                    if (unCurrentProgress != unProgress)
-                    {
-                        unCurrentProgress = unProgress;
-                        PpsFirmwareUpdateData->fnProgressCallback(unCurrentProgress);
-                    }
-                }
+                unReturnValue = RC_SUCCESS;
+                break;
             }
+            unReturnValue = TSS_TPM2_FieldUpgradeDataVendorDirect(rgbFirmwareBlock, usBlockSize);
         }
-
-        // Check for errors
         if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeDataVendor returned an unexpected value while processing block %d. (0x%.8X)", pEngine->unBlockNumber, unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
             break;
+        }
 
-        // Set Progress to 99%
-        PpsFirmwareUpdateData->fnProgressCallback(99);
-
-        // Finalize firmware upgrade.
+        // The TPM has received all firmware data already
+        if (fBlockAccepted)
         {
-            unsigned int unRetryCounter = 1;
-            for (; unRetryCounter <= TPM20_FU_RETRY_COUNT; unRetryCounter++)
-            {
-                // Wait for TPM to switch back to firmware mode.
-                Platform_Sleep(TPM20_FU_WAIT_TIME);
-
-                // Disconnect from TPM.
-                unReturnValue = DeviceManagement_Disconnect();
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_Disconnect failed (0x%.8X). Continue finalizing update.", unReturnValue);
-                }
-
-                // Reconnect to the TPM.
-                unReturnValue = DeviceManagement_Connect();
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    LOGGING_WRITE_LEVEL2_FMT(L"DeviceManagement_Connect failed (0x%.8X). Continue finalizing update.", unReturnValue);
-                    continue;
-                }
-
-                // Verify that TPM switched to boot loader mode.
-                Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
-                unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_OPERATION_MODE, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_GetCapability returned an unexpected value. (0x%.8X)", unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-
-                // Check returned vendor capability data
-                if (TSS_TPM_CAP_VENDOR_PROPERTY != vendorCapabilityData.capability || 1 != vendorCapabilityData.data.vendorData.count)
-                {
-                    ERROR_STORE(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_GetCapability(TPM_PT_VENDOR_FIX_FU_OPERATION_MODE) returned unexpected data.");
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-
-                bOperationMode = vendorCapabilityData.data.vendorData.buffer[0].buffer[0];
-                if (OM_FU_BEFORE_FINALIZE != bOperationMode && OM_RE_BEFORE_FINALIZE != bOperationMode)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TPM is in an unexpected mode (%d).", bOperationMode);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
+            FirmwareUpdate_Engine_EndData();
+            break;
+        }
 
-                // Call finalize command
-                sData.size = 0;
-                unReturnValue = TSS_TPM2_FieldUpgradeFinalizeVendor(&sData);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeFinalizeVendor returned an unexpected value. (0x%.8X)", unReturnValue);
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                    break;
-                }
-                else {
-                    LOGGING_WRITE_LEVEL3(L"TSS_TPM2_FieldUpgradeFinalizeVendor succeeded.");
-                    break;
-                }
-            }
+        pEngine->unOffset += usBlockSize;
+        pEngine->unBlockNumber++;
+        unRemainingBytes -= usBlockSize;
+        FirmwareUpdate_TransferTelemetryBlock(usBlockSize);
 
-            if (RC_SUCCESS != unReturnValue)
+        // Set Progress (0% after _StartVendor, 1% after _ManifestVendor, 99% before _FinalizeVendor, 100% after _FinalizeVendor)
+        {
+            unsigned int unProgress = (pEngine->sFirmwareImage.unFirmwareSize - unRemainingBytes) * 96 / pEngine->sFirmwareImage.unFirmwareSize + 2;
+            if (pEngine->unCurrentProgress != unProgress)
             {
-                if (TPM20_FU_RETRY_COUNT == unRetryCounter)
-                {
-                    ERROR_STORE(RC_E_FIRMWARE_UPDATE_FAILED, L"No connection to the TPM can be established.");
-                    unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
-                }
-                break;
+                pEngine->unCurrentProgress = unProgress;
+                pEngine->sUpdateData.fnProgressCallback(unProgress);
             }
         }
 
-        // Set Progress to 100%
-        PpsFirmwareUpdateData->fnProgressCallback(100);
+        if (0 == unRemainingBytes)
+            FirmwareUpdate_Engine_EndData();
     }
     WHILE_FALSE_END;
 
@@ -2730,31 +5842,48 @@ FirmwareUpdate_UpdateTpm20(
 }
 
 /**
- *  @brief      Abandon update and switch back to TPM operational mode.
- *  @details    This function switch back to TPM operational mode by calling TPM2_FieldUpgradeAbandonVendor() command.
+ *  @brief      Engine step UPDATE_STATE_FINALIZE
+ *  @details    Finalizes the firmware update.
  *
- *  @retval     RC_SUCCESS      The operation completed successfully.
- *  @retval     ...             Return codes from TSS_TPM2_FieldUpgradeAbandonVendor().
+ *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation failed.
+ *  @retval     ...                             Error codes from called functions.
  */
-_Check_return_
+static
 unsigned int
-FirmwareUpdate_AbandonUpdate()
+FirmwareUpdate_Engine_Finalize()
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_ENGINE* pEngine = &s_sUpdateEngine;
 
     do
     {
-        // Initialize size with zero since parameter is not used
-        TSS_TPM2B_MAX_BUFFER sData;
-        sData.size = 0;
+#ifndef IFXTPMUPDATE_TPM20_ONLY
+        if (!pEngine->sTpmState.attribs.tpmHasFULoader20)
+        {
+            // Finalize the firmware update
+            unReturnValue = FirmwareUpdate_Complete(pEngine->sUpdateData.fnProgressCallback);
+            if (RC_SUCCESS == unReturnValue)
+                FirmwareUpdate_Engine_Complete(RC_SUCCESS);
+            break;
+        }
+#endif
 
-        // Call abandon command (switching back to TPM operational mode)
-        unReturnValue = TSS_TPM2_FieldUpgradeAbandonVendor(&sData);
+        // Finalize firmware upgrade.
+        s_sFieldUpgradeData.size = 0;
+        unReturnValue = TSS_TPM2_FieldUpgradeFinalizeVendor(&s_sFieldUpgradeData);
         if (RC_SUCCESS != unReturnValue)
         {
-            ERROR_STORE(unReturnValue, L"TSS_TPM2_FieldUpgradeAbandonVendor returned an unexpected value.");
+            ERROR_STORE_FMT(RC_E_FIRMWARE_UPDATE_FAILED, L"TSS_TPM2_FieldUpgradeFinalizeVendor returned an unexpected value. (0x%.8X)", unReturnValue);
+            unReturnValue = RC_E_FIRMWARE_UPDATE_FAILED;
             break;
         }
+        LOGGING_WRITE_LEVEL3(L"TSS_TPM2_FieldUpgradeFinalizeVendor succeeded.");
+        FirmwareUpdate_Tpm20_WriteCheckpoint(NULL);
+
+        // Set Progress to 100%
+        pEngine->sUpdateData.fnProgressCallback(100);
+        FirmwareUpdate_Engine_Complete(RC_SUCCESS);
     }
     WHILE_FALSE_END;
 
@@ -2762,85 +5891,58 @@ FirmwareUpdate_AbandonUpdate()
 }
 
 /**
- *  @brief      Returns information about the current state of TPM
- *  @details
+ *  @brief      Starts a firmware update without blocking the caller
+ *  @details    The firmware update is driven by calls to FirmwareUpdate_PollUpdate. Each call performs one step (e.g. one
+ *              firmware block) and returns. The firmware image and the TPM access must stay available until the engine
+ *              reaches UPDATE_STATE_DONE. The progress callback of the firmware update data is optional.
  *
- *  @param      PwszVersionName             A pointer to a null-terminated string representing the firmware image version name.
- *  @param      PpunVersionNameSize         IN: Capacity of the PwszVersionName parameter in wide characters including zero termination
- *                                          OUT: Length of written wide character string (excluding zero termination)
- *  @param      PpsTpmState                 Receives TPM state.
- *  @param      PpunRemainingUpdates        Receives the number of remaining updates or -1 in case the value could not be detected.
+ *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PfPrepare               TRUE to check the firmware image (FirmwareUpdate_CheckImage) and to prepare a TPM2.0
+ *                                      policy session if none is given.\n
+ *                                      FALSE if the caller has done so already (see FirmwareUpdate_UpdateImage).
  *
- *  @retval     RC_SUCCESS                  The operation completed successfully.
- *  @retval     RC_E_FAIL                   An unexpected error occurred.
- *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
- *  @retval     RC_E_NO_IFX_TPM             The TPM is not manufactured by Infineon.
- *  @retval     ...                         Error codes from called functions.
+ *  @retval     RC_SUCCESS              The firmware update was started.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          Another firmware update is in progress.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_GetImageInfo(
-    _Inout_bytecap_(*PpunVersionNameSize)   wchar_t*                    PwszVersionName,
-    _Inout_                                 unsigned int*               PpunVersionNameSize,
-    _Inout_                                 TPM_STATE *                 PpsTpmState,
-    _Inout_                                 unsigned int*               PpunRemainingUpdates)
+FirmwareUpdate_StartUpdate(
+    _In_    const IfxFirmwareUpdateData* const  PpsFirmwareUpdateData,
+    _In_    BOOL                                PfPrepare)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
-        unsigned int unTpmFuCounter = REMAINING_UPDATES_UNAVAILABLE;
-
         // Check parameters
-        if (NULL == PwszVersionName ||
-                NULL == PpunVersionNameSize ||
-                0 == *PpunVersionNameSize ||
-                NULL == PpsTpmState ||
-                NULL == PpunRemainingUpdates)
+        if (NULL == PpsFirmwareUpdateData || NULL == PpsFirmwareUpdateData->rgbFirmwareImage)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Bad parameter detected. PwszVersionName, PpunVersionNameSize, PpsTpmState or PpunRemainingUpdates is NULL or *PpunVersionNameSize is 0.");
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsFirmwareUpdateData or its firmware image is NULL)");
             break;
         }
 
-        // Get TPM operation mode
-        unReturnValue = FirmwareUpdate_CalculateState(TRUE, PpsTpmState);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-
-        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
-        if (PpsTpmState->attribs.infineon == 0)
+        // Only one firmware update can be in progress
+        if (UPDATE_STATE_IDLE != s_sUpdateEngine.sStatus.unState && UPDATE_STATE_DONE != s_sUpdateEngine.sStatus.unState)
         {
-            unReturnValue = RC_E_NO_IFX_TPM;
-            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
+            unReturnValue = RC_E_NOT_READY;
+            ERROR_STORE(unReturnValue, L"Another firmware update is in progress.");
             break;
         }
 
-        // Get firmware version string
-        {
-            wchar_t wszDummy[MAX_NAME];
-            unsigned int unDummySize = RG_LEN(wszDummy);
-            IGNORE_RETURN_VALUE(Platform_StringSetZero(wszDummy, RG_LEN(wszDummy)));
-            unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionString(PpsTpmState->attribs, PwszVersionName, PpunVersionNameSize, wszDummy, &unDummySize);
-            if (RC_SUCCESS != unReturnValue)
-                break;
-        }
-
-        // Read update counter from TPM
-        // Cannot be done after firmware update to TPM 2.0 when reboot is required
-        // Can be done for TPM2.0 firmware update loader when reboot is required (not in failure mode)
-        if ((!(PpsTpmState->attribs.tpm20 && PpsTpmState->attribs.tpm20restartRequired) &&
-                !PpsTpmState->attribs.tpm20InFailureMode &&
-                !(PpsTpmState->attribs.tpm12 && PpsTpmState->attribs.tpm12FieldUpgradeInfo2Failed)) ||
-                (PpsTpmState->attribs.tpmHasFULoader20 && !PpsTpmState->attribs.tpm20InFailureMode))
-        {
-            unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(PpsTpmState->attribs, &unTpmFuCounter);
-            if (RC_SUCCESS != unReturnValue)
-                break;
-        }
+        Platform_MemorySet(&s_sUpdateEngine, 0, sizeof(s_sUpdateEngine));
+        s_sUpdateEngine.sUpdateData = *PpsFirmwareUpdateData;
+        s_sUpdateEngine.fnProgressCallback = PpsFirmwareUpdateData->fnProgressCallback;
+        s_sUpdateEngine.sUpdateData.fnProgressCallback = FirmwareUpdate_Engine_Progress;
+        s_sUpdateEngine.fPrepare = PfPrepare;
+        s_sUpdateEngine.unCurrentProgress = 1;
+        Platform_MemorySet(&s_sTransferTelemetry, 0, sizeof(s_sTransferTelemetry));
 
-        // Fill in number of remaining updates
-        *PpunRemainingUpdates = unTpmFuCounter;
+        // Measure the phases from here if the caller did not start the phase timing
+        if (UPDATE_PHASE_NONE == s_sPhaseTiming.unCurrentPhase)
+            FirmwareUpdate_PhaseTimingReset();
+        FirmwareUpdate_Engine_SetState(UPDATE_STATE_VERIFY);
 
         unReturnValue = RC_SUCCESS;
     }
@@ -2850,121 +5952,73 @@ FirmwareUpdate_GetImageInfo(
 }
 
 /**
- *  @brief      Checks if the firmware image is valid for the TPM
- *  @details    Performs integrity, consistency and content checks to determine if the given firmware image can be applied to the installed TPM.
+ *  @brief      Performs the next step of the firmware update started by FirmwareUpdate_StartUpdate
+ *  @details    The function returns after one step. Steps that wait for the TPM to switch its operation mode probe the TPM
+ *              once and return a poll interval in unNextPollMs instead of sleeping. The result of the firmware update is
+ *              returned in unResult once the engine has reached UPDATE_STATE_DONE.
  *
- *  @param      PrgbImage                   Firmware image byte stream.
- *  @param      PullImageSize               Size of firmware image byte stream.
- *  @param      PpfValid                    TRUE in case the image is valid, FALSE otherwise.
- *  @param      PpbfNewTpmFirmwareInfo      Pointer to a bit field to return info data for the new firmware image.
- *  @param      PpunErrorDetails            Pointer to an unsigned int to return error details. Possible values are:\n
- *                                              RC_E_FW_UPDATE_BLOCKED in case the field upgrade counter value has been exceeded.\n
- *                                              RC_E_WRONG_FW_IMAGE in case the TPM is not updatable with the given image.\n
- *                                              RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
- *                                              RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.\n
- *                                              RC_E_WRONG_DECRYPT_KEYS in case the TPM2.0 does not have decrypt keys matching to the firmware image.
+ *  @param      PpsStatus               Receives the status of the engine after the step.
  *
- *  @retval     RC_SUCCESS                  The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
- *  @retval     RC_E_TPM20_FAILURE_MODE     The TPM2.0 is in failure mode.
- *  @retval     RC_E_RESTART_REQUIRED       In case a restart is required to get back to a functional TPM.
- *  @retval     RC_E_NO_IFX_TPM             In case TPM vendor is not IFX.
- *  @retval     RC_E_FAIL                   An unexpected error occurred.
- *  @retval     ...                         Error codes from called functions.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. The parameter is NULL.
  */
 _Check_return_
-_Success_(return == 0)
 unsigned int
-FirmwareUpdate_CheckImage(
-    _In_bytecount_(PullImageSize)   BYTE *                           PrgbImage,
-    _In_                            unsigned long long               PullImageSize,
-    _Out_                           BOOL *                           PpfValid,
-    _Out_                           BITFIELD_NEW_TPM_FIRMWARE_INFO * PpbfNewTpmFirmwareInfo,
-    _Out_                           unsigned int*                    PpunErrorDetails)
+FirmwareUpdate_PollUpdate(
+    _Out_   UPDATE_ENGINE_STATUS*   PpsStatus)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
-        TPM_STATE sTpmState;
-        IfxFirmwareImage sIfxFirmwareImage;
-        int nBufferSize = (int)PullImageSize;
-        BYTE* pbBuffer = PrgbImage;
-        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
-        Platform_MemorySet(&sIfxFirmwareImage, 0, sizeof(sIfxFirmwareImage));
+        unsigned int unResultStep = RC_SUCCESS;
 
         // Check parameters
-        if (NULL == PrgbImage ||
-                0 == PullImageSize ||
-                NULL == PpfValid ||
-                NULL == PpbfNewTpmFirmwareInfo ||
-                NULL == PpunErrorDetails)
+        if (NULL == PpsStatus)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgbImage or PpfValid or PpbfNewTpmFirmwareInfo is NULL or PullImageSize is zero)");
-            break;
-        }
-
-        // Initialize out parameters
-        *PpunErrorDetails = RC_E_FW_UPDATE_BLOCKED;
-        *PpfValid = FALSE;
-
-        Platform_MemorySet(PpbfNewTpmFirmwareInfo, 0, sizeof(BITFIELD_NEW_TPM_FIRMWARE_INFO));
-
-        // Get TPM operation mode
-        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-
-        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
-        if (!sTpmState.attribs.infineon)
-        {
-            unReturnValue = RC_E_NO_IFX_TPM;
-            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsStatus is NULL)");
             break;
         }
 
-        // Cannot make a decision if restart is required.
-        if (sTpmState.attribs.tpm20restartRequired)
-        {
-            unReturnValue = RC_E_RESTART_REQUIRED;
-            ERROR_STORE(unReturnValue, L"A restart is required.");
-            *PpunErrorDetails = RC_E_WRONG_FW_IMAGE;
-            break;
-        }
-
-        // Cannot make a decision if TPM2.0 is in failure mode.
-        if (sTpmState.attribs.tpm20InFailureMode)
-        {
-            unReturnValue = RC_E_TPM20_FAILURE_MODE;
-            ERROR_STORE(unReturnValue, L"TPM2.0 is in failure mode.");
-            break;
-        }
-
-        // Unmarshal the firmware image structure
-        unReturnValue = FirmwareImage_Unmarshal(&sIfxFirmwareImage, &pbBuffer, &nBufferSize);
-        if (RC_SUCCESS != unReturnValue)
+        s_sUpdateEngine.sStatus.unNextPollMs = 0;
+        switch (s_sUpdateEngine.sStatus.unState)
         {
-            ERROR_STORE(unReturnValue, L"Failed to unmarshal the firmware image.");
-            if (RC_E_NEWER_TOOL_REQUIRED == unReturnValue)
-            {
-                unReturnValue = RC_SUCCESS;
-                *PpunErrorDetails = RC_E_NEWER_TOOL_REQUIRED;
-            }
-            else
-            {
-                unReturnValue = RC_SUCCESS;
-                *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
-            }
-            break;
+            case UPDATE_STATE_VERIFY:
+                unResultStep = FirmwareUpdate_Engine_Verify();
+                break;
+            case UPDATE_STATE_PROBE:
+                unResultStep = FirmwareUpdate_Engine_Probe();
+                break;
+            case UPDATE_STATE_POLICY:
+                unResultStep = FirmwareUpdate_Engine_Policy();
+                break;
+            case UPDATE_STATE_START:
+                unResultStep = FirmwareUpdate_Engine_Start();
+                break;
+            case UPDATE_STATE_WAIT_BOOT_LOADER:
+                unResultStep = FirmwareUpdate_Engine_Wait(FALSE);
+                break;
+            case UPDATE_STATE_MANIFEST:
+                unResultStep = FirmwareUpdate_Engine_SendManifestBlock();
+                break;
+            case UPDATE_STATE_DATA:
+                unResultStep = FirmwareUpdate_Engine_SendFirmwareBlock();
+                break;
+            case UPDATE_STATE_WAIT_FINALIZE:
+                unResultStep = FirmwareUpdate_Engine_Wait(TRUE);
+                break;
+            case UPDATE_STATE_FINALIZE:
+                unResultStep = FirmwareUpdate_Engine_Finalize();
+                break;
+            default:
+                // Nothing to do in UPDATE_STATE_IDLE and UPDATE_STATE_DONE
+                break;
         }
+        if (RC_SUCCESS != unResultStep)
+            FirmwareUpdate_Engine_Complete(unResultStep);
 
-        // Check if update is possible
-        nBufferSize = (int)PullImageSize;
-        unReturnValue = FirmwareUpdate_IsFirmwareUpdatable(sTpmState.attribs, PrgbImage, nBufferSize, &sIfxFirmwareImage, PpfValid, PpbfNewTpmFirmwareInfo, PpunErrorDetails);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-
+        *PpsStatus = s_sUpdateEngine.sStatus;
         unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
@@ -2973,358 +6027,469 @@ FirmwareUpdate_CheckImage(
 }
 
 /**
- *  @brief      Prepares a policy session for TPM firmware.
- *  @details    The function prepares a policy session for TPM Firmware Update.
- *
- *  @param      PphPolicySession                    Pointer to session handle that will be filled in by this method.
+ *  @brief      Cancels the firmware update started by FirmwareUpdate_StartUpdate
+ *  @details    Before the update is started on the TPM the engine just stops. A TPM2.0 in boot loader mode is switched back
+ *              to operational mode (FirmwareUpdate_AbandonUpdate). A TPM1.2 update or a TPM2.0 update waiting for or
+ *              performing the finalization cannot be canceled. A canceled update ends with RC_E_UPDATE_CANCELED.
  *
- *  @retval     RC_SUCCESS                          The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
- *  @retval     RC_E_FAIL                           An unexpected error occurred.
- *  @retval     RC_E_PLATFORM_AUTH_NOT_EMPTY        In case PlatformAuth is not the Empty Buffer.
- *  @retval     RC_E_PLATFORM_HIERARCHY_DISABLED    In case platform hierarchy has been disabled.
- *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ *  @retval     RC_SUCCESS              The firmware update was canceled or no firmware update is in progress.
+ *  @retval     RC_E_NOT_READY          The firmware update cannot be canceled in its current state.
+ *  @retval     ...                     Error codes from FirmwareUpdate_AbandonUpdate.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_PrepareTPM20Policy(
-    _Out_ TSS_TPMI_SH_AUTH_SESSION * PphPolicySession)
+FirmwareUpdate_CancelUpdate()
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    TSS_TPMI_SH_AUTH_SESSION hPolicySession = 0;
+    unsigned int unReturnValue = RC_SUCCESS;
 
-    do
+    switch (s_sUpdateEngine.sStatus.unState)
     {
-        // Check parameters
-        if (NULL == PphPolicySession)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PphPolicySession is NULL)");
+        case UPDATE_STATE_IDLE:
+        case UPDATE_STATE_DONE:
             break;
-        }
-        *PphPolicySession = 0;
-
-        TSS_TPM2B_NONCE sNonceTpm;
-        TSS_TPM2B_NONCE sNonceCaller;
-
-        TSS_TPM2B_DIGEST sPolicyDigest;
-
-        // Authorization session area
-        TSS_AuthorizationCommandData sAuthSessionData;
-        TSS_AcknowledgmentResponseData sAckAuthSessionData;
-
-        Platform_MemorySet(&sNonceTpm, 0, sizeof(sNonceTpm));
-        Platform_MemorySet(&sNonceCaller, 0, sizeof(sNonceCaller));
-        Platform_MemorySet(&sPolicyDigest, 0, sizeof(sPolicyDigest));
-        Platform_MemorySet(&sAuthSessionData, 0, sizeof(sAuthSessionData));
-        Platform_MemorySet(&sAckAuthSessionData, 0, sizeof(sAckAuthSessionData));
-
-        sPolicyDigest.size = TSS_SHA256_DIGEST_SIZE;
-        unReturnValue = Platform_MemoryCopy(sPolicyDigest.buffer, sPolicyDigest.size, rgbTpm20FirmwareUpdatePolicyDigest, sPolicyDigest.size);
-        if (RC_SUCCESS != unReturnValue)
-        {
-            ERROR_STORE(unReturnValue, L"Platform_MemoryCopy returned an unexpected value while copying rgbTpm20FirmwareUpdatePolicyDigest.");
+        case UPDATE_STATE_VERIFY:
+        case UPDATE_STATE_PROBE:
+        case UPDATE_STATE_POLICY:
+        case UPDATE_STATE_START:
+            LOGGING_WRITE_LEVEL1(L"The firmware update was canceled before it was started.");
+            FirmwareUpdate_Engine_Complete(RC_E_UPDATE_CANCELED);
             break;
-        }
-
-        // Call TPM2_SetPrimaryPolicy command
-        sAuthSessionData.authHandle = TSS_TPM_RS_PW;    // Use password based authorization session
-        sAuthSessionData.sessionAttributes.continueSession = 1;
-        // sAuthSessionData.hmac.size = 0;          // Due to current Empty Buffer platform AuthSecret
-        // sAuthSessionData.nonceCaller.size = 0;   // Due to password based authorization session
-
-        // PolicyDigest.buffer: return value of TPM2_PolicyDigest
-        unReturnValue = TSS_TPM2_SetPrimaryPolicy(TSS_TPM_RH_PLATFORM, &sAuthSessionData, &sPolicyDigest, TSS_TPM_ALG_SHA256, &sAckAuthSessionData);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
-        {
-            if ((TSS_TPM_RC_HIERARCHY | TSS_TPM_RC_1) == (unReturnValue ^ RC_TPM_MASK))
+        case UPDATE_STATE_WAIT_BOOT_LOADER:
+        case UPDATE_STATE_MANIFEST:
+        case UPDATE_STATE_DATA:
+            if (!s_sUpdateEngine.sTpmState.attribs.tpmHasFULoader20)
             {
-                ERROR_STORE_FMT(RC_E_PLATFORM_HIERARCHY_DISABLED, L"TSS_TPM2_SetPrimaryPolicy returned that platform hierarchy is disabled. (0x%.8X)", unReturnValue);
-                unReturnValue = RC_E_PLATFORM_HIERARCHY_DISABLED;
+                unReturnValue = RC_E_NOT_READY;
+                ERROR_STORE(unReturnValue, L"A TPM1.2 firmware update cannot be canceled once it is started.");
                 break;
             }
-            else if ((TSS_TPM_RC_BAD_AUTH | TSS_TPM_RC_S | TSS_TPM_RC_1) == (unReturnValue ^ RC_TPM_MASK))
-            {
-                ERROR_STORE_FMT(RC_E_PLATFORM_AUTH_NOT_EMPTY, L"TSS_TPM2_SetPrimaryPolicy returned that platformAuth is not the EmptyBuffer. (0x%.8X)", unReturnValue);
-                unReturnValue = RC_E_PLATFORM_AUTH_NOT_EMPTY;
+            // Switch back to TPM operational mode, the transfer cannot be resumed anymore
+            unReturnValue = FirmwareUpdate_AbandonUpdate();
+            if (RC_SUCCESS != unReturnValue)
                 break;
-            }
-            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_SetPrimaryPolicy");
+            LOGGING_WRITE_LEVEL1(L"The firmware update was canceled and abandoned.");
+            FirmwareUpdate_Engine_Complete(RC_E_UPDATE_CANCELED);
             break;
-        }
+        default:
+            unReturnValue = RC_E_NOT_READY;
+            ERROR_STORE(unReturnValue, L"The firmware update cannot be canceled while it is finalized.");
+            break;
+    }
 
-        sNonceCaller.size = TSS_SHA256_DIGEST_SIZE;
-        unReturnValue = Crypt_GetRandom(sNonceCaller.size, sNonceCaller.buffer);
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Drives the firmware update engine until the firmware update is done
+ *  @details
+ *
+ *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PfPrepare               See FirmwareUpdate_StartUpdate.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     ...                     Error codes from FirmwareUpdate_StartUpdate and of the firmware update.
+ */
+static
+unsigned int
+FirmwareUpdate_DriveUpdate(
+    _In_    const IfxFirmwareUpdateData * const PpsFirmwareUpdateData,
+    _In_    BOOL                                PfPrepare)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unReturnValue = FirmwareUpdate_StartUpdate(PpsFirmwareUpdateData, PfPrepare);
         if (RC_SUCCESS != unReturnValue)
-        {
-            ERROR_STORE(unReturnValue, L"Error calling Crypt_GetRandom");
             break;
-        }
-
-        {
-            // Start policy session
-            TSS_TPM2B_ENCRYPTED_SECRET sEncSecretEmpty;
-            TSS_TPMT_SYM_DEF sSymDefEmpty;
-            Platform_MemorySet(&sEncSecretEmpty, 0, sizeof(sEncSecretEmpty));
-            Platform_MemorySet(&sSymDefEmpty, 0, sizeof(sSymDefEmpty));
-
-            sSymDefEmpty.algorithm = TSS_TPM_ALG_NULL;
-            unReturnValue = TSS_TPM2_StartAuthSession(TSS_TPM_RH_NULL,
-                            // Bind must be NULL, otherwise we'd have
-                            // to calculate AuthSessionData.hmac !!
-                            TSS_TPM_RH_NULL,
-                            &sNonceCaller, &sEncSecretEmpty,
-                            TSS_TPM_SE_POLICY, &sSymDefEmpty, TSS_TPM_ALG_SHA256,
-                            &hPolicySession, &sNonceTpm);
-            if (TSS_TPM_RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_StartAuthSession");
-                break;
-            }
-        }
 
+        for (;;)
         {
-            // Update policy session to include platformAuth
-            TSS_TPM2B_DIGEST sDigestEmpty;
-            TSS_TPM2B_NONCE sPolicyRef;
-            TSS_TPMT_TK_AUTH sPolicyTicket;
-            TSS_TPM2B_TIMEOUT sTimeout;
-            unsigned int unPlatformValue = Platform_SwapBytes32(TSS_TPM_RH_PLATFORM);
-
-            Platform_MemorySet(&sDigestEmpty, 0, sizeof(sDigestEmpty));
-            Platform_MemorySet(&sPolicyRef, 0, sizeof(sPolicyRef));
-            Platform_MemorySet(&sPolicyTicket, 0, sizeof(sPolicyTicket));
-            Platform_MemorySet(&sTimeout, 0, sizeof(sTimeout));
+            UPDATE_ENGINE_STATUS sStatus;
+            Platform_MemorySet(&sStatus, 0, sizeof(sStatus));
 
-            sPolicyRef.size = sizeof(unsigned int);
-            unReturnValue = Platform_MemoryCopy(sPolicyRef.buffer, sPolicyRef.size, (const void*) &unPlatformValue, sizeof(unPlatformValue));
+            unReturnValue = FirmwareUpdate_PollUpdate(&sStatus);
             if (RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE(unReturnValue, L"Unexpected return value from function call Platform_MemoryCopy");
                 break;
-            }
-
-            unReturnValue = TSS_TPM2_PolicySecret(TSS_TPM_RH_PLATFORM, &sAuthSessionData, hPolicySession, &sNonceTpm, &sDigestEmpty, &sPolicyRef, 0, &sTimeout, &sPolicyTicket, &sAckAuthSessionData);
-            if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            if (UPDATE_STATE_DONE == sStatus.unState)
             {
-                ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_PolicySecret");
+                unReturnValue = sStatus.unResult;
                 break;
             }
+            if (0 != sStatus.unNextPollMs)
+                Platform_Sleep(sStatus.unNextPollMs);
         }
-
-        // Update policy session to include command TPM2_FieldUpgradeStartVendor
-        unReturnValue = TSS_TPM2_PolicyCommandCode(hPolicySession, TPM2_CC_FieldUpgradeStartVendor);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
-        {
-            ERROR_STORE(unReturnValue, L"Error calling TSS_TPM2_PolicyCommandCode");
-            break;
-        }
-
-        *PphPolicySession = hPolicySession;
     }
     WHILE_FALSE_END;
 
-    // Try to close policy session in case of errors (only if session has already been started)
-    if (RC_SUCCESS != unReturnValue && 0 != hPolicySession)
-        IGNORE_RETURN_VALUE(TSS_TPM2_FlushContext(hPolicySession));
-
     return unReturnValue;
 }
 
 /**
- *  @brief      Function to issue TPM_FieldUpgrade_Start
- *  @details    This function initiates TPM Firmware Update via the TPM_FieldUpgrade_Start command depending on the current TPM Operation mode.
+ *  @brief      Function to update the firmware with the given firmware image
+ *  @details    This function updates the TPM firmware with the image given in the parameters.
+ *              A check if the firmware can be updated with the image is done before. The function drives the firmware
+ *              update engine (FirmwareUpdate_StartUpdate, FirmwareUpdate_PollUpdate) until the update is done.
  *
- *  @param      PbfTpmAttributes        The current TPM operation mode.
- *  @param      PpsIfxFirmwareImage     Pointer to structure containing the firmware image.
  *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
  *
  *  @retval     RC_SUCCESS                      The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. The parameter is NULL.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE           Policy parameter block is corrupt and/or cannot be unmarshalled.
+ *  @retval     RC_E_NO_IFX_TPM                 The TPM is not manufactured by Infineon.
+ *  @retval     RC_E_NOT_READY                  Another firmware update is in progress.
  *  @retval     RC_E_TPM12_MISSING_OWNERAUTH    The TPM has an owner but TPM Owner authorization was not provided (TPM1.2 only).
  *  @retval     RC_E_TPM12_NO_OWNER             The TPM does not have an owner but TPM Owner authorization was provided (TPM1.2 only).
  *  @retval     RC_E_FAIL                       TPM connection or command error.
  *  @retval     ...                             Error codes from called functions.
+ *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_Start(
-    _In_    BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
-    _In_    const IfxFirmwareImage * const      PpsIfxFirmwareImage,
-    _In_    const IfxFirmwareUpdateData * const PpsFirmwareUpdateData)
+FirmwareUpdate_UpdateImage(
+    _In_    const IfxFirmwareUpdateData * const  PpsFirmwareUpdateData)
+{
+    // The caller has checked the image and prepared the policy session already
+    return FirmwareUpdate_DriveUpdate(PpsFirmwareUpdateData, FALSE);
+}
+
+/**
+ *  @brief      Returns the pending firmware update plan
+ *  @details    The plan is read from the non-volatile platform storage. The function does not access the TPM.
+ *              unHopCount is 0 if no plan is pending.
+ *
+ *  @param      PpsPlan             Receives the pending firmware update plan.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetPendingUpdatePlan(
+    _Out_   UPDATE_PLAN_STATE*      PpsPlan)
 {
     unsigned int unReturnValue = RC_E_FAIL;
-    BOOL fUpdateStarted = FALSE;
 
-    // Check if firmware update was already started
-    if (!PbfTpmAttributes.tpmInOperationalMode)
+    do
     {
-        unReturnValue = RC_SUCCESS; // Continue firmware update
-        PpsFirmwareUpdateData->fnProgressCallback(0);
+        unsigned int unPlanSize = sizeof(*PpsPlan);
+
+        // Check parameters
+        if (NULL == PpsPlan)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsPlan is NULL)");
+            break;
+        }
+
+        // Ignore a missing plan, a plan with another layout and an inconsistent plan
+        if (RC_SUCCESS != Platform_NvStoreRead(UPDATE_PLAN_NAME, PpsPlan, &unPlanSize) ||
+                sizeof(*PpsPlan) != unPlanSize || UPDATE_PLAN_LAYOUT_VERSION != PpsPlan->unLayoutVersion ||
+                PpsPlan->unHopCount > UPDATE_PLAN_MAX_HOPS || PpsPlan->unNextHop >= PpsPlan->unHopCount)
+        {
+            Platform_MemorySet(PpsPlan, 0, sizeof(*PpsPlan));
+            PpsPlan->unLayoutVersion = UPDATE_PLAN_LAYOUT_VERSION;
+        }
+
+        unReturnValue = RC_SUCCESS;
     }
-    else if (PbfTpmAttributes.tpm20 && PbfTpmAttributes.infineon && !PbfTpmAttributes.tpm20restartRequired)
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks if a firmware image follows another one in a firmware update plan
+ *  @details    The target TPM family and version of the previous image must be an allowed source of the image.
+ *
+ *  @param      PpsPrevious         Unmarshalled previous firmware image.
+ *  @param      PpsNext             Unmarshalled firmware image.
+ *  @param      PpfFollows          Receives TRUE if the image can be applied after the previous one, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from FirmwareUpdate_IsSourceVersionAllowed.
+ */
+static
+unsigned int
+FirmwareUpdate_IsPlanHopChained(
+    _In_    const IfxFirmwareImage* PpsPrevious,
+    _In_    const IfxFirmwareImage* PpsNext,
+    _Out_   BOOL*                   PpfFollows)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+
+    do
     {
-        unReturnValue = FirmwareUpdate_Start_Tpm20(
-                            PbfTpmAttributes,
-                            PpsIfxFirmwareImage->rgbPolicyParameterBlock,
-                            PpsIfxFirmwareImage->usPolicyParameterBlockSize,
-                            PpsFirmwareUpdateData->unSessionHandle,
-                            PpsFirmwareUpdateData->fnProgressCallback);
-        fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+        wchar_t wszTargetVersion[RG_LEN(PpsPrevious->wszTargetVersion)];
+        wchar_t wszTargetVersionShort[RG_LEN(PpsPrevious->wszTargetVersion)];
+        unsigned int unLength = 0;
+        unsigned int unShortLength = 0;
+        unsigned int unIndex = 0;
+
+        *PpfFollows = FALSE;
+        if (PpsPrevious->bTargetTpmFamily != PpsNext->bSourceTpmFamily)
+            break;
+
+        // The target version of the previous image with subversion.minor (e.g. 4.40.119.0) and without it (e.g. 4.40.119)
+        Platform_MemorySet(wszTargetVersion, 0, sizeof(wszTargetVersion));
+        Platform_MemorySet(wszTargetVersionShort, 0, sizeof(wszTargetVersionShort));
+        for (unLength = 0; unLength < RG_LEN(wszTargetVersion) - 1 && L'\0' != PpsPrevious->wszTargetVersion[unLength]; unLength++)
+        {
+            wszTargetVersion[unLength] = PpsPrevious->wszTargetVersion[unLength];
+            wszTargetVersionShort[unLength] = PpsPrevious->wszTargetVersion[unLength];
+            if (L'.' == wszTargetVersion[unLength])
+                unShortLength = unLength;
+        }
+        for (unIndex = unShortLength; unIndex < unLength; unIndex++)
+            wszTargetVersionShort[unIndex] = L'\0';
+
+        unReturnValue = FirmwareUpdate_IsSourceVersionAllowed(PpsNext, wszTargetVersion, unLength, wszTargetVersionShort, unShortLength, PpfFollows);
     }
-    else if (PbfTpmAttributes.tpm12 && PbfTpmAttributes.infineon && !PbfTpmAttributes.unsupportedChip)
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Verifies the hops of a firmware update plan before any of them is applied
+ *  @details    The first hop is checked against the TPM like FirmwareUpdate_CheckImage. Every later hop is checked without
+ *              the TPM: the CRC and the signature must be valid (FirmwareUpdate_VerifyImageIntegrity) and the target TPM
+ *              family and version of the previous hop must be an allowed source of the hop.
+ *
+ *  @param      PrgsHops            Hops of the plan.
+ *  @param      PunHopCount         Number of hops (at most UPDATE_PLAN_MAX_HOPS).
+ *  @param      PunFirstHop         Index of the first hop to apply.
+ *  @param      PpunFailedHop       Receives the index of the first hop that cannot be applied, PunHopCount if all can.
+ *  @param      PpunErrorDetails    Receives RC_SUCCESS if all hops can be applied, otherwise the error details of the
+ *                                  failed hop (see FirmwareUpdate_CheckImage), RC_E_WRONG_FW_IMAGE if the hop does not
+ *                                  follow the previous hop.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_VerifyUpdatePlan(
+    _In_count_(PunHopCount) const UPDATE_PLAN_HOP*  PrgsHops,
+    _In_                    unsigned int            PunHopCount,
+    _In_                    unsigned int            PunFirstHop,
+    _Out_                   unsigned int*           PpunFailedHop,
+    _Out_                   unsigned int*           PpunErrorDetails)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
     {
-        if (PbfTpmAttributes.tpm12owner)
+        IfxFirmwareImage sPrevious;
+        IfxFirmwareImage sNext;
+        unsigned int unHop = 0;
+        Platform_MemorySet(&sPrevious, 0, sizeof(sPrevious));
+        Platform_MemorySet(&sNext, 0, sizeof(sNext));
+
+        // Check parameters
+        if (NULL == PrgsHops || 0 == PunHopCount || PunHopCount > UPDATE_PLAN_MAX_HOPS || PunFirstHop >= PunHopCount ||
+                NULL == PpunFailedHop || NULL == PpunErrorDetails)
         {
-            if (!PpsFirmwareUpdateData->fOwnerAuthProvided)
+            unReturnValue = RC_E_BAD_PARAMETER;
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgsHops, PpunFailedHop or PpunErrorDetails is NULL or PunHopCount or PunFirstHop is invalid)");
+            break;
+        }
+        *PpunFailedHop = PunFirstHop;
+        *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+
+        for (unHop = PunFirstHop; unHop < PunHopCount; unHop++)
+        {
+            BOOL fValid = FALSE;
+            BYTE* pbBuffer = PrgsHops[unHop].rgbImage;
+            int nBufferSize = (int)PrgsHops[unHop].unImageSize;
+            *PpunFailedHop = unHop;
+
+            if (NULL == PrgsHops[unHop].rgbImage || 0 == PrgsHops[unHop].unImageSize)
             {
-                unReturnValue = RC_E_TPM12_MISSING_OWNERAUTH;
-                ERROR_STORE(unReturnValue, L"TPM1.2 has an owner but TPM Owner authorization was not provided.");
+                unReturnValue = RC_E_BAD_PARAMETER;
+                ERROR_STORE_FMT(unReturnValue, L"Parameter not initialized correctly (image of hop %d is NULL or empty)", unHop);
+                break;
+            }
+
+            if (unHop == PunFirstHop)
+            {
+                // The first hop is applied to the TPM as it is now
+                BITFIELD_NEW_TPM_FIRMWARE_INFO bfNewTpmFirmwareInfo;
+                Platform_MemorySet(&bfNewTpmFirmwareInfo, 0, sizeof(bfNewTpmFirmwareInfo));
+                unReturnValue = FirmwareUpdate_CheckImage(PrgsHops[unHop].rgbImage, PrgsHops[unHop].unImageSize, &fValid, &bfNewTpmFirmwareInfo, PpunErrorDetails);
             }
             else
             {
-                unReturnValue = FirmwareUpdate_Start_Tpm12(
-                                    PbfTpmAttributes,
-                                    PpsIfxFirmwareImage->rgbPolicyParameterBlock,
-                                    PpsIfxFirmwareImage->usPolicyParameterBlockSize,
-                                    PpsFirmwareUpdateData->rgbOwnerAuthHash,
-                                    PpsFirmwareUpdateData->fnProgressCallback);
-                fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+                // Later hops are applied to the firmware installed by the previous hop
+                unReturnValue = FirmwareUpdate_VerifyImageIntegrity(PrgsHops[unHop].rgbImage, PrgsHops[unHop].unImageSize, &fValid, PpunErrorDetails);
             }
-        }
-        else
-        {
-            if (PpsFirmwareUpdateData->fOwnerAuthProvided)
+            if (RC_SUCCESS != unReturnValue || !fValid)
+                break;
+
+            unReturnValue = FirmwareImage_Unmarshal(&sNext, &pbBuffer, &nBufferSize);
+            if (RC_SUCCESS != unReturnValue)
             {
-                unReturnValue = RC_E_TPM12_NO_OWNER;
-                ERROR_STORE(unReturnValue, L"TPM1.2 does not have an owner but TPM Owner authorization was provided.");
+                unReturnValue = RC_SUCCESS;
+                *PpunErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+                break;
             }
-            else
+
+            if (unHop != PunFirstHop)
             {
-                unReturnValue = FirmwareUpdate_Start_Tpm12(
-                                    PbfTpmAttributes,
-                                    PpsIfxFirmwareImage->rgbPolicyParameterBlock,
-                                    PpsIfxFirmwareImage->usPolicyParameterBlockSize,
-                                    PpsFirmwareUpdateData->rgbOwnerAuthHash,
-                                    PpsFirmwareUpdateData->fnProgressCallback);
-                fUpdateStarted = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
+                unReturnValue = FirmwareUpdate_IsPlanHopChained(&sPrevious, &sNext, &fValid);
+                if (RC_SUCCESS != unReturnValue || !fValid)
+                {
+                    ERROR_STORE_FMT(RC_E_WRONG_FW_IMAGE, L"Hop %d of the firmware update plan does not follow the previous hop.", unHop);
+                    unReturnValue = RC_SUCCESS;
+                    *PpunErrorDetails = RC_E_WRONG_FW_IMAGE;
+                    break;
+                }
             }
+
+            sPrevious = sNext;
+            *PpunErrorDetails = RC_SUCCESS;
         }
-    }
-    else
-    {
-        ERROR_STORE_FMT(unReturnValue, L"Error: Unexpected TPM state attributes were recognized. (Mode: 0x%.8X)", PbfTpmAttributes);
-    }
+        if (RC_SUCCESS != unReturnValue || RC_SUCCESS != *PpunErrorDetails)
+            break;
 
-    // Invoke the callback function if firmware update was started and TPM is about to switch to boot loader mode.
-    if (fUpdateStarted && NULL != PpsFirmwareUpdateData->fnUpdateStartedCallback)
-    {
-        PpsFirmwareUpdateData->fnUpdateStartedCallback();
+        *PpunFailedHop = PunHopCount;
     }
+    WHILE_FALSE_END;
 
     return unReturnValue;
 }
 
 /**
- *  @brief      Function to update the firmware with the given firmware image
- *  @details    This function updates the TPM firmware with the image given in the parameters.
- *              A check if the firmware can be updated with the image is done before.
+ *  @brief      Applies a firmware update plan
+ *  @details    All remaining hops are verified (FirmwareUpdate_VerifyUpdatePlan) before the first one is applied. The hops
+ *              are then applied back to back, each one with the firmware update engine including the image check and the
+ *              default TPM2.0 policy session. If the TPM must be restarted after a hop, the remaining plan is stored (see
+ *              UPDATE_PLAN_NAME) and RC_E_RESTART_REQUIRED is returned. Running the plan with the same images after the
+ *              restart continues with the next hop. The stored plan is removed when the last hop has been applied.
  *
- *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PrgsHops            Hops of the plan.
+ *  @param      PunHopCount         Number of hops (at most UPDATE_PLAN_MAX_HOPS).
+ *  @param      PfnProgress         Callback function to indicate the progress of each hop.
+ *  @param      PpunNextHop         Receives the index of the hop that failed or that is applied after the restart,
+ *                                  PunHopCount if the plan is complete.
  *
- *  @retval     RC_SUCCESS                      The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER              An invalid parameter was passed to the function. The parameter is NULL.
- *  @retval     RC_E_CORRUPT_FW_IMAGE           Policy parameter block is corrupt and/or cannot be unmarshalled.
- *  @retval     RC_E_NO_IFX_TPM                 The TPM is not manufactured by Infineon.
- *  @retval     RC_E_TPM12_MISSING_OWNERAUTH    The TPM has an owner but TPM Owner authorization was not provided (TPM1.2 only).
- *  @retval     RC_E_TPM12_NO_OWNER             The TPM does not have an owner but TPM Owner authorization was provided (TPM1.2 only).
- *  @retval     RC_E_FAIL                       TPM connection or command error.
- *  @retval     ...                             Error codes from called functions.
- *  @retval     RC_E_FIRMWARE_UPDATE_FAILED     The update operation was started but failed.
+ *  @retval     RC_SUCCESS              All hops have been applied.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_RESTART_REQUIRED   The TPM must be restarted before the next hop.
+ *  @retval     ...                     Error details of a hop that cannot be applied (see FirmwareUpdate_VerifyUpdatePlan)
+ *                                      or error codes of the firmware update.
  */
 _Check_return_
 unsigned int
-FirmwareUpdate_UpdateImage(
-    _In_    const IfxFirmwareUpdateData * const  PpsFirmwareUpdateData)
+FirmwareUpdate_RunUpdatePlan(
+    _In_count_(PunHopCount) const UPDATE_PLAN_HOP*              PrgsHops,
+    _In_                    unsigned int                        PunHopCount,
+    _In_                    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress,
+    _Out_                   unsigned int*                       PpunNextHop)
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
     do
     {
+        UPDATE_PLAN_STATE sPlan;
+        UPDATE_PLAN_STATE sPending;
+        unsigned int unHop = 0;
+        unsigned int unErrorDetails = RC_E_FAIL;
+        Platform_MemorySet(&sPlan, 0, sizeof(sPlan));
+
         // Check parameters
-        if (NULL == PpsFirmwareUpdateData)
+        if (NULL == PrgsHops || 0 == PunHopCount || PunHopCount > UPDATE_PLAN_MAX_HOPS || NULL == PfnProgress || NULL == PpunNextHop)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
-            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PpsFirmwareUpdateData is NULL)");
+            ERROR_STORE(unReturnValue, L"Parameter not initialized correctly (PrgsHops, PfnProgress or PpunNextHop is NULL or PunHopCount is invalid)");
             break;
         }
+        *PpunNextHop = 0;
 
-        TPM_STATE sTpmState;
-        IfxFirmwareImage sIfxFirmwareImage;
-        int nBufferSize = (int)PpsFirmwareUpdateData->unFirmwareImageSize;
-        BYTE* pbBuffer = PpsFirmwareUpdateData->rgbFirmwareImage;
-        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
-        Platform_MemorySet(&sIfxFirmwareImage, 0, sizeof(sIfxFirmwareImage));
+        sPlan.unLayoutVersion = UPDATE_PLAN_LAYOUT_VERSION;
+        sPlan.unHopCount = PunHopCount;
+        for (unHop = 0; unHop < PunHopCount; unHop++)
+        {
+            sPlan.rgunFingerprint[unHop] = NULL == PrgsHops[unHop].rgbImage ? 0 : FirmwareUpdate_GetImageFingerprint(PrgsHops[unHop].rgbImage, PrgsHops[unHop].unImageSize);
+            sPlan.rgunImageSize[unHop] = PrgsHops[unHop].unImageSize;
+        }
 
-        // Get TPM operation mode
-        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+        // Continue a stored plan with the same images after the TPM restart
+        unReturnValue = FirmwareUpdate_GetPendingUpdatePlan(&sPending);
         if (RC_SUCCESS != unReturnValue)
             break;
-
-        // Check if the recognized TPM is from an unsupported vendor and return the appropriate value.
-        if (!sTpmState.attribs.infineon)
+        if (sPending.unHopCount == sPlan.unHopCount &&
+                0 == Platform_MemoryCompare(sPending.rgunFingerprint, sPlan.rgunFingerprint, sizeof(sPlan.rgunFingerprint)) &&
+                0 == Platform_MemoryCompare(sPending.rgunImageSize, sPlan.rgunImageSize, sizeof(sPlan.rgunImageSize)))
         {
-            unReturnValue = RC_E_NO_IFX_TPM;
-            ERROR_STORE(unReturnValue, L"Unsupported TPM vendor.");
-            break;
+            sPlan.unNextHop = sPending.unNextHop;
+            LOGGING_WRITE_LEVEL2_FMT(L"Continuing the firmware update plan with hop %d of %d", sPlan.unNextHop + 1, sPlan.unHopCount);
         }
+        *PpunNextHop = sPlan.unNextHop;
 
-        // Unmarshal the firmware image structure
-        unReturnValue = FirmwareImage_Unmarshal(&sIfxFirmwareImage, &pbBuffer, &nBufferSize);
+        // Nothing is sent to the TPM unless all remaining hops can be applied
+        unReturnValue = FirmwareUpdate_VerifyUpdatePlan(PrgsHops, PunHopCount, sPlan.unNextHop, PpunNextHop, &unErrorDetails);
         if (RC_SUCCESS != unReturnValue)
+            break;
+        if (RC_SUCCESS != unErrorDetails)
         {
-            ERROR_STORE(RC_E_CORRUPT_FW_IMAGE, L"Firmware image cannot be parsed. (0x%.8X)");
-            unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            unReturnValue = unErrorDetails;
             break;
         }
+        *PpunNextHop = sPlan.unNextHop;
 
-        if (sTpmState.attribs.tpmHasFULoader20)
+        while (sPlan.unNextHop < sPlan.unHopCount)
         {
-            // Select correct manifest
-            unReturnValue = FirmwareUpdate_SelectManifest(&sIfxFirmwareImage);
+            IfxFirmwareUpdateData sFirmwareUpdateData;
+            TPM_STATE sTpmState;
+            Platform_MemorySet(&sFirmwareUpdateData, 0, sizeof(sFirmwareUpdateData));
+            Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+            // Keep the plan while a hop is applied, so an interrupted hop is repeated after the restart
+            unReturnValue = Platform_NvStoreWrite(UPDATE_PLAN_NAME, &sPlan, sizeof(sPlan));
             if (RC_SUCCESS != unReturnValue)
             {
-                ERROR_STORE(unReturnValue, L"FirmwareUpdate_SelectManifest returned an error");
+                ERROR_STORE_FMT(unReturnValue, L"Platform_NvStoreWrite(%ls) failed.", UPDATE_PLAN_NAME);
                 break;
             }
-        }
-
-        // Perform the firmware update
-        // Start the firmware update
-        unReturnValue = FirmwareUpdate_Start(sTpmState.attribs, &sIfxFirmwareImage, PpsFirmwareUpdateData);
-        if (RC_SUCCESS != unReturnValue)
-            break;
 
-        if (sTpmState.attribs.tpmHasFULoader20)
-        {
-            // Transfer manifest and new firmware data to TPM
-            unReturnValue = FirmwareUpdate_UpdateTpm20(&sIfxFirmwareImage, PpsFirmwareUpdateData);
+            LOGGING_WRITE_LEVEL2_FMT(L"Applying hop %d of %d of the firmware update plan", sPlan.unNextHop + 1, sPlan.unHopCount);
+            sFirmwareUpdateData.rgbFirmwareImage = PrgsHops[sPlan.unNextHop].rgbImage;
+            sFirmwareUpdateData.unFirmwareImageSize = PrgsHops[sPlan.unNextHop].unImageSize;
+            sFirmwareUpdateData.fnProgressCallback = PfnProgress;
+            unReturnValue = FirmwareUpdate_DriveUpdate(&sFirmwareUpdateData, TRUE);
             if (RC_SUCCESS != unReturnValue)
                 break;
-        }
-        else
-        {
-            // Transfer new firmware data to TPM
-            unReturnValue = FirmwareUpdate_Update(sIfxFirmwareImage.unFirmwareSize, sIfxFirmwareImage.rgbFirmware, PpsFirmwareUpdateData->fnProgressCallback);
-            if (RC_SUCCESS != unReturnValue)
+
+            sPlan.unNextHop++;
+            *PpunNextHop = sPlan.unNextHop;
+            if (sPlan.unNextHop == sPlan.unHopCount)
                 break;
 
-            // Finalize the firmware update
-            unReturnValue = FirmwareUpdate_Complete(PpsFirmwareUpdateData->fnProgressCallback);
-            if (RC_SUCCESS != unReturnValue)
+            // The next hop needs the new firmware running
+            unReturnValue = FirmwareUpdate_CalculateState(FALSE, &sTpmState);
+            if (RC_SUCCESS != unReturnValue || sTpmState.attribs.tpm20restartRequired)
+            {
+                unReturnValue = Platform_NvStoreWrite(UPDATE_PLAN_NAME, &sPlan, sizeof(sPlan));
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    ERROR_STORE_FMT(unReturnValue, L"Platform_NvStoreWrite(%ls) failed.", UPDATE_PLAN_NAME);
+                    break;
+                }
+                unReturnValue = RC_E_RESTART_REQUIRED;
+                LOGGING_WRITE_LEVEL2_FMT(L"The TPM must be restarted before hop %d of the firmware update plan", sPlan.unNextHop + 1);
                 break;
+            }
         }
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
-        unReturnValue = RC_SUCCESS;
+        // The plan is complete
+        Platform_MemorySet(&sPlan, 0, sizeof(sPlan));
+        sPlan.unLayoutVersion = UPDATE_PLAN_LAYOUT_VERSION;
+        if (RC_SUCCESS != Platform_NvStoreWrite(UPDATE_PLAN_NAME, &sPlan, sizeof(sPlan)))
+            LOGGING_WRITE_LEVEL2_FMT(L"Platform_NvStoreWrite(%ls) failed.", UPDATE_PLAN_NAME);
     }
     WHILE_FALSE_END;
 
@@ -3339,6 +6504,7 @@ FirmwareUpdate_UpdateImage(
  *
  *  @retval     RC_SUCCESS                      The operation completed successfully.
  *  @retval     RC_E_FAIL                       An internal error occurred.
+ *  @retval     RC_E_UNSUPPORTED_CHIP           TPM1.2 support is not included in the build (IFXTPMUPDATE_TPM20_ONLY).
  *  @retval     ...                             Error codes from called functions.
  */
 _Check_return_
@@ -3346,6 +6512,11 @@ unsigned int
 FirmwareUpdate_CheckOwnerAuthorization(
     _In_bytecount_(TSS_SHA1_DIGEST_SIZE)    const BYTE  PrgbOwnerAuthHash[TSS_SHA1_DIGEST_SIZE])
 {
+#ifdef IFXTPMUPDATE_TPM20_ONLY
+    UNREFERENCED_PARAMETER(PrgbOwnerAuthHash);
+    ERROR_STORE(RC_E_UNSUPPORTED_CHIP, L"TPM1.2 Owner authorization is not supported by this build.");
+    return RC_E_UNSUPPORTED_CHIP;
+#else
     unsigned int unReturnValue = RC_E_FAIL;
     do
     {
@@ -3424,4 +6595,5 @@ FirmwareUpdate_CheckOwnerAuthorization(
     WHILE_FALSE_END;
 
     return unReturnValue;
+#endif
 }
@@ -29,10 +29,33 @@ extern "C" {
 /// Default wait time in milliseconds after sending TPM_FieldUpgrade_Complete before continuing to give TPM time to finish.
 #define TPM_FU_COMPLETE_WAIT_TIME 2000
 
+/// Interval in milliseconds in between two checks whether TPM1.2 switched to boot loader mode (upper limit of the backoff).
+#define TPM_FU_PROBE_INTERVAL 100
+/// First interval in milliseconds in between two checks whether TPM1.2 switched to boot loader mode. The interval is doubled per check up to TPM_FU_PROBE_INTERVAL.
+#define TPM_FU_PROBE_INTERVAL_FIRST 20
+/// Overall time in milliseconds to wait for TPM1.2 to switch to boot loader mode (same overall time as TPM_FU_START_MAX_RETRIES * TPM_FU_START_RETRY_WAIT_TIME).
+#define TPM_FU_START_WAIT_BUDGET (TPM_FU_START_MAX_RETRIES * TPM_FU_START_RETRY_WAIT_TIME)
+
 /// Default retry count (TPM2.0 based firmware update)
 #define TPM20_FU_RETRY_COUNT 5
 /// Default wait time in milliseconds (TPM2.0 based firmware update)
 #define TPM20_FU_WAIT_TIME 1000
+/// Interval in milliseconds in between two probes of the TPM interface while waiting for a mode switch (TPM2.0 based firmware update).
+/// The overall time to wait is TPM20_FU_RETRY_COUNT * TPM20_FU_WAIT_TIME.
+#define TPM20_FU_PROBE_INTERVAL 50
+/// Name of the non-volatile value holding the firmware transfer checkpoint (TPM2.0 based firmware update)
+#define TPM20_FU_CHECKPOINT_NAME L"IfxTpmFuCheckpoint"
+/// Maximum number of attempts to resend a firmware block after a transmission error (TPM2.0 based firmware update)
+#define TPM20_FU_BLOCK_MAX_RETRIES 3
+/// Calibrated latency in microseconds of one block of TSS_MAX_DIGEST_BUFFER bytes (TPM2.0 based firmware update, used until a transfer was measured)
+#define TPM20_FU_ESTIMATE_BLOCK_LATENCY_US 45000
+/// Calibrated latency in microseconds of one block of TSS_MAX_DIGEST_BUFFER bytes (TPM1.2 based firmware update, used until a transfer was measured)
+#define TPM_FU_ESTIMATE_BLOCK_LATENCY_US 90000
+
+/// Maximum number of TPM2.0 properties held by the TPM property map
+#define TPM_PROPERTY_MAP_SIZE 16
+/// Maximum number of value bytes of a vendor property held by the TPM property map
+#define TPM_PROPERTY_MAP_MAX_VALUE 16
 
 /// This value is the policy for TPM20 firmware update
 static const BYTE rgbTpm20FirmwareUpdatePolicyDigest[] = {0x6D, 0x9B, 0x4B, 0x75, 0x61, 0xCA, 0xC7, 0x7B,
@@ -120,8 +143,44 @@ typedef struct tdTPM_STATE
     unsigned int unTestResultLen;
     /// TPM attributes
     BITFIELD_TPM_ATTRIBUTES attribs;
+    /// TRUE if unKeyGroupId has been read from the TPM (see FirmwareUpdate_GetTpmKeyGroupId)
+    BOOL fKeyGroupIdValid;
+    /// Key group ID of the TPM (only TPM2.0 based firmware update)
+    unsigned int unKeyGroupId;
 } TPM_STATE;
 
+/**
+ *  @brief      Entry of the TPM property map
+ *  @details    Holds a TPM2.0 property read with TPM2_GetCapability.
+ */
+typedef struct tdTPM_PROPERTY_MAP_ENTRY
+{
+    /// Capability (TSS_TPM_CAP_TPM_PROPERTIES or TSS_TPM_CAP_VENDOR_PROPERTY)
+    TSS_TPM_CAP capability;
+    /// Property identifier
+    TSS_UINT32 unProperty;
+    /// Property value (TSS_TPM_CAP_TPM_PROPERTIES only)
+    TSS_UINT32 unValue;
+    /// Size of the property value in bytes as returned by the TPM (TSS_TPM_CAP_VENDOR_PROPERTY only)
+    TSS_UINT16 usSize;
+    /// Property value bytes, at most TPM_PROPERTY_MAP_MAX_VALUE (TSS_TPM_CAP_VENDOR_PROPERTY only)
+    TSS_BYTE rgbValue[TPM_PROPERTY_MAP_MAX_VALUE];
+} TPM_PROPERTY_MAP_ENTRY;
+
+/**
+ *  @brief      TPM property map
+ *  @details    Caches TPM2.0 properties for one TPM state generation (see DeviceManagement_GetTpmStateGeneration).
+ */
+typedef struct tdTPM_PROPERTY_MAP
+{
+    /// TPM state generation of the entries
+    unsigned int unGeneration;
+    /// Number of entries
+    unsigned int unCount;
+    /// Entries
+    TPM_PROPERTY_MAP_ENTRY rgsEntries[TPM_PROPERTY_MAP_SIZE];
+} TPM_PROPERTY_MAP;
+
 /**
  *  @brief      TPM firmware version
  *  @details    TPM firmware version
@@ -158,6 +217,372 @@ typedef struct tdBITFIELD_NEW_TPM_FIRMWARE_INFO
     unsigned int fwRecovery : 1;
 } BITFIELD_NEW_TPM_FIRMWARE_INFO;
 
+/**
+ *  @brief      Firmware image integrity cache
+ *  @details    Holds the outcome of the last CRC and signature check of a firmware image. The outcome does not depend on the
+ *              TPM state and is valid as long as the image is unchanged. The entry is identified by the image address, size
+ *              and fingerprint.
+ */
+typedef struct tdIMAGE_INTEGRITY_CACHE
+{
+    /// Flag indicating the entry is filled
+    BOOL fValid;
+    /// Address of the image
+    const BYTE* pbImage;
+    /// Size of the image in bytes
+    unsigned long long ullImageSize;
+    /// Fingerprint of the image (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int unFingerprint;
+    /// Check outcome: RC_SUCCESS in case CRC and signature are valid, RC_E_CORRUPT_FW_IMAGE or RC_E_NEWER_TOOL_REQUIRED otherwise
+    unsigned int unErrorDetails;
+    /// SHA-256 digest of the firmware block
+    BYTE rgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE];
+    /// Flag indicating rgbFirmwareDigest is filled
+    BOOL fFirmwareDigestValid;
+} IMAGE_INTEGRITY_CACHE;
+
+/**
+ *  @brief      Firmware image checksum task
+ *  @details    Input and result of the CRC and digest calculation started by FirmwareUpdate_StartImageIntegrityCheck on
+ *              an application processor. The result is consumed by the next integrity check of the same image.
+ */
+typedef struct tdIMAGE_CHECKSUM_TASK
+{
+    /// Flag indicating the calculation is running
+    BOOL fPending;
+    /// Flag indicating the calculation has finished and the result has not been consumed yet
+    BOOL fDone;
+    /// Address of the image
+    const BYTE* pbImage;
+    /// Size of the image in bytes
+    unsigned long long ullImageSize;
+    /// Fingerprint of the image (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int unFingerprint;
+    /// Number of bytes covered by the CRC
+    unsigned int unCrcDataSize;
+    /// Number of bytes covered by the signature digest
+    unsigned int unSignedDataSize;
+    /// Offset of the firmware block in the image
+    unsigned int unFirmwareOffset;
+    /// Size of the firmware block, 0 if its digest is not calculated
+    unsigned int unFirmwareSize;
+    /// Return value of FirmwareUpdate_CalculateImageChecksums
+    unsigned int unReturnValue;
+    /// CRC value
+    unsigned int unCRC;
+    /// SHA-256 digest of the signed part of the image
+    BYTE rgbSignedDataDigest[TSS_SHA256_DIGEST_SIZE];
+    /// SHA-256 digest of the firmware block
+    BYTE rgbFirmwareDigest[TSS_SHA256_DIGEST_SIZE];
+} IMAGE_CHECKSUM_TASK;
+
+/**
+ *  @brief      Update duration estimate
+ *  @details    Estimates the duration of a firmware update with a checked image (see FirmwareUpdate_GetUpdateDurationEstimate).
+ *              The estimate is the number of blocks times the per-block latency plus the fixed waits for the mode switches.
+ */
+typedef struct tdUPDATE_DURATION_ESTIMATE
+{
+    /// TRUE if the estimate is available
+    BOOL fValid;
+    /// TRUE if the per-block latency was measured during a firmware transfer, FALSE if the calibrated value is used
+    BOOL fMeasured;
+    /// Number of manifest blocks (TPM2.0) respectively policy parameter blocks (TPM1.2)
+    unsigned int unManifestBlocks;
+    /// Number of firmware blocks
+    unsigned int unFirmwareBlocks;
+    /// Size of a block in bytes
+    unsigned int unBlockSize;
+    /// Latency of a block in microseconds
+    unsigned int unBlockLatencyUs;
+    /// Sum of the fixed waits for the mode switches in milliseconds
+    unsigned int unFixedWaitMs;
+    /// Estimated duration of the firmware update in milliseconds
+    unsigned int unTotalMs;
+} UPDATE_DURATION_ESTIMATE;
+
+/**
+ *  @brief      TPM state for the selection of a firmware image
+ *  @details    Read once by FirmwareUpdate_ProbeImageSelection and matched against the header of each candidate image by
+ *              FirmwareUpdate_MatchImageHeader, so selecting an image from many candidates costs a single TPM probe.
+ */
+typedef struct tdIMAGE_SELECTION_PROBE
+{
+    /// TPM state attributes
+    BITFIELD_TPM_ATTRIBUTES attribs;
+    /// TRUE if the firmware version has been read (TPM in operational mode or TPM2.0 firmware loader)
+    BOOL fVersionValid;
+    /// Firmware version with subversion.minor (e.g. 4.40.119.0)
+    wchar_t wszFirmwareVersion[MAX_NAME];
+    /// Length of wszFirmwareVersion in elements (without null-termination)
+    unsigned int unFirmwareVersionLength;
+    /// Firmware version without subversion.minor (e.g. 4.40.119)
+    wchar_t wszFirmwareVersionShort[MAX_NAME];
+    /// Length of wszFirmwareVersionShort in elements (without null-termination)
+    unsigned int unFirmwareVersionShortLength;
+} IMAGE_SELECTION_PROBE;
+
+/**
+ *  @brief      Platform hierarchy state cache
+ *  @details    Holds the outcome of the TPM2_HierarchyChangeAuth(TPM_RH_PLATFORM) probe of FirmwareUpdate_CalculateState for
+ *              the current TPM boot. Unlike the TPM state snapshot it survives other TPM commands and is only dropped when the
+ *              TPM has been restarted (TPM2_Startup succeeded) or a firmware update has been started.
+ */
+typedef struct tdPLATFORM_HIERARCHY_CACHE
+{
+    /// Flag indicating the platform hierarchy has been probed since the last TPM restart
+    BOOL fValid;
+    /// platformAuth is the Empty Buffer and the platform hierarchy is enabled
+    BOOL fEmptyPlatformAuth;
+    /// The platform hierarchy is disabled
+    BOOL fDisabled;
+} PLATFORM_HIERARCHY_CACHE;
+
+/**
+ *  @brief      Verified firmware image cache
+ *  @details    Holds the parse result and the verification outcome of the last image checked by FirmwareUpdate_CheckImage.
+ *              The entry is identified by the image address, size and fingerprint. The verification outcome is only valid
+ *              for one TPM state generation (see DeviceManagement_GetTpmStateGeneration), the parse result as long as the
+ *              image is unchanged.
+ */
+typedef struct tdVERIFIED_IMAGE_CACHE
+{
+    /// Flag indicating the entry is filled
+    BOOL fValid;
+    /// Address of the image
+    const BYTE* pbImage;
+    /// Size of the image in bytes
+    unsigned long long ullImageSize;
+    /// Fingerprint of the image (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int unFingerprint;
+    /// TPM state generation of the verification outcome
+    unsigned int unGeneration;
+    /// Unmarshalled image
+    IfxFirmwareImage sFirmwareImage;
+    /// Verification outcome: TRUE in case the image is valid
+    BOOL fImageValid;
+    /// Verification outcome: info data for the new firmware image
+    BITFIELD_NEW_TPM_FIRMWARE_INFO bfNewTpmFirmwareInfo;
+    /// Verification outcome: error details
+    unsigned int unErrorDetails;
+    /// Verification outcome: update duration estimate
+    UPDATE_DURATION_ESTIMATE sDurationEstimate;
+} VERIFIED_IMAGE_CACHE;
+
+/**
+ *  @brief      Firmware transfer checkpoint
+ *  @details    Records the start of the TPM2.0 firmware data transfer in the non-volatile platform storage (see TPM20_FU_CHECKPOINT_NAME).
+ *              The checkpoint identifies the TPM instance and the image by its size and fingerprint. It is written once when the
+ *              data transfer starts and deleted once the update is finalized or abandoned.
+ */
+typedef struct tdFIRMWARE_TRANSFER_CHECKPOINT
+{
+    /// TPM instance (see DeviceManagement_SelectInstance)
+    unsigned int unInstance;
+    /// Fingerprint of the image (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int unFingerprint;
+    /// Size of the image in bytes
+    unsigned int unImageSize;
+    /// Size of the firmware blocks in bytes
+    unsigned int unBlockSize;
+} FIRMWARE_TRANSFER_CHECKPOINT;
+
+/// This value indicates that the estimated time to completion of a firmware transfer is unknown
+#define TRANSFER_TELEMETRY_UNKNOWN (unsigned int)(-1)
+
+/**
+ *  @brief      Firmware transfer telemetry
+ *  @details    Describes the progress of the current or last firmware transfer (see FirmwareUpdate_GetTransferTelemetry).
+ *              Throughput values are in bytes per second and are updated whenever the TPM acknowledges a firmware block.
+ */
+typedef struct tdFIRMWARE_TRANSFER_TELEMETRY
+{
+    /// TRUE while the firmware blocks are sent
+    BOOL fActive;
+    /// Number of firmware bytes to send
+    unsigned int unTotalBytes;
+    /// Number of firmware bytes acknowledged by the TPM
+    unsigned int unBytesSent;
+    /// Number of firmware blocks acknowledged by the TPM
+    unsigned int unBlocksAcknowledged;
+    /// Throughput of the last acknowledged block
+    unsigned int unCurrentThroughput;
+    /// Average throughput since the transfer started
+    unsigned int unAverageThroughput;
+    /// Time since the transfer started in milliseconds (at the last acknowledged block)
+    unsigned int unElapsedMs;
+    /// Estimated time to completion in milliseconds or TRANSFER_TELEMETRY_UNKNOWN
+    unsigned int unEstimatedRemainingMs;
+} FIRMWARE_TRANSFER_TELEMETRY;
+
+/// Phases of a firmware update measured by FirmwareUpdate_PhaseTimingSwitch
+/// Image integrity and consistency checks on the host (CRC, signature, FirmwareUpdate_CheckImage)
+#define UPDATE_PHASE_VERIFY         0
+/// Determination of the TPM state (FirmwareUpdate_CalculateState)
+#define UPDATE_PHASE_STATE          1
+/// Start and completion of the TPM2.0 policy session
+#define UPDATE_PHASE_POLICY         2
+/// Start of the field upgrade (TPM2_FieldUpgradeStartVendor or TPM_FieldUpgrade start)
+#define UPDATE_PHASE_START          3
+/// Wait for the TPM to switch to boot loader mode
+#define UPDATE_PHASE_BOOT_LOADER    4
+/// Transfer of the manifest
+#define UPDATE_PHASE_MANIFEST       5
+/// Transfer of the firmware blocks
+#define UPDATE_PHASE_FIRMWARE       6
+/// Wait for the TPM to switch to the mode before finalize and finalization of the field upgrade
+#define UPDATE_PHASE_FINALIZE       7
+/// Number of measured phases
+#define UPDATE_PHASE_COUNT          8
+/// No phase is measured
+#define UPDATE_PHASE_NONE           (unsigned int)(-1)
+
+/**
+ *  @brief      Firmware update phase timing
+ *  @details    Describes the time spent in each phase of the current or last firmware update (see FirmwareUpdate_GetPhaseTiming).
+ *              The times are measured with the monotonic tick source of the platform.
+ */
+typedef struct tdUPDATE_PHASE_TIMING
+{
+    /// Phase measured at the moment (UPDATE_PHASE_NONE if no firmware update is running)
+    unsigned int unCurrentPhase;
+    /// Time spent in each phase in microseconds, indexed by UPDATE_PHASE_VERIFY, ...
+    unsigned long long rgullPhaseUs[UPDATE_PHASE_COUNT];
+    /// Time since the phase timing was reset in microseconds (at the last phase switch)
+    unsigned long long ullTotalUs;
+} UPDATE_PHASE_TIMING;
+
+/// Name of the firmware update history in the non-volatile platform storage
+#define UPDATE_HISTORY_NAME L"IfxTpmFuHistory"
+/// Number of firmware update attempts kept in the firmware update history
+#define UPDATE_HISTORY_SIZE 8
+/// Capacity of the version strings of a firmware update history entry in elements (including null-termination)
+#define UPDATE_HISTORY_VERSION_SIZE 16
+/// Layout version of the firmware update history, a stored history with another layout version is discarded
+#define UPDATE_HISTORY_LAYOUT_VERSION 1
+
+/**
+ *  @brief      Entry of the firmware update history
+ *  @details    Describes one firmware update attempt of the firmware update engine.
+ */
+typedef struct tdUPDATE_HISTORY_ENTRY
+{
+    /// Sequence number of the attempt, counting from 1
+    unsigned int unSequence;
+    /// Result of the firmware update (RC_SUCCESS or error code)
+    unsigned int unResult;
+    /// Engine state in which the firmware update failed (UPDATE_STATE_VERIFY, ...) or UPDATE_STATE_DONE
+    unsigned int unLastState;
+    /// Fingerprint of the image (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int unFingerprint;
+    /// Size of the image in bytes
+    unsigned int unImageSize;
+    /// Number of firmware blocks acknowledged by the TPM
+    unsigned int unBlockCount;
+    /// Number of resent firmware blocks
+    unsigned int unBlockRetries;
+    /// Firmware version of the TPM before the firmware update (empty if it could not be read)
+    wchar_t wszSourceVersion[UPDATE_HISTORY_VERSION_SIZE];
+    /// Target firmware version of the image (empty if the image could not be parsed)
+    wchar_t wszTargetVersion[UPDATE_HISTORY_VERSION_SIZE];
+    /// Time spent in each phase in milliseconds, indexed by UPDATE_PHASE_VERIFY, ...
+    unsigned int rgunPhaseMs[UPDATE_PHASE_COUNT];
+} UPDATE_HISTORY_ENTRY;
+
+/**
+ *  @brief      Firmware update history
+ *  @details    Ring of the last UPDATE_HISTORY_SIZE firmware update attempts, stored in the non-volatile platform storage
+ *              (see UPDATE_HISTORY_NAME) so it survives the platform reset after the firmware update.
+ */
+typedef struct tdUPDATE_HISTORY
+{
+    /// Layout version (UPDATE_HISTORY_LAYOUT_VERSION)
+    unsigned int unLayoutVersion;
+    /// Number of attempts recorded so far, the newest entry is at (unCount - 1) % UPDATE_HISTORY_SIZE
+    unsigned int unCount;
+    /// Entries
+    UPDATE_HISTORY_ENTRY rgsEntries[UPDATE_HISTORY_SIZE];
+} UPDATE_HISTORY;
+
+/// Name of the pending firmware update plan in the non-volatile platform storage
+#define UPDATE_PLAN_NAME L"IfxTpmFuPlan"
+/// Maximum number of firmware images (hops) of a firmware update plan
+#define UPDATE_PLAN_MAX_HOPS 4
+/// Layout version of the pending firmware update plan, a stored plan with another layout version is discarded
+#define UPDATE_PLAN_LAYOUT_VERSION 1
+
+/**
+ *  @brief      Firmware image of a firmware update plan
+ *  @details    The hops of a plan are applied in order, the target version of a hop must be a source version of the next hop.
+ */
+typedef struct tdUPDATE_PLAN_HOP
+{
+    /// Firmware image
+    BYTE* rgbImage;
+    /// Size of the firmware image in bytes
+    unsigned int unImageSize;
+} UPDATE_PLAN_HOP;
+
+/**
+ *  @brief      Pending firmware update plan
+ *  @details    Stored in the non-volatile platform storage (see UPDATE_PLAN_NAME) while a plan waits for a TPM restart. The
+ *              hops are identified by image fingerprint and size, so the plan continues when it is run again with the same
+ *              images after the restart.
+ */
+typedef struct tdUPDATE_PLAN_STATE
+{
+    /// Layout version (UPDATE_PLAN_LAYOUT_VERSION)
+    unsigned int unLayoutVersion;
+    /// Number of hops of the plan, 0 if no plan is pending
+    unsigned int unHopCount;
+    /// Index of the next hop to apply
+    unsigned int unNextHop;
+    /// Fingerprints of the images (see FirmwareUpdate_GetImageFingerprint)
+    unsigned int rgunFingerprint[UPDATE_PLAN_MAX_HOPS];
+    /// Sizes of the images in bytes
+    unsigned int rgunImageSize[UPDATE_PLAN_MAX_HOPS];
+} UPDATE_PLAN_STATE;
+
+/// States of the firmware update engine (see FirmwareUpdate_StartUpdate and FirmwareUpdate_PollUpdate)
+/// No firmware update was started
+#define UPDATE_STATE_IDLE               0
+/// The firmware image is checked and parsed
+#define UPDATE_STATE_VERIFY             1
+/// The TPM state is read
+#define UPDATE_STATE_PROBE              2
+/// The TPM2.0 policy session is prepared
+#define UPDATE_STATE_POLICY             3
+/// The firmware update is started
+#define UPDATE_STATE_START              4
+/// Waiting for the TPM2.0 to switch to boot loader mode
+#define UPDATE_STATE_WAIT_BOOT_LOADER   5
+/// The manifest is sent to the TPM2.0 (one block per poll)
+#define UPDATE_STATE_MANIFEST           6
+/// The firmware data is sent to the TPM (one block per poll)
+#define UPDATE_STATE_DATA               7
+/// Waiting for the TPM2.0 to switch to the mode before finalize
+#define UPDATE_STATE_WAIT_FINALIZE      8
+/// The firmware update is finalized
+#define UPDATE_STATE_FINALIZE           9
+/// The firmware update is over, the result is available
+#define UPDATE_STATE_DONE               10
+
+/**
+ *  @brief      Firmware update engine status
+ *  @details    Describes the state of the firmware update engine after a call to FirmwareUpdate_PollUpdate.
+ */
+typedef struct tdUPDATE_ENGINE_STATUS
+{
+    /// Current state (UPDATE_STATE_IDLE, ...)
+    unsigned int unState;
+    /// Result of the firmware update, only valid in UPDATE_STATE_DONE
+    unsigned int unResult;
+    /// Last reported progress in percent
+    unsigned int unProgress;
+    /// Time in milliseconds the caller should wait before the next poll (0 to poll again immediately)
+    unsigned int unNextPollMs;
+} UPDATE_ENGINE_STATUS;
+
 /// Function pointer type definition for Response_ProgressCallback
 typedef
 unsigned long long
@@ -177,6 +602,8 @@ void
  *  @details    This function obtains the field upgrade counter value from the TPM.
  *
  *  @param      PbfTpmAttributes            TPM state attributes.
+ *  @param      PpSecurityModuleLogicInfo2  Security Module Logic Info already read from a TPM2.0 without firmware update loader
+ *                                          or NULL to read it from the TPM.
  *  @param      PpunUpgradeCounter          Pointer to the field upgrade counter parameter.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
@@ -188,8 +615,9 @@ void
 _Check_return_
 unsigned int
 FirmwareUpdate_GetTpmFieldUpgradeCounter(
-    _In_    BITFIELD_TPM_ATTRIBUTES PbfTpmAttributes,
-    _Out_   unsigned int*           PpunUpgradeCounter);
+    _In_        BITFIELD_TPM_ATTRIBUTES             PbfTpmAttributes,
+    _In_opt_    const sSecurityModuleLogicInfo2_d*  PpSecurityModuleLogicInfo2,
+    _Out_       unsigned int*                       PpunUpgradeCounter);
 
 /**
  *  @brief      Function to read the field upgrade counter for an update to the same version
@@ -281,7 +709,10 @@ FirmwareUpdate_SelectManifest(
 
 /**
  *  @brief      Returns the TPM state attributes
- *  @details
+ *  @details    The TPM state is served from a snapshot of the last call as long as no command that may change the TPM
+ *              state has been sent since (see DeviceManagement_GetTpmStateGeneration). Otherwise the TPM is queried and
+ *              the snapshot is updated. A snapshot without the state of the platform hierarchy is not used if
+ *              PfCheckPlatformHierarchy is TRUE. The state of the platform hierarchy itself is probed once per TPM boot.
  *
  *  @param      PfCheckPlatformHierarchy    Whether to check the state of platform hierarchy. This operation can be skipped if .tpm20phDisabled and .tpm20emptyPlatformAuth are
  *                                          not needed and tool runtime should be optimized for performance.
@@ -298,6 +729,27 @@ FirmwareUpdate_CalculateState(
     _In_    BOOL        PfCheckPlatformHierarchy,
     _Out_   TPM_STATE*  PpsTpmState);
 
+/**
+ *  @brief      Reads the TPM2.0 firmware update operation mode with a single command
+ *  @details    The function sends exactly one TPM2_GetCapability(TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_OPERATION_MODE)
+ *              command and sets only the attributes derived from the operation mode (tpm20, tpmHasFULoader20, tpm20OperationMode,
+ *              tpmInOperationalMode, tpmInFwUpdateMode, tpmInFwRecoveryMode, tpmFirmwareIsValid and tpm20restartRequired).
+ *              All other attributes are zero. Unlike FirmwareUpdate_CalculateState the TPM is not started and the TPM state
+ *              snapshot is neither used nor updated, so mode switches the TPM performs on its own are reported. If the function
+ *              fails (e.g. the TPM has not been started yet or is a TPM1.2) the caller can fall back to FirmwareUpdate_CalculateState.
+ *
+ *  @param      PpsTpmState                 Pointer to a variable representing the TPM state.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully. tpmHasFULoader20 is 0 if the TPM does not support the property.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PpsTpmState is NULL.
+ *  @retval     RC_E_FAIL                   The TPM returned a property of an unexpected size.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetOperationMode(
+    _Out_   TPM_STATE*  PpsTpmState);
+
 /**
  *  @brief      Returns information about the current state of TPM
  *  @details
@@ -355,6 +807,46 @@ FirmwareUpdate_CheckImage(
     _Out_                           BITFIELD_NEW_TPM_FIRMWARE_INFO* PpbfNewTpmFirmwareInfo,
     _Out_                           unsigned int*                   PpunErrorDetails);
 
+/**
+ *  @brief      Reads the TPM state for the selection of a firmware image
+ *  @details    Determines the TPM state and the firmware version once for FirmwareUpdate_MatchImageHeader.
+ *
+ *  @param      PpsProbe                    Receives the TPM state.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. The parameter is NULL.
+ *  @retval     RC_E_NO_IFX_TPM             The TPM is not manufactured by Infineon.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_ProbeImageSelection(
+    _Out_   IMAGE_SELECTION_PROBE*  PpsProbe);
+
+/**
+ *  @brief      Checks if the header of a firmware image matches the TPM
+ *  @details    Only the header and the source version list of the image are parsed (FirmwareImage_Unmarshal). The CRC, the
+ *              digest and the signature are not verified and the TPM is not accessed, so the check is cheap enough to find
+ *              the applicable image among many candidates. The image must still be checked with FirmwareUpdate_CheckImage.
+ *
+ *  @param      PrgbImage                   Firmware image byte stream.
+ *  @param      PunImageSize                Size of firmware image byte stream.
+ *  @param      PpsProbe                    TPM state read by FirmwareUpdate_ProbeImageSelection.
+ *  @param      PpfMatch                    Receives TRUE if the image is meant for the TPM family, firmware loader and
+ *                                          firmware version of the TPM, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE       The header of the image cannot be parsed.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_MatchImageHeader(
+    _In_bytecount_(PunImageSize)    BYTE*                           PrgbImage,
+    _In_                            unsigned int                    PunImageSize,
+    _In_                            const IMAGE_SELECTION_PROBE*    PpsProbe,
+    _Out_                           BOOL*                           PpfMatch);
+
 /**
  *  @brief      Firmware Update Data structure
  *  @details    This structure is used to hand over the firmware update related data.
@@ -375,8 +867,206 @@ typedef struct tdIfxFirmwareUpdateData
     BYTE rgbOwnerAuthHash[TSS_SHA1_DIGEST_SIZE];
     /// Stores whether TPM Owner authentication hash value was provided
     BOOL fOwnerAuthProvided;
+    /// Stores whether the caller has already checked the dictionary attack state and the TPM Owner authentication hash value
+    /// (FirmwareUpdate_CheckOwnerAuthorization succeeded). The update is then started with a single OIAP session.
+    BOOL fOwnerAuthVerified;
 } IfxFirmwareUpdateData;
 
+/**
+ *  @brief      Firmware update engine
+ *  @details    Context of the firmware update driven by FirmwareUpdate_StartUpdate and FirmwareUpdate_PollUpdate.
+ */
+typedef struct tdUPDATE_ENGINE
+{
+    /// Status returned by FirmwareUpdate_PollUpdate
+    UPDATE_ENGINE_STATUS sStatus;
+    /// Firmware update data given to FirmwareUpdate_StartUpdate (the progress callback is replaced by the engine)
+    IfxFirmwareUpdateData sUpdateData;
+    /// Progress callback of the caller (optional)
+    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK fnProgressCallback;
+    /// Parsed firmware image
+    IfxFirmwareImage sFirmwareImage;
+    /// TPM state read in UPDATE_STATE_PROBE
+    TPM_STATE sTpmState;
+    /// TRUE to check the image and to prepare the policy session within the update
+    BOOL fPrepare;
+    /// TRUE if the engine prepared the policy session
+    BOOL fOwnPolicySession;
+    /// TRUE once the firmware update has been started on the TPM
+    BOOL fStarted;
+    /// TRUE once an operation mode has been read in the current wait state
+    BOOL fModeRead;
+    /// Last operation mode read from the TPM2.0
+    BYTE bOperationMode;
+    /// Ticks when the current wait state was entered
+    unsigned long long ullWaitStartTicks;
+    /// Time waited in the current wait state in milliseconds (lower bound in case no tick counter is available)
+    unsigned int unWaitedMs;
+    /// Checkpoint of the firmware transfer
+    FIRMWARE_TRANSFER_CHECKPOINT sCheckpoint;
+    /// Maximum size of a manifest or firmware block in bytes
+    unsigned int unMaxBlockSize;
+    /// Offset of the next manifest or firmware block
+    unsigned int unOffset;
+    /// Number of the next manifest or firmware block
+    unsigned int unBlockNumber;
+    /// Last reported progress of the firmware transfer
+    unsigned int unCurrentProgress;
+    /// Number of resent firmware blocks
+    unsigned int unBlockRetries;
+    /// Firmware version of the TPM read in UPDATE_STATE_PROBE (empty if it could not be read)
+    wchar_t wszSourceVersion[UPDATE_HISTORY_VERSION_SIZE];
+} UPDATE_ENGINE;
+
+/**
+ *  @brief      Returns the telemetry of the current or last firmware transfer
+ *  @details    The function does not access the TPM. It can be called from the progress callback or from a timer event
+ *              while a firmware update is in progress.
+ *
+ *  @param      PpsTelemetry        Receives the transfer telemetry.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetTransferTelemetry(
+    _Out_   FIRMWARE_TRANSFER_TELEMETRY*    PpsTelemetry);
+
+/**
+ *  @brief      Resets the phase timing of a firmware update
+ *  @details    Called by the caller of FirmwareUpdate_UpdateImage before the image is verified, so that the verification and
+ *              the policy session are included in the phase timing. FirmwareUpdate_UpdateImage resets the phase timing itself
+ *              if no phase is measured when it is called.
+ */
+void
+FirmwareUpdate_PhaseTimingReset();
+
+/**
+ *  @brief      Switches the measured phase of a firmware update
+ *  @details    The time since the last switch is added to the phase measured so far. Switching to a phase measured before
+ *              adds to its time, so interleaved phases (e.g. verification and policy session) are accounted for separately.
+ *
+ *  @param      PunPhase            Phase to measure from now on (UPDATE_PHASE_VERIFY, ...) or UPDATE_PHASE_NONE to stop.
+ */
+void
+FirmwareUpdate_PhaseTimingSwitch(
+    _In_    unsigned int    PunPhase);
+
+/**
+ *  @brief      Returns the phase timing of the current or last firmware update
+ *  @details    The function does not access the TPM.
+ *
+ *  @param      PpsTiming           Receives the phase timing.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetPhaseTiming(
+    _Out_   UPDATE_PHASE_TIMING*    PpsTiming);
+
+/**
+ *  @brief      Returns the firmware update history
+ *  @details    The history is read from the non-volatile platform storage. The function does not access the TPM.
+ *              An empty history is returned if no firmware update has been recorded yet.
+ *
+ *  @param      PpsHistory          Receives the firmware update history.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetUpdateHistory(
+    _Out_   UPDATE_HISTORY*         PpsHistory);
+
+/**
+ *  @brief      Returns the pending firmware update plan
+ *  @details    The plan is read from the non-volatile platform storage. The function does not access the TPM.
+ *              unHopCount is 0 if no plan is pending.
+ *
+ *  @param      PpsPlan             Receives the pending firmware update plan.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetPendingUpdatePlan(
+    _Out_   UPDATE_PLAN_STATE*      PpsPlan);
+
+/**
+ *  @brief      Verifies the hops of a firmware update plan before any of them is applied
+ *  @details    The first hop is checked against the TPM like FirmwareUpdate_CheckImage. Every later hop is checked without
+ *              the TPM: the CRC and the signature must be valid (FirmwareUpdate_VerifyImageIntegrity) and the target TPM
+ *              family and version of the previous hop must be an allowed source of the hop.
+ *
+ *  @param      PrgsHops            Hops of the plan.
+ *  @param      PunHopCount         Number of hops (at most UPDATE_PLAN_MAX_HOPS).
+ *  @param      PunFirstHop         Index of the first hop to apply.
+ *  @param      PpunFailedHop       Receives the index of the first hop that cannot be applied, PunHopCount if all can.
+ *  @param      PpunErrorDetails    Receives RC_SUCCESS if all hops can be applied, otherwise the error details of the
+ *                                  failed hop (see FirmwareUpdate_CheckImage), RC_E_WRONG_FW_IMAGE if the hop does not
+ *                                  follow the previous hop.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_VerifyUpdatePlan(
+    _In_count_(PunHopCount) const UPDATE_PLAN_HOP*  PrgsHops,
+    _In_                    unsigned int            PunHopCount,
+    _In_                    unsigned int            PunFirstHop,
+    _Out_                   unsigned int*           PpunFailedHop,
+    _Out_                   unsigned int*           PpunErrorDetails);
+
+/**
+ *  @brief      Applies a firmware update plan
+ *  @details    All remaining hops are verified (FirmwareUpdate_VerifyUpdatePlan) before the first one is applied. The hops
+ *              are then applied back to back, each one with the firmware update engine including the image check and the
+ *              default TPM2.0 policy session. If the TPM must be restarted after a hop, the remaining plan is stored (see
+ *              UPDATE_PLAN_NAME) and RC_E_RESTART_REQUIRED is returned. Running the plan with the same images after the
+ *              restart continues with the next hop. The stored plan is removed when the last hop has been applied.
+ *
+ *  @param      PrgsHops            Hops of the plan.
+ *  @param      PunHopCount         Number of hops (at most UPDATE_PLAN_MAX_HOPS).
+ *  @param      PfnProgress         Callback function to indicate the progress of each hop.
+ *  @param      PpunNextHop         Receives the index of the hop that failed or that is applied after the restart,
+ *                                  PunHopCount if the plan is complete.
+ *
+ *  @retval     RC_SUCCESS              All hops have been applied.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_RESTART_REQUIRED   The TPM must be restarted before the next hop.
+ *  @retval     ...                     Error details of a hop that cannot be applied (see FirmwareUpdate_VerifyUpdatePlan)
+ *                                      or error codes of the firmware update.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_RunUpdatePlan(
+    _In_count_(PunHopCount) const UPDATE_PLAN_HOP*              PrgsHops,
+    _In_                    unsigned int                        PunHopCount,
+    _In_                    PFN_FIRMWAREUPDATE_PROGRESSCALLBACK PfnProgress,
+    _Out_                   unsigned int*                       PpunNextHop);
+
+/**
+ *  @brief      Returns the estimated duration of a firmware update with the image last checked by FirmwareUpdate_CheckImage
+ *  @details    The function does not access the TPM. The estimate is not available (fValid is FALSE) if no image was checked,
+ *              if the image is not valid for the TPM or if the image has been consumed by FirmwareUpdate_UpdateImage.
+ *
+ *  @param      PpsEstimate         Receives the update duration estimate.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_GetUpdateDurationEstimate(
+    _Out_   UPDATE_DURATION_ESTIMATE*   PpsEstimate);
+
 /**
  *  @brief      Function to update the firmware with the given firmware image
  *  @details    This function updates the TPM firmware with the image given in the parameters.
@@ -399,6 +1089,57 @@ unsigned int
 FirmwareUpdate_UpdateImage(
     _In_    const IfxFirmwareUpdateData* const  PpsFirmwareUpdateData);
 
+/**
+ *  @brief      Starts a firmware update without blocking the caller
+ *  @details    The firmware update is driven by calls to FirmwareUpdate_PollUpdate. Each call performs one step (e.g. one
+ *              firmware block) and returns. The firmware image and the TPM access must stay available until the engine
+ *              reaches UPDATE_STATE_DONE. The progress callback of the firmware update data is optional.
+ *
+ *  @param      PpsFirmwareUpdateData   Pointer to structure containing all relevant data for a firmware update.
+ *  @param      PfPrepare               TRUE to check the firmware image (FirmwareUpdate_CheckImage) and to prepare a TPM2.0
+ *                                      policy session if none is given.\n
+ *                                      FALSE if the caller has done so already (see FirmwareUpdate_UpdateImage).
+ *
+ *  @retval     RC_SUCCESS              The firmware update was started.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          Another firmware update is in progress.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_StartUpdate(
+    _In_    const IfxFirmwareUpdateData* const  PpsFirmwareUpdateData,
+    _In_    BOOL                                PfPrepare);
+
+/**
+ *  @brief      Performs the next step of the firmware update started by FirmwareUpdate_StartUpdate
+ *  @details    The function returns after one step. Steps that wait for the TPM to switch its operation mode probe the TPM
+ *              once and return a poll interval in unNextPollMs instead of sleeping. The result of the firmware update is
+ *              returned in unResult once the engine has reached UPDATE_STATE_DONE.
+ *
+ *  @param      PpsStatus               Receives the status of the engine after the step.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. The parameter is NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_PollUpdate(
+    _Out_   UPDATE_ENGINE_STATUS*   PpsStatus);
+
+/**
+ *  @brief      Cancels the firmware update started by FirmwareUpdate_StartUpdate
+ *  @details    Before the update is started on the TPM the engine just stops. A TPM2.0 in boot loader mode is switched back
+ *              to operational mode (FirmwareUpdate_AbandonUpdate). A TPM1.2 update or a TPM2.0 update waiting for or
+ *              performing the finalization cannot be canceled. A canceled update ends with RC_E_UPDATE_CANCELED.
+ *
+ *  @retval     RC_SUCCESS              The firmware update was canceled or no firmware update is in progress.
+ *  @retval     RC_E_NOT_READY          The firmware update cannot be canceled in its current state.
+ *  @retval     ...                     Error codes from FirmwareUpdate_AbandonUpdate.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_CancelUpdate();
+
 /**
  *  @brief      Abandon update and switch back to TPM operational mode.
  *  @details    This function switch back to TPM operational mode by calling TPM2_FieldUpgradeAbandonVendor() command.
@@ -418,6 +1159,7 @@ FirmwareUpdate_AbandonUpdate();
  *
  *  @retval     RC_SUCCESS                      The operation completed successfully.
  *  @retval     RC_E_FAIL                       An internal error occurred.
+ *  @retval     RC_E_UNSUPPORTED_CHIP           TPM1.2 support is not included in the build (IFXTPMUPDATE_TPM20_ONLY).
  *  @retval     ...                             Error codes from called functions.
  */
 _Check_return_
@@ -425,9 +1167,53 @@ unsigned int
 FirmwareUpdate_CheckOwnerAuthorization(
     _In_bytecount_(TSS_SHA1_DIGEST_SIZE)    const BYTE  PrgbOwnerAuthHash[TSS_SHA1_DIGEST_SIZE]);
 
+/**
+ *  @brief      Reuses the policy session kept from a previous firmware update attempt
+ *  @details    A policy session completed by FirmwareUpdate_CompleteTPM20Policy is kept until a started firmware update
+ *              consumes it or it is flushed with FirmwareUpdate_FlushTPM20Policy. Instead of the five commands of a new setup, the kept session is checked
+ *              with a single TPM2_PolicyGetDigest: it is reused if the TPM still holds it with the firmware update policy
+ *              digest. Otherwise it is forgotten without flushing it, since after a TPM restart the handle may belong to
+ *              another session.
+ *              If *PphPolicySession is 0 it receives the kept session or stays 0 if there is none or the check fails. If it
+ *              is the kept session it is checked and set to 0 if the check fails. Any other session handle (e.g. provided by
+ *              the caller of the driver) is left unchanged.
+ *
+ *  @param      PphPolicySession                    In: 0 or a policy session handle, Out: the session handle to use or 0.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_ReuseTPM20Policy(
+    _Inout_ TSS_TPMI_SH_AUTH_SESSION*   PphPolicySession);
+
+/**
+ *  @brief      Flushes a policy session
+ *  @details    Errors are ignored. If the session was kept for a retry by FirmwareUpdate_CompleteTPM20Policy it is not
+ *              reused anymore.
+ *
+ *  @param      PhPolicySession                     Policy session handle.
+ */
+void
+FirmwareUpdate_FlushTPM20Policy(
+    _In_    TSS_TPMI_SH_AUTH_SESSION    PhPolicySession);
+
+/**
+ *  @brief      Returns the policy session kept for a retry of the firmware update
+ *  @details    The function does not access the TPM. The session is kept in a TPM session slot until it is flushed with
+ *              FirmwareUpdate_FlushTPM20Policy, which the caller must do before it hands the TPM over (e.g. before the OS
+ *              boots or the tool exits).
+ *
+ *  @returns    Policy session handle or 0 if no session is kept.
+ */
+TSS_TPMI_SH_AUTH_SESSION
+FirmwareUpdate_GetRetainedTPM20Policy();
+
 /**
  *  @brief      Prepares a policy session for TPM firmware.
- *  @details    The function prepares a policy session for TPM Firmware Update.
+ *  @details    The function prepares a policy session for TPM Firmware Update. A valid session kept from a previous
+ *              attempt is reused, see FirmwareUpdate_ReuseTPM20Policy.
  *
  *  @param      PphPolicySession                    Pointer to session handle that will be filled in by this method.
  *
@@ -443,6 +1229,89 @@ unsigned int
 FirmwareUpdate_PrepareTPM20Policy(
     _Out_ TSS_TPMI_SH_AUTH_SESSION* PphPolicySession);
 
+/**
+ *  @brief      Starts the preparation of a policy session for TPM firmware.
+ *  @details    The function sets the primary policy of the platform hierarchy and sends the TPM2_StartAuthSession command
+ *              without waiting for the response. No other command must be sent to the TPM before FirmwareUpdate_CompleteTPM20Policy
+ *              is called. FirmwareUpdate_CompleteTPM20Policy must only be called if this function returned RC_SUCCESS.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_FAIL                           An unexpected error occurred.
+ *  @retval     RC_E_PLATFORM_AUTH_NOT_EMPTY        In case PlatformAuth is not the Empty Buffer.
+ *  @retval     RC_E_PLATFORM_HIERARCHY_DISABLED    In case platform hierarchy has been disabled.
+ *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_BeginTPM20Policy();
+
+/**
+ *  @brief      Completes the preparation of a policy session for TPM firmware.
+ *  @details    The function receives the policy session started by FirmwareUpdate_BeginTPM20Policy and updates it for TPM
+ *              Firmware Update. If PfDiscard is TRUE the started session is flushed instead. A completed session is kept
+ *              for a retry, see FirmwareUpdate_ReuseTPM20Policy.
+ *
+ *  @param      PfDiscard                           TRUE to flush the started session instead of updating it.
+ *  @param      PphPolicySession                    Pointer to session handle that will be filled in by this method (0 if discarded).
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function. It is invalid or NULL.
+ *  @retval     RC_E_FAIL                           An unexpected error occurred.
+ *  @retval     ...                                 Error codes from called functions. like TPM error codes.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_CompleteTPM20Policy(
+    _In_    BOOL                        PfDiscard,
+    _Out_   TSS_TPMI_SH_AUTH_SESSION*   PphPolicySession);
+
+/**
+ *  @brief      Function to verify the integrity of a firmware image
+ *  @details    The function checks the CRC and the signature of the firmware image without sending any command to the TPM.
+ *              It can therefore be called while a TPM command is pending. The outcome is reused by FirmwareUpdate_CheckImage.
+ *
+ *  @param      PrgbImage           Firmware image byte stream.
+ *  @param      PullImageSize       Size of firmware image byte stream.
+ *  @param      PpfIntact           TRUE in case the image is intact, FALSE otherwise.
+ *  @param      PpunErrorDetails    The error details in case the image is not intact:\n
+ *                                      RC_E_CORRUPT_FW_IMAGE in case the firmware image is corrupt.\n
+ *                                      RC_E_NEWER_TOOL_REQUIRED in case a newer version of the tool is required to parse the firmware image.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. It is invalid or NULL.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+FirmwareUpdate_VerifyImageIntegrity(
+    _In_bytecount_(PullImageSize)   BYTE*               PrgbImage,
+    _In_                            unsigned long long  PullImageSize,
+    _Out_                           BOOL*               PpfIntact,
+    _Out_                           unsigned int*       PpunErrorDetails);
+
+/**
+ *  @brief      Starts the CRC and digest calculation of a firmware image on an application processor
+ *  @details    The calculation runs while the caller talks to the TPM (e.g. FirmwareUpdate_CalculateState or
+ *              FirmwareUpdate_BeginTPM20Policy). The next integrity check of the same image waits for the result instead of
+ *              calculating it again. If no application processor is available or the image is already in the integrity
+ *              cache, nothing is started and the integrity check runs as before. The image must not be released before
+ *              FirmwareUpdate_WaitImageIntegrityCheck or an integrity check has been called.
+ *
+ *  @param      PrgbImage           Firmware image byte stream.
+ *  @param      PullImageSize       Size of firmware image byte stream.
+ */
+void
+FirmwareUpdate_StartImageIntegrityCheck(
+    _In_bytecount_(PullImageSize)   BYTE*               PrgbImage,
+    _In_                            unsigned long long  PullImageSize);
+
+/**
+ *  @brief      Waits for the calculation started by FirmwareUpdate_StartImageIntegrityCheck
+ *  @details    Returns immediately if no calculation is running. The result is kept for the next integrity check.
+ */
+void
+FirmwareUpdate_WaitImageIntegrityCheck();
+
 #ifdef __cplusplus
 }
 #endif
@@ -42,8 +42,12 @@
 #define TPM_DEVICE_ACCESS_MEMORY_BASED 1
 /// TPM device access through device driver (for example /dev/tpm0, etc.)
 #define TPM_DEVICE_ACCESS_DRIVER 3
-/// TPM device access through UEFI protocol (EFI_TCG2_PROTOCOL)
+/// TPM device access through UEFI protocol (EFI_TCG2_PROTOCOL) for complete TPM2.0 commands and memory based access otherwise
 #define TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL 4
+/// TPM device access through a recorded command/response trace (no TPM is accessed)
+#define TPM_DEVICE_ACCESS_REPLAY 5
+/// TPM device access through the Command Response Buffer (CRB) interface (selected automatically for memory based access if the TPM implements it)
+#define TPM_DEVICE_ACCESS_CRB 6
 /// TPM DEVICE_ACCESS_PATH
 #define TPM_DEVICE_ACCESS_PATH L"/dev/tpm0"
 /// Define for TPM device access mode property string
@@ -52,6 +56,20 @@
 #define PROPERTY_TPM_DEVICE_ACCESS_PATH     L"TpmDeviceAccessPath"
 /// Define for CallTpm2ShutdownOnExit property
 #define PROPERTY_CALL_SHUTDOWN_ON_EXIT      L"CallTpm2ShutdownOnExit"
+/// Define for command duration calibration property.
+/// If TRUE, the processing time of each successful TPM command is stored as calibrated duration of its command code.
+/// If FALSE, calibrated durations are only used to derive timeouts and poll intervals.
+#define PROPERTY_CALIBRATE_COMMAND_DURATIONS    L"CalibrateCommandDurations"
+/// Key prefix of the calibrated command duration properties, followed by the command code as 8 hex digits (value in microseconds)
+#define PROPERTY_COMMAND_DURATION_PREFIX        L"CommandDuration_"
+/// Define for the query deadline property.
+/// Time budget in milliseconds of a TPM access with priority DEVICE_MANAGEMENT_PRIORITY_QUERY (0 disables the deadline).
+#define PROPERTY_QUERY_DEADLINE                 L"QueryDeadline"
+/// Define for the link check property.
+/// Number of interface register reads of the pre-flight link check before a firmware update is started (0 disables the check).
+#define PROPERTY_LINK_CHECK_READS               L"LinkCheckReads"
+/// Define for the number of failed or inconsistent register reads the pre-flight link check tolerates
+#define PROPERTY_LINK_CHECK_MAX_ERRORS          L"LinkCheckMaxErrors"
 
 // ------------------ Global type definitions ------------------
 #ifndef BYTE
@@ -75,6 +93,66 @@ typedef unsigned long   DWORD;
 #define FALSE   0
 #endif // FALSE
 
+/**
+ *  @brief      Describes one segment of a scattered TPM command.
+ *  @details    A TPM command may be passed to the device access layer as a list of segments which are written to the
+ *              TPM in order. This avoids assembling large payloads (e.g. firmware blocks) in an intermediate buffer.
+ */
+typedef struct tdTPM_TX_SEGMENT
+{
+    /// Pointer to the segment bytes
+    const BYTE*     pbData;
+    /// Size of the segment in bytes
+    unsigned int    unSize;
+} TPM_TX_SEGMENT;
+
+/**
+ *  @brief      Durations of the transport phases of the last TPM command.
+ *  @details    The device access layer fills in the durations in microseconds. A phase that was not executed
+ *              (e.g. the receive phases after a failed send) has a duration of 0.
+ */
+typedef struct tdTPM_PHASE_TIMING
+{
+    /// Time to write the command to the TPM
+    unsigned long long  ullSendUs;
+    /// Time waiting for the TPM to signal that the response is available (TPM processing)
+    unsigned long long  ullWaitUs;
+    /// Time to read the response from the TPM
+    unsigned long long  ullReceiveUs;
+} TPM_PHASE_TIMING;
+
+/// TPM family could not be derived from the interface registers
+#define TPM_INTERFACE_FAMILY_UNKNOWN    0
+/// Interface registers of a TPM1.2 (TIS 1.2 or TIS 1.3 interface)
+#define TPM_INTERFACE_FAMILY_TPM12      1
+/// Interface registers of a TPM2.0 (FIFO or CRB interface of the PC Client Platform TPM Profile)
+#define TPM_INTERFACE_FAMILY_TPM20      2
+
+/**
+ *  @brief      Identification of the TPM read from its interface registers
+ *  @details    The registers can be read without sending a TPM command, so the family is only a hint: it reflects the
+ *              interface of the running firmware and is TPM_INTERFACE_FAMILY_UNKNOWN if the registers give no answer.
+ */
+typedef struct tdTPM_INTERFACE_INFO
+{
+    /// Vendor id (e.g. TPM_VID_IFX)
+    unsigned short  usVendorId;
+    /// Device id
+    unsigned short  usDeviceId;
+    /// Revision id
+    BYTE            bRevisionId;
+    /// InterfaceType field of the interface id register (0xF for TIS 1.3 and older)
+    BYTE            bInterfaceType;
+    /// InterfaceVersion field of the interface capability register (FIFO) or interface id register (CRB)
+    BYTE            bInterfaceVersion;
+    /// TPM_INTERFACE_FAMILY_*
+    BYTE            bFamily;
+    /// Typical duration of a field upgrade data block command in microseconds from the transport profile (0 if unknown)
+    unsigned int    unBlockLatencyUs;
+    /// Field upgrade block size in bytes from the transport profile (0 if unknown)
+    unsigned short  usFieldUpgradeBlockSize;
+} TPM_INTERFACE_INFO;
+
 // --------------------- Macro definitions ---------------------
 /// Size of a constant array in elements, e.g. length (not size!) of a null-terminated wide character string (incl. null-termination)
 #define RG_LEN(x) (sizeof(x) / sizeof(x[0]))
@@ -130,6 +208,14 @@ typedef unsigned long   DWORD;
 #define SLEEP_TIME_US_BURSTCOUNT    10
 /// This is the time value to sleep between TIS_IsActiveLocality() retries in micro seconds
 #define SLEEP_TIME_US_CR            10
+/// Number of register polls without sleeping before a TIS wait loop starts to back off
+#define TIS_POLL_SPIN_COUNT         4
+/// Upper limit in micro seconds for the sleep time between register polls while waiting for a TPM response
+#define SLEEP_TIME_US_MAX           2000
+/// Divisor applied to the expected duration of a TPM command to get the initial sleep time while waiting for its response
+#define TIS_EXPECTED_DURATION_POLL_DIVISOR  8
+/// Interval in micro seconds for register polls while waiting for a TPM interrupt (covers lost interrupts)
+#define TIS_INTERRUPT_POLL_INTERVAL_US  50000
 /// Default memory address base for TPM device
 #define TPM_DEFAULT_MEM_BASE        0xFED40000U
 /// Default memory address size for TPM device
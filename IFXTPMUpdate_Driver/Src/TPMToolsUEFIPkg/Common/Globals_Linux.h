@@ -0,0 +1,146 @@
+/**
+ *  @brief      Declares global definitions for the Linux platform
+ *  @details    Provides the UEFI base types and the SAL annotations used by the common modules, so they can be built
+ *              with the C library of a Linux host. The common modules expect two byte wide characters, so the sources
+ *              must be compiled with -fshort-wchar.
+ *  @file       Globals_Linux.h
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include <stddef.h> // NULL, wchar_t, size_t
+#include <stdarg.h> // Defines va_* macros
+#include <stdint.h> // uint8_t ... uint64_t, UINT64_MAX
+#include <limits.h> // UINT_MAX, INT_MAX
+#include <string.h> // memcpy, memset
+
+#if defined(__SIZEOF_WCHAR_T__) && (__SIZEOF_WCHAR_T__ != 2)
+#error The common modules require a two byte wchar_t, compile with -fshort-wchar.
+#endif
+
+// Common include files
+#include "Globals.h"
+
+// UEFI base types used by the common modules
+/// Definition of type UINT8
+typedef uint8_t     UINT8;
+/// Definition of type UINT16
+typedef uint16_t    UINT16;
+/// Definition of type UINT32
+typedef uint32_t    UINT32;
+/// Definition of type UINT64
+typedef uint64_t    UINT64;
+/// Definition of type UINTN
+typedef uintptr_t   UINTN;
+/// Definition of type INT8
+typedef int8_t      INT8;
+/// Definition of type INT16
+typedef int16_t     INT16;
+/// Definition of type INT32
+typedef int32_t     INT32;
+/// Definition of type INT64
+typedef int64_t     INT64;
+/// Definition of type BOOLEAN
+typedef uint8_t     BOOLEAN;
+/// Definition of type CHAR8
+typedef char        CHAR8;
+/// Definition of type CHAR16
+typedef wchar_t     CHAR16;
+/// Definition of type VOID
+#define VOID        void
+/// Definition of CONST
+#define CONST       const
+
+/// Definition of a GUID in the layout of EFI_GUID
+typedef struct tdGUID
+{
+    /// First 32 bits
+    UINT32  Data1;
+    /// Next 16 bits
+    UINT16  Data2;
+    /// Next 16 bits
+    UINT16  Data3;
+    /// Last 64 bits
+    UINT8   Data4[8];
+} GUID;
+/// Definition of type EFI_GUID
+typedef GUID EFI_GUID;
+
+/// Parameter direction modifiers (informational only)
+#define IN
+#define OUT
+#define OPTIONAL
+
+/// Returns the minimum of two values
+#ifndef MIN
+#define MIN(a, b)   (((a) < (b)) ? (a) : (b))
+#endif
+/// Returns the maximum of two values
+#ifndef MAX
+#define MAX(a, b)   (((a) > (b)) ? (a) : (b))
+#endif
+
+// SAL annotations
+/// @cond SHOW_SAL_DEFINITIONS
+// Override SAL annotations for GCC
+#define _Check_return_
+#define _Success_(x)
+
+#define _In_
+#define _In_opt_
+#define _In_bytecount_(x)
+#define _In_opt_bytecount_(x)
+#define _In_count_(x)
+#define _In_z_
+#define _In_opt_z_
+#define _In_z_count_(x)
+#define _In_opt_z_count_(x)
+#define _In_reads_z_(x)
+#define _In_reads_or_z_(x)
+#define _In_reads_bytes_(x)
+#define _In_reads_bytes_opt_(x)
+
+#define _Inout_
+#define _Inout_bytecap_(x)
+#define _Inout_count_(x)
+#define _Inout_opt_
+#define _Inout_updates_z_(x)
+#define _Inout_z_
+#define _Inout_z_cap_(x)
+#define _Inout_opt_z_cap_(x)
+
+#define _Out_
+#define _Out_opt_
+#define _Out_bytecap_(x)
+#define _Out_bytecapcount_(x)
+#define _Out_opt_bytecap_(x)
+#define _Out_opt_bytecapcount_(x)
+#define _Out_writes_bytes_all_(x)
+#define _Out_writes_bytes_to_opt_(x, y)
+#define _Outptr_result_buffer_(x)
+#define _Outptr_result_maybenull_
+#define _Outptr_result_maybenull_z_
+#define _Out_z_cap_(x)
+#define _Out_z_bytecap_(x)
+#define _Out_writes_z_(x)
+/// @endcond
+
+/// Scan code of ESC character on Windows
+#define CHAR_ESC 27
+/// Maximum numerical value of a byte
+#define MAXBYTE 0xFF
+
+/// Calling convention
+#define IFXAPI
+
+/// Unchecked memory copy used by the inline fast paths of the Platform module
+#define PLATFORM_COPY_MEM(Dst, Src, Size)   memcpy(Dst, Src, Size)
+/// Unchecked memory set used by the inline fast paths of the Platform module
+#define PLATFORM_SET_MEM(Dst, Value, Size)  memset(Dst, Value, Size)
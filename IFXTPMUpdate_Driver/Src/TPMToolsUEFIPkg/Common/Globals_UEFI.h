@@ -29,6 +29,7 @@
 #define _In_opt_                IN OPTIONAL
 #define _In_bytecount_(x)       IN
 #define _In_opt_bytecount_(x)   IN OPTIONAL
+#define _In_count_(x)           IN
 #define _In_z_                  IN
 #define _In_opt_z_              IN OPTIONAL
 #define _In_z_count_(x)         IN
@@ -47,6 +48,7 @@
 #define _Inout_opt_z_cap_(x)    IN OUT OPTIONAL
 
 #define _Out_                           OUT
+#define _Out_opt_                       OUT OPTIONAL
 #define _Out_bytecap_(x)                OUT
 #define _Out_bytecapcount_(x)           OUT
 #define _Out_opt_bytecap_(x)            OUT OPTIONAL
@@ -119,3 +121,8 @@ typedef UINTN size_t;
 
 /// Calling convention
 #define IFXAPI EFIAPI
+
+/// Unchecked memory copy used by the inline fast paths of the Platform module (BaseMemoryLib)
+#define PLATFORM_COPY_MEM(Dst, Src, Size)   CopyMem(Dst, Src, Size)
+/// Unchecked memory set used by the inline fast paths of the Platform module (BaseMemoryLib)
+#define PLATFORM_SET_MEM(Dst, Value, Size)  SetMem(Dst, Size, (UINT8)(Value))
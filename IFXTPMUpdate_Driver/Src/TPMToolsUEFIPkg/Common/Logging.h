@@ -22,6 +22,9 @@ extern "C" {
 /// Flag indicating whether to write a header into the log file or not
 extern BOOL g_fLogHeader;
 
+/// Current log level, messages of a higher log level are skipped before their arguments are evaluated
+extern unsigned int g_unLoggingLevel;
+
 /**
  *  Value definitions for logging
  */
@@ -53,40 +56,76 @@ extern BOOL g_fLogHeader;
 /// The maximum HEX byte characters written per line in log file
 #define LOGGING_HEX_CHARS_PER_LINE 16
 
+/// Size of the buffer in characters in which a hex dump is passed to the log callback. Longer dumps are passed in several chunks of complete lines.
+#define LOGGING_HEX_CHUNK_SIZE 1024
+
 /// Divisor for megabyte
 #define DIV_KILOBYTE 1024
 
+/// Highest log level compiled into the binary (set with [BuildOptions] in the module INF). Messages of a higher level compile to nothing.
+#ifndef LOGGING_MAX_LEVEL
+#define LOGGING_MAX_LEVEL   LOGGING_LEVEL_4
+#endif
+
 /**
  *  Macro definitions for logging
  */
 
 /// Macro for writing a message into the log file
-#define LOGGING_WRITE(LOGLEVEL, LOGMESSAGE, ...)    Logging_WriteLog(FILENAME, __func__, LOGLEVEL, LOGMESSAGE, __VA_ARGS__);
+#define LOGGING_WRITE(LOGLEVEL, LOGMESSAGE, ...)    { if ((LOGLEVEL) <= LOGGING_MAX_LEVEL && (LOGLEVEL) <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGLEVEL, LOGMESSAGE, __VA_ARGS__); }
 
 /// Macro for writing a message into the log file only in case current log level is level 1 or higher
-#define LOGGING_WRITE_LEVEL1_FMT(LOGMESSAGE, ...)   Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_1, LOGMESSAGE, __VA_ARGS__);
-#define LOGGING_WRITE_LEVEL1(LOGMESSAGE)            Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_1, LOGMESSAGE, NULL);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_1
+#define LOGGING_WRITE_LEVEL1_FMT(LOGMESSAGE, ...)   { if (LOGGING_LEVEL_1 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_1, LOGMESSAGE, __VA_ARGS__); }
+#define LOGGING_WRITE_LEVEL1(LOGMESSAGE)            { if (LOGGING_LEVEL_1 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_1, LOGMESSAGE, NULL); }
+#else
+#define LOGGING_WRITE_LEVEL1_FMT(LOGMESSAGE, ...)
+#define LOGGING_WRITE_LEVEL1(LOGMESSAGE)
+#endif
 
 /// Macro for writing a message into the log file only in case current log level is level 2 or higher
-#define LOGGING_WRITE_LEVEL2_FMT(LOGMESSAGE, ...)   Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_2, LOGMESSAGE, __VA_ARGS__);
-#define LOGGING_WRITE_LEVEL2(LOGMESSAGE)            Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_2, LOGMESSAGE, NULL);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_2
+#define LOGGING_WRITE_LEVEL2_FMT(LOGMESSAGE, ...)   { if (LOGGING_LEVEL_2 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_2, LOGMESSAGE, __VA_ARGS__); }
+#define LOGGING_WRITE_LEVEL2(LOGMESSAGE)            { if (LOGGING_LEVEL_2 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_2, LOGMESSAGE, NULL); }
+#else
+#define LOGGING_WRITE_LEVEL2_FMT(LOGMESSAGE, ...)
+#define LOGGING_WRITE_LEVEL2(LOGMESSAGE)
+#endif
 
 /// Macro for writing a message into the log file only in case current log level is level 3 or higher
-#define LOGGING_WRITE_LEVEL3_FMT(LOGMESSAGE, ...)   Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_3, LOGMESSAGE, __VA_ARGS__);
-#define LOGGING_WRITE_LEVEL3(LOGMESSAGE)            Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_3, LOGMESSAGE, NULL);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_3
+#define LOGGING_WRITE_LEVEL3_FMT(LOGMESSAGE, ...)   { if (LOGGING_LEVEL_3 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_3, LOGMESSAGE, __VA_ARGS__); }
+#define LOGGING_WRITE_LEVEL3(LOGMESSAGE)            { if (LOGGING_LEVEL_3 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_3, LOGMESSAGE, NULL); }
+#else
+#define LOGGING_WRITE_LEVEL3_FMT(LOGMESSAGE, ...)
+#define LOGGING_WRITE_LEVEL3(LOGMESSAGE)
+#endif
 
 /// Macro for writing a message into the log file only in case current log level is level 4 or higher
-#define LOGGING_WRITE_LEVEL4_FMT(LOGMESSAGE, ...)   Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_4, LOGMESSAGE, __VA_ARGS__);
-#define LOGGING_WRITE_LEVEL4(LOGMESSAGE)            Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_4, LOGMESSAGE, NULL);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_4
+#define LOGGING_WRITE_LEVEL4_FMT(LOGMESSAGE, ...)   { if (LOGGING_LEVEL_4 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_4, LOGMESSAGE, __VA_ARGS__); }
+#define LOGGING_WRITE_LEVEL4(LOGMESSAGE)            { if (LOGGING_LEVEL_4 <= g_unLoggingLevel) Logging_WriteLog(FILENAME, __func__, LOGGING_LEVEL_4, LOGMESSAGE, NULL); }
+#else
+#define LOGGING_WRITE_LEVEL4_FMT(LOGMESSAGE, ...)
+#define LOGGING_WRITE_LEVEL4(LOGMESSAGE)
+#endif
 
 /// Macro for writing a buffer's contents in hex bytes into the log file
-#define LOGGING_WRITEHEX(LOGLEVEL, BUFFER, SIZE)    Logging_WriteHex(FILENAME, __func__, LOGLEVEL, BUFFER, SIZE);
+#define LOGGING_WRITEHEX(LOGLEVEL, BUFFER, SIZE)    { if ((LOGLEVEL) <= LOGGING_MAX_LEVEL && (LOGLEVEL) <= g_unLoggingLevel) Logging_WriteHex(FILENAME, __func__, LOGLEVEL, BUFFER, SIZE); }
 
 /// Macro for writing a buffer's contents in hex bytes into the log file only in case current log level is level 1 or higher
-#define LOGGING_WRITEHEX_LEVEL1(BUFFER, SIZE)       Logging_WriteHex(FILENAME, __func__, LOGGING_LEVEL_1, BUFFER, SIZE);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_1
+#define LOGGING_WRITEHEX_LEVEL1(BUFFER, SIZE)       { if (LOGGING_LEVEL_1 <= g_unLoggingLevel) Logging_WriteHex(FILENAME, __func__, LOGGING_LEVEL_1, BUFFER, SIZE); }
+#else
+#define LOGGING_WRITEHEX_LEVEL1(BUFFER, SIZE)
+#endif
 
 /// Macro for writing a buffer's contents in hex bytes into the log file only in case current log level is level 3 or higher
-#define LOGGING_WRITEHEX_LEVEL3(BUFFER, SIZE)       Logging_WriteHex(FILENAME, __func__, LOGGING_LEVEL_3, BUFFER, SIZE);
+#if LOGGING_MAX_LEVEL >= LOGGING_LEVEL_3
+#define LOGGING_WRITEHEX_LEVEL3(BUFFER, SIZE)       { if (LOGGING_LEVEL_3 <= g_unLoggingLevel) Logging_WriteHex(FILENAME, __func__, LOGGING_LEVEL_3, BUFFER, SIZE); }
+#else
+#define LOGGING_WRITEHEX_LEVEL3(BUFFER, SIZE)
+#endif
 
 /// Structure for storing a cached log message
 typedef struct tdIfxLogEntry
@@ -99,6 +138,23 @@ typedef struct tdIfxLogEntry
     void*           pNextLogEntry;
 } IfxLogEntry;
 
+/// Structure of a log message recorded in the log ring. It is followed by the format arguments and the copied data.
+typedef struct tdIfxLogRecord
+{
+    /// Size of the record in bytes incl. format arguments and data (0 marks the unused end of the log ring)
+    unsigned int        unSize;
+    /// The log level
+    unsigned int        unLogLevel;
+    /// Value of the tick counter when the message was logged
+    unsigned long long  ullTicks;
+    /// The format string of the log message (NULL for a hex dump)
+    const wchar_t*      pwszFormat;
+    /// Size of the format arguments in bytes
+    unsigned int        unArgumentsSize;
+    /// Size of the copied data (string arguments or hex dump) in bytes
+    unsigned int        unDataSize;
+} IfxLogRecord;
+
 /**
  *  Method declarations for logging
  */
@@ -154,6 +210,57 @@ Logging_WriteHex(
     _In_bytecount_(PunSize) const BYTE*     PrgbHexData,
     _In_                    unsigned int    PunSize);
 
+/**
+ *  @brief      Enable or disable the log ring
+ *  @details    While the log ring is enabled, Logging_WriteLog and Logging_WriteHex record the messages in binary form (log level,
+ *              format string, format arguments and tick count) instead of formatting them. Disabling the log ring discards
+ *              all messages not read yet.
+ *
+ *  @param      PfEnable            TRUE to enable the log ring, FALSE to disable it.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_FAIL           The memory for the log ring could not be allocated.
+ */
+_Check_return_
+unsigned int
+Logging_EnableRing(
+    _In_    BOOL    PfEnable);
+
+/**
+ *  @brief      Check if the log ring is enabled
+ *  @details
+ *
+ *  @retval     TRUE                The log ring is enabled.
+ *  @retval     FALSE               The log ring is disabled.
+ */
+_Check_return_
+BOOL
+Logging_IsRingEnabled();
+
+/**
+ *  @brief      Read the messages of the log ring
+ *  @details    Formats the recorded messages from oldest to newest and removes them from the log ring. Messages which do not fit
+ *              into the given buffer stay in the log ring. Call the function with PwszText set to NULL to get the capacity
+ *              required for all messages without removing them.
+ *
+ *  @param      PwszText            Buffer receiving the null-terminated messages (optional, can be NULL).
+ *  @param      PpunTextCapacity    In:     Capacity of PwszText in elements\n
+ *                                  Out:    Count of written elements (incl. null-termination) or required capacity if PwszText is NULL
+ *  @param      PpunMessageCount    Receives the number of messages written.
+ *  @param      PpunDroppedCount    Receives the number of messages dropped since the last call.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL           The log ring is not enabled or memory allocation failed.
+ */
+_Check_return_
+unsigned int
+Logging_DrainRing(
+    _Out_opt_   wchar_t*        PwszText,
+    _Inout_     unsigned int*   PpunTextCapacity,
+    _Out_       unsigned int*   PpunMessageCount,
+    _Out_       unsigned int*   PpunDroppedCount);
+
 /**
  *  @brief      Check if log file is open for writing
  *  @details    Checks if log file is open for writing.
@@ -39,13 +39,12 @@ TSS_TPM_FieldUpgradeComplete(
     _Out_                           uint16_t*       PpusOutCompleteSize)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
 
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
-        TSS_BYTE* pbBuffer = rgbRequest;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest), nSizeResponse = sizeof(rgbResponse);
+        TSS_BYTE* pbBuffer = psContext->rgbRequest;
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest), nSizeResponse = sizeof(psContext->rgbResponse);
 
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_TAG_RQU_COMMAND;
@@ -61,8 +60,10 @@ TSS_TPM_FieldUpgradeComplete(
         TSS_BYTE bLRC = 0;
         TSS_BYTE* pbLRCBuffer = NULL;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
         // Initialize _Out_ parameters
         Platform_MemorySet(PpusOutCompleteSize, 0x00, sizeof(uint16_t));
 
@@ -89,32 +90,32 @@ TSS_TPM_FieldUpgradeComplete(
         unReturnValue = TSS_UINT16_Marshal(&PusCompleteSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
-        // Complete Data
-        unReturnValue = TSS_UINT8_Array_Marshal(PrgbComplete, &pbBuffer, &nSizeRemaining, PusCompleteSize);
+        // Complete Data, the LRC is calculated while the data is copied
+        bLRC = TSS_CalcLRC(pbLRCBuffer, (uint32_t) (pbBuffer - pbLRCBuffer));
+        unReturnValue = TSS_BYTE_Array_MarshalLRC(PrgbComplete, &pbBuffer, &nSizeRemaining, PusCompleteSize, &bLRC);
         if (RC_SUCCESS != unReturnValue)
             break;
 
-        // Calculate and marshal LRC
-        bLRC = TSS_CalcLRC(pbLRCBuffer, (uint32_t) (pbBuffer - pbLRCBuffer));
+        // Marshal LRC
         unReturnValue = TSS_UINT8_Marshal(&bLRC, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -137,5 +138,7 @@ TSS_TPM_FieldUpgradeComplete(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
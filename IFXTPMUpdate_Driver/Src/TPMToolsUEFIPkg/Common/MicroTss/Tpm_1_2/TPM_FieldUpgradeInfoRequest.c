@@ -35,14 +35,13 @@ TSS_TPM_FieldUpgradeInfoRequest(
     _Inout_ TSS_IFX_FIELDUPGRADEINFO* PpIfxFieldUpgradeInfo)
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
 
     do
     {
-        BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_UINT32 unSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_UINT32 unSizeResponse = sizeof(psContext->rgbResponse);
         TSS_UINT16 usTemp = 0;
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_TAG_RQU_COMMAND;
@@ -54,11 +53,13 @@ TSS_TPM_FieldUpgradeInfoRequest(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -76,19 +77,19 @@ TSS_TPM_FieldUpgradeInfoRequest(
             break;
 
         // Update command size
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + sizeof(tag);
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + sizeof(tag);
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, &unSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, &unSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = unSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -119,5 +120,7 @@ TSS_TPM_FieldUpgradeInfoRequest(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
@@ -40,14 +40,13 @@ TSS_TPM_FieldUpgradeStart(
     _In_opt_                                    TSS_TPM_NONCE*      PpsLastNonceEven)
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
 
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_UINT32 unSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_UINT32 unSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_TAG_RQU_COMMAND;
         TSS_UINT32 unCommandSize = 0;
@@ -59,30 +58,20 @@ TSS_TPM_FieldUpgradeStart(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
         // Authorization session parameters
-        TSS_UINT16 usInParamDigestSize = 0;
-        TSS_BYTE *pbInParamDigest = NULL;
-        TSS_UINT16 usHmacInputSize = 0;
-        TSS_BYTE *pbHmacInput = NULL;
+        // The HMAC input uses (SHA1_DIGEST_SIZE + 2 * sizeof(TSS_TPM_NONCE) + 1) Bytes
+        TSS_BYTE rgbHmacInput[TSS_SHA1_DIGEST_SIZE + 2 * sizeof(TSS_TPM_NONCE) + 1];
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        Platform_MemorySet(rgbHmacInput, 0, sizeof(rgbHmacInput));
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
         if (PpbOwnerAuth != NULL)
-        {
-            // Initialize temporary data buffers for HMAC calculation according to the OIAP
-            usInParamDigestSize = sizeof(TSS_TPM_CC) + PunPolicyParameterBlockSize + 4; // The SHA-1 input uses command code and policy parameter block.
-            usHmacInputSize = TSS_SHA1_DIGEST_SIZE + 2 * sizeof(TSS_TPM_NONCE) + 1; // The HMAC input uses (SHA1_DIGEST_SIZE + 2 * sizeof(TSS_TPM_NONCE) + 1) Bytes
-            pbInParamDigest = (TSS_BYTE*)Platform_MemoryAllocateZero(usInParamDigestSize);
-            pbHmacInput = (TSS_BYTE*)Platform_MemoryAllocateZero(usHmacInputSize);
-            if (NULL == pbInParamDigest || NULL == pbHmacInput)
-            {
-                unReturnValue = RC_E_FAIL;
-                break;
-            }
             tag = TSS_TPM_TAG_RQU_AUTH1_COMMAND;
-        }
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -100,10 +89,10 @@ TSS_TPM_FieldUpgradeStart(
         unReturnValue = TSS_UINT16_Marshal(&PunPolicyParameterBlockSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
-        unReturnValue = TSS_BYTE_Array_Marshal(PpbPolicyParameterBlock, &pbBuffer, &nSizeRemaining, PunPolicyParameterBlockSize);
+        bLRC = TSS_CalcLRC(pbLRCStart, (TSS_UINT32)(pbBuffer - pbLRCStart)); // Calculate LRC beginning from stored location to current pointer position
+        unReturnValue = TSS_BYTE_Array_MarshalLRC(PpbPolicyParameterBlock, &pbBuffer, &nSizeRemaining, PunPolicyParameterBlockSize, &bLRC);
         if (RC_SUCCESS != unReturnValue)
             break;
-        bLRC = TSS_CalcLRC(pbLRCStart, (TSS_UINT32)(pbBuffer - pbLRCStart)); // Calculate LRC beginning from stored location to current pointer position
         unReturnValue = TSS_UINT8_Marshal(&bLRC, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -125,10 +114,13 @@ TSS_TPM_FieldUpgradeStart(
                 break;
             sAuthIn.bContinueAuthSession = 0;
 
-            // Fill pbInParamDigest buffer according to OIAP
+            // Create SHA-1 hash from the input parameters according to OIAP. The command code, sub command code and
+            // block size are hashed from a small buffer, the policy parameter block is hashed in place.
             {
-                TSS_BYTE* pbBuffer2 = pbInParamDigest;
-                TSS_INT32 nSizeRemaining2 = usInParamDigestSize;
+                CRYPT_HASH_CONTEXT sHashContext;
+                TSS_BYTE rgbInParamHeader[sizeof(TSS_TPM_CC) + sizeof(TSS_BYTE) + sizeof(TSS_UINT16)];
+                TSS_BYTE* pbBuffer2 = rgbInParamHeader;
+                TSS_INT32 nSizeRemaining2 = sizeof(rgbInParamHeader);
                 unReturnValue = TSS_UINT32_Marshal(&commandCode, &pbBuffer2, &nSizeRemaining2);
                 if (RC_SUCCESS != unReturnValue)
                     break;
@@ -141,23 +133,27 @@ TSS_TPM_FieldUpgradeStart(
                 if (RC_SUCCESS != unReturnValue)
                     break;
 
-                unReturnValue = TSS_BYTE_Array_Marshal(PpbPolicyParameterBlock, &pbBuffer2, &nSizeRemaining2, PunPolicyParameterBlockSize);
+                unReturnValue = Crypt_HashInit(&sHashContext, CRYPT_HASH_ALGORITHM_SHA1);
                 if (RC_SUCCESS != unReturnValue)
                     break;
-
-                unReturnValue = TSS_UINT8_Marshal(&bLRC, &pbBuffer2, &nSizeRemaining2);
+                unReturnValue = Crypt_HashUpdate(&sHashContext, rgbInParamHeader, (unsigned int)(pbBuffer2 - rgbInParamHeader));
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unReturnValue = Crypt_HashUpdate(&sHashContext, PpbPolicyParameterBlock, PunPolicyParameterBlockSize);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unReturnValue = Crypt_HashUpdate(&sHashContext, &bLRC, sizeof(bLRC));
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unReturnValue = Crypt_HashFinal(&sHashContext, TSS_SHA1_DIGEST_SIZE, rgbHmacInput);
                 if (RC_SUCCESS != unReturnValue)
                     break;
             }
-            // Create SHA-1 hash from the input parameters according to OIAP
-            unReturnValue = Crypt_SHA1(pbInParamDigest, usInParamDigestSize, pbHmacInput);
-            if (unReturnValue != RC_SUCCESS)
-                break;
 
             // Fill HMAC input buffer according to OIAP
             {
-                TSS_BYTE* pbBuffer2 = &pbHmacInput[TSS_SHA1_DIGEST_SIZE];
-                TSS_INT32 nSizeRemaining2 = usHmacInputSize - TSS_SHA1_DIGEST_SIZE;
+                TSS_BYTE* pbBuffer2 = &rgbHmacInput[TSS_SHA1_DIGEST_SIZE];
+                TSS_INT32 nSizeRemaining2 = sizeof(rgbHmacInput) - TSS_SHA1_DIGEST_SIZE;
                 unReturnValue = TSS_BYTE_Array_Marshal((TSS_BYTE*)PpsLastNonceEven, &pbBuffer2, &nSizeRemaining2, sizeof(TSS_TPM_NONCE));
                 if (RC_SUCCESS != unReturnValue)
                     break;
@@ -170,7 +166,7 @@ TSS_TPM_FieldUpgradeStart(
             }
 
             // Create HMAC for authenticated TPM command according to OIAP
-            unReturnValue = Crypt_HMAC(pbHmacInput, usHmacInputSize, PpbOwnerAuth, sAuthIn.sOwnerAuth.authdata);
+            unReturnValue = Crypt_HMAC(rgbHmacInput, sizeof(rgbHmacInput), PpbOwnerAuth, sAuthIn.sOwnerAuth.authdata);
             if (unReturnValue != RC_SUCCESS)
                 break;
 
@@ -180,19 +176,19 @@ TSS_TPM_FieldUpgradeStart(
         }
 
         // Update command size
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + sizeof(tag);
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + sizeof(tag);
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, &unSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, &unSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = unSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -211,5 +207,7 @@ TSS_TPM_FieldUpgradeStart(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
@@ -35,14 +35,13 @@ TSS_TPM_FieldUpgradeUpdate(
     _In_                                        TSS_UINT16      PunFieldUpgradeBlockSize)
 {
     unsigned int unReturnValue = RC_E_FAIL;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
 
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_UINT32 unSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_UINT32 unSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_TAG_RQU_COMMAND;
         TSS_UINT32 unCommandSize = 0;
@@ -54,10 +53,12 @@ TSS_TPM_FieldUpgradeUpdate(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -74,28 +75,28 @@ TSS_TPM_FieldUpgradeUpdate(
         unReturnValue = TSS_UINT16_Marshal(&PunFieldUpgradeBlockSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
-        unReturnValue = TSS_BYTE_Array_Marshal(PpbFieldUpgradeBlock, &pbBuffer, &nSizeRemaining, PunFieldUpgradeBlockSize);
+        bLRC = TSS_CalcLRC(pbLRCStart, (TSS_UINT32)(pbBuffer - pbLRCStart)); // Calculate LRC beginning from stored location to current pointer position
+        unReturnValue = TSS_BYTE_Array_MarshalLRC(PpbFieldUpgradeBlock, &pbBuffer, &nSizeRemaining, PunFieldUpgradeBlockSize, &bLRC);
         if (RC_SUCCESS != unReturnValue)
             break;
-        bLRC = TSS_CalcLRC(pbLRCStart, (TSS_UINT32)(pbBuffer - pbLRCStart)); // Calculate LRC beginning from stored location to current pointer position
         unReturnValue = TSS_UINT8_Marshal(&bLRC, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Update command size
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + sizeof(tag);
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + sizeof(tag);
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, &unSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, &unSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = unSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -114,5 +115,7 @@ TSS_TPM_FieldUpgradeUpdate(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
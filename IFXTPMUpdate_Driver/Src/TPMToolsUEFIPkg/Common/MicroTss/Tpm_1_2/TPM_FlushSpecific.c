@@ -39,13 +39,12 @@ TSS_TPM_FlushSpecific(
     _In_ TSS_TPM_RESOURCE_TYPE  PunResourceType)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_TAG tag = TSS_TPM_TAG_RQU_COMMAND;
         TSS_UINT32 unCommandSize = 0;
@@ -54,10 +53,12 @@ TSS_TPM_FlushSpecific(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RESULT responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPM_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -75,20 +76,20 @@ TSS_TPM_FlushSpecific(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_TAG_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -107,5 +108,7 @@ TSS_TPM_FlushSpecific(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
@@ -49,13 +49,12 @@ TSS_TPM_GetCapability(
     _Out_bytecap_(*PpunRespSize)    TSS_BYTE*                   PrgbRespCap)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_TAG tag = TSS_TPM_TAG_RQU_COMMAND;
         TSS_UINT32 unCommandSize = 0;
@@ -64,8 +63,10 @@ TSS_TPM_GetCapability(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RESULT responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
         // Check parameters
         if ((PunSubCapSize != 0 && NULL == PrgbSubCapBuffer) ||
@@ -76,7 +77,7 @@ TSS_TPM_GetCapability(
         }
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPM_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -104,20 +105,20 @@ TSS_TPM_GetCapability(
         }
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_TAG_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -228,5 +229,7 @@ TSS_TPM_GetCapability(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
@@ -42,13 +42,12 @@ TSS_TPM_GetTestResult(
     _Out_bytecap_(*PpunOutDataSize) TSS_BYTE*               PrgbOutData)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_TAG tag = TSS_TPM_TAG_RQU_COMMAND;
         TSS_UINT32 unCommandSize = 0;
@@ -57,8 +56,10 @@ TSS_TPM_GetTestResult(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RESULT responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
         // Check parameters
         if (NULL == PrgbOutData || NULL == PpunOutDataSize)
         {
@@ -67,7 +68,7 @@ TSS_TPM_GetTestResult(
         }
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPM_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -79,20 +80,20 @@ TSS_TPM_GetTestResult(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_TAG_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -132,5 +133,7 @@ TSS_TPM_GetTestResult(
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
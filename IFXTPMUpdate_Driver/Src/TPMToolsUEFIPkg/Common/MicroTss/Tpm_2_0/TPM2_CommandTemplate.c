@@ -0,0 +1,228 @@
+/**
+ *  @brief      Implements pre-marshaled command templates for repeated TPM2.0 commands
+ *  @details    The constant fields of a command are marshaled once, per call only the command size and the parameter
+ *              fields are patched. Responses without response parameters are checked with a single compare.
+ *  @file       TPM2_CommandTemplate.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TPM2_CommandTemplate.h"
+#include "TPM2_Marshal.h"
+#include "Platform.h"
+#include "StdInclude.h"
+
+/// Offset of the command size in a command header
+#define TSS_COMMAND_SIZE_OFFSET     2
+
+/// Fixed fields of a response without response parameters (tag TPM_ST_NO_SESSIONS and response size)
+static const TSS_BYTE s_rgbEmptyResponseFields[] = {0x80, 0x01, 0x00, 0x00, 0x00, TSS_RESPONSE_HEADER_SIZE};
+
+/**
+ *  @brief      Marshals the constant fields of a command template
+ *  @details    The command size is set to the size of the template and the parameters are zeroed.
+ *
+ *  @param      PpsTemplate                         Command template.
+ *  @param      Ptag                                Command tag.
+ *  @param      PcommandCode                        Command code.
+ *  @param      PunParameterSize                    Size of the fixed-size parameters in front of the payload in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_Initialize(
+    _Out_   TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    TSS_TPM_ST              Ptag,
+    _In_    TSS_TPM_CC              PcommandCode,
+    _In_    unsigned int            PunParameterSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSizeRemaining = 0;
+        TSS_UINT32 unCommandSize = 0;
+
+        if (NULL == PpsTemplate || PunParameterSize > TSS_COMMAND_TEMPLATE_MAX_SIZE - TSS_COMMAND_HEADER_SIZE)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        Platform_MemorySet(PpsTemplate, 0, sizeof(*PpsTemplate));
+        PpsTemplate->unSize = TSS_COMMAND_HEADER_SIZE + PunParameterSize;
+        unCommandSize = PpsTemplate->unSize;
+
+        pbBuffer = PpsTemplate->rgbTemplate;
+        nSizeRemaining = TSS_COMMAND_HEADER_SIZE;
+        unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&Ptag, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_TPM_CC_Marshal(&PcommandCode, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        PpsTemplate->fInitialized = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Patches the command size of a command template
+ *  @details
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunPayloadSize                      Size of the payload sent after the template in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the command exceeds TSS_MAX_COMMAND_SIZE.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetPayloadSize(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunPayloadSize)
+{
+    unsigned int unCommandSize = 0;
+
+    if (NULL == PpsTemplate || !PpsTemplate->fInitialized || PunPayloadSize > TSS_MAX_COMMAND_SIZE - PpsTemplate->unSize)
+        return RC_E_BAD_PARAMETER;
+
+    unCommandSize = PpsTemplate->unSize + PunPayloadSize;
+    PpsTemplate->rgbTemplate[TSS_COMMAND_SIZE_OFFSET] = (TSS_BYTE)(unCommandSize >> 24);
+    PpsTemplate->rgbTemplate[TSS_COMMAND_SIZE_OFFSET + 1] = (TSS_BYTE)(unCommandSize >> 16);
+    PpsTemplate->rgbTemplate[TSS_COMMAND_SIZE_OFFSET + 2] = (TSS_BYTE)(unCommandSize >> 8);
+    PpsTemplate->rgbTemplate[TSS_COMMAND_SIZE_OFFSET + 3] = (TSS_BYTE)unCommandSize;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Patches a one byte parameter of a command template
+ *  @details
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunOffset                           Offset of the parameter behind the command header in bytes.
+ *  @param      PbValue                             Parameter value.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the parameter exceeds the template.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetUINT8(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunOffset,
+    _In_    TSS_UINT8               PbValue)
+{
+    if (NULL == PpsTemplate || !PpsTemplate->fInitialized || PunOffset + sizeof(PbValue) > PpsTemplate->unSize - TSS_COMMAND_HEADER_SIZE)
+        return RC_E_BAD_PARAMETER;
+
+    PpsTemplate->rgbTemplate[TSS_COMMAND_HEADER_SIZE + PunOffset] = PbValue;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Patches a two byte parameter of a command template
+ *  @details    The value is stored in big endian byte order, e.g. the size field of a TPM2B structure.
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunOffset                           Offset of the parameter behind the command header in bytes.
+ *  @param      PusValue                            Parameter value.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the parameter exceeds the template.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetUINT16(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunOffset,
+    _In_    TSS_UINT16              PusValue)
+{
+    if (NULL == PpsTemplate || !PpsTemplate->fInitialized || PunOffset + sizeof(PusValue) > PpsTemplate->unSize - TSS_COMMAND_HEADER_SIZE)
+        return RC_E_BAD_PARAMETER;
+
+    PpsTemplate->rgbTemplate[TSS_COMMAND_HEADER_SIZE + PunOffset] = (TSS_BYTE)(PusValue >> 8);
+    PpsTemplate->rgbTemplate[TSS_COMMAND_HEADER_SIZE + PunOffset + 1] = (TSS_BYTE)PusValue;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Checks a response without response parameters
+ *  @details    A response of TSS_RESPONSE_HEADER_SIZE bytes with tag TPM_ST_NO_SESSIONS is checked with a single compare of
+ *              the fixed fields. Any other response is unmarshaled field by field.
+ *
+ *  @param      PrgbResponse                        Response buffer.
+ *  @param      PunResponseSize                     Size of the response in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions or the TPM.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_CheckResponse(
+    _In_bytecount_(PunResponseSize) const TSS_BYTE* PrgbResponse,
+    _In_                            unsigned int    PunResponseSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        TSS_BYTE* pbBuffer = (TSS_BYTE*)PrgbResponse;
+        TSS_INT32 nSizeRemaining = (TSS_INT32)PunResponseSize;
+        TSS_TPM_ST tag = 0;
+        TSS_UINT32 unResponseSize = 0;
+        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
+
+        if (NULL == PrgbResponse)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Fixed layout of the expected response, only the response code varies
+        if (TSS_RESPONSE_HEADER_SIZE == PunResponseSize &&
+                0 == Platform_MemoryCompare(PrgbResponse, s_rgbEmptyResponseFields, sizeof(s_rgbEmptyResponseFields)))
+        {
+            responseCode = ((TSS_TPM_RC)PrgbResponse[6] << 24) | ((TSS_TPM_RC)PrgbResponse[7] << 16) |
+                           ((TSS_TPM_RC)PrgbResponse[8] << 8) | (TSS_TPM_RC)PrgbResponse[9];
+        }
+        else
+        {
+            unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
+            if (TSS_TPM_RC_SUCCESS != unReturnValue)
+                break;
+            unReturnValue = TSS_UINT32_Unmarshal(&unResponseSize, &pbBuffer, &nSizeRemaining);
+            if (TSS_TPM_RC_SUCCESS != unReturnValue)
+                break;
+            unReturnValue = TSS_TPM_RC_Unmarshal(&responseCode, &pbBuffer, &nSizeRemaining);
+            if (TSS_TPM_RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        if (responseCode != TSS_TPM_RC_SUCCESS)
+        {
+            unReturnValue = RC_TPM_MASK | responseCode;
+            break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
@@ -0,0 +1,137 @@
+/**
+ *  @brief      Declares pre-marshaled command templates for repeated TPM2.0 commands
+ *  @details    A command template holds the command header (tag, command size, command code) and the fixed-size
+ *              parameters in front of the payload of a command that is sent many times, e.g. TPM2_FieldUpgradeDataVendor.
+ *              The constant fields are marshaled once. Per call only the command size and the parameter fields are patched.
+ *  @file       TPM2_CommandTemplate.h
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+#pragma once
+
+#include "TPM2_Types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Size of a TPM2.0 command header (tag, command size and command code)
+#define TSS_COMMAND_HEADER_SIZE             10
+/// Size of a TPM2.0 response without response parameters (tag, response size and response code)
+#define TSS_RESPONSE_HEADER_SIZE            10
+/// Maximum size of a command template (command header and fixed-size parameters in front of the payload)
+#define TSS_COMMAND_TEMPLATE_MAX_SIZE       16
+
+/**
+ *  @brief      Pre-marshaled command header and fixed-size parameters of a TPM2.0 command
+ *  @details    The template is sent as the first segment of the command, the payload follows in a separate segment.
+ */
+typedef struct tdTSS_COMMAND_TEMPLATE
+{
+    /// TRUE once the template has been marshaled by TSS_CommandTemplate_Initialize
+    TSS_BOOL    fInitialized;
+    /// Size of the template in bytes
+    unsigned int unSize;
+    /// Marshaled template, the command size and the parameters are patched per call
+    TSS_BYTE    rgbTemplate[TSS_COMMAND_TEMPLATE_MAX_SIZE];
+} TSS_COMMAND_TEMPLATE;
+
+/**
+ *  @brief      Marshals the constant fields of a command template
+ *  @details    The command size is set to the size of the template and the parameters are zeroed.
+ *
+ *  @param      PpsTemplate                         Command template.
+ *  @param      Ptag                                Command tag.
+ *  @param      PcommandCode                        Command code.
+ *  @param      PunParameterSize                    Size of the fixed-size parameters in front of the payload in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_Initialize(
+    _Out_   TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    TSS_TPM_ST              Ptag,
+    _In_    TSS_TPM_CC              PcommandCode,
+    _In_    unsigned int            PunParameterSize);
+
+/**
+ *  @brief      Patches the command size of a command template
+ *  @details
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunPayloadSize                      Size of the payload sent after the template in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the command exceeds TSS_MAX_COMMAND_SIZE.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetPayloadSize(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunPayloadSize);
+
+/**
+ *  @brief      Patches a one byte parameter of a command template
+ *  @details
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunOffset                           Offset of the parameter behind the command header in bytes.
+ *  @param      PbValue                             Parameter value.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the parameter exceeds the template.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetUINT8(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunOffset,
+    _In_    TSS_UINT8               PbValue);
+
+/**
+ *  @brief      Patches a two byte parameter of a command template
+ *  @details    The value is stored in big endian byte order, e.g. the size field of a TPM2B structure.
+ *
+ *  @param      PpsTemplate                         Initialized command template.
+ *  @param      PunOffset                           Offset of the parameter behind the command header in bytes.
+ *  @param      PusValue                            Parameter value.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  The template is not initialized or the parameter exceeds the template.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_SetUINT16(
+    _Inout_ TSS_COMMAND_TEMPLATE*   PpsTemplate,
+    _In_    unsigned int            PunOffset,
+    _In_    TSS_UINT16              PusValue);
+
+/**
+ *  @brief      Checks a response without response parameters
+ *  @details    A response of TSS_RESPONSE_HEADER_SIZE bytes with tag TPM_ST_NO_SESSIONS is checked with a single compare of
+ *              the fixed fields. Any other response is unmarshaled field by field.
+ *
+ *  @param      PrgbResponse                        Response buffer.
+ *  @param      PunResponseSize                     Size of the response in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions or the TPM.
+ */
+_Check_return_
+unsigned int
+TSS_CommandTemplate_CheckResponse(
+    _In_bytecount_(PunResponseSize) const TSS_BYTE* PrgbResponse,
+    _In_                            unsigned int    PunResponseSize);
+
+#ifdef __cplusplus
+}
+#endif
@@ -16,10 +16,53 @@
 
 #include "TPM2_FieldUpgradeDataVendor.h"
 #include "TPM2_Marshal.h"
+#include "TPM2_CommandTemplate.h"
 #include "DeviceManagement.h"
 #include "Platform.h"
 #include "StdInclude.h"
 
+/// Pre-marshaled header of the TPM2_FieldUpgradeDataVendor command (the size field of the data block is the only parameter)
+static TSS_COMMAND_TEMPLATE s_sDataVendorTemplate;
+
+/**
+ *  @brief      Patches the size fields of the TPM2_FieldUpgradeDataVendor command template
+ *  @details    Tag and command code are marshaled on first use, afterwards only the command size and the size field of
+ *              the data block are patched.
+ *
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from TSS_CommandTemplate functions.
+ */
+static
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_PatchTemplate(
+    _In_    TSS_UINT16      PusDataSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        // Marshal tag and command code only once
+        if (!s_sDataVendorTemplate.fInitialized)
+        {
+            unReturnValue = TSS_CommandTemplate_Initialize(&s_sDataVendorTemplate, TSS_TPM_ST_NO_SESSIONS, TPM2_CC_FieldUpgradeDataVendor, sizeof(TSS_UINT16));
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        // Command size and size field of the TPM2B_MAX_BUFFER, the buffer itself follows in a separate segment
+        unReturnValue = TSS_CommandTemplate_SetPayloadSize(&s_sDataVendorTemplate, PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_CommandTemplate_SetUINT16(&s_sDataVendorTemplate, 0, PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      This function handles the TPM2_FieldUpgradeDataVendor command
  *  @details    The function receives the input parameters marshals these parameters
@@ -37,27 +80,24 @@ TSS_TPM2_FieldUpgradeDataVendor(
     _In_    TSS_TPM2B_MAX_BUFFER*               PpsFuData)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_ST_NO_SESSIONS;
         TSS_UINT32 unCommandSize = 0;
         TSS_TPM_CC commandCode = TPM2_CC_FieldUpgradeDataVendor;
 
-        // Response parameters
-        TSS_UINT32 unResponseSize = 0;
-        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
-
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -73,35 +113,171 @@ TSS_TPM2_FieldUpgradeDataVendor(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
-        nSizeRemaining = nSizeResponse;
-        unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        unReturnValue = TSS_CommandTemplate_CheckResponse(psContext->rgbResponse, (unsigned int)nSizeResponse);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function marshals the header of a TPM2_FieldUpgradeDataVendor request
+ *  @details    The header consists of tag, command size, command code and the size field of the data block. It is copied
+ *              from a template marshaled on first use, only the size fields are patched. It is sent
+ *              together with the data block by TSS_TPM2_FieldUpgradeDataVendor_Send, so the data block is streamed to
+ *              the TPM directly from its source buffer.
+ *
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *  @param      PrgbHeader                          Buffer receiving the marshaled header.
+ *  @param      PunHeaderBufferSize                 Size of the header buffer in bytes (at least TPM2_FU_DATA_VENDOR_HEADER_SIZE).
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader(
+    _In_                                    TSS_UINT16      PusDataSize,
+    _Out_bytecap_(PunHeaderBufferSize)      TSS_BYTE*       PrgbHeader,
+    _In_                                    unsigned int    PunHeaderBufferSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        if (NULL == PrgbHeader || PunHeaderBufferSize < TPM2_FU_DATA_VENDOR_HEADER_SIZE || PusDataSize > TSS_MAX_COMMAND_SIZE - TPM2_FU_DATA_VENDOR_HEADER_SIZE)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
             break;
-        unReturnValue = TSS_UINT32_Unmarshal(&unResponseSize, &pbBuffer, &nSizeRemaining);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        }
+
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_PatchTemplate(PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = Platform_MemoryCopy(PrgbHeader, PunHeaderBufferSize, s_sDataVendorTemplate.rgbTemplate, TPM2_FU_DATA_VENDOR_HEADER_SIZE);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function sends a TPM2_FieldUpgradeDataVendor request
+ *  @details    The header and the data block are passed as separate segments, so the data block is not copied.
+ *              The function returns as soon as the request is transmitted to the TPM. The response must be
+ *              collected with TSS_TPM2_FieldUpgradeDataVendor_Receive.
+ *
+ *  @param      PrgbHeader                          Header marshaled by TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader.
+ *  @param      PrgbData                            Encrypted field upgrade image data block.
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_SendSegments.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_Send(
+    _In_bytecount_(TPM2_FU_DATA_VENDOR_HEADER_SIZE) const TSS_BYTE* PrgbHeader,
+    _In_bytecount_(PusDataSize)                     const TSS_BYTE* PrgbData,
+    _In_                                            TSS_UINT16      PusDataSize)
+{
+    TPM_TX_SEGMENT rgsSegments[2];
+
+    rgsSegments[0].pbData = PrgbHeader;
+    rgsSegments[0].unSize = TPM2_FU_DATA_VENDOR_HEADER_SIZE;
+    rgsSegments[1].pbData = PrgbData;
+    rgsSegments[1].unSize = PusDataSize;
+
+    return DeviceManagement_SendSegments(rgsSegments, RG_LEN(rgsSegments));
+}
+
+/**
+ *  @brief      This function receives and unmarshals the response of a sent TPM2_FieldUpgradeDataVendor request
+ *  @details
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_Receive and Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_Receive()
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        unsigned int unSizeResponse = sizeof(psContext->rgbResponse);
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        unReturnValue = TSS_TPM_RC_Unmarshal(&responseCode, &pbBuffer, &nSizeRemaining);
+
+        unReturnValue = DeviceManagement_Receive(psContext->rgbResponse, &unSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
-        if (responseCode != TSS_TPM_RC_SUCCESS)
+
+        unReturnValue = TSS_CommandTemplate_CheckResponse(psContext->rgbResponse, unSizeResponse);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function handles the TPM2_FieldUpgradeDataVendor command without copying the data block
+ *  @details    The function patches the request header template, streams the data block to the TPM directly from the
+ *              source buffer and unmarshals the response.
+ *
+ *  @param      PrgbData                            Encrypted field upgrade image data block.
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendorDirect(
+    _In_bytecount_(PusDataSize)     const TSS_BYTE* PrgbData,
+    _In_                            TSS_UINT16      PusDataSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        if (PusDataSize > TSS_MAX_COMMAND_SIZE - TPM2_FU_DATA_VENDOR_HEADER_SIZE)
         {
-            unReturnValue = RC_TPM_MASK | responseCode;
+            unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
+
+        // The template is sent as header segment, no header copy is needed
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_PatchTemplate(PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Send(s_sDataVendorTemplate.rgbTemplate, PrgbData, PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_FieldUpgradeDataVendor_Receive();
     }
     WHILE_FALSE_END;
 
@@ -38,6 +38,75 @@ unsigned int
 TSS_TPM2_FieldUpgradeDataVendor(
     _In_    TSS_TPM2B_MAX_BUFFER*               PpsFuData);
 
+/**
+ *  @brief      This function marshals the header of a TPM2_FieldUpgradeDataVendor request
+ *  @details    The header consists of tag, command size, command code and the size field of the data block. It is sent
+ *              together with the data block by TSS_TPM2_FieldUpgradeDataVendor_Send, so the data block is streamed to
+ *              the TPM directly from its source buffer.
+ *
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *  @param      PrgbHeader                          Buffer receiving the marshaled header.
+ *  @param      PunHeaderBufferSize                 Size of the header buffer in bytes (at least TPM2_FU_DATA_VENDOR_HEADER_SIZE).
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader(
+    _In_                                    TSS_UINT16      PusDataSize,
+    _Out_bytecap_(PunHeaderBufferSize)      TSS_BYTE*       PrgbHeader,
+    _In_                                    unsigned int    PunHeaderBufferSize);
+
+/**
+ *  @brief      This function sends a TPM2_FieldUpgradeDataVendor request
+ *  @details    The header and the data block are passed as separate segments, so the data block is not copied.
+ *              The function returns as soon as the request is transmitted to the TPM. The response must be
+ *              collected with TSS_TPM2_FieldUpgradeDataVendor_Receive.
+ *
+ *  @param      PrgbHeader                          Header marshaled by TSS_TPM2_FieldUpgradeDataVendor_MarshalHeader.
+ *  @param      PrgbData                            Encrypted field upgrade image data block.
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_SendSegments.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_Send(
+    _In_bytecount_(TPM2_FU_DATA_VENDOR_HEADER_SIZE) const TSS_BYTE* PrgbHeader,
+    _In_bytecount_(PusDataSize)                     const TSS_BYTE* PrgbData,
+    _In_                                            TSS_UINT16      PusDataSize);
+
+/**
+ *  @brief      This function receives and unmarshals the response of a sent TPM2_FieldUpgradeDataVendor request
+ *  @details
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_Receive and Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendor_Receive();
+
+/**
+ *  @brief      This function handles the TPM2_FieldUpgradeDataVendor command without copying the data block
+ *  @details    The function marshals the request header, streams the data block to the TPM directly from the
+ *              source buffer and unmarshals the response.
+ *
+ *  @param      PrgbData                            Encrypted field upgrade image data block.
+ *  @param      PusDataSize                         Size of the data block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeDataVendorDirect(
+    _In_bytecount_(PusDataSize)     const TSS_BYTE* PrgbData,
+    _In_                            TSS_UINT16      PusDataSize);
+
 #ifdef __cplusplus
 }
 #endif
@@ -16,10 +16,14 @@
 
 #include "TPM2_FieldUpgradeManifestVendor.h"
 #include "TPM2_Marshal.h"
+#include "TPM2_CommandTemplate.h"
 #include "DeviceManagement.h"
 #include "Platform.h"
 #include "StdInclude.h"
 
+/// Pre-marshaled header of the TPM2_FieldUpgradeManifestVendor command (processing info and size field of the manifest block)
+static TSS_COMMAND_TEMPLATE s_sManifestVendorTemplate;
+
 /**
  *  @brief      This function handles the TPM2_FieldUpgradeManifestVendor command
  *  @details    The function receives the input parameters marshals these parameters
@@ -39,26 +43,24 @@ TSS_TPM2_FieldUpgradeManifestVendor(
     _In_    TSS_TPM2B_MAX_BUFFER*               PpsData)
 {
     unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_ST_NO_SESSIONS;
         TSS_UINT32 unCommandSize = 0;
         TSS_TPM_CC commandCode = TPM2_CC_FieldUpgradeManifestVendor;
-        // Response parameters
-        TSS_UINT32 unResponseSize = 0;
-        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
 
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -78,37 +80,101 @@ TSS_TPM2_FieldUpgradeManifestVendor(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
-        nSizeRemaining = nSizeResponse;
-        unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        unReturnValue = TSS_CommandTemplate_CheckResponse(psContext->rgbResponse, (unsigned int)nSizeResponse);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function handles the TPM2_FieldUpgradeManifestVendor command without copying the manifest block
+ *  @details    The function patches the request header template and streams the manifest block to the TPM directly from the
+ *              source buffer. It then unmarshals the response.
+ *
+ *  @param      PbProcessingInfo                    Processing info (see TPM20_FU_PROCESSING_INFO).
+ *  @param      PrgbData                            Signed manifest block.
+ *  @param      PusDataSize                         Size of the manifest block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeManifestVendorDirect(
+    _In_                            TSS_UINT8       PbProcessingInfo,
+    _In_bytecount_(PusDataSize)     const TSS_BYTE* PrgbData,
+    _In_                            TSS_UINT16      PusDataSize)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TPM_TX_SEGMENT rgsSegments[2];
+        unsigned int unSizeResponse = sizeof(psContext->rgbResponse);
+
+        if (NULL == PrgbData || PusDataSize > TSS_MAX_COMMAND_SIZE - TPM2_FU_MANIFEST_VENDOR_HEADER_SIZE)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
             break;
-        unReturnValue = TSS_UINT32_Unmarshal(&unResponseSize, &pbBuffer, &nSizeRemaining);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        }
+
+        // Marshal tag and command code only once
+        if (!s_sManifestVendorTemplate.fInitialized)
+        {
+            unReturnValue = TSS_CommandTemplate_Initialize(&s_sManifestVendorTemplate, TSS_TPM_ST_NO_SESSIONS, TPM2_CC_FieldUpgradeManifestVendor, sizeof(TSS_UINT8) + sizeof(TSS_UINT16));
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        // Patch command size, processing info and size field of the TPM2B_MAX_BUFFER, the buffer itself follows in a separate segment
+        unReturnValue = TSS_CommandTemplate_SetPayloadSize(&s_sManifestVendorTemplate, PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        unReturnValue = TSS_TPM_RC_Unmarshal(&responseCode, &pbBuffer, &nSizeRemaining);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+        unReturnValue = TSS_CommandTemplate_SetUINT8(&s_sManifestVendorTemplate, 0, PbProcessingInfo);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        if (responseCode != TSS_TPM_RC_SUCCESS)
-        {
-            unReturnValue = RC_TPM_MASK | responseCode;
+        unReturnValue = TSS_CommandTemplate_SetUINT16(&s_sManifestVendorTemplate, sizeof(TSS_UINT8), PusDataSize);
+        if (RC_SUCCESS != unReturnValue)
             break;
-        }
+
+        rgsSegments[0].pbData = s_sManifestVendorTemplate.rgbTemplate;
+        rgsSegments[0].unSize = TPM2_FU_MANIFEST_VENDOR_HEADER_SIZE;
+        rgsSegments[1].pbData = PrgbData;
+        rgsSegments[1].unSize = PusDataSize;
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Transmit the command over TDDL
+        unReturnValue = DeviceManagement_TransmitSegments(rgsSegments, RG_LEN(rgsSegments), psContext->rgbResponse, &unSizeResponse);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        // Unmarshal the response
+        unReturnValue = TSS_CommandTemplate_CheckResponse(psContext->rgbResponse, unSizeResponse);
     }
     WHILE_FALSE_END;
 
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
@@ -44,6 +44,26 @@ TSS_TPM2_FieldUpgradeManifestVendor(
 #define PROCESSING_INFO_FIRST_BLOCK 1
 #define PROCESSING_INFO_CONSECUTIVE_BLOCK 2
 
+/**
+ *  @brief      This function handles the TPM2_FieldUpgradeManifestVendor command without copying the manifest block
+ *  @details    The function marshals the request header and streams the manifest block to the TPM directly from the
+ *              source buffer. It then unmarshals the response.
+ *
+ *  @param      PbProcessingInfo                    Processing info (see TPM20_FU_PROCESSING_INFO).
+ *  @param      PrgbData                            Signed manifest block.
+ *  @param      PusDataSize                         Size of the manifest block in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER                  An invalid parameter was passed to the function.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_FieldUpgradeManifestVendorDirect(
+    _In_                            TSS_UINT8       PbProcessingInfo,
+    _In_bytecount_(PusDataSize)     const TSS_BYTE* PrgbData,
+    _In_                            TSS_UINT16      PusDataSize);
+
 #ifdef __cplusplus
 }
 #endif
@@ -50,6 +50,86 @@ TSS_CalcLRC(
     return bLRC;
 }
 
+/**
+ *  @brief      Marshals a BYTE array and folds it into an LRC
+ *  @details    The array is copied and XORed into the LRC in the same pass, so the payload of a field upgrade command is
+ *              read only once. Four bytes are processed per step, the remaining bytes one at a time. The bytes are
+ *              assembled with shifts, which keeps the helper independent of the alignment of both buffers.
+ *
+ *  @param      PpSource        Location containing the array that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer     Location in the output buffer where the first octet of the array is to be placed.
+ *  @param      PpnSize         Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount         Number of elements.
+ *  @param      PpbLRC          LRC of the preceding command bytes, receives the LRC including the array.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The array does not fit into the output buffer.
+ */
+_Check_return_
+unsigned int
+TSS_BYTE_Array_MarshalLRC(
+    _In_bytecount_(PnCount) const TSS_BYTE* PpSource,
+    _Inout_                 TSS_BYTE**      PprgbBuffer,
+    _Inout_                 TSS_INT32*      PpnSize,
+    _In_                    TSS_INT32       PnCount,
+    _Inout_                 TSS_BYTE*       PpbLRC)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        const TSS_BYTE* pbSource = PpSource;
+        TSS_BYTE* pbTarget = NULL;
+        TSS_UINT32 unWords = 0;
+        TSS_INT32 nIndex = 0;
+
+        // Check parameters
+        if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize) || (NULL == PpbLRC))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (PnCount <= 0)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+        // Check size once for the whole array
+        if (*PpnSize < PnCount)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        pbTarget = *PprgbBuffer;
+        for (; nIndex + 4 <= PnCount; nIndex += 4)
+        {
+            TSS_UINT32 unWord = (TSS_UINT32)pbSource[0] | ((TSS_UINT32)pbSource[1] << 8) |
+                                ((TSS_UINT32)pbSource[2] << 16) | ((TSS_UINT32)pbSource[3] << 24);
+            pbTarget[0] = (TSS_BYTE)unWord;
+            pbTarget[1] = (TSS_BYTE)(unWord >> 8);
+            pbTarget[2] = (TSS_BYTE)(unWord >> 16);
+            pbTarget[3] = (TSS_BYTE)(unWord >> 24);
+            unWords ^= unWord;
+            pbSource += 4;
+            pbTarget += 4;
+        }
+        *PpbLRC ^= (TSS_BYTE)(unWords ^ (unWords >> 8) ^ (unWords >> 16) ^ (unWords >> 24));
+        for (; nIndex < PnCount; nIndex++)
+        {
+            *PpbLRC ^= *pbSource;
+            *(pbTarget++) = *(pbSource++);
+        }
+
+        *PprgbBuffer += PnCount;
+        *PpnSize -= PnCount;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
 //********************************************************************************************************
 //
 // Marshal and unmarshal for structures
@@ -88,7 +168,7 @@ TSS_sMessageDigest_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sMessageDigest_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sMessageDigest_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -140,7 +220,7 @@ TSS_sFirmwarePackage_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sFirmwarePackage_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sFirmwarePackage_d));
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
             unReturnValue = RC_E_BAD_PARAMETER;
@@ -195,7 +275,7 @@ TSS_sVersions_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sVersions_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sVersions_d));
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
             unReturnValue = RC_E_BAD_PARAMETER;
@@ -250,7 +330,7 @@ TSS_sSignedAttributes_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSignedAttributes_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSignedAttributes_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -338,7 +418,7 @@ TSS_sSignerInfo_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSignerInfo_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSignerInfo_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -408,7 +488,7 @@ TSS_sSignedData_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSignedData_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSignedData_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -435,6 +515,146 @@ TSS_sSignedData_d_Unmarshal(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Skips a byte array of a marshaled structure
+ *  @details    A truncated tail is tolerated like by TSS_BYTE_Array_Unmarshal.
+ *
+ *  @param      PprgbBuffer     Pointer to the buffer position.
+ *  @param      PpnBufferSize   Remaining size of the buffer.
+ *  @param      PnCount         Size of the byte array.
+ *  @returns    Number of bytes skipped.
+ */
+static
+TSS_INT32
+TSS_SkipBytes(
+    _Inout_ TSS_BYTE**      PprgbBuffer,
+    _Inout_ TSS_INT32*      PpnBufferSize,
+    _In_    TSS_INT32       PnCount)
+{
+    TSS_INT32 nCount = MIN(PnCount, *PpnBufferSize);
+    *PprgbBuffer += nCount;
+    *PpnBufferSize -= nCount;
+    return nCount;
+}
+
+/**
+ *  @brief      Unmarshal a view of a structure of type sSignedData_d
+ *  @details    Decodes the scalar fields and records the offsets and sizes of the message digest, the versions and the
+ *              signature within PrgbBuffer without copying them. The byte arrays are bounds-checked like by
+ *              TSS_sSignedData_d_Unmarshal, i.e. a truncated tail of a byte array is tolerated.
+ *
+ *  @param      PpTarget        Pointer to the target view.
+ *  @param      PrgbBuffer      Buffer holding the marshaled structure, must stay valid while the view is used.
+ *  @param      PnBufferSize    Size of the buffer (at most 0xFFFF bytes).
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function or the message digest exceeds 32 bytes.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_sSignedData_d_UnmarshalView(
+    _Out_                           sSignedDataView_d*  PpTarget,
+    _In_bytecount_(PnBufferSize)    const TSS_BYTE*     PrgbBuffer,
+    _In_                            TSS_INT32           PnBufferSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        TSS_BYTE* pbBuffer = (TSS_BYTE*)PrgbBuffer;
+        TSS_INT32 nBufferSize = PnBufferSize;
+        TSS_UINT16 usInternal = 0;
+        TSS_UINT32 unInternal = 0;
+
+        // Check and initialize _Out_ parameters
+        if (NULL == PpTarget)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSignedDataView_d));
+        // Check _In_ parameters
+        if ((NULL == PrgbBuffer) || (PnBufferSize < 0) || (PnBufferSize > 0xFFFF))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // The scalar fields in front of the message digest are unmarshaled to detect a truncated buffer like
+        // TSS_sSignedData_d_Unmarshal: internal1, internal2 and wSignerInfoSize of sSignedData_d, internal1 to internal5 of
+        // sSignerInfo_d and internal1 to internal3 of sSignedAttributes_d
+        unReturnValue = TSS_UINT32_Unmarshal(&unInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Unmarshal(&unInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Unmarshal(&unInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sSignedAttributes_d*)NULL)->internal2));
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // sMessageDigest_d
+        unReturnValue = TSS_UINT16_Unmarshal(&PpTarget->wMessageDigestSize, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        if (PpTarget->wMessageDigestSize > sizeof(((sMessageDigest_d*)NULL)->rgbMessageDigest))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        PpTarget->wMessageDigestOffset = (uint16_t)(pbBuffer - PrgbBuffer);
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, PpTarget->wMessageDigestSize);
+
+        // sFirmwarePackage_d, internal6 to internal8 and DecryptKeyId
+        unReturnValue = TSS_sFirmwarePackage_d_Unmarshal(&PpTarget->sFirmwarePackage, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sSignedAttributes_d*)NULL)->internal6) +
+                      sizeof(((sSignedAttributes_d*)NULL)->internal7) + sizeof(((sSignedAttributes_d*)NULL)->internal8));
+        unReturnValue = TSS_DecryptKeyId_d_Unmarshal(&PpTarget->DecryptKeyId, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sSignedAttributes_d*)NULL)->internal10));
+
+        // sVersions_d
+        unReturnValue = TSS_UINT32_Unmarshal(&unInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT16_Unmarshal(&PpTarget->wVersionEntries, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        PpTarget->wVersionsOffset = (uint16_t)(pbBuffer - PrgbBuffer);
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sVersions_d*)NULL)->Version));
+
+        // internal12 and internal13 of sSignedAttributes_d, internal7 and the signature of sSignerInfo_d
+        TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sSignedAttributes_d*)NULL)->internal12) + sizeof(((sSignedAttributes_d*)NULL)->internal13));
+        unReturnValue = TSS_UINT16_Unmarshal(&usInternal, &pbBuffer, &nBufferSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        PpTarget->wSignatureOffset = (uint16_t)(pbBuffer - PrgbBuffer);
+        PpTarget->wSignatureSize = (uint16_t)TSS_SkipBytes(&pbBuffer, &nBufferSize, sizeof(((sSignerInfo_d*)NULL)->internal8));
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      Unmarshal structure of type sSecurityModuleLogicInfo_d
  *  @details
@@ -463,7 +683,7 @@ TSS_sSecurityModuleLogicInfo_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSecurityModuleLogicInfo_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSecurityModuleLogicInfo_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -533,7 +753,7 @@ TSS_sSecurityModuleLogicInfo2_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSecurityModuleLogicInfo2_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSecurityModuleLogicInfo2_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -607,7 +827,7 @@ TSS_sKeyList_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sKeyList_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sKeyList_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -677,7 +897,7 @@ TSS_sSecurityModuleLogic_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sSecurityModuleLogic_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sSecurityModuleLogic_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -735,7 +955,7 @@ TSS_sFirmwarePackages_d_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(sFirmwarePackages_d));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(sFirmwarePackages_d));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -41,6 +41,31 @@ TSS_CalcLRC(
     _In_bytecount_(PunDataSize) uint8_t*    PrgbData,
     _In_                        uint32_t    PunDataSize);
 
+/**
+ *  @brief      Marshals a BYTE array and folds it into an LRC
+ *  @details    The array is copied and XORed into the LRC in the same pass, so the payload of a field upgrade command is
+ *              read only once. Four bytes are processed per step, the remaining bytes one at a time. The bytes are
+ *              assembled with shifts, which keeps the helper independent of the alignment of both buffers.
+ *
+ *  @param      PpSource        Location containing the array that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer     Location in the output buffer where the first octet of the array is to be placed.
+ *  @param      PpnSize         Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount         Number of elements.
+ *  @param      PpbLRC          LRC of the preceding command bytes, receives the LRC including the array.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The array does not fit into the output buffer.
+ */
+_Check_return_
+unsigned int
+TSS_BYTE_Array_MarshalLRC(
+    _In_bytecount_(PnCount) const TSS_BYTE* PpSource,
+    _Inout_                 TSS_BYTE**      PprgbBuffer,
+    _Inout_                 TSS_INT32*      PpnSize,
+    _In_                    TSS_INT32       PnCount,
+    _Inout_                 TSS_BYTE*       PpbLRC);
+
 //********************************************************************************************************
 //
 // Marshal and unmarshal for types
@@ -196,6 +221,27 @@ TSS_sSignedData_d_Unmarshal(
     _Inout_ TSS_BYTE**          PprgbBuffer,
     _Inout_ TSS_INT32*          PpnBufferSize);
 
+/**
+ *  @brief      Unmarshal a view of a structure of type sSignedData_d
+ *  @details    Decodes the scalar fields and records the offsets and sizes of the message digest, the versions and the
+ *              signature within PrgbBuffer without copying them. The byte arrays are bounds-checked like by
+ *              TSS_sSignedData_d_Unmarshal, i.e. a truncated tail of a byte array is tolerated.
+ *
+ *  @param      PpTarget        Pointer to the target view.
+ *  @param      PrgbBuffer      Buffer holding the marshaled structure, must stay valid while the view is used.
+ *  @param      PnBufferSize    Size of the buffer (at most 0xFFFF bytes).
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function or the message digest exceeds 32 bytes.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_sSignedData_d_UnmarshalView(
+    _Out_                           sSignedDataView_d*  PpTarget,
+    _In_bytecount_(PnBufferSize)    const TSS_BYTE*     PrgbBuffer,
+    _In_                            TSS_INT32           PnBufferSize);
+
 /**
  *  @brief      Unmarshal structure of type sSecurityModuleLogicInfo_d
  *  @details
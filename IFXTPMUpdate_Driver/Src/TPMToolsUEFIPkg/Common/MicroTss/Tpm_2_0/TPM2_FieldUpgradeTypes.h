@@ -30,6 +30,11 @@
 #define     TPM2_CC_FieldUpgradeDataVendor      (TSS_TPM_CC)(0x20000132)
 #define     TPM2_CC_FieldUpgradeFinalizeVendor  (TSS_TPM_CC)(0x20000133)
 
+/// Size of the TPM2_FieldUpgradeDataVendor request header including the size field of the data block
+#define     TPM2_FU_DATA_VENDOR_HEADER_SIZE     12
+/// Size of the TPM2_FieldUpgradeManifestVendor request header including processing info and the size field of the manifest block
+#define     TPM2_FU_MANIFEST_VENDOR_HEADER_SIZE 13
+
 /// TPM1.2 FieldUpgrade sub commands
 #define     TPM_FieldUpgradeInfoRequest     0x10
 #define     TPM_FieldUpgradeInfoRequest2    0x11
@@ -174,6 +179,31 @@ typedef struct sSignedData_d
     sSignerInfo_d           sSignerInfo;
 } sSignedData_d;
 
+/**
+ *  @brief      View of a Signed Firmware Data Info structure
+ *  @details    Filled by TSS_sSignedData_d_UnmarshalView. The scalar fields are decoded, the byte arrays are located by their
+ *              offset within the unmarshaled buffer instead of being copied.
+ */
+typedef struct sSignedDataView_d
+{
+    /// Offset of sMessageDigest.rgbMessageDigest within the buffer in bytes
+    uint16_t                wMessageDigestOffset;
+    /// sMessageDigest.wSize
+    uint16_t                wMessageDigestSize;
+    /// sFirmwarePackage of the signed attributes
+    sFirmwarePackage_d      sFirmwarePackage;
+    /// DecryptKeyId of the signed attributes
+    DecryptKeyId_d          DecryptKeyId;
+    /// Offset of sVersions.Version within the buffer in bytes
+    uint16_t                wVersionsOffset;
+    /// sVersions.wEntries
+    uint16_t                wVersionEntries;
+    /// Offset of the signature (sSignerInfo.internal8) within the buffer in bytes
+    uint16_t                wSignatureOffset;
+    /// Size of the signature available in the buffer in bytes
+    uint16_t                wSignatureSize;
+} sSignedDataView_d;
+
 /**
  *  @brief      Security Module Logic structure
  */
@@ -62,29 +62,40 @@
 #include "StdInclude.h"
 
 /**
- *  @brief  Implementation of TPM2_GetCapability command.
+ *  @brief      Sends a TPM2_GetCapability command and unmarshals the response header
+ *  @details    On success the response buffer position is left at the capability data so that callers can decode only
+ *              the part of the capability data they need.
  *
- *  @retval TPM_RC_HANDLE                   value of property is in an unsupported handle range for the TPM_CAP_HANDLES capability value.
- *  @retval TPM_RC_VALUE                    invalid capability; or property is not 0 for the TPM_CAP_PCRS capability value.
+ *  @param      capability          Group selection.
+ *  @param      property            Further definition of information.
+ *  @param      propertyCount       Number of properties of the indicated type to return.
+ *  @param      psContext           Command context holding the request and response buffers.
+ *  @param      pMoreData           Receives the moreData flag of the response.
+ *  @param      ppbBuffer           Receives the position of the capability data in the response buffer.
+ *  @param      pnSizeRemaining     Receives the number of response bytes from that position on.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from called functions and TPM response codes masked with RC_TPM_MASK.
  */
+static
 _Check_return_
 unsigned int
-TSS_TPM2_GetCapability(
-    _In_    TSS_TPM_CAP                     capability,
-    _In_    TSS_UINT32                      property,
-    _In_    TSS_UINT32                      propertyCount,
-    _Out_   TSS_TPMI_YES_NO*                pMoreData,
-    _Out_   TSS_TPMS_CAPABILITY_DATA*       pCapabilityData
+TSS_TPM2_GetCapability_Execute(
+    _In_    TSS_TPM_CAP                             capability,
+    _In_    TSS_UINT32                              property,
+    _In_    TSS_UINT32                              propertyCount,
+    _Inout_ DEVICE_MANAGEMENT_COMMAND_CONTEXT*      psContext,
+    _Out_   TSS_TPMI_YES_NO*                        pMoreData,
+    _Out_   TSS_BYTE**                              ppbBuffer,
+    _Out_   TSS_INT32*                              pnSizeRemaining
 )
 {
     unsigned int unReturnValue = RC_SUCCESS;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
         TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_ST_NO_SESSIONS;
         TSS_UINT32 unCommandSize = 0;
@@ -93,13 +104,12 @@ TSS_TPM2_GetCapability(
         TSS_UINT32 unResponseSize = 0;
         TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
         // Initialize _Out_ parameters
         Platform_MemorySet(pMoreData, 0x00, sizeof(TSS_TPMI_YES_NO));
-        Platform_MemorySet(pCapabilityData, 0x00, sizeof(TSS_TPMS_CAPABILITY_DATA));
+        *ppbBuffer = NULL;
+        *pnSizeRemaining = 0;
         // Marshal the request
-        pbBuffer = rgbRequest;
+        pbBuffer = psContext->rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -120,20 +130,20 @@ TSS_TPM2_GetCapability(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
         // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
 
         // Unmarshal the response
-        pbBuffer = rgbResponse;
+        pbBuffer = psContext->rgbResponse;
         nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
@@ -150,6 +160,49 @@ TSS_TPM2_GetCapability(
             break;
         }
         unReturnValue = TSS_TPMI_YES_NO_Unmarshal(pMoreData, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        *ppbBuffer = pbBuffer;
+        *pnSizeRemaining = nSizeRemaining;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief  Implementation of TPM2_GetCapability command.
+ *
+ *  @retval TPM_RC_HANDLE                   value of property is in an unsupported handle range for the TPM_CAP_HANDLES capability value.
+ *  @retval TPM_RC_VALUE                    invalid capability; or property is not 0 for the TPM_CAP_PCRS capability value.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_GetCapability(
+    _In_    TSS_TPM_CAP                     capability,
+    _In_    TSS_UINT32                      property,
+    _In_    TSS_UINT32                      propertyCount,
+    _Out_   TSS_TPMI_YES_NO*                pMoreData,
+    _Out_   TSS_TPMS_CAPABILITY_DATA*       pCapabilityData
+)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSizeRemaining = 0;
+
+        // Initialize _Out_ parameters
+        Platform_MemorySet(pMoreData, 0x00, sizeof(TSS_TPMI_YES_NO));
+        Platform_MemorySet(pCapabilityData, 0x00, sizeof(TSS_TPMS_CAPABILITY_DATA));
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_GetCapability_Execute(capability, property, propertyCount, psContext, pMoreData, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
         unReturnValue = TSS_TPMS_CAPABILITY_DATA_Unmarshal(pCapabilityData, &pbBuffer, &nSizeRemaining);
@@ -157,5 +210,176 @@ TSS_TPM2_GetCapability(
             break;
     }
     WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads a single TPM property (TPM_CAP_TPM_PROPERTIES)
+ *  @details    The value is decoded directly from the response buffer without materializing a TPMS_CAPABILITY_DATA
+ *              structure.
+ *
+ *  @param      property            Property identifier (TPM_PT).
+ *  @param      pValue              Receives the property value.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_FOUND      The TPM did not return the requested property (the property is not implemented).
+ *  @retval     RC_E_FAIL           The TPM returned an unexpected capability.
+ *  @retval     ...                 Error codes from called functions and TPM response codes masked with RC_TPM_MASK.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_GetTpmProperty(
+    _In_    TSS_UINT32                      property,
+    _Out_   TSS_UINT32*                     pValue
+)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSizeRemaining = 0;
+        TSS_TPMI_YES_NO moreData = 0;
+        TSS_TPM_CAP capability = 0;
+        TSS_UINT32 unCount = 0;
+        TSS_UINT32 unProperty = 0;
+
+        // Check and initialize _Out_ parameters
+        if (NULL == pValue)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *pValue = 0;
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_GetCapability_Execute(TSS_TPM_CAP_TPM_PROPERTIES, property, 1, psContext, &moreData, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        // Decode TPMS_CAPABILITY_DATA.capability and the TPML_TAGGED_TPM_PROPERTY up to the first property
+        unReturnValue = TSS_TPM_CAP_Unmarshal(&capability, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        if (TSS_TPM_CAP_TPM_PROPERTIES != capability)
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+        unReturnValue = TSS_UINT32_Unmarshal(&unCount, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        if (0 == unCount)
+        {
+            unReturnValue = RC_E_NOT_FOUND;
+            break;
+        }
+        unReturnValue = TSS_UINT32_Unmarshal(&unProperty, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        // The TPM continues with the next implemented property if the requested one is not implemented
+        if (property != unProperty)
+        {
+            unReturnValue = RC_E_NOT_FOUND;
+            break;
+        }
+        unReturnValue = TSS_UINT32_Unmarshal(pValue, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads a single vendor property (TPM_CAP_VENDOR_PROPERTY)
+ *  @details    The property bytes are copied directly from the response buffer into the caller's buffer without
+ *              materializing a TPMS_VENDOR_CAPABILITY_DATA structure.
+ *
+ *  @param      property            Vendor property identifier.
+ *  @param      pValue              Receives the property bytes.
+ *  @param      pValueSize          In: Size of pValue in bytes. Out: Size of the property in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   pValue is too small for the property. pValueSize receives the required size.
+ *  @retval     RC_E_FAIL               The TPM returned an unexpected capability or not exactly one property.
+ *  @retval     ...                     Error codes from called functions and TPM response codes masked with RC_TPM_MASK.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_GetVendorProperty(
+    _In_                        TSS_UINT32      property,
+    _Out_bytecap_(*pValueSize)  TSS_BYTE*       pValue,
+    _Inout_                     TSS_UINT32*     pValueSize
+)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSizeRemaining = 0;
+        TSS_TPMI_YES_NO moreData = 0;
+        TSS_TPM_CAP capability = 0;
+        TSS_UINT32 unCount = 0;
+        TSS_UINT16 usSize = 0;
+
+        // Check and initialize _Out_ parameters
+        if (NULL == pValue || NULL == pValueSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        Platform_MemorySet(pValue, 0x00, *pValueSize);
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_GetCapability_Execute(TSS_TPM_CAP_VENDOR_PROPERTY, property, 1, psContext, &moreData, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        // Decode TPMS_VENDOR_CAPABILITY_DATA.capability and the TPML_MAX_BUFFER up to the first buffer
+        unReturnValue = TSS_TPM_CAP_Unmarshal(&capability, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Unmarshal(&unCount, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        if (TSS_TPM_CAP_VENDOR_PROPERTY != capability || 1 != unCount)
+        {
+            unReturnValue = RC_E_FAIL;
+            break;
+        }
+        unReturnValue = TSS_UINT16_Unmarshal(&usSize, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        if (usSize > *pValueSize)
+        {
+            *pValueSize = usSize;
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        unReturnValue = TSS_BYTE_Array_Unmarshal(pValue, &pbBuffer, &nSizeRemaining, usSize);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        *pValueSize = usSize;
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
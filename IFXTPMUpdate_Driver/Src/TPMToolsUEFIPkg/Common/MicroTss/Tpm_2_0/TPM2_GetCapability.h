@@ -78,6 +78,50 @@ TSS_TPM2_GetCapability(
     _Out_   TSS_TPMS_CAPABILITY_DATA*       pCapabilityData
 );
 
+/**
+ *  @brief      Reads a single TPM property (TPM_CAP_TPM_PROPERTIES)
+ *  @details    The value is decoded directly from the response buffer without materializing a TPMS_CAPABILITY_DATA
+ *              structure.
+ *
+ *  @param      property            Property identifier (TPM_PT).
+ *  @param      pValue              Receives the property value.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_FOUND      The TPM did not return the requested property (the property is not implemented).
+ *  @retval     RC_E_FAIL           The TPM returned an unexpected capability.
+ *  @retval     ...                 Error codes from called functions and TPM response codes masked with RC_TPM_MASK.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_GetTpmProperty(
+    _In_    TSS_UINT32                      property,
+    _Out_   TSS_UINT32*                     pValue
+);
+
+/**
+ *  @brief      Reads a single vendor property (TPM_CAP_VENDOR_PROPERTY)
+ *  @details    The property bytes are copied directly from the response buffer into the caller's buffer without
+ *              materializing a TPMS_VENDOR_CAPABILITY_DATA structure.
+ *
+ *  @param      property            Vendor property identifier.
+ *  @param      pValue              Receives the property bytes.
+ *  @param      pValueSize          In: Size of pValue in bytes. Out: Size of the property in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   pValue is too small for the property. pValueSize receives the required size.
+ *  @retval     RC_E_FAIL               The TPM returned an unexpected capability or not exactly one property.
+ *  @retval     ...                     Error codes from called functions and TPM response codes masked with RC_TPM_MASK.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_GetVendorProperty(
+    _In_                        TSS_UINT32      property,
+    _Out_bytecap_(*pValueSize)  TSS_BYTE*       pValue,
+    _Inout_                     TSS_UINT32*     pValueSize
+);
+
 #ifdef __cplusplus
 }
 #endif
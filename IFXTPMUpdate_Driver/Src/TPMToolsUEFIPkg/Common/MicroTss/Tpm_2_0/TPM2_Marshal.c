@@ -128,7 +128,7 @@ TSS_UINT8_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_UINT8));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT8));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -171,23 +171,32 @@ TSS_UINT8_Array_Marshal(
     _In_    TSS_INT32           PnCount)
 {
     unsigned int unReturnValue = RC_E_FAIL;
-    // Check parameters
-    if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-    {
-        unReturnValue = RC_E_BAD_PARAMETER;
-    }
-    else
+    do
     {
-        TSS_INT32 nPos;
-        unReturnValue = RC_SUCCESS;
-        // Marshal byte by byte to the buffer
-        for (nPos = 0; nPos < PnCount; nPos++)
+        // Check parameters
+        if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
-            unReturnValue = TSS_UINT8_Marshal(&PpSource[nPos], PprgbBuffer, PpnSize);
-            if (RC_SUCCESS != unReturnValue)
-                break;
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
         }
+        if (PnCount <= 0)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+        // Check size once for the whole array
+        if (*PpnSize < PnCount)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        // Copy the whole array to the buffer
+        Platform_MemoryCopyFast(*PprgbBuffer, PpSource, (unsigned int)PnCount);
+        *PprgbBuffer += PnCount;
+        *PpnSize -= PnCount;
+        unReturnValue = RC_SUCCESS;
     }
+    WHILE_FALSE_END;
     return unReturnValue;
 }
 
@@ -214,13 +223,15 @@ TSS_UINT8_Array_Unmarshal(
     unsigned int unReturnValue = RC_E_FAIL;
     do
     {
+        TSS_INT32 nCount = PnCount;
+
         // Check and initialize _Out_ parameters
         if (NULL == PpTarget)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_UINT8));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT8));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -228,15 +239,14 @@ TSS_UINT8_Array_Unmarshal(
             break;
         }
 
-        if (PnCount != 0)
+        // Copy as many elements as available at once (a truncated tail is tolerated like before)
+        if (nCount > *PpnSize)
+            nCount = *PpnSize;
+        if (nCount > 0)
         {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_UINT8_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
+            Platform_MemoryCopyFast(PpTarget, *PprgbBuffer, (unsigned int)nCount);
+            *PprgbBuffer += nCount;
+            *PpnSize -= nCount;
         }
         unReturnValue = RC_SUCCESS;
     }
@@ -307,23 +317,32 @@ TSS_BYTE_Array_Marshal(
     _In_    TSS_INT32           PnCount)
 {
     unsigned int unReturnValue = RC_E_FAIL;
-    // Check parameters
-    if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-    {
-        unReturnValue = RC_E_BAD_PARAMETER;
-    }
-    else
+    do
     {
-        TSS_INT32 nPos;
-        unReturnValue = RC_SUCCESS;
-        // Marshal byte by byte to the buffer
-        for (nPos = 0; nPos < PnCount; nPos++)
+        // Check parameters
+        if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (PnCount <= 0)
         {
-            unReturnValue = TSS_BYTE_Marshal(&PpSource[nPos], PprgbBuffer, PpnSize);
-            if (RC_SUCCESS != unReturnValue)
-                break;
+            unReturnValue = RC_SUCCESS;
+            break;
         }
+        // Check size once for the whole array
+        if (*PpnSize < PnCount)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        // Copy the whole array to the buffer
+        Platform_MemoryCopyFast(*PprgbBuffer, PpSource, (unsigned int)PnCount);
+        *PprgbBuffer += PnCount;
+        *PpnSize -= PnCount;
+        unReturnValue = RC_SUCCESS;
     }
+    WHILE_FALSE_END;
     return unReturnValue;
 }
 
@@ -350,13 +369,15 @@ TSS_BYTE_Array_Unmarshal(
     unsigned int unReturnValue = RC_E_FAIL;
     do
     {
+        TSS_INT32 nCount = PnCount;
+
         // Check and initialize _Out_ parameters
         if (NULL == PpTarget)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_BYTE));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_BYTE));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -364,15 +385,14 @@ TSS_BYTE_Array_Unmarshal(
             break;
         }
 
-        if (PnCount != 0)
+        // Copy as many elements as available at once (a truncated tail is tolerated like before)
+        if (nCount > *PpnSize)
+            nCount = *PpnSize;
+        if (nCount > 0)
         {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_BYTE_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
+            Platform_MemoryCopyFast(PpTarget, *PprgbBuffer, (unsigned int)nCount);
+            *PprgbBuffer += nCount;
+            *PpnSize -= nCount;
         }
         unReturnValue = RC_SUCCESS;
     }
@@ -494,7 +514,7 @@ TSS_UINT16_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_UINT16));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT16));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -515,6 +535,123 @@ TSS_UINT16_Unmarshal(
     WHILE_FALSE_END;
     return unReturnValue;
 }
+/**
+ *  @brief      Marshals a UINT16 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpSource    Location containing the value that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer Location in the output buffer where the first octet of the TYPE is to be placed.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT16_Array_Marshal(
+    _In_    const TSS_UINT16*   PpSource,
+    _Inout_ TSS_BYTE**          PprgbBuffer,
+    _Inout_ TSS_INT32*          PpnSize,
+    _In_    TSS_INT32           PnCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nPos;
+
+        // Check parameters
+        if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (PnCount <= 0)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+        // Check size once for the whole array
+        if (PnCount > *PpnSize / 2)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        // Swap all elements to big endian without revalidating each one
+        pbBuffer = *PprgbBuffer;
+        for (nPos = 0; nPos < PnCount; nPos++, pbBuffer += 2)
+        {
+            UINT16_TO_BYTE_ARRAY(PpSource[nPos], pbBuffer);
+        }
+        *PprgbBuffer += PnCount * 2;
+        *PpnSize -= PnCount * 2;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Unmarshals a UINT16 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpTarget    Location into which the data from **PprgbBuffer is placed.
+ *  @param      PprgbBuffer Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT16_Array_Unmarshal(
+    _Out_   TSS_UINT16*     PpTarget,
+    _Inout_ TSS_BYTE**      PprgbBuffer,
+    _Inout_ TSS_INT32*      PpnSize,
+    _In_    TSS_INT32       PnCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nCount = PnCount;
+        TSS_INT32 nPos;
+
+        // Check and initialize _Out_ parameters
+        if (NULL == PpTarget)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT16));
+        // Check _Inout_ parameters
+        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Swap as many complete elements as available at once (a truncated tail is tolerated like before)
+        if (nCount > *PpnSize / 2)
+            nCount = *PpnSize / 2;
+        pbBuffer = *PprgbBuffer;
+        for (nPos = 0; nPos < nCount; nPos++, pbBuffer += 2)
+        {
+            BYTE_ARRAY_TO_UINT16(pbBuffer, PpTarget[nPos]);
+        }
+        if (nCount > 0)
+        {
+            *PprgbBuffer += nCount * 2;
+            *PpnSize -= nCount * 2;
+        }
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+    return unReturnValue;
+}
+
 
 /**
  *  @brief      Marshals a UINT32 type
@@ -555,6 +692,63 @@ TSS_UINT32_Marshal(
     }
     return unReturnValue;
 }
+/**
+ *  @brief      Marshals a UINT32 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpSource    Location containing the value that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer Location in the output buffer where the first octet of the TYPE is to be placed.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT32_Array_Marshal(
+    _In_    const TSS_UINT32*   PpSource,
+    _Inout_ TSS_BYTE**          PprgbBuffer,
+    _Inout_ TSS_INT32*          PpnSize,
+    _In_    TSS_INT32           PnCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nPos;
+
+        // Check parameters
+        if ((NULL == PpSource) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (PnCount <= 0)
+        {
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+        // Check size once for the whole array
+        if (PnCount > *PpnSize / 4)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        // Swap all elements to big endian without revalidating each one
+        pbBuffer = *PprgbBuffer;
+        for (nPos = 0; nPos < PnCount; nPos++, pbBuffer += 4)
+        {
+            UINT32_TO_BYTE_ARRAY(PpSource[nPos], pbBuffer);
+        }
+        *PprgbBuffer += PnCount * 4;
+        *PpnSize -= PnCount * 4;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+    return unReturnValue;
+}
+
 
 /**
  *  @brief      Unmarshals a UINT32 type
@@ -583,7 +777,7 @@ TSS_UINT32_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_UINT32));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT32));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -628,13 +822,17 @@ TSS_UINT32_Array_Unmarshal(
     unsigned int unReturnValue = RC_E_FAIL;
     do
     {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nCount = PnCount;
+        TSS_INT32 nPos;
+
         // Check and initialize _Out_ parameters
         if (NULL == PpTarget)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_UINT32));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_UINT32));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -642,15 +840,18 @@ TSS_UINT32_Array_Unmarshal(
             break;
         }
 
-        if (PnCount != 0)
+        // Swap as many complete elements as available at once (a truncated tail is tolerated like before)
+        if (nCount > *PpnSize / 4)
+            nCount = *PpnSize / 4;
+        pbBuffer = *PprgbBuffer;
+        for (nPos = 0; nPos < nCount; nPos++, pbBuffer += 4)
         {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_UINT32_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
+            BYTE_ARRAY_TO_UINT32(pbBuffer, PpTarget[nPos]);
+        }
+        if (nCount > 0)
+        {
+            *PprgbBuffer += nCount * 4;
+            *PpnSize -= nCount * 4;
         }
         unReturnValue = RC_SUCCESS;
     }
@@ -804,37 +1005,7 @@ TSS_TPM_ECC_CURVE_Array_Unmarshal(
     _Inout_ TSS_INT32*                  PpnSize,
     _In_    TSS_INT32                   PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM_ECC_CURVE));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPM_ECC_CURVE_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_UINT16_Array_Unmarshal((TSS_UINT16 *)PpTarget, PprgbBuffer, PpnSize, PnCount);
 }
 
 /**
@@ -899,37 +1070,7 @@ TSS_TPM_CC_Array_Unmarshal(
     _Inout_ TSS_INT32*          PpnSize,
     _In_    TSS_INT32           PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM_CC));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPM_CC_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_UINT32_Array_Unmarshal((TSS_UINT32 *)PpTarget, PprgbBuffer, PpnSize, PnCount);
 }
 
 /**
@@ -1158,41 +1299,11 @@ _Check_return_
 unsigned int
 TSS_TPM_HANDLE_Array_Unmarshal(
     _Out_   TSS_TPM_HANDLE*     PpTarget,
-    _Inout_ TSS_BYTE**          PprgbBuffer,
-    _Inout_ TSS_INT32*          PpnSize,
-    _In_    TSS_INT32           PnCount)
-{
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM_HANDLE));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPM_HANDLE_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    _Inout_ TSS_BYTE**          PprgbBuffer,
+    _Inout_ TSS_INT32*          PpnSize,
+    _In_    TSS_INT32           PnCount)
+{
+    return TSS_UINT32_Array_Unmarshal((TSS_UINT32 *)PpTarget, PprgbBuffer, PpnSize, PnCount);
 }
 
 /**
@@ -1308,7 +1419,7 @@ TSS_TPMA_CC_Array_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMA_CC));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPMA_CC));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -1825,7 +1936,7 @@ TSS_TPMT_HA_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMT_HA));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPMT_HA));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -1922,7 +2033,7 @@ TSS_TPM2B_DIGEST_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM2B_DIGEST));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPM2B_DIGEST));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2103,7 +2214,7 @@ TSS_TPM2B_MAX_BUFFER_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM2B_MAX_BUFFER));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPM2B_MAX_BUFFER));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2150,7 +2261,7 @@ TSS_TPM2B_MAX_BUFFER_Array_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM2B_MAX_BUFFER));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPM2B_MAX_BUFFER));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2201,7 +2312,7 @@ TSS_TPM2B_TIMEOUT_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPM2B_TIMEOUT));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPM2B_TIMEOUT));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2220,53 +2331,164 @@ TSS_TPM2B_TIMEOUT_Unmarshal(
 }
 
 /**
- *  @brief      Unmarshals a TSS_TPMS_PCR_SELECTION structure
- *  @details    Refer to: Table 85 - Definition of TPMS_PCR_SELECTION Structure
+ *  @brief      Unmarshals table-described structures
+ *  @details    Unmarshals PnCount consecutive structures of PnStride bytes each. Every structure is described once by a
+ *              field table, so flat structures share one interpreter loop instead of a hand-coded function per type.
+ *              Byte array fields are bounded by their capacity. The buffer position is only advanced on success.
  *
- *  @param      PpTarget    Location into which the data from **PprgbBuffer is placed.
- *  @param      PprgbBuffer Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
- *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PpTarget        Location into which the data from **PprgbBuffer is placed.
+ *  @param      PnStride        Size of one structure in bytes.
+ *  @param      PnCount         Number of structures.
+ *  @param      PrgsFields      Field table of the structure, in wire order.
+ *  @param      PnFieldCount    Number of entries in the field table.
+ *  @param      PprgbBuffer     Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
+ *  @param      PpnSize         Number of octets remaining in **PprgbBuffer.
  *
- *  @retval     RC_SUCCESS  The operation completed successfully.
- *  @retval     ...         Error codes from called functions.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function or a byte array exceeds its capacity.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The buffer ends within a structure.
  */
 _Check_return_
 unsigned int
-TSS_TPMS_PCR_SELECTION_Unmarshal(
-    _Out_   TSS_TPMS_PCR_SELECTION*         PpTarget,
-    _Inout_ TSS_BYTE**                      PprgbBuffer,
-    _Inout_ TSS_INT32*                      PpnSize)
+TSS_Fields_Unmarshal(
+    _Out_bytecap_(PnStride * PnCount)   void*                           PpTarget,
+    _In_                                TSS_INT32                       PnStride,
+    _In_                                TSS_INT32                       PnCount,
+    _In_count_(PnFieldCount)            const TSS_FIELD_DESCRIPTOR*     PrgsFields,
+    _In_                                TSS_INT32                       PnFieldCount,
+    _Inout_                             TSS_BYTE**                      PprgbBuffer,
+    _Inout_                             TSS_INT32*                      PpnSize)
 {
     unsigned int unReturnValue = RC_E_FAIL;
     do
     {
+        TSS_BYTE* pbElement = (TSS_BYTE*)PpTarget;
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSize = 0;
+        TSS_INT32 nPos = 0;
+
         // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
+        if ((NULL == PpTarget) || (PnStride <= 0) || (PnCount < 0))
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_PCR_SELECTION));
+        Platform_MemorySetFast(PpTarget, 0x00, (unsigned int)(PnStride * PnCount));
         // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
+        if ((NULL == PrgsFields) || (NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        unReturnValue = TSS_TPMI_ALG_HASH_Unmarshal((TSS_TPMI_ALG_HASH *) & (PpTarget->hash), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_UINT8_Unmarshal((TSS_UINT8 *) & (PpTarget->sizeofSelect), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_BYTE_Array_Unmarshal((TSS_BYTE *) & (PpTarget->pcrSelect), PprgbBuffer, PpnSize, PpTarget->sizeofSelect);
+
+        pbBuffer = *PprgbBuffer;
+        nSize = *PpnSize;
+        unReturnValue = RC_SUCCESS;
+        for (nPos = 0; (nPos < PnCount) && (RC_SUCCESS == unReturnValue); nPos++, pbElement += PnStride)
+        {
+            TSS_INT32 nField;
+            for (nField = 0; nField < PnFieldCount; nField++)
+            {
+                const TSS_FIELD_DESCRIPTOR* psField = &PrgsFields[nField];
+                TSS_BYTE* pbField = pbElement + psField->usOffset;
+                TSS_INT32 nFieldSize = psField->bKind;
+
+                // A byte array takes its size from a previously unmarshaled UINT8 field
+                if (TSS_FIELD_KIND_BYTE_ARRAY == psField->bKind)
+                {
+                    nFieldSize = pbElement[PrgsFields[psField->bSizeSelector].usOffset];
+                    if (nFieldSize > psField->usCapacity)
+                    {
+                        unReturnValue = RC_E_BAD_PARAMETER;
+                        break;
+                    }
+                }
+                // Check size
+                if (nSize < nFieldSize)
+                {
+                    unReturnValue = RC_E_BUFFER_TOO_SMALL;
+                    break;
+                }
+
+                switch (psField->bKind)
+                {
+                    case TSS_FIELD_KIND_UINT8:
+                        *pbField = *pbBuffer;
+                        break;
+                    case TSS_FIELD_KIND_UINT16:
+                        BYTE_ARRAY_TO_UINT16(pbBuffer, *(TSS_UINT16*)pbField);
+                        break;
+                    case TSS_FIELD_KIND_UINT32:
+                        BYTE_ARRAY_TO_UINT32(pbBuffer, *(TSS_UINT32*)pbField);
+                        break;
+                    default:
+                        if (nFieldSize > 0)
+                            unReturnValue = Platform_MemoryCopy(pbField, psField->usCapacity, pbBuffer, (unsigned int)nFieldSize);
+                        break;
+                }
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                pbBuffer += nFieldSize;
+                nSize -= nFieldSize;
+            }
+        }
         if (RC_SUCCESS != unReturnValue)
             break;
+
+        *PprgbBuffer = pbBuffer;
+        *PpnSize = nSize;
     }
     WHILE_FALSE_END;
     return unReturnValue;
 }
 
+/// Field table of TSS_TPMS_PCR_SELECTION (Table 85)
+static const TSS_FIELD_DESCRIPTOR s_rgsPcrSelectionFields[] = {
+    TSS_FIELD(TSS_TPMS_PCR_SELECTION, hash, TSS_FIELD_KIND_UINT16, 0),
+    TSS_FIELD(TSS_TPMS_PCR_SELECTION, sizeofSelect, TSS_FIELD_KIND_UINT8, 0),
+    TSS_FIELD(TSS_TPMS_PCR_SELECTION, pcrSelect, TSS_FIELD_KIND_BYTE_ARRAY, 1)
+};
+
+/// Field table of TSS_TPMS_ALG_PROPERTY (Table 92)
+static const TSS_FIELD_DESCRIPTOR s_rgsAlgPropertyFields[] = {
+    TSS_FIELD(TSS_TPMS_ALG_PROPERTY, alg, TSS_FIELD_KIND_UINT16, 0),
+    TSS_FIELD(TSS_TPMS_ALG_PROPERTY, algProperties, TSS_FIELD_KIND_UINT32, 0)
+};
+
+/// Field table of TSS_TPMS_TAGGED_PROPERTY (Table 93)
+static const TSS_FIELD_DESCRIPTOR s_rgsTaggedPropertyFields[] = {
+    TSS_FIELD(TSS_TPMS_TAGGED_PROPERTY, property, TSS_FIELD_KIND_UINT32, 0),
+    TSS_FIELD(TSS_TPMS_TAGGED_PROPERTY, value, TSS_FIELD_KIND_UINT32, 0)
+};
+
+/// Field table of TSS_TPMS_TAGGED_PCR_SELECT (Table 94)
+static const TSS_FIELD_DESCRIPTOR s_rgsTaggedPcrSelectFields[] = {
+    TSS_FIELD(TSS_TPMS_TAGGED_PCR_SELECT, tag, TSS_FIELD_KIND_UINT32, 0),
+    TSS_FIELD(TSS_TPMS_TAGGED_PCR_SELECT, sizeofSelect, TSS_FIELD_KIND_UINT8, 0),
+    TSS_FIELD(TSS_TPMS_TAGGED_PCR_SELECT, pcrSelect, TSS_FIELD_KIND_BYTE_ARRAY, 1)
+};
+
+/**
+ *  @brief      Unmarshals a TSS_TPMS_PCR_SELECTION structure
+ *  @details    Refer to: Table 85 - Definition of TPMS_PCR_SELECTION Structure
+ *
+ *  @param      PpTarget    Location into which the data from **PprgbBuffer is placed.
+ *  @param      PprgbBuffer Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPMS_PCR_SELECTION_Unmarshal(
+    _Out_   TSS_TPMS_PCR_SELECTION*         PpTarget,
+    _Inout_ TSS_BYTE**                      PprgbBuffer,
+    _Inout_ TSS_INT32*                      PpnSize)
+{
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_PCR_SELECTION), 1, s_rgsPcrSelectionFields, (TSS_INT32)(sizeof(s_rgsPcrSelectionFields) / sizeof(s_rgsPcrSelectionFields[0])), PprgbBuffer, PpnSize);
+}
+
 /**
  *  @brief      Unmarshals a TSS_TPMS_PCR_SELECTION array
  *  @details    Refer to: Table 85 - Definition of TPMS_PCR_SELECTION Structure
@@ -2287,37 +2509,7 @@ TSS_TPMS_PCR_SELECTION_Array_Unmarshal(
     _Inout_ TSS_INT32*                      PpnSize,
     _In_    TSS_INT32                       PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_PCR_SELECTION));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPMS_PCR_SELECTION_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_PCR_SELECTION), PnCount, s_rgsPcrSelectionFields, (TSS_INT32)(sizeof(s_rgsPcrSelectionFields) / sizeof(s_rgsPcrSelectionFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2347,7 +2539,7 @@ TSS_TPMT_TK_AUTH_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMT_TK_AUTH));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPMT_TK_AUTH));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2386,31 +2578,7 @@ TSS_TPMS_ALG_PROPERTY_Unmarshal(
     _Inout_ TSS_BYTE**                      PprgbBuffer,
     _Inout_ TSS_INT32*                      PpnSize)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_ALG_PROPERTY));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        unReturnValue = TSS_TPM_ALG_ID_Unmarshal((TSS_TPM_ALG_ID *) & (PpTarget->alg), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_TPMA_ALGORITHM_Unmarshal((TSS_TPMA_ALGORITHM *) & (PpTarget->algProperties), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_ALG_PROPERTY), 1, s_rgsAlgPropertyFields, (TSS_INT32)(sizeof(s_rgsAlgPropertyFields) / sizeof(s_rgsAlgPropertyFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2433,37 +2601,7 @@ TSS_TPMS_ALG_PROPERTY_Array_Unmarshal(
     _Inout_ TSS_INT32*                      PpnSize,
     _In_    TSS_INT32                       PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_ALG_PROPERTY));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPMS_ALG_PROPERTY_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_ALG_PROPERTY), PnCount, s_rgsAlgPropertyFields, (TSS_INT32)(sizeof(s_rgsAlgPropertyFields) / sizeof(s_rgsAlgPropertyFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2484,31 +2622,7 @@ TSS_TPMS_TAGGED_PROPERTY_Unmarshal(
     _Inout_ TSS_BYTE**                          PprgbBuffer,
     _Inout_ TSS_INT32*                          PpnSize)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_TAGGED_PROPERTY));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        unReturnValue = TSS_TPM_PT_Unmarshal((TSS_TPM_PT *) & (PpTarget->property), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_UINT32_Unmarshal((TSS_UINT32 *) & (PpTarget->value), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_TAGGED_PROPERTY), 1, s_rgsTaggedPropertyFields, (TSS_INT32)(sizeof(s_rgsTaggedPropertyFields) / sizeof(s_rgsTaggedPropertyFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2531,37 +2645,7 @@ TSS_TPMS_TAGGED_PROPERTY_Array_Unmarshal(
     _Inout_ TSS_INT32*                          PpnSize,
     _In_    TSS_INT32                           PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_TAGGED_PROPERTY));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPMS_TAGGED_PROPERTY_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_TAGGED_PROPERTY), PnCount, s_rgsTaggedPropertyFields, (TSS_INT32)(sizeof(s_rgsTaggedPropertyFields) / sizeof(s_rgsTaggedPropertyFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2582,34 +2666,7 @@ TSS_TPMS_TAGGED_PCR_SELECT_Unmarshal(
     _Inout_ TSS_BYTE**                          PprgbBuffer,
     _Inout_ TSS_INT32*                          PpnSize)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_TAGGED_PCR_SELECT));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        unReturnValue = TSS_TPM_PT_Unmarshal((TSS_TPM_PT *) & (PpTarget->tag), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_UINT8_Unmarshal((TSS_UINT8 *) & (PpTarget->sizeofSelect), PprgbBuffer, PpnSize);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-        unReturnValue = TSS_BYTE_Array_Unmarshal((TSS_BYTE *) & (PpTarget->pcrSelect), PprgbBuffer, PpnSize, PpTarget->sizeofSelect);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_TAGGED_PCR_SELECT), 1, s_rgsTaggedPcrSelectFields, (TSS_INT32)(sizeof(s_rgsTaggedPcrSelectFields) / sizeof(s_rgsTaggedPcrSelectFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2632,37 +2689,7 @@ TSS_TPMS_TAGGED_PCR_SELECT_Array_Unmarshal(
     _Inout_ TSS_INT32*                          PpnSize,
     _In_    TSS_INT32                           PnCount)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    do
-    {
-        // Check and initialize _Out_ parameters
-        if (NULL == PpTarget)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_TAGGED_PCR_SELECT));
-        // Check _Inout_ parameters
-        if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
-
-        if (PnCount != 0)
-        {
-            TSS_INT32 nPos;
-            for (nPos = 0; nPos < PnCount; nPos++)
-            {
-                unReturnValue = TSS_TPMS_TAGGED_PCR_SELECT_Unmarshal(&PpTarget[nPos], PprgbBuffer, PpnSize);
-                if (RC_SUCCESS != unReturnValue)
-                    break;
-            }
-        }
-        unReturnValue = RC_SUCCESS;
-    }
-    WHILE_FALSE_END;
-    return unReturnValue;
+    return TSS_Fields_Unmarshal(PpTarget, (TSS_INT32)sizeof(TSS_TPMS_TAGGED_PCR_SELECT), PnCount, s_rgsTaggedPcrSelectFields, (TSS_INT32)(sizeof(s_rgsTaggedPcrSelectFields) / sizeof(s_rgsTaggedPcrSelectFields[0])), PprgbBuffer, PpnSize);
 }
 
 /**
@@ -2692,7 +2719,7 @@ TSS_TPML_CC_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_CC));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_CC));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2737,7 +2764,7 @@ TSS_TPML_CCA_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_CCA));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_CCA));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2782,7 +2809,7 @@ TSS_TPML_HANDLE_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_HANDLE));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_HANDLE));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2827,7 +2854,7 @@ TSS_TPML_PCR_SELECTION_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_PCR_SELECTION));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_PCR_SELECTION));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2837,6 +2864,12 @@ TSS_TPML_PCR_SELECTION_Unmarshal(
         unReturnValue = TSS_UINT32_Unmarshal((TSS_UINT32 *) & (PpTarget->count), PprgbBuffer, PpnSize);
         if (RC_SUCCESS != unReturnValue)
             break;
+        // The element count is taken from the wire, so bound it by the capacity of the list
+        if (PpTarget->count > sizeof(PpTarget->pcrSelections) / sizeof(PpTarget->pcrSelections[0]))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
         unReturnValue = TSS_TPMS_PCR_SELECTION_Array_Unmarshal((TSS_TPMS_PCR_SELECTION *) & (PpTarget->pcrSelections), PprgbBuffer, PpnSize, PpTarget->count);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -2872,7 +2905,7 @@ TSS_TPML_ALG_PROPERTY_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_ALG_PROPERTY));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_ALG_PROPERTY));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2882,6 +2915,12 @@ TSS_TPML_ALG_PROPERTY_Unmarshal(
         unReturnValue = TSS_UINT32_Unmarshal((TSS_UINT32 *) & (PpTarget->count), PprgbBuffer, PpnSize);
         if (RC_SUCCESS != unReturnValue)
             break;
+        // The element count is taken from the wire, so bound it by the capacity of the list
+        if (PpTarget->count > sizeof(PpTarget->algProperties) / sizeof(PpTarget->algProperties[0]))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
         unReturnValue = TSS_TPMS_ALG_PROPERTY_Array_Unmarshal((TSS_TPMS_ALG_PROPERTY *) & (PpTarget->algProperties), PprgbBuffer, PpnSize, PpTarget->count);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -2917,7 +2956,7 @@ TSS_TPML_TAGGED_TPM_PROPERTY_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_TAGGED_TPM_PROPERTY));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_TAGGED_TPM_PROPERTY));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2927,6 +2966,12 @@ TSS_TPML_TAGGED_TPM_PROPERTY_Unmarshal(
         unReturnValue = TSS_UINT32_Unmarshal((TSS_UINT32 *) & (PpTarget->count), PprgbBuffer, PpnSize);
         if (RC_SUCCESS != unReturnValue)
             break;
+        // The element count is taken from the wire, so bound it by the capacity of the list
+        if (PpTarget->count > sizeof(PpTarget->tpmProperty) / sizeof(PpTarget->tpmProperty[0]))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
         unReturnValue = TSS_TPMS_TAGGED_PROPERTY_Array_Unmarshal((TSS_TPMS_TAGGED_PROPERTY *) & (PpTarget->tpmProperty), PprgbBuffer, PpnSize, PpTarget->count);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -2962,7 +3007,7 @@ TSS_TPML_TAGGED_PCR_PROPERTY_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_TAGGED_PCR_PROPERTY));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_TAGGED_PCR_PROPERTY));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -2972,6 +3017,12 @@ TSS_TPML_TAGGED_PCR_PROPERTY_Unmarshal(
         unReturnValue = TSS_UINT32_Unmarshal((TSS_UINT32 *) & (PpTarget->count), PprgbBuffer, PpnSize);
         if (RC_SUCCESS != unReturnValue)
             break;
+        // The element count is taken from the wire, so bound it by the capacity of the list
+        if (PpTarget->count > sizeof(PpTarget->pcrProperty) / sizeof(PpTarget->pcrProperty[0]))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
         unReturnValue = TSS_TPMS_TAGGED_PCR_SELECT_Array_Unmarshal((TSS_TPMS_TAGGED_PCR_SELECT *) & (PpTarget->pcrProperty), PprgbBuffer, PpnSize, PpTarget->count);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -3007,7 +3058,7 @@ TSS_TPML_ECC_CURVE_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_ECC_CURVE));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_ECC_CURVE));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -3100,7 +3151,7 @@ TSS_TPMS_CAPABILITY_DATA_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPMS_CAPABILITY_DATA));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPMS_CAPABILITY_DATA));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -3403,7 +3454,7 @@ TSS_AcknowledgmentResponseData_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_AcknowledgmentResponseData));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_AcknowledgmentResponseData));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnSize))
         {
@@ -287,6 +287,46 @@ TSS_UINT16_Unmarshal(
     _Inout_ TSS_BYTE**      PprgbBuffer,
     _Inout_ TSS_INT32*      PpnSize);
 
+/**
+ *  @brief      Marshals a UINT16 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpSource    Location containing the value that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer Location in the output buffer where the first octet of the TYPE is to be placed.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT16_Array_Marshal(
+    _In_    const TSS_UINT16*   PpSource,
+    _Inout_ TSS_BYTE**          PprgbBuffer,
+    _Inout_ TSS_INT32*          PpnSize,
+    _In_    TSS_INT32           PnCount);
+
+/**
+ *  @brief      Unmarshals a UINT16 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpTarget    Location into which the data from **PprgbBuffer is placed.
+ *  @param      PprgbBuffer Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT16_Array_Unmarshal(
+    _Out_   TSS_UINT16*     PpTarget,
+    _Inout_ TSS_BYTE**      PprgbBuffer,
+    _Inout_ TSS_INT32*      PpnSize,
+    _In_    TSS_INT32       PnCount);
+
 /**
  *  @brief      Marshals a UINT32 type
  *  @details    Refer to: Table 3 - Definition of Base Types
@@ -323,6 +363,26 @@ TSS_UINT32_Unmarshal(
     _Inout_ TSS_BYTE**      PprgbBuffer,
     _Inout_ TSS_INT32*      PpnSize);
 
+/**
+ *  @brief      Marshals a UINT32 array
+ *  @details    Refer to: Table 3 - Definition of Base Types
+ *
+ *  @param      PpSource    Location containing the value that is to be marshaled in to the designated buffer.
+ *  @param      PprgbBuffer Location in the output buffer where the first octet of the TYPE is to be placed.
+ *  @param      PpnSize     Number of octets remaining in **PprgbBuffer.
+ *  @param      PnCount     Number of elements.
+ *
+ *  @retval     RC_SUCCESS  The operation completed successfully.
+ *  @retval     ...         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TSS_UINT32_Array_Marshal(
+    _In_    const TSS_UINT32*   PpSource,
+    _Inout_ TSS_BYTE**          PprgbBuffer,
+    _Inout_ TSS_INT32*          PpnSize,
+    _In_    TSS_INT32           PnCount);
+
 /**
  *  @brief      Unmarshals a UINT32 array
  *  @details    Refer to: Table 3 - Definition of Base Types
@@ -1368,6 +1428,63 @@ TSS_TPM2B_TIMEOUT_Unmarshal(
     _Inout_ TSS_BYTE**                  PprgbBuffer,
     _Inout_ TSS_INT32*                  PpnSize);
 
+/// Field kind of a big endian UINT8 (the value equals the size on the wire)
+#define TSS_FIELD_KIND_UINT8        1
+/// Field kind of a big endian UINT16
+#define TSS_FIELD_KIND_UINT16       2
+/// Field kind of a big endian UINT32
+#define TSS_FIELD_KIND_UINT32       4
+/// Field kind of a byte array whose element count is held by the UINT8 field referenced by the size selector
+#define TSS_FIELD_KIND_BYTE_ARRAY   0
+
+/**
+ *  @brief      Field descriptor
+ *  @details    Describes one field of a structure processed by TSS_Fields_Unmarshal. Use TSS_FIELD to fill it.
+ */
+typedef struct _TSS_FIELD_DESCRIPTOR {
+    /// Offset of the field in the structure
+    TSS_UINT16 usOffset;
+    /// Field kind (TSS_FIELD_KIND_*)
+    TSS_UINT8 bKind;
+    /// Index of the UINT8 field holding the element count of a byte array field (unused for other kinds)
+    TSS_UINT8 bSizeSelector;
+    /// Size of the field in the structure in bytes
+    TSS_UINT16 usCapacity;
+} TSS_FIELD_DESCRIPTOR;
+
+/// Initializes a field descriptor of the member PMember of the structure PType
+#define TSS_FIELD(PType, PMember, PbKind, PbSizeSelector) \
+    { (TSS_UINT16)(size_t)&(((PType*)0)->PMember), (PbKind), (PbSizeSelector), (TSS_UINT16)sizeof(((PType*)0)->PMember) }
+
+/**
+ *  @brief      Unmarshals table-described structures
+ *  @details    Unmarshals PnCount consecutive structures of PnStride bytes each. Every structure is described once by a
+ *              field table, so flat structures share one interpreter loop instead of a hand-coded function per type.
+ *              Byte array fields are bounded by their capacity. The buffer position is only advanced on success.
+ *
+ *  @param      PpTarget        Location into which the data from **PprgbBuffer is placed.
+ *  @param      PnStride        Size of one structure in bytes.
+ *  @param      PnCount         Number of structures.
+ *  @param      PrgsFields      Field table of the structure, in wire order.
+ *  @param      PnFieldCount    Number of entries in the field table.
+ *  @param      PprgbBuffer     Location in the output buffer containing the most significant octet (MSO) of *PpTarget.
+ *  @param      PpnSize         Number of octets remaining in **PprgbBuffer.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function or a byte array exceeds its capacity.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The buffer ends within a structure.
+ */
+_Check_return_
+unsigned int
+TSS_Fields_Unmarshal(
+    _Out_bytecap_(PnStride * PnCount)   void*                           PpTarget,
+    _In_                                TSS_INT32                       PnStride,
+    _In_                                TSS_INT32                       PnCount,
+    _In_count_(PnFieldCount)            const TSS_FIELD_DESCRIPTOR*     PrgsFields,
+    _In_                                TSS_INT32                       PnFieldCount,
+    _Inout_                             TSS_BYTE**                      PprgbBuffer,
+    _Inout_                             TSS_INT32*                      PpnSize);
+
 /**
  *  @brief      Unmarshals a TSS_TPMS_PCR_SELECTION structure
  *  @details    Refer to: Table 85 - Definition of TPMS_PCR_SELECTION Structure
@@ -0,0 +1,155 @@
+/**
+ *  @brief      Implements the TPM2_PolicyGetDigest method
+ *  @file       TPM2_PolicyGetDigest.c
+ *  @details    This file was auto-generated based on TPM2.0 specification revision 116.
+ *
+ *              Copyright Licenses:
+ *
+ *              * Trusted Computing Group (TCG) grants to the user of the source code
+ *              in this specification (the "Source Code") a worldwide, irrevocable,
+ *              nonexclusive, royalty free, copyright license to reproduce, create
+ *              derivative works, distribute, display and perform the Source Code and
+ *              derivative works thereof, and to grant others the rights granted
+ *              herein.
+ *
+ *              * The TCG grants to the user of the other parts of the specification
+ *              (other than the Source Code) the rights to reproduce, distribute,
+ *              display, and perform the specification solely for the purpose of
+ *              developing products based on such documents.
+ *
+ *              Source Code Distribution Conditions:
+ *
+ *              * Redistributions of Source Code must retain the above copyright
+ *              licenses, this list of conditions and the following disclaimers.
+ *
+ *              * Redistributions in binary form must reproduce the above copyright
+ *              licenses, this list of conditions and the following disclaimers in the
+ *              documentation and/or other materials provided with the distribution.
+ *
+ *              Disclaimers:
+ *
+ *              * THE COPYRIGHT LICENSES SET FORTH ABOVE DO NOT REPRESENT ANY FORM OF
+ *              LICENSE OR WAIVER, EXPRESS OR IMPLIED, BY ESTOPPEL OR OTHERWISE, WITH
+ *              RESPECT TO PATENT RIGHTS HELD BY TCG MEMBERS (OR OTHER THIRD PARTIES)
+ *              THAT MAY BE NECESSARY TO IMPLEMENT THIS SPECIFICATION OR
+ *              OTHERWISE. Contact TCG Administration
+ *              (admin@trustedcomputinggroup.org) for information on specification
+ *              licensing rights available through TCG membership agreements.
+ *
+ *              * THIS SPECIFICATION IS PROVIDED "AS IS" WITH NO EXPRESS OR IMPLIED
+ *              WARRANTIES WHATSOEVER, INCLUDING ANY WARRANTY OF MERCHANTABILITY OR
+ *              FITNESS FOR A PARTICULAR PURPOSE, ACCURACY, COMPLETENESS, OR
+ *              NONINFRINGEMENT OF INTELLECTUAL PROPERTY RIGHTS, OR ANY WARRANTY
+ *              OTHERWISE ARISING OUT OF ANY PROPOSAL, SPECIFICATION OR SAMPLE.
+ *
+ *              * Without limitation, TCG and its members and licensors disclaim all
+ *              liability, including liability for infringement of any proprietary
+ *              rights, relating to use of information in this specification and to
+ *              the implementation of this specification, and TCG disclaims all
+ *              liability for cost of procurement of substitute goods or services,
+ *              lost profits, loss of use, loss of data or any incidental,
+ *              consequential, direct, indirect, or special damages, whether under
+ *              contract, tort, warranty or otherwise, arising in any way out of use
+ *              or reliance upon this specification or any information herein.
+ *
+ *              Any marks and brands contained herein are the property of their
+ *              respective owners.
+ */
+#include "TPM2_PolicyGetDigest.h"
+#include "TPM2_Marshal.h"
+#include "DeviceManagement.h"
+#include "Platform.h"
+#include "StdInclude.h"
+
+/**
+ *  @brief  Implementation of TPM2_PolicyGetDigest command.
+ *
+ *  @retval TPM_RC_HANDLE                   policySession is not a loaded policy session.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_PolicyGetDigest(
+    _In_    TSS_TPMI_SH_POLICY      policySession,
+    _Out_   TSS_TPM2B_DIGEST*       policyDigest
+)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_BYTE* pbBuffer = NULL;
+        TSS_INT32 nSizeRemaining = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
+        // Request parameters
+        TSS_TPM_ST tag = TSS_TPM_ST_NO_SESSIONS;
+        TSS_UINT32 unCommandSize = 0;
+        TSS_TPM_CC commandCode = TSS_TPM_CC_PolicyGetDigest;
+        // Response parameters
+        TSS_UINT32 unResponseSize = 0;
+        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
+
+        if (NULL == policyDigest)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        // Marshal the request
+        pbBuffer = psContext->rgbRequest;
+        unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_TPM_CC_Marshal(&commandCode, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_TPMI_SH_POLICY_Marshal(&policySession, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Overwrite unCommandSize
+        unCommandSize = sizeof(psContext->rgbRequest) - nSizeRemaining;
+        pbBuffer = psContext->rgbRequest + 2;
+        nSizeRemaining = 4;
+        unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Transmit the command over TDDL
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, unCommandSize, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        // Unmarshal the response
+        pbBuffer = psContext->rgbResponse;
+        nSizeRemaining = nSizeResponse;
+        unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_UINT32_Unmarshal(&unResponseSize, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = TSS_TPM_RC_Unmarshal(&responseCode, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+        if (responseCode != TSS_TPM_RC_SUCCESS)
+        {
+            unReturnValue = RC_TPM_MASK | responseCode;
+            break;
+        }
+        unReturnValue = TSS_TPM2B_DIGEST_Unmarshal(policyDigest, &pbBuffer, &nSizeRemaining);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
@@ -62,55 +62,46 @@
 #include "StdInclude.h"
 
 /**
- *  @brief  Implementation of TPM2_StartAuthSession command.
+ *  @brief      This function marshals a TPM2_StartAuthSession request
+ *  @details
  *
- *  @retval TPM_RC_ATTRIBUTES               tpmKey does not reference a decrypt key.
- *  @retval TPM_RC_CONTEXT_GAP              the difference between the most recently created active context and the oldest active context is at the limits of the TPM.
- *  @retval TPM_RC_HANDLE                   input decrypt key handle only has public portion loaded.
- *  @retval TPM_RC_MODE                     symmetric specifies a block cipher but the mode is not TPM_ALG_CFB.
- *  @retval TPM_RC_SESSION_HANDLES          no session handle is available.
- *  @retval TPM_RC_SESSION_MEMORY           no more slots for loading a session.
- *  @retval TPM_RC_SIZE                     nonce less than 16 octets or greater than the size of the digest produced by authHash.
- *  @retval TPM_RC_VALUE                    secret size does not match decrypt key type; or the recovered secret is larger than the digest size of the nameAlg of tpmKey; or, for an RSA decrypt key, if encryptedSecret is greater than the public exponent of tpmKey.
+ *  @param      tpmKey                              Handle of a loaded decrypt key used to encrypt salt.
+ *  @param      bind                                Entity providing the authValue.
+ *  @param      pNonceCaller                        Initial nonceCaller.
+ *  @param      pEncryptedSalt                      Value encrypted according to the type of tpmKey.
+ *  @param      sessionType                         Indicates the type of the session.
+ *  @param      pSymmetric                          The algorithm and key size for parameter encryption.
+ *  @param      authHash                            Hash algorithm to use for the session.
+ *  @param      PrgbRequest                         Request buffer.
+ *  @param      PpnSizeRequest                      In: Capacity of the request buffer in bytes, out: size of the request in bytes.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions.
  */
-_Check_return_
+static
 unsigned int
-TSS_TPM2_StartAuthSession(
-    _In_    TSS_TPMI_DH_OBJECT              tpmKey,
-    _In_    TSS_TPMI_DH_ENTITY              bind,
-    _In_    TSS_TPM2B_NONCE*                pNonceCaller,
-    _In_    TSS_TPM2B_ENCRYPTED_SECRET*     pEncryptedSalt,
-    _In_    TSS_TPM_SE                      sessionType,
-    _In_    TSS_TPMT_SYM_DEF*               pSymmetric,
-    _In_    TSS_TPMI_ALG_HASH               authHash,
-    _Out_   TSS_TPMI_SH_AUTH_SESSION*       pSessionHandle,
-    _Out_   TSS_TPM2B_NONCE*                pNonceTPM
-)
+TSS_TPM2_StartAuthSession_MarshalRequest(
+    _In_                                TSS_TPMI_DH_OBJECT              tpmKey,
+    _In_                                TSS_TPMI_DH_ENTITY              bind,
+    _In_                                TSS_TPM2B_NONCE*                pNonceCaller,
+    _In_                                TSS_TPM2B_ENCRYPTED_SECRET*     pEncryptedSalt,
+    _In_                                TSS_TPM_SE                      sessionType,
+    _In_                                TSS_TPMT_SYM_DEF*               pSymmetric,
+    _In_                                TSS_TPMI_ALG_HASH               authHash,
+    _Out_bytecap_(*PpnSizeRequest)      TSS_BYTE*                       PrgbRequest,
+    _Inout_                             TSS_INT32*                      PpnSizeRequest)
 {
     unsigned int unReturnValue = RC_SUCCESS;
     do
     {
-        TSS_BYTE rgbRequest[TSS_MAX_COMMAND_SIZE];
-        TSS_BYTE rgbResponse[TSS_MAX_RESPONSE_SIZE];
-        TSS_BYTE* pbBuffer = NULL;
-        TSS_INT32 nSizeRemaining = sizeof(rgbRequest);
-        TSS_INT32 nSizeResponse = sizeof(rgbResponse);
+        TSS_BYTE* pbBuffer = PrgbRequest;
+        TSS_INT32 nSizeRemaining = *PpnSizeRequest;
         // Request parameters
         TSS_TPM_ST tag = TSS_TPM_ST_NO_SESSIONS;
         TSS_UINT32 unCommandSize = 0;
         TSS_TPM_CC commandCode = TSS_TPM_CC_StartAuthSession;
-        // Response parameters
-        TSS_UINT32 unResponseSize = 0;
-        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        Platform_MemorySet(rgbRequest, 0, sizeof(rgbRequest));
-        Platform_MemorySet(rgbResponse, 0, sizeof(rgbResponse));
-
-        // Initialize _Out_ parameters
-        Platform_MemorySet(pSessionHandle, 0x00, sizeof(TSS_TPMI_SH_AUTH_SESSION));
-        Platform_MemorySet(pNonceTPM, 0x00, sizeof(TSS_TPM2B_NONCE));
         // Marshal the request
-        pbBuffer = rgbRequest;
         unReturnValue = TSS_TPMI_ST_COMMAND_TAG_Marshal(&tag, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
@@ -143,21 +134,49 @@ TSS_TPM2_StartAuthSession(
             break;
 
         // Overwrite unCommandSize
-        unCommandSize = sizeof(rgbRequest) - nSizeRemaining;
-        pbBuffer = rgbRequest + 2;
+        unCommandSize = *PpnSizeRequest - nSizeRemaining;
+        pbBuffer = PrgbRequest + 2;
         nSizeRemaining = 4;
         unReturnValue = TSS_UINT32_Marshal(&unCommandSize, &pbBuffer, &nSizeRemaining);
         if (RC_SUCCESS != unReturnValue)
             break;
 
-        // Transmit the command over TDDL
-        unReturnValue = DeviceManagement_Transmit(rgbRequest, unCommandSize, rgbResponse, (unsigned int*)&nSizeResponse);
-        if (TSS_TPM_RC_SUCCESS != unReturnValue)
-            break;
+        *PpnSizeRequest = (TSS_INT32)unCommandSize;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function unmarshals a TPM2_StartAuthSession response
+ *  @details
+ *
+ *  @param      PrgbResponse                        Response buffer.
+ *  @param      PnSizeResponse                      Size of the response in bytes.
+ *  @param      pSessionHandle                      Handle for the newly created session.
+ *  @param      pNonceTPM                           The initial nonce from the TPM.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions or the TPM.
+ */
+static
+unsigned int
+TSS_TPM2_StartAuthSession_UnmarshalResponse(
+    _In_bytecount_(PnSizeResponse)  TSS_BYTE*                   PrgbResponse,
+    _In_                            TSS_INT32                   PnSizeResponse,
+    _Out_                           TSS_TPMI_SH_AUTH_SESSION*   pSessionHandle,
+    _Out_                           TSS_TPM2B_NONCE*            pNonceTPM)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    do
+    {
+        TSS_BYTE* pbBuffer = PrgbResponse;
+        TSS_INT32 nSizeRemaining = PnSizeResponse;
+        TSS_TPM_ST tag = 0;
+        TSS_UINT32 unResponseSize = 0;
+        TSS_TPM_RC responseCode = TSS_TPM_RC_SUCCESS;
 
-        // Unmarshal the response
-        pbBuffer = rgbResponse;
-        nSizeRemaining = nSizeResponse;
         unReturnValue = TSS_TPM_ST_Unmarshal(&tag, &pbBuffer, &nSizeRemaining);
         if (TSS_TPM_RC_SUCCESS != unReturnValue)
             break;
@@ -180,5 +199,165 @@ TSS_TPM2_StartAuthSession(
             break;
     }
     WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief  Implementation of TPM2_StartAuthSession command.
+ *
+ *  @retval TPM_RC_ATTRIBUTES               tpmKey does not reference a decrypt key.
+ *  @retval TPM_RC_CONTEXT_GAP              the difference between the most recently created active context and the oldest active context is at the limits of the TPM.
+ *  @retval TPM_RC_HANDLE                   input decrypt key handle only has public portion loaded.
+ *  @retval TPM_RC_MODE                     symmetric specifies a block cipher but the mode is not TPM_ALG_CFB.
+ *  @retval TPM_RC_SESSION_HANDLES          no session handle is available.
+ *  @retval TPM_RC_SESSION_MEMORY           no more slots for loading a session.
+ *  @retval TPM_RC_SIZE                     nonce less than 16 octets or greater than the size of the digest produced by authHash.
+ *  @retval TPM_RC_VALUE                    secret size does not match decrypt key type; or the recovered secret is larger than the digest size of the nameAlg of tpmKey; or, for an RSA decrypt key, if encryptedSecret is greater than the public exponent of tpmKey.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_StartAuthSession(
+    _In_    TSS_TPMI_DH_OBJECT              tpmKey,
+    _In_    TSS_TPMI_DH_ENTITY              bind,
+    _In_    TSS_TPM2B_NONCE*                pNonceCaller,
+    _In_    TSS_TPM2B_ENCRYPTED_SECRET*     pEncryptedSalt,
+    _In_    TSS_TPM_SE                      sessionType,
+    _In_    TSS_TPMT_SYM_DEF*               pSymmetric,
+    _In_    TSS_TPMI_ALG_HASH               authHash,
+    _Out_   TSS_TPMI_SH_AUTH_SESSION*       pSessionHandle,
+    _Out_   TSS_TPM2B_NONCE*                pNonceTPM
+)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_INT32 nSizeRequest = sizeof(psContext->rgbRequest);
+        TSS_INT32 nSizeResponse = sizeof(psContext->rgbResponse);
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Initialize _Out_ parameters
+        Platform_MemorySet(pSessionHandle, 0x00, sizeof(TSS_TPMI_SH_AUTH_SESSION));
+        Platform_MemorySet(pNonceTPM, 0x00, sizeof(TSS_TPM2B_NONCE));
+
+        // Marshal the request
+        unReturnValue = TSS_TPM2_StartAuthSession_MarshalRequest(tpmKey, bind, pNonceCaller, pEncryptedSalt, sessionType, pSymmetric, authHash, psContext->rgbRequest, &nSizeRequest);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Transmit the command over TDDL
+        unReturnValue = DeviceManagement_Transmit(psContext->rgbRequest, (unsigned int)nSizeRequest, psContext->rgbResponse, (unsigned int*)&nSizeResponse);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        // Unmarshal the response
+        unReturnValue = TSS_TPM2_StartAuthSession_UnmarshalResponse(psContext->rgbResponse, nSizeResponse, pSessionHandle, pNonceTPM);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function sends a TPM2_StartAuthSession request
+ *  @details    The function returns as soon as the request is transmitted to the TPM, so the caller can do other work
+ *              while the TPM creates the session. The response must be collected with TSS_TPM2_StartAuthSession_Receive
+ *              before the next TPM command is sent.
+ *
+ *  @param      tpmKey                              Handle of a loaded decrypt key used to encrypt salt.
+ *  @param      bind                                Entity providing the authValue.
+ *  @param      pNonceCaller                        Initial nonceCaller.
+ *  @param      pEncryptedSalt                      Value encrypted according to the type of tpmKey.
+ *  @param      sessionType                         Indicates the type of the session.
+ *  @param      pSymmetric                          The algorithm and key size for parameter encryption.
+ *  @param      authHash                            Hash algorithm to use for the session.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions and DeviceManagement_Send.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_StartAuthSession_Send(
+    _In_    TSS_TPMI_DH_OBJECT              tpmKey,
+    _In_    TSS_TPMI_DH_ENTITY              bind,
+    _In_    TSS_TPM2B_NONCE*                pNonceCaller,
+    _In_    TSS_TPM2B_ENCRYPTED_SECRET*     pEncryptedSalt,
+    _In_    TSS_TPM_SE                      sessionType,
+    _In_    TSS_TPMT_SYM_DEF*               pSymmetric,
+    _In_    TSS_TPMI_ALG_HASH               authHash)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        TSS_INT32 nSizeRequest = sizeof(psContext->rgbRequest);
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Marshal the request
+        unReturnValue = TSS_TPM2_StartAuthSession_MarshalRequest(tpmKey, bind, pNonceCaller, pEncryptedSalt, sessionType, pSymmetric, authHash, psContext->rgbRequest, &nSizeRequest);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = DeviceManagement_Send(psContext->rgbRequest, (unsigned int)nSizeRequest);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      This function receives and unmarshals the response of a sent TPM2_StartAuthSession request
+ *  @details
+ *
+ *  @param      pSessionHandle                      Handle for the newly created session.
+ *  @param      pNonceTPM                           The initial nonce from the TPM.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_Receive and Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_StartAuthSession_Receive(
+    _Out_   TSS_TPMI_SH_AUTH_SESSION*       pSessionHandle,
+    _Out_   TSS_TPM2B_NONCE*                pNonceTPM)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    DEVICE_MANAGEMENT_COMMAND_CONTEXT* psContext = NULL;
+    do
+    {
+        unsigned int unSizeResponse = sizeof(psContext->rgbResponse);
+
+        // Borrow the zeroed command buffers of the driver
+        unReturnValue = DeviceManagement_AcquireCommandContext(&psContext);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Initialize _Out_ parameters
+        Platform_MemorySet(pSessionHandle, 0x00, sizeof(TSS_TPMI_SH_AUTH_SESSION));
+        Platform_MemorySet(pNonceTPM, 0x00, sizeof(TSS_TPM2B_NONCE));
+
+        unReturnValue = DeviceManagement_Receive(psContext->rgbResponse, &unSizeResponse);
+        if (TSS_TPM_RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TSS_TPM2_StartAuthSession_UnmarshalResponse(psContext->rgbResponse, (TSS_INT32)unSizeResponse, pSessionHandle, pNonceTPM);
+    }
+    WHILE_FALSE_END;
+
+    DeviceManagement_ReleaseCommandContext(&psContext);
+
     return unReturnValue;
 }
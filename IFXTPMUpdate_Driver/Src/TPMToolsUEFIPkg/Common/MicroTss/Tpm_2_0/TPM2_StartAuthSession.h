@@ -88,6 +88,50 @@ TSS_TPM2_StartAuthSession(
     _Out_   TSS_TPM2B_NONCE*                pNonceTPM
 );
 
+/**
+ *  @brief      This function sends a TPM2_StartAuthSession request
+ *  @details    The function returns as soon as the request is transmitted to the TPM, so the caller can do other work
+ *              while the TPM creates the session. The response must be collected with TSS_TPM2_StartAuthSession_Receive
+ *              before the next TPM command is sent.
+ *
+ *  @param      tpmKey                              Handle of a loaded decrypt key used to encrypt salt.
+ *  @param      bind                                Entity providing the authValue.
+ *  @param      pNonceCaller                        Initial nonceCaller.
+ *  @param      pEncryptedSalt                      Value encrypted according to the type of tpmKey.
+ *  @param      sessionType                         Indicates the type of the session.
+ *  @param      pSymmetric                          The algorithm and key size for parameter encryption.
+ *  @param      authHash                            Hash algorithm to use for the session.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from Micro TSS functions and DeviceManagement_Send.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_StartAuthSession_Send(
+    _In_    TSS_TPMI_DH_OBJECT              tpmKey,
+    _In_    TSS_TPMI_DH_ENTITY              bind,
+    _In_    TSS_TPM2B_NONCE*                pNonceCaller,
+    _In_    TSS_TPM2B_ENCRYPTED_SECRET*     pEncryptedSalt,
+    _In_    TSS_TPM_SE                      sessionType,
+    _In_    TSS_TPMT_SYM_DEF*               pSymmetric,
+    _In_    TSS_TPMI_ALG_HASH               authHash);
+
+/**
+ *  @brief      This function receives and unmarshals the response of a sent TPM2_StartAuthSession request
+ *  @details
+ *
+ *  @param      pSessionHandle                      Handle for the newly created session.
+ *  @param      pNonceTPM                           The initial nonce from the TPM.
+ *
+ *  @retval     RC_SUCCESS                          The operation completed successfully.
+ *  @retval     ...                                 Error codes from DeviceManagement_Receive and Micro TSS functions.
+ */
+_Check_return_
+unsigned int
+TSS_TPM2_StartAuthSession_Receive(
+    _Out_   TSS_TPMI_SH_AUTH_SESSION*       pSessionHandle,
+    _Out_   TSS_TPM2B_NONCE*                pNonceTPM);
+
 #ifdef __cplusplus
 }
 #endif
@@ -45,7 +45,7 @@ TSS_TPML_MAX_BUFFER_Unmarshal(
             unReturnValue = RC_E_BAD_PARAMETER;
             break;
         }
-        Platform_MemorySet(PpTarget, 0x00, sizeof(TSS_TPML_MAX_BUFFER));
+        Platform_MemorySetFast(PpTarget, 0x00, sizeof(TSS_TPML_MAX_BUFFER));
         // Check _Inout_ parameters
         if ((NULL == PprgbBuffer) || (NULL == *PprgbBuffer) || (NULL == PpnBufferSize))
         {
@@ -0,0 +1,1778 @@
+/**
+ *  @brief      Implements the Platform interface for Linux
+ *  @details    This module provides platform related functions (memory allocation, string manipulation, time, etc.) on
+ *              top of the C library. Strings are two byte wide characters (-fshort-wchar), so the wide character functions
+ *              of the C library are not used. Strings are formatted with the conversions of the UEFI PrintLib.
+ *  @file       Linux/Platform.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Platform.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+
+/// Alignment of the allocations from the memory arena in bytes
+#define PLATFORM_ARENA_ALIGNMENT 8
+
+/// Memory arena (NULL if not reserved)
+static unsigned char* s_pbArena = NULL;
+
+/// Size of the memory arena in bytes
+static unsigned int s_unArenaSize = 0;
+
+/// Fill level of the memory arena in bytes
+static unsigned int s_unArenaUsed = 0;
+
+/// Directory of the files written by Platform_NvStoreWrite
+#define PLATFORM_NV_STORE_DIRECTORY "/var/lib/ifxtpmupdate"
+
+/// Thread running the task started by Platform_TaskStart
+static pthread_t s_hTaskThread;
+
+/// Flag indicating a task is running (s_hTaskThread must be joined)
+static BOOL s_fTaskRunning = FALSE;
+
+/// Procedure of the task started by Platform_TaskStart
+static PFN_PLATFORM_TASK_PROCEDURE s_pfnTaskProcedure = NULL;
+
+/// Context of the task started by Platform_TaskStart
+static void* s_pvTaskContext = NULL;
+
+/// Mutex protecting the sections entered with Platform_EnterCriticalSection
+static pthread_mutex_t s_hCriticalSection = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ *  @brief      Memory allocation initialized with zeros
+ *  @details    This function returns a pointer to a zero initialized memory
+ *
+ *  @param      PunSize     Memory allocation size in bytes.
+ *  @retval     != NULL     Pointer to the zero initialized memory.
+ *  @retval     NULL        If the allocation fails.
+ */
+_Check_return_
+void*
+Platform_MemoryAllocateZero(
+    _In_ unsigned int PunSize)
+{
+    void* pvBuffer = NULL;
+
+    if (0 != PunSize)
+        // Allocate new memory and initialize it with zeros
+        pvBuffer = calloc(1, PunSize);
+
+    return pvBuffer;
+}
+
+/**
+ *  @brief      Memory deallocation
+ *  @details    This function releases the allocated memory and sets its pointer to NULL
+ *
+ *  @param      PppvMemory  Pointer to the pointer to the memory which should be released.
+ */
+void
+Platform_MemoryFree(
+    _Inout_opt_ void** PppvMemory)
+{
+    // Check if pointer is not null and free than
+    if (NULL != PppvMemory && NULL != *PppvMemory)
+    {
+        // Arena memory is reclaimed by Platform_ArenaRelease or Platform_ArenaUninitialize only
+        if (NULL == s_pbArena ||
+                (unsigned char*)*PppvMemory < s_pbArena ||
+                (unsigned char*)*PppvMemory >= s_pbArena + s_unArenaSize)
+            free(*PppvMemory);
+        *PppvMemory = NULL;
+    }
+}
+
+/**
+ *  @brief      Reserves the memory arena
+ *  @details    The memory arena is a single heap allocation which serves small, long-living allocations and scoped
+ *              scratch memory through Platform_ArenaAllocateZero. Call it once at program start.
+ *
+ *  @param      PunSize                 Size of the memory arena in bytes.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function or the arena is already reserved.
+ *  @retval     RC_E_FAIL               The memory allocation failed.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaInitialize(
+    _In_ unsigned int PunSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (0 == PunSize || NULL != s_pbArena)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        s_pbArena = (unsigned char*)malloc(PunSize);
+        if (NULL == s_pbArena)
+            break;
+
+        s_unArenaSize = PunSize;
+        s_unArenaUsed = 0;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Releases the memory arena
+ *  @details    All memory allocated from the arena is released at once. Call it once at program exit after all users
+ *              of arena memory have released their references.
+ */
+void
+Platform_ArenaUninitialize()
+{
+    free(s_pbArena);
+
+    s_pbArena = NULL;
+    s_unArenaSize = 0;
+    s_unArenaUsed = 0;
+}
+
+/**
+ *  @brief      Memory allocation from the memory arena initialized with zeros
+ *  @details    The memory is taken from the memory arena. If the arena is not reserved or exhausted, the memory is
+ *              allocated with Platform_MemoryAllocateZero instead. Release the memory with Platform_MemoryFree in both
+ *              cases; arena memory is only reclaimed by Platform_ArenaRelease or Platform_ArenaUninitialize.
+ *
+ *  @param      PunSize     Memory allocation size in bytes.
+ *  @retval     != NULL     Pointer to the zero initialized memory.
+ *  @retval     NULL        If the allocation fails.
+ */
+_Check_return_
+void*
+Platform_ArenaAllocateZero(
+    _In_ unsigned int PunSize)
+{
+    void* pvBuffer = NULL;
+    unsigned int unAlignedSize = (PunSize + PLATFORM_ARENA_ALIGNMENT - 1) & ~(PLATFORM_ARENA_ALIGNMENT - 1);
+
+    if (0 != PunSize)
+    {
+        if (NULL != s_pbArena && unAlignedSize >= PunSize && unAlignedSize <= s_unArenaSize - s_unArenaUsed)
+        {
+            // Bump allocation from the arena; released arena memory may contain old data
+            pvBuffer = s_pbArena + s_unArenaUsed;
+            s_unArenaUsed += unAlignedSize;
+            memset(pvBuffer, 0, PunSize);
+        }
+        else
+            pvBuffer = Platform_MemoryAllocateZero(PunSize);
+    }
+
+    return pvBuffer;
+}
+
+/**
+ *  @brief      Returns the current fill level of the memory arena
+ *  @details    Pass the value to Platform_ArenaRelease to release all arena memory allocated after this call, e.g. for
+ *              scratch memory of a single operation.
+ *
+ *  @returns    Current fill level of the memory arena in bytes.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaGetMark()
+{
+    return s_unArenaUsed;
+}
+
+/**
+ *  @brief      Releases the arena memory allocated after a mark
+ *  @details    The caller must ensure no allocation made after the mark is still in use.
+ *
+ *  @param      PunMark     Fill level returned by Platform_ArenaGetMark.
+ */
+void
+Platform_ArenaRelease(
+    _In_ unsigned int PunMark)
+{
+    if (PunMark < s_unArenaUsed)
+        s_unArenaUsed = PunMark;
+}
+
+/**
+ *  @brief      Memory compare
+ *  @details    This function compares 2 memory buffers
+ *
+ *  @param      PpvBuffer1      Pointer to the first buffer.
+ *  @param      PpvBuffer2      Pointer to the second buffer.
+ *  @param      PunSize         Size to compare.
+ *  @retval     0               If buffers are equal.
+ *  @retval     < 0             If first buffer is less than second one.
+ *  @retval     > 0             If first buffer is greater than the second one.
+ */
+_Check_return_
+int
+Platform_MemoryCompare(
+    _In_reads_bytes_(PunSize)   const void*     PpvBuffer1,
+    _In_reads_bytes_(PunSize)   const void*     PpvBuffer2,
+    _In_                        unsigned int    PunSize)
+{
+    // Compare the two buffers
+    return memcmp(PpvBuffer1, PpvBuffer2, PunSize);
+}
+
+/**
+ *  @brief      Memory Set
+ *  @details    This function sets the memory to a value
+ *
+ *  @param      PpvDestination      Pointer to the buffer.
+ *  @param      PnValue             Value to set.
+ *  @param      PunSize             Size of the buffer in bytes.
+ */
+void
+Platform_MemorySet(
+    _Out_writes_bytes_all_(PunSize) void*           PpvDestination,
+    _In_                            int             PnValue,
+    _In_                            unsigned int    PunSize)
+{
+    if (NULL != PpvDestination)
+        memset(PpvDestination, PnValue, PunSize);
+}
+
+/**
+ *  @brief      Memory copy
+ *  @details    This function copies one memory buffer to another
+ *
+ *  @param      PpvDestination          Pointer to the destination buffer.
+ *  @param      PunDestinationCapacity  Capacity of the destination buffer.
+ *  @param      PpvSource               Pointer to the source buffer.
+ *  @param      PunSize                 Size of the buffer in bytes.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. One parameter is NULL.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   Destination parameter too small.
+ */
+_Check_return_
+unsigned int
+Platform_MemoryCopy(
+    _Inout_bytecap_(PunDestinationCapacity) void*           PpvDestination,
+    _In_                                    unsigned int    PunDestinationCapacity,
+    _In_reads_bytes_opt_(PunSize)           const void*     PpvSource,
+    _In_                                    unsigned int    PunSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Parameter check.
+        if ((NULL == PpvDestination) || (0 == PunDestinationCapacity) ||
+                (NULL == PpvSource))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check if source buffer is greater than destination buffer
+        if (PunSize > PunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Copy memory contents (the buffers may overlap like with CopyMem on UEFI)
+        memmove(PpvDestination, PpvSource, PunSize);
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the length of a Unicode string
+ *  @details    Counts at most PunMaximum elements.
+ *
+ *  @param      PwszString      Pointer to the Unicode string.
+ *  @param      PunMaximum      Maximum number of elements to count.
+ *  @returns    Length of the string in elements (without terminating 0) or PunMaximum if the string is longer.
+ */
+static
+unsigned int
+Platform_WideLength(
+    _In_z_  const wchar_t*  PwszString,
+    _In_    unsigned int    PunMaximum)
+{
+    unsigned int unLength = 0;
+
+    while (unLength < PunMaximum && L'\0' != PwszString[unLength])
+        unLength++;
+
+    return unLength;
+}
+
+/**
+ *  @brief      Copy Unicode strings
+ *  @details    This function copies the source Unicode string to the destination.
+ *
+ *  @param      PwszDestination         Pointer to the destination Unicode buffer.
+ *  @param      PpunDestinationCapacity In: Capacity of the destination buffer in elements (include additional space for terminating 0)\n
+ *                                      Out: Number of elements copied to the destination buffer (without terminating 0)
+ *  @param      PwszSource              Pointer to the source Unicode buffer.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. One parameter is NULL.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   Destination parameter too small.
+ */
+_Check_return_
+unsigned int
+Platform_StringCopy(
+    _Out_z_cap_(*PpunDestinationCapacity)   wchar_t*        PwszDestination,
+    _Inout_                                 unsigned int*   PpunDestinationCapacity,
+    _In_z_                                  const wchar_t*  PwszSource)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unLength = 0;
+
+        // Check parameters
+        if (NULL == PwszSource || NULL == PwszDestination || NULL == PpunDestinationCapacity || 0 == *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check that destination is large enough
+        unLength = Platform_WideLength(PwszSource, *PpunDestinationCapacity);
+        if (unLength >= *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Copy string
+        memmove(PwszDestination, PwszSource, (unLength + 1) * sizeof(wchar_t));
+
+        // Update destination length
+        *PpunDestinationCapacity = unLength;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameters
+        if (NULL != PwszDestination && NULL != PpunDestinationCapacity && 0 != *PpunDestinationCapacity)
+            PwszDestination[0] = L'\0';
+        if (NULL != PpunDestinationCapacity)
+            *PpunDestinationCapacity = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Compare strings
+ *  @details    This function compares two strings
+ *
+ *  @param      PwszString1         First string to compare.
+ *  @param      PwszString2         Second string to compare.
+ *  @param      PunCount            The maximum number of elements to compare.
+ *  @param      PfCaseInsensitive   If set to TRUE, do a case insensitive compare; FALSE for case sensitive compare.
+ *  @retval     0                   If strings match.
+ *  @retval     <0                  string 1 less than string 2.
+ *  @retval     >0                  string 1 greater than string 2.
+ */
+_Check_return_
+int
+Platform_StringCompare(
+    _In_z_  const wchar_t*  PwszString1,
+    _In_z_  const wchar_t*  PwszString2,
+    _In_    unsigned int    PunCount,
+    _In_    BOOL            PfCaseInsensitive)
+{
+    int nReturn = 0;
+
+    // Compare pointers and strings
+    if (NULL == PwszString1 && NULL == PwszString2)
+        nReturn = 0;
+    else if (NULL == PwszString1)
+        nReturn = -1;
+    else if (NULL == PwszString2)
+        nReturn = 1;
+    else
+    {
+        unsigned int unIndex = 0;
+
+        // Compare character by character, both strings end at the same index if they match
+        for (unIndex = 0; unIndex < PunCount; unIndex++)
+        {
+            wchar_t wch1 = PwszString1[unIndex];
+            wchar_t wch2 = PwszString2[unIndex];
+
+            if (PfCaseInsensitive)
+            {
+                wch1 = Platform_WCharToUpper(wch1);
+                wch2 = Platform_WCharToUpper(wch2);
+            }
+
+            if (wch1 != wch2)
+            {
+                nReturn = (int)wch1 - (int)wch2;
+                break;
+            }
+            if (L'\0' == wch1)
+                break;
+        }
+    }
+
+    return nReturn;
+}
+
+/**
+ *  @brief      Appends an element to a formatted string
+ *  @details    Counts the element even if the destination is full, so the caller can detect the truncation.
+ *
+ *  @param      PwszDestination         Pointer to the destination Unicode buffer.
+ *  @param      PunDestinationCapacity  Capacity of the destination buffer in elements (including terminating 0).
+ *  @param      PpunCount               In: index of the element, out: incremented index.
+ *  @param      PwchValue               Element to append.
+ */
+static
+void
+Platform_FormatPut(
+    _Out_z_cap_(PunDestinationCapacity) wchar_t*        PwszDestination,
+    _In_                                unsigned int    PunDestinationCapacity,
+    _Inout_                             unsigned int*   PpunCount,
+    _In_                                wchar_t         PwchValue)
+{
+    if (*PpunCount + 1 < PunDestinationCapacity)
+        PwszDestination[*PpunCount] = PwchValue;
+    (*PpunCount)++;
+}
+
+/**
+ *  @brief      Formats a Unicode string with the conversions of the UEFI PrintLib
+ *  @details    Supports the flags '-', '+', ' ', '0', ',' and '#', width and precision (also as '*') and the conversions
+ *              %d, %i, %u, %x, %X, %c, %p, %r, %s, %S (Unicode string), %a (ASCII string) and %%. Like on UEFI, 'l' or 'L'
+ *              selects a 64 bit integer argument and %s takes a Unicode string with or without 'l'. %r prints the status
+ *              code as hex number.
+ *
+ *  @param      PwszDestination         Pointer to the destination Unicode buffer.
+ *  @param      PunDestinationCapacity  Capacity of the destination buffer in elements (including terminating 0).
+ *  @param      PwszFormat              Format string.
+ *  @param      PargList                Arguments of the format string.
+ *
+ *  @returns    Number of elements of the complete formatted string (without terminating 0). The string is truncated if the
+ *              number is not less than PunDestinationCapacity.
+ */
+static
+unsigned int
+Platform_FormatV(
+    _Out_z_cap_(PunDestinationCapacity) wchar_t*        PwszDestination,
+    _In_                                unsigned int    PunDestinationCapacity,
+    _In_z_                              const wchar_t*  PwszFormat,
+    _In_                                va_list         PargList)
+{
+    unsigned int unCount = 0;
+    const wchar_t* pwszPosition = PwszFormat;
+
+    for (; L'\0' != *pwszPosition; pwszPosition++)
+    {
+        BOOL fLeftAlign = FALSE;
+        BOOL fZeroPad = FALSE;
+        BOOL fLong = FALSE;
+        BOOL fPrecision = FALSE;
+        wchar_t wchSign = L'\0';
+        unsigned int unWidth = 0;
+        unsigned int unPrecision = 0;
+        wchar_t rgwchDigits[24];
+        unsigned int unDigits = 0;
+        const wchar_t* pwszString = NULL;
+        const char* pszString = NULL;
+        unsigned int unLength = 0;
+        unsigned int unIndex = 0;
+
+        if (L'%' != *pwszPosition)
+        {
+            Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, *pwszPosition);
+            continue;
+        }
+
+        // Flags
+        for (pwszPosition++; ; pwszPosition++)
+        {
+            if (L'-' == *pwszPosition)
+                fLeftAlign = TRUE;
+            else if (L'0' == *pwszPosition)
+                fZeroPad = TRUE;
+            else if (L'+' == *pwszPosition)
+                wchSign = L'+';
+            else if (L' ' == *pwszPosition)
+            {
+                if (L'+' != wchSign)
+                    wchSign = L' ';
+            }
+            else if (L',' != *pwszPosition && L'#' != *pwszPosition)
+                break;
+        }
+
+        // Width
+        if (L'*' == *pwszPosition)
+        {
+            unWidth = va_arg(PargList, unsigned int);
+            pwszPosition++;
+        }
+        for (; L'0' <= *pwszPosition && L'9' >= *pwszPosition; pwszPosition++)
+            unWidth = unWidth * 10 + (*pwszPosition - L'0');
+
+        // Precision
+        if (L'.' == *pwszPosition)
+        {
+            fPrecision = TRUE;
+            pwszPosition++;
+            if (L'*' == *pwszPosition)
+            {
+                unPrecision = va_arg(PargList, unsigned int);
+                pwszPosition++;
+            }
+            for (; L'0' <= *pwszPosition && L'9' >= *pwszPosition; pwszPosition++)
+                unPrecision = unPrecision * 10 + (*pwszPosition - L'0');
+        }
+
+        // Size
+        for (; L'l' == *pwszPosition || L'L' == *pwszPosition; pwszPosition++)
+            fLong = TRUE;
+
+        switch (*pwszPosition)
+        {
+            case L'\0':
+                // Incomplete conversion at the end of the format string
+                pwszPosition--;
+                continue;
+
+            case L'%':
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, L'%');
+                continue;
+
+            case L'c':
+            {
+                wchar_t wchValue = (wchar_t)va_arg(PargList, unsigned int);
+                rgwchDigits[0] = wchValue;
+                pwszString = rgwchDigits;
+                unLength = 1;
+                fPrecision = FALSE;
+                fZeroPad = FALSE;
+                break;
+            }
+
+            case L's':
+            case L'S':
+            case L'a':
+            {
+                if (L'a' == *pwszPosition)
+                {
+                    pszString = va_arg(PargList, const char*);
+                    if (NULL == pszString)
+                        pszString = "<null string>";
+                    while ((!fPrecision || unLength < unPrecision) && '\0' != pszString[unLength])
+                        unLength++;
+                }
+                else
+                {
+                    pwszString = va_arg(PargList, const wchar_t*);
+                    if (NULL == pwszString)
+                        pwszString = L"<null string>";
+                    unLength = Platform_WideLength(pwszString, fPrecision ? unPrecision : UINT_MAX);
+                }
+                fPrecision = FALSE;
+                fZeroPad = FALSE;
+                break;
+            }
+
+            case L'd':
+            case L'i':
+            case L'u':
+            case L'x':
+            case L'X':
+            case L'p':
+            case L'r':
+            {
+                unsigned long long ullValue = 0;
+                BOOL fNegative = FALSE;
+                unsigned int unRadix = 10;
+                const wchar_t* pwszHexDigits = L"0123456789ABCDEF";
+
+                if (L'p' == *pwszPosition)
+                {
+                    ullValue = (UINTN)va_arg(PargList, void*);
+                    unRadix = 16;
+                    fZeroPad = TRUE;
+                    unWidth = sizeof(void*) * 2;
+                }
+                else if (L'r' == *pwszPosition)
+                {
+                    ullValue = va_arg(PargList, UINTN);
+                    unRadix = 16;
+                }
+                else if (L'd' == *pwszPosition || L'i' == *pwszPosition)
+                {
+                    long long llValue = fLong ? va_arg(PargList, long long) : (long long)va_arg(PargList, int);
+                    fNegative = llValue < 0;
+                    ullValue = fNegative ? 0 - (unsigned long long)llValue : (unsigned long long)llValue;
+                }
+                else
+                {
+                    ullValue = fLong ? va_arg(PargList, unsigned long long) : (unsigned long long)va_arg(PargList, unsigned int);
+                    if (L'u' != *pwszPosition)
+                        unRadix = 16;
+                    if (L'x' == *pwszPosition)
+                        pwszHexDigits = L"0123456789abcdef";
+                }
+
+                // Convert the digits in reverse order
+                do
+                {
+                    rgwchDigits[unDigits++] = pwszHexDigits[ullValue % unRadix];
+                    ullValue /= unRadix;
+                }
+                while (0 != ullValue);
+
+                // The precision is the minimum number of digits
+                if (fPrecision)
+                {
+                    while (unDigits < unPrecision && unDigits < RG_LEN(rgwchDigits) - 1)
+                        rgwchDigits[unDigits++] = L'0';
+                    fZeroPad = FALSE;
+                }
+
+                if (fNegative)
+                    wchSign = L'-';
+                else if (10 != unRadix || L'u' == *pwszPosition)
+                    wchSign = L'\0';
+
+                unLength = unDigits + (L'\0' != wchSign ? 1 : 0);
+                break;
+            }
+
+            default:
+                // Unknown conversion, copied as is
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, *pwszPosition);
+                continue;
+        }
+
+        // Padding in front of the value
+        if (!fLeftAlign && !fZeroPad)
+            for (; unWidth > unLength; unWidth--)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, L' ');
+
+        if (NULL != pwszString)
+        {
+            for (unIndex = 0; unIndex < unLength; unIndex++)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, pwszString[unIndex]);
+        }
+        else if (NULL != pszString)
+        {
+            for (unIndex = 0; unIndex < unLength; unIndex++)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, (wchar_t)(unsigned char)pszString[unIndex]);
+        }
+        else
+        {
+            if (L'\0' != wchSign)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, wchSign);
+            if (!fLeftAlign && fZeroPad)
+                for (; unWidth > unLength; unWidth--)
+                    Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, L'0');
+            while (unDigits > 0)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, rgwchDigits[--unDigits]);
+        }
+
+        // Padding behind the value
+        if (fLeftAlign)
+            for (; unWidth > unLength; unWidth--)
+                Platform_FormatPut(PwszDestination, PunDestinationCapacity, &unCount, L' ');
+    }
+
+    PwszDestination[unCount < PunDestinationCapacity ? unCount : PunDestinationCapacity - 1] = L'\0';
+
+    return unCount;
+}
+
+/**
+ *  @brief      Format Unicode strings
+ *  @details    This function formats a Unicode string
+ *
+ *  @param      PwszDestination         Pointer to the destination Unicode buffer.
+ *  @param      PpunDestinationCapacity In:     Capacity of the destination buffer in elements\n
+ *                                      Out:    Count of written elements
+ *  @param      PwszSource              Pointer to the source Unicode buffer.
+ *  @param      ...                     Additional parameters to format the string.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. One parameter is NULL.
+ *  @retval     ...                     Error codes from Platform_StringFormatV.
+ */
+_Check_return_
+unsigned int
+IFXAPI
+Platform_StringFormat(
+    _Out_z_cap_(*PpunDestinationCapacity)   wchar_t*        PwszDestination,
+    _Inout_                                 unsigned int*   PpunDestinationCapacity,
+    _In_z_                                  const wchar_t*  PwszSource,
+    ...)
+{
+    va_list argptr;
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    // Check used parameter (the others will be checked later)
+    if (NULL == PwszSource)
+        unReturnValue = RC_E_BAD_PARAMETER;
+    else
+    {
+        // Prepare string to write in buffer szBuf
+        va_start(argptr, PwszSource);
+        unReturnValue = Platform_StringFormatV(PwszDestination, PpunDestinationCapacity, PwszSource, argptr);
+        va_end(argptr);
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Format Unicode strings using a va_list
+ *  @details    This function formats a Unicode string using a va_list
+ *
+ *  @param      PwszDestination         Pointer to the destination Unicode buffer.
+ *  @param      PpunDestinationCapacity In:     Capacity of the destination buffer in elements\n
+ *                                      Out:    Count of written elements
+ *  @param      PwszSource              Pointer to the source Unicode buffer.
+ *  @param      PargList                Additional parameters to format the string.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. One parameter is NULL.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   Destination parameter too small.
+ */
+_Check_return_
+unsigned int
+Platform_StringFormatV(
+    _Out_z_cap_(*PpunDestinationCapacity)   wchar_t*        PwszDestination,
+    _Inout_                                 unsigned int*   PpunDestinationCapacity,
+    _In_z_                                  const wchar_t*  PwszSource,
+    _In_                                    va_list         PargList)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unWritten = 0;
+
+        // Check parameters
+        if (NULL == PwszDestination || NULL == PpunDestinationCapacity || PLATFORM_STRING_IS_NULL_OR_EMPTY(PwszSource))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check destination buffer capacity; we need at least a size of 1 for null-termination
+        if (0 == *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Format string
+        unWritten = Platform_FormatV(PwszDestination, *PpunDestinationCapacity, PwszSource, PargList);
+        if (unWritten >= *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        *PpunDestinationCapacity = unWritten;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameters
+        if (NULL != PwszDestination && NULL != PpunDestinationCapacity && 0 != *PpunDestinationCapacity)
+            PwszDestination[0] = L'\0';
+        if (NULL != PpunDestinationCapacity)
+            *PpunDestinationCapacity = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Get Unicode string length
+ *  @details    This function returns the length of a Unicode string in elements without the terminating 0
+ *
+ *  @param      PwszBuffer              Pointer to the Unicode string buffer.
+ *  @param      PunMaximumCapacity      Maximum capacity of the string buffer in elements (including terminating 0).
+ *  @param      PpunStrLen              Length of the Unicode string in elements (without terminating 0)
+ *  @returns    RC_SUCCESS  The operation completed successfully. In case of an error, *PpunStrLen is set to 0 if possible and one of the following error codes is being returned:
+ *  @retval     RC_E_FAIL               An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function. PwszBuffer or PpunStrLen is NULL, or PunMaximumCapacity is 0.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   String is not null-terminated within given maximum capacity.
+ */
+_Check_return_
+unsigned int
+Platform_StringGetLength(
+    _In_z_  const wchar_t*  PwszBuffer,
+    _In_    unsigned int    PunMaximumCapacity,
+    _Out_   unsigned int*   PpunStrLen)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PwszBuffer || 0 == PunMaximumCapacity || NULL == PpunStrLen)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Get string length
+        *PpunStrLen = Platform_WideLength(PwszBuffer, PunMaximumCapacity);
+        if (*PpunStrLen >= PunMaximumCapacity) // In this case the input string is not null-terminated and / or maximum capacity is too small
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameter
+        if (NULL != PpunStrLen)
+            *PpunStrLen = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Concatenates Unicode strings
+ *  @details    This function concatenates destination and source Unicode strings.
+ *
+ *  @param      PwszDestination             In: Pointer to the destination Unicode buffer
+ *                                          Out: Pointer to the concatenated Unicode buffer
+ *  @param      PpunDestinationCapacity     In: Capacity of the destination buffer in elements (include additional space for terminating 0)\n
+ *                                          Out: Number of elements in the destination buffer (without terminating 0)
+ *  @param      PwszSource                  Pointer to the source Unicode buffer.
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. One parameter is NULL or strings overlap.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       Destination buffer is too small.
+ */
+_Check_return_
+unsigned int
+Platform_StringConcatenate(
+    _Inout_updates_z_(*PpunDestinationCapacity) wchar_t*        PwszDestination,
+    _Inout_                                     unsigned int*   PpunDestinationCapacity,
+    _In_z_                                      const wchar_t*  PwszSource)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unSourceLength = 0;
+        unsigned int unDestinationLength = 0;
+
+        // Check parameters
+        if (NULL == PwszDestination || NULL == PpunDestinationCapacity || NULL == PwszSource)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check destination buffer capacity; we need at least a size of 1 for null-termination
+        if (0 == *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Get original string lengths
+        unReturnValue = Platform_StringGetLength(PwszSource, *PpunDestinationCapacity, &unSourceLength);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unReturnValue = Platform_StringGetLength(PwszDestination, *PpunDestinationCapacity, &unDestinationLength);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Check destination buffer capacity; we need at least a size of 1 more element for null-termination
+        if (*PpunDestinationCapacity <= unSourceLength + unDestinationLength)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Check if strings overlap (not supported by concatenation method)
+        if ((PwszSource == PwszDestination) ||
+                (PwszSource < PwszDestination && PwszSource + unSourceLength >= PwszDestination) ||
+                (PwszSource > PwszDestination && PwszDestination + unDestinationLength >= PwszSource))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Concatenate strings
+        memcpy(&PwszDestination[unDestinationLength], PwszSource, (unSourceLength + 1) * sizeof(wchar_t));
+
+        // Update destination length
+        *PpunDestinationCapacity = unDestinationLength + unSourceLength;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameters
+        if (NULL != PwszDestination && NULL != PpunDestinationCapacity && 0 != *PpunDestinationCapacity)
+            PwszDestination[0] = L'\0';
+        if (NULL != PpunDestinationCapacity)
+            *PpunDestinationCapacity = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Concatenates Unicode strings representing two paths
+ *  @details    This function concatenates destination and source Unicode strings representing two paths. The function adds if necessary
+ *              a '/' as separator.
+ *
+ *  @param      PwszDestination             In: Pointer to the destination Unicode buffer
+ *                                          Out: Pointer to the concatenated Unicode buffer
+ *  @param      PpunDestinationCapacity     In: Capacity of the destination buffer in elements (include additional space for terminating 0)\n
+ *                                          Out: Number of elements in the destination buffer (without terminating 0)
+ *  @param      PwszSource                  Pointer to the source Unicode buffer.
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. One parameter is NULL or strings overlap.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       Destination buffer is too small.
+ */
+_Check_return_
+unsigned int
+Platform_StringConcatenatePaths(
+    _Inout_updates_z_(*PpunDestinationCapacity) wchar_t*        PwszDestination,
+    _Inout_                                     unsigned int*   PpunDestinationCapacity,
+    _In_z_                                      const wchar_t*  PwszSource)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned int unDestinationLength = 0;
+
+        // Check parameters
+        if (NULL == PwszDestination || NULL == PpunDestinationCapacity || NULL == PwszSource)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check destination buffer capacity; we need at least a size of 1 for null-termination
+        if (0 == *PpunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        unReturnValue = Platform_StringGetLength(PwszDestination, *PpunDestinationCapacity, &unDestinationLength);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Check if last character of destination is '/'
+        if (unDestinationLength > 0 && PwszDestination[unDestinationLength - 1] != L'/')
+        {
+            if (*PpunDestinationCapacity <= unDestinationLength + 1)
+            {
+                unReturnValue = RC_E_BUFFER_TOO_SMALL;
+                break;
+            }
+
+            PwszDestination[unDestinationLength] = L'/';
+            PwszDestination[unDestinationLength + 1] = L'\0';
+        }
+
+        // Concatenate strings
+        unReturnValue = Platform_StringConcatenate(PwszDestination, PpunDestinationCapacity, PwszSource);
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameters
+        if (NULL != PwszDestination && NULL != PpunDestinationCapacity && 0 != *PpunDestinationCapacity)
+            PwszDestination[0] = L'\0';
+        if (NULL != PpunDestinationCapacity)
+            *PpunDestinationCapacity = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Convert an ANSI string to a Unicode string
+ *  @details    This function converts an ANSI string to a Unicode string
+ *
+ *  @param      PwszDestination             Pointer to the destination Unicode string buffer.
+ *  @param      PunDestinationCapacity      Size of the destination Unicode string buffer in wide characters.
+ *  @param      PszSource                   Pointer to the ANSI string buffer.
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_FAIL                   An unexpected error occurred.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. One parameter is NULL.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       Destination buffer is too small.
+ */
+_Check_return_
+unsigned int
+Platform_AnsiString2UnicodeString(
+    _Inout_updates_z_(PunDestinationCapacity)   wchar_t*        PwszDestination,
+    _In_                                        unsigned int    PunDestinationCapacity,
+    _In_z_                                      const char*     PszSource)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        size_t unLength = 0;
+        size_t unIndex = 0;
+
+        // Check parameters
+        if (NULL == PwszDestination || 0 == PunDestinationCapacity || NULL == PszSource)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check that destination is large enough
+        unLength = strlen(PszSource);
+        if (unLength >= PunDestinationCapacity)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Convert from ANSI to Unicode
+        for (unIndex = 0; unIndex <= unLength; unIndex++)
+            PwszDestination[unIndex] = (wchar_t)(unsigned char)PszSource[unIndex];
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Convert a string to integer
+ *  @details    This function returns the int value produced by interpreting the input characters as a decimal number
+ *
+ *  @param      PwszBuffer              Pointer to the Unicode string buffer
+ *  @returns    Decimal numerical value of the interpreted string as integer
+ */
+_Check_return_
+int
+Platform_String2Int(
+    _In_z_ const wchar_t* PwszBuffer)
+{
+    unsigned int unValue = 0;
+
+    if (NULL != PwszBuffer)
+    {
+        // Skip leading white space like StrDecimalToUintn on UEFI
+        while (L' ' == *PwszBuffer || L'\t' == *PwszBuffer)
+            PwszBuffer++;
+        for (; L'0' <= *PwszBuffer && L'9' >= *PwszBuffer; PwszBuffer++)
+            unValue = unValue * 10 + (unsigned int)(*PwszBuffer - L'0');
+    }
+
+    return (int)unValue;
+}
+
+/**
+ *  @brief      Set a String to zero wide characters
+ *  @details    This function sets all wide characters of the buffer to zero
+ *
+ *  @param      PwszBuffer          Pointer to the Unicode string buffer.
+ *  @param      PunBufferSize       Size of wchar_t buffer in elements.
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. One parameter is NULL.
+ */
+_Check_return_
+unsigned int
+Platform_StringSetZero(
+    _Out_writes_z_(PunBufferSize)   wchar_t*        PwszBuffer,
+    _In_                            unsigned int    PunBufferSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    // Check input parameters
+    if (NULL == PwszBuffer || PunBufferSize == 0)
+        unReturnValue = RC_E_BAD_PARAMETER;
+    else
+    {
+        Platform_MemorySet(PwszBuffer, 0, PunBufferSize * sizeof(PwszBuffer[0]));
+        unReturnValue = RC_SUCCESS;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Converts a wide character to upper case
+ *  @details
+ *
+ *  @param      PwchToUpper     Wide character to be converted
+ *  @returns    Converted upper case wide character
+ */
+_Check_return_
+wchar_t
+Platform_WCharToUpper(
+    _In_ wchar_t PwchToUpper)
+{
+    // Check if value is a lower case letter
+    if (PwchToUpper >= 'a' && PwchToUpper <= 'z')
+        // Convert letter to upper case
+        PwchToUpper += (unsigned short)('A' - 'a');
+
+    return PwchToUpper;
+}
+
+/**
+ *  @brief      Gets the current time
+ *  @details    Retrieves the current local date and time. The accuracy is platform and OS dependent.
+ *
+ *  @param      PpTime                  The current local time; accuracy is given in this structure and is platform and OS dependent.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_GetTime(
+    _Inout_ IfxTime* PpTime)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        struct timeval sTimeValue;
+        struct tm sLocalTime;
+
+        // Check parameters
+        if (NULL == PpTime)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Get time
+        if (0 != gettimeofday(&sTimeValue, NULL))
+            break;
+        if (NULL == localtime_r(&sTimeValue.tv_sec, &sLocalTime))
+            break;
+
+        // Assign values to returned structure
+        PpTime->unYear = (unsigned int)sLocalTime.tm_year + 1900;
+        PpTime->unMonth = (unsigned int)sLocalTime.tm_mon + 1;
+        PpTime->unDay = (unsigned int)sLocalTime.tm_mday;
+        PpTime->unHour = (unsigned int)sLocalTime.tm_hour;
+        PpTime->unMinute = (unsigned int)sLocalTime.tm_min;
+        PpTime->unSecond = (unsigned int)sLocalTime.tm_sec;
+        PpTime->fMillisecondAvailable = TRUE;
+        PpTime->nMillisecond = (int)(sTimeValue.tv_usec / 1000);
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Builds the path of the file storing a non-volatile value
+ *  @details    The name is restricted to letters, digits, '_', '-' and '.', so it cannot leave the storage directory.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PszPath                 Receives the path.
+ *  @param      PunPathCapacity         Capacity of PszPath in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      The name is empty, too long or contains other characters.
+ */
+static
+unsigned int
+Platform_NvStoreGetPath(
+    _In_z_                      const wchar_t*  PwszName,
+    _Out_z_cap_(PunPathCapacity) char*          PszPath,
+    _In_                        unsigned int    PunPathCapacity)
+{
+    unsigned int unReturnValue = RC_E_BAD_PARAMETER;
+
+    do
+    {
+        unsigned int unPrefixLength = (unsigned int)sizeof(PLATFORM_NV_STORE_DIRECTORY "/") - 1;
+        unsigned int unIndex = 0;
+
+        if (L'\0' == PwszName[0] || L'.' == PwszName[0])
+            break;
+
+        memcpy(PszPath, PLATFORM_NV_STORE_DIRECTORY "/", unPrefixLength);
+        for (unIndex = 0; L'\0' != PwszName[unIndex]; unIndex++)
+        {
+            wchar_t wch = PwszName[unIndex];
+            if (unPrefixLength + unIndex + 1 >= PunPathCapacity)
+                break;
+            if (!((L'a' <= wch && L'z' >= wch) || (L'A' <= wch && L'Z' >= wch) || (L'0' <= wch && L'9' >= wch) ||
+                    L'_' == wch || L'-' == wch || L'.' == wch))
+                break;
+            PszPath[unPrefixLength + unIndex] = (char)wch;
+        }
+        if (L'\0' != PwszName[unIndex])
+            break;
+
+        PszPath[unPrefixLength + unIndex] = '\0';
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads a value from the non-volatile platform storage
+ *  @details    The value survives a platform reset. On Linux it is stored in a file in PLATFORM_NV_STORE_DIRECTORY.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Receives the value.
+ *  @param      PpunDataSize            In: size of PrgbData in bytes, out: size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_FOUND          The value does not exist.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PrgbData is too small for the value.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreRead(
+    _In_z_                          const wchar_t*  PwszName,
+    _Out_bytecap_(*PpunDataSize)    void*           PrgbData,
+    _Inout_                         unsigned int*   PpunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    int nFile = -1;
+
+    do
+    {
+        char szPath[MAX_PATH];
+        struct stat sStat;
+        ssize_t nRead = 0;
+
+        // Check parameters
+        if (NULL == PwszName || NULL == PrgbData || NULL == PpunDataSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnValue = Platform_NvStoreGetPath(PwszName, szPath, sizeof(szPath));
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = RC_E_FAIL;
+        nFile = open(szPath, O_RDONLY | O_CLOEXEC);
+        if (nFile < 0)
+        {
+            if (ENOENT == errno)
+                unReturnValue = RC_E_NOT_FOUND;
+            break;
+        }
+        if (0 != fstat(nFile, &sStat) || sStat.st_size > UINT_MAX)
+            break;
+        if ((unsigned long long)sStat.st_size > *PpunDataSize)
+        {
+            *PpunDataSize = (unsigned int)sStat.st_size;
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        nRead = read(nFile, PrgbData, (size_t)sStat.st_size);
+        if (nRead != (ssize_t)sStat.st_size)
+            break;
+
+        *PpunDataSize = (unsigned int)nRead;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (nFile >= 0)
+        close(nFile);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Writes a value to the non-volatile platform storage
+ *  @details    The value survives a platform reset. On Linux it is stored in a file in PLATFORM_NV_STORE_DIRECTORY. The
+ *              file is replaced atomically, so a power loss leaves either the old or the new value. A size of zero
+ *              deletes the value.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Value to write, may be NULL if PunDataSize is zero.
+ *  @param      PunDataSize             Size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully. Deleting a value which does not exist succeeds as well.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreWrite(
+    _In_z_                          const wchar_t*  PwszName,
+    _In_bytecount_(PunDataSize)     const void*     PrgbData,
+    _In_                            unsigned int    PunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    int nFile = -1;
+    char szTempPath[MAX_PATH + 4];
+
+    szTempPath[0] = '\0';
+
+    do
+    {
+        char szPath[MAX_PATH];
+
+        // Check parameters
+        if (NULL == PwszName || (NULL == PrgbData && 0 != PunDataSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnValue = Platform_NvStoreGetPath(PwszName, szPath, sizeof(szPath));
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = RC_E_FAIL;
+        if (0 == PunDataSize)
+        {
+            // Deleting a value which does not exist is not an error
+            if (0 != unlink(szPath) && ENOENT != errno)
+                break;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        if (0 != mkdir(PLATFORM_NV_STORE_DIRECTORY, 0700) && EEXIST != errno)
+            break;
+
+        snprintf(szTempPath, sizeof(szTempPath), "%s.new", szPath);
+        nFile = open(szTempPath, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+        if (nFile < 0)
+        {
+            szTempPath[0] = '\0';
+            break;
+        }
+        if (write(nFile, PrgbData, PunDataSize) != (ssize_t)PunDataSize || 0 != fsync(nFile))
+            break;
+        close(nFile);
+        nFile = -1;
+
+        if (0 != rename(szTempPath, szPath))
+            break;
+        szTempPath[0] = '\0';
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (nFile >= 0)
+        close(nFile);
+    if ('\0' != szTempPath[0])
+        unlink(szTempPath);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Sleeps the given time in milliseconds
+ *  @details
+ *
+ *  @param      PunSleepTime            Time to sleep in milliseconds.
+ */
+void
+Platform_Sleep(
+    _In_ unsigned int PunSleepTime)
+{
+    Platform_SleepMicroSeconds(1000 * PunSleepTime);
+}
+
+/**
+ *  @brief      Sleeps the given time in microseconds.
+ *  @details    The sleep is continued if it is interrupted by a signal.
+ *
+ *  @param      PunSleepTime    Time to sleep in microseconds.
+ */
+void
+Platform_SleepMicroSeconds(
+    _In_ unsigned int PunSleepTime)
+{
+    struct timespec sRequest;
+
+    sRequest.tv_sec = PunSleepTime / 1000000;
+    sRequest.tv_nsec = (long)(PunSleepTime % 1000000) * 1000;
+    while (0 != nanosleep(&sRequest, &sRequest) && EINTR == errno)
+    {
+    }
+}
+
+/**
+ *  @brief      Returns the current value of the monotonic tick counter
+ *  @details    On Linux a tick is a nanosecond of CLOCK_MONOTONIC.
+ *
+ *  @returns    Tick count since an unspecified starting point.
+ */
+_Check_return_
+unsigned long long
+Platform_GetTicks()
+{
+    struct timespec sNow;
+
+    if (0 != clock_gettime(CLOCK_MONOTONIC, &sNow))
+        return 0;
+
+    return (unsigned long long)sNow.tv_sec * 1000000000ULL + (unsigned long long)sNow.tv_nsec;
+}
+
+/**
+ *  @brief      Converts a number of ticks to microseconds
+ *  @details    Use this function to convert the difference of two Platform_GetTicks values.
+ *
+ *  @param      PullTicks       Number of ticks.
+ *  @returns    Duration in microseconds.
+ */
+_Check_return_
+unsigned long long
+Platform_TicksToMicroseconds(
+    _In_ unsigned long long PullTicks)
+{
+    return PullTicks / 1000;
+}
+
+/**
+ *  @brief      Entry point of the task thread
+ *  @details
+ *
+ *  @param      PpvArgument     Not used.
+ *  @returns    Always NULL.
+ */
+static
+void*
+Platform_TaskEntry(
+    _Inout_ void* PpvArgument)
+{
+    UNREFERENCED_PARAMETER(PpvArgument);
+    s_pfnTaskProcedure(s_pvTaskContext);
+    return NULL;
+}
+
+/**
+ *  @brief      Starts a procedure on another processor
+ *  @details    On Linux the procedure runs in a thread. Only one task can run at a time and it must be joined with
+ *              Platform_TaskWait. In case the function fails the caller runs the procedure itself.
+ *
+ *  @param      PfnProcedure            Procedure to run.
+ *  @param      PpvContext              Context passed to the procedure.
+ *
+ *  @retval     RC_SUCCESS              The procedure has been started.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          Another task is running.
+ *  @retval     RC_E_NOT_FOUND          No thread could be created to run the procedure.
+ */
+_Check_return_
+unsigned int
+Platform_TaskStart(
+    _In_    PFN_PLATFORM_TASK_PROCEDURE PfnProcedure,
+    _Inout_ void*                       PpvContext)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (NULL == PfnProcedure)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (s_fTaskRunning)
+        {
+            unReturnValue = RC_E_NOT_READY;
+            break;
+        }
+
+        s_pfnTaskProcedure = PfnProcedure;
+        s_pvTaskContext = PpvContext;
+        if (0 != pthread_create(&s_hTaskThread, NULL, Platform_TaskEntry, NULL))
+        {
+            s_pfnTaskProcedure = NULL;
+            s_pvTaskContext = NULL;
+            unReturnValue = RC_E_NOT_FOUND;
+            break;
+        }
+
+        s_fTaskRunning = TRUE;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Waits until the procedure started by Platform_TaskStart has finished
+ *  @details    Returns immediately if no task is running.
+ */
+void
+Platform_TaskWait()
+{
+    if (!s_fTaskRunning)
+        return;
+
+    IGNORE_RETURN_VALUE(pthread_join(s_hTaskThread, NULL));
+    s_fTaskRunning = FALSE;
+    s_pfnTaskProcedure = NULL;
+    s_pvTaskContext = NULL;
+}
+
+/**
+ *  @brief      Enters a section protected against concurrent callers
+ *  @details    The section is protected by a mutex. The section must be short and must not wait for the TPM. Sections
+ *              must not be nested.
+ *
+ *  @returns    State to be passed to Platform_LeaveCriticalSection (always 0).
+ */
+_Check_return_
+unsigned long long
+Platform_EnterCriticalSection()
+{
+    IGNORE_RETURN_VALUE(pthread_mutex_lock(&s_hCriticalSection));
+    return 0;
+}
+
+/**
+ *  @brief      Leaves a section entered with Platform_EnterCriticalSection
+ *  @details
+ *
+ *  @param      PullState       State returned by Platform_EnterCriticalSection.
+ */
+void
+Platform_LeaveCriticalSection(
+    _In_ unsigned long long PullState)
+{
+    UNREFERENCED_PARAMETER(PullState);
+    IGNORE_RETURN_VALUE(pthread_mutex_unlock(&s_hCriticalSection));
+}
+
+/**
+ *  @brief      Returns the execution level of the caller
+ *  @details    There are no execution levels on Linux, all callers run on level 0.
+ *
+ *  @returns    Execution level of the caller (always 0).
+ */
+_Check_return_
+unsigned int
+Platform_GetExecutionLevel()
+{
+    return 0;
+}
+
+/**
+ *  @brief      Swaps a UINT16
+ *  @details
+ *
+ *  @param      PusValue
+ *  @returns    Swapped UINT16 value
+ */
+unsigned short
+Platform_SwapBytes16(
+    _In_ unsigned short PusValue)
+{
+    return __builtin_bswap16(PusValue);
+}
+
+/**
+ *  @brief      Swaps a UINT32
+ *  @details
+ *
+ *  @param      PunValue
+ *  @returns    Swapped UINT32 value
+ */
+unsigned int
+Platform_SwapBytes32(
+    _In_ unsigned int PunValue)
+{
+    return __builtin_bswap32(PunValue);
+}
+
+/**
+ *  @brief      Unmarshal a Unicode string (16bit per character) to the target platform
+ *  @details    The string is decoded from little endian code units in a single pass. PrgbBuffer needs no 16bit alignment.
+ *
+ *  @param      PrgbBuffer              Binary buffer.
+ *  @param      PunBufferLen            Length of binary buffer.
+ *  @param      PwszTargetString        Receives the unmarshalled string including null-termination.
+ *  @param      PpunTargetStringLen     On input the capacity of the wchar_t buffer in elements.
+ *                                      On output the length of the wchar_t string in elements without terminating NULL character.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   The buffer in PwszTargetString is too small to hold the contents of the binary buffer.
+ */
+_Check_return_
+unsigned int
+Platform_UnmarshalString(
+    _In_bytecount_(PunBufferLen)            const void*     PrgbBuffer,
+    _In_                                    unsigned int    PunBufferLen,
+    _Out_writes_z_(*PpunTargetStringLen)    wchar_t*        PwszTargetString,
+    _Inout_                                 unsigned int*   PpunTargetStringLen)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        const BYTE* pbBuffer = (const BYTE*)PrgbBuffer;
+        unsigned int unLength = 0;
+
+        // Check parameters
+        if (NULL == PrgbBuffer || 0 == PunBufferLen || NULL == PwszTargetString || 0 == PpunTargetStringLen || 0 == *PpunTargetStringLen)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Input buffer must have even length for unmarshaling to succeed.
+        if (PunBufferLen % 2 != 0)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Check if target buffer is too small to fit the input string.
+        if (PunBufferLen / 2 >= *PpunTargetStringLen)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+
+        // Decode the little endian code units byte-wise, so the buffer needs no 16bit alignment.
+        // The string is truncated if it is not null-terminated.
+        for (unLength = 0; unLength < PunBufferLen / 2; unLength++)
+        {
+            wchar_t wcCodeUnit = (wchar_t)(pbBuffer[2 * unLength] | (pbBuffer[2 * unLength + 1] << 8));
+            if (L'\0' == wcCodeUnit)
+                break;
+            PwszTargetString[unLength] = wcCodeUnit;
+        }
+        PwszTargetString[unLength] = L'\0';
+
+        // Update the string length.
+        *PpunTargetStringLen = unLength;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+    {
+        // Reset out parameter
+        if (NULL != PpunTargetStringLen)
+            *PpunTargetStringLen = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Finds a string in another string.
+ *  @details
+ *
+ *  @param      PwszSearch              String to search for.
+ *  @param      PwszString              String to search in.
+ *  @param      PpwszStart              If return code is RC_SUCCESS, returns the start position of the PwszSearch in PwszString.
+ *
+ *  @retval     RC_SUCCESS              Search string was found in the actual string.
+ *  @retval     RC_E_NOT_FOUND          Search string was not found in the actual string.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ */
+_Check_return_
+unsigned int
+Platform_FindString(
+    _In_z_  const wchar_t*  PwszSearch,
+    _In_z_  const wchar_t*  PwszString,
+    _Out_   wchar_t**       PpwszStart)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        const wchar_t* pwszPosition = NULL;
+
+        // Check parameters
+        if (NULL == PwszSearch || NULL == PwszString || NULL == PpwszStart)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Find the string
+        *PpwszStart = NULL;
+        unReturnValue = RC_E_NOT_FOUND;
+        for (pwszPosition = PwszString; ; pwszPosition++)
+        {
+            unsigned int unIndex = 0;
+            while (L'\0' != PwszSearch[unIndex] && pwszPosition[unIndex] == PwszSearch[unIndex])
+                unIndex++;
+            if (L'\0' == PwszSearch[unIndex])
+            {
+                // String was found
+                *PpwszStart = (wchar_t*)pwszPosition;
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+            if (L'\0' == *pwszPosition)
+                break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
@@ -60,6 +60,15 @@ typedef struct tdIfxTime
     unsigned int unYear;
 } IfxTime;
 
+/**
+ *  @brief      Procedure run by Platform_TaskStart
+ *  @details    The procedure may run on another processor. It must not call any platform service, log or store errors.
+ *
+ *  @param      PpvContext      Context passed to Platform_TaskStart.
+ */
+typedef void (*PFN_PLATFORM_TASK_PROCEDURE)(
+    _Inout_ void* PpvContext);
+
 /**
  *  @brief      Structure for TPM Firmware Version
  *  @details
@@ -99,6 +108,65 @@ void
 Platform_MemoryFree(
     _Inout_opt_ void** PppvMemory);
 
+/**
+ *  @brief      Reserves the memory arena
+ *  @details    The memory arena is a single pool allocation which serves small, long-living allocations and scoped
+ *              scratch memory through Platform_ArenaAllocateZero. Call it once at driver initialization.
+ *
+ *  @param      PunSize                 Size of the memory arena in bytes.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function or the arena is already reserved.
+ *  @retval     RC_E_FAIL               The memory allocation failed.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaInitialize(
+    _In_ unsigned int PunSize);
+
+/**
+ *  @brief      Releases the memory arena
+ *  @details    All memory allocated from the arena is released at once. Call it once at driver unload after all users
+ *              of arena memory have released their references.
+ */
+void
+Platform_ArenaUninitialize();
+
+/**
+ *  @brief      Memory allocation from the memory arena initialized with zeros
+ *  @details    The memory is taken from the memory arena. If the arena is not reserved or exhausted, the memory is
+ *              allocated with Platform_MemoryAllocateZero instead. Release the memory with Platform_MemoryFree in both
+ *              cases; arena memory is only reclaimed by Platform_ArenaRelease or Platform_ArenaUninitialize.
+ *
+ *  @param      PunSize     Memory allocation size in bytes.
+ *  @retval     != NULL     Pointer to the zero initialized memory.
+ *  @retval     NULL        If the allocation fails.
+ */
+_Check_return_
+void*
+Platform_ArenaAllocateZero(
+    _In_ unsigned int PunSize);
+
+/**
+ *  @brief      Returns the current fill level of the memory arena
+ *  @details    Pass the value to Platform_ArenaRelease to release all arena memory allocated after this call, e.g. for
+ *              scratch memory of a single operation.
+ *
+ *  @returns    Current fill level of the memory arena in bytes.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaGetMark();
+
+/**
+ *  @brief      Releases the arena memory allocated after a mark
+ *  @details    The caller must ensure no allocation made after the mark is still in use.
+ *
+ *  @param      PunMark     Fill level returned by Platform_ArenaGetMark.
+ */
+void
+Platform_ArenaRelease(
+    _In_ unsigned int PunMark);
+
 /**
  *  @brief      Memory compare
  *  @details    This function compares 2 memory buffers
@@ -152,6 +220,43 @@ Platform_MemoryCopy(
     _In_reads_bytes_opt_(PunSize)           const void*     PpvSource,
     _In_                                    unsigned int    PunSize);
 
+/**
+ *  @brief      Memory set without parameter checks
+ *  @details    Inline variant of Platform_MemorySet for the marshaling code. The caller guarantees a valid destination.
+ *
+ *  @param      PpvDestination      Pointer to the buffer.
+ *  @param      PnValue             Value to set.
+ *  @param      PunSize             Size of the buffer in bytes.
+ */
+static __inline
+void
+Platform_MemorySetFast(
+    _Out_writes_bytes_all_(PunSize) void*           PpvDestination,
+    _In_                            int             PnValue,
+    _In_                            unsigned int    PunSize)
+{
+    PLATFORM_SET_MEM(PpvDestination, PnValue, PunSize);
+}
+
+/**
+ *  @brief      Memory copy without parameter checks
+ *  @details    Inline variant of Platform_MemoryCopy for the marshaling code. The caller guarantees valid buffers and
+ *              has already checked PunSize against the capacity of the destination buffer.
+ *
+ *  @param      PpvDestination          Pointer to the destination buffer.
+ *  @param      PpvSource               Pointer to the source buffer.
+ *  @param      PunSize                 Size of the buffer in bytes.
+ */
+static __inline
+void
+Platform_MemoryCopyFast(
+    _Out_writes_bytes_all_(PunSize)         void*           PpvDestination,
+    _In_reads_bytes_(PunSize)               const void*     PpvSource,
+    _In_                                    unsigned int    PunSize)
+{
+    PLATFORM_COPY_MEM(PpvDestination, PpvSource, PunSize);
+}
+
 /**
  *  @brief      Copy Unicode strings
  *  @details    This function copies the source Unicode string to the destination.
@@ -373,6 +478,47 @@ unsigned int
 Platform_GetTime(
     _Inout_ IfxTime* PpTime);
 
+/**
+ *  @brief      Reads a value from the non-volatile platform storage
+ *  @details    The value survives a platform reset. On UEFI it is stored in a non-volatile variable of the driver.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Receives the value.
+ *  @param      PpunDataSize            In: size of PrgbData in bytes, out: size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_FOUND          The value does not exist.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PrgbData is too small for the value.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreRead(
+    _In_z_                          const wchar_t*  PwszName,
+    _Out_bytecap_(*PpunDataSize)    void*           PrgbData,
+    _Inout_                         unsigned int*   PpunDataSize);
+
+/**
+ *  @brief      Writes a value to the non-volatile platform storage
+ *  @details    The value survives a platform reset. On UEFI it is stored in a non-volatile variable of the driver.
+ *              A size of zero deletes the value.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Value to write, may be NULL if PunDataSize is zero.
+ *  @param      PunDataSize             Size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully. Deleting a value which does not exist succeeds as well.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreWrite(
+    _In_z_                          const wchar_t*  PwszName,
+    _In_bytecount_(PunDataSize)     const void*     PrgbData,
+    _In_                            unsigned int    PunDataSize);
+
 /**
  *  @brief      Sleeps the given time in milliseconds
  *  @details
@@ -385,7 +531,9 @@ Platform_Sleep(
 
 /**
  *  @brief      Sleeps the given time in microseconds.
- *  @details
+ *  @details    Sleep times of at least 10 milliseconds wait for a timer event if possible, so the CPU is not kept
+ *              busy. Since the timer fires with the granularity of the system timer, the remaining time is stalled. Shorter
+ *              sleep times are stalled.
  *
  *  @param      PunSleepTime    Time to sleep in microseconds.
  */
@@ -393,6 +541,88 @@ void
 Platform_SleepMicroSeconds(
     _In_ unsigned int PunSleepTime);
 
+/**
+ *  @brief      Returns the current value of the monotonic tick counter
+ *  @details    The tick counter is based on the platform performance counter. Counter rollovers are accounted for
+ *              as long as the function is called at least once per rollover period of the counter.
+ *
+ *  @returns    Tick count since the first call of the function.
+ */
+_Check_return_
+unsigned long long
+Platform_GetTicks();
+
+/**
+ *  @brief      Converts a number of ticks to microseconds
+ *  @details    Use this function to convert the difference of two Platform_GetTicks values.
+ *
+ *  @param      PullTicks       Number of ticks.
+ *  @returns    Duration in microseconds or 0 if the platform does not provide a performance counter.
+ */
+_Check_return_
+unsigned long long
+Platform_TicksToMicroseconds(
+    _In_ unsigned long long PullTicks);
+
+/**
+ *  @brief      Starts a procedure on another processor
+ *  @details    On UEFI the procedure is dispatched to an idle application processor through the MP services protocol.
+ *              Only one task can run at a time and it must be joined with Platform_TaskWait. In case the function
+ *              fails the caller runs the procedure itself.
+ *
+ *  @param      PfnProcedure            Procedure to run.
+ *  @param      PpvContext              Context passed to the procedure.
+ *
+ *  @retval     RC_SUCCESS              The procedure has been started.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          Another task is running.
+ *  @retval     RC_E_NOT_FOUND          No processor is available to run the procedure.
+ */
+_Check_return_
+unsigned int
+Platform_TaskStart(
+    _In_    PFN_PLATFORM_TASK_PROCEDURE PfnProcedure,
+    _Inout_ void*                       PpvContext);
+
+/**
+ *  @brief      Waits until the procedure started by Platform_TaskStart has finished
+ *  @details    Returns immediately if no task is running.
+ */
+void
+Platform_TaskWait();
+
+/**
+ *  @brief      Enters a section protected against concurrent callers
+ *  @details    On UEFI the TPL is raised to TPL_NOTIFY, so timer and event callbacks cannot interrupt the section. The
+ *              section must be short and must not wait for the TPM. Sections must not be nested.
+ *
+ *  @returns    State to be passed to Platform_LeaveCriticalSection.
+ */
+_Check_return_
+unsigned long long
+Platform_EnterCriticalSection();
+
+/**
+ *  @brief      Leaves a section entered with Platform_EnterCriticalSection
+ *  @details
+ *
+ *  @param      PullState       State returned by Platform_EnterCriticalSection.
+ */
+void
+Platform_LeaveCriticalSection(
+    _In_ unsigned long long PullState);
+
+/**
+ *  @brief      Returns the execution level of the caller
+ *  @details    On UEFI this is the current TPL. A caller on a higher level may have interrupted a caller on a lower level,
+ *              callers on the same level cannot interrupt each other. Platforms without execution levels return 0.
+ *
+ *  @returns    Execution level of the caller.
+ */
+_Check_return_
+unsigned int
+Platform_GetExecutionLevel();
+
 /**
  *  @brief      Swaps a UINT16
  *  @details
@@ -415,9 +645,47 @@ unsigned int
 Platform_SwapBytes32(
     _In_ unsigned int PunValue);
 
+/**
+ *  @brief      Swaps a UINT16 inline
+ *  @details    Inline variant of Platform_SwapBytes16, maps to the byte swap builtin of the compiler.
+ *
+ *  @param      PusValue
+ *  @returns    Swapped UINT16 value
+ */
+static __inline
+unsigned short
+Platform_SwapBytes16Fast(
+    _In_ unsigned short PusValue)
+{
+#if defined(__GNUC__)
+    return __builtin_bswap16(PusValue);
+#else
+    return (unsigned short)((PusValue << 8) | (PusValue >> 8));
+#endif
+}
+
+/**
+ *  @brief      Swaps a UINT32 inline
+ *  @details    Inline variant of Platform_SwapBytes32, maps to the byte swap builtin of the compiler.
+ *
+ *  @param      PunValue
+ *  @returns    Swapped UINT32 value
+ */
+static __inline
+unsigned int
+Platform_SwapBytes32Fast(
+    _In_ unsigned int PunValue)
+{
+#if defined(__GNUC__)
+    return __builtin_bswap32(PunValue);
+#else
+    return (PunValue << 24) | ((PunValue & 0xFF00) << 8) | ((PunValue >> 8) & 0xFF00) | (PunValue >> 24);
+#endif
+}
+
 /**
  *  @brief      Unmarshal a Unicode string (16bit per character) to the target platform
- *  @details
+ *  @details    The string is decoded from little endian code units in a single pass. PrgbBuffer needs no 16bit alignment.
  *
  *  @param      PrgbBuffer              Binary buffer.
  *  @param      PunBufferLen            Length of binary buffer.
@@ -428,7 +696,6 @@ Platform_SwapBytes32(
  *  @retval     RC_SUCCESS              The operation completed successfully.
  *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
  *  @retval     RC_E_BUFFER_TOO_SMALL   The buffer in PwszTargetString is too small to hold the contents of the binary buffer.
- *  @retval     RC_E_FAIL               An internal error occurred. Either there was not enough memory to create a temporary copy of PrgbBuffer or StrnCpyS failed.
  */
 _Check_return_
 unsigned int
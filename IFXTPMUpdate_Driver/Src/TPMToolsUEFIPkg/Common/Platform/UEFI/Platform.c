@@ -14,10 +14,51 @@
  */
 
 #include "Platform.h"
+#include <Library/TimerLib.h>
+#include <Protocol/MpService.h>
+
+/// Last raw value of the performance counter read by Platform_GetTicks
+static UINT64 s_ullLastCounter = 0;
+
+/// Ticks accumulated by Platform_GetTicks
+static UINT64 s_ullTicks = 0;
+
+/// Flag indicating Platform_GetTicks has read the performance counter before
+static BOOL s_fTicksStarted = FALSE;
+
+/// Alignment of the allocations from the memory arena in bytes
+#define PLATFORM_ARENA_ALIGNMENT 8
+
+/// Memory arena (NULL if not reserved)
+static unsigned char* s_pbArena = NULL;
+
+/// Size of the memory arena in bytes
+static unsigned int s_unArenaSize = 0;
+
+/// Fill level of the memory arena in bytes
+static unsigned int s_unArenaUsed = 0;
 
 /// Handle to the UEFI image
 extern EFI_HANDLE gImageHandle;
 
+/// Minimum sleep time in microseconds for which Platform_SleepMicroSeconds waits for a timer event instead of stalling
+#define PLATFORM_TIMER_WAIT_MIN_US 10000
+
+/// Interval to check for the completion of a task started by Platform_TaskStart in microseconds
+#define PLATFORM_TASK_POLL_INTERVAL 1000
+
+/// Procedure of the task started by Platform_TaskStart
+static PFN_PLATFORM_TASK_PROCEDURE s_pfnTaskProcedure = NULL;
+
+/// Context of the task started by Platform_TaskStart
+static void* s_pvTaskContext = NULL;
+
+/// Event signaled by the MP services protocol when the task has finished (NULL if no task is running)
+static EFI_EVENT s_hTaskEvent = NULL;
+
+/// Vendor GUID of the non-volatile variables written by Platform_NvStoreWrite {5C3B7F4E-9A21-4D6B-8E0F-2A7C91D4B563}
+static EFI_GUID s_sNvStoreGuid = { 0x5c3b7f4e, 0x9a21, 0x4d6b, { 0x8e, 0x0f, 0x2a, 0x7c, 0x91, 0xd4, 0xb5, 0x63 } };
+
 /**
  *  @brief      Memory allocation initialized with zeros
  *  @details    This function returns a pointer to a zero initialized memory
@@ -53,11 +94,132 @@ Platform_MemoryFree(
     // Check if pointer is not null and free than
     if (NULL != PppvMemory && NULL != *PppvMemory)
     {
-        FreePool(*PppvMemory);
+        // Arena memory is reclaimed by Platform_ArenaRelease or Platform_ArenaUninitialize only
+        if (NULL == s_pbArena ||
+                (unsigned char*)*PppvMemory < s_pbArena ||
+                (unsigned char*)*PppvMemory >= s_pbArena + s_unArenaSize)
+            FreePool(*PppvMemory);
         *PppvMemory = NULL;
     }
 }
 
+/**
+ *  @brief      Reserves the memory arena
+ *  @details    The memory arena is a single pool allocation which serves small, long-living allocations and scoped
+ *              scratch memory through Platform_ArenaAllocateZero. Call it once at driver initialization.
+ *
+ *  @param      PunSize                 Size of the memory arena in bytes.
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function or the arena is already reserved.
+ *  @retval     RC_E_FAIL               The memory allocation failed.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaInitialize(
+    _In_ unsigned int PunSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check parameters
+        if (0 == PunSize || NULL != s_pbArena)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        s_pbArena = (unsigned char*)AllocatePool(PunSize);
+        if (NULL == s_pbArena)
+            break;
+
+        s_unArenaSize = PunSize;
+        s_unArenaUsed = 0;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Releases the memory arena
+ *  @details    All memory allocated from the arena is released at once. Call it once at driver unload after all users
+ *              of arena memory have released their references.
+ */
+void
+Platform_ArenaUninitialize()
+{
+    if (NULL != s_pbArena)
+        FreePool(s_pbArena);
+
+    s_pbArena = NULL;
+    s_unArenaSize = 0;
+    s_unArenaUsed = 0;
+}
+
+/**
+ *  @brief      Memory allocation from the memory arena initialized with zeros
+ *  @details    The memory is taken from the memory arena. If the arena is not reserved or exhausted, the memory is
+ *              allocated with Platform_MemoryAllocateZero instead. Release the memory with Platform_MemoryFree in both
+ *              cases; arena memory is only reclaimed by Platform_ArenaRelease or Platform_ArenaUninitialize.
+ *
+ *  @param      PunSize     Memory allocation size in bytes.
+ *  @retval     != NULL     Pointer to the zero initialized memory.
+ *  @retval     NULL        If the allocation fails.
+ */
+_Check_return_
+void*
+Platform_ArenaAllocateZero(
+    _In_ unsigned int PunSize)
+{
+    void* pvBuffer = NULL;
+    unsigned int unAlignedSize = (PunSize + PLATFORM_ARENA_ALIGNMENT - 1) & ~(PLATFORM_ARENA_ALIGNMENT - 1);
+
+    if (0 != PunSize)
+    {
+        if (NULL != s_pbArena && unAlignedSize >= PunSize && unAlignedSize <= s_unArenaSize - s_unArenaUsed)
+        {
+            // Bump allocation from the arena; released arena memory may contain old data
+            pvBuffer = s_pbArena + s_unArenaUsed;
+            s_unArenaUsed += unAlignedSize;
+            ZeroMem(pvBuffer, PunSize);
+        }
+        else
+            pvBuffer = Platform_MemoryAllocateZero(PunSize);
+    }
+
+    return pvBuffer;
+}
+
+/**
+ *  @brief      Returns the current fill level of the memory arena
+ *  @details    Pass the value to Platform_ArenaRelease to release all arena memory allocated after this call, e.g. for
+ *              scratch memory of a single operation.
+ *
+ *  @returns    Current fill level of the memory arena in bytes.
+ */
+_Check_return_
+unsigned int
+Platform_ArenaGetMark()
+{
+    return s_unArenaUsed;
+}
+
+/**
+ *  @brief      Releases the arena memory allocated after a mark
+ *  @details    The caller must ensure no allocation made after the mark is still in use.
+ *
+ *  @param      PunMark     Fill level returned by Platform_ArenaGetMark.
+ */
+void
+Platform_ArenaRelease(
+    _In_ unsigned int PunMark)
+{
+    if (PunMark < s_unArenaUsed)
+        s_unArenaUsed = PunMark;
+}
+
 /**
  *  @brief      Memory compare
  *  @details    This function compares 2 memory buffers
@@ -253,51 +415,29 @@ Platform_StringCompare(
         nReturn = -1;
     else if (NULL == PwszString2)
         nReturn = 1;
-    else
+    else if (TRUE == PfCaseInsensitive)
     {
-        // Stores for upper case strings to compare them in temporary memory if necessary
-        wchar_t* wszString1ToUpper = NULL;
-        wchar_t* wszString2ToUpper = NULL;
+        unsigned int unIndex = 0;
 
-        do
+        // Compare the upper case characters one by one, both strings end at the same index if they match
+        nReturn = 0;
+        for (unIndex = 0; unIndex < PunCount; unIndex++)
         {
-            // If necessary, bring strings to upper case
-            if (TRUE == PfCaseInsensitive)
-            {
-                unsigned int unIndex = 0;
-                unsigned int unBufferSize = (PunCount + 1) * sizeof(L'\0'); // Add space for null-termination (required e.g. in case substring is being compared)
-
-                // Allocate memory for first upper string
-                wszString1ToUpper = (wchar_t*)Platform_MemoryAllocateZero(unBufferSize);
-                if (NULL == wszString1ToUpper)
-                    break;
-
-                // Bring all characters in first string to upper case
-                for (unIndex = 0; unIndex < PunCount; unIndex++)
-                    *(wszString1ToUpper + unIndex) = (wchar_t)Platform_WCharToUpper((unsigned short) * (PwszString1 + unIndex));
-
-                // Allocate memory for second upper string
-                wszString2ToUpper = (wchar_t*)Platform_MemoryAllocateZero(unBufferSize);
-                if (NULL == wszString2ToUpper)
-                    break;
-
-                // Bring all characters in second string to upper case
-                for (unIndex = 0; unIndex < PunCount; unIndex++)
-                    *(wszString2ToUpper + unIndex) = (wchar_t)Platform_WCharToUpper((unsigned short) * (PwszString2 + unIndex));
+            wchar_t wch1 = Platform_WCharToUpper(PwszString1[unIndex]);
+            wchar_t wch2 = Platform_WCharToUpper(PwszString2[unIndex]);
 
-                // Compare upper case strings
-                nReturn = (int)StrnCmp(wszString1ToUpper, wszString2ToUpper, PunCount);
+            if (wch1 != wch2)
+            {
+                nReturn = (int)wch1 - (int)wch2;
+                break;
             }
-            else
-                // Compare original strings
-                nReturn = (int)StrnCmp(PwszString1, PwszString2, PunCount);
+            if (L'\0' == wch1)
+                break;
         }
-        WHILE_FALSE_END;
-
-        // Cleanup
-        Platform_MemoryFree((void**)&wszString1ToUpper);
-        Platform_MemoryFree((void**)&wszString2ToUpper);
     }
+    else
+        // Compare original strings
+        nReturn = (int)StrnCmp(PwszString1, PwszString2, PunCount);
 
     return nReturn;
 }
@@ -857,6 +997,117 @@ Platform_GetTime(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Reads a value from the non-volatile platform storage
+ *  @details    The value survives a platform reset. On UEFI it is stored in a non-volatile variable of the driver.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Receives the value.
+ *  @param      PpunDataSize            In: size of PrgbData in bytes, out: size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_FOUND          The value does not exist.
+ *  @retval     RC_E_BUFFER_TOO_SMALL   PrgbData is too small for the value.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreRead(
+    _In_z_                          const wchar_t*  PwszName,
+    _Out_bytecap_(*PpunDataSize)    void*           PrgbData,
+    _Inout_                         unsigned int*   PpunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+        UINTN unDataSize = 0;
+
+        // Check parameters
+        if (NULL == PwszName || NULL == PrgbData || NULL == PpunDataSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unDataSize = *PpunDataSize;
+        efiStatus = gRT->GetVariable((CHAR16*)PwszName, &s_sNvStoreGuid, NULL, &unDataSize, PrgbData);
+        if (EFI_NOT_FOUND == efiStatus)
+        {
+            unReturnValue = RC_E_NOT_FOUND;
+            break;
+        }
+        if (EFI_BUFFER_TOO_SMALL == efiStatus)
+        {
+            *PpunDataSize = (unsigned int)unDataSize;
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            break;
+        }
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        *PpunDataSize = (unsigned int)unDataSize;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Writes a value to the non-volatile platform storage
+ *  @details    The value survives a platform reset. On UEFI it is stored in a non-volatile variable of the driver.
+ *              A size of zero deletes the value.
+ *
+ *  @param      PwszName                Name of the value.
+ *  @param      PrgbData                Value to write, may be NULL if PunDataSize is zero.
+ *  @param      PunDataSize             Size of the value in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully. Deleting a value which does not exist succeeds as well.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL               An unexpected error occurred. Returned from the system call.
+ */
+_Check_return_
+unsigned int
+Platform_NvStoreWrite(
+    _In_z_                          const wchar_t*  PwszName,
+    _In_bytecount_(PunDataSize)     const void*     PrgbData,
+    _In_                            unsigned int    PunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+
+        // Check parameters
+        if (NULL == PwszName || (NULL == PrgbData && 0 != PunDataSize))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        efiStatus = gRT->SetVariable(
+                        (CHAR16*)PwszName,
+                        &s_sNvStoreGuid,
+                        EFI_VARIABLE_NON_VOLATILE | EFI_VARIABLE_BOOTSERVICE_ACCESS,
+                        PunDataSize,
+                        (void*)PrgbData);
+        // Deleting a value which does not exist is not an error
+        if (EFI_NOT_FOUND == efiStatus && 0 == PunDataSize)
+            efiStatus = EFI_SUCCESS;
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      Sleeps the given time in milliseconds
  *  @details
@@ -870,9 +1121,60 @@ Platform_Sleep(
     Platform_SleepMicroSeconds(1000 * PunSleepTime);
 }
 
+/**
+ *  @brief      Waits for a timer event
+ *  @details    Lets other timer callbacks (e.g. progress display, watchdog and console) run and the CPU idle during the wait.
+ *              Only possible at TPL_APPLICATION since WaitForEvent is not allowed at a higher TPL.
+ *
+ *  @param      PunSleepTime    Time to wait in microseconds.
+ *
+ *  @retval     TRUE            The timer event was signaled.
+ *  @retval     FALSE           A timer event cannot be waited for, the caller has to stall.
+ */
+static
+BOOL
+Platform_WaitForTimer(
+    _In_ unsigned int PunSleepTime)
+{
+    BOOL fWaited = FALSE;
+    EFI_EVENT hTimerEvent = NULL;
+
+    do
+    {
+        EFI_TPL tplCurrent = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+        UINTN unIndex = 0;
+        gBS->RestoreTPL(tplCurrent);
+        if (TPL_APPLICATION != tplCurrent)
+            break;
+
+        if (EFI_ERROR(gBS->CreateEvent(EVT_TIMER, TPL_APPLICATION, NULL, NULL, &hTimerEvent)))
+        {
+            hTimerEvent = NULL;
+            break;
+        }
+
+        // The trigger time is given in units of 100ns
+        if (EFI_ERROR(gBS->SetTimer(hTimerEvent, TimerRelative, MultU64x32(PunSleepTime, 10))))
+            break;
+
+        if (EFI_ERROR(gBS->WaitForEvent(1, &hTimerEvent, &unIndex)))
+            break;
+
+        fWaited = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != hTimerEvent)
+        gBS->CloseEvent(hTimerEvent);
+
+    return fWaited;
+}
+
 /**
  *  @brief      Sleeps the given time in microseconds.
- *  @details
+ *  @details    Sleep times of at least PLATFORM_TIMER_WAIT_MIN_US wait for a timer event if possible, so the CPU is not kept
+ *              busy. Since the timer fires with the granularity of the system timer, the remaining time is stalled. Shorter
+ *              sleep times are stalled.
  *
  *  @param      PunSleepTime    Time to sleep in microseconds.
  */
@@ -881,8 +1183,269 @@ Platform_SleepMicroSeconds(
     _In_ unsigned int PunSleepTime)
 {
     // Check global pointer
+    if (NULL == gBS)
+        return;
+
+    if (PunSleepTime >= PLATFORM_TIMER_WAIT_MIN_US)
+    {
+        unsigned long long ullStartTicks = Platform_GetTicks();
+        if (Platform_WaitForTimer(PunSleepTime))
+        {
+            unsigned long long ullElapsedUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+            if (ullElapsedUs >= PunSleepTime)
+                return;
+            PunSleepTime -= (unsigned int)ullElapsedUs;
+        }
+    }
+
+    gBS->Stall(PunSleepTime);
+}
+
+/**
+ *  @brief      Returns the current value of the monotonic tick counter
+ *  @details    The tick counter is based on the platform performance counter. Counter rollovers are accounted for
+ *              as long as the function is called at least once per rollover period of the counter.
+ *
+ *  @returns    Tick count since the first call of the function.
+ */
+_Check_return_
+unsigned long long
+Platform_GetTicks()
+{
+    UINT64 ullStartValue = 0;
+    UINT64 ullEndValue = 0;
+    UINT64 ullCounter = GetPerformanceCounter();
+
+    // The counter may count up or down and may roll over before reaching 2^64
+    GetPerformanceCounterProperties(&ullStartValue, &ullEndValue);
+    if (!s_fTicksStarted)
+    {
+        s_ullLastCounter = ullCounter;
+        s_fTicksStarted = TRUE;
+    }
+
+    if (ullEndValue >= ullStartValue)
+    {
+        if (ullCounter >= s_ullLastCounter)
+            s_ullTicks += ullCounter - s_ullLastCounter;
+        else
+            s_ullTicks += (ullEndValue - s_ullLastCounter) + (ullCounter - ullStartValue) + 1;
+    }
+    else
+    {
+        if (ullCounter <= s_ullLastCounter)
+            s_ullTicks += s_ullLastCounter - ullCounter;
+        else
+            s_ullTicks += (s_ullLastCounter - ullEndValue) + (ullStartValue - ullCounter) + 1;
+    }
+    s_ullLastCounter = ullCounter;
+
+    return s_ullTicks;
+}
+
+/**
+ *  @brief      Converts a number of ticks to microseconds
+ *  @details    Use this function to convert the difference of two Platform_GetTicks values.
+ *
+ *  @param      PullTicks       Number of ticks.
+ *  @returns    Duration in microseconds or 0 if the platform does not provide a performance counter.
+ */
+_Check_return_
+unsigned long long
+Platform_TicksToMicroseconds(
+    _In_ unsigned long long PullTicks)
+{
+    return GetTimeInNanoSecond(PullTicks) / 1000;
+}
+
+/**
+ *  @brief      Entry point of the task on the application processor
+ *  @details
+ *
+ *  @param      PpvBuffer       Not used.
+ */
+static
+VOID
+EFIAPI
+Platform_TaskEntry(
+    _Inout_ VOID* PpvBuffer)
+{
+    UNREFERENCED_PARAMETER(PpvBuffer);
+    s_pfnTaskProcedure(s_pvTaskContext);
+}
+
+/**
+ *  @brief      Starts a procedure on another processor
+ *  @details    On UEFI the procedure is dispatched to an idle application processor through the MP services protocol.
+ *              Only one task can run at a time and it must be joined with Platform_TaskWait. In case the function
+ *              fails the caller runs the procedure itself.
+ *
+ *  @param      PfnProcedure            Procedure to run.
+ *  @param      PpvContext              Context passed to the procedure.
+ *
+ *  @retval     RC_SUCCESS              The procedure has been started.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          Another task is running.
+ *  @retval     RC_E_NOT_FOUND          No processor is available to run the procedure.
+ */
+_Check_return_
+unsigned int
+Platform_TaskStart(
+    _In_    PFN_PLATFORM_TASK_PROCEDURE PfnProcedure,
+    _Inout_ void*                       PpvContext)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        EFI_STATUS efiStatus = EFI_NOT_FOUND;
+        EFI_MP_SERVICES_PROTOCOL* pMpServices = NULL;
+        UINTN ullProcessorNumber = 0;
+        UINTN ullNumberOfProcessors = 0;
+        UINTN ullNumberOfEnabledProcessors = 0;
+        UINTN ullBsp = 0;
+
+        // Check parameters
+        if (NULL == PfnProcedure)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (NULL != s_hTaskEvent)
+        {
+            unReturnValue = RC_E_NOT_READY;
+            break;
+        }
+
+        unReturnValue = RC_E_NOT_FOUND;
+        if (NULL == gBS)
+            break;
+
+        // The MP services protocol is not available on all platforms
+        efiStatus = gBS->LocateProtocol(&gEfiMpServiceProtocolGuid, NULL, (VOID**)&pMpServices);
+        if (EFI_ERROR(efiStatus) || NULL == pMpServices)
+            break;
+        efiStatus = pMpServices->GetNumberOfProcessors(pMpServices, &ullNumberOfProcessors, &ullNumberOfEnabledProcessors);
+        if (EFI_ERROR(efiStatus) || ullNumberOfEnabledProcessors < 2)
+            break;
+        efiStatus = pMpServices->WhoAmI(pMpServices, &ullBsp);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        // The event is signaled by the MP services protocol once the procedure returns
+        efiStatus = gBS->CreateEvent(0, TPL_CALLBACK, NULL, NULL, &s_hTaskEvent);
+        if (EFI_ERROR(efiStatus))
+        {
+            s_hTaskEvent = NULL;
+            break;
+        }
+
+        s_pfnTaskProcedure = PfnProcedure;
+        s_pvTaskContext = PpvContext;
+
+        // Use the first enabled and healthy application processor which is idle
+        efiStatus = EFI_NOT_FOUND;
+        for (ullProcessorNumber = 0; ullProcessorNumber < ullNumberOfProcessors; ullProcessorNumber++)
+        {
+            EFI_PROCESSOR_INFORMATION sProcessorInfo;
+            SetMem(&sProcessorInfo, sizeof(sProcessorInfo), 0);
+
+            if (ullProcessorNumber == ullBsp)
+                continue;
+            if (EFI_ERROR(pMpServices->GetProcessorInfo(pMpServices, ullProcessorNumber, &sProcessorInfo)))
+                continue;
+            if ((sProcessorInfo.StatusFlag & (PROCESSOR_ENABLED_BIT | PROCESSOR_HEALTH_STATUS_BIT)) != (PROCESSOR_ENABLED_BIT | PROCESSOR_HEALTH_STATUS_BIT))
+                continue;
+
+            efiStatus = pMpServices->StartupThisAP(pMpServices, Platform_TaskEntry, ullProcessorNumber, s_hTaskEvent, 0, NULL, NULL);
+            if (!EFI_ERROR(efiStatus))
+                break;
+        }
+        if (EFI_ERROR(efiStatus))
+        {
+            gBS->CloseEvent(s_hTaskEvent);
+            s_hTaskEvent = NULL;
+            break;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Waits until the procedure started by Platform_TaskStart has finished
+ *  @details    Returns immediately if no task is running.
+ */
+void
+Platform_TaskWait()
+{
+    if (NULL == s_hTaskEvent)
+        return;
+
+    // The event must not be closed before the MP services protocol has signaled it
+    while (EFI_NOT_READY == gBS->CheckEvent(s_hTaskEvent))
+        gBS->Stall(PLATFORM_TASK_POLL_INTERVAL);
+
+    gBS->CloseEvent(s_hTaskEvent);
+    s_hTaskEvent = NULL;
+    s_pfnTaskProcedure = NULL;
+    s_pvTaskContext = NULL;
+}
+
+/**
+ *  @brief      Enters a section protected against concurrent callers
+ *  @details    The TPL is raised to TPL_NOTIFY, so timer and event callbacks cannot interrupt the section. The section
+ *              must be short and must not wait for the TPM. Sections must not be nested.
+ *
+ *  @returns    State to be passed to Platform_LeaveCriticalSection.
+ */
+_Check_return_
+unsigned long long
+Platform_EnterCriticalSection()
+{
+    if (NULL == gBS)
+        return TPL_APPLICATION;
+
+    return gBS->RaiseTPL(TPL_NOTIFY);
+}
+
+/**
+ *  @brief      Leaves a section entered with Platform_EnterCriticalSection
+ *  @details
+ *
+ *  @param      PullState       State returned by Platform_EnterCriticalSection.
+ */
+void
+Platform_LeaveCriticalSection(
+    _In_ unsigned long long PullState)
+{
+    if (NULL != gBS)
+        gBS->RestoreTPL((EFI_TPL)PullState);
+}
+
+/**
+ *  @brief      Returns the execution level of the caller
+ *  @details    The execution level is the current TPL. A caller on a higher TPL may have interrupted a caller on a lower
+ *              TPL, callers on the same TPL cannot interrupt each other.
+ *
+ *  @returns    Execution level of the caller.
+ */
+_Check_return_
+unsigned int
+Platform_GetExecutionLevel()
+{
+    EFI_TPL tplCurrent = TPL_APPLICATION;
+
     if (NULL != gBS)
-        gBS->Stall(PunSleepTime);
+    {
+        tplCurrent = gBS->RaiseTPL(TPL_HIGH_LEVEL);
+        gBS->RestoreTPL(tplCurrent);
+    }
+
+    return (unsigned int)tplCurrent;
 }
 
 /**
@@ -915,7 +1478,7 @@ Platform_SwapBytes32(
 
 /**
  *  @brief      Unmarshal a Unicode string (16bit per character) to the target platform
- *  @details
+ *  @details    The string is decoded from little endian code units in a single pass. PrgbBuffer needs no 16bit alignment.
  *
  *  @param      PrgbBuffer              Binary buffer.
  *  @param      PunBufferLen            Length of binary buffer.
@@ -926,7 +1489,6 @@ Platform_SwapBytes32(
  *  @retval     RC_SUCCESS              The operation completed successfully.
  *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
  *  @retval     RC_E_BUFFER_TOO_SMALL   The buffer in PwszTargetString is too small to hold the contents of the binary buffer.
- *  @retval     RC_E_FAIL               An internal error occurred. Either there was not enough memory to create a temporary copy of PrgbBuffer or StrnCpyS failed.
  */
 _Check_return_
 unsigned int
@@ -937,10 +1499,12 @@ Platform_UnmarshalString(
     _Inout_                                 unsigned int*   PpunTargetStringLen)
 {
     unsigned int unReturnValue = RC_E_FAIL;
-    wchar_t* pwszTempBuffer = NULL;
 
     do
     {
+        const BYTE* pbBuffer = (const BYTE*)PrgbBuffer;
+        unsigned int unLength = 0;
+
         // Check parameters
         if (NULL == PrgbBuffer || 0 == PunBufferLen || NULL == PwszTargetString || 0 == PpunTargetStringLen || 0 == *PpunTargetStringLen)
         {
@@ -962,41 +1526,24 @@ Platform_UnmarshalString(
             break;
         }
 
-        // Memory for Strn* APIs must be aligned to 16bit boundaries. Copy the buffer to aligned memory first.
-        pwszTempBuffer = AllocateZeroPool(PunBufferLen);
-        if (NULL == pwszTempBuffer)
-        {
-            unReturnValue = RC_E_FAIL;
-            break;
-        }
-        CopyMem(pwszTempBuffer, PrgbBuffer, PunBufferLen);
-
+        // Decode the little endian code units byte-wise, so the buffer needs no 16bit alignment.
+        // The string is truncated if it is not null-terminated.
+        for (unLength = 0; unLength < PunBufferLen / 2; unLength++)
         {
-            // Get string length of the buffer, truncate if it is not null-terminated.
-            RETURN_STATUS status;
-            UINTN ullBuffer = StrnLenS(pwszTempBuffer, PunBufferLen / 2);
-
-            // Copy the string.
-            status = StrnCpyS(PwszTargetString, *PpunTargetStringLen, pwszTempBuffer, ullBuffer);
-            if (RETURN_SUCCESS != status)
-            {
-                unReturnValue = RC_E_FAIL;
+            wchar_t wcCodeUnit = (wchar_t)(pbBuffer[2 * unLength] | (pbBuffer[2 * unLength + 1] << 8));
+            if (L'\0' == wcCodeUnit)
                 break;
-            }
-
-            // Update the string length.
-            *PpunTargetStringLen = (unsigned int)ullBuffer;
+            PwszTargetString[unLength] = wcCodeUnit;
         }
+        PwszTargetString[unLength] = L'\0';
+
+        // Update the string length.
+        *PpunTargetStringLen = unLength;
 
         unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
 
-    if (pwszTempBuffer != NULL)
-    {
-        FreePool(pwszTempBuffer);
-    }
-
     if (RC_SUCCESS != unReturnValue)
     {
         // Reset out parameter
@@ -22,23 +22,275 @@ IfxPropertyElement* s_pvHead = NULL;
 /// Pointer to the last element in the list
 IfxPropertyElement* s_pvTail = NULL;
 
+/// Initial number of slots of the hash index (power of two)
+#define PROPERTY_STORAGE_INDEX_INITIAL_CAPACITY 64
+
+/// Open-addressed hash index over the elements in the list (NULL if not allocated)
+static IfxPropertyElement** s_ppIndex = NULL;
+
+/// Number of slots of the hash index (power of two)
+static unsigned int s_unIndexCapacity = 0;
+
+/// Number of elements in the list
+static unsigned int s_unElementCount = 0;
+
+/// Table of default values consulted for keys without an element (NULL if not registered)
+static const IfxPropertyDefault* s_prgsDefaults = NULL;
+
+/// Number of entries in s_prgsDefaults
+static unsigned int s_unDefaultCount = 0;
+
+/// Number of changes of the elements or defaults (see PropertyStorage_GetChangeCount)
+static unsigned int s_unChangeCount = 0;
+
 /**
- *  @brief      Add a key value pair to the PropertyStorage
- *  @details    Operation fails in case an element with same key already exists.
+ *  @brief      Calculates the hash value of a key
+ *  @details    Local helper method implementing the 32-bit FNV-1a hash over the wide characters of the key.
+ *
+ *  @param      PwszKey         Key identifier, null-terminated wide char array; max length PROPERTY_STORAGE_MAX_KEY
+ *
+ *  @returns    The hash value of the key
+ */
+static
+unsigned int
+PropertyStorage_HashKey(
+    _In_z_ const wchar_t* PwszKey)
+{
+    unsigned int unHash = 2166136261U;
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; unIndex < PROPERTY_STORAGE_MAX_KEY && L'\0' != PwszKey[unIndex]; unIndex++)
+    {
+        unHash ^= (unsigned int)PwszKey[unIndex];
+        unHash *= 16777619U;
+    }
+
+    return unHash;
+}
+
+/**
+ *  @brief      Inserts an element into the hash index
+ *  @details    Local helper method using linear probing. The hash index must contain at least one free slot.
+ *
+ *  @param      PpElement       Element to insert.
+ */
+static
+void
+PropertyStorage_IndexInsert(
+    _In_ IfxPropertyElement* PpElement)
+{
+    unsigned int unSlot = PpElement->unKeyHash & (s_unIndexCapacity - 1);
+
+    while (NULL != s_ppIndex[unSlot])
+        unSlot = (unSlot + 1) & (s_unIndexCapacity - 1);
+
+    s_ppIndex[unSlot] = PpElement;
+}
+
+/**
+ *  @brief      Rebuilds the hash index from the list
+ *  @details    Local helper method. The capacity is doubled until the hash index is filled to at most three quarters.
+ *              If the memory allocation fails, the lookups fall back to a linear search of the list.
+ *
+ *  @param      PunCapacity     Minimum number of slots of the hash index (power of two).
+ */
+static
+void
+PropertyStorage_IndexRebuild(
+    _In_ unsigned int PunCapacity)
+{
+    IfxPropertyElement* pIteratorElement = s_pvHead;
+    unsigned int unCapacity = PunCapacity;
+
+    if (PROPERTY_STORAGE_INDEX_INITIAL_CAPACITY > unCapacity)
+        unCapacity = PROPERTY_STORAGE_INDEX_INITIAL_CAPACITY;
+    while (s_unElementCount * 4 > unCapacity * 3)
+        unCapacity *= 2;
+
+    Platform_MemoryFree((void**)&s_ppIndex);
+    s_unIndexCapacity = 0;
+
+    s_ppIndex = (IfxPropertyElement**)Platform_ArenaAllocateZero(unCapacity * sizeof(IfxPropertyElement*));
+    if (NULL != s_ppIndex)
+    {
+        s_unIndexCapacity = unCapacity;
+        while (NULL != pIteratorElement)
+        {
+            PropertyStorage_IndexInsert(pIteratorElement);
+            pIteratorElement = pIteratorElement->pvNextElement;
+        }
+    }
+}
+
+/**
+ *  @brief      Set the string value of an element
+ *  @details    Local helper method. The string is copied to a buffer of the required size and the typed values of
+ *              the element are invalidated.
+ *
+ *  @param      PpElement       Element to be changed.
+ *  @param      PwszValue       Pointer to a wide char array containing the new value\n
+ *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_VALUE
+ *
+ *  @retval     TRUE        If the element value has been set.
+ *  @retval     FALSE       If the element value could not be set.
+ */
+static
+BOOL
+PropertyStorage_SetElementString(
+    _Inout_ IfxPropertyElement* PpElement,
+    _In_z_  const wchar_t*      PwszValue)
+{
+    BOOL fReturnValue = FALSE;
+    wchar_t* pwszValue = NULL;
+
+    do
+    {
+        unsigned int unLength = 0;
+
+        // Check length of value
+        if (NULL == PwszValue ||
+                RC_SUCCESS != Platform_StringGetLength(PwszValue, PROPERTY_STORAGE_MAX_VALUE, &unLength))
+            break;
+
+        // Copy value to a new buffer
+        pwszValue = (wchar_t*)Platform_ArenaAllocateZero((unLength + 1) * sizeof(wchar_t));
+        if (NULL == pwszValue)
+            break;
+
+        unLength++;
+        if (RC_SUCCESS != Platform_StringCopy(pwszValue, &unLength, PwszValue))
+            break;
+
+        // Replace the value of the element
+        Platform_MemoryFree((void**)&PpElement->pwszValue);
+        PpElement->pwszValue = pwszValue;
+        PpElement->unValueType = PROPERTY_STORAGE_TYPE_STRING;
+        PpElement->unTypedValues = 0;
+        s_unChangeCount++;
+
+        fReturnValue = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    // Cleanup in case of error
+    if (!fReturnValue)
+        Platform_MemoryFree((void**)&pwszValue);
+
+    return fReturnValue;
+}
+
+/**
+ *  @brief      Set the typed value of an element
+ *  @details    Local helper method. The value is held in binary form, the string form is generated on first use.
+ *
+ *  @param      PpElement       Element to be changed.
+ *  @param      PunValueType    Type of the value (PROPERTY_STORAGE_TYPE_BOOLEAN, _UINTEGER or _ULONGLONG).
+ *  @param      PullValue       Value; a BOOL or unsigned integer value is passed widened to unsigned long long.
+ */
+static
+void
+PropertyStorage_SetElementTypedValue(
+    _Inout_ IfxPropertyElement* PpElement,
+    _In_    unsigned int        PunValueType,
+    _In_    unsigned long long  PullValue)
+{
+    // Discard the string form of the previous value
+    Platform_MemoryFree((void**)&PpElement->pwszValue);
+    PpElement->unValueType = PunValueType;
+    s_unChangeCount++;
+
+    switch (PunValueType)
+    {
+        case PROPERTY_STORAGE_TYPE_BOOLEAN:
+            PpElement->fValue = (0 != PullValue) ? TRUE : FALSE;
+            PpElement->unTypedValues = PROPERTY_STORAGE_TYPED_BOOLEAN;
+            break;
+        case PROPERTY_STORAGE_TYPE_UINTEGER:
+            PpElement->unValue = (unsigned int)PullValue;
+            PpElement->ullValue = (unsigned int)PullValue;
+            PpElement->unTypedValues = PROPERTY_STORAGE_TYPED_UINTEGER | PROPERTY_STORAGE_TYPED_ULONGLONG;
+            break;
+        default:
+            PpElement->unValueType = PROPERTY_STORAGE_TYPE_ULONGLONG;
+            PpElement->ullValue = PullValue;
+            PpElement->unTypedValues = PROPERTY_STORAGE_TYPED_ULONGLONG;
+            break;
+    }
+}
+
+/**
+ *  @brief      Get the string value of an element
+ *  @details    Local helper method. The string form of a typed value is generated on first use and kept until the
+ *              value changes.
+ *
+ *  @param      PpElement       Element to get the string value from.
+ *
+ *  @returns    The string value of the element, NULL if the string form could not be generated
+ */
+static
+const wchar_t*
+PropertyStorage_GetElementString(
+    _Inout_ IfxPropertyElement* PpElement)
+{
+    do
+    {
+        wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
+        unsigned int unValueSize = RG_LEN(wszValue);
+        unsigned int unReturnValue = RC_E_FAIL;
+
+        if (NULL != PpElement->pwszValue)
+            break;
+
+        IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
+
+        // Generate the string form of the typed value
+        switch (PpElement->unValueType)
+        {
+            case PROPERTY_STORAGE_TYPE_BOOLEAN:
+                unReturnValue = Platform_StringCopy(wszValue, &unValueSize, PpElement->fValue ? L"TRUE" : L"FALSE");
+                break;
+            case PROPERTY_STORAGE_TYPE_UINTEGER:
+                unReturnValue = Utility_UInteger2String(PpElement->unValue, wszValue, &unValueSize);
+                break;
+            case PROPERTY_STORAGE_TYPE_ULONGLONG:
+                unReturnValue = Utility_ULongLong2String(PpElement->ullValue, wszValue, &unValueSize);
+                break;
+            default:
+                break;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // Keep the string form
+        PpElement->pwszValue = (wchar_t*)Platform_ArenaAllocateZero((unValueSize + 1) * sizeof(wchar_t));
+        if (NULL == PpElement->pwszValue)
+            break;
+
+        unValueSize++;
+        if (RC_SUCCESS != Platform_StringCopy(PpElement->pwszValue, &unValueSize, wszValue))
+            Platform_MemoryFree((void**)&PpElement->pwszValue);
+    }
+    WHILE_FALSE_END;
+
+    return PpElement->pwszValue;
+}
+
+/**
+ *  @brief      Add an element with the given key to the PropertyStorage and return it
+ *  @details    Local helper method. Operation fails in case an element with same key already exists.
  *
  *  @param      PwszKey         Unique key identifier for the PropertyElement to be added\n
  *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_KEY
- *  @param      PwszValue       Pointer to a wide char array containing the value\n
+ *  @param      PwszValue       Pointer to a wide char array containing the value or NULL if the caller sets a typed value\n
  *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_VALUE
  *
- *  @retval     TRUE        If the element has been added.
- *  @retval     FALSE       If the element could not be added, e.g. because element with same key already exists.
+ *  @returns    The added element, NULL if the element could not be added
  */
-_Check_return_
-BOOL
-PropertyStorage_AddKeyValuePair(
-    _In_z_  const wchar_t*  PwszKey,
-    _In_z_  const wchar_t*  PwszValue)
+static
+IfxPropertyElement*
+PropertyStorage_AddElement(
+    _In_z_      const wchar_t*  PwszKey,
+    _In_opt_z_  const wchar_t*  PwszValue)
 {
     BOOL fReturnValue = FALSE;
     IfxPropertyElement* pElement = NULL;
@@ -46,34 +298,35 @@ PropertyStorage_AddKeyValuePair(
     do
     {
         unsigned int unLength = 0;
+        unsigned int unKeyLength = 0;
 
         // Check parameters
-        if (NULL == PwszKey ||
-                NULL == PwszValue)
+        if (NULL == PwszKey)
             break;
 
         // Check length of key and value
-        if (RC_E_BUFFER_TOO_SMALL == Platform_StringGetLength(PwszKey, PROPERTY_STORAGE_MAX_KEY, &unLength) ||
-                RC_E_BUFFER_TOO_SMALL == Platform_StringGetLength(PwszValue, PROPERTY_STORAGE_MAX_VALUE, &unLength))
+        if (RC_E_BUFFER_TOO_SMALL == Platform_StringGetLength(PwszKey, PROPERTY_STORAGE_MAX_KEY, &unKeyLength) ||
+                (NULL != PwszValue && RC_E_BUFFER_TOO_SMALL == Platform_StringGetLength(PwszValue, PROPERTY_STORAGE_MAX_VALUE, &unLength)))
             break;
 
         // Abort if element with same key already exists
         if (PropertyStorage_ExistsElement(PwszKey))
             break;
 
-        // Allocate memory for one property element
-        pElement = (IfxPropertyElement*)Platform_MemoryAllocateZero(sizeof(IfxPropertyElement));
+        // Allocate memory for one property element and its key
+        pElement = (IfxPropertyElement*)Platform_ArenaAllocateZero(sizeof(IfxPropertyElement) + (unKeyLength + 1) * sizeof(wchar_t));
         if (NULL == pElement)
             break;
 
         // Copy key to element
-        unLength = PROPERTY_STORAGE_MAX_KEY;
-        if (RC_SUCCESS != Platform_StringCopy(pElement->wszKey, &unLength, PwszKey))
+        pElement->pwszKey = (wchar_t*)(pElement + 1);
+        unLength = unKeyLength + 1;
+        if (RC_SUCCESS != Platform_StringCopy(pElement->pwszKey, &unLength, PwszKey))
             break;
+        pElement->unKeyHash = PropertyStorage_HashKey(pElement->pwszKey);
 
         // Copy value to element
-        unLength = PROPERTY_STORAGE_MAX_VALUE;
-        if (RC_SUCCESS != Platform_StringCopy(pElement->wszValue, &unLength, PwszValue))
+        if (NULL != PwszValue && !PropertyStorage_SetElementString(pElement, PwszValue))
             break;
 
         // If list is empty, add it to the list
@@ -93,7 +346,15 @@ PropertyStorage_AddKeyValuePair(
             // Update last list element link
             s_pvTail = pElement;
         }
+        s_unElementCount++;
+
+        // Add the element to the hash index, grow the hash index if it is filled to more than three quarters
+        if (NULL == s_ppIndex || s_unElementCount * 4 > s_unIndexCapacity * 3)
+            PropertyStorage_IndexRebuild(s_unIndexCapacity * 2);
+        else
+            PropertyStorage_IndexInsert(pElement);
 
+        s_unChangeCount++;
         fReturnValue = TRUE;
     }
     WHILE_FALSE_END;
@@ -102,6 +363,33 @@ PropertyStorage_AddKeyValuePair(
     if (!fReturnValue)
         Platform_MemoryFree((void**)&pElement);
 
+    return pElement;
+}
+
+/**
+ *  @brief      Add a key value pair to the PropertyStorage
+ *  @details    Operation fails in case an element with same key already exists.
+ *
+ *  @param      PwszKey         Unique key identifier for the PropertyElement to be added\n
+ *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_KEY
+ *  @param      PwszValue       Pointer to a wide char array containing the value\n
+ *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_VALUE
+ *
+ *  @retval     TRUE        If the element has been added.
+ *  @retval     FALSE       If the element could not be added, e.g. because element with same key already exists.
+ */
+_Check_return_
+BOOL
+PropertyStorage_AddKeyValuePair(
+    _In_z_  const wchar_t*  PwszKey,
+    _In_z_  const wchar_t*  PwszValue)
+{
+    BOOL fReturnValue = FALSE;
+
+    // A string value is mandatory here
+    if (NULL != PwszValue)
+        fReturnValue = NULL != PropertyStorage_AddElement(PwszKey, PwszValue);
+
     return fReturnValue;
 }
 
@@ -122,7 +410,16 @@ PropertyStorage_AddKeyBooleanValuePair(
     _In_z_  const wchar_t*  PwszKey,
     _In_    BOOL            PfValue)
 {
-    return PropertyStorage_AddKeyValuePair(PwszKey, PfValue ? L"TRUE" : L"FALSE");
+    BOOL fReturnValue = FALSE;
+    IfxPropertyElement* pElement = PropertyStorage_AddElement(PwszKey, NULL);
+
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_BOOLEAN, PfValue);
+        fReturnValue = TRUE;
+    }
+
+    return fReturnValue;
 }
 
 /**
@@ -143,12 +440,13 @@ PropertyStorage_AddKeyUIntegerValuePair(
     _In_    unsigned int        PunValue)
 {
     BOOL fReturnValue = FALSE;
-    wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
-    unsigned int unValueSize = RG_LEN(wszValue);
-    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
+    IfxPropertyElement* pElement = PropertyStorage_AddElement(PwszKey, NULL);
 
-    if (RC_SUCCESS == Utility_UInteger2String(PunValue, wszValue, &unValueSize))
-        fReturnValue = PropertyStorage_AddKeyValuePair(PwszKey, wszValue);
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_UINTEGER, PunValue);
+        fReturnValue = TRUE;
+    }
 
     return fReturnValue;
 }
@@ -171,19 +469,21 @@ PropertyStorage_AddKeyULongLongValuePair(
     _In_    unsigned long long  PullValue)
 {
     BOOL fReturnValue = FALSE;
-    wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
-    unsigned int unValueSize = RG_LEN(wszValue);
-    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
+    IfxPropertyElement* pElement = PropertyStorage_AddElement(PwszKey, NULL);
 
-    if (RC_SUCCESS == Utility_ULongLong2String(PullValue, wszValue, &unValueSize))
-        fReturnValue = PropertyStorage_AddKeyValuePair(PwszKey, wszValue);
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_ULONGLONG, PullValue);
+        fReturnValue = TRUE;
+    }
 
     return fReturnValue;
 }
 
 /**
  *  @brief      Get an element identified by a key
- *  @details    Local helper method to get the element with the given key.
+ *  @details    Local helper method to get the element with the given key. The hash index is probed if it is allocated,
+ *              otherwise the list is searched.
  *
  *  @param      PwszKey         Key identifier for the PropertyElement to be changed\n
  *                              null-terminated wide char array; max length PROPERTY_STORAGE_MAX_KEY
@@ -200,26 +500,72 @@ PropertyStorage_GetElementByKey(
     // Check parameter
     if (NULL != PwszKey)
     {
-        // Search list for element
-        IfxPropertyElement* pIteratorElement = s_pvHead;
-        while (NULL != pIteratorElement)
+        unsigned int unKeyHash = PropertyStorage_HashKey(PwszKey);
+
+        if (NULL != s_ppIndex)
         {
-            // Check if current element contains the given key
-            if (0 == Platform_StringCompare(PwszKey, pIteratorElement->wszKey, PROPERTY_STORAGE_MAX_KEY, FALSE))
+            // Probe the hash index until the element or a free slot has been found
+            unsigned int unSlot = unKeyHash & (s_unIndexCapacity - 1);
+            while (NULL != s_ppIndex[unSlot])
             {
-                // If yes, return it
-                pReturnElement = pIteratorElement;
-                break;
+                if (unKeyHash == s_ppIndex[unSlot]->unKeyHash &&
+                        0 == Platform_StringCompare(PwszKey, s_ppIndex[unSlot]->pwszKey, PROPERTY_STORAGE_MAX_KEY, FALSE))
+                {
+                    pReturnElement = s_ppIndex[unSlot];
+                    break;
+                }
+
+                unSlot = (unSlot + 1) & (s_unIndexCapacity - 1);
+            }
+        }
+        else
+        {
+            // Search list for element
+            IfxPropertyElement* pIteratorElement = s_pvHead;
+            while (NULL != pIteratorElement)
+            {
+                // Check if current element contains the given key
+                if (unKeyHash == pIteratorElement->unKeyHash &&
+                        0 == Platform_StringCompare(PwszKey, pIteratorElement->pwszKey, PROPERTY_STORAGE_MAX_KEY, FALSE))
+                {
+                    // If yes, return it
+                    pReturnElement = pIteratorElement;
+                    break;
+                }
+
+                // Update iterator
+                pIteratorElement = pIteratorElement->pvNextElement;
             }
-
-            // Update iterator
-            pIteratorElement = pIteratorElement->pvNextElement;
         }
     }
 
     return pReturnElement;
 }
 
+/**
+ *  @brief      Get the default value of a key
+ *  @details    Local helper method to search the registered table of default values.
+ *
+ *  @param      PwszKey         Key identifier, null-terminated wide char array; max length PROPERTY_STORAGE_MAX_KEY
+ *
+ *  @returns    The default value entry if found, NULL otherwise
+ */
+static
+const IfxPropertyDefault*
+PropertyStorage_GetDefaultByKey(
+    _In_z_ const wchar_t* PwszKey)
+{
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; NULL != s_prgsDefaults && unIndex < s_unDefaultCount; unIndex++)
+    {
+        if (0 == Platform_StringCompare(PwszKey, s_prgsDefaults[unIndex].pwszKey, PROPERTY_STORAGE_MAX_KEY, FALSE))
+            return &s_prgsDefaults[unIndex];
+    }
+
+    return NULL;
+}
+
 /**
  *  @brief      Change the value of an element identified by a key
  *  @details
@@ -255,11 +601,7 @@ PropertyStorage_ChangeValueByKey(
             break;
 
         // Change value
-        {
-            unsigned int unValueSize = PROPERTY_STORAGE_MAX_VALUE;
-            if (RC_SUCCESS == Platform_StringCopy(pElement->wszValue, &unValueSize, PwszValue))
-                fReturnValue = TRUE;
-        }
+        fReturnValue = PropertyStorage_SetElementString(pElement, PwszValue);
     }
     WHILE_FALSE_END;
 
@@ -283,7 +625,16 @@ PropertyStorage_ChangeBooleanValueByKey(
     _In_z_  const wchar_t*  PwszKey,
     _In_    BOOL            PfValue)
 {
-    return PropertyStorage_ChangeValueByKey(PwszKey, PfValue ? L"TRUE" : L"FALSE");
+    BOOL fReturnValue = FALSE;
+    IfxPropertyElement* pElement = PropertyStorage_GetElementByKey(PwszKey);
+
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_BOOLEAN, PfValue);
+        fReturnValue = TRUE;
+    }
+
+    return fReturnValue;
 }
 
 /**
@@ -304,12 +655,13 @@ PropertyStorage_ChangeUIntegerValueByKey(
     _In_    unsigned int        PunValue)
 {
     BOOL fReturnValue = FALSE;
-    wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
-    unsigned int unValueSize = RG_LEN(wszValue);
-    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
+    IfxPropertyElement* pElement = PropertyStorage_GetElementByKey(PwszKey);
 
-    if (RC_SUCCESS == Utility_UInteger2String(PunValue, wszValue, &unValueSize))
-        fReturnValue = PropertyStorage_ChangeValueByKey(PwszKey, wszValue);
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_UINTEGER, PunValue);
+        fReturnValue = TRUE;
+    }
 
     return fReturnValue;
 }
@@ -332,12 +684,13 @@ PropertyStorage_ChangeULongLongValueByKey(
     _In_    unsigned long long  PullValue)
 {
     BOOL fReturnValue = FALSE;
-    wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
-    unsigned int unValueSize = RG_LEN(wszValue);
-    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
+    IfxPropertyElement* pElement = PropertyStorage_GetElementByKey(PwszKey);
 
-    if (RC_SUCCESS == Utility_ULongLong2String(PullValue, wszValue, &unValueSize))
-        fReturnValue = PropertyStorage_ChangeValueByKey(PwszKey, wszValue);
+    if (NULL != pElement)
+    {
+        PropertyStorage_SetElementTypedValue(pElement, PROPERTY_STORAGE_TYPE_ULONGLONG, PullValue);
+        fReturnValue = TRUE;
+    }
 
     return fReturnValue;
 }
@@ -367,6 +720,7 @@ PropertyStorage_GetValueByKey(
     do
     {
         IfxPropertyElement* pElement = NULL;
+        const wchar_t* pwszValue = NULL;
 
         // Check parameters
         if (NULL == PwszKey ||
@@ -381,7 +735,11 @@ PropertyStorage_GetValueByKey(
             break;
 
         // Get value
-        if (RC_SUCCESS == Platform_StringCopy(PwszValue, PpunValueSize, pElement->wszValue))
+        pwszValue = PropertyStorage_GetElementString(pElement);
+        if (NULL == pwszValue)
+            break;
+
+        if (RC_SUCCESS == Platform_StringCopy(PwszValue, PpunValueSize, pwszValue))
             fReturnValue = TRUE;
     }
     WHILE_FALSE_END;
@@ -448,7 +806,7 @@ PropertyStorage_FindKey(
         {
             // Check if current element contains the given key
             wchar_t* pwszKey = NULL;
-            if (0 == Platform_FindString(PwszSearch, pElement->wszKey, &pwszKey) && pwszKey)
+            if (0 == Platform_FindString(PwszSearch, pElement->pwszKey, &pwszKey) && pwszKey)
             {
                 // Copy key value
                 if (RC_SUCCESS == Platform_StringCopy(PwszKey, PpunKeySize, pwszKey))
@@ -496,6 +854,8 @@ PropertyStorage_GetBooleanValueByKey(
 
     do
     {
+        IfxPropertyElement* pElement = NULL;
+        const wchar_t* pwszElementValue = NULL;
         wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
         unsigned int unValueSize = RG_LEN(wszValue);
         IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
@@ -507,7 +867,29 @@ PropertyStorage_GetBooleanValueByKey(
 
         *PpfValue = FALSE;
 
-        if (FALSE == PropertyStorage_GetValueByKey(PwszKey, wszValue, &unValueSize))
+        pElement = PropertyStorage_GetElementByKey(PwszKey);
+        if (NULL == pElement)
+        {
+            // Use the default value if one is registered
+            const IfxPropertyDefault* psDefault = PropertyStorage_GetDefaultByKey(PwszKey);
+            if (NULL != psDefault && PROPERTY_STORAGE_TYPE_BOOLEAN == psDefault->unValueType)
+            {
+                *PpfValue = (0 != psDefault->ullValue);
+                fReturnValue = TRUE;
+            }
+            break;
+        }
+
+        // Use the typed value if available
+        if (0 != (pElement->unTypedValues & PROPERTY_STORAGE_TYPED_BOOLEAN))
+        {
+            *PpfValue = pElement->fValue;
+            fReturnValue = TRUE;
+            break;
+        }
+
+        pwszElementValue = PropertyStorage_GetElementString(pElement);
+        if (NULL == pwszElementValue || RC_SUCCESS != Platform_StringCopy(wszValue, &unValueSize, pwszElementValue))
             break;
 
         // Increment size by one due to null-termination
@@ -525,6 +907,13 @@ PropertyStorage_GetBooleanValueByKey(
             *PpfValue = FALSE;
             fReturnValue = TRUE;
         }
+
+        // Store the typed value for subsequent calls
+        if (fReturnValue)
+        {
+            pElement->fValue = *PpfValue;
+            pElement->unTypedValues |= PROPERTY_STORAGE_TYPED_BOOLEAN;
+        }
     }
     WHILE_FALSE_END;
 
@@ -552,6 +941,8 @@ PropertyStorage_GetUIntegerValueByKey(
 
     do
     {
+        IfxPropertyElement* pElement = NULL;
+        const wchar_t* pwszElementValue = NULL;
         wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
         unsigned int unValueSize = RG_LEN(wszValue);
         int nIndex = -1;
@@ -562,7 +953,29 @@ PropertyStorage_GetUIntegerValueByKey(
                 NULL == PpunValue)
             break;
 
-        if (FALSE == PropertyStorage_GetValueByKey(PwszKey, wszValue, &unValueSize))
+        pElement = PropertyStorage_GetElementByKey(PwszKey);
+        if (NULL == pElement)
+        {
+            // Use the default value if one is registered and fits
+            const IfxPropertyDefault* psDefault = PropertyStorage_GetDefaultByKey(PwszKey);
+            if (NULL != psDefault && PROPERTY_STORAGE_TYPE_BOOLEAN != psDefault->unValueType && psDefault->ullValue <= UINT_MAX)
+            {
+                *PpunValue = (unsigned int)psDefault->ullValue;
+                fReturnValue = TRUE;
+            }
+            break;
+        }
+
+        // Use the typed value if available
+        if (0 != (pElement->unTypedValues & PROPERTY_STORAGE_TYPED_UINTEGER))
+        {
+            *PpunValue = pElement->unValue;
+            fReturnValue = TRUE;
+            break;
+        }
+
+        pwszElementValue = PropertyStorage_GetElementString(pElement);
+        if (NULL == pwszElementValue || RC_SUCCESS != Platform_StringCopy(wszValue, &unValueSize, pwszElementValue))
             break;
 
         // Increment size by one due to null-termination
@@ -585,6 +998,13 @@ PropertyStorage_GetUIntegerValueByKey(
                     fReturnValue = TRUE;
             }
         }
+
+        // Store the typed value for subsequent calls
+        if (fReturnValue)
+        {
+            pElement->unValue = *PpunValue;
+            pElement->unTypedValues |= PROPERTY_STORAGE_TYPED_UINTEGER;
+        }
     }
     WHILE_FALSE_END;
 
@@ -617,6 +1037,8 @@ PropertyStorage_GetULongLongValueByKey(
 
     do
     {
+        IfxPropertyElement* pElement = NULL;
+        const wchar_t* pwszElementValue = NULL;
         wchar_t wszValue[PROPERTY_STORAGE_MAX_VALUE];
         unsigned int unValueSize = RG_LEN(wszValue);
         IGNORE_RETURN_VALUE(Platform_StringSetZero(wszValue, RG_LEN(wszValue)));
@@ -625,7 +1047,29 @@ PropertyStorage_GetULongLongValueByKey(
         if (NULL == PwszKey || NULL == PpullValue)
             break;
 
-        if (FALSE == PropertyStorage_GetValueByKey(PwszKey, wszValue, &unValueSize))
+        pElement = PropertyStorage_GetElementByKey(PwszKey);
+        if (NULL == pElement)
+        {
+            // Use the default value if one is registered
+            const IfxPropertyDefault* psDefault = PropertyStorage_GetDefaultByKey(PwszKey);
+            if (NULL != psDefault && PROPERTY_STORAGE_TYPE_BOOLEAN != psDefault->unValueType)
+            {
+                *PpullValue = psDefault->ullValue;
+                fReturnValue = TRUE;
+            }
+            break;
+        }
+
+        // Use the typed value if available
+        if (0 != (pElement->unTypedValues & PROPERTY_STORAGE_TYPED_ULONGLONG))
+        {
+            *PpullValue = pElement->ullValue;
+            fReturnValue = TRUE;
+            break;
+        }
+
+        pwszElementValue = PropertyStorage_GetElementString(pElement);
+        if (NULL == pwszElementValue || RC_SUCCESS != Platform_StringCopy(wszValue, &unValueSize, pwszElementValue))
             break;
 
         // Increment size by one due to null-termination
@@ -634,7 +1078,12 @@ PropertyStorage_GetULongLongValueByKey(
 
         // Convert String to Integer
         if (RC_SUCCESS == Utility_StringParseULongLong(wszValue, unValueSize, PpullValue))
+        {
+            // Store the typed value for subsequent calls
+            pElement->ullValue = *PpullValue;
+            pElement->unTypedValues |= PROPERTY_STORAGE_TYPED_ULONGLONG;
             fReturnValue = TRUE;
+        }
     }
     WHILE_FALSE_END;
 
@@ -823,8 +1272,14 @@ PropertyStorage_RemoveElement(
                 s_pvTail = pPrev;
 
             // Free memory of element to be removed
+            Platform_MemoryFree((void**)&pElement->pwszValue);
             Platform_MemoryFree((void**)&pElement);
+            s_unElementCount--;
+
+            // Rebuild the hash index without the removed element
+            PropertyStorage_IndexRebuild(s_unIndexCapacity);
 
+            s_unChangeCount++;
             fReturnValue = TRUE;
         }
     }
@@ -853,10 +1308,48 @@ PropertyStorage_ClearElements()
         pIteratorElement = pIteratorElement->pvNextElement;
 
         // Free memory of current element
+        Platform_MemoryFree((void**)&pElement->pwszValue);
         Platform_MemoryFree((void**)&pElement);
     }
 
     // Clear pointers to first and last element
     s_pvHead = NULL;
     s_pvTail = NULL;
+    s_unElementCount = 0;
+
+    // Free the hash index
+    Platform_MemoryFree((void**)&s_ppIndex);
+    s_unIndexCapacity = 0;
+    s_unChangeCount++;
+}
+
+/**
+ *  @brief      Registers a table of default property values
+ *  @details    The table is not copied and must stay valid while it is registered. It is consulted by the typed getters
+ *              for keys without an element. An element set for a key overrides its default value.
+ *
+ *  @param      PrgsDefaults    Table of default values or NULL to unregister the table.
+ *  @param      PunCount        Number of entries in the table.
+ */
+void
+PropertyStorage_SetDefaults(
+    _In_opt_                    const IfxPropertyDefault*   PrgsDefaults,
+    _In_                        unsigned int                PunCount)
+{
+    s_prgsDefaults = PrgsDefaults;
+    s_unDefaultCount = (NULL == PrgsDefaults) ? 0 : PunCount;
+    s_unChangeCount++;
+}
+
+/**
+ *  @brief      Returns the change count of the PropertyStorage
+ *  @details    The count is incremented whenever an element is added, changed or removed or the defaults are registered.
+ *              A module keeping a copy of property values compares the count to detect that its copy may be stale.
+ *
+ *  @returns    The change count.
+ */
+unsigned int
+PropertyStorage_GetChangeCount()
+{
+    return s_unChangeCount;
 }
@@ -25,9 +25,27 @@ extern "C" {
 /// Define property storage max value size
 #define PROPERTY_STORAGE_MAX_VALUE  MAX_PATH + 1
 
+/// Value of an IfxPropertyElement set as string
+#define PROPERTY_STORAGE_TYPE_STRING        0
+/// Value of an IfxPropertyElement set as BOOL
+#define PROPERTY_STORAGE_TYPE_BOOLEAN       1
+/// Value of an IfxPropertyElement set as unsigned integer
+#define PROPERTY_STORAGE_TYPE_UINTEGER      2
+/// Value of an IfxPropertyElement set as unsigned long long
+#define PROPERTY_STORAGE_TYPE_ULONGLONG     3
+
+/// Flag indicating the fValue member of an IfxPropertyElement is valid
+#define PROPERTY_STORAGE_TYPED_BOOLEAN      0x00000001
+/// Flag indicating the unValue member of an IfxPropertyElement is valid
+#define PROPERTY_STORAGE_TYPED_UINTEGER     0x00000002
+/// Flag indicating the ullValue member of an IfxPropertyElement is valid
+#define PROPERTY_STORAGE_TYPED_ULONGLONG    0x00000004
+
 /**
  *  @brief      This structure is used to store a property in a double linked list
- *  @details    Each element has a unique key and a value.
+ *  @details    Each element has a unique key and a value. The elements are additionally referenced by a hash index
+ *              over the key. A value set as BOOL or number is held in binary form and its string form is generated on
+ *              first use. A value set as string caches its typed values once they have been parsed.
  */
 typedef struct tdIfxPropertyElement
 {
@@ -35,12 +53,39 @@ typedef struct tdIfxPropertyElement
     struct tdIfxPropertyElement*    pvPreviousElement;
     /// Pointer to the next IfxPropertyElement (NULL if the last element)
     struct tdIfxPropertyElement*    pvNextElement;
-    /// Key to identify the IfxPropertyElement
-    wchar_t                         wszKey[PROPERTY_STORAGE_MAX_KEY];
-    /// Value for the IfxPropertyElement
-    wchar_t                         wszValue[PROPERTY_STORAGE_MAX_VALUE];
+    /// Hash value of pwszKey
+    unsigned int                    unKeyHash;
+    /// Type the value has been set with (PROPERTY_STORAGE_TYPE_*)
+    unsigned int                    unValueType;
+    /// Bit field of PROPERTY_STORAGE_TYPED_* flags indicating the valid typed values
+    unsigned int                    unTypedValues;
+    /// Value as BOOL
+    BOOL                            fValue;
+    /// Value as unsigned integer
+    unsigned int                    unValue;
+    /// Value as unsigned long long
+    unsigned long long              ullValue;
+    /// Key to identify the IfxPropertyElement (stored in the same allocation behind the structure)
+    wchar_t*                        pwszKey;
+    /// Value for the IfxPropertyElement as string (NULL as long as the string form of a typed value is not generated)
+    wchar_t*                        pwszValue;
 } IfxPropertyElement;
 
+/**
+ *  @brief      This structure describes the default value of a property
+ *  @details    A table of defaults is registered with PropertyStorage_SetDefaults. The typed getters return the default
+ *              value if no element with the key exists, so defaults do not need an element of their own.
+ */
+typedef struct tdIfxPropertyDefault
+{
+    /// Key of the property
+    const wchar_t*                  pwszKey;
+    /// Type of the default value (PROPERTY_STORAGE_TYPE_BOOLEAN, PROPERTY_STORAGE_TYPE_UINTEGER or PROPERTY_STORAGE_TYPE_ULONGLONG)
+    unsigned int                    unValueType;
+    /// Default value
+    unsigned long long              ullValue;
+} IfxPropertyDefault;
+
 /**
  *  @brief      Add a key value pair to the PropertyStorage
  *  @details    Operation fails in case an element with same key already exists.
@@ -376,6 +421,29 @@ PropertyStorage_RemoveElement(
 void
 PropertyStorage_ClearElements();
 
+/**
+ *  @brief      Registers a table of default property values
+ *  @details    The table is not copied and must stay valid while it is registered. It is consulted by the typed getters
+ *              for keys without an element. An element set for a key overrides its default value.
+ *
+ *  @param      PrgsDefaults    Table of default values or NULL to unregister the table.
+ *  @param      PunCount        Number of entries in the table.
+ */
+void
+PropertyStorage_SetDefaults(
+    _In_opt_                    const IfxPropertyDefault*   PrgsDefaults,
+    _In_                        unsigned int                PunCount);
+
+/**
+ *  @brief      Returns the change count of the PropertyStorage
+ *  @details    The count is incremented whenever an element is added, changed or removed or the defaults are registered.
+ *              A module keeping a copy of property values compares the count to detect that its copy may be stale.
+ *
+ *  @returns    The change count.
+ */
+unsigned int
+PropertyStorage_GetChangeCount();
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,158 @@
 
 #include "StdInclude.h"
 
+/// Maximum number of TPM instances handled by the device access
+#define DEVICE_ACCESS_MAX_INSTANCES 8
+
+/// Number of records in the register access trace ring (must be a power of two)
+#ifndef DEVICE_ACCESS_TRACE_CAPACITY
+#define DEVICE_ACCESS_TRACE_CAPACITY    512
+#endif
+
+/// Register access trace operation: byte read
+#define DEVICE_ACCESS_TRACE_READ_BYTE       0x01
+/// Register access trace operation: byte write
+#define DEVICE_ACCESS_TRACE_WRITE_BYTE      0x02
+/// Register access trace operation: word read
+#define DEVICE_ACCESS_TRACE_READ_WORD       0x03
+/// Register access trace operation: word write
+#define DEVICE_ACCESS_TRACE_WRITE_WORD      0x04
+/// Register access trace operation: block read (the record value is the number of bytes)
+#define DEVICE_ACCESS_TRACE_READ_BLOCK      0x05
+/// Register access trace operation: block write (the record value is the number of bytes)
+#define DEVICE_ACCESS_TRACE_WRITE_BLOCK     0x06
+
+/// Register access trace status flag marking an error status
+#define DEVICE_ACCESS_TRACE_STATUS_ERROR    0x80
+
+/**
+ *  @brief      Register access trace record
+ *  @details    One record is written for each register access, also if the access fails.
+ */
+typedef struct tdDEVICE_ACCESS_TRACE_RECORD
+{
+    /// Platform_GetTicks value at the start of the access
+    unsigned long long  ullTicks;
+    /// Register address
+    unsigned short      usAddress;
+    /// Operation (DEVICE_ACCESS_TRACE_READ_BYTE, ...)
+    BYTE                bOperation;
+    /// Status code of the bus transaction (0 on success, DEVICE_ACCESS_TRACE_STATUS_ERROR is set for errors)
+    BYTE                bStatus;
+    /// Value read or written or number of bytes for block operations
+    unsigned int        unValue;
+} DEVICE_ACCESS_TRACE_RECORD;
+
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    The TPM instances are enumerated on first use. At most DEVICE_ACCESS_MAX_INSTANCES instances are used.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_GetInstanceCount();
+
+/**
+ *  @brief      Selects the TPM instance used by all following accesses
+ *  @details    Instance 0 is selected by default.
+ *
+ *  @param      PunInstance         Zero based index of the TPM instance.
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  There is no TPM instance with the given index.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_SelectInstance(
+    _In_    unsigned int    PunInstance);
+
+/**
+ *  @brief      Returns the records of the register access trace ring
+ *  @details    The register access trace ring always holds the last DEVICE_ACCESS_TRACE_CAPACITY register accesses. The records
+ *              are returned from oldest to newest and stay in the ring. If the buffer is too small, the newest records are returned.
+ *              Call the function with PrgsRecords set to NULL to get the number of records available.
+ *
+ *  @param      PrgsRecords         Buffer receiving the records (optional, can be NULL).
+ *  @param      PpunRecordCount     In:     Capacity of PrgsRecords in records\n
+ *                                  Out:    Number of records written or available if PrgsRecords is NULL
+ *  @param      PpunDroppedCount    Receives the number of register accesses overwritten since the driver was loaded.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_GetTrace(
+    _Out_opt_   DEVICE_ACCESS_TRACE_RECORD* PrgsRecords,
+    _Inout_     unsigned int*               PpunRecordCount,
+    _Out_       unsigned int*               PpunDroppedCount);
+
+/**
+ *  @brief      Returns whether the platform routes the TPM interrupt to the host
+ *  @details    Only then DeviceAccess_WaitForInterrupt can be signaled.
+ *
+ *  @retval     TRUE        The TPM interrupt is routed.
+ *  @retval     FALSE       The TPM interrupt is not available, the TPM registers must be polled.
+ */
+_Check_return_
+BOOL
+DeviceAccess_IsInterruptRouted();
+
+/**
+ *  @brief      Waits for the TPM interrupt
+ *  @details    Returns as soon as the TPM interrupt was signaled since the last call or the timeout elapsed. The pending
+ *              interrupt is consumed, so an interrupt raised between a register poll and this call is not lost.
+ *
+ *  @param      PunTimeoutUs        Timeout in microseconds.
+ *  @param      PpfSignaled         Receives TRUE if the interrupt was signaled, FALSE on timeout.
+ *  @param      PpunWaitedUs        Receives the time waited in microseconds.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY      The TPM interrupt is not routed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WaitForInterrupt(
+    _In_    unsigned int    PunTimeoutUs,
+    _Out_   BOOL*           PpfSignaled,
+    _Out_   unsigned int*   PpunWaitedUs);
+
+/**
+ *  @brief      Returns whether the platform TPM driver can be used through EFI_TCG2_PROTOCOL
+ *  @details    The protocol must be installed and report a present TPM. It is only used for the first TPM instance,
+ *              because the platform TPM driver does not address other instances.
+ *
+ *  @retval     TRUE        Commands can be submitted with DeviceAccess_Tcg2SubmitCommand.
+ *  @retval     FALSE       EFI_TCG2_PROTOCOL is not available.
+ */
+_Check_return_
+BOOL
+DeviceAccess_IsTcg2Available();
+
+/**
+ *  @brief      Submits a complete TPM command through EFI_TCG2_PROTOCOL.SubmitCommand
+ *  @details    The platform TPM driver transfers the command and waits for the response.
+ *
+ *  @param      PrgbRequest         TPM command request bytes.
+ *  @param      PunRequestSize      Size of the TPM command request in bytes.
+ *  @param      PrgbResponse        Buffer receiving the TPM command response bytes.
+ *  @param      PpunResponseSize    Input size of the response buffer, output size of the TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          EFI_TCG2_PROTOCOL is not available.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA  SubmitCommand failed.
+ *  @retval     RC_E_TPM_RECEIVE_DATA   The response header is invalid.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_Tcg2SubmitCommand(
+    _In_bytecount_(PunRequestSize)      const BYTE*     PrgbRequest,
+    _In_                                unsigned int    PunRequestSize,
+    _Out_bytecap_(*PpunResponseSize)    BYTE*           PrgbResponse,
+    _Inout_                             unsigned int*   PpunResponseSize);
+
 /**
  *  @brief      Initialize the device access
  *  @details
@@ -41,6 +193,99 @@ unsigned int
 DeviceAccess_Uninitialize(
     _In_    BYTE    PbLocality);
 
+/**
+ *  @brief      Returns the sticky bus error state
+ *  @details    The state is set by every failed bus transaction and kept until DeviceAccess_ClearBusError is called, so
+ *              a wait loop can abort as soon as the bus fails instead of polling register values that were never read.
+ *
+ *  @retval     RC_SUCCESS          No bus transaction failed since the state was cleared.
+ *  @retval     RC_E_BUS_ERROR      A bus transaction failed since the state was cleared.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_GetBusError();
+
+/**
+ *  @brief      Clears the sticky bus error state
+ *  @details    Called at the start of a TPM command, so a transient bus error does not fail the retries.
+ */
+void
+DeviceAccess_ClearBusError();
+
+/**
+ *  @brief      Inserts an idle gap on the bus if the TPM transfers exceed the bus duty cycle cap
+ *  @details    Called once at the start of the transmit and the receive phase of a TPM command, so the gap never splits a
+ *              TIS or CRB transaction (e.g. between the burst count poll and the FIFO write).
+ */
+void
+DeviceAccess_Throttle();
+
+/**
+ *  @brief      Read a Byte from the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PpbData             Receives the value read, 0xFF if the bus transaction failed.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PpbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_ReadByteEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _Out_   BYTE*           PpbData);
+
+/**
+ *  @brief      Write a Byte to the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PbData              Byte to write.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WriteByteEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _In_    BYTE            PbData);
+
+/**
+ *  @brief      Read a Word from the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PpusData            Receives the value read, 0xFFFF if the bus transaction failed.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PpusData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_ReadWordEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _Out_   unsigned short* PpusData);
+
+/**
+ *  @brief      Write a Word to the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PusData             Data to be written.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WriteWordEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _In_    unsigned short  PusData);
+
 /**
  *  @brief      Read a Byte from the specified memory address
  *  @details
@@ -88,3 +333,41 @@ void
 DeviceAccess_WriteWord(
     _In_    unsigned int    PunMemoryAddress,
     _In_    unsigned short  PusData);
+
+/**
+ *  @brief      Read a block of bytes from the specified memory address
+ *  @details    All bytes are read from the same address (e.g. the TIS data FIFO) in a single bus transaction.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PrgbData            Buffer to store the data read.
+ *  @param      PunLength           Number of bytes to read.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PrgbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_ReadBlock(
+    _In_                        unsigned int    PunMemoryAddress,
+    _Out_bytecap_(PunLength)    BYTE*           PrgbData,
+    _In_                        unsigned int    PunLength);
+
+/**
+ *  @brief      Write a block of bytes to the specified memory address
+ *  @details    All bytes are written to the same address (e.g. the TIS data FIFO) in a single bus transaction.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PrgbData            Data to be written.
+ *  @param      PunLength           Number of bytes to write.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PrgbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WriteBlock(
+    _In_                        unsigned int    PunMemoryAddress,
+    _In_bytecount_(PunLength)   const BYTE*     PrgbData,
+    _In_                        unsigned int    PunLength);
@@ -0,0 +1,881 @@
+/**
+ *  @brief      Implements the TPM I/O interface for Linux
+ *  @details    Commands are transmitted through the TPM character device of the Linux kernel (TPM_DEVICE_ACCESS_DRIVER).
+ *              The kernel owns the TPM interface registers, so register access is not available. The in-kernel resource
+ *              manager (/dev/tpmrm0) is used by default, which allows other TPM users to run in parallel. /dev/tpm0 can
+ *              be configured through the TpmDeviceAccessPath property.
+ *  @file       Linux/TpmIO.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "StdInclude.h"
+#include "TpmIO.h"
+#include "Logging.h"
+#include "TpmReplay.h"
+#include "PropertyStorage.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+/// Global flag to signalize if module is connected or disconnected
+BOOL g_fConnected = 0;
+/// Global variable storing TPM device access mode configuration
+UINT32 g_unTpmDeviceAccessModeCfg = 0;
+/// File descriptor of the opened TPM device
+static int s_nTpmDevice = -1;
+/// Command buffer, a scattered command is written to the device with a single write() call
+static BYTE s_rgbCommandBuffer[MAX_TPM_COMMAND_SIZE];
+/// Durations of the transport phases of the last command submitted through the device driver
+static TPM_PHASE_TIMING s_sDriverPhaseTiming;
+
+/**
+ *  @brief      Opens the TPM device
+ *  @details    The device path is read from the TpmDeviceAccessPath property.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_COMPONENT_NOT_FOUND    The TPM device does not exist.
+ *  @retval     RC_E_NO_TPM                 The TPM device cannot be opened (e.g. missing permission).
+ *  @retval     RC_E_INTERNAL               The device path setting could not be read.
+ */
+static
+unsigned int
+TPMIO_OpenDevice()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        wchar_t wszDevicePath[MAX_PATH];
+        char szDevicePath[MAX_PATH];
+        unsigned int unDevicePathSize = RG_LEN(wszDevicePath);
+        unsigned int unIndex = 0;
+
+        Platform_MemorySet(wszDevicePath, 0, sizeof(wszDevicePath));
+        if (FALSE == PropertyStorage_GetValueByKey(PROPERTY_TPM_DEVICE_ACCESS_PATH, wszDevicePath, &unDevicePathSize))
+        {
+            unReturnValue = RC_E_INTERNAL;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Retrieving PROPERTY_TPM_DEVICE_ACCESS_PATH failed (%.8x)!", unReturnValue);
+            break;
+        }
+
+        // Device paths are plain ASCII
+        for (unIndex = 0; unIndex < RG_LEN(szDevicePath) - 1 && L'\0' != wszDevicePath[unIndex]; unIndex++)
+            szDevicePath[unIndex] = (char)wszDevicePath[unIndex];
+        szDevicePath[unIndex] = '\0';
+
+        s_nTpmDevice = open(szDevicePath, O_RDWR | O_CLOEXEC);
+        if (-1 == s_nTpmDevice)
+        {
+            unReturnValue = (ENOENT == errno || ENODEV == errno) ? RC_E_COMPONENT_NOT_FOUND : RC_E_NO_TPM;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Opening the TPM device %ls failed with errno %d (0x%.8X)!", wszDevicePath, errno, unReturnValue);
+            break;
+        }
+
+        LOGGING_WRITE_LEVEL4_FMT(L"Using TPM device %ls", wszDevicePath);
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Writes a TPM command to the TPM device
+ *  @details    The kernel expects the complete command in one write() call, so the segments are assembled first.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      The command exceeds MAX_TPM_COMMAND_SIZE.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA  The command could not be written to the TPM device.
+ */
+static
+unsigned int
+TPMIO_DriverSend(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned long long ullStartTicks = Platform_GetTicks();
+        unsigned int unCommandSize = 0;
+        unsigned int unIndex = 0;
+        ssize_t nWritten = 0;
+
+        Platform_MemorySet(&s_sDriverPhaseTiming, 0, sizeof(s_sDriverPhaseTiming));
+        for (unIndex = 0; unIndex < PunSegmentCount; unIndex++)
+        {
+            if (PrgsSegments[unIndex].unSize > sizeof(s_rgbCommandBuffer) - unCommandSize)
+                break;
+            Platform_MemoryCopy(s_rgbCommandBuffer + unCommandSize, sizeof(s_rgbCommandBuffer) - unCommandSize, PrgsSegments[unIndex].pbData, PrgsSegments[unIndex].unSize);
+            unCommandSize += PrgsSegments[unIndex].unSize;
+        }
+        if (unIndex < PunSegmentCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: TPM command exceeds the maximum command size (0x%.8X)!", unReturnValue);
+            break;
+        }
+
+        do
+        {
+            nWritten = write(s_nTpmDevice, s_rgbCommandBuffer, unCommandSize);
+        }
+        while (-1 == nWritten && EINTR == errno);
+        s_sDriverPhaseTiming.ullSendUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+        if (nWritten != (ssize_t)unCommandSize)
+        {
+            unReturnValue = RC_E_TPM_TRANSMIT_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Writing to the TPM device failed with errno %d (0x%.8X)!", errno, unReturnValue);
+            break;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Waits for the TPM device to be readable
+ *  @details
+ *
+ *  @param      PnTimeout               Timeout in milliseconds, 0 to check without waiting.
+ *  @param      PpfReadable             Receives TRUE if the response can be read, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_TPM_RECEIVE_DATA   Waiting on the TPM device failed.
+ */
+static
+unsigned int
+TPMIO_DriverWait(
+    _In_    int     PnTimeout,
+    _Out_   BOOL*   PpfReadable)
+{
+    struct pollfd sPollFd;
+    int nResult = 0;
+
+    Platform_MemorySet(&sPollFd, 0, sizeof(sPollFd));
+    sPollFd.fd = s_nTpmDevice;
+    sPollFd.events = POLLIN;
+
+    do
+    {
+        nResult = poll(&sPollFd, 1, PnTimeout);
+    }
+    while (-1 == nResult && EINTR == errno);
+
+    *PpfReadable = (nResult > 0 && 0 != (sPollFd.revents & POLLIN));
+    if (-1 == nResult)
+    {
+        LOGGING_WRITE_LEVEL1_FMT(L"Error: Waiting on the TPM device failed with errno %d!", errno);
+        return RC_E_TPM_RECEIVE_DATA;
+    }
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Reads the TPM response from the TPM device
+ *  @details    Waits until the response is available but at most the maximum duration of the command.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_TPM_RECEIVE_DATA       The response could not be read from the TPM device.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  No response within the maximum duration.
+ */
+static
+unsigned int
+TPMIO_DriverReceive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        unsigned long long ullStartTicks = Platform_GetTicks();
+        // Round up, a maximum duration of 0 leaves the wait to the kernel
+        int nTimeout = 0 == PunMaxDuration ? -1 : (int)((PunMaxDuration + 999) / 1000);
+        BOOL fReadable = FALSE;
+        ssize_t nRead = 0;
+
+        unReturnValue = TPMIO_DriverWait(nTimeout, &fReadable);
+        s_sDriverPhaseTiming.ullWaitUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        if (!fReadable)
+        {
+            unReturnValue = RC_E_TPM_NO_DATA_AVAILABLE;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: No TPM response within %d ms (0x%.8X)!", nTimeout, unReturnValue);
+            break;
+        }
+
+        ullStartTicks = Platform_GetTicks();
+        do
+        {
+            nRead = read(s_nTpmDevice, PrgbResponseBuffer, *PpunResponseBufferSize);
+        }
+        while (-1 == nRead && EINTR == errno);
+        s_sDriverPhaseTiming.ullReceiveUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+        if (nRead <= 0)
+        {
+            unReturnValue = RC_E_TPM_RECEIVE_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Reading from the TPM device failed with errno %d (0x%.8X)!", errno, unReturnValue);
+            break;
+        }
+
+        *PpunResponseBufferSize = (unsigned int)nRead;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM connect function
+ *  @details    This function handles the connect to the underlying TPM.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_ALREADY_CONNECTED      If TPM I/O is already connected.
+ *  @retval     RC_E_COMPONENT_NOT_FOUND    The TPM device does not exist.
+ *  @retval     RC_E_NOT_READY              No replay trace loaded.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ *  @retval     ...                         Error codes from TPMIO_OpenDevice.
+ */
+_Check_return_
+unsigned int
+TPMIO_Connect()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check if already connected
+        if (FALSE != g_fConnected)
+        {
+            unReturnValue = RC_E_ALREADY_CONNECTED;
+            break;
+        }
+
+        if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, &g_unTpmDeviceAccessModeCfg))
+        {
+            unReturnValue = RC_E_INTERNAL;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Retrieving PROPERTY_TPM_DEVICE_ACCESS_MODE failed (%.8x)!", unReturnValue);
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                LOGGING_WRITE_LEVEL4(L"Connecting to TPM...");
+                unReturnValue = TPMIO_OpenDevice();
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                // Commands are answered from the loaded trace, no TPM is accessed
+                if (!TpmReplay_IsLoaded())
+                {
+                    unReturnValue = RC_E_NOT_READY;
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: No replay trace loaded (0x%.8X)!", unReturnValue);
+                    break;
+                }
+                LOGGING_WRITE_LEVEL4(L"Using replay trace");
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: An Unknown or unsupported device access routine is configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        LOGGING_WRITE_LEVEL4(L"Connected to TPM");
+        g_fConnected = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM revalidate function
+ *  @details    Checks that the connection is still usable after the TPM may have restarted (e.g. a switch to or from boot
+ *              loader mode). The kernel driver keeps the device open across a TPM restart, so the connection stays valid.
+ *
+ *  @retval     RC_SUCCESS                  The connection is usable.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_NOT_READY              No replay trace loaded.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_Revalidate()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_IsLoaded() ? RC_SUCCESS : RC_E_NOT_READY;
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM disconnect function
+ *  @details    This function handles the disconnect to the underlying TPM.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_NOT_CONNECTED      If TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_Disconnect()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                if (-1 != s_nTpmDevice)
+                    close(s_nTpmDevice);
+                s_nTpmDevice = -1;
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        g_fConnected = FALSE;
+        LOGGING_WRITE_LEVEL4(L"Disconnected from TPM");
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM transmit function
+ *  @details    This function submits the TPM command to the underlying TPM.
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (not used, the kernel driver polls the TPM).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Transmit(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize,
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        TPM_TX_SEGMENT sSegment;
+
+        // Check parameters
+        if (NULL == PrgbRequestBuffer || NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        sSegment.pbData = PrgbRequestBuffer;
+        sSegment.unSize = PunRequestBufferSize;
+        unReturnValue = TPMIO_Send(&sSegment, 1);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = TPMIO_Receive(PrgbResponseBuffer, PpunResponseBufferSize, PunMaxDuration, PunExpectedDuration);
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM send function
+ *  @details    This function submits the TPM command to the underlying TPM without waiting for the response.
+ *              The response must be read with TPMIO_Receive before the next command is sent.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Send(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check parameters
+        if (NULL == PrgsSegments || 0 == PunSegmentCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                LOGGING_WRITE_LEVEL3(L"Transmission of data via device driver.");
+                unReturnValue = TPMIO_DriverSend(PrgsSegments, PunSegmentCount);
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Send(PrgsSegments, PunSegmentCount);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM receive function
+ *  @details    This function waits for the response of the TPM command submitted with TPMIO_Send.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (not used, the kernel driver polls the TPM).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    UNREFERENCED_PARAMETER(PunExpectedDuration);
+
+    do
+    {
+        // Check parameters
+        if (NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                unReturnValue = TPMIO_DriverReceive(PrgbResponseBuffer, PpunResponseBufferSize, PunMaxDuration);
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Receive(PrgbResponseBuffer, PpunResponseBufferSize);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM poll function
+ *  @details    This function checks once, without waiting, if the response of the TPM command submitted with TPMIO_Send
+ *              is available.
+ *
+ *  @param      PpfResponseAvailable    Receives TRUE if the response can be read with TPMIO_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Poll(
+    _Out_       BOOL*               PpfResponseAvailable)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        // Check parameters
+        if (NULL == PpfResponseAvailable)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *PpfResponseAvailable = FALSE;
+
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_DRIVER:
+            {
+                unReturnValue = TPMIO_DriverWait(0, PpfResponseAvailable);
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Poll(PpfResponseAvailable);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    The configured TPM device is the only instance.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInstanceCount()
+{
+    return 1;
+}
+
+/**
+ *  @brief      Selects the TPM instance
+ *  @details    All following connects and TPM commands use the selected TPM instance. Another TPM is selected through the
+ *              TpmDeviceAccessPath property, so only instance 0 exists.
+ *
+ *  @param      PunInstance                 Zero based index of the TPM instance.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_ALREADY_CONNECTED      If TPM I/O is connected.
+ *  @retval     RC_E_BAD_PARAMETER          There is no TPM instance with the given index.
+ */
+_Check_return_
+unsigned int
+TPMIO_SelectInstance(
+    _In_        unsigned int        PunInstance)
+{
+    if (FALSE != g_fConnected)
+        return RC_E_ALREADY_CONNECTED;
+
+    return 0 == PunInstance ? RC_SUCCESS : RC_E_BAD_PARAMETER;
+}
+
+/**
+ *  @brief      Read a byte from a specific address (register)
+ *  @details    The TPM registers are owned by the kernel driver and cannot be accessed.
+ *
+ *  @param      PunRegisterAddress          Register address.
+ *  @param      PpbRegisterValue            Pointer to a byte to store the register value.
+ *
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_ReadRegister(
+    _In_    unsigned int    PunRegisterAddress,
+    _Out_   BYTE*           PpbRegisterValue)
+{
+    UNREFERENCED_PARAMETER(PunRegisterAddress);
+
+    if (NULL == PpbRegisterValue)
+        return RC_E_BAD_PARAMETER;
+    *PpbRegisterValue = 0;
+
+    LOGGING_WRITE_LEVEL1(L"Error: Register access is not supported by the device driver access!");
+    return RC_E_INTERNAL;
+}
+
+/**
+ *  @brief      Write a byte to a specific address (register)
+ *  @details    The TPM registers are owned by the kernel driver and cannot be accessed.
+ *
+ *  @param      PunRegisterAddress          Register address.
+ *  @param      PbRegisterValue             Byte to write to the register address.
+ *
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_WriteRegister(
+    _In_    unsigned int    PunRegisterAddress,
+    _In_    BYTE            PbRegisterValue)
+{
+    UNREFERENCED_PARAMETER(PunRegisterAddress);
+    UNREFERENCED_PARAMETER(PbRegisterValue);
+
+    LOGGING_WRITE_LEVEL1(L"Error: Register access is not supported by the device driver access!");
+    return RC_E_INTERNAL;
+}
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    This function returns the time needed to send the last command, to wait for its response and to read
+ *              the response. With the device driver the send phase includes the command processing if the kernel
+ *              executes the command synchronously in write().
+ *
+ *  @param      PpsTiming                   Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetLastPhaseTiming(
+    _Out_       TPM_PHASE_TIMING*   PpsTiming)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    switch (g_unTpmDeviceAccessModeCfg)
+    {
+        case TPM_DEVICE_ACCESS_DRIVER:
+        {
+            if (NULL == PpsTiming)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            *PpsTiming = s_sDriverPhaseTiming;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        case TPM_DEVICE_ACCESS_REPLAY:
+        {
+            unReturnValue = TpmReplay_GetLastPhaseTiming(PpsTiming);
+            break;
+        }
+
+        default:
+        {
+            unReturnValue = RC_E_INTERNAL;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access routine configured (0x%.8x)!", unReturnValue);
+            break;
+        }
+    }
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the identification of the TPM read from its interface registers
+ *  @details    The interface registers are owned by the kernel driver, so the identification is empty and the family is
+ *              TPM_INTERFACE_FAMILY_UNKNOWN. The TPM is probed with TPM commands instead.
+ *
+ *  @param      PpsInfo                     Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInterfaceInfo(
+    _Out_       TPM_INTERFACE_INFO* PpsInfo)
+{
+    if (NULL == PpsInfo)
+        return RC_E_BAD_PARAMETER;
+    Platform_MemorySet(PpsInfo, 0, sizeof(*PpsInfo));
+
+    return FALSE == g_fConnected ? RC_E_NOT_CONNECTED : RC_SUCCESS;
+}
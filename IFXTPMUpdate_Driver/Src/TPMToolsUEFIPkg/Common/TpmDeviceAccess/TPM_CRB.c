@@ -0,0 +1,818 @@
+/**
+ *  @brief      Implements the CRB related functions
+ *  @details    The data buffer is accessed with DeviceAccess_ReadBlock and DeviceAccess_WriteBlock. Unlike the TIS data FIFO
+ *              the data buffer is not a FIFO register, so the TPM increments the address within a bus transaction and a
+ *              chunk of CRB_DATA_BUFFER_CHUNK_SIZE bytes lands at consecutive buffer offsets.
+ *  @file       TpmDeviceAccess/TPM_CRB.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TPM_CRB.h"
+#include "TPM_TIS.h"
+#include "DeviceAccess.h"
+#include "Platform.h"
+#include "Logging.h"
+
+/**
+ *  @brief      Flag indicating that a locality session is held (see CRB_BeginLocalitySession).
+ */
+static BOOL s_fLocalitySessionActive = FALSE;
+
+/**
+ *  @brief      Locality held by the locality session.
+ */
+static BYTE s_bSessionLocality = 0;
+
+/**
+ *  @brief      Flag indicating that a command was started and its response was not read yet.
+ */
+static BOOL s_fCommandPending = FALSE;
+
+/**
+ *  @brief      Durations of the transport phases of the last TPM command.
+ */
+static TPM_PHASE_TIMING s_sPhaseTiming;
+
+/**
+ *  @brief      Condition callback for CRB_WaitFor
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ */
+typedef
+void
+(*PFN_CRB_WAIT_CONDITION)(
+    _In_    UINT32  PunAddress,
+    _Out_   BOOL*   PpfConditionMet);
+
+/**
+ *  @brief      Returns the base address of the register space of a locality
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpunAddress     Pointer to the base address.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+static
+UINT32
+CRB_GetLocalityAddress(
+    _In_    BYTE    PbLocality,
+    _Out_   UINT32* PpunAddress)
+{
+    if (PbLocality > TIS_LOCALITY_4)
+        return RC_E_LOCALITY_NOT_SUPPORTED;
+
+    *PpunAddress = TIS_BASE_ADDRESS + PbLocality * CRB_LOCALITY_SIZE;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Polls a CRB condition until it is met or the timeout elapses
+ *  @details    The sleep time between polls starts at PunFirstSleepUs and is doubled after each poll up to SLEEP_TIME_US_MAX.
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PfnCondition    Condition callback.
+ *  @param      PunTimeoutUs    Timeout in microseconds.
+ *  @param      PunFirstSleepUs Initial sleep time between polls in microseconds.
+ *
+ *  @retval     TRUE            The condition is met.
+ *  @retval     FALSE           The condition was not met within the timeout.
+ */
+static
+BOOL
+CRB_WaitFor(
+    _In_    UINT32                  PunAddress,
+    _In_    PFN_CRB_WAIT_CONDITION  PfnCondition,
+    _In_    UINT32                  PunTimeoutUs,
+    _In_    UINT32                  PunFirstSleepUs)
+{
+    UINT64 ullStartTicks = Platform_GetTicks();
+    UINT64 ullElapsedUs = 0;
+    UINT32 unSleptUs = 0;
+    UINT32 unSleepUs = (0 != PunFirstSleepUs) ? PunFirstSleepUs : SLEEP_TIME_US_CR;
+    BOOL fConditionMet = FALSE;
+
+    if (unSleepUs > SLEEP_TIME_US_MAX)
+        unSleepUs = SLEEP_TIME_US_MAX;
+
+    for (;;)
+    {
+        PfnCondition(PunAddress, &fConditionMet);
+        if (fConditionMet)
+            break;
+
+        // The accumulated sleep time is a lower bound in case no tick counter is available
+        ullElapsedUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+        if (ullElapsedUs < unSleptUs)
+            ullElapsedUs = unSleptUs;
+        if (ullElapsedUs >= PunTimeoutUs)
+            break;
+
+        // Do not sleep beyond the timeout
+        if (unSleepUs > PunTimeoutUs - ullElapsedUs)
+            unSleepUs = (UINT32)(PunTimeoutUs - ullElapsedUs);
+
+        Platform_SleepMicroSeconds(unSleepUs);
+        unSleptUs += unSleepUs;
+
+        unSleepUs *= 2;
+        if (unSleepUs > SLEEP_TIME_US_MAX)
+            unSleepUs = SLEEP_TIME_US_MAX;
+    }
+
+    return fConditionMet;
+}
+
+/**
+ *  @brief      Condition: TPM_LOC_STS.Granted is set
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ */
+static
+void
+CRB_ConditionLocalityGranted(
+    _In_    UINT32  PunAddress,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    BYTE bValue = DeviceAccess_ReadByte(PunAddress | CRB_TPM_LOC_STS);
+    // All bits set means the TPM does not respond
+    *PpfConditionMet = (0xFF != bValue && 0 != (bValue & CRB_TPM_LOC_STS_GRANTED));
+}
+
+/**
+ *  @brief      Condition: TPM_CRB_CTRL_REQ.cmdReady is cleared by the TPM
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ */
+static
+void
+CRB_ConditionCommandReady(
+    _In_    UINT32  PunAddress,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    *PpfConditionMet = (0 == (DeviceAccess_ReadByte(PunAddress | CRB_TPM_CTRL_REQ) & CRB_TPM_CTRL_REQ_CMD_READY));
+}
+
+/**
+ *  @brief      Condition: TPM_CRB_CTRL_REQ.goIdle is cleared by the TPM
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ */
+static
+void
+CRB_ConditionIdle(
+    _In_    UINT32  PunAddress,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    *PpfConditionMet = (0 == (DeviceAccess_ReadByte(PunAddress | CRB_TPM_CTRL_REQ) & CRB_TPM_CTRL_REQ_GO_IDLE));
+}
+
+/**
+ *  @brief      Condition: TPM_CRB_CTRL_START.Start is cleared by the TPM
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ */
+static
+void
+CRB_ConditionCommandDone(
+    _In_    UINT32  PunAddress,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    *PpfConditionMet = (0 == (DeviceAccess_ReadByte(PunAddress | CRB_TPM_CTRL_START) & CRB_TPM_CTRL_START_START));
+}
+
+/**
+ *  @brief      Requests the locality and waits until it is granted
+ *  @details
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    The locality was not granted within TIMEOUT_A.
+ */
+static
+UINT32
+CRB_RequestLocality(
+    _In_    UINT32  PunAddress)
+{
+    DeviceAccess_WriteByte(PunAddress | CRB_TPM_LOC_CTRL, CRB_TPM_LOC_CTRL_REQUEST_ACCESS);
+    if (!CRB_WaitFor(PunAddress, CRB_ConditionLocalityGranted, TIMEOUT_A * 1000, 0))
+        return RC_E_LOCALITY_NOT_ACTIVE;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Puts the TPM into the idle state and relinquishes the locality
+ *  @details    A timeout of the idle transition is ignored, the locality is relinquished anyway.
+ *
+ *  @param      PunAddress      Base address of the register space of the locality.
+ */
+static
+void
+CRB_RelinquishLocality(
+    _In_    UINT32  PunAddress)
+{
+    DeviceAccess_WriteByte(PunAddress | CRB_TPM_CTRL_REQ, CRB_TPM_CTRL_REQ_GO_IDLE);
+    IGNORE_RETURN_VALUE_BOOL(CRB_WaitFor(PunAddress, CRB_ConditionIdle, TIMEOUT_C * 1000, 0));
+    DeviceAccess_WriteByte(PunAddress | CRB_TPM_LOC_CTRL, CRB_TPM_LOC_CTRL_RELINQUISH);
+}
+
+/**
+ *  @brief      Checks whether the TPM implements the CRB interface
+ *  @details    Reads the InterfaceType of the TPM_CRB_INTF_ID register. The register is located at the offset of the
+ *              TPM_INTERFACE_ID register of the FIFO interface, so the function can be used to detect the interface of an
+ *              unknown TPM.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpfIsCrb        Set to TRUE if the TPM implements the CRB interface, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_IsInterfaceCrb(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfIsCrb)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (NULL == PpfIsCrb)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        *PpfIsCrb = (CRB_TPM_INTF_ID_TYPE_CRB == (DeviceAccess_ReadByte(unAddress | CRB_TPM_INTF_ID) & CRB_TPM_INTF_ID_TYPE_MASK));
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Reads the vendor id of the TPM
+ *  @details    Reads the VID field of the TPM_CRB_INTF_ID register.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpusVendorId    Pointer to receive the vendor id.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_ReadVendorId(
+    _In_    BYTE        PbLocality,
+    _Out_   UINT16*     PpusVendorId)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (NULL == PpusVendorId)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        *PpusVendorId = DeviceAccess_ReadWord(unAddress | CRB_TPM_INTF_ID_VID);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Reads the identification of the TPM from the TPM_CRB_INTF_ID register
+ *  @details    The CRB interface is only defined for TPM2.0, so the family is TPM_INTERFACE_FAMILY_TPM20 unless the TPM does
+ *              not respond.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpsInfo         Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_ReadInterfaceInfo(
+    _In_    BYTE                    PbLocality,
+    _Out_   TPM_INTERFACE_INFO*     PpsInfo)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+    BYTE bInterfaceId = 0;
+
+    do
+    {
+        if (NULL == PpsInfo)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        Platform_MemorySet(PpsInfo, 0, sizeof(*PpsInfo));
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        bInterfaceId = DeviceAccess_ReadByte(unAddress | CRB_TPM_INTF_ID);
+        PpsInfo->bInterfaceType = bInterfaceId & CRB_TPM_INTF_ID_TYPE_MASK;
+        PpsInfo->bInterfaceVersion = (bInterfaceId & CRB_TPM_INTF_ID_VERSION_MASK) >> 4;
+        PpsInfo->bRevisionId = DeviceAccess_ReadByte(unAddress | CRB_TPM_INTF_ID_RID);
+        PpsInfo->usVendorId = DeviceAccess_ReadWord(unAddress | CRB_TPM_INTF_ID_VID);
+        PpsInfo->usDeviceId = DeviceAccess_ReadWord(unAddress | CRB_TPM_INTF_ID_DID);
+
+        // All bits set means the TPM does not respond
+        PpsInfo->bFamily = (0xFFFF != PpsInfo->usVendorId) ? TPM_INTERFACE_FAMILY_TPM20 : TPM_INTERFACE_FAMILY_UNKNOWN;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Begins a locality session
+ *  @details    Requests the locality once. Until CRB_EndLocalitySession is called the locality is neither requested before
+ *              nor relinquished after each TPM command. Beginning a session for the locality already held is a no-op.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          A session for another locality is already active.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    The locality was not granted within TIMEOUT_A.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_BeginLocalitySession(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (s_fLocalitySessionActive)
+        {
+            unReturnCode = (s_bSessionLocality == PbLocality) ? RC_SUCCESS : RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = CRB_RequestLocality(unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_bSessionLocality = PbLocality;
+        s_fLocalitySessionActive = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Ends a locality session
+ *  @details    Puts the TPM into the idle state and relinquishes the locality held by the session. The session is ended
+ *              even if this fails. Ending without an active session is a no-op.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_EndLocalitySession()
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (!s_fLocalitySessionActive)
+            break;
+
+        s_fLocalitySessionActive = FALSE;
+        s_fCommandPending = FALSE;
+
+        unReturnCode = CRB_GetLocalityAddress(s_bSessionLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        CRB_RelinquishLocality(unAddress);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Checks whether a locality is assigned to the host
+ *  @details    Reads the TPM_LOC_STATE register. Used to find out whether a locality session survived a TPM restart.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpfActive       Set to TRUE if the register is valid and PbLocality is the active locality, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_IsLocalityActive(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfActive)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        BYTE bState = 0;
+
+        if (NULL == PpfActive)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *PpfActive = FALSE;
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        bState = DeviceAccess_ReadByte(unAddress | CRB_TPM_LOC_STATE);
+        if (0xFF == bState)
+            break;
+
+        *PpfActive = (CRB_TPM_LOC_STATE_REG_VALID | CRB_TPM_LOC_STATE_LOC_ASSIGNED) == (bState & (CRB_TPM_LOC_STATE_REG_VALID | CRB_TPM_LOC_STATE_LOC_ASSIGNED)) &&
+                     PbLocality == ((bState & CRB_TPM_LOC_STATE_ACTIVE_LOCALITY) >> 2);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Sends a TPM command to the CRB data buffer and starts it
+ *  @details    Requests the locality unless a locality session is active, moves the TPM to the ready state, writes the
+ *              segments to the data buffer in order and sets TPM_CRB_CTRL_START.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgsSegments    Segments of the TPM command request.
+ *  @param      PunSegmentCount Number of segments.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The command does not fit into the data buffer.
+ *  @retval     RC_E_NOT_READY              The TPM did not become ready within TIMEOUT_C.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA      The TPM reports a fatal error.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_Send(
+    _In_                        BYTE                    PbLocality,
+    _In_count_(PunSegmentCount) const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                        UINT32                  PunSegmentCount)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+    UINT32 unCommandSize = 0;
+    UINT32 unBufferSize = 0;
+    UINT32 unOffset = 0;
+    UINT32 unSegment = 0;
+    BOOL fLocalityRequested = FALSE;
+    UINT64 ullStartTicks = Platform_GetTicks();
+
+    Platform_MemorySet(&s_sPhaseTiming, 0, sizeof(s_sPhaseTiming));
+    s_fCommandPending = FALSE;
+
+    do
+    {
+        if (NULL == PrgsSegments || 0 == PunSegmentCount)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        // Keep the bus duty cycle cap before the transmit transactions start
+        DeviceAccess_Throttle();
+
+        if (!s_fLocalitySessionActive || s_bSessionLocality != PbLocality)
+        {
+            unReturnCode = CRB_RequestLocality(unAddress);
+            if (RC_SUCCESS != unReturnCode)
+            {
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Send: Locality %d was not granted (0x%.8x)", PbLocality, unReturnCode);
+                break;
+            }
+            fLocalityRequested = TRUE;
+        }
+
+        // Move the TPM from the idle to the ready state, timeout after TIMEOUT_C
+        DeviceAccess_WriteByte(unAddress | CRB_TPM_CTRL_REQ, CRB_TPM_CTRL_REQ_CMD_READY);
+        if (!CRB_WaitFor(unAddress, CRB_ConditionCommandReady, TIMEOUT_C * 1000, 0))
+        {
+            unReturnCode = RC_E_NOT_READY;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Send: TPM did not become ready (0x%.8x)", unReturnCode);
+            break;
+        }
+        if (0 != (DeviceAccess_ReadByte(unAddress | CRB_TPM_CTRL_STS) & CRB_TPM_CTRL_STS_FATAL_ERROR))
+        {
+            unReturnCode = RC_E_TPM_TRANSMIT_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Send: TPM reports a fatal error (0x%.8x)", unReturnCode);
+            break;
+        }
+
+        // The data buffer must hold the complete command
+        for (unSegment = 0; unSegment < PunSegmentCount; unSegment++)
+            unCommandSize += PrgsSegments[unSegment].unSize;
+        unBufferSize = DeviceAccess_ReadWord(unAddress | CRB_TPM_CTRL_CMD_SIZE);
+        if (unCommandSize > unBufferSize || unBufferSize > CRB_LOCALITY_SIZE - CRB_TPM_DATA_BUFFER)
+        {
+            unReturnCode = RC_E_INSUFFICIENT_BUFFER;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Send: Command size %d exceeds the data buffer size %d (0x%.8x)", unCommandSize, unBufferSize, unReturnCode);
+            break;
+        }
+
+        for (unSegment = 0; unSegment < PunSegmentCount && RC_SUCCESS == unReturnCode; unSegment++)
+        {
+            UINT32 unWritten = 0;
+            while (unWritten < PrgsSegments[unSegment].unSize)
+            {
+                UINT32 unChunk = PrgsSegments[unSegment].unSize - unWritten;
+                if (unChunk > CRB_DATA_BUFFER_CHUNK_SIZE - (unOffset % CRB_DATA_BUFFER_CHUNK_SIZE))
+                    unChunk = CRB_DATA_BUFFER_CHUNK_SIZE - (unOffset % CRB_DATA_BUFFER_CHUNK_SIZE);
+
+                unReturnCode = DeviceAccess_WriteBlock(unAddress | (CRB_TPM_DATA_BUFFER + unOffset), PrgsSegments[unSegment].pbData + unWritten, unChunk);
+                if (RC_SUCCESS != unReturnCode)
+                    break;
+
+                unWritten += unChunk;
+                unOffset += unChunk;
+            }
+        }
+        if (RC_SUCCESS != unReturnCode)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Send: Writing the data buffer failed (0x%.8x)", unReturnCode);
+            break;
+        }
+
+        // Start the command
+        DeviceAccess_WriteByte(unAddress | CRB_TPM_CTRL_START, CRB_TPM_CTRL_START_START);
+        s_fCommandPending = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnCode && fLocalityRequested)
+        CRB_RelinquishLocality(unAddress);
+
+    s_sPhaseTiming.ullSendUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Checks whether the response of the sent command is available
+ *  @details    The response is available once the TPM has cleared TPM_CRB_CTRL_START.
+ *
+ *  @param      PbLocality              Locality value.
+ *  @param      PpfResponseAvailable    Receives TRUE if the response can be read with CRB_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_Poll(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfResponseAvailable)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (NULL == PpfResponseAvailable)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *PpfResponseAvailable = FALSE;
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode || !s_fCommandPending)
+            break;
+
+        CRB_ConditionCommandDone(unAddress, PpfResponseAvailable);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Waits for the response of the sent command and reads it from the CRB data buffer
+ *  @details    Relinquishes the locality afterwards unless a locality session is active. If the command does not complete
+ *              within PunMaxDuration it is cancelled.
+ *
+ *  @param      PbLocality          Locality value.
+ *  @param      PrgbRxBuffer        Pointer to a Receive buffer.
+ *  @param      PpunRxLen           Input size of the Receive buffer, output size of the response in bytes.
+ *  @param      PunMaxDuration      The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  No command was sent or the command did not complete within PunMaxDuration.
+ *  @retval     RC_E_TPM_RECEIVE_DATA       The response header is invalid or the TPM reports a fatal error.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The Receive buffer is too small.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_Receive(
+    _In_                        BYTE        PbLocality,
+    _Out_bytecap_(*PpunRxLen)   BYTE*       PrgbRxBuffer,
+    _Inout_                     UINT32*     PpunRxLen,
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unAddress = 0;
+    UINT32 unResponseSize = 0;
+    UINT32 unOffset = 0;
+    UINT32 unFirstSleepUs = 0;
+    UINT64 ullStartTicks = Platform_GetTicks();
+    UINT64 ullDoneTicks = 0;
+    BOOL fWaitDone = FALSE;
+    BOOL fRelinquish = FALSE;
+
+    do
+    {
+        if (NULL == PrgbRxBuffer || NULL == PpunRxLen || *PpunRxLen < CRB_RESPONSE_HEADER_SIZE)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = CRB_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        if (!s_fCommandPending)
+        {
+            unReturnCode = RC_E_TPM_NO_DATA_AVAILABLE;
+            break;
+        }
+        s_fCommandPending = FALSE;
+        fRelinquish = !s_fLocalitySessionActive || s_bSessionLocality != PbLocality;
+
+        // Keep the bus duty cycle cap before the receive transactions start
+        DeviceAccess_Throttle();
+
+        // Start polling with a fraction of the expected duration like the TIS layer does
+        if (0 != PunExpectedDuration)
+        {
+            unFirstSleepUs = PunExpectedDuration / TIS_EXPECTED_DURATION_POLL_DIVISOR;
+            if (unFirstSleepUs < SLEEP_TIME_US_CR)
+                unFirstSleepUs = SLEEP_TIME_US_CR;
+        }
+
+        fWaitDone = CRB_WaitFor(unAddress, CRB_ConditionCommandDone, PunMaxDuration, unFirstSleepUs);
+        ullDoneTicks = Platform_GetTicks();
+        s_sPhaseTiming.ullWaitUs = Platform_TicksToMicroseconds(ullDoneTicks - ullStartTicks);
+        if (!fWaitDone)
+        {
+            // Cancel the command, so the TPM can accept the next one
+            DeviceAccess_WriteByte(unAddress | CRB_TPM_CTRL_CANCEL, CRB_TPM_CTRL_CANCEL_CANCEL);
+            IGNORE_RETURN_VALUE_BOOL(CRB_WaitFor(unAddress, CRB_ConditionCommandDone, TIMEOUT_B * 1000, 0));
+            DeviceAccess_WriteByte(unAddress | CRB_TPM_CTRL_CANCEL, 0);
+            unReturnCode = RC_E_TPM_NO_DATA_AVAILABLE;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Receive: No response after timeout of %d microseconds (0x%.8x)", PunMaxDuration, unReturnCode);
+            break;
+        }
+        if (0 != (DeviceAccess_ReadByte(unAddress | CRB_TPM_CTRL_STS) & CRB_TPM_CTRL_STS_FATAL_ERROR))
+        {
+            unReturnCode = RC_E_TPM_RECEIVE_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Receive: TPM reports a fatal error (0x%.8x)", unReturnCode);
+            break;
+        }
+
+        // Read the response header first to learn the response size
+        unReturnCode = DeviceAccess_ReadBlock(unAddress | CRB_TPM_DATA_BUFFER, PrgbRxBuffer, CRB_RESPONSE_HEADER_SIZE);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unResponseSize = ((UINT32)PrgbRxBuffer[2] << 24) | ((UINT32)PrgbRxBuffer[3] << 16) | ((UINT32)PrgbRxBuffer[4] << 8) | PrgbRxBuffer[5];
+        if (unResponseSize < CRB_RESPONSE_HEADER_SIZE || unResponseSize > CRB_LOCALITY_SIZE - CRB_TPM_DATA_BUFFER)
+        {
+            unReturnCode = RC_E_TPM_RECEIVE_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Receive: Invalid response size %d (0x%.8x)", unResponseSize, unReturnCode);
+            break;
+        }
+        if (unResponseSize > *PpunRxLen)
+        {
+            unReturnCode = RC_E_INSUFFICIENT_BUFFER;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Receive: Response size %d exceeds the buffer size %d (0x%.8x)", unResponseSize, *PpunRxLen, unReturnCode);
+            break;
+        }
+
+        for (unOffset = CRB_RESPONSE_HEADER_SIZE; unOffset < unResponseSize; )
+        {
+            UINT32 unChunk = unResponseSize - unOffset;
+            if (unChunk > CRB_DATA_BUFFER_CHUNK_SIZE)
+                unChunk = CRB_DATA_BUFFER_CHUNK_SIZE;
+
+            unReturnCode = DeviceAccess_ReadBlock(unAddress | (CRB_TPM_DATA_BUFFER + unOffset), PrgbRxBuffer + unOffset, unChunk);
+            if (RC_SUCCESS != unReturnCode)
+                break;
+
+            unOffset += unChunk;
+        }
+        if (RC_SUCCESS != unReturnCode)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: CRB_Receive: Reading the data buffer failed (0x%.8x)", unReturnCode);
+            break;
+        }
+
+        *PpunRxLen = unResponseSize;
+    }
+    WHILE_FALSE_END;
+
+    if (fRelinquish)
+        CRB_RelinquishLocality(unAddress);
+
+    if (fWaitDone)
+        s_sPhaseTiming.ullReceiveUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullDoneTicks);
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+CRB_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming)
+{
+    if (NULL == PpsTiming)
+        return RC_E_BAD_PARAMETER;
+
+    *PpsTiming = s_sPhaseTiming;
+
+    return RC_SUCCESS;
+}
@@ -0,0 +1,273 @@
+/**
+ *  @brief      Declares the CRB related functions
+ *  @details    The Command Response Buffer (CRB) interface of the TCG PC Client Platform TPM Profile is an alternative to the
+ *              FIFO (TIS) interface. The command is written to a data buffer in the register space of the locality and started
+ *              by a single register write, and the response is read from the same buffer.
+ *  @file       TpmDeviceAccess/TPM_CRB.h
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TPM_CRB_H__
+#define __TPM_CRB_H__
+
+#include "StdInclude.h"
+
+// CRB Definitions (the register space of a locality is the same as for TIS)
+/// Size of the register space of a locality
+#define CRB_LOCALITY_SIZE 0x1000
+
+// CRB Interface Registers
+/// Register offset for TPM_LOC_STATE register
+#define CRB_TPM_LOC_STATE 0x00000000
+/// Register offset for TPM_LOC_CTRL register
+#define CRB_TPM_LOC_CTRL 0x00000008
+/// Register offset for TPM_LOC_STS register
+#define CRB_TPM_LOC_STS 0x0000000C
+/// Register offset for TPM_CRB_INTF_ID register (same offset as TPM_INTERFACE_ID of the FIFO interface)
+#define CRB_TPM_INTF_ID 0x00000030
+/// Register offset for the revision id in the TPM_CRB_INTF_ID register
+#define CRB_TPM_INTF_ID_RID 0x00000033
+/// Register offset for the vendor id in the TPM_CRB_INTF_ID register
+#define CRB_TPM_INTF_ID_VID 0x00000034
+/// Register offset for the device id in the TPM_CRB_INTF_ID register
+#define CRB_TPM_INTF_ID_DID 0x00000036
+/// Register offset for TPM_CRB_CTRL_REQ register
+#define CRB_TPM_CTRL_REQ 0x00000040
+/// Register offset for TPM_CRB_CTRL_STS register
+#define CRB_TPM_CTRL_STS 0x00000044
+/// Register offset for TPM_CRB_CTRL_CANCEL register
+#define CRB_TPM_CTRL_CANCEL 0x00000048
+/// Register offset for TPM_CRB_CTRL_START register
+#define CRB_TPM_CTRL_START 0x0000004C
+/// Register offset for TPM_CRB_CTRL_CMD_SIZE register
+#define CRB_TPM_CTRL_CMD_SIZE 0x00000058
+/// Register offset for TPM_CRB_CTRL_RSP_SIZE register
+#define CRB_TPM_CTRL_RSP_SIZE 0x00000064
+/// Register offset for TPM_CRB_DATA_BUFFER
+#define CRB_TPM_DATA_BUFFER 0x00000080
+
+/// TPM_LOC_STATE register bit for tpmRegValidSts
+#define CRB_TPM_LOC_STATE_REG_VALID 0x80
+/// TPM_LOC_STATE register bits for activeLocality
+#define CRB_TPM_LOC_STATE_ACTIVE_LOCALITY 0x1C
+/// TPM_LOC_STATE register bit for locAssigned
+#define CRB_TPM_LOC_STATE_LOC_ASSIGNED 0x02
+/// TPM_LOC_CTRL register bit for requestAccess
+#define CRB_TPM_LOC_CTRL_REQUEST_ACCESS 0x01
+/// TPM_LOC_CTRL register bit for relinquish
+#define CRB_TPM_LOC_CTRL_RELINQUISH 0x02
+/// TPM_LOC_STS register bit for Granted
+#define CRB_TPM_LOC_STS_GRANTED 0x01
+/// TPM_CRB_INTF_ID register bits for InterfaceType
+#define CRB_TPM_INTF_ID_TYPE_MASK 0x0F
+/// TPM_CRB_INTF_ID register bits for InterfaceVersion
+#define CRB_TPM_INTF_ID_VERSION_MASK 0xF0
+/// TPM_CRB_INTF_ID InterfaceType value of the CRB interface
+#define CRB_TPM_INTF_ID_TYPE_CRB 0x01
+/// TPM_CRB_CTRL_REQ register bit for cmdReady
+#define CRB_TPM_CTRL_REQ_CMD_READY 0x01
+/// TPM_CRB_CTRL_REQ register bit for goIdle
+#define CRB_TPM_CTRL_REQ_GO_IDLE 0x02
+/// TPM_CRB_CTRL_STS register bit for tpmSts (fatal error)
+#define CRB_TPM_CTRL_STS_FATAL_ERROR 0x01
+/// TPM_CRB_CTRL_STS register bit for tpmIdle
+#define CRB_TPM_CTRL_STS_IDLE 0x02
+/// TPM_CRB_CTRL_START register bit for Start
+#define CRB_TPM_CTRL_START_START 0x01
+/// TPM_CRB_CTRL_CANCEL register value to cancel the command
+#define CRB_TPM_CTRL_CANCEL_CANCEL 0x01
+
+/// Maximum number of bytes transferred to or from the data buffer in a single bus transaction
+#define CRB_DATA_BUFFER_CHUNK_SIZE 64
+/// Size of a TPM response header (tag, size and response code)
+#define CRB_RESPONSE_HEADER_SIZE 10
+
+/**
+ *  @brief      Checks whether the TPM implements the CRB interface
+ *  @details    Reads the InterfaceType of the TPM_CRB_INTF_ID register. The register is located at the offset of the
+ *              TPM_INTERFACE_ID register of the FIFO interface, so the function can be used to detect the interface of an
+ *              unknown TPM.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpfIsCrb        Set to TRUE if the TPM implements the CRB interface, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_IsInterfaceCrb(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfIsCrb);
+
+/**
+ *  @brief      Reads the vendor id of the TPM
+ *  @details    Reads the VID field of the TPM_CRB_INTF_ID register.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpusVendorId    Pointer to receive the vendor id.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_ReadVendorId(
+    _In_    BYTE        PbLocality,
+    _Out_   UINT16*     PpusVendorId);
+
+/**
+ *  @brief      Reads the identification of the TPM from the TPM_CRB_INTF_ID register
+ *  @details    The CRB interface is only defined for TPM2.0, so the family is TPM_INTERFACE_FAMILY_TPM20 unless the TPM does
+ *              not respond.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpsInfo         Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_ReadInterfaceInfo(
+    _In_    BYTE                    PbLocality,
+    _Out_   TPM_INTERFACE_INFO*     PpsInfo);
+
+/**
+ *  @brief      Begins a locality session
+ *  @details    Requests the locality once. Until CRB_EndLocalitySession is called the locality is neither requested before
+ *              nor relinquished after each TPM command. Beginning a session for the locality already held is a no-op.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          A session for another locality is already active.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    The locality was not granted within TIMEOUT_A.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_BeginLocalitySession(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Ends a locality session
+ *  @details    Puts the TPM into the idle state and relinquishes the locality held by the session. The session is ended
+ *              even if this fails. Ending without an active session is a no-op.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_EndLocalitySession();
+
+/**
+ *  @brief      Checks whether a locality is assigned to the host
+ *  @details    Reads the TPM_LOC_STATE register. Used to find out whether a locality session survived a TPM restart.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpfActive       Set to TRUE if the register is valid and PbLocality is the active locality, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_IsLocalityActive(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfActive);
+
+/**
+ *  @brief      Sends a TPM command to the CRB data buffer and starts it
+ *  @details    Requests the locality unless a locality session is active, moves the TPM to the ready state, writes the
+ *              segments to the data buffer in order and sets TPM_CRB_CTRL_START.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgsSegments    Segments of the TPM command request.
+ *  @param      PunSegmentCount Number of segments.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The command does not fit into the data buffer.
+ *  @retval     RC_E_NOT_READY              The TPM did not become ready within TIMEOUT_C.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA      The TPM reports a fatal error.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_Send(
+    _In_                        BYTE                    PbLocality,
+    _In_count_(PunSegmentCount) const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                        UINT32                  PunSegmentCount);
+
+/**
+ *  @brief      Checks whether the response of the sent command is available
+ *  @details    The response is available once the TPM has cleared TPM_CRB_CTRL_START.
+ *
+ *  @param      PbLocality              Locality value.
+ *  @param      PpfResponseAvailable    Receives TRUE if the response can be read with CRB_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+CRB_Poll(
+    _In_    BYTE    PbLocality,
+    _Out_   BOOL*   PpfResponseAvailable);
+
+/**
+ *  @brief      Waits for the response of the sent command and reads it from the CRB data buffer
+ *  @details    Relinquishes the locality afterwards unless a locality session is active. If the command does not complete
+ *              within PunMaxDuration it is cancelled.
+ *
+ *  @param      PbLocality          Locality value.
+ *  @param      PrgbRxBuffer        Pointer to a Receive buffer.
+ *  @param      PpunRxLen           Input size of the Receive buffer, output size of the response in bytes.
+ *  @param      PunMaxDuration      The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  No command was sent or the command did not complete within PunMaxDuration.
+ *  @retval     RC_E_TPM_RECEIVE_DATA       The response header is invalid or the TPM reports a fatal error.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The Receive buffer is too small.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+UINT32
+CRB_Receive(
+    _In_                        BYTE        PbLocality,
+    _Out_bytecap_(*PpunRxLen)   BYTE*       PrgbRxBuffer,
+    _Inout_                     UINT32*     PpunRxLen,
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration);
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+CRB_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming);
+
+#endif //__TPM_CRB_H__
@@ -39,6 +39,77 @@ static BOOL s_fCachedStatusRegisterValid = FALSE;
  */
 static BOOL s_fKeepLocality = FALSE;
 
+/**
+ *  @brief      Determines whether a locality session is held. The locality is then requested once by
+ *              TIS_BeginLocalitySession and released by TIS_EndLocalitySession instead of per TPM command.
+ */
+static BOOL s_fLocalitySessionActive = FALSE;
+/**
+ *  @brief      Locality held by the locality session.
+ */
+static BYTE s_bSessionLocality = 0;
+/**
+ *  @brief      Determines whether the session locality was seen active since it was requested. While set, the
+ *              ACCESS register is not polled before each TPM command.
+ */
+static BOOL s_fSessionLocalityVerified = FALSE;
+/**
+ *  @brief      Determines whether the session locality was yielded to another locality with a pending request. The
+ *              locality is then requested again before the next TPM command.
+ */
+static BOOL s_fSessionLocalityYielded = FALSE;
+
+/**
+ *  @brief      Determines whether the TPM interrupts are enabled and the waits for data available, command ready and the
+ *              active locality sleep until the TPM interrupt is signaled.
+ */
+static BOOL s_fInterruptMode = FALSE;
+
+/**
+ *  @brief      Transport profiles of the supported TPM models, the first matching entry is used.
+ *  @details    The last entry matches any TPM and keeps the conservative poll intervals tuned for the slowest device.
+ */
+static const TIS_TRANSPORT_PROFILE s_rgsTransportProfiles[] =
+{
+    // VID, DID, min. RID, name, handshake sleep, max. handshake sleep, burst count sleep, response sleep, block latency, block size
+    {TPM_VID_IFX, 0x001D, 0x00, L"SLB 9672", 5, 50, 5, 5, 30000, 1024},
+    {TPM_VID_IFX, 0x001B, 0x00, L"SLB 9670", 10, 100, 10, 10, 45000, 1024},
+    {TPM_VID_IFX, 0x000B, 0x00, L"SLB 9660", SLEEP_TIME_US_CR, SLEEP_TIME_US, SLEEP_TIME_US_BURSTCOUNT, SLEEP_TIME_US_CR, 0, 0},
+    {0, TIS_PROFILE_ANY_DEVICE, 0x00, L"default", SLEEP_TIME_US_CR, SLEEP_TIME_US, SLEEP_TIME_US_BURSTCOUNT, SLEEP_TIME_US_CR, 0, 0}
+};
+
+/**
+ *  @brief      Transport profile selected by TIS_SelectTransportProfile.
+ */
+static const TIS_TRANSPORT_PROFILE* s_psTransportProfile = &s_rgsTransportProfiles[RG_LEN(s_rgsTransportProfiles) - 1];
+
+/**
+ *  @brief      Backoff policies of the TIS wait loops, indexed by TIS_WAIT_* identifier.
+ *  @details    Register handshakes usually complete within a few polls, so they spin first and back off only up to
+ *              SLEEP_TIME_US. Waiting for a response backs off further since long running commands take seconds.
+ *              The initial and maximum sleep times are replaced by the values of the selected transport profile.
+ */
+static TIS_BACKOFF_POLICY s_rgsBackoffPolicy[TIS_WAIT_COUNT] =
+{
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US},             // TIS_WAIT_LOCALITY_ACTIVE
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US},             // TIS_WAIT_COMMAND_READY
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_BURSTCOUNT, SLEEP_TIME_US},     // TIS_WAIT_BURSTCOUNT
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US},             // TIS_WAIT_STS_EXPECT
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US},             // TIS_WAIT_STS_NOT_EXPECT
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US_MAX},         // TIS_WAIT_DATA_AVAILABLE
+    {TIS_POLL_SPIN_COUNT, SLEEP_TIME_US_CR, SLEEP_TIME_US}              // TIS_WAIT_STS_NOT_AVAILABLE
+};
+
+/**
+ *  @brief      Polling statistics of the TIS wait loops, indexed by TIS_WAIT_* identifier.
+ */
+static TIS_POLL_STATISTICS s_rgsPollStatistics[TIS_WAIT_COUNT];
+
+/**
+ *  @brief      Durations of the transport phases of the last TPM command.
+ */
+static TPM_PHASE_TIMING s_sPhaseTiming;
+
 /**
  *  @brief      Represents a TPM register descriptor
  *  @details    Structure that holds the bit value and the name of a TPM register.
@@ -115,15 +186,785 @@ static IfxTpmRegister s_sAccessRegister[] =
     } \
 } \
 
-/**
- *  @brief      Keep the locality active between TPM commands. If not set, the locality would be released after a TPM response
- *              and requested again before the next TPM command.
- *  @details
- */
-void
-TIS_KeepLocalityActive()
-{
-    s_fKeepLocality = TRUE;
+/**
+ *  @brief      Invalidates the cached register values
+ *  @details    The cached values of the access and status register belong to one TPM. They must be invalidated when
+ *              another TPM instance is selected.
+ */
+void
+TIS_InvalidateCachedRegisters()
+{
+    s_bCachedAccessRegister = 0xFF;
+    s_fCachedAccessRegisterValid = FALSE;
+    s_bCachedStatusRegister = 0xFF;
+    s_fCachedStatusRegisterValid = FALSE;
+}
+
+/**
+ *  @brief      Keep the locality active between TPM commands. If not set, the locality would be released after a TPM response
+ *              and requested again before the next TPM command.
+ *  @details
+ */
+void
+TIS_KeepLocalityActive()
+{
+    s_fKeepLocality = TRUE;
+}
+
+/**
+ *  @brief      Begins a locality session
+ *  @details    Requests the locality once. Until TIS_EndLocalitySession is called the locality is neither requested
+ *              before nor released after each TPM command, and once the locality was seen active the ACCESS register
+ *              is not polled anymore. Any failed TPM command makes the next one verify the locality again. After each
+ *              TPM response the ACCESS register is read once, if another locality has a pending request the locality
+ *              is yielded and requested again before the next TPM command. Beginning a session for the locality
+ *              already held is a no-op.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          A session for another locality is already active.
+ *  @retval     ...                         Error codes from TIS_RequestUse function.
+ */
+_Check_return_
+UINT32
+TIS_BeginLocalitySession(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    do
+    {
+        if (s_fLocalitySessionActive)
+        {
+            if (PbLocality != s_bSessionLocality)
+                unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        DeviceAccess_ClearBusError();
+        unReturnCode = TIS_RequestUse(PbLocality);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_bSessionLocality = PbLocality;
+        s_fSessionLocalityVerified = FALSE;
+        s_fSessionLocalityYielded = FALSE;
+        s_fLocalitySessionActive = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Ends a locality session
+ *  @details    Releases the locality held by the session. The session is ended even if the release fails, so a
+ *              following TIS_BeginLocalitySession (e.g. after a TPM restart) starts from scratch. Ending without an
+ *              active session is a no-op.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     ...                         Error codes from TIS_ReleaseActiveLocality function.
+ */
+_Check_return_
+UINT32
+TIS_EndLocalitySession()
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    if (s_fLocalitySessionActive)
+    {
+        s_fLocalitySessionActive = FALSE;
+        s_fSessionLocalityVerified = FALSE;
+        s_fSessionLocalityYielded = FALSE;
+        unReturnCode = TIS_ReleaseActiveLocality(s_bSessionLocality);
+    }
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Returns whether a locality session is held for the given locality
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     TRUE            A locality session is held for PbLocality.
+ *  @retval     FALSE           Otherwise.
+ */
+_Check_return_
+BOOL
+TIS_IsLocalitySessionActive(
+    _In_    BYTE    PbLocality)
+{
+    return (s_fLocalitySessionActive && PbLocality == s_bSessionLocality) ? TRUE : FALSE;
+}
+
+/**
+ *  @brief      Returns the TPM interrupt signaling the condition of a TIS wait loop
+ *  @details
+ *
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *
+ *  @returns    TIS_TPM_INT_* bit or 0 if the condition is not signaled by an interrupt.
+ */
+static
+BYTE
+TIS_GetWaitInterrupt(
+    _In_    UINT32  PunWaitId)
+{
+    switch (PunWaitId)
+    {
+        case TIS_WAIT_LOCALITY_ACTIVE:
+            return TIS_TPM_INT_LOCALITY_CHANGE;
+        case TIS_WAIT_COMMAND_READY:
+            return TIS_TPM_INT_COMMAND_READY;
+        case TIS_WAIT_DATA_AVAILABLE:
+            return TIS_TPM_INT_DATA_AVAIL;
+        default:
+            return 0;
+    }
+}
+
+/**
+ *  @brief      Acknowledges the pending TPM interrupts
+ *  @details    Writes the set bits of TPM.INT_STATUS back to clear them.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadRegister and TIS_WriteRegister functions.
+ */
+static
+UINT32
+TIS_ClearInterruptStatus(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    BYTE bStatus = 0;
+
+    do
+    {
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INT_STATUS, sizeof(bStatus), &bStatus);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        if (0 != bStatus && 0xFF != bStatus)
+            unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_INT_STATUS, sizeof(bStatus), bStatus);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Switches the TIS layer to interrupt mode if possible
+ *  @details    Enables the dataAvail, commandReady and localityChange interrupts of the TPM if the platform routes the TPM
+ *              interrupt to the host (see DeviceAccess_IsInterruptRouted) and the TPM supports them. In interrupt mode the waits
+ *              for these conditions sleep until the interrupt is signaled instead of polling the TPM registers. The registers are
+ *              still checked every TIS_INTERRUPT_POLL_INTERVAL_US, so a lost interrupt only delays the wait. If interrupts are
+ *              not available the function succeeds and the TIS layer keeps polling. The locality must be active.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadRegister and TIS_WriteRegister functions.
+ */
+_Check_return_
+UINT32
+TIS_EnableInterrupts(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    do
+    {
+        BYTE bCapability = 0;
+        BYTE bEnable = 0;
+
+        if (s_fInterruptMode || !DeviceAccess_IsInterruptRouted())
+            break;
+
+        // Check that the TPM supports the interrupts
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INTF_CAPABILITY, sizeof(bCapability), &bCapability);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        if (0xFF == bCapability || TIS_TPM_INT_MASK != (bCapability & TIS_TPM_INT_MASK))
+        {
+            LOGGING_WRITE_LEVEL4_FMT(L"TPM interrupts not supported (0x%.2x), polling the TPM", bCapability);
+            break;
+        }
+
+        // Keep the interrupt type and polarity configured by the platform
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INT_ENABLE, sizeof(bEnable), &bEnable);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_ClearInterruptStatus(PbLocality);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_INT_ENABLE, sizeof(bEnable), (bEnable & TIS_TPM_INT_TYPE_POLARITY) | TIS_TPM_INT_MASK);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_INT_ENABLE_GLOBAL, sizeof(BYTE), TIS_TPM_INT_GLOBAL_ENABLE);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_fInterruptMode = TRUE;
+        LOGGING_WRITE_LEVEL4(L"TPM interrupts enabled");
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Switches the TIS layer back to polling mode
+ *  @details    Disables the interrupts enabled by TIS_EnableInterrupts. Does nothing if interrupt mode is not active.
+ *              The locality must be active.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadRegister and TIS_WriteRegister functions.
+ */
+_Check_return_
+UINT32
+TIS_DisableInterrupts(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    do
+    {
+        BYTE bEnable = 0;
+
+        if (!s_fInterruptMode)
+            break;
+
+        // Polling mode is used from now on, also if the TPM cannot be accessed
+        s_fInterruptMode = FALSE;
+
+        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_INT_ENABLE_GLOBAL, sizeof(BYTE), 0);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INT_ENABLE, sizeof(bEnable), &bEnable);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_INT_ENABLE, sizeof(bEnable), bEnable & TIS_TPM_INT_TYPE_POLARITY);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = TIS_ClearInterruptStatus(PbLocality);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Returns whether the TIS layer waits for TPM interrupts
+ *  @details
+ *
+ *  @retval     TRUE            Interrupt mode is active.
+ *  @retval     FALSE           The TIS layer polls the TPM registers.
+ */
+_Check_return_
+BOOL
+TIS_IsInterruptModeActive()
+{
+    return s_fInterruptMode;
+}
+
+/**
+ *  @brief      Polls a TIS condition until it is met or the timeout elapses, starting with a given sleep time
+ *  @details    Works like TIS_WaitFor but lets the caller override the initial sleep time of the backoff policy,
+ *              e.g. with a value derived from the expected duration of a TPM command. In interrupt mode the wait sleeps
+ *              until the TPM interrupt is signaled instead, if the condition is signaled by an interrupt. The wait aborts
+ *              as soon as a bus transaction has failed (see DeviceAccess_GetBusError), since the register values polled
+ *              afterwards are not read from the TPM.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *  @param      PfnCondition    Condition callback.
+ *  @param      PpvContext      Context passed to the condition callback.
+ *  @param      PunTimeoutUs    Timeout in microseconds.
+ *  @param      PunFirstSleepUs Initial sleep time between polls in microseconds; 0 to use the value of the backoff policy.
+ *  @param      PpfTimedOut     Set to TRUE if the condition was not met within the timeout.
+ *
+ *  @retval     RC_SUCCESS          The condition is met.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY      The condition was not met within the timeout (*PpfTimedOut is TRUE).
+ *  @retval     RC_E_BUS_ERROR      A bus transaction failed.
+ *  @retval     ...                 Error codes from the condition callback.
+ */
+static
+UINT32
+TIS_WaitForWithFirstSleep(
+    _In_        BYTE                    PbLocality,
+    _In_        UINT32                  PunWaitId,
+    _In_        PFN_TIS_WAIT_CONDITION  PfnCondition,
+    _Inout_opt_ void*                   PpvContext,
+    _In_        UINT32                  PunTimeoutUs,
+    _In_        UINT32                  PunFirstSleepUs,
+    _Out_       BOOL*                   PpfTimedOut)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT32 unPolls = 0;
+    UINT32 unElapsedUs = 0;
+    UINT32 unSleptUs = 0;
+    UINT32 unSleepUs = 0;
+    UINT64 ullStartTicks = Platform_GetTicks();
+    UINT64 ullMeasuredUs = 0;
+    BOOL fConditionMet = FALSE;
+    BOOL fInterruptSignaled = FALSE;
+    const TIS_BACKOFF_POLICY* pPolicy = NULL;
+
+    do
+    {
+        if (NULL == PfnCondition || NULL == PpfTimedOut || PunWaitId >= TIS_WAIT_COUNT)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        *PpfTimedOut = FALSE;
+        pPolicy = &s_rgsBackoffPolicy[PunWaitId];
+        unSleepUs = (0 != PunFirstSleepUs) ? PunFirstSleepUs : pPolicy->unMinSleepUs;
+        if (unSleepUs > pPolicy->unMaxSleepUs)
+            unSleepUs = pPolicy->unMaxSleepUs;
+
+        // The elapsed time is measured with the tick counter, so the time consumed by the register accesses counts
+        // against the timeout as well. The accumulated sleep time is a lower bound in case no tick counter is available.
+        for (;;)
+        {
+            unPolls++;
+            unReturnCode = PfnCondition(PbLocality, PpvContext, &fConditionMet);
+            if (RC_SUCCESS != unReturnCode || fConditionMet)
+                break;
+
+            // Do not poll register values that could not be read (also covers failed writes, e.g. clearing the interrupt status)
+            unReturnCode = DeviceAccess_GetBusError();
+            if (RC_SUCCESS != unReturnCode)
+                break;
+
+            // The timeout is also checked while spinning, since each poll is a bus transaction that may take long on a
+            // slow bus
+            ullMeasuredUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+            if (ullMeasuredUs > PunTimeoutUs)
+                ullMeasuredUs = PunTimeoutUs;
+            unElapsedUs = (ullMeasuredUs > unSleptUs) ? (UINT32)ullMeasuredUs : unSleptUs;
+            if (unElapsedUs >= PunTimeoutUs)
+            {
+                unReturnCode = RC_E_NOT_READY;
+                *PpfTimedOut = TRUE;
+                break;
+            }
+
+            if (unPolls <= pPolicy->unSpinPolls)
+                continue;
+
+            // Sleep until the TPM signals a change. The condition is polled again after each interrupt (it may have been
+            // raised for another condition) and at least every TIS_INTERRUPT_POLL_INTERVAL_US.
+            if (s_fInterruptMode && 0 != TIS_GetWaitInterrupt(PunWaitId))
+            {
+                BOOL fSignaled = FALSE;
+                UINT32 unWaitedUs = 0;
+                UINT32 unWaitUs = PunTimeoutUs - unElapsedUs;
+                if (unWaitUs > TIS_INTERRUPT_POLL_INTERVAL_US)
+                    unWaitUs = TIS_INTERRUPT_POLL_INTERVAL_US;
+
+                IGNORE_RETURN_VALUE(DeviceAccess_WaitForInterrupt(unWaitUs, &fSignaled, &unWaitedUs));
+                unSleptUs += unWaitedUs;
+                if (fSignaled)
+                {
+                    fInterruptSignaled = TRUE;
+                    IGNORE_RETURN_VALUE(TIS_ClearInterruptStatus(PbLocality));
+                }
+                continue;
+            }
+
+            // Do not sleep beyond the timeout
+            if (unSleepUs > PunTimeoutUs - unElapsedUs)
+                unSleepUs = PunTimeoutUs - unElapsedUs;
+
+            Platform_SleepMicroSeconds(unSleepUs);
+            unSleptUs += unSleepUs;
+
+            // Exponential backoff up to the maximum sleep time of the policy
+            unSleepUs *= 2;
+            if (unSleepUs > pPolicy->unMaxSleepUs)
+                unSleepUs = pPolicy->unMaxSleepUs;
+        }
+
+        // The status of the localityChange interrupt can only be cleared once the locality is active
+        if (fInterruptSignaled && TIS_WAIT_LOCALITY_ACTIVE == PunWaitId && fConditionMet)
+            IGNORE_RETURN_VALUE(TIS_ClearInterruptStatus(PbLocality));
+
+        // Record the polling statistics
+        ullMeasuredUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+        if (ullMeasuredUs < unSleptUs)
+            ullMeasuredUs = unSleptUs;
+        s_rgsPollStatistics[PunWaitId].unLastWaitUs = (ullMeasuredUs > 0xFFFFFFFF) ? 0xFFFFFFFF : (UINT32)ullMeasuredUs;
+        s_rgsPollStatistics[PunWaitId].unWaits++;
+        s_rgsPollStatistics[PunWaitId].unPolls += unPolls;
+        s_rgsPollStatistics[PunWaitId].unLastPolls = unPolls;
+        if (unPolls > s_rgsPollStatistics[PunWaitId].unMaxPolls)
+            s_rgsPollStatistics[PunWaitId].unMaxPolls = unPolls;
+        if (*PpfTimedOut)
+            s_rgsPollStatistics[PunWaitId].unTimeouts++;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Polls a TIS condition until it is met or the timeout elapses
+ *  @details    The condition is polled according to the backoff policy of the given wait loop identifier.
+ *              The number of polls is recorded in the polling statistics of the wait loop.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *  @param      PfnCondition    Condition callback.
+ *  @param      PpvContext      Context passed to the condition callback.
+ *  @param      PunTimeoutUs    Timeout in microseconds.
+ *  @param      PpfTimedOut     Set to TRUE if the condition was not met within the timeout.
+ *
+ *  @retval     RC_SUCCESS          The condition is met.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY      The condition was not met within the timeout (*PpfTimedOut is TRUE).
+ *  @retval     RC_E_BUS_ERROR      A bus transaction failed.
+ *  @retval     ...                 Error codes from the condition callback.
+ */
+_Check_return_
+UINT32
+TIS_WaitFor(
+    _In_        BYTE                    PbLocality,
+    _In_        UINT32                  PunWaitId,
+    _In_        PFN_TIS_WAIT_CONDITION  PfnCondition,
+    _Inout_opt_ void*                   PpvContext,
+    _In_        UINT32                  PunTimeoutUs,
+    _Out_       BOOL*                   PpfTimedOut)
+{
+    return TIS_WaitForWithFirstSleep(PbLocality, PunWaitId, PfnCondition, PpvContext, PunTimeoutUs, 0, PpfTimedOut);
+}
+
+/**
+ *  @brief      Returns the polling statistics of a TIS wait loop
+ *  @details
+ *
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *  @param      PpsStatistics   Pointer to receive the statistics.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TIS_GetPollStatistics(
+    _In_    UINT32                  PunWaitId,
+    _Out_   TIS_POLL_STATISTICS*    PpsStatistics)
+{
+    if (NULL == PpsStatistics || PunWaitId >= TIS_WAIT_COUNT)
+        return RC_E_BAD_PARAMETER;
+
+    *PpsStatistics = s_rgsPollStatistics[PunWaitId];
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Resets the polling statistics of all TIS wait loops
+ *  @details
+ */
+void
+TIS_ResetPollStatistics()
+{
+    Platform_MemorySet(s_rgsPollStatistics, 0, sizeof(s_rgsPollStatistics));
+}
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TIS_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming)
+{
+    if (NULL == PpsTiming)
+        return RC_E_BAD_PARAMETER;
+
+    *PpsTiming = s_sPhaseTiming;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Finds the transport profile of a TPM model
+ *  @details
+ *
+ *  @param      PusVendorId     Vendor id.
+ *  @param      PusDeviceId     Device id.
+ *  @param      PbRevisionId    Revision id.
+ *
+ *  @returns    The first matching transport profile, the default profile if no other one matches.
+ */
+static
+const TIS_TRANSPORT_PROFILE*
+TIS_FindTransportProfile(
+    _In_    UINT16  PusVendorId,
+    _In_    UINT16  PusDeviceId,
+    _In_    BYTE    PbRevisionId)
+{
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; unIndex < RG_LEN(s_rgsTransportProfiles) - 1; unIndex++)
+    {
+        const TIS_TRANSPORT_PROFILE* psProfile = &s_rgsTransportProfiles[unIndex];
+        if (psProfile->usVendorId == PusVendorId &&
+                (TIS_PROFILE_ANY_DEVICE == psProfile->usDeviceId || psProfile->usDeviceId == PusDeviceId) &&
+                PbRevisionId >= psProfile->bMinRevisionId)
+            return psProfile;
+    }
+
+    return &s_rgsTransportProfiles[RG_LEN(s_rgsTransportProfiles) - 1];
+}
+
+/**
+ *  @brief      Selects the transport profile of the TPM
+ *  @details    Reads the VID, DID and RID registers and applies the poll intervals of the matching profile to the TIS wait
+ *              loops. A TPM without a matching profile uses the conservative default profile.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+TIS_SelectTransportProfile(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    UINT16 usVendorId = 0;
+    UINT16 usDeviceId = 0;
+    BYTE bRevisionId = 0;
+    UINT32 unWaitId = 0;
+
+    do
+    {
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_VID, sizeof(usVendorId), &usVendorId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_DID, sizeof(usDeviceId), &usDeviceId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_RID, sizeof(bRevisionId), &bRevisionId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_psTransportProfile = TIS_FindTransportProfile(usVendorId, usDeviceId, bRevisionId);
+
+        for (unWaitId = 0; unWaitId < TIS_WAIT_COUNT; unWaitId++)
+        {
+            if (TIS_WAIT_BURSTCOUNT == unWaitId)
+                s_rgsBackoffPolicy[unWaitId].unMinSleepUs = s_psTransportProfile->unBurstCountSleepUs;
+            else if (TIS_WAIT_DATA_AVAILABLE == unWaitId)
+                s_rgsBackoffPolicy[unWaitId].unMinSleepUs = s_psTransportProfile->unResponseSleepUs;
+            else
+                s_rgsBackoffPolicy[unWaitId].unMinSleepUs = s_psTransportProfile->unHandshakeSleepUs;
+
+            // Waiting for a response keeps its own upper limit
+            if (TIS_WAIT_DATA_AVAILABLE != unWaitId)
+                s_rgsBackoffPolicy[unWaitId].unMaxSleepUs = s_psTransportProfile->unMaxHandshakeSleepUs;
+        }
+
+        LOGGING_WRITE_LEVEL3_FMT(L"TPM VID 0x%.4X DID 0x%.4X RID 0x%.2X, using transport profile %ls",
+            usVendorId, usDeviceId, bRevisionId, s_psTransportProfile->wszName);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Returns the selected transport profile
+ *  @details
+ *
+ *  @returns    The transport profile selected by TIS_SelectTransportProfile, the default profile before.
+ */
+const TIS_TRANSPORT_PROFILE*
+TIS_GetTransportProfile()
+{
+    return s_psTransportProfile;
+}
+
+/**
+ *  @brief      Reads the identification of the TPM from the interface registers
+ *  @details    Reads the DID_VID, RID, interface capability and interface id registers. The TPM family is derived from the
+ *              interface: the FIFO interface for TPM2.0 implies a TPM2.0, TIS 1.2 and TIS 1.3 imply a TPM1.2. No TPM
+ *              command is sent and the locality does not need to be active. The firmware update hints are taken from the
+ *              transport profile of the TPM model.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpsInfo         Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+TIS_ReadInterfaceInfo(
+    _In_    BYTE                    PbLocality,
+    _Out_   TPM_INTERFACE_INFO*     PpsInfo)
+{
+    UINT32 unReturnCode = RC_E_FAIL;
+    BYTE bInterfaceId = 0;
+    BYTE bCapability = 0;
+    const TIS_TRANSPORT_PROFILE* psProfile = NULL;
+
+    do
+    {
+        if (NULL == PpsInfo)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        Platform_MemorySet(PpsInfo, 0, sizeof(*PpsInfo));
+
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_VID, sizeof(UINT16), &PpsInfo->usVendorId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_DID, sizeof(UINT16), &PpsInfo->usDeviceId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_RID, sizeof(BYTE), &PpsInfo->bRevisionId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INTERFACE_ID, sizeof(BYTE), &bInterfaceId);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_INTF_CAPABILITY_VERSION, sizeof(BYTE), &bCapability);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        PpsInfo->bInterfaceType = bInterfaceId & TIS_TPM_INTERFACE_TYPE_MASK;
+        PpsInfo->bInterfaceVersion = (bCapability & TIS_TPM_INTF_VERSION_MASK) >> 4;
+        PpsInfo->bFamily = TPM_INTERFACE_FAMILY_UNKNOWN;
+
+        psProfile = TIS_FindTransportProfile(PpsInfo->usVendorId, PpsInfo->usDeviceId, PpsInfo->bRevisionId);
+        PpsInfo->unBlockLatencyUs = psProfile->unBlockLatencyUs;
+        PpsInfo->usFieldUpgradeBlockSize = psProfile->usFieldUpgradeBlockSize;
+
+        // All bits set means the TPM does not respond (e.g. while it restarts)
+        if (0xFFFF == PpsInfo->usVendorId || 0xFF == bCapability)
+            break;
+
+        if (TIS_TPM_INTERFACE_TYPE_FIFO == PpsInfo->bInterfaceType && TIS_TPM_INTF_VERSION_FIFO20 == (bCapability & TIS_TPM_INTF_VERSION_MASK))
+            PpsInfo->bFamily = TPM_INTERFACE_FAMILY_TPM20;
+        else if (TIS_TPM_INTERFACE_TYPE_TIS == PpsInfo->bInterfaceType &&
+                 (TIS_TPM_INTF_VERSION_TIS12 == (bCapability & TIS_TPM_INTF_VERSION_MASK) || TIS_TPM_INTF_VERSION_TIS13 == (bCapability & TIS_TPM_INTF_VERSION_MASK)))
+            PpsInfo->bFamily = TPM_INTERFACE_FAMILY_TPM12;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Returns the base address of the register space of a locality
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpunAddress     Pointer to the base address.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+static
+UINT32
+TIS_GetLocalityAddress(
+    _In_    BYTE    PbLocality,
+    _Out_   UINT32* PpunAddress)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    switch (PbLocality)
+    {
+        case TIS_LOCALITY_0:
+            *PpunAddress = TIS_LOCALITY0OFFSET;
+            break;
+
+        case TIS_LOCALITY_1:
+            *PpunAddress = TIS_LOCALITY1OFFSET;
+            break;
+
+        case TIS_LOCALITY_2:
+            *PpunAddress = TIS_LOCALITY2OFFSET;
+            break;
+
+        case TIS_LOCALITY_3:
+            *PpunAddress = TIS_LOCALITY3OFFSET;
+            break;
+
+        case TIS_LOCALITY_4:
+            *PpunAddress = TIS_LOCALITY4OFFSET;
+            break;
+
+        default:
+            unReturnCode = RC_E_LOCALITY_NOT_SUPPORTED;
+    }
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Checks that the locality is active
+ *  @details    Within a locality session whose locality was already seen active nothing but this driver could have
+ *              changed TPM.ACCESS, so the register is not read again. Otherwise TPM.ACCESS is read.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The locality is active.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Not an active locality.
+ *  @retval     ...                         Error codes from TIS_IsActiveLocality function.
+ */
+static
+UINT32
+TIS_CheckActiveLocality(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    BOOL bFlag = FALSE;
+
+    do
+    {
+        if (s_fSessionLocalityVerified && TIS_IsLocalitySessionActive(PbLocality))
+            break;
+
+        unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        if (FALSE == bFlag)
+            unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
 }
 
 /**
@@ -138,6 +979,7 @@ TIS_KeepLocalityActive()
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
  *  @retval     RC_E_BAD_PARAMETER          Invalid register size requested.
+ *  @retval     RC_E_BUS_ERROR              The bus transaction failed.
  */
 _Check_return_
 UINT32
@@ -158,31 +1000,7 @@ TIS_ReadRegister(
             break;
         }
 
-        switch (PbLocality)
-        {
-            case TIS_LOCALITY_0:
-                unAddress = TIS_LOCALITY0OFFSET;
-                break;
-
-            case TIS_LOCALITY_1:
-                unAddress = TIS_LOCALITY1OFFSET;
-                break;
-
-            case TIS_LOCALITY_2:
-                unAddress = TIS_LOCALITY2OFFSET;
-                break;
-
-            case TIS_LOCALITY_3:
-                unAddress = TIS_LOCALITY3OFFSET;
-                break;
-
-            case TIS_LOCALITY_4:
-                unAddress = TIS_LOCALITY4OFFSET;
-                break;
-
-            default:
-                unReturnCode = RC_E_LOCALITY_NOT_SUPPORTED;
-        }
+        unReturnCode = TIS_GetLocalityAddress(PbLocality, &unAddress);
 
         if (RC_SUCCESS != unReturnCode)
         {
@@ -196,11 +1014,11 @@ TIS_ReadRegister(
         switch (PbRegSize)
         {
             case sizeof(BYTE):
-                *(BYTE*)PpValue = DeviceAccess_ReadByte(unAddress);
+                unReturnCode = DeviceAccess_ReadByteEx(unAddress, (BYTE*)PpValue);
                 break;
 
             case sizeof(UINT16):
-                *(UINT16*)PpValue = DeviceAccess_ReadWord(unAddress);
+                unReturnCode = DeviceAccess_ReadWordEx(unAddress, (UINT16*)PpValue);
                 break;
 
             default:
@@ -226,6 +1044,7 @@ TIS_ReadRegister(
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
  *  @retval     RC_E_BAD_PARAMETER          Invalid register size requested.
+ *  @retval     RC_E_BUS_ERROR              The bus transaction failed.
  */
 _Check_return_
 UINT32
@@ -240,31 +1059,7 @@ TIS_WriteRegister(
 
     do
     {
-        switch (PbLocality)
-        {
-            case TIS_LOCALITY_0:
-                unAddress = TIS_LOCALITY0OFFSET;
-                break;
-
-            case TIS_LOCALITY_1:
-                unAddress = TIS_LOCALITY1OFFSET;
-                break;
-
-            case TIS_LOCALITY_2:
-                unAddress = TIS_LOCALITY2OFFSET;
-                break;
-
-            case TIS_LOCALITY_3:
-                unAddress = TIS_LOCALITY3OFFSET;
-                break;
-
-            case TIS_LOCALITY_4:
-                unAddress = TIS_LOCALITY4OFFSET;
-                break;
-
-            default:
-                unReturnCode = RC_E_LOCALITY_NOT_SUPPORTED;
-        }
+        unReturnCode = TIS_GetLocalityAddress(PbLocality, &unAddress);
 
         if (RC_SUCCESS != unReturnCode)
             break;
@@ -275,11 +1070,11 @@ TIS_WriteRegister(
         switch (PbRegSize)
         {
             case sizeof(BYTE):
-                DeviceAccess_WriteByte(unAddress, (BYTE)PunValue);
+                unReturnCode = DeviceAccess_WriteByteEx(unAddress, (BYTE)PunValue);
                 break;
 
             case sizeof(UINT16):
-                DeviceAccess_WriteWord(unAddress, (UINT16)PunValue);
+                unReturnCode = DeviceAccess_WriteWordEx(unAddress, (UINT16)PunValue);
                 break;
 
             default:
@@ -292,6 +1087,92 @@ TIS_WriteRegister(
     return unReturnCode;
 }
 
+/**
+ *  @brief      Read a block of data from the TIS data FIFO
+ *  @details    The block is transferred in a single bus transaction. The caller must ensure that PusLen
+ *              does not exceed the current burst count.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Pointer to buffer to store bytes.
+ *  @param      PusLen          Number of bytes to read.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ *  @retval     RC_E_BAD_PARAMETER          PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from DeviceAccess_ReadBlock function.
+ */
+_Check_return_
+UINT32
+TIS_ReadDataFifo(
+    _In_                    BYTE    PbLocality,
+    _Out_bytecap_(PusLen)   BYTE*   PrgbByteBuf,
+    _In_                    UINT16  PusLen)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (NULL == PrgbByteBuf)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = TIS_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = DeviceAccess_ReadBlock(unAddress | TIS_TPM_DATA_FIFO, PrgbByteBuf, PusLen);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Write a block of data to the TIS data FIFO
+ *  @details    The block is transferred in a single bus transaction. The caller must ensure that PusLen
+ *              does not exceed the current burst count.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Bytes to write.
+ *  @param      PusLen          Number of bytes to write.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ *  @retval     RC_E_BAD_PARAMETER          PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from DeviceAccess_WriteBlock function.
+ */
+_Check_return_
+UINT32
+TIS_WriteDataFifo(
+    _In_                    BYTE        PbLocality,
+    _In_bytecount_(PusLen)  const BYTE* PrgbByteBuf,
+    _In_                    UINT16      PusLen)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    UINT32 unAddress = 0;
+
+    do
+    {
+        if (NULL == PrgbByteBuf)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        unReturnCode = TIS_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        unReturnCode = DeviceAccess_WriteBlock(unAddress | TIS_TPM_DATA_FIFO, PrgbByteBuf, PusLen);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
 /**
  *  @brief      Read the value from the access register
  *  @details
@@ -345,7 +1226,6 @@ TIS_ReadStsRegister(
     _Out_   BYTE*   PpbValue)
 {
     UINT32 unReturnCode = RC_SUCCESS;
-    BOOL bFlag = FALSE;
 
     do
     {
@@ -359,16 +1239,10 @@ TIS_ReadStsRegister(
         *PpbValue = 0;
 
         // Check whether the requested locality is active.
-        unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
+        unReturnCode = TIS_CheckActiveLocality(PbLocality);
         if (RC_SUCCESS != unReturnCode)
             break;
 
-        if (FALSE == bFlag)
-        {
-            unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
-            break;
-        }
-
         s_fCachedStatusRegisterValid = FALSE;
         unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_STS, sizeof(BYTE), PpbValue);
         if (RC_SUCCESS == unReturnCode)
@@ -401,21 +1275,14 @@ TIS_WriteStsRegister(
     _In_    BYTE    PbValue)
 {
     UINT32 unReturnCode = RC_SUCCESS;
-    BOOL bFlag = FALSE;
 
     do
     {
         // Check whether requested Locality is active
-        unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
+        unReturnCode = TIS_CheckActiveLocality(PbLocality);
         if (RC_SUCCESS != unReturnCode)
             break;
 
-        if (FALSE == bFlag)
-        {
-            unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
-            break;
-        }
-
         unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_STS, sizeof(BYTE), (UINT32)PbValue);
     }
     WHILE_FALSE_END;
@@ -425,7 +1292,7 @@ TIS_WriteStsRegister(
 
 /**
  *  @brief      Returns the value of TPM.ACCESS.VALID
- *  @details
+ *  @details    An all-ones register value is reported as not valid since the TPM does not respond in this case.
  *
  *  @param      PbLocality      Locality value.
  *  @param      PpbFlag         Pointer to a BOOL flag.
@@ -447,7 +1314,8 @@ TIS_IsAccessValid(
         unReturnCode = TIS_ReadAccessRegister(PbLocality, &bValue);
         if (unReturnCode == RC_SUCCESS)
         {
-            if (bValue & TIS_TPM_ACCESS_VALID)
+            // All bits set means the TPM does not respond (e.g. while it restarts)
+            if ((bValue & TIS_TPM_ACCESS_VALID) && 0xFF != bValue)
                 *PpbFlag = TRUE;
             else
                 *PpbFlag = FALSE;
@@ -517,6 +1385,7 @@ TIS_ReleaseActiveLocality(
 
     // To clear the active Locality a 1 must be written to ACCESS.activeLocality
     BYTE bValue = TIS_TPM_ACCESS_ACTIVELOCALITY;
+    s_fSessionLocalityVerified = FALSE;
     unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_ACCESS, sizeof(BYTE), (UINT32)bValue);
 
     return unReturnCode;
@@ -541,11 +1410,53 @@ TIS_RequestUse(
 
     // To request the TPM for a given Locality a 1 must be written to ACCESS.requestUse
     bValue = TIS_TPM_ACCESS_REQUESTUSE;
+    s_fSessionLocalityVerified = FALSE;
     unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_ACCESS, sizeof(BYTE), (UINT32)bValue);
 
     return unReturnCode;
 }
 
+/**
+ *  @brief      Yields the session locality if another locality is waiting for the TPM
+ *  @details    Called between two TPM commands of a locality session. The ACCESS register is read once and the
+ *              locality is only released if ACCESS.pendingRequest is set, so without a competing agent the locality
+ *              stays active for the whole session. A yielded locality is requested again by the next TIS_SendLPC.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadAccessRegister and TIS_ReleaseActiveLocality functions.
+ */
+static
+UINT32
+TIS_YieldLocalityOnPendingRequest(
+    _In_    BYTE    PbLocality)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+    BYTE bAccess = 0;
+
+    do
+    {
+        unReturnCode = TIS_ReadAccessRegister(PbLocality, &bAccess);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        if (TIS_TPM_ACCESS_VALID != (bAccess & TIS_TPM_ACCESS_VALID) ||
+                TIS_TPM_ACCESS_PENDINGREQUEST != (bAccess & TIS_TPM_ACCESS_PENDINGREQUEST))
+            break;
+
+        LOGGING_WRITE_LEVEL3_FMT(L"TIS_YieldLocalityOnPendingRequest: Another locality is pending, yielding locality 0x%.2X (ACCESS 0x%.2X)", PbLocality, bAccess);
+        unReturnCode = TIS_ReleaseActiveLocality(PbLocality);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_fSessionLocalityYielded = TRUE;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnCode;
+}
+
 /**
  *  @brief      Returns the value of TPM.STS.BURSTCOUNT
  *  @details
@@ -555,42 +1466,78 @@ TIS_RequestUse(
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Not an active locality.
+ *  @retval     ...                         Error codes from TIS_ReadStsAndBurstCount function.
+ */
+_Check_return_
+UINT32
+TIS_GetBurstCount(
+    _In_    BYTE    PbLocality,
+    _Out_   UINT16* PpusBurstCount)
+{
+    BYTE bStatus = 0;
+
+    return TIS_ReadStsAndBurstCount(PbLocality, &bStatus, PpusBurstCount);
+}
+
+/**
+ *  @brief      Returns the values of TPM.STS and TPM.STS.BURSTCOUNT
+ *  @details    Both are read in one 4-byte transaction at TPM.STS (status, burst count, extended status).
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpbStatus       Pointer to the status register variable.
+ *  @param      PpusBurstCount  Pointer to the Burst Count variable.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Not an active locality.
  *  @retval     ...                         Error codes from:
  *                                              TIS_IsActiveLocality
- *                                              TIS_ReadRegister function
+ *                                              DeviceAccess_ReadBlock function
  */
 _Check_return_
 UINT32
-TIS_GetBurstCount(
+TIS_ReadStsAndBurstCount(
     _In_    BYTE    PbLocality,
+    _Out_   BYTE*   PpbStatus,
     _Out_   UINT16* PpusBurstCount)
 {
     UINT32 unReturnCode = RC_E_FAIL;
-    BOOL bFlag = FALSE;
+    UINT32 unAddress = 0;
+    BYTE rgbStatus[4] = {0};
 
     do
     {
-        if (NULL == PpusBurstCount)
+        if (NULL == PpbStatus || NULL == PpusBurstCount)
         {
             unReturnCode = RC_E_BAD_PARAMETER;
             break;
         }
 
-        // Initialize return parameter
+        // Initialize return parameters
+        *PpbStatus = 0;
         *PpusBurstCount = 0;
 
         // Check whether requested Locality is active
-        unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
+        unReturnCode = TIS_CheckActiveLocality(PbLocality);
         if (RC_SUCCESS != unReturnCode)
             break;
 
-        if (FALSE == bFlag)
-        {
-            unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
+        unReturnCode = TIS_GetLocalityAddress(PbLocality, &unAddress);
+        if (RC_SUCCESS != unReturnCode)
+            break;
+
+        s_fCachedStatusRegisterValid = FALSE;
+        unReturnCode = DeviceAccess_ReadBlock(unAddress | TIS_TPM_STS, rgbStatus, sizeof(rgbStatus));
+        if (RC_SUCCESS != unReturnCode)
             break;
-        }
 
-        unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_BURSTCOUNT, sizeof(UINT16), PpusBurstCount);
+        // Cache the register value for troubleshooting.
+        s_bCachedStatusRegister = rgbStatus[0];
+        s_fCachedStatusRegisterValid = TRUE;
+
+        // The burst count is stored little endian after the status byte
+        *PpbStatus = rgbStatus[0];
+        *PpusBurstCount = (UINT16)(rgbStatus[1] | (rgbStatus[2] << 8));
     }
     WHILE_FALSE_END;
 
@@ -708,33 +1655,199 @@ TIS_IsDataAvailable(
 }
 
 /**
- *  @brief      Lets the TPM repeat the last response
+ *  @brief      Lets the TPM repeat the last response
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadStsRegister function.
+ */
+_Check_return_
+UINT32
+TIS_Retry(
+    _In_    BYTE    PbLocality)
+{
+    return TIS_WriteStsRegister(PbLocality, TIS_TPM_STS_RETRY);
+}
+
+/**
+ *  @brief      Condition callback: TPM.ACCESS.activeLocality is set
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Not used.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_IsActiveLocality function.
+ */
+static
+UINT32
+TIS_ConditionLocalityActive(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    UNREFERENCED_PARAMETER(PpvContext);
+    return TIS_IsActiveLocality(PbLocality, PpfConditionMet);
+}
+
+/**
+ *  @brief      Condition callback: TPM.STS.commandReady is set
+ *  @details    The status and the burst count are read in one transaction, so the first burst of a command can be
+ *              written without reading the burst count again.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Pointer to a UINT16 receiving the burst count.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadStsAndBurstCount function.
+ */
+static
+UINT32
+TIS_ConditionCommandReady(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    BYTE bValue = 0;
+    UINT32 unReturnCode = TIS_ReadStsAndBurstCount(PbLocality, &bValue, (UINT16*)PpvContext);
+    *PpfConditionMet = (RC_SUCCESS == unReturnCode && (bValue & TIS_TPM_STS_CMDRDY)) ? TRUE : FALSE;
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Condition callback: TPM.STS.burstCount is greater than zero
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Pointer to a UINT16 receiving the burst count.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_GetBurstCount function.
+ */
+static
+UINT32
+TIS_ConditionBurstCount(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    UINT32 unReturnCode = TIS_GetBurstCount(PbLocality, (UINT16*)PpvContext);
+    *PpfConditionMet = (RC_SUCCESS == unReturnCode && 0 < *(UINT16*)PpvContext) ? TRUE : FALSE;
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Condition callback: TPM.STS.stsValid and TPM.STS.Expect are set
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Pointer to a BYTE receiving the status register value.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadStsRegister function.
+ */
+static
+UINT32
+TIS_ConditionStsExpect(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    BYTE* pbValue = (BYTE*)PpvContext;
+    UINT32 unReturnCode = TIS_ReadStsRegister(PbLocality, pbValue);
+    *PpfConditionMet = (RC_SUCCESS == unReturnCode && (*pbValue & TIS_TPM_STS_VALID) && (*pbValue & TIS_TPM_STS_EXPECT)) ? TRUE : FALSE;
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Condition callback: TPM.STS.stsValid is set and TPM.STS.Expect is cleared
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Pointer to a BYTE receiving the status register value.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadStsRegister function.
+ */
+static
+UINT32
+TIS_ConditionStsNotExpect(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    BYTE* pbValue = (BYTE*)PpvContext;
+    UINT32 unReturnCode = TIS_ReadStsRegister(PbLocality, pbValue);
+    *PpfConditionMet = (RC_SUCCESS == unReturnCode && (*pbValue & TIS_TPM_STS_VALID) && !(*pbValue & TIS_TPM_STS_EXPECT)) ? TRUE : FALSE;
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Condition callback: TPM.STS.stsValid is set and TPM.STS.dataAvail is cleared
  *  @details
  *
  *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Pointer to a BYTE receiving the status register value.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
  *
  *  @retval     RC_SUCCESS      The operation completed successfully.
  *  @retval     ...             Error codes from TIS_ReadStsRegister function.
  */
-_Check_return_
+static
 UINT32
-TIS_Retry(
-    _In_    BYTE    PbLocality)
+TIS_ConditionStsNotAvailable(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
 {
-    return TIS_WriteStsRegister(PbLocality, TIS_TPM_STS_RETRY);
+    BYTE* pbValue = (BYTE*)PpvContext;
+    UINT32 unReturnCode = TIS_ReadStsRegister(PbLocality, pbValue);
+    *PpfConditionMet = (RC_SUCCESS == unReturnCode && (*pbValue & TIS_TPM_STS_VALID) && !(*pbValue & TIS_TPM_STS_AVAIL)) ? TRUE : FALSE;
+    return unReturnCode;
 }
 
 /**
- *  @brief      Send data block to the TPM
- *  @details    Send a data block to the TPM TIS data FIFO under consideration of the
- *              TIS communication protocol
+ *  @brief      Condition callback: TPM.STS.stsValid and TPM.STS.dataAvail are set
+ *  @details
  *
  *  @param      PbLocality      Locality value.
- *  @param      PrgbByteBuf     Bytes to send.
- *  @param      PusLen          Length of bytes.
+ *  @param      PpvContext      Not used.
+ *  @param      PpfConditionMet Set to TRUE if the condition is met.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_IsDataAvailable function.
+ */
+static
+UINT32
+TIS_ConditionDataAvailable(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet)
+{
+    UNREFERENCED_PARAMETER(PpvContext);
+    return TIS_IsDataAvailable(PbLocality, PpfConditionMet);
+}
+
+/**
+ *  @brief      Send a scattered data block to the TPM
+ *  @details    Send the segments of a data block to the TPM TIS data FIFO under consideration of the
+ *              TIS communication protocol. The segments are written in order as one TPM command, each burst
+ *              is taken directly from the segment buffers.
+ *
+ *  @param      PbLocality          Locality value.
+ *  @param      PrgsSegments        Segments to send.
+ *  @param      PunSegmentCount     Number of segments.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgbByteBuf is NULL.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgsSegments is NULL, a
+ *                                          segment has no data or the total size exceeds 0xFFFF bytes.
  *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Locality not active.
  *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
  *  @retval     RC_E_NOT_READY              Not ready.
@@ -742,194 +1855,187 @@ TIS_Retry(
  *  @retval     ...                         Error codes from:
  *                                              TIS_RequestUse,
  *                                              TIS_IsActiveLocality,
- *                                              TIS_IsCommandReady,
+ *                                              TIS_ReadStsAndBurstCount,
  *                                              TIS_Abort,
  *                                              TIS_GetBurstCount,
  *                                              TIS_WriteRegister,
+ *                                              TIS_WriteDataFifo,
  *                                              TIS_ReadStsRegister function
  */
 _Check_return_
 UINT32
-TIS_SendLPC(
-    _In_                    BYTE        PbLocality,
-    _In_bytecount_(PusLen)  const BYTE* PrgbByteBuf,
-    _In_                    UINT16      PusLen)
+TIS_SendLPCSegments(
+    _In_                            BYTE                    PbLocality,
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            UINT32                  PunSegmentCount)
 {
     UINT32 unReturnCode = RC_SUCCESS;
     BYTE bValue = 0;
-    BYTE i = 0;
     BOOL bFlag = FALSE;
     UINT16 usBurstCount = 0;
     UINT16 usTxSize = 0;
-    UINT32 unTimeOut = 0;
-    UINT32 unPosition = 0;
+    BOOL fTimedOut = FALSE;
+    UINT32 unSegment = 0;
+    UINT32 unOffset = 0;
+    UINT32 unTotalSize = 0;
+    BOOL fInSession = FALSE;
+    UINT64 ullStartTicks = Platform_GetTicks();
 
     do
     {
         // Check input parameter
-        if (NULL == PrgbByteBuf)
+        if (NULL == PrgsSegments || 0 == PunSegmentCount)
         {
             unReturnCode = RC_E_BAD_PARAMETER;
             break;
         }
-
-        usTxSize = PusLen;
-
-        if (!s_fKeepLocality)
+        for (unSegment = 0; unSegment < PunSegmentCount; unSegment++)
         {
-            // Request the locality
-            unReturnCode = TIS_RequestUse(PbLocality);
-            if (RC_SUCCESS != unReturnCode)
+            if (NULL == PrgsSegments[unSegment].pbData && 0 != PrgsSegments[unSegment].unSize)
                 break;
+            unTotalSize += PrgsSegments[unSegment].unSize;
+        }
+        if (unSegment < PunSegmentCount || unTotalSize > 0xFFFF)
+        {
+            unReturnCode = RC_E_BAD_PARAMETER;
+            break;
         }
+        unSegment = 0;
 
-        // Check whether requested Locality is active, timeout after TIMEOUT_A
-        unTimeOut = (TIMEOUT_A * 1000) / SLEEP_TIME_US_CR;
-        do
+        usTxSize = (UINT16)unTotalSize;
+
+        // A new command starts, a bus error of a previous one must not abort it
+        DeviceAccess_ClearBusError();
+
+        // Keep the bus duty cycle cap before the transmit transactions start
+        DeviceAccess_Throttle();
+
+        fInSession = TIS_IsLocalitySessionActive(PbLocality);
+        if (!fInSession || !s_fSessionLocalityVerified)
         {
-            unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
+            if ((!s_fKeepLocality && !fInSession) || (fInSession && s_fSessionLocalityYielded))
+            {
+                // Request the locality (again if it was yielded within the session)
+                unReturnCode = TIS_RequestUse(PbLocality);
+                if (RC_SUCCESS != unReturnCode)
+                    break;
+            }
+
+            // Check whether requested Locality is active, timeout after TIMEOUT_A
+            unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_LOCALITY_ACTIVE, TIS_ConditionLocalityActive, NULL, TIMEOUT_A * 1000, &fTimedOut);
+            if (fTimedOut)
+            {
+                unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
+                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Locality 0x%.2X not active after %d us (timeout %d ms) (0x%.8x)", PbLocality, s_rgsPollStatistics[TIS_WAIT_LOCALITY_ACTIVE].unLastWaitUs, TIMEOUT_A, unReturnCode);
+                break;
+            }
             if (RC_SUCCESS != unReturnCode)
             {
                 TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to test the active locality (0x%.8x)", unReturnCode);
-                unTimeOut = 0;  // Stop immediately on error
+                break;
             }
-            else if (TRUE == bFlag)
-                unTimeOut = 0;  // Stop immediately if flag is set
-            else
+
+            // Within a session the locality stays active, no need to poll it again before the next command
+            if (fInSession)
             {
-                Platform_SleepMicroSeconds(SLEEP_TIME_US_CR);
-                unTimeOut = unTimeOut - 1;
-                if (0 == unTimeOut)
-                {
-                    unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
-                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Locality 0x%.2X not active after 750ms (0x%.8x)", PbLocality, unReturnCode);
-                }
+                s_fSessionLocalityVerified = TRUE;
+                s_fSessionLocalityYielded = FALSE;
             }
         }
-        while (unTimeOut > 0);
-        if (RC_SUCCESS != unReturnCode)
-            break;
 
-        // Check the commandReady flag first
-        unReturnCode = TIS_IsCommandReady(PbLocality, &bFlag);
+        // Check the commandReady flag first, the burst count for the first burst is read in the same transaction
+        unReturnCode = TIS_ConditionCommandReady(PbLocality, &usBurstCount, &bFlag);
         if (FALSE == bFlag)
         {
+            usBurstCount = 0;
             unReturnCode = TIS_Abort(PbLocality);
             if (RC_SUCCESS != unReturnCode)
                 break;
 
             // Check whether the TPM can receive a command, timeout after TIMEOUT_B
-            unTimeOut = (TIMEOUT_B * 1000) / SLEEP_TIME_US;
-            do
+            unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_COMMAND_READY, TIS_ConditionCommandReady, &usBurstCount, TIMEOUT_B * 1000, &fTimedOut);
+            if (fTimedOut)
             {
-                unReturnCode = TIS_IsCommandReady(PbLocality, &bFlag);
-                if (RC_SUCCESS != unReturnCode)
-                {
-                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the command ready flag (0x%.8x)", unReturnCode);
-                    unTimeOut = 0;  // Stop immediately on error
-                }
-                else if (TRUE == bFlag)
-                    unTimeOut = 0;  // Stop immediately if flag is set
-                else
-                {
-                    Platform_SleepMicroSeconds(SLEEP_TIME_US);
-                    unTimeOut = unTimeOut - 1;
-                    if (0 == unTimeOut)
-                    {
-                        unReturnCode = RC_E_NOT_READY;
-                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Command ready flag not set after 2000ms (0x%.8x)", unReturnCode);
-                    }
-                }
+                unReturnCode = RC_E_NOT_READY;
+                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Command ready flag not set after %d us (timeout %d ms) (0x%.8x)", s_rgsPollStatistics[TIS_WAIT_COMMAND_READY].unLastWaitUs, TIMEOUT_B, unReturnCode);
+            }
+            else if (RC_SUCCESS != unReturnCode)
+            {
+                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the command ready flag (0x%.8x)", unReturnCode);
             }
-            while (unTimeOut > 0);
         }
         if (RC_SUCCESS != unReturnCode)
             break;
 
-        if (PusLen > 9)     // 10 bytes should always be writable
+        if (usTxSize > 9)     // 10 bytes should always be writable
         {
             do
             {
-                // Read the BurstCount register, timeout after TIMEOUT_C if it remains 0
-                unTimeOut = (TIMEOUT_C * 1000) / SLEEP_TIME_US_BURSTCOUNT;
-                do
+                // Read the BurstCount register unless it came with the commandReady check, timeout after TIMEOUT_C if it remains 0
+                if (0 == usBurstCount)
                 {
-                    unReturnCode = TIS_GetBurstCount(PbLocality, &usBurstCount);
-                    if (RC_SUCCESS != unReturnCode)
+                    unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_BURSTCOUNT, TIS_ConditionBurstCount, &usBurstCount, TIMEOUT_C * 1000, &fTimedOut);
+                    if (fTimedOut)
                     {
-                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the burst count (0x%.8x)", unReturnCode);
-                        unTimeOut = 0;  // Stop immediately on error
+                        unReturnCode = RC_E_NOT_READY;
+                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Burst count not > 0 after %d us (timeout %d ms). Burst count: 0x%.4X (0x%.8x)", s_rgsPollStatistics[TIS_WAIT_BURSTCOUNT].unLastWaitUs, TIMEOUT_C, usBurstCount, unReturnCode);
+                        break;
                     }
-                    else if (0 < usBurstCount)
-                        unTimeOut = 0;
-                    else
+                    if (RC_SUCCESS != unReturnCode)
                     {
-                        Platform_SleepMicroSeconds(SLEEP_TIME_US_BURSTCOUNT);
-                        unTimeOut = unTimeOut - 1;
-                        if (0 == unTimeOut)
-                        {
-                            unReturnCode = RC_E_NOT_READY;
-                            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Burst count not > 0 after 750ms. Burst count: 0x%.4X (0x%.8x)", usBurstCount, unReturnCode);
-                        }
+                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the burst count (0x%.8x)", unReturnCode);
+                        break;
                     }
                 }
-                while (unTimeOut > 0);
-                if (RC_SUCCESS != unReturnCode)
-                    break;
 
-                if (usTxSize > usBurstCount)
+                // Write up to burst count bytes but keep the last byte for the stsValid/Expect check below
+                if (usBurstCount > (usTxSize - 1))
+                    usBurstCount = usTxSize - 1;
+
+                // All OK, now write the burst to the TPM FIFO, one transaction per segment it spans
+                while (usBurstCount > 0)
                 {
-                    for (i = 0; i < usBurstCount; i++)
+                    UINT16 usChunk = 0;
+
+                    // Skip exhausted segments
+                    while (unOffset >= PrgsSegments[unSegment].unSize)
                     {
-                        // All OK, now write Byte to the TPM FIFO
-                        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), (UINT32)*&PrgbByteBuf[unPosition]);
-                        if (RC_SUCCESS != unReturnCode)
-                            break;
-                        unPosition++;
+                        unSegment++;
+                        unOffset = 0;
                     }
-                    usTxSize -= usBurstCount;
-                }
-                else
-                {
-                    for (i = 0; i < (usTxSize - 1); i++)
+
+                    usChunk = usBurstCount;
+                    if (usChunk > PrgsSegments[unSegment].unSize - unOffset)
+                        usChunk = (UINT16)(PrgsSegments[unSegment].unSize - unOffset);
+
+                    unReturnCode = TIS_WriteDataFifo(PbLocality, &PrgsSegments[unSegment].pbData[unOffset], usChunk);
+                    if (RC_SUCCESS != unReturnCode)
                     {
-                        // All OK, now write Byte(s) to the TPM FIFO
-                        unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), (UINT32)*&PrgbByteBuf[unPosition]);
-                        if (RC_SUCCESS != unReturnCode)
-                            break;
-                        unPosition++;
+                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to write %d bytes to the data FIFO (0x%.8x)", usChunk, unReturnCode);
+                        break;
                     }
-                    usTxSize = 1;
+                    unOffset += usChunk;
+                    usBurstCount -= usChunk;
+                    usTxSize -= usChunk;
                 }
                 if (RC_SUCCESS != unReturnCode)
                     break;
             }
             while (usTxSize > 1);
+            if (RC_SUCCESS != unReturnCode)
+                break;
 
             // Last Byte, check stsValid and Expect, timeout after TIMEOUT_C
-            unTimeOut = (TIMEOUT_C * 1000) / SLEEP_TIME_US;
-            do
+            unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_STS_EXPECT, TIS_ConditionStsExpect, &bValue, TIMEOUT_C * 1000, &fTimedOut);
+            if (fTimedOut)
             {
-                unReturnCode = TIS_ReadStsRegister(PbLocality, &bValue);
-                if (RC_SUCCESS != unReturnCode)
-                {
-                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the STS register before last byte (0x%.8x)", unReturnCode);
-                    unTimeOut = 0;  // Stop immediately on error
-                }
-                else if ((bValue & TIS_TPM_STS_VALID) && (bValue & TIS_TPM_STS_EXPECT))
-                    unTimeOut = 0;  // Stop immediately if flag is set
-                else
-                {
-                    Platform_SleepMicroSeconds(SLEEP_TIME_US);
-                    unTimeOut = unTimeOut - 1;
-                    if (0 == unTimeOut)
-                    {
-                        unReturnCode = RC_E_TPM_TRANSMIT_DATA;
-                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: STS register: TPM did not set stsValid and Expect bits after timeout of 750 ms. Register value: 0x%.2X (0x%.8x)", bValue, unReturnCode);
-                    }
-                }
+                unReturnCode = RC_E_TPM_TRANSMIT_DATA;
+                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: STS register: TPM did not set stsValid and Expect bits after %d us (timeout %d ms). Register value: 0x%.2X (0x%.8x)", s_rgsPollStatistics[TIS_WAIT_STS_EXPECT].unLastWaitUs, TIMEOUT_C, bValue, unReturnCode);
+            }
+            else if (RC_SUCCESS != unReturnCode)
+            {
+                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the STS register before last byte (0x%.8x)", unReturnCode);
             }
-            while (unTimeOut > 0);
             if (RC_SUCCESS != unReturnCode)
             {
                 // Warning C6031 can be suppressed here, since in case of failure we can't do anything and we
@@ -941,7 +2047,12 @@ TIS_SendLPC(
                 break;
             }
             // Transmit the last Byte now
-            unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), (UINT32)*&PrgbByteBuf[unPosition]);
+            while (unOffset >= PrgsSegments[unSegment].unSize)
+            {
+                unSegment++;
+                unOffset = 0;
+            }
+            unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), (UINT32)PrgsSegments[unSegment].pbData[unOffset]);
             if (RC_SUCCESS != unReturnCode)
             {
                 // Warning C6031 can be suppressed here, since in case of failure we can't do anything and we do not
@@ -955,40 +2066,33 @@ TIS_SendLPC(
         }
         else // 10 bytes should always be writable.
         {
-            for (i = 0; i < PusLen; i++)
+            // All OK, now write the Bytes to the TPM FIFO
+            for (unSegment = 0; unSegment < PunSegmentCount; unSegment++)
             {
-                // All OK, now write Byte to the TPM FIFO
-                unReturnCode = TIS_WriteRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), (UINT32)*&PrgbByteBuf[unPosition]);
+                if (0 == PrgsSegments[unSegment].unSize)
+                    continue;
+                unReturnCode = TIS_WriteDataFifo(PbLocality, PrgsSegments[unSegment].pbData, (UINT16)PrgsSegments[unSegment].unSize);
                 if (RC_SUCCESS != unReturnCode)
+                {
+                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to write %d bytes to the data FIFO (0x%.8x)", PrgsSegments[unSegment].unSize, unReturnCode);
                     break;
-                unPosition++;
+                }
             }
+            if (RC_SUCCESS != unReturnCode)
+                break;
         }
 
         // After the last Byte, check stsValid=TRUE and Expect=FALSE, timeout after TIMEOUT_C
-        unTimeOut = (TIMEOUT_C * 1000) / SLEEP_TIME_US;
-        do
+        unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_STS_NOT_EXPECT, TIS_ConditionStsNotExpect, &bValue, TIMEOUT_C * 1000, &fTimedOut);
+        if (fTimedOut)
         {
-            unReturnCode = TIS_ReadStsRegister(PbLocality, &bValue);
-            if (RC_SUCCESS != unReturnCode)
-            {
-                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the STS register after last byte (0x%.8x)", unReturnCode);
-                unTimeOut = 0;  // Stop immediately on error
-            }
-            else if ((bValue & TIS_TPM_STS_VALID) && (!(bValue & TIS_TPM_STS_EXPECT)))
-                unTimeOut = 0;  // Stop immediately if condition is met
-            else
-            {
-                Platform_SleepMicroSeconds(SLEEP_TIME_US);
-                unTimeOut = unTimeOut - 1;
-                if (0 == unTimeOut)
-                {
-                    unReturnCode = RC_E_TPM_TRANSMIT_DATA;
-                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: STS register: TPM did not set stsValid and !Expect bit after timeout of 750 ms. Register value: 0x%.2X (0x%.8x)", bValue, unReturnCode);
-                }
-            }
+            unReturnCode = RC_E_TPM_TRANSMIT_DATA;
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: STS register: TPM did not set stsValid and !Expect bit after %d us (timeout %d ms). Register value: 0x%.2X (0x%.8x)", s_rgsPollStatistics[TIS_WAIT_STS_NOT_EXPECT].unLastWaitUs, TIMEOUT_C, bValue, unReturnCode);
+        }
+        else if (RC_SUCCESS != unReturnCode)
+        {
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_SendLPC: Failed to read the STS register after last byte (0x%.8x)", unReturnCode);
         }
-        while (unTimeOut > 0);
         if (RC_SUCCESS != unReturnCode)
         {
             // Warning C6031 can be suppressed here, since in case of failure we can't do anything and we
@@ -1004,9 +2108,49 @@ TIS_SendLPC(
     }
     WHILE_FALSE_END;
 
+    // A new command starts, so the receive phases of the previous one are discarded
+    s_sPhaseTiming.ullSendUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+    s_sPhaseTiming.ullWaitUs = 0;
+    s_sPhaseTiming.ullReceiveUs = 0;
+
+    // The TPM may have lost the locality (e.g. by a restart), verify it again before the next command
+    if (RC_SUCCESS != unReturnCode)
+        s_fSessionLocalityVerified = FALSE;
+
     return unReturnCode;
 }
 
+/**
+ *  @brief      Send data block to the TPM
+ *  @details    Send a data block to the TPM TIS data FIFO under consideration of the
+ *              TIS communication protocol
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Bytes to send.
+ *  @param      PusLen          Length of bytes.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from TIS_SendLPCSegments function
+ */
+_Check_return_
+UINT32
+TIS_SendLPC(
+    _In_                    BYTE        PbLocality,
+    _In_bytecount_(PusLen)  const BYTE* PrgbByteBuf,
+    _In_                    UINT16      PusLen)
+{
+    TPM_TX_SEGMENT sSegment;
+
+    if (NULL == PrgbByteBuf)
+        return RC_E_BAD_PARAMETER;
+
+    sSegment.pbData = PrgbByteBuf;
+    sSegment.unSize = PusLen;
+
+    return TIS_SendLPCSegments(PbLocality, &sSegment, 1);
+}
+
 /**
  *  @brief      Read a data block from the TPM TIS port
  *  @details
@@ -1025,9 +2169,9 @@ TIS_SendLPC(
  *  @retval     RC_E_TPM_TRANSMIT_DATA      Error during transmit data.
  *  @retval     ...                         Error codes from:
  *                                              TIS_IsActiveLocality,
- *                                              TIS_ReadStsRegister,
+ *                                              TIS_ReadStsAndBurstCount,
  *                                              TIS_GetBurstCount,
- *                                              TIS_ReadRegister,
+ *                                              TIS_ReadDataFifo,
  *                                              TIS_ReadStsRegister,
  *                                              TIS_IsCommandReady,
  *                                              TIS_Abort,
@@ -1043,15 +2187,13 @@ TIS_ReadLPC(
     UINT32 unReturnCode = RC_SUCCESS;
     BYTE bValue = 0;
     BYTE bRetryCount = 0;
-    BOOL bFlag = FALSE;
     BOOL bUpdateBytes2Read = FALSE;
     BOOL bRxDone = FALSE;
     UINT16 usBurstCount = 0;
     UINT16 usRxSize = 0;
     UINT16 usBytes2Read = 0;
-    UINT32 unTimeOut = 0;
+    BOOL fTimedOut = FALSE;
     BYTE *pbRxData = NULL;
-    BYTE i = 0;
 
     do
     {
@@ -1079,14 +2221,14 @@ TIS_ReadLPC(
             }
 
             // Check whether requested Locality is active
-            unReturnCode = TIS_IsActiveLocality(PbLocality, &bFlag);
-            if (RC_SUCCESS != unReturnCode)
+            unReturnCode = TIS_CheckActiveLocality(PbLocality);
+            if (RC_E_LOCALITY_NOT_ACTIVE != unReturnCode && RC_SUCCESS != unReturnCode)
             {
                 TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: ACCESS register cannot be read (0x%.8x)", unReturnCode);
                 bRxDone = TRUE; // Retry not reasonable if ACCESS register cannot be read
                 break;  // Stop immediately on Error
             }
-            if (FALSE == bFlag)
+            if (RC_E_LOCALITY_NOT_ACTIVE == unReturnCode)
             {
                 unReturnCode = RC_E_LOCALITY_NOT_ACTIVE;
                 TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: Requested locality is not available (0x%.8x)", unReturnCode);
@@ -1094,8 +2236,8 @@ TIS_ReadLPC(
                 break;
             }
 
-            // Check whether there are already data available
-            unReturnCode = TIS_ReadStsRegister(PbLocality, &bValue);
+            // Check whether there are already data available, the burst count for the first burst is read in the same transaction
+            unReturnCode = TIS_ReadStsAndBurstCount(PbLocality, &bValue, &usBurstCount);
             if (RC_SUCCESS != unReturnCode)
             {
                 TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: STS register cannot be read (0x%.8x)", unReturnCode);
@@ -1116,63 +2258,55 @@ TIS_ReadLPC(
 
             while ((usBytes2Read - usRxSize) > 0)
             {
-                // Read the BurstCounter whether there are Bytes in the data FIFO
-                unTimeOut = (TIMEOUT_D * 1000) / SLEEP_TIME_US_BURSTCOUNT;
-                do
+                // Read the BurstCounter whether there are Bytes in the data FIFO unless it came with the status read
+                if (0 == usBurstCount)
                 {
-                    unReturnCode = TIS_GetBurstCount(PbLocality, &usBurstCount);
+                    unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_BURSTCOUNT, TIS_ConditionBurstCount, &usBurstCount, TIMEOUT_D * 1000, &fTimedOut);
                     if (RC_SUCCESS != unReturnCode)
-                        unTimeOut = 0;  // Stop immediately on Error
-                    else if (usBurstCount > 0)
-                        unTimeOut = 0;
-                    else
                     {
-                        Platform_SleepMicroSeconds(SLEEP_TIME_US_BURSTCOUNT);
-                        unTimeOut = unTimeOut - 1;
-                        if (0 == unTimeOut)
-                            unReturnCode = RC_E_NOT_READY;
+                        bRxDone = FALSE;    // It could make sense to retry
+                        break;
                     }
                 }
-                while (unTimeOut > 0);
-                if (RC_SUCCESS != unReturnCode)
-                {
-                    bRxDone = FALSE;    // It could make sense to retry
-                    break;
-                }
                 // Set BurstCount to the actual number of Bytes to be read
                 if (usBurstCount > (usBytes2Read - usRxSize))
                     usBurstCount = usBytes2Read - usRxSize;
 
-                for (i = 0; i < usBurstCount; i++)
-                {
-                    unReturnCode = TIS_ReadRegister(PbLocality, TIS_TPM_DATA_FIFO, sizeof(BYTE), pbRxData);
-                    if (RC_SUCCESS != unReturnCode)
-                        break;
-
-                    pbRxData++;
-                }
-
+                // Read the whole burst from the data FIFO in one transaction
+                unReturnCode = TIS_ReadDataFifo(PbLocality, pbRxData, usBurstCount);
                 if (RC_SUCCESS != unReturnCode)
                 {
                     bRxDone = FALSE;    // It could make sense to retry
                     break;
                 }
 
+                pbRxData += usBurstCount;
                 usRxSize += usBurstCount;
+                usBurstCount = 0;
 
-                // Correct the number of Bytes to be read according to the real parameter size if available
+                // Correct the number of Bytes to be read according to the real response size if available
                 if ((usRxSize > 5) && (bUpdateBytes2Read == TRUE))
                 {
-                    usBytes2Read = (PrgbByteBuf[4] << 8) + PrgbByteBuf[5];
+                    UINT32 unResponseSize = ((UINT32)PrgbByteBuf[2] << 24) | ((UINT32)PrgbByteBuf[3] << 16) |
+                                            ((UINT32)PrgbByteBuf[4] << 8) | (UINT32)PrgbByteBuf[5];
                     bUpdateBytes2Read = FALSE;
+                    // A response shorter than its header can only be a transfer error, request it again
+                    if (unResponseSize < 10)
+                    {
+                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: Invalid response size (%d)", unResponseSize);
+                        unReturnCode = RC_E_TPM_RECEIVE_DATA;
+                        bRxDone = FALSE;    // It could make sense to retry
+                        break;
+                    }
                     // Check for sufficient space in the Buffer now
-                    if (*PpusLen < usBytes2Read)
+                    if (*PpusLen < unResponseSize)
                     {
-                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: Insufficient space in the receive buffer (%d, %d)", *PpusLen, usBytes2Read);
+                        TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: Insufficient space in the receive buffer (%d, %d)", *PpusLen, unResponseSize);
                         unReturnCode = RC_E_INSUFFICIENT_BUFFER;
                         bRxDone = TRUE; // It makes no sense to retry if the buffer is too small
                         break;
                     }
+                    usBytes2Read = (UINT16)unResponseSize;
                 }
             };
 
@@ -1180,23 +2314,9 @@ TIS_ReadLPC(
                 break;
 
             // All Bytes received, check whether this is indicated by the TPM
-            unTimeOut = (TIMEOUT_C * 1000) / SLEEP_TIME_US;
-            do
-            {
-                unReturnCode = TIS_ReadStsRegister(PbLocality, &bValue);
-                if (RC_SUCCESS != unReturnCode)
-                    unTimeOut = 0;  // Stop immediately on Error
-                else if ((bValue & TIS_TPM_STS_VALID) && (!(bValue & TIS_TPM_STS_AVAIL)))
-                    unTimeOut = 0;  // Stop immediately if condition is met
-                else
-                {
-                    Platform_SleepMicroSeconds(SLEEP_TIME_US);
-                    unTimeOut = unTimeOut - 1;
-                    if (0 == unTimeOut)
-                        unReturnCode = RC_E_TPM_RECEIVE_DATA;
-                }
-            }
-            while (unTimeOut > 0);
+            unReturnCode = TIS_WaitFor(PbLocality, TIS_WAIT_STS_NOT_AVAILABLE, TIS_ConditionStsNotAvailable, &bValue, TIMEOUT_C * 1000, &fTimedOut);
+            if (fTimedOut)
+                unReturnCode = RC_E_TPM_RECEIVE_DATA;
             if (RC_SUCCESS != unReturnCode)
             {
                 bRxDone = FALSE;
@@ -1225,7 +2345,13 @@ TIS_ReadLPC(
         }
         WHILE_FALSE_END;
 
-        if ((RC_SUCCESS != unReturnCode) && (bRxDone == FALSE) && (bRetryCount < MAX_TPM_READ_RETRIES))
+        if ((RC_SUCCESS != unReturnCode) && (bRxDone == FALSE) && (RC_SUCCESS != DeviceAccess_GetBusError()))
+        {
+            // The retry request would not reach the TPM either
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReadLPC: Bus transaction failed, no retry (0x%.8x)", unReturnCode);
+            bRxDone = TRUE;
+        }
+        else if ((RC_SUCCESS != unReturnCode) && (bRxDone == FALSE) && (bRetryCount < MAX_TPM_READ_RETRIES))
         {
             unReturnCode = TIS_Retry(PbLocality);
             if (RC_SUCCESS != unReturnCode)
@@ -1258,93 +2384,154 @@ TIS_ReadLPC(
 }
 
 /**
- *  @brief      Sends the Transceive Buffer to the TPM and returns the response
- *  @details
+ *  @brief      Waits for the response of a previously sent command and reads it from the TPM
+ *  @details    The function is the second half of TIS_TransceiveLPC. It allows the caller to prepare the next command
+ *              while the TPM is still processing the command sent with TIS_SendLPC.
  *
  *  @param      PbLocality      Locality value.
- *  @param      PrgbTxBuffer    Pointer to Transceive buffer.
- *  @param      PusTxLen        Length of the Transceive buffer.
  *  @param      PrgbRxBuffer    Pointer to a Receive buffer.
  *  @param      PpusRxLen       Pointer to the length of the Receive buffer.
  *  @param      PunMaxDuration  The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.\n
+ *                              Sets the initial sleep time between the polls for the response.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
  *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
  *  @retval     ...                         Error codes from:
- *                                              TIS_SendLPC,
  *                                              TIS_IsDataAvailable,
  *                                              TIS_ReadLPC,
  *                                              TIS_ReleaseActiveLocality function
  */
 _Check_return_
 UINT32
-TIS_TransceiveLPC(
+TIS_ReceiveLPC(
     _In_                        BYTE        PbLocality,
-    _In_bytecount_(PusTxLen)    const BYTE* PrgbTxBuffer,
-    _In_                        UINT16      PusTxLen,
     _Out_bytecap_(*PpusRxLen)   BYTE*       PrgbRxBuffer,
     _Inout_                     UINT16*     PpusRxLen,
-    _In_                        UINT32      PunMaxDuration)
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration)
 {
     UINT32 unReturnCode = RC_SUCCESS;
     UINT16 usRxSize = 0;
-    UINT32 unTimeOut = 0;
-    BOOL bFlag = FALSE;
+    BOOL fTimedOut = FALSE;
+    UINT32 unFirstSleepUs = 0;
+    UINT64 ullStartTicks = Platform_GetTicks();
+    UINT64 ullDataAvailableTicks = 0;
+    BOOL fWaitDone = FALSE;
 
     do
     {
-        unReturnCode = TIS_SendLPC(PbLocality, PrgbTxBuffer, PusTxLen);
-        if (RC_SUCCESS != unReturnCode)
+        if (NULL == PrgbRxBuffer || NULL == PpusRxLen)
         {
-            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_TransceiveLPC: TIS_SendLPC failed with (0x%.8x)", unReturnCode);
+            unReturnCode = RC_E_BAD_PARAMETER;
             break;
         }
 
+        // Keep the bus duty cycle cap before the receive transactions start
+        DeviceAccess_Throttle();
+
+        // Start polling with a fraction of the expected duration, so short commands are not delayed and long ones
+        // do not poll needlessly often.
+        if (0 != PunExpectedDuration)
+        {
+            unFirstSleepUs = PunExpectedDuration / TIS_EXPECTED_DURATION_POLL_DIVISOR;
+            if (unFirstSleepUs < SLEEP_TIME_US_CR)
+                unFirstSleepUs = SLEEP_TIME_US_CR;
+        }
+
         // The actual timeout will be higher than PunMaxDuration due to additional time consumed by multiple invocations of
         // the TIS_IsDataAvailable function.
-        unTimeOut = PunMaxDuration / SLEEP_TIME_US;
-        do
+        unReturnCode = TIS_WaitForWithFirstSleep(PbLocality, TIS_WAIT_DATA_AVAILABLE, TIS_ConditionDataAvailable, NULL, PunMaxDuration, unFirstSleepUs, &fTimedOut);
+        ullDataAvailableTicks = Platform_GetTicks();
+        fWaitDone = TRUE;
+        s_sPhaseTiming.ullWaitUs = Platform_TicksToMicroseconds(ullDataAvailableTicks - ullStartTicks);
+        if (fTimedOut)
         {
-            unReturnCode = TIS_IsDataAvailable(PbLocality, &bFlag);
-            if (RC_SUCCESS != unReturnCode)
-            {
-                TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_TransceiveLPC: TIS_IsDataAvailable failed with (0x%.8x)", unReturnCode);
-                unTimeOut = 0;  // Stop immediately on Error
-            }
-            else if (TRUE == bFlag)
-            {
-                unTimeOut = 0;  // Stop immediately if Flag is set
-            }
-            else
-            {
-                Platform_SleepMicroSeconds(SLEEP_TIME_US);
-                unTimeOut = unTimeOut - 1;
-                if (0 == unTimeOut)
-                {
-                    unReturnCode = RC_E_TPM_NO_DATA_AVAILABLE;
-                    TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_TransceiveLPC: No data available after timeout of %d microseconds (0x%.8x)", PunMaxDuration, unReturnCode);
-                }
-            }
+            unReturnCode = RC_E_TPM_NO_DATA_AVAILABLE;
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReceiveLPC: No data available after %d microseconds (timeout %d microseconds) (0x%.8x)", s_rgsPollStatistics[TIS_WAIT_DATA_AVAILABLE].unLastWaitUs, PunMaxDuration, unReturnCode);
+            break;
         }
-        while (unTimeOut > 0);
         if (RC_SUCCESS != unReturnCode)
+        {
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReceiveLPC: TIS_IsDataAvailable failed with (0x%.8x)", unReturnCode);
             break;
+        }
 
         usRxSize = *PpusRxLen;
         unReturnCode = TIS_ReadLPC(PbLocality, PrgbRxBuffer, &usRxSize);
         if (RC_SUCCESS != unReturnCode)
         {
-            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_TransceiveLPC: TIS_ReadLPC failed with (0x%.8x)", unReturnCode);
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_ReceiveLPC: TIS_ReadLPC failed with (0x%.8x)", unReturnCode);
             break;
         }
 
         *PpusRxLen = usRxSize;
 
-        if (!s_fKeepLocality)
+        if (!s_fKeepLocality && !TIS_IsLocalitySessionActive(PbLocality))
         {
             // Release current Locality
             unReturnCode = TIS_ReleaseActiveLocality(PbLocality);
         }
+        else if (TIS_IsLocalitySessionActive(PbLocality))
+        {
+            // The response is complete, a failure to yield must not fail the command
+            IGNORE_RETURN_VALUE(TIS_YieldLocalityOnPendingRequest(PbLocality));
+        }
+    }
+    WHILE_FALSE_END;
+
+    if (fWaitDone)
+        s_sPhaseTiming.ullReceiveUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullDataAvailableTicks);
+
+    // The TPM may have lost the locality (e.g. by a restart), verify it again before the next command
+    if (RC_SUCCESS != unReturnCode)
+        s_fSessionLocalityVerified = FALSE;
+
+    return unReturnCode;
+}
+
+/**
+ *  @brief      Sends the Transceive Buffer to the TPM and returns the response
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbTxBuffer    Pointer to Transceive buffer.
+ *  @param      PusTxLen        Length of the Transceive buffer.
+ *  @param      PrgbRxBuffer    Pointer to a Receive buffer.
+ *  @param      PpusRxLen       Pointer to the length of the Receive buffer.
+ *  @param      PunMaxDuration  The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
+ *  @retval     ...                         Error codes from:
+ *                                              TIS_SendLPC,
+ *                                              TIS_ReceiveLPC function
+ */
+_Check_return_
+UINT32
+TIS_TransceiveLPC(
+    _In_                        BYTE        PbLocality,
+    _In_bytecount_(PusTxLen)    const BYTE* PrgbTxBuffer,
+    _In_                        UINT16      PusTxLen,
+    _Out_bytecap_(*PpusRxLen)   BYTE*       PrgbRxBuffer,
+    _Inout_                     UINT16*     PpusRxLen,
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration)
+{
+    UINT32 unReturnCode = RC_SUCCESS;
+
+    do
+    {
+        unReturnCode = TIS_SendLPC(PbLocality, PrgbTxBuffer, PusTxLen);
+        if (RC_SUCCESS != unReturnCode)
+        {
+            TIS_LOGGING_WRITE_LEVEL1_FMT(L"Error: TIS_TransceiveLPC: TIS_SendLPC failed with (0x%.8x)", unReturnCode);
+            break;
+        }
+
+        unReturnCode = TIS_ReceiveLPC(PbLocality, PrgbRxBuffer, PpusRxLen, PunMaxDuration, PunExpectedDuration);
     }
     WHILE_FALSE_END;
 
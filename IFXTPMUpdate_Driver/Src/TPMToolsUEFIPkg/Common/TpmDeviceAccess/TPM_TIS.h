@@ -45,14 +45,30 @@
 // TPM Interface Registers
 /// Register offset for TPM Access register
 #define TIS_TPM_ACCESS 0x00000000
+/// Register offset for TPM Interrupt Enable register (enable bits, byte 0)
+#define TIS_TPM_INT_ENABLE 0x00000008
+/// Register offset for TPM Interrupt Enable register (globalIntEnable, byte 3)
+#define TIS_TPM_INT_ENABLE_GLOBAL 0x0000000B
+/// Register offset for TPM Interrupt Status register
+#define TIS_TPM_INT_STATUS 0x00000010
+/// Register offset for TPM Interface Capability register
+#define TIS_TPM_INTF_CAPABILITY 0x00000014
+/// Register offset for TPM Interface Capability register (InterfaceVersion, byte 3)
+#define TIS_TPM_INTF_CAPABILITY_VERSION 0x00000017
 /// Register offset for TPM Status register
 #define TIS_TPM_STS 0x00000018
 /// Register offset for TPM Burst Count register
 #define TIS_TPM_BURSTCOUNT 0x00000019
 /// Register offset for TPM Data FIFO register
 #define TIS_TPM_DATA_FIFO 0x00000024
+/// Register offset for TPM Interface Identifier register (not implemented by TIS 1.3 and older)
+#define TIS_TPM_INTERFACE_ID 0x00000030
 /// Register offset for TPM VID register
 #define TIS_TPM_VID 0x00000F00
+/// Register offset for TPM DID register
+#define TIS_TPM_DID 0x00000F02
+/// Register offset for TPM RID register
+#define TIS_TPM_RID 0x00000F04
 
 /// TPM Access register bit for access valid
 #define TIS_TPM_ACCESS_VALID 0x80
@@ -82,6 +98,36 @@
 /// TPM Status register bit for status retry
 #define TIS_TPM_STS_RETRY 0x02
 
+/// TPM Interrupt Enable register bit for globalIntEnable (in byte TIS_TPM_INT_ENABLE_GLOBAL)
+#define TIS_TPM_INT_GLOBAL_ENABLE 0x80
+/// TPM Interrupt Enable/Status/Interface Capability register bit for commandReady interrupt
+#define TIS_TPM_INT_COMMAND_READY 0x80
+/// TPM Interrupt Enable register bits for typePolarity
+#define TIS_TPM_INT_TYPE_POLARITY 0x18
+/// TPM Interrupt Enable/Status/Interface Capability register bit for localityChange interrupt
+#define TIS_TPM_INT_LOCALITY_CHANGE 0x04
+/// TPM Interrupt Enable/Status/Interface Capability register bit for stsValid interrupt
+#define TIS_TPM_INT_STS_VALID 0x02
+/// TPM Interrupt Enable/Status/Interface Capability register bit for dataAvail interrupt
+#define TIS_TPM_INT_DATA_AVAIL 0x01
+/// Interrupts used in interrupt mode
+#define TIS_TPM_INT_MASK (TIS_TPM_INT_COMMAND_READY | TIS_TPM_INT_LOCALITY_CHANGE | TIS_TPM_INT_DATA_AVAIL)
+
+/// TPM Interface Capability register bits for InterfaceVersion (in byte TIS_TPM_INTF_CAPABILITY_VERSION)
+#define TIS_TPM_INTF_VERSION_MASK 0x70
+/// InterfaceVersion of TIS 1.2
+#define TIS_TPM_INTF_VERSION_TIS12 0x00
+/// InterfaceVersion of TIS 1.3
+#define TIS_TPM_INTF_VERSION_TIS13 0x20
+/// InterfaceVersion of the FIFO interface for TPM2.0
+#define TIS_TPM_INTF_VERSION_FIFO20 0x30
+/// TPM Interface Identifier register bits for InterfaceType
+#define TIS_TPM_INTERFACE_TYPE_MASK 0x0F
+/// InterfaceType of the FIFO interface for TPM2.0
+#define TIS_TPM_INTERFACE_TYPE_FIFO 0x00
+/// InterfaceType if the TPM Interface Identifier register is not implemented (TIS 1.3 and older)
+#define TIS_TPM_INTERFACE_TYPE_TIS 0x0F
+
 // Infineon TPM Vendor ID
 #define TPM_VID_IFX 0x15D1
 
@@ -95,6 +141,118 @@
 /// TIS Timeout D
 #define TIMEOUT_D 750
 
+// TIS wait loop identifiers used for polling statistics
+/// Wait for TPM.ACCESS.activeLocality
+#define TIS_WAIT_LOCALITY_ACTIVE    0
+/// Wait for TPM.STS.commandReady
+#define TIS_WAIT_COMMAND_READY      1
+/// Wait for TPM.STS.burstCount > 0
+#define TIS_WAIT_BURSTCOUNT         2
+/// Wait for TPM.STS.stsValid and TPM.STS.Expect before the last command byte
+#define TIS_WAIT_STS_EXPECT         3
+/// Wait for TPM.STS.stsValid and !TPM.STS.Expect after the last command byte
+#define TIS_WAIT_STS_NOT_EXPECT     4
+/// Wait for TPM.STS.stsValid and TPM.STS.dataAvail after command execution
+#define TIS_WAIT_DATA_AVAILABLE     5
+/// Wait for TPM.STS.stsValid and !TPM.STS.dataAvail after the last response byte
+#define TIS_WAIT_STS_NOT_AVAILABLE  6
+/// Number of TIS wait loop identifiers
+#define TIS_WAIT_COUNT              7
+
+/**
+ *  @brief      Backoff policy for a TIS wait loop
+ *  @details    The register is polled unSpinPolls times without delay. Afterwards the sleep time between polls starts
+ *              at unMinSleepUs and is doubled after each poll until it reaches unMaxSleepUs.
+ */
+typedef struct tdTIS_BACKOFF_POLICY
+{
+    /// Number of polls without delay
+    UINT32 unSpinPolls;
+    /// Initial sleep time between polls in microseconds
+    UINT32 unMinSleepUs;
+    /// Maximum sleep time between polls in microseconds
+    UINT32 unMaxSleepUs;
+} TIS_BACKOFF_POLICY;
+
+/// Device id of a transport profile that matches any device of the vendor
+#define TIS_PROFILE_ANY_DEVICE      0xFFFF
+
+/**
+ *  @brief      Transport profile of a TPM model
+ *  @details    The profile is selected from the VID, DID and RID registers when connecting to the TPM. It holds the initial
+ *              poll intervals of the TIS wait loops and hints for the firmware update (0 if unknown). The TIS timeouts are
+ *              not part of the profile, they only take effect if the TPM does not respond.
+ */
+typedef struct tdTIS_TRANSPORT_PROFILE
+{
+    /// Vendor id (TPM_VID)
+    UINT16 usVendorId;
+    /// Device id (TPM_DID) or TIS_PROFILE_ANY_DEVICE
+    UINT16 usDeviceId;
+    /// Minimum revision id (TPM_RID)
+    BYTE bMinRevisionId;
+    /// Name of the TPM model for logging
+    const wchar_t* wszName;
+    /// Initial sleep time between polls of the access and status register handshakes in microseconds
+    UINT32 unHandshakeSleepUs;
+    /// Maximum sleep time between polls of the access and status register handshakes in microseconds
+    UINT32 unMaxHandshakeSleepUs;
+    /// Initial sleep time between polls of the burst count in microseconds
+    UINT32 unBurstCountSleepUs;
+    /// Initial sleep time between polls for a response if the command duration is not calibrated in microseconds
+    UINT32 unResponseSleepUs;
+    /// Typical duration of a field upgrade data block command in microseconds
+    UINT32 unBlockLatencyUs;
+    /// Field upgrade block size in bytes if the TPM does not report its input buffer size
+    UINT16 usFieldUpgradeBlockSize;
+} TIS_TRANSPORT_PROFILE;
+
+/**
+ *  @brief      Polling statistics of a TIS wait loop
+ *  @details
+ */
+typedef struct tdTIS_POLL_STATISTICS
+{
+    /// Number of waits
+    UINT32 unWaits;
+    /// Total number of register polls over all waits
+    UINT32 unPolls;
+    /// Number of register polls of the last wait
+    UINT32 unLastPolls;
+    /// Maximum number of register polls of a single wait
+    UINT32 unMaxPolls;
+    /// Number of waits that ran into a timeout
+    UINT32 unTimeouts;
+    /// Elapsed time of the last wait in microseconds (measured with the tick counter, including the register accesses)
+    UINT32 unLastWaitUs;
+} TIS_POLL_STATISTICS;
+
+/**
+ *  @brief      Condition callback for TIS_WaitFor
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpvContext      Caller specific context (e.g. to return the last register value).
+ *  @param      PpfConditionMet Set to TRUE if the awaited condition is met.
+ *
+ *  @retval     RC_SUCCESS      The register could be read.
+ *  @retval     ...             Error codes from the register access functions.
+ */
+typedef
+UINT32
+(*PFN_TIS_WAIT_CONDITION)(
+    _In_    BYTE    PbLocality,
+    _Inout_ void*   PpvContext,
+    _Out_   BOOL*   PpfConditionMet);
+
+/**
+ *  @brief      Invalidates the cached register values
+ *  @details    The cached values of the access and status register belong to one TPM. They must be invalidated when
+ *              another TPM instance is selected.
+ */
+void
+TIS_InvalidateCachedRegisters();
+
 /**
  *  @brief      Keep the locality active between TPM commands. If not set, the locality would be released after a TPM response
  *              and requested again before the next TPM command.
@@ -103,6 +261,203 @@
 void
 TIS_KeepLocalityActive();
 
+/**
+ *  @brief      Begins a locality session
+ *  @details    Requests the locality once. Until TIS_EndLocalitySession is called the locality is neither requested
+ *              before nor released after each TPM command, and once the locality was seen active the ACCESS register
+ *              is not polled anymore. Any failed TPM command makes the next one verify the locality again. Beginning
+ *              a session for the locality already held is a no-op.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          A session for another locality is already active.
+ *  @retval     ...                         Error codes from TIS_RequestUse function.
+ */
+_Check_return_
+UINT32
+TIS_BeginLocalitySession(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Ends a locality session
+ *  @details    Releases the locality held by the session. The session is ended even if the release fails, so a
+ *              following TIS_BeginLocalitySession (e.g. after a TPM restart) starts from scratch. Ending without an
+ *              active session is a no-op.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     ...                         Error codes from TIS_ReleaseActiveLocality function.
+ */
+_Check_return_
+UINT32
+TIS_EndLocalitySession();
+
+/**
+ *  @brief      Returns whether a locality session is held for the given locality
+ *  @details
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     TRUE            A locality session is held for PbLocality.
+ *  @retval     FALSE           Otherwise.
+ */
+_Check_return_
+BOOL
+TIS_IsLocalitySessionActive(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Switches the TIS layer to interrupt mode if possible
+ *  @details    Enables the dataAvail, commandReady and localityChange interrupts of the TPM if the platform routes the TPM
+ *              interrupt to the host (see DeviceAccess_IsInterruptRouted) and the TPM supports them. In interrupt mode the waits
+ *              for these conditions sleep until the interrupt is signaled instead of polling the TPM registers. The registers are
+ *              still checked every TIS_INTERRUPT_POLL_INTERVAL_US, so a lost interrupt only delays the wait. If interrupts are
+ *              not available the function succeeds and the TIS layer keeps polling. The locality must be active.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadRegister and TIS_WriteRegister functions.
+ */
+_Check_return_
+UINT32
+TIS_EnableInterrupts(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Switches the TIS layer back to polling mode
+ *  @details    Disables the interrupts enabled by TIS_EnableInterrupts. Does nothing if interrupt mode is not active.
+ *              The locality must be active.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS      The operation completed successfully.
+ *  @retval     ...             Error codes from TIS_ReadRegister and TIS_WriteRegister functions.
+ */
+_Check_return_
+UINT32
+TIS_DisableInterrupts(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Returns whether the TIS layer waits for TPM interrupts
+ *  @details
+ *
+ *  @retval     TRUE            Interrupt mode is active.
+ *  @retval     FALSE           The TIS layer polls the TPM registers.
+ */
+_Check_return_
+BOOL
+TIS_IsInterruptModeActive();
+
+/**
+ *  @brief      Polls a TIS condition until it is met or the timeout elapses
+ *  @details    The condition is polled according to the backoff policy of the given wait loop identifier. In interrupt mode
+ *              the waits for data available, command ready and the active locality sleep until the TPM interrupt is signaled.
+ *              The number of polls is recorded in the polling statistics of the wait loop.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *  @param      PfnCondition    Condition callback.
+ *  @param      PpvContext      Context passed to the condition callback.
+ *  @param      PunTimeoutUs    Timeout in microseconds.
+ *  @param      PpfTimedOut     Set to TRUE if the condition was not met within the timeout.
+ *
+ *  @retval     RC_SUCCESS          The condition is met.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY      The condition was not met within the timeout (*PpfTimedOut is TRUE).
+ *  @retval     ...                 Error codes from the condition callback.
+ */
+_Check_return_
+UINT32
+TIS_WaitFor(
+    _In_        BYTE                    PbLocality,
+    _In_        UINT32                  PunWaitId,
+    _In_        PFN_TIS_WAIT_CONDITION  PfnCondition,
+    _Inout_opt_ void*                   PpvContext,
+    _In_        UINT32                  PunTimeoutUs,
+    _Out_       BOOL*                   PpfTimedOut);
+
+/**
+ *  @brief      Returns the polling statistics of a TIS wait loop
+ *  @details
+ *
+ *  @param      PunWaitId       TIS wait loop identifier (TIS_WAIT_*).
+ *  @param      PpsStatistics   Pointer to receive the statistics.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TIS_GetPollStatistics(
+    _In_    UINT32                  PunWaitId,
+    _Out_   TIS_POLL_STATISTICS*    PpsStatistics);
+
+/**
+ *  @brief      Resets the polling statistics of all TIS wait loops
+ *  @details
+ */
+void
+TIS_ResetPollStatistics();
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    The send phase is recorded by TIS_SendLPCSegments, the wait and receive phases by TIS_ReceiveLPC.
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TIS_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming);
+
+/**
+ *  @brief      Selects the transport profile of the TPM
+ *  @details    Reads the VID, DID and RID registers and applies the poll intervals of the matching profile to the TIS wait
+ *              loops. A TPM without a matching profile uses the conservative default profile.
+ *
+ *  @param      PbLocality      Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+TIS_SelectTransportProfile(
+    _In_    BYTE    PbLocality);
+
+/**
+ *  @brief      Returns the selected transport profile
+ *  @details
+ *
+ *  @returns    The transport profile selected by TIS_SelectTransportProfile, the default profile before.
+ */
+const TIS_TRANSPORT_PROFILE*
+TIS_GetTransportProfile();
+
+/**
+ *  @brief      Reads the identification of the TPM from the interface registers
+ *  @details    Reads the DID_VID, RID, interface capability and interface id registers. The TPM family is derived from the
+ *              interface: the FIFO interface for TPM2.0 implies a TPM2.0, TIS 1.2 and TIS 1.3 imply a TPM1.2. No TPM
+ *              command is sent and the locality does not need to be active.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpsInfo         Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ */
+_Check_return_
+UINT32
+TIS_ReadInterfaceInfo(
+    _In_    BYTE                    PbLocality,
+    _Out_   TPM_INTERFACE_INFO*     PpsInfo);
+
 /**
  *  @brief      Read the value of a TIS register
  *  @details
@@ -145,6 +500,48 @@ TIS_WriteRegister(
     _In_    BYTE    PbRegSize,
     _In_    UINT32  PunValue);
 
+/**
+ *  @brief      Read a block of data from the TIS data FIFO
+ *  @details    The block is transferred in a single bus transaction. The caller must ensure that PusLen
+ *              does not exceed the current burst count.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Pointer to buffer to store bytes.
+ *  @param      PusLen          Number of bytes to read.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ *  @retval     RC_E_BAD_PARAMETER          PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from DeviceAccess_ReadBlock function.
+ */
+_Check_return_
+UINT32
+TIS_ReadDataFifo(
+    _In_                    BYTE    PbLocality,
+    _Out_bytecap_(PusLen)   BYTE*   PrgbByteBuf,
+    _In_                    UINT16  PusLen);
+
+/**
+ *  @brief      Write a block of data to the TIS data FIFO
+ *  @details    The block is transferred in a single bus transaction. The caller must ensure that PusLen
+ *              does not exceed the current burst count.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Bytes to write.
+ *  @param      PusLen          Number of bytes to write.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_LOCALITY_NOT_SUPPORTED Given locality is not supported.
+ *  @retval     RC_E_BAD_PARAMETER          PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from DeviceAccess_WriteBlock function.
+ */
+_Check_return_
+UINT32
+TIS_WriteDataFifo(
+    _In_                    BYTE        PbLocality,
+    _In_bytecount_(PusLen)  const BYTE* PrgbByteBuf,
+    _In_                    UINT16      PusLen);
+
 /**
  *  @brief      Read the value from the access register
  *  @details
@@ -197,7 +594,7 @@ TIS_WriteStsRegister(
 
 /**
  *  @brief      Returns the value of TPM.ACCESS.VALID
- *  @details
+ *  @details    An all-ones register value is reported as not valid since the TPM does not respond in this case.
  *
  *  @param      PbLocality      Locality value.
  *  @param      PpbFlag         Pointer to a BOOL flag.
@@ -264,14 +661,34 @@ TIS_RequestUse(
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Not an active locality.
+ *  @retval     ...                         Error codes from TIS_ReadStsAndBurstCount function.
+ */
+_Check_return_
+UINT32
+TIS_GetBurstCount(
+    _In_    BYTE    PbLocality,
+    _Out_   UINT16* PpusBurstCount);
+
+/**
+ *  @brief      Returns the values of TPM.STS and TPM.STS.BURSTCOUNT
+ *  @details    Both are read in one 4-byte transaction at TPM.STS (status, burst count, extended status).
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PpbStatus       Pointer to the status register variable.
+ *  @param      PpusBurstCount  Pointer to the Burst Count variable.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Not an active locality.
  *  @retval     ...                         Error codes from:
  *                                              TIS_IsActiveLocality
- *                                              TIS_ReadRegister function
+ *                                              DeviceAccess_ReadBlock function
  */
 _Check_return_
 UINT32
-TIS_GetBurstCount(
+TIS_ReadStsAndBurstCount(
     _In_    BYTE    PbLocality,
+    _Out_   BYTE*   PpbStatus,
     _Out_   UINT16* PpusBurstCount);
 
 /**
@@ -349,16 +766,18 @@ TIS_Retry(
     _In_    BYTE    PbLocality);
 
 /**
- *  @brief      Send data block to the TPM
- *  @details    Send a data block to the TPM TIS data FIFO under consideration of the
- *              TIS communication protocol
+ *  @brief      Send a scattered data block to the TPM
+ *  @details    Send the segments of a data block to the TPM TIS data FIFO under consideration of the
+ *              TIS communication protocol. The segments are written in order as one TPM command, each burst
+ *              is taken directly from the segment buffers.
  *
- *  @param      PbLocality      Locality value.
- *  @param      PrgbByteBuf     Bytes to send.
- *  @param      PusLen          Length of bytes.
+ *  @param      PbLocality          Locality value.
+ *  @param      PrgsSegments        Segments to send.
+ *  @param      PunSegmentCount     Number of segments.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgbByteBuf is NULL.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgsSegments is NULL, a
+ *                                          segment has no data or the total size exceeds 0xFFFF bytes.
  *  @retval     RC_E_LOCALITY_NOT_ACTIVE    Locality not active.
  *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
  *  @retval     RC_E_NOT_READY              Not ready.
@@ -366,14 +785,35 @@ TIS_Retry(
  *  @retval     ...                         Error codes from:
  *                                              TIS_RequestUse,
  *                                              TIS_IsActiveLocality,
- *                                              TIS_IsCommandReady,
+ *                                              TIS_ReadStsAndBurstCount,
  *                                              TIS_Abort,
  *                                              TIS_GetBurstCount,
  *                                              TIS_WriteRegister,
+ *                                              TIS_WriteDataFifo,
  *                                              TIS_ReadStsRegister function
  */
 _Check_return_
 UINT32
+TIS_SendLPCSegments(
+    _In_                            BYTE                    PbLocality,
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            UINT32                  PunSegmentCount);
+
+/**
+ *  @brief      Send data block to the TPM
+ *  @details    Send a data block to the TPM TIS data FIFO under consideration of the
+ *              TIS communication protocol
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbByteBuf     Bytes to send.
+ *  @param      PusLen          Length of bytes.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. PrgbByteBuf is NULL.
+ *  @retval     ...                         Error codes from TIS_SendLPCSegments function
+ */
+_Check_return_
+UINT32
 TIS_SendLPC(
     _In_                    BYTE        PbLocality,
     _In_bytecount_(PusLen)  const BYTE* PrgbByteBuf,
@@ -397,9 +837,9 @@ TIS_SendLPC(
  *  @retval     RC_E_TPM_TRANSMIT_DATA      Error during transmit data.
  *  @retval     ...                         Error codes from:
  *                                              TIS_IsActiveLocality,
- *                                              TIS_ReadStsRegister,
+ *                                              TIS_ReadStsAndBurstCount,
  *                                              TIS_GetBurstCount,
- *                                              TIS_ReadRegister,
+ *                                              TIS_ReadDataFifo,
  *                                              TIS_ReadStsRegister,
  *                                              TIS_IsCommandReady,
  *                                              TIS_Abort,
@@ -412,6 +852,35 @@ TIS_ReadLPC(
     _Out_bytecap_(*PpusLen) BYTE*   PrgbByteBuf,
     _Inout_                 UINT16* PpusLen);
 
+/**
+ *  @brief      Waits for the response of a previously sent command and reads it from the TPM
+ *  @details    The function is the second half of TIS_TransceiveLPC. It allows the caller to prepare the next command
+ *              while the TPM is still processing the command sent with TIS_SendLPC.
+ *
+ *  @param      PbLocality      Locality value.
+ *  @param      PrgbRxBuffer    Pointer to a Receive buffer.
+ *  @param      PpusRxLen       Pointer to the length of the Receive buffer.
+ *  @param      PunMaxDuration  The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.\n
+ *                              Sets the initial sleep time between the polls for the response.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
+ *  @retval     ...                         Error codes from:
+ *                                              TIS_IsDataAvailable,
+ *                                              TIS_ReadLPC,
+ *                                              TIS_ReleaseActiveLocality function
+ */
+_Check_return_
+UINT32
+TIS_ReceiveLPC(
+    _In_                        BYTE        PbLocality,
+    _Out_bytecap_(*PpusRxLen)   BYTE*       PrgbRxBuffer,
+    _Inout_                     UINT16*     PpusRxLen,
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration);
+
 /**
  *  @brief      Sends the Transceive Buffer to the TPM and returns the response
  *  @details
@@ -422,14 +891,13 @@ TIS_ReadLPC(
  *  @param      PrgbRxBuffer    Pointer to a Receive buffer.
  *  @param      PpusRxLen       Pointer to the length of the Receive buffer.
  *  @param      PunMaxDuration  The maximum duration of the command in microseconds.
+ *  @param      PunExpectedDuration The expected duration of the command in microseconds, 0 if unknown.
  *
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  TPM no data available.
  *  @retval     ...                         Error codes from:
  *                                              TIS_SendLPC,
- *                                              TIS_IsDataAvailable,
- *                                              TIS_ReadLPC,
- *                                              TIS_ReleaseActiveLocality function
+ *                                              TIS_ReceiveLPC function
  */
 _Check_return_
 UINT32
@@ -439,6 +907,7 @@ TIS_TransceiveLPC(
     _In_                        UINT16      PusTxLen,
     _Out_bytecap_(*PpusRxLen)   BYTE*       PrgbRxBuffer,
     _Inout_                     UINT16*     PpusRxLen,
-    _In_                        UINT32      PunMaxDuration);
+    _In_                        UINT32      PunMaxDuration,
+    _In_                        UINT32      PunExpectedDuration);
 
 #endif //__TPM_TIS_H__
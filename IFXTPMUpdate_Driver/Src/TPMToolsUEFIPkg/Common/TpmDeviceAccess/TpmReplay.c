@@ -0,0 +1,408 @@
+/**
+ *  @brief      Implements the trace replay functions
+ *  @details    The trace replay answers TPM commands from a recorded command/response trace instead of a TPM. It is used
+ *              to measure the host-side cost of the update flow without a TPM and without consuming firmware update counters.
+ *  @file       TpmDeviceAccess/TpmReplay.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "TpmReplay.h"
+#include "Platform.h"
+#include "Logging.h"
+
+/// Copy of the loaded trace, NULL if no trace is loaded
+static BYTE* s_pbTrace = NULL;
+/// Size of the loaded trace in bytes
+static UINT32 s_unTraceSize = 0;
+/// Number of records in the loaded trace
+static UINT32 s_unRecordCount = 0;
+/// Offset of the next record to replay
+static UINT32 s_unNextRecord = 0;
+/// Scale of the recorded command durations in percent
+static UINT32 s_unLatencyScalePercent = 0;
+/// Additional latency per command in microseconds
+static UINT32 s_unExtraLatencyUs = 0;
+/// Flag indicating that a command was sent and its response was not received yet
+static BOOL s_fPending = FALSE;
+/// Offset of the record of the pending command
+static UINT32 s_unPendingRecord = 0;
+/// Injected latency of the pending command in microseconds
+static unsigned long long s_ullPendingLatencyUs = 0;
+/// Ticks at the time the pending command was sent
+static unsigned long long s_ullSendTicks = 0;
+/// Durations of the transport phases of the last command
+static TPM_PHASE_TIMING s_sPhaseTiming;
+
+/**
+ *  @brief      Reads a little endian UINT32 from the trace
+ *  @details
+ *
+ *  @param      PrgbData        Pointer to the four bytes.
+ *  @returns    The value.
+ */
+static
+UINT32
+TpmReplay_ReadUInt32(
+    _In_reads_bytes_(4)     const BYTE*     PrgbData)
+{
+    return (UINT32)PrgbData[0] | ((UINT32)PrgbData[1] << 8) | ((UINT32)PrgbData[2] << 16) | ((UINT32)PrgbData[3] << 24);
+}
+
+/**
+ *  @brief      Returns the microseconds elapsed since the pending command was sent
+ *  @details
+ *
+ *  @returns    Elapsed time in microseconds.
+ */
+static
+unsigned long long
+TpmReplay_GetElapsedUs()
+{
+    return Platform_TicksToMicroseconds(Platform_GetTicks() - s_ullSendTicks);
+}
+
+/**
+ *  @brief      Loads a replay trace
+ *  @details    The trace is a sequence of records. Each record consists of the request size, the response size and the
+ *              recorded command duration in microseconds (each UINT32, little endian) followed by the request and the
+ *              response bytes. The trace is copied, so the caller may release it after the call. A previously loaded
+ *              trace is replaced and the replay restarts with the first record.
+ *
+ *  @param      PrgbTrace                   Pointer to the trace.
+ *  @param      PunTraceSize                Size of the trace in bytes.
+ *  @param      PunLatencyScalePercent      Scale of the recorded command durations in percent (0 replays without recorded latency).
+ *  @param      PunExtraLatencyUs           Additional latency per command in microseconds.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function or the trace is malformed.
+ *  @retval     RC_E_FAIL                   The memory for the trace could not be allocated.
+ */
+_Check_return_
+UINT32
+TpmReplay_Load(
+    _In_bytecount_(PunTraceSize)    const BYTE*     PrgbTrace,
+    _In_                            UINT32          PunTraceSize,
+    _In_                            UINT32          PunLatencyScalePercent,
+    _In_                            UINT32          PunExtraLatencyUs)
+{
+    UINT32 unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        UINT32 unOffset = 0;
+        UINT32 unRecordCount = 0;
+
+        // Check parameters
+        if (NULL == PrgbTrace || 0 == PunTraceSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // Validate all records before anything is replaced
+        unReturnValue = RC_SUCCESS;
+        while (unOffset < PunTraceSize)
+        {
+            UINT32 unRequestSize = 0;
+            UINT32 unResponseSize = 0;
+
+            if (PunTraceSize - unOffset < TPM_REPLAY_RECORD_HEADER_SIZE)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            unRequestSize = TpmReplay_ReadUInt32(&PrgbTrace[unOffset]);
+            unResponseSize = TpmReplay_ReadUInt32(&PrgbTrace[unOffset + 4]);
+            unOffset += TPM_REPLAY_RECORD_HEADER_SIZE;
+
+            if (unRequestSize < TPM_REPLAY_TPM_HEADER_SIZE || unResponseSize < TPM_REPLAY_TPM_HEADER_SIZE ||
+                unRequestSize > PunTraceSize - unOffset || unResponseSize > PunTraceSize - unOffset - unRequestSize)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            unOffset += unRequestSize + unResponseSize;
+            unRecordCount++;
+        }
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Replay trace is malformed at record %d (0x%.8X)!", unRecordCount, unReturnValue);
+            break;
+        }
+
+        TpmReplay_Unload();
+
+        s_pbTrace = (BYTE*)Platform_MemoryAllocateZero(PunTraceSize);
+        if (NULL == s_pbTrace)
+        {
+            unReturnValue = RC_E_FAIL;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Allocating memory for the replay trace failed (0x%.8X)!", unReturnValue);
+            break;
+        }
+        unReturnValue = Platform_MemoryCopy(s_pbTrace, PunTraceSize, PrgbTrace, PunTraceSize);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            TpmReplay_Unload();
+            break;
+        }
+
+        s_unTraceSize = PunTraceSize;
+        s_unRecordCount = unRecordCount;
+        s_unLatencyScalePercent = PunLatencyScalePercent;
+        s_unExtraLatencyUs = PunExtraLatencyUs;
+        LOGGING_WRITE_LEVEL3_FMT(L"Replay trace loaded: %d records, latency scale %d%%, extra latency %d us.", unRecordCount, PunLatencyScalePercent, PunExtraLatencyUs);
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Unloads the replay trace
+ *  @details    Releases the trace memory. The function does nothing if no trace is loaded.
+ */
+void
+TpmReplay_Unload()
+{
+    Platform_MemoryFree((void**)&s_pbTrace);
+    s_unTraceSize = 0;
+    s_unRecordCount = 0;
+    s_unNextRecord = 0;
+    s_fPending = FALSE;
+    Platform_MemorySet(&s_sPhaseTiming, 0, sizeof(s_sPhaseTiming));
+}
+
+/**
+ *  @brief      Returns whether a replay trace is loaded
+ *  @details
+ *
+ *  @retval     TRUE        A replay trace is loaded.
+ *  @retval     FALSE       No replay trace is loaded.
+ */
+_Check_return_
+BOOL
+TpmReplay_IsLoaded()
+{
+    return NULL != s_pbTrace;
+}
+
+/**
+ *  @brief      Sends a TPM command to the replay trace
+ *  @details    The command code of the command must match the command code of the next record of the trace. Other bytes
+ *              are not compared because nonces and session values differ between runs.
+ *
+ *  @param      PrgsSegments                Segments of the TPM command request.
+ *  @param      PunSegmentCount             Number of segments.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED        No replay trace is loaded.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA      The trace is exhausted or the command does not match the next record.
+ */
+_Check_return_
+UINT32
+TpmReplay_Send(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            UINT32                  PunSegmentCount)
+{
+    UINT32 unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BYTE rgbHeader[TPM_REPLAY_TPM_HEADER_SIZE];
+        UINT32 unHeaderSize = 0;
+        UINT32 unSegment = 0;
+        const BYTE* pbRecordRequest = NULL;
+        unsigned long long ullLatencyUs = 0;
+
+        // Check parameters
+        if (NULL == PrgsSegments || 0 == PunSegmentCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (NULL == s_pbTrace)
+        {
+            unReturnValue = RC_E_NOT_INITIALIZED;
+            break;
+        }
+
+        // Collect the command header, it may be split across segments
+        Platform_MemorySet(rgbHeader, 0, sizeof(rgbHeader));
+        for (unSegment = 0; unSegment < PunSegmentCount && unHeaderSize < sizeof(rgbHeader); unSegment++)
+        {
+            UINT32 unCopy = sizeof(rgbHeader) - unHeaderSize;
+            if (unCopy > PrgsSegments[unSegment].unSize)
+                unCopy = PrgsSegments[unSegment].unSize;
+            unReturnValue = Platform_MemoryCopy(&rgbHeader[unHeaderSize], sizeof(rgbHeader) - unHeaderSize, PrgsSegments[unSegment].pbData, unCopy);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            unHeaderSize += unCopy;
+        }
+        if (unHeaderSize < sizeof(rgbHeader))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+
+        // A new command starts, so a response not collected yet is discarded
+        s_fPending = FALSE;
+        Platform_MemorySet(&s_sPhaseTiming, 0, sizeof(s_sPhaseTiming));
+
+        if (s_unNextRecord >= s_unTraceSize)
+        {
+            unReturnValue = RC_E_TPM_TRANSMIT_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Replay trace is exhausted after %d records (0x%.8X)!", s_unRecordCount, unReturnValue);
+            break;
+        }
+
+        // Compare the command code (bytes 6 to 9 of the command header)
+        pbRecordRequest = &s_pbTrace[s_unNextRecord + TPM_REPLAY_RECORD_HEADER_SIZE];
+        if (0 != Platform_MemoryCompare(&rgbHeader[6], &pbRecordRequest[6], 4))
+        {
+            unReturnValue = RC_E_TPM_TRANSMIT_DATA;
+            LOGGING_WRITE_LEVEL1_FMT(
+                L"Error: Command 0x%.2X%.2X%.2X%.2X does not match the replay trace, expected 0x%.2X%.2X%.2X%.2X (0x%.8X)!",
+                rgbHeader[6], rgbHeader[7], rgbHeader[8], rgbHeader[9],
+                pbRecordRequest[6], pbRecordRequest[7], pbRecordRequest[8], pbRecordRequest[9],
+                unReturnValue);
+            break;
+        }
+
+        // Injected latency: recorded duration scaled plus the fixed extra latency
+        ullLatencyUs = (unsigned long long)TpmReplay_ReadUInt32(&s_pbTrace[s_unNextRecord + 8]) * s_unLatencyScalePercent / 100;
+        s_ullPendingLatencyUs = ullLatencyUs + s_unExtraLatencyUs;
+
+        s_unPendingRecord = s_unNextRecord;
+        s_unNextRecord += TPM_REPLAY_RECORD_HEADER_SIZE + TpmReplay_ReadUInt32(&s_pbTrace[s_unNextRecord]) + TpmReplay_ReadUInt32(&s_pbTrace[s_unNextRecord + 4]);
+        s_ullSendTicks = Platform_GetTicks();
+        s_fPending = TRUE;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks whether the response of the sent command is available
+ *  @details    The response becomes available once the injected latency of the record has elapsed.
+ *
+ *  @param      PpfResponseAvailable        Receives TRUE if the response can be read with TpmReplay_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TpmReplay_Poll(
+    _Out_   BOOL*   PpfResponseAvailable)
+{
+    if (NULL == PpfResponseAvailable)
+        return RC_E_BAD_PARAMETER;
+
+    *PpfResponseAvailable = s_fPending && TpmReplay_GetElapsedUs() >= s_ullPendingLatencyUs;
+
+    return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Receives the recorded response of the sent command
+ *  @details    The function waits until the injected latency of the record has elapsed.
+ *
+ *  @param      PrgbResponseBuffer          Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize      Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  No command was sent.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The response buffer is too small.
+ */
+_Check_return_
+UINT32
+TpmReplay_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)  BYTE*       PrgbResponseBuffer,
+    _Inout_                                 UINT32*     PpunResponseBufferSize)
+{
+    UINT32 unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        UINT32 unRequestSize = 0;
+        UINT32 unResponseSize = 0;
+        unsigned long long ullElapsedUs = 0;
+
+        // Check parameters
+        if (NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (!s_fPending || NULL == s_pbTrace)
+        {
+            unReturnValue = RC_E_TPM_NO_DATA_AVAILABLE;
+            break;
+        }
+
+        // Wait for the rest of the injected latency
+        ullElapsedUs = TpmReplay_GetElapsedUs();
+        if (ullElapsedUs < s_ullPendingLatencyUs)
+            Platform_SleepMicroSeconds((unsigned int)(s_ullPendingLatencyUs - ullElapsedUs));
+        s_sPhaseTiming.ullWaitUs = TpmReplay_GetElapsedUs();
+        s_fPending = FALSE;
+
+        unRequestSize = TpmReplay_ReadUInt32(&s_pbTrace[s_unPendingRecord]);
+        unResponseSize = TpmReplay_ReadUInt32(&s_pbTrace[s_unPendingRecord + 4]);
+        if (*PpunResponseBufferSize < unResponseSize)
+        {
+            unReturnValue = RC_E_INSUFFICIENT_BUFFER;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Response buffer too small for the replayed response of %d bytes (0x%.8X)!", unResponseSize, unReturnValue);
+            break;
+        }
+
+        unReturnValue = Platform_MemoryCopy(
+                            PrgbResponseBuffer,
+                            *PpunResponseBufferSize,
+                            &s_pbTrace[s_unPendingRecord + TPM_REPLAY_RECORD_HEADER_SIZE + unRequestSize],
+                            unResponseSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        *PpunResponseBufferSize = unResponseSize;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    The replay has no transport, so only the wait phase (the injected latency) is reported.
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TpmReplay_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming)
+{
+    if (NULL == PpsTiming)
+        return RC_E_BAD_PARAMETER;
+
+    *PpsTiming = s_sPhaseTiming;
+
+    return RC_SUCCESS;
+}
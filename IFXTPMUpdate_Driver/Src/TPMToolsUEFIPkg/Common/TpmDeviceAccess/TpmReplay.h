@@ -0,0 +1,133 @@
+/**
+ *  @brief      Declares the trace replay functions
+ *  @details    The trace replay answers TPM commands from a recorded command/response trace instead of a TPM. It is used
+ *              to measure the host-side cost of the update flow without a TPM and without consuming firmware update counters.
+ *  @file       TpmDeviceAccess/TpmReplay.h
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#ifndef __TPM_REPLAY_H__
+#define __TPM_REPLAY_H__
+
+#include "StdInclude.h"
+
+/// Size of the header preceding each record of a replay trace: request size, response size and duration (each UINT32, little endian)
+#define TPM_REPLAY_RECORD_HEADER_SIZE   12
+/// Size of a TPM command or response header (tag, size and command or response code)
+#define TPM_REPLAY_TPM_HEADER_SIZE      10
+
+/**
+ *  @brief      Loads a replay trace
+ *  @details    The trace is a sequence of records. Each record consists of the request size, the response size and the
+ *              recorded command duration in microseconds (each UINT32, little endian) followed by the request and the
+ *              response bytes. The trace is copied, so the caller may release it after the call. A previously loaded
+ *              trace is replaced and the replay restarts with the first record.
+ *
+ *  @param      PrgbTrace                   Pointer to the trace.
+ *  @param      PunTraceSize                Size of the trace in bytes.
+ *  @param      PunLatencyScalePercent      Scale of the recorded command durations in percent (0 replays without recorded latency).
+ *  @param      PunExtraLatencyUs           Additional latency per command in microseconds.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function or the trace is malformed.
+ *  @retval     RC_E_FAIL                   The memory for the trace could not be allocated.
+ */
+_Check_return_
+UINT32
+TpmReplay_Load(
+    _In_bytecount_(PunTraceSize)    const BYTE*     PrgbTrace,
+    _In_                            UINT32          PunTraceSize,
+    _In_                            UINT32          PunLatencyScalePercent,
+    _In_                            UINT32          PunExtraLatencyUs);
+
+/**
+ *  @brief      Unloads the replay trace
+ *  @details    Releases the trace memory. The function does nothing if no trace is loaded.
+ */
+void
+TpmReplay_Unload();
+
+/**
+ *  @brief      Returns whether a replay trace is loaded
+ *  @details
+ *
+ *  @retval     TRUE        A replay trace is loaded.
+ *  @retval     FALSE       No replay trace is loaded.
+ */
+_Check_return_
+BOOL
+TpmReplay_IsLoaded();
+
+/**
+ *  @brief      Sends a TPM command to the replay trace
+ *  @details    The command code of the command must match the command code of the next record of the trace. Other bytes
+ *              are not compared because nonces and session values differ between runs.
+ *
+ *  @param      PrgsSegments                Segments of the TPM command request.
+ *  @param      PunSegmentCount             Number of segments.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_INITIALIZED        No replay trace is loaded.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA      The trace is exhausted or the command does not match the next record.
+ */
+_Check_return_
+UINT32
+TpmReplay_Send(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            UINT32                  PunSegmentCount);
+
+/**
+ *  @brief      Checks whether the response of the sent command is available
+ *  @details    The response becomes available once the injected latency of the record has elapsed.
+ *
+ *  @param      PpfResponseAvailable        Receives TRUE if the response can be read with TpmReplay_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TpmReplay_Poll(
+    _Out_   BOOL*   PpfResponseAvailable);
+
+/**
+ *  @brief      Receives the recorded response of the sent command
+ *  @details    The function waits until the injected latency of the record has elapsed.
+ *
+ *  @param      PrgbResponseBuffer          Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize      Input size of response buffer, output size of TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_TPM_NO_DATA_AVAILABLE  No command was sent.
+ *  @retval     RC_E_INSUFFICIENT_BUFFER    The response buffer is too small.
+ */
+_Check_return_
+UINT32
+TpmReplay_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)  BYTE*       PrgbResponseBuffer,
+    _Inout_                                 UINT32*     PpunResponseBufferSize);
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    The replay has no transport, so only the wait phase (the injected latency) is reported.
+ *
+ *  @param      PpsTiming       Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+UINT32
+TpmReplay_GetLastPhaseTiming(
+    _Out_   TPM_PHASE_TIMING*   PpsTiming);
+
+#endif //__TPM_REPLAY_H__
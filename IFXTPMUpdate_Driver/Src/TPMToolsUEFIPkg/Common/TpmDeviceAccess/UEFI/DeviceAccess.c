@@ -17,14 +17,186 @@
 #include "Logging.h"
 #include <Library/IoLib.h>                      // Because of TPM-LPC
 
+#include <Library/PcdLib.h>
 #include <Protocol/Tpm2.h>
+#include <Protocol/Tcg2Protocol.h>
 
 #define TIS_INVALID_VALUE  0xFF
 
+//
+// Stall between two checks for a pending TPM interrupt
+//
+#define DEVICE_ACCESS_INTERRUPT_STALL_US  10
+
+//
+// Size of a TPM response header (tag, size and response code)
+//
+#define DEVICE_ACCESS_TPM_HEADER_SIZE  10
+
 STATIC NVIDIA_TPM2_PROTOCOL  *mTpm2 = NULL;
+STATIC NVIDIA_TPM2_PROTOCOL  *mTpm2Instances[DEVICE_ACCESS_MAX_INSTANCES];
+STATIC UINTN                 mTpm2InstanceCount = 0;
+STATIC UINTN                 mTpm2SelectedInstance = 0;
+STATIC EFI_TCG2_PROTOCOL     *mTcg2 = NULL;
+
+STATIC DEVICE_ACCESS_TRACE_RECORD  mTrace[DEVICE_ACCESS_TRACE_CAPACITY];
+STATIC UINT64                      mTraceCount = 0;
+
+STATIC EFI_EVENT         mInterruptEvent   = NULL;
+STATIC volatile BOOLEAN  mInterruptPending = FALSE;
+
+//
+// Sticky bus error state, see DeviceAccess_GetBusError
+//
+STATIC UINT32  mBusError = RC_SUCCESS;
+
+//
+// Bus occupancy of the current duty cycle window and idle time inserted to keep it below
+// PcdIfxTpmBusDutyCyclePercent, see DeviceAccess_Throttle
+//
+STATIC UINT64  mDutyWindowStartTicks = 0;
+STATIC UINT64  mDutyBusyUs           = 0;
+STATIC UINT64  mDutyIdleUs           = 0;
+
+/**
+  Notification of the TPM interrupt event group
+
+  The platform signals gIfxTpmInterruptEventGroupGuid from the handler of the TPM interrupt.
+
+  @param Event    Event whose notification function is being invoked.
+  @param Context  Not used.
+**/
+STATIC
+VOID
+EFIAPI
+DeviceAccessInterruptNotify (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  mInterruptPending = TRUE;
+}
+
+/**
+  Record a register access in the trace ring
+
+  The oldest record is overwritten if the ring is full.
+
+  @param Ticks      Platform_GetTicks value at the start of the access.
+  @param Address    Register address.
+  @param Operation  DEVICE_ACCESS_TRACE_READ_BYTE, ...
+  @param Status     Status of the bus transaction.
+  @param Value      Value read or written or number of bytes for block operations.
+**/
+STATIC
+VOID
+DeviceAccessTrace (
+  IN UINT64      Ticks,
+  IN UINT32      Address,
+  IN UINT8       Operation,
+  IN EFI_STATUS  Status,
+  IN UINT32      Value
+  )
+{
+  DEVICE_ACCESS_TRACE_RECORD  *Record;
+
+  Record             = &mTrace[mTraceCount & (DEVICE_ACCESS_TRACE_CAPACITY - 1)];
+  Record->ullTicks   = Ticks;
+  Record->usAddress  = (UINT16)Address;
+  Record->bOperation = Operation;
+  Record->bStatus    = (UINT8)(Status & 0x7F);
+  if (EFI_ERROR (Status)) {
+    Record->bStatus |= DEVICE_ACCESS_TRACE_STATUS_ERROR;
+  }
+
+  Record->unValue = Value;
+  mTraceCount++;
+}
+
+/**
+  Transfer data to or from a TPM register through the selected TPM2 protocol instance
+
+  The duration of the transaction is accounted to the current duty cycle window, see DeviceAccess_Throttle.
+
+  @param IsRead   TRUE to read the register, FALSE to write it.
+  @param Address  Register address.
+  @param Buffer   Data to write or buffer receiving the data read.
+  @param Size     Number of bytes to transfer.
+  @param Ticks    Receives the Platform_GetTicks value at the start of the bus transaction.
+
+  @retval EFI_SUCCESS  The operation completed successfully.
+  @retval Others       The TPM2 protocol is not available or the transfer failed.
+**/
+STATIC
+EFI_STATUS
+DeviceAccessTransfer (
+  IN     BOOLEAN  IsRead,
+  IN     UINT32   Address,
+  IN OUT UINT8    *Buffer,
+  IN     UINTN    Size,
+  OUT    UINT64   *Ticks
+  )
+{
+  EFI_STATUS  Status;
+
+  *Ticks = Platform_GetTicks ();
+  Status = GetNvidiaTpm2Protocol ();
+  if (!EFI_ERROR (Status)) {
+    Status       = mTpm2->Transfer (mTpm2, IsRead, Address, Buffer, Size);
+    mDutyBusyUs += Platform_TicksToMicroseconds (Platform_GetTicks () - *Ticks);
+  }
+
+  return Status;
+}
+
+/**
+  Enumerate the TPM2 protocol instances
+
+  @retval EFI_SUCCESS  At least one instance was found.
+**/
+STATIC
+EFI_STATUS
+EnumerateNvidiaTpm2Protocols (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+  EFI_HANDLE  *Handles;
+  UINTN       HandleCount;
+  UINTN       Index;
+
+  if (mTpm2InstanceCount != 0) {
+    return EFI_SUCCESS;
+  }
+
+  Handles     = NULL;
+  HandleCount = 0;
+  Status      = gBS->LocateHandleBuffer (ByProtocol, &gNVIDIATpm2ProtocolGuid, NULL, &HandleCount, &Handles);
+  if (!EFI_ERROR (Status)) {
+    for (Index = 0; Index < HandleCount && mTpm2InstanceCount < DEVICE_ACCESS_MAX_INSTANCES; Index++) {
+      Status = gBS->HandleProtocol (Handles[Index], &gNVIDIATpm2ProtocolGuid, (VOID **)&mTpm2Instances[mTpm2InstanceCount]);
+      if (!EFI_ERROR (Status)) {
+        mTpm2InstanceCount++;
+      }
+    }
+
+    FreePool (Handles);
+  }
+
+  if (mTpm2InstanceCount == 0) {
+    DEBUG ((DEBUG_ERROR, "%a: Fail to locate TPM protocol.\n", __FUNCTION__));
+    return EFI_DEVICE_ERROR;
+  }
+
+  if (HandleCount > DEVICE_ACCESS_MAX_INSTANCES) {
+    DEBUG ((DEBUG_WARN, "%a: Only %u of %u TPM protocol instances are used.\n", __FUNCTION__, DEVICE_ACCESS_MAX_INSTANCES, (UINT32)HandleCount));
+  }
+
+  return EFI_SUCCESS;
+}
 
 /**
-  Get TPM2 protocol
+  Get TPM2 protocol of the selected instance
 
   @retval EFI_SUCCESS  The operation completed successfully.
 **/
@@ -40,18 +212,277 @@ GetNvidiaTpm2Protocol (
     return EFI_SUCCESS;
   }
 
-  Status = gBS->LocateProtocol (&gNVIDIATpm2ProtocolGuid, NULL, (VOID **)&mTpm2);
+  Status = EnumerateNvidiaTpm2Protocols ();
   if (EFI_ERROR (Status)) {
-    DEBUG ((DEBUG_ERROR, "%a: Fail to locate TPM protocol.\n", __FUNCTION__));
     return EFI_DEVICE_ERROR;
   }
 
+  if (mTpm2SelectedInstance >= mTpm2InstanceCount) {
+    return EFI_DEVICE_ERROR;
+  }
+
+  mTpm2 = mTpm2Instances[mTpm2SelectedInstance];
+
   return EFI_SUCCESS;
 }
 
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    The TPM instances are enumerated on first use. At most DEVICE_ACCESS_MAX_INSTANCES instances are used.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_GetInstanceCount()
+{
+  if (EFI_ERROR (EnumerateNvidiaTpm2Protocols ())) {
+    return 0;
+  }
+
+  return (unsigned int)mTpm2InstanceCount;
+}
+
+/**
+ *  @brief      Selects the TPM instance used by all following accesses
+ *  @details    Instance 0 is selected by default.
+ *
+ *  @param      PunInstance         Zero based index of the TPM instance.
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  There is no TPM instance with the given index.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_SelectInstance(
+    _In_    unsigned int    PunInstance)
+{
+  if (PunInstance >= DeviceAccess_GetInstanceCount ()) {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  mTpm2SelectedInstance = PunInstance;
+  mTpm2                 = mTpm2Instances[PunInstance];
+
+  return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Returns the records of the register access trace ring
+ *  @details    The register access trace ring always holds the last DEVICE_ACCESS_TRACE_CAPACITY register accesses. The records
+ *              are returned from oldest to newest and stay in the ring. If the buffer is too small, the newest records are returned.
+ *              Call the function with PrgsRecords set to NULL to get the number of records available.
+ *
+ *  @param      PrgsRecords         Buffer receiving the records (optional, can be NULL).
+ *  @param      PpunRecordCount     In:     Capacity of PrgsRecords in records\n
+ *                                  Out:    Number of records written or available if PrgsRecords is NULL
+ *  @param      PpunDroppedCount    Receives the number of register accesses overwritten since the driver was loaded.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_GetTrace(
+    _Out_opt_   DEVICE_ACCESS_TRACE_RECORD* PrgsRecords,
+    _Inout_     unsigned int*               PpunRecordCount,
+    _Out_       unsigned int*               PpunDroppedCount)
+{
+  UINT64  Available;
+  UINT64  Dropped;
+  UINT64  Index;
+
+  if ((NULL == PpunRecordCount) || (NULL == PpunDroppedCount)) {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  Available = MIN (mTraceCount, DEVICE_ACCESS_TRACE_CAPACITY);
+  Dropped   = mTraceCount - Available;
+  *PpunDroppedCount = (Dropped > MAX_UINT32) ? MAX_UINT32 : (unsigned int)Dropped;
+
+  if (NULL == PrgsRecords) {
+    *PpunRecordCount = (unsigned int)Available;
+    return RC_SUCCESS;
+  }
+
+  if (Available > *PpunRecordCount) {
+    Available = *PpunRecordCount;
+  }
+
+  for (Index = 0; Index < Available; Index++) {
+    PrgsRecords[Index] = mTrace[(mTraceCount - Available + Index) & (DEVICE_ACCESS_TRACE_CAPACITY - 1)];
+  }
+
+  *PpunRecordCount = (unsigned int)Available;
+
+  return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Returns whether the platform routes the TPM interrupt to the host
+ *  @details    Only then DeviceAccess_WaitForInterrupt can be signaled.
+ *
+ *  @retval     TRUE        The TPM interrupt is routed.
+ *  @retval     FALSE       The TPM interrupt is not available, the TPM registers must be polled.
+ */
+_Check_return_
+BOOL
+DeviceAccess_IsInterruptRouted()
+{
+  return (mInterruptEvent != NULL);
+}
+
+/**
+ *  @brief      Waits for the TPM interrupt
+ *  @details    Returns as soon as the TPM interrupt was signaled since the last call or the timeout elapsed. The pending
+ *              interrupt is consumed, so an interrupt raised between a register poll and this call is not lost.
+ *
+ *  @param      PunTimeoutUs        Timeout in microseconds.
+ *  @param      PpfSignaled         Receives TRUE if the interrupt was signaled, FALSE on timeout.
+ *  @param      PpunWaitedUs        Receives the time waited in microseconds.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY      The TPM interrupt is not routed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WaitForInterrupt(
+    _In_    unsigned int    PunTimeoutUs,
+    _Out_   BOOL*           PpfSignaled,
+    _Out_   unsigned int*   PpunWaitedUs)
+{
+  EFI_TPL  OldTpl;
+  BOOLEAN  Pending;
+  UINTN    StallUs;
+
+  if ((NULL == PpfSignaled) || (NULL == PpunWaitedUs)) {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  *PpfSignaled  = FALSE;
+  *PpunWaitedUs = 0;
+  if (mInterruptEvent == NULL) {
+    return RC_E_NOT_READY;
+  }
+
+  //
+  // The notification function runs while the TPL is lowered between the stalls
+  //
+  for ( ; ; ) {
+    OldTpl            = gBS->RaiseTPL (TPL_NOTIFY);
+    Pending           = mInterruptPending;
+    mInterruptPending = FALSE;
+    gBS->RestoreTPL (OldTpl);
+
+    if (Pending || (*PpunWaitedUs >= PunTimeoutUs)) {
+      break;
+    }
+
+    StallUs = MIN (DEVICE_ACCESS_INTERRUPT_STALL_US, PunTimeoutUs - *PpunWaitedUs);
+    gBS->Stall (StallUs);
+    *PpunWaitedUs += (unsigned int)StallUs;
+  }
+
+  *PpfSignaled = Pending;
+
+  return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Returns whether the platform TPM driver can be used through EFI_TCG2_PROTOCOL
+ *  @details    The protocol must be installed and report a present TPM. It is only used for the first TPM instance,
+ *              because the platform TPM driver does not address other instances.
+ *
+ *  @retval     TRUE        Commands can be submitted with DeviceAccess_Tcg2SubmitCommand.
+ *  @retval     FALSE       EFI_TCG2_PROTOCOL is not available.
+ */
+_Check_return_
+BOOL
+DeviceAccess_IsTcg2Available()
+{
+  EFI_STATUS                        Status;
+  EFI_TCG2_BOOT_SERVICE_CAPABILITY  Capability;
+
+  if (mTpm2SelectedInstance != 0) {
+    return FALSE;
+  }
+
+  if (mTcg2 == NULL) {
+    Status = gBS->LocateProtocol (&gEfiTcg2ProtocolGuid, NULL, (VOID **)&mTcg2);
+    if (EFI_ERROR (Status)) {
+      mTcg2 = NULL;
+      return FALSE;
+    }
+  }
+
+  ZeroMem (&Capability, sizeof (Capability));
+  Capability.Size = (UINT8)sizeof (Capability);
+  Status          = mTcg2->GetCapability (mTcg2, &Capability);
+  if (EFI_ERROR (Status) || !Capability.TPMPresentFlag) {
+    DEBUG ((DEBUG_INFO, "%a: TCG2 protocol reports no TPM (%r).\n", __FUNCTION__, Status));
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+/**
+ *  @brief      Submits a complete TPM command through EFI_TCG2_PROTOCOL.SubmitCommand
+ *  @details    The platform TPM driver transfers the command and waits for the response.
+ *
+ *  @param      PrgbRequest         TPM command request bytes.
+ *  @param      PunRequestSize      Size of the TPM command request in bytes.
+ *  @param      PrgbResponse        Buffer receiving the TPM command response bytes.
+ *  @param      PpunResponseSize    Input size of the response buffer, output size of the TPM command response in bytes.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_READY          EFI_TCG2_PROTOCOL is not available.
+ *  @retval     RC_E_TPM_TRANSMIT_DATA  SubmitCommand failed.
+ *  @retval     RC_E_TPM_RECEIVE_DATA   The response header is invalid.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_Tcg2SubmitCommand(
+    _In_bytecount_(PunRequestSize)      const BYTE*     PrgbRequest,
+    _In_                                unsigned int    PunRequestSize,
+    _Out_bytecap_(*PpunResponseSize)    BYTE*           PrgbResponse,
+    _Inout_                             unsigned int*   PpunResponseSize)
+{
+  EFI_STATUS  Status;
+  UINT32      ResponseSize;
+
+  if ((NULL == PrgbRequest) || (NULL == PrgbResponse) || (NULL == PpunResponseSize) ||
+      (*PpunResponseSize < DEVICE_ACCESS_TPM_HEADER_SIZE))
+  {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  if (mTcg2 == NULL) {
+    return RC_E_NOT_READY;
+  }
+
+  Status = mTcg2->SubmitCommand (mTcg2, PunRequestSize, (UINT8 *)PrgbRequest, *PpunResponseSize, PrgbResponse);
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_ERROR, "%a: SubmitCommand failed: %r\n", __FUNCTION__, Status));
+    return RC_E_TPM_TRANSMIT_DATA;
+  }
+
+  ResponseSize = SwapBytes32 (ReadUnaligned32 ((UINT32 *)&PrgbResponse[2]));
+  if ((ResponseSize < DEVICE_ACCESS_TPM_HEADER_SIZE) || (ResponseSize > *PpunResponseSize)) {
+    LOGGING_WRITE_LEVEL1_FMT (L"DeviceAccess_Tcg2SubmitCommand: Invalid response size %d", ResponseSize);
+    return RC_E_TPM_RECEIVE_DATA;
+  }
+
+  *PpunResponseSize = ResponseSize;
+
+  return RC_SUCCESS;
+}
+
 /**
  *  @brief      Initialize the device access
- *  @details
+ *  @details    Subscribes to the TPM interrupt event group if the platform routes the TPM interrupt (PcdIfxTpmInterruptRouted)
+ *              and starts a new bus duty cycle window.
  *
  *  @param      PbLocality      Locality value.
  *  @retval     RC_SUCCESS      The operation completed successfully.
@@ -63,12 +494,38 @@ unsigned int
 DeviceAccess_Initialize(
     _In_    BYTE    PbLocality)
 {
+  EFI_STATUS  Status;
+
+  if (FeaturePcdGet (PcdIfxTpmInterruptRouted) && (mInterruptEvent == NULL)) {
+    mInterruptPending = FALSE;
+    Status            = gBS->CreateEventEx (
+                               EVT_NOTIFY_SIGNAL,
+                               TPL_NOTIFY,
+                               DeviceAccessInterruptNotify,
+                               NULL,
+                               &gIfxTpmInterruptEventGroupGuid,
+                               &mInterruptEvent
+                               );
+    if (EFI_ERROR (Status)) {
+      //
+      // Not fatal, the TPM registers are polled then
+      //
+      DEBUG ((DEBUG_WARN, "%a: Fail to create TPM interrupt event: %r\n", __FUNCTION__, Status));
+      mInterruptEvent = NULL;
+    }
+  }
+
+  mBusError             = RC_SUCCESS;
+  mDutyWindowStartTicks = 0;
+  mDutyBusyUs           = 0;
+  mDutyIdleUs           = 0;
+
   return RC_SUCCESS;
 }
 
 /**
  *  @brief      UnInitialize the device access
- *  @details
+ *  @details    Unsubscribes from the TPM interrupt event group and logs the idle time inserted by the bus duty cycle cap.
  *
  *  @param      PbLocality      Locality value.
  *  @retval     RC_SUCCESS      The operation completed successfully.
@@ -79,110 +536,306 @@ unsigned int
 DeviceAccess_Uninitialize(
     _In_    BYTE    PbLocality)
 {
+  if (mInterruptEvent != NULL) {
+    gBS->CloseEvent (mInterruptEvent);
+    mInterruptEvent = NULL;
+  }
+
+  if (mDutyIdleUs != 0) {
+    LOGGING_WRITE_LEVEL3_FMT (L"DeviceAccess_Uninitialize: Bus duty cycle cap inserted %d ms idle time", (UINT32)DivU64x32 (mDutyIdleUs, 1000));
+  }
+
   return RC_SUCCESS;
 }
 
 /**
- *  @brief      Read a Byte from the specified memory address
- *  @details
+ *  @brief      Returns the sticky bus error state
+ *  @details    The state is set by every failed bus transaction and kept until DeviceAccess_ClearBusError is called, so
+ *              a wait loop can abort as soon as the bus fails instead of polling register values that were never read.
  *
- *  @param      PunMemoryAddress    Memory address
- *  @returns    Data value read from specified memory
+ *  @retval     RC_SUCCESS          No bus transaction failed since the state was cleared.
+ *  @retval     RC_E_BUS_ERROR      A bus transaction failed since the state was cleared.
  */
 _Check_return_
-BYTE
-DeviceAccess_ReadByte(
-    _In_    unsigned int PunMemoryAddress)
+unsigned int
+DeviceAccess_GetBusError()
+{
+  return mBusError;
+}
+
+/**
+ *  @brief      Clears the sticky bus error state
+ *  @details    Called at the start of a TPM command, so a transient bus error does not fail the retries.
+ */
+void
+DeviceAccess_ClearBusError()
+{
+  mBusError = RC_SUCCESS;
+}
+
+/**
+ *  @brief      Inserts an idle gap on the bus if the TPM transfers exceed the bus duty cycle cap
+ *  @details    The time spent in mTpm2->Transfer is accumulated per window of PcdIfxTpmBusDutyCycleWindowUs. If it exceeds
+ *              PcdIfxTpmBusDutyCyclePercent of the time elapsed in the window, the CPU stalls until the busy time is back at
+ *              the cap, so other devices behind the same SPI controller get the bus. Called once per transmit and receive
+ *              phase of a TPM command, never within a TIS or CRB transaction. Nothing is inserted while the cap is not
+ *              exceeded or if PcdIfxTpmBusDutyCyclePercent is 0 or 100 or more.
+ */
+void
+DeviceAccess_Throttle()
+{
+  UINT32  Percent;
+  UINT64  ElapsedUs;
+  UINT64  IdleUs;
+
+  Percent = PcdGet32 (PcdIfxTpmBusDutyCyclePercent);
+  if ((Percent == 0) || (Percent >= 100)) {
+    return;
+  }
+
+  ElapsedUs = Platform_TicksToMicroseconds (Platform_GetTicks () - mDutyWindowStartTicks);
+  if ((mDutyWindowStartTicks == 0) || (ElapsedUs >= PcdGet32 (PcdIfxTpmBusDutyCycleWindowUs))) {
+    mDutyWindowStartTicks = Platform_GetTicks ();
+    mDutyBusyUs           = 0;
+    return;
+  }
+
+  if (mDutyBusyUs * 100 <= ElapsedUs * Percent) {
+    return;
+  }
+
+  IdleUs = DivU64x32 (mDutyBusyUs * 100, Percent) - ElapsedUs;
+  gBS->Stall ((UINTN)IdleUs);
+  mDutyIdleUs += IdleUs;
+}
+
+/**
+ *  @brief      Read a Byte from the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PpbData             Receives the value read, 0xFF if the bus transaction failed.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PpbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_ReadByteEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _Out_   BYTE*           PpbData)
 {
   EFI_STATUS  Status;
   BYTE        bData = 0;
+  UINT64      Ticks;
 
-  Status = GetNvidiaTpm2Protocol ();
-  if (EFI_ERROR (Status)) {
-    return TIS_INVALID_VALUE;
+  if (NULL == PpbData) {
+    return RC_E_BAD_PARAMETER;
   }
 
   PunMemoryAddress &= 0xFFFF;
-  Status            = mTpm2->Transfer (mTpm2, TRUE, PunMemoryAddress, &bData, sizeof (bData));
+  Status            = DeviceAccessTransfer (TRUE, PunMemoryAddress, &bData, sizeof (bData), &Ticks);
+
   if (EFI_ERROR (Status)) {
     bData = TIS_INVALID_VALUE;
   }
 
+  DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_READ_BYTE, Status, bData);
+
+  *PpbData = bData;
+  if (EFI_ERROR (Status)) {
+    LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadByte:   Address: %0.8X : failed", PunMemoryAddress);
+    mBusError = RC_E_BUS_ERROR;
+    return RC_E_BUS_ERROR;
+  }
+
   LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadByte:   Address: %0.8X :         %0.2X", PunMemoryAddress, bData);
 
-  return bData;
+  return RC_SUCCESS;
 }
 
 /**
- *  @brief      Write a Byte to the specified memory address
- *  @details
+ *  @brief      Write a Byte to the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
  *
  *  @param      PunMemoryAddress    Memory address.
  *  @param      PbData              Byte to write.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
  */
-void
-DeviceAccess_WriteByte(
+_Check_return_
+unsigned int
+DeviceAccess_WriteByteEx(
     _In_    unsigned int    PunMemoryAddress,
     _In_    BYTE            PbData)
 {
   EFI_STATUS  Status;
+  UINT64      Ticks;
 
-  Status = GetNvidiaTpm2Protocol ();
+  PunMemoryAddress &= 0xFFFF;
+  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_WriteByte:  Address: %0.8X = %0.2X", PunMemoryAddress, PbData);
+  Status = DeviceAccessTransfer (FALSE, PunMemoryAddress, &PbData, sizeof (PbData), &Ticks);
+
+  DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_WRITE_BYTE, Status, PbData);
   if (EFI_ERROR (Status)) {
-    return;
+    mBusError = RC_E_BUS_ERROR;
+    return RC_E_BUS_ERROR;
   }
 
-  PunMemoryAddress &= 0xFFFF;
-  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_WriteByte:  Address: %0.8X = %0.2X", PunMemoryAddress, PbData);
-  Status = mTpm2->Transfer (mTpm2, FALSE, PunMemoryAddress, &PbData, sizeof (PbData));
+  return RC_SUCCESS;
 }
 
 /**
- *  @brief      Read a Word from the specified memory address
- *  @details
+ *  @brief      Read a Word from the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
  *
- *  @param      PunMemoryAddress    Memory address
- *  @returns    Data value read from specified memory
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PpusData            Receives the value read, 0xFFFF if the bus transaction failed.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PpusData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
  */
 _Check_return_
-unsigned short
-DeviceAccess_ReadWord(
-    _In_    unsigned int    PunMemoryAddress)
+unsigned int
+DeviceAccess_ReadWordEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _Out_   unsigned short* PpusData)
 {
   EFI_STATUS      Status;
+  UINT32          unReturnCode;
   unsigned short  usData = 0;
 
+  if (NULL == PpusData) {
+    return RC_E_BAD_PARAMETER;
+  }
+
   // 16 bit read access must be aligned on a 16-bit boundary
   // because of that the access is split up into two 8 bit read's if necessary
   // This restriction is also true for a 16 bit write, and a 32 bit read/write access,
   // (32-bit aligned) but for the LPC-TPM there is so far no use case for this access
   if ((PunMemoryAddress & 1) == 1) {
-    unsigned short  usTemp = 0;
+    BYTE  bLow  = 0;
+    BYTE  bHigh = 0;
     LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadWord:   Address: %0.8X is not word aligned so read it in two byte operations", PunMemoryAddress);
-    usData  = DeviceAccess_ReadByte (PunMemoryAddress);
-    usTemp  = DeviceAccess_ReadByte (PunMemoryAddress + 1);
-    usData |= (usTemp << 8);
-  } else {
-    Status = GetNvidiaTpm2Protocol ();
-    if (EFI_ERROR (Status)) {
-      return 0xFFFF;
+    unReturnCode = DeviceAccess_ReadByteEx (PunMemoryAddress, &bLow);
+    if (RC_SUCCESS == unReturnCode) {
+      unReturnCode = DeviceAccess_ReadByteEx (PunMemoryAddress + 1, &bHigh);
     }
 
+    usData = (RC_SUCCESS == unReturnCode) ? (unsigned short)(bLow | (bHigh << 8)) : 0xFFFF;
+  } else {
+    UINT64  Ticks;
+
     PunMemoryAddress &= 0xFFFF;
-    Status            = mTpm2->Transfer (mTpm2, TRUE, PunMemoryAddress, (UINT8 *)&usData, sizeof (usData));
+    Status            = DeviceAccessTransfer (TRUE, PunMemoryAddress, (UINT8 *)&usData, sizeof (usData), &Ticks);
+
+    unReturnCode = RC_SUCCESS;
     if (EFI_ERROR (Status)) {
-      usData = 0xFFFF;
+      usData       = 0xFFFF;
+      mBusError    = RC_E_BUS_ERROR;
+      unReturnCode = RC_E_BUS_ERROR;
     }
+
+    DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_READ_WORD, Status, usData);
   }
 
   LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadWord:   Address: %0.8X :         %0.4X", PunMemoryAddress, usData);
 
+  *PpusData = usData;
+  return unReturnCode;
+}
+
+/**
+ *  @brief      Write a Word to the specified memory address and return the status of the bus transaction
+ *  @details    Sets the sticky bus error state if the bus transaction fails.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PusData             Data to be written.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WriteWordEx(
+    _In_    unsigned int    PunMemoryAddress,
+    _In_    unsigned short  PusData)
+{
+  EFI_STATUS  Status;
+  UINT64      Ticks;
+
+  PunMemoryAddress &= 0xFFFF;
+  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_WriteWord:  Address: %0.8X = %0.4X", PunMemoryAddress, PusData);
+  Status = DeviceAccessTransfer (FALSE, PunMemoryAddress, (UINT8 *)&PusData, sizeof (PusData), &Ticks);
+
+  DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_WRITE_WORD, Status, PusData);
+  if (EFI_ERROR (Status)) {
+    mBusError = RC_E_BUS_ERROR;
+    return RC_E_BUS_ERROR;
+  }
+
+  return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Read a Byte from the specified memory address
+ *  @details    A failed bus transaction is only reported by the sticky bus error state, see DeviceAccess_ReadByteEx.
+ *
+ *  @param      PunMemoryAddress    Memory address
+ *  @returns    Data value read from specified memory
+ */
+_Check_return_
+BYTE
+DeviceAccess_ReadByte(
+    _In_    unsigned int PunMemoryAddress)
+{
+  BYTE  bData = TIS_INVALID_VALUE;
+
+  IGNORE_RETURN_VALUE (DeviceAccess_ReadByteEx (PunMemoryAddress, &bData));
+
+  return bData;
+}
+
+/**
+ *  @brief      Write a Byte to the specified memory address
+ *  @details    A failed bus transaction is only reported by the sticky bus error state, see DeviceAccess_WriteByteEx.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PbData              Byte to write.
+ */
+void
+DeviceAccess_WriteByte(
+    _In_    unsigned int    PunMemoryAddress,
+    _In_    BYTE            PbData)
+{
+  IGNORE_RETURN_VALUE (DeviceAccess_WriteByteEx (PunMemoryAddress, PbData));
+}
+
+/**
+ *  @brief      Read a Word from the specified memory address
+ *  @details    A failed bus transaction is only reported by the sticky bus error state, see DeviceAccess_ReadWordEx.
+ *
+ *  @param      PunMemoryAddress    Memory address
+ *  @returns    Data value read from specified memory
+ */
+_Check_return_
+unsigned short
+DeviceAccess_ReadWord(
+    _In_    unsigned int    PunMemoryAddress)
+{
+  unsigned short  usData = 0xFFFF;
+
+  IGNORE_RETURN_VALUE (DeviceAccess_ReadWordEx (PunMemoryAddress, &usData));
+
   return usData;
 }
 
 /**
  *  @brief      Write a Word to the specified memory address
- *  @details
+ *  @details    A failed bus transaction is only reported by the sticky bus error state, see DeviceAccess_WriteWordEx.
  *
  *  @param      PunMemoryAddress    Memory address.
  *  @param      PusData             Data to be written.
@@ -191,15 +844,95 @@ void
 DeviceAccess_WriteWord(
     _In_    unsigned int    PunMemoryAddress,
     _In_    unsigned short  PusData)
+{
+  IGNORE_RETURN_VALUE (DeviceAccess_WriteWordEx (PunMemoryAddress, PusData));
+}
+
+/**
+ *  @brief      Read a block of bytes from the specified memory address
+ *  @details    All bytes are read from the same address (e.g. the TIS data FIFO) in a single bus transaction.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PrgbData            Buffer to store the data read.
+ *  @param      PunLength           Number of bytes to read.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PrgbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_ReadBlock(
+    _In_                        unsigned int    PunMemoryAddress,
+    _Out_bytecap_(PunLength)    BYTE*           PrgbData,
+    _In_                        unsigned int    PunLength)
 {
   EFI_STATUS  Status;
+  UINT64      Ticks;
 
-  Status = GetNvidiaTpm2Protocol ();
+  if (NULL == PrgbData) {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  if (0 == PunLength) {
+    return RC_SUCCESS;
+  }
+
+  PunMemoryAddress &= 0xFFFF;
+  Status            = DeviceAccessTransfer (TRUE, PunMemoryAddress, PrgbData, PunLength, &Ticks);
+
+  DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_READ_BLOCK, Status, PunLength);
   if (EFI_ERROR (Status)) {
-    return;
+    SetMem (PrgbData, PunLength, TIS_INVALID_VALUE);
+    LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadBlock:  Address: %0.8X : %d bytes failed", PunMemoryAddress, PunLength);
+    mBusError = RC_E_BUS_ERROR;
+    return RC_E_BUS_ERROR;
+  }
+
+  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_ReadBlock:  Address: %0.8X : %d bytes", PunMemoryAddress, PunLength);
+
+  return RC_SUCCESS;
+}
+
+/**
+ *  @brief      Write a block of bytes to the specified memory address
+ *  @details    All bytes are written to the same address (e.g. the TIS data FIFO) in a single bus transaction.
+ *
+ *  @param      PunMemoryAddress    Memory address.
+ *  @param      PrgbData            Data to be written.
+ *  @param      PunLength           Number of bytes to write.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  PrgbData is NULL.
+ *  @retval     RC_E_BUS_ERROR      The bus transaction failed.
+ */
+_Check_return_
+unsigned int
+DeviceAccess_WriteBlock(
+    _In_                        unsigned int    PunMemoryAddress,
+    _In_bytecount_(PunLength)   const BYTE*     PrgbData,
+    _In_                        unsigned int    PunLength)
+{
+  EFI_STATUS  Status;
+  UINT64      Ticks;
+
+  if (NULL == PrgbData) {
+    return RC_E_BAD_PARAMETER;
+  }
+
+  if (0 == PunLength) {
+    return RC_SUCCESS;
   }
 
   PunMemoryAddress &= 0xFFFF;
-  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_WriteWord:  Address: %0.8X = %0.4X", PunMemoryAddress, PusData);
-  Status = mTpm2->Transfer (mTpm2, FALSE, PunMemoryAddress, (UINT8 *)&PusData, sizeof (PusData));
+  LOGGING_WRITE_LEVEL4_FMT (L"DeviceAccess_WriteBlock: Address: %0.8X = %d bytes", PunMemoryAddress, PunLength);
+  Status = DeviceAccessTransfer (FALSE, PunMemoryAddress, (UINT8 *)PrgbData, PunLength, &Ticks);
+
+  DeviceAccessTrace (Ticks, PunMemoryAddress, DEVICE_ACCESS_TRACE_WRITE_BLOCK, Status, PunLength);
+  if (EFI_ERROR (Status)) {
+    mBusError = RC_E_BUS_ERROR;
+    return RC_E_BUS_ERROR;
+  }
+
+  return RC_SUCCESS;
 }
@@ -17,6 +17,8 @@
 #include "Logging.h"
 #include "DeviceAccess.h"
 #include "TPM_TIS.h"
+#include "TPM_CRB.h"
+#include "TpmReplay.h"
 #include "PropertyStorage.h"
 
 /// Global flag to signalize if module is connected or disconnected
@@ -31,6 +33,192 @@ UINT32 g_unTpmDeviceAccessModeCfg = 0;
 #define PROPERTY_KEEP_LOCALITY_ACTIVE   L"KeepLocalityActive"
 /// Flag indicating locality is set or not
 BOOL s_fIsLocalitySet = FALSE;
+/// Locality used by the connection
+static BYTE s_bConnectedLocality = 0;
+/// Flag indicating that complete TPM2.0 commands are submitted through EFI_TCG2_PROTOCOL (TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL)
+static BOOL s_fTcg2Passthrough = FALSE;
+/// Flag indicating that the last command was submitted through EFI_TCG2_PROTOCOL
+static BOOL s_fLastCommandTcg2 = FALSE;
+/// Durations of the transport phases of the last command submitted through EFI_TCG2_PROTOCOL
+static TPM_PHASE_TIMING s_sTcg2PhaseTiming;
+/// Locality configuration snapshot (PROPERTY_LOCALITY)
+static unsigned int s_unLocalityCfg = 0;
+/// Locality request configuration snapshot (PROPERTY_KEEP_LOCALITY_ACTIVE)
+static BOOL s_fKeepLocalityActiveCfg = FALSE;
+/// Flag indicating that the locality configuration snapshot is valid
+static BOOL s_fLocalityCfgValid = FALSE;
+/// PropertyStorage change count at the time the locality configuration snapshot was taken
+static unsigned int s_unLocalityCfgChangeCount = 0;
+
+/**
+ *  @brief      Returns the locality configuration
+ *  @details    The configuration is read from the PropertyStorage once and kept in a snapshot. The snapshot is only
+ *              refreshed if a property has been changed since then, so a TPM command does not look up the properties.
+ *
+ *  @param      PpunLocality            Receives the configured locality (PROPERTY_LOCALITY), may be NULL.
+ *  @param      PpfKeepLocalityActive   Receives the locality request configuration (PROPERTY_KEEP_LOCALITY_ACTIVE), may be NULL.
+ *
+ *  @retval     TRUE        The configuration was returned.
+ *  @retval     FALSE       A property is missing.
+ */
+static
+BOOL
+TPMIO_GetLocalityConfiguration(
+    _Out_opt_   unsigned int*   PpunLocality,
+    _Out_opt_   BOOL*           PpfKeepLocalityActive)
+{
+    unsigned int unChangeCount = PropertyStorage_GetChangeCount();
+
+    if (!s_fLocalityCfgValid || unChangeCount != s_unLocalityCfgChangeCount)
+    {
+        if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LOCALITY, &s_unLocalityCfg) ||
+                FALSE == PropertyStorage_GetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, &s_fKeepLocalityActiveCfg))
+        {
+            s_fLocalityCfgValid = FALSE;
+            return FALSE;
+        }
+        s_unLocalityCfgChangeCount = unChangeCount;
+        s_fLocalityCfgValid = TRUE;
+    }
+
+    if (NULL != PpunLocality)
+        *PpunLocality = s_unLocalityCfg;
+    if (NULL != PpfKeepLocalityActive)
+        *PpfKeepLocalityActive = s_fKeepLocalityActiveCfg;
+
+    return TRUE;
+}
+
+/**
+ *  @brief      Checks whether a command may be submitted through EFI_TCG2_PROTOCOL
+ *  @details    Only TPM2.0 commands are submitted. A vendor command (e.g. TPM2_FieldUpgradeStartVendor) may switch the
+ *              TPM to boot loader mode, which the platform TPM driver does not expect. So the passthrough is disabled for
+ *              the rest of the connection as soon as a vendor command is transmitted.
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *
+ *  @retval     TRUE        The command is submitted through EFI_TCG2_PROTOCOL.
+ *  @retval     FALSE       The command is transmitted through memory based access.
+ */
+static
+BOOL
+TPMIO_IsTcg2Command(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize)
+{
+    unsigned int unCommandCode = 0;
+
+    if (!s_fTcg2Passthrough || PunRequestBufferSize < 10)
+        return FALSE;
+
+    // TPM_ST_NO_SESSIONS (0x8001) or TPM_ST_SESSIONS (0x8002)
+    if (0x80 != PrgbRequestBuffer[0] || (0x01 != PrgbRequestBuffer[1] && 0x02 != PrgbRequestBuffer[1]))
+        return FALSE;
+
+    unCommandCode = ((unsigned int)PrgbRequestBuffer[6] << 24) | ((unsigned int)PrgbRequestBuffer[7] << 16) |
+                    ((unsigned int)PrgbRequestBuffer[8] << 8) | PrgbRequestBuffer[9];
+    // TPM_CC_V (vendor specific command)
+    if (0 != (unCommandCode & 0x20000000))
+    {
+        LOGGING_WRITE_LEVEL3(L"Vendor command, using memory access routines for the rest of the connection.");
+        s_fTcg2Passthrough = FALSE;
+        return FALSE;
+    }
+
+    return TRUE;
+}
+
+/**
+ *  @brief      Connects to a TPM with the CRB interface
+ *  @details    Checks the interface and (for IFXTPMUPDATE) the vendor of the TPM and begins the locality session if the
+ *              locality shall be kept active. The device access must be initialized.
+ *
+ *  @param      PbLocality                  Locality value.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_COMPONENT_NOT_FOUND    The TPM does not implement the CRB interface or no IFX TPM found.
+ *  @retval     RC_E_NOT_READY              The TPM does not respond.
+ *  @retval     RC_E_INTERNAL               The locality setting could not be read.
+ *  @retval     ...                         Error codes from CRB functions.
+ */
+static
+unsigned int
+TPMIO_ConnectCrb(
+    _In_        BYTE                PbLocality)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BOOL fIsCrb = FALSE;
+        BOOL fKeepLocalityActive = FALSE;
+
+        unReturnValue = CRB_IsInterfaceCrb(PbLocality, &fIsCrb);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not read the interface id (0x%.8X)!", unReturnValue);
+            break;
+        }
+
+        if (!fIsCrb)
+        {
+            unReturnValue = RC_E_COMPONENT_NOT_FOUND;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: TPM does not implement the CRB interface (0x%.8X)!", unReturnValue);
+            break;
+        }
+
+#ifdef IFXTPMUPDATE
+        // Check the presence of an Infineon TPM (via the VID field of TPM_CRB_INTF_ID).
+        {
+            unsigned short usVendorId = 0;
+            unReturnValue = CRB_ReadVendorId(PbLocality, &usVendorId);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not read vendor id (0x%.8X)!", unReturnValue);
+                break;
+            }
+
+            // All bits set means the TPM does not respond (e.g. while it restarts)
+            if (0xFFFF == usVendorId)
+            {
+                unReturnValue = RC_E_NOT_READY;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: TPM does not respond (0x%.8X)!", unReturnValue);
+                break;
+            }
+
+            if (TPM_VID_IFX != usVendorId)
+            {
+                unReturnValue = RC_E_COMPONENT_NOT_FOUND;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: No Infineon TPM found (0x%.8X)!", unReturnValue);
+                break;
+            }
+        }
+#endif
+
+        if (FALSE == TPMIO_GetLocalityConfiguration(NULL, &fKeepLocalityActive))
+        {
+            unReturnValue = RC_E_INTERNAL;
+            break;
+        }
+
+        if (fKeepLocalityActive)
+        {
+            unReturnValue = CRB_BeginLocalitySession(PbLocality);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not request locality (0x%.8X)!", unReturnValue);
+                break;
+            }
+        }
+
+        LOGGING_WRITE_LEVEL4(L"Using CRB access routines");
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
 
 /**
  *  @brief      TPM connect function
@@ -54,6 +242,7 @@ TPMIO_Connect()
         unsigned int unLocality = 0;
         BOOL bFlag = FALSE;
         BOOL fKeepLocalityActive = FALSE;
+        BOOL fTcg2Requested = FALSE;
 
         // Check if already connected
         if (FALSE != g_fConnected)
@@ -69,6 +258,12 @@ TPMIO_Connect()
             break;
         }
 
+        // The TCG2 passthrough only submits complete TPM2.0 commands to the platform TPM driver. All other accesses
+        // (register accesses, segmented commands and commands in boot loader mode) use memory based access.
+        fTcg2Requested = (TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL == g_unTpmDeviceAccessModeCfg);
+        if (fTcg2Requested)
+            g_unTpmDeviceAccessModeCfg = TPM_DEVICE_ACCESS_MEMORY_BASED;
+
         switch (g_unTpmDeviceAccessModeCfg)
         {
             case TPM_DEVICE_ACCESS_MEMORY_BASED:
@@ -77,7 +272,7 @@ TPMIO_Connect()
                 LOGGING_WRITE_LEVEL4(L"Connecting to TPM...");
 
                 // Get the selected locality for TPM access
-                if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LOCALITY, &unLocality))
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
                 {
                     unReturnValue = RC_E_INTERNAL;
                     break;
@@ -93,6 +288,23 @@ TPMIO_Connect()
                 LOGGING_WRITE_LEVEL4(L"Using memory access routines");
                 LOGGING_WRITE_LEVEL4_FMT(L"Using Locality: %d", unLocality);
 
+                // A TPM with the CRB interface has no FIFO registers, so switch to the CRB access routines. The
+                // TPM_CRB_INTF_ID register is located at the offset of TPM_INTERFACE_ID of the FIFO interface.
+                unReturnValue = CRB_IsInterfaceCrb((BYTE)unLocality, &bFlag);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not read the interface id (0x%.8X)!", unReturnValue);
+                    break;
+                }
+
+                if (bFlag)
+                {
+                    LOGGING_WRITE_LEVEL3(L"TPM implements the CRB interface.");
+                    g_unTpmDeviceAccessModeCfg = TPM_DEVICE_ACCESS_CRB;
+                    unReturnValue = TPMIO_ConnectCrb((BYTE)unLocality);
+                    break;
+                }
+
                 // Check the presence of a TPM first
                 // Check whether TPM.ACCESS.VALID
                 unReturnValue = TIS_IsAccessValid((BYTE)unLocality, &bFlag);
@@ -114,12 +326,20 @@ TPMIO_Connect()
                 {
                     unsigned short usVendorId = 0;
                     unReturnValue = TIS_ReadRegister((BYTE)unLocality, TIS_TPM_VID, sizeof(usVendorId), &usVendorId);
-                    if (RC_SUCCESS != unReturnValue)
+                    if (RC_SUCCESS != unReturnValue && RC_E_BUS_ERROR != unReturnValue)
                     {
                         LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not read vendor id (0x%.8X)!", unReturnValue);
                         break;
                     }
 
+                    // All bits set (also returned for a failed bus transaction) means the TPM does not respond (e.g. while it restarts)
+                    if (0xFFFF == usVendorId)
+                    {
+                        unReturnValue = RC_E_NOT_READY;
+                        LOGGING_WRITE_LEVEL1_FMT(L"Error: TPM does not respond (0x%.8X)!", unReturnValue);
+                        break;
+                    }
+
                     if (TPM_VID_IFX != usVendorId)
                     {
                         unReturnValue = RC_E_COMPONENT_NOT_FOUND;
@@ -129,6 +349,14 @@ TPMIO_Connect()
                 }
 #endif
 
+                // Poll with the intervals of the TPM model
+                unReturnValue = TIS_SelectTransportProfile((BYTE)unLocality);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not select the transport profile (0x%.8X)!", unReturnValue);
+                    break;
+                }
+
                 // Remember if locality was active at the time when program started. In this case the locality will be restored
                 // to initial value after this program disconnects from the TPM.
                 unReturnValue = TIS_IsActiveLocality((BYTE)unLocality, &s_fIsLocalitySet);
@@ -140,7 +368,7 @@ TPMIO_Connect()
 
                 // Shall locality be requested only once before first TPM command and release after last TPM response or shall
                 // it be requested and released for each TPM command?
-                if (FALSE == PropertyStorage_GetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, &fKeepLocalityActive))
+                if (FALSE == TPMIO_GetLocalityConfiguration(NULL, &fKeepLocalityActive))
                 {
                     unReturnValue = RC_E_INTERNAL;
                     break;
@@ -149,16 +377,59 @@ TPMIO_Connect()
                 if (fKeepLocalityActive)
                 {
                     // Request locality once, keep active as long as this program communicates with the TPM.
-                    unReturnValue = TIS_RequestUse((BYTE)unLocality);
+                    // The session is ended on disconnect, so a reconnect after a TPM restart requests it again.
+                    unReturnValue = TIS_BeginLocalitySession((BYTE)unLocality);
                     if (RC_SUCCESS != unReturnValue)
                     {
                         LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not request locality (0x%.8X)!", unReturnValue);
                         break;
                     }
 
-                    TIS_KeepLocalityActive();
+                    // Wait for TPM interrupts instead of polling if the platform routes them. The interrupt registers can
+                    // only be written with an active locality, so this is limited to the locality session.
+                    unReturnValue = TIS_EnableInterrupts((BYTE)unLocality);
+                    if (RC_SUCCESS != unReturnValue)
+                    {
+                        LOGGING_WRITE_LEVEL1_FMT(L"Error: Could not enable TPM interrupts (0x%.8X)!", unReturnValue);
+                        break;
+                    }
+                }
+
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
                 }
 
+                unReturnValue = DeviceAccess_Initialize((BYTE)unLocality);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Initializing LowLevelIO failed (0x%.8X)!", unReturnValue);
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL4_FMT(L"Using Locality: %d", unLocality);
+                unReturnValue = TPMIO_ConnectCrb((BYTE)unLocality);
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                // Commands are answered from the loaded trace, no TPM is accessed
+                if (!TpmReplay_IsLoaded())
+                {
+                    unReturnValue = RC_E_NOT_READY;
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: No replay trace loaded (0x%.8X)!", unReturnValue);
+                    break;
+                }
+                LOGGING_WRITE_LEVEL4(L"Using replay trace");
+                unReturnValue = RC_SUCCESS;
                 break;
             }
 
@@ -173,7 +444,15 @@ TPMIO_Connect()
         if (RC_SUCCESS != unReturnValue)
             break;
 
+        // The platform TPM driver uses locality 0
+        if (fTcg2Requested)
+        {
+            s_fTcg2Passthrough = (0 == unLocality) && DeviceAccess_IsTcg2Available();
+            LOGGING_WRITE_LEVEL3_FMT(L"EFI_TCG2_PROTOCOL passthrough: %d", s_fTcg2Passthrough);
+        }
+
         LOGGING_WRITE_LEVEL4(L"Connected to TPM");
+        s_bConnectedLocality = (BYTE)unLocality;
         g_fConnected = TRUE;
     }
     WHILE_FALSE_END;
@@ -184,99 +463,124 @@ TPMIO_Connect()
 }
 
 /**
- *  @brief      TPM disconnect function
- *  @details    This function handles the disconnect to the underlying TPM.
+ *  @brief      TPM revalidate function
+ *  @details    Checks that the connection is still usable after the TPM may have restarted (e.g. a switch to or from boot
+ *              loader mode) without tearing down the device access. The access and vendor id registers are read again
+ *              and a locality session which was lost with the restart is requested again. Configuration read at
+ *              connect time is kept.
  *
- *  @retval     RC_SUCCESS              The operation completed successfully.
- *  @retval     RC_E_NOT_CONNECTED      If TPM I/O is not connected to the TPM.
- *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
- *  @retval     ...                     Error codes from DeviceAccess_Uninitialize function.
+ *  @retval     RC_SUCCESS                  The connection is usable.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_NOT_READY              The TPM does not respond yet, the connection is kept.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ *  @retval     ...                         Error codes from TIS and CRB functions. The caller should reconnect.
  */
 _Check_return_
 unsigned int
-TPMIO_Disconnect()
+TPMIO_Revalidate()
 {
     unsigned int unReturnValue = RC_E_FAIL;
-
     LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
 
     do
     {
-        unsigned int unLocality = 0;
-        BOOL fKeepLocalityActive = FALSE;
+        BOOL fFlag = FALSE;
+        unsigned short usVendorId = 0;
 
-        // Check if connected to the TPM
         if (FALSE == g_fConnected)
         {
             unReturnValue = RC_E_NOT_CONNECTED;
             break;
         }
 
-        // Try to disconnect the TPM and check return code
-        LOGGING_WRITE_LEVEL4(L"Disconnecting from TPM...");
-
         switch (g_unTpmDeviceAccessModeCfg)
         {
             case TPM_DEVICE_ACCESS_MEMORY_BASED:
             {
-                // Get the selected locality for TPM access
-                if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LOCALITY, &unLocality))
+                // The cached register values may be from before the restart
+                TIS_InvalidateCachedRegisters();
+
+                unReturnValue = TIS_IsAccessValid(s_bConnectedLocality, &fFlag);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                if (fFlag)
+                    unReturnValue = TIS_ReadRegister(s_bConnectedLocality, TIS_TPM_VID, sizeof(usVendorId), &usVendorId);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                // All bits set means the TPM does not respond (e.g. while it restarts)
+                if (!fFlag || 0xFFFF == usVendorId)
                 {
-                    unReturnValue = RC_E_INTERNAL;
-                    LOGGING_WRITE_LEVEL1(L"PropertyStorage_GetUIntegerValueByKey Locality is missing.");
+                    unReturnValue = RC_E_NOT_READY;
                     break;
                 }
 
-                // Do we need to release locality after all
-                if (FALSE == PropertyStorage_GetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, &fKeepLocalityActive))
-                {
-                    unReturnValue = RC_E_INTERNAL;
+                if (!TIS_IsLocalitySessionActive(s_bConnectedLocality))
                     break;
-                }
 
-                if (fKeepLocalityActive)
-                {
-                    unReturnValue = TIS_ReleaseActiveLocality((BYTE)unLocality);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        LOGGING_WRITE_LEVEL1_FMT(L"Error Could not release locality: 0x%.8X", unReturnValue);
-                        break;
-                    }
-                }
+                unReturnValue = TIS_IsActiveLocality(s_bConnectedLocality, &fFlag);
+                if (RC_SUCCESS != unReturnValue || fFlag)
+                    break;
 
-                // Request locality again if it was set at the time when this program started.
-                if (s_fIsLocalitySet)
-                {
-                    unReturnValue = TIS_RequestUse((BYTE)unLocality);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        LOGGING_WRITE_LEVEL1_FMT(L"Error Could not request locality: 0x%.8X", unReturnValue);
-                        break;
-                    }
+                // The TPM restarted and dropped the locality, request it again and re-enable the interrupts
+                LOGGING_WRITE_LEVEL3(L"Locality lost, requesting it again.");
+                IGNORE_RETURN_VALUE(TIS_DisableInterrupts(s_bConnectedLocality));
+                IGNORE_RETURN_VALUE(TIS_EndLocalitySession());
+                unReturnValue = TIS_BeginLocalitySession(s_bConnectedLocality);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unReturnValue = TIS_EnableInterrupts(s_bConnectedLocality);
+                break;
+            }
 
-                    s_fIsLocalitySet = FALSE;
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                unReturnValue = CRB_IsInterfaceCrb(s_bConnectedLocality, &fFlag);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                if (fFlag)
+                    unReturnValue = CRB_ReadVendorId(s_bConnectedLocality, &usVendorId);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                if (!fFlag || 0xFFFF == usVendorId)
+                {
+                    unReturnValue = RC_E_NOT_READY;
+                    break;
                 }
 
-                unReturnValue = DeviceAccess_Uninitialize((BYTE)unLocality);
+                unReturnValue = CRB_IsLocalityActive(s_bConnectedLocality, &fFlag);
+                if (RC_SUCCESS != unReturnValue || fFlag)
+                    break;
+
+                // Only a locality session keeps the locality between commands
+                unReturnValue = CRB_EndLocalitySession();
                 if (RC_SUCCESS != unReturnValue)
+                    break;
+                if (FALSE == TPMIO_GetLocalityConfiguration(NULL, &fFlag))
                 {
-                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Device uninitializing failed (0x%.8X)!", unReturnValue);
+                    unReturnValue = RC_E_INTERNAL;
                     break;
                 }
+                if (fFlag)
+                {
+                    LOGGING_WRITE_LEVEL3(L"Locality lost, requesting it again.");
+                    unReturnValue = CRB_BeginLocalitySession(s_bConnectedLocality);
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_IsLoaded() ? RC_SUCCESS : RC_E_NOT_READY;
                 break;
             }
 
             default:
             {
                 unReturnValue = RC_E_INTERNAL;
-                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: An Unknown or unsupported device access routine is configured (0x%.8x)!", unReturnValue);
                 break;
             }
         }
-
-        LOGGING_WRITE_LEVEL4(L"Disconnected from TPM");
-        g_fConnected = FALSE;
-        g_unTpmDeviceAccessModeCfg = 0;
     }
     WHILE_FALSE_END;
 
@@ -286,29 +590,17 @@ TPMIO_Disconnect()
 }
 
 /**
- *  @brief      TPM transmit function
- *  @details    This function submits the TPM command to the underlying TPM.
- *
- *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
- *  @param      PunRequestBufferSize    Size of command request in bytes.
- *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
- *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
- *  @param      PunMaxDuration          The maximum duration of the command in microseconds (relevant for memory based access / TIS protocol only).
+ *  @brief      TPM disconnect function
+ *  @details    This function handles the disconnect to the underlying TPM.
  *
  *  @retval     RC_SUCCESS              The operation completed successfully.
- *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
- *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_NOT_CONNECTED      If TPM I/O is not connected to the TPM.
  *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
- *  @retval     ...                     Error codes from called functions.
+ *  @retval     ...                     Error codes from DeviceAccess_Uninitialize function.
  */
 _Check_return_
 unsigned int
-TPMIO_Transmit(
-    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
-    _In_                                        unsigned int    PunRequestBufferSize,
-    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
-    _Inout_                                     unsigned int*   PpunResponseBufferSize,
-    _In_                                        unsigned int    PunMaxDuration)
+TPMIO_Disconnect()
 {
     unsigned int unReturnValue = RC_E_FAIL;
 
@@ -318,12 +610,6 @@ TPMIO_Transmit(
     {
         unsigned int unLocality = 0;
 
-        // Check parameters
-        if (NULL == PrgbRequestBuffer || NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
-        {
-            unReturnValue = RC_E_BAD_PARAMETER;
-            break;
-        }
         // Check if connected to the TPM
         if (FALSE == g_fConnected)
         {
@@ -331,36 +617,568 @@ TPMIO_Transmit(
             break;
         }
 
+        // Try to disconnect the TPM and check return code
+        LOGGING_WRITE_LEVEL4(L"Disconnecting from TPM...");
+
         switch (g_unTpmDeviceAccessModeCfg)
         {
             case TPM_DEVICE_ACCESS_MEMORY_BASED:
             {
                 // Get the selected locality for TPM access
-                if (FALSE == PropertyStorage_GetUIntegerValueByKey(PROPERTY_LOCALITY, &unLocality))
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
                 {
                     unReturnValue = RC_E_INTERNAL;
+                    LOGGING_WRITE_LEVEL1(L"Locality configuration is missing.");
                     break;
                 }
 
-                LOGGING_WRITE_LEVEL3(L"Transmission of data via TIS.");
-
-                unReturnValue = TIS_TransceiveLPC(
-                                    (BYTE)unLocality,
-                                    PrgbRequestBuffer,
-                                    (UINT16)PunRequestBufferSize,
-                                    PrgbResponseBuffer,
-                                    (UINT16*)PpunResponseBufferSize,
-                                    PunMaxDuration);
+                // Disable the TPM interrupts while the locality of the session is still active (no-op in polling mode)
+                unReturnValue = TIS_DisableInterrupts((BYTE)unLocality);
+                if (RC_SUCCESS != unReturnValue)
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error Could not disable TPM interrupts: 0x%.8X", unReturnValue);
 
+                // Release the locality held by the session of TPMIO_Connect (no-op if the locality was handled per command)
+                unReturnValue = TIS_EndLocalitySession();
                 if (RC_SUCCESS != unReturnValue)
                 {
-                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Transmission of data via TIS failed (0x%.8x)!", unReturnValue);
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error Could not release locality: 0x%.8X", unReturnValue);
                     break;
                 }
-                break;
-            }
 
-            default:
+                // Request locality again if it was set at the time when this program started.
+                if (s_fIsLocalitySet)
+                {
+                    unReturnValue = TIS_RequestUse((BYTE)unLocality);
+                    if (RC_SUCCESS != unReturnValue)
+                    {
+                        LOGGING_WRITE_LEVEL1_FMT(L"Error Could not request locality: 0x%.8X", unReturnValue);
+                        break;
+                    }
+
+                    s_fIsLocalitySet = FALSE;
+                }
+
+                unReturnValue = DeviceAccess_Uninitialize((BYTE)unLocality);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Device uninitializing failed (0x%.8X)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    LOGGING_WRITE_LEVEL1(L"Locality configuration is missing.");
+                    break;
+                }
+
+                // Put the TPM into the idle state and relinquish the locality of the session (no-op without session)
+                unReturnValue = CRB_EndLocalitySession();
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error Could not release locality: 0x%.8X", unReturnValue);
+                    break;
+                }
+
+                unReturnValue = DeviceAccess_Uninitialize((BYTE)unLocality);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Device uninitializing failed (0x%.8X)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                // The trace stays loaded and continues with the next record on the next connect
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+
+        LOGGING_WRITE_LEVEL4(L"Disconnected from TPM");
+        g_fConnected = FALSE;
+        g_unTpmDeviceAccessModeCfg = 0;
+        s_fTcg2Passthrough = FALSE;
+        s_fLastCommandTcg2 = FALSE;
+        s_fLocalityCfgValid = FALSE;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM transmit function
+ *  @details    This function submits the TPM command to the underlying TPM.
+ *
+ *  @param      PrgbRequestBuffer       Pointer to a byte array containing the TPM command request bytes.
+ *  @param      PunRequestBufferSize    Size of command request in bytes.
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds (relevant for memory based access / TIS protocol only).
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (relevant for memory based access / TIS protocol only).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Transmit(
+    _In_bytecount_(PunRequestBufferSize)        const BYTE*     PrgbRequestBuffer,
+    _In_                                        unsigned int    PunRequestBufferSize,
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unLocality = 0;
+
+        // Check parameters
+        if (NULL == PrgbRequestBuffer || NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        s_fLastCommandTcg2 = FALSE;
+        if (TPMIO_IsTcg2Command(PrgbRequestBuffer, PunRequestBufferSize))
+        {
+            unsigned long long ullStartTicks = Platform_GetTicks();
+
+            LOGGING_WRITE_LEVEL3(L"Transmission of data via EFI_TCG2_PROTOCOL.");
+
+            unReturnValue = DeviceAccess_Tcg2SubmitCommand(PrgbRequestBuffer, PunRequestBufferSize, PrgbResponseBuffer, PpunResponseBufferSize);
+
+            // The platform TPM driver does not report the transport phases, the whole command counts as wait phase
+            Platform_MemorySet(&s_sTcg2PhaseTiming, 0, sizeof(s_sTcg2PhaseTiming));
+            s_sTcg2PhaseTiming.ullWaitUs = Platform_TicksToMicroseconds(Platform_GetTicks() - ullStartTicks);
+            s_fLastCommandTcg2 = TRUE;
+            if (RC_SUCCESS != unReturnValue)
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Transmission of data via EFI_TCG2_PROTOCOL failed (0x%.8x)!", unReturnValue);
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_MEMORY_BASED:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Transmission of data via TIS.");
+
+                unReturnValue = TIS_TransceiveLPC(
+                                    (BYTE)unLocality,
+                                    PrgbRequestBuffer,
+                                    (UINT16)PunRequestBufferSize,
+                                    PrgbResponseBuffer,
+                                    (UINT16*)PpunResponseBufferSize,
+                                    PunMaxDuration,
+                                    PunExpectedDuration);
+
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Transmission of data via TIS failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                TPM_TX_SEGMENT sSegment;
+                sSegment.pbData = PrgbRequestBuffer;
+                sSegment.unSize = PunRequestBufferSize;
+
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Transmission of data via CRB.");
+
+                unReturnValue = CRB_Send((BYTE)unLocality, &sSegment, 1);
+                if (RC_SUCCESS == unReturnValue)
+                    unReturnValue = CRB_Receive((BYTE)unLocality, PrgbResponseBuffer, PpunResponseBufferSize, PunMaxDuration, PunExpectedDuration);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Transmission of data via CRB failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                TPM_TX_SEGMENT sSegment;
+                sSegment.pbData = PrgbRequestBuffer;
+                sSegment.unSize = PunRequestBufferSize;
+
+                unReturnValue = TpmReplay_Send(&sSegment, 1);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unReturnValue = TpmReplay_Receive(PrgbResponseBuffer, PpunResponseBufferSize);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM send function
+ *  @details    This function submits the TPM command to the underlying TPM without waiting for the response.
+ *              The command is passed as a list of segments which are written to the TPM in order.
+ *              The response must be collected with TPMIO_Receive before the next command is sent.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Send(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unLocality = 0;
+
+        // Check parameters
+        if (NULL == PrgsSegments || 0 == PunSegmentCount)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        // Segmented commands are never submitted through EFI_TCG2_PROTOCOL
+        s_fLastCommandTcg2 = FALSE;
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_MEMORY_BASED:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Sending data via TIS.");
+
+                unReturnValue = TIS_SendLPCSegments((BYTE)unLocality, PrgsSegments, PunSegmentCount);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Sending data via TIS failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Sending data via CRB.");
+
+                unReturnValue = CRB_Send((BYTE)unLocality, PrgsSegments, PunSegmentCount);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Sending data via CRB failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Send(PrgsSegments, PunSegmentCount);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM receive function
+ *  @details    This function waits for the response of the TPM command submitted with TPMIO_Send.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds (relevant for memory based access / TIS protocol only).
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (relevant for memory based access / TIS protocol only).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unLocality = 0;
+
+        // Check parameters
+        if (NULL == PrgbResponseBuffer || NULL == PpunResponseBufferSize)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_MEMORY_BASED:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Receiving data via TIS.");
+
+                unReturnValue = TIS_ReceiveLPC(
+                                    (BYTE)unLocality,
+                                    PrgbResponseBuffer,
+                                    (UINT16*)PpunResponseBufferSize,
+                                    PunMaxDuration,
+                                    PunExpectedDuration);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Receiving data via TIS failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3(L"Receiving data via CRB.");
+
+                unReturnValue = CRB_Receive((BYTE)unLocality, PrgbResponseBuffer, PpunResponseBufferSize, PunMaxDuration, PunExpectedDuration);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Receiving data via CRB failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Receive(PrgbResponseBuffer, PpunResponseBufferSize);
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      TPM poll function
+ *  @details    This function checks once, without waiting, if the response of the TPM command submitted with TPMIO_Send
+ *              is available.
+ *
+ *  @param      PpfResponseAvailable    Receives TRUE if the response can be read with TPMIO_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Poll(
+    _Out_       BOOL*               PpfResponseAvailable)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unLocality = 0;
+
+        // Check parameters
+        if (NULL == PpfResponseAvailable)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *PpfResponseAvailable = FALSE;
+
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_MEMORY_BASED:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                unReturnValue = TIS_IsDataAvailable((BYTE)unLocality, PpfResponseAvailable);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Polling data via TIS failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                unReturnValue = CRB_Poll((BYTE)unLocality, PpfResponseAvailable);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Polling data via CRB failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                unReturnValue = TpmReplay_Poll(PpfResponseAvailable);
+                break;
+            }
+
+            default:
             {
                 unReturnValue = RC_E_INTERNAL;
                 LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
@@ -375,6 +1193,59 @@ TPMIO_Transmit(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    This function returns the number of TPMs available through the underlying device access.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInstanceCount()
+{
+    return DeviceAccess_GetInstanceCount();
+}
+
+/**
+ *  @brief      Selects the TPM instance
+ *  @details    All following connects and TPM commands use the selected TPM instance. The instance can only be changed
+ *              while TPM I/O is disconnected.
+ *
+ *  @param      PunInstance                 Zero based index of the TPM instance.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_ALREADY_CONNECTED      If TPM I/O is connected.
+ *  @retval     RC_E_BAD_PARAMETER          There is no TPM instance with the given index.
+ */
+_Check_return_
+unsigned int
+TPMIO_SelectInstance(
+    _In_        unsigned int        PunInstance)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        // Check if connected to the TPM
+        if (FALSE != g_fConnected)
+        {
+            unReturnValue = RC_E_ALREADY_CONNECTED;
+            break;
+        }
+
+        unReturnValue = DeviceAccess_SelectInstance(PunInstance);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        // The cached register values belong to the previous instance
+        TIS_InvalidateCachedRegisters();
+        LOGGING_WRITE_LEVEL3_FMT(L"TPM instance %d selected.", PunInstance);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      Read a byte from a specific address (register)
  *  @details    This function reads a byte from the specified address
@@ -474,3 +1345,159 @@ TPMIO_WriteRegister(
 
     return unReturnValue;
 }
+
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    This function returns the time needed to send the last command, to wait for its response and to read
+ *              the response.
+ *
+ *  @param      PpsTiming                   Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetLastPhaseTiming(
+    _Out_       TPM_PHASE_TIMING*   PpsTiming)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    switch (s_fLastCommandTcg2 ? TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL : g_unTpmDeviceAccessModeCfg)
+    {
+        case TPM_DEVICE_ACCESS_MEMORY_BASED:
+        {
+            unReturnValue = TIS_GetLastPhaseTiming(PpsTiming);
+            break;
+        }
+
+        case TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL:
+        {
+            if (NULL == PpsTiming)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            *PpsTiming = s_sTcg2PhaseTiming;
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        case TPM_DEVICE_ACCESS_CRB:
+        {
+            unReturnValue = CRB_GetLastPhaseTiming(PpsTiming);
+            break;
+        }
+
+        case TPM_DEVICE_ACCESS_REPLAY:
+        {
+            unReturnValue = TpmReplay_GetLastPhaseTiming(PpsTiming);
+            break;
+        }
+
+        default:
+        {
+            unReturnValue = RC_E_INTERNAL;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access routine configured (0x%.8x)!", unReturnValue);
+            break;
+        }
+    }
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Returns the identification of the TPM read from its interface registers
+ *  @details    This function reads vendor, device and revision id and the interface type without sending a TPM command.
+ *              The derived TPM family can be used to pick the command sequence for probing the TPM. For device access
+ *              modes without TPM registers (e.g. the replay trace) the family is TPM_INTERFACE_FAMILY_UNKNOWN.
+ *
+ *  @param      PpsInfo                     Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL               Unsupported device access or locality setting.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInterfaceInfo(
+    _Out_       TPM_INTERFACE_INFO* PpsInfo)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    LOGGING_WRITE_LEVEL4(LOGGING_METHOD_ENTRY_STRING);
+
+    do
+    {
+        unsigned int unLocality = 0;
+
+        // Check parameters
+        if (NULL == PpsInfo)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        Platform_MemorySet(PpsInfo, 0, sizeof(*PpsInfo));
+
+        // Check if connected to the TPM
+        if (FALSE == g_fConnected)
+        {
+            unReturnValue = RC_E_NOT_CONNECTED;
+            break;
+        }
+
+        switch (g_unTpmDeviceAccessModeCfg)
+        {
+            case TPM_DEVICE_ACCESS_MEMORY_BASED:
+            case TPM_DEVICE_ACCESS_CRB:
+            {
+                // Get the selected locality for TPM access
+                if (FALSE == TPMIO_GetLocalityConfiguration(&unLocality, NULL))
+                {
+                    unReturnValue = RC_E_INTERNAL;
+                    break;
+                }
+
+                if (TPM_DEVICE_ACCESS_CRB == g_unTpmDeviceAccessModeCfg)
+                    unReturnValue = CRB_ReadInterfaceInfo((BYTE)unLocality, PpsInfo);
+                else
+                    unReturnValue = TIS_ReadInterfaceInfo((BYTE)unLocality, PpsInfo);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error: Reading the interface registers failed (0x%.8x)!", unReturnValue);
+                    break;
+                }
+
+                LOGGING_WRITE_LEVEL3_FMT(L"TPM VID 0x%.4X DID 0x%.4X RID 0x%.2X, interface type 0x%X version %d, family %d",
+                    PpsInfo->usVendorId, PpsInfo->usDeviceId, PpsInfo->bRevisionId, PpsInfo->bInterfaceType, PpsInfo->bInterfaceVersion, PpsInfo->bFamily);
+                break;
+            }
+
+            case TPM_DEVICE_ACCESS_REPLAY:
+            {
+                // The replay trace has no registers, the family stays unknown
+                unReturnValue = RC_SUCCESS;
+                break;
+            }
+
+            default:
+            {
+                unReturnValue = RC_E_INTERNAL;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: Unknown device access mode configured (0x%.8x)!", unReturnValue);
+                break;
+            }
+        }
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL4_FMT(LOGGING_METHOD_EXIT_STRING_RET_VAL, unReturnValue);
+
+    return unReturnValue;
+}
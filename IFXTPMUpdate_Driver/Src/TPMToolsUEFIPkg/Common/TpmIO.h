@@ -25,6 +25,10 @@ unsigned int
 typedef
 unsigned int
 (*PFN_TPMIO_Disconnect)();
+/// Function pointer to method for revalidating the connection to the TPM
+typedef
+unsigned int
+(*PFN_TPMIO_Revalidate)();
 /// Function pointer to method for transmitting data to the TPM
 typedef
 unsigned int
@@ -33,7 +37,27 @@ unsigned int
     unsigned int    PunRequestBufferSize,
     BYTE*           PrgbResponseBuffer,
     unsigned int*   PpunResponseBufferSize,
-    unsigned int    PunMaxDuration);
+    unsigned int    PunMaxDuration,
+    unsigned int    PunExpectedDuration);
+/// Function pointer to method for sending a command to the TPM without waiting for the response
+typedef
+unsigned int
+(*PFN_TPMIO_Send)(
+    const TPM_TX_SEGMENT*   PrgsSegments,
+    unsigned int            PunSegmentCount);
+/// Function pointer to method for receiving the response of a command sent to the TPM
+typedef
+unsigned int
+(*PFN_TPMIO_Receive)(
+    BYTE*           PrgbResponseBuffer,
+    unsigned int*   PpunResponseBufferSize,
+    unsigned int    PunMaxDuration,
+    unsigned int    PunExpectedDuration);
+/// Function pointer to method for checking if the response of a command sent to the TPM is available
+typedef
+unsigned int
+(*PFN_TPMIO_Poll)(
+    BOOL*           PpfResponseAvailable);
 /// Function pointer to read a byte from a register of the TPM
 typedef
 unsigned int
@@ -46,6 +70,16 @@ unsigned int
 (*PFN_TPMIO_WriteRegister)(
     unsigned int    PunRegisterAddress,
     BYTE            PbRegisterValue);
+/// Function pointer to method for getting the transport phase durations of the last TPM command
+typedef
+unsigned int
+(*PFN_TPMIO_GetLastPhaseTiming)(
+    TPM_PHASE_TIMING*   PpsTiming);
+/// Function pointer to method for reading the identification of the TPM from its interface registers
+typedef
+unsigned int
+(*PFN_TPMIO_GetInterfaceInfo)(
+    TPM_INTERFACE_INFO* PpsInfo);
 
 /**
  *  @brief      TPM connect function
@@ -74,6 +108,23 @@ _Check_return_
 unsigned int
 TPMIO_Disconnect();
 
+/**
+ *  @brief      TPM revalidate function
+ *  @details    Checks that the connection is still usable after the TPM may have restarted (e.g. a switch to or from boot
+ *              loader mode) without tearing down the device access. The access and vendor id registers are read again
+ *              and a locality session which was lost with the restart is requested again. Configuration read at
+ *              connect time is kept.
+ *
+ *  @retval     RC_SUCCESS                  The connection is usable.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_NOT_READY              The TPM does not respond yet, the connection is kept.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ *  @retval     ...                         Error codes from TIS and CRB functions. The caller should reconnect.
+ */
+_Check_return_
+unsigned int
+TPMIO_Revalidate();
+
 /**
  *  @brief      TPM transmit function
  *  @details    This function submits the TPM command to the underlying TPM.
@@ -83,6 +134,7 @@ TPMIO_Disconnect();
  *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
  *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
  *  @param      PunMaxDuration          The maximum duration of the command in microseconds (relevant for memory based access / TIS protocol only).
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (relevant for memory based access / TIS protocol only).
  *
  *  @retval     RC_SUCCESS              The operation completed successfully.
  *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
@@ -97,7 +149,96 @@ TPMIO_Transmit(
     _In_                                        unsigned int    PunRequestBufferSize,
     _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
     _Inout_                                     unsigned int*   PpunResponseBufferSize,
-    _In_                                        unsigned int    PunMaxDuration);
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration);
+
+/**
+ *  @brief      TPM send function
+ *  @details    This function submits the TPM command to the underlying TPM without waiting for the response.
+ *              The command is passed as a list of segments which are written to the TPM in order.
+ *              The response must be collected with TPMIO_Receive before the next command is sent.
+ *
+ *  @param      PrgsSegments            Segments of the TPM command request.
+ *  @param      PunSegmentCount         Number of segments.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Send(
+    _In_count_(PunSegmentCount)     const TPM_TX_SEGMENT*   PrgsSegments,
+    _In_                            unsigned int            PunSegmentCount);
+
+/**
+ *  @brief      TPM receive function
+ *  @details    This function waits for the response of the TPM command submitted with TPMIO_Send.
+ *
+ *  @param      PrgbResponseBuffer      Pointer to a byte array receiving the TPM command response bytes.
+ *  @param      PpunResponseBufferSize  Input size of response buffer, output size of TPM command response in bytes.
+ *  @param      PunMaxDuration          The maximum duration of the command in microseconds (relevant for memory based access / TIS protocol only).
+ *  @param      PunExpectedDuration     The expected duration of the command in microseconds, 0 if unknown (relevant for memory based access / TIS protocol only).
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Receive(
+    _Out_bytecap_(*PpunResponseBufferSize)      BYTE*           PrgbResponseBuffer,
+    _Inout_                                     unsigned int*   PpunResponseBufferSize,
+    _In_                                        unsigned int    PunMaxDuration,
+    _In_                                        unsigned int    PunExpectedDuration);
+
+/**
+ *  @brief      TPM poll function
+ *  @details    This function checks once, without waiting, if the response of the TPM command submitted with TPMIO_Send
+ *              is available.
+ *
+ *  @param      PpfResponseAvailable    Receives TRUE if the response can be read with TPMIO_Receive, FALSE otherwise.
+ *
+ *  @retval     RC_SUCCESS              The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER      An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED      If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL           Unsupported device access or locality setting.
+ *  @retval     ...                     Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_Poll(
+    _Out_       BOOL*               PpfResponseAvailable);
+
+/**
+ *  @brief      Returns the number of TPM instances
+ *  @details    This function returns the number of TPMs available through the underlying device access.
+ *
+ *  @returns    Number of TPM instances or 0 if no TPM was found.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInstanceCount();
+
+/**
+ *  @brief      Selects the TPM instance
+ *  @details    All following connects and TPM commands use the selected TPM instance. The instance can only be changed
+ *              while TPM I/O is disconnected.
+ *
+ *  @param      PunInstance                 Zero based index of the TPM instance.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_ALREADY_CONNECTED      If TPM I/O is connected.
+ *  @retval     RC_E_BAD_PARAMETER          There is no TPM instance with the given index.
+ */
+_Check_return_
+unsigned int
+TPMIO_SelectInstance(
+    _In_        unsigned int        PunInstance);
 
 /**
  *  @brief      Read a byte from a specific address (register)
@@ -134,6 +275,41 @@ TPMIO_WriteRegister(
     _In_        unsigned int        PunRegisterAddress,
     _In_        BYTE                PbRegisterValue);
 
+/**
+ *  @brief      Returns the durations of the transport phases of the last TPM command
+ *  @details    This function returns the time needed to send the last command, to wait for its response and to read
+ *              the response.
+ *
+ *  @param      PpsTiming                   Pointer to receive the phase durations.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_INTERNAL               Unsupported device access setting.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetLastPhaseTiming(
+    _Out_       TPM_PHASE_TIMING*   PpsTiming);
+
+/**
+ *  @brief      Returns the identification of the TPM read from its interface registers
+ *  @details    This function reads vendor, device and revision id and the interface type without sending a TPM command.
+ *              The derived TPM family can be used to pick the command sequence for probing the TPM. For device access
+ *              modes without TPM registers (e.g. the replay trace) the family is TPM_INTERFACE_FAMILY_UNKNOWN.
+ *
+ *  @param      PpsInfo                     Pointer to receive the identification.
+ *
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function.
+ *  @retval     RC_E_NOT_CONNECTED          If the TPM I/O is not connected to the TPM.
+ *  @retval     RC_E_INTERNAL               Unsupported device access or locality setting.
+ *  @retval     ...                         Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+TPMIO_GetInterfaceInfo(
+    _Out_       TPM_INTERFACE_INFO* PpsInfo);
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,6 +14,21 @@
 
 #include "Utility.h"
 
+/// Number of milliseconds per day
+#define MILLISECONDS_PER_DAY (24ULL * 60 * 60 * 1000)
+
+/// Hex digits used by the hex dump formatter
+static const wchar_t s_rgwchHexDigits[] = L"0123456789ABCDEF";
+
+/// Date and time read from the real time clock as base for the time-stamps
+static IfxTime s_sTimestampBase;
+
+/// Tick count read together with s_sTimestampBase
+static unsigned long long s_ullTimestampBaseTicks = 0;
+
+/// Flag indicating s_sTimestampBase and s_ullTimestampBaseTicks are valid
+static BOOL s_fTimestampBaseValid = FALSE;
+
 //----------------------------------------------------------------------------------------------
 // String Functions
 //----------------------------------------------------------------------------------------------
@@ -120,7 +135,7 @@ Utility_UInteger2String(
     _Out_z_cap_(*PpunBufferSize)    wchar_t*        PwszBuffer,
     _Inout_                         unsigned int*   PpunBufferSize)
 {
-    return Platform_StringFormat(PwszBuffer, PpunBufferSize, L"%lu", PunValue);
+    return Platform_StringFormat(PwszBuffer, PpunBufferSize, L"%u", PunValue);
 }
 
 /**
@@ -277,24 +292,66 @@ Utility_StringParseUInteger(
 }
 
 /**
- *  @brief      Prints data from a byte array to a string in formatted HEX style
+ *  @brief      Calculates the length of one line of a hex dump
  *  @details
  *
+ *  @param      PunLineOffset               Offset of the first byte of the line in the dumped data.
+ *  @param      PunLineSize                 Count of bytes in the line (1 to LOGGING_HEX_CHARS_PER_LINE).
+ *  @param      PpunAddressDigits           Receives the count of hex digits of the line header.
+ *
+ *  @returns    Count of characters of the line without terminating zero.
+ */
+static
+unsigned int
+Utility_GetHexLineLength(
+    _In_    unsigned int    PunLineOffset,
+    _In_    unsigned int    PunLineSize,
+    _Out_   unsigned int*   PpunAddressDigits)
+{
+    unsigned int unLength = 0;
+
+    // The line header has at least four digits like "%.4X"
+    *PpunAddressDigits = 4;
+    while (*PpunAddressDigits < 8 && 0 != (PunLineOffset >> (*PpunAddressDigits * 4)))
+        (*PpunAddressDigits)++;
+
+    // Line break in front of each line except the first one ("\n" is written as CR LF)
+    if (0 != PunLineOffset)
+        unLength += 2;
+    // Line header "XXXX: "
+    unLength += *PpunAddressDigits + 2;
+    // "XX " per byte
+    unLength += PunLineSize * 3;
+    // Additional space after the 8th byte
+    if (PunLineSize >= LOGGING_HEX_CHARS_PER_LINE / 2)
+        unLength++;
+
+    return unLength;
+}
+
+/**
+ *  @brief      Prints part of a byte array to a string in formatted HEX style
+ *  @details    Writes as many complete lines of the hex dump as fit into the destination buffer, starting at the
+ *              given offset. The outputs for consecutive offsets concatenate to the output of Utility_StringWriteHex,
+ *              so large buffers can be dumped in chunks of a fixed size.
+ *
  *  @param      PrgbHexData                 Pointer to a buffer with the data.
  *  @param      PunSize                     Count of byte in the input buffer in elements.
+ *  @param      PpunOffset                  In:     Offset of the first byte to write (a multiple of LOGGING_HEX_CHARS_PER_LINE)\n
+ *                                          Out:    Offset of the first byte not written yet (PunSize if the dump is complete)
  *  @param      PwszFormattedHexData        Pointer to the buffer containing the formatted hex data.
  *  @param      PpunFormattedHexDataSize    In:     Capacity of the destination buffer\n
- *                                          Out:    Count of written bytes
+ *                                          Out:    Count of written characters without terminating zero
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. It was either NULL or invalid.
- *  @retval     RC_E_FAIL                   An unexpected error occurred.
- *  @retval     ...                         Error codes from Platform_StringFormat.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       Not even one line fits into the destination buffer.
  */
 _Check_return_
 unsigned int
-Utility_StringWriteHex(
+Utility_StringWriteHexPart(
     _In_bytecount_(PunSize)                     const BYTE*     PrgbHexData,
     _In_                                        unsigned int    PunSize,
+    _Inout_                                     unsigned int*   PpunOffset,
     _Out_z_cap_(*PpunFormattedHexDataSize)      wchar_t*        PwszFormattedHexData,
     _Inout_                                     unsigned int*   PpunFormattedHexDataSize)
 {
@@ -302,108 +359,81 @@ Utility_StringWriteHex(
 
     do
     {
-        unsigned int unDestinationSize = 0;
-        unsigned int unIndex = 0;
-        wchar_t wszHelper[HEX_STRING_OUT_LENGTH * 2];
-        unsigned int unHelperSize = RG_LEN(wszHelper);
-        IGNORE_RETURN_VALUE(Platform_StringSetZero(wszHelper, RG_LEN(wszHelper)));
+        unsigned int unCapacity = 0;
+        unsigned int unCursor = 0;
+        unsigned int unOffset = 0;
 
-        if (NULL == PrgbHexData || NULL == PwszFormattedHexData || NULL == PpunFormattedHexDataSize || *PpunFormattedHexDataSize == 0)
+        if (NULL == PrgbHexData || NULL == PpunOffset || NULL == PwszFormattedHexData || NULL == PpunFormattedHexDataSize || *PpunFormattedHexDataSize == 0 ||
+                *PpunOffset > PunSize || 0 != *PpunOffset % LOGGING_HEX_CHARS_PER_LINE)
         {
             unReturnValue = RC_E_BAD_PARAMETER;
             ERROR_STORE(unReturnValue, L"One of the input parameters is invalid.");
             break;
         }
 
-        PwszFormattedHexData[0] = '\0';
+        unCapacity = *PpunFormattedHexDataSize;
+        unOffset = *PpunOffset;
+        PwszFormattedHexData[0] = L'\0';
 
-        // Log buffer content
-        for (unIndex = 0; unIndex < PunSize; unIndex++)
+        while (unOffset < PunSize)
         {
-            // Line header
-            if (unIndex % LOGGING_HEX_CHARS_PER_LINE == 0)
-            {
-                // Add a new line to the beginning of each hex line written except the first one
-                unDestinationSize = *PpunFormattedHexDataSize;
-                if (unIndex != 0)
-                {
-                    unsigned int unLength = 0;
-                    unsigned int unSize = 0;
-                    unReturnValue = Platform_StringGetLength(PwszFormattedHexData, unDestinationSize, &unLength);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        ERROR_STORE(unReturnValue, L"Platform_StringGetLength returned an unexpected value.");
-                        break;
-                    }
-                    unSize = *PpunFormattedHexDataSize - unLength;
-                    unReturnValue = Platform_StringFormat(&PwszFormattedHexData[unLength], &unSize, L"\n");
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
-                        break;
-                    }
-                }
+            unsigned int unLineSize = PunSize - unOffset;
+            unsigned int unAddressDigits = 0;
+            unsigned int unIndex = 0;
+            if (unLineSize > LOGGING_HEX_CHARS_PER_LINE)
+                unLineSize = LOGGING_HEX_CHARS_PER_LINE;
 
-                // Convert current byte to string
-                unHelperSize = HEX_STRING_OUT_LENGTH * 2;
-                unReturnValue = Platform_StringFormat(wszHelper, &unHelperSize, L"%.4X: ", unIndex);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
-                    break;
-                }
+            // Only write complete lines and keep room for the terminating zero
+            if (Utility_GetHexLineLength(unOffset, unLineSize, &unAddressDigits) >= unCapacity - unCursor)
+                break;
 
-                // Add header to output
-                unDestinationSize = *PpunFormattedHexDataSize;
-                unReturnValue = Platform_StringConcatenate(PwszFormattedHexData, &unDestinationSize, wszHelper);
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE(unReturnValue, L"Platform_StringConcatenate returned an unexpected value.");
-                    break;
-                }
+            if (0 != unOffset)
+            {
+                PwszFormattedHexData[unCursor++] = L'\r';
+                PwszFormattedHexData[unCursor++] = L'\n';
             }
 
+            // Line header
+            for (unIndex = unAddressDigits; unIndex > 0; unIndex--)
+                PwszFormattedHexData[unCursor++] = s_rgwchHexDigits[(unOffset >> ((unIndex - 1) * 4)) & 0xF];
+            PwszFormattedHexData[unCursor++] = L':';
+            PwszFormattedHexData[unCursor++] = L' ';
+
             // Hex characters
-            unHelperSize = HEX_STRING_OUT_LENGTH;
-            unReturnValue = Platform_StringFormat(wszHelper, &unHelperSize, L"%.2X ", PrgbHexData[unIndex]);
-            if (RC_SUCCESS != unReturnValue)
+            for (unIndex = 0; unIndex < unLineSize; unIndex++)
             {
-                ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
-                break;
+                BYTE bValue = PrgbHexData[unOffset + unIndex];
+                PwszFormattedHexData[unCursor++] = s_rgwchHexDigits[bValue >> 4];
+                PwszFormattedHexData[unCursor++] = s_rgwchHexDigits[bValue & 0xF];
+                PwszFormattedHexData[unCursor++] = L' ';
+
+                // Additional space after 8th character
+                if (unIndex == LOGGING_HEX_CHARS_PER_LINE / 2 - 1)
+                    PwszFormattedHexData[unCursor++] = L' ';
             }
 
-            // Concatenate string for current byte with string for previous bytes
-            unDestinationSize = *PpunFormattedHexDataSize;
-            unReturnValue = Platform_StringConcatenate(PwszFormattedHexData, &unDestinationSize, wszHelper);
-            if (RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE(unReturnValue, L"Platform_StringConcatenate returned an unexpected value.");
-                break;
-            }
+            unOffset += unLineSize;
+        }
 
-            // Additional space after 8th character
-            if ((int)unIndex % LOGGING_HEX_CHARS_PER_LINE == LOGGING_HEX_CHARS_PER_LINE / 2 - 1)
-            {
-                // Concatenate string for current byte with string for previous bytes
-                unDestinationSize = *PpunFormattedHexDataSize;
-                unReturnValue = Platform_StringConcatenate(PwszFormattedHexData, &unDestinationSize, L" ");
-                if (RC_SUCCESS != unReturnValue)
-                {
-                    ERROR_STORE(unReturnValue, L"Platform_StringConcatenate returned an unexpected value.");
-                    break;
-                }
-            }
+        PwszFormattedHexData[unCursor] = L'\0';
+
+        if (unOffset == *PpunOffset && unOffset < PunSize)
+        {
+            unReturnValue = RC_E_BUFFER_TOO_SMALL;
+            ERROR_STORE(unReturnValue, L"The destination buffer is too small for one line of the hex dump.");
+            break;
         }
 
-        // Update output size
-        unReturnValue = Platform_StringGetLength(PwszFormattedHexData, *PpunFormattedHexDataSize, PpunFormattedHexDataSize);
+        *PpunOffset = unOffset;
+        *PpunFormattedHexDataSize = unCursor;
+        unReturnValue = RC_SUCCESS;
     }
     WHILE_FALSE_END;
 
     if (RC_SUCCESS != unReturnValue)
     {
         // Reset out parameters
-        if (NULL != PwszFormattedHexData)
+        if (NULL != PwszFormattedHexData && NULL != PpunFormattedHexDataSize && 0 != *PpunFormattedHexDataSize)
             PwszFormattedHexData[0] = L'\0';
         if (NULL != PpunFormattedHexDataSize)
             *PpunFormattedHexDataSize = 0;
@@ -412,6 +442,45 @@ Utility_StringWriteHex(
     return unReturnValue;
 }
 
+/**
+ *  @brief      Prints data from a byte array to a string in formatted HEX style
+ *  @details    The whole dump must fit into the destination buffer, use Utility_StringWriteHexPart to write it in chunks.
+ *
+ *  @param      PrgbHexData                 Pointer to a buffer with the data.
+ *  @param      PunSize                     Count of byte in the input buffer in elements.
+ *  @param      PwszFormattedHexData        Pointer to the buffer containing the formatted hex data.
+ *  @param      PpunFormattedHexDataSize    In:     Capacity of the destination buffer\n
+ *                                          Out:    Count of written bytes
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. It was either NULL or invalid.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       The destination buffer is too small for the whole dump.
+ *  @retval     ...                         Error codes from Utility_StringWriteHexPart.
+ */
+_Check_return_
+unsigned int
+Utility_StringWriteHex(
+    _In_bytecount_(PunSize)                     const BYTE*     PrgbHexData,
+    _In_                                        unsigned int    PunSize,
+    _Out_z_cap_(*PpunFormattedHexDataSize)      wchar_t*        PwszFormattedHexData,
+    _Inout_                                     unsigned int*   PpunFormattedHexDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned int unOffset = 0;
+
+    unReturnValue = Utility_StringWriteHexPart(PrgbHexData, PunSize, &unOffset, PwszFormattedHexData, PpunFormattedHexDataSize);
+    if (RC_SUCCESS == unReturnValue && unOffset < PunSize)
+    {
+        unReturnValue = RC_E_BUFFER_TOO_SMALL;
+        ERROR_STORE(unReturnValue, L"The destination buffer is too small for the hex dump.");
+
+        // Reset out parameters
+        PwszFormattedHexData[0] = L'\0';
+        *PpunFormattedHexDataSize = 0;
+    }
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      Formats a time-stamp structure to an output string.
  *  @details    The output string can contain date information or not.
@@ -498,6 +567,8 @@ Utility_Timestamp2String(
 /**
  *  @brief      Gets a time-stamp with or without date as string.
  *  @details    The output string can contain date information or not.
+ *              The real time clock is read only once per day, the time-stamps in between are derived from the monotonic
+ *              tick counter with millisecond resolution. Without a tick counter the real time clock is read on each call.
  *
  *  @param      PfDate                  If '1' the output contains a date, if '0' not.
  *  @param      PwszValue               Pointer to a wide character buffer to fill in the value.
@@ -521,6 +592,9 @@ Utility_GetTimestamp(
     do
     {
         IfxTime sTime;
+        unsigned long long ullTicks = 0;
+        unsigned long long ullMillisecondOfDay = 0;
+        BOOL fTicksAvailable = FALSE;
 
         Platform_MemorySet(&sTime, 0, sizeof(sTime));
 
@@ -532,12 +606,51 @@ Utility_GetTimestamp(
             break;
         }
 
-        // Get current date and time
-        unReturnValue = Platform_GetTime(&sTime);
-        if (RC_SUCCESS != unReturnValue)
+        // Derive the current time from the time-stamp base and the tick counter
+        ullTicks = Platform_GetTicks();
+        fTicksAvailable = (0 != Platform_TicksToMicroseconds(0xFFFFFFFFULL)) ? TRUE : FALSE;
+        if (fTicksAvailable && s_fTimestampBaseValid)
         {
-            ERROR_STORE(unReturnValue, L"Platform_GetTime failed");
-            break;
+            ullMillisecondOfDay = ((s_sTimestampBase.unHour * 60ULL + s_sTimestampBase.unMinute) * 60ULL + s_sTimestampBase.unSecond) * 1000ULL + (unsigned long long)s_sTimestampBase.nMillisecond;
+            ullMillisecondOfDay += Platform_TicksToMicroseconds(ullTicks - s_ullTimestampBaseTicks) / 1000;
+
+            // Read the real time clock again after midnight to get the new date
+            if (ullMillisecondOfDay >= MILLISECONDS_PER_DAY)
+                s_fTimestampBaseValid = FALSE;
+        }
+
+        if (!fTicksAvailable || !s_fTimestampBaseValid)
+        {
+            // Get current date and time
+            unReturnValue = Platform_GetTime(&sTime);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Platform_GetTime failed");
+                break;
+            }
+
+            if (fTicksAvailable)
+            {
+                // Take the time-stamp base, the tick counter provides the milliseconds from now on
+                if (!sTime.fMillisecondAvailable)
+                {
+                    sTime.fMillisecondAvailable = TRUE;
+                    sTime.nMillisecond = 0;
+                }
+                s_sTimestampBase = sTime;
+                s_ullTimestampBaseTicks = ullTicks;
+                s_fTimestampBaseValid = TRUE;
+            }
+        }
+        else
+        {
+            sTime = s_sTimestampBase;
+            sTime.nMillisecond = (int)(ullMillisecondOfDay % 1000);
+            ullMillisecondOfDay /= 1000;
+            sTime.unSecond = (unsigned int)(ullMillisecondOfDay % 60);
+            ullMillisecondOfDay /= 60;
+            sTime.unMinute = (unsigned int)(ullMillisecondOfDay % 60);
+            sTime.unHour = (unsigned int)(ullMillisecondOfDay / 60);
         }
 
         // Convert current time to string
@@ -126,9 +126,35 @@ Utility_StringParseUInteger(
     _In_                                unsigned int    PunMaximumCapacity,
     _Out_                               unsigned int*   PpunNumber);
 
+/**
+ *  @brief      Prints part of a byte array to a string in formatted HEX style
+ *  @details    Writes as many complete lines of the hex dump as fit into the destination buffer, starting at the
+ *              given offset. The outputs for consecutive offsets concatenate to the output of Utility_StringWriteHex,
+ *              so large buffers can be dumped in chunks of a fixed size.
+ *
+ *  @param      PrgbHexData                 Pointer to a buffer with the data.
+ *  @param      PunSize                     Count of byte in the input buffer in elements.
+ *  @param      PpunOffset                  In:     Offset of the first byte to write (a multiple of LOGGING_HEX_CHARS_PER_LINE)\n
+ *                                          Out:    Offset of the first byte not written yet (PunSize if the dump is complete)
+ *  @param      PwszFormattedHexData        Pointer to the buffer containing the formatted hex data.
+ *  @param      PpunFormattedHexDataSize    In:     Capacity of the destination buffer\n
+ *                                          Out:    Count of written characters without terminating zero
+ *  @retval     RC_SUCCESS                  The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. It was either NULL or invalid.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       Not even one line fits into the destination buffer.
+ */
+_Check_return_
+unsigned int
+Utility_StringWriteHexPart(
+    _In_bytecount_(PunSize)                     const BYTE*     PrgbHexData,
+    _In_                                        unsigned int    PunSize,
+    _Inout_                                     unsigned int*   PpunOffset,
+    _Out_z_cap_(*PpunFormattedHexDataSize)      wchar_t*        PwszFormattedHexData,
+    _Inout_                                     unsigned int*   PpunFormattedHexDataSize);
+
 /**
  *  @brief      Prints data from a byte array to a string in formatted HEX style
- *  @details
+ *  @details    The whole dump must fit into the destination buffer, use Utility_StringWriteHexPart to write it in chunks.
  *
  *  @param      PrgbHexData                 Pointer to a buffer with the data.
  *  @param      PunSize                     Count of byte in the input buffer in elements.
@@ -137,8 +163,8 @@ Utility_StringParseUInteger(
  *                                          Out:    Count of written bytes
  *  @retval     RC_SUCCESS                  The operation completed successfully.
  *  @retval     RC_E_BAD_PARAMETER          An invalid parameter was passed to the function. It was either NULL or invalid.
- *  @retval     RC_E_FAIL                   An unexpected error occurred.
- *  @retval     ...                         Error codes from Platform_StringFormat.
+ *  @retval     RC_E_BUFFER_TOO_SMALL       The destination buffer is too small for the whole dump.
+ *  @retval     ...                         Error codes from Utility_StringWriteHexPart.
  */
 _Check_return_
 unsigned int
@@ -0,0 +1,480 @@
+/**
+ *  @brief      Implements the host benchmark HostBench
+ *  @details    Measures the host-only code paths of the Infineon TPM Firmware Update Driver (TSS marshaling, firmware image
+ *              parsing and verification, hex dumps and PropertyStorage lookups) on the build machine. The common code is
+ *              built against the Linux platform layer, the TPM is never accessed. The results are printed as CSV, so
+ *              performance work on these paths can be measured and compared between builds.
+ *  @file       HostBench/HostBench.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "StdInclude.h"
+#include "Crypt.h"
+#include "FirmwareImage.h"
+#include "FirmwareUpdate.h"
+#include "Utility.h"
+#include "TPM2_Marshal.h"
+#include "TPM2_FieldUpgradeMarshal.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/// Default number of iterations of each benchmark
+#define BENCH_DEFAULT_ITERATIONS        10000
+
+/// Divisor applied to the number of iterations of the benchmarks processing a complete firmware image
+#define BENCH_IMAGE_DIVISOR             100
+
+/// Size of the memory arena in bytes (used by PropertyStorage)
+#define BENCH_ARENA_SIZE                (32 * 1024)
+
+/// Number of tagged properties in the capability data of the unmarshal benchmark
+#define BENCH_CAPABILITY_PROPERTIES     16
+
+/// Size of the data dumped by the hex dump benchmark in bytes
+#define BENCH_HEX_DATA_SIZE             256
+
+/// Maximum size of a firmware image in bytes
+#define BENCH_MAX_IMAGE_SIZE            (16 * 1024 * 1024)
+
+/**
+ *  @brief      Measurement of one benchmark
+ */
+typedef struct tdBENCH_RESULT
+{
+    /// Number of measured iterations
+    unsigned int        unIterations;
+    /// Duration of all iterations in microseconds
+    unsigned long long  ullTotalUs;
+    /// Number of bytes processed by all iterations
+    unsigned long long  ullBytes;
+} BENCH_RESULT;
+
+/// Start of the current measurement in ticks
+static unsigned long long s_ullStartTicks = 0;
+
+/**
+ *  @brief      Shows the usage of the program
+ *  @details
+ */
+static
+void
+Bench_ShowUsage()
+{
+    printf("Usage: HostBench [iterations] [image ...]\n"
+           "\n"
+           "Measures the host-only code paths of IFXTPMUpdate and prints the results as CSV (default iterations: %d).\n"
+           "Firmware images given on the command line are parsed and verified with iterations / %d repetitions.\n"
+           "Columns: benchmark,iterations,total_us,ns_per_op,bytes,mb_per_s\n"
+           "Error messages are printed as lines starting with '#'.\n",
+           BENCH_DEFAULT_ITERATIONS, BENCH_IMAGE_DIVISOR);
+}
+
+/**
+ *  @brief      Starts a measurement
+ *  @details
+ */
+static
+void
+Bench_Start()
+{
+    s_ullStartTicks = Platform_GetTicks();
+}
+
+/**
+ *  @brief      Stops a measurement and prints its result as CSV row
+ *  @details    The operations are timed as a whole, single operations are shorter than the resolution of the timer.
+ *
+ *  @param      PszName             Name of the benchmark.
+ *  @param      PunIterations       Number of measured iterations.
+ *  @param      PullBytes           Number of bytes processed by all iterations.
+ */
+static
+void
+Bench_Stop(
+    _In_z_  const char*         PszName,
+    _In_    unsigned int        PunIterations,
+    _In_    unsigned long long  PullBytes)
+{
+    BENCH_RESULT sResult;
+    unsigned long long ullNsPerOp = 0;
+    unsigned long long ullMBPerSecond = 0;
+
+    sResult.ullTotalUs = Platform_TicksToMicroseconds(Platform_GetTicks() - s_ullStartTicks);
+    sResult.unIterations = PunIterations;
+    sResult.ullBytes = PullBytes;
+
+    if (0 != sResult.unIterations)
+        ullNsPerOp = sResult.ullTotalUs * 1000 / sResult.unIterations;
+    // Bytes per microsecond equal (decimal) megabytes per second
+    if (0 != sResult.ullTotalUs)
+        ullMBPerSecond = sResult.ullBytes / sResult.ullTotalUs;
+
+    printf("%s,%u,%llu,%llu,%llu,%llu\n", PszName, sResult.unIterations, sResult.ullTotalUs, ullNsPerOp, sResult.ullBytes, ullMBPerSecond);
+}
+
+/**
+ *  @brief      Measures the TSS marshaling
+ *  @details    Marshals a TPMT_HA with a SHA-256 digest (as used in policy commands) and unmarshals a TPMS_CAPABILITY_DATA with
+ *              BENCH_CAPABILITY_PROPERTIES tagged properties (as returned by TPM2_GetCapability(TPM_CAP_TPM_PROPERTIES)).
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     RC_SUCCESS          The benchmark completed.
+ *  @retval     ...                 Error codes from the marshaling functions.
+ */
+static
+unsigned int
+Bench_Marshal(
+    _In_    unsigned int    PunIterations)
+{
+    static TSS_TPMS_CAPABILITY_DATA sCapabilityData;
+    unsigned int unReturnValue = RC_SUCCESS;
+    unsigned int unIndex = 0;
+    TSS_BYTE rgbBuffer[sizeof(TSS_UINT32) * (2 + 2 * BENCH_CAPABILITY_PROPERTIES)];
+    TSS_TPMT_HA sHash;
+
+    do
+    {
+        TSS_INT32 nCapabilitySize = sizeof(rgbBuffer);
+        TSS_BYTE* pbBuffer = rgbBuffer;
+
+        Platform_MemorySet(&sHash, 0xA5, sizeof(sHash));
+        sHash.hashAlg = TSS_TPM_ALG_SHA256;
+
+        Bench_Start();
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            TSS_INT32 nSize = sizeof(rgbBuffer);
+            pbBuffer = rgbBuffer;
+            unReturnValue = TSS_TPMT_HA_Marshal(&sHash, &pbBuffer, &nSize);
+        }
+        Bench_Stop("tss_marshal_tpmt_ha", unIndex, (unsigned long long)unIndex * (unsigned long long)(pbBuffer - rgbBuffer));
+        if (RC_SUCCESS != unReturnValue)
+        {
+            printf("# Error: Marshaling TPMT_HA failed (0x%.8X)\n", unReturnValue);
+            break;
+        }
+
+        // TPM_CAP_TPM_PROPERTIES, count, followed by (property, value) pairs
+        pbBuffer = rgbBuffer;
+        Platform_MemorySet(rgbBuffer, 0, sizeof(rgbBuffer));
+        rgbBuffer[3] = (TSS_BYTE)TSS_TPM_CAP_TPM_PROPERTIES;
+        rgbBuffer[7] = BENCH_CAPABILITY_PROPERTIES;
+        for (unIndex = 0; unIndex < BENCH_CAPABILITY_PROPERTIES; unIndex++)
+        {
+            rgbBuffer[8 + unIndex * 8 + 2] = 0x01;
+            rgbBuffer[8 + unIndex * 8 + 3] = (TSS_BYTE)unIndex;
+            rgbBuffer[8 + unIndex * 8 + 7] = (TSS_BYTE)unIndex;
+        }
+
+        Bench_Start();
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            TSS_INT32 nSize = nCapabilitySize;
+            pbBuffer = rgbBuffer;
+            unReturnValue = TSS_TPMS_CAPABILITY_DATA_Unmarshal(&sCapabilityData, &pbBuffer, &nSize);
+        }
+        Bench_Stop("tss_unmarshal_capability", unIndex, (unsigned long long)unIndex * (unsigned long long)nCapabilitySize);
+        if (RC_SUCCESS != unReturnValue)
+            printf("# Error: Unmarshaling TPMS_CAPABILITY_DATA failed (0x%.8X)\n", unReturnValue);
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Measures the hex dump used by the logging
+ *  @details    Formats BENCH_HEX_DATA_SIZE bytes with Utility_StringWriteHex.
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     RC_SUCCESS          The benchmark completed.
+ *  @retval     ...                 Error codes from Utility_StringWriteHex.
+ */
+static
+unsigned int
+Bench_HexDump(
+    _In_    unsigned int    PunIterations)
+{
+    static wchar_t wszHexDump[LOGGING_HEX_CHUNK_SIZE * 4];
+    unsigned int unReturnValue = RC_SUCCESS;
+    unsigned int unIndex = 0;
+    BYTE rgbData[BENCH_HEX_DATA_SIZE];
+
+    for (unIndex = 0; unIndex < sizeof(rgbData); unIndex++)
+        rgbData[unIndex] = (BYTE)unIndex;
+
+    Bench_Start();
+    for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+    {
+        unsigned int unSize = RG_LEN(wszHexDump);
+        unReturnValue = Utility_StringWriteHex(rgbData, sizeof(rgbData), wszHexDump, &unSize);
+    }
+    Bench_Stop("utility_write_hex", unIndex, (unsigned long long)unIndex * sizeof(rgbData));
+    if (RC_SUCCESS != unReturnValue)
+        printf("# Error: Utility_StringWriteHex failed (0x%.8X)\n", unReturnValue);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Measures the PropertyStorage lookups
+ *  @details    Sets the properties the driver sets at initialization and looks them up like the update code does.
+ *
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     RC_SUCCESS          The benchmark completed.
+ *  @retval     RC_E_FAIL           A property could not be set or found.
+ */
+static
+unsigned int
+Bench_PropertyStorage(
+    _In_    unsigned int    PunIterations)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    unsigned int unIndex = 0;
+    BOOL fFound = TRUE;
+
+    do
+    {
+        if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL) ||
+                !PropertyStorage_SetBooleanValueByKey(PROPERTY_STREAMING_UPDATE, TRUE) ||
+                !PropertyStorage_SetBooleanValueByKey(PROPERTY_CALIBRATE_COMMAND_DURATIONS, FALSE) ||
+                !PropertyStorage_SetUIntegerValueByKey(PROPERTY_LOCALITY, 0) ||
+                !PropertyStorage_SetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, TRUE) ||
+                !PropertyStorage_SetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, TPM_DEVICE_ACCESS_DRIVER))
+        {
+            unReturnValue = RC_E_FAIL;
+            printf("# Error: Setting the properties failed\n");
+            break;
+        }
+
+        Bench_Start();
+        for (unIndex = 0; unIndex < PunIterations && fFound; unIndex++)
+        {
+            unsigned int unValue = 0;
+            BOOL fValue = FALSE;
+            // First and last property set above
+            fFound = PropertyStorage_GetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, &unValue) &&
+                     PropertyStorage_GetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, &unValue) &&
+                     PropertyStorage_GetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, &fValue);
+        }
+        // Three lookups per iteration
+        Bench_Stop("property_lookup", unIndex * 3, 0);
+        if (!fFound)
+        {
+            unReturnValue = RC_E_FAIL;
+            printf("# Error: PropertyStorage lookup failed\n");
+        }
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Measures the parsing and verification of a firmware image
+ *  @details    Runs FirmwareImage_Unmarshal, TSS_sSignedData_d_Unmarshal and TSS_sSignedData_d_UnmarshalView on the policy
+ *              parameter block (images without manifest) and FirmwareUpdate_VerifyImageIntegrity (CRC and signature). The driver keeps the outcome of the last
+ *              integrity check, so the verification alternates between two copies of the image to measure the full check in
+ *              every iteration.
+ *
+ *  @param      PszImagePath        Path of the firmware image.
+ *  @param      PunIterations       Number of iterations.
+ *
+ *  @retval     RC_SUCCESS          The benchmark completed.
+ *  @retval     RC_E_FAIL           The image could not be read.
+ *  @retval     RC_E_CORRUPT_FW_IMAGE   The image could not be parsed or is not intact.
+ *  @retval     ...                 Error codes from called functions.
+ */
+static
+unsigned int
+Bench_Image(
+    _In_z_  const char*     PszImagePath,
+    _In_    unsigned int    PunIterations)
+{
+    static IfxFirmwareImage sFirmwareImage;
+    static sSignedData_d sSignedData;
+    sSignedDataView_d sSignedDataView;
+    unsigned int unReturnValue = RC_E_FAIL;
+    BYTE* rgpbImage[2] = { NULL, NULL };
+    FILE* pFile = NULL;
+
+    do
+    {
+        unsigned int unIndex = 0;
+        unsigned int unImageSize = 0;
+        long lSize = 0;
+        BYTE* pbBuffer = NULL;
+        int nBufferSize = 0;
+
+        printf("# Image: %s\n", PszImagePath);
+
+        pFile = fopen(PszImagePath, "rb");
+        if (NULL == pFile || 0 != fseek(pFile, 0, SEEK_END) || (lSize = ftell(pFile)) <= 0 || lSize > BENCH_MAX_IMAGE_SIZE || 0 != fseek(pFile, 0, SEEK_SET))
+        {
+            printf("# Error: Cannot read %s\n", PszImagePath);
+            break;
+        }
+        unImageSize = (unsigned int)lSize;
+        rgpbImage[0] = (BYTE*)Platform_MemoryAllocateZero(unImageSize);
+        rgpbImage[1] = (BYTE*)Platform_MemoryAllocateZero(unImageSize);
+        if (NULL == rgpbImage[0] || NULL == rgpbImage[1] || unImageSize != fread(rgpbImage[0], 1, unImageSize, pFile))
+        {
+            printf("# Error: Cannot read %s\n", PszImagePath);
+            break;
+        }
+        unReturnValue = Platform_MemoryCopy(rgpbImage[1], unImageSize, rgpbImage[0], unImageSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        Bench_Start();
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            pbBuffer = rgpbImage[0];
+            nBufferSize = (int)unImageSize;
+            unReturnValue = FirmwareImage_Unmarshal(&sFirmwareImage, &pbBuffer, &nBufferSize);
+        }
+        // The firmware block is referenced, not copied; count the parsed header bytes only
+        Bench_Stop("image_unmarshal", unIndex, RC_SUCCESS != unReturnValue ? 0 : (unsigned long long)unIndex * (unsigned long long)(unImageSize - (unsigned int)nBufferSize - sFirmwareImage.unFirmwareSize));
+        if (RC_SUCCESS != unReturnValue)
+        {
+            printf("# Error: FirmwareImage_Unmarshal failed (0x%.8X)\n", unReturnValue);
+            unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            break;
+        }
+
+        if (NULL == sFirmwareImage.rgbManifestData)
+        {
+            Bench_Start();
+            for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+            {
+                TSS_BYTE* pbPolicyParameterBlock = sFirmwareImage.rgbPolicyParameterBlock;
+                TSS_INT32 nPolicyParameterBlockSize = sFirmwareImage.usPolicyParameterBlockSize;
+                unReturnValue = TSS_sSignedData_d_Unmarshal(&sSignedData, &pbPolicyParameterBlock, &nPolicyParameterBlockSize);
+            }
+            Bench_Stop("image_unmarshal_signed_data", unIndex, (unsigned long long)unIndex * sFirmwareImage.usPolicyParameterBlockSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                printf("# Error: TSS_sSignedData_d_Unmarshal failed (0x%.8X)\n", unReturnValue);
+                unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+                break;
+            }
+
+            Bench_Start();
+            for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+            {
+                unReturnValue = TSS_sSignedData_d_UnmarshalView(&sSignedDataView, sFirmwareImage.rgbPolicyParameterBlock, sFirmwareImage.usPolicyParameterBlockSize);
+            }
+            Bench_Stop("image_unmarshal_signed_data_view", unIndex, (unsigned long long)unIndex * sFirmwareImage.usPolicyParameterBlockSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                printf("# Error: TSS_sSignedData_d_UnmarshalView failed (0x%.8X)\n", unReturnValue);
+                unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+                break;
+            }
+        }
+
+        PunIterations = PunIterations / BENCH_IMAGE_DIVISOR + 1;
+        Bench_Start();
+        for (unIndex = 0; unIndex < PunIterations && RC_SUCCESS == unReturnValue; unIndex++)
+        {
+            BOOL fIntact = FALSE;
+            unsigned int unErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+            unReturnValue = FirmwareUpdate_VerifyImageIntegrity(rgpbImage[unIndex & 1], unImageSize, &fIntact, &unErrorDetails);
+            if (RC_SUCCESS == unReturnValue && !fIntact)
+            {
+                printf("# Error: The firmware image is not intact (0x%.8X)\n", unErrorDetails);
+                unReturnValue = RC_E_CORRUPT_FW_IMAGE;
+            }
+        }
+        Bench_Stop("image_verify_integrity", unIndex, (unsigned long long)unIndex * unImageSize);
+        if (RC_SUCCESS != unReturnValue)
+            printf("# Error: FirmwareUpdate_VerifyImageIntegrity failed (0x%.8X)\n", unReturnValue);
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != pFile)
+        fclose(pFile);
+    Platform_MemoryFree((void**)&rgpbImage[0]);
+    Platform_MemoryFree((void**)&rgpbImage[1]);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Entry point of HostBench
+ *  @details    Runs the benchmarks which do not need an image, then the image benchmarks for each given image.
+ *
+ *  @param      argc                Number of arguments.
+ *  @param      argv                Arguments.
+ *
+ *  @returns    0 if all benchmarks completed, 1 if a benchmark failed and 2 for an invalid command line.
+ */
+int
+main(
+    _In_                int     argc,
+    _In_count_(argc)    char**  argv)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned int unIterations = BENCH_DEFAULT_ITERATIONS;
+    int nImageIndex = 1;
+
+    if (argc > 1 && '0' <= argv[1][0] && '9' >= argv[1][0])
+    {
+        char* szEnd = NULL;
+        unsigned long ulIterations = strtoul(argv[1], &szEnd, 10);
+        if ('\0' != *szEnd || 0 == ulIterations || ulIterations > UINT_MAX)
+        {
+            Bench_ShowUsage();
+            return 2;
+        }
+        unIterations = (unsigned int)ulIterations;
+        nImageIndex = 2;
+    }
+    else if (argc > 1 && '-' == argv[1][0])
+    {
+        Bench_ShowUsage();
+        return 2;
+    }
+
+    do
+    {
+        if (RC_SUCCESS != Platform_ArenaInitialize(BENCH_ARENA_SIZE))
+            break;
+        Crypt_Initialize();
+
+        printf("benchmark,iterations,total_us,ns_per_op,bytes,mb_per_s\n");
+
+        unReturnValue = Bench_Marshal(unIterations);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = Bench_HexDump(unIterations);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = Bench_PropertyStorage(unIterations);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        for (; nImageIndex < argc && RC_SUCCESS == unReturnValue; nImageIndex++)
+            unReturnValue = Bench_Image(argv[nImageIndex], unIterations);
+    }
+    WHILE_FALSE_END;
+
+    PropertyStorage_ClearElements();
+    Crypt_Uninitialize();
+    Platform_ArenaUninitialize();
+
+    return RC_SUCCESS == unReturnValue ? 0 : 1;
+}
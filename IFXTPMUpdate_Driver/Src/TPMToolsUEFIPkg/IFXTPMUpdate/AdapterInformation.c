@@ -16,12 +16,17 @@
  */
 
 #include "AdapterInformation.h"
+#include "DeviceAccess.h"
+#include "DeviceManagement.h"
 #include "TPM2_GetCapability.h"
 #include "TPM2_HierarchyChangeAuth.h"
+#ifndef IFXTPMUPDATE_TPM20_ONLY
 #include "TPM_GetCapability.h"
+#endif
 #include "TPM_Types.h"
 #include "FirmwareManagement.h"
 #include "FirmwareUpdate.h"
+#include "TpmReplay.h"
 #include "IFXTPMUpdate.h"
 #include "IFXTPMUpdateApp.h"
 #include <Library/BaseMemoryLib.h>
@@ -56,7 +61,7 @@ IFXTPMUpdate_AdapterInformation_GetInformationCounters(
         }
 
         // Try to initialize TPM access
-        efiStatus = InitializeTpmAccess();
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
         if (EFI_ERROR(efiStatus))
             break;
 
@@ -73,7 +78,7 @@ IFXTPMUpdate_AdapterInformation_GetInformationCounters(
 
         // Get number of remaining firmware updates
         unsigned int unFieldUpgradeCounter = 0;
-        unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(sTpmState.attribs, &unFieldUpgradeCounter);
+        unReturnValue = FirmwareUpdate_GetTpmFieldUpgradeCounter(sTpmState.attribs, NULL, &unFieldUpgradeCounter);
         if (RC_SUCCESS != unReturnValue)
         {
             efiStatus = EFI_DEVICE_ERROR;
@@ -111,6 +116,7 @@ IFXTPMUpdate_AdapterInformation_GetInformationCounters(
     }
     WHILE_FALSE_END;
 
+    efiStatus = MapQueryDeadlineStatus(efiStatus);
     UninitializeTpmAccess();
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationCounters(): (0x%.16lX)", efiStatus);
@@ -118,6 +124,124 @@ IFXTPMUpdate_AdapterInformation_GetInformationCounters(
     return efiStatus;
 }
 
+/**
+ *  @brief      Reads the TPM firmware update details.
+ *  @details    This function reads the firmware update details from the TPM into the given structure. The TPM must have a TPM2.0 FU loader.
+ *
+ *  @param      PpsTpmState                 Pointer to the TPM state.
+ *  @param      PpFuDetails                 Pointer to the structure to fill. All bytes must be set to zero.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ */
+static
+EFI_STATUS
+IFXTPMUpdate_AdapterInformation_ReadFuDetails(
+    IN  const TPM_STATE*                                    PpsTpmState,
+    OUT EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1*    PpFuDetails)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+
+    do {
+        unsigned int unReturnValue = RC_E_FAIL;
+
+        // Get current firmware version
+        TPM_FIRMWARE_VERSION sFirmwareVersion;
+        Platform_MemorySet(&sFirmwareVersion, 0, sizeof(sFirmwareVersion));
+
+        unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(TPM_PT_VENDOR_FIX_FU_CURRENT_TPM_FW_VERSION, &sFirmwareVersion);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmFirmwareVersionByVendorCap returned an unexpected value for current firmware version.");
+            break;
+        }
+
+        // Get current firmware version
+        TPM_FIRMWARE_VERSION sNewFirmwareVersion;
+        Platform_MemorySet(&sNewFirmwareVersion, 0, sizeof(sNewFirmwareVersion));
+
+        if (!PpsTpmState->attribs.tpmFirmwareIsValid)
+        {
+            unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(TPM_PT_VENDOR_FIX_FU_NEW_TPM_FW_VERSION, &sNewFirmwareVersion);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmFirmwareVersionByVendorCap returned an unexpected value for new firmware version.");
+                break;
+            }
+        }
+
+        // Get key group ID (internal1)
+        UINT32 unKeyGroupId = 0;
+        unReturnValue = FirmwareUpdate_GetTpmKeyGroupId(&unKeyGroupId);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmKeyGroupId returned an unexpected value.");
+            break;
+        }
+
+        // Get FU_START_HASH (internal2)
+        // The property is read directly into Internal2. A property too large for Internal2 is reported with its size only.
+        TSS_UINT32 unInternal2Size = sizeof(PpFuDetails->Internal2);
+        unReturnValue = TSS_TPM2_GetVendorProperty(TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST, &PpFuDetails->Internal2[0], &unInternal2Size);
+        if (RC_SUCCESS != unReturnValue && RC_E_BUFFER_TOO_SMALL != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"TSS_TPM2_GetVendorProperty returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        UINT32 unMaxFirmwareSize = sizeof(PpFuDetails->FirmwareVersion) / sizeof(CHAR16);
+        unReturnValue = Platform_StringFormat(&PpFuDetails->FirmwareVersion[0], &unMaxFirmwareSize, L"%d.%d.%d.%d", sFirmwareVersion.usMajor, sFirmwareVersion.usMinor, sFirmwareVersion.usBuild, sFirmwareVersion.usRevision);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
+            break;
+        }
+
+        if (!PpsTpmState->attribs.tpmFirmwareIsValid)
+        {
+            unMaxFirmwareSize = sizeof(PpFuDetails->NewFirmwareVersion) / sizeof(CHAR16);
+            unReturnValue = Platform_StringFormat(&PpFuDetails->NewFirmwareVersion[0], &unMaxFirmwareSize, L"%d.%d.%d.%d", sNewFirmwareVersion.usMajor, sNewFirmwareVersion.usMinor, sNewFirmwareVersion.usBuild, sNewFirmwareVersion.usRevision);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
+                break;
+            }
+        }
+
+        PpFuDetails->Internal1 = unKeyGroupId;
+        PpFuDetails->Internal2Size = unInternal2Size;
+
+        if (PpFuDetails->Internal2Size > sizeof(PpFuDetails->Internal2))
+            LOGGING_WRITE_LEVEL1_FMT(L"Capability returned an unsupported value TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST (0x%.8lX)", RC_E_BUFFER_TOO_SMALL);
+
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Sets the TPM operation mode information.
+ *  @details    This function sets the operation mode value and its boolean representations from the TPM state.
+ *
+ *  @param      PpsTpmState                 Pointer to the TPM state.
+ *  @param      PpInfoOperationMode         Pointer to the structure to fill.
+ */
+static
+VOID
+IFXTPMUpdate_AdapterInformation_SetOperationMode(
+    IN  const TPM_STATE*                                        PpsTpmState,
+    OUT EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1* PpInfoOperationMode)
+{
+    PpInfoOperationMode->TpmOperationMode = (UINT8)PpsTpmState->attribs.tpm20OperationMode;
+    PpInfoOperationMode->TpmInOperationalMode = PpsTpmState->attribs.tpmInOperationalMode ? TRUE : FALSE;
+    PpInfoOperationMode->TpmInFirmwareUpdateMode = PpsTpmState->attribs.tpmInFwUpdateMode ? TRUE : FALSE;
+    PpInfoOperationMode->TpmInFirmwareRecoveryMode = PpsTpmState->attribs.tpmInFwRecoveryMode ? TRUE : FALSE;
+    PpInfoOperationMode->TpmFirmwareIsValid = PpsTpmState->attribs.tpmFirmwareIsValid ? TRUE : FALSE;
+    PpInfoOperationMode->TpmRestartRequired = PpsTpmState->attribs.tpm20restartRequired ? TRUE : FALSE;
+}
+
 /**
  *  @brief      Returns TPM firmware update details.
  *  @details    This function returns details about the firmware update state.
@@ -148,7 +272,7 @@ IFXTPMUpdate_AdapterInformation_GetInformationFuDetails(
         }
 
         // Try to initialize TPM access
-        efiStatus = InitializeTpmAccess();
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
         if (EFI_ERROR(efiStatus))
             break;
 
@@ -170,132 +294,809 @@ IFXTPMUpdate_AdapterInformation_GetInformationFuDetails(
             break;
         }
 
-        // Get current firmware version
-        TPM_FIRMWARE_VERSION sFirmwareVersion;
-        Platform_MemorySet(&sFirmwareVersion, 0, sizeof(sFirmwareVersion));
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationFuDetails(). (0x%.16lX)", efiStatus);
+            break;
+        }
 
-        unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(TPM_PT_VENDOR_FIX_FU_CURRENT_TPM_FW_VERSION, &sFirmwareVersion);
+        efiStatus = IFXTPMUpdate_AdapterInformation_ReadFuDetails(&sTpmState, (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1*)*PppInformationBlock);
+        if (EFI_ERROR(efiStatus))
+        {
+            FreePool(*PppInformationBlock);
+            *PppInformationBlock = NULL;
+            break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    efiStatus = MapQueryDeadlineStatus(efiStatus);
+    UninitializeTpmAccess();
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationFuDetails(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns TPM operation mode information.
+ *  @details    This function returns TPM operation mode information.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_UNSUPPORTED             The information is not available at the used TPM model.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationOperationMode(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Try to initialize TPM access
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        // Get the operation mode, determine the full TPM state only if it cannot be read directly
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+        unsigned int unReturnValue = FirmwareUpdate_GetOperationMode(&sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            unReturnValue = FirmwareUpdate_CalculateState(FALSE, &sTpmState);
         if (RC_SUCCESS != unReturnValue)
         {
             efiStatus = EFI_DEVICE_ERROR;
-            LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmFirmwareVersionByVendorCap returned an unexpected value for current firmware version.");
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during determination of TPM state in GetInformationOperationMode(). (0x%.16lX)", efiStatus);
             break;
         }
 
-        // Get current firmware version
-        TPM_FIRMWARE_VERSION sNewFirmwareVersion;
-        Platform_MemorySet(&sNewFirmwareVersion, 0, sizeof(sNewFirmwareVersion));
+        // Operation mode is only available on SLB 9672
+        if (FALSE == sTpmState.attribs.tpmHasFULoader20)
+        {
+            efiStatus = EFI_UNSUPPORTED;
+            break;
+        }
 
-        if (!sTpmState.attribs.tpmFirmwareIsValid)
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
         {
-            unReturnValue = FirmwareUpdate_GetTpmFirmwareVersionByVendorCap(TPM_PT_VENDOR_FIX_FU_NEW_TPM_FW_VERSION, &sNewFirmwareVersion);
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationOperationMode(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        // Set operation mode value and its boolean representations
+        IFXTPMUpdate_AdapterInformation_SetOperationMode(&sTpmState, (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1*)*PppInformationBlock);
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    efiStatus = MapQueryDeadlineStatus(efiStatus);
+    UninitializeTpmAccess();
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationOperationMode(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the complete TPM firmware update status.
+ *  @details    This function returns the version name, the firmware update counters, the operation mode and the firmware update details
+ *              of the TPM. The TPM state is determined only once and shared by all parts, so the function sends considerably fewer TPM commands
+ *              than querying the parts separately. The operation mode and the firmware update details are only filled on SLB 9672.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                     The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER           In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR                An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES            In case memory allocation failed.
+ *  @retval     EFI_TIMEOUT                     The query deadline elapsed. The parts read before are returned, the others are
+ *                                              marked as unavailable (empty VersionName, counters 0xFFFFFFFF, flags FALSE).
+ *  @retval     EFI_IFXTPM_UNSUPPORTED_VENDOR   The TPM is not manufactured by Infineon.
+ *  @retval     EFI_IFXTPM_UNSUPPORTED_CHIP     The Infineon TPM chip detected is not supported by the driver.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationStatus(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1* pInfoStatus = NULL;
+        unsigned int unCapacity = 0;
+        unsigned int unRemainingUpdates = REMAINING_UPDATES_UNAVAILABLE;
+        unsigned int unReturnValue = RC_E_FAIL;
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+        *PppInformationBlock = NULL;
+
+        // Try to initialize TPM access
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationStatus(). (0x%.16lX)", efiStatus);
+            break;
+        }
+        pInfoStatus = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1*)*PppInformationBlock;
+        // Counters which are not read before the query deadline are reported as unavailable
+        pInfoStatus->Counters.UpdateCounter = REMAINING_UPDATES_UNAVAILABLE;
+        pInfoStatus->Counters.UpdateCounterSelf = 0xFFFFFFFF;
+
+        // Get TPM state, version name and number of remaining firmware updates with one state calculation.
+        // The following requests are served from the TPM state snapshot of FirmwareUpdate_CalculateState.
+        unCapacity = RG_LEN(pInfoStatus->VersionName);
+        unReturnValue = FirmwareUpdate_GetImageInfo(pInfoStatus->VersionName, &unCapacity, &sTpmState, &unRemainingUpdates);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            switch (unReturnValue)
+            {
+                case RC_E_NO_IFX_TPM:
+                    efiStatus = EFI_IFXTPM_UNSUPPORTED_VENDOR;
+                    break;
+                case RC_E_UNSUPPORTED_CHIP:
+                    efiStatus = EFI_IFXTPM_UNSUPPORTED_CHIP;
+                    break;
+                default:
+                    efiStatus = EFI_DEVICE_ERROR;
+                    break;
+            }
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during determination of TPM state in GetInformationStatus(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        pInfoStatus->Counters.UpdateCounter = unRemainingUpdates;
+
+        // Get number of remaining firmware updates onto the same firmware version (only TPM2.0 FU loader).
+        // If counter is not supported value will be set to 0xFFFFFFFF.
+        pInfoStatus->Counters.UpdateCounterSelf = 0xFFFFFFFF;
+        if (sTpmState.attribs.tpmHasFULoader20)
+        {
+            unsigned int unFieldUpgradeCounterSelf = 0xFFFFFFFF;
+            unReturnValue = FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf(&unFieldUpgradeCounterSelf);
             if (RC_SUCCESS != unReturnValue)
             {
                 efiStatus = EFI_DEVICE_ERROR;
-                LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmFirmwareVersionByVendorCap returned an unexpected value for new firmware version.");
                 break;
             }
-        }
+            pInfoStatus->Counters.UpdateCounterSelf = unFieldUpgradeCounterSelf;
 
-        // Get key group ID (internal1)
-        UINT32 unKeyGroupId = 0;
-        unReturnValue = FirmwareUpdate_GetTpmKeyGroupId(&unKeyGroupId);
-        if (RC_SUCCESS != unReturnValue)
-        {
-            efiStatus = EFI_DEVICE_ERROR;
-            LOGGING_WRITE_LEVEL1(L"FirmwareUpdate_GetTpmKeyGroupId returned an unexpected value.");
-            break;
+            // Operation mode and firmware update details are only available with TPM2.0 FU loader
+            IFXTPMUpdate_AdapterInformation_SetOperationMode(&sTpmState, &pInfoStatus->OperationMode);
+            pInfoStatus->OperationModeValid = TRUE;
+
+            efiStatus = IFXTPMUpdate_AdapterInformation_ReadFuDetails(&sTpmState, &pInfoStatus->Details);
+            if (EFI_ERROR(efiStatus))
+                break;
+            pInfoStatus->DetailsValid = TRUE;
         }
 
-        // Get FU_START_HASH (internal2)
-        TSS_TPMS_VENDOR_CAPABILITY_DATA vendorCapabilityData;
-        TSS_TPMI_YES_NO bMoreData = 0;
-        Platform_MemorySet(&vendorCapabilityData, 0, sizeof(vendorCapabilityData));
-        unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_VENDOR_PROPERTY, TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST, 1, &bMoreData, (TSS_TPMS_CAPABILITY_DATA*)&vendorCapabilityData);
-        if (RC_SUCCESS != unReturnValue)
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    // If the query deadline elapsed, the parts read before are returned with EFI_TIMEOUT
+    efiStatus = MapQueryDeadlineStatus(efiStatus);
+    if (EFI_ERROR(efiStatus) && EFI_TIMEOUT != efiStatus && NULL != PppInformationBlock && NULL != *PppInformationBlock)
+    {
+        FreePool(*PppInformationBlock);
+        *PppInformationBlock = NULL;
+    }
+
+    UninitializeTpmAccess();
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationStatus(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns TPM command latency statistics.
+ *  @details    This function returns the latency statistics of all TPM commands sent since the driver was loaded.
+ *              The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationLatency(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    DEVICE_MANAGEMENT_LATENCY_STATISTICS* psStatistics = NULL;
+
+    do {
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Get a snapshot of the statistics (too large for the stack)
+        psStatistics = (DEVICE_MANAGEMENT_LATENCY_STATISTICS*)AllocateZeroPool(sizeof(DEVICE_MANAGEMENT_LATENCY_STATISTICS));
+        if (NULL == psStatistics)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for the statistics in GetInformationLatency(). (0x%.16lX)", efiStatus);
+            break;
+        }
+        unsigned int unReturnValue = DeviceManagement_GetLatencyStatistics(psStatistics);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"DeviceManagement_GetLatencyStatistics returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationLatency(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        // Copy the statistics into the public structure
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1* pInfoLatency = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1*)*PppInformationBlock;
+        unsigned int unIndex = 0;
+        pInfoLatency->DroppedCount = psStatistics->unDroppedCount;
+        for (unIndex = 0; unIndex < psStatistics->unCommandCount && unIndex < EFI_IFXTPM_LATENCY_MAX_COMMANDS; unIndex++)
+        {
+            const DEVICE_MANAGEMENT_COMMAND_LATENCY* psLatency = &psStatistics->rgsCommands[unIndex];
+            EFI_IFXTPM_FIRMWARE_UPDATE_LATENCY_ENTRY_1* pEntry = &pInfoLatency->Commands[unIndex];
+            unsigned int unBucket = 0;
+
+            pEntry->CommandCode = psLatency->unCommandCode;
+            pEntry->Count = psLatency->unCount;
+            pEntry->Failures = psLatency->unFailures;
+            pEntry->Retries = psLatency->unRetries;
+            pEntry->MinUs = psLatency->ullMinUs;
+            pEntry->MaxUs = psLatency->ullMaxUs;
+            pEntry->MeanUs = (0 != psLatency->unCount) ? psLatency->ullTotalUs / psLatency->unCount : 0;
+            pEntry->TotalUs = psLatency->ullTotalUs;
+            pEntry->SendUs = psLatency->ullSendUs;
+            pEntry->WaitUs = psLatency->ullWaitUs;
+            pEntry->ReceiveUs = psLatency->ullReceiveUs;
+            for (unBucket = 0; unBucket < DEVICE_MANAGEMENT_LATENCY_BUCKET_COUNT && unBucket < EFI_IFXTPM_LATENCY_HISTOGRAM_BUCKETS; unBucket++)
+                pEntry->Histogram[unBucket] = psLatency->rgunHistogram[unBucket];
+        }
+        pInfoLatency->CommandCount = unIndex;
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != psStatistics)
+        FreePool(psStatistics);
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationLatency(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the messages recorded in the log ring.
+ *  @details    This function formats the messages recorded in the log ring and removes them from the log ring.
+ *              The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_NOT_READY               The log ring is not enabled.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationLogRing(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1* pInfoLogRing = NULL;
+        unsigned int unTextCapacity = 0;
+        unsigned int unMessageCount = 0;
+        unsigned int unDroppedCount = 0;
+        unsigned int unReturnValue = RC_E_FAIL;
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        if (!Logging_IsRingEnabled())
+        {
+            efiStatus = EFI_NOT_READY;
+            break;
+        }
+
+        // Get the capacity required for the messages
+        unReturnValue = Logging_DrainRing(NULL, &unTextCapacity, &unMessageCount, &unDroppedCount);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1) + (unTextCapacity - 1) * sizeof(CHAR16);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            break;
+        }
+
+        // Read the messages
+        pInfoLogRing = (EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1*)*PppInformationBlock;
+        unReturnValue = Logging_DrainRing(pInfoLogRing->Text, &unTextCapacity, &unMessageCount, &unDroppedCount);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            FreePool(*PppInformationBlock);
+            *PppInformationBlock = NULL;
+            efiStatus = EFI_DEVICE_ERROR;
+            break;
+        }
+        pInfoLogRing->MessageCount = unMessageCount;
+        pInfoLogRing->DroppedCount = unDroppedCount;
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationLogRing(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the records of the register access trace ring.
+ *  @details    This function returns the last TPM register accesses recorded by the device access layer.
+ *              The records stay in the ring. The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationRegisterTrace(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+    DEVICE_ACCESS_TRACE_RECORD* psRecords = NULL;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1* pInfoTrace = NULL;
+        unsigned int unRecordCount = DEVICE_ACCESS_TRACE_CAPACITY;
+        unsigned int unDroppedCount = 0;
+        unsigned int unIndex = 0;
+        unsigned int unReturnValue = RC_E_FAIL;
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Get a snapshot of the ring (too large for the stack)
+        psRecords = (DEVICE_ACCESS_TRACE_RECORD*)AllocatePool(sizeof(DEVICE_ACCESS_TRACE_RECORD) * DEVICE_ACCESS_TRACE_CAPACITY);
+        if (NULL == psRecords)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for the register trace in GetInformationRegisterTrace(). (0x%.16lX)", efiStatus);
+            break;
+        }
+        unReturnValue = DeviceAccess_GetTrace(psRecords, &unRecordCount, &unDroppedCount);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"DeviceAccess_GetTrace returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = OFFSET_OF(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1, Records) + MAX(unRecordCount, 1) * sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_REGISTER_TRACE_RECORD_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationRegisterTrace(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        // Copy the records into the public structure
+        pInfoTrace = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1*)*PppInformationBlock;
+        pInfoTrace->RecordCount = unRecordCount;
+        pInfoTrace->DroppedCount = unDroppedCount;
+        for (unIndex = 0; unIndex < unRecordCount; unIndex++)
+        {
+            pInfoTrace->Records[unIndex].TimeUs = Platform_TicksToMicroseconds(psRecords[unIndex].ullTicks);
+            pInfoTrace->Records[unIndex].Address = psRecords[unIndex].usAddress;
+            pInfoTrace->Records[unIndex].Operation = psRecords[unIndex].bOperation;
+            pInfoTrace->Records[unIndex].Status = psRecords[unIndex].bStatus;
+            pInfoTrace->Records[unIndex].Value = psRecords[unIndex].unValue;
+        }
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != psRecords)
+        FreePool(psRecords);
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationRegisterTrace(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the telemetry of the current or last firmware transfer.
+ *  @details    This function returns the progress, the throughput and the estimated time to completion of the firmware transfer.
+ *              The TPM is not accessed, so the function can be called while EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage is running.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationTransfer(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1* pInfoTransfer = NULL;
+        FIRMWARE_TRANSFER_TELEMETRY sTelemetry;
+        unsigned int unReturnValue = RC_E_FAIL;
+        Platform_MemorySet(&sTelemetry, 0, sizeof(sTelemetry));
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationTransfer(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        unReturnValue = FirmwareUpdate_GetTransferTelemetry(&sTelemetry);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"FirmwareUpdate_GetTransferTelemetry returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        pInfoTransfer = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1*)*PppInformationBlock;
+        pInfoTransfer->Active = sTelemetry.fActive ? 1 : 0;
+        pInfoTransfer->TotalBytes = sTelemetry.unTotalBytes;
+        pInfoTransfer->BytesSent = sTelemetry.unBytesSent;
+        pInfoTransfer->BlocksAcknowledged = sTelemetry.unBlocksAcknowledged;
+        pInfoTransfer->CurrentThroughput = sTelemetry.unCurrentThroughput;
+        pInfoTransfer->AverageThroughput = sTelemetry.unAverageThroughput;
+        pInfoTransfer->ElapsedMs = sTelemetry.unElapsedMs;
+        pInfoTransfer->EstimatedRemainingMs = TRANSFER_TELEMETRY_UNKNOWN == sTelemetry.unEstimatedRemainingMs ?
+                                              EFI_IFXTPM_TRANSFER_ESTIMATE_UNKNOWN : sTelemetry.unEstimatedRemainingMs;
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationTransfer(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the estimated duration of a firmware update.
+ *  @details    This function returns the update duration estimate of the image last passed to EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage.
+ *              The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationDuration(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1* pInfoDuration = NULL;
+        UPDATE_DURATION_ESTIMATE sEstimate;
+        unsigned int unReturnValue = RC_E_FAIL;
+        Platform_MemorySet(&sEstimate, 0, sizeof(sEstimate));
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationDuration(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        unReturnValue = FirmwareUpdate_GetUpdateDurationEstimate(&sEstimate);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"FirmwareUpdate_GetUpdateDurationEstimate returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        pInfoDuration = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1*)*PppInformationBlock;
+        pInfoDuration->Valid = sEstimate.fValid ? 1 : 0;
+        pInfoDuration->Measured = sEstimate.fMeasured ? 1 : 0;
+        pInfoDuration->ManifestBlocks = sEstimate.unManifestBlocks;
+        pInfoDuration->FirmwareBlocks = sEstimate.unFirmwareBlocks;
+        pInfoDuration->BlockSize = sEstimate.unBlockSize;
+        pInfoDuration->BlockLatencyUs = sEstimate.unBlockLatencyUs;
+        pInfoDuration->FixedWaitMs = sEstimate.unFixedWaitMs;
+        pInfoDuration->EstimatedDurationMs = sEstimate.unTotalMs;
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationDuration(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Returns the phase timing of a firmware update.
+ *  @details    This function returns the time spent in each phase of the current or last EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage call.
+ *              The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationPhaseTiming(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1* pInfoPhaseTiming = NULL;
+        UPDATE_PHASE_TIMING sTiming;
+        unsigned int unReturnValue = RC_E_FAIL;
+        unsigned int unIndex = 0;
+        Platform_MemorySet(&sTiming, 0, sizeof(sTiming));
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        }
+
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        if (NULL == *PppInformationBlock)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationPhaseTiming(). (0x%.16lX)", efiStatus);
+            break;
+        }
+
+        unReturnValue = FirmwareUpdate_GetPhaseTiming(&sTiming);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"FirmwareUpdate_GetPhaseTiming returned an unexpected value. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        pInfoPhaseTiming = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1*)*PppInformationBlock;
+        pInfoPhaseTiming->Active = UPDATE_PHASE_NONE != sTiming.unCurrentPhase ? 1 : 0;
+        pInfoPhaseTiming->CurrentPhase = sTiming.unCurrentPhase;
+        pInfoPhaseTiming->TotalUs = sTiming.ullTotalUs;
+        for (unIndex = 0; unIndex < MIN(EFI_IFXTPM_UPDATE_PHASE_COUNT, UPDATE_PHASE_COUNT); unIndex++)
+            pInfoPhaseTiming->PhaseUs[unIndex] = sTiming.rgullPhaseUs[unIndex];
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationPhaseTiming(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+/**
+ *  @brief      Performs the next step of a firmware update started with SetInformation.
+ *  @details    This function performs one step of the firmware update started with EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START and
+ *              returns its state. The TPM reserved for the update is released once the update is done.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationUpdateEngine(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1* pInfoUpdateEngine = NULL;
+        UPDATE_ENGINE_STATUS sStatus;
+        unsigned int unReturnValue = RC_E_FAIL;
+        Platform_MemorySet(&sStatus, 0, sizeof(sStatus));
+
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
         {
-            efiStatus = EFI_DEVICE_ERROR;
-            LOGGING_WRITE_LEVEL1_FMT(L"TSS_TPM2_GetCapability returned an unexpected value. (0x%.8X)", unReturnValue);
+            efiStatus = EFI_INVALID_PARAMETER;
             break;
         }
 
         // Allocate memory (with all bytes set to zero)
-        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1);
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1);
         *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
         if (NULL == *PppInformationBlock)
         {
             efiStatus = EFI_OUT_OF_RESOURCES;
-            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationFuDetails(). (0x%.16lX)", efiStatus);
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationUpdateEngine(). (0x%.16lX)", efiStatus);
             break;
         }
-        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1* pFuDetails = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1*)*PppInformationBlock;
 
-        UINT32 unMaxFirmwareSize = sizeof(pFuDetails->FirmwareVersion) / sizeof(CHAR16);
-        unReturnValue = Platform_StringFormat(&pFuDetails->FirmwareVersion[0], &unMaxFirmwareSize, L"%d.%d.%d.%d", sFirmwareVersion.usMajor, sFirmwareVersion.usMinor, sFirmwareVersion.usBuild, sFirmwareVersion.usRevision);
+        // The TPM is connected while the update holds it, otherwise the engine does not access the TPM
+        unReturnValue = FirmwareUpdate_PollUpdate(&sStatus);
         if (RC_SUCCESS != unReturnValue)
         {
-            ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
+            efiStatus = EFI_DEVICE_ERROR;
+            LOGGING_WRITE_LEVEL1_FMT(L"FirmwareUpdate_PollUpdate returned an unexpected value. (0x%.8X)", unReturnValue);
             break;
         }
 
-        if (!sTpmState.attribs.tpmFirmwareIsValid)
+        // Release the TPM reserved for the update
+        if (UPDATE_STATE_DONE == sStatus.unState && g_pPrivateData->fUpdateEngineAccess)
         {
-            unMaxFirmwareSize = sizeof(pFuDetails->NewFirmwareVersion) / sizeof(CHAR16);
-            unReturnValue = Platform_StringFormat(&pFuDetails->NewFirmwareVersion[0], &unMaxFirmwareSize, L"%d.%d.%d.%d", sNewFirmwareVersion.usMajor, sNewFirmwareVersion.usMinor, sNewFirmwareVersion.usBuild, sNewFirmwareVersion.usRevision);
-            if (RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE(unReturnValue, L"Platform_StringFormat returned an unexpected value.");
-                break;
-            }
-        }
-
-        pFuDetails->Internal1 = unKeyGroupId;
-        pFuDetails->Internal2Size = vendorCapabilityData.data.vendorData.buffer[0].size;
-
-        if (pFuDetails->Internal2Size <= sizeof(pFuDetails->Internal2)) {
-            unReturnValue = Platform_MemoryCopy(&pFuDetails->Internal2[0], sizeof(pFuDetails->Internal2), &vendorCapabilityData.data.vendorData.buffer[0].buffer[0], pFuDetails->Internal2Size);
-            if (RC_SUCCESS != unReturnValue)
-            {
-                ERROR_STORE(unReturnValue, L"Platform_MemoryCopy returned an unexpected value.");
-                break;
-            }
+            g_pPrivateData->fUpdateEngineAccess = FALSE;
+            UninitializeTpmAccess();
         }
-        else
-            LOGGING_WRITE_LEVEL1_FMT(L"Capability returned an unsupported value TPM_PT_VENDOR_FIX_FU_START_HASH_DIGEST (0x%.8lX)", RC_E_BUFFER_TOO_SMALL);
 
+        pInfoUpdateEngine = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1*)*PppInformationBlock;
+        pInfoUpdateEngine->State = sStatus.unState;
+        pInfoUpdateEngine->Progress = sStatus.unProgress;
+        pInfoUpdateEngine->NextPollMs = sStatus.unNextPollMs;
+        pInfoUpdateEngine->Status = UPDATE_STATE_DONE == sStatus.unState ? IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(sStatus.unResult) : EFI_SUCCESS;
         efiStatus = EFI_SUCCESS;
     }
     WHILE_FALSE_END;
 
-    UninitializeTpmAccess();
-
-    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationFuDetails(): (0x%.16lX)", efiStatus);
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationUpdateEngine(): (0x%.16lX)", efiStatus);
 
     return efiStatus;
 }
 
 /**
- *  @brief      Returns TPM operation mode information.
- *  @details    This function returns TPM operation mode information.
+ *  @brief      Returns the firmware update history.
+ *  @details    This function returns the last firmware update attempts from the non-volatile firmware update history, newest first.
+ *              The TPM is not accessed.
  *
- *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID structure.
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1 structure.
  *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
  *
  *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
  *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
- *  @retval     EFI_UNSUPPORTED             The information is not available at the used TPM model.
  *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
  *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
  */
 EFI_STATUS
 EFIAPI
-IFXTPMUpdate_AdapterInformation_GetInformationOperationMode(
+IFXTPMUpdate_AdapterInformation_GetInformationUpdateHistory(
     OUT VOID** PppInformationBlock,
     OUT UINTN* PpullInformationBlockSize)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    UPDATE_HISTORY* pHistory = NULL;
 
     do {
+        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1* pInfoUpdateHistory = NULL;
+        unsigned int unReturnValue = RC_E_FAIL;
+        unsigned int unIndex = 0;
+
         // Parameter Check
         if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
         {
@@ -303,57 +1104,114 @@ IFXTPMUpdate_AdapterInformation_GetInformationOperationMode(
             break;
         }
 
-        // Try to initialize TPM access
-        efiStatus = InitializeTpmAccess();
-        if (EFI_ERROR(efiStatus))
+        // Allocate memory (with all bytes set to zero)
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1);
+        *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
+        pHistory = (UPDATE_HISTORY*)AllocateZeroPool(sizeof(UPDATE_HISTORY));
+        if (NULL == *PppInformationBlock || NULL == pHistory)
+        {
+            efiStatus = EFI_OUT_OF_RESOURCES;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationUpdateHistory(). (0x%.16lX)", efiStatus);
             break;
+        }
 
-        // Get TPM information
-        TPM_STATE sTpmState;
-        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
-        unsigned int unReturnValue = FirmwareUpdate_CalculateState(FALSE, &sTpmState);
+        unReturnValue = FirmwareUpdate_GetUpdateHistory(pHistory);
         if (RC_SUCCESS != unReturnValue)
         {
             efiStatus = EFI_DEVICE_ERROR;
-            LOGGING_WRITE_LEVEL1_FMT(L"Error during determination of TPM state in GetInformationOperationMode(). (0x%.16lX)", efiStatus);
+            LOGGING_WRITE_LEVEL1_FMT(L"FirmwareUpdate_GetUpdateHistory returned an unexpected value. (0x%.8X)", unReturnValue);
             break;
         }
 
-        // Operation mode is only available on SLB 9672
-        if (FALSE == sTpmState.attribs.tpmHasFULoader20)
+        pInfoUpdateHistory = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1*)*PppInformationBlock;
+        pInfoUpdateHistory->TotalCount = pHistory->unCount;
+        pInfoUpdateHistory->Count = MIN(pHistory->unCount, MIN(EFI_IFXTPM_UPDATE_HISTORY_SIZE, UPDATE_HISTORY_SIZE));
+        for (unIndex = 0; unIndex < pInfoUpdateHistory->Count; unIndex++)
         {
-            efiStatus = EFI_UNSUPPORTED;
+            // Newest entry first
+            const UPDATE_HISTORY_ENTRY* pEntry = &pHistory->rgsEntries[(pHistory->unCount - 1 - unIndex) % UPDATE_HISTORY_SIZE];
+            EFI_IFXTPM_UPDATE_HISTORY_ENTRY* pInfoEntry = &pInfoUpdateHistory->Entries[unIndex];
+            unsigned int unPhase = 0;
+            unsigned int unChar = 0;
+
+            pInfoEntry->Sequence = pEntry->unSequence;
+            pInfoEntry->Status = IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(pEntry->unResult);
+            pInfoEntry->Result = pEntry->unResult;
+            pInfoEntry->LastState = pEntry->unLastState;
+            pInfoEntry->ImageFingerprint = pEntry->unFingerprint;
+            pInfoEntry->ImageSize = pEntry->unImageSize;
+            pInfoEntry->BlockCount = pEntry->unBlockCount;
+            pInfoEntry->BlockRetries = pEntry->unBlockRetries;
+            // Keep the null-termination of the zeroed strings
+            for (unChar = 0; unChar < MIN(EFI_IFXTPM_UPDATE_HISTORY_VERSION_SIZE, UPDATE_HISTORY_VERSION_SIZE) - 1; unChar++)
+            {
+                pInfoEntry->SourceVersion[unChar] = (CHAR16)pEntry->wszSourceVersion[unChar];
+                pInfoEntry->TargetVersion[unChar] = (CHAR16)pEntry->wszTargetVersion[unChar];
+            }
+            for (unPhase = 0; unPhase < MIN(EFI_IFXTPM_UPDATE_PHASE_COUNT, UPDATE_PHASE_COUNT); unPhase++)
+                pInfoEntry->PhaseMs[unPhase] = pEntry->rgunPhaseMs[unPhase];
+        }
+        efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != pHistory)
+        FreePool(pHistory);
+
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationUpdateHistory(): (0x%.16lX)", efiStatus);
+
+    return efiStatus;
+}
+
+#ifdef IFXTPMUPDATE_STACK_CHECK
+/**
+ *  @brief      Returns the stack high-water marks of the driver entry points.
+ *  @details    This function returns the stack usage recorded by the stack check instrumentation (IFXTPMUPDATE_STACK_CHECK builds only).
+ *              The TPM is not accessed.
+ *
+ *  @param      PppInformationBlock         Pointer to pointer to store @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1 structure.
+ *  @param      PpullInformationBlockSize   Pointer to store the size of the PppInformationBlock in bytes.
+ *
+ *  @retval     EFI_SUCCESS                 The requested information was returned successfully.
+ *  @retval     EFI_INVALID_PARAMETER       In case of an invalid input parameter.
+ *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_AdapterInformation_GetInformationStackUsage(
+    OUT VOID** PppInformationBlock,
+    OUT UINTN* PpullInformationBlockSize)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do {
+        // Parameter Check
+        if (NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
+        {
+            efiStatus = EFI_INVALID_PARAMETER;
             break;
         }
 
         // Allocate memory (with all bytes set to zero)
-        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1);
+        *PpullInformationBlockSize = sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1);
         *PppInformationBlock = AllocateZeroPool(*PpullInformationBlockSize);
         if (NULL == *PppInformationBlock)
         {
             efiStatus = EFI_OUT_OF_RESOURCES;
-            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationOperationMode(). (0x%.16lX)", efiStatus);
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for PppInformationBlock in GetInformationStackUsage(). (0x%.16lX)", efiStatus);
             break;
         }
 
-        // Set operation mode value and its boolean representations
-        EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1* pInfoOperationMode = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1*)*PppInformationBlock;
-        pInfoOperationMode->TpmOperationMode = (UINT8)sTpmState.attribs.tpm20OperationMode;
-        pInfoOperationMode->TpmInOperationalMode = sTpmState.attribs.tpmInOperationalMode ? TRUE : FALSE;
-        pInfoOperationMode->TpmInFirmwareUpdateMode = sTpmState.attribs.tpmInFwUpdateMode ? TRUE : FALSE;
-        pInfoOperationMode->TpmInFirmwareRecoveryMode = sTpmState.attribs.tpmInFwRecoveryMode ? TRUE : FALSE;
-        pInfoOperationMode->TpmFirmwareIsValid = sTpmState.attribs.tpmFirmwareIsValid ? TRUE : FALSE;
-        pInfoOperationMode->TpmRestartRequired = sTpmState.attribs.tpm20restartRequired ? TRUE : FALSE;
+        IFXTPMUpdate_StackCheckGetUsage((EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1*)*PppInformationBlock);
         efiStatus = EFI_SUCCESS;
     }
     WHILE_FALSE_END;
 
-    UninitializeTpmAccess();
-
-    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationOperationMode(): (0x%.16lX)", efiStatus);
+    LOGGING_WRITE_LEVEL2_FMT(L"Exiting GetInformationStackUsage(): (0x%.16lX)", efiStatus);
 
     return efiStatus;
 }
+#endif
 
 /**
  *  @brief      Returns the current state information for the adapter.
@@ -374,6 +1232,56 @@ IFXTPMUpdate_AdapterInformation_GetInformationOperationMode(
  *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID</td>
  *              <td>Use the information type to get the TPM2.0 firmware update details (only SLB 9672). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1 structure.
  *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID</td>
+ *              <td>Use the information type to get the latency statistics of the TPM commands sent by the driver. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID</td>
+ *              <td>Use the information type to read the messages recorded in the log ring. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID</td>
+ *              <td>Use the information type to get the version name, the TPM firmware update counters, the operation mode and the firmware update details with a single TPM state determination. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID</td>
+ *              <td>Use the information type to read the last TPM register accesses of the driver. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID</td>
+ *              <td>Use the information type to read the throughput and the estimated time to completion of the firmware transfer (also while SetImage is running). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID</td>
+ *              <td>Use the information type to read the estimated duration of a firmware update with the image last passed to CheckImage. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1_GUID</td>
+ *              <td>Use the information type to read the time spent in each phase of the current or last SetImage call. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID</td>
+ *              <td>Use the information type to perform the next step of a firmware update started with SetInformation. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID</td>
+ *              <td>Use the information type to read the last firmware update attempts with their versions, phase durations, block counts and results. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID</td>
+ *              <td>Use the information type to read the stack high-water marks of the driver entry points (only drivers built with IFXTPMUPDATE_STACK_CHECK). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1 structure.
+ *              </tr>
  *              </table>
  *              Otherwise EFI_UNSUPPORTED is returned.
  *  @param      PpThis                      A pointer to the EFI_ADAPTER_INFORMATION_PROTOCOL instance.
@@ -387,6 +1295,7 @@ IFXTPMUpdate_AdapterInformation_GetInformationOperationMode(
  *  @retval     EFI_UNSUPPORTED             The PpInformationType is not known.
  *  @retval     EFI_DEVICE_ERROR            An unexpected error occurred.
  *  @retval     EFI_OUT_OF_RESOURCES        In case memory allocation failed.
+ *  @retval     EFI_TIMEOUT                 The query deadline (see EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID) elapsed.
  */
 EFI_STATUS
 EFIAPI
@@ -397,6 +1306,7 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
     OUT UINTN*                              PpullInformationBlockSize)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_GET_INFORMATION);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_ADAPTER_INFORMATION.GetInformation()");
 
     do
@@ -404,6 +1314,18 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
         const EFI_GUID guidCounters = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1_GUID;
         const EFI_GUID guidOperationMode = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID;
         const EFI_GUID guidFuDetails = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID;
+        const EFI_GUID guidLatency = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID;
+        const EFI_GUID guidLogRing = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID;
+        const EFI_GUID guidStatus = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID;
+        const EFI_GUID guidRegisterTrace = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID;
+        const EFI_GUID guidTransfer = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID;
+        const EFI_GUID guidDuration = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID;
+        const EFI_GUID guidPhaseTiming = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1_GUID;
+        const EFI_GUID guidUpdateEngine = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID;
+        const EFI_GUID guidUpdateHistory = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID;
+#ifdef IFXTPMUPDATE_STACK_CHECK
+        const EFI_GUID guidStackUsage = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID;
+#endif
 
         // Parameter Check
         if (NULL == PpThis || NULL == PpInformationType || NULL == PppInformationBlock || NULL == PpullInformationBlockSize)
@@ -434,6 +1356,78 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
             if (EFI_ERROR(efiStatus))
                 break;
         }
+        // Check for command latency GUID
+        else if (CompareGuid(PpInformationType, &guidLatency))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationLatency(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for log ring GUID
+        else if (CompareGuid(PpInformationType, &guidLogRing))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationLogRing(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for full status GUID
+        else if (CompareGuid(PpInformationType, &guidStatus))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationStatus(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for register trace GUID
+        else if (CompareGuid(PpInformationType, &guidRegisterTrace))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationRegisterTrace(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for firmware transfer GUID
+        else if (CompareGuid(PpInformationType, &guidTransfer))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationTransfer(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for update duration GUID
+        else if (CompareGuid(PpInformationType, &guidDuration))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationDuration(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for phase timing GUID
+        else if (CompareGuid(PpInformationType, &guidPhaseTiming))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationPhaseTiming(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for update engine GUID
+        else if (CompareGuid(PpInformationType, &guidUpdateEngine))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationUpdateEngine(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+        // Check for update history GUID
+        else if (CompareGuid(PpInformationType, &guidUpdateHistory))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationUpdateHistory(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+#ifdef IFXTPMUPDATE_STACK_CHECK
+        // Check for stack usage GUID
+        else if (CompareGuid(PpInformationType, &guidStackUsage))
+        {
+            efiStatus = IFXTPMUpdate_AdapterInformation_GetInformationStackUsage(PppInformationBlock, PpullInformationBlockSize);
+            if (EFI_ERROR(efiStatus))
+                break;
+        }
+#endif
         else
         {
             // GetInformation called with unsupported GUID
@@ -446,6 +1440,8 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_ADAPTER_INFORMATION.GetInformation(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_GET_INFORMATION);
+
     return efiStatus;
 }
 
@@ -470,6 +1466,26 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
  *              The caller must pass a @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1 structure and either set the policy session handle for an authorized policy session in TPM2.0
  *              or set policy session handle to 0 to make IFXTPMUpdate.efi create a default policy session.</td>
  *              </tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID</td>
+ *              <td>Use the information type to enable or disable the log ring. The caller must pass a @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1 structure.
+ *              While the log ring is enabled, log messages are recorded in memory instead of being passed to the logging callback function.</td>
+ *              </tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID</td>
+ *              <td>Use the information type to answer TPM commands from a recorded command/response trace instead of the TPM. The caller must pass a
+ *              @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1 structure.</td>
+ *              </tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID</td>
+ *              <td>Use the information type to start or cancel a firmware update without blocking the caller. The caller must pass a
+ *              @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1 structure. The update is driven by GetInformation calls with the same information type.</td>
+ *              </tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID</td>
+ *              <td>Use the information type to limit the time of the query and check functions. The caller must pass a
+ *              @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1 structure.</td>
+ *              </tr>
  *              </table>
  *              Otherwise EFI_UNSUPPORTED is returned.
  *
@@ -482,6 +1498,7 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
  *  @retval     EFI_DEVICE_ERROR                                An unexpected error occurred.
  *  @retval     EFI_INVALID_PARAMETER                           In case of an invalid input parameter.
  *  @retval     EFI_UNSUPPORTED                                 The PpInformationType is not known.
+ *  @retval     EFI_NOT_READY                                   A firmware update is in progress or cannot be canceled in its current state.
  *  @retval     EFI_IFXTPM_TPM12_DA_ACTIVE                      The TPM Owner is locked out due to dictionary attack\n (The error code only applies to TPM1.2 and information type EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1_GUID).
  *  @retval     EFI_IFXTPM_TPM12_INVALID_OWNERAUTH              TPM Owner authentication is incorrect\n (The error code only applies to TPM1.2 and information type EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1_GUID).
  *  @retval     EFI_IFXTPM_TPM12_NO_OWNER                       The TPM does not have an owner but TPM Owner authorization was provided\n (The error code only applies to TPM1.2 and information type EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1_GUID).
@@ -500,6 +1517,8 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
     IN  UINTN                               PullInformationBlockSize)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    BOOL fTpmAccess = FALSE;
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_SET_INFORMATION);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation()");
 
     do
@@ -507,6 +1526,10 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
         const EFI_GUID guidLogging = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOGGING_1_GUID;
         const EFI_GUID guidTpm12 = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1_GUID;
         const EFI_GUID guidTpm20 = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID;
+        const EFI_GUID guidLogRing = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID;
+        const EFI_GUID guidReplay = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID;
+        const EFI_GUID guidUpdateEngine = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID;
+        const EFI_GUID guidDeadline = EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID;
 
         // Parameter Check
         if (NULL == PpThis || NULL == PpInformationBlock || NULL == PpInformationType)
@@ -529,11 +1552,85 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
             pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOGGING_1*)PpInformationBlock;
             g_pPrivateData->pfnLogCallback = pDescriptor->LogCallback;
             g_pPrivateData->fLogTimeStamps = pDescriptor->AddTimeStamps;
+            g_unLoggingLevel = (NULL != pDescriptor->LogCallback || Logging_IsRingEnabled()) ? LOGGING_LEVEL_3 : LOGGING_DISABLED;
+        }
+        // Check for log ring structure GUID
+        else if (CompareGuid(PpInformationType, &guidLogRing))
+        {
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1* pDescriptor = NULL;
+            if (PullInformationBlockSize != sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1))
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for PullInformationBlockSize. (0x%.16lX)", efiStatus);
+                break;
+            }
+            pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1*)PpInformationBlock;
+            if (RC_SUCCESS != Logging_EnableRing(pDescriptor->Enable))
+            {
+                efiStatus = EFI_OUT_OF_RESOURCES;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during memory allocation for the log ring in SetInformation. (0x%.16lX)", efiStatus);
+                break;
+            }
+            g_unLoggingLevel = (NULL != g_pPrivateData->pfnLogCallback || Logging_IsRingEnabled()) ? LOGGING_LEVEL_3 : LOGGING_DISABLED;
+        }
+        // Check for deadline structure GUID
+        else if (CompareGuid(PpInformationType, &guidDeadline))
+        {
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1* pDescriptor = NULL;
+            if (PullInformationBlockSize != sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1))
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for PullInformationBlockSize. (0x%.16lX)", efiStatus);
+                break;
+            }
+            pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1*)PpInformationBlock;
+            // The deadline is applied by the next TPM access with query priority
+            if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_QUERY_DEADLINE, pDescriptor->DeadlineMs))
+            {
+                efiStatus = EFI_OUT_OF_RESOURCES;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error while setting the query deadline in SetInformation. (0x%.16lX)", efiStatus);
+                break;
+            }
+        }
+        // Check for replay structure GUID
+        else if (CompareGuid(PpInformationType, &guidReplay))
+        {
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1* pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1*)PpInformationBlock;
+            UINTN ullHeaderSize = OFFSET_OF(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1, Trace);
+            if (PullInformationBlockSize < ullHeaderSize || (pDescriptor->Enable && pDescriptor->TraceSize > PullInformationBlockSize - ullHeaderSize))
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for PullInformationBlockSize. (0x%.16lX)", efiStatus);
+                break;
+            }
+
+            // The TPM cannot be replaced while the firmware update engine holds it
+            if (g_pPrivateData->fUpdateEngineAccess)
+            {
+                efiStatus = EFI_NOT_READY;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error in SetInformation: a firmware update is in progress. (0x%.16lX)", efiStatus);
+                break;
+            }
+
+            // The access mode is selected on the next connect
+            UninitializeTpmAccess();
+            if (!pDescriptor->Enable)
+                TpmReplay_Unload();
+            else if (RC_SUCCESS != TpmReplay_Load(pDescriptor->Trace, pDescriptor->TraceSize, pDescriptor->LatencyScalePercent, pDescriptor->ExtraLatencyUs))
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during loading of the replay trace in SetInformation. (0x%.16lX)", efiStatus);
+                break;
+            }
+            // Cached TPM information belongs to the previous TPM access
+            DeviceManagement_InvalidateTpmState();
         }
         // Check for TPM1.2 structure GUID
         else if (CompareGuid(PpInformationType, &guidTpm12))
         {
+#ifndef IFXTPMUPDATE_TPM20_ONLY
             EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1* pDescriptor = NULL;
+#endif
             unsigned int unReturnValue = RC_E_FAIL;
             TPM_STATE sTpmState;
             Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
@@ -546,7 +1643,8 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
             }
 
             // Try to initialize TPM access
-            efiStatus = InitializeTpmAccess();
+            fTpmAccess = TRUE;
+            efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
             if (EFI_ERROR(efiStatus))
                 break;
 
@@ -591,6 +1689,12 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
                 break;
             }
 
+#ifdef IFXTPMUPDATE_TPM20_ONLY
+            // The TPM1.2 authorization commands are not included in this build
+            efiStatus = EFI_IFXTPM_UNSUPPORTED_CHIP;
+            LOGGING_WRITE_LEVEL1_FMT(L"Error: TPM1.2 is not supported by this build of the driver. (0x%.16lX)", efiStatus);
+            break;
+#else
             // Get dictionary attack state for TPM_ET_OWNER and return RC_E_TPM12_DA_ACTIVE if TPM Owner is locked out.
             {
                 UINT16 usSubCap = TSS_TPM_ET_OWNER;
@@ -617,6 +1721,7 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
             // Check TPM Owner authorization (except for disabled/deactivated TPM).
             pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM12_1*)PpInformationBlock;
             unReturnValue = FirmwareUpdate_CheckOwnerAuthorization(pDescriptor->OwnerPasswordSha1);
+            g_pPrivateData->fOwnerAuthVerified = RC_SUCCESS == unReturnValue ? TRUE : FALSE;
             if (RC_SUCCESS != unReturnValue)
             {
                 if ((TSS_TPM_DEACTIVATED == (unReturnValue ^ RC_TPM_MASK)) || (TSS_TPM_DISABLED == (unReturnValue ^ RC_TPM_MASK)))
@@ -642,6 +1747,7 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
             // Copy TPM Owner authentication hash
             CopyMem(g_pPrivateData->rgbOwnerPasswordSha1, pDescriptor->OwnerPasswordSha1, sizeof(pDescriptor->OwnerPasswordSha1));
             g_pPrivateData->fOwnedUpdate = TRUE;
+#endif
         }
         // Check for TPM2.0 structure GUID
         else if (CompareGuid(PpInformationType, &guidTpm20))
@@ -661,12 +1767,14 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
             pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1*)PpInformationBlock;
 
             // Initialize TPM in case it has not been done before to get the type of the plugged TPM
-            efiStatus = InitializeTpmAccess();
+            fTpmAccess = TRUE;
+            efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
             if (EFI_ERROR(efiStatus))
                 break;
 
-            // Get TPM operation mode
-            unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+            // Get TPM operation mode. The state of the platform hierarchy is only needed if the driver shall generate the
+            // policy session, a caller provided policy session is validated by its handle below.
+            unReturnValue = FirmwareUpdate_CalculateState(0 == pDescriptor->SessionHandle, &sTpmState);
             if (RC_SUCCESS != unReturnValue)
             {
                 efiStatus = EFI_DEVICE_ERROR;
@@ -712,23 +1820,23 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
                 }
                 else
                 {
-                    // Read out the list of loaded session handles from the TPM.
+                    // Read out the first loaded session handle at or after the given session handle from the TPM.
+                    // The loaded sessions are listed in handle order, so the given session is loaded if it is returned first.
                     TSS_TPMS_CAPABILITY_DATA handleCapabilityData;
                     BYTE bMoreData = 0;
-                    unsigned int unIndex = 0;
                     BOOL fFound = FALSE;
                     Platform_MemorySet(&handleCapabilityData, 0, sizeof(handleCapabilityData));
 
-                    unReturnValue = TSS_TPM2_GetCapability(TSS_TPM_CAP_HANDLES, TSS_TPM_HT_LOADED_SESSION << 24, 256, &bMoreData, &handleCapabilityData);
+                    unReturnValue = TSS_TPM2_GetCapability(
+                                        TSS_TPM_CAP_HANDLES,
+                                        (TSS_TPM_HT_LOADED_SESSION << 24) | (pDescriptor->SessionHandle & TSS_HR_HANDLE_MASK),
+                                        1, &bMoreData, &handleCapabilityData);
                     if (RC_SUCCESS == unReturnValue)
                     {
-                        unsigned int unCountofHandles = handleCapabilityData.data.handles.count;
-                        for (unIndex = 0; unIndex < unCountofHandles; unIndex++)
-                        {
-                            // Check whether the given SessionHandle is in the list
-                            if (pDescriptor->SessionHandle == handleCapabilityData.data.handles.handle[unIndex])
-                                fFound = TRUE;
-                        }
+                        // Check whether the given SessionHandle is the first handle returned
+                        if (handleCapabilityData.data.handles.count > 0 &&
+                                pDescriptor->SessionHandle == handleCapabilityData.data.handles.handle[0])
+                            fFound = TRUE;
 
                         if (!fFound)
                         {
@@ -756,9 +1864,102 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
 
             g_pPrivateData->unSessionHandle = pDescriptor->SessionHandle;
         }
+        // Check for update engine structure GUID
+        else if (CompareGuid(PpInformationType, &guidUpdateEngine))
+        {
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1* pDescriptor = NULL;
+            unsigned int unReturnValue = RC_E_FAIL;
+
+            if (PullInformationBlockSize != sizeof(EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1))
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for PullInformationBlockSize. (0x%.16lX)", efiStatus);
+                break;
+            }
+            pDescriptor = (EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1*)PpInformationBlock;
+
+            if (EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START == pDescriptor->Command)
+            {
+                IfxFirmwareUpdateData sFirmwareUpdateData;
+                ZeroMem(&sFirmwareUpdateData, sizeof(sFirmwareUpdateData));
+
+                if (NULL == pDescriptor->Image || 0 == pDescriptor->ImageSize || pDescriptor->ImageSize > MAX_UINT32)
+                {
+                    efiStatus = EFI_INVALID_PARAMETER;
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid firmware image. (0x%.16lX)", efiStatus);
+                    break;
+                }
+                if (g_pPrivateData->fUpdateEngineAccess)
+                {
+                    efiStatus = EFI_NOT_READY;
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error in SetInformation: a firmware update is in progress. (0x%.16lX)", efiStatus);
+                    break;
+                }
+
+                fTpmAccess = TRUE;
+                efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_UPDATE);
+                if (EFI_ERROR(efiStatus))
+                    break;
+
+                sFirmwareUpdateData.rgbFirmwareImage = (BYTE*)pDescriptor->Image;
+                sFirmwareUpdateData.unFirmwareImageSize = (unsigned int)pDescriptor->ImageSize;
+                sFirmwareUpdateData.unSessionHandle = g_pPrivateData->unSessionHandle;
+                if (g_pPrivateData->fOwnedUpdate)
+                {
+                    unReturnValue = Platform_MemoryCopy(
+                                        sFirmwareUpdateData.rgbOwnerAuthHash,
+                                        sizeof(sFirmwareUpdateData.rgbOwnerAuthHash),
+                                        g_pPrivateData->rgbOwnerPasswordSha1,
+                                        sizeof(g_pPrivateData->rgbOwnerPasswordSha1));
+                    if (RC_SUCCESS != unReturnValue)
+                    {
+                        efiStatus = EFI_DEVICE_ERROR;
+                        break;
+                    }
+                    sFirmwareUpdateData.fOwnerAuthProvided = TRUE;
+                    // The checks of SetInformation() are only reused for the first update attempt
+                    sFirmwareUpdateData.fOwnerAuthVerified = g_pPrivateData->fOwnerAuthVerified;
+                    g_pPrivateData->fOwnerAuthVerified = FALSE;
+                }
+
+                // Check the image and prepare the policy session within the update
+                unReturnValue = FirmwareUpdate_StartUpdate(&sFirmwareUpdateData, TRUE);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    efiStatus = IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(unReturnValue);
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error during start of the firmware update. (0x%.16lX)", efiStatus);
+                    break;
+                }
+
+                // Keep the TPM reserved for the update, GetInformation releases it once the update is done
+                efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_UPDATE);
+                if (EFI_ERROR(efiStatus))
+                {
+                    IGNORE_RETURN_VALUE(FirmwareUpdate_CancelUpdate());
+                    break;
+                }
+                g_pPrivateData->fUpdateEngineAccess = TRUE;
+            }
+            else if (EFI_IFXTPM_UPDATE_ENGINE_COMMAND_CANCEL == pDescriptor->Command)
+            {
+                unReturnValue = FirmwareUpdate_CancelUpdate();
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    efiStatus = IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(unReturnValue);
+                    LOGGING_WRITE_LEVEL1_FMT(L"Error during cancellation of the firmware update. (0x%.16lX)", efiStatus);
+                    break;
+                }
+            }
+            else
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for Command. (0x%.16lX)", efiStatus);
+                break;
+            }
+        }
         else
         {
-            // SetInformation only supports EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOGGING_1_GUID and EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID
+            // SetInformation only supports EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOGGING_1_GUID, EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID, EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID, EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID and EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID
             efiStatus = EFI_UNSUPPORTED;
             LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetInformation: invalid value for PpInformationType. (0x%.16lX)", efiStatus);
             break;
@@ -768,10 +1969,14 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
     }
     WHILE_FALSE_END;
 
-    UninitializeTpmAccess();
+    // Only release the TPM access claimed above, the firmware update engine may hold the TPM
+    if (fTpmAccess)
+        UninitializeTpmAccess();
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_SET_INFORMATION);
+
     return efiStatus;
 }
 
@@ -787,6 +1992,17 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1_GUID
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID (only drivers built with IFXTPMUPDATE_STACK_CHECK)
  *
  *  @param      PpThis                      A pointer to the EFI_ADAPTER_INFORMATION_PROTOCOL instance.
  *  @param      PppInfoTypesBuffer          A pointer to the array of InformationType GUIDs that are supported by PpThis.
@@ -806,6 +2022,7 @@ IFXTPMUpdate_AdapterInformation_GetSupportedTypes(
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
 
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_GET_SUPPORTED_TYPES);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_ADAPTER_INFORMATION_PROTOCOL.GetSupportedTypes()");
     do
     {
@@ -815,7 +2032,21 @@ IFXTPMUpdate_AdapterInformation_GetSupportedTypes(
             EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID,
             EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1_GUID,
             EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID,
-            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID,
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID,
+#ifdef IFXTPMUPDATE_STACK_CHECK
+            EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID
+#endif
         };
 
         // Check parameters
@@ -846,6 +2077,8 @@ IFXTPMUpdate_AdapterInformation_GetSupportedTypes(
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_ADAPTER_INFORMATION_PROTOCOL.GetSupportedTypes(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_GET_SUPPORTED_TYPES);
+
     return efiStatus;
 }
 
@@ -39,6 +39,41 @@
  *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID</td>
  *              <td>Use the information type to get the TPM2.0 firmware update details (only SLB 9672). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1 structure.
  *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID</td>
+ *              <td>Use the information type to get the latency statistics of the TPM commands sent by the driver. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID</td>
+ *              <td>Use the information type to read the messages recorded in the log ring. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID</td>
+ *              <td>Use the information type to get the version name, the TPM firmware update counters, the operation mode and the firmware update details with a single TPM state determination. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID</td>
+ *              <td>Use the information type to read the last TPM register accesses of the driver. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID</td>
+ *              <td>Use the information type to read the throughput and the estimated time to completion of the firmware transfer (also while SetImage is running). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID</td>
+ *              <td>Use the information type to read the estimated duration of a firmware update with the image last passed to CheckImage. The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1 structure.
+ *              </tr>
+ *              <tr><th>Information Type</th><th>Description</th></tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID</td>
+ *              <td>Use the information type to read the stack high-water marks of the driver entry points (only drivers built with IFXTPMUPDATE_STACK_CHECK). The caller will receive @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1 structure.
+ *              </tr>
  *              </table>
  *              Otherwise EFI_UNSUPPORTED is returned.
  *  @param      PpThis                      A pointer to the EFI_ADAPTER_INFORMATION_PROTOCOL instance.
@@ -82,6 +117,11 @@ IFXTPMUpdate_AdapterInformation_GetInformation(
  *              The caller must pass a @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1 structure and either set the policy session handle for an authorized policy session in TPM2.0
  *              or set policy session handle to 0 to make IFXTPMUpdate.efi create a default policy session.</td>
  *              </tr>
+ *              <tr>
+ *              <td>@ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID</td>
+ *              <td>Use the information type to answer TPM commands from a recorded command/response trace instead of the TPM. The caller must pass a
+ *              @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1 structure.</td>
+ *              </tr>
  *              </table>
  *              Otherwise EFI_UNSUPPORTED is returned.
  *
@@ -123,6 +163,14 @@ IFXTPMUpdate_AdapterInformation_SetInformation(
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1_GUID
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID
  *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID
+ *              * @ref EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID (only drivers built with IFXTPMUPDATE_STACK_CHECK)
  *
  *  @param      PpThis                      A pointer to the EFI_ADAPTER_INFORMATION_PROTOCOL instance.
  *  @param      PppInfoTypesBuffer          A pointer to the array of InformationType GUIDs that are supported by PpThis.
@@ -15,35 +15,248 @@
 
 #include "Error.h"
 
+/// Number of records in the error ring
+#define ERROR_RING_CAPACITY             16
+
+/// Maximum size of the format arguments of an error record in bytes
+#define ERROR_RECORD_ARGUMENTS_SIZE     (8 * sizeof(UINT64))
+
+/// Value of unArgumentsSize if the format arguments could not be recorded
+#define ERROR_RECORD_NO_ARGUMENTS       0xFFFFFFFF
+
+/// Capacity of the buffer used to format an error record for the log in elements
+#define ERROR_LOG_MESSAGE_CAPACITY      512
+
+/**
+ *  @brief      Error record
+ *  @details    An error is recorded with its format string and raw format arguments. The message is only formatted when the record
+ *              is logged or read.
+ */
+typedef struct tdIfxErrorRecord
+{
+    /// The internal error code
+    unsigned int    unInternalErrorCode;
+    /// The code line in the module where the error occurred
+    int             nOccurredInLine;
+    /// The module where the error occurred
+    const char*     szOccurredInModule;
+    /// The function in the module where the error occurred
+    const char*     szOccurredInFunction;
+    /// Format string of the internal error message
+    const wchar_t*  wszInternalErrorMessage;
+    /// Size of the recorded format arguments in bytes or ERROR_RECORD_NO_ARGUMENTS
+    unsigned int    unArgumentsSize;
+    /// Flag indicating whether the record was already logged
+    BOOL            fLogged;
+    /// Format arguments in the layout of a BASE_LIST
+    UINT64          rgullArguments[ERROR_RECORD_ARGUMENTS_SIZE / sizeof(UINT64)];
+} IfxErrorRecord;
+
+/// The error ring
+static IfxErrorRecord s_rgsErrorRing[ERROR_RING_CAPACITY];
+
+/// Index of the newest record in the error ring
+static unsigned int s_unErrorRingNewest = 0;
+
+/// Number of records in the error ring
+static unsigned int s_unErrorRingCount = 0;
+
+/// Error data of the newest record (formatted by Error_GetStack)
+static IfxErrorData s_sErrorData;
+
+/**
+ *  @brief      Returns a record of the error ring
+ *  @details
+ *
+ *  @param      PunAge      Age of the record (0 for the newest one). Must be lower than s_unErrorRingCount.
+ *
+ *  @returns    Pointer to the record.
+ */
+static
+IfxErrorRecord*
+Error_RingRecord(
+    _In_    unsigned int    PunAge)
+{
+    return &s_rgsErrorRing[(s_unErrorRingNewest + ERROR_RING_CAPACITY - PunAge) % ERROR_RING_CAPACITY];
+}
+
+/**
+ *  @brief      Collects the format arguments of an error message
+ *  @details    Only integer, character and pointer conversions are supported. The arguments of other conversions (e.g. strings)
+ *              may not stay valid until the message is formatted.
+ *
+ *  @param      PpRecord            Record receiving the arguments.
+ *  @param      PwszFormat          Format string of the message.
+ *  @param      PargList            Arguments of the message.
+ */
+static
+void
+Error_RecordArguments(
+    _Inout_ IfxErrorRecord* PpRecord,
+    _In_z_  const wchar_t*  PwszFormat,
+    _In_    va_list         PargList)
+{
+    BYTE* pbArguments = (BYTE*)PpRecord->rgullArguments;
+    unsigned int unArgumentsSize = 0;
+    const wchar_t* pwszPosition = NULL;
+
+    PpRecord->unArgumentsSize = ERROR_RECORD_NO_ARGUMENTS;
+
+    for (pwszPosition = PwszFormat; L'\0' != *pwszPosition; pwszPosition++)
+    {
+        BOOL fLong = FALSE;
+        unsigned int unArgumentSize = 0;
+
+        if (L'%' != *pwszPosition)
+            continue;
+
+        // Skip flags, width and precision
+        for (pwszPosition++; L'\0' != *pwszPosition; pwszPosition++)
+        {
+            if (L'l' == *pwszPosition || L'L' == *pwszPosition)
+                fLong = TRUE;
+            else if (L'*' == *pwszPosition)
+            {
+                if (unArgumentsSize + _BASE_INT_SIZE_OF(UINTN) > ERROR_RECORD_ARGUMENTS_SIZE)
+                    return;
+                *(UINTN*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINTN);
+                unArgumentsSize += _BASE_INT_SIZE_OF(UINTN);
+            }
+            else if (!((L'0' <= *pwszPosition && L'9' >= *pwszPosition) || L'.' == *pwszPosition || L'-' == *pwszPosition ||
+                    L'+' == *pwszPosition || L' ' == *pwszPosition || L',' == *pwszPosition || L'#' == *pwszPosition))
+                break;
+        }
+
+        switch (*pwszPosition)
+        {
+            case L'%':
+                break;
+            case L'd':
+            case L'i':
+            case L'u':
+            case L'x':
+            case L'X':
+                unArgumentSize = fLong ? _BASE_INT_SIZE_OF(UINT64) : _BASE_INT_SIZE_OF(int);
+                if (unArgumentsSize + unArgumentSize > ERROR_RECORD_ARGUMENTS_SIZE)
+                    return;
+                if (fLong)
+                    *(UINT64*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINT64);
+                else
+                    *(int*)&pbArguments[unArgumentsSize] = va_arg(PargList, int);
+                unArgumentsSize += unArgumentSize;
+                break;
+            case L'c':
+            case L'p':
+                if (unArgumentsSize + _BASE_INT_SIZE_OF(UINTN) > ERROR_RECORD_ARGUMENTS_SIZE)
+                    return;
+                *(UINTN*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINTN);
+                unArgumentsSize += _BASE_INT_SIZE_OF(UINTN);
+                break;
+            default:
+                // e.g. string (%s) or GUID (%g) arguments
+                return;
+        }
+
+        if (L'\0' == *pwszPosition)
+            break;
+    }
+
+    PpRecord->unArgumentsSize = unArgumentsSize;
+}
+
+/**
+ *  @brief      Formats the message of an error record
+ *  @details    The message is truncated if the buffer is too small.
+ *
+ *  @param      PpRecord            Record to format.
+ *  @param      PwszMessage         Buffer receiving the null-terminated message.
+ *  @param      PunMessageCapacity  Capacity of PwszMessage in elements.
+ */
+static
+void
+Error_FormatRecord(
+    _In_                            const IfxErrorRecord*   PpRecord,
+    _Out_z_cap_(PunMessageCapacity) wchar_t*                PwszMessage,
+    _In_                            unsigned int            PunMessageCapacity)
+{
+    unsigned int unCount = (unsigned int)UnicodeSPrint(PwszMessage, PunMessageCapacity * sizeof(wchar_t), L"ErrorCode: 0x%.8x; ErrorMessage: ", PpRecord->unInternalErrorCode);
+
+    if (NULL == PpRecord->wszInternalErrorMessage)
+        return;
+
+    if (ERROR_RECORD_NO_ARGUMENTS == PpRecord->unArgumentsSize)
+        // The arguments could not be recorded, so the format string is returned as is
+        UnicodeSPrint(&PwszMessage[unCount], (PunMessageCapacity - unCount) * sizeof(wchar_t), L"%s", PpRecord->wszInternalErrorMessage);
+    else
+        UnicodeBSPrint(&PwszMessage[unCount], (PunMessageCapacity - unCount) * sizeof(wchar_t), PpRecord->wszInternalErrorMessage, (BASE_LIST)PpRecord->rgullArguments);
+}
+
+/**
+ *  @brief      Logs an error record
+ *  @details
+ *
+ *  @param      PpRecord            Record to log.
+ */
+static
+void
+Error_LogRecord(
+    _Inout_ IfxErrorRecord* PpRecord)
+{
+    wchar_t wszMessage[ERROR_LOG_MESSAGE_CAPACITY];
+
+    Error_FormatRecord(PpRecord, wszMessage, RG_LEN(wszMessage));
+    Logging_WriteLog(PpRecord->szOccurredInModule, PpRecord->szOccurredInFunction, LOGGING_LEVEL_1, L"%ls", wszMessage);
+    PpRecord->fLogged = TRUE;
+}
+
 /**
  *  @brief      Function to return the error stack
- *  @details    Not used
+ *  @details    Returns the newest error of the error ring. Its message is formatted on each call. Older errors are not linked.
  *
- *  @returns    NULL
+ *  @returns    Pointer to the newest error or NULL if no error is stored.
  */
 _Check_return_
 IfxErrorData*
 Error_GetStack()
 {
-    return NULL;
+    const IfxErrorRecord* pRecord = NULL;
+
+    if (0 == s_unErrorRingCount)
+        return NULL;
+
+    pRecord = Error_RingRecord(0);
+    s_sErrorData.unInternalErrorCode = pRecord->unInternalErrorCode;
+    s_sErrorData.nOccurredInLine = pRecord->nOccurredInLine;
+    s_sErrorData.pPreviousError = NULL;
+    Error_FormatRecord(pRecord, s_sErrorData.wszInternalErrorMessage, RG_LEN(s_sErrorData.wszInternalErrorMessage));
+    UnicodeSPrint(s_sErrorData.wszOccurredInModule, sizeof(s_sErrorData.wszOccurredInModule), L"%a", pRecord->szOccurredInModule);
+    UnicodeSPrint(s_sErrorData.wszOccurredInFunction, sizeof(s_sErrorData.wszOccurredInFunction), L"%a", pRecord->szOccurredInFunction);
+
+    return &s_sErrorData;
 }
 
 /**
  *  @brief      Function to clear the error stack
- *  @details    Not used
+ *  @details    Removes all errors from the error ring.
  */
 void
 Error_ClearStack()
 {
+    s_unErrorRingCount = 0;
 }
 
 /**
  *  @brief      Function to clear the first item in the error stack
- *  @details    Not used
+ *  @details    Removes the newest error from the error ring.
  */
 void
 Error_ClearFirstItem()
 {
+    if (0 == s_unErrorRingCount)
+        return;
+
+    s_unErrorRingNewest = (s_unErrorRingNewest + ERROR_RING_CAPACITY - 1) % ERROR_RING_CAPACITY;
+    s_unErrorRingCount--;
 }
 
 /**
@@ -79,7 +292,9 @@ Error_GetErrorData(
 /**
  *  @brief      Function to store an error
  *  @details    This function stores an error and its specific parameters for later use.
- *              The error element is stored as the first element of the error list (stack).
+ *              The error is recorded in a ring of the last ERROR_RING_CAPACITY errors with its format string and raw format
+ *              arguments. The message is only formatted if it is logged (a logging consumer is set) or read.
+ *              The module, function and format strings must stay valid, which is the case for the ERROR_STORE macros.
  *
  *  @param      PszOccurredInModule         Pointer to a char array holding the module name where the error occurred.
  *  @param      PszOccurredInFunction       Pointer to a char array holding the function name where the error occurred.
@@ -98,35 +313,32 @@ Error_Store(
     _In_z_  const wchar_t*  PwszInternalErrorMessage,
     ...)
 {
-    unsigned int unReturnValue = RC_E_FAIL;
-    UNREFERENCED_PARAMETER(PnOccurredInLine);
+    IfxErrorRecord* pRecord = NULL;
 
-    do
-    {
-        wchar_t wszMessage[6144];
-        unsigned int unMessageSize = RG_LEN(wszMessage);
-        unsigned int unSize = unMessageSize;
-        va_list argptr;
-        IGNORE_RETURN_VALUE(Platform_StringSetZero(wszMessage, RG_LEN(wszMessage)));
+    s_unErrorRingNewest = (s_unErrorRingNewest + 1) % ERROR_RING_CAPACITY;
+    if (s_unErrorRingCount < ERROR_RING_CAPACITY)
+        s_unErrorRingCount++;
 
-        // Format error code to message
-        unReturnValue = Platform_StringFormat(wszMessage, &unSize, L"ErrorCode: 0x%.8x; ErrorMessage: ", PunInternalErrorCode);
-        if (RC_SUCCESS != unReturnValue)
-            break;
-
-        unMessageSize -= unSize;
+    pRecord = Error_RingRecord(0);
+    pRecord->unInternalErrorCode = PunInternalErrorCode;
+    pRecord->nOccurredInLine = PnOccurredInLine;
+    pRecord->szOccurredInModule = PszOccurredInModule;
+    pRecord->szOccurredInFunction = PszOccurredInFunction;
+    pRecord->wszInternalErrorMessage = PwszInternalErrorMessage;
+    pRecord->unArgumentsSize = 0;
+    pRecord->fLogged = FALSE;
 
-        // Format Message
+    if (NULL != PwszInternalErrorMessage)
+    {
+        va_list argptr;
         va_start(argptr, PwszInternalErrorMessage);
-        unReturnValue = Platform_StringFormatV(&wszMessage[unSize], &unMessageSize, PwszInternalErrorMessage, argptr);
+        Error_RecordArguments(pRecord, PwszInternalErrorMessage, argptr);
         va_end(argptr);
-
-        if (RC_SUCCESS != unReturnValue)
-            break;
-
-        Logging_WriteLog(PszOccurredInModule, PszOccurredInFunction, LOGGING_LEVEL_1, wszMessage);
     }
-    WHILE_FALSE_END;
+
+    // Format the message only if somebody consumes the log
+    if (LOGGING_LEVEL_1 <= g_unLoggingLevel)
+        Error_LogRecord(pRecord);
 }
 
 /**
@@ -209,24 +421,35 @@ Error_GetFinalMessage(
 
 /**
  *  @brief      Return the internal error code
- *  @details    This function returns the internal error code.
+ *  @details    This function returns the internal error code of the newest stored error.
  *
- *  @retval     The internal error code.
+ *  @retval     The internal error code or RC_E_FAIL if no error is stored.
  */
 _Check_return_
 unsigned int
 Error_GetInternalCode()
 {
-    return RC_E_FAIL;
+    if (0 == s_unErrorRingCount)
+        return RC_E_FAIL;
+
+    return Error_RingRecord(0)->unInternalErrorCode;
 }
 
 /**
  *  @brief      Log the error stack
- *  @details    This function logs the whole error stack.
+ *  @details    This function logs all errors of the error ring which were not logged yet, from oldest to newest.
  */
 void
 Error_LogStack()
 {
+    unsigned int unAge = 0;
+
+    for (unAge = s_unErrorRingCount; unAge > 0; unAge--)
+    {
+        IfxErrorRecord* pRecord = Error_RingRecord(unAge - 1);
+        if (!pRecord->fLogged)
+            Error_LogRecord(pRecord);
+    }
 }
 
 /**
@@ -26,34 +26,302 @@
 #include "TPM_Types.h"
 
 #include <Library/DisplayUpdateProgressLib.h>
+#include <Library/HobLib.h>
+#include <Library/PcdLib.h>
+#include <Guid/FmpCapsule.h>
+#include <Protocol/IpmiProtocol.h>
+
+//
+// Interval at which the posted firmware update progress is rendered
+//
+#define UPDATE_PROGRESS_RENDER_PERIOD  EFI_TIMER_PERIOD_MILLISECONDS (250)
+
+//
+// Progress channel between the firmware update loop and the render timer
+//
+STATIC EFI_EVENT      mUpdateProgressEvent     = NULL;
+STATIC volatile UINTN mUpdateProgressPosted    = 0;
+STATIC UINTN          mUpdateProgressRendered  = (UINTN)-1;
+
+//
+// IPMI network function of OEM/Group commands, the request data starts with the IANA enterprise number
+//
+#define BMC_TELEMETRY_NETFN_OEM_GROUP  0x2E
+
+//
+// Record types posted to the BMC
+//
+#define BMC_TELEMETRY_RECORD_PROGRESS  0x01
+#define BMC_TELEMETRY_RECORD_RESULT    0x02
+
+//
+// Phase value of a record while no phase is measured
+//
+#define BMC_TELEMETRY_PHASE_NONE  0xFF
+
+#pragma pack(1)
+
+//
+// Request data of the IPMI OEM command posting a telemetry record to the BMC.
+// Multi-byte fields are little endian as usual for IPMI.
+//
+typedef struct {
+  UINT8     Iana[3];                // IANA enterprise number from PcdIfxTpmBmcTelemetryIanaNumber, LSB first
+  UINT8     RecordType;             // BMC_TELEMETRY_RECORD_PROGRESS or BMC_TELEMETRY_RECORD_RESULT
+  UINT8     ImageIndex;             // Image index of the TPM instance
+  UINT8     Phase;                  // UPDATE_PHASE_VERIFY, ... or BMC_TELEMETRY_PHASE_NONE
+  UINT8     Completion;             // Completion of the firmware update in percent
+  UINT32    CurrentThroughput;      // Throughput of the last acknowledged firmware block in bytes per second
+  UINT32    AverageThroughput;      // Average throughput of the firmware transfer in bytes per second
+  UINT32    EstimatedRemainingMs;   // Estimated time to completion or TRANSFER_TELEMETRY_UNKNOWN
+  UINT32    LastAttemptStatus;      // LAST_ATTEMPT_STATUS_* of a result record, 0 in progress records
+} BMC_TELEMETRY_RECORD;
+
+#pragma pack()
+
+//
+// Telemetry sink of the current firmware update, NULL if PcdIfxTpmBmcTelemetry is disabled,
+// no IPMI protocol is installed or the BMC did not accept a record
+//
+STATIC IPMI_PROTOCOL  *mBmcTelemetryIpmi       = NULL;
+STATIC UINT8          mBmcTelemetryImageIndex  = 0;
+STATIC UINT8          mBmcTelemetryPhase       = BMC_TELEMETRY_PHASE_NONE;
+STATIC UINT64         mBmcTelemetryPostTicks   = 0;
+STATIC UINTN          mBmcTelemetryCompletion  = 0;
+
+//
+// Progress callback of SetImage, called by BmcTelemetryProgressCallback
+//
+STATIC EFI_FIRMWARE_MANAGEMENT_UPDATE_IMAGE_PROGRESS  mBmcTelemetryForward = NULL;
 
 /**
-  Function indicate the current completion progress of the firmware
-  update. Platform may override with own specific progress function.
+  Post a telemetry record of the current firmware update to the BMC.
 
-  @param[in]  Completion  A value between 1 and 100 indicating the current
+  The record is built from the phase timing and the transfer telemetry of the
+  firmware update engine, which does not access the TPM. The sink is closed
+  for the rest of the firmware update if the BMC does not accept the record,
+  so an unresponsive BMC costs at most one IPMI timeout.
+
+  @param[in]  RecordType         BMC_TELEMETRY_RECORD_PROGRESS or BMC_TELEMETRY_RECORD_RESULT.
+  @param[in]  Completion         Completion of the firmware update in percent.
+  @param[in]  LastAttemptStatus  LAST_ATTEMPT_STATUS_* value of a result record.
+
+**/
+STATIC
+VOID
+BmcTelemetryPost (
+  IN UINT8   RecordType,
+  IN UINTN   Completion,
+  IN UINT32  LastAttemptStatus
+  )
+{
+  EFI_STATUS                   Status;
+  BMC_TELEMETRY_RECORD         Record;
+  UPDATE_PHASE_TIMING          PhaseTiming;
+  FIRMWARE_TRANSFER_TELEMETRY  Transfer;
+  UINT32                       Iana;
+  UINT8                        Response[8];
+  UINT32                       ResponseSize;
+
+  ZeroMem (&Record, sizeof (Record));
+  ZeroMem (&PhaseTiming, sizeof (PhaseTiming));
+  ZeroMem (&Transfer, sizeof (Transfer));
+
+  PhaseTiming.unCurrentPhase = UPDATE_PHASE_NONE;
+  IGNORE_RETURN_VALUE (FirmwareUpdate_GetPhaseTiming (&PhaseTiming));
+  IGNORE_RETURN_VALUE (FirmwareUpdate_GetTransferTelemetry (&Transfer));
+
+  Iana                        = PcdGet32 (PcdIfxTpmBmcTelemetryIanaNumber);
+  Record.Iana[0]              = (UINT8)Iana;
+  Record.Iana[1]              = (UINT8)(Iana >> 8);
+  Record.Iana[2]              = (UINT8)(Iana >> 16);
+  Record.RecordType           = RecordType;
+  Record.ImageIndex           = mBmcTelemetryImageIndex;
+  Record.Phase                = (PhaseTiming.unCurrentPhase < UPDATE_PHASE_COUNT) ? (UINT8)PhaseTiming.unCurrentPhase : BMC_TELEMETRY_PHASE_NONE;
+  Record.Completion           = (UINT8)MIN (Completion, 100);
+  Record.CurrentThroughput    = Transfer.unCurrentThroughput;
+  Record.AverageThroughput    = Transfer.unAverageThroughput;
+  Record.EstimatedRemainingMs = Transfer.unEstimatedRemainingMs;
+  Record.LastAttemptStatus    = LastAttemptStatus;
+
+  mBmcTelemetryPhase     = Record.Phase;
+  mBmcTelemetryPostTicks = Platform_GetTicks ();
+
+  ResponseSize = sizeof (Response);
+  Status       = mBmcTelemetryIpmi->IpmiSubmitCommand (
+                                      mBmcTelemetryIpmi,
+                                      BMC_TELEMETRY_NETFN_OEM_GROUP,
+                                      PcdGet8 (PcdIfxTpmBmcTelemetryCommand),
+                                      (UINT8 *)&Record,
+                                      sizeof (Record),
+                                      Response,
+                                      &ResponseSize
+                                      );
+  if (!EFI_ERROR (Status) && ((ResponseSize == 0) || (Response[0] != 0x00))) {
+    Status = EFI_DEVICE_ERROR;
+  }
+
+  if (EFI_ERROR (Status)) {
+    DEBUG ((DEBUG_WARN, "BMC telemetry disabled for this update - %r\n", Status));
+    mBmcTelemetryIpmi = NULL;
+  }
+}
+
+/**
+  Open the BMC telemetry sink for a firmware update and post the first
+  progress record.
+
+  @param[in]  ImageIndex  Image index of the TPM instance.
+
+**/
+STATIC
+VOID
+BmcTelemetryStart (
+  IN UINT8  ImageIndex
+  )
+{
+  EFI_STATUS  Status;
+
+  mBmcTelemetryIpmi       = NULL;
+  mBmcTelemetryImageIndex = ImageIndex;
+  mBmcTelemetryPhase      = BMC_TELEMETRY_PHASE_NONE;
+  mBmcTelemetryCompletion = 0;
+
+  if (!FeaturePcdGet (PcdIfxTpmBmcTelemetry)) {
+    return;
+  }
+
+  Status = gBS->LocateProtocol (&gIpmiProtocolGuid, NULL, (VOID **)&mBmcTelemetryIpmi);
+  if (EFI_ERROR (Status)) {
+    mBmcTelemetryIpmi = NULL;
+    return;
+  }
+
+  BmcTelemetryPost (BMC_TELEMETRY_RECORD_PROGRESS, 0, 0);
+}
+
+/**
+  Post a progress record to the BMC if the phase of the firmware update has
+  changed or PcdIfxTpmBmcTelemetryIntervalMs has elapsed since the last record.
+
+  Called from the progress callback of the firmware update, i.e. between two
+  firmware blocks when no TPM transaction is in flight.
+
+  @param[in]  Completion  Completion of the firmware update in percent.
+
+**/
+STATIC
+VOID
+BmcTelemetryProgress (
+  IN UINTN  Completion
+  )
+{
+  UPDATE_PHASE_TIMING  PhaseTiming;
+  UINT8                Phase;
+
+  mBmcTelemetryCompletion = Completion;
+  if (mBmcTelemetryIpmi == NULL) {
+    return;
+  }
+
+  PhaseTiming.unCurrentPhase = UPDATE_PHASE_NONE;
+  IGNORE_RETURN_VALUE (FirmwareUpdate_GetPhaseTiming (&PhaseTiming));
+  Phase = (PhaseTiming.unCurrentPhase < UPDATE_PHASE_COUNT) ? (UINT8)PhaseTiming.unCurrentPhase : BMC_TELEMETRY_PHASE_NONE;
+
+  if ((Phase == mBmcTelemetryPhase) &&
+      (Platform_TicksToMicroseconds (Platform_GetTicks () - mBmcTelemetryPostTicks) < (UINT64)PcdGet32 (PcdIfxTpmBmcTelemetryIntervalMs) * 1000))
+  {
+    return;
+  }
+
+  BmcTelemetryPost (BMC_TELEMETRY_RECORD_PROGRESS, Completion, 0);
+}
+
+/**
+  Progress callback of the firmware update while the BMC telemetry sink is
+  open. Posts a progress record if it is due and forwards the progress to the
+  progress callback of SetImage.
+
+  @param[in]  Completion  Completion of the firmware update in percent.
+
+  @return  Status returned by the progress callback of SetImage.
+
+**/
+STATIC
+EFI_STATUS
+EFIAPI
+BmcTelemetryProgressCallback (
+  IN UINTN  Completion
+  )
+{
+  BmcTelemetryProgress (Completion);
+  return mBmcTelemetryForward (Completion);
+}
+
+/**
+  Route the progress of the firmware update through the BMC telemetry sink.
+
+  @param[in]  Progress  Progress callback of SetImage.
+
+  @return  BmcTelemetryProgressCallback if the sink is open, Progress otherwise.
+
+**/
+STATIC
+EFI_FIRMWARE_MANAGEMENT_UPDATE_IMAGE_PROGRESS
+BmcTelemetryHookProgress (
+  IN EFI_FIRMWARE_MANAGEMENT_UPDATE_IMAGE_PROGRESS  Progress
+  )
+{
+  if (mBmcTelemetryIpmi == NULL) {
+    return Progress;
+  }
+
+  mBmcTelemetryForward = Progress;
+  return BmcTelemetryProgressCallback;
+}
+
+/**
+  Post the result record of a firmware update to the BMC and close the sink.
+
+  @param[in]  Success            TRUE if the firmware update succeeded.
+  @param[in]  LastAttemptStatus  LAST_ATTEMPT_STATUS_* value of the firmware update.
+
+**/
+STATIC
+VOID
+BmcTelemetryStop (
+  IN BOOLEAN  Success,
+  IN UINT32   LastAttemptStatus
+  )
+{
+  if (mBmcTelemetryIpmi == NULL) {
+    return;
+  }
+
+  BmcTelemetryPost (BMC_TELEMETRY_RECORD_RESULT, Success ? 100 : mBmcTelemetryCompletion, LastAttemptStatus);
+  mBmcTelemetryIpmi = NULL;
+}
+
+/**
+  Render the firmware update progress and re-arm the watchdog timer.
+
+  @param[in]  Completion  A value between 0 and 100 indicating the current
                           completion progress of the firmware update
 
   @retval EFI_SUCESS             The capsule update progress was updated.
-  @retval EFI_INVALID_PARAMETER  Completion is greater than 100%.
 
 **/
+STATIC
 EFI_STATUS
-EFIAPI
-UpdateImageProgress (
+UpdateImageProgressRender (
   IN UINTN  Completion
   )
 {
-  EFI_STATUS                           Status;
   UINTN                                Seconds;
   EFI_GRAPHICS_OUTPUT_BLT_PIXEL_UNION  *Color;
 
   DEBUG ((DEBUG_INFO, "Update Progress - %llu%%\n", Completion));
 
-  if (Completion > 100) {
-    return EFI_INVALID_PARAMETER;
-  }
-
   //
   // Use a default timeout of 5 minutes
   //
@@ -73,23 +341,645 @@ UpdateImageProgress (
       DEBUG ((DEBUG_VERBOSE, "Arm watchdog timer %llu seconds\n", Seconds));
       gBS->SetWatchdogTimer (Seconds, 0x0000, 0, NULL);
     }
-  }
-
-  Status = DisplayUpdateProgress (Completion, Color);
+  }
+
+  mUpdateProgressRendered = Completion;
+
+  return DisplayUpdateProgress (Completion, Color);
+}
+
+/**
+  Timer notification rendering the last posted firmware update progress.
+  The watchdog timer is only re-armed if the progress has changed, so a
+  stalled update is still detected.
+
+  @param[in]  Event    The render timer event.
+  @param[in]  Context  Not used.
+
+**/
+STATIC
+VOID
+EFIAPI
+UpdateImageProgressTimer (
+  IN EFI_EVENT  Event,
+  IN VOID       *Context
+  )
+{
+  UINTN  Completion;
+
+  Completion = mUpdateProgressPosted;
+  if (Completion != mUpdateProgressRendered) {
+    UpdateImageProgressRender (Completion);
+  }
+}
+
+/**
+  Start rendering the firmware update progress from a periodic timer, so
+  UpdateImageProgress only posts the value and returns immediately.
+  The progress is rendered synchronously if the timer cannot be created.
+
+**/
+STATIC
+VOID
+UpdateImageProgressStart (
+  VOID
+  )
+{
+  EFI_STATUS  Status;
+
+  mUpdateProgressPosted   = 0;
+  mUpdateProgressRendered = (UINTN)-1;
+
+  Status = gBS->CreateEvent (
+                  EVT_TIMER | EVT_NOTIFY_SIGNAL,
+                  TPL_CALLBACK,
+                  UpdateImageProgressTimer,
+                  NULL,
+                  &mUpdateProgressEvent
+                  );
+  if (EFI_ERROR (Status)) {
+    mUpdateProgressEvent = NULL;
+    return;
+  }
+
+  Status = gBS->SetTimer (mUpdateProgressEvent, TimerPeriodic, UPDATE_PROGRESS_RENDER_PERIOD);
+  if (EFI_ERROR (Status)) {
+    gBS->CloseEvent (mUpdateProgressEvent);
+    mUpdateProgressEvent = NULL;
+  }
+}
+
+/**
+  Stop the render timer and render the last posted progress if the timer
+  has not done it yet.
+
+**/
+STATIC
+VOID
+UpdateImageProgressStop (
+  VOID
+  )
+{
+  if (mUpdateProgressEvent == NULL) {
+    return;
+  }
+
+  gBS->CloseEvent (mUpdateProgressEvent);
+  mUpdateProgressEvent = NULL;
+
+  if (mUpdateProgressPosted != mUpdateProgressRendered) {
+    UpdateImageProgressRender (mUpdateProgressPosted);
+  }
+}
+
+/**
+  Function indicate the current completion progress of the firmware
+  update. Platform may override with own specific progress function.
+
+  While the render timer is running the value is only posted and drawn
+  by the timer, which keeps the slow redraw off the firmware update loop.
+  The final value of 100 is always rendered immediately.
+
+  @param[in]  Completion  A value between 1 and 100 indicating the current
+                          completion progress of the firmware update
+
+  @retval EFI_SUCESS             The capsule update progress was updated.
+  @retval EFI_INVALID_PARAMETER  Completion is greater than 100%.
+
+**/
+EFI_STATUS
+EFIAPI
+UpdateImageProgress (
+  IN UINTN  Completion
+  )
+{
+  EFI_STATUS  Status;
+  EFI_TPL     OldTpl;
+
+  if (Completion > 100) {
+    return EFI_INVALID_PARAMETER;
+  }
+
+  mUpdateProgressPosted = Completion;
+  if ((mUpdateProgressEvent != NULL) && (Completion != 100)) {
+    return EFI_SUCCESS;
+  }
+
+  //
+  // Do not race with the render timer
+  //
+  OldTpl = gBS->RaiseTPL (TPL_CALLBACK);
+  Status = UpdateImageProgressRender (Completion);
+  gBS->RestoreTPL (OldTpl);
+
+  return Status;
+}
+
+/// Predefined image version, one per TPM instance
+CHAR16 gwszVersionName[DEVICE_MANAGEMENT_MAX_INSTANCES][MAX_NAME];
+
+/// Name prefix of the non-volatile values holding the image information cache, followed by the image index
+#define IMAGE_INFO_CACHE_NAME_PREFIX L"IfxTpmImageInfo"
+/// Maximum length of a cached version name in characters (including the terminating zero)
+#define IMAGE_INFO_CACHE_VERSION_NAME_LENGTH 32
+
+/**
+ *  @brief      Image information cache entry
+ *  @details    Holds the descriptor fields computed by IFXTPMUpdate_FirmwareManagement_GetImageInfoInternal for one TPM
+ *              instance in the non-volatile platform storage. The entry is valid as long as the interface registers of
+ *              the TPM return the same identification. It is deleted by SetImage before the TPM firmware is touched.
+ */
+typedef struct tdIMAGE_INFO_CACHE_ENTRY
+{
+    /// Size of the structure, detects entries written by a different driver version
+    UINT32 unStructSize;
+    /// Identification of the TPM the entry was computed for
+    TPM_INTERFACE_INFO sInterfaceInfo;
+    /// AttributesSetting describing the TPM firmware (without the attributes derived from the counters)
+    UINT64 ullAttributesSetting;
+    /// Remaining firmware updates (see FirmwareUpdate_GetImageInfo)
+    UINT32 unRemainingUpdates;
+    /// Remaining firmware updates of the TPM2.0 firmware update loader (see FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf)
+    UINT32 unRemainingUpdatesSelf;
+    /// VersionName of the descriptor
+    CHAR16 wszVersionName[IMAGE_INFO_CACHE_VERSION_NAME_LENGTH];
+} IMAGE_INFO_CACHE_ENTRY;
+
+/**
+ *  @brief      Builds the name of the image information cache entry of a TPM instance
+ *  @details
+ *
+ *  @param      PbImageIndex        Image index of the TPM instance starting with 1.
+ *  @param      PwszName            Buffer receiving the name.
+ *  @param      PunNameCapacity     Capacity of PwszName in characters.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from Platform_StringFormat.
+ */
+static
+unsigned int
+IFXTPMUpdate_FirmwareManagement_GetImageInfoCacheName(
+    _In_                            UINT8           PbImageIndex,
+    _Out_z_cap_(PunNameCapacity)    wchar_t*        PwszName,
+    _In_                            unsigned int    PunNameCapacity)
+{
+    return Platform_StringFormat(PwszName, &PunNameCapacity, L"%ls%d", IMAGE_INFO_CACHE_NAME_PREFIX, PbImageIndex);
+}
+
+/**
+ *  @brief      Reads the image information cache entry of the selected TPM instance
+ *  @details    The entry is only returned if the interface registers of the TPM still return the identification the
+ *              entry was computed for. Reading the registers does not send a TPM command.
+ *
+ *  @param      PbImageIndex        Image index of the TPM instance starting with 1.
+ *  @param      PpsEntry            Receives the cache entry.
+ *
+ *  @retval     TRUE                The entry is valid for the TPM.
+ *  @retval     FALSE               There is no valid entry, the descriptor must be computed.
+ */
+static
+BOOL
+IFXTPMUpdate_FirmwareManagement_ReadImageInfoCache(
+    _In_    UINT8                       PbImageIndex,
+    _Out_   IMAGE_INFO_CACHE_ENTRY*     PpsEntry)
+{
+    wchar_t wszName[MAX_NAME];
+    unsigned int unSize = sizeof(*PpsEntry);
+    TPM_INTERFACE_INFO sInterfaceInfo;
+
+    Platform_MemorySet(wszName, 0, sizeof(wszName));
+    Platform_MemorySet(PpsEntry, 0, sizeof(*PpsEntry));
+    Platform_MemorySet(&sInterfaceInfo, 0, sizeof(sInterfaceInfo));
+
+    if (!FeaturePcdGet(PcdIfxTpmImageInfoCache))
+        return FALSE;
+    if (RC_SUCCESS != IFXTPMUpdate_FirmwareManagement_GetImageInfoCacheName(PbImageIndex, wszName, RG_LEN(wszName)))
+        return FALSE;
+    if (RC_SUCCESS != Platform_NvStoreRead(wszName, PpsEntry, &unSize) || sizeof(*PpsEntry) != unSize || sizeof(*PpsEntry) != PpsEntry->unStructSize)
+        return FALSE;
+
+    // The registers of a replay trace or an unresponsive TPM cannot confirm the entry
+    if (RC_SUCCESS != DeviceManagement_GetInterfaceInfo(&sInterfaceInfo) || TPM_INTERFACE_FAMILY_UNKNOWN == sInterfaceInfo.bFamily)
+        return FALSE;
+    if (0 != Platform_MemoryCompare(&sInterfaceInfo, &PpsEntry->sInterfaceInfo, sizeof(sInterfaceInfo)))
+    {
+        LOGGING_WRITE_LEVEL2_FMT(L"Image information cache of TPM instance %d does not match the TPM.", PbImageIndex);
+        return FALSE;
+    }
+
+    PpsEntry->wszVersionName[RG_LEN(PpsEntry->wszVersionName) - 1] = L'\0';
+    return TRUE;
+}
+
+/**
+ *  @brief      Writes or deletes the image information cache entry of the selected TPM instance
+ *  @details    The cache is informational, a failure to write it is only logged.
+ *
+ *  @param      PbImageIndex            Image index of the TPM instance starting with 1.
+ *  @param      PullAttributesSetting   AttributesSetting describing the TPM firmware.
+ *  @param      PunRemainingUpdates     Remaining firmware updates.
+ *  @param      PunRemainingUpdatesSelf Remaining firmware updates of the TPM2.0 firmware update loader.
+ *  @param      PwszVersionName         VersionName of the descriptor or NULL to delete the entry.
+ */
+static
+void
+IFXTPMUpdate_FirmwareManagement_WriteImageInfoCache(
+    _In_        UINT8           PbImageIndex,
+    _In_        UINT64          PullAttributesSetting,
+    _In_        UINT32          PunRemainingUpdates,
+    _In_        UINT32          PunRemainingUpdatesSelf,
+    _In_opt_z_  const CHAR16*   PwszVersionName)
+{
+    wchar_t wszName[MAX_NAME];
+    unsigned int unReturnValue = RC_E_FAIL;
+    IMAGE_INFO_CACHE_ENTRY sEntry;
+
+    Platform_MemorySet(wszName, 0, sizeof(wszName));
+    Platform_MemorySet(&sEntry, 0, sizeof(sEntry));
+
+    if (!FeaturePcdGet(PcdIfxTpmImageInfoCache))
+        return;
+    if (RC_SUCCESS != IFXTPMUpdate_FirmwareManagement_GetImageInfoCacheName(PbImageIndex, wszName, RG_LEN(wszName)))
+        return;
+
+    if (NULL == PwszVersionName)
+    {
+        unReturnValue = Platform_NvStoreWrite(wszName, NULL, 0);
+    }
+    else
+    {
+        unsigned int unCapacity = RG_LEN(sEntry.wszVersionName);
+        sEntry.unStructSize = sizeof(sEntry);
+        sEntry.ullAttributesSetting = PullAttributesSetting;
+        sEntry.unRemainingUpdates = PunRemainingUpdates;
+        sEntry.unRemainingUpdatesSelf = PunRemainingUpdatesSelf;
+        if (RC_SUCCESS != DeviceManagement_GetInterfaceInfo(&sEntry.sInterfaceInfo) || TPM_INTERFACE_FAMILY_UNKNOWN == sEntry.sInterfaceInfo.bFamily)
+            return;
+        if (RC_SUCCESS != Platform_StringCopy(sEntry.wszVersionName, &unCapacity, PwszVersionName))
+            return;
+        unReturnValue = Platform_NvStoreWrite(wszName, &sEntry, sizeof(sEntry));
+    }
+
+    if (RC_SUCCESS != unReturnValue)
+        LOGGING_WRITE_LEVEL2_FMT(L"Platform_NvStoreWrite(%ls) failed (0x%.8X).", wszName, unReturnValue);
+}
+
+/// Name prefix of the non-volatile values holding the outcome of the last firmware update, followed by the image index
+#define LAST_ATTEMPT_NAME_PREFIX L"IfxTpmLastAttempt"
+
+/**
+ *  @brief      Last attempt entry
+ *  @details    Holds the outcome of the last firmware update of one TPM instance in the non-volatile platform storage. It is
+ *              written by SetImage and reported in LastAttemptVersion and LastAttemptStatus of the descriptor, which the ESRT
+ *              takes over for capsule based updates.
+ */
+typedef struct tdLAST_ATTEMPT_ENTRY
+{
+    /// Size of the structure, detects entries written by a different driver version
+    UINT32 unStructSize;
+    /// ESRT version of the target firmware of the image (see IFXTPMUpdate_FirmwareManagement_GetEsrtVersion)
+    UINT32 unVersion;
+    /// LAST_ATTEMPT_STATUS_* value
+    UINT32 unStatus;
+} LAST_ATTEMPT_ENTRY;
+
+/**
+ *  @brief      Converts a TPM firmware version name to the 32 bit version of the descriptor
+ *  @details    The ESRT compares firmware versions as unsigned 32 bit integers. The version is packed as
+ *              (Major << 24) | (Minor << 16) | Build, e.g. "7.85.4555.0" results in 0x075511CB. Major and minor are
+ *              saturated at 0xFF, the build number of TPM firmware versions is below 0x8000.
+ *
+ *  @param      PwszVersionName     Version name, e.g. "7.85.4555.0".
+ *  @param      PunCapacity         Capacity of PwszVersionName in characters.
+ *
+ *  @returns    Packed version or 0 if the version name is no numeric tuple.
+ */
+static
+UINT32
+IFXTPMUpdate_FirmwareManagement_GetEsrtVersion(
+    _In_z_count_(PunCapacity)   const CHAR16*   PwszVersionName,
+    _In_                        unsigned int    PunCapacity)
+{
+    const unsigned long long ullMask = (1ull << VERSION_COMPONENT_BITS) - 1;
+    unsigned long long ullVersion = 0;
+    unsigned int unLength = 0;
+
+    if (RC_SUCCESS != Platform_StringGetLength(PwszVersionName, PunCapacity, &unLength) ||
+            !FirmwareImage_ParseVersion(PwszVersionName, unLength, &ullVersion))
+        return 0;
+
+    return (UINT32)(MIN(ullVersion & ullMask, 0xFF) << 24) |
+           (UINT32)(MIN((ullVersion >> VERSION_COMPONENT_BITS) & ullMask, 0xFF) << 16) |
+           (UINT32)((ullVersion >> (2 * VERSION_COMPONENT_BITS)) & ullMask);
+}
+
+/**
+ *  @brief      Reads the outcome of the last firmware update of a TPM instance
+ *  @details
+ *
+ *  @param      PbImageIndex        Image index of the TPM instance starting with 1.
+ *  @param      PpunVersion         Receives the ESRT version of the last attempted image (0 if there was no attempt).
+ *  @param      PpunStatus          Receives the LAST_ATTEMPT_STATUS_* value (LAST_ATTEMPT_STATUS_SUCCESS if there was no attempt).
+ */
+static
+void
+IFXTPMUpdate_FirmwareManagement_ReadLastAttempt(
+    _In_    UINT8       PbImageIndex,
+    _Out_   UINT32*     PpunVersion,
+    _Out_   UINT32*     PpunStatus)
+{
+    wchar_t wszName[MAX_NAME];
+    unsigned int unCapacity = RG_LEN(wszName);
+    unsigned int unSize = 0;
+    LAST_ATTEMPT_ENTRY sEntry;
+
+    Platform_MemorySet(wszName, 0, sizeof(wszName));
+    Platform_MemorySet(&sEntry, 0, sizeof(sEntry));
+    unSize = sizeof(sEntry);
+
+    *PpunVersion = 0;
+    *PpunStatus = LAST_ATTEMPT_STATUS_SUCCESS;
+
+    if (RC_SUCCESS != Platform_StringFormat(wszName, &unCapacity, L"%ls%d", LAST_ATTEMPT_NAME_PREFIX, PbImageIndex))
+        return;
+    if (RC_SUCCESS != Platform_NvStoreRead(wszName, &sEntry, &unSize) || sizeof(sEntry) != unSize || sizeof(sEntry) != sEntry.unStructSize)
+        return;
+
+    *PpunVersion = sEntry.unVersion;
+    *PpunStatus = sEntry.unStatus;
+}
+
+/**
+ *  @brief      Maps the status returned by SetImage to the LastAttemptStatus of the descriptor
+ *  @details
+ *
+ *  @param      PefiStatus          Status returned by SetImage.
+ *
+ *  @returns    LAST_ATTEMPT_STATUS_* value.
+ */
+static
+UINT32
+IFXTPMUpdate_FirmwareManagement_GetLastAttemptStatus(
+    _In_    EFI_STATUS  PefiStatus)
+{
+    if (!EFI_ERROR(PefiStatus))
+        return LAST_ATTEMPT_STATUS_SUCCESS;
+    if (EFI_IFXTPM_CORRUPT_FIRMWARE_IMAGE == PefiStatus || EFI_IFXTPM_WRONG_FIRMWARE_IMAGE == PefiStatus || EFI_INVALID_PARAMETER == PefiStatus)
+        return LAST_ATTEMPT_STATUS_ERROR_INVALID_FORMAT;
+    if (EFI_IFXTPM_NEWER_DRIVER_REQUIRED == PefiStatus || EFI_IFXTPM_NEWER_FW_IMAGE_REQUIRED == PefiStatus || EFI_IFXTPM_NO_MORE_UPDATES == PefiStatus)
+        return LAST_ATTEMPT_STATUS_ERROR_INCORRECT_VERSION;
+    if (EFI_IFXTPM_TPM12_MISSING_OWNERAUTH == PefiStatus || EFI_IFXTPM_TPM12_INVALID_OWNERAUTH == PefiStatus ||
+            EFI_IFXTPM_TPM20_INVALID_POLICYSESSION == PefiStatus || EFI_IFXTPM_TPM20_POLICYSESSION_NOT_LOADED == PefiStatus ||
+            EFI_IFXTPM_TPM20_POLICY_HANDLE_OUT_OF_RANGE == PefiStatus || EFI_IFXTPM_TPM20_PLATFORMAUTH_NOT_EMPTYBUFFER == PefiStatus ||
+            EFI_IFXTPM_TPM20_PLATFORMHIERARCHY_DISABLED == PefiStatus)
+        return LAST_ATTEMPT_STATUS_ERROR_AUTH_ERROR;
+    if (EFI_OUT_OF_RESOURCES == PefiStatus)
+        return LAST_ATTEMPT_STATUS_ERROR_INSUFFICIENT_RESOURCES;
+    return LAST_ATTEMPT_STATUS_ERROR_UNSUCCESSFUL;
+}
+
+/**
+ *  @brief      Records the outcome of a firmware update of a TPM instance
+ *  @details    The target version is taken from the image header. The record is informational, a failure to write it is
+ *              only logged.
+ *
+ *  @param      PbImageIndex        Image index of the TPM instance starting with 1.
+ *  @param      PrgbImage           Firmware image passed to SetImage.
+ *  @param      PullImageSize       Size of the firmware image in bytes.
+ *  @param      PefiStatus          Status returned by SetImage.
+ */
+static
+void
+IFXTPMUpdate_FirmwareManagement_WriteLastAttempt(
+    _In_                            UINT8       PbImageIndex,
+    _In_bytecount_(PullImageSize)   const BYTE* PrgbImage,
+    _In_                            UINTN       PullImageSize,
+    _In_                            EFI_STATUS  PefiStatus)
+{
+    wchar_t wszName[MAX_NAME];
+    unsigned int unCapacity = RG_LEN(wszName);
+    unsigned int unReturnValue = RC_E_FAIL;
+    LAST_ATTEMPT_ENTRY sEntry;
+    IfxFirmwareImage sFirmwareImage;
+
+    Platform_MemorySet(wszName, 0, sizeof(wszName));
+    Platform_MemorySet(&sEntry, 0, sizeof(sEntry));
+    Platform_MemorySet(&sFirmwareImage, 0, sizeof(sFirmwareImage));
+
+    if (RC_SUCCESS != Platform_StringFormat(wszName, &unCapacity, L"%ls%d", LAST_ATTEMPT_NAME_PREFIX, PbImageIndex))
+        return;
+
+    // Take the target version from the image header, a corrupt header results in version 0
+    {
+        BYTE* pbBuffer = (BYTE*)PrgbImage;
+        int nBufferSize = (int)MIN(PullImageSize, 0x7FFFFFFF);
+        if (RC_SUCCESS == FirmwareImage_Unmarshal(&sFirmwareImage, &pbBuffer, &nBufferSize))
+            sEntry.unVersion = IFXTPMUpdate_FirmwareManagement_GetEsrtVersion(sFirmwareImage.wszTargetVersion, RG_LEN(sFirmwareImage.wszTargetVersion));
+    }
+
+    sEntry.unStatus = IFXTPMUpdate_FirmwareManagement_GetLastAttemptStatus(PefiStatus);
+    sEntry.unStructSize = sizeof(sEntry);
+
+    unReturnValue = Platform_NvStoreWrite(wszName, &sEntry, sizeof(sEntry));
+    if (RC_SUCCESS != unReturnValue)
+        LOGGING_WRITE_LEVEL2_FMT(L"Platform_NvStoreWrite(%ls) failed (0x%.8X).", wszName, unReturnValue);
+}
+
+/**
+ *  @brief      Returns information about the current firmware image of the selected TPM instance (internal).
+ *  @details    Fills one EFI_FIRMWARE_IMAGE_DESCRIPTOR as described for @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo.
+ *              The TPM instance must be selected with DeviceManagement_SelectInstance before.
+ *
+ *  @param      PbImageIndex                Image index of the TPM instance starting with 1.
+ *  @param      PpImageInfo                 A pointer to the descriptor to fill.
+ *  @param      PwszVersionName             A pointer to the buffer receiving the version name. The descriptor refers to this buffer.
+ *  @param      PunVersionNameCapacity      Capacity of PwszVersionName in characters.
+ *
+ *  @retval     EFI_SUCCESS                         The operation completed successfully.
+ *  @retval     EFI_IFXTPM_UNSUPPORTED_CHIP         The Infineon TPM chip detected is not supported by the driver. The descriptor is filled nevertheless.
+ *  @retval     ...                                 Error codes as described for @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo. The descriptor is not filled.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_FirmwareManagement_GetImageInfoInternal(
+    IN      UINT8                               PbImageIndex,
+    OUT     EFI_FIRMWARE_IMAGE_DESCRIPTOR*      PpImageInfo,
+    OUT     CHAR16*                             PwszVersionName,
+    IN      unsigned int                        PunVersionNameCapacity)
+{
+    EFI_STATUS efiStatus = EFI_SUCCESS;
+
+    do
+    {
+        unsigned int unCapacity = PunVersionNameCapacity;
+        unsigned int unRemainingUpdates = REMAINING_UPDATES_UNAVAILABLE; // -1
+        unsigned int unRemainingUpdatesSelf = REMAINING_UPDATES_UNAVAILABLE; // -1
+        unsigned long long ullAttributesSetting = 0;
+        BOOL fCacheable = FALSE;
+        IMAGE_INFO_CACHE_ENTRY sCacheEntry;
+
+        // Answer from the image information cache if the TPM has not changed since it was written
+        if (IFXTPMUpdate_FirmwareManagement_ReadImageInfoCache(PbImageIndex, &sCacheEntry))
+        {
+            if (RC_SUCCESS != Platform_StringCopy(PwszVersionName, &unCapacity, sCacheEntry.wszVersionName))
+            {
+                efiStatus = EFI_DEVICE_ERROR;
+                break;
+            }
+            LOGGING_WRITE_LEVEL2_FMT(L"Image information of TPM instance %d taken from the cache.", PbImageIndex);
+            ullAttributesSetting = sCacheEntry.ullAttributesSetting;
+            unRemainingUpdates = sCacheEntry.unRemainingUpdates;
+            unRemainingUpdatesSelf = sCacheEntry.unRemainingUpdatesSelf;
+        }
+        // Get Image Info
+        else
+        {
+            TPM_STATE sTpmState;
+            unsigned int unReturnValue = RC_E_FAIL;
+            Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+            unReturnValue = FirmwareUpdate_GetImageInfo(PwszVersionName, &unCapacity, &sTpmState, &unRemainingUpdates);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                switch (unReturnValue)
+                {
+                    case RC_E_NO_IFX_TPM:
+                        efiStatus = EFI_IFXTPM_UNSUPPORTED_VENDOR;
+                        break;
+                    case RC_E_UNSUPPORTED_CHIP:
+                        efiStatus = EFI_IFXTPM_UNSUPPORTED_CHIP;
+                        break;
+                    case RC_E_BAD_PARAMETER:
+                        efiStatus = EFI_INVALID_PARAMETER;
+                        break;
+                    case RC_TPM_MASK|TSS_TPM_DEACTIVATED:
+                        efiStatus = EFI_IFXTPM_TPM12_DEACTIVATED;
+                        break;
+                    case RC_TPM_MASK|TSS_TPM_DISABLED:
+                        efiStatus = EFI_IFXTPM_TPM12_DISABLED;
+                        break;
+                    default:
+                        efiStatus = EFI_DEVICE_ERROR;
+                        break;
+                }
+                if (RC_E_UNSUPPORTED_CHIP != unReturnValue)
+                    break;
+            }
+            else if (sTpmState.attribs.tpm20InFailureMode)
+            {
+                efiStatus = EFI_IFXTPM_TPM20_FAILURE_MODE;
+                break;
+            }
+            else if (sTpmState.attribs.tpm12FailedSelfTest)
+            {
+                efiStatus = EFI_IFXTPM_TPM12_FAILED_SELFTEST;
+                break;
+            }
+            else
+            {
+                if(sTpmState.attribs.tpmHasFULoader20)
+                {
+                    unReturnValue = FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf(&unRemainingUpdatesSelf);
+                    if (RC_SUCCESS != unReturnValue)
+                    {
+                        efiStatus = EFI_DEVICE_ERROR;
+                        break;
+                    }
+                }
+
+                ullAttributesSetting |= sTpmState.attribs.tpm12 ? IMAGE_ATTRIBUTE_IFXTPM_1_2 : 0;
+                ullAttributesSetting |= sTpmState.attribs.tpm20 ? IMAGE_ATTRIBUTE_IFXTPM_2_0 : 0;
+                ullAttributesSetting |= sTpmState.attribs.tpm20restartRequired ? IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED : 0;
+                ullAttributesSetting |= sTpmState.attribs.tpm12owner ? IMAGE_ATTRIBUTE_IFXTPM_HAS_OWNER : 0;
+                ullAttributesSetting |= sTpmState.attribs.tpm12DeferredPhysicalPresence ? IMAGE_ATTRIBUTE_IFXTPM_DEFERREDPP : 0;
+                if (sTpmState.attribs.tpmHasFULoader20)
+                    ullAttributesSetting |= !sTpmState.attribs.tpmInOperationalMode ? IMAGE_ATTRIBUTE_IFXTPM_NON_OPERATIONAL_MODE : 0;
+                else
+                    ullAttributesSetting |= !sTpmState.attribs.tpmFirmwareIsValid ? IMAGE_ATTRIBUTE_IFXTPM_INVALID_FIRMWARE_MODE : 0;
+
+                // Only a TPM2.0 in operational mode is cached. TPM1.2 ownership and physical presence settings may
+                // change outside of this driver.
+                fCacheable = sTpmState.attribs.tpm20 && sTpmState.attribs.tpmInOperationalMode && !sTpmState.attribs.tpm20restartRequired;
+            }
+
+            // Cache the result once the counters are available
+            if (fCacheable && REMAINING_UPDATES_UNAVAILABLE != MIN(unRemainingUpdates, unRemainingUpdatesSelf))
+                IFXTPMUpdate_FirmwareManagement_WriteImageInfoCache(PbImageIndex, ullAttributesSetting, unRemainingUpdates, unRemainingUpdatesSelf, PwszVersionName);
+        }
+
+        // Set attributes according to number of remaining updates
+        ullAttributesSetting |= IMAGE_ATTRIBUTE_IN_USE | IMAGE_ATTRIBUTE_RESET_REQUIRED;
+
+        // Get effective counter value (no more updates are possible if one of the counter is zero)
+        UINT32 unEffectiveCounter = MIN(unRemainingUpdates, unRemainingUpdatesSelf);
+        switch (unEffectiveCounter)
+        {
+            case 0:
+                // No more updates possible
+                break;
+            case 1:
+                // 1 update possible
+                ullAttributesSetting |= IMAGE_ATTRIBUTE_IMAGE_UPDATABLE | IMAGE_ATTRIBUTE_IFXTPM_LAST_UPDATE;
+                break;
+            case REMAINING_UPDATES_UNAVAILABLE: // -1
+                // counter not available, restart required
+                ullAttributesSetting |= IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED;
+                break;
+            default:
+                // More than 1 update possible
+                ullAttributesSetting |= IMAGE_ATTRIBUTE_IMAGE_UPDATABLE;
+                break;
+        }
+
+        // Fill out parameters
+        {
+            const EFI_GUID guid = EFI_IFXTPM_FIRMWARE_TYPE_GUID;
+
+            // Index of the TPM instance starting with 1
+            PpImageInfo->ImageIndex = PbImageIndex;
+            // Must be set to EFI_IFXTPM_FIRMWARE_TYPE_GUID
+            CopyGuid(&PpImageInfo->ImageTypeId, &guid);
+            // Must be set to 0
+            PpImageInfo->ImageId = 0;
+            // Must be set to NULL
+            PpImageInfo->ImageIdName = (CHAR16*) NULL;
+            // Numeric form of VersionName, reported as FwVersion in the ESRT
+            PpImageInfo->Version = IFXTPMUpdate_FirmwareManagement_GetEsrtVersion(PwszVersionName, PunVersionNameCapacity);
+            // A pointer to a null-terminated string representing the firmware image version name.
+            PpImageInfo->VersionName = PwszVersionName;
+            // Size of the image in bytes. If size=0, then only ImageIndex and ImageTypeId are valid.
+            PpImageInfo->Size = 0;
+            // Must include all supported attributes
+            PpImageInfo->AttributesSupported = IMAGE_ATTRIBUTE_IMAGE_UPDATABLE | IMAGE_ATTRIBUTE_RESET_REQUIRED | IMAGE_ATTRIBUTE_IN_USE | IMAGE_ATTRIBUTE_IFXTPM_LAST_UPDATE |
+                                               IMAGE_ATTRIBUTE_IFXTPM_HAS_OWNER | IMAGE_ATTRIBUTE_IFXTPM_INVALID_FIRMWARE_MODE | IMAGE_ATTRIBUTE_IFXTPM_2_0 | IMAGE_ATTRIBUTE_IFXTPM_1_2 | IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED |
+                                               IMAGE_ATTRIBUTE_IFXTPM_DEFERREDPP;
+            PpImageInfo->AttributesSetting = ullAttributesSetting;
+            // Must be set to IMAGE_COMPATIBILITY_CHECK_SUPPORTED
+            PpImageInfo->Compatibilities = IMAGE_COMPATIBILITY_CHECK_SUPPORTED;
+            // Must be set to 0. Describes the lowest ImageDescriptor version that the device will accept. Only present in version 2 or higher.
+            PpImageInfo->LowestSupportedImageVersion = 0;
+            // Outcome of the last SetImage call. Only present in version 3 or higher.
+            IFXTPMUpdate_FirmwareManagement_ReadLastAttempt(PbImageIndex, &PpImageInfo->LastAttemptVersion, &PpImageInfo->LastAttemptStatus);
+            // Must be set to 0. Only present in version 3 or higher.
+            PpImageInfo->HardwareInstance = 0;
+            // Must be set to NULL. Only present in version 4 or higher.
+            PpImageInfo->Dependencies = NULL;
+        }
+        if (EFI_IFXTPM_UNSUPPORTED_CHIP != efiStatus)
+            efiStatus = EFI_SUCCESS;
+    }
+    WHILE_FALSE_END;
 
-  return Status;
+    return efiStatus;
 }
 
-/// Predefined image version
-CHAR16 gwszVersionName[MAX_NAME];
-
 /**
  *  @brief      Returns information about the current firmware image of the TPM.
  *  @details    The function returns a EFI_FIRMWARE_IMAGE_DESCRIPTOR in PpImageInfo which contains information about the current firmware image on the TPM.
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
  *  @param      PpullImageInfoSize          A pointer to the size, in bytes, of the PpImageInfo buffer.
- *  @param      PpImageInfo                 A pointer to the buffer in which firmware places the current image information. IFXTPMUpdate returns 1 EFI_FIRMWARE_IMAGE_DESCRIPTOR.
+ *  @param      PpImageInfo                 A pointer to the buffer in which firmware places the current image information. IFXTPMUpdate returns one EFI_FIRMWARE_IMAGE_DESCRIPTOR per TPM instance.
  *                                          The relevant parameters are:
  *                                          - ImageTypeId = EFI_IFXTPM_FIRMWARE_TYPE_GUID
  *                                          - VersionName = TPM version information as Unicode string. The pattern is (Major).(Minor).(SubversionMinor) and an example value would be 4.40.119.0. The string is allocated statically by IFXTPMUpdate, memory will be invalidated at next call to @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo or at unload of IFXTPMUpdate. Memory does not need to be freed by the caller.
@@ -119,15 +1009,19 @@ CHAR16 gwszVersionName[MAX_NAME];
  *                                              <tr><td>IMAGE_ATTRIBUTE_RESET_REQUIRED | IMAGE_ATTRIBUTE_IN_USE</td><td>The currently active TPM firmware image is in use. After updating the TPM firmware a reset is required so that the new firmware becomes active.</td></tr>
  *                                              </table>\n
  *                                          Further parameters (required to be compliant with EFI_FIRMWARE_MANAGEMENT_PROTOCOL):
- *                                          - ImageIndex = 1
+ *                                          - ImageIndex = Index of the TPM instance starting with 1
  *                                          - ImageId = 0
  *                                          - ImageIdName = NULL
- *                                          - Version = 0
+ *                                          - Version = VersionName packed as (Major << 24) | (Minor << 16) | Build (reported as FwVersion in the ESRT)
  *                                          - Size = 0
  *                                          - Compatibilities = 0
  *                                          - LowestSupportedImageVersion = 0
- *  @param      PpunDescriptorVersion       A pointer to the location in which firmware returns the version number associated with the EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION (2).
- *  @param      PpbDescriptorCount          A pointer to the location in which firmware returns the number of descriptors or firmware images within this device. IFXTPMUpdate returns 1.
+ *                                          - LastAttemptVersion = Target version of the image passed to the last SetImage call (packed like Version), 0 if there was none
+ *                                          - LastAttemptStatus = LAST_ATTEMPT_STATUS_* value describing the outcome of the last SetImage call
+ *                                          - HardwareInstance = 0
+ *                                          - Dependencies = NULL
+ *  @param      PpunDescriptorVersion       A pointer to the location in which firmware returns the version number associated with the EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION.
+ *  @param      PpbDescriptorCount          A pointer to the location in which firmware returns the number of descriptors or firmware images within this device. IFXTPMUpdate returns the number of TPM instances.
  *  @param      PpullDescriptorSize         A pointer to the location in which firmware returns the size, in bytes, of an individual EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR).
  *  @param      PpunPackageVersion          A version number that represents all the firmware images in the device. The format is vendor specific. IFXTPMUpdate returns 0xFFFFFFFF (not supported).
  *  @param      PppPackageVersionName       A pointer to a null-terminated string representing the package version name. IFXTPMUpdate returns NULL.
@@ -136,6 +1030,8 @@ CHAR16 gwszVersionName[MAX_NAME];
  *  @retval     EFI_BUFFER_TOO_SMALL                The ImageInfo buffer was too small. The current buffer size needed to hold the image(s) information is returned in PpImageInfoSize.
  *  @retval     EFI_DEVICE_ERROR                    Valid information could not be returned. This error may occur if the communication with the TPM failed.
  *  @retval     EFI_INVALID_PARAMETER               PpullImageInfoSize is NULL.
+ *  @retval     EFI_TIMEOUT                         The query deadline (see EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID) elapsed. PpbDescriptorCount
+ *                                                  returns the number of descriptors filled before, which may be 0.
  *  @retval     EFI_IFXTPM_TPM12_DEACTIVATED        The TPM is deactivated. It needs to be activated to retrieve TPM firmware information (TPM1.2 only).
  *  @retval     EFI_IFXTPM_TPM12_DISABLED           The TPM is disabled. It needs to be enabled to retrieve TPM firmware information (TPM1.2 only).
  *  @retval     EFI_IFXTPM_TPM12_FAILED_SELFTEST    The TPM1.2 failed the self-test.
@@ -156,14 +1052,18 @@ IFXTPMUpdate_FirmwareManagement_GetImageInfo(
     OUT     CHAR16**                            PppPackageVersionName)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_GET_IMAGE_INFO);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo()");
 
     do
     {
-        unsigned int unCapacity = RG_LEN(gwszVersionName);
-        unsigned int unRemainingUpdates = REMAINING_UPDATES_UNAVAILABLE; // -1
-        unsigned int unRemainingUpdatesSelf = REMAINING_UPDATES_UNAVAILABLE; // -1
-        unsigned long long ullAttributesSetting = 0;
+        UINT8 bDescriptorCount = (UINT8)DeviceManagement_GetInstanceCount();
+        UINT8 bIndex = 0;
+        BOOL fUnsupportedChip = FALSE;
+
+        // Report one descriptor if no TPM instance was found, the error is returned from the TPM access
+        if (0 == bDescriptorCount)
+            bDescriptorCount = 1;
 
         // Check parameters
         if (NULL == PpThis || NULL == PpullImageInfoSize)
@@ -175,10 +1075,10 @@ IFXTPMUpdate_FirmwareManagement_GetImageInfo(
 
         // The function can be asked for the needed output structure size. In this case PpImageInfo may be NULL and PpullImageInfoSize points to a size
         // that is smaller then the used return structure. The function returns EFI_BUFFER_TOO_SMALL and puts the required size in PpullImageInfoSize.
-        if (*PpullImageInfoSize < sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR))
+        if (*PpullImageInfoSize < bDescriptorCount * sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR))
         {
             // This is not a real error, since the caller just wants to obtain the output structure size as defined
-            *PpullImageInfoSize = sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR);
+            *PpullImageInfoSize = bDescriptorCount * sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR);
             efiStatus = EFI_BUFFER_TOO_SMALL;
             break;
         }
@@ -200,142 +1100,55 @@ IFXTPMUpdate_FirmwareManagement_GetImageInfo(
             break;
         }
 
-        efiStatus = InitializeTpmAccess();
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
         if (EFI_ERROR(efiStatus))
             break;
 
-        // Get Image Info
+        // Fill one descriptor per TPM instance
+        for (bIndex = 0; bIndex < bDescriptorCount; bIndex++)
         {
-            TPM_STATE sTpmState;
-            unsigned int unReturnValue = RC_E_FAIL;
-            Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
-
-            unReturnValue = FirmwareUpdate_GetImageInfo(gwszVersionName, &unCapacity, &sTpmState, &unRemainingUpdates);
+            EFI_STATUS efiStatusDescriptor = EFI_SUCCESS;
+            unsigned int unReturnValue = DeviceManagement_SelectInstance(bIndex);
             if (RC_SUCCESS != unReturnValue)
             {
-                switch (unReturnValue)
-                {
-                    case RC_E_NO_IFX_TPM:
-                        efiStatus = EFI_IFXTPM_UNSUPPORTED_VENDOR;
-                        break;
-                    case RC_E_UNSUPPORTED_CHIP:
-                        efiStatus = EFI_IFXTPM_UNSUPPORTED_CHIP;
-                        break;
-                    case RC_E_BAD_PARAMETER:
-                        efiStatus = EFI_INVALID_PARAMETER;
-                        break;
-                    case RC_TPM_MASK|TSS_TPM_DEACTIVATED:
-                        efiStatus = EFI_IFXTPM_TPM12_DEACTIVATED;
-                        break;
-                    case RC_TPM_MASK|TSS_TPM_DISABLED:
-                        efiStatus = EFI_IFXTPM_TPM12_DISABLED;
-                        break;
-                    default:
-                        efiStatus = EFI_DEVICE_ERROR;
-                        break;
-                }
-                if (RC_E_UNSUPPORTED_CHIP != unReturnValue)
-                    break;
-            }
-            else if (sTpmState.attribs.tpm20InFailureMode)
-            {
-                efiStatus = EFI_IFXTPM_TPM20_FAILURE_MODE;
+                efiStatus = EFI_DEVICE_ERROR;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error selecting TPM instance %d. (0x%.8X)", bIndex, unReturnValue);
                 break;
             }
-            else if (sTpmState.attribs.tpm12FailedSelfTest)
+
+            efiStatusDescriptor = IFXTPMUpdate_FirmwareManagement_GetImageInfoInternal(bIndex + 1, &PpImageInfo[bIndex], gwszVersionName[bIndex], RG_LEN(gwszVersionName[bIndex]));
+            if (EFI_IFXTPM_UNSUPPORTED_CHIP == efiStatusDescriptor)
+                fUnsupportedChip = TRUE;
+            else if (EFI_ERROR(efiStatusDescriptor))
             {
-                efiStatus = EFI_IFXTPM_TPM12_FAILED_SELFTEST;
+                efiStatus = efiStatusDescriptor;
                 break;
             }
-            else
-            {
-                if(sTpmState.attribs.tpmHasFULoader20)
-                {
-                    unReturnValue = FirmwareUpdate_GetTpm20FieldUpgradeCounterSelf(&unRemainingUpdatesSelf);
-                    if (RC_SUCCESS != unReturnValue)
-                    {
-                        efiStatus = EFI_DEVICE_ERROR;
-                        break;
-                    }
-                }
-
-                ullAttributesSetting |= sTpmState.attribs.tpm12 ? IMAGE_ATTRIBUTE_IFXTPM_1_2 : 0;
-                ullAttributesSetting |= sTpmState.attribs.tpm20 ? IMAGE_ATTRIBUTE_IFXTPM_2_0 : 0;
-                ullAttributesSetting |= sTpmState.attribs.tpm20restartRequired ? IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED : 0;
-                ullAttributesSetting |= sTpmState.attribs.tpm12owner ? IMAGE_ATTRIBUTE_IFXTPM_HAS_OWNER : 0;
-                ullAttributesSetting |= sTpmState.attribs.tpm12DeferredPhysicalPresence ? IMAGE_ATTRIBUTE_IFXTPM_DEFERREDPP : 0;
-                if (sTpmState.attribs.tpmHasFULoader20)
-                    ullAttributesSetting |= !sTpmState.attribs.tpmInOperationalMode ? IMAGE_ATTRIBUTE_IFXTPM_NON_OPERATIONAL_MODE : 0;
-                else
-                    ullAttributesSetting |= !sTpmState.attribs.tpmFirmwareIsValid ? IMAGE_ATTRIBUTE_IFXTPM_INVALID_FIRMWARE_MODE : 0;
-            }
         }
-
-        // Set attributes according to number of remaining updates
-        ullAttributesSetting |= IMAGE_ATTRIBUTE_IN_USE | IMAGE_ATTRIBUTE_RESET_REQUIRED;
-
-        // Get effective counter value (no more updates are possible if one of the counter is zero)
-        UINT32 unEffectiveCounter = MIN(unRemainingUpdates, unRemainingUpdatesSelf);
-        switch (unEffectiveCounter)
+        if (EFI_ERROR(efiStatus))
         {
-            case 0:
-                // No more updates possible
-                break;
-            case 1:
-                // 1 update possible
-                ullAttributesSetting |= IMAGE_ATTRIBUTE_IMAGE_UPDATABLE | IMAGE_ATTRIBUTE_IFXTPM_LAST_UPDATE;
-                break;
-            case REMAINING_UPDATES_UNAVAILABLE: // -1
-                // counter not available, restart required
-                ullAttributesSetting |= IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED;
-                break;
-            default:
-                // More than 1 update possible
-                ullAttributesSetting |= IMAGE_ATTRIBUTE_IMAGE_UPDATABLE;
+            // If the query deadline elapsed, the descriptors filled before are returned
+            efiStatus = MapQueryDeadlineStatus(efiStatus);
+            if (EFI_TIMEOUT != efiStatus)
                 break;
+            bDescriptorCount = bIndex;
         }
 
         // Fill out parameters
-        *PpullImageInfoSize = sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR);
-        {
-            const EFI_GUID guid = EFI_IFXTPM_FIRMWARE_TYPE_GUID;
-
-            // Must be set to 1
-            PpImageInfo->ImageIndex = 1;
-            // Must be set to EFI_IFXTPM_FIRMWARE_TYPE_GUID
-            CopyGuid(&PpImageInfo->ImageTypeId, &guid);
-            // Must be set to 0
-            PpImageInfo->ImageId = 0;
-            // Must be set to NULL
-            PpImageInfo->ImageIdName = (CHAR16*) NULL;
-            // Must be set to 1
-            PpImageInfo->Version = 0;
-            // A pointer to a null-terminated string representing the firmware image version name.
-            PpImageInfo->VersionName = gwszVersionName;
-            // Size of the image in bytes. If size=0, then only ImageIndex and ImageTypeId are valid.
-            PpImageInfo->Size = 0;
-            // Must include all supported attributes
-            PpImageInfo->AttributesSupported = IMAGE_ATTRIBUTE_IMAGE_UPDATABLE | IMAGE_ATTRIBUTE_RESET_REQUIRED | IMAGE_ATTRIBUTE_IN_USE | IMAGE_ATTRIBUTE_IFXTPM_LAST_UPDATE |
-                                               IMAGE_ATTRIBUTE_IFXTPM_HAS_OWNER | IMAGE_ATTRIBUTE_IFXTPM_INVALID_FIRMWARE_MODE | IMAGE_ATTRIBUTE_IFXTPM_2_0 | IMAGE_ATTRIBUTE_IFXTPM_1_2 | IMAGE_ATTRIBUTE_IFXTPM_RESTART_REQUIRED |
-                                               IMAGE_ATTRIBUTE_IFXTPM_DEFERREDPP;
-            PpImageInfo->AttributesSetting = ullAttributesSetting;
-            // Must be set to IMAGE_COMPATIBILITY_CHECK_SUPPORTED
-            PpImageInfo->Compatibilities = IMAGE_COMPATIBILITY_CHECK_SUPPORTED;
-            // Must be set to 0. Describes the lowest ImageDescriptor version that the device will accept. Only present in version 2 or higher.
-            PpImageInfo->LowestSupportedImageVersion = 0;
-            // Must be set to EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION
-            *PpunDescriptorVersion = EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION;
-            // Must be set to 1
-            *PpbDescriptorCount = 1;
-            // Must be set to sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR)
-            *PpullDescriptorSize = *PpullImageInfoSize;
-            // PackageVersion/Name is not supported. Must be set to 0xFFFFFFFF
-            *PpunPackageVersion = 0xFFFFFFFF;
-            // Must be set to NULL
-            *PppPackageVersionName = (CHAR16*) NULL;
-        }
-        if (EFI_IFXTPM_UNSUPPORTED_CHIP != efiStatus)
-            efiStatus = EFI_SUCCESS;
+        *PpullImageInfoSize = bDescriptorCount * sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR);
+        // Must be set to EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION
+        *PpunDescriptorVersion = EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION;
+        // One descriptor per TPM instance
+        *PpbDescriptorCount = bDescriptorCount;
+        // Must be set to sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR)
+        *PpullDescriptorSize = sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR);
+        // PackageVersion/Name is not supported. Must be set to 0xFFFFFFFF
+        *PpunPackageVersion = 0xFFFFFFFF;
+        // Must be set to NULL
+        *PppPackageVersionName = (CHAR16*) NULL;
+
+        if (EFI_TIMEOUT != efiStatus)
+            efiStatus = fUnsupportedChip ? EFI_IFXTPM_UNSUPPORTED_CHIP : EFI_SUCCESS;
     }
     WHILE_FALSE_END;
 
@@ -343,6 +1156,8 @@ IFXTPMUpdate_FirmwareManagement_GetImageInfo(
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_GET_IMAGE_INFO);
+
     return efiStatus;
 }
 
@@ -535,22 +1350,101 @@ IFXTPMUpdate_FirmwareManagement_ProgressCallback(
     return EFI_SUCCESS;
 }
 
+/**
+ *  @brief      Maps the result of a firmware update to the status returned by SetImage
+ *  @details
+ *
+ *  @param      PunReturnValue          Result of FirmwareUpdate_UpdateImage or of the firmware update engine.
+ *
+ *  @returns    The EFI status of SetImage for the result.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(
+    IN  UINT32  PunReturnValue)
+{
+    EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
+
+    switch (PunReturnValue)
+    {
+        case RC_SUCCESS:
+            efiStatus = EFI_SUCCESS;
+            break;
+        case RC_E_BAD_PARAMETER:
+            efiStatus = EFI_INVALID_PARAMETER;
+            break;
+        case RC_E_TPM20_INVALID_POLICY_SESSION:
+            efiStatus = EFI_IFXTPM_TPM20_INVALID_POLICYSESSION;
+            break;
+        case RC_E_TPM20_POLICY_SESSION_NOT_LOADED:
+            efiStatus = EFI_IFXTPM_TPM20_POLICYSESSION_NOT_LOADED;
+            break;
+        case RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE:
+            efiStatus = EFI_IFXTPM_TPM20_POLICY_HANDLE_OUT_OF_RANGE;
+            break;
+        case RC_E_FIRMWARE_UPDATE_FAILED:
+            efiStatus = EFI_IFXTPM_FIRMWARE_UPDATE_FAILED;
+            break;
+        case RC_E_CORRUPT_FW_IMAGE:
+            efiStatus = EFI_IFXTPM_CORRUPT_FIRMWARE_IMAGE;
+            break;
+        case RC_E_TPM12_MISSING_OWNERAUTH:
+            efiStatus = EFI_IFXTPM_TPM12_MISSING_OWNERAUTH;
+            break;
+        case RC_E_TPM12_DA_ACTIVE:
+            efiStatus = EFI_IFXTPM_TPM12_DA_ACTIVE;
+            break;
+        case RC_E_TPM12_INVALID_OWNERAUTH:
+            efiStatus = EFI_IFXTPM_TPM12_INVALID_OWNERAUTH;
+            break;
+        case RC_E_TPM12_DEFERREDPP_REQUIRED:
+            efiStatus = EFI_IFXTPM_TPM12_DEFERREDPP_REQUIRED;
+            break;
+        case RC_E_TPM12_NO_OWNER:
+            efiStatus = EFI_IFXTPM_TPM12_NO_OWNER;
+            break;
+        case RC_E_WRONG_FW_IMAGE:
+            efiStatus = EFI_IFXTPM_WRONG_FIRMWARE_IMAGE;
+            break;
+        case RC_E_FW_UPDATE_BLOCKED:
+            efiStatus = EFI_IFXTPM_NO_MORE_UPDATES;
+            break;
+        case RC_E_NO_IFX_TPM:
+            efiStatus = EFI_IFXTPM_UNSUPPORTED_VENDOR;
+            break;
+        case RC_E_RESTART_REQUIRED:
+            efiStatus = EFI_IFXTPM_RESTART_REQUIRED;
+            break;
+        case RC_E_NOT_READY:
+            efiStatus = EFI_NOT_READY;
+            break;
+        case RC_E_UPDATE_CANCELED:
+            efiStatus = EFI_ABORTED;
+            break;
+        default:
+            efiStatus = EFI_DEVICE_ERROR;
+            break;
+    }
+
+    return efiStatus;
+}
+
 /**
  *  @brief      Updates the firmware of the TPM.
  *  @details    This function performs the actual TPM Firmware Update. To ensure successful execution respectively proper error handling, it also performs the firmware image checks of @ref IFXTPMUpdate_FirmwareManagement_CheckImage again prior to updating the firmware.
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
- *  @param      PbImageIndex                Must be set to 1.
+ *  @param      PbImageIndex                Image index of the TPM instance (ImageIndex of the descriptor returned by @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo).
  *  @param      PpImage                     A pointer to the binary contents of a TPM firmware image file or NULL for abandoning an update.
  *  @param      PullImageSize               Size of the TPM firmware image file in bytes or zero for abandoning an update.
- *  @param      PpVendorCode                IFXTPMUpdate does not support vendor-specific firmware image update policy. The pointer must be set to NULL by the caller.
+ *  @param      PpVendorCode                NULL or a pointer to an EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1 structure passing the TPM2.0 policy session handle.
  *  @param      PfnProgress                 A callback function used by the driver to report the progress of the firmware update.
  *                                          The progress value is in range from 0 to 100 and shows the completion percentage of the TPM Firmware Update.
  *  @param      PppAbortReason              A pointer to a null-terminated string providing more details for the aborted operation. IFXTPMUpdate does not support abort reasons and sets the pointer to NULL always.
  *
  *  @retval     EFI_SUCCESS                                     The device was successfully updated with the new image.
  *  @retval     EFI_DEVICE_ERROR                                The communication with the TPM failed.
- *  @retval     EFI_INVALID_PARAMETER                           PpThis or PpImage was NULL or PbImageIndex was != 1 or PullImageSize was 0 or PpVendorCode was != NULL.
+ *  @retval     EFI_INVALID_PARAMETER                           PpThis or PpImage was NULL or PbImageIndex was no valid image index or PullImageSize was 0 or PpVendorCode has an unsupported version.
  *  @retval     EFI_IFXTPM_CORRUPT_FIRMWARE_IMAGE               The image is corrupt.
  *  @retval     EFI_IFXTPM_FIRMWARE_UPDATE_FAILED               The update operation was started but failed.
  *  @retval     EFI_IFXTPM_NEWER_DRIVER_REQUIRED                A newer version of the driver is required to process the firmware image.
@@ -585,6 +1479,10 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
     OUT CHAR16**                                        PppAbortReason)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    BOOL fDiscardPolicySession = FALSE;
+    BOOL fUpdateAttempted = FALSE;
+    const EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1* pVendorCode = (const EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1*)PpVendorCode;
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_SET_IMAGE);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage()");
 
     do
@@ -592,13 +1490,31 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
         unsigned int unReturnValue = RC_E_FAIL;
 
         // Check input parameters
-        if (NULL == PpThis || 1 != PbImageIndex || NULL != PpVendorCode)
+        if (NULL == PpThis || 0 == PbImageIndex || PbImageIndex > MAX(DeviceManagement_GetInstanceCount(), 1))
         {
             efiStatus = EFI_INVALID_PARAMETER;
             LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetImage: at least one mandatory parameter is NULL or invalid. (0x%.16lX)", efiStatus);
             break;
         }
 
+        // The vendor code passes the policy session handle without a separate SetInformation() call. Only the handle type
+        // is checked here, the session itself is validated by the TPM when the update is started.
+        if (NULL != pVendorCode)
+        {
+            if (EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_VERSION_1 != pVendorCode->Version)
+            {
+                efiStatus = EFI_INVALID_PARAMETER;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetImage: unsupported VendorCode version %d. (0x%.16lX)", pVendorCode->Version, efiStatus);
+                break;
+            }
+            if (0 != pVendorCode->SessionHandle && TSS_TPM_HT_POLICY_SESSION != (pVendorCode->SessionHandle >> TSS_HR_SHIFT))
+            {
+                efiStatus = EFI_IFXTPM_TPM20_POLICY_HANDLE_OUT_OF_RANGE;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error: 0x%.8X is no policy session handle. (0x%.16lX)", pVendorCode->SessionHandle, efiStatus);
+                break;
+            }
+        }
+
 #ifdef STRICT_PARAM_CHECK_SETIMAGE
         if (NULL == PfnProgress || NULL == PppAbortReason)
         {
@@ -615,18 +1531,38 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
         if (NULL != PppAbortReason)
             *PppAbortReason = (CHAR16*)NULL;
 
-        efiStatus = InitializeTpmAccess();
+        // Status queries scheduled during the update wait until the firmware transfer has finished
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_UPDATE);
         if (EFI_ERROR(efiStatus))
             break;
 
+        // Select the TPM instance of the image index
+        {
+            unsigned int unReturnValueSelect = DeviceManagement_SelectInstance(PbImageIndex - 1);
+            if (RC_SUCCESS != unReturnValueSelect)
+            {
+                efiStatus = EFI_DEVICE_ERROR;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error selecting TPM instance %d. (0x%.8X)", PbImageIndex - 1, unReturnValueSelect);
+                break;
+            }
+        }
+
+        // The firmware version and counters change from here on, GetImageInfo must query the TPM again
+        IFXTPMUpdate_FirmwareManagement_WriteImageInfoCache(PbImageIndex, 0, 0, 0, NULL);
+
+        if (NULL != pVendorCode)
+            g_pPrivateData->unSessionHandle = pVendorCode->SessionHandle;
+
         // Abort of firmware update or recovery mode requested?
         if (NULL == PpImage && 0 == PullImageSize)
         {
-            // Get TPM state
+            // Get the operation mode, determine the full TPM state only if it cannot be read directly
             TPM_STATE sTpmState;
             Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
 
-            unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+            unReturnValue = FirmwareUpdate_GetOperationMode(&sTpmState);
+            if (RC_SUCCESS != unReturnValue)
+                unReturnValue = FirmwareUpdate_CalculateState(FALSE, &sTpmState);
             if (RC_SUCCESS != unReturnValue)
             {
                 efiStatus = EFI_DEVICE_ERROR;
@@ -663,49 +1599,115 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
                 LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in SetImage: at least one mandatory parameter is NULL or invalid. (0x%.16lX)", efiStatus);
                 break;
             }
+            fUpdateAttempted = TRUE;
 
-            efiStatus = IFXTPMUpdate_FirmwareManagement_CheckImageInternal((BYTE*)PpImage, PullImageSize, NULL);
-            if (EFI_ERROR(efiStatus))
-                break;
-
-            if (g_pPrivateData->unSessionHandle == 0)
+            // The default policy session on TPM2.0 is started before the image is checked. The TPM starts the session
+            // while the CRC and the signature of the image are verified on the host.
             {
-                // Get TPM state
-                TPM_STATE sTpmState;
-                Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
-
-                unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+                EFI_STATUS efiPolicyStatus = EFI_SUCCESS;
+                BOOL fPolicyPending = FALSE;
+                BOOL fIntact = FALSE;
+                unsigned int unIntegrityDetails = RC_E_CORRUPT_FW_IMAGE;
+
+                // Calculate the checksums of the image on an application processor while the TPM state is read and
+                // the policy session is started
+                FirmwareUpdate_PhaseTimingReset();
+                FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+                BmcTelemetryStart(PbImageIndex);
+                FirmwareUpdate_StartImageIntegrityCheck((BYTE*)PpImage, PullImageSize);
+
+                // A policy session kept from a previous attempt is checked with a single command and reused, a new one is
+                // only started below if the TPM does not hold it anymore
+                FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_POLICY);
+                unReturnValue = FirmwareUpdate_ReuseTPM20Policy(&g_pPrivateData->unSessionHandle);
                 if (RC_SUCCESS != unReturnValue)
                 {
                     efiStatus = EFI_DEVICE_ERROR;
                     break;
                 }
+                // A reused session is closed like a new one if the image is rejected
+                if (0 != g_pPrivateData->unSessionHandle && FirmwareUpdate_GetRetainedTPM20Policy() == g_pPrivateData->unSessionHandle)
+                    fDiscardPolicySession = TRUE;
 
-                // Prepare the default policy session on TPM2.0 (only possible within operational mode)
-                if (sTpmState.attribs.tpm20 && sTpmState.attribs.tpmInOperationalMode)
+                if (g_pPrivateData->unSessionHandle == 0)
                 {
-                    unsigned int unPolicySession = 0;
-                    unReturnValue = FirmwareUpdate_PrepareTPM20Policy(&unPolicySession);
-                    switch (unReturnValue)
+                    // Get TPM state
+                    TPM_STATE sTpmState;
+                    Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+                    FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_STATE);
+                    unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+                    if (RC_SUCCESS != unReturnValue)
                     {
-                        case RC_SUCCESS:
-                            efiStatus = EFI_SUCCESS;
-                            break;
-                        case RC_E_PLATFORM_AUTH_NOT_EMPTY:
-                            efiStatus = EFI_IFXTPM_TPM20_PLATFORMAUTH_NOT_EMPTYBUFFER;
-                            break;
-                        case RC_E_PLATFORM_HIERARCHY_DISABLED:
-                            efiStatus = EFI_IFXTPM_TPM20_PLATFORMHIERARCHY_DISABLED;
-                            break;
-                        default:
-                            efiStatus = EFI_DEVICE_ERROR;
-                            break;
-                    }
-                    if (EFI_ERROR(efiStatus))
+                        efiStatus = EFI_DEVICE_ERROR;
                         break;
+                    }
+
+                    // Start the default policy session on TPM2.0 (only possible within operational mode). All other
+                    // TPM states are rejected by IFXTPMUpdate_FirmwareManagement_CheckImageInternal below.
+                    if (sTpmState.attribs.tpm20 && sTpmState.attribs.tpmInOperationalMode && sTpmState.attribs.infineon &&
+                            !sTpmState.attribs.tpm20restartRequired && !sTpmState.attribs.tpm20InFailureMode)
+                    {
+                        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_POLICY);
+                        unReturnValue = FirmwareUpdate_BeginTPM20Policy();
+                        switch (unReturnValue)
+                        {
+                            case RC_SUCCESS:
+                                efiPolicyStatus = EFI_SUCCESS;
+                                fPolicyPending = TRUE;
+                                break;
+                            case RC_E_PLATFORM_AUTH_NOT_EMPTY:
+                                efiPolicyStatus = EFI_IFXTPM_TPM20_PLATFORMAUTH_NOT_EMPTYBUFFER;
+                                break;
+                            case RC_E_PLATFORM_HIERARCHY_DISABLED:
+                                efiPolicyStatus = EFI_IFXTPM_TPM20_PLATFORMHIERARCHY_DISABLED;
+                                break;
+                            default:
+                                efiPolicyStatus = EFI_DEVICE_ERROR;
+                                break;
+                        }
+                    }
+                }
+
+                // Verify CRC and signature of the image, this does not send any command to the TPM
+                FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+                unReturnValue = FirmwareUpdate_VerifyImageIntegrity((BYTE*)PpImage, PullImageSize, &fIntact, &unIntegrityDetails);
+                if (RC_SUCCESS != unReturnValue)
+                {
+                    LOGGING_WRITE_LEVEL2_FMT(L"Unexpected error calling FirmwareUpdate_VerifyImageIntegrity: (0x%.8lX)", unReturnValue);
+                    fIntact = FALSE;
+                    efiStatus = EFI_DEVICE_ERROR;
+                }
 
-                    g_pPrivateData->unSessionHandle = unPolicySession;
+                // Complete the policy session, it is not needed if the image is not intact
+                if (fPolicyPending)
+                {
+                    unsigned int unPolicySession = 0;
+                    FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_POLICY);
+                    unReturnValue = FirmwareUpdate_CompleteTPM20Policy(!fIntact, &unPolicySession);
+                    if (RC_SUCCESS != unReturnValue)
+                        efiPolicyStatus = EFI_DEVICE_ERROR;
+                    else if (0 != unPolicySession)
+                    {
+                        g_pPrivateData->unSessionHandle = unPolicySession;
+                        fDiscardPolicySession = TRUE;
+                    }
                 }
+                if (EFI_ERROR(efiStatus))
+                    break;
+
+                // Check the image against the TPM, the integrity check above is not repeated
+                FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+                efiStatus = IFXTPMUpdate_FirmwareManagement_CheckImageInternal((BYTE*)PpImage, PullImageSize, NULL);
+                if (EFI_ERROR(efiStatus))
+                    break;
+
+                efiStatus = efiPolicyStatus;
+                if (EFI_ERROR(efiStatus))
+                    break;
+
+                // Keep the policy session for the update
+                fDiscardPolicySession = FALSE;
             }
 
             {
@@ -713,7 +1715,7 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
                 ZeroMem(&sFirmwareUpdateData, sizeof(sFirmwareUpdateData));
                 sFirmwareUpdateData.rgbFirmwareImage = (BYTE*) PpImage;
                 sFirmwareUpdateData.unFirmwareImageSize = (unsigned int)PullImageSize;
-                sFirmwareUpdateData.fnProgressCallback = (PFN_FIRMWAREUPDATE_PROGRESSCALLBACK) PfnProgress;
+                sFirmwareUpdateData.fnProgressCallback = (PFN_FIRMWAREUPDATE_PROGRESSCALLBACK) BmcTelemetryHookProgress(PfnProgress);
                 sFirmwareUpdateData.unSessionHandle = g_pPrivateData->unSessionHandle;
                 if (g_pPrivateData->fOwnedUpdate)
                 {
@@ -725,54 +1727,18 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
                     if (RC_SUCCESS != unReturnValue)
                         break;
                     sFirmwareUpdateData.fOwnerAuthProvided = TRUE;
+                    // The checks of SetInformation() are only reused for the first update attempt
+                    sFirmwareUpdateData.fOwnerAuthVerified = g_pPrivateData->fOwnerAuthVerified;
+                    g_pPrivateData->fOwnerAuthVerified = FALSE;
                 }
 
-                // Call firmware update
+                // Call firmware update, the progress is rendered by a timer meanwhile
+                UpdateImageProgressStart();
                 unReturnValue = FirmwareUpdate_UpdateImage(&sFirmwareUpdateData);
+                UpdateImageProgressStop();
 
                 // Evaluate the return code
-                switch (unReturnValue)
-                {
-                    case RC_SUCCESS:
-                        efiStatus = EFI_SUCCESS;
-                        break;
-                    case RC_E_BAD_PARAMETER:
-                        efiStatus = EFI_INVALID_PARAMETER;
-                        break;
-                    case RC_E_TPM20_INVALID_POLICY_SESSION:
-                        efiStatus = EFI_IFXTPM_TPM20_INVALID_POLICYSESSION;
-                        break;
-                    case RC_E_TPM20_POLICY_SESSION_NOT_LOADED:
-                        efiStatus = EFI_IFXTPM_TPM20_POLICYSESSION_NOT_LOADED;
-                        break;
-                    case RC_E_TPM20_POLICY_HANDLE_OUT_OF_RANGE:
-                        efiStatus = EFI_IFXTPM_TPM20_POLICY_HANDLE_OUT_OF_RANGE;
-                        break;
-                    case RC_E_FIRMWARE_UPDATE_FAILED:
-                        efiStatus = EFI_IFXTPM_FIRMWARE_UPDATE_FAILED;
-                        break;
-                    case RC_E_CORRUPT_FW_IMAGE:
-                        efiStatus = EFI_IFXTPM_CORRUPT_FIRMWARE_IMAGE;
-                        break;
-                    case RC_E_TPM12_MISSING_OWNERAUTH:
-                        efiStatus = EFI_IFXTPM_TPM12_MISSING_OWNERAUTH;
-                        break;
-                    case RC_E_TPM12_DA_ACTIVE:
-                        efiStatus = EFI_IFXTPM_TPM12_DA_ACTIVE;
-                        break;
-                    case RC_E_TPM12_INVALID_OWNERAUTH:
-                        efiStatus = EFI_IFXTPM_TPM12_INVALID_OWNERAUTH;
-                        break;
-                    case RC_E_TPM12_DEFERREDPP_REQUIRED:
-                        efiStatus = EFI_IFXTPM_TPM12_DEFERREDPP_REQUIRED;
-                        break;
-                    case RC_E_TPM12_NO_OWNER:
-                        efiStatus = EFI_IFXTPM_TPM12_NO_OWNER;
-                        break;
-                    default:
-                        efiStatus = EFI_DEVICE_ERROR;
-                        break;
-                }
+                efiStatus = IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(unReturnValue);
                 if (EFI_ERROR(efiStatus))
                     break;
             }
@@ -782,10 +1748,30 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
     }
     WHILE_FALSE_END;
 
+    // Close a policy session started for an image that has been rejected
+    if (fDiscardPolicySession)
+    {
+        FirmwareUpdate_FlushTPM20Policy(g_pPrivateData->unSessionHandle);
+        g_pPrivateData->unSessionHandle = 0;
+    }
+
+    // Do not return while the image is still read on an application processor
+    FirmwareUpdate_WaitImageIntegrityCheck();
+    FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_NONE);
+
+    // Record the outcome for LastAttemptVersion and LastAttemptStatus of the descriptor (and the ESRT)
+    if (fUpdateAttempted)
+        IFXTPMUpdate_FirmwareManagement_WriteLastAttempt(PbImageIndex, (const BYTE*)PpImage, PullImageSize, efiStatus);
+
+    // Post the final status to the BMC, no-op if the telemetry sink is not open
+    BmcTelemetryStop(!EFI_ERROR(efiStatus), IFXTPMUpdate_FirmwareManagement_GetLastAttemptStatus(efiStatus));
+
     UninitializeTpmAccess();
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_SET_IMAGE);
+
     return efiStatus;
 }
 
@@ -795,7 +1781,7 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
  *              It allows firmware update application to validate the firmware image without invoking the SetImage() first.
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
- *  @param      PbImageIndex                Must be set to 1.
+ *  @param      PbImageIndex                Image index of the TPM instance (ImageIndex of the descriptor returned by @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo).
  *  @param      PpImage                     A pointer to the binary contents of a firmware image file.
  *                                          @cond !SHOW_INTERNAL @ref FirmwareImages describes the structure of this file. @endcond
  *  @param      PullImageSize               Size of the firmware image file in bytes.
@@ -816,7 +1802,8 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
  *
  *  @retval     EFI_SUCCESS                         The image was successfully checked.
  *  @retval     EFI_DEVICE_ERROR                    The communication with the TPM failed.
- *  @retval     EFI_INVALID_PARAMETER               PpThis or PpImage or PpunImageUpdatable was NULL or PbImageIndex was != 1 or PullImageSize was 0.
+ *  @retval     EFI_INVALID_PARAMETER               PpThis or PpImage or PpunImageUpdatable was NULL or PbImageIndex was no valid image index or PullImageSize was 0.
+ *  @retval     EFI_TIMEOUT                         The query deadline (see EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID) elapsed.
  *  @retval     EFI_IFXTPM_RESTART_REQUIRED         The system must be restarted before the firmware image can be verified.
  *  @retval     EFI_IFXTPM_TPM12_DEACTIVATED        The TPM is deactivated. It needs to be activated to check the firmware image (TPM1.2 only).
  *  @retval     EFI_IFXTPM_TPM12_DISABLED           The TPM is disabled. It needs to be enabled to check the firmware image (TPM1.2 only).
@@ -834,32 +1821,47 @@ IFXTPMUpdate_FirmwareManagement_CheckImage(
     OUT UINT32*                             PpunImageUpdatable)
 {
     EFI_STATUS efiStatus = EFI_SUCCESS;
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_CHECK_IMAGE);
     LOGGING_WRITE_LEVEL2(L"Entering EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage()");
 
     do
     {
         // Check input parameters
-        if (NULL == PpThis || NULL == PpImage || NULL == PpunImageUpdatable || 1 != PbImageIndex || 0 == PullImageSize)
+        if (NULL == PpThis || NULL == PpImage || NULL == PpunImageUpdatable || 0 == PbImageIndex || PbImageIndex > MAX(DeviceManagement_GetInstanceCount(), 1) || 0 == PullImageSize)
         {
             efiStatus = EFI_INVALID_PARAMETER;
             LOGGING_WRITE_LEVEL1_FMT(L"Error during input parameter check in CheckImage: at least one mandatory parameter is NULL or invalid. (0x%.16lX)", efiStatus);
             break;
         }
 
-        efiStatus = InitializeTpmAccess();
+        efiStatus = InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY);
         if (EFI_ERROR(efiStatus))
             break;
 
+        // Select the TPM instance of the image index
+        {
+            unsigned int unReturnValueSelect = DeviceManagement_SelectInstance(PbImageIndex - 1);
+            if (RC_SUCCESS != unReturnValueSelect)
+            {
+                efiStatus = EFI_DEVICE_ERROR;
+                LOGGING_WRITE_LEVEL1_FMT(L"Error selecting TPM instance %d. (0x%.8X)", PbImageIndex - 1, unReturnValueSelect);
+                break;
+            }
+        }
+
         efiStatus = IFXTPMUpdate_FirmwareManagement_CheckImageInternal((BYTE*)PpImage, PullImageSize, PpunImageUpdatable);
         if (EFI_ERROR(efiStatus))
             break;
     }
     WHILE_FALSE_END;
 
+    efiStatus = MapQueryDeadlineStatus(efiStatus);
     UninitializeTpmAccess();
 
     LOGGING_WRITE_LEVEL2_FMT(L"Exiting EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage(): (0x%.16lX)", efiStatus);
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_CHECK_IMAGE);
+
     return efiStatus;
 }
 
@@ -920,6 +1922,75 @@ IFXTPMUpdate_FirmwareManagement_SetPackageInfo(
 /// @cond SHOW_INTERNAL
 //-------------------------------------------------------------------------------------------------------
 
+/**
+ *  @brief      Starts the integrity check of a TPM firmware image delivered in an FMP capsule
+ *  @details    A capsule passed to UpdateCapsule with CAPSULE_FLAGS_PERSIST_ACROSS_RESET is coalesced in the PEI phase and
+ *              described by a capsule HOB. The capsule library of the platform processes it later in the DXE phase and
+ *              calls SetImage with a pointer into the coalesced capsule. The function looks for a payload with the update
+ *              image type EFI_IFXTPM_FIRMWARE_TYPE_GUID and starts the CRC and digest calculation of the image on an
+ *              application processor while the remaining DXE drivers are dispatched. SetImage takes the result from the
+ *              integrity cache because it is called with the same buffer, only the signature is verified on the digest. The image is neither copied nor modified.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_FirmwareManagement_PreVerifyCapsules()
+{
+    const EFI_GUID sImageTypeId = EFI_IFXTPM_FIRMWARE_TYPE_GUID;
+    EFI_PEI_HOB_POINTERS sHob;
+
+    for (sHob.Raw = GetFirstHob(EFI_HOB_TYPE_UEFI_CAPSULE); NULL != sHob.Raw; sHob.Raw = GetNextHob(EFI_HOB_TYPE_UEFI_CAPSULE, GET_NEXT_HOB(sHob)))
+    {
+        EFI_CAPSULE_HEADER* pCapsuleHeader = (EFI_CAPSULE_HEADER*)(UINTN)sHob.Capsule->BaseAddress;
+        EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER* pFmpHeader = NULL;
+        UINT64 ullFmpSize = 0;
+        UINT32 unItemCount = 0;
+        UINT32 unItem = 0;
+
+        // Check the capsule header against the HOB, the capsule is not trusted
+        if (sHob.Capsule->Length < sizeof(EFI_CAPSULE_HEADER) || !CompareGuid(&pCapsuleHeader->CapsuleGuid, &gEfiFmpCapsuleGuid) ||
+                pCapsuleHeader->CapsuleImageSize > sHob.Capsule->Length || pCapsuleHeader->HeaderSize >= pCapsuleHeader->CapsuleImageSize)
+            continue;
+        pFmpHeader = (EFI_FIRMWARE_MANAGEMENT_CAPSULE_HEADER*)((UINT8*)pCapsuleHeader + pCapsuleHeader->HeaderSize);
+        ullFmpSize = pCapsuleHeader->CapsuleImageSize - pCapsuleHeader->HeaderSize;
+        if (ullFmpSize < sizeof(*pFmpHeader))
+            continue;
+        unItemCount = (UINT32)pFmpHeader->EmbeddedDriverCount + pFmpHeader->PayloadItemCount;
+        if (sizeof(*pFmpHeader) + (UINT64)unItemCount * sizeof(UINT64) > ullFmpSize)
+            continue;
+
+        // The payload items follow the embedded drivers
+        for (unItem = pFmpHeader->EmbeddedDriverCount; unItem < unItemCount; unItem++)
+        {
+            UINT64 ullOffset = pFmpHeader->ItemOffsetList[unItem];
+            EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER* pImageHeader = NULL;
+            UINT64 ullImageHeaderSize = 0;
+
+            if (ullOffset >= ullFmpSize || ullFmpSize - ullOffset < OFFSET_OF(EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateHardwareInstance))
+                continue;
+            pImageHeader = (EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER*)((UINT8*)pFmpHeader + ullOffset);
+
+            // The size of the image header depends on its version, the image follows the header (as in the capsule library)
+            if (1 == pImageHeader->Version)
+                ullImageHeaderSize = OFFSET_OF(EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, UpdateHardwareInstance);
+            else if (2 == pImageHeader->Version)
+                ullImageHeaderSize = OFFSET_OF(EFI_FIRMWARE_MANAGEMENT_CAPSULE_IMAGE_HEADER, ImageCapsuleSupport);
+            else
+                ullImageHeaderSize = sizeof(*pImageHeader);
+
+            if (ullFmpSize - ullOffset < ullImageHeaderSize || !CompareGuid(&pImageHeader->UpdateImageTypeId, &sImageTypeId))
+                continue;
+            if (0 == pImageHeader->UpdateImageSize || ullFmpSize - ullOffset - ullImageHeaderSize < (UINT64)pImageHeader->UpdateImageSize)
+                continue;
+
+            LOGGING_WRITE_LEVEL2_FMT(L"TPM firmware image found in capsule (payload %d, %d bytes), starting the integrity check.", unItem, pImageHeader->UpdateImageSize);
+
+            // Only one integrity check runs at a time, further images are checked by SetImage
+            FirmwareUpdate_StartImageIntegrityCheck((BYTE*)pImageHeader + ullImageHeaderSize, pImageHeader->UpdateImageSize);
+            return;
+        }
+    }
+}
+
 /// The services provided by protocol for managing firmware.
 EFI_FIRMWARE_MANAGEMENT_PROTOCOL g_IFXTPMUpdateFirmwareManagement =
 {
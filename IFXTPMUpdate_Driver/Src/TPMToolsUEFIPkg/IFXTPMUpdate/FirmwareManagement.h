@@ -25,7 +25,7 @@
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
  *  @param      PpullImageInfoSize          A pointer to the size, in bytes, of the PpImageInfo buffer.
- *  @param      PpImageInfo                 A pointer to the buffer in which firmware places the current image information. IFXTPMUpdate returns 1 EFI_FIRMWARE_IMAGE_DESCRIPTOR.
+ *  @param      PpImageInfo                 A pointer to the buffer in which firmware places the current image information. IFXTPMUpdate returns one EFI_FIRMWARE_IMAGE_DESCRIPTOR per TPM instance.
  *                                          The relevant parameters are:
  *                                          - ImageTypeId = EFI_IFXTPM_FIRMWARE_TYPE_GUID
  *                                          - VersionName = TPM version information as Unicode string. The pattern is (Major).(Minor).(SubversionMinor) and an example value would be 4.40.119.0. The string is allocated statically by IFXTPMUpdate, memory will be invalidated at next call to @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo or at unload of IFXTPMUpdate. Memory does not need to be freed by the caller.
@@ -55,15 +55,19 @@
  *                                              <tr><td>IMAGE_ATTRIBUTE_RESET_REQUIRED | IMAGE_ATTRIBUTE_IN_USE</td><td>The currently active TPM firmware image is in use. After updating the TPM firmware a reset is required so that the new firmware becomes active.</td></tr>
  *                                              </table>\n
  *                                          Further parameters (required to be compliant with EFI_FIRMWARE_MANAGEMENT_PROTOCOL):
- *                                          - ImageIndex = 1
+ *                                          - ImageIndex = Index of the TPM instance starting with 1
  *                                          - ImageId = 0
  *                                          - ImageIdName = NULL
- *                                          - Version = 0
+ *                                          - Version = VersionName packed as (Major << 24) | (Minor << 16) | Build (reported as FwVersion in the ESRT)
  *                                          - Size = 0
  *                                          - Compatibilities = 0
  *                                          - LowestSupportedImageVersion = 0
- *  @param      PpunDescriptorVersion       A pointer to the location in which firmware returns the version number associated with the EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION (2).
- *  @param      PpbDescriptorCount          A pointer to the location in which firmware returns the number of descriptors or firmware images within this device. IFXTPMUpdate returns 1.
+ *                                          - LastAttemptVersion = Target version of the image passed to the last SetImage call (packed like Version), 0 if there was none
+ *                                          - LastAttemptStatus = LAST_ATTEMPT_STATUS_* value describing the outcome of the last SetImage call
+ *                                          - HardwareInstance = 0
+ *                                          - Dependencies = NULL
+ *  @param      PpunDescriptorVersion       A pointer to the location in which firmware returns the version number associated with the EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns EFI_FIRMWARE_IMAGE_DESCRIPTOR_VERSION.
+ *  @param      PpbDescriptorCount          A pointer to the location in which firmware returns the number of descriptors or firmware images within this device. IFXTPMUpdate returns the number of TPM instances.
  *  @param      PpullDescriptorSize         A pointer to the location in which firmware returns the size, in bytes, of an individual EFI_FIRMWARE_IMAGE_DESCRIPTOR. IFXTPMUpdate returns sizeof(EFI_FIRMWARE_IMAGE_DESCRIPTOR).
  *  @param      PpunPackageVersion          A version number that represents all the firmware images in the device. The format is vendor specific. IFXTPMUpdate returns 0xFFFFFFFF (not supported).
  *  @param      PppPackageVersionName       A pointer to a null-terminated string representing the package version name. IFXTPMUpdate returns NULL.
@@ -114,17 +118,17 @@ IFXTPMUpdate_FirmwareManagement_GetImage(
  *  @details    This function performs the actual TPM Firmware Update. To ensure successful execution respectively proper error handling, it also performs the firmware image checks of @ref IFXTPMUpdate_FirmwareManagement_CheckImage again prior to updating the firmware.
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
- *  @param      PbImageIndex                Must be set to 1.
+ *  @param      PbImageIndex                Image index of the TPM instance (ImageIndex of the descriptor returned by @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo).
  *  @param      PpImage                     A pointer to the binary contents of a TPM firmware image file or NULL for abandoning an update.
  *  @param      PullImageSize               Size of the TPM firmware image file in bytes or zero for abandoning an update.
- *  @param      PpVendorCode                IFXTPMUpdate does not support vendor-specific firmware image update policy. The pointer must be set to NULL by the caller.
+ *  @param      PpVendorCode                NULL or a pointer to an EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1 structure passing the TPM2.0 policy session handle.
  *  @param      PfnProgress                 A callback function used by the driver to report the progress of the firmware update.
  *                                          The progress value is in range from 0 to 100 and shows the completion percentage of the TPM Firmware Update.
  *  @param      PppAbortReason              A pointer to a null-terminated string providing more details for the aborted operation. IFXTPMUpdate does not support abort reasons and sets the pointer to NULL always.
  *
  *  @retval     EFI_SUCCESS                                     The device was successfully updated with the new image.
  *  @retval     EFI_DEVICE_ERROR                                The communication with the TPM failed.
- *  @retval     EFI_INVALID_PARAMETER                           PpThis or PpImage was NULL or PbImageIndex was != 1 or PullImageSize was 0 or PpVendorCode was != NULL.
+ *  @retval     EFI_INVALID_PARAMETER                           PpThis or PpImage was NULL or PbImageIndex was no valid image index or PullImageSize was 0 or PpVendorCode has an unsupported version.
  *  @retval     EFI_IFXTPM_CORRUPT_FIRMWARE_IMAGE               The image is corrupt.
  *  @retval     EFI_IFXTPM_FIRMWARE_UPDATE_FAILED               The update operation was started but failed.
  *  @retval     EFI_IFXTPM_NEWER_DRIVER_REQUIRED                A newer version of the driver is required to process the firmware image.
@@ -164,7 +168,7 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
  *              It allows firmware update application to validate the firmware image without invoking the SetImage() first.
  *
  *  @param      PpThis                      A pointer to the EFI_FIRMWARE_MANAGEMENT_PROTOCOL instance.
- *  @param      PbImageIndex                Must be set to 1.
+ *  @param      PbImageIndex                Image index of the TPM instance (ImageIndex of the descriptor returned by @ref IFXTPMUpdate_FirmwareManagement_GetImageInfo).
  *  @param      PpImage                     A pointer to the binary contents of a firmware image file.
  *                                          @cond !SHOW_INTERNAL @ref FirmwareImages describes the structure of this file. @endcond
  *  @param      PullImageSize               Size of the firmware image file in bytes.
@@ -185,7 +189,7 @@ IFXTPMUpdate_FirmwareManagement_SetImage(
  *
  *  @retval     EFI_SUCCESS                         The image was successfully checked.
  *  @retval     EFI_DEVICE_ERROR                    The communication with the TPM failed.
- *  @retval     EFI_INVALID_PARAMETER               PpThis or PpImage or PpunImageUpdatable was NULL or PbImageIndex was != 1 or PullImageSize was 0.
+ *  @retval     EFI_INVALID_PARAMETER               PpThis or PpImage or PpunImageUpdatable was NULL or PbImageIndex was no valid image index or PullImageSize was 0.
  *  @retval     EFI_IFXTPM_RESTART_REQUIRED         The system must be restarted before the firmware image can be verified.
  *  @retval     EFI_IFXTPM_TPM12_DEACTIVATED        The TPM is deactivated. It needs to be activated to check the firmware image (TPM1.2 only).
  *  @retval     EFI_IFXTPM_TPM12_DISABLED           The TPM is disabled. It needs to be enabled to check the firmware image (TPM1.2 only).
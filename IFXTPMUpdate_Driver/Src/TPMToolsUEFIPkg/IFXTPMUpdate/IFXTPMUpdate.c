@@ -16,6 +16,7 @@
 #include "StdInclude.h"
 #include "IFXTPMUpdateApp.h"
 #include "Crypt.h"
+#include "TpmReplay.h"
 
 /**
  *  @brief      Initialization of the external driver binding structure
@@ -30,6 +31,15 @@ EFI_DRIVER_BINDING_PROTOCOL g_IFXTPMUpdateDriverBinding = {
     NULL
 };
 
+/// Discovery protocol of the driver, ImageHandle is set by the entry point
+static EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL s_sDriverProtocol = {
+    EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_REVISION,
+    NULL
+};
+
+/// GUID of the discovery protocol
+static EFI_GUID s_guidDriverProtocol = EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_GUID;
+
 /**
  *  @brief      The user Entry Point for module IFXTPMUpdate.
  *  @details    The user code starts with this function.
@@ -50,6 +60,8 @@ IFXTPMUpdateEntryPoint(
 {
     EFI_STATUS efiStatus = EFI_UNSUPPORTED;
 
+    IFXTPMUPDATE_STACK_CHECK_ENTER(EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY);
+
     do
     {
         // Install driver model protocol(s).
@@ -66,21 +78,34 @@ IFXTPMUpdateEntryPoint(
         }
 
         // Install the TPM Firmware Management Protocol (and others) onto an existing handle.
+        s_sDriverProtocol.ImageHandle = PhImageHandle;
         efiStatus = gBS->InstallMultipleProtocolInterfaces(
                         &PhImageHandle,
                         &gEfiFirmwareManagementProtocolGuid,
                         &g_IFXTPMUpdateFirmwareManagement,
                         &gEfiAdapterInformationProtocolGuid,
                         &g_IFXTPMUpdateAdapterInformation,
+                        &s_guidDriverProtocol,
+                        &s_sDriverProtocol,
                         NULL);
         if (EFI_ERROR(efiStatus))
             break;
 
         // Initialize the driver
         efiStatus = IFXTPMUpdateInitialize();
+        if (EFI_ERROR(efiStatus))
+            break;
+
+        // Verify a TPM firmware image delivered in a capsule while the boot continues
+        IFXTPMUpdate_FirmwareManagement_PreVerifyCapsules();
+
+        // Read the TPM state in the background so the first query is answered from the cache
+        IFXTPMUpdate_SchedulePrewarm();
     }
     WHILE_FALSE_END;
 
+    IFXTPMUPDATE_STACK_CHECK_LEAVE(EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY);
+
     return efiStatus;
 }
 
@@ -173,12 +198,44 @@ DefaultUnload(
                         &gEfiComponentNameProtocolGuid,         &g_IFXTPMUpdateComponentName,
                         &gEfiComponentName2ProtocolGuid,        &g_IFXTPMUpdateComponentName2,
                         &gEfiDriverBindingProtocolGuid,         &g_IFXTPMUpdateDriverBinding,
+                        &s_guidDriverProtocol,                  &s_sDriverProtocol,
                         NULL);
 
         efiStatus = EFI_SUCCESS;
     }
     WHILE_FALSE_END;
 
+    // Do not unload while a capsule image is still read on an application processor
+    FirmwareUpdate_WaitImageIntegrityCheck();
+
+    // Close the policy session kept for a retry, nobody can use it once the driver is gone
+    if (NULL != g_pPrivateData && NULL != g_pPrivateData->hExitBootServicesEvent)
+    {
+        gBS->CloseEvent(g_pPrivateData->hExitBootServicesEvent);
+        g_pPrivateData->hExitBootServicesEvent = NULL;
+    }
+    IFXTPMUpdate_ReleasePolicySession();
+
+    // Cancel a pending TPM state pre-warm and disconnect a pre-warmed TPM
+    IFXTPMUpdate_CancelPrewarm();
+    if (NULL != g_pPrivateData)
+        UninitializeTpmAccess();
+
+    // Stop logging and free the log ring
+    g_unLoggingLevel = LOGGING_DISABLED;
+    IGNORE_RETURN_VALUE(Logging_EnableRing(FALSE));
+
+    // Free the cached signature verification keys
+    Crypt_Uninitialize();
+
+    // Free the replay trace
+    TpmReplay_Unload();
+
+    // Free the property storage and release the memory arena
+    PropertyStorage_ClearElements();
+    PropertyStorage_SetDefaults(NULL, 0);
+    Platform_ArenaUninitialize();
+
     // Free the private context data structure.
     if (NULL != g_pPrivateData)
     {
@@ -188,3 +245,96 @@ DefaultUnload(
 
     return efiStatus;
 }
+
+#ifdef IFXTPMUPDATE_STACK_CHECK
+/// Pattern painted onto the unused stack
+#define STACK_CHECK_PAINT_VALUE 0xA5
+/// Number of bytes directly below IFXTPMUpdate_StackCheckEnter's marker which are not painted (the painter's own stack frame)
+#define STACK_CHECK_GUARD_SIZE 256
+
+/// Address of the marker variable of the outermost IFXTPMUpdate_StackCheckEnter call
+static UINTN s_ullStackCheckTop = 0;
+/// Nesting depth of the instrumented entry points
+static UINT32 s_unStackCheckDepth = 0;
+/// Stack usage of the instrumented entry points
+static EFI_IFXTPM_FIRMWARE_UPDATE_STACK_USAGE_ENTRY_1 s_rgsStackUsage[EFI_IFXTPM_STACK_USAGE_ENTRY_COUNT];
+
+/**
+ *  @brief      Paints the stack below an entry point
+ *  @details    Fills IFXTPMUPDATE_STACK_CHECK_SIZE bytes below the stack frame of the caller with a pattern. Calls of entry points from
+ *              within another entry point are accounted to the outer entry point and do not paint the stack again.
+ *
+ *  @param      PunEntryPoint           Entry point (EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...).
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckEnter(
+    IN  UINT32                          PunEntryPoint)
+{
+    volatile BYTE bMarker = 0;
+    volatile BYTE* pbStack = NULL;
+    UINTN ullIndex = 0;
+
+    UNREFERENCED_PARAMETER(PunEntryPoint);
+
+    if (0 == s_unStackCheckDepth++)
+    {
+        // The stack grows downwards. Paint everything below the frame of this function (a memset call would overwrite its own frame).
+        s_ullStackCheckTop = (UINTN)&bMarker;
+        pbStack = (volatile BYTE*)(s_ullStackCheckTop - IFXTPMUPDATE_STACK_CHECK_SIZE);
+        for (ullIndex = 0; ullIndex < IFXTPMUPDATE_STACK_CHECK_SIZE - STACK_CHECK_GUARD_SIZE; ullIndex++)
+            pbStack[ullIndex] = STACK_CHECK_PAINT_VALUE;
+    }
+}
+
+/**
+ *  @brief      Records the stack high-water mark of an entry point
+ *  @details    Determines the deepest stack byte overwritten since IFXTPMUpdate_StackCheckEnter and updates the high-water mark of
+ *              the entry point.
+ *
+ *  @param      PunEntryPoint           Entry point (EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...).
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckLeave(
+    IN  UINT32                          PunEntryPoint)
+{
+    const volatile BYTE* pbStack = NULL;
+    UINTN ullIndex = 0;
+    UINT32 unUsed = 0;
+
+    do
+    {
+        if (0 == s_unStackCheckDepth || 0 != --s_unStackCheckDepth)
+            break;
+        if (PunEntryPoint >= EFI_IFXTPM_STACK_USAGE_ENTRY_COUNT)
+            break;
+
+        // Find the deepest byte which does not carry the pattern anymore
+        pbStack = (const volatile BYTE*)(s_ullStackCheckTop - IFXTPMUPDATE_STACK_CHECK_SIZE);
+        while (ullIndex < IFXTPMUPDATE_STACK_CHECK_SIZE - STACK_CHECK_GUARD_SIZE && STACK_CHECK_PAINT_VALUE == pbStack[ullIndex])
+            ullIndex++;
+        unUsed = (UINT32)(IFXTPMUPDATE_STACK_CHECK_SIZE - ullIndex);
+
+        s_rgsStackUsage[PunEntryPoint].CallCount++;
+        if (unUsed > s_rgsStackUsage[PunEntryPoint].HighWater)
+            s_rgsStackUsage[PunEntryPoint].HighWater = unUsed;
+    }
+    WHILE_FALSE_END;
+}
+
+/**
+ *  @brief      Returns the stack high-water marks of the entry points
+ *  @details
+ *
+ *  @param      PpsStackUsage           Receives the stack usage of the entry points.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckGetUsage(
+    OUT EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1*    PpsStackUsage)
+{
+    PpsStackUsage->PaintedSize = IFXTPMUPDATE_STACK_CHECK_SIZE;
+    CopyMem(PpsStackUsage->Entries, s_rgsStackUsage, sizeof(s_rgsStackUsage));
+}
+#endif
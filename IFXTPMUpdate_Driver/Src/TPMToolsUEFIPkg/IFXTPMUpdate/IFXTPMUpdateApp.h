@@ -23,6 +23,27 @@
 /// Maximum size of a TPM response
 #define TPM_RESPONSE_BUF_MAXSIZE 1280
 
+/// Size of the memory arena for property storage elements and scratch memory, reserved at driver initialization
+#define IFXTPMUPDATE_ARENA_SIZE (32 * 1024)
+
+/// Delay of the TPM state pre-warm after the driver has been loaded in 100ns units (PcdIfxTpmStatePrewarm)
+#define IFXTPMUPDATE_PREWARM_DELAY (100 * 10000)
+
+// IFXTPMUPDATE_STACK_CHECK builds the driver with stack high-water instrumentation of the entry points (debug builds only)
+#ifdef IFXTPMUPDATE_STACK_CHECK
+/// Number of stack bytes painted below an entry point (the callers of the driver must have that much stack free)
+#ifndef IFXTPMUPDATE_STACK_CHECK_SIZE
+#define IFXTPMUPDATE_STACK_CHECK_SIZE (32 * 1024)
+#endif
+/// Paint the stack on entry of an entry point (EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...)
+#define IFXTPMUPDATE_STACK_CHECK_ENTER(PunEntryPoint) IFXTPMUpdate_StackCheckEnter(PunEntryPoint)
+/// Record the stack high-water mark on exit of an entry point
+#define IFXTPMUPDATE_STACK_CHECK_LEAVE(PunEntryPoint) IFXTPMUpdate_StackCheckLeave(PunEntryPoint)
+#else
+#define IFXTPMUPDATE_STACK_CHECK_ENTER(PunEntryPoint)
+#define IFXTPMUPDATE_STACK_CHECK_LEAVE(PunEntryPoint)
+#endif
+
 /// Global Variables
 /// External global variable for Driver Binding Protocol
 extern EFI_DRIVER_BINDING_PROTOCOL  g_IFXTPMUpdateDriverBinding;
@@ -53,6 +74,14 @@ typedef struct tdIFX_TPM_FIRMWARE_UPDATE_PRIVATE_DATA
     BOOLEAN fOwnedUpdate;
     /// Stores the TPM1.2 Owner password hash
     UINT8 rgbOwnerPasswordSha1[TSS_SHA1_DIGEST_SIZE];
+    /// Stores whether SetInformation() has verified the TPM1.2 Owner password hash with the dictionary attack mode inactive
+    BOOLEAN fOwnerAuthVerified;
+    /// Timer event of the pending TPM state pre-warm (NULL if none is pending)
+    EFI_EVENT hPrewarmEvent;
+    /// Event flushing the policy session kept for a retry at ExitBootServices (NULL if not registered)
+    EFI_EVENT hExitBootServicesEvent;
+    /// Stores whether the firmware update engine holds the TPM access (until the update is done)
+    BOOLEAN fUpdateEngineAccess;
 } IFX_TPM_FIRMWARE_UPDATE_PRIVATE_DATA;
 
 /// External global variable that points to private data of IFXTPMUpdate.efi
@@ -111,13 +140,49 @@ IFXTPMUpdateDriverBindingStop(
     IN  UINTN                           PullNumberOfChildren,
     IN  EFI_HANDLE*                     PpChildHandleBuffer);
 
+#ifdef IFXTPMUPDATE_STACK_CHECK
+/**
+ *  @brief      Paints the stack below an entry point
+ *  @details    Fills IFXTPMUPDATE_STACK_CHECK_SIZE bytes below the stack frame of the caller with a pattern. Calls of entry points from
+ *              within another entry point are accounted to the outer entry point and do not paint the stack again.
+ *
+ *  @param      PunEntryPoint           Entry point (EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...).
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckEnter(
+    IN  UINT32                          PunEntryPoint);
+
+/**
+ *  @brief      Records the stack high-water mark of an entry point
+ *  @details    Determines the deepest stack byte overwritten since IFXTPMUpdate_StackCheckEnter and updates the high-water mark of
+ *              the entry point.
+ *
+ *  @param      PunEntryPoint           Entry point (EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...).
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckLeave(
+    IN  UINT32                          PunEntryPoint);
+
+/**
+ *  @brief      Returns the stack high-water marks of the entry points
+ *  @details
+ *
+ *  @param      PpsStackUsage           Receives the stack usage of the entry points.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_StackCheckGetUsage(
+    OUT EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1*    PpsStackUsage);
+#endif
+
 /**
  *  @brief      Initialize the driver/library data.
  *  @details    Initialize the driver/library data.
  *
  *  @retval     EFI_SUCCESS             The entry point is executed successfully.
  *  @retval     EFI_OUT_OF_RESOURCES    In case of an allocate memory failed.
- *  @retval     EFI_DEVICE_ERROR        In case the random number generator could not be seeded.
  */
 EFI_STATUS
 EFIAPI
@@ -125,21 +190,92 @@ IFXTPMUpdateInitialize();
 
 /**
  *  @brief      Initializes access to the TPM.
- *  @details
+ *  @details    Claims the TPM for the caller. A protocol call which interrupts another protocol call holding the TPM
+ *              (e.g. from a timer callback during a firmware update) is rejected. Each call must be paired with
+ *              UninitializeTpmAccess, also if it fails.
+ *
+ *  @param      PunPriority                         Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
  *
  *  @retval     EFI_SUCCESS                         TPM access initialized successfully or already initialized.
  *  @retval     EFI_DEVICE_ERROR                    Failed to initialize TPM access.
+ *  @retval     EFI_NOT_READY                       The TPM is in use by an interrupted protocol call.
  *  @retval     EFI_OUT_OF_RESOURCES                Not enough memory.
  *  @retval     EFI_IFXTPM_UNSUPPORTED_VENDOR       The TPM is not manufactured by Infineon. It is not supported by the driver.
  */
 EFI_STATUS
 EFIAPI
-InitializeTpmAccess();
+InitializeTpmAccess(
+    _In_    UINT32  PunPriority);
 
 /**
  *  @brief      Uninitializes access to the TPM.
- *  @details
+ *  @details    Releases the claim of InitializeTpmAccess. The TPM is disconnected once the outermost claim is released.
  */
 VOID
 EFIAPI
 UninitializeTpmAccess();
+
+/**
+ *  @brief      Maps the failure of a TPM query to EFI_TIMEOUT if the query deadline elapsed.
+ *  @details    The TPM commands of a call with priority DEVICE_MANAGEMENT_PRIORITY_QUERY fail once the time budget set
+ *              with EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID is used up. The caller gets EFI_TIMEOUT instead
+ *              of the error the failed command was mapped to.
+ *
+ *  @param      PefiStatus                          Result of the call.
+ *
+ *  @returns    EFI_TIMEOUT if the call failed because the query deadline elapsed, PefiStatus otherwise.
+ */
+EFI_STATUS
+EFIAPI
+MapQueryDeadlineStatus(
+    _In_    EFI_STATUS  PefiStatus);
+
+/**
+ *  @brief      Schedules the background TPM state pre-warm
+ *  @details    Does nothing unless PcdIfxTpmStatePrewarm is TRUE. Otherwise a one-shot TPL_CALLBACK timer connects to
+ *              the TPM and reads the TPM state once the boot flow is idle.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_SchedulePrewarm();
+
+/**
+ *  @brief      Cancels a pending TPM state pre-warm
+ *  @details
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_CancelPrewarm();
+
+/**
+ *  @brief      Flushes the policy session kept for a retry of the firmware update
+ *  @details    A kept session is only of use within the same boot. It is flushed before the driver is unloaded and at
+ *              ExitBootServices, so it does not occupy a TPM session slot when the OS boots. The session is left alone if a
+ *              protocol call holds the TPM.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_ReleasePolicySession();
+
+/**
+ *  @brief      Starts the integrity check of a TPM firmware image delivered in an FMP capsule
+ *  @details    Looks for an FMP capsule payload with the update image type EFI_IFXTPM_FIRMWARE_TYPE_GUID in the capsule HOBs
+ *              and starts the CRC and digest calculation of the image in place. SetImage reuses the result when the capsule
+ *              library passes the same buffer.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_FirmwareManagement_PreVerifyCapsules();
+
+/**
+ *  @brief      Maps the result of a firmware update to the status returned by SetImage
+ *  @details
+ *
+ *  @param      PunReturnValue          Result of FirmwareUpdate_UpdateImage or of the firmware update engine.
+ *
+ *  @returns    The EFI status of SetImage for the result.
+ */
+EFI_STATUS
+EFIAPI
+IFXTPMUpdate_FirmwareManagement_UpdateResultToStatus(
+    IN  UINT32  PunReturnValue);
@@ -17,18 +17,61 @@
 #include "DeviceManagement.h"
 #include "IFXTPMUpdateApp.h"
 #include "Crypt.h"
+#include "FirmwareUpdate.h"
+#include "TpmReplay.h"
+#include <Library/PcdLib.h>
+#include <Guid/EventGroup.h>
 
 IFX_TPM_FIRMWARE_UPDATE_PRIVATE_DATA* g_pPrivateData = NULL;
 
 const wchar_t CwszErrorMsgFormatPropertyStorage_Set[] = L"Error while setting property %ls. (0x%.16lX)";
 
+/// Default property values, consulted by PropertyStorage for properties which have not been set
+static const IfxPropertyDefault s_rgsPropertyDefaults[] =
+{
+    // Abandon firmware update behavior
+    { PROPERTY_ABANDON_UPDATE_MODE, PROPERTY_STORAGE_TYPE_UINTEGER, ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL },
+    // Pipelined firmware block streaming
+    { PROPERTY_STREAMING_UPDATE, PROPERTY_STORAGE_TYPE_BOOLEAN, TRUE },
+    // Spec command durations until a calibration is requested
+    { PROPERTY_CALIBRATE_COMMAND_DURATIONS, PROPERTY_STORAGE_TYPE_BOOLEAN, FALSE },
+    // Pre-flight link check before a firmware update: disabled
+    { PROPERTY_LINK_CHECK_READS, PROPERTY_STORAGE_TYPE_UINTEGER, 0 },
+    { PROPERTY_LINK_CHECK_MAX_ERRORS, PROPERTY_STORAGE_TYPE_UINTEGER, 0 },
+    // Default access mode: LOCALITY_0
+    { PROPERTY_LOCALITY, PROPERTY_STORAGE_TYPE_UINTEGER, LOCALITY_0 },
+    // Locality request mode
+    { PROPERTY_KEEP_LOCALITY_ACTIVE, PROPERTY_STORAGE_TYPE_BOOLEAN, TRUE },
+};
+
+/**
+ *  @brief      Flushes the policy session kept for a retry at ExitBootServices
+ *  @details
+ *
+ *  @param      PhEvent                 ExitBootServices event.
+ *  @param      PpContext               Not used.
+ */
+static
+VOID
+EFIAPI
+IFXTPMUpdate_ExitBootServicesCallback(
+    IN  EFI_EVENT   PhEvent,
+    IN  VOID*       PpContext)
+{
+    UNREFERENCED_PARAMETER(PhEvent);
+    UNREFERENCED_PARAMETER(PpContext);
+
+    IFXTPMUpdate_ReleasePolicySession();
+}
+
 /**
  *  @brief      Initialize the driver/library data.
- *  @details    Initialize the driver/library data.
+ *  @details    Initialize the driver/library data. The driver is loaded on every boot, so work which is only needed for
+ *              an update is deferred: default properties come from a constant table and the random number generator
+ *              is seeded by the first Crypt_GetRandom call.
  *
  *  @retval     EFI_SUCCESS             The entry point is executed successfully.
  *  @retval     EFI_OUT_OF_RESOURCES    In case of an allocate memory failed.
- *  @retval     EFI_DEVICE_ERROR        In case the random number generator could not be seeded.
  */
 EFI_STATUS
 EFIAPI
@@ -46,21 +89,24 @@ IFXTPMUpdateInitialize()
             break;
         }
 
-        // Seed the random number generator
-        if (RC_SUCCESS != Crypt_SeedRandom(NULL, 0))
-        {
-            efiStatus = EFI_DEVICE_ERROR;
-            break;
-        }
-
-        // Set abandon firmware update behavior.
-        if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL))
+        // Reserve the memory arena
+        if (RC_SUCCESS != Platform_ArenaInitialize(IFXTPMUPDATE_ARENA_SIZE))
         {
             efiStatus = EFI_OUT_OF_RESOURCES;
-            LOGGING_WRITE_LEVEL1_FMT(CwszErrorMsgFormatPropertyStorage_Set, PROPERTY_ABANDON_UPDATE_MODE, efiStatus);
             break;
         }
 
+        // Select the CPU accelerated CRC and SHA-256 calculations and run their self-test
+        Crypt_Initialize();
+
+        // Register the default properties, no element is allocated until a property is set
+        PropertyStorage_SetDefaults(s_rgsPropertyDefaults, RG_LEN(s_rgsPropertyDefaults));
+
+        // Flush a policy session kept for a retry before the OS boots. The driver works without the event.
+        if (EFI_ERROR(gBS->CreateEventEx(EVT_NOTIFY_SIGNAL, TPL_CALLBACK, IFXTPMUpdate_ExitBootServicesCallback, NULL,
+                                         &gEfiEventExitBootServicesGuid, &g_pPrivateData->hExitBootServicesEvent)))
+            g_pPrivateData->hExitBootServicesEvent = NULL;
+
         efiStatus = EFI_SUCCESS;
     }
     WHILE_FALSE_END;
@@ -70,43 +116,45 @@ IFXTPMUpdateInitialize()
 
 /**
  *  @brief      Initializes access to the TPM.
- *  @details
+ *  @details    Claims the TPM for the caller. A protocol call which interrupts another protocol call holding the TPM
+ *              (e.g. from a timer callback during a firmware update) is rejected. Each call must be paired with
+ *              UninitializeTpmAccess, also if it fails.
+ *
+ *  @param      PunPriority                         Access priority (DEVICE_MANAGEMENT_PRIORITY_*).
  *
  *  @retval     EFI_SUCCESS                         TPM access initialized successfully or already initialized.
  *  @retval     EFI_DEVICE_ERROR                    Failed to initialize TPM access.
+ *  @retval     EFI_NOT_READY                       The TPM is in use by an interrupted protocol call.
  *  @retval     EFI_OUT_OF_RESOURCES                Not enough memory.
  *  @retval     EFI_IFXTPM_UNSUPPORTED_VENDOR       The TPM is not manufactured by Infineon. It is not supported by the driver.
  */
 EFI_STATUS
 EFIAPI
-InitializeTpmAccess()
+InitializeTpmAccess(
+    _In_    UINT32  PunPriority)
 {
     EFI_STATUS efiStatus = EFI_DEVICE_ERROR;
 
     do
     {
+        if (RC_SUCCESS != DeviceManagement_AcquireAccess(PunPriority))
+        {
+            efiStatus = EFI_NOT_READY;
+            break;
+        }
+
         if (!g_pPrivateData->fTpmAccessInitialized)
         {
             unsigned int unReturnValue = RC_E_FAIL;
 
-            // Set default access mode: LOCALITY_0
-            if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_LOCALITY, LOCALITY_0))
-            {
-                efiStatus = EFI_OUT_OF_RESOURCES;
-                LOGGING_WRITE_LEVEL1_FMT(CwszErrorMsgFormatPropertyStorage_Set, PROPERTY_LOCALITY, efiStatus);
-                break;
-            }
-
-            // Set locality request mode
-            if (!PropertyStorage_SetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, TRUE))
-            {
-                efiStatus = EFI_OUT_OF_RESOURCES;
-                LOGGING_WRITE_LEVEL1_FMT(CwszErrorMsgFormatPropertyStorage_Set, PROPERTY_KEEP_LOCALITY_ACTIVE, efiStatus);
-                break;
-            }
-
-            // Set default TPM device access
+            // Locality and locality request mode come from the default properties.
+            // Set default TPM device access, a loaded replay trace replaces the TPM. The TCG2 passthrough falls back to
+            // memory based access if EFI_TCG2_PROTOCOL is not available.
             UINT32 unDeviceAccess = TPM_DEVICE_ACCESS_MEMORY_BASED;
+            if (TpmReplay_IsLoaded())
+                unDeviceAccess = TPM_DEVICE_ACCESS_REPLAY;
+            else if (FeaturePcdGet(PcdIfxTpmTcg2Passthrough))
+                unDeviceAccess = TPM_DEVICE_ACCESS_EFI_TCG2_PROTOCOL;
 
             // Set device access mode
             if (!PropertyStorage_SetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, unDeviceAccess))
@@ -138,18 +186,159 @@ InitializeTpmAccess()
 
 /**
  *  @brief      Uninitializes access to the TPM.
- *  @details
+ *  @details    Releases the claim of InitializeTpmAccess. The TPM is disconnected once the outermost claim is released.
  */
 VOID
 EFIAPI
 UninitializeTpmAccess()
 {
+    // Keep the TPM connected for the caller holding it
+    if (!DeviceManagement_ReleaseAccess())
+        return;
+
     if (g_pPrivateData->fTpmAccessInitialized)
     {
         // Disconnect to the TPM device
         IGNORE_RETURN_VALUE(DeviceManagement_Disconnect());
+        // Other calls (e.g. EFI_ADAPTER_INFORMATION_PROTOCOL) use the first TPM instance
+        IGNORE_RETURN_VALUE(DeviceManagement_SelectInstance(0));
         // Uninitialize TPM device access
         DeviceManagement_Uninitialize();
         g_pPrivateData->fTpmAccessInitialized = FALSE;
     }
 }
+
+/**
+ *  @brief      Maps the failure of a TPM query to EFI_TIMEOUT if the query deadline elapsed.
+ *  @details    The TPM commands of a call with priority DEVICE_MANAGEMENT_PRIORITY_QUERY fail once the time budget set
+ *              with EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID is used up. The caller gets EFI_TIMEOUT instead
+ *              of the error the failed command was mapped to.
+ *
+ *  @param      PefiStatus                          Result of the call.
+ *
+ *  @returns    EFI_TIMEOUT if the call failed because the query deadline elapsed, PefiStatus otherwise.
+ */
+EFI_STATUS
+EFIAPI
+MapQueryDeadlineStatus(
+    _In_    EFI_STATUS  PefiStatus)
+{
+    // Parameter errors and rejected calls are not caused by the TPM
+    if (!EFI_ERROR(PefiStatus) || EFI_INVALID_PARAMETER == PefiStatus || EFI_NOT_READY == PefiStatus)
+        return PefiStatus;
+
+    return DeviceManagement_IsQueryDeadlineExceeded() ? EFI_TIMEOUT : PefiStatus;
+}
+
+/**
+ *  @brief      Reads the TPM state in the background
+ *  @details    Timer callback scheduled by IFXTPMUpdate_SchedulePrewarm. Connects to the TPM and fills the TPM state
+ *              snapshot of FirmwareUpdate_CalculateState. On success the TPM stays connected, since connecting and
+ *              disconnecting invalidate the snapshot. The next protocol call reuses the connection and disconnects when
+ *              it returns. The pre-warm is skipped if a protocol call holds the TPM.
+ *
+ *  @param      PhEvent                 Timer event.
+ *  @param      PpContext               Not used.
+ */
+static
+VOID
+EFIAPI
+IFXTPMUpdate_PrewarmCallback(
+    IN  EFI_EVENT   PhEvent,
+    IN  VOID*       PpContext)
+{
+    TPM_STATE sTpmState;
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    UNREFERENCED_PARAMETER(PpContext);
+
+    gBS->CloseEvent(PhEvent);
+    g_pPrivateData->hPrewarmEvent = NULL;
+
+    do
+    {
+        if (EFI_ERROR(InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_QUERY)))
+            break;
+
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+        {
+            LOGGING_WRITE_LEVEL1_FMT(L"Error during TPM state pre-warm. (0x%.8X)", unReturnValue);
+            break;
+        }
+
+        // Keep the TPM connected, the snapshot is bound to the connection
+        IGNORE_RETURN_VALUE(DeviceManagement_ReleaseAccess());
+        LOGGING_WRITE_LEVEL2(L"TPM state pre-warmed");
+        return;
+    }
+    WHILE_FALSE_END;
+
+    UninitializeTpmAccess();
+}
+
+/**
+ *  @brief      Schedules the background TPM state pre-warm
+ *  @details    Does nothing unless PcdIfxTpmStatePrewarm is TRUE. Otherwise a one-shot TPL_CALLBACK timer connects to
+ *              the TPM and reads the TPM state once the boot flow is idle.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_SchedulePrewarm()
+{
+    EFI_EVENT hEvent = NULL;
+
+    if (!FeaturePcdGet(PcdIfxTpmStatePrewarm) || NULL == g_pPrivateData || NULL != g_pPrivateData->hPrewarmEvent)
+        return;
+
+    if (EFI_ERROR(gBS->CreateEvent(EVT_TIMER | EVT_NOTIFY_SIGNAL, TPL_CALLBACK, IFXTPMUpdate_PrewarmCallback, NULL, &hEvent)))
+        return;
+
+    if (EFI_ERROR(gBS->SetTimer(hEvent, TimerRelative, IFXTPMUPDATE_PREWARM_DELAY)))
+    {
+        gBS->CloseEvent(hEvent);
+        return;
+    }
+
+    g_pPrivateData->hPrewarmEvent = hEvent;
+}
+
+/**
+ *  @brief      Cancels a pending TPM state pre-warm
+ *  @details
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_CancelPrewarm()
+{
+    if (NULL != g_pPrivateData && NULL != g_pPrivateData->hPrewarmEvent)
+    {
+        gBS->CloseEvent(g_pPrivateData->hPrewarmEvent);
+        g_pPrivateData->hPrewarmEvent = NULL;
+    }
+}
+
+/**
+ *  @brief      Flushes the policy session kept for a retry of the firmware update
+ *  @details    A kept session is only of use within the same boot. It is flushed before the driver is unloaded and at
+ *              ExitBootServices, so it does not occupy a TPM session slot when the OS boots. The session is left alone if a
+ *              protocol call holds the TPM.
+ */
+VOID
+EFIAPI
+IFXTPMUpdate_ReleasePolicySession()
+{
+    TSS_TPMI_SH_AUTH_SESSION hPolicySession = FirmwareUpdate_GetRetainedTPM20Policy();
+
+    if (NULL == g_pPrivateData || 0 == hPolicySession)
+        return;
+
+    if (!EFI_ERROR(InitializeTpmAccess(DEVICE_MANAGEMENT_PRIORITY_UPDATE)))
+    {
+        FirmwareUpdate_FlushTPM20Policy(hPolicySession);
+        if (hPolicySession == g_pPrivateData->unSessionHandle)
+            g_pPrivateData->unSessionHandle = 0;
+    }
+    UninitializeTpmAccess();
+}
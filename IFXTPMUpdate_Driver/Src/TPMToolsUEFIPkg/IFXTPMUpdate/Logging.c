@@ -19,9 +19,600 @@
 /// Flag indicating whether to write a header into the log file or not
 BOOL g_fLogHeader = TRUE;
 
-/// Flag indicating whether logging is already ongoing
+/// Flag indicating whether logging is already ongoing (s_wszMessage is in use)
 BOOL g_fInLogging = FALSE;
 
+/// Current log level (messages are only logged while a logging callback function or the log ring is set)
+unsigned int g_unLoggingLevel = LOGGING_DISABLED;
+
+/// Size of the log ring in bytes
+#define LOGGING_RING_SIZE           (256 * 1024)
+
+/// Alignment of the records in the log ring
+#define LOGGING_RING_ALIGNMENT      8
+
+/// Maximum size of the format arguments of a recorded message in bytes
+#define LOGGING_RING_ARGUMENTS_SIZE (16 * sizeof(UINT64))
+
+/// Maximum number of characters recorded per string argument (incl. null-termination)
+#define LOGGING_RING_MAX_STRING     256
+
+/// Maximum number of bytes recorded per hex dump
+#define LOGGING_RING_MAX_HEX_BYTES  1536
+
+/// Capacity of the buffers used to format a log message in elements
+#define LOGGING_MESSAGE_CAPACITY    6144
+
+/// Buffer to format a log message in, kept off the stack because messages are logged from deeply nested calls
+static wchar_t s_wszMessage[LOGGING_MESSAGE_CAPACITY];
+
+/// Format string used for messages which are recorded preformatted
+static const wchar_t s_wszPreformatted[] = L"%ls";
+
+/// The log ring (NULL if the log ring is disabled)
+static BYTE* s_pbLogRing = NULL;
+
+/// Offset of the oldest record in the log ring
+static unsigned int s_unLogRingHead = 0;
+
+/// Offset behind the newest record in the log ring
+static unsigned int s_unLogRingTail = 0;
+
+/// Number of records in the log ring
+static unsigned int s_unLogRingCount = 0;
+
+/// Number of messages dropped since the log ring was read last
+static unsigned int s_unLogRingDropped = 0;
+
+/// Tick count when the log ring was enabled
+static unsigned long long s_ullLogRingStartTicks = 0;
+
+/// Flag indicating the log ring is being read
+static BOOL s_fLogRingDraining = FALSE;
+
+/**
+ *  @brief      Returns the oldest record of the log ring
+ *  @details    Skips the unused end of the log ring if necessary. The log ring must not be empty.
+ *
+ *  @returns    Pointer to the oldest record.
+ */
+static
+IfxLogRecord*
+Logging_RingOldest()
+{
+    if (s_unLogRingHead + sizeof(IfxLogRecord) > LOGGING_RING_SIZE ||
+            0 == ((IfxLogRecord*)&s_pbLogRing[s_unLogRingHead])->unSize)
+        s_unLogRingHead = 0;
+
+    return (IfxLogRecord*)&s_pbLogRing[s_unLogRingHead];
+}
+
+/**
+ *  @brief      Removes the oldest record from the log ring
+ *  @details    The log ring must not be empty.
+ */
+static
+void
+Logging_RingRemoveOldest()
+{
+    s_unLogRingHead += Logging_RingOldest()->unSize;
+    s_unLogRingCount--;
+    if (0 == s_unLogRingCount)
+    {
+        s_unLogRingHead = 0;
+        s_unLogRingTail = 0;
+    }
+}
+
+/**
+ *  @brief      Reserves a record in the log ring
+ *  @details    The oldest records are dropped until the new record fits into the log ring.
+ *
+ *  @param      PunSize             Size of the record in bytes (aligned to LOGGING_RING_ALIGNMENT).
+ *
+ *  @returns    Pointer to the record or NULL if the record is larger than the log ring.
+ */
+static
+IfxLogRecord*
+Logging_RingReserve(
+    _In_    unsigned int    PunSize)
+{
+    IfxLogRecord* pRecord = NULL;
+
+    if (PunSize > LOGGING_RING_SIZE)
+        return NULL;
+
+    for (;;)
+    {
+        if (0 == s_unLogRingCount)
+        {
+            s_unLogRingHead = 0;
+            s_unLogRingTail = 0;
+        }
+
+        if (0 == s_unLogRingCount || s_unLogRingHead < s_unLogRingTail)
+        {
+            // Free space is behind the tail up to the end of the log ring
+            if (s_unLogRingTail + PunSize <= LOGGING_RING_SIZE)
+                break;
+
+            // Mark the unused end of the log ring and continue at its beginning
+            if (s_unLogRingTail + sizeof(IfxLogRecord) <= LOGGING_RING_SIZE)
+                ((IfxLogRecord*)&s_pbLogRing[s_unLogRingTail])->unSize = 0;
+            s_unLogRingTail = 0;
+            continue;
+        }
+
+        // Free space is between tail and head
+        if (s_unLogRingTail + PunSize <= s_unLogRingHead)
+            break;
+
+        Logging_RingRemoveOldest();
+        s_unLogRingDropped++;
+    }
+
+    pRecord = (IfxLogRecord*)&s_pbLogRing[s_unLogRingTail];
+    s_unLogRingTail += PunSize;
+    s_unLogRingCount++;
+
+    return pRecord;
+}
+
+/**
+ *  @brief      Records a message in the log ring
+ *  @details    Only the format arguments are stored, the message is formatted when the log ring is read. String arguments
+ *              are copied (truncated to LOGGING_RING_MAX_STRING characters).
+ *
+ *  @param      PunLoggingLevel     Logging level.
+ *  @param      PwszFormat          Format string of the message (must stay valid while the message is in the log ring).
+ *  @param      PargList            Arguments of the message.
+ *
+ *  @retval     TRUE                The message was recorded or dropped because the log ring is full.
+ *  @retval     FALSE               The format string contains unsupported conversions or too many arguments.
+ */
+static
+BOOL
+Logging_RingRecordMessage(
+    _In_    unsigned int    PunLoggingLevel,
+    _In_z_  const wchar_t*  PwszFormat,
+    _In_    va_list         PargList)
+{
+    UINT64 rgullArguments[LOGGING_RING_ARGUMENTS_SIZE / sizeof(UINT64)];
+    BYTE* pbArguments = (BYTE*)rgullArguments;
+    unsigned int unArgumentsSize = 0;
+    unsigned int rgunStringOffsets[LOGGING_RING_ARGUMENTS_SIZE / sizeof(UINTN)];
+    unsigned int rgunStringSizes[LOGGING_RING_ARGUMENTS_SIZE / sizeof(UINTN)];
+    unsigned int rgunStringCharSizes[LOGGING_RING_ARGUMENTS_SIZE / sizeof(UINTN)];
+    unsigned int unStringCount = 0;
+    unsigned int unDataSize = 0;
+    unsigned int unIndex = 0;
+    const wchar_t* pwszPosition = NULL;
+    IfxLogRecord* pRecord = NULL;
+    BYTE* pbData = NULL;
+
+    // Collect the arguments in the layout of a BASE_LIST
+    for (pwszPosition = PwszFormat; L'\0' != *pwszPosition; pwszPosition++)
+    {
+        BOOL fLong = FALSE;
+        unsigned int unArgumentSize = 0;
+
+        if (L'%' != *pwszPosition)
+            continue;
+
+        // Skip flags, width and precision
+        for (pwszPosition++; L'\0' != *pwszPosition; pwszPosition++)
+        {
+            if (L'l' == *pwszPosition || L'L' == *pwszPosition)
+                fLong = TRUE;
+            else if (L'*' == *pwszPosition)
+            {
+                if (unArgumentsSize + _BASE_INT_SIZE_OF(UINTN) > LOGGING_RING_ARGUMENTS_SIZE)
+                    return FALSE;
+                *(UINTN*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINTN);
+                unArgumentsSize += _BASE_INT_SIZE_OF(UINTN);
+            }
+            else if (!((L'0' <= *pwszPosition && L'9' >= *pwszPosition) || L'.' == *pwszPosition || L'-' == *pwszPosition ||
+                    L'+' == *pwszPosition || L' ' == *pwszPosition || L',' == *pwszPosition || L'#' == *pwszPosition))
+                break;
+        }
+
+        switch (*pwszPosition)
+        {
+            case L'%':
+                break;
+            case L'd':
+            case L'i':
+            case L'u':
+            case L'x':
+            case L'X':
+                unArgumentSize = fLong ? _BASE_INT_SIZE_OF(UINT64) : _BASE_INT_SIZE_OF(int);
+                if (unArgumentsSize + unArgumentSize > LOGGING_RING_ARGUMENTS_SIZE)
+                    return FALSE;
+                if (fLong)
+                    *(UINT64*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINT64);
+                else
+                    *(int*)&pbArguments[unArgumentsSize] = va_arg(PargList, int);
+                unArgumentsSize += unArgumentSize;
+                break;
+            case L'c':
+            case L'r':
+            case L'p':
+            case L's':
+            case L'S':
+            case L'a':
+                if (unArgumentsSize + _BASE_INT_SIZE_OF(UINTN) > LOGGING_RING_ARGUMENTS_SIZE)
+                    return FALSE;
+                *(UINTN*)&pbArguments[unArgumentsSize] = va_arg(PargList, UINTN);
+                if (L's' == *pwszPosition || L'S' == *pwszPosition || L'a' == *pwszPosition)
+                {
+                    // Determine the size of the string copy
+                    unsigned int unLength = 0;
+                    unsigned int unCharSize = (L'a' == *pwszPosition) ? sizeof(CHAR8) : sizeof(CHAR16);
+                    const BYTE* pbString = *(const BYTE**)&pbArguments[unArgumentsSize];
+                    if (NULL != pbString)
+                    {
+                        if (sizeof(CHAR8) == unCharSize)
+                            unLength = (unsigned int)AsciiStrnLenS((const CHAR8*)pbString, LOGGING_RING_MAX_STRING - 1);
+                        else
+                            unLength = (unsigned int)StrnLenS((const CHAR16*)pbString, LOGGING_RING_MAX_STRING - 1);
+                        rgunStringOffsets[unStringCount] = unArgumentsSize;
+                        rgunStringSizes[unStringCount] = (unLength + 1) * unCharSize;
+                        rgunStringCharSizes[unStringCount] = unCharSize;
+                        unDataSize += rgunStringSizes[unStringCount];
+                        unStringCount++;
+                    }
+                }
+                unArgumentsSize += _BASE_INT_SIZE_OF(UINTN);
+                break;
+            default:
+                // e.g. GUID (%g) or time (%t) arguments
+                return FALSE;
+        }
+
+        if (L'\0' == *pwszPosition)
+            break;
+    }
+
+    pRecord = Logging_RingReserve(ALIGN_VALUE(sizeof(IfxLogRecord) + unArgumentsSize + unDataSize, LOGGING_RING_ALIGNMENT));
+    if (NULL == pRecord)
+    {
+        s_unLogRingDropped++;
+        return TRUE;
+    }
+
+    pRecord->unSize = (unsigned int)ALIGN_VALUE(sizeof(IfxLogRecord) + unArgumentsSize + unDataSize, LOGGING_RING_ALIGNMENT);
+    pRecord->unLogLevel = PunLoggingLevel;
+    pRecord->ullTicks = Platform_GetTicks();
+    pRecord->pwszFormat = PwszFormat;
+    pRecord->unArgumentsSize = unArgumentsSize;
+    pRecord->unDataSize = unDataSize;
+    CopyMem(pRecord + 1, pbArguments, unArgumentsSize);
+
+    // Copy the strings behind the arguments and let the arguments point to the copies
+    pbData = (BYTE*)(pRecord + 1) + unArgumentsSize;
+    for (unIndex = 0; unIndex < unStringCount; unIndex++)
+    {
+        BYTE** ppbArgument = (BYTE**)((BYTE*)(pRecord + 1) + rgunStringOffsets[unIndex]);
+        unsigned int unCopySize = rgunStringSizes[unIndex] - rgunStringCharSizes[unIndex];
+
+        CopyMem(pbData, *ppbArgument, unCopySize);
+        ZeroMem(pbData + unCopySize, rgunStringCharSizes[unIndex]);
+        *ppbArgument = pbData;
+        pbData += rgunStringSizes[unIndex];
+    }
+
+    return TRUE;
+}
+
+/**
+ *  @brief      Records a formatted message in the log ring
+ *  @details    Used for messages which cannot be recorded with their format arguments.
+ *
+ *  @param      PunLoggingLevel     Logging level.
+ *  @param      PwszText            The formatted message.
+ *  @param      PunLength           Length of the message in elements (without null-termination).
+ */
+static
+void
+Logging_RingRecordText(
+    _In_                        unsigned int    PunLoggingLevel,
+    _In_count_(PunLength)       const wchar_t*  PwszText,
+    _In_                        unsigned int    PunLength)
+{
+    IfxLogRecord* pRecord = NULL;
+    unsigned int unDataSize = (PunLength + 1) * sizeof(wchar_t);
+    wchar_t* pwszCopy = NULL;
+
+    pRecord = Logging_RingReserve(ALIGN_VALUE(sizeof(IfxLogRecord) + sizeof(UINTN) + unDataSize, LOGGING_RING_ALIGNMENT));
+    if (NULL == pRecord)
+    {
+        s_unLogRingDropped++;
+        return;
+    }
+
+    pRecord->unSize = (unsigned int)ALIGN_VALUE(sizeof(IfxLogRecord) + sizeof(UINTN) + unDataSize, LOGGING_RING_ALIGNMENT);
+    pRecord->unLogLevel = PunLoggingLevel;
+    pRecord->ullTicks = Platform_GetTicks();
+    pRecord->pwszFormat = s_wszPreformatted;
+    pRecord->unArgumentsSize = sizeof(UINTN);
+    pRecord->unDataSize = unDataSize;
+    pwszCopy = (wchar_t*)((BYTE*)(pRecord + 1) + sizeof(UINTN));
+    CopyMem(pwszCopy, PwszText, PunLength * sizeof(wchar_t));
+    pwszCopy[PunLength] = L'\0';
+    *(wchar_t**)(pRecord + 1) = pwszCopy;
+}
+
+/**
+ *  @brief      Records a hex dump in the log ring
+ *  @details    The data is copied (truncated to LOGGING_RING_MAX_HEX_BYTES bytes) and formatted when the log ring is read.
+ *
+ *  @param      PunLoggingLevel     Logging level.
+ *  @param      PrgbHexData         Data to dump.
+ *  @param      PunSize             Size of the data in bytes.
+ */
+static
+void
+Logging_RingRecordHex(
+    _In_                    unsigned int    PunLoggingLevel,
+    _In_bytecount_(PunSize) const BYTE*     PrgbHexData,
+    _In_                    unsigned int    PunSize)
+{
+    IfxLogRecord* pRecord = NULL;
+
+    if (PunSize > LOGGING_RING_MAX_HEX_BYTES)
+        PunSize = LOGGING_RING_MAX_HEX_BYTES;
+
+    pRecord = Logging_RingReserve(ALIGN_VALUE(sizeof(IfxLogRecord) + PunSize, LOGGING_RING_ALIGNMENT));
+    if (NULL == pRecord)
+    {
+        s_unLogRingDropped++;
+        return;
+    }
+
+    pRecord->unSize = (unsigned int)ALIGN_VALUE(sizeof(IfxLogRecord) + PunSize, LOGGING_RING_ALIGNMENT);
+    pRecord->unLogLevel = PunLoggingLevel;
+    pRecord->ullTicks = Platform_GetTicks();
+    pRecord->pwszFormat = NULL;
+    pRecord->unArgumentsSize = 0;
+    pRecord->unDataSize = PunSize;
+    CopyMem(pRecord + 1, PrgbHexData, PunSize);
+}
+
+/**
+ *  @brief      Formats a record of the log ring
+ *  @details
+ *
+ *  @param      PpRecord            Record to format.
+ *  @param      PwszMessage         Buffer receiving the formatted message including a terminating new line.
+ *  @param      PpunMessageSize     In:     Capacity of PwszMessage in elements\n
+ *                                  Out:    Count of written elements (without null-termination)
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from called functions.
+ */
+static
+unsigned int
+Logging_RingFormatRecord(
+    _In_                            const IfxLogRecord* PpRecord,
+    _Out_z_cap_(*PpunMessageSize)   wchar_t*            PwszMessage,
+    _Inout_                         unsigned int*       PpunMessageSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    unsigned int unCapacity = *PpunMessageSize;
+    unsigned int unCount = 0;
+    unsigned int unSize = 0;
+
+    do
+    {
+        PwszMessage[0] = L'\0';
+
+        if (g_pPrivateData->fLogTimeStamps)
+        {
+            unsigned long long ullMicroseconds = Platform_TicksToMicroseconds(PpRecord->ullTicks - s_ullLogRingStartTicks);
+            unSize = unCapacity;
+            unReturnValue = Platform_StringFormat(PwszMessage, &unSize, L"[%llu.%.6llu] ", ullMicroseconds / 1000000, ullMicroseconds % 1000000);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            unCount = unSize;
+        }
+
+        if (NULL != PpRecord->pwszFormat)
+        {
+            // Format the message from the recorded arguments
+            unCount += (unsigned int)UnicodeBSPrint(&PwszMessage[unCount], (unCapacity - unCount) * sizeof(wchar_t), PpRecord->pwszFormat, (BASE_LIST)(PpRecord + 1));
+        }
+        else
+        {
+            // Format the hex dump
+            unSize = unCapacity - unCount;
+            unReturnValue = Utility_StringWriteHex((const BYTE*)(PpRecord + 1), PpRecord->unDataSize, &PwszMessage[unCount], &unSize);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            unCount += unSize;
+        }
+
+        unSize = unCapacity - unCount;
+        unReturnValue = Platform_StringFormat(&PwszMessage[unCount], &unSize, L"\n");
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        unCount += unSize;
+
+        *PpunMessageSize = unCount;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Enable or disable the log ring
+ *  @details    While the log ring is enabled, Logging_WriteLog and Logging_WriteHex record the messages in binary form (log level,
+ *              format string, format arguments and tick count) instead of formatting them. Disabling the log ring discards
+ *              all messages not read yet.
+ *
+ *  @param      PfEnable            TRUE to enable the log ring, FALSE to disable it.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_FAIL           The memory for the log ring could not be allocated.
+ */
+_Check_return_
+unsigned int
+Logging_EnableRing(
+    _In_    BOOL    PfEnable)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        if (!PfEnable)
+        {
+            Platform_MemoryFree((void**)&s_pbLogRing);
+        }
+        else if (NULL == s_pbLogRing)
+        {
+            s_pbLogRing = (BYTE*)Platform_MemoryAllocateZero(LOGGING_RING_SIZE);
+            if (NULL == s_pbLogRing)
+                break;
+            s_ullLogRingStartTicks = Platform_GetTicks();
+        }
+        else
+        {
+            // Keep the messages of the log ring already enabled
+            unReturnValue = RC_SUCCESS;
+            break;
+        }
+
+        s_unLogRingHead = 0;
+        s_unLogRingTail = 0;
+        s_unLogRingCount = 0;
+        s_unLogRingDropped = 0;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Check if the log ring is enabled
+ *  @details
+ *
+ *  @retval     TRUE                The log ring is enabled.
+ *  @retval     FALSE               The log ring is disabled.
+ */
+_Check_return_
+BOOL
+Logging_IsRingEnabled()
+{
+    return NULL != s_pbLogRing;
+}
+
+/**
+ *  @brief      Read the messages of the log ring
+ *  @details    Formats the recorded messages from oldest to newest and removes them from the log ring. Messages which do not fit
+ *              into the given buffer stay in the log ring. Call the function with PwszText set to NULL to get the capacity
+ *              required for all messages without removing them.
+ *
+ *  @param      PwszText            Buffer receiving the null-terminated messages (optional, can be NULL).
+ *  @param      PpunTextCapacity    In:     Capacity of PwszText in elements\n
+ *                                  Out:    Count of written elements (incl. null-termination) or required capacity if PwszText is NULL
+ *  @param      PpunMessageCount    Receives the number of messages written.
+ *  @param      PpunDroppedCount    Receives the number of messages dropped since the last call.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function.
+ *  @retval     RC_E_FAIL           The log ring is not enabled or memory allocation failed.
+ */
+_Check_return_
+unsigned int
+Logging_DrainRing(
+    _Out_opt_   wchar_t*        PwszText,
+    _Inout_     unsigned int*   PpunTextCapacity,
+    _Out_       unsigned int*   PpunMessageCount,
+    _Out_       unsigned int*   PpunDroppedCount)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    wchar_t* pwszMessage = NULL;
+
+    do
+    {
+        unsigned int unHead = s_unLogRingHead;
+        unsigned int unIndex = 0;
+        unsigned int unCount = 0;
+
+        if (NULL == PpunTextCapacity || NULL == PpunMessageCount || NULL == PpunDroppedCount || (NULL != PwszText && 0 == *PpunTextCapacity))
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        *PpunMessageCount = 0;
+        *PpunDroppedCount = 0;
+
+        if (NULL == s_pbLogRing)
+            break;
+
+        pwszMessage = (wchar_t*)Platform_MemoryAllocateZero(LOGGING_MESSAGE_CAPACITY * sizeof(wchar_t));
+        if (NULL == pwszMessage)
+            break;
+
+        // Messages logged while formatting (e.g. errors) are dropped
+        s_fLogRingDraining = TRUE;
+        unReturnValue = RC_SUCCESS;
+        for (unIndex = s_unLogRingCount; unIndex > 0; unIndex--)
+        {
+            unsigned int unSize = LOGGING_MESSAGE_CAPACITY;
+            const IfxLogRecord* pRecord = Logging_RingOldest();
+
+            unReturnValue = Logging_RingFormatRecord(pRecord, pwszMessage, &unSize);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                // Skip a record which cannot be formatted
+                unSize = 0;
+                unReturnValue = RC_SUCCESS;
+            }
+
+            if (NULL == PwszText)
+            {
+                // Only determine the required capacity
+                s_unLogRingHead += pRecord->unSize;
+                unCount += unSize;
+                continue;
+            }
+
+            // Keep messages which do not fit into the buffer
+            if (unCount + unSize + 1 > *PpunTextCapacity)
+                break;
+
+            CopyMem(&PwszText[unCount], pwszMessage, unSize * sizeof(wchar_t));
+            unCount += unSize;
+            (*PpunMessageCount)++;
+            Logging_RingRemoveOldest();
+        }
+        s_fLogRingDraining = FALSE;
+
+        if (NULL == PwszText)
+        {
+            // Restore the read position
+            s_unLogRingHead = unHead;
+            *PpunTextCapacity = unCount + 1;
+            *PpunMessageCount = s_unLogRingCount;
+            *PpunDroppedCount = s_unLogRingDropped;
+            break;
+        }
+
+        PwszText[unCount] = L'\0';
+        *PpunTextCapacity = unCount + 1;
+        *PpunDroppedCount = s_unLogRingDropped;
+        s_unLogRingDropped = 0;
+    }
+    WHILE_FALSE_END;
+
+    Platform_MemoryFree((void**)&pwszMessage);
+
+    return unReturnValue;
+}
+
 /**
  *  @brief      Logging function
  *  @details    Logs all messages for logging levels 0 - 3 in case a logging callback function has been set by the caller of the driver.
@@ -45,20 +636,58 @@ Logging_WriteLog(
     UNREFERENCED_PARAMETER(PszCurrentFunction);
     do
     {
+        // Record the message in the log ring, it is formatted when the log ring is read
+        if (NULL != s_pbLogRing && PunLoggingLevel <= 3 && NULL != PwszLoggingMessage)
+        {
+            BOOL fRecorded = FALSE;
+            va_list argptr;
+
+            if (s_fLogRingDraining)
+            {
+                s_unLogRingDropped++;
+                break;
+            }
+
+            va_start(argptr, PwszLoggingMessage);
+            fRecorded = Logging_RingRecordMessage(PunLoggingLevel, PwszLoggingMessage, argptr);
+            va_end(argptr);
+
+            if (!fRecorded)
+            {
+                // Record the formatted message instead
+                unsigned int unSize = RG_LEN(s_wszMessage);
+                if (g_fInLogging)
+                {
+                    s_unLogRingDropped++;
+                    break;
+                }
+
+                g_fInLogging = TRUE;
+                va_start(argptr, PwszLoggingMessage);
+                if (RC_SUCCESS == Platform_StringFormatV(s_wszMessage, &unSize, PwszLoggingMessage, argptr))
+                    Logging_RingRecordText(PunLoggingLevel, s_wszMessage, unSize);
+                va_end(argptr);
+                g_fInLogging = FALSE;
+            }
+            break;
+        }
+
         if (g_pPrivateData->pfnLogCallback != NULL && PunLoggingLevel <= 3)
         {
             if (NULL != PwszLoggingMessage)
             {
-                // Skip formating if an empty line should be logged
-                if (PwszLoggingMessage[0] != L'\0')
+                // Skip formating if an empty line should be logged or the message buffer is in use (by a message logged
+                // while formatting or from within the logging callback function)
+                if (PwszLoggingMessage[0] != L'\0' && !g_fInLogging)
                 {
-                    wchar_t wszMessage[6144];
-                    unsigned int unMessageSize = RG_LEN(wszMessage);
+                    wchar_t* wszMessage = s_wszMessage;
+                    unsigned int unMessageSize = RG_LEN(s_wszMessage);
                     unsigned int unSize = unMessageSize;
                     unsigned int unCount = 0;
                     unsigned int unReturnValue = RC_E_FAIL;
                     va_list argptr;
-                    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszMessage, RG_LEN(wszMessage)));
+                    g_fInLogging = TRUE;
+                    IGNORE_RETURN_VALUE(Platform_StringSetZero(wszMessage, unMessageSize));
 
                     if (g_pPrivateData->fLogTimeStamps)
                     {
@@ -83,19 +712,21 @@ Logging_WriteLog(
                     va_start(argptr, PwszLoggingMessage);
                     unReturnValue = Platform_StringFormatV(&wszMessage[unCount], &unSize, PwszLoggingMessage, argptr);
                     va_end(argptr);
-                    if (RC_SUCCESS != unReturnValue)
-                        break;
-
-                    unCount += unSize;
-                    unSize = unMessageSize - unCount;
-                    unReturnValue = Platform_StringFormat(&wszMessage[unCount], &unSize, L"\n");
-                    if (RC_SUCCESS != unReturnValue)
-                        break;
+                    if (RC_SUCCESS == unReturnValue)
+                    {
+                        unCount += unSize;
+                        unSize = unMessageSize - unCount;
+                        unReturnValue = Platform_StringFormat(&wszMessage[unCount], &unSize, L"\n");
+                    }
 
-                    unCount += unSize + 1;
+                    if (RC_SUCCESS == unReturnValue)
+                    {
+                        unCount += unSize + 1;
 
-                    // Log the message
-                    g_pPrivateData->pfnLogCallback(unCount * sizeof(CHAR16), (CHAR16*)wszMessage);
+                        // Log the message
+                        g_pPrivateData->pfnLogCallback(unCount * sizeof(CHAR16), (CHAR16*)wszMessage);
+                    }
+                    g_fInLogging = FALSE;
                 }
             }
         }
@@ -129,14 +760,27 @@ Logging_WriteHex(
         if (NULL == PrgbHexData || 0 == PunSize)
             break;
 
-        if (g_pPrivateData->pfnLogCallback != NULL && PunLoggingLevel <= 3)
+        // Record the data in the log ring, it is formatted when the log ring is read
+        if (NULL != s_pbLogRing && PunLoggingLevel <= 3)
+        {
+            if (s_fLogRingDraining)
+                s_unLogRingDropped++;
+            else
+                Logging_RingRecordHex(PunLoggingLevel, PrgbHexData, PunSize);
+            break;
+        }
+
+        // The message buffer is in use if the data is logged while formatting or from within the logging callback function
+        if (g_pPrivateData->pfnLogCallback != NULL && PunLoggingLevel <= 3 && !g_fInLogging)
         {
-            wchar_t wszMessage[6144];
-            unsigned int unMessageSize = RG_LEN(wszMessage);
+            wchar_t* wszMessage = s_wszMessage;
+            unsigned int unMessageSize = LOGGING_HEX_CHUNK_SIZE;
             unsigned int unSize = unMessageSize;
             unsigned int unCount = 0;
+            unsigned int unOffset = 0;
             unsigned int unReturnValue = RC_E_FAIL;
-            IGNORE_RETURN_VALUE(Platform_StringSetZero(wszMessage, RG_LEN(wszMessage)));
+            g_fInLogging = TRUE;
+            IGNORE_RETURN_VALUE(Platform_StringSetZero(wszMessage, unMessageSize));
 
             if (g_pPrivateData->fLogTimeStamps)
             {
@@ -154,7 +798,10 @@ Logging_WriteHex(
                     // does not interpret \n as \r\n in other string copy or concatenation functions)
                     unReturnValue = Platform_StringFormat(&wszMessage[unCount], &unSize, L"\n");
                     if (RC_SUCCESS != unReturnValue)
+                    {
+                        g_fInLogging = FALSE;
                         break;
+                    }
                 }
             }
             else
@@ -162,24 +809,32 @@ Logging_WriteHex(
                 // Skip time-stamp
                 unSize = 0;
             }
-
-            // Format Message
             unCount += unSize;
-            unSize = unMessageSize - unCount;
-            // Convert hex data to string
-            unReturnValue = Utility_StringWriteHex(PrgbHexData, PunSize, &wszMessage[unCount], &unSize);
-            if (RC_SUCCESS != unReturnValue)
-                break;
 
-            unCount += unSize;
-            unSize = unMessageSize - unCount;
-            unReturnValue = Platform_StringFormat(&wszMessage[unCount], &unSize, L"\n");
-            if (RC_SUCCESS != unReturnValue)
-                break;
+            // Log the hex dump in chunks of complete lines, each chunk continues the previous one
+            while (unOffset < PunSize)
+            {
+                // Keep room for the closing CR LF
+                unSize = unMessageSize - unCount - 2;
+                unReturnValue = Utility_StringWriteHexPart(PrgbHexData, PunSize, &unOffset, &wszMessage[unCount], &unSize);
+                if (RC_SUCCESS != unReturnValue)
+                    break;
+                unCount += unSize;
 
-            unCount += unSize + 1;
-            // Log the message
-            g_pPrivateData->pfnLogCallback(unCount * sizeof(CHAR16), (CHAR16*)wszMessage);
+                if (unOffset == PunSize)
+                {
+                    unSize = unMessageSize - unCount;
+                    unReturnValue = Platform_StringFormat(&wszMessage[unCount], &unSize, L"\n");
+                    if (RC_SUCCESS != unReturnValue)
+                        break;
+                    unCount += unSize;
+                }
+
+                // Log the message
+                g_pPrivateData->pfnLogCallback((unCount + 1) * sizeof(CHAR16), (CHAR16*)wszMessage);
+                unCount = 0;
+            }
+            g_fInLogging = FALSE;
         }
     }
     WHILE_FALSE_END;
@@ -22,7 +22,8 @@ extern "C" {
 /// Define for locality configuration setting property
 #define PROPERTY_LOCALITY               L"Locality"
 /// Define for locality request.
-/// If TRUE, locality is requested for use once before first TPM command and released after last TPM response.
+/// If TRUE (default), locality is requested for use once before first TPM command and released after last TPM response.
+/// In between it is only yielded while another locality has a pending request for use.
 /// If FALSE, locality is requested before each TPM command and released after each TPM response.
 #define PROPERTY_KEEP_LOCALITY_ACTIVE   L"KeepLocalityActive"
 /// Define for firmware update abandon mode property
@@ -32,6 +33,10 @@ extern "C" {
 #define ABANDON_UPDATE_NO_ACTION                (UINT32)0x00000000
 /// Define for calling abandon update if FieldUpgradeManifestVendor command fails
 #define ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL    (UINT32)0x00000001
+/// Define for firmware block streaming property.
+/// If TRUE, the next firmware block is marshaled while the TPM processes the current one.
+/// If FALSE, each firmware block is marshaled and sent strictly after the previous block was completed.
+#define PROPERTY_STREAMING_UPDATE               L"StreamingUpdate"
 
 #ifdef __cplusplus
 }
@@ -14,6 +14,34 @@
 
 #include <Uefi.h>
 
+/**
+ *  @brief  GUID of the EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL installed on the image handle of the Infineon TPM Firmware Update Driver.
+ *          A caller locates a loaded driver with LocateHandleBuffer(ByProtocol) or LocateProtocol.
+ */
+#define EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_GUID \
+    { 0xc651a620, 0x5c5a, 0x4128, {0xa0, 0xcb, 0x9a, 0x5c, 0x47, 0x30, 0x00, 0x60} }
+
+/**
+ *  @brief  Revision of the EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL interface.
+ */
+#define EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_REVISION  0x00010000
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver discovery protocol
+ *  @details    The protocol identifies the driver. EFI_FIRMWARE_MANAGEMENT_PROTOCOL and EFI_ADAPTER_INFORMATION_PROTOCOL of the
+ *              driver are installed on ImageHandle.
+ */
+typedef struct {
+    /**
+     *  @brief  Revision of the interface (EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL_REVISION).
+     */
+    UINT32      Revision;
+    /**
+     *  @brief  Image handle of the driver.
+     */
+    EFI_HANDLE  ImageHandle;
+} EFI_IFXTPM_UPDATE_DRIVER_PROTOCOL;
+
 /*
  *  Driver specific flags and definitions for EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation function.
  */
@@ -100,6 +128,30 @@ typedef struct {
     UINT32      SessionHandle;
 } EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1;
 
+/**
+ *  @brief  Version of the EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1 structure.
+ */
+#define EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_VERSION_1  1
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure may be passed as VendorCode to EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage() instead of setting
+ *              the policy session handle with EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1 beforehand. It saves the
+ *              EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation() call and its TPM state query. The session handle is not
+ *              looked up in the TPM, the TPM validates it when the firmware update is started.
+ */
+typedef struct {
+    /**
+     *  @brief  Version of the structure, must be EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_VERSION_1.
+     */
+    UINT32      Version;
+    /**
+     *  @brief  TPM2.0 authorized policy session handle or 0 to let the driver start the default policy session. It
+     *          replaces a session handle set with EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1 and is ignored for TPM1.2.
+     */
+    UINT32      SessionHandle;
+} EFI_IFXTPM_SET_IMAGE_VENDOR_CODE_1;
+
 /**
  *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
  *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1 structure.
@@ -202,6 +254,707 @@ typedef struct {
     UINT8       Internal2[66];
 } EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1;
 
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1_GUID \
+    { 0x77edb988, 0xd259, 0x459f, {0x8e, 0x62, 0xd0, 0x74, 0xbb, 0x1d, 0x19, 0x31} }
+
+/**
+ *  @brief  Number of buckets of the TPM command latency histogram.
+ */
+#define EFI_IFXTPM_LATENCY_HISTOGRAM_BUCKETS    16
+
+/**
+ *  @brief  Upper bound of the first TPM command latency histogram bucket in microseconds.
+ *          Each following bucket doubles the bound, the last bucket is unbounded.
+ */
+#define EFI_IFXTPM_LATENCY_FIRST_BUCKET_US      128
+
+/**
+ *  @brief  Maximum number of TPM command codes in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1.
+ */
+#define EFI_IFXTPM_LATENCY_MAX_COMMANDS         24
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the latency statistics of one TPM command code. All durations are given
+ *              in microseconds. The latency covers the time from writing the command to the TPM until its response is read.
+ *              It is split into the send phase (transport to the TPM), the wait phase (TPM processing) and the receive
+ *              phase (transport from the TPM). The remainder of TotalUs is spent by the host, e.g. preparing the next
+ *              firmware block while the TPM processes the current one.
+ */
+typedef struct {
+    /**
+     *  @brief  TPM command code (0 for commands too short to contain a command code).
+     */
+    UINT32      CommandCode;
+    /**
+     *  @brief  Number of measured commands.
+     */
+    UINT32      Count;
+    /**
+     *  @brief  Number of measured commands which failed on the transport layer.
+     */
+    UINT32      Failures;
+    /**
+     *  @brief  Number of times a command was sent again after a transient transport error. Each attempt is measured.
+     */
+    UINT32      Retries;
+    /**
+     *  @brief  Minimum latency.
+     */
+    UINT64      MinUs;
+    /**
+     *  @brief  Maximum latency.
+     */
+    UINT64      MaxUs;
+    /**
+     *  @brief  Mean latency.
+     */
+    UINT64      MeanUs;
+    /**
+     *  @brief  Sum of all latencies.
+     */
+    UINT64      TotalUs;
+    /**
+     *  @brief  Sum of the send phases.
+     */
+    UINT64      SendUs;
+    /**
+     *  @brief  Sum of the phases waiting for the TPM to signal that the response is available.
+     */
+    UINT64      WaitUs;
+    /**
+     *  @brief  Sum of the receive phases.
+     */
+    UINT64      ReceiveUs;
+    /**
+     *  @brief  Latency histogram. Bucket 0 counts latencies below EFI_IFXTPM_LATENCY_FIRST_BUCKET_US,
+     *          bucket n counts latencies below EFI_IFXTPM_LATENCY_FIRST_BUCKET_US << n that do not fit into bucket n - 1.
+     */
+    UINT32      Histogram[EFI_IFXTPM_LATENCY_HISTOGRAM_BUCKETS];
+} EFI_IFXTPM_FIRMWARE_UPDATE_LATENCY_ENTRY_1;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the latency statistics of all TPM commands sent since the driver was loaded.
+ *              The durations are 0 if the platform does not provide a performance counter.
+ */
+typedef struct {
+    /**
+     *  @brief  Number of valid entries in Commands.
+     */
+    UINT32      CommandCount;
+    /**
+     *  @brief  Number of measured commands which are not contained in Commands because the table was full.
+     */
+    UINT32      DroppedCount;
+    /**
+     *  @brief  Latency statistics per TPM command code in order of first occurrence.
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_LATENCY_ENTRY_1  Commands[EFI_IFXTPM_LATENCY_MAX_COMMANDS];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LATENCY_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation and GetInformation functions.
+ *          SetInformation: Caller must pass an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1 structure.
+ *          GetInformation: Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1_GUID \
+    { 0x3f1d6a42, 0x8c5e, 0x4b97, {0xa1, 0x6d, 0x52, 0xe9, 0x0b, 0x7c, 0x44, 0x18} }
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to configure the log ring of the Infineon TPM Firmware Update Driver. While the log ring
+ *              is enabled, log messages are recorded in memory in binary form instead of being passed to the logging callback.
+ *              They are only formatted when the caller reads them with EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation().
+ *              If the log ring is full the oldest messages are dropped.
+ */
+typedef struct {
+    /**
+     *  @brief  Set it to TRUE to enable the log ring.\n
+     *          Set it to FALSE to disable the log ring and discard all messages not read yet.
+     */
+    BOOLEAN     Enable;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOG_RING_1;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to read the messages recorded in the log ring. The messages returned are removed from the
+ *              log ring. If time stamps are enabled (see EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_LOGGING_1), each message starts
+ *              with the time since the log ring was enabled in the format [seconds.microseconds].
+ */
+typedef struct {
+    /**
+     *  @brief  Number of messages in Text.
+     */
+    UINT32      MessageCount;
+    /**
+     *  @brief  Number of messages dropped since the log ring was read last, e.g. because the log ring was full.
+     */
+    UINT32      DroppedCount;
+    /**
+     *  @brief  A Null-terminated Unicode string that contains the messages, each one terminated by a new line.
+     *          The string fills the remainder of the information block.
+     */
+    CHAR16      Text[1];
+} EFI_IFXTPM_FIRMWARE_UPDATE_LOG_RING_CONTENTS_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1_GUID \
+    { 0x5b8e2c71, 0x4d0a, 0x4f63, {0x9e, 0x27, 0xc4, 0x81, 0x3a, 0x6f, 0xd5, 0x0b} }
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the complete firmware update status of the TPM with a single request. It combines the
+ *              version name of EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo() with the information of
+ *              EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1_GUID, EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1_GUID and
+ *              EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1_GUID. The TPM state is determined only once for all parts.
+ */
+typedef struct {
+    /**
+     *  @brief  TPM version information as returned in EFI_FIRMWARE_IMAGE_DESCRIPTOR.VersionName.
+     */
+    CHAR16      VersionName[64];
+    /**
+     *  @brief  TPM firmware update counters. UpdateCounter is 0xFFFFFFFF if it cannot be read in the current TPM state,
+     *          e.g. if a restart is required after a firmware update.
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_COUNTERS_1        Counters;
+    /**
+     *  @brief  Flag indicating if OperationMode is filled. The operation mode is only available on SLB 9672.
+     */
+    BOOLEAN     OperationModeValid;
+    /**
+     *  @brief  TPM2.0 operation mode (only SLB 9672).
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_OPERATION_MODE_1  OperationMode;
+    /**
+     *  @brief  Flag indicating if Details is filled. The firmware update details are only available on SLB 9672.
+     */
+    BOOLEAN     DetailsValid;
+    /**
+     *  @brief  Firmware update details (only SLB 9672).
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DETAILS_1         Details;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STATUS_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation function.
+ *          Caller must pass an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1_GUID \
+    { 0x923a3c73, 0x8f21, 0x4e93, {0x93, 0xa4, 0xa5, 0x1c, 0xc8, 0xde, 0xfc, 0xfd} }
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to answer all following TPM commands from a recorded command/response trace instead of the TPM.
+ *              It allows measuring the host-side cost of the update flow without a TPM and without consuming firmware update counters.
+ *              The trace is a sequence of records. Each record is an EFI_IFXTPM_FIRMWARE_UPDATE_REPLAY_RECORD_1 header followed by the
+ *              request bytes and the response bytes. A command is answered with the response of the next record if its command code matches
+ *              the command code of the record request. Other request bytes are not compared because nonces and session values differ between runs.
+ */
+typedef struct {
+    /**
+     *  @brief  Set it to TRUE to load the trace and replay it from the first record.\n
+     *          Set it to FALSE to discard the trace and access the TPM again.
+     */
+    BOOLEAN     Enable;
+    /**
+     *  @brief  Scale of the recorded command durations in percent, e.g. 100 to replay with the recorded latency or 0 to replay without it.
+     */
+    UINT32      LatencyScalePercent;
+    /**
+     *  @brief  Additional latency in microseconds injected for each command.
+     */
+    UINT32      ExtraLatencyUs;
+    /**
+     *  @brief  Size of Trace in bytes (ignored if Enable is FALSE).
+     */
+    UINT32      TraceSize;
+    /**
+     *  @brief  The trace. It fills the remainder of the information block.
+     */
+    UINT8       Trace[1];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    Header of a record of the trace in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REPLAY_1. All fields are little endian.
+ */
+typedef struct {
+    /**
+     *  @brief  Size of the request bytes following the header.
+     */
+    UINT32      RequestSize;
+    /**
+     *  @brief  Size of the response bytes following the request bytes.
+     */
+    UINT32      ResponseSize;
+    /**
+     *  @brief  Recorded duration of the command in microseconds.
+     */
+    UINT32      DurationUs;
+} EFI_IFXTPM_FIRMWARE_UPDATE_REPLAY_RECORD_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1_GUID \
+    { 0x3b26927f, 0xdacc, 0x4352, {0x93, 0xc6, 0x66, 0x5f, 0x2a, 0x5d, 0x60, 0x31} }
+
+/**
+ *  @brief  Register trace operations in EFI_IFXTPM_FIRMWARE_UPDATE_REGISTER_TRACE_RECORD_1.
+ */
+#define EFI_IFXTPM_REGISTER_TRACE_READ_BYTE     0x01
+#define EFI_IFXTPM_REGISTER_TRACE_WRITE_BYTE    0x02
+#define EFI_IFXTPM_REGISTER_TRACE_READ_WORD     0x03
+#define EFI_IFXTPM_REGISTER_TRACE_WRITE_WORD    0x04
+#define EFI_IFXTPM_REGISTER_TRACE_READ_BLOCK    0x05
+#define EFI_IFXTPM_REGISTER_TRACE_WRITE_BLOCK   0x06
+
+/**
+ *  @brief  Flag in EFI_IFXTPM_FIRMWARE_UPDATE_REGISTER_TRACE_RECORD_1.Status marking a failed register access.
+ */
+#define EFI_IFXTPM_REGISTER_TRACE_STATUS_ERROR  0x80
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure describes one TPM register access of the driver.
+ */
+typedef struct {
+    /**
+     *  @brief  Start of the access in microseconds of the platform performance counter (0 if the platform does not provide one).
+     */
+    UINT64      TimeUs;
+    /**
+     *  @brief  TPM register address.
+     */
+    UINT16      Address;
+    /**
+     *  @brief  Operation (EFI_IFXTPM_REGISTER_TRACE_READ_BYTE, ...).
+     */
+    UINT8       Operation;
+    /**
+     *  @brief  Low 7 bits of the EFI_STATUS code of the bus transaction, EFI_IFXTPM_REGISTER_TRACE_STATUS_ERROR is set for errors.
+     *          0 if the access succeeded.
+     */
+    UINT8       Status;
+    /**
+     *  @brief  Value read or written. Number of bytes for block operations.
+     */
+    UINT32      Value;
+} EFI_IFXTPM_FIRMWARE_UPDATE_REGISTER_TRACE_RECORD_1;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to read the last TPM register accesses of the driver, e.g. to analyze a slow or failed firmware
+ *              update afterwards. The driver always records the register accesses in a ring of fixed size, independent of the logging
+ *              configuration. Reading the records does not remove them from the ring and does not access the TPM.
+ */
+typedef struct {
+    /**
+     *  @brief  Number of records in Records.
+     */
+    UINT32      RecordCount;
+    /**
+     *  @brief  Number of register accesses overwritten in the ring since the driver was loaded.
+     */
+    UINT32      DroppedCount;
+    /**
+     *  @brief  Register accesses from oldest to newest. The array fills the remainder of the information block.
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_REGISTER_TRACE_RECORD_1  Records[1];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_REGISTER_TRACE_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1 structure.
+ *          The information type is only supported by drivers built with IFXTPMUPDATE_STACK_CHECK.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1_GUID \
+    { 0x17debc33, 0x933f, 0x4160, {0x9a, 0xbb, 0x09, 0x60, 0x8c, 0x20, 0xfd, 0x89} }
+
+/**
+ *  @brief  Entry points in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1.Entries.
+ */
+#define EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY          0
+#define EFI_IFXTPM_STACK_USAGE_GET_IMAGE_INFO        1
+#define EFI_IFXTPM_STACK_USAGE_SET_IMAGE             2
+#define EFI_IFXTPM_STACK_USAGE_CHECK_IMAGE           3
+#define EFI_IFXTPM_STACK_USAGE_GET_INFORMATION       4
+#define EFI_IFXTPM_STACK_USAGE_SET_INFORMATION       5
+#define EFI_IFXTPM_STACK_USAGE_GET_SUPPORTED_TYPES   6
+#define EFI_IFXTPM_STACK_USAGE_ENTRY_COUNT           7
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure describes the stack usage of one entry point of the driver.
+ */
+typedef struct {
+    /**
+     *  @brief  Number of calls of the entry point. Calls from within another entry point of the driver are not counted.
+     */
+    UINT32      CallCount;
+    /**
+     *  @brief  Highest number of stack bytes used by a call of the entry point (including the functions it called).
+     *          A value equal to EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1.PaintedSize means at least that many bytes.
+     */
+    UINT32      HighWater;
+} EFI_IFXTPM_FIRMWARE_UPDATE_STACK_USAGE_ENTRY_1;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to read the stack high-water marks of the driver entry points. On each call of an entry point the
+ *              driver paints the stack below the caller with a pattern and determines the deepest overwritten byte when the entry point
+ *              returns. The stack of the caller must have PaintedSize bytes free.
+ */
+typedef struct {
+    /**
+     *  @brief  Number of stack bytes painted below each entry point.
+     */
+    UINT32      PaintedSize;
+    /**
+     *  @brief  Stack usage per entry point, indexed by EFI_IFXTPM_STACK_USAGE_DRIVER_ENTRY, ...
+     */
+    EFI_IFXTPM_FIRMWARE_UPDATE_STACK_USAGE_ENTRY_1  Entries[EFI_IFXTPM_STACK_USAGE_ENTRY_COUNT];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_STACK_USAGE_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1_GUID \
+    { 0xddd1056d, 0x809f, 0x495e, {0x83, 0xd2, 0xdc, 0xc6, 0x97, 0x78, 0x1e, 0x95} }
+
+/**
+ *  @brief  Value of EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1.EstimatedRemainingMs if no estimate is available yet.
+ */
+#define EFI_IFXTPM_TRANSFER_ESTIMATE_UNKNOWN    0xFFFFFFFF
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the progress of the firmware transfer of the current or last
+ *              EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage call. The values are updated whenever the TPM acknowledges a firmware block.
+ *              The information type does not access the TPM and can be queried from the progress callback function or from a
+ *              timer event while SetImage is running.
+ */
+typedef struct {
+    /**
+     *  @brief  1 while the firmware blocks are sent, 0 otherwise.
+     */
+    UINT32      Active;
+    /**
+     *  @brief  Number of firmware bytes to send.
+     */
+    UINT32      TotalBytes;
+    /**
+     *  @brief  Number of firmware bytes acknowledged by the TPM.
+     */
+    UINT32      BytesSent;
+    /**
+     *  @brief  Number of firmware blocks acknowledged by the TPM.
+     */
+    UINT32      BlocksAcknowledged;
+    /**
+     *  @brief  Throughput of the last acknowledged block in bytes per second.
+     */
+    UINT32      CurrentThroughput;
+    /**
+     *  @brief  Average throughput since the transfer started in bytes per second.
+     */
+    UINT32      AverageThroughput;
+    /**
+     *  @brief  Time since the transfer started in milliseconds (at the last acknowledged block).
+     */
+    UINT32      ElapsedMs;
+    /**
+     *  @brief  Estimated time to completion of the transfer in milliseconds or EFI_IFXTPM_TRANSFER_ESTIMATE_UNKNOWN.
+     */
+    UINT32      EstimatedRemainingMs;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TRANSFER_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1_GUID \
+    { 0x71c7b9c5, 0x271f, 0x4d32, {0x8d, 0x0f, 0xdd, 0xe0, 0xbc, 0x6c, 0x59, 0x4f} }
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the estimated duration of a firmware update with the image passed to the last
+ *              EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage call. The estimate is the number of manifest and firmware blocks times
+ *              the per-block latency plus the fixed waits for the TPM mode switches. The per-block latency is measured during a
+ *              firmware transfer; before the first transfer since the driver was loaded a calibrated value is used.
+ *              The information type does not access the TPM.
+ */
+typedef struct {
+    /**
+     *  @brief  1 if the estimate is available, 0 if no valid image was checked with EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage.
+     */
+    UINT32      Valid;
+    /**
+     *  @brief  1 if the per-block latency was measured, 0 if the calibrated value is used.
+     */
+    UINT32      Measured;
+    /**
+     *  @brief  Number of manifest blocks.
+     */
+    UINT32      ManifestBlocks;
+    /**
+     *  @brief  Number of firmware blocks.
+     */
+    UINT32      FirmwareBlocks;
+    /**
+     *  @brief  Size of a block in bytes.
+     */
+    UINT32      BlockSize;
+    /**
+     *  @brief  Latency of a block in microseconds.
+     */
+    UINT32      BlockLatencyUs;
+    /**
+     *  @brief  Sum of the fixed waits for the TPM mode switches in milliseconds.
+     */
+    UINT32      FixedWaitMs;
+    /**
+     *  @brief  Estimated duration of the firmware update in milliseconds.
+     */
+    UINT32      EstimatedDurationMs;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DURATION_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1_GUID \
+    { 0x096bcf66, 0xc34a, 0x40fe, {0x8a, 0x7c, 0x6e, 0xd4, 0x42, 0x17, 0x06, 0x2f} }
+
+/**
+ *  @brief  Phases in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1.PhaseUs.
+ */
+#define EFI_IFXTPM_UPDATE_PHASE_VERIFY          0
+#define EFI_IFXTPM_UPDATE_PHASE_STATE           1
+#define EFI_IFXTPM_UPDATE_PHASE_POLICY          2
+#define EFI_IFXTPM_UPDATE_PHASE_START           3
+#define EFI_IFXTPM_UPDATE_PHASE_BOOT_LOADER     4
+#define EFI_IFXTPM_UPDATE_PHASE_MANIFEST        5
+#define EFI_IFXTPM_UPDATE_PHASE_FIRMWARE        6
+#define EFI_IFXTPM_UPDATE_PHASE_FINALIZE        7
+#define EFI_IFXTPM_UPDATE_PHASE_COUNT           8
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to get the time spent in each phase of the current or last
+ *              EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage call: image verification, TPM state determination, policy session,
+ *              start of the field upgrade, wait for boot loader mode, manifest transfer, firmware transfer and finalization.
+ *              The information type does not access the TPM.
+ */
+typedef struct {
+    /**
+     *  @brief  1 while SetImage is running, 0 otherwise.
+     */
+    UINT32      Active;
+    /**
+     *  @brief  Phase measured at the moment (EFI_IFXTPM_UPDATE_PHASE_VERIFY, ...) or 0xFFFFFFFF if SetImage is not running.
+     */
+    UINT32      CurrentPhase;
+    /**
+     *  @brief  Time since SetImage started to verify the image in microseconds (at the last phase switch).
+     */
+    UINT64      TotalUs;
+    /**
+     *  @brief  Time spent in each phase in microseconds, indexed by EFI_IFXTPM_UPDATE_PHASE_VERIFY, ...
+     */
+    UINT64      PhaseUs[EFI_IFXTPM_UPDATE_PHASE_COUNT];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_PHASE_TIMING_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation and EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation function.
+ *          Caller must pass and will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1_GUID \
+    { 0x1832ef22, 0x68ee, 0x4c6b, {0x90, 0x4e, 0xe7, 0x7f, 0x9e, 0x01, 0x34, 0x14} }
+
+/**
+ *  @brief  Commands in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1.Command.
+ */
+#define EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START      1
+#define EFI_IFXTPM_UPDATE_ENGINE_COMMAND_CANCEL     2
+
+/**
+ *  @brief  States in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1.State.
+ */
+#define EFI_IFXTPM_UPDATE_STATE_IDLE                0
+#define EFI_IFXTPM_UPDATE_STATE_VERIFY              1
+#define EFI_IFXTPM_UPDATE_STATE_PROBE               2
+#define EFI_IFXTPM_UPDATE_STATE_POLICY              3
+#define EFI_IFXTPM_UPDATE_STATE_START               4
+#define EFI_IFXTPM_UPDATE_STATE_WAIT_BOOT_LOADER    5
+#define EFI_IFXTPM_UPDATE_STATE_MANIFEST            6
+#define EFI_IFXTPM_UPDATE_STATE_DATA                7
+#define EFI_IFXTPM_UPDATE_STATE_WAIT_FINALIZE       8
+#define EFI_IFXTPM_UPDATE_STATE_FINALIZE            9
+#define EFI_IFXTPM_UPDATE_STATE_DONE                10
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to run a firmware update without blocking the caller. SetInformation with Command
+ *              EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START checks the image and starts the update, the policy session set with
+ *              EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_TPM20_1_GUID is used (a default policy session is created if it is 0).
+ *              Each GetInformation call performs one step of the update (e.g. one firmware block) and returns the state.
+ *              The caller should wait NextPollMs milliseconds before the next GetInformation call. The image must stay
+ *              available and the TPM is reserved for the update until State is EFI_IFXTPM_UPDATE_STATE_DONE.
+ */
+typedef struct {
+    /**
+     *  @brief  SetInformation: EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START or EFI_IFXTPM_UPDATE_ENGINE_COMMAND_CANCEL. Ignored by GetInformation.
+     */
+    UINT32      Command;
+    /**
+     *  @brief  GetInformation: state of the update (EFI_IFXTPM_UPDATE_STATE_IDLE, ...).
+     */
+    UINT32      State;
+    /**
+     *  @brief  GetInformation: last reported progress in percent.
+     */
+    UINT32      Progress;
+    /**
+     *  @brief  GetInformation: time in milliseconds to wait before the next GetInformation call.
+     */
+    UINT32      NextPollMs;
+    /**
+     *  @brief  GetInformation: result of the update as returned by SetImage, valid in state EFI_IFXTPM_UPDATE_STATE_DONE.
+     */
+    EFI_STATUS  Status;
+    /**
+     *  @brief  SetInformation with EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START: size of the firmware image in bytes.
+     */
+    UINT64      ImageSize;
+    /**
+     *  @brief  SetInformation with EFI_IFXTPM_UPDATE_ENGINE_COMMAND_START: the firmware image.
+     */
+    CONST VOID* Image;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_ENGINE_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation function.
+ *          Caller will receive an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1_GUID \
+    { 0x5d3a8f41, 0x2b7c, 0x4e19, {0xa6, 0x0d, 0x93, 0x1f, 0xc4, 0x58, 0x7e, 0x22} }
+
+/**
+ *  @brief  Maximum number of entries in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1.Entries.
+ */
+#define EFI_IFXTPM_UPDATE_HISTORY_SIZE          8
+
+/**
+ *  @brief  Capacity of the version strings in EFI_IFXTPM_UPDATE_HISTORY_ENTRY in characters (including null-termination).
+ */
+#define EFI_IFXTPM_UPDATE_HISTORY_VERSION_SIZE  16
+
+/**
+ *  @brief  Firmware update attempt in EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1.
+ */
+typedef struct {
+    /**
+     *  @brief  Sequence number of the attempt, counting from 1.
+     */
+    UINT32      Sequence;
+    /**
+     *  @brief  Result of the attempt as returned by SetImage.
+     */
+    EFI_STATUS  Status;
+    /**
+     *  @brief  Driver specific result code of the attempt (0 on success).
+     */
+    UINT32      Result;
+    /**
+     *  @brief  State in which the attempt failed (EFI_IFXTPM_UPDATE_STATE_VERIFY, ...) or EFI_IFXTPM_UPDATE_STATE_DONE on success.
+     */
+    UINT32      LastState;
+    /**
+     *  @brief  Fingerprint of the firmware image.
+     */
+    UINT32      ImageFingerprint;
+    /**
+     *  @brief  Size of the firmware image in bytes.
+     */
+    UINT32      ImageSize;
+    /**
+     *  @brief  Number of firmware blocks acknowledged by the TPM.
+     */
+    UINT32      BlockCount;
+    /**
+     *  @brief  Number of resent firmware blocks.
+     */
+    UINT32      BlockRetries;
+    /**
+     *  @brief  TPM firmware version before the attempt (empty string if it could not be read).
+     */
+    CHAR16      SourceVersion[EFI_IFXTPM_UPDATE_HISTORY_VERSION_SIZE];
+    /**
+     *  @brief  Target firmware version of the image (empty string if the image could not be parsed).
+     */
+    CHAR16      TargetVersion[EFI_IFXTPM_UPDATE_HISTORY_VERSION_SIZE];
+    /**
+     *  @brief  Time spent in each phase in milliseconds, indexed by EFI_IFXTPM_UPDATE_PHASE_VERIFY, ...
+     */
+    UINT32      PhaseMs[EFI_IFXTPM_UPDATE_PHASE_COUNT];
+} EFI_IFXTPM_UPDATE_HISTORY_ENTRY;
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to read the last firmware update attempts (SetImage or the update engine). The history
+ *              is kept in a non-volatile UEFI variable of the driver, so it survives the platform reset after the update and
+ *              does not depend on logging. The information type does not access the TPM.
+ */
+typedef struct {
+    /**
+     *  @brief  Number of attempts recorded since the history was created.
+     */
+    UINT32      TotalCount;
+    /**
+     *  @brief  Number of valid entries in Entries.
+     */
+    UINT32      Count;
+    /**
+     *  @brief  Recorded attempts, newest first.
+     */
+    EFI_IFXTPM_UPDATE_HISTORY_ENTRY Entries[EFI_IFXTPM_UPDATE_HISTORY_SIZE];
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_UPDATE_HISTORY_1;
+
+/**
+ *  @brief  Supported GUID for EFI_ADAPTER_INFORMATION_PROTOCOL.SetInformation function.
+ *          Caller must pass an EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1 structure.
+ */
+#define EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1_GUID \
+    { 0x8e4c2d19, 0x6a73, 0x4f0b, {0xb5, 0x2e, 0x1d, 0x97, 0xc0, 0x3a, 0x68, 0xf4} }
+
+/**
+ *  @brief      Infineon TPM Firmware Update Driver communication structure
+ *  @details    This structure is used to limit the time the query and check functions may spend on the TPM, e.g. for an
+ *              inventory in a boot phase with a fixed time budget. The deadline applies to each call of
+ *              EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo(), EFI_FIRMWARE_MANAGEMENT_PROTOCOL.CheckImage() and
+ *              EFI_ADAPTER_INFORMATION_PROTOCOL.GetInformation() for the information types which access the TPM. Once it
+ *              elapses, the call returns EFI_TIMEOUT together with the information read before, if the information type
+ *              supports partial results. A firmware update is not limited by the deadline.
+ */
+typedef struct {
+    /**
+     *  @brief  Time budget of a call in milliseconds. Set it to 0 to disable the deadline.
+     */
+    UINT32      DeadlineMs;
+} EFI_IFXTPM_FIRMWARE_UPDATE_DESCRIPTOR_DEADLINE_1;
+
 /*
  *  Driver specific flags and definitions for EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo function.
  */
@@ -0,0 +1,382 @@
+/**
+ *  @brief      Implements the error handling for the command line tool
+ *  @details    This module stores the last errors in a ring. In contrast to the driver the message is formatted when the error
+ *              is stored, because a va_list cannot be replayed later without a BASE_LIST.
+ *  @file       IFXTPMUpdateCli/Error.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Error.h"
+
+/// Number of records in the error ring
+#define ERROR_RING_CAPACITY             16
+
+/**
+ *  @brief      Error record
+ *  @details    An error is recorded with its formatted message.
+ */
+typedef struct tdIfxErrorRecord
+{
+    /// The internal error code
+    unsigned int    unInternalErrorCode;
+    /// The code line in the module where the error occurred
+    int             nOccurredInLine;
+    /// The module where the error occurred
+    const char*     szOccurredInModule;
+    /// The function in the module where the error occurred
+    const char*     szOccurredInFunction;
+    /// Flag indicating whether the record was already logged
+    BOOL            fLogged;
+    /// The formatted error message
+    wchar_t         wszMessage[MAX_MESSAGE_SIZE];
+} IfxErrorRecord;
+
+/// The error ring
+static IfxErrorRecord s_rgsErrorRing[ERROR_RING_CAPACITY];
+
+/// Index of the newest record in the error ring
+static unsigned int s_unErrorRingNewest = 0;
+
+/// Number of records in the error ring
+static unsigned int s_unErrorRingCount = 0;
+
+/// Error data of the newest record (filled by Error_GetStack)
+static IfxErrorData s_sErrorData;
+
+/**
+ *  @brief      Returns a record of the error ring
+ *  @details
+ *
+ *  @param      PunAge      Age of the record (0 for the newest one). Must be lower than s_unErrorRingCount.
+ *
+ *  @returns    Pointer to the record.
+ */
+static
+IfxErrorRecord*
+Error_RingRecord(
+    _In_    unsigned int    PunAge)
+{
+    return &s_rgsErrorRing[(s_unErrorRingNewest + ERROR_RING_CAPACITY - PunAge) % ERROR_RING_CAPACITY];
+}
+
+/**
+ *  @brief      Copies a module or function name into a wide character buffer
+ *  @details    The name is truncated if the buffer is too small.
+ *
+ *  @param      PszName             Name to copy (optional, can be NULL).
+ *  @param      PwszTarget          Buffer receiving the null-terminated name.
+ *  @param      PunTargetCapacity   Capacity of PwszTarget in elements.
+ */
+static
+void
+Error_CopyName(
+    _In_opt_z_                      const char*     PszName,
+    _Out_z_cap_(PunTargetCapacity)  wchar_t*        PwszTarget,
+    _In_                            unsigned int    PunTargetCapacity)
+{
+    unsigned int unIndex = 0;
+
+    for (unIndex = 0; NULL != PszName && unIndex < PunTargetCapacity - 1 && '\0' != PszName[unIndex]; unIndex++)
+        PwszTarget[unIndex] = (wchar_t)(BYTE)PszName[unIndex];
+    PwszTarget[unIndex] = L'\0';
+}
+
+/**
+ *  @brief      Logs an error record
+ *  @details
+ *
+ *  @param      PpRecord            Record to log.
+ */
+static
+void
+Error_LogRecord(
+    _Inout_ IfxErrorRecord* PpRecord)
+{
+    Logging_WriteLog(PpRecord->szOccurredInModule, PpRecord->szOccurredInFunction, LOGGING_LEVEL_1, L"ErrorCode: 0x%.8x; ErrorMessage: %ls", PpRecord->unInternalErrorCode, PpRecord->wszMessage);
+    PpRecord->fLogged = TRUE;
+}
+
+/**
+ *  @brief      Function to return the error stack
+ *  @details    Returns the newest error of the error ring. Older errors are not linked.
+ *
+ *  @returns    Pointer to the newest error or NULL if no error is stored.
+ */
+_Check_return_
+IfxErrorData*
+Error_GetStack()
+{
+    const IfxErrorRecord* pRecord = NULL;
+    unsigned int unSize = RG_LEN(s_sErrorData.wszInternalErrorMessage);
+
+    if (0 == s_unErrorRingCount)
+        return NULL;
+
+    pRecord = Error_RingRecord(0);
+    s_sErrorData.unInternalErrorCode = pRecord->unInternalErrorCode;
+    s_sErrorData.nOccurredInLine = pRecord->nOccurredInLine;
+    s_sErrorData.pPreviousError = NULL;
+    if (RC_SUCCESS != Platform_StringFormat(s_sErrorData.wszInternalErrorMessage, &unSize, L"ErrorCode: 0x%.8x; ErrorMessage: %ls", pRecord->unInternalErrorCode, pRecord->wszMessage))
+        s_sErrorData.wszInternalErrorMessage[RG_LEN(s_sErrorData.wszInternalErrorMessage) - 1] = L'\0';
+    Error_CopyName(pRecord->szOccurredInModule, s_sErrorData.wszOccurredInModule, RG_LEN(s_sErrorData.wszOccurredInModule));
+    Error_CopyName(pRecord->szOccurredInFunction, s_sErrorData.wszOccurredInFunction, RG_LEN(s_sErrorData.wszOccurredInFunction));
+
+    return &s_sErrorData;
+}
+
+/**
+ *  @brief      Function to clear the error stack
+ *  @details    Removes all errors from the error ring.
+ */
+void
+Error_ClearStack()
+{
+    s_unErrorRingCount = 0;
+}
+
+/**
+ *  @brief      Function to clear the first item in the error stack
+ *  @details    Removes the newest error from the error ring.
+ */
+void
+Error_ClearFirstItem()
+{
+    if (0 == s_unErrorRingCount)
+        return;
+
+    s_unErrorRingNewest = (s_unErrorRingNewest + ERROR_RING_CAPACITY - 1) % ERROR_RING_CAPACITY;
+    s_unErrorRingCount--;
+}
+
+/**
+ *  @brief      Function to store all parameters to an IfxErrorData structure
+ *  @details    This function stores an error and its specific parameters for later use.
+ *
+ *  @param      PszOccurredInModule         Pointer to a char array holding the module name where the error occurred.
+ *  @param      PszOccurredInFunction       Pointer to a char array holding the function name where the error occurred.
+ *  @param      PnOccurredInLine            The line where the error occurred.
+ *  @param      PunInternalErrorCode        Internal error code.
+ *  @param      PwszInternalErrorMessage    Format string used to format the internal error message.
+ *  @param      PvaArgumentList             Parameters needed to format the error message.
+ */
+_Check_return_
+IfxErrorData*
+Error_GetErrorData(
+    _In_z_  const char*     PszOccurredInModule,
+    _In_z_  const char*     PszOccurredInFunction,
+    _In_    int             PnOccurredInLine,
+    _In_    unsigned int    PunInternalErrorCode,
+    _In_z_  const wchar_t*  PwszInternalErrorMessage,
+    _In_    va_list         PvaArgumentList)
+{
+    UNREFERENCED_PARAMETER(PszOccurredInModule);
+    UNREFERENCED_PARAMETER(PszOccurredInFunction);
+    UNREFERENCED_PARAMETER(PnOccurredInLine);
+    UNREFERENCED_PARAMETER(PunInternalErrorCode);
+    UNREFERENCED_PARAMETER(PwszInternalErrorMessage);
+    UNREFERENCED_PARAMETER(PvaArgumentList);
+    return NULL;
+}
+
+/**
+ *  @brief      Function to store an error
+ *  @details    This function stores an error and its specific parameters for later use.
+ *              The error is recorded in a ring of the last ERROR_RING_CAPACITY errors. The module and function strings must
+ *              stay valid, which is the case for the ERROR_STORE macros.
+ *
+ *  @param      PszOccurredInModule         Pointer to a char array holding the module name where the error occurred.
+ *  @param      PszOccurredInFunction       Pointer to a char array holding the function name where the error occurred.
+ *  @param      PnOccurredInLine            The line where the error occurred.
+ *  @param      PunInternalErrorCode        Internal error code.
+ *  @param      PwszInternalErrorMessage    Format string used to format the internal error message.
+ *  @param      ...                         Parameters needed to format the error message.
+ */
+void
+IFXAPI
+Error_Store(
+    _In_z_  const char*     PszOccurredInModule,
+    _In_z_  const char*     PszOccurredInFunction,
+    _In_    int             PnOccurredInLine,
+    _In_    unsigned int    PunInternalErrorCode,
+    _In_z_  const wchar_t*  PwszInternalErrorMessage,
+    ...)
+{
+    IfxErrorRecord* pRecord = NULL;
+
+    s_unErrorRingNewest = (s_unErrorRingNewest + 1) % ERROR_RING_CAPACITY;
+    if (s_unErrorRingCount < ERROR_RING_CAPACITY)
+        s_unErrorRingCount++;
+
+    pRecord = Error_RingRecord(0);
+    pRecord->unInternalErrorCode = PunInternalErrorCode;
+    pRecord->nOccurredInLine = PnOccurredInLine;
+    pRecord->szOccurredInModule = PszOccurredInModule;
+    pRecord->szOccurredInFunction = PszOccurredInFunction;
+    pRecord->fLogged = FALSE;
+    pRecord->wszMessage[0] = L'\0';
+
+    if (NULL != PwszInternalErrorMessage)
+    {
+        unsigned int unSize = RG_LEN(pRecord->wszMessage);
+        va_list argptr;
+        va_start(argptr, PwszInternalErrorMessage);
+        // A truncated message is kept
+        if (RC_SUCCESS != Platform_StringFormatV(pRecord->wszMessage, &unSize, PwszInternalErrorMessage, argptr))
+            pRecord->wszMessage[RG_LEN(pRecord->wszMessage) - 1] = L'\0';
+        va_end(argptr);
+    }
+
+    if (LOGGING_LEVEL_1 <= g_unLoggingLevel)
+        Error_LogRecord(pRecord);
+}
+
+/**
+ *  @brief      Return the final error code
+ *  @details    This function maps the given error code to the final one.
+ *
+ *  @retval     The final mapped error code.
+ */
+_Check_return_
+unsigned int
+Error_GetFinalCodeFromError(
+    _In_ unsigned int PunErrorCode)
+{
+    return PunErrorCode;
+}
+
+/**
+ *  @brief      Return the final error code
+ *  @details    This function maps the internal error code to the final one displayed to the end user.
+ *
+ *  @retval     The final mapped error code.
+ */
+_Check_return_
+unsigned int
+Error_GetFinalCode()
+{
+    return RC_E_FAIL;
+}
+
+/**
+ *  @brief      Return the final error code
+ *  @details    This function maps the internal error code to the final one displayed to the user.
+ *
+ *  @param      PunErrorCode        Error Code to map to the final message.
+ *  @param      PwszErrorMessage    Pointer to a char buffer to copy the error message to.
+ *  @param      PpunBufferSize      Size of the error message buffer.
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. E.g. PwszErrorMessage == NULL.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+Error_GetFinalMessageFromErrorCode(
+    _In_                            unsigned int    PunErrorCode,
+    _Out_z_cap_(*PpunBufferSize)    wchar_t*        PwszErrorMessage,
+    _Inout_                         unsigned int*   PpunBufferSize)
+{
+    UNREFERENCED_PARAMETER(PunErrorCode);
+    UNREFERENCED_PARAMETER(PwszErrorMessage);
+    UNREFERENCED_PARAMETER(PpunBufferSize);
+    return RC_E_FAIL;
+}
+
+/**
+ *  @brief      Return the final error code
+ *  @details    This function maps the internal error code to the final one displayed to the user.
+ *
+ *  @param      PwszErrorMessage    Pointer to a char buffer to copy the error message to.
+ *  @param      PpunBufferSize      Size of the error message buffer.
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  An invalid parameter was passed to the function. E.g. PwszErrorMessage == NULL.
+ *  @retval     ...                 Error codes from called functions.
+ */
+_Check_return_
+unsigned int
+Error_GetFinalMessage(
+    _Out_z_cap_(*PpunBufferSize)    wchar_t*        PwszErrorMessage,
+    _Inout_                         unsigned int*   PpunBufferSize)
+{
+    UNREFERENCED_PARAMETER(PwszErrorMessage);
+    UNREFERENCED_PARAMETER(PpunBufferSize);
+    return RC_E_FAIL;
+}
+
+/**
+ *  @brief      Return the internal error code
+ *  @details    This function returns the internal error code of the newest stored error.
+ *
+ *  @retval     The internal error code or RC_E_FAIL if no error is stored.
+ */
+_Check_return_
+unsigned int
+Error_GetInternalCode()
+{
+    if (0 == s_unErrorRingCount)
+        return RC_E_FAIL;
+
+    return Error_RingRecord(0)->unInternalErrorCode;
+}
+
+/**
+ *  @brief      Log the error stack
+ *  @details    This function logs all errors of the error ring which were not logged yet, from oldest to newest.
+ */
+void
+Error_LogStack()
+{
+    unsigned int unAge = 0;
+
+    for (unAge = s_unErrorRingCount; unAge > 0; unAge--)
+    {
+        IfxErrorRecord* pRecord = Error_RingRecord(unAge - 1);
+        if (!pRecord->fLogged)
+            Error_LogRecord(pRecord);
+    }
+}
+
+/**
+ *  @brief      Log error code and message
+ *  @details    This function logs an error code and message.
+ *
+ *  @param      PszOccurredInModule         Pointer to a char array holding the module name where the error occurred.
+ *  @param      PszOccurredInFunction       Pointer to a char array holding the function name where the error occurred.
+ *  @param      PnOccurredInLine            The line where the error occurred.
+ *  @param      PunInternalErrorCode        Internal error code.
+ *  @param      PwszInternalErrorMessage    Format string used to format the internal error message.
+ *  @param      ...                         Parameters needed to format the error message.
+ */
+void
+IFXAPI
+Error_LogCodeAndMessage(
+    _In_z_  const char*     PszOccurredInModule,
+    _In_z_  const char*     PszOccurredInFunction,
+    _In_    int             PnOccurredInLine,
+    _In_    unsigned int    PunInternalErrorCode,
+    _In_z_  const wchar_t*  PwszInternalErrorMessage,
+    ...)
+{
+    UNREFERENCED_PARAMETER(PszOccurredInModule);
+    UNREFERENCED_PARAMETER(PszOccurredInFunction);
+    UNREFERENCED_PARAMETER(PnOccurredInLine);
+    UNREFERENCED_PARAMETER(PunInternalErrorCode);
+    UNREFERENCED_PARAMETER(PwszInternalErrorMessage);
+}
+
+/**
+ *  @brief      Log IfxErrorData and linked IfxErrorData
+ *  @details    This function logs an IfxErrorData object and all linked IfxErrorData objects.
+ */
+void
+Error_LogErrorData(
+    _In_    const IfxErrorData* PpErrorData)
+{
+    UNREFERENCED_PARAMETER(PpErrorData);
+}
@@ -0,0 +1,863 @@
+/**
+ *  @brief      Implements the IFXTPMUpdate command line tool for Linux
+ *  @details    The tool runs the firmware update flow of the driver (EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo,
+ *              CheckImage and SetImage) from the running operating system. The TPM is accessed through the kernel TPM
+ *              driver, so no reboot into the UEFI shell is needed to check or update the firmware.
+ *  @file       IFXTPMUpdateCli/IFXTPMUpdateCli.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "StdInclude.h"
+#include "Crypt.h"
+#include "DeviceManagement.h"
+#include "FirmwareUpdate.h"
+#include "TpmReplay.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+/// Size of the memory arena (same as the driver)
+#define IFXTPMUPDATECLI_ARENA_SIZE      (32 * 1024)
+/// Default locality
+#define IFXTPMUPDATECLI_LOCALITY        0
+/// Default TPM device, the in-kernel resource manager allows other TPM users to run in parallel
+#define IFXTPMUPDATECLI_DEVICE_PATH     L"/dev/tpmrm0"
+/// Maximum size of a firmware image or replay trace file in bytes
+#define IFXTPMUPDATECLI_MAX_FILE_SIZE   (16 * 1024 * 1024)
+
+/// Operation requested on the command line
+typedef enum tdIFXTPMUPDATECLI_OPERATION
+{
+    /// No operation given
+    IFXTPMUPDATECLI_OPERATION_NONE,
+    /// Show the TPM firmware information
+    IFXTPMUPDATECLI_OPERATION_INFO,
+    /// Check whether the image can be applied to the TPM
+    IFXTPMUPDATECLI_OPERATION_CHECK,
+    /// Update the TPM firmware with the image
+    IFXTPMUPDATECLI_OPERATION_UPDATE,
+    /// Update the TPM firmware with a plan of images applied in order
+    IFXTPMUPDATECLI_OPERATION_PLAN
+} IFXTPMUPDATECLI_OPERATION;
+
+/// Options given on the command line
+typedef struct tdIFXTPMUPDATECLI_OPTIONS
+{
+    /// Requested operation
+    IFXTPMUPDATECLI_OPERATION eOperation;
+    /// Path of the firmware image or of a directory with firmware images (-check and -update), comma separated paths of the firmware images (-plan)
+    const char* szImagePath;
+    /// Path of the TPM device (NULL for IFXTPMUPDATECLI_DEVICE_PATH)
+    const char* szDevicePath;
+    /// Path of a replay trace answering the TPM commands instead of the TPM (optional)
+    const char* szReplayPath;
+    /// Log level written to stderr
+    unsigned int unLoggingLevel;
+} IFXTPMUPDATECLI_OPTIONS;
+
+/**
+ *  @brief      Prints the usage of the tool
+ *  @details
+ */
+static
+void
+IFXTPMUpdateCli_PrintUsage()
+{
+    printf("Usage: IFXTPMUpdateCli <operation> [options]\n"
+           "Operations:\n"
+           "  -info                Show the TPM firmware version and remaining updates\n"
+           "  -check <image>       Check whether the firmware image can be applied to the TPM\n"
+           "  -update <image>      Update the TPM firmware with the firmware image\n"
+           "                       If <image> is a directory, the image meant for the TPM is selected from it\n"
+           "  -plan <image>,<image> Update the TPM firmware with the images in the given order, all images are\n"
+           "                       checked before the first one is applied\n"
+           "Options:\n"
+           "  -device <path>       TPM device (default /dev/tpmrm0)\n"
+           "  -replay <trace>      Answer the TPM commands from a replay trace instead of the TPM\n"
+           "  -log <level>         Write log messages up to the given level (1-4) to stderr\n");
+}
+
+/**
+ *  @brief      Parses the command line
+ *  @details
+ *
+ *  @param      PnArgc              Number of arguments.
+ *  @param      PrgszArgv           Arguments.
+ *  @param      PpsOptions          Receives the options.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  The command line is invalid.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_ParseCommandLine(
+    _In_                int                         PnArgc,
+    _In_count_(PnArgc)  char**                      PrgszArgv,
+    _Out_               IFXTPMUPDATECLI_OPTIONS*    PpsOptions)
+{
+    unsigned int unReturnValue = RC_SUCCESS;
+    int nIndex = 0;
+
+    Platform_MemorySet(PpsOptions, 0, sizeof(*PpsOptions));
+
+    for (nIndex = 1; nIndex < PnArgc && RC_SUCCESS == unReturnValue; nIndex++)
+    {
+        const char* szOption = PrgszArgv[nIndex];
+        const char* szValue = nIndex + 1 < PnArgc ? PrgszArgv[nIndex + 1] : NULL;
+        IFXTPMUPDATECLI_OPERATION eOperation = IFXTPMUPDATECLI_OPERATION_NONE;
+
+        if (0 == strcmp(szOption, "-info"))
+            eOperation = IFXTPMUPDATECLI_OPERATION_INFO;
+        else if (0 == strcmp(szOption, "-check"))
+            eOperation = IFXTPMUPDATECLI_OPERATION_CHECK;
+        else if (0 == strcmp(szOption, "-update"))
+            eOperation = IFXTPMUPDATECLI_OPERATION_UPDATE;
+        else if (0 == strcmp(szOption, "-plan"))
+            eOperation = IFXTPMUPDATECLI_OPERATION_PLAN;
+
+        if (IFXTPMUPDATECLI_OPERATION_NONE != eOperation)
+        {
+            // Only one operation per call
+            if (IFXTPMUPDATECLI_OPERATION_NONE != PpsOptions->eOperation)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            PpsOptions->eOperation = eOperation;
+            if (IFXTPMUPDATECLI_OPERATION_INFO == eOperation)
+                continue;
+            if (NULL == szValue)
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                break;
+            }
+            PpsOptions->szImagePath = szValue;
+            nIndex++;
+            continue;
+        }
+
+        if (NULL == szValue)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            break;
+        }
+        if (0 == strcmp(szOption, "-device"))
+            PpsOptions->szDevicePath = szValue;
+        else if (0 == strcmp(szOption, "-replay"))
+            PpsOptions->szReplayPath = szValue;
+        else if (0 == strcmp(szOption, "-log") && '1' <= szValue[0] && '4' >= szValue[0] && '\0' == szValue[1])
+            PpsOptions->unLoggingLevel = (unsigned int)(szValue[0] - '0');
+        else
+            unReturnValue = RC_E_BAD_PARAMETER;
+        nIndex++;
+    }
+
+    if (IFXTPMUPDATECLI_OPERATION_NONE == PpsOptions->eOperation)
+        unReturnValue = RC_E_BAD_PARAMETER;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Reads a file into memory
+ *  @details    The caller must free the returned buffer with Platform_MemoryFree.
+ *
+ *  @param      PszPath             Path of the file.
+ *  @param      PppbData            Receives the file content.
+ *  @param      PpunDataSize        Receives the size of the file content in bytes.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  The file is empty or too large.
+ *  @retval     RC_E_FAIL           The file could not be read.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_ReadFile(
+    _In_z_  const char*     PszPath,
+    _Out_   BYTE**          PppbData,
+    _Out_   unsigned int*   PpunDataSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    FILE* pFile = NULL;
+
+    *PppbData = NULL;
+    *PpunDataSize = 0;
+
+    do
+    {
+        long lSize = 0;
+
+        pFile = fopen(PszPath, "rb");
+        if (NULL == pFile)
+        {
+            fprintf(stderr, "Error: Cannot open %s.\n", PszPath);
+            break;
+        }
+
+        if (0 != fseek(pFile, 0, SEEK_END) || (lSize = ftell(pFile)) < 0 || 0 != fseek(pFile, 0, SEEK_SET))
+        {
+            fprintf(stderr, "Error: Cannot determine the size of %s.\n", PszPath);
+            break;
+        }
+        if (0 == lSize || lSize > IFXTPMUPDATECLI_MAX_FILE_SIZE)
+        {
+            unReturnValue = RC_E_BAD_PARAMETER;
+            fprintf(stderr, "Error: %s is empty or larger than %d bytes.\n", PszPath, IFXTPMUPDATECLI_MAX_FILE_SIZE);
+            break;
+        }
+
+        *PppbData = (BYTE*)Platform_MemoryAllocateZero((size_t)lSize);
+        if (NULL == *PppbData)
+            break;
+
+        if ((size_t)lSize != fread(*PppbData, 1, (size_t)lSize, pFile))
+        {
+            Platform_MemoryFree((void**)PppbData);
+            fprintf(stderr, "Error: Cannot read %s.\n", PszPath);
+            break;
+        }
+
+        *PpunDataSize = (unsigned int)lSize;
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != pFile)
+        fclose(pFile);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Selects the applicable firmware image from a directory
+ *  @details    The TPM state is read once. Each regular file in the directory is matched against it by parsing only the
+ *              image header (FirmwareUpdate_MatchImageHeader), so the full verification runs on the selected image only.
+ *              Exactly one image must match.
+ *
+ *  @param      PszDirectory        Path of the directory.
+ *  @param      PppbImage           Receives the selected firmware image.
+ *  @param      PpunImageSize       Receives the size of the selected firmware image in bytes.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_WRONG_FW_IMAGE No image or more than one image matches the TPM.
+ *  @retval     RC_E_FAIL           The directory could not be read.
+ *  @retval     ...                 Error codes from FirmwareUpdate_ProbeImageSelection.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_SelectImage(
+    _In_z_  const char*     PszDirectory,
+    _Out_   BYTE**          PppbImage,
+    _Out_   unsigned int*   PpunImageSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    DIR* pDirectory = NULL;
+
+    *PppbImage = NULL;
+    *PpunImageSize = 0;
+
+    do
+    {
+        struct dirent* pEntry = NULL;
+        unsigned int unMatchCount = 0;
+        IMAGE_SELECTION_PROBE sProbe;
+
+        unReturnValue = FirmwareUpdate_ProbeImageSelection(&sProbe);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        pDirectory = opendir(PszDirectory);
+        if (NULL == pDirectory)
+        {
+            unReturnValue = RC_E_FAIL;
+            fprintf(stderr, "Error: Cannot open %s.\n", PszDirectory);
+            break;
+        }
+
+        while (NULL != (pEntry = readdir(pDirectory)))
+        {
+            char szPath[MAX_PATH];
+            struct stat sStat;
+            BYTE* pbCandidate = NULL;
+            unsigned int unCandidateSize = 0;
+            BOOL fMatch = FALSE;
+
+            if ((int)sizeof(szPath) <= snprintf(szPath, sizeof(szPath), "%s/%s", PszDirectory, pEntry->d_name) ||
+                    0 != stat(szPath, &sStat) || !S_ISREG(sStat.st_mode))
+                continue;
+
+            if (RC_SUCCESS != IFXTPMUpdateCli_ReadFile(szPath, &pbCandidate, &unCandidateSize))
+                continue;
+
+            if (RC_SUCCESS == FirmwareUpdate_MatchImageHeader(pbCandidate, unCandidateSize, &sProbe, &fMatch) && fMatch)
+            {
+                printf("Matching firmware image: %s\n", szPath);
+                unMatchCount++;
+                if (NULL == *PppbImage)
+                {
+                    *PppbImage = pbCandidate;
+                    *PpunImageSize = unCandidateSize;
+                    pbCandidate = NULL;
+                }
+            }
+            Platform_MemoryFree((void**)&pbCandidate);
+        }
+
+        if (1 != unMatchCount)
+        {
+            unReturnValue = RC_E_WRONG_FW_IMAGE;
+            if (0 == unMatchCount)
+                fprintf(stderr, "Error: No firmware image in %s is meant for this TPM.\n", PszDirectory);
+            else
+                fprintf(stderr, "Error: %u firmware images in %s are meant for this TPM.\n", unMatchCount, PszDirectory);
+            break;
+        }
+
+        unReturnValue = RC_SUCCESS;
+    }
+    WHILE_FALSE_END;
+
+    if (NULL != pDirectory)
+        closedir(pDirectory);
+    if (RC_SUCCESS != unReturnValue)
+    {
+        Platform_MemoryFree((void**)PppbImage);
+        *PpunImageSize = 0;
+    }
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Sets the properties of the driver and connects to the TPM
+ *  @details    Mirrors the driver initialization (IFXTPMUpdate_Initialize and InitializeTpmAccess).
+ *
+ *  @param      PpsOptions          Options given on the command line.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_FAIL           A property could not be set or the random number generator could not be seeded.
+ *  @retval     ...                 Error codes from TpmReplay_Load and DeviceManagement_Connect.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_Connect(
+    _In_    const IFXTPMUPDATECLI_OPTIONS*  PpsOptions)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    BYTE* pbTrace = NULL;
+
+    do
+    {
+        wchar_t wszDevicePath[MAX_PATH] = IFXTPMUPDATECLI_DEVICE_PATH;
+        unsigned int unTraceSize = 0;
+        BOOL fSet = TRUE;
+
+        if (NULL != PpsOptions->szDevicePath)
+        {
+            unsigned int unIndex = 0;
+            for (unIndex = 0; unIndex < RG_LEN(wszDevicePath) - 1 && '\0' != PpsOptions->szDevicePath[unIndex]; unIndex++)
+                wszDevicePath[unIndex] = (wchar_t)(BYTE)PpsOptions->szDevicePath[unIndex];
+            wszDevicePath[unIndex] = L'\0';
+        }
+
+        if (NULL != PpsOptions->szReplayPath)
+        {
+            unReturnValue = IFXTPMUpdateCli_ReadFile(PpsOptions->szReplayPath, &pbTrace, &unTraceSize);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+            // Replay without the recorded latency
+            unReturnValue = TpmReplay_Load(pbTrace, unTraceSize, 0, 0);
+            if (RC_SUCCESS != unReturnValue)
+            {
+                fprintf(stderr, "Error: %s is not a valid replay trace.\n", PpsOptions->szReplayPath);
+                break;
+            }
+        }
+
+        unReturnValue = RC_E_FAIL;
+        if (RC_SUCCESS != Crypt_SeedRandom(NULL, 0))
+            break;
+
+        fSet = fSet && PropertyStorage_SetUIntegerValueByKey(PROPERTY_ABANDON_UPDATE_MODE, ABANDON_UPDATE_IF_MANIFEST_CALL_FAIL);
+        fSet = fSet && PropertyStorage_SetBooleanValueByKey(PROPERTY_STREAMING_UPDATE, TRUE);
+        fSet = fSet && PropertyStorage_SetBooleanValueByKey(PROPERTY_CALIBRATE_COMMAND_DURATIONS, FALSE);
+        fSet = fSet && PropertyStorage_SetUIntegerValueByKey(PROPERTY_LOCALITY, IFXTPMUPDATECLI_LOCALITY);
+        fSet = fSet && PropertyStorage_SetBooleanValueByKey(PROPERTY_KEEP_LOCALITY_ACTIVE, TRUE);
+        fSet = fSet && PropertyStorage_SetUIntegerValueByKey(PROPERTY_TPM_DEVICE_ACCESS_MODE, TpmReplay_IsLoaded() ? TPM_DEVICE_ACCESS_REPLAY : TPM_DEVICE_ACCESS_DRIVER);
+        fSet = fSet && PropertyStorage_SetValueByKey(PROPERTY_TPM_DEVICE_ACCESS_PATH, wszDevicePath);
+        if (!fSet)
+            break;
+
+        DeviceManagement_Initialize();
+
+        unReturnValue = DeviceManagement_Connect();
+        if (RC_SUCCESS != unReturnValue)
+        {
+            fprintf(stderr, "Error: Cannot connect to the TPM (0x%.8X).\n", unReturnValue);
+            break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    // The replay keeps a copy of the trace
+    Platform_MemoryFree((void**)&pbTrace);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Prints a wide character string to stdout
+ *  @details    The strings of the driver (e.g. version names) are ASCII.
+ *
+ *  @param      PwszText            Null-terminated string.
+ */
+static
+void
+IFXTPMUpdateCli_PrintWide(
+    _In_z_  const wchar_t*  PwszText)
+{
+    for (; L'\0' != *PwszText; PwszText++)
+        putchar(*PwszText < 0x80 ? (int)*PwszText : '?');
+}
+
+/**
+ *  @brief      Shows the TPM firmware information
+ *  @details    Mirrors EFI_FIRMWARE_MANAGEMENT_PROTOCOL.GetImageInfo.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from FirmwareUpdate_GetImageInfo.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_Info()
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        wchar_t wszVersionName[MAX_NAME];
+        unsigned int unCapacity = RG_LEN(wszVersionName);
+        unsigned int unRemainingUpdates = REMAINING_UPDATES_UNAVAILABLE;
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+        Platform_MemorySet(wszVersionName, 0, sizeof(wszVersionName));
+
+        unReturnValue = FirmwareUpdate_GetImageInfo(wszVersionName, &unCapacity, &sTpmState, &unRemainingUpdates);
+        // The version of an unsupported chip is shown anyway
+        if (RC_SUCCESS != unReturnValue && RC_E_UNSUPPORTED_CHIP != unReturnValue)
+            break;
+
+        printf("TPM family:          %s\n", sTpmState.attribs.tpm20 ? "TPM2.0" : (sTpmState.attribs.tpm12 ? "TPM1.2" : "unknown"));
+        printf("Firmware version:    ");
+        IFXTPMUpdateCli_PrintWide(wszVersionName);
+        printf("\n");
+        if (REMAINING_UPDATES_UNAVAILABLE == unRemainingUpdates)
+            printf("Remaining updates:   unknown\n");
+        else
+            printf("Remaining updates:   %u\n", unRemainingUpdates);
+        if (sTpmState.attribs.tpm20restartRequired)
+            printf("A restart is required before the firmware can be updated.\n");
+        if (sTpmState.attribs.tpm20InFailureMode)
+            printf("The TPM is in failure mode.\n");
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Checks whether the firmware image can be applied to the TPM
+ *  @details    Mirrors IFXTPMUpdate_FirmwareManagement_CheckImageInternal.
+ *
+ *  @param      PrgbImage           Firmware image.
+ *  @param      PunImageSize        Size of the firmware image in bytes.
+ *
+ *  @retval     RC_SUCCESS          The image can be applied.
+ *  @retval     ...                 Error codes from FirmwareUpdate_CheckImage or the error details why the image cannot be applied.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_CheckImage(
+    _In_bytecount_(PunImageSize)    BYTE*           PrgbImage,
+    _In_                            unsigned int    PunImageSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+
+    do
+    {
+        BOOL fValid = FALSE;
+        unsigned int unErrorDetails = RC_E_FAIL;
+        BITFIELD_NEW_TPM_FIRMWARE_INFO bfNewTpmFirmwareInfo;
+        Platform_MemorySet(&bfNewTpmFirmwareInfo, 0, sizeof(bfNewTpmFirmwareInfo));
+
+        unReturnValue = FirmwareUpdate_CheckImage(PrgbImage, PunImageSize, &fValid, &bfNewTpmFirmwareInfo, &unErrorDetails);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        switch (unErrorDetails)
+        {
+            case RC_SUCCESS:
+                printf("The firmware image can be applied to the TPM.\n");
+                if (bfNewTpmFirmwareInfo.deviceTypeChange)
+                    printf("The update changes the TPM family.\n");
+                if (bfNewTpmFirmwareInfo.factoryDefaults)
+                    printf("The update resets the TPM to factory defaults.\n");
+                if (bfNewTpmFirmwareInfo.fwUpdateSameVersion)
+                    printf("The image contains the installed firmware version.\n");
+                if (bfNewTpmFirmwareInfo.fwRecovery)
+                    printf("The update recovers an interrupted firmware update.\n");
+                break;
+            case RC_E_FW_UPDATE_BLOCKED:
+                printf("The TPM does not allow any more firmware updates.\n");
+                break;
+            case RC_E_WRONG_DECRYPT_KEYS:
+            case RC_E_WRONG_FW_IMAGE:
+                printf("The firmware image is not meant for this TPM.\n");
+                break;
+            case RC_E_NEWER_TOOL_REQUIRED:
+                printf("A newer version of the tool is required to process the firmware image.\n");
+                break;
+            case RC_E_NEWER_FW_IMAGE_REQUIRED:
+                printf("A newer revision of the firmware image is required.\n");
+                break;
+            default:
+                printf("The firmware image is corrupt.\n");
+                unErrorDetails = RC_E_CORRUPT_FW_IMAGE;
+                break;
+        }
+        unReturnValue = unErrorDetails;
+    }
+    WHILE_FALSE_END;
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Progress callback of the firmware update
+ *  @details
+ *
+ *  @param      PullCompletion      Completion in percent.
+ *
+ *  @returns    Always 0.
+ */
+static
+unsigned long long
+IFXAPI
+IFXTPMUpdateCli_ProgressCallback(
+    _In_    unsigned long long  PullCompletion)
+{
+    printf("\rUpdating the TPM firmware: %3u%%", (unsigned int)PullCompletion);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ *  @brief      Prints the time spent in each phase of the last firmware update
+ *  @details
+ */
+static
+void
+IFXTPMUpdateCli_PrintPhaseTiming()
+{
+    static const char* const s_rgszPhaseNames[UPDATE_PHASE_COUNT] = {
+        "Image verification", "TPM state", "Policy session", "Field upgrade start",
+        "Boot loader wait", "Manifest transfer", "Firmware transfer", "Finalization"
+    };
+    UPDATE_PHASE_TIMING sTiming;
+    unsigned int unIndex = 0;
+    Platform_MemorySet(&sTiming, 0, sizeof(sTiming));
+
+    if (RC_SUCCESS != FirmwareUpdate_GetPhaseTiming(&sTiming))
+        return;
+
+    printf("Update phases:\n");
+    for (unIndex = 0; unIndex < UPDATE_PHASE_COUNT; unIndex++)
+        printf("  %-20s %10llu ms\n", s_rgszPhaseNames[unIndex], sTiming.rgullPhaseUs[unIndex] / 1000);
+    printf("  %-20s %10llu ms\n", "Total", sTiming.ullTotalUs / 1000);
+}
+
+/**
+ *  @brief      Updates the TPM firmware with the firmware image
+ *  @details    Mirrors EFI_FIRMWARE_MANAGEMENT_PROTOCOL.SetImage: the policy session is started while the integrity of the
+ *              image is verified, then the image is checked against the TPM and applied.
+ *
+ *  @param      PrgbImage           Firmware image.
+ *  @param      PunImageSize        Size of the firmware image in bytes.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     ...                 Error codes from called functions.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_UpdateImage(
+    _In_bytecount_(PunImageSize)    BYTE*           PrgbImage,
+    _In_                            unsigned int    PunImageSize)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    TSS_TPMI_SH_AUTH_SESSION hPolicySession = 0;
+
+    do
+    {
+        unsigned int unPolicyReturnValue = RC_SUCCESS;
+        unsigned int unIntegrityDetails = RC_E_CORRUPT_FW_IMAGE;
+        BOOL fPolicyPending = FALSE;
+        BOOL fIntact = FALSE;
+        IfxFirmwareUpdateData sFirmwareUpdateData;
+        TPM_STATE sTpmState;
+        Platform_MemorySet(&sTpmState, 0, sizeof(sTpmState));
+
+        // Calculate the checksums of the image on a second thread while the TPM state is read and the policy session is started
+        FirmwareUpdate_PhaseTimingReset();
+        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+        FirmwareUpdate_StartImageIntegrityCheck(PrgbImage, PunImageSize);
+
+        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_STATE);
+        unReturnValue = FirmwareUpdate_CalculateState(TRUE, &sTpmState);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        if (sTpmState.attribs.tpm20 && sTpmState.attribs.tpmInOperationalMode && sTpmState.attribs.infineon &&
+                !sTpmState.attribs.tpm20restartRequired && !sTpmState.attribs.tpm20InFailureMode)
+        {
+            FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_POLICY);
+            unPolicyReturnValue = FirmwareUpdate_BeginTPM20Policy();
+            fPolicyPending = (RC_SUCCESS == unPolicyReturnValue);
+        }
+
+        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+        unReturnValue = FirmwareUpdate_VerifyImageIntegrity(PrgbImage, PunImageSize, &fIntact, &unIntegrityDetails);
+        if (RC_SUCCESS != unReturnValue)
+            fIntact = FALSE;
+
+        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_POLICY);
+        if (fPolicyPending)
+        {
+            unsigned int unCompleteReturnValue = FirmwareUpdate_CompleteTPM20Policy(!fIntact, &hPolicySession);
+            if (RC_SUCCESS != unCompleteReturnValue)
+                unPolicyReturnValue = unCompleteReturnValue;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_VERIFY);
+        unReturnValue = IFXTPMUpdateCli_CheckImage(PrgbImage, PunImageSize);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        if (RC_SUCCESS != unPolicyReturnValue)
+        {
+            unReturnValue = unPolicyReturnValue;
+            if (RC_E_PLATFORM_AUTH_NOT_EMPTY == unReturnValue)
+                fprintf(stderr, "Error: The platform authorization is not empty.\n");
+            else if (RC_E_PLATFORM_HIERARCHY_DISABLED == unReturnValue)
+                fprintf(stderr, "Error: The platform hierarchy is disabled.\n");
+            break;
+        }
+
+        Platform_MemorySet(&sFirmwareUpdateData, 0, sizeof(sFirmwareUpdateData));
+        sFirmwareUpdateData.rgbFirmwareImage = PrgbImage;
+        sFirmwareUpdateData.unFirmwareImageSize = PunImageSize;
+        sFirmwareUpdateData.fnProgressCallback = IFXTPMUpdateCli_ProgressCallback;
+        sFirmwareUpdateData.unSessionHandle = hPolicySession;
+
+        unReturnValue = FirmwareUpdate_UpdateImage(&sFirmwareUpdateData);
+        // The update consumes the policy session
+        hPolicySession = 0;
+        printf("\n");
+        IFXTPMUpdateCli_PrintPhaseTiming();
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        printf("The TPM firmware has been updated.\n");
+    }
+    WHILE_FALSE_END;
+
+    // Close a policy session started for an image that has been rejected and a session the update has not consumed, the
+    // kept session is of no use once the tool exits
+    if (0 != hPolicySession)
+        FirmwareUpdate_FlushTPM20Policy(hPolicySession);
+    hPolicySession = FirmwareUpdate_GetRetainedTPM20Policy();
+    if (0 != hPolicySession)
+        FirmwareUpdate_FlushTPM20Policy(hPolicySession);
+
+    // Do not release the image while it is still read on the second thread
+    FirmwareUpdate_WaitImageIntegrityCheck();
+    FirmwareUpdate_PhaseTimingSwitch(UPDATE_PHASE_NONE);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Applies a firmware update plan
+ *  @details    The images of the plan are given as a comma separated list. All hops are verified before the first one is
+ *              applied (FirmwareUpdate_RunUpdatePlan). If the TPM must be restarted in between, the same plan continues with
+ *              the next hop when the tool is run again after the restart.
+ *
+ *  @param      PszPlan             Comma separated paths of the firmware images.
+ *
+ *  @retval     RC_SUCCESS          The operation completed successfully.
+ *  @retval     RC_E_BAD_PARAMETER  The plan has no image or more than UPDATE_PLAN_MAX_HOPS images.
+ *  @retval     ...                 Error codes from called functions.
+ */
+static
+unsigned int
+IFXTPMUpdateCli_RunPlan(
+    _In_z_  const char*     PszPlan)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    UPDATE_PLAN_HOP rgsHops[UPDATE_PLAN_MAX_HOPS];
+    unsigned int unHopCount = 0;
+    unsigned int unHop = 0;
+
+    Platform_MemorySet(rgsHops, 0, sizeof(rgsHops));
+
+    do
+    {
+        const char* szPath = PszPlan;
+        unsigned int unNextHop = 0;
+
+        // Read the images of the plan
+        unReturnValue = RC_SUCCESS;
+        while (RC_SUCCESS == unReturnValue && '\0' != *szPath)
+        {
+            char szImagePath[MAX_PATH];
+            size_t nLength = strcspn(szPath, ",");
+
+            if (unHopCount == UPDATE_PLAN_MAX_HOPS || 0 == nLength || nLength >= sizeof(szImagePath))
+            {
+                unReturnValue = RC_E_BAD_PARAMETER;
+                fprintf(stderr, "Error: The plan must list 1 to %d image paths separated by commas.\n", UPDATE_PLAN_MAX_HOPS);
+                break;
+            }
+            Platform_MemorySet(szImagePath, 0, sizeof(szImagePath));
+            IGNORE_RETURN_VALUE(Platform_MemoryCopy(szImagePath, sizeof(szImagePath), szPath, (unsigned int)nLength));
+            unReturnValue = IFXTPMUpdateCli_ReadFile(szImagePath, &rgsHops[unHopCount].rgbImage, &rgsHops[unHopCount].unImageSize);
+            unHopCount++;
+
+            szPath += nLength;
+            if (',' == *szPath)
+                szPath++;
+        }
+        if (RC_SUCCESS != unReturnValue)
+            break;
+
+        unReturnValue = FirmwareUpdate_RunUpdatePlan(rgsHops, unHopCount, IFXTPMUpdateCli_ProgressCallback, &unNextHop);
+        printf("\n");
+        if (RC_E_RESTART_REQUIRED == unReturnValue)
+        {
+            printf("Hops 1 to %u of %u have been applied. Restart the TPM and run the same plan again to continue.\n", unNextHop, unHopCount);
+            break;
+        }
+        if (RC_SUCCESS != unReturnValue)
+        {
+            fprintf(stderr, "Error: Hop %u of %u of the plan failed.\n", unNextHop + 1, unHopCount);
+            break;
+        }
+
+        IFXTPMUpdateCli_PrintPhaseTiming();
+        printf("The TPM firmware has been updated with all %u images of the plan.\n", unHopCount);
+    }
+    WHILE_FALSE_END;
+
+    for (unHop = 0; unHop < unHopCount; unHop++)
+        Platform_MemoryFree((void**)&rgsHops[unHop].rgbImage);
+
+    return unReturnValue;
+}
+
+/**
+ *  @brief      Entry point of the command line tool
+ *  @details
+ *
+ *  @param      argc                Number of arguments.
+ *  @param      argv                Arguments.
+ *
+ *  @returns    0 on success, 1 on failure and 2 for an invalid command line.
+ */
+int
+main(
+    _In_                int     argc,
+    _In_count_(argc)    char**  argv)
+{
+    unsigned int unReturnValue = RC_E_FAIL;
+    BYTE* pbImage = NULL;
+    BOOL fConnected = FALSE;
+    IFXTPMUPDATECLI_OPTIONS sOptions;
+
+    if (RC_SUCCESS != IFXTPMUpdateCli_ParseCommandLine(argc, argv, &sOptions))
+    {
+        IFXTPMUpdateCli_PrintUsage();
+        return 2;
+    }
+    g_unLoggingLevel = sOptions.unLoggingLevel;
+
+    do
+    {
+        unsigned int unImageSize = 0;
+        struct stat sStat;
+        BOOL fDirectory = NULL != sOptions.szImagePath && IFXTPMUPDATECLI_OPERATION_PLAN != sOptions.eOperation &&
+                          0 == stat(sOptions.szImagePath, &sStat) && S_ISDIR(sStat.st_mode);
+
+        if (RC_SUCCESS != Platform_ArenaInitialize(IFXTPMUPDATECLI_ARENA_SIZE))
+            break;
+        Crypt_Initialize();
+
+        if (NULL != sOptions.szImagePath && !fDirectory && IFXTPMUPDATECLI_OPERATION_PLAN != sOptions.eOperation)
+        {
+            unReturnValue = IFXTPMUpdateCli_ReadFile(sOptions.szImagePath, &pbImage, &unImageSize);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        unReturnValue = IFXTPMUpdateCli_Connect(&sOptions);
+        if (RC_SUCCESS != unReturnValue)
+            break;
+        fConnected = TRUE;
+
+        if (fDirectory)
+        {
+            unReturnValue = IFXTPMUpdateCli_SelectImage(sOptions.szImagePath, &pbImage, &unImageSize);
+            if (RC_SUCCESS != unReturnValue)
+                break;
+        }
+
+        switch (sOptions.eOperation)
+        {
+            case IFXTPMUPDATECLI_OPERATION_INFO:
+                unReturnValue = IFXTPMUpdateCli_Info();
+                break;
+            case IFXTPMUPDATECLI_OPERATION_CHECK:
+                unReturnValue = IFXTPMUpdateCli_CheckImage(pbImage, unImageSize);
+                break;
+            case IFXTPMUPDATECLI_OPERATION_PLAN:
+                unReturnValue = IFXTPMUpdateCli_RunPlan(sOptions.szImagePath);
+                break;
+            default:
+                unReturnValue = IFXTPMUpdateCli_UpdateImage(pbImage, unImageSize);
+                break;
+        }
+    }
+    WHILE_FALSE_END;
+
+    if (RC_SUCCESS != unReturnValue)
+        fprintf(stderr, "Error: The operation failed (0x%.8X).\n", unReturnValue);
+
+    if (fConnected)
+        IGNORE_RETURN_VALUE(DeviceManagement_Disconnect());
+    DeviceManagement_Uninitialize();
+    TpmReplay_Unload();
+    Platform_MemoryFree((void**)&pbImage);
+    Crypt_Uninitialize();
+    Platform_ArenaUninitialize();
+
+    return RC_SUCCESS == unReturnValue ? 0 : 1;
+}
@@ -0,0 +1,205 @@
+/**
+ *  @brief      Implements logging methods for the command line tool
+ *  @details    This module writes the log messages to stderr, so they do not mix with the regular output on stdout.
+ *  @file       IFXTPMUpdateCli/Logging.c
+ *
+ *  Copyright 2014 - 2022 Infineon Technologies AG ( www.infineon.com )
+ *
+ *  Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+ *  1. Redistributions of source code must retain the above copyright notice, this list of conditions and the following disclaimer.
+ *  2. Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the following disclaimer in the documentation and/or other materials provided with the distribution.
+ *  3. Neither the name of the copyright holder nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "Logging.h"
+#include "Utility.h"
+
+#include <stdio.h>
+
+/// Flag indicating whether to write a header into the log file or not
+BOOL g_fLogHeader = TRUE;
+
+/// Current log level (set by the -log option)
+unsigned int g_unLoggingLevel = LOGGING_DISABLED;
+
+/// Capacity of the buffer used to format a log message in elements
+#define LOGGING_MESSAGE_CAPACITY    6144
+
+/// Buffer to format a log message in
+static wchar_t s_wszMessage[LOGGING_MESSAGE_CAPACITY];
+
+/// Buffer for the UTF-8 encoding of a log message (up to three bytes per UTF-16 code unit)
+static char s_szMessage[LOGGING_MESSAGE_CAPACITY * 3];
+
+/// Flag indicating whether logging is already ongoing (s_wszMessage is in use)
+static BOOL s_fInLogging = FALSE;
+
+/**
+ *  @brief      Writes a message to stderr
+ *  @details    Converts the UTF-16 message to UTF-8. Surrogate pairs are combined, unpaired surrogates are replaced by '?'.
+ *
+ *  @param      PwszMessage         Null-terminated message.
+ */
+static
+void
+Logging_Output(
+    _In_z_  const wchar_t*  PwszMessage)
+{
+    unsigned int unCount = 0;
+    const wchar_t* pwszPosition = NULL;
+
+    for (pwszPosition = PwszMessage; L'\0' != *pwszPosition && unCount < sizeof(s_szMessage) - 4; pwszPosition++)
+    {
+        unsigned int unCodePoint = (UINT16)*pwszPosition;
+        if (unCodePoint >= 0xD800 && unCodePoint <= 0xDBFF && pwszPosition[1] >= 0xDC00 && pwszPosition[1] <= 0xDFFF)
+        {
+            unCodePoint = 0x10000 + ((unCodePoint - 0xD800) << 10) + ((UINT16)pwszPosition[1] - 0xDC00);
+            pwszPosition++;
+        }
+        else if (unCodePoint >= 0xD800 && unCodePoint <= 0xDFFF)
+            unCodePoint = '?';
+
+        if (unCodePoint < 0x80)
+            s_szMessage[unCount++] = (char)unCodePoint;
+        else if (unCodePoint < 0x800)
+        {
+            s_szMessage[unCount++] = (char)(0xC0 | (unCodePoint >> 6));
+            s_szMessage[unCount++] = (char)(0x80 | (unCodePoint & 0x3F));
+        }
+        else if (unCodePoint < 0x10000)
+        {
+            s_szMessage[unCount++] = (char)(0xE0 | (unCodePoint >> 12));
+            s_szMessage[unCount++] = (char)(0x80 | ((unCodePoint >> 6) & 0x3F));
+            s_szMessage[unCount++] = (char)(0x80 | (unCodePoint & 0x3F));
+        }
+        else
+        {
+            s_szMessage[unCount++] = (char)(0xF0 | (unCodePoint >> 18));
+            s_szMessage[unCount++] = (char)(0x80 | ((unCodePoint >> 12) & 0x3F));
+            s_szMessage[unCount++] = (char)(0x80 | ((unCodePoint >> 6) & 0x3F));
+            s_szMessage[unCount++] = (char)(0x80 | (unCodePoint & 0x3F));
+        }
+    }
+    s_szMessage[unCount] = '\0';
+
+    fputs(s_szMessage, stderr);
+}
+
+/**
+ *  @brief      Writes the time-stamp of a log message into the message buffer
+ *  @details
+ *
+ *  @returns    Count of written characters (incl. the separating blank) or 0 if the time-stamp cannot be returned.
+ */
+static
+unsigned int
+Logging_WriteTimestamp()
+{
+    unsigned int unSize = RG_LEN(s_wszMessage);
+
+    if (RC_SUCCESS != Utility_GetTimestamp(TRUE, s_wszMessage, &unSize))
+        return 0;
+
+    s_wszMessage[unSize++] = L' ';
+    return unSize;
+}
+
+/**
+ *  @brief      Logging function
+ *  @details    Logs all messages up to the current log level to stderr.
+ *
+ *  @param      PszCurrentModule        Pointer to a char array holding the module name (optional, can be NULL).
+ *  @param      PszCurrentFunction      Pointer to a char array holding the function name (optional, can be NULL).
+ *  @param      PunLoggingLevel         Logging level.
+ *  @param      PwszLoggingMessage      Format string used to format the message.
+ *  @param      ...                     Parameters needed to format the message.
+ */
+void
+IFXAPI
+Logging_WriteLog(
+    _In_z_  const char*     PszCurrentModule,
+    _In_z_  const char*     PszCurrentFunction,
+    _In_    unsigned int    PunLoggingLevel,
+    _In_z_  const wchar_t*  PwszLoggingMessage,
+    ...)
+{
+    UNREFERENCED_PARAMETER(PszCurrentModule);
+    UNREFERENCED_PARAMETER(PszCurrentFunction);
+    do
+    {
+        unsigned int unCount = 0;
+        unsigned int unSize = 0;
+        va_list argptr;
+
+        // Skip empty messages and messages logged while formatting
+        if (PunLoggingLevel > g_unLoggingLevel || NULL == PwszLoggingMessage || L'\0' == PwszLoggingMessage[0] || s_fInLogging)
+            break;
+
+        s_fInLogging = TRUE;
+        unCount = Logging_WriteTimestamp();
+        unSize = RG_LEN(s_wszMessage) - unCount;
+
+        va_start(argptr, PwszLoggingMessage);
+        // A truncated message is logged as well
+        if (RC_SUCCESS != Platform_StringFormatV(&s_wszMessage[unCount], &unSize, PwszLoggingMessage, argptr))
+            s_wszMessage[RG_LEN(s_wszMessage) - 1] = L'\0';
+        va_end(argptr);
+
+        Logging_Output(s_wszMessage);
+        fputc('\n', stderr);
+        s_fInLogging = FALSE;
+    }
+    WHILE_FALSE_END
+}
+
+/**
+ *  @brief      Log hex dump function
+ *  @details    Writes the given data as hex dump to stderr.
+ *
+ *  @param      PszCurrentModule        Pointer to a char array holding the module name (optional, can be NULL).
+ *  @param      PszCurrentFunction      Pointer to a char array holding the function name (optional, can be NULL).
+ *  @param      PunLoggingLevel         Logging level.
+ *  @param      PrgbHexData             Format string used to format the message.
+ *  @param      PunSize                 Size of hex data buffer.
+ */
+void
+Logging_WriteHex(
+    _In_z_                  const char*     PszCurrentModule,
+    _In_z_                  const char*     PszCurrentFunction,
+    _In_                    unsigned int    PunLoggingLevel,
+    _In_bytecount_(PunSize) const BYTE*     PrgbHexData,
+    _In_                    unsigned int    PunSize)
+{
+    UNREFERENCED_PARAMETER(PszCurrentModule);
+    UNREFERENCED_PARAMETER(PszCurrentFunction);
+    do
+    {
+        unsigned int unOffset = 0;
+        unsigned int unCount = 0;
+
+        // Check parameters
+        if (PunLoggingLevel > g_unLoggingLevel || NULL == PrgbHexData || 0 == PunSize || s_fInLogging)
+            break;
+
+        s_fInLogging = TRUE;
+        unCount = Logging_WriteTimestamp();
+        if (0 != unCount)
+        {
+            s_wszMessage[unCount - 1] = L'\0';
+            Logging_Output(s_wszMessage);
+            fputc('\n', stderr);
+        }
+
+        // Log the hex dump in chunks of complete lines, each chunk continues the previous one
+        while (unOffset < PunSize)
+        {
+            unsigned int unSize = LOGGING_HEX_CHUNK_SIZE;
+            if (RC_SUCCESS != Utility_StringWriteHexPart(PrgbHexData, PunSize, &unOffset, s_wszMessage, &unSize))
+                break;
+            Logging_Output(s_wszMessage);
+        }
+        s_fInLogging = FALSE;
+    }
+    WHILE_FALSE_END
+}